@@ -3666,6 +3666,14 @@ void radv_CmdBindPipeline(
 	RADV_FROM_HANDLE(radv_cmd_buffer, cmd_buffer, commandBuffer);
 	RADV_FROM_HANDLE(radv_pipeline, pipeline, _pipeline);
 
+	if (pipeline) {
+		VkResult result = radv_pipeline_wait_ready(pipeline);
+		if (result != VK_SUCCESS) {
+			cmd_buffer->record_result = result;
+			return;
+		}
+	}
+
 	switch (pipelineBindPoint) {
 	case VK_PIPELINE_BIND_POINT_COMPUTE:
 		if (cmd_buffer->state.compute_pipeline == pipeline)
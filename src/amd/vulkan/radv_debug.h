@@ -55,6 +55,9 @@ enum {
 	RADV_DEBUG_NO_NGG            = 0x2000000,
 	RADV_DEBUG_NO_SHADER_BALLOT  = 0x4000000,
 	RADV_DEBUG_ALL_ENTRYPOINTS   = 0x8000000,
+	RADV_DEBUG_NO_THREAD_COMPILE = 0x10000000,
+	RADV_DEBUG_CACHE_STATS       = 0x20000000,
+	RADV_DEBUG_SHADER_ARENA_STATS = 0x40000000,
 };
 
 enum {
@@ -69,6 +72,7 @@ enum {
 	RADV_PERFTEST_CS_WAVE_32     = 0x100,
 	RADV_PERFTEST_PS_WAVE_32     = 0x200,
 	RADV_PERFTEST_GE_WAVE_32     = 0x400,
+	RADV_PERFTEST_ASYNC_PIPELINES = 0x800,
 };
 
 bool
@@ -28,6 +28,7 @@
 #include <fcntl.h>
 
 #include "util/mesa-sha1.h"
+#include "util/u_math.h"
 #include "radv_private.h"
 #include "sid.h"
 #include "vk_format.h"
@@ -469,6 +470,201 @@ void radv_DestroyPipelineLayout(
 
 #define EMPTY 1
 
+#define NO_FREE_BLOCK UINT32_MAX
+
+/* Descriptor sets are 32 byte aligned. */
+static unsigned
+radv_descriptor_pool_block_class(uint32_t size)
+{
+	return MIN2(util_logbase2(size / 32),
+		    RADV_DESCRIPTOR_POOL_SIZE_CLASSES - 1);
+}
+
+static struct radv_descriptor_pool_free_block *
+radv_descriptor_pool_get_block(struct radv_descriptor_pool *pool,
+			       uint32_t index)
+{
+	return util_dynarray_element(&pool->free_blocks,
+				     struct radv_descriptor_pool_free_block,
+				     index);
+}
+
+static void
+radv_descriptor_pool_reset_free_blocks(struct radv_descriptor_pool *pool)
+{
+	util_dynarray_clear(&pool->free_blocks);
+	pool->unused_free_blocks = NO_FREE_BLOCK;
+	for (unsigned i = 0; i < RADV_DESCRIPTOR_POOL_SIZE_CLASSES; i++)
+		pool->free_block_lists[i] = NO_FREE_BLOCK;
+}
+
+static void
+radv_descriptor_pool_free_range(struct radv_descriptor_pool *pool,
+				uint32_t offset, uint32_t size)
+{
+	struct radv_descriptor_pool_free_block *block;
+	uint32_t index;
+
+	/* Give the end of the used range back to the linear allocator. */
+	if (offset + size == pool->current_offset) {
+		pool->current_offset = offset;
+		return;
+	}
+
+	if (pool->unused_free_blocks != NO_FREE_BLOCK) {
+		index = pool->unused_free_blocks;
+		block = radv_descriptor_pool_get_block(pool, index);
+		pool->unused_free_blocks = block->next;
+	} else {
+		index = util_dynarray_num_elements(&pool->free_blocks,
+						   struct radv_descriptor_pool_free_block);
+		block = util_dynarray_grow(&pool->free_blocks,
+					   struct radv_descriptor_pool_free_block, 1);
+		/* The range is lost until the pool is reset. */
+		if (!block)
+			return;
+	}
+
+	unsigned class = radv_descriptor_pool_block_class(size);
+
+	block->offset = offset;
+	block->size = size;
+	block->next = pool->free_block_lists[class];
+	pool->free_block_lists[class] = index;
+}
+
+static int
+radv_descriptor_pool_block_compare(const void *a, const void *b)
+{
+	const struct radv_descriptor_pool_free_block *block_a = a;
+	const struct radv_descriptor_pool_free_block *block_b = b;
+
+	return block_a->offset < block_b->offset ? -1 :
+	       block_a->offset > block_b->offset;
+}
+
+/* Merge adjacent free ranges. Only done when an allocation fails, so
+ * the lists don't need to be kept sorted.
+ */
+static void
+radv_descriptor_pool_merge_free_ranges(struct radv_descriptor_pool *pool)
+{
+	struct radv_descriptor_pool_free_block *blocks;
+	unsigned count = 0;
+
+	blocks = malloc(pool->free_blocks.size);
+	if (!blocks)
+		return;
+
+	for (unsigned i = 0; i < RADV_DESCRIPTOR_POOL_SIZE_CLASSES; i++) {
+		uint32_t index = pool->free_block_lists[i];
+
+		while (index != NO_FREE_BLOCK) {
+			blocks[count] = *radv_descriptor_pool_get_block(pool, index);
+			index = blocks[count++].next;
+		}
+	}
+
+	qsort(blocks, count, sizeof(*blocks), radv_descriptor_pool_block_compare);
+
+	unsigned merged = 0;
+	for (unsigned i = 0; i < count; i++) {
+		if (merged &&
+		    blocks[merged - 1].offset + blocks[merged - 1].size == blocks[i].offset)
+			blocks[merged - 1].size += blocks[i].size;
+		else
+			blocks[merged++] = blocks[i];
+	}
+
+	/* Free from the end, so that ranges that reach the linear
+	 * allocator's offset are all given back to it.
+	 */
+	radv_descriptor_pool_reset_free_blocks(pool);
+	for (unsigned i = merged; i-- > 0;)
+		radv_descriptor_pool_free_range(pool, blocks[i].offset, blocks[i].size);
+
+	free(blocks);
+}
+
+static bool
+radv_descriptor_pool_find_range(struct radv_descriptor_pool *pool,
+				uint32_t size, uint32_t *offset)
+{
+	/* All the blocks of the classes after the one of the size are
+	 * large enough, so only the first list may need to be searched.
+	 */
+	for (unsigned class = radv_descriptor_pool_block_class(size);
+	     class < RADV_DESCRIPTOR_POOL_SIZE_CLASSES; class++) {
+		uint32_t *link = &pool->free_block_lists[class];
+
+		while (*link != NO_FREE_BLOCK) {
+			uint32_t index = *link;
+			struct radv_descriptor_pool_free_block *block =
+				radv_descriptor_pool_get_block(pool, index);
+
+			if (block->size < size) {
+				link = &block->next;
+				continue;
+			}
+
+			uint32_t remaining_offset = block->offset + size;
+			uint32_t remaining_size = block->size - size;
+
+			*offset = block->offset;
+			*link = block->next;
+			block->next = pool->unused_free_blocks;
+			pool->unused_free_blocks = index;
+
+			if (remaining_size)
+				radv_descriptor_pool_free_range(pool, remaining_offset,
+								remaining_size);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool
+radv_descriptor_pool_alloc_range(struct radv_descriptor_pool *pool,
+				 uint32_t size, uint32_t *offset)
+{
+	if (radv_descriptor_pool_find_range(pool, size, offset))
+		return true;
+
+	if (pool->current_offset + size <= pool->size) {
+		*offset = pool->current_offset;
+		pool->current_offset += size;
+		return true;
+	}
+
+	radv_descriptor_pool_merge_free_ranges(pool);
+
+	if (radv_descriptor_pool_find_range(pool, size, offset))
+		return true;
+
+	if (pool->current_offset + size <= pool->size) {
+		*offset = pool->current_offset;
+		pool->current_offset += size;
+		return true;
+	}
+
+	return false;
+}
+
+static void
+radv_descriptor_pool_free_set_object(struct radv_descriptor_pool *pool,
+				     struct radv_descriptor_set *set)
+{
+	unsigned class = set->host_size_class;
+
+	/* The object is reused for the next set of the same size class, the
+	 * list is linked through its first bytes.
+	 */
+	*(void **)set = pool->free_sets[class];
+	pool->free_sets[class] = set;
+}
+
 static VkResult
 radv_descriptor_set_create(struct radv_device *device,
 			   struct radv_descriptor_pool *pool,
@@ -491,6 +687,8 @@ radv_descriptor_set_create(struct radv_device *device,
 	unsigned mem_size = range_offset +
 		sizeof(struct radv_descriptor_range) * layout->dynamic_offset_count;
 
+	unsigned host_size_class = 0;
+
 	if (pool->host_memory_base) {
 		if (pool->host_memory_end - pool->host_memory_ptr < mem_size)
 			return vk_error(device->instance, VK_ERROR_OUT_OF_POOL_MEMORY);
@@ -498,14 +696,25 @@ radv_descriptor_set_create(struct radv_device *device,
 		set = (struct radv_descriptor_set*)pool->host_memory_ptr;
 		pool->host_memory_ptr += mem_size;
 	} else {
-		set = vk_alloc2(&device->alloc, NULL, mem_size, 8,
-		                VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+		if (pool->entry_count == pool->max_entry_count)
+			return vk_error(device->instance, VK_ERROR_OUT_OF_POOL_MEMORY);
 
-		if (!set)
-			return vk_error(device->instance, VK_ERROR_OUT_OF_HOST_MEMORY);
+		host_size_class = util_logbase2_ceil(mem_size);
+		set = pool->free_sets[host_size_class];
+		if (set) {
+			pool->free_sets[host_size_class] = *(void **)set;
+		} else {
+			set = vk_alloc2(&device->alloc, NULL,
+			                1u << host_size_class, 8,
+			                VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+
+			if (!set)
+				return vk_error(device->instance, VK_ERROR_OUT_OF_HOST_MEMORY);
+		}
 	}
 
 	memset(set, 0, mem_size);
+	set->host_size_class = host_size_class;
 
 	if (layout->dynamic_offset_count) {
 		set->dynamic_descriptors = (struct radv_descriptor_range*)((uint8_t*)set + range_offset);
@@ -526,50 +735,34 @@ radv_descriptor_set_create(struct radv_device *device,
 	if (layout_size) {
 		set->size = layout_size;
 
-		if (!pool->host_memory_base && pool->entry_count == pool->max_entry_count) {
-			vk_free2(&device->alloc, NULL, set);
-			return vk_error(device->instance, VK_ERROR_OUT_OF_POOL_MEMORY);
-		}
+		/* Pools without FREE_DESCRIPTOR_SET_BIT are only allocated
+		 * linearly and reset.
+		 */
+		if (pool->host_memory_base) {
+			if (pool->current_offset + layout_size > pool->size)
+				return vk_error(device->instance, VK_ERROR_OUT_OF_POOL_MEMORY);
 
-		/* try to allocate linearly first, so that we don't spend
-		 * time looking for gaps if the app only allocates &
-		 * resets via the pool. */
-		if (pool->current_offset + layout_size <= pool->size) {
 			set->bo = pool->bo;
 			set->mapped_ptr = (uint32_t*)(pool->mapped_ptr + pool->current_offset);
 			set->va = radv_buffer_get_va(set->bo) + pool->current_offset;
-			if (!pool->host_memory_base) {
-				pool->entries[pool->entry_count].offset = pool->current_offset;
-				pool->entries[pool->entry_count].size = layout_size;
-				pool->entries[pool->entry_count].set = set;
-				pool->entry_count++;
-			}
 			pool->current_offset += layout_size;
-		} else if (!pool->host_memory_base) {
-			uint64_t offset = 0;
-			int index;
-
-			for (index = 0; index < pool->entry_count; ++index) {
-				if (pool->entries[index].offset - offset >= layout_size)
-					break;
-				offset = pool->entries[index].offset + pool->entries[index].size;
-			}
+		} else {
+			uint32_t offset;
 
-			if (pool->size - offset < layout_size) {
-				vk_free2(&device->alloc, NULL, set);
+			if (!radv_descriptor_pool_alloc_range(pool, layout_size, &offset)) {
+				radv_descriptor_pool_free_set_object(pool, set);
 				return vk_error(device->instance, VK_ERROR_OUT_OF_POOL_MEMORY);
 			}
+
 			set->bo = pool->bo;
 			set->mapped_ptr = (uint32_t*)(pool->mapped_ptr + offset);
 			set->va = radv_buffer_get_va(set->bo) + offset;
-			memmove(&pool->entries[index + 1], &pool->entries[index],
-				sizeof(pool->entries[0]) * (pool->entry_count - index));
-			pool->entries[index].offset = offset;
-			pool->entries[index].size = layout_size;
-			pool->entries[index].set = set;
-			pool->entry_count++;
-		} else
-			return vk_error(device->instance, VK_ERROR_OUT_OF_POOL_MEMORY);
+		}
+	}
+
+	if (!pool->host_memory_base) {
+		set->pool_entry = pool->entry_count;
+		pool->entries[pool->entry_count++].set = set;
 	}
 
 	if (layout->has_immutable_samplers) {
@@ -597,23 +790,39 @@ radv_descriptor_set_create(struct radv_device *device,
 static void
 radv_descriptor_set_destroy(struct radv_device *device,
 			    struct radv_descriptor_pool *pool,
-			    struct radv_descriptor_set *set,
-			    bool free_bo)
+			    struct radv_descriptor_set *set)
 {
 	assert(!pool->host_memory_base);
 
-	if (free_bo && set->size && !pool->host_memory_base) {
+	if (set->size) {
 		uint32_t offset = (uint8_t*)set->mapped_ptr - pool->mapped_ptr;
-		for (int i = 0; i < pool->entry_count; ++i) {
-			if (pool->entries[i].offset == offset) {
-				memmove(&pool->entries[i], &pool->entries[i+1],
-					sizeof(pool->entries[i]) * (pool->entry_count - i - 1));
-				--pool->entry_count;
-				break;
-			}
+		radv_descriptor_pool_free_range(pool, offset, set->size);
+	}
+
+	struct radv_descriptor_set *last = pool->entries[--pool->entry_count].set;
+	pool->entries[set->pool_entry].set = last;
+	last->pool_entry = set->pool_entry;
+
+	radv_descriptor_pool_free_set_object(pool, set);
+}
+
+static void
+radv_descriptor_pool_free_set_objects(struct radv_device *device,
+				      struct radv_descriptor_pool *pool)
+{
+	for (unsigned i = 0; i < pool->entry_count; ++i)
+		vk_free2(&device->alloc, NULL, pool->entries[i].set);
+
+	for (unsigned i = 0; i < RADV_DESCRIPTOR_POOL_SIZE_CLASSES; ++i) {
+		void *set = pool->free_sets[i];
+
+		while (set) {
+			void *next = *(void **)set;
+			vk_free2(&device->alloc, NULL, set);
+			set = next;
 		}
+		pool->free_sets[i] = NULL;
 	}
-	vk_free2(&device->alloc, NULL, set);
 }
 
 VkResult radv_CreateDescriptorPool(
@@ -711,6 +920,9 @@ VkResult radv_CreateDescriptorPool(
 	pool->size = bo_size;
 	pool->max_entry_count = pCreateInfo->maxSets;
 
+	util_dynarray_init(&pool->free_blocks, NULL);
+	radv_descriptor_pool_reset_free_blocks(pool);
+
 	*pDescriptorPool = radv_descriptor_pool_to_handle(pool);
 	return VK_SUCCESS;
 }
@@ -726,11 +938,10 @@ void radv_DestroyDescriptorPool(
 	if (!pool)
 		return;
 
-	if (!pool->host_memory_base) {
-		for(int i = 0; i < pool->entry_count; ++i) {
-			radv_descriptor_set_destroy(device, pool, pool->entries[i].set, false);
-		}
-	}
+	if (!pool->host_memory_base)
+		radv_descriptor_pool_free_set_objects(device, pool);
+
+	util_dynarray_fini(&pool->free_blocks);
 
 	if (pool->bo)
 		device->ws->buffer_destroy(pool->bo);
@@ -742,16 +953,16 @@ VkResult radv_ResetDescriptorPool(
 	VkDescriptorPool                            descriptorPool,
 	VkDescriptorPoolResetFlags                  flags)
 {
-	RADV_FROM_HANDLE(radv_device, device, _device);
 	RADV_FROM_HANDLE(radv_descriptor_pool, pool, descriptorPool);
 
+	/* Keep the set objects for the next allocations. */
 	if (!pool->host_memory_base) {
-		for(int i = 0; i < pool->entry_count; ++i) {
-			radv_descriptor_set_destroy(device, pool, pool->entries[i].set, false);
-		}
+		for (unsigned i = 0; i < pool->entry_count; ++i)
+			radv_descriptor_pool_free_set_object(pool, pool->entries[i].set);
 		pool->entry_count = 0;
 	}
 
+	radv_descriptor_pool_reset_free_blocks(pool);
 	pool->current_offset = 0;
 	pool->host_memory_ptr = pool->host_memory_base;
 
@@ -819,7 +1030,7 @@ VkResult radv_FreeDescriptorSets(
 		RADV_FROM_HANDLE(radv_descriptor_set, set, pDescriptorSets[i]);
 
 		if (set && !pool->host_memory_base)
-			radv_descriptor_set_destroy(device, pool, set, true);
+			radv_descriptor_set_destroy(device, pool, set);
 	}
 	return VK_SUCCESS;
 }
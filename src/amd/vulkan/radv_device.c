@@ -476,6 +476,9 @@ static const struct debug_control radv_debug_options[] = {
 	{"nongg", RADV_DEBUG_NO_NGG},
 	{"noshaderballot", RADV_DEBUG_NO_SHADER_BALLOT},
 	{"allentrypoints", RADV_DEBUG_ALL_ENTRYPOINTS},
+	{"nothreadcompile", RADV_DEBUG_NO_THREAD_COMPILE},
+	{"cachestats", RADV_DEBUG_CACHE_STATS},
+	{"shaderarenastats", RADV_DEBUG_SHADER_ARENA_STATS},
 	{NULL, 0}
 };
 
@@ -497,6 +500,7 @@ static const struct debug_control radv_perftest_options[] = {
 	{"cswave32", RADV_PERFTEST_CS_WAVE_32},
 	{"pswave32", RADV_PERFTEST_PS_WAVE_32},
 	{"gewave32", RADV_PERFTEST_GE_WAVE_32},
+	{"asyncpipelines", RADV_PERFTEST_ASYNC_PIPELINES},
 	{NULL, 0}
 };
 
@@ -1996,6 +2000,20 @@ VkResult radv_CreateDevice(
 
 	device->keep_shader_info = keep_shader_info;
 
+	/* Dumped shaders and statistics would be interleaved. */
+	if (!(device->instance->debug_flags & (RADV_DEBUG_NO_THREAD_COMPILE |
+	                                       RADV_DEBUG_DUMP_SHADERS |
+	                                       RADV_DEBUG_DUMP_SHADER_STATS))) {
+		long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		/* Without threads, shaders are just compiled serially. */
+		if (num_cpus > 1)
+			util_queue_init(&device->shader_compiler_queue, "radvsh",
+			                64, MIN2(num_cpus, 16),
+			                UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+			                UTIL_QUEUE_INIT_SHARED_POOL);
+	}
+
 	result = radv_device_init_meta(device);
 	if (result != VK_SUCCESS)
 		goto fail;
@@ -2051,6 +2069,9 @@ VkResult radv_CreateDevice(
 fail_meta:
 	radv_device_finish_meta(device);
 fail:
+	if (util_queue_is_initialized(&device->shader_compiler_queue))
+		util_queue_destroy(&device->shader_compiler_queue);
+
 	radv_bo_list_finish(&device->bo_list);
 
 	if (device->trace_bo)
@@ -2095,6 +2116,9 @@ void radv_DestroyDevice(
 	}
 	radv_device_finish_meta(device);
 
+	if (util_queue_is_initialized(&device->shader_compiler_queue))
+		util_queue_destroy(&device->shader_compiler_queue);
+
 	VkPipelineCache pc = radv_pipeline_cache_to_handle(device->mem_cache);
 	radv_DestroyPipelineCache(radv_device_to_handle(device), pc, NULL);
 
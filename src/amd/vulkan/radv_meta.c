@@ -355,8 +355,14 @@ radv_device_init_meta(struct radv_device *device)
 
 	device->meta_state.cache.alloc = device->meta_state.alloc;
 	radv_pipeline_cache_init(&device->meta_state.cache, device);
-	bool loaded_cache = radv_load_meta_pipeline(device);
-	bool on_demand = !loaded_cache;
+	radv_load_meta_pipeline(device);
+
+	/* Meta shaders go through the shader disk cache like application
+	 * shaders, so cold starts load them from disk instead of compiling
+	 * them. Only create the pipelines on first use either way, there
+	 * are a lot of them and most are never used.
+	 */
+	bool on_demand = true;
 
 	mtx_init(&device->meta_state.mtx, mtx_plain);
 
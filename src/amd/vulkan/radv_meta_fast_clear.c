@@ -642,6 +642,8 @@ radv_process_color_image(struct radv_cmd_buffer *cmd_buffer,
 			 bool decompress_dcc)
 {
 	struct radv_meta_saved_state saved_state;
+	bool old_predicating = cmd_buffer->state.predicating;
+	bool predicated = false;
 	VkPipeline *pipeline;
 
 	if (decompress_dcc && radv_dcc_enabled(image, subresourceRange->baseMipLevel)) {
@@ -670,13 +672,31 @@ radv_process_color_image(struct radv_cmd_buffer *cmd_buffer,
 			     VK_PIPELINE_BIND_POINT_GRAPHICS, *pipeline);
 
 	for (uint32_t l = 0; l < radv_get_levelCount(image, subresourceRange); ++l) {
+		uint32_t level = subresourceRange->baseMipLevel + l;
 		uint32_t width, height;
 
 		/* Do not decompress levels without DCC. */
-		if (decompress_dcc &&
-		    !radv_dcc_enabled(image, subresourceRange->baseMipLevel + l))
+		if (decompress_dcc && !radv_dcc_enabled(image, level))
 			continue;
 
+		/* The predicates are tracked per level, so that only the
+		 * levels that were fast cleared or written compressed since
+		 * the last decompression are processed.
+		 */
+		if (radv_dcc_enabled(image, level)) {
+			uint64_t pred_offset = decompress_dcc ? image->dcc_pred_offset :
+								image->fce_pred_offset;
+			pred_offset += 8 * level;
+
+			radv_emit_set_predication_state_from_image(cmd_buffer, image, pred_offset, true);
+			cmd_buffer->state.predicating = true;
+			predicated = true;
+		} else if (predicated) {
+			radv_emit_set_predication_state_from_image(cmd_buffer, image, 0, false);
+			cmd_buffer->state.predicating = old_predicating;
+			predicated = false;
+		}
+
 		width = radv_minify(image->info.width,
 				    subresourceRange->baseMipLevel + l);
 		height = radv_minify(image->info.height,
@@ -704,6 +724,19 @@ radv_process_color_image(struct radv_cmd_buffer *cmd_buffer,
 		}
 	}
 
+	if (predicated) {
+		radv_emit_set_predication_state_from_image(cmd_buffer, image, 0, false);
+		cmd_buffer->state.predicating = old_predicating;
+	}
+
+	if (radv_dcc_enabled(image, subresourceRange->baseMipLevel) &&
+	    cmd_buffer->state.predication_type != -1) {
+		/* Restore previous conditional rendering user state. */
+		si_emit_set_predication_state(cmd_buffer,
+					      cmd_buffer->state.predication_type,
+					      cmd_buffer->state.predication_va);
+	}
+
 	radv_meta_restore(&saved_state, cmd_buffer);
 }
 
@@ -713,41 +746,11 @@ radv_emit_color_decompress(struct radv_cmd_buffer *cmd_buffer,
                            const VkImageSubresourceRange *subresourceRange,
                            bool decompress_dcc)
 {
-	bool old_predicating = false;
-
 	assert(cmd_buffer->queue_family_index == RADV_QUEUE_GENERAL);
 
-	if (radv_dcc_enabled(image, subresourceRange->baseMipLevel)) {
-		uint64_t pred_offset = decompress_dcc ? image->dcc_pred_offset :
-							image->fce_pred_offset;
-		pred_offset += 8 * subresourceRange->baseMipLevel;
-
-		old_predicating = cmd_buffer->state.predicating;
-
-		radv_emit_set_predication_state_from_image(cmd_buffer, image, pred_offset, true);
-		cmd_buffer->state.predicating = true;
-	}
-
 	radv_process_color_image(cmd_buffer, image, subresourceRange,
 				 decompress_dcc);
 
-	if (radv_dcc_enabled(image, subresourceRange->baseMipLevel)) {
-		uint64_t pred_offset = decompress_dcc ? image->dcc_pred_offset :
-							image->fce_pred_offset;
-		pred_offset += 8 * subresourceRange->baseMipLevel;
-
-		cmd_buffer->state.predicating = old_predicating;
-
-		radv_emit_set_predication_state_from_image(cmd_buffer, image, pred_offset, false);
-
-		if (cmd_buffer->state.predication_type != -1) {
-			/* Restore previous conditional rendering user state. */
-			si_emit_set_predication_state(cmd_buffer,
-						      cmd_buffer->state.predication_type,
-						      cmd_buffer->state.predication_va);
-		}
-	}
-
 	if (radv_dcc_enabled(image, subresourceRange->baseMipLevel)) {
 		/* Clear the image's fast-clear eliminate predicate because
 		 * FMASK and DCC also imply a fast-clear eliminate.
@@ -125,6 +125,11 @@ radv_pipeline_destroy(struct radv_device *device,
                       struct radv_pipeline *pipeline,
                       const VkAllocationCallbacks* allocator)
 {
+	if (pipeline->async.enabled) {
+		util_queue_fence_wait(&pipeline->async.fence);
+		util_queue_fence_destroy(&pipeline->async.fence);
+	}
+
 	for (unsigned i = 0; i < MESA_SHADER_STAGES; ++i)
 		if (pipeline->shaders[i])
 			radv_shader_variant_destroy(device, pipeline->shaders[i]);
@@ -2555,6 +2560,36 @@ void radv_stop_feedback(VkPipelineCreationFeedbackEXT *feedback, bool cache_hit)
 	                   (cache_hit ? VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT : 0);
 }
 
+struct radv_shader_compile_job {
+	struct util_queue_fence fence;
+	struct radv_device *device;
+	struct radv_shader_module *module;
+	struct nir_shader **nir;
+	struct radv_pipeline_layout *layout;
+	const struct radv_shader_variant_key *key;
+	struct radv_shader_info *info;
+	bool keep_executable_info;
+	struct radv_shader_binary **binary;
+	VkPipelineCreationFeedbackEXT *feedback;
+	struct radv_shader_variant *variant;
+};
+
+static void
+radv_shader_compile_job_execute(void *data, int thread_index)
+{
+	struct radv_shader_compile_job *job = data;
+
+	radv_start_feedback(job->feedback);
+
+	job->variant = radv_shader_variant_compile(job->device, job->module,
+						   job->nir, 1, job->layout,
+						   job->key, job->info,
+						   job->keep_executable_info,
+						   job->binary);
+
+	radv_stop_feedback(job->feedback, false);
+}
+
 static
 void radv_create_shaders(struct radv_pipeline *pipeline,
                          struct radv_device *device,
@@ -2564,8 +2599,11 @@ void radv_create_shaders(struct radv_pipeline *pipeline,
                          const VkPipelineCreateFlags flags,
                          const VkGraphicsPipelineCreateInfo *pCreateInfo,
                          VkPipelineCreationFeedbackEXT *pipeline_feedback,
-                         VkPipelineCreationFeedbackEXT **stage_feedbacks)
+                         VkPipelineCreationFeedbackEXT **stage_feedbacks,
+                         bool async_stages)
 {
+	struct radv_shader_compile_job fs_job = {0};
+	bool fs_async = false;
 	struct radv_shader_module fs_m = {0};
 	struct radv_shader_module *modules[MESA_SHADER_STAGES] = { 0, };
 	nir_shader *nir[MESA_SHADER_STAGES] = {0};
@@ -2690,32 +2728,41 @@ void radv_create_shaders(struct radv_pipeline *pipeline,
 		gfx9_get_gs_info(pCreateInfo, pipeline, nir, infos, gs_info);
 	}
 
-	if (nir[MESA_SHADER_FRAGMENT]) {
-		if (!pipeline->shaders[MESA_SHADER_FRAGMENT]) {
-			radv_start_feedback(stage_feedbacks[MESA_SHADER_FRAGMENT]);
-
-			pipeline->shaders[MESA_SHADER_FRAGMENT] =
-			       radv_shader_variant_compile(device, modules[MESA_SHADER_FRAGMENT], &nir[MESA_SHADER_FRAGMENT], 1,
-			                                  pipeline->layout, keys + MESA_SHADER_FRAGMENT,
-							  infos + MESA_SHADER_FRAGMENT,
-			                                  keep_executable_info, &binaries[MESA_SHADER_FRAGMENT]);
-
-			radv_stop_feedback(stage_feedbacks[MESA_SHADER_FRAGMENT], false);
+	/* The keys of the other stages only depend on the fragment shader
+	 * info filled above, so the fragment shader can be compiled on
+	 * another thread while the other stages are compiled here. Those
+	 * can't be compiled in parallel because the TES and GS keys depend
+	 * on the compiled TCS.
+	 */
+	if (nir[MESA_SHADER_FRAGMENT] && !pipeline->shaders[MESA_SHADER_FRAGMENT]) {
+		fs_job.device = device;
+		fs_job.module = modules[MESA_SHADER_FRAGMENT];
+		fs_job.nir = &nir[MESA_SHADER_FRAGMENT];
+		fs_job.layout = pipeline->layout;
+		fs_job.key = &keys[MESA_SHADER_FRAGMENT];
+		fs_job.info = &infos[MESA_SHADER_FRAGMENT];
+		fs_job.keep_executable_info = keep_executable_info;
+		fs_job.binary = &binaries[MESA_SHADER_FRAGMENT];
+		fs_job.feedback = stage_feedbacks[MESA_SHADER_FRAGMENT];
+
+		if (async_stages &&
+		    util_queue_is_initialized(&device->shader_compiler_queue)) {
+			for (int i = 0; i < MESA_SHADER_STAGES; ++i) {
+				if (i != MESA_SHADER_FRAGMENT &&
+				    modules[i] && !pipeline->shaders[i])
+					fs_async = true;
+			}
 		}
 
-		/* TODO: These are no longer used as keys we should refactor this */
-		keys[MESA_SHADER_VERTEX].vs_common_out.export_prim_id =
-		        pipeline->shaders[MESA_SHADER_FRAGMENT]->info.ps.prim_id_input;
-		keys[MESA_SHADER_VERTEX].vs_common_out.export_layer_id =
-		        pipeline->shaders[MESA_SHADER_FRAGMENT]->info.ps.layer_input;
-		keys[MESA_SHADER_VERTEX].vs_common_out.export_clip_dists =
-		        !!pipeline->shaders[MESA_SHADER_FRAGMENT]->info.ps.num_input_clips_culls;
-		keys[MESA_SHADER_TESS_EVAL].vs_common_out.export_prim_id =
-		        pipeline->shaders[MESA_SHADER_FRAGMENT]->info.ps.prim_id_input;
-		keys[MESA_SHADER_TESS_EVAL].vs_common_out.export_layer_id =
-		        pipeline->shaders[MESA_SHADER_FRAGMENT]->info.ps.layer_input;
-		keys[MESA_SHADER_TESS_EVAL].vs_common_out.export_clip_dists =
-		        !!pipeline->shaders[MESA_SHADER_FRAGMENT]->info.ps.num_input_clips_culls;
+		if (fs_async) {
+			util_queue_fence_init(&fs_job.fence);
+			util_queue_add_job(&device->shader_compiler_queue,
+					   &fs_job, &fs_job.fence,
+					   radv_shader_compile_job_execute, NULL);
+		} else {
+			radv_shader_compile_job_execute(&fs_job, 0);
+			pipeline->shaders[MESA_SHADER_FRAGMENT] = fs_job.variant;
+		}
 	}
 
 	if (device->physical_device->rad_info.chip_class >= GFX9 && modules[MESA_SHADER_TESS_CTRL]) {
@@ -2756,6 +2803,9 @@ void radv_create_shaders(struct radv_pipeline *pipeline,
 	}
 
 	for (int i = 0; i < MESA_SHADER_STAGES; ++i) {
+		if (i == MESA_SHADER_FRAGMENT && fs_async)
+			continue;
+
 		if(modules[i] && !pipeline->shaders[i]) {
 			if (i == MESA_SHADER_TESS_CTRL) {
 				keys[MESA_SHADER_TESS_CTRL].tcs.num_inputs = util_last_bit64(pipeline->shaders[MESA_SHADER_VERTEX]->info.vs.ls_outputs_written);
@@ -2811,6 +2861,12 @@ void radv_create_shaders(struct radv_pipeline *pipeline,
 		free(gs_copy_binary);
 	}
 
+	if (fs_async) {
+		util_queue_fence_wait(&fs_job.fence);
+		util_queue_fence_destroy(&fs_job.fence);
+		pipeline->shaders[MESA_SHADER_FRAGMENT] = fs_job.variant;
+	}
+
 	if (!keep_executable_info) {
 		radv_pipeline_cache_insert_shaders(device, cache, hash, pipeline->shaders,
 						   binaries);
@@ -4605,7 +4661,8 @@ radv_pipeline_init(struct radv_pipeline *pipeline,
 		   struct radv_device *device,
 		   struct radv_pipeline_cache *cache,
 		   const VkGraphicsPipelineCreateInfo *pCreateInfo,
-		   const struct radv_graphics_pipeline_create_info *extra)
+		   const struct radv_graphics_pipeline_create_info *extra,
+		   bool async_stages)
 {
 	VkResult result;
 	bool has_view_index = false;
@@ -4637,7 +4694,7 @@ radv_pipeline_init(struct radv_pipeline *pipeline,
 	}
 
 	struct radv_pipeline_key key = radv_generate_graphics_pipeline_key(pipeline, pCreateInfo, &blend, has_view_index);
-	radv_create_shaders(pipeline, device, cache, &key, pStages, pCreateInfo->flags, pCreateInfo, pipeline_feedback, stage_feedbacks);
+	radv_create_shaders(pipeline, device, cache, &key, pStages, pCreateInfo->flags, pCreateInfo, pipeline_feedback, stage_feedbacks, async_stages);
 
 	pipeline->graphics.spi_baryc_cntl = S_0286E0_FRONT_FACE_ALL_BITS(1);
 	radv_pipeline_init_multisample_state(pipeline, &blend, pCreateInfo);
@@ -4745,13 +4802,14 @@ radv_pipeline_init(struct radv_pipeline *pipeline,
 	return result;
 }
 
-VkResult
-radv_graphics_pipeline_create(
+static VkResult
+radv_graphics_pipeline_create_internal(
 	VkDevice _device,
 	VkPipelineCache _cache,
 	const VkGraphicsPipelineCreateInfo *pCreateInfo,
 	const struct radv_graphics_pipeline_create_info *extra,
 	const VkAllocationCallbacks *pAllocator,
+	bool async_stages,
 	VkPipeline *pPipeline)
 {
 	RADV_FROM_HANDLE(radv_device, device, _device);
@@ -4765,7 +4823,7 @@ radv_graphics_pipeline_create(
 		return vk_error(device->instance, VK_ERROR_OUT_OF_HOST_MEMORY);
 
 	result = radv_pipeline_init(pipeline, device, cache,
-				    pCreateInfo, extra);
+				    pCreateInfo, extra, async_stages);
 	if (result != VK_SUCCESS) {
 		radv_pipeline_destroy(device, pipeline, pAllocator);
 		return result;
@@ -4776,32 +4834,199 @@ radv_graphics_pipeline_create(
 	return VK_SUCCESS;
 }
 
-VkResult radv_CreateGraphicsPipelines(
+VkResult
+radv_graphics_pipeline_create(
+	VkDevice _device,
+	VkPipelineCache _cache,
+	const VkGraphicsPipelineCreateInfo *pCreateInfo,
+	const struct radv_graphics_pipeline_create_info *extra,
+	const VkAllocationCallbacks *pAllocator,
+	VkPipeline *pPipeline)
+{
+	return radv_graphics_pipeline_create_internal(_device, _cache,
+						      pCreateInfo, extra,
+						      pAllocator, true,
+						      pPipeline);
+}
+
+static VkResult radv_compute_pipeline_create(
 	VkDevice                                    _device,
-	VkPipelineCache                             pipelineCache,
-	uint32_t                                    count,
-	const VkGraphicsPipelineCreateInfo*         pCreateInfos,
+	VkPipelineCache                             _cache,
+	const VkComputePipelineCreateInfo*          pCreateInfo,
 	const VkAllocationCallbacks*                pAllocator,
-	VkPipeline*                                 pPipelines)
+	VkPipeline*                                 pPipeline);
+
+static void
+radv_pipeline_async_compile(void *data, int thread_index)
+{
+	struct radv_pipeline *pipeline = data;
+
+	/* Waiting for the stage jobs from a job of the same queue could
+	 * deadlock, so compile all stages here.
+	 */
+	pipeline->async.result = radv_pipeline_init(pipeline, pipeline->device,
+						    pipeline->async.cache,
+						    pipeline->async.create_info,
+						    NULL, false);
+}
+
+/* Return a graphics pipeline right away, and compile it on the shader
+ * compiler queue. radv_pipeline_wait_ready() has to be called before the
+ * pipeline is used.
+ */
+static VkResult
+radv_graphics_pipeline_create_async(
+	VkDevice _device,
+	VkPipelineCache _cache,
+	const VkGraphicsPipelineCreateInfo *pCreateInfo,
+	const VkAllocationCallbacks *pAllocator,
+	VkPipeline *pPipeline)
+{
+	RADV_FROM_HANDLE(radv_device, device, _device);
+	RADV_FROM_HANDLE(radv_pipeline_cache, cache, _cache);
+	struct radv_pipeline *pipeline;
+
+	pipeline = vk_zalloc2(&device->alloc, pAllocator, sizeof(*pipeline), 8,
+			      VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+	if (pipeline == NULL)
+		return vk_error(device->instance, VK_ERROR_OUT_OF_HOST_MEMORY);
+
+	pipeline->device = device;
+	pipeline->async.enabled = true;
+	pipeline->async.cache = cache;
+	pipeline->async.create_info = pCreateInfo;
+	util_queue_fence_init(&pipeline->async.fence);
+	util_queue_add_job(&device->shader_compiler_queue, pipeline,
+			   &pipeline->async.fence, radv_pipeline_async_compile,
+			   NULL);
+
+	*pPipeline = radv_pipeline_to_handle(pipeline);
+
+	return VK_SUCCESS;
+}
+
+struct radv_pipeline_create_job {
+	struct util_queue_fence fence;
+	VkDevice device;
+	VkPipelineCache cache;
+	const VkGraphicsPipelineCreateInfo *graphics_info;
+	const VkComputePipelineCreateInfo *compute_info;
+	const VkAllocationCallbacks *alloc;
+	bool async_stages;
+	VkPipeline *pipeline;
+	VkResult result;
+};
+
+static void
+radv_pipeline_create_job_execute(void *data, int thread_index)
+{
+	struct radv_pipeline_create_job *job = data;
+
+	if (job->graphics_info) {
+		job->result = radv_graphics_pipeline_create_internal(job->device,
+								     job->cache,
+								     job->graphics_info,
+								     NULL, job->alloc,
+								     job->async_stages,
+								     job->pipeline);
+	} else {
+		job->result = radv_compute_pipeline_create(job->device,
+							   job->cache,
+							   job->compute_info,
+							   job->alloc,
+							   job->pipeline);
+	}
+
+	if (job->result != VK_SUCCESS)
+		*job->pipeline = VK_NULL_HANDLE;
+}
+
+/* Create the pipelines of a vkCreate*Pipelines call in parallel. The jobs
+ * compile their stages themselves, because waiting for other jobs of the
+ * queue from a job could deadlock.
+ */
+static VkResult
+radv_create_pipelines(VkDevice _device,
+		      VkPipelineCache pipelineCache,
+		      uint32_t count,
+		      const VkGraphicsPipelineCreateInfo *pGraphicsCreateInfos,
+		      const VkComputePipelineCreateInfo *pComputeCreateInfos,
+		      const VkAllocationCallbacks *pAllocator,
+		      VkPipeline *pPipelines)
 {
+	RADV_FROM_HANDLE(radv_device, device, _device);
+	struct radv_pipeline_create_job serial_job;
+	struct radv_pipeline_create_job *jobs = NULL;
 	VkResult result = VK_SUCCESS;
-	unsigned i = 0;
-
-	for (; i < count; i++) {
-		VkResult r;
-		r = radv_graphics_pipeline_create(_device,
-						  pipelineCache,
-						  &pCreateInfos[i],
-						  NULL, pAllocator, &pPipelines[i]);
-		if (r != VK_SUCCESS) {
-			result = r;
-			pPipelines[i] = VK_NULL_HANDLE;
+
+	if (pGraphicsCreateInfos &&
+	    (device->instance->perftest_flags & RADV_PERFTEST_ASYNC_PIPELINES) &&
+	    util_queue_is_initialized(&device->shader_compiler_queue)) {
+		for (unsigned i = 0; i < count; i++) {
+			VkResult r = radv_graphics_pipeline_create_async(_device, pipelineCache,
+									 &pGraphicsCreateInfos[i],
+									 pAllocator, &pPipelines[i]);
+			if (r != VK_SUCCESS) {
+				result = r;
+				pPipelines[i] = VK_NULL_HANDLE;
+			}
+		}
+		return result;
+	}
+
+	if (count > 1 &&
+	    util_queue_is_initialized(&device->shader_compiler_queue))
+		jobs = calloc(count, sizeof(*jobs));
+
+	for (unsigned i = 0; i < count; i++) {
+		struct radv_pipeline_create_job *job = jobs ? &jobs[i] : &serial_job;
+
+		job->device = _device;
+		job->cache = pipelineCache;
+		job->graphics_info = pGraphicsCreateInfos ? &pGraphicsCreateInfos[i] : NULL;
+		job->compute_info = pComputeCreateInfos ? &pComputeCreateInfos[i] : NULL;
+		job->alloc = pAllocator;
+		job->async_stages = !jobs;
+		job->pipeline = &pPipelines[i];
+
+		if (jobs) {
+			util_queue_fence_init(&job->fence);
+			util_queue_add_job(&device->shader_compiler_queue,
+					   job, &job->fence,
+					   radv_pipeline_create_job_execute, NULL);
+		} else {
+			radv_pipeline_create_job_execute(job, 0);
+			if (job->result != VK_SUCCESS)
+				result = job->result;
+		}
+	}
+
+	if (jobs) {
+		for (unsigned i = 0; i < count; i++) {
+			util_queue_fence_wait(&jobs[i].fence);
+			util_queue_fence_destroy(&jobs[i].fence);
+			if (jobs[i].result != VK_SUCCESS)
+				result = jobs[i].result;
 		}
+		free(jobs);
 	}
 
 	return result;
 }
 
+VkResult radv_CreateGraphicsPipelines(
+	VkDevice                                    _device,
+	VkPipelineCache                             pipelineCache,
+	uint32_t                                    count,
+	const VkGraphicsPipelineCreateInfo*         pCreateInfos,
+	const VkAllocationCallbacks*                pAllocator,
+	VkPipeline*                                 pPipelines)
+{
+	return radv_create_pipelines(_device, pipelineCache, count,
+				     pCreateInfos, NULL, pAllocator,
+				     pPipelines);
+}
+
 
 static void
 radv_compute_generate_pm4(struct radv_pipeline *pipeline)
@@ -4892,7 +5117,7 @@ static VkResult radv_compute_pipeline_create(
 		stage_feedbacks[MESA_SHADER_COMPUTE] = &creation_feedback->pPipelineStageCreationFeedbacks[0];
 
 	pStages[MESA_SHADER_COMPUTE] = &pCreateInfo->stage;
-	radv_create_shaders(pipeline, device, cache, &(struct radv_pipeline_key) {0}, pStages, pCreateInfo->flags, NULL, pipeline_feedback, stage_feedbacks);
+	radv_create_shaders(pipeline, device, cache, &(struct radv_pipeline_key) {0}, pStages, pCreateInfo->flags, NULL, pipeline_feedback, stage_feedbacks, false);
 
 	pipeline->user_data_0[MESA_SHADER_COMPUTE] = radv_pipeline_stage_to_user_data_0(pipeline, MESA_SHADER_COMPUTE, device->physical_device->rad_info.chip_class);
 	pipeline->need_indirect_descriptor_sets |= pipeline->shaders[MESA_SHADER_COMPUTE]->info.need_indirect_descriptor_sets;
@@ -4917,21 +5142,9 @@ VkResult radv_CreateComputePipelines(
 	const VkAllocationCallbacks*                pAllocator,
 	VkPipeline*                                 pPipelines)
 {
-	VkResult result = VK_SUCCESS;
-
-	unsigned i = 0;
-	for (; i < count; i++) {
-		VkResult r;
-		r = radv_compute_pipeline_create(_device, pipelineCache,
-						 &pCreateInfos[i],
-						 pAllocator, &pPipelines[i]);
-		if (r != VK_SUCCESS) {
-			result = r;
-			pPipelines[i] = VK_NULL_HANDLE;
-		}
-	}
-
-	return result;
+	return radv_create_pipelines(_device, pipelineCache, count,
+				     NULL, pCreateInfos, pAllocator,
+				     pPipelines);
 }
 
 
@@ -4988,6 +5201,10 @@ VkResult radv_GetPipelineExecutablePropertiesKHR(
     VkPipelineExecutablePropertiesKHR*          pProperties)
 {
 	RADV_FROM_HANDLE(radv_pipeline, pipeline, pPipelineInfo->pipeline);
+	VkResult result = radv_pipeline_wait_ready(pipeline);
+	if (result != VK_SUCCESS)
+		return result;
+
 	const uint32_t total_count = radv_get_executable_count(pipeline);
 
 	if (!pProperties) {
@@ -5067,7 +5284,7 @@ VkResult radv_GetPipelineExecutablePropertiesKHR(
 	for (unsigned i = 0; i < count; ++i)
 		pProperties[i].subgroupSize = 64;
 
-	VkResult result = *pExecutableCount < total_count ? VK_INCOMPLETE : VK_SUCCESS;
+	result = *pExecutableCount < total_count ? VK_INCOMPLETE : VK_SUCCESS;
 	*pExecutableCount = count;
 	return result;
 }
@@ -5080,6 +5297,10 @@ VkResult radv_GetPipelineExecutableStatisticsKHR(
 {
 	RADV_FROM_HANDLE(radv_device, device, _device);
 	RADV_FROM_HANDLE(radv_pipeline, pipeline, pExecutableInfo->pipeline);
+	VkResult result = radv_pipeline_wait_ready(pipeline);
+	if (result != VK_SUCCESS)
+		return result;
+
 	gl_shader_stage stage;
 	struct radv_shader_variant *shader = radv_get_shader_from_executable_index(pipeline, pExecutableInfo->executableIndex, &stage);
 
@@ -5089,7 +5310,6 @@ VkResult radv_GetPipelineExecutableStatisticsKHR(
 
 	VkPipelineExecutableStatisticKHR *s = pStatistics;
 	VkPipelineExecutableStatisticKHR *end = s + (pStatistics ? *pStatisticCount : 0);
-	VkResult result = VK_SUCCESS;
 
 	if (s < end) {
 		desc_copy(s->name, "SGPRs");
@@ -5199,12 +5419,15 @@ VkResult radv_GetPipelineExecutableInternalRepresentationsKHR(
     VkPipelineExecutableInternalRepresentationKHR* pInternalRepresentations)
 {
 	RADV_FROM_HANDLE(radv_pipeline, pipeline, pExecutableInfo->pipeline);
+	VkResult result = radv_pipeline_wait_ready(pipeline);
+	if (result != VK_SUCCESS)
+		return result;
+
 	gl_shader_stage stage;
 	struct radv_shader_variant *shader = radv_get_shader_from_executable_index(pipeline, pExecutableInfo->executableIndex, &stage);
 
 	VkPipelineExecutableInternalRepresentationKHR *p = pInternalRepresentations;
 	VkPipelineExecutableInternalRepresentationKHR *end = p + (pInternalRepresentations ? *pInternalRepresentationCount : 0);
-	VkResult result = VK_SUCCESS;
 	/* optimized NIR */
 	if (p < end) {
 		p->isText = true;
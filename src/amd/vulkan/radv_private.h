@@ -48,6 +48,8 @@
 #include "compiler/shader_enums.h"
 #include "util/macros.h"
 #include "util/list.h"
+#include "util/u_dynarray.h"
+#include "util/u_queue.h"
 #include "util/xmlconfig.h"
 #include "main/macros.h"
 #include "vk_alloc.h"
@@ -336,16 +338,30 @@ bool radv_physical_device_extension_supported(struct radv_physical_device *dev,
 
 struct cache_entry;
 
-struct radv_pipeline_cache {
-	struct radv_device *                          device;
+#define RADV_PIPELINE_CACHE_NUM_SHARDS 16
+
+struct radv_pipeline_cache_shard {
 	pthread_mutex_t                              mutex;
 
 	uint32_t                                     total_size;
 	uint32_t                                     table_size;
 	uint32_t                                     kernel_count;
 	struct cache_entry **                        hash_table;
+};
+
+struct radv_pipeline_cache {
+	struct radv_device *                          device;
+
+	/* Entries are spread over shards with their own lock, so that
+	 * threads creating different pipelines rarely wait for each other.
+	 */
+	struct radv_pipeline_cache_shard             shards[RADV_PIPELINE_CACHE_NUM_SHARDS];
 	bool                                         modified;
 
+	/* Only counted with RADV_DEBUG=cachestats. */
+	uint32_t                                     num_lock_waits;
+	uint64_t                                     lock_wait_time; /* ns */
+
 	VkAllocationCallbacks                        alloc;
 };
 
@@ -625,6 +641,7 @@ struct radv_meta_state {
 		VkPipeline occlusion_query_pipeline;
 		VkPipeline pipeline_statistics_query_pipeline;
 		VkPipeline tfb_query_pipeline;
+		VkPipeline timestamp_query_pipeline;
 	} query;
 
 	struct {
@@ -731,6 +748,20 @@ struct radv_device {
 	struct list_head shader_slabs;
 	mtx_t shader_slab_mutex;
 
+	/* Shader arena usage, printed with RADV_DEBUG=shaderarenastats. */
+	struct {
+		uint64_t used_size;
+		uint64_t peak_used_size;
+		uint64_t slab_size;
+		uint64_t peak_slab_size;
+		unsigned num_slabs_freed;
+	} shader_arena_stats;
+
+	/* Compiles pipelines and shader stages in parallel. Not initialized
+	 * if compilation has to be serialized.
+	 */
+	struct util_queue shader_compiler_queue;
+
 	/* For detecting VM faults reported by dmesg. */
 	uint64_t dmesg_timestamp;
 
@@ -774,6 +805,12 @@ struct radv_descriptor_set {
 	uint32_t *mapped_ptr;
 	struct radv_descriptor_range *dynamic_descriptors;
 
+	/* For pools with FREE_DESCRIPTOR_SET_BIT: the index of the set in
+	 * pool->entries and log2 of the size of its host allocation.
+	 */
+	uint32_t pool_entry;
+	uint32_t host_size_class;
+
 	struct radeon_winsys_bo *descriptors[0];
 };
 
@@ -784,11 +821,18 @@ struct radv_push_descriptor_set
 };
 
 struct radv_descriptor_pool_entry {
+	struct radv_descriptor_set *set;
+};
+
+/* A freed range of the descriptor pool BO. */
+struct radv_descriptor_pool_free_block {
 	uint32_t offset;
 	uint32_t size;
-	struct radv_descriptor_set *set;
+	uint32_t next;
 };
 
+#define RADV_DESCRIPTOR_POOL_SIZE_CLASSES 32
+
 struct radv_descriptor_pool {
 	struct radeon_winsys_bo *bo;
 	uint8_t *mapped_ptr;
@@ -799,6 +843,15 @@ struct radv_descriptor_pool {
 	uint8_t *host_memory_ptr;
 	uint8_t *host_memory_end;
 
+	/* With FREE_DESCRIPTOR_SET_BIT, freed BO ranges and set objects are
+	 * kept in lists by log2 of their size, so that allocations don't
+	 * have to search the whole pool or call the host allocator.
+	 */
+	struct util_dynarray free_blocks; /* radv_descriptor_pool_free_block */
+	uint32_t unused_free_blocks;
+	uint32_t free_block_lists[RADV_DESCRIPTOR_POOL_SIZE_CLASSES];
+	void *free_sets[RADV_DESCRIPTOR_POOL_SIZE_CLASSES];
+
 	uint32_t entry_count;
 	uint32_t max_entry_count;
 	struct radv_descriptor_pool_entry entries[0];
@@ -1526,8 +1579,36 @@ struct radv_pipeline {
 
 	/* Not NULL if graphics pipeline uses streamout. */
 	struct radv_shader_variant *streamout_shader;
+
+	/* Graphics pipelines created with RADV_PERFTEST=asyncpipelines are
+	 * compiled in the background. The create info and the objects it
+	 * references have to stay valid until the pipeline is ready.
+	 */
+	struct {
+		bool enabled;
+		struct util_queue_fence fence;
+		struct radv_pipeline_cache *cache;
+		const VkGraphicsPipelineCreateInfo *create_info;
+		VkResult result;
+	} async;
 };
 
+/* Whether the pipeline can be used without waiting for its compilation. */
+static inline bool radv_pipeline_is_ready(struct radv_pipeline *pipeline)
+{
+	return !pipeline->async.enabled ||
+	       util_queue_fence_is_signalled(&pipeline->async.fence);
+}
+
+static inline VkResult radv_pipeline_wait_ready(struct radv_pipeline *pipeline)
+{
+	if (!pipeline->async.enabled)
+		return VK_SUCCESS;
+
+	util_queue_fence_wait(&pipeline->async.fence);
+	return pipeline->async.result;
+}
+
 static inline bool radv_pipeline_has_gs(const struct radv_pipeline *pipeline)
 {
 	return pipeline->shaders[MESA_SHADER_GEOMETRY] ? true : false;
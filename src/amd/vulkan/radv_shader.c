@@ -545,61 +545,166 @@ radv_lower_fs_io(nir_shader *nir)
 }
 
 
-void *
-radv_alloc_shader_memory(struct radv_device *device,
-			 struct radv_shader_variant *shader)
-{
-	mtx_lock(&device->shader_slab_mutex);
-	list_for_each_entry(struct radv_shader_slab, slab, &device->shader_slabs, slabs) {
-		uint64_t offset = 0;
-		list_for_each_entry(struct radv_shader_variant, s, &slab->shaders, slab_list) {
-			if (s->bo_offset - offset >= shader->code_size) {
-				shader->bo = slab->bo;
-				shader->bo_offset = offset;
-				list_addtail(&shader->slab_list, &s->slab_list);
-				mtx_unlock(&device->shader_slab_mutex);
-				return slab->ptr + offset;
-			}
-			offset = align_u64(s->bo_offset + s->code_size, 256);
-		}
-		if (slab->size - offset >= shader->code_size) {
-			shader->bo = slab->bo;
-			shader->bo_offset = offset;
-			list_addtail(&shader->slab_list, &slab->shaders);
-			mtx_unlock(&device->shader_slab_mutex);
-			return slab->ptr + offset;
-		}
-	}
+/* Shader code is sub-allocated from slabs of at least this size. */
+#define RADV_SHADER_SLAB_SIZE (256 * 1024)
 
-	mtx_unlock(&device->shader_slab_mutex);
+/* util_vma_heap uses 0 for failed allocations, so the heap of a slab
+ * starts at this address instead of at its offset 0.
+ */
+#define RADV_SHADER_SLAB_HEAP_BASE 256
+
+static struct radv_shader_slab *
+radv_create_shader_slab(struct radv_device *device, uint64_t min_size)
+{
 	struct radv_shader_slab *slab = calloc(1, sizeof(struct radv_shader_slab));
+	if (!slab)
+		return NULL;
 
-	slab->size = 256 * 1024;
+	slab->size = align_u64(MAX2(min_size, RADV_SHADER_SLAB_SIZE),
+			       RADV_SHADER_SLAB_SIZE);
 	slab->bo = device->ws->buffer_create(device->ws, slab->size, 256,
 	                                     RADEON_DOMAIN_VRAM,
 					     RADEON_FLAG_NO_INTERPROCESS_SHARING |
 					     (device->physical_device->rad_info.cpdma_prefetch_writes_memory ?
 					             0 : RADEON_FLAG_READ_ONLY),
 					     RADV_BO_PRIORITY_SHADER);
+	if (!slab->bo) {
+		free(slab);
+		return NULL;
+	}
+
 	slab->ptr = (char*)device->ws->buffer_map(slab->bo);
-	list_inithead(&slab->shaders);
+	if (!slab->ptr) {
+		device->ws->buffer_destroy(slab->bo);
+		free(slab);
+		return NULL;
+	}
+
+	util_vma_heap_init(&slab->heap, RADV_SHADER_SLAB_HEAP_BASE, slab->size);
+	return slab;
+}
+
+static void
+radv_destroy_shader_slab(struct radv_device *device,
+			 struct radv_shader_slab *slab)
+{
+	util_vma_heap_finish(&slab->heap);
+	device->ws->buffer_destroy(slab->bo);
+	free(slab);
+}
+
+/* Must be called with the shader slab mutex held. */
+static void *
+radv_shader_slab_alloc(struct radv_device *device,
+		       struct radv_shader_slab *slab,
+		       struct radv_shader_variant *shader)
+{
+	uint64_t size = align_u64(shader->code_size, 256);
+	uint64_t addr;
+
+	if (slab->size - slab->used_size < size)
+		return NULL;
+
+	addr = util_vma_heap_alloc(&slab->heap, size, 256);
+	if (!addr)
+		return NULL;
+
+	shader->slab = slab;
+	shader->bo = slab->bo;
+	shader->bo_offset = addr - RADV_SHADER_SLAB_HEAP_BASE;
+	slab->used_size += size;
+
+	device->shader_arena_stats.used_size += size;
+	device->shader_arena_stats.peak_used_size =
+		MAX2(device->shader_arena_stats.peak_used_size,
+		     device->shader_arena_stats.used_size);
+	return slab->ptr + shader->bo_offset;
+}
+
+void *
+radv_alloc_shader_memory(struct radv_device *device,
+			 struct radv_shader_variant *shader)
+{
+	struct radv_shader_slab *slab;
+	void *ptr;
+
+	mtx_lock(&device->shader_slab_mutex);
+	list_for_each_entry(struct radv_shader_slab, s, &device->shader_slabs, slabs) {
+		ptr = radv_shader_slab_alloc(device, s, shader);
+		if (ptr) {
+			mtx_unlock(&device->shader_slab_mutex);
+			return ptr;
+		}
+	}
+	mtx_unlock(&device->shader_slab_mutex);
+
+	slab = radv_create_shader_slab(device, align_u64(shader->code_size, 256));
+	if (!slab)
+		return NULL;
 
 	mtx_lock(&device->shader_slab_mutex);
 	list_add(&slab->slabs, &device->shader_slabs);
 
-	shader->bo = slab->bo;
-	shader->bo_offset = 0;
-	list_add(&shader->slab_list, &slab->shaders);
+	device->shader_arena_stats.slab_size += slab->size;
+	device->shader_arena_stats.peak_slab_size =
+		MAX2(device->shader_arena_stats.peak_slab_size,
+		     device->shader_arena_stats.slab_size);
+
+	ptr = radv_shader_slab_alloc(device, slab, shader);
+	mtx_unlock(&device->shader_slab_mutex);
+	return ptr;
+}
+
+static void
+radv_free_shader_memory(struct radv_device *device,
+			struct radv_shader_variant *shader)
+{
+	struct radv_shader_slab *slab = shader->slab;
+	uint64_t size = align_u64(shader->code_size, 256);
+
+	if (!slab)
+		return;
+
+	mtx_lock(&device->shader_slab_mutex);
+	util_vma_heap_free(&slab->heap,
+			   shader->bo_offset + RADV_SHADER_SLAB_HEAP_BASE, size);
+	slab->used_size -= size;
+	device->shader_arena_stats.used_size -= size;
+
+	/* Keep a single idle slab around, so that pipelines that are
+	 * created and destroyed repeatedly don't create new BOs each time,
+	 * and release the others.
+	 */
+	if (!slab->used_size) {
+		list_for_each_entry(struct radv_shader_slab, s, &device->shader_slabs, slabs) {
+			if (s != slab && !s->used_size) {
+				list_del(&slab->slabs);
+				device->shader_arena_stats.slab_size -= slab->size;
+				device->shader_arena_stats.num_slabs_freed++;
+				radv_destroy_shader_slab(device, slab);
+				break;
+			}
+		}
+	}
 	mtx_unlock(&device->shader_slab_mutex);
-	return slab->ptr;
 }
 
 void
 radv_destroy_shader_slabs(struct radv_device *device)
 {
+	if (device->instance->debug_flags & RADV_DEBUG_SHADER_ARENA_STATS) {
+		fprintf(stderr, "radv: shader arena: %"PRIu64" bytes used in "
+			"%"PRIu64" bytes of slabs (peak %"PRIu64" bytes used, "
+			"%"PRIu64" bytes of slabs), %u slabs freed\n",
+			device->shader_arena_stats.used_size,
+			device->shader_arena_stats.slab_size,
+			device->shader_arena_stats.peak_used_size,
+			device->shader_arena_stats.peak_slab_size,
+			device->shader_arena_stats.num_slabs_freed);
+	}
+
 	list_for_each_entry_safe(struct radv_shader_slab, slab, &device->shader_slabs, slabs) {
-		device->ws->buffer_destroy(slab->bo);
-		free(slab);
+		radv_destroy_shader_slab(device, slab);
 	}
 	mtx_destroy(&device->shader_slab_mutex);
 }
@@ -952,6 +1057,12 @@ radv_shader_variant_create(struct radv_device *device,
 				binary->stage, &variant->config);
 	
 	void *dest_ptr = radv_alloc_shader_memory(device, variant);
+	if (!dest_ptr) {
+		if (binary->type == RADV_BINARY_TYPE_RTLD)
+			ac_rtld_close(&rtld_binary);
+		free(variant);
+		return NULL;
+	}
 
 	if (binary->type == RADV_BINARY_TYPE_RTLD) {
 		struct radv_shader_binary_rtld* bin = (struct radv_shader_binary_rtld *)binary;
@@ -1164,9 +1275,7 @@ radv_shader_variant_destroy(struct radv_device *device,
 	if (!p_atomic_dec_zero(&variant->ref_count))
 		return;
 
-	mtx_lock(&device->shader_slab_mutex);
-	list_del(&variant->slab_list);
-	mtx_unlock(&device->shader_slab_mutex);
+	radv_free_shader_memory(device, variant);
 
 	free(variant->nir_string);
 	free(variant->disasm_string);
@@ -1334,10 +1443,22 @@ radv_GetShaderInfoAMD(VkDevice _device,
 	RADV_FROM_HANDLE(radv_device, device, _device);
 	RADV_FROM_HANDLE(radv_pipeline, pipeline, _pipeline);
 	gl_shader_stage stage = vk_to_mesa_shader_stage(shaderStage);
-	struct radv_shader_variant *variant = pipeline->shaders[stage];
+	struct radv_shader_variant *variant;
 	struct _mesa_string_buffer *buf;
 	VkResult result = VK_SUCCESS;
 
+	/* Pipelines that are still compiled in the background report
+	 * VK_NOT_READY, which is how the application can poll them.
+	 */
+	if (!radv_pipeline_is_ready(pipeline))
+		return VK_NOT_READY;
+
+	result = radv_pipeline_wait_ready(pipeline);
+	if (result != VK_SUCCESS)
+		return result;
+
+	variant = pipeline->shaders[stage];
+
 	/* Spec doesn't indicate what to do if the stage is invalid, so just
 	 * return no info for this. */
 	if (!variant)
@@ -33,6 +33,7 @@
 #include "radv_constants.h"
 
 #include "nir/nir.h"
+#include "util/vma.h"
 #include "vulkan/vulkan.h"
 
 struct radv_device;
@@ -363,14 +364,15 @@ struct radv_shader_variant {
 	char *disasm_string;
 	char *llvm_ir_string;
 
-	struct list_head slab_list;
+	struct radv_shader_slab *slab;
 };
 
 struct radv_shader_slab {
 	struct list_head slabs;
-	struct list_head shaders;
+	struct util_vma_heap heap;
 	struct radeon_winsys_bo *bo;
 	uint64_t size;
+	uint64_t used_size;
 	char *ptr;
 };
 
@@ -34,9 +34,11 @@
 #include "radv_amdgpu_cs.h"
 #include "radv_amdgpu_bo.h"
 #include "sid.h"
+#include "util/u_math.h"
 
 
 enum {
+	BUFFER_HASH_TABLE_INITIAL_SIZE = 1024,
 	VIRTUAL_BUFFER_HASH_TABLE_SIZE = 1024
 };
 
@@ -59,7 +61,11 @@ struct radv_amdgpu_cs {
 	bool                        failed;
 	bool                        is_chained;
 
-	int                         buffer_hash_table[1024];
+	/* Open-addressed table of indices into handles, -1 is empty. It is
+	 * kept at most half full.
+	 */
+	int                         *buffer_hash_table;
+	unsigned                    buffer_hash_table_size;
 	unsigned                    hw_ip;
 
 	unsigned                    num_virtual_buffers;
@@ -70,6 +76,13 @@ struct radv_amdgpu_cs {
 	/* For chips that don't support chaining. */
 	struct radeon_cmdbuf     *old_cs_buffers;
 	unsigned                    num_old_cs_buffers;
+
+	/* Executed secondary command streams, whose buffers are only added
+	 * to the BO list when submitting.
+	 */
+	struct radv_amdgpu_cs       **child_cs;
+	unsigned                    num_child_cs;
+	unsigned                    max_num_child_cs;
 };
 
 static inline struct radv_amdgpu_cs *
@@ -290,19 +303,26 @@ static void radv_amdgpu_cs_destroy(struct radeon_cmdbuf *rcs)
 
 	free(cs->old_cs_buffers);
 	free(cs->old_ib_buffers);
+	free(cs->child_cs);
 	free(cs->virtual_buffers);
 	free(cs->virtual_buffer_hash_table);
+	free(cs->buffer_hash_table);
 	free(cs->handles);
 	free(cs);
 }
 
-static void radv_amdgpu_init_cs(struct radv_amdgpu_cs *cs,
+static bool radv_amdgpu_init_cs(struct radv_amdgpu_cs *cs,
 				enum ring_type ring_type)
 {
-	for (int i = 0; i < ARRAY_SIZE(cs->buffer_hash_table); ++i)
-		cs->buffer_hash_table[i] = -1;
+	cs->buffer_hash_table_size = BUFFER_HASH_TABLE_INITIAL_SIZE;
+	cs->buffer_hash_table = malloc(cs->buffer_hash_table_size * sizeof(int));
+	if (!cs->buffer_hash_table)
+		return false;
+
+	memset(cs->buffer_hash_table, -1, cs->buffer_hash_table_size * sizeof(int));
 
 	cs->hw_ip = ring_to_hw_ip(ring_type);
+	return true;
 }
 
 static struct radeon_cmdbuf *
@@ -316,7 +336,10 @@ radv_amdgpu_cs_create(struct radeon_winsys *ws,
 		return NULL;
 
 	cs->ws = radv_amdgpu_winsys(ws);
-	radv_amdgpu_init_cs(cs, ring_type);
+	if (!radv_amdgpu_init_cs(cs, ring_type)) {
+		free(cs);
+		return NULL;
+	}
 
 	if (cs->ws->use_ib_bos) {
 		cs->ib_buffer = ws->buffer_create(ws, ib_size, 0,
@@ -326,6 +349,7 @@ radv_amdgpu_cs_create(struct radeon_winsys *ws,
 						  RADEON_FLAG_READ_ONLY,
 						  RADV_BO_PRIORITY_CS);
 		if (!cs->ib_buffer) {
+			free(cs->buffer_hash_table);
 			free(cs);
 			return NULL;
 		}
@@ -333,6 +357,7 @@ radv_amdgpu_cs_create(struct radeon_winsys *ws,
 		cs->ib_mapped = ws->buffer_map(cs->ib_buffer);
 		if (!cs->ib_mapped) {
 			ws->buffer_destroy(cs->ib_buffer);
+			free(cs->buffer_hash_table);
 			free(cs);
 			return NULL;
 		}
@@ -348,6 +373,7 @@ radv_amdgpu_cs_create(struct radeon_winsys *ws,
 		cs->base.buf = malloc(16384);
 		cs->base.max_dw = 4096;
 		if (!cs->base.buf) {
+			free(cs->buffer_hash_table);
 			free(cs);
 			return NULL;
 		}
@@ -493,9 +519,15 @@ static void radv_amdgpu_cs_reset(struct radeon_cmdbuf *_cs)
 	cs->base.cdw = 0;
 	cs->failed = false;
 
+	/* Every entry is removed, so the probing doesn't have to stop at
+	 * the slots that were already cleared.
+	 */
 	for (unsigned i = 0; i < cs->num_buffers; ++i) {
-		unsigned hash = cs->handles[i].bo_handle &
-		                (ARRAY_SIZE(cs->buffer_hash_table) - 1);
+		unsigned mask = cs->buffer_hash_table_size - 1;
+		unsigned hash = cs->handles[i].bo_handle & mask;
+
+		while (cs->buffer_hash_table[hash] != (int)i)
+			hash = (hash + 1) & mask;
 		cs->buffer_hash_table[hash] = -1;
 	}
 
@@ -506,6 +538,7 @@ static void radv_amdgpu_cs_reset(struct radeon_cmdbuf *_cs)
 
 	cs->num_buffers = 0;
 	cs->num_virtual_buffers = 0;
+	cs->num_child_cs = 0;
 
 	if (cs->ws->use_ib_bos) {
 		cs->ws->base.cs_add_buffer(&cs->base, cs->ib_buffer);
@@ -529,37 +562,60 @@ static void radv_amdgpu_cs_reset(struct radeon_cmdbuf *_cs)
 	}
 }
 
-static int radv_amdgpu_cs_find_buffer(struct radv_amdgpu_cs *cs,
-				      uint32_t bo)
+/* Return the slot of bo in the buffer hash table, or the empty slot where
+ * it has to be inserted. GEM handles are small and allocated sequentially,
+ * so they are used as hash directly.
+ */
+static unsigned radv_amdgpu_cs_find_buffer(const struct radv_amdgpu_cs *cs,
+					   uint32_t bo)
 {
-	unsigned hash = bo & (ARRAY_SIZE(cs->buffer_hash_table) - 1);
-	int index = cs->buffer_hash_table[hash];
+	unsigned mask = cs->buffer_hash_table_size - 1;
+	unsigned hash = bo & mask;
 
-	if (index == -1)
-		return -1;
+	for (;;) {
+		int index = cs->buffer_hash_table[hash];
 
-	if (cs->handles[index].bo_handle == bo)
-		return index;
+		if (index == -1 || cs->handles[index].bo_handle == bo)
+			return hash;
 
-	for (unsigned i = 0; i < cs->num_buffers; ++i) {
-		if (cs->handles[i].bo_handle == bo) {
-			cs->buffer_hash_table[hash] = i;
-			return i;
-		}
+		hash = (hash + 1) & mask;
 	}
+}
+
+static bool radv_amdgpu_cs_grow_buffer_hash_table(struct radv_amdgpu_cs *cs)
+{
+	unsigned size = cs->buffer_hash_table_size * 2;
+	int *table = malloc(size * sizeof(int));
 
-	return -1;
+	if (!table)
+		return false;
+
+	memset(table, -1, size * sizeof(int));
+	free(cs->buffer_hash_table);
+	cs->buffer_hash_table = table;
+	cs->buffer_hash_table_size = size;
+
+	for (unsigned i = 0; i < cs->num_buffers; ++i)
+		table[radv_amdgpu_cs_find_buffer(cs, cs->handles[i].bo_handle)] = i;
+	return true;
 }
 
 static void radv_amdgpu_cs_add_buffer_internal(struct radv_amdgpu_cs *cs,
 					       uint32_t bo, uint8_t priority)
 {
-	unsigned hash;
-	int index = radv_amdgpu_cs_find_buffer(cs, bo);
+	unsigned slot = radv_amdgpu_cs_find_buffer(cs, bo);
 
-	if (index != -1)
+	if (cs->buffer_hash_table[slot] != -1)
 		return;
 
+	if ((cs->num_buffers + 1) * 2 > cs->buffer_hash_table_size) {
+		if (!radv_amdgpu_cs_grow_buffer_hash_table(cs)) {
+			cs->failed = true;
+			return;
+		}
+		slot = radv_amdgpu_cs_find_buffer(cs, bo);
+	}
+
 	if (cs->num_buffers == cs->max_num_buffers) {
 		unsigned new_count = MAX2(1, cs->max_num_buffers * 2);
 		cs->handles = realloc(cs->handles, new_count * sizeof(struct drm_amdgpu_bo_list_entry));
@@ -568,9 +624,7 @@ static void radv_amdgpu_cs_add_buffer_internal(struct radv_amdgpu_cs *cs,
 
 	cs->handles[cs->num_buffers].bo_handle = bo;
 	cs->handles[cs->num_buffers].bo_priority = priority;
-
-	hash = bo & (ARRAY_SIZE(cs->buffer_hash_table) - 1);
-	cs->buffer_hash_table[hash] = cs->num_buffers;
+	cs->buffer_hash_table[slot] = cs->num_buffers;
 
 	++cs->num_buffers;
 }
@@ -630,22 +684,55 @@ static void radv_amdgpu_cs_add_buffer(struct radeon_cmdbuf *_cs,
 	radv_amdgpu_cs_add_buffer_internal(cs, bo->bo_handle, bo->priority);
 }
 
+/* Reference a secondary command stream from the parent, so that its
+ * buffers are added to the BO list at submit time instead of being merged
+ * into the parent's list on every execution.
+ */
+static bool radv_amdgpu_cs_add_child(struct radv_amdgpu_cs *parent,
+				     struct radv_amdgpu_cs *child)
+{
+	for (unsigned i = 0; i < parent->num_child_cs; ++i) {
+		if (parent->child_cs[i] == child)
+			return true;
+	}
+
+	if (parent->num_child_cs == parent->max_num_child_cs) {
+		unsigned new_count = MAX2(4, parent->max_num_child_cs * 2);
+		struct radv_amdgpu_cs **child_cs =
+			realloc(parent->child_cs, new_count * sizeof(*child_cs));
+
+		if (!child_cs)
+			return false;
+
+		parent->child_cs = child_cs;
+		parent->max_num_child_cs = new_count;
+	}
+
+	parent->child_cs[parent->num_child_cs++] = child;
+	return true;
+}
+
 static void radv_amdgpu_cs_execute_secondary(struct radeon_cmdbuf *_parent,
 					     struct radeon_cmdbuf *_child)
 {
 	struct radv_amdgpu_cs *parent = radv_amdgpu_cs(_parent);
 	struct radv_amdgpu_cs *child = radv_amdgpu_cs(_child);
 
-	for (unsigned i = 0; i < child->num_buffers; ++i) {
-		radv_amdgpu_cs_add_buffer_internal(parent,
-		                                   child->handles[i].bo_handle,
-		                                   child->handles[i].bo_priority);
-	}
+	if (!radv_amdgpu_cs_add_child(parent, child)) {
+		for (unsigned i = 0; i < child->num_buffers; ++i) {
+			radv_amdgpu_cs_add_buffer_internal(parent,
+			                                   child->handles[i].bo_handle,
+			                                   child->handles[i].bo_priority);
+		}
 
-	for (unsigned i = 0; i < child->num_virtual_buffers; ++i) {
-		radv_amdgpu_cs_add_buffer(&parent->base, child->virtual_buffers[i]);
+		for (unsigned i = 0; i < child->num_virtual_buffers; ++i) {
+			radv_amdgpu_cs_add_buffer(&parent->base, child->virtual_buffers[i]);
+		}
 	}
 
+	/* Without IB BOs (GFX6 or RADV_DEBUG=noibs) the secondary can't be
+	 * executed as IB2 and has to be copied.
+	 */
 	if (parent->ws->use_ib_bos) {
 		if (parent->base.cdw + 4 > parent->base.max_dw)
 			radv_amdgpu_cs_grow(&parent->base, 4);
@@ -663,6 +750,66 @@ static void radv_amdgpu_cs_execute_secondary(struct radeon_cmdbuf *_parent,
 	}
 }
 
+static unsigned
+radv_amdgpu_cs_num_bo_entries(const struct radv_amdgpu_cs *cs)
+{
+	unsigned count = cs->num_buffers;
+
+	for (unsigned i = 0; i < cs->num_virtual_buffers; ++i)
+		count += radv_amdgpu_winsys_bo(cs->virtual_buffers[i])->bo_count;
+	return count;
+}
+
+/* Deduplicating builder for the BO list of a submission. */
+struct radv_amdgpu_bo_list_builder {
+	struct drm_amdgpu_bo_list_entry *handles;
+	unsigned count;
+	int *hash_table;
+	unsigned hash_mask;
+};
+
+static void
+radv_amdgpu_bo_list_add(struct radv_amdgpu_bo_list_builder *list,
+			uint32_t bo, uint8_t priority)
+{
+	unsigned hash = bo & list->hash_mask;
+
+	for (;;) {
+		int index = list->hash_table[hash];
+
+		if (index == -1)
+			break;
+		if (list->handles[index].bo_handle == bo)
+			return;
+		hash = (hash + 1) & list->hash_mask;
+	}
+
+	list->hash_table[hash] = list->count;
+	list->handles[list->count].bo_handle = bo;
+	list->handles[list->count].bo_priority = priority;
+	++list->count;
+}
+
+static void
+radv_amdgpu_add_cs_to_bo_list(struct radv_amdgpu_bo_list_builder *list,
+			      const struct radv_amdgpu_cs *cs)
+{
+	if (!cs->num_buffers)
+		return;
+
+	for (unsigned j = 0; j < cs->num_buffers; ++j) {
+		radv_amdgpu_bo_list_add(list, cs->handles[j].bo_handle,
+					cs->handles[j].bo_priority);
+	}
+	for (unsigned j = 0; j < cs->num_virtual_buffers; ++j) {
+		struct radv_amdgpu_winsys_bo *virtual_bo = radv_amdgpu_winsys_bo(cs->virtual_buffers[j]);
+		for(unsigned k = 0; k < virtual_bo->bo_count; ++k) {
+			struct radv_amdgpu_winsys_bo *bo = virtual_bo->bos[k];
+			radv_amdgpu_bo_list_add(list, bo->bo_handle, bo->priority);
+		}
+	}
+}
+
 static int radv_amdgpu_create_bo_list(struct radv_amdgpu_winsys *ws,
 				      struct radeon_cmdbuf **cs_array,
 				      unsigned count,
@@ -699,7 +846,8 @@ static int radv_amdgpu_create_bo_list(struct radv_amdgpu_winsys *ws,
 		free(handles);
 		pthread_mutex_unlock(&ws->global_bo_list_lock);
 	} else if (count == 1 && !num_extra_bo && !extra_cs && !radv_bo_list &&
-	           !radv_amdgpu_cs(cs_array[0])->num_virtual_buffers) {
+	           !radv_amdgpu_cs(cs_array[0])->num_virtual_buffers &&
+	           !radv_amdgpu_cs(cs_array[0])->num_child_cs) {
 		struct radv_amdgpu_cs *cs = (struct radv_amdgpu_cs*)cs_array[0];
 		if (cs->num_buffers == 0) {
 			*bo_list = 0;
@@ -708,17 +856,19 @@ static int radv_amdgpu_create_bo_list(struct radv_amdgpu_winsys *ws,
 		r = amdgpu_bo_list_create_raw(ws->dev, cs->num_buffers, cs->handles,
 					      bo_list);
 	} else {
+		struct radv_amdgpu_bo_list_builder list = {0};
 		unsigned total_buffer_count = num_extra_bo;
-		unsigned unique_bo_count = num_extra_bo;
+		unsigned hash_table_size;
+
 		for (unsigned i = 0; i < count; ++i) {
 			struct radv_amdgpu_cs *cs = (struct radv_amdgpu_cs*)cs_array[i];
-			total_buffer_count += cs->num_buffers;
-			for (unsigned j = 0; j < cs->num_virtual_buffers; ++j)
-				total_buffer_count += radv_amdgpu_winsys_bo(cs->virtual_buffers[j])->bo_count;
+			total_buffer_count += radv_amdgpu_cs_num_bo_entries(cs);
+			for (unsigned j = 0; j < cs->num_child_cs; ++j)
+				total_buffer_count += radv_amdgpu_cs_num_bo_entries(cs->child_cs[j]);
 		}
 
 		if (extra_cs) {
-			total_buffer_count += ((struct radv_amdgpu_cs*)extra_cs)->num_buffers;
+			total_buffer_count += radv_amdgpu_cs_num_bo_entries(radv_amdgpu_cs(extra_cs));
 		}
 
 		if (radv_bo_list) {
@@ -729,15 +879,22 @@ static int radv_amdgpu_create_bo_list(struct radv_amdgpu_winsys *ws,
 			*bo_list = 0;
 			return 0;
 		}
-		struct drm_amdgpu_bo_list_entry *handles = malloc(sizeof(struct drm_amdgpu_bo_list_entry) * total_buffer_count);
-		if (!handles) {
-			free(handles);
+
+		hash_table_size = util_next_power_of_two(total_buffer_count * 2);
+		list.handles = malloc(sizeof(struct drm_amdgpu_bo_list_entry) * total_buffer_count);
+		list.hash_table = malloc(sizeof(int) * hash_table_size);
+		list.hash_mask = hash_table_size - 1;
+		if (!list.handles || !list.hash_table) {
+			free(list.handles);
+			free(list.hash_table);
 			return -ENOMEM;
 		}
 
+		memset(list.hash_table, -1, sizeof(int) * hash_table_size);
+
 		for (unsigned i = 0; i < num_extra_bo; i++) {
-			handles[i].bo_handle = extra_bo_array[i]->bo_handle;
-			handles[i].bo_priority = extra_bo_array[i]->priority;
+			radv_amdgpu_bo_list_add(&list, extra_bo_array[i]->bo_handle,
+						extra_bo_array[i]->priority);
 		}
 
 		for (unsigned i = 0; i < count + !!extra_cs; ++i) {
@@ -748,75 +905,27 @@ static int radv_amdgpu_create_bo_list(struct radv_amdgpu_winsys *ws,
 			else
 				cs = (struct radv_amdgpu_cs*)cs_array[i];
 
-			if (!cs->num_buffers)
-				continue;
-
-			if (unique_bo_count == 0 && !cs->num_virtual_buffers) {
-				memcpy(handles, cs->handles, cs->num_buffers * sizeof(struct drm_amdgpu_bo_list_entry));
-				unique_bo_count = cs->num_buffers;
-				continue;
-			}
-			int unique_bo_so_far = unique_bo_count;
-			for (unsigned j = 0; j < cs->num_buffers; ++j) {
-				bool found = false;
-				for (unsigned k = 0; k < unique_bo_so_far; ++k) {
-					if (handles[k].bo_handle == cs->handles[j].bo_handle) {
-						found = true;
-						break;
-					}
-				}
-				if (!found) {
-					handles[unique_bo_count] = cs->handles[j];
-					++unique_bo_count;
-				}
-			}
-			for (unsigned j = 0; j < cs->num_virtual_buffers; ++j) {
-				struct radv_amdgpu_winsys_bo *virtual_bo = radv_amdgpu_winsys_bo(cs->virtual_buffers[j]);
-				for(unsigned k = 0; k < virtual_bo->bo_count; ++k) {
-					struct radv_amdgpu_winsys_bo *bo = virtual_bo->bos[k];
-					bool found = false;
-					for (unsigned m = 0; m < unique_bo_count; ++m) {
-						if (handles[m].bo_handle == bo->bo_handle) {
-							found = true;
-							break;
-						}
-					}
-					if (!found) {
-						handles[unique_bo_count].bo_handle = bo->bo_handle;
-						handles[unique_bo_count].bo_priority = bo->priority;
-						++unique_bo_count;
-					}
-				}
-			}
+			radv_amdgpu_add_cs_to_bo_list(&list, cs);
+			for (unsigned j = 0; j < cs->num_child_cs; ++j)
+				radv_amdgpu_add_cs_to_bo_list(&list, cs->child_cs[j]);
 		}
 
 		if (radv_bo_list) {
-			unsigned unique_bo_so_far = unique_bo_count;
 			for (unsigned i = 0; i < radv_bo_list->count; ++i) {
 				struct radv_amdgpu_winsys_bo *bo = radv_amdgpu_winsys_bo(radv_bo_list->bos[i]);
-				bool found = false;
-				for (unsigned j = 0; j < unique_bo_so_far; ++j) {
-					if (bo->bo_handle == handles[j].bo_handle) {
-						found = true;
-						break;
-					}
-				}
-				if (!found) {
-					handles[unique_bo_count].bo_handle = bo->bo_handle;
-					handles[unique_bo_count].bo_priority = bo->priority;
-					++unique_bo_count;
-				}
+				radv_amdgpu_bo_list_add(&list, bo->bo_handle, bo->priority);
 			}
 		}
 
-		if (unique_bo_count > 0) {
-			r = amdgpu_bo_list_create_raw(ws->dev, unique_bo_count, handles,
+		if (list.count > 0) {
+			r = amdgpu_bo_list_create_raw(ws->dev, list.count, list.handles,
 						      bo_list);
 		} else {
 			*bo_list = 0;
 		}
 
-		free(handles);
+		free(list.hash_table);
+		free(list.handles);
 	}
 
 	return r;
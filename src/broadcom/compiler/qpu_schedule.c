@@ -755,6 +755,120 @@ qpu_merge_inst(const struct v3d_device_info *devinfo,
         return ok;
 }
 
+/**
+ * Returns whether the DAG head n may be scheduled in the next instruction,
+ * merged into prev_inst if that's set.
+ */
+static bool
+can_schedule_node(const struct v3d_device_info *devinfo,
+                  struct choose_scoreboard *scoreboard,
+                  struct schedule_node *prev_inst,
+                  struct schedule_node *n)
+{
+        const struct v3d_qpu_instr *inst = &n->inst->qpu;
+
+        /* Don't choose the branch instruction until it's the last one
+         * left.  We'll move it up to fit its delay slots after we
+         * choose it.
+         */
+        if (inst->type == V3D_QPU_INSTR_TYPE_BRANCH &&
+            !list_is_singular(&scoreboard->dag->heads)) {
+                return false;
+        }
+
+        /* "An instruction must not read from a location in physical
+         *  regfile A or B that was written to by the previous
+         *  instruction."
+         */
+        if (reads_too_soon_after_write(scoreboard, n->inst))
+                return false;
+
+        if (writes_too_soon_after_write(devinfo, scoreboard, n->inst))
+                return false;
+
+        /* "A scoreboard wait must not occur in the first two
+         *  instructions of a fragment shader. This is either the
+         *  explicit Wait for Scoreboard signal or an implicit wait
+         *  with the first tile-buffer read or write instruction."
+         */
+        if (pixel_scoreboard_too_soon(scoreboard, inst))
+                return false;
+
+        /* ldunif and ldvary both write r5, but ldunif does so a tick
+         * sooner.  If the ldvary's r5 wasn't used, then ldunif might
+         * otherwise get scheduled so ldunif and ldvary try to update
+         * r5 in the same tick.
+         *
+         * XXX perf: To get good pipelining of a sequence of varying
+         * loads, we need to figure out how to pair the ldvary signal
+         * up to the instruction before the last r5 user in the
+         * previous ldvary sequence.  Currently, it usually pairs with
+         * the last r5 user.
+         */
+        if ((inst->sig.ldunif || inst->sig.ldunifa) &&
+            scoreboard->tick == scoreboard->last_ldvary_tick + 1) {
+                return false;
+        }
+
+        /* If we're trying to pair with another instruction, check
+         * that they're compatible.
+         */
+        if (prev_inst) {
+                /* Don't pair up a thread switch signal -- we'll
+                 * handle pairing it when we pick it on its own.
+                 */
+                if (inst->sig.thrsw)
+                        return false;
+
+                if (prev_inst->inst->uniform != -1 &&
+                    n->inst->uniform != -1)
+                        return false;
+
+                /* Don't merge in something that will lock the TLB.
+                 * Hopwefully what we have in inst will release some
+                 * other instructions, allowing us to delay the
+                 * TLB-locking instruction until later.
+                 */
+                if (!scoreboard->tlb_locked && qpu_inst_is_tlb(inst))
+                        return false;
+
+                struct v3d_qpu_instr merged_inst;
+                if (!qpu_merge_inst(devinfo, &merged_inst,
+                                    &prev_inst->inst->qpu, inst)) {
+                        return false;
+                }
+
+                /* Don't merge an instruction that stalls */
+                if (mux_read_stalls(scoreboard, inst))
+                        return false;
+        }
+
+        return true;
+}
+
+/**
+ * Returns whether some other DAG head could be merged into the instruction
+ * if we picked n for it.
+ */
+static bool
+node_has_merge_partner(const struct v3d_device_info *devinfo,
+                       struct choose_scoreboard *scoreboard,
+                       struct schedule_node *n)
+{
+        if (n->inst->qpu.type != V3D_QPU_INSTR_TYPE_ALU ||
+            n->inst->qpu.sig.thrsw) {
+                return false;
+        }
+
+        list_for_each_entry(struct schedule_node, m, &scoreboard->dag->heads,
+                            dag.link) {
+                if (m != n && can_schedule_node(devinfo, scoreboard, n, m))
+                        return true;
+        }
+
+        return false;
+}
+
 static struct schedule_node *
 choose_instruction_to_schedule(const struct v3d_device_info *devinfo,
                                struct choose_scoreboard *scoreboard,
@@ -762,6 +876,7 @@ choose_instruction_to_schedule(const struct v3d_device_info *devinfo,
 {
         struct schedule_node *chosen = NULL;
         int chosen_prio = 0;
+        int chosen_can_merge = -1;
 
         /* Don't pair up anything with a thread switch signal -- emit_thrsw()
          * will handle pairing it along with filling the delay slots.
@@ -775,113 +890,60 @@ choose_instruction_to_schedule(const struct v3d_device_info *devinfo,
                             dag.link) {
                 const struct v3d_qpu_instr *inst = &n->inst->qpu;
 
-                /* Don't choose the branch instruction until it's the last one
-                 * left.  We'll move it up to fit its delay slots after we
-                 * choose it.
-                 */
-                if (inst->type == V3D_QPU_INSTR_TYPE_BRANCH &&
-                    !list_is_singular(&scoreboard->dag->heads)) {
-                        continue;
-                }
-
-                /* "An instruction must not read from a location in physical
-                 *  regfile A or B that was written to by the previous
-                 *  instruction."
-                 */
-                if (reads_too_soon_after_write(scoreboard, n->inst))
-                        continue;
-
-                if (writes_too_soon_after_write(devinfo, scoreboard, n->inst))
+                if (!can_schedule_node(devinfo, scoreboard, prev_inst, n))
                         continue;
 
-                /* "A scoreboard wait must not occur in the first two
-                 *  instructions of a fragment shader. This is either the
-                 *  explicit Wait for Scoreboard signal or an implicit wait
-                 *  with the first tile-buffer read or write instruction."
-                 */
-                if (pixel_scoreboard_too_soon(scoreboard, inst))
-                        continue;
-
-                /* ldunif and ldvary both write r5, but ldunif does so a tick
-                 * sooner.  If the ldvary's r5 wasn't used, then ldunif might
-                 * otherwise get scheduled so ldunif and ldvary try to update
-                 * r5 in the same tick.
-                 *
-                 * XXX perf: To get good pipelining of a sequence of varying
-                 * loads, we need to figure out how to pair the ldvary signal
-                 * up to the instruction before the last r5 user in the
-                 * previous ldvary sequence.  Currently, it usually pairs with
-                 * the last r5 user.
-                 */
-                if ((inst->sig.ldunif || inst->sig.ldunifa) &&
-                    scoreboard->tick == scoreboard->last_ldvary_tick + 1) {
-                        continue;
-                }
-
-                /* If we're trying to pair with another instruction, check
-                 * that they're compatible.
-                 */
-                if (prev_inst) {
-                        /* Don't pair up a thread switch signal -- we'll
-                         * handle pairing it when we pick it on its own.
-                         */
-                        if (inst->sig.thrsw)
-                                continue;
-
-                        if (prev_inst->inst->uniform != -1 &&
-                            n->inst->uniform != -1)
-                                continue;
-
-                        /* Don't merge in something that will lock the TLB.
-                         * Hopwefully what we have in inst will release some
-                         * other instructions, allowing us to delay the
-                         * TLB-locking instruction until later.
-                         */
-                        if (!scoreboard->tlb_locked && qpu_inst_is_tlb(inst))
-                                continue;
-
-                        struct v3d_qpu_instr merged_inst;
-                        if (!qpu_merge_inst(devinfo, &merged_inst,
-                                            &prev_inst->inst->qpu, inst)) {
-                                continue;
-                        }
-                }
-
                 int prio = get_instruction_priority(inst);
 
                 if (mux_read_stalls(scoreboard, inst)) {
-                        /* Don't merge an instruction that stalls */
-                        if (prev_inst)
-                                continue;
-                        else {
-                                /* Any instruction that don't stall will have
-                                 * higher scheduling priority */
-                                prio -= MAX_SCHEDULE_PRIORITY;
-                                assert(prio < 0);
-                        }
+                        /* Any instruction that don't stall will have
+                         * higher scheduling priority
+                         */
+                        prio -= MAX_SCHEDULE_PRIORITY;
+                        assert(prio < 0);
                 }
 
                 /* Found a valid instruction.  If nothing better comes along,
                  * this one works.
                  */
-                if (!chosen) {
+                if (!chosen || prio > chosen_prio) {
                         chosen = n;
                         chosen_prio = prio;
+                        chosen_can_merge = -1;
                         continue;
-                }
-
-                if (prio > chosen_prio) {
-                        chosen = n;
-                        chosen_prio = prio;
                 } else if (prio < chosen_prio) {
                         continue;
                 }
 
-                if (n->delay > chosen->delay) {
+                int delay = n->delay;
+                int chosen_delay = chosen->delay;
+                int can_merge = -1;
+
+                /* Look ahead at whether the rest of the ready list could
+                 * be paired with the instruction: filling the other ALU
+                 * saves an instruction right away, which is worth as much
+                 * as a cycle of the critical path.  Only bother when that
+                 * can change the choice, since it's quadratic in the
+                 * number of DAG heads.
+                 */
+                if (!prev_inst && abs(delay - chosen_delay) <= 1) {
+                        if (chosen_can_merge < 0) {
+                                chosen_can_merge =
+                                        node_has_merge_partner(devinfo,
+                                                               scoreboard,
+                                                               chosen);
+                        }
+                        can_merge = node_has_merge_partner(devinfo,
+                                                           scoreboard, n);
+
+                        delay += can_merge;
+                        chosen_delay += chosen_can_merge;
+                }
+
+                if (delay > chosen_delay) {
                         chosen = n;
                         chosen_prio = prio;
-                } else if (n->delay < chosen->delay) {
-                        continue;
+                        chosen_can_merge = can_merge;
                 }
         }
 
@@ -1344,6 +1406,7 @@ schedule_instructions(struct v3d_compile *c,
                                 list_addtail(&merge->link, &merged_list);
                                 (void)qpu_merge_inst(devinfo, inst,
                                                      inst, &merge->inst->qpu);
+                                c->qpu_inst_merged_count++;
                                 if (merge->inst->uniform != -1) {
                                         chosen->inst->uniform =
                                                 merge->inst->uniform;
@@ -614,6 +614,8 @@ struct v3d_compile {
         uint32_t qpu_inst_count;
         uint32_t qpu_inst_size;
         uint32_t qpu_inst_stalled_count;
+        /** Number of VIR instructions merged into another's QPU instruction. */
+        uint32_t qpu_inst_merged_count;
 
         /* For the FS, the number of varying inputs not counting the
          * point/line varyings payload
@@ -952,7 +952,8 @@ uint64_t *v3d_compile(const struct v3d_compiler *compiler,
         int ret = asprintf(&shaderdb,
                            "%s shader: %d inst, %d threads, %d loops, "
                            "%d uniforms, %d max-temps, %d:%d spills:fills, "
-                           "%d sfu-stalls, %d inst-and-stalls",
+                           "%d sfu-stalls, %d inst-and-stalls, "
+                           "%d merged-inst",
                            vir_get_stage_name(c),
                            c->qpu_inst_count,
                            c->threads,
@@ -962,7 +963,8 @@ uint64_t *v3d_compile(const struct v3d_compiler *compiler,
                            c->spills,
                            c->fills,
                            c->qpu_inst_stalled_count,
-                           c->qpu_inst_count + c->qpu_inst_stalled_count);
+                           c->qpu_inst_count + c->qpu_inst_stalled_count,
+                           c->qpu_inst_merged_count);
         if (ret >= 0) {
                 if (V3D_DEBUG & V3D_DEBUG_SHADERDB)
                         fprintf(stderr, "SHADER-DB: %s\n", shaderdb);
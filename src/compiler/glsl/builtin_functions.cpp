@@ -39,7 +39,9 @@
  *
  *    The builtin_builder::create_builtins() function contains lists of all
  *    built-in function signatures, where they're available, what types they
- *    take, and so on.
+ *    take, and so on.  It is only run on demand: the first time a shader
+ *    references a name, the list is walked again and only the entries for
+ *    that name generate IR.
  *
  * 4. Implementations of built-in function signatures
  *
@@ -83,6 +85,7 @@
 #include <math.h>
 #include "builtin_functions.h"
 #include "util/hash_table.h"
+#include "util/set.h"
 
 #define M_PIf   ((float) M_PI)
 #define M_PI_2f ((float) M_PI_2)
@@ -842,6 +845,9 @@ public:
    ir_function_signature *find(_mesa_glsl_parse_state *state,
                                const char *name, exec_list *actual_parameters);
 
+   /** Look up the built-in function \p name, generating it if necessary. */
+   ir_function *find_function(const char *name);
+
    /**
     * A shader to hold all the built-in signatures; created by this module.
     *
@@ -854,10 +860,30 @@ public:
 private:
    void *mem_ctx;
 
+   /**
+    * Names for which create_builtins() has already been run, whether or not
+    * they turned out to be built-ins.
+    */
+   struct set *materialized;
+
+   /**
+    * The only name create_builtins() should generate IR for, or NULL to
+    * generate all of them.
+    */
+   const char *materialize_name;
+
    void create_shader();
    void create_intrinsics();
    void create_builtins();
 
+   /** Generate the built-in signatures for \p name, if not done already. */
+   void materialize(const char *name);
+
+   bool wants_function(const char *name) const
+   {
+      return materialize_name == NULL || strcmp(name, materialize_name) == 0;
+   }
+
    /**
     * IR builder helpers:
     *
@@ -1212,7 +1238,7 @@ enum image_function_flags {
  *  @{
  */
 builtin_builder::builtin_builder()
-   : shader(NULL)
+   : shader(NULL), materialized(NULL), materialize_name(NULL)
 {
    mem_ctx = NULL;
 }
@@ -1235,7 +1261,7 @@ builtin_builder::find(_mesa_glsl_parse_state *state,
     */
    state->uses_builtin_functions = true;
 
-   ir_function *f = shader->symbols->get_function(name);
+   ir_function *f = find_function(name);
    if (f == NULL)
       return NULL;
 
@@ -1247,6 +1273,13 @@ builtin_builder::find(_mesa_glsl_parse_state *state,
    return sig;
 }
 
+ir_function *
+builtin_builder::find_function(const char *name)
+{
+   materialize(name);
+   return shader->symbols->get_function(name);
+}
+
 void
 builtin_builder::initialize()
 {
@@ -1257,9 +1290,28 @@ builtin_builder::initialize()
    glsl_type_singleton_init_or_ref();
 
    mem_ctx = ralloc_context(NULL);
+   materialized = _mesa_set_create(mem_ctx, _mesa_key_hash_string,
+                                   _mesa_key_string_equal);
    create_shader();
+
+   /* Built-in bodies call intrinsics by looking them up in the symbol table,
+    * so those have to exist before anything is materialized.  The built-ins
+    * themselves are generated on first use by materialize().
+    */
    create_intrinsics();
+}
+
+void
+builtin_builder::materialize(const char *name)
+{
+   if (_mesa_set_search(materialized, name) != NULL)
+      return;
+
+   _mesa_set_add(materialized, ralloc_strdup(mem_ctx, name));
+
+   materialize_name = name;
    create_builtins();
+   materialize_name = NULL;
 }
 
 void
@@ -1267,6 +1319,7 @@ builtin_builder::release()
 {
    ralloc_free(mem_ctx);
    mem_ctx = NULL;
+   materialized = NULL;
 
    ralloc_free(shader);
    shader = NULL;
@@ -1498,6 +1551,16 @@ builtin_builder::create_intrinsics()
  *
  * Contains a list of every available built-in.
  */
+
+/* Skip every entry but the one being materialized.  The check happens before
+ * the signature arguments are evaluated, so the others don't emit any IR.
+ */
+#define add_function(name, ...)                        \
+   do {                                                \
+      if (wants_function(name))                        \
+         add_function(name, __VA_ARGS__);              \
+   } while (0)
+
 void
 builtin_builder::create_builtins()
 {
@@ -4261,6 +4324,8 @@ builtin_builder::create_builtins()
 #undef FIU2_MIXED
 }
 
+#undef add_function
+
 void
 builtin_builder::add_function(const char *name, ...)
 {
@@ -4331,6 +4396,9 @@ builtin_builder::add_image_function(const char *name,
       glsl_type::uimage2DMSArray_type
    };
 
+   if (!wants_function(name))
+      return;
+
    ir_function *f = new(mem_ctx) ir_function(name);
 
    for (unsigned i = 0; i < ARRAY_SIZE(types); ++i) {
@@ -7324,7 +7392,7 @@ _mesa_glsl_has_builtin_function(_mesa_glsl_parse_state *state, const char *name)
    ir_function *f;
    bool ret = false;
    mtx_lock(&builtins_lock);
-   f = builtins.shader->symbols->get_function(name);
+   f = builtins.find_function(name);
    if (f != NULL) {
       foreach_in_list(ir_function_signature, sig, &f->signatures) {
          if (sig->is_builtin_available(state)) {
@@ -7338,10 +7406,15 @@ _mesa_glsl_has_builtin_function(_mesa_glsl_parse_state *state, const char *name)
    return ret;
 }
 
-gl_shader *
-_mesa_glsl_get_builtin_function_shader()
+ir_function *
+_mesa_glsl_find_builtin_function_by_name(const char *name)
 {
-   return builtins.shader;
+   ir_function *f;
+   mtx_lock(&builtins_lock);
+   f = builtins.find_function(name);
+   mtx_unlock(&builtins_lock);
+
+   return f;
 }
 
 
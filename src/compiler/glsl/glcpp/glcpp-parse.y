@@ -107,6 +107,12 @@ _parser_active_list_pop(glcpp_parser_t *parser);
 static int
 _parser_active_list_contains(glcpp_parser_t *parser, const char *identifier);
 
+static bool
+_macro_is_memoizable(glcpp_parser_t *parser, macro_t *macro);
+
+static token_list_t *
+_glcpp_parser_memoize(glcpp_parser_t *parser, macro_t *macro);
+
 typedef enum {
    EXPANSION_MODE_IGNORE_DEFINED,
    EXPANSION_MODE_EVALUATE_DEFINED
@@ -321,6 +327,7 @@ control_line_success:
 		entry = _mesa_hash_table_search (parser->defines, $3);
 		if (entry) {
 			_mesa_hash_table_remove (parser->defines, entry);
+			parser->define_generation++;
 		}
 	}
 |	HASH_TOKEN IF pp_tokens NEWLINE {
@@ -1367,6 +1374,7 @@ glcpp_parser_create(const struct gl_extensions *extension_list,
    glcpp_lex_init_extra (parser, &parser->scanner);
    parser->defines = _mesa_hash_table_create(NULL, _mesa_key_hash_string,
                                              _mesa_key_string_equal);
+   parser->define_generation = 0;
    parser->linalloc = linear_alloc_parent(parser, 0);
    parser->active = NULL;
    parser->lexing_directive = 0;
@@ -1896,6 +1904,13 @@ _glcpp_parser_expand_node(glcpp_parser_t *parser, token_node_t *node,
       if (macro->replacements == NULL)
          return _token_list_create_with_one_space(parser);
 
+      /* Outside of any other expansion, the active list is empty, so the
+       * expansion only depends on the macros currently defined and can be
+       * reused from the last time.
+       */
+      if (parser->active == NULL && _macro_is_memoizable(parser, macro))
+         return _token_list_copy(parser, _glcpp_parser_memoize(parser, macro));
+
       replacement = _token_list_copy(parser, macro->replacements);
       _glcpp_parser_apply_pastes(parser, replacement);
       return replacement;
@@ -1904,6 +1919,86 @@ _glcpp_parser_expand_node(glcpp_parser_t *parser, token_node_t *node,
    return _glcpp_parser_expand_function(parser, node, last, mode);
 }
 
+/* Whether the expansion of 'macro' is independent of the tokens around
+ * it.  That's the case if expanding it only ever involves object-like
+ * macros without pasting, "defined", __LINE__ or __FILE__, so that the
+ * expansion can't fail or look past its end.  Recursive macros are
+ * conservatively rejected.
+ */
+static bool
+_macro_is_memoizable(glcpp_parser_t *parser, macro_t *macro)
+{
+   token_node_t *node;
+   bool memoizable = true;
+
+   if (macro->memo_generation != parser->define_generation) {
+      macro->memo_generation = parser->define_generation;
+      macro->memo_state = MACRO_MEMO_UNKNOWN;
+      macro->memo = NULL;
+   }
+
+   switch (macro->memo_state) {
+   case MACRO_MEMO_YES:
+      return true;
+   case MACRO_MEMO_NO:
+   case MACRO_MEMO_VISITING:
+      return false;
+   case MACRO_MEMO_UNKNOWN:
+      break;
+   }
+
+   if (macro->is_function) {
+      macro->memo_state = MACRO_MEMO_NO;
+      return false;
+   }
+
+   macro->memo_state = MACRO_MEMO_VISITING;
+
+   for (node = macro->replacements ? macro->replacements->head : NULL;
+        node && memoizable; node = node->next) {
+      token_t *token = node->token;
+
+      if (token->type == DEFINED || token->type == PASTE) {
+         memoizable = false;
+      } else if (token->type == IDENTIFIER) {
+         const char *identifier = token->value.str;
+         struct hash_entry *entry;
+
+         if (strcmp(identifier, "__LINE__") == 0 ||
+             strcmp(identifier, "__FILE__") == 0) {
+            memoizable = false;
+         } else {
+            entry = _mesa_hash_table_search(parser->defines, identifier);
+            if (entry && !_macro_is_memoizable(parser, entry->data))
+               memoizable = false;
+         }
+      }
+   }
+
+   macro->memo_state = memoizable ? MACRO_MEMO_YES : MACRO_MEMO_NO;
+   return memoizable;
+}
+
+/* Return the full expansion of a memoizable object-like macro, computing
+ * it on first use.  Callers must copy the list before splicing it.
+ */
+static token_list_t *
+_glcpp_parser_memoize(glcpp_parser_t *parser, macro_t *macro)
+{
+   if (macro->memo == NULL) {
+      token_list_t *expansion = _token_list_copy(parser, macro->replacements);
+
+      _parser_active_list_push(parser, macro->identifier, NULL);
+      _glcpp_parser_expand_token_list(parser, expansion,
+                                      EXPANSION_MODE_IGNORE_DEFINED);
+      _parser_active_list_pop(parser);
+
+      macro->memo = expansion;
+   }
+
+   return macro->memo;
+}
+
 /* Push a new identifier onto the parser's active list.
  *
  * Here, 'marker' is the token node that appears in the list after the
@@ -2132,6 +2227,9 @@ _define_object_macro(glcpp_parser_t *parser, YYLTYPE *loc,
    macro->parameters = NULL;
    macro->identifier = linear_strdup(parser->linalloc, identifier);
    macro->replacements = replacements;
+   macro->memo_generation = 0;
+   macro->memo_state = MACRO_MEMO_UNKNOWN;
+   macro->memo = NULL;
 
    entry = _mesa_hash_table_search(parser->defines, identifier);
    previous = entry ? entry->data : NULL;
@@ -2143,6 +2241,7 @@ _define_object_macro(glcpp_parser_t *parser, YYLTYPE *loc,
    }
 
    _mesa_hash_table_insert (parser->defines, identifier, macro);
+   parser->define_generation++;
 }
 
 void
@@ -2167,6 +2266,9 @@ _define_function_macro(glcpp_parser_t *parser, YYLTYPE *loc,
    macro->parameters = parameters;
    macro->identifier = linear_strdup(parser->linalloc, identifier);
    macro->replacements = replacements;
+   macro->memo_generation = 0;
+   macro->memo_state = MACRO_MEMO_UNKNOWN;
+   macro->memo = NULL;
 
    entry = _mesa_hash_table_search(parser->defines, identifier);
    previous = entry ? entry->data : NULL;
@@ -2178,6 +2280,7 @@ _define_function_macro(glcpp_parser_t *parser, YYLTYPE *loc,
    }
 
    _mesa_hash_table_insert(parser->defines, identifier, macro);
+   parser->define_generation++;
 }
 
 static int
@@ -143,11 +143,26 @@ glcpp_parser_classify_token (glcpp_parser_t *parser,
 			     const char *identifier,
 			     int *parameter_index);
 
+typedef enum macro_memo_state {
+	MACRO_MEMO_UNKNOWN,
+	MACRO_MEMO_VISITING,
+	MACRO_MEMO_NO,
+	MACRO_MEMO_YES
+} macro_memo_state_t;
+
 typedef struct {
 	int is_function;
 	string_list_t *parameters;
 	const char *identifier;
 	token_list_t *replacements;
+
+	/* Whether the full expansion of this object-like macro can be
+	 * reused, and the expansion itself once computed.  Both are only
+	 * valid while memo_generation matches the parser's
+	 * define_generation. */
+	unsigned memo_generation;
+	macro_memo_state_t memo_state;
+	token_list_t *memo;
 } macro_t;
 
 typedef struct expansion_node {
@@ -188,6 +203,7 @@ struct glcpp_parser {
 	void *linalloc;
 	yyscan_t scanner;
 	struct hash_table *defines;
+	unsigned define_generation; /* bumped by every #define and #undef */
 	active_list_t *active;
 	int lexing_directive;
 	int lexing_version_directive;
@@ -31,13 +31,13 @@
 
 #include "main/errors.h"
 #include "main/mtypes.h"
-#include "glsl_symbol_table.h"
 #include "glsl_parser_extras.h"
 #include "ir_optimization.h"
 #include "linker.h"
 #include "link_varyings.h"
 #include "main/macros.h"
 #include "util/hash_table.h"
+#include "util/set.h"
 #include "util/u_math.h"
 #include "program.h"
 
@@ -732,6 +732,13 @@ validate_first_and_last_interface_explicit_locations(struct gl_context *ctx,
    }
 }
 
+static ir_variable *
+find_output(hash_table *outputs, const char *name)
+{
+   hash_entry *entry = _mesa_hash_table_search(outputs, name);
+   return entry ? (ir_variable *) entry->data : NULL;
+}
+
 /**
  * Validate that outputs from one stage match inputs of another
  */
@@ -741,7 +748,10 @@ cross_validate_outputs_to_inputs(struct gl_context *ctx,
                                  gl_linked_shader *producer,
                                  gl_linked_shader *consumer)
 {
-   glsl_symbol_table parameters;
+   void *mem_ctx = ralloc_context(NULL);
+   hash_table *outputs =
+      _mesa_hash_table_create(mem_ctx, _mesa_key_hash_string,
+                              _mesa_key_string_equal);
    struct explicit_location_info output_explicit_locations[MAX_VARYING][4] = {};
    struct explicit_location_info input_explicit_locations[MAX_VARYING][4] = {};
 
@@ -754,15 +764,20 @@ cross_validate_outputs_to_inputs(struct gl_context *ctx,
          continue;
 
       if (!var->data.explicit_location
-          || var->data.location < VARYING_SLOT_VAR0)
-         parameters.add_variable(var);
-      else {
+          || var->data.location < VARYING_SLOT_VAR0) {
+         /* The first declaration of a name wins, as it did when these were
+          * kept in a symbol table.
+          */
+         if (!_mesa_hash_table_search(outputs, var->name))
+            _mesa_hash_table_insert(outputs, var->name, var);
+      } else {
          /* User-defined varyings with explicit locations are handled
           * differently because they do not need to have matching names.
           */
          if (!validate_explicit_variable_location(ctx,
                                                   output_explicit_locations,
                                                   var, prog, producer)) {
+            ralloc_free(mem_ctx);
             return;
          }
       }
@@ -785,20 +800,20 @@ cross_validate_outputs_to_inputs(struct gl_context *ctx,
 
       if (strcmp(input->name, "gl_Color") == 0 && input->data.used) {
          const ir_variable *const front_color =
-            parameters.get_variable("gl_FrontColor");
+            find_output(outputs, "gl_FrontColor");
 
          const ir_variable *const back_color =
-            parameters.get_variable("gl_BackColor");
+            find_output(outputs, "gl_BackColor");
 
          cross_validate_front_and_back_color(ctx, prog, input,
                                              front_color, back_color,
                                              consumer->Stage, producer->Stage);
       } else if (strcmp(input->name, "gl_SecondaryColor") == 0 && input->data.used) {
          const ir_variable *const front_color =
-            parameters.get_variable("gl_FrontSecondaryColor");
+            find_output(outputs, "gl_FrontSecondaryColor");
 
          const ir_variable *const back_color =
-            parameters.get_variable("gl_BackSecondaryColor");
+            find_output(outputs, "gl_BackSecondaryColor");
 
          cross_validate_front_and_back_color(ctx, prog, input,
                                              front_color, back_color,
@@ -822,6 +837,7 @@ cross_validate_outputs_to_inputs(struct gl_context *ctx,
             if (!validate_explicit_variable_location(ctx,
                                                      input_explicit_locations,
                                                      input, prog, consumer)) {
+               ralloc_free(mem_ctx);
                return;
             }
 
@@ -830,6 +846,7 @@ cross_validate_outputs_to_inputs(struct gl_context *ctx,
                   linker_error(prog,
                                "Invalid location %u in %s shader\n", idx,
                                _mesa_shader_stage_to_string(consumer->Stage));
+                  ralloc_free(mem_ctx);
                   return;
                }
 
@@ -859,7 +876,7 @@ cross_validate_outputs_to_inputs(struct gl_context *ctx,
                idx++;
             }
          } else {
-            output = parameters.get_variable(input->name);
+            output = find_output(outputs, input->name);
          }
 
          if (output != NULL) {
@@ -887,6 +904,8 @@ cross_validate_outputs_to_inputs(struct gl_context *ctx,
          }
       }
    }
+
+   ralloc_free(mem_ctx);
 }
 
 /**
@@ -1016,21 +1035,20 @@ tfeedback_decl::init(struct gl_context *ctx, const void *mem_ctx,
 
 
 /**
- * Determine whether two tfeedback_decl objects refer to the same variable and
- * array index (if applicable).
+ * Return a string that identifies the variable and array index (if
+ * applicable) this tfeedback_decl refers to.  Two declarations refer to the
+ * same varying exactly when their keys compare equal.
  */
-bool
-tfeedback_decl::is_same(const tfeedback_decl &x, const tfeedback_decl &y)
+const char *
+tfeedback_decl::identity_key(void *mem_ctx) const
 {
-   assert(x.is_varying() && y.is_varying());
+   assert(this->is_varying());
 
-   if (strcmp(x.var_name, y.var_name) != 0)
-      return false;
-   if (x.is_subscripted != y.is_subscripted)
-      return false;
-   if (x.is_subscripted && x.array_subscript != y.array_subscript)
-      return false;
-   return true;
+   if (!this->is_subscripted)
+      return this->var_name;
+
+   return ralloc_asprintf(mem_ctx, "%s[%u]", this->var_name,
+                          this->array_subscript);
 }
 
 
@@ -1386,6 +1404,9 @@ parse_tfeedback_decls(struct gl_context *ctx, struct gl_shader_program *prog,
                       const void *mem_ctx, unsigned num_names,
                       char **varying_names, tfeedback_decl *decls)
 {
+   set *seen = _mesa_set_create(NULL, _mesa_key_hash_string,
+                                _mesa_key_string_equal);
+
    for (unsigned i = 0; i < num_names; ++i) {
       decls[i].init(ctx, mem_ctx, varying_names[i]);
 
@@ -1402,16 +1423,19 @@ parse_tfeedback_decls(struct gl_context *ctx, struct gl_shader_program *prog,
        * specify the same varying variable and array index", since transform
        * feedback of arrays would be useless otherwise.
        */
-      for (unsigned j = 0; j < i; ++j) {
-         if (decls[j].is_varying()) {
-            if (tfeedback_decl::is_same(decls[i], decls[j])) {
-               linker_error(prog, "Transform feedback varying %s specified "
-                            "more than once.", varying_names[i]);
-               return false;
-            }
-         }
+      const char *key = decls[i].identity_key(seen);
+
+      if (_mesa_set_search(seen, key)) {
+         linker_error(prog, "Transform feedback varying %s specified "
+                      "more than once.", varying_names[i]);
+         _mesa_set_destroy(seen, NULL);
+         return false;
       }
+
+      _mesa_set_add(seen, key);
    }
+
+   _mesa_set_destroy(seen, NULL);
    return true;
 }
 
@@ -21,8 +21,10 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <inttypes.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <getopt.h>
 
 /** @file main.cpp
@@ -35,9 +37,20 @@
  */
 
 #include "main/mtypes.h"
+#include "util/detect_os.h"
+#include "util/os_time.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_queue.h"
 #include "standalone.h"
 
+#if DETECT_OS_UNIX
+#include <sys/resource.h>
+#endif
+
 static struct standalone_options options;
+static const char *batch_manifest;
+static const char *batch_json = "-";
+static unsigned batch_threads;
 
 const struct option compiler_opts[] = {
    { "dump-ast", no_argument, &options.dump_ast, 1 },
@@ -47,6 +60,9 @@ const struct option compiler_opts[] = {
    { "link",     no_argument, &options.do_link,  1 },
    { "just-log", no_argument, &options.just_log, 1 },
    { "version",  required_argument, NULL, 'v' },
+   { "batch",    required_argument, NULL, 'b' },
+   { "threads",  required_argument, NULL, 'j' },
+   { "json",     required_argument, NULL, 'o' },
    { NULL, 0, NULL, 0 }
 };
 
@@ -59,9 +75,14 @@ usage_fail(const char *name)
 
    const char *header =
       "usage: %s [options] <file.vert | file.tesc | file.tese | file.geom | file.frag | file.comp>\n"
+      "       %s [options] --batch <manifest> [--threads <n>] [--json <file>]\n"
+      "\n"
+      "A batch manifest lists one program per line as whitespace separated\n"
+      "shader files; empty lines and lines starting with '#' are skipped.\n"
+      "Results are written as JSON to --json, or stdout by default.\n"
       "\n"
       "Possible options are:\n";
-   printf(header, name);
+   printf(header, name, name);
    for (const struct option *o = compiler_opts; o->name != 0; ++o) {
       printf("    --%s", o->name);
       if (o->has_arg == required_argument)
@@ -71,6 +92,201 @@ usage_fail(const char *name)
    exit(EXIT_FAILURE);
 }
 
+struct batch_program {
+   char **files;
+   unsigned num_files;
+   struct util_queue_fence fence;
+
+   /* Filled in by the worker thread. */
+   bool valid;
+   bool linked;
+   int64_t time_ns;
+   unsigned ir_size;
+};
+
+static void
+compile_batch_program(void *data, int thread_index)
+{
+   struct batch_program *prog = (struct batch_program *) data;
+
+   /* gl_context is too big for a worker's stack. */
+   struct gl_context *ctx = (struct gl_context *) calloc(1, sizeof(*ctx));
+   if (!ctx)
+      return;
+
+   int64_t start = os_time_get_nano();
+   struct gl_shader_program *whole_program =
+      standalone_compile_shader(&options, prog->num_files, prog->files, ctx);
+   prog->time_ns = os_time_get_nano() - start;
+
+   if (whole_program) {
+      prog->valid = true;
+      prog->linked = whole_program->data->LinkStatus;
+      prog->ir_size = standalone_count_linked_ir(whole_program);
+      standalone_compiler_cleanup(whole_program);
+   }
+
+   free(ctx);
+}
+
+static void
+print_json_string(FILE *f, const char *str)
+{
+   fputc('"', f);
+   for (; *str; str++) {
+      if (*str == '"' || *str == '\\')
+         fputc('\\', f);
+      fputc(*str, f);
+   }
+   fputc('"', f);
+}
+
+/**
+ * Parse the manifest into programs.  Returns the number of programs, or -1
+ * on error.  Everything is allocated with malloc and lives until exit.
+ */
+static int
+read_batch_manifest(const char *path, struct batch_program **programs_out)
+{
+   FILE *f = fopen(path, "r");
+   if (!f) {
+      fprintf(stderr, "Cannot open batch manifest `%s'\n", path);
+      return -1;
+   }
+
+   struct batch_program *programs = NULL;
+   unsigned num_programs = 0;
+   char *line = NULL;
+   size_t line_size = 0;
+
+   while (getline(&line, &line_size, f) != -1) {
+      struct batch_program prog = {};
+      char *save;
+
+      if (line[0] == '#')
+         continue;
+
+      for (char *tok = strtok_r(line, " \t\r\n", &save); tok;
+           tok = strtok_r(NULL, " \t\r\n", &save)) {
+         /* standalone_compile_shader exits on a missing file, which would
+          * take the whole batch down.
+          */
+         FILE *shader = fopen(tok, "rb");
+         if (!shader) {
+            fprintf(stderr, "File \"%s\" does not exist.\n", tok);
+            fclose(f);
+            free(line);
+            return -1;
+         }
+         fclose(shader);
+
+         prog.files = (char **) realloc(prog.files, (prog.num_files + 1) *
+                                                    sizeof(char *));
+         prog.files[prog.num_files++] = strdup(tok);
+      }
+
+      if (prog.num_files == 0)
+         continue;
+
+      programs = (struct batch_program *)
+         realloc(programs, (num_programs + 1) * sizeof(*programs));
+      programs[num_programs++] = prog;
+   }
+
+   free(line);
+   fclose(f);
+
+   *programs_out = programs;
+   return num_programs;
+}
+
+/**
+ * Compile and link every program of the manifest on a pool of threads, and
+ * report per-program results as JSON.
+ */
+static int
+run_batch(void)
+{
+   struct batch_program *programs;
+   int num_programs = read_batch_manifest(batch_manifest, &programs);
+   if (num_programs < 0)
+      return EXIT_FAILURE;
+
+   if (batch_threads == 0) {
+      util_cpu_detect();
+      batch_threads = util_cpu_caps.nr_cpus;
+   }
+
+   struct util_queue queue;
+   if (!util_queue_init(&queue, "glsl", 64, batch_threads,
+                        UTIL_QUEUE_INIT_RESIZE_IF_FULL)) {
+      fprintf(stderr, "Failed to create the compiler threads\n");
+      return EXIT_FAILURE;
+   }
+
+   int64_t start = os_time_get_nano();
+   for (int i = 0; i < num_programs; i++) {
+      util_queue_fence_init(&programs[i].fence);
+      util_queue_add_job(&queue, &programs[i], &programs[i].fence,
+                         compile_batch_program, NULL);
+   }
+   for (int i = 0; i < num_programs; i++) {
+      util_queue_fence_wait(&programs[i].fence);
+      util_queue_fence_destroy(&programs[i].fence);
+   }
+   int64_t total_ns = os_time_get_nano() - start;
+
+   util_queue_destroy(&queue);
+
+   FILE *out = stdout;
+   if (strcmp(batch_json, "-") != 0) {
+      out = fopen(batch_json, "w");
+      if (!out) {
+         fprintf(stderr, "Cannot open `%s' for writing\n", batch_json);
+         return EXIT_FAILURE;
+      }
+   }
+
+   int status = EXIT_SUCCESS;
+
+   fprintf(out, "{\n  \"threads\": %u,\n  \"programs\": [\n", batch_threads);
+   for (int i = 0; i < num_programs; i++) {
+      const struct batch_program *prog = &programs[i];
+
+      fprintf(out, "    { \"files\": [");
+      for (unsigned j = 0; j < prog->num_files; j++) {
+         if (j)
+            fprintf(out, ", ");
+         print_json_string(out, prog->files[j]);
+      }
+      fprintf(out, "], \"status\": \"%s\", \"time_ns\": %" PRId64
+              ", \"ir_instructions\": %u }%s\n",
+              !prog->valid ? "invalid" : prog->linked ? "success" : "failure",
+              prog->time_ns, prog->ir_size,
+              i + 1 < num_programs ? "," : "");
+
+      if (!prog->valid || !prog->linked)
+         status = EXIT_FAILURE;
+   }
+   fprintf(out, "  ],\n  \"total_time_ns\": %" PRId64, total_ns);
+
+#if DETECT_OS_UNIX
+   /* Peak memory is only known for the whole process, not per program;
+    * use --threads 1 and one program per run to attribute it.
+    */
+   struct rusage usage;
+   if (getrusage(RUSAGE_SELF, &usage) == 0)
+      fprintf(out, ",\n  \"peak_rss_kb\": %ld", usage.ru_maxrss);
+#endif
+
+   fprintf(out, "\n}\n");
+
+   if (out != stdout)
+      fclose(out);
+
+   return status;
+}
+
 int
 main(int argc, char * const* argv)
 {
@@ -83,11 +299,23 @@ main(int argc, char * const* argv)
       case 'v':
          options.glsl_version = strtol(optarg, NULL, 10);
          break;
+      case 'b':
+         batch_manifest = optarg;
+         break;
+      case 'j':
+         batch_threads = strtol(optarg, NULL, 10);
+         break;
+      case 'o':
+         batch_json = optarg;
+         break;
       default:
          break;
       }
    }
 
+   if (batch_manifest)
+      return run_batch();
+
    if (argc <= optind)
       usage_fail(argv[0]);
 
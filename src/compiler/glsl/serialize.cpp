@@ -428,63 +428,80 @@ has_uniform_storage(struct gl_shader_program *prog, unsigned idx)
 static void
 write_uniforms(struct blob *metadata, struct gl_shader_program *prog)
 {
+   const unsigned num_uniforms = prog->data->NumUniformStorage;
+
    blob_write_uint32(metadata, prog->SamplersValidated);
-   blob_write_uint32(metadata, prog->data->NumUniformStorage);
+   blob_write_uint32(metadata, num_uniforms);
    blob_write_uint32(metadata, prog->data->NumUniformDataSlots);
 
-   for (unsigned i = 0; i < prog->data->NumUniformStorage; i++) {
+   /* The plain fields go out as an image of the UniformStorage array so that
+    * read_uniforms can load them with a single copy.  The pointers are left
+    * NULL in the image and written separately below.  Copy field by field
+    * into zeroed memory so padding doesn't leak uninitialized bytes.
+    */
+   struct gl_uniform_storage *image = (struct gl_uniform_storage *)
+      calloc(num_uniforms, sizeof(*image));
+   if (num_uniforms && !image) {
+      metadata->out_of_memory = true;
+      return;
+   }
+
+   unsigned names_size = 0;
+   for (unsigned i = 0; i < num_uniforms; i++) {
+      const struct gl_uniform_storage *uni = &prog->data->UniformStorage[i];
+
+      image[i].array_elements = uni->array_elements;
+      memcpy(image[i].opaque, uni->opaque, sizeof(uni->opaque));
+      image[i].active_shader_mask = uni->active_shader_mask;
+      image[i].block_index = uni->block_index;
+      image[i].offset = uni->offset;
+      image[i].matrix_stride = uni->matrix_stride;
+      image[i].array_stride = uni->array_stride;
+      image[i].row_major = uni->row_major;
+      image[i].hidden = uni->hidden;
+      image[i].builtin = uni->builtin;
+      image[i].is_shader_storage = uni->is_shader_storage;
+      image[i].atomic_buffer_index = uni->atomic_buffer_index;
+      image[i].remap_location = uni->remap_location;
+      image[i].num_compatible_subroutines = uni->num_compatible_subroutines;
+      image[i].top_level_array_size = uni->top_level_array_size;
+      image[i].top_level_array_stride = uni->top_level_array_stride;
+      image[i].is_bindless = uni->is_bindless;
+
+      names_size += (uni->name ? strlen(uni->name) : 0) + 1;
+   }
+
+   blob_write_bytes(metadata, image, sizeof(*image) * num_uniforms);
+   free(image);
+
+   /* All the names, back to back, so they can share one allocation. */
+   blob_write_uint32(metadata, names_size);
+   for (unsigned i = 0; i < num_uniforms; i++) {
+      const char *name = prog->data->UniformStorage[i].name;
+      if (!name)
+         name = "";
+      blob_write_bytes(metadata, name, strlen(name) + 1);
+   }
+
+   for (unsigned i = 0; i < num_uniforms; i++) {
       encode_type_to_blob(metadata, prog->data->UniformStorage[i].type);
-      blob_write_uint32(metadata, prog->data->UniformStorage[i].array_elements);
-      if (prog->data->UniformStorage[i].name) {
-         blob_write_string(metadata, prog->data->UniformStorage[i].name);
-      } else {
-         blob_write_string(metadata, "");
-      }
-      blob_write_uint32(metadata, prog->data->UniformStorage[i].builtin);
-      blob_write_uint32(metadata, prog->data->UniformStorage[i].remap_location);
-      blob_write_uint32(metadata, prog->data->UniformStorage[i].block_index);
-      blob_write_uint32(metadata, prog->data->UniformStorage[i].atomic_buffer_index);
-      blob_write_uint32(metadata, prog->data->UniformStorage[i].offset);
-      blob_write_uint32(metadata, prog->data->UniformStorage[i].array_stride);
-      blob_write_uint32(metadata, prog->data->UniformStorage[i].hidden);
-      blob_write_uint32(metadata, prog->data->UniformStorage[i].is_shader_storage);
-      blob_write_uint32(metadata, prog->data->UniformStorage[i].active_shader_mask);
-      blob_write_uint32(metadata, prog->data->UniformStorage[i].matrix_stride);
-      blob_write_uint32(metadata, prog->data->UniformStorage[i].row_major);
-      blob_write_uint32(metadata, prog->data->UniformStorage[i].is_bindless);
-      blob_write_uint32(metadata,
-                        prog->data->UniformStorage[i].num_compatible_subroutines);
-      blob_write_uint32(metadata,
-                        prog->data->UniformStorage[i].top_level_array_size);
-      blob_write_uint32(metadata,
-                        prog->data->UniformStorage[i].top_level_array_stride);
 
-     if (has_uniform_storage(prog, i)) {
+      if (has_uniform_storage(prog, i)) {
          blob_write_uint32(metadata, prog->data->UniformStorage[i].storage -
                                      prog->data->UniformDataSlots);
       }
-
-      blob_write_bytes(metadata, prog->data->UniformStorage[i].opaque,
-                       sizeof(prog->data->UniformStorage[i].opaque));
    }
 
    /* Here we cache all uniform values. We do this to retain values for
     * uniforms with initialisers and also hidden uniforms that may be lowered
-    * constant arrays. We could possibly just store the values we need but for
-    * now we just store everything.
+    * constant arrays.  Storing the whole defaults array rather than just the
+    * slots of each uniform lets it be read back with one copy.
     */
    blob_write_uint32(metadata, prog->data->NumHiddenUniforms);
-   for (unsigned i = 0; i < prog->data->NumUniformStorage; i++) {
-      if (has_uniform_storage(prog, i)) {
-         unsigned vec_size =
-            prog->data->UniformStorage[i].type->component_slots() *
-            MAX2(prog->data->UniformStorage[i].array_elements, 1);
-         unsigned slot =
-            prog->data->UniformStorage[i].storage -
-            prog->data->UniformDataSlots;
-         blob_write_bytes(metadata, &prog->data->UniformDataDefaults[slot],
-                          sizeof(union gl_constant_value) * vec_size);
-      }
+   if (prog->data->NumUniformDataSlots) {
+      blob_write_bytes(metadata, prog->data->UniformDataDefaults,
+                       sizeof(union gl_constant_value) *
+                          prog->data->NumUniformDataSlots);
    }
 }
 
@@ -498,70 +515,51 @@ read_uniforms(struct blob_reader *metadata, struct gl_shader_program *prog)
    prog->data->NumUniformStorage = blob_read_uint32(metadata);
    prog->data->NumUniformDataSlots = blob_read_uint32(metadata);
 
-   uniforms = rzalloc_array(prog->data, struct gl_uniform_storage,
-                            prog->data->NumUniformStorage);
+   const unsigned num_uniforms = prog->data->NumUniformStorage;
+
+   uniforms = ralloc_array(prog->data, struct gl_uniform_storage,
+                           num_uniforms);
    prog->data->UniformStorage = uniforms;
 
-   data = rzalloc_array(uniforms, union gl_constant_value,
-                        prog->data->NumUniformDataSlots);
+   data = ralloc_array(uniforms, union gl_constant_value,
+                       prog->data->NumUniformDataSlots);
    prog->data->UniformDataSlots = data;
    prog->data->UniformDataDefaults =
-      rzalloc_array(uniforms, union gl_constant_value,
-                    prog->data->NumUniformDataSlots);
+      ralloc_array(uniforms, union gl_constant_value,
+                   prog->data->NumUniformDataSlots);
+
+   blob_copy_bytes(metadata, (uint8_t *) uniforms,
+                   sizeof(*uniforms) * num_uniforms);
+
+   unsigned names_size = blob_read_uint32(metadata);
+   char *names = (char *) ralloc_size(uniforms, names_size);
+   blob_copy_bytes(metadata, (uint8_t *) names, names_size);
 
    prog->UniformHash = new string_to_uint_map;
 
-   for (unsigned i = 0; i < prog->data->NumUniformStorage; i++) {
+   /* Everything that isn't part of the copied image. */
+   for (unsigned i = 0; i < num_uniforms; i++) {
+      uniforms[i].name = names;
+      names += strlen(names) + 1;
       uniforms[i].type = decode_type_from_blob(metadata);
-      uniforms[i].array_elements = blob_read_uint32(metadata);
-      uniforms[i].name = ralloc_strdup(prog, blob_read_string (metadata));
-      uniforms[i].builtin = blob_read_uint32(metadata);
-      uniforms[i].remap_location = blob_read_uint32(metadata);
-      uniforms[i].block_index = blob_read_uint32(metadata);
-      uniforms[i].atomic_buffer_index = blob_read_uint32(metadata);
-      uniforms[i].offset = blob_read_uint32(metadata);
-      uniforms[i].array_stride = blob_read_uint32(metadata);
-      uniforms[i].hidden = blob_read_uint32(metadata);
-      uniforms[i].is_shader_storage = blob_read_uint32(metadata);
-      uniforms[i].active_shader_mask = blob_read_uint32(metadata);
-      uniforms[i].matrix_stride = blob_read_uint32(metadata);
-      uniforms[i].row_major = blob_read_uint32(metadata);
-      uniforms[i].is_bindless = blob_read_uint32(metadata);
-      uniforms[i].num_compatible_subroutines = blob_read_uint32(metadata);
-      uniforms[i].top_level_array_size = blob_read_uint32(metadata);
-      uniforms[i].top_level_array_stride = blob_read_uint32(metadata);
-      prog->UniformHash->put(i, uniforms[i].name);
-
-      if (has_uniform_storage(prog, i)) {
-         uniforms[i].storage = data + blob_read_uint32(metadata);
-      }
+      uniforms[i].num_driver_storage = 0;
+      uniforms[i].driver_storage = NULL;
+      uniforms[i].storage = has_uniform_storage(prog, i) ?
+         data + blob_read_uint32(metadata) : NULL;
 
-      memcpy(uniforms[i].opaque,
-             blob_read_bytes(metadata, sizeof(uniforms[i].opaque)),
-             sizeof(uniforms[i].opaque));
+      prog->UniformHash->put(i, uniforms[i].name);
    }
 
    /* Restore uniform values. */
    prog->data->NumHiddenUniforms = blob_read_uint32(metadata);
-   for (unsigned i = 0; i < prog->data->NumUniformStorage; i++) {
-      if (has_uniform_storage(prog, i)) {
-         unsigned vec_size =
-            prog->data->UniformStorage[i].type->component_slots() *
-            MAX2(prog->data->UniformStorage[i].array_elements, 1);
-         unsigned slot =
-            prog->data->UniformStorage[i].storage -
-            prog->data->UniformDataSlots;
-         blob_copy_bytes(metadata,
-                         (uint8_t *) &prog->data->UniformDataSlots[slot],
-                         sizeof(union gl_constant_value) * vec_size);
-
-        assert(vec_size + prog->data->UniformStorage[i].storage <=
-               data +  prog->data->NumUniformDataSlots);
-      }
+   if (prog->data->NumUniformDataSlots) {
+      blob_copy_bytes(metadata, (uint8_t *) data,
+                      sizeof(union gl_constant_value) *
+                         prog->data->NumUniformDataSlots);
+      memcpy(prog->data->UniformDataDefaults, data,
+             sizeof(union gl_constant_value) *
+                prog->data->NumUniformDataSlots);
    }
-
-   memcpy(prog->data->UniformDataDefaults, prog->data->UniformDataSlots,
-          sizeof(union gl_constant_value) * prog->data->NumUniformDataSlots);
 }
 
 enum uniform_remap_type
@@ -571,20 +569,39 @@ enum uniform_remap_type
    remap_type_uniform_offset
 };
 
+/* Arrays of uniforms take one remap table entry per element, all pointing
+ * at the same gl_uniform_storage, so the tables are written as runs of
+ * identical entries: the entry type, the uniform offset if there is one and
+ * the number of consecutive locations sharing it.
+ */
 static void
-write_uniform_remap_table_entry(struct blob *metadata,
-                                gl_uniform_storage *uniform_storage,
-                                gl_uniform_storage *entry)
+write_uniform_remap_table(struct blob *metadata,
+                          unsigned num_entries,
+                          gl_uniform_storage *uniform_storage,
+                          gl_uniform_storage **remap_table)
 {
-   if (entry == INACTIVE_UNIFORM_EXPLICIT_LOCATION) {
-      blob_write_uint32(metadata, remap_type_inactive_explicit_location);
-   } else if (entry == NULL) {
-      blob_write_uint32(metadata, remap_type_null_ptr);
-   } else {
-      blob_write_uint32(metadata, remap_type_uniform_offset);
-
-      uint32_t offset = entry - uniform_storage;
-      blob_write_uint32(metadata, offset);
+   blob_write_uint32(metadata, num_entries);
+
+   for (unsigned i = 0; i < num_entries; ) {
+      gl_uniform_storage *entry = remap_table[i];
+      unsigned count = 1;
+
+      while (i + count < num_entries && remap_table[i + count] == entry)
+         count++;
+
+      if (entry == INACTIVE_UNIFORM_EXPLICIT_LOCATION) {
+         blob_write_uint32(metadata, remap_type_inactive_explicit_location);
+      } else if (entry == NULL) {
+         blob_write_uint32(metadata, remap_type_null_ptr);
+      } else {
+         blob_write_uint32(metadata, remap_type_uniform_offset);
+
+         uint32_t offset = entry - uniform_storage;
+         blob_write_uint32(metadata, offset);
+      }
+
+      blob_write_uint32(metadata, count);
+      i += count;
    }
 }
 
@@ -592,41 +609,59 @@ static void
 write_uniform_remap_tables(struct blob *metadata,
                            struct gl_shader_program *prog)
 {
-   blob_write_uint32(metadata, prog->NumUniformRemapTable);
-
-   for (unsigned i = 0; i < prog->NumUniformRemapTable; i++) {
-      write_uniform_remap_table_entry(metadata, prog->data->UniformStorage,
-                                      prog->UniformRemapTable[i]);
-   }
+   write_uniform_remap_table(metadata, prog->NumUniformRemapTable,
+                             prog->data->UniformStorage,
+                             prog->UniformRemapTable);
 
    for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
       struct gl_linked_shader *sh = prog->_LinkedShaders[i];
       if (sh) {
          struct gl_program *glprog = sh->Program;
-         blob_write_uint32(metadata, glprog->sh.NumSubroutineUniformRemapTable);
-
-         for (unsigned j = 0; j < glprog->sh.NumSubroutineUniformRemapTable; j++) {
-            write_uniform_remap_table_entry(metadata,
-                                            prog->data->UniformStorage,
-                                            glprog->sh.SubroutineUniformRemapTable[j]);
-         }
+         write_uniform_remap_table(metadata,
+                                   glprog->sh.NumSubroutineUniformRemapTable,
+                                   prog->data->UniformStorage,
+                                   glprog->sh.SubroutineUniformRemapTable);
       }
    }
 }
 
 static void
-read_uniform_remap_table_entry(struct blob_reader *metadata,
-                               gl_uniform_storage *uniform_storage,
-                               gl_uniform_storage **entry,
-                               enum uniform_remap_type type)
+read_uniform_remap_table(struct blob_reader *metadata,
+                         void *mem_ctx,
+                         gl_uniform_storage *uniform_storage,
+                         unsigned *num_entries,
+                         gl_uniform_storage ***remap_table)
 {
-   if (type == remap_type_inactive_explicit_location) {
-      *entry = INACTIVE_UNIFORM_EXPLICIT_LOCATION;
-   } else if (type == remap_type_null_ptr) {
-      *entry = NULL;
-   } else {
-      uint32_t uni_offset = blob_read_uint32(metadata);
-      *entry = uniform_storage + uni_offset;
+   unsigned num = blob_read_uint32(metadata);
+
+   *num_entries = num;
+   gl_uniform_storage **table =
+      rzalloc_array(mem_ctx, struct gl_uniform_storage *, num);
+   *remap_table = table;
+
+   for (unsigned i = 0; i < num && !metadata->overrun; ) {
+      enum uniform_remap_type type =
+         (enum uniform_remap_type) blob_read_uint32(metadata);
+      gl_uniform_storage *entry;
+
+      if (type == remap_type_inactive_explicit_location) {
+         entry = INACTIVE_UNIFORM_EXPLICIT_LOCATION;
+      } else if (type == remap_type_null_ptr) {
+         entry = NULL;
+      } else {
+         uint32_t uni_offset = blob_read_uint32(metadata);
+         entry = uniform_storage + uni_offset;
+      }
+
+      unsigned count = MIN2(blob_read_uint32(metadata), num - i);
+      for (unsigned j = 0; j < count; j++)
+         table[i + j] = entry;
+
+      /* A zero count can only come from a truncated blob. */
+      if (count == 0)
+         break;
+
+      i += count;
    }
 }
 
@@ -634,38 +669,17 @@ static void
 read_uniform_remap_tables(struct blob_reader *metadata,
                           struct gl_shader_program *prog)
 {
-   prog->NumUniformRemapTable = blob_read_uint32(metadata);
-
-   prog->UniformRemapTable = rzalloc_array(prog, struct gl_uniform_storage *,
-                                           prog->NumUniformRemapTable);
-
-   for (unsigned i = 0; i < prog->NumUniformRemapTable; i++) {
-      enum uniform_remap_type type =
-         (enum uniform_remap_type) blob_read_uint32(metadata);
-
-      read_uniform_remap_table_entry(metadata, prog->data->UniformStorage,
-                                     &prog->UniformRemapTable[i], type);
-   }
+   read_uniform_remap_table(metadata, prog, prog->data->UniformStorage,
+                            &prog->NumUniformRemapTable,
+                            &prog->UniformRemapTable);
 
    for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
       struct gl_linked_shader *sh = prog->_LinkedShaders[i];
       if (sh) {
          struct gl_program *glprog = sh->Program;
-         glprog->sh.NumSubroutineUniformRemapTable = blob_read_uint32(metadata);
-
-         glprog->sh.SubroutineUniformRemapTable =
-            rzalloc_array(glprog, struct gl_uniform_storage *,
-                          glprog->sh.NumSubroutineUniformRemapTable);
-
-         for (unsigned j = 0; j < glprog->sh.NumSubroutineUniformRemapTable; j++) {
-            enum uniform_remap_type type =
-               (enum uniform_remap_type) blob_read_uint32(metadata);
-
-            read_uniform_remap_table_entry(metadata,
-                                           prog->data->UniformStorage,
-                                           &glprog->sh.SubroutineUniformRemapTable[j],
-                                           type);
-         }
+         read_uniform_remap_table(metadata, glprog, prog->data->UniformStorage,
+                                  &glprog->sh.NumSubroutineUniformRemapTable,
+                                  &glprog->sh.SubroutineUniformRemapTable);
       }
    }
 }
@@ -747,13 +761,10 @@ write_shader_subroutine_index(struct blob *metadata,
 {
    assert(sh);
 
-   for (unsigned j = 0; j < sh->Program->sh.NumSubroutineFunctions; j++) {
-      if (strcmp(((gl_subroutine_function *)res->Data)->name,
-                 sh->Program->sh.SubroutineFunctions[j].name) == 0) {
-         blob_write_uint32(metadata, j);
-         break;
-      }
-   }
+   unsigned j = (gl_subroutine_function *)res->Data -
+                sh->Program->sh.SubroutineFunctions;
+   assert(j < sh->Program->sh.NumSubroutineFunctions);
+   blob_write_uint32(metadata, j);
 }
 
 static void
@@ -804,23 +815,23 @@ write_program_resource_data(struct blob *metadata,
                        s_var_size - s_var_ptrs);
       break;
    }
+   /* The linker points resource Data straight into the arrays that
+    * read_program_resource_data indexes, so the index is just the offset
+    * into that array.
+    */
    case GL_UNIFORM_BLOCK:
-      for (unsigned i = 0; i < prog->data->NumUniformBlocks; i++) {
-         if (strcmp(((gl_uniform_block *)res->Data)->Name,
-                    prog->data->UniformBlocks[i].Name) == 0) {
-            blob_write_uint32(metadata, i);
-            break;
-         }
-      }
+      assert((unsigned) ((gl_uniform_block *)res->Data -
+                         prog->data->UniformBlocks) <
+             prog->data->NumUniformBlocks);
+      blob_write_uint32(metadata, (gl_uniform_block *)res->Data -
+                                  prog->data->UniformBlocks);
       break;
    case GL_SHADER_STORAGE_BLOCK:
-      for (unsigned i = 0; i < prog->data->NumShaderStorageBlocks; i++) {
-         if (strcmp(((gl_uniform_block *)res->Data)->Name,
-                    prog->data->ShaderStorageBlocks[i].Name) == 0) {
-            blob_write_uint32(metadata, i);
-            break;
-         }
-      }
+      assert((unsigned) ((gl_uniform_block *)res->Data -
+                         prog->data->ShaderStorageBlocks) <
+             prog->data->NumShaderStorageBlocks);
+      blob_write_uint32(metadata, (gl_uniform_block *)res->Data -
+                                  prog->data->ShaderStorageBlocks);
       break;
    case GL_BUFFER_VARIABLE:
    case GL_VERTEX_SUBROUTINE_UNIFORM:
@@ -833,26 +844,22 @@ write_program_resource_data(struct blob *metadata,
       if (((gl_uniform_storage *)res->Data)->builtin ||
           res->Type != GL_UNIFORM) {
          blob_write_uint32(metadata, uniform_not_remapped);
-         for (unsigned i = 0; i < prog->data->NumUniformStorage; i++) {
-            if (strcmp(((gl_uniform_storage *)res->Data)->name,
-                       prog->data->UniformStorage[i].name) == 0) {
-               blob_write_uint32(metadata, i);
-               break;
-            }
-         }
+         assert((unsigned) ((gl_uniform_storage *)res->Data -
+                            prog->data->UniformStorage) <
+                prog->data->NumUniformStorage);
+         blob_write_uint32(metadata, (gl_uniform_storage *)res->Data -
+                                     prog->data->UniformStorage);
       } else {
          blob_write_uint32(metadata, uniform_remapped);
          blob_write_uint32(metadata, ((gl_uniform_storage *)res->Data)->remap_location);
       }
       break;
    case GL_ATOMIC_COUNTER_BUFFER:
-      for (unsigned i = 0; i < prog->data->NumAtomicBuffers; i++) {
-         if (((gl_active_atomic_buffer *)res->Data)->Binding ==
-             prog->data->AtomicBuffers[i].Binding) {
-            blob_write_uint32(metadata, i);
-            break;
-         }
-      }
+      assert((unsigned) ((gl_active_atomic_buffer *)res->Data -
+                         prog->data->AtomicBuffers) <
+             prog->data->NumAtomicBuffers);
+      blob_write_uint32(metadata, (gl_active_atomic_buffer *)res->Data -
+                                  prog->data->AtomicBuffers);
       break;
    case GL_TRANSFORM_FEEDBACK_BUFFER:
       for (unsigned i = 0; i < MAX_FEEDBACK_BUFFERS; i++) {
@@ -863,15 +870,16 @@ write_program_resource_data(struct blob *metadata,
          }
       }
       break;
-   case GL_TRANSFORM_FEEDBACK_VARYING:
-      for (int i = 0; i < prog->last_vert_prog->sh.LinkedTransformFeedback->NumVarying; i++) {
-         if (strcmp(((gl_transform_feedback_varying_info *)res->Data)->Name,
-                    prog->last_vert_prog->sh.LinkedTransformFeedback->Varyings[i].Name) == 0) {
-            blob_write_uint32(metadata, i);
-            break;
-         }
-      }
+   case GL_TRANSFORM_FEEDBACK_VARYING: {
+      struct gl_transform_feedback_info *xfb =
+         prog->last_vert_prog->sh.LinkedTransformFeedback;
+      assert(((gl_transform_feedback_varying_info *)res->Data -
+              xfb->Varyings) < xfb->NumVarying);
+      blob_write_uint32(metadata,
+                        (gl_transform_feedback_varying_info *)res->Data -
+                        xfb->Varyings);
       break;
+   }
    case GL_VERTEX_SUBROUTINE:
    case GL_TESS_CONTROL_SUBROUTINE:
    case GL_TESS_EVALUATION_SUBROUTINE:
@@ -42,6 +42,12 @@
  * in the hope that the final linked shader will be found in the cache.
  * If anything goes wrong (shader variant not found, backend cache item is
  * corrupt, etc) we will use a fallback path to compile and link the IR.
+ *
+ * Because the program key covers every attached shader, a new combination
+ * of shaders that were each seen before still misses.  To keep that from
+ * recompiling every stage from source, a second, in-memory tier keeps the
+ * compiled IR of recently compiled shaders keyed by their own hash, and the
+ * fallback path clones it so that only the linking has to be redone.
  */
 
 #include "compiler/shader_info.h"
@@ -57,6 +63,8 @@
 #include "program.h"
 #include "serialize.h"
 #include "shader_cache.h"
+#include "util/hash_table.h"
+#include "util/list.h"
 #include "util/mesa-sha1.h"
 #include "string_to_uint_map.h"
 #include "main/mtypes.h"
@@ -67,10 +75,241 @@ extern "C" {
 #include "program/program.h"
 }
 
+/** Number of compiled shaders kept by the per-stage tier. */
+#define STAGE_CACHE_MAX_ENTRIES 64
+
+struct shader_stage_cache {
+   simple_mtx_t mutex;
+
+   /** Maps a stage key to its stage_cache_entry. */
+   struct hash_table *entries;
+
+   /** Entries in least recently used order, the most recent first. */
+   struct list_head lru;
+   unsigned num_entries;
+};
+
+struct stage_cache_entry {
+   cache_key key;
+   struct list_head link;
+
+   /** A private copy of the compiled shader, never linked directly. */
+   struct gl_shader *shader;
+};
+
+static uint32_t
+stage_key_hash(const void *key)
+{
+   return _mesa_hash_data(key, sizeof(cache_key));
+}
+
+static bool
+stage_key_equal(const void *a, const void *b)
+{
+   return memcmp(a, b, sizeof(cache_key)) == 0;
+}
+
+static void
+compute_stage_key(struct gl_context *ctx, struct gl_shader *sh,
+                  cache_key key)
+{
+   /* sh->sha1 only covers the source.  Contexts that share shader objects
+    * can still differ in API and version, which changes the compile.
+    */
+   const unsigned state[] = {
+      (unsigned) sh->Stage,
+      ctx->API,
+      ctx->Version,
+      ctx->Const.GLSLVersion,
+      ctx->Const.ForceGLSLVersion,
+   };
+
+   struct mesa_sha1 sha1_ctx;
+   _mesa_sha1_init(&sha1_ctx);
+   _mesa_sha1_update(&sha1_ctx, sh->sha1, sizeof(sh->sha1));
+   _mesa_sha1_update(&sha1_ctx, state, sizeof(state));
+   _mesa_sha1_final(&sha1_ctx, key);
+}
+
+static struct shader_stage_cache *
+get_stage_cache(struct gl_context *ctx)
+{
+   struct gl_shared_state *shared = ctx->Shared;
+
+   simple_mtx_lock(&shared->Mutex);
+   if (shared->ShaderStageCache == NULL) {
+      struct shader_stage_cache *cache =
+         rzalloc(NULL, struct shader_stage_cache);
+      simple_mtx_init(&cache->mutex, mtx_plain);
+      cache->entries = _mesa_hash_table_create(cache, stage_key_hash,
+                                               stage_key_equal);
+      list_inithead(&cache->lru);
+      shared->ShaderStageCache = cache;
+   }
+   simple_mtx_unlock(&shared->Mutex);
+
+   return shared->ShaderStageCache;
+}
+
+extern "C" void
+shader_cache_destroy_stage_cache(struct shader_stage_cache *cache)
+{
+   if (cache == NULL)
+      return;
+
+   simple_mtx_destroy(&cache->mutex);
+   ralloc_free(cache);
+}
+
+/**
+ * Replace the compile results in \p dst with a copy of those in \p src.
+ *
+ * This covers everything _mesa_glsl_compile_shader() sets on success, so
+ * \p dst can be linked as if it had been compiled itself.
+ */
+static void
+copy_compiled_shader(struct gl_shader *dst, struct gl_shader *src)
+{
+   assert(src->CompileStatus == COMPILE_SUCCESS);
+
+   ralloc_free(dst->ir);
+   dst->ir = new(dst) exec_list;
+   clone_ir_list(dst->ir, dst->ir, src->ir);
+
+   dst->symbols = new(dst->ir) glsl_symbol_table;
+   _mesa_glsl_copy_symbols_from_table(dst->ir, src->symbols, dst->symbols);
+
+   ralloc_free(dst->InfoLog);
+   dst->InfoLog = ralloc_strdup(dst, src->InfoLog);
+
+   dst->CompileStatus = COMPILE_SUCCESS;
+   dst->Version = src->Version;
+   dst->IsES = src->IsES;
+   dst->BlendSupport = src->BlendSupport;
+   dst->EarlyFragmentTests = src->EarlyFragmentTests;
+   dst->ARB_fragment_coord_conventions_enable =
+      src->ARB_fragment_coord_conventions_enable;
+   dst->redeclares_gl_fragcoord = src->redeclares_gl_fragcoord;
+   dst->uses_gl_fragcoord = src->uses_gl_fragcoord;
+   dst->PostDepthCoverage = src->PostDepthCoverage;
+   dst->PixelInterlockOrdered = src->PixelInterlockOrdered;
+   dst->PixelInterlockUnordered = src->PixelInterlockUnordered;
+   dst->SampleInterlockOrdered = src->SampleInterlockOrdered;
+   dst->SampleInterlockUnordered = src->SampleInterlockUnordered;
+   dst->InnerCoverage = src->InnerCoverage;
+   dst->origin_upper_left = src->origin_upper_left;
+   dst->pixel_center_integer = src->pixel_center_integer;
+   dst->bindless_sampler = src->bindless_sampler;
+   dst->bindless_image = src->bindless_image;
+   dst->bound_sampler = src->bound_sampler;
+   dst->bound_image = src->bound_image;
+   memcpy(dst->TransformFeedbackBufferStride,
+          src->TransformFeedbackBufferStride,
+          sizeof(dst->TransformFeedbackBufferStride));
+   dst->info = src->info;
+}
+
+void
+shader_cache_write_compiled_shader(struct gl_context *ctx,
+                                   struct gl_shader *sh)
+{
+   if (!ctx->Cache || sh->CompileStatus != COMPILE_SUCCESS)
+      return;
+
+   struct shader_stage_cache *cache = get_stage_cache(ctx);
+
+   cache_key key;
+   compute_stage_key(ctx, sh, key);
+
+   /* Copy the IR before taking the lock; it's the expensive part. */
+   struct stage_cache_entry *entry = rzalloc(NULL, struct stage_cache_entry);
+   memcpy(entry->key, key, sizeof(cache_key));
+   entry->shader = rzalloc(entry, struct gl_shader);
+   entry->shader->Type = sh->Type;
+   entry->shader->Stage = sh->Stage;
+   copy_compiled_shader(entry->shader, sh);
+
+   simple_mtx_lock(&cache->mutex);
+
+   struct hash_entry *he = _mesa_hash_table_search(cache->entries, key);
+   if (he != NULL) {
+      /* Another context got here first. */
+      struct stage_cache_entry *old = (struct stage_cache_entry *) he->data;
+      list_del(&old->link);
+      list_add(&old->link, &cache->lru);
+      simple_mtx_unlock(&cache->mutex);
+      ralloc_free(entry);
+      return;
+   }
+
+   if (cache->num_entries == STAGE_CACHE_MAX_ENTRIES) {
+      struct stage_cache_entry *lru =
+         list_last_entry(&cache->lru, struct stage_cache_entry, link);
+      _mesa_hash_table_remove_key(cache->entries, lru->key);
+      list_del(&lru->link);
+      ralloc_free(lru);
+      cache->num_entries--;
+   }
+
+   ralloc_steal(cache, entry);
+   _mesa_hash_table_insert(cache->entries, entry->key, entry);
+   list_add(&entry->link, &cache->lru);
+   cache->num_entries++;
+
+   simple_mtx_unlock(&cache->mutex);
+}
+
+bool
+shader_cache_read_compiled_shader(struct gl_context *ctx,
+                                  struct gl_shader *sh)
+{
+   struct shader_stage_cache *cache = ctx->Shared->ShaderStageCache;
+   if (cache == NULL)
+      return false;
+
+   cache_key key;
+   compute_stage_key(ctx, sh, key);
+
+   simple_mtx_lock(&cache->mutex);
+
+   struct hash_entry *he = _mesa_hash_table_search(cache->entries, key);
+   if (he == NULL) {
+      simple_mtx_unlock(&cache->mutex);
+      return false;
+   }
+
+   struct stage_cache_entry *entry = (struct stage_cache_entry *) he->data;
+   list_del(&entry->link);
+   list_add(&entry->link, &cache->lru);
+
+   /* The entry may be evicted as soon as the lock is dropped. */
+   copy_compiled_shader(sh, entry->shader);
+
+   simple_mtx_unlock(&cache->mutex);
+
+   if (ctx->Shader.Flags & GLSL_CACHE_INFO) {
+      char sha1_buf[41];
+      _mesa_sha1_format(sha1_buf, sh->sha1);
+      fprintf(stderr, "reusing compiled shader from stage cache: %s\n",
+              sha1_buf);
+   }
+
+   return true;
+}
+
 static void
 compile_shaders(struct gl_context *ctx, struct gl_shader_program *prog) {
    for (unsigned i = 0; i < prog->NumShaders; i++) {
-      _mesa_glsl_compile_shader(ctx, prog->Shaders[i], false, false, true);
+      struct gl_shader *sh = prog->Shaders[i];
+
+      /* Shaders whose compile was deferred may have been compiled for
+       * another program already.
+       */
+      if (sh->CompileStatus == COMPILE_SKIPPED &&
+          shader_cache_read_compiled_shader(ctx, sh))
+         continue;
+
+      _mesa_glsl_compile_shader(ctx, sh, false, false, true);
    }
 }
 
@@ -27,7 +27,20 @@
 #include "util/disk_cache.h"
 
 struct gl_context;
+struct gl_shader;
 struct gl_shader_program;
+struct shader_stage_cache;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void
+shader_cache_destroy_stage_cache(struct shader_stage_cache *cache);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
 
 void
 shader_cache_write_program_metadata(struct gl_context *ctx,
@@ -37,4 +50,12 @@ bool
 shader_cache_read_program_metadata(struct gl_context *ctx,
                                    struct gl_shader_program *prog);
 
+void
+shader_cache_write_compiled_shader(struct gl_context *ctx,
+                                   struct gl_shader *sh);
+
+bool
+shader_cache_read_compiled_shader(struct gl_context *ctx,
+                                  struct gl_shader *sh);
+
 #endif /* SHADER_CACHE_H */
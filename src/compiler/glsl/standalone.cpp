@@ -607,6 +607,30 @@ fail:
    return NULL;
 }
 
+static void
+count_ir_instruction(ir_instruction *, void *data)
+{
+   (*(unsigned *) data)++;
+}
+
+extern "C" unsigned
+standalone_count_linked_ir(struct gl_shader_program *whole_program)
+{
+   unsigned count = 0;
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      struct gl_linked_shader *shader = whole_program->_LinkedShaders[i];
+
+      if (!shader)
+         continue;
+
+      foreach_in_list(ir_instruction, ir, shader->ir)
+         visit_tree(ir, count_ir_instruction, &count);
+   }
+
+   return count;
+}
+
 extern "C" void
 standalone_compiler_cleanup(struct gl_shader_program *whole_program)
 {
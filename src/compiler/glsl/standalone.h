@@ -45,6 +45,9 @@ struct gl_shader_program * standalone_compile_shader(
       unsigned num_files, char* const* files,
       struct gl_context *ctx);
 
+/* Number of IR instructions left in the linked shaders of prog. */
+unsigned standalone_count_linked_ir(struct gl_shader_program *prog);
+
 void standalone_compiler_cleanup(struct gl_shader_program *prog);
 
 #ifdef __cplusplus
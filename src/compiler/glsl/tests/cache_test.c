@@ -493,6 +493,124 @@ test_put_key_and_get_key(void)
 
    disk_cache_destroy(cache);
 }
+
+static void
+test_get_batch(void)
+{
+   struct disk_cache *cache;
+   char blob[] = "This is a blob of thirty-seven bytes";
+   char string[] = "While this string has thirty-four";
+   uint8_t keys[3][20];
+   struct disk_cache_batch *batch;
+   char *result;
+   size_t size;
+
+   cache = disk_cache_create("test", "make_check", 0);
+
+   disk_cache_compute_key(cache, blob, sizeof(blob), keys[0]);
+   disk_cache_compute_key(cache, string, sizeof(string), keys[1]);
+   memset(keys[2], 0x5a, sizeof(keys[2]));
+
+   disk_cache_put(cache, keys[0], blob, sizeof(blob), NULL);
+   disk_cache_put(cache, keys[1], string, sizeof(string), NULL);
+   wait_until_file_written(cache, keys[0]);
+   wait_until_file_written(cache, keys[1]);
+
+   batch = disk_cache_get_batch(cache, (const cache_key *) keys, 3);
+   expect_non_null(batch, "disk_cache_get_batch");
+
+   /* Take the results out of order. */
+   result = disk_cache_batch_get(batch, 1, &size);
+   expect_equal_str(result, string, "disk_cache_batch_get 2nd item (pointer)");
+   expect_equal(size, sizeof(string), "disk_cache_batch_get 2nd item (size)");
+   free(result);
+
+   result = disk_cache_batch_get(batch, 2, &size);
+   expect_null(result, "disk_cache_batch_get missing item (pointer)");
+   expect_equal(size, 0, "disk_cache_batch_get missing item (size)");
+
+   result = disk_cache_batch_get(batch, 1, &size);
+   expect_null(result, "disk_cache_batch_get of an item already taken");
+
+   /* Leave the first item for disk_cache_batch_destroy() to free. */
+   disk_cache_batch_destroy(batch);
+
+   disk_cache_destroy(cache);
+}
+
+static void
+test_lru_eviction(void)
+{
+   struct disk_cache *cache;
+   char data[100];
+   uint8_t keys[10][20];
+   uint8_t new_key[20];
+   int err, count;
+
+   err = rmrf_local(CACHE_TEST_TMP);
+   expect_equal(err, 0, "Removing " CACHE_TEST_TMP " before LRU test");
+   mkdir(CACHE_TEST_TMP, 0755);
+
+   /* Room for the ten items below, assuming each takes one 4K block. */
+   setenv("MESA_GLSL_CACHE_MAX_SIZE", "40K", 1);
+   cache = disk_cache_create("test", "make_check", 0);
+
+   for (unsigned i = 0; i < 10; i++) {
+      memset(data, i, sizeof(data));
+      disk_cache_compute_key(cache, data, sizeof(data), keys[i]);
+      disk_cache_put(cache, keys[i], data, sizeof(data), NULL);
+      wait_until_file_written(cache, keys[i]);
+   }
+
+   /* Use the older half again, making the newer half the coldest. */
+   for (unsigned i = 0; i < 5; i++)
+      does_cache_contain(cache, keys[i]);
+
+   memset(data, 0xff, sizeof(data));
+   disk_cache_compute_key(cache, data, sizeof(data), new_key);
+   disk_cache_put(cache, new_key, data, sizeof(data), NULL);
+   wait_until_file_written(cache, new_key);
+
+   count = 0;
+   for (unsigned i = 0; i < 5; i++) {
+      if (does_cache_contain(cache, keys[i]))
+         count++;
+   }
+   expect_equal(count, 5, "LRU eviction keeps recently used items");
+
+   count = 0;
+   for (unsigned i = 5; i < 10; i++) {
+      if (does_cache_contain(cache, keys[i]))
+         count++;
+   }
+   expect_true(count < 5, "LRU eviction drops least recently used items");
+
+   expect_true(does_cache_contain(cache, new_key),
+               "LRU eviction keeps the new item");
+
+   disk_cache_destroy(cache);
+   unsetenv("MESA_GLSL_CACHE_MAX_SIZE");
+}
+
+static void
+test_single_file(void)
+{
+   int err;
+
+   /* Start from an empty cache directory so nothing is left over from the
+    * per-file tests.
+    */
+   err = rmrf_local(CACHE_TEST_TMP);
+   expect_equal(err, 0, "Removing " CACHE_TEST_TMP " before single file test");
+   mkdir(CACHE_TEST_TMP, 0755);
+
+   setenv("MESA_GLSL_CACHE_SINGLE_FILE", "true", 1);
+   unsetenv("MESA_GLSL_CACHE_MAX_SIZE");
+
+   test_put_and_get();
+
+   unsetenv("MESA_GLSL_CACHE_SINGLE_FILE");
+}
 #endif /* ENABLE_SHADER_CACHE */
 
 int
@@ -507,6 +625,12 @@ main(void)
 
    test_put_key_and_get_key();
 
+   test_get_batch();
+
+   test_lru_eviction();
+
+   test_single_file();
+
    err = rmrf_local(CACHE_TEST_TMP);
    expect_equal(err, 0, "Removing " CACHE_TEST_TMP " again");
 #endif /* ENABLE_SHADER_CACHE */
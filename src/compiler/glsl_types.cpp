@@ -26,16 +26,130 @@
 #include "compiler/glsl/glsl_parser_extras.h"
 #include "glsl_types.h"
 #include "util/hash_table.h"
+#include "util/u_atomic.h"
 #include "util/u_string.h"
 
 
+/**
+ * Hash table of interned types that can be searched without a lock.
+ *
+ * Types are only ever added, with glsl_type::hash_mutex held, and each slot
+ * is published with a release store once it's filled in, so a reader sees
+ * every slot either empty or complete.  When the table grows, the new slot
+ * array is published the same way and the old one is kept until the table
+ * is destroyed, since a reader may still be probing it.
+ */
+struct glsl_type_table_entry {
+   uint32_t hash;
+   const glsl_type *type;
+};
+
+struct glsl_type_table_slots {
+   unsigned size; /**< Always a power of two */
+   struct glsl_type_table_slots *prev;
+   struct glsl_type_table_entry *entries;
+};
+
+struct glsl_type_table {
+   struct glsl_type_table_slots *slots;
+   unsigned num_entries;
+};
+
+typedef bool (*glsl_type_key_equal_func)(const glsl_type *type,
+                                         const void *key);
+
+static const glsl_type *
+type_table_search(glsl_type_table *table, uint32_t hash, const void *key,
+                  glsl_type_key_equal_func equal)
+{
+   glsl_type_table_slots *slots = p_atomic_read(&table->slots);
+   if (slots == NULL)
+      return NULL;
+
+   /* The table is kept at most half full, so this always terminates. */
+   const unsigned mask = slots->size - 1;
+   for (unsigned i = hash & mask; ; i = (i + 1) & mask) {
+      const glsl_type *type = p_atomic_read(&slots->entries[i].type);
+      if (type == NULL)
+         return NULL;
+
+      if (slots->entries[i].hash == hash && equal(type, key))
+         return type;
+   }
+}
+
+static void
+type_table_slots_add(glsl_type_table_slots *slots, uint32_t hash,
+                     const glsl_type *type)
+{
+   const unsigned mask = slots->size - 1;
+   unsigned i = hash & mask;
+   while (slots->entries[i].type != NULL)
+      i = (i + 1) & mask;
+
+   slots->entries[i].hash = hash;
+   p_atomic_set(&slots->entries[i].type, type);
+}
+
+/** Add \p type; the caller holds glsl_type::hash_mutex. */
+static void
+type_table_insert(glsl_type_table *table, uint32_t hash, const glsl_type *type)
+{
+   glsl_type_table_slots *old = table->slots;
+
+   if (old == NULL || (table->num_entries + 1) * 2 > old->size) {
+      glsl_type_table_slots *slots =
+         (glsl_type_table_slots *) malloc(sizeof(*slots));
+      slots->size = old ? old->size * 2 : 64;
+      slots->prev = old;
+      slots->entries = (glsl_type_table_entry *)
+         calloc(slots->size, sizeof(*slots->entries));
+
+      if (old != NULL) {
+         for (unsigned i = 0; i < old->size; i++) {
+            if (old->entries[i].type != NULL) {
+               type_table_slots_add(slots, old->entries[i].hash,
+                                    old->entries[i].type);
+            }
+         }
+      }
+
+      p_atomic_set(&table->slots, slots);
+   }
+
+   type_table_slots_add(table->slots, hash, type);
+   table->num_entries++;
+}
+
+/** Delete every type and the table storage; only called with no users. */
+static void
+type_table_destroy(glsl_type_table *table)
+{
+   glsl_type_table_slots *slots = table->slots;
+
+   if (slots != NULL) {
+      for (unsigned i = 0; i < slots->size; i++)
+         delete slots->entries[i].type;
+   }
+
+   while (slots != NULL) {
+      glsl_type_table_slots *prev = slots->prev;
+      free(slots->entries);
+      free(slots);
+      slots = prev;
+   }
+
+   table->slots = NULL;
+   table->num_entries = 0;
+}
+
 mtx_t glsl_type::hash_mutex = _MTX_INITIALIZER_NP;
-hash_table *glsl_type::explicit_matrix_types = NULL;
-hash_table *glsl_type::array_types = NULL;
-hash_table *glsl_type::struct_types = NULL;
-hash_table *glsl_type::interface_types = NULL;
-hash_table *glsl_type::function_types = NULL;
-hash_table *glsl_type::subroutine_types = NULL;
+glsl_type_table glsl_type::explicit_matrix_types;
+glsl_type_table glsl_type::array_types;
+glsl_type_table glsl_type::struct_types;
+glsl_type_table glsl_type::interface_types;
+glsl_type_table glsl_type::function_types;
+glsl_type_table glsl_type::subroutine_types;
 
 /* There might be multiple users for types (e.g. application using OpenGL
  * and Vulkan simultanously or app using multiple Vulkan instances). Counter
@@ -463,17 +577,6 @@ const glsl_type *glsl_type::get_bare_type() const
 }
 
 
-static void
-hash_free_type_function(struct hash_entry *entry)
-{
-   glsl_type *type = (glsl_type *) entry->data;
-
-   if (type->is_array())
-      free((void*)entry->key);
-
-   delete type;
-}
-
 void
 glsl_type_singleton_init_or_ref()
 {
@@ -494,36 +597,12 @@ glsl_type_singleton_decref()
       return;
    }
 
-   if (glsl_type::explicit_matrix_types != NULL) {
-      _mesa_hash_table_destroy(glsl_type::explicit_matrix_types,
-                               hash_free_type_function);
-      glsl_type::explicit_matrix_types = NULL;
-   }
-
-   if (glsl_type::array_types != NULL) {
-      _mesa_hash_table_destroy(glsl_type::array_types, hash_free_type_function);
-      glsl_type::array_types = NULL;
-   }
-
-   if (glsl_type::struct_types != NULL) {
-      _mesa_hash_table_destroy(glsl_type::struct_types, hash_free_type_function);
-      glsl_type::struct_types = NULL;
-   }
-
-   if (glsl_type::interface_types != NULL) {
-      _mesa_hash_table_destroy(glsl_type::interface_types, hash_free_type_function);
-      glsl_type::interface_types = NULL;
-   }
-
-   if (glsl_type::function_types != NULL) {
-      _mesa_hash_table_destroy(glsl_type::function_types, hash_free_type_function);
-      glsl_type::function_types = NULL;
-   }
-
-   if (glsl_type::subroutine_types != NULL) {
-      _mesa_hash_table_destroy(glsl_type::subroutine_types, hash_free_type_function);
-      glsl_type::subroutine_types = NULL;
-   }
+   type_table_destroy(&glsl_type::explicit_matrix_types);
+   type_table_destroy(&glsl_type::array_types);
+   type_table_destroy(&glsl_type::struct_types);
+   type_table_destroy(&glsl_type::interface_types);
+   type_table_destroy(&glsl_type::function_types);
+   type_table_destroy(&glsl_type::subroutine_types);
 
    mtx_unlock(&glsl_type::hash_mutex);
 }
@@ -616,6 +695,24 @@ VECN(components, uint16_t, u16vec)
 VECN(components, int8_t, i8vec)
 VECN(components, uint8_t, u8vec)
 
+struct explicit_matrix_key {
+   const glsl_type *bare_type;
+   unsigned explicit_stride;
+   unsigned row_major;
+};
+
+static bool
+explicit_matrix_key_equal(const glsl_type *type, const void *key)
+{
+   const explicit_matrix_key *k = (const explicit_matrix_key *) key;
+
+   return type->base_type == k->bare_type->base_type &&
+          type->vector_elements == k->bare_type->vector_elements &&
+          type->matrix_columns == k->bare_type->matrix_columns &&
+          type->explicit_stride == k->explicit_stride &&
+          type->interface_row_major == k->row_major;
+}
+
 const glsl_type *
 glsl_type::get_instance(unsigned base_type, unsigned rows, unsigned columns,
                         unsigned explicit_stride, bool row_major)
@@ -633,39 +730,39 @@ glsl_type::get_instance(unsigned base_type, unsigned rows, unsigned columns,
 
       assert(columns > 1 || !row_major);
 
-      char name[128];
-      snprintf(name, sizeof(name), "%sx%uB%s", bare_type->name,
-               explicit_stride, row_major ? "RM" : "");
-
-      mtx_lock(&glsl_type::hash_mutex);
-      assert(glsl_type_users > 0);
-
-      if (explicit_matrix_types == NULL) {
-         explicit_matrix_types =
-            _mesa_hash_table_create(NULL, _mesa_key_hash_string,
-                                    _mesa_key_string_equal);
-      }
-
-      const struct hash_entry *entry =
-         _mesa_hash_table_search(explicit_matrix_types, name);
-      if (entry == NULL) {
-         const glsl_type *t = new glsl_type(bare_type->gl_type,
-                                            (glsl_base_type)base_type,
-                                            rows, columns, name,
-                                            explicit_stride, row_major);
+      const explicit_matrix_key key = {
+         bare_type, explicit_stride, row_major
+      };
+      const uint32_t hash = _mesa_hash_data(&key, sizeof(key));
+
+      const glsl_type *t = type_table_search(&explicit_matrix_types, hash,
+                                             &key, explicit_matrix_key_equal);
+      if (t == NULL) {
+         mtx_lock(&glsl_type::hash_mutex);
+         assert(glsl_type_users > 0);
+
+         t = type_table_search(&explicit_matrix_types, hash, &key,
+                               explicit_matrix_key_equal);
+         if (t == NULL) {
+            char name[128];
+            snprintf(name, sizeof(name), "%sx%uB%s", bare_type->name,
+                     explicit_stride, row_major ? "RM" : "");
+
+            t = new glsl_type(bare_type->gl_type, (glsl_base_type)base_type,
+                              rows, columns, name,
+                              explicit_stride, row_major);
+            type_table_insert(&explicit_matrix_types, hash, t);
+         }
 
-         entry = _mesa_hash_table_insert(explicit_matrix_types,
-                                         t->name, (void *)t);
+         mtx_unlock(&glsl_type::hash_mutex);
       }
 
-      assert(((glsl_type *) entry->data)->base_type == base_type);
-      assert(((glsl_type *) entry->data)->vector_elements == rows);
-      assert(((glsl_type *) entry->data)->matrix_columns == columns);
-      assert(((glsl_type *) entry->data)->explicit_stride == explicit_stride);
+      assert(t->base_type == base_type);
+      assert(t->vector_elements == rows);
+      assert(t->matrix_columns == columns);
+      assert(t->explicit_stride == explicit_stride);
 
-      mtx_unlock(&glsl_type::hash_mutex);
-
-      return (const glsl_type *) entry->data;
+      return t;
    }
 
    assert(!row_major);
@@ -989,44 +1086,54 @@ glsl_type::get_image_instance(enum glsl_sampler_dim dim,
    unreachable("switch statement above should be complete");
 }
 
+struct array_key {
+   const glsl_type *base;
+   unsigned length;
+   unsigned explicit_stride;
+};
+
+static bool
+array_key_equal(const glsl_type *type, const void *key)
+{
+   const array_key *k = (const array_key *) key;
+
+   return type->fields.array == k->base &&
+          type->length == k->length &&
+          type->explicit_stride == k->explicit_stride;
+}
+
 const glsl_type *
 glsl_type::get_array_instance(const glsl_type *base,
                               unsigned array_size,
                               unsigned explicit_stride)
 {
-   /* Generate a name using the base type pointer in the key.  This is
-    * done because the name of the base type may not be unique across
-    * shaders.  For example, two shaders may have different record types
-    * named 'foo'.
+   /* Key on the base type pointer rather than its name.  This is done
+    * because the name of the base type may not be unique across shaders.
+    * For example, two shaders may have different record types named 'foo'.
     */
-   char key[128];
-   snprintf(key, sizeof(key), "%p[%u]x%uB", (void *) base, array_size,
-            explicit_stride);
+   const array_key key = { base, array_size, explicit_stride };
+   const uint32_t hash = _mesa_hash_data(&key, sizeof(key));
 
-   mtx_lock(&glsl_type::hash_mutex);
-   assert(glsl_type_users > 0);
-
-   if (array_types == NULL) {
-      array_types = _mesa_hash_table_create(NULL, _mesa_key_hash_string,
-                                            _mesa_key_string_equal);
-   }
+   const glsl_type *t = type_table_search(&array_types, hash, &key,
+                                          array_key_equal);
+   if (t == NULL) {
+      mtx_lock(&glsl_type::hash_mutex);
+      assert(glsl_type_users > 0);
 
-   const struct hash_entry *entry = _mesa_hash_table_search(array_types, key);
-   if (entry == NULL) {
-      const glsl_type *t = new glsl_type(base, array_size, explicit_stride);
+      t = type_table_search(&array_types, hash, &key, array_key_equal);
+      if (t == NULL) {
+         t = new glsl_type(base, array_size, explicit_stride);
+         type_table_insert(&array_types, hash, t);
+      }
 
-      entry = _mesa_hash_table_insert(array_types,
-                                      strdup(key),
-                                      (void *) t);
+      mtx_unlock(&glsl_type::hash_mutex);
    }
 
-   assert(((glsl_type *) entry->data)->base_type == GLSL_TYPE_ARRAY);
-   assert(((glsl_type *) entry->data)->length == array_size);
-   assert(((glsl_type *) entry->data)->fields.array == base);
+   assert(t->base_type == GLSL_TYPE_ARRAY);
+   assert(t->length == array_size);
+   assert(t->fields.array == base);
 
-   mtx_unlock(&glsl_type::hash_mutex);
-
-   return (glsl_type *) entry->data;
+   return t;
 }
 
 bool
@@ -1162,9 +1269,8 @@ glsl_type::record_compare(const glsl_type *b, bool match_name,
 
 
 bool
-glsl_type::record_key_compare(const void *a, const void *b)
+glsl_type::record_key_compare(const glsl_type *key1, const void *b)
 {
-   const glsl_type *const key1 = (glsl_type *) a;
    const glsl_type *const key2 = (glsl_type *) b;
 
    return strcmp(key1->name, key2->name) == 0 &&
@@ -1203,31 +1309,29 @@ glsl_type::get_struct_instance(const glsl_struct_field *fields,
                                bool packed)
 {
    const glsl_type key(fields, num_fields, name, packed);
+   const uint32_t hash = record_key_hash(&key);
 
-   mtx_lock(&glsl_type::hash_mutex);
-   assert(glsl_type_users > 0);
-
-   if (struct_types == NULL) {
-      struct_types = _mesa_hash_table_create(NULL, record_key_hash,
-                                             record_key_compare);
-   }
+   const glsl_type *t = type_table_search(&struct_types, hash, &key,
+                                          record_key_compare);
+   if (t == NULL) {
+      mtx_lock(&glsl_type::hash_mutex);
+      assert(glsl_type_users > 0);
 
-   const struct hash_entry *entry = _mesa_hash_table_search(struct_types,
-                                                            &key);
-   if (entry == NULL) {
-      const glsl_type *t = new glsl_type(fields, num_fields, name, packed);
+      t = type_table_search(&struct_types, hash, &key, record_key_compare);
+      if (t == NULL) {
+         t = new glsl_type(fields, num_fields, name, packed);
+         type_table_insert(&struct_types, hash, t);
+      }
 
-      entry = _mesa_hash_table_insert(struct_types, t, (void *) t);
+      mtx_unlock(&glsl_type::hash_mutex);
    }
 
-   assert(((glsl_type *) entry->data)->base_type == GLSL_TYPE_STRUCT);
-   assert(((glsl_type *) entry->data)->length == num_fields);
-   assert(strcmp(((glsl_type *) entry->data)->name, name) == 0);
-   assert(((glsl_type *) entry->data)->packed == packed);
-
-   mtx_unlock(&glsl_type::hash_mutex);
+   assert(t->base_type == GLSL_TYPE_STRUCT);
+   assert(t->length == num_fields);
+   assert(strcmp(t->name, name) == 0);
+   assert(t->packed == packed);
 
-   return (glsl_type *) entry->data;
+   return t;
 }
 
 
@@ -1239,67 +1343,62 @@ glsl_type::get_interface_instance(const glsl_struct_field *fields,
                                   const char *block_name)
 {
    const glsl_type key(fields, num_fields, packing, row_major, block_name);
+   const uint32_t hash = record_key_hash(&key);
 
-   mtx_lock(&glsl_type::hash_mutex);
-   assert(glsl_type_users > 0);
-
-   if (interface_types == NULL) {
-      interface_types = _mesa_hash_table_create(NULL, record_key_hash,
-                                                record_key_compare);
-   }
+   const glsl_type *t = type_table_search(&interface_types, hash, &key,
+                                          record_key_compare);
+   if (t == NULL) {
+      mtx_lock(&glsl_type::hash_mutex);
+      assert(glsl_type_users > 0);
 
-   const struct hash_entry *entry = _mesa_hash_table_search(interface_types,
-                                                            &key);
-   if (entry == NULL) {
-      const glsl_type *t = new glsl_type(fields, num_fields,
-                                         packing, row_major, block_name);
+      t = type_table_search(&interface_types, hash, &key, record_key_compare);
+      if (t == NULL) {
+         t = new glsl_type(fields, num_fields,
+                           packing, row_major, block_name);
+         type_table_insert(&interface_types, hash, t);
+      }
 
-      entry = _mesa_hash_table_insert(interface_types, t, (void *) t);
+      mtx_unlock(&glsl_type::hash_mutex);
    }
 
-   assert(((glsl_type *) entry->data)->base_type == GLSL_TYPE_INTERFACE);
-   assert(((glsl_type *) entry->data)->length == num_fields);
-   assert(strcmp(((glsl_type *) entry->data)->name, block_name) == 0);
-
-   mtx_unlock(&glsl_type::hash_mutex);
+   assert(t->base_type == GLSL_TYPE_INTERFACE);
+   assert(t->length == num_fields);
+   assert(strcmp(t->name, block_name) == 0);
 
-   return (glsl_type *) entry->data;
+   return t;
 }
 
 const glsl_type *
 glsl_type::get_subroutine_instance(const char *subroutine_name)
 {
    const glsl_type key(subroutine_name);
+   const uint32_t hash = record_key_hash(&key);
 
-   mtx_lock(&glsl_type::hash_mutex);
-   assert(glsl_type_users > 0);
-
-   if (subroutine_types == NULL) {
-      subroutine_types = _mesa_hash_table_create(NULL, record_key_hash,
-                                                 record_key_compare);
-   }
+   const glsl_type *t = type_table_search(&subroutine_types, hash, &key,
+                                          record_key_compare);
+   if (t == NULL) {
+      mtx_lock(&glsl_type::hash_mutex);
+      assert(glsl_type_users > 0);
 
-   const struct hash_entry *entry = _mesa_hash_table_search(subroutine_types,
-                                                            &key);
-   if (entry == NULL) {
-      const glsl_type *t = new glsl_type(subroutine_name);
+      t = type_table_search(&subroutine_types, hash, &key, record_key_compare);
+      if (t == NULL) {
+         t = new glsl_type(subroutine_name);
+         type_table_insert(&subroutine_types, hash, t);
+      }
 
-      entry = _mesa_hash_table_insert(subroutine_types, t, (void *) t);
+      mtx_unlock(&glsl_type::hash_mutex);
    }
 
-   assert(((glsl_type *) entry->data)->base_type == GLSL_TYPE_SUBROUTINE);
-   assert(strcmp(((glsl_type *) entry->data)->name, subroutine_name) == 0);
-
-   mtx_unlock(&glsl_type::hash_mutex);
+   assert(t->base_type == GLSL_TYPE_SUBROUTINE);
+   assert(strcmp(t->name, subroutine_name) == 0);
 
-   return (glsl_type *) entry->data;
+   return t;
 }
 
 
 static bool
-function_key_compare(const void *a, const void *b)
+function_key_compare(const glsl_type *key1, const void *b)
 {
-   const glsl_type *const key1 = (glsl_type *) a;
    const glsl_type *const key2 = (glsl_type *) b;
 
    if (key1->length != key2->length)
@@ -1318,35 +1417,33 @@ function_key_hash(const void *a)
                           (key->length + 1) * sizeof(*key->fields.parameters));
 }
 
+
 const glsl_type *
 glsl_type::get_function_instance(const glsl_type *return_type,
                                  const glsl_function_param *params,
                                  unsigned num_params)
 {
    const glsl_type key(return_type, params, num_params);
+   const uint32_t hash = function_key_hash(&key);
 
-   mtx_lock(&glsl_type::hash_mutex);
-   assert(glsl_type_users > 0);
-
-   if (function_types == NULL) {
-      function_types = _mesa_hash_table_create(NULL, function_key_hash,
-                                               function_key_compare);
-   }
+   const glsl_type *t = type_table_search(&function_types, hash, &key,
+                                          function_key_compare);
+   if (t == NULL) {
+      mtx_lock(&glsl_type::hash_mutex);
+      assert(glsl_type_users > 0);
 
-   struct hash_entry *entry = _mesa_hash_table_search(function_types, &key);
-   if (entry == NULL) {
-      const glsl_type *t = new glsl_type(return_type, params, num_params);
+      t = type_table_search(&function_types, hash, &key, function_key_compare);
+      if (t == NULL) {
+         t = new glsl_type(return_type, params, num_params);
+         type_table_insert(&function_types, hash, t);
+      }
 
-      entry = _mesa_hash_table_insert(function_types, t, (void *) t);
+      mtx_unlock(&glsl_type::hash_mutex);
    }
 
-   const glsl_type *t = (const glsl_type *)entry->data;
-
    assert(t->base_type == GLSL_TYPE_FUNCTION);
    assert(t->length == num_params);
 
-   mtx_unlock(&glsl_type::hash_mutex);
-
    return t;
 }
 
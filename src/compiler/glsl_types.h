@@ -242,6 +242,8 @@ enum {
 #include "util/ralloc.h"
 #include "main/menums.h" /* for gl_texture_index, C++'s enum rules are broken */
 
+struct glsl_type_table;
+
 struct glsl_type {
    GLenum gl_type;
    glsl_base_type base_type:8;
@@ -1128,24 +1130,24 @@ private:
    glsl_type(const char *name);
 
    /** Hash table containing the known explicit matrix and vector types. */
-   static struct hash_table *explicit_matrix_types;
+   static struct glsl_type_table explicit_matrix_types;
 
    /** Hash table containing the known array types. */
-   static struct hash_table *array_types;
+   static struct glsl_type_table array_types;
 
    /** Hash table containing the known struct types. */
-   static struct hash_table *struct_types;
+   static struct glsl_type_table struct_types;
 
    /** Hash table containing the known interface types. */
-   static struct hash_table *interface_types;
+   static struct glsl_type_table interface_types;
 
    /** Hash table containing the known subroutine types. */
-   static struct hash_table *subroutine_types;
+   static struct glsl_type_table subroutine_types;
 
    /** Hash table containing the known function types. */
-   static struct hash_table *function_types;
+   static struct glsl_type_table function_types;
 
-   static bool record_key_compare(const void *a, const void *b);
+   static bool record_key_compare(const glsl_type *a, const void *b);
    static unsigned record_key_hash(const void *key);
 
    /**
@@ -28,6 +28,7 @@
 #include "nir.h"
 #include "nir_builder.h"
 #include "nir_control_flow_private.h"
+#include "util/debug.h"
 #include "util/half_float.h"
 #include <limits.h>
 #include <assert.h>
@@ -67,6 +68,16 @@ nir_shader_create(void *mem_ctx,
    shader->num_uniforms = 0;
    shader->num_shared = 0;
 
+   if ((options && options->use_instr_arena) ||
+       env_var_as_boolean("NIR_INSTR_ARENA", false))
+      shader->instr_arena = linear_alloc_parent(shader, 0);
+
+   if ((options && options->skip_clean_passes) ||
+       env_var_as_boolean("NIR_SKIP_CLEAN_PASSES", false))
+      shader->pass_generations = _mesa_pointer_hash_table_create(shader);
+   shader->generation = 1;
+   shader->pass_stats = nir_pass_stats_enabled();
+
    return shader;
 }
 
@@ -216,7 +227,7 @@ void nir_src_copy(nir_src *dest, const nir_src *src, void *mem_ctx)
       dest->reg.base_offset = src->reg.base_offset;
       dest->reg.reg = src->reg.reg;
       if (src->reg.indirect) {
-         dest->reg.indirect = ralloc(mem_ctx, nir_src);
+         dest->reg.indirect = nir_src_alloc_indirect(src->reg.reg);
          nir_src_copy(dest->reg.indirect, src->reg.indirect, mem_ctx);
       } else {
          dest->reg.indirect = NULL;
@@ -234,7 +245,7 @@ void nir_dest_copy(nir_dest *dest, const nir_dest *src, nir_instr *instr)
    dest->reg.base_offset = src->reg.base_offset;
    dest->reg.reg = src->reg.reg;
    if (src->reg.indirect) {
-      dest->reg.indirect = ralloc(instr, nir_src);
+      dest->reg.indirect = nir_src_alloc_indirect(src->reg.reg);
       nir_src_copy(dest->reg.indirect, src->reg.indirect, instr);
    } else {
       dest->reg.indirect = NULL;
@@ -388,6 +399,53 @@ nir_loop_create(nir_shader *shader)
    return loop;
 }
 
+/**
+ * Allocates an instruction.  Ones from the shader's arena are preceded by
+ * a pointer to it, so that the memory they own can come from there too.
+ */
+static void *
+instr_alloc(nir_shader *shader, size_t size, bool zero)
+{
+   nir_instr *instr;
+
+   if (shader->instr_arena) {
+      void **mem = linear_zalloc_child(shader->instr_arena,
+                                       sizeof(void *) + size);
+      mem[0] = shader->instr_arena;
+      instr = (nir_instr *)&mem[1];
+      instr->from_arena = true;
+   } else {
+      instr = zero ? rzalloc_size(shader, size) : ralloc_size(shader, size);
+      instr->from_arena = false;
+   }
+
+   return instr;
+}
+
+static inline void *
+instr_arena(const nir_instr *instr)
+{
+   assert(instr->from_arena);
+   return ((void **)instr)[-1];
+}
+
+void *
+nir_instr_alloc_data(nir_instr *instr, size_t size)
+{
+   if (instr->from_arena)
+      return linear_alloc_child(instr_arena(instr), size);
+   else
+      return ralloc_size(instr, size);
+}
+
+void
+nir_instr_free(nir_instr *instr)
+{
+   /* Arena memory is only reclaimed by nir_sweep() */
+   if (!instr->from_arena)
+      ralloc_free(instr);
+}
+
 static void
 instr_init(nir_instr *instr, nir_instr_type type)
 {
@@ -428,8 +486,8 @@ nir_alu_instr_create(nir_shader *shader, nir_op op)
    unsigned num_srcs = nir_op_infos[op].num_inputs;
    /* TODO: don't use rzalloc */
    nir_alu_instr *instr =
-      rzalloc_size(shader,
-                   sizeof(nir_alu_instr) + num_srcs * sizeof(nir_alu_src));
+      instr_alloc(shader,
+                  sizeof(nir_alu_instr) + num_srcs * sizeof(nir_alu_src), true);
 
    instr_init(&instr->instr, nir_instr_type_alu);
    instr->op = op;
@@ -444,7 +502,7 @@ nir_deref_instr *
 nir_deref_instr_create(nir_shader *shader, nir_deref_type deref_type)
 {
    nir_deref_instr *instr =
-      rzalloc_size(shader, sizeof(nir_deref_instr));
+      instr_alloc(shader, sizeof(nir_deref_instr), true);
 
    instr_init(&instr->instr, nir_instr_type_deref);
 
@@ -464,7 +522,7 @@ nir_deref_instr_create(nir_shader *shader, nir_deref_type deref_type)
 nir_jump_instr *
 nir_jump_instr_create(nir_shader *shader, nir_jump_type type)
 {
-   nir_jump_instr *instr = ralloc(shader, nir_jump_instr);
+   nir_jump_instr *instr = instr_alloc(shader, sizeof(*instr), false);
    instr_init(&instr->instr, nir_instr_type_jump);
    instr->type = type;
    return instr;
@@ -475,7 +533,8 @@ nir_load_const_instr_create(nir_shader *shader, unsigned num_components,
                             unsigned bit_size)
 {
    nir_load_const_instr *instr =
-      rzalloc_size(shader, sizeof(*instr) + num_components * sizeof(*instr->value));
+      instr_alloc(shader, sizeof(*instr) + num_components * sizeof(*instr->value),
+                  true);
    instr_init(&instr->instr, nir_instr_type_load_const);
 
    nir_ssa_def_init(&instr->instr, &instr->def, num_components, bit_size, NULL);
@@ -489,8 +548,8 @@ nir_intrinsic_instr_create(nir_shader *shader, nir_intrinsic_op op)
    unsigned num_srcs = nir_intrinsic_infos[op].num_srcs;
    /* TODO: don't use rzalloc */
    nir_intrinsic_instr *instr =
-      rzalloc_size(shader,
-                  sizeof(nir_intrinsic_instr) + num_srcs * sizeof(nir_src));
+      instr_alloc(shader,
+                  sizeof(nir_intrinsic_instr) + num_srcs * sizeof(nir_src), true);
 
    instr_init(&instr->instr, nir_instr_type_intrinsic);
    instr->intrinsic = op;
@@ -509,8 +568,8 @@ nir_call_instr_create(nir_shader *shader, nir_function *callee)
 {
    const unsigned num_params = callee->num_params;
    nir_call_instr *instr =
-      rzalloc_size(shader, sizeof(*instr) +
-                   num_params * sizeof(instr->params[0]));
+      instr_alloc(shader, sizeof(*instr) +
+                  num_params * sizeof(instr->params[0]), true);
 
    instr_init(&instr->instr, nir_instr_type_call);
    instr->callee = callee;
@@ -532,13 +591,14 @@ static int8_t default_tg4_offsets[4][2] =
 nir_tex_instr *
 nir_tex_instr_create(nir_shader *shader, unsigned num_srcs)
 {
-   nir_tex_instr *instr = rzalloc(shader, nir_tex_instr);
+   nir_tex_instr *instr = instr_alloc(shader, sizeof(*instr), true);
    instr_init(&instr->instr, nir_instr_type_tex);
 
    dest_init(&instr->dest);
 
    instr->num_srcs = num_srcs;
-   instr->src = ralloc_array(instr, nir_tex_src, num_srcs);
+   instr->src = nir_instr_alloc_data(&instr->instr,
+                                     num_srcs * sizeof(nir_tex_src));
    for (unsigned i = 0; i < num_srcs; i++)
       src_init(&instr->src[i].src);
 
@@ -555,8 +615,10 @@ nir_tex_instr_add_src(nir_tex_instr *tex,
                       nir_tex_src_type src_type,
                       nir_src src)
 {
-   nir_tex_src *new_srcs = rzalloc_array(tex, nir_tex_src,
-                                         tex->num_srcs + 1);
+   nir_tex_src *new_srcs =
+      nir_instr_alloc_data(&tex->instr,
+                           (tex->num_srcs + 1) * sizeof(nir_tex_src));
+   memset(new_srcs, 0, (tex->num_srcs + 1) * sizeof(nir_tex_src));
 
    for (unsigned i = 0; i < tex->num_srcs; i++) {
       new_srcs[i].src_type = tex->src[i].src_type;
@@ -564,7 +626,8 @@ nir_tex_instr_add_src(nir_tex_instr *tex,
                          &tex->src[i].src);
    }
 
-   ralloc_free(tex->src);
+   if (!tex->instr.from_arena)
+      ralloc_free(tex->src);
    tex->src = new_srcs;
 
    tex->src[tex->num_srcs].src_type = src_type;
@@ -600,7 +663,7 @@ nir_tex_instr_has_explicit_tg4_offsets(nir_tex_instr *tex)
 nir_phi_instr *
 nir_phi_instr_create(nir_shader *shader)
 {
-   nir_phi_instr *instr = ralloc(shader, nir_phi_instr);
+   nir_phi_instr *instr = instr_alloc(shader, sizeof(*instr), false);
    instr_init(&instr->instr, nir_instr_type_phi);
 
    dest_init(&instr->dest);
@@ -611,7 +674,7 @@ nir_phi_instr_create(nir_shader *shader)
 nir_parallel_copy_instr *
 nir_parallel_copy_instr_create(nir_shader *shader)
 {
-   nir_parallel_copy_instr *instr = ralloc(shader, nir_parallel_copy_instr);
+   nir_parallel_copy_instr *instr = instr_alloc(shader, sizeof(*instr), false);
    instr_init(&instr->instr, nir_instr_type_parallel_copy);
 
    exec_list_make_empty(&instr->entries);
@@ -624,7 +687,7 @@ nir_ssa_undef_instr_create(nir_shader *shader,
                            unsigned num_components,
                            unsigned bit_size)
 {
-   nir_ssa_undef_instr *instr = ralloc(shader, nir_ssa_undef_instr);
+   nir_ssa_undef_instr *instr = instr_alloc(shader, sizeof(*instr), false);
    instr_init(&instr->instr, nir_instr_type_ssa_undef);
 
    nir_ssa_def_init(&instr->instr, &instr->def, num_components, bit_size, NULL);
@@ -1441,7 +1504,10 @@ nir_ssa_def_init(nir_instr *instr, nir_ssa_def *def,
                  unsigned num_components,
                  unsigned bit_size, const char *name)
 {
-   def->name = ralloc_strdup(instr, name);
+   if (instr->from_arena)
+      def->name = linear_strdup(instr_arena(instr), name);
+   else
+      def->name = ralloc_strdup(instr, name);
    def->parent_instr = instr;
    list_inithead(&def->uses);
    list_inithead(&def->if_uses);
@@ -1473,6 +1539,24 @@ nir_ssa_def_rewrite_uses(nir_ssa_def *def, nir_src new_src)
 {
    assert(!new_src.is_ssa || def != new_src.ssa);
 
+   /* If the new source is also an SSA value, the uses keep their parents and
+    * only change which def they point at, so we can retarget them in place
+    * and hand the whole use lists over in one go instead of unlinking and
+    * relinking every source.
+    */
+   if (new_src.is_ssa) {
+      nir_foreach_use(use_src, def)
+         use_src->ssa = new_src.ssa;
+      nir_foreach_if_use(use_src, def)
+         use_src->ssa = new_src.ssa;
+
+      list_splicetail(&def->uses, &new_src.ssa->uses);
+      list_inithead(&def->uses);
+      list_splicetail(&def->if_uses, &new_src.ssa->if_uses);
+      list_inithead(&def->if_uses);
+      return;
+   }
+
    nir_foreach_use_safe(use_src, def)
       nir_instr_rewrite_src(use_src->parent_instr, use_src, new_src);
 
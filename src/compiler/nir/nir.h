@@ -608,6 +608,9 @@ typedef struct nir_instr {
     */
    uint8_t pass_flags;
 
+   /** Whether this was allocated from the shader's instruction arena */
+   bool from_arena;
+
    /** generic instruction index. */
    unsigned index;
 } nir_instr;
@@ -819,6 +822,13 @@ nir_dest_num_components(nir_dest dest)
    return dest.is_ssa ? dest.ssa.num_components : dest.reg.reg->num_components;
 }
 
+/** Allocates an indirect source for an access to reg, owned by the shader */
+static inline nir_src *
+nir_src_alloc_indirect(nir_register *reg)
+{
+   return ralloc(ralloc_parent(reg), nir_src);
+}
+
 void nir_src_copy(nir_src *dest, const nir_src *src, void *instr_or_if);
 void nir_dest_copy(nir_dest *dest, const nir_dest *src, nir_instr *instr);
 
@@ -2265,6 +2275,11 @@ typedef struct {
    /* Unroll the loop regardless of its size */
    bool force_unroll;
 
+   /* A branch in the loop depends on a value that is only different on the
+    * first iteration, so peeling that iteration lets the branch fold away.
+    */
+   bool peel_first_iteration;
+
    /* Does the loop contain complex loop terminators, continues or other
     * complex behaviours? If this is true we can't rely on
     * loop_terminator_list to be complete or accurate.
@@ -2682,8 +2697,41 @@ typedef struct nir_shader_compiler_options {
 
    unsigned max_unroll_iterations;
 
+   /**
+    * Largest factor nir_opt_loop_unroll() may partially unroll a loop by
+    * when its trip count is known but too large to unroll it fully.  The
+    * unrolled body is held to the same size budget as a full unroll.  Zero
+    * or one disables partial unrolling.
+    */
+   unsigned max_partial_unroll_factor;
+
+   /**
+    * Let nir_opt_loop_unroll() peel the first iteration off loops that loop
+    * analysis flags with nir_loop_info::peel_first_iteration.
+    */
+   bool peel_loop_first_iteration;
+
    nir_lower_int64_options lower_int64_options;
    nir_lower_doubles_options lower_doubles_options;
+
+   /**
+    * Allocate instructions from a per-shader linear arena instead of
+    * giving each its own ralloc context.  See nir_shader::instr_arena.
+    */
+   bool use_instr_arena;
+
+   /**
+    * Let NIR_PASS() skip a pass when the shader hasn't changed since that
+    * call site last ran it without making progress.  See nir_pass_begin().
+    */
+   bool skip_clean_passes;
+
+   /**
+    * Number of SSA values nir_opt_gcm() lets be live across a loop or into
+    * a block before it stops moving instructions there.  If zero, the
+    * highest pressure already found in the function is used.
+    */
+   unsigned gcm_max_live_values;
 } nir_shader_compiler_options;
 
 typedef struct nir_shader {
@@ -2733,6 +2781,31 @@ typedef struct nir_shader {
     */
    void *constant_data;
    unsigned constant_data_size;
+
+   /** Linear allocator the instructions come from, or NULL.
+    *
+    * Instructions, their sources, phi sources and SSA def names are then
+    * bump-allocated from it, and are only freed with the shader or when
+    * nir_sweep() compacts it into a fresh arena.  They can't be used as
+    * ralloc contexts; use nir_instr_alloc_data() and nir_instr_free().
+    */
+   void *instr_arena;
+
+   /**
+    * When clean passes are skipped, this maps each NIR_PASS() call site to
+    * the generation the shader was at after that site's last run without
+    * progress.  NULL otherwise.
+    */
+   struct hash_table *pass_generations;
+
+   /**
+    * Bumped whenever the shader may have changed: a pass reported progress
+    * or something invalidated metadata with nir_metadata_preserve().
+    */
+   unsigned generation;
+
+   /** Whether NIR_PASS() records time and size statistics for this shader */
+   bool pass_stats;
 } nir_shader;
 
 #define nir_foreach_function(func, shader) \
@@ -2836,6 +2909,12 @@ nir_ssa_undef_instr *nir_ssa_undef_instr_create(nir_shader *shader,
                                                 unsigned num_components,
                                                 unsigned bit_size);
 
+/** Allocates memory that lives as long as the instruction, e.g. phi sources */
+void *nir_instr_alloc_data(nir_instr *instr, size_t size);
+
+/** Frees an instruction which was removed, or never inserted */
+void nir_instr_free(nir_instr *instr);
+
 nir_const_value nir_alu_binop_identity(nir_op binop, unsigned bit_size);
 
 /**
@@ -3278,6 +3357,60 @@ static inline bool should_serialize_deserialize_nir(void) { return false; }
 static inline bool should_print_nir(void) { return false; }
 #endif /* NDEBUG */
 
+/** A NIR_PASS() call site, along with its statistics */
+typedef struct nir_pass_site {
+   const char *name;
+   unsigned runs;
+   unsigned progress;
+   unsigned skips;
+   uint64_t time_ns;
+   uint64_t instrs_before, instrs_after;
+   uint64_t blocks_before, blocks_after;
+   bool registered;
+   struct nir_pass_site *next;
+} nir_pass_site;
+
+/** State carried from nir_pass_begin() to nir_pass_end() */
+typedef struct nir_pass_run {
+   int64_t start_ns;
+   unsigned instrs;
+   unsigned blocks;
+} nir_pass_run;
+
+bool nir_pass_stats_enabled(void);
+bool nir_pass_begin_tracked(nir_shader *shader, nir_pass_site *site,
+                            nir_pass_run *run);
+void nir_pass_end_tracked(nir_shader *shader, nir_pass_site *site,
+                          nir_pass_run *run, bool progress);
+
+/**
+ * Returns false if the pass at this call site can be skipped because it ran
+ * without making progress and nothing has changed since.
+ */
+static inline bool
+nir_pass_begin(nir_shader *shader, nir_pass_site *site, nir_pass_run *run)
+{
+   if (!shader->pass_generations && !shader->pass_stats)
+      return true;
+
+   return nir_pass_begin_tracked(shader, site, run);
+}
+
+/* For NIR_PASS_V, whose shader argument may be a void pointer. */
+static inline void
+nir_shader_mark_changed(nir_shader *shader)
+{
+   shader->generation++;
+}
+
+static inline void
+nir_pass_end(nir_shader *shader, nir_pass_site *site, nir_pass_run *run,
+             bool progress)
+{
+   if (shader->pass_generations || shader->pass_stats)
+      nir_pass_end_tracked(shader, site, run, progress);
+}
+
 #define _PASS(pass, nir, do_pass) do {                               \
    if (should_skip_nir(#pass)) {                                     \
       printf("skipping %s\n", #pass);                                \
@@ -3295,21 +3428,33 @@ static inline bool should_print_nir(void) { return false; }
 } while (0)
 
 #define NIR_PASS(progress, nir, pass, ...) _PASS(pass, nir,          \
+   static nir_pass_site _pass_site = { #pass };                      \
+   nir_pass_run _pass_run;                                           \
+   if (!nir_pass_begin(nir, &_pass_site, &_pass_run))                \
+      break;                                                         \
    nir_metadata_set_validation_flag(nir);                            \
    if (should_print_nir())                                           \
       printf("%s\n", #pass);                                         \
-   if (pass(nir, ##__VA_ARGS__)) {                                   \
+   bool _pass_progress = pass(nir, ##__VA_ARGS__);                   \
+   if (_pass_progress) {                                             \
       progress = true;                                               \
       if (should_print_nir())                                        \
          nir_print_shader(nir, stdout);                              \
       nir_metadata_check_validation_flag(nir);                       \
    }                                                                 \
+   nir_pass_end(nir, &_pass_site, &_pass_run, _pass_progress);       \
 )
 
 #define NIR_PASS_V(nir, pass, ...) _PASS(pass, nir,                  \
+   static nir_pass_site _pass_site = { #pass };                      \
+   nir_pass_run _pass_run;                                           \
+   nir_pass_begin(nir, &_pass_site, &_pass_run);                     \
    if (should_print_nir())                                           \
       printf("%s\n", #pass);                                         \
    pass(nir, ##__VA_ARGS__);                                         \
+   /* Passes that don't report progress always count as changing */  \
+   nir_shader_mark_changed(nir);                                     \
+   nir_pass_end(nir, &_pass_site, &_pass_run, true);                 \
    if (should_print_nir())                                           \
       nir_print_shader(nir, stdout);                                 \
 )
@@ -3982,6 +4127,15 @@ bool nir_opt_large_constants(nir_shader *shader,
                              glsl_type_size_align_func size_align,
                              unsigned threshold);
 
+typedef bool (*nir_should_vectorize_mem_func)(unsigned align, unsigned bit_size,
+                                              unsigned num_components,
+                                              unsigned high_offset,
+                                              nir_intrinsic_instr *low,
+                                              nir_intrinsic_instr *high);
+
+bool nir_opt_load_store_vectorize(nir_shader *shader, nir_variable_mode modes,
+                                  nir_should_vectorize_mem_func callback);
+
 bool nir_opt_loop_unroll(nir_shader *shader, nir_variable_mode indirect_mask);
 
 typedef enum {
@@ -1115,68 +1115,109 @@ static const struct per_op_table ${pass_name}_table[nir_num_search_ops] = {
 };
 
 static void
-${pass_name}_pre_block(nir_block *block, uint16_t *states)
+${pass_name}_label_instr(nir_instr *instr, uint16_t *states)
 {
-   nir_foreach_instr(instr, block) {
-      switch (instr->type) {
-      case nir_instr_type_alu: {
-         nir_alu_instr *alu = nir_instr_as_alu(instr);
-         nir_op op = alu->op;
-         uint16_t search_op = nir_search_op_for_nir_op(op);
-         const struct per_op_table *tbl = &${pass_name}_table[search_op];
-         if (tbl->num_filtered_states == 0)
-            continue;
-
-         /* Calculate the index into the transition table. Note the index
-          * calculated must match the iteration order of Python's
-          * itertools.product(), which was used to emit the transition
-          * table.
-          */
-         uint16_t index = 0;
-         for (unsigned i = 0; i < nir_op_infos[op].num_inputs; i++) {
-            index *= tbl->num_filtered_states;
-            index += tbl->filter[states[alu->src[i].src.ssa->index]];
-         }
-         states[alu->dest.dest.ssa.index] = tbl->table[index];
-         break;
+   switch (instr->type) {
+   case nir_instr_type_alu: {
+      nir_alu_instr *alu = nir_instr_as_alu(instr);
+      nir_op op = alu->op;
+      uint16_t search_op = nir_search_op_for_nir_op(op);
+      const struct per_op_table *tbl = &${pass_name}_table[search_op];
+      if (tbl->num_filtered_states == 0)
+         return;
+
+      /* Calculate the index into the transition table. Note the index
+       * calculated must match the iteration order of Python's
+       * itertools.product(), which was used to emit the transition
+       * table.
+       */
+      uint16_t index = 0;
+      for (unsigned i = 0; i < nir_op_infos[op].num_inputs; i++) {
+         index *= tbl->num_filtered_states;
+         index += tbl->filter[states[alu->src[i].src.ssa->index]];
       }
+      states[alu->dest.dest.ssa.index] = tbl->table[index];
+      break;
+   }
 
-      case nir_instr_type_load_const: {
-         nir_load_const_instr *load_const = nir_instr_as_load_const(instr);
-         states[load_const->def.index] = CONST_STATE;
-         break;
-      }
+   case nir_instr_type_load_const: {
+      nir_load_const_instr *load_const = nir_instr_as_load_const(instr);
+      states[load_const->def.index] = CONST_STATE;
+      break;
+   }
+
+   default:
+      break;
+   }
+}
+
+static void
+${pass_name}_pre_block(nir_block *block, uint16_t *states)
+{
+   nir_foreach_instr(instr, block)
+      ${pass_name}_label_instr(instr, states);
+}
+
+/* Labels the instructions built by a replacement.  They are all inserted
+ * right before the instruction they replace, ending with the final mov, so
+ * they sit between "first" and "last" in the block.
+ */
+static uint16_t *
+${pass_name}_label_replacement(nir_function_impl *impl, uint16_t *states,
+                               unsigned *num_states,
+                               nir_instr *first, nir_instr *last)
+{
+   if (impl->ssa_alloc > *num_states) {
+      unsigned new_num_states = MAX2(impl->ssa_alloc, *num_states * 2);
+      states = realloc(states, new_num_states * sizeof(*states));
+      memset(states + *num_states, 0,
+             (new_num_states - *num_states) * sizeof(*states));
+      *num_states = new_num_states;
+   }
 
-      default:
+   for (nir_instr *instr = first; ; instr = nir_instr_next(instr)) {
+      ${pass_name}_label_instr(instr, states);
+      if (instr == last)
          break;
-      }
    }
+
+   return states;
 }
 
 static bool
 ${pass_name}_block(nir_builder *build, nir_block *block,
-                   const uint16_t *states, const bool *condition_flags)
+                   uint16_t **states, unsigned *num_states,
+                   const bool *condition_flags)
 {
    bool progress = false;
 
-   nir_foreach_instr_reverse_safe(instr, block) {
-      if (instr->type != nir_instr_type_alu)
+   nir_instr *instr = nir_block_last_instr(block);
+   while (instr) {
+      nir_instr *prev = nir_instr_prev(instr);
+
+      if (instr->type != nir_instr_type_alu) {
+         instr = prev;
          continue;
+      }
 
       nir_alu_instr *alu = nir_instr_as_alu(instr);
-      if (!alu->dest.dest.is_ssa)
+      if (!alu->dest.dest.is_ssa) {
+         instr = prev;
          continue;
+      }
 
-      switch (states[alu->dest.dest.ssa.index]) {
+      nir_ssa_def *replacement = NULL;
+      switch ((*states)[alu->dest.dest.ssa.index]) {
 % for i in range(len(automaton.state_patterns)):
       case ${i}:
          % if automaton.state_patterns[i]:
          for (unsigned i = 0; i < ARRAY_SIZE(${pass_name}_state${i}_xforms); i++) {
             const struct transform *xform = &${pass_name}_state${i}_xforms[i];
-            if (condition_flags[xform->condition_offset] &&
-                nir_replace_instr(build, alu, xform->search, xform->replace)) {
-               progress = true;
-               break;
+            if (condition_flags[xform->condition_offset]) {
+               replacement = nir_replace_instr(build, alu, xform->search,
+                                               xform->replace);
+               if (replacement)
+                  break;
             }
          }
          % endif
@@ -1184,6 +1225,23 @@ ${pass_name}_block(nir_builder *build, nir_block *block,
 % endfor
       default: assert(0);
       }
+
+      if (replacement) {
+         /* Label what the replacement built and keep walking backwards from
+          * its last instruction, so that patterns exposed by the rewrite are
+          * matched in this same pass rather than the next time around the
+          * optimization loop.
+          */
+         nir_instr *first = prev ? nir_instr_next(prev) :
+                                   nir_block_first_instr(block);
+         *states = ${pass_name}_label_replacement(build->impl, *states,
+                                                  num_states, first,
+                                                  replacement->parent_instr);
+         prev = replacement->parent_instr;
+         progress = true;
+      }
+
+      instr = prev;
    }
 
    return progress;
@@ -1201,14 +1259,16 @@ ${pass_name}_impl(nir_function_impl *impl, const bool *condition_flags)
     * state 0 is the default state, which means we don't have to visit
     * anything other than constants and ALU instructions.
     */
-   uint16_t *states = calloc(impl->ssa_alloc, sizeof(*states));
+   unsigned num_states = impl->ssa_alloc;
+   uint16_t *states = calloc(num_states, sizeof(*states));
 
    nir_foreach_block(block, impl) {
       ${pass_name}_pre_block(block, states);
    }
 
    nir_foreach_block_reverse(block, impl) {
-      progress |= ${pass_name}_block(&build, block, states, condition_flags);
+      progress |= ${pass_name}_block(&build, block, &states, &num_states,
+                                     condition_flags);
    }
 
    free(states);
@@ -239,7 +239,7 @@ __clone_src(clone_state *state, void *ninstr_or_if,
    } else {
       nsrc->reg.reg = remap_reg(state, src->reg.reg);
       if (src->reg.indirect) {
-         nsrc->reg.indirect = ralloc(ninstr_or_if, nir_src);
+         nsrc->reg.indirect = nir_src_alloc_indirect(nsrc->reg.reg);
          __clone_src(state, ninstr_or_if, nsrc->reg.indirect, src->reg.indirect);
       }
       nsrc->reg.base_offset = src->reg.base_offset;
@@ -258,7 +258,7 @@ __clone_dst(clone_state *state, nir_instr *ninstr,
    } else {
       ndst->reg.reg = remap_reg(state, dst->reg.reg);
       if (dst->reg.indirect) {
-         ndst->reg.indirect = ralloc(ninstr, nir_src);
+         ndst->reg.indirect = nir_src_alloc_indirect(ndst->reg.reg);
          __clone_src(state, ninstr, ndst->reg.indirect, dst->reg.indirect);
       }
       ndst->reg.base_offset = dst->reg.base_offset;
@@ -447,7 +447,7 @@ clone_phi(clone_state *state, const nir_phi_instr *phi, nir_block *nblk)
    nir_instr_insert_after_block(nblk, &nphi->instr);
 
    foreach_list_typed(nir_phi_src, src, node, &phi->srcs) {
-      nir_phi_src *nsrc = ralloc(nphi, nir_phi_src);
+      nir_phi_src *nsrc = nir_instr_alloc_data(&nphi->instr, sizeof(*nsrc));
 
       /* Just copy the old source for now. */
       memcpy(nsrc, src, sizeof(*src));
@@ -778,7 +778,8 @@ nir_shader_clone(void *mem_ctx, const nir_shader *s)
  * will be freed.
  *
  * This should only be used by test code which needs to swap out shaders with
- * a cloned or deserialized version.
+ * a cloned or deserialized version, and by nir_sweep() for instruction
+ * arenas.
  */
 void
 nir_shader_replace(nir_shader *dst, nir_shader *src)
@@ -793,6 +794,10 @@ nir_shader_replace(nir_shader *dst, nir_shader *src)
 
    memcpy(dst, src, sizeof(*dst));
 
+   /* The arena's chunks remember their ralloc parent for new allocations */
+   if (dst->instr_arena)
+      ralloc_steal_linear_parent(dst, dst->instr_arena);
+
    /* We have to move all the linked lists over separately because we need the
     * pointers in the list elements to point to the lists in dst and not src.
     */
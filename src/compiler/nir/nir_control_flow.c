@@ -236,11 +236,11 @@ insert_phi_undef(nir_block *block, nir_block *pred)
 
       nir_phi_instr *phi = nir_instr_as_phi(instr);
       nir_ssa_undef_instr *undef =
-         nir_ssa_undef_instr_create(ralloc_parent(phi),
+         nir_ssa_undef_instr_create(impl->function->shader,
                                     phi->dest.ssa.num_components,
                                     phi->dest.ssa.bit_size);
       nir_instr_insert_before_cf_list(&impl->body, &undef->instr);
-      nir_phi_src *src = ralloc(phi, nir_phi_src);
+      nir_phi_src *src = nir_instr_alloc_data(&phi->instr, sizeof(nir_phi_src));
       src->pred = pred;
       src->src.parent_instr = &phi->instr;
       src->src.is_ssa = true;
@@ -224,8 +224,21 @@ merge_sets_interfere(merge_set *a, merge_set *b)
    return false;
 }
 
+static nir_parallel_copy_instr *
+create_parallel_copy(struct from_ssa_state *state)
+{
+   nir_parallel_copy_instr *pcopy =
+      nir_parallel_copy_instr_create(state->builder.shader);
+
+   /* These are all gone by the end of the pass, so free them with it. */
+   if (!pcopy->instr.from_arena)
+      ralloc_steal(state->dead_ctx, pcopy);
+
+   return pcopy;
+}
+
 static bool
-add_parallel_copy_to_end_of_block(nir_block *block, void *dead_ctx)
+add_parallel_copy_to_end_of_block(nir_block *block, struct from_ssa_state *state)
 {
 
    bool need_end_copy = false;
@@ -246,8 +259,7 @@ add_parallel_copy_to_end_of_block(nir_block *block, void *dead_ctx)
        * create a parallel copy at the end of the block but before the jump
        * (if there is one).
        */
-      nir_parallel_copy_instr *pcopy =
-         nir_parallel_copy_instr_create(dead_ctx);
+      nir_parallel_copy_instr *pcopy = create_parallel_copy(state);
 
       nir_instr_insert(nir_after_block_before_jump(block), &pcopy->instr);
    }
@@ -303,7 +315,7 @@ get_parallel_copy_at_end_of_block(nir_block *block)
  * time because of potential back-edges in the CFG.
  */
 static bool
-isolate_phi_nodes_block(nir_block *block, void *dead_ctx)
+isolate_phi_nodes_block(nir_block *block, struct from_ssa_state *state)
 {
    nir_instr *last_phi_instr = NULL;
    nir_foreach_instr(instr, block) {
@@ -321,8 +333,7 @@ isolate_phi_nodes_block(nir_block *block, void *dead_ctx)
    /* If we have phi nodes, we need to create a parallel copy at the
     * start of this block but after the phi nodes.
     */
-   nir_parallel_copy_instr *block_pcopy =
-      nir_parallel_copy_instr_create(dead_ctx);
+   nir_parallel_copy_instr *block_pcopy = create_parallel_copy(state);
    nir_instr_insert_after(last_phi_instr, &block_pcopy->instr);
 
    nir_foreach_instr(instr, block) {
@@ -337,7 +348,7 @@ isolate_phi_nodes_block(nir_block *block, void *dead_ctx)
             get_parallel_copy_at_end_of_block(src->pred);
          assert(pcopy);
 
-         nir_parallel_copy_entry *entry = rzalloc(dead_ctx,
+         nir_parallel_copy_entry *entry = rzalloc(state->dead_ctx,
                                                   nir_parallel_copy_entry);
          nir_ssa_dest_init(&pcopy->instr, &entry->dest,
                            phi->dest.ssa.num_components,
@@ -351,7 +362,7 @@ isolate_phi_nodes_block(nir_block *block, void *dead_ctx)
                                nir_src_for_ssa(&entry->dest.ssa));
       }
 
-      nir_parallel_copy_entry *entry = rzalloc(dead_ctx,
+      nir_parallel_copy_entry *entry = rzalloc(state->dead_ctx,
                                                nir_parallel_copy_entry);
       nir_ssa_dest_init(&block_pcopy->instr, &entry->dest,
                         phi->dest.ssa.num_components, phi->dest.ssa.bit_size,
@@ -503,7 +514,8 @@ rewrite_ssa_def(nir_ssa_def *def, void *void_state)
        */
       nir_instr *parent_instr = def->parent_instr;
       nir_instr_remove(parent_instr);
-      ralloc_steal(state->dead_ctx, parent_instr);
+      if (!parent_instr->from_arena)
+         ralloc_steal(state->dead_ctx, parent_instr);
       state->progress = true;
       return true;
    }
@@ -532,7 +544,8 @@ resolve_registers_block(nir_block *block, struct from_ssa_state *state)
 
       if (instr->type == nir_instr_type_phi) {
          nir_instr_remove(instr);
-         ralloc_steal(state->dead_ctx, instr);
+         if (!instr->from_arena)
+            ralloc_steal(state->dead_ctx, instr);
          state->progress = true;
       }
    }
@@ -772,11 +785,11 @@ nir_convert_from_ssa_impl(nir_function_impl *impl, bool phi_webs_only)
    state.progress = false;
 
    nir_foreach_block(block, impl) {
-      add_parallel_copy_to_end_of_block(block, state.dead_ctx);
+      add_parallel_copy_to_end_of_block(block, &state);
    }
 
    nir_foreach_block(block, impl) {
-      isolate_phi_nodes_block(block, state.dead_ctx);
+      isolate_phi_nodes_block(block, &state);
    }
 
    /* Mark metadata as dirty before we ask for liveness analysis */
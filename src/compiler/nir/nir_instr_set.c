@@ -796,30 +796,38 @@ nir_instr_set_destroy(struct set *instr_set)
 }
 
 bool
-nir_instr_set_add_or_rewrite(struct set *instr_set, nir_instr *instr)
+nir_instr_set_add_or_rewrite(struct set *instr_set, nir_instr *instr,
+                             nir_instr_set_cond_cb cond, void *data)
 {
    if (!instr_can_rewrite(instr))
       return false;
 
    struct set_entry *e = _mesa_set_search_or_add(instr_set, instr);
    nir_instr *match = (nir_instr *) e->key;
-   if (match != instr) {
-      nir_ssa_def *def = nir_instr_get_dest_ssa_def(instr);
-      nir_ssa_def *new_def = nir_instr_get_dest_ssa_def(match);
-
-      /* It's safe to replace an exact instruction with an inexact one as
-       * long as we make it exact.  If we got here, the two instructions are
-       * exactly identical in every other way so, once we've set the exact
-       * bit, they are the same.
-       */
-      if (instr->type == nir_instr_type_alu && nir_instr_as_alu(instr)->exact)
-         nir_instr_as_alu(match)->exact = true;
+   if (match == instr)
+      return false;
 
-      nir_ssa_def_rewrite_uses(def, nir_src_for_ssa(new_def));
-      return true;
+   if (cond && !cond(match, instr, data)) {
+      /* The old instruction can't stand in for this one.  Let this one take
+       * its place so that whatever follows gets matched against it instead.
+       */
+      e->key = instr;
+      return false;
    }
 
-   return false;
+   nir_ssa_def *def = nir_instr_get_dest_ssa_def(instr);
+   nir_ssa_def *new_def = nir_instr_get_dest_ssa_def(match);
+
+   /* It's safe to replace an exact instruction with an inexact one as
+    * long as we make it exact.  If we got here, the two instructions are
+    * exactly identical in every other way so, once we've set the exact
+    * bit, they are the same.
+    */
+   if (instr->type == nir_instr_type_alu && nir_instr_as_alu(instr)->exact)
+      nir_instr_as_alu(match)->exact = true;
+
+   nir_ssa_def_rewrite_uses(def, nir_src_for_ssa(new_def));
+   return true;
 }
 
 void
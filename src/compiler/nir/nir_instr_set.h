@@ -45,13 +45,24 @@ struct set *nir_instr_set_create(void *mem_ctx);
 /** Destroys an instruction set. */
 void nir_instr_set_destroy(struct set *instr_set);
 
+/**
+ * Callback deciding whether "old", an instruction already in the set, may
+ * replace the equal instruction "instr".
+ */
+typedef bool (*nir_instr_set_cond_cb)(nir_instr *old, nir_instr *instr,
+                                      void *data);
+
 /**
  * Adds an instruction to an instruction set if it doesn't exist, or if it
  * does already exist, rewrites all uses of it to point to the other
  * already-inserted instruction. Returns 'true' if the uses of the instruction
  * were rewritten.
+ *
+ * If cond is non-NULL, it is consulted before rewriting.  When it returns
+ * false, the instruction replaces the old one in the set instead.
  */
-bool nir_instr_set_add_or_rewrite(struct set *instr_set, nir_instr *instr);
+bool nir_instr_set_add_or_rewrite(struct set *instr_set, nir_instr *instr,
+                                  nir_instr_set_cond_cb cond, void *data);
 
 /**
  * Removes an instruction from an instruction set, so that other instructions
@@ -1141,6 +1141,68 @@ force_unroll_heuristics(loop_info_state *state, nir_block *block)
    return false;
 }
 
+static bool
+def_decides_branch(nir_ssa_def *def)
+{
+   if (!list_empty(&def->if_uses))
+      return true;
+
+   nir_foreach_use(src, def) {
+      nir_instr *instr = src->parent_instr;
+      if (instr->type == nir_instr_type_alu &&
+          !list_empty(&nir_instr_as_alu(instr)->dest.dest.ssa.if_uses))
+         return true;
+   }
+
+   return false;
+}
+
+/* Looks for a phi at the top of the loop whose back-edge source is loop
+ * invariant, such as a "first" flag that gets cleared every iteration, and
+ * which decides a branch inside the loop.  Only the first iteration sees the
+ * value from before the loop.
+ */
+static bool
+find_first_iteration_branch(loop_info_state *state)
+{
+   nir_block *header = nir_loop_first_block(state->loop);
+   nir_block *preheader = nir_block_cf_tree_prev(header);
+
+   nir_foreach_instr(instr, header) {
+      if (instr->type != nir_instr_type_phi)
+         break;
+
+      nir_phi_instr *phi = nir_instr_as_phi(instr);
+      if (exec_list_length(&phi->srcs) != 2 ||
+          phi->dest.ssa.num_components != 1)
+         continue;
+
+      nir_src *entry_src = NULL, *back_src = NULL;
+      nir_foreach_phi_src(src, phi) {
+         if (src->pred == preheader)
+            entry_src = &src->src;
+         else
+            back_src = &src->src;
+      }
+
+      if (!entry_src || !back_src ||
+          !mark_invariant(back_src->ssa, state))
+         continue;
+
+      if (entry_src->ssa == back_src->ssa)
+         continue;
+
+      if (nir_src_is_const(*entry_src) && nir_src_is_const(*back_src) &&
+          nir_src_as_uint(*entry_src) == nir_src_as_uint(*back_src))
+         continue;
+
+      if (def_decides_branch(&phi->dest.ssa))
+         return true;
+   }
+
+   return false;
+}
+
 static void
 get_loop_info(loop_info_state *state, nir_function_impl *impl)
 {
@@ -1205,6 +1267,9 @@ get_loop_info(loop_info_state *state, nir_function_impl *impl)
    /* Run through each of the terminators and try to compute a trip-count */
    find_trip_count(state);
 
+   state->loop->info->peel_first_iteration =
+      find_first_iteration_branch(state);
+
    nir_foreach_block_in_cf_node(block, &state->loop->cf_node) {
       if (force_unroll_heuristics(state, block)) {
          state->loop->info->force_unroll = true;
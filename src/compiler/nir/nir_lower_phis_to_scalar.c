@@ -263,7 +263,8 @@ lower_phis_to_scalar_block(nir_block *block,
       nir_ssa_def_rewrite_uses(&phi->dest.ssa,
                                nir_src_for_ssa(&vec->dest.dest.ssa));
 
-      ralloc_steal(state->dead_ctx, phi);
+      if (!phi->instr.from_arena)
+         ralloc_steal(state->dead_ctx, phi);
       nir_instr_remove(&phi->instr);
 
       progress = true;
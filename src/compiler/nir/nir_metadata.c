@@ -25,6 +25,12 @@
  */
 
 #include "nir.h"
+#include "util/debug.h"
+#include "util/os_time.h"
+#include "util/simple_mtx.h"
+#include "util/u_atomic.h"
+#include <inttypes.h>
+#include <string.h>
 
 /*
  * Handles management of the metadata.
@@ -57,6 +63,197 @@ void
 nir_metadata_preserve(nir_function_impl *impl, nir_metadata preserved)
 {
    impl->valid_metadata &= preserved;
+
+   /* Passes only call this once they have changed the function, so clean
+    * passes have to run again.
+    */
+   impl->function->shader->generation++;
+}
+
+enum pass_stats_format {
+   PASS_STATS_NONE,
+   PASS_STATS_TEXT,
+   PASS_STATS_CSV,
+   PASS_STATS_JSON,
+};
+
+static simple_mtx_t pass_sites_mutex = _SIMPLE_MTX_INITIALIZER_NP;
+static nir_pass_site *pass_sites;
+
+static enum pass_stats_format
+get_pass_stats_format(void)
+{
+   static int format = -1;
+   if (format < 0) {
+      const char *str = getenv("NIR_PASS_STATS");
+      if (str && !strcmp(str, "csv"))
+         format = PASS_STATS_CSV;
+      else if (str && !strcmp(str, "json"))
+         format = PASS_STATS_JSON;
+      else if (env_var_as_boolean("NIR_PASS_STATS", false))
+         format = PASS_STATS_TEXT;
+      else
+         format = PASS_STATS_NONE;
+   }
+
+   return format;
+}
+
+bool
+nir_pass_stats_enabled(void)
+{
+   return get_pass_stats_format() != PASS_STATS_NONE;
+}
+
+static void
+print_pass_stats(void)
+{
+   FILE *fp = stderr;
+
+   switch (get_pass_stats_format()) {
+   case PASS_STATS_TEXT:
+      fprintf(fp, "%-40s %8s %8s %8s %12s %12s %12s\n", "NIR pass",
+              "runs", "progress", "skipped", "time (ms)", "instrs -",
+              "blocks -");
+      for (nir_pass_site *site = pass_sites; site; site = site->next) {
+         fprintf(fp, "%-40s %8u %8u %8u %12.3f %12"PRId64" %12"PRId64"\n",
+                 site->name, site->runs, site->progress, site->skips,
+                 site->time_ns / 1000000.0,
+                 (int64_t)(site->instrs_before - site->instrs_after),
+                 (int64_t)(site->blocks_before - site->blocks_after));
+      }
+      break;
+
+   case PASS_STATS_CSV:
+      fprintf(fp, "pass,runs,progress,skips,time_ns,instrs_before,"
+                  "instrs_after,blocks_before,blocks_after\n");
+      for (nir_pass_site *site = pass_sites; site; site = site->next) {
+         fprintf(fp, "%s,%u,%u,%u,%"PRIu64",%"PRIu64",%"PRIu64",%"PRIu64
+                     ",%"PRIu64"\n",
+                 site->name, site->runs, site->progress, site->skips,
+                 site->time_ns, site->instrs_before, site->instrs_after,
+                 site->blocks_before, site->blocks_after);
+      }
+      break;
+
+   case PASS_STATS_JSON:
+      fprintf(fp, "[\n");
+      for (nir_pass_site *site = pass_sites; site; site = site->next) {
+         fprintf(fp, "  { \"pass\": \"%s\", \"runs\": %u, \"progress\": %u, "
+                     "\"skips\": %u, \"time_ns\": %"PRIu64", "
+                     "\"instrs_before\": %"PRIu64", \"instrs_after\": %"PRIu64", "
+                     "\"blocks_before\": %"PRIu64", \"blocks_after\": %"PRIu64
+                     " }%s\n",
+                 site->name, site->runs, site->progress, site->skips,
+                 site->time_ns, site->instrs_before, site->instrs_after,
+                 site->blocks_before, site->blocks_after,
+                 site->next ? "," : "");
+      }
+      fprintf(fp, "]\n");
+      break;
+
+   case PASS_STATS_NONE:
+      break;
+   }
+}
+
+static void
+register_pass_site(nir_pass_site *site)
+{
+   simple_mtx_lock(&pass_sites_mutex);
+   if (!site->registered) {
+      if (!pass_sites)
+         atexit(print_pass_stats);
+      site->next = pass_sites;
+      pass_sites = site;
+      site->registered = true;
+   }
+   simple_mtx_unlock(&pass_sites_mutex);
+}
+
+static void
+count_shader(const nir_shader *shader, unsigned *instrs, unsigned *blocks)
+{
+   *instrs = 0;
+   *blocks = 0;
+
+   nir_foreach_function(function, shader) {
+      if (!function->impl)
+         continue;
+
+      nir_foreach_block(block, function->impl) {
+         (*blocks)++;
+         nir_foreach_instr(instr, block)
+            (*instrs)++;
+      }
+   }
+}
+
+/**
+ * Decides whether a NIR_PASS() call site has to run, and starts collecting
+ * statistics for it if requested.
+ *
+ * A pass is a function of the shader, so if it made no progress the last
+ * time this call site ran it and the generation hasn't moved since, running
+ * it again can't do anything either.
+ */
+bool
+nir_pass_begin_tracked(nir_shader *shader, nir_pass_site *site,
+                       nir_pass_run *run)
+{
+   if (shader->pass_stats && !site->registered)
+      register_pass_site(site);
+
+   if (shader->pass_generations) {
+      struct hash_entry *entry =
+         _mesa_hash_table_search(shader->pass_generations, site);
+      if (entry && (uintptr_t)entry->data == shader->generation) {
+         p_atomic_inc(&site->skips);
+         return false;
+      }
+   }
+
+   p_atomic_inc(&site->runs);
+
+   if (shader->pass_stats) {
+      count_shader(shader, &run->instrs, &run->blocks);
+      run->start_ns = os_time_get_nano();
+   }
+
+   return true;
+}
+
+void
+nir_pass_end_tracked(nir_shader *shader, nir_pass_site *site,
+                     nir_pass_run *run, bool progress)
+{
+   if (shader->pass_stats) {
+      p_atomic_add(&site->time_ns, os_time_get_nano() - run->start_ns);
+
+      unsigned instrs, blocks;
+      count_shader(shader, &instrs, &blocks);
+      p_atomic_add(&site->instrs_before, run->instrs);
+      p_atomic_add(&site->instrs_after, instrs);
+      p_atomic_add(&site->blocks_before, run->blocks);
+      p_atomic_add(&site->blocks_after, blocks);
+   }
+
+   if (progress)
+      p_atomic_inc(&site->progress);
+
+   if (!shader->pass_generations)
+      return;
+
+   if (progress) {
+      shader->generation++;
+      _mesa_hash_table_remove_key(shader->pass_generations, site);
+   } else {
+      /* Record the generation after the pass, since a pass may invalidate
+       * metadata even when it reports no progress.
+       */
+      _mesa_hash_table_insert(shader->pass_generations, site,
+                              (void *)(uintptr_t)shader->generation);
+   }
 }
 
 #ifndef NDEBUG
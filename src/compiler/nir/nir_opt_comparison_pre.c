@@ -139,7 +139,7 @@ static void
 rewrite_compare_instruction(nir_builder *bld, nir_alu_instr *orig_cmp,
                             nir_alu_instr *orig_add, bool zero_on_left)
 {
-   void *const mem_ctx = ralloc_parent(orig_cmp);
+   nir_shader *const mem_ctx = bld->shader;
 
    bld->cursor = nir_before_instr(&orig_cmp->instr);
 
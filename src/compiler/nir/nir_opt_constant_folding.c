@@ -103,7 +103,7 @@ constant_fold_alu_instr(nir_alu_instr *instr, void *mem_ctx)
                             nir_src_for_ssa(&new_instr->def));
 
    nir_instr_remove(&instr->instr);
-   ralloc_free(instr);
+   nir_instr_free(&instr->instr);
 
    return true;
 }
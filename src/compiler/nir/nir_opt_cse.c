@@ -30,45 +30,80 @@
 
 /*
  * Implements common subexpression elimination
+ *
+ * This is really global value numbering: a single instruction set is shared
+ * by the whole function and, since blocks are visited in an order consistent
+ * with dominance, each instruction only gets replaced by an equal one whose
+ * block dominates its own.  When two equal instructions sit at the very top
+ * of the then and else branches of the same if, both paths compute the
+ * value, so the then-side copy is hoisted above the if and the else-side one
+ * rewritten to it.  This also applies to loads that may be reordered, which
+ * gives a simple form of partial redundancy elimination.
  */
 
-/*
- * Visits and CSEs the given block and all its descendants in the dominance
- * tree recursively. Note that the instr_set is guaranteed to only ever
- * contain instructions that dominate the current block.
- */
+static bool
+src_dominates_block(nir_src *src, void *state)
+{
+   nir_block *block = state;
+
+   assert(src->is_ssa);
+   return nir_block_dominates(src->ssa->parent_instr->block, block);
+}
 
 static bool
-cse_block(nir_block *block, struct set *dominance_set)
+try_hoist_to_if(nir_instr *old, nir_instr *instr)
 {
-   bool progress = false;
-   struct set *instr_set = _mesa_set_clone(dominance_set, NULL);
+   if (old->type == nir_instr_type_phi)
+      return false;
 
-   nir_foreach_instr_safe(instr, block) {
-      if (nir_instr_set_add_or_rewrite(instr_set, instr)) {
-         progress = true;
-         nir_instr_remove(instr);
-      }
-   }
+   nir_cf_node *parent = old->block->cf_node.parent;
+   if (parent->type != nir_cf_node_if)
+      return false;
 
-   for (unsigned i = 0; i < block->num_dom_children; i++) {
-      nir_block *child = block->dom_children[i];
-      progress |= cse_block(child, instr_set);
-   }
+   nir_if *nif = nir_cf_node_as_if(parent);
+   if (old->block != nir_if_first_then_block(nif) ||
+       instr->block != nir_if_first_else_block(nif))
+      return false;
 
-   _mesa_set_destroy(instr_set, NULL);
+   nir_block *pred = nir_cf_node_as_block(nir_cf_node_prev(&nif->cf_node));
+   if (nir_block_ends_in_jump(pred))
+      return false;
 
-   return progress;
+   if (!nir_foreach_src(old, src_dominates_block, pred))
+      return false;
+
+   nir_instr_remove(old);
+   nir_instr_insert(nir_after_block(pred), old);
+   return true;
+}
+
+static bool
+dominates_or_hoist(nir_instr *old, nir_instr *instr, void *data)
+{
+   if (nir_block_dominates(old->block, instr->block))
+      return true;
+
+   return try_hoist_to_if(old, instr);
 }
 
 static bool
 nir_opt_cse_impl(nir_function_impl *impl)
 {
    struct set *instr_set = nir_instr_set_create(NULL);
+   _mesa_set_resize(instr_set, impl->ssa_alloc);
 
    nir_metadata_require(impl, nir_metadata_dominance);
 
-   bool progress = cse_block(nir_start_block(impl), instr_set);
+   bool progress = false;
+   nir_foreach_block(block, impl) {
+      nir_foreach_instr_safe(instr, block) {
+         if (nir_instr_set_add_or_rewrite(instr_set, instr,
+                                          dominates_or_hoist, NULL)) {
+            progress = true;
+            nir_instr_remove(instr);
+         }
+      }
+   }
 
    if (progress) {
       nir_metadata_preserve(impl, nir_metadata_block_index |
@@ -35,12 +35,32 @@
  * number of ways.  The algorithm used here differs substantially from the
  * one in the paper but it is, in my opinion, much easier to read and
  * verify correcness.
+ *
+ * Instructions are hoisted out of loops and sunk into the branches that use
+ * them.  Both are limited by a register pressure estimate taken from SSA
+ * liveness.  Neither may push the number of values live across a loop or
+ * into a block past a limit, which is the driver's gcm_max_live_values or,
+ * failing that, the highest pressure already found in the function.
  */
 
+struct gcm_loop_info {
+   /* The loop this one is nested in, if any */
+   struct gcm_loop_info *parent;
+
+   /* Estimated number of SSA values live across the loop */
+   unsigned pressure;
+};
+
 struct gcm_block_info {
    /* Number of loops this block is inside */
    unsigned loop_depth;
 
+   /* The innermost loop this block is inside, or NULL */
+   struct gcm_loop_info *loop;
+
+   /* Number of SSA values live on entry to this block */
+   unsigned pressure;
+
    /* The last instruction inserted into this block.  This is used as we
     * traverse the instructions and insert them back into the program to
     * put them in the right order.
@@ -48,6 +68,11 @@ struct gcm_block_info {
    nir_instr *last_instr;
 };
 
+struct gcm_instr_info {
+   /* The block the instruction was in before the pass moved it */
+   nir_block *orig_block;
+};
+
 /* Flags used in the instr->pass_flags field for various instruction states */
 enum {
    GCM_INSTR_PINNED =            (1 << 0),
@@ -68,29 +93,52 @@ struct gcm_state {
    struct exec_list instrs;
 
    struct gcm_block_info *blocks;
+
+   /* Indexed by instr->index */
+   struct gcm_instr_info *instr_infos;
+
+   /* Pressure that hoisting and sinking may not go above */
+   unsigned max_pressure;
 };
 
 /* Recursively walks the CFG and builds the block_info structure */
 static void
 gcm_build_block_info(struct exec_list *cf_list, struct gcm_state *state,
-                     unsigned loop_depth)
+                     struct gcm_loop_info *loop, unsigned loop_depth,
+                     unsigned live_words)
 {
    foreach_list_typed(nir_cf_node, node, node, cf_list) {
       switch (node->type) {
       case nir_cf_node_block: {
          nir_block *block = nir_cf_node_as_block(node);
-         state->blocks[block->index].loop_depth = loop_depth;
+         struct gcm_block_info *info = &state->blocks[block->index];
+         info->loop_depth = loop_depth;
+         info->loop = loop;
+
+         info->pressure = 0;
+         for (unsigned i = 0; i < live_words; i++)
+            info->pressure += util_bitcount(block->live_in[i]);
+
+         state->max_pressure = MAX2(state->max_pressure, info->pressure);
+         for (struct gcm_loop_info *l = loop; l; l = l->parent)
+            l->pressure = MAX2(l->pressure, info->pressure);
          break;
       }
       case nir_cf_node_if: {
          nir_if *if_stmt = nir_cf_node_as_if(node);
-         gcm_build_block_info(&if_stmt->then_list, state, loop_depth);
-         gcm_build_block_info(&if_stmt->else_list, state, loop_depth);
+         gcm_build_block_info(&if_stmt->then_list, state, loop, loop_depth,
+                              live_words);
+         gcm_build_block_info(&if_stmt->else_list, state, loop, loop_depth,
+                              live_words);
          break;
       }
       case nir_cf_node_loop: {
-         nir_loop *loop = nir_cf_node_as_loop(node);
-         gcm_build_block_info(&loop->body, state, loop_depth + 1);
+         nir_loop *nloop = nir_cf_node_as_loop(node);
+         struct gcm_loop_info *info =
+            rzalloc(state->blocks, struct gcm_loop_info);
+         info->parent = loop;
+         gcm_build_block_info(&nloop->body, state, info, loop_depth + 1,
+                              live_words);
          break;
       }
       default:
@@ -135,6 +183,8 @@ gcm_pin_instructions_block(nir_block *block, struct gcm_state *state)
       case nir_instr_type_tex:
          if (nir_tex_instr_has_implicit_derivative(nir_instr_as_tex(instr)))
             instr->pass_flags = GCM_INSTR_PINNED;
+         else
+            instr->pass_flags = 0;
          break;
 
       case nir_instr_type_load_const:
@@ -160,6 +210,8 @@ gcm_pin_instructions_block(nir_block *block, struct gcm_state *state)
          unreachable("Invalid instruction type in GCM");
       }
 
+      state->instr_infos[instr->index].orig_block = block;
+
       if (!(instr->pass_flags & GCM_INSTR_PINNED)) {
          /* If this is an unpinned instruction, go ahead and pull it out of
           * the program and put it on the instrs list.  This has a couple
@@ -254,6 +306,119 @@ gcm_schedule_early_instr(nir_instr *instr, struct gcm_state *state)
 static void
 gcm_schedule_late_instr(nir_instr *instr, struct gcm_state *state);
 
+static bool
+gcm_loop_contains_block(struct gcm_loop_info *loop, nir_block *block,
+                        struct gcm_state *state)
+{
+   for (struct gcm_loop_info *l = state->blocks[block->index].loop;
+        l; l = l->parent) {
+      if (l == loop)
+         return true;
+   }
+
+   return false;
+}
+
+/* Hoisting a value out of a loop it was computed in keeps it live across
+ * the whole loop.  Returns whether the loops between "from" and "to" have
+ * room for it and, if "commit" is set, accounts for it.
+ */
+static bool
+gcm_try_hoist_out_of_loops(nir_block *orig, nir_block *from, nir_block *to,
+                           bool commit, struct gcm_state *state)
+{
+   struct gcm_loop_info *to_loop = state->blocks[to->index].loop;
+
+   for (struct gcm_loop_info *l = state->blocks[from->index].loop;
+        l != to_loop; l = l->parent) {
+      if (!gcm_loop_contains_block(l, orig, state))
+         continue;
+
+      if (commit)
+         l->pressure++;
+      else if (l->pressure >= state->max_pressure)
+         return false;
+   }
+
+   return true;
+}
+
+struct gcm_sink_state {
+   nir_block *block;
+   unsigned pressure;
+};
+
+static bool
+gcm_count_new_live_src(nir_src *src, void *void_state)
+{
+   struct gcm_sink_state *state = void_state;
+
+   assert(src->is_ssa);
+   if (src->ssa->parent_instr->type != nir_instr_type_ssa_undef &&
+       !BITSET_TEST(state->block->live_in, src->ssa->live_index))
+      state->pressure++;
+
+   return true;
+}
+
+/* Sinking a value moves the uses of its sources along with it, so any
+ * source that isn't already live into the new block becomes live there.
+ */
+static bool
+gcm_can_sink_to(nir_ssa_def *def, nir_block *block, struct gcm_state *state)
+{
+   struct gcm_sink_state sink = {
+      .block = block,
+      .pressure = state->blocks[block->index].pressure,
+   };
+   if (BITSET_TEST(block->live_in, def->live_index))
+      sink.pressure--;
+
+   nir_foreach_src(def->parent_instr, gcm_count_new_live_src, &sink);
+
+   return sink.pressure <= MAX2(state->blocks[block->index].pressure,
+                                state->max_pressure);
+}
+
+/** Picks the block for an instruction between its early and late blocks
+ *
+ * Walks up the dominance tree from the LCA of the uses to the early block
+ * and picks the lowest block that is as far outside loops as the pressure
+ * estimate allows.  Within the same loop depth, this means the value is
+ * sunk as close to its uses as possible.
+ */
+static nir_block *
+gcm_choose_block_for_def(nir_ssa_def *def, nir_block *early,
+                         nir_block *late, struct gcm_state *state)
+{
+   nir_block *orig = state->instr_infos[def->parent_instr->index].orig_block;
+
+   nir_block *best = late;
+   for (nir_block *block = late; block != NULL; block = block->imm_dom) {
+      if (state->blocks[block->index].loop_depth <
+          state->blocks[best->index].loop_depth) {
+         if (!gcm_try_hoist_out_of_loops(orig, best, block, false, state))
+            break;
+         best = block;
+      }
+
+      if (block == early)
+         break;
+   }
+
+   if (best != late)
+      gcm_try_hoist_out_of_loops(orig, late, best, true, state);
+
+   if (best != orig &&
+       state->blocks[best->index].loop_depth ==
+       state->blocks[orig->index].loop_depth &&
+       nir_block_dominates(orig, best) &&
+       !gcm_can_sink_to(def, best, state))
+      best = orig;
+
+   return best;
+}
+
 /** Schedules the instruction associated with the given SSA def late
  *
  * This function works by first walking all of the uses of the given SSA
@@ -312,19 +477,9 @@ gcm_schedule_late_def(nir_ssa_def *def, void *void_state)
 
    /* We now have the LCA of all of the uses.  If our invariants hold,
     * this is dominated by the block that we chose when scheduling early.
-    * We now walk up the dominance tree and pick the lowest block that is
-    * as far outside loops as we can get.
     */
-   nir_block *best = lca;
-   for (nir_block *block = lca; block != NULL; block = block->imm_dom) {
-      if (state->blocks[block->index].loop_depth <
-          state->blocks[best->index].loop_depth)
-         best = block;
-
-      if (block == def->parent_instr->block)
-         break;
-   }
-   def->parent_instr->block = best;
+   def->parent_instr->block =
+      gcm_choose_block_for_def(def, def->parent_instr->block, lca, state);
 
    return true;
 }
@@ -443,20 +598,48 @@ gcm_place_instr(nir_instr *instr, struct gcm_state *state)
    block_info->last_instr = instr;
 }
 
+static bool
+gcm_count_live_def(nir_ssa_def *def, void *void_count)
+{
+   unsigned *count = void_count;
+
+   /* This matches the numbering done by nir_live_ssa_defs_impl() */
+   if (def->parent_instr->type != nir_instr_type_ssa_undef)
+      (*count)++;
+
+   return true;
+}
+
 static bool
 opt_gcm_impl(nir_function_impl *impl, bool value_number)
 {
    nir_metadata_require(impl, nir_metadata_block_index |
-                              nir_metadata_dominance);
+                              nir_metadata_dominance |
+                              nir_metadata_live_ssa_defs);
 
    struct gcm_state state;
 
    state.impl = impl;
    state.instr = NULL;
+   state.max_pressure = 0;
    exec_list_make_empty(&state.instrs);
    state.blocks = rzalloc_array(NULL, struct gcm_block_info, impl->num_blocks);
+   state.instr_infos = ralloc_array(state.blocks, struct gcm_instr_info,
+                                    nir_index_instrs(impl));
+
+   unsigned num_live_defs = 1;
+   nir_foreach_block(block, impl) {
+      nir_foreach_instr(instr, block)
+         nir_foreach_ssa_def(instr, gcm_count_live_def, &num_live_defs);
+   }
+
+   gcm_build_block_info(&impl->body, &state, NULL, 0,
+                        BITSET_WORDS(num_live_defs));
 
-   gcm_build_block_info(&impl->body, &state, 0);
+   unsigned max_live_values =
+      impl->function->shader->options->gcm_max_live_values;
+   if (max_live_values)
+      state.max_pressure = max_live_values;
 
    nir_foreach_block(block, impl) {
       gcm_pin_instructions_block(block, &state);
@@ -466,7 +649,7 @@ opt_gcm_impl(nir_function_impl *impl, bool value_number)
    if (value_number) {
       struct set *gvn_set = nir_instr_set_create(NULL);
       foreach_list_typed_safe(nir_instr, instr, node, &state.instrs) {
-         if (nir_instr_set_add_or_rewrite(gvn_set, instr)) {
+         if (nir_instr_set_add_or_rewrite(gvn_set, instr, NULL, NULL)) {
             nir_instr_remove(instr);
             progress = true;
          }
@@ -480,6 +663,11 @@ opt_gcm_impl(nir_function_impl *impl, bool value_number)
    foreach_list_typed(nir_instr, instr, node, &state.instrs)
       gcm_schedule_late_instr(instr, &state);
 
+   foreach_list_typed(nir_instr, instr, node, &state.instrs) {
+      if (instr->block != state.instr_infos[instr->index].orig_block)
+         progress = true;
+   }
+
    while (!exec_list_is_empty(&state.instrs)) {
       nir_instr *instr = exec_node_data(nir_instr,
                                         state.instrs.tail_sentinel.prev, node);
@@ -515,12 +515,12 @@ opt_split_alu_of_phi(nir_builder *b, nir_loop *loop)
          nir_phi_instr *const phi = nir_phi_instr_create(b->shader);
          nir_phi_src *phi_src;
 
-         phi_src = ralloc(phi, nir_phi_src);
+         phi_src = nir_instr_alloc_data(&phi->instr, sizeof(nir_phi_src));
          phi_src->pred = prev_block;
          phi_src->src = nir_src_for_ssa(prev_value);
          exec_list_push_tail(&phi->srcs, &phi_src->node);
 
-         phi_src = ralloc(phi, nir_phi_src);
+         phi_src = nir_instr_alloc_data(&phi->instr, sizeof(nir_phi_src));
          phi_src->pred = continue_block;
          phi_src->src = nir_src_for_ssa(alu_copy);
          exec_list_push_tail(&phi->srcs, &phi_src->node);
@@ -549,7 +549,7 @@ opt_split_alu_of_phi(nir_builder *b, nir_loop *loop)
           * remove it.
           */
          nir_instr_remove_v(&alu->instr);
-         ralloc_free(alu);
+         nir_instr_free(&alu->instr);
 
          progress = true;
       }
@@ -728,14 +728,14 @@ opt_simplify_bcsel_of_phi(nir_builder *b, nir_loop *loop)
       nir_phi_instr *const phi = nir_phi_instr_create(b->shader);
       nir_phi_src *phi_src;
 
-      phi_src = ralloc(phi, nir_phi_src);
+      phi_src = nir_instr_alloc_data(&phi->instr, sizeof(nir_phi_src));
       phi_src->pred = prev_block;
       phi_src->src =
          nir_src_for_ssa(ssa_for_phi_from_block(nir_instr_as_phi(bcsel->src[entry_src].src.ssa->parent_instr),
                                                 prev_block));
       exec_list_push_tail(&phi->srcs, &phi_src->node);
 
-      phi_src = ralloc(phi, nir_phi_src);
+      phi_src = nir_instr_alloc_data(&phi->instr, sizeof(nir_phi_src));
       phi_src->pred = continue_block;
       phi_src->src =
          nir_src_for_ssa(ssa_for_phi_from_block(nir_instr_as_phi(bcsel->src[continue_src].src.ssa->parent_instr),
@@ -0,0 +1,517 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir.h"
+#include "nir_builder.h"
+#include "util/u_dynarray.h"
+
+/*
+ * Combines adjacent loads and stores of UBO, SSBO, shared and global memory
+ * into wider ones.
+ *
+ * This works on explicit offsets, so it should run after the variables
+ * have been lowered to offsets.  Each offset is split into an SSA base and
+ * a constant part; two accesses with the same intrinsic, resource, base and
+ * bit size are candidates if their constant parts put them next to each
+ * other.  The driver callback decides whether the combined access is
+ * acceptable.
+ *
+ * Accesses are only combined within a block.  Anything that may touch
+ * memory and isn't one of the accesses we handle ends the group, and an
+ * access may not be moved across a possibly aliasing store (or, for
+ * stores, a possibly aliasing load).
+ */
+
+struct intrinsic_info {
+   nir_variable_mode mode;
+   nir_intrinsic_op op;
+   int resource_src; /* -1 if there is none */
+   int offset_src;
+   int value_src;    /* -1 for loads */
+};
+
+static const struct intrinsic_info infos[] = {
+   { nir_var_mem_ubo,    nir_intrinsic_load_ubo,      0,  1, -1 },
+   { nir_var_mem_ssbo,   nir_intrinsic_load_ssbo,     0,  1, -1 },
+   { nir_var_mem_ssbo,   nir_intrinsic_store_ssbo,    1,  2,  0 },
+   { nir_var_mem_shared, nir_intrinsic_load_shared,  -1,  0, -1 },
+   { nir_var_mem_shared, nir_intrinsic_store_shared, -1,  1,  0 },
+   { nir_var_mem_global, nir_intrinsic_load_global,  -1,  0, -1 },
+   { nir_var_mem_global, nir_intrinsic_store_global, -1,  1,  0 },
+};
+
+static const struct intrinsic_info *
+get_info(nir_intrinsic_op op)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(infos); i++) {
+      if (infos[i].op == op)
+         return &infos[i];
+   }
+
+   return NULL;
+}
+
+struct entry {
+   /* NULL once the access has been combined into another one */
+   nir_intrinsic_instr *intrin;
+   const struct intrinsic_info *info;
+
+   /* The offset is base + offset, in bytes.  base.def is NULL if the whole
+    * offset is constant.
+    */
+   nir_ssa_scalar base;
+   int64_t offset;
+
+   unsigned bit_size;
+   unsigned num_components;
+   nir_component_mask_t write_mask;
+};
+
+struct vectorize_ctx {
+   nir_variable_mode modes;
+   nir_should_vectorize_mem_func callback;
+
+   /* Accesses seen since the last instruction that ended the group */
+   struct util_dynarray entries;
+};
+
+static bool
+is_store(const struct entry *entry)
+{
+   return entry->info->value_src >= 0;
+}
+
+static void
+parse_offset(nir_src *src, int64_t base_const, struct entry *entry)
+{
+   nir_ssa_scalar scalar = { src->ssa, 0 };
+   int64_t offset = base_const;
+
+   while (true) {
+      if (nir_ssa_scalar_is_const(scalar)) {
+         offset += nir_ssa_scalar_as_int(scalar);
+         scalar.def = NULL;
+         break;
+      }
+
+      if (!nir_ssa_scalar_is_alu(scalar) ||
+          nir_ssa_scalar_alu_op(scalar) != nir_op_iadd)
+         break;
+
+      nir_ssa_scalar src0 = nir_ssa_scalar_chase_alu_src(scalar, 0);
+      nir_ssa_scalar src1 = nir_ssa_scalar_chase_alu_src(scalar, 1);
+      if (nir_ssa_scalar_is_const(src1)) {
+         offset += nir_ssa_scalar_as_int(src1);
+         scalar = src0;
+      } else if (nir_ssa_scalar_is_const(src0)) {
+         offset += nir_ssa_scalar_as_int(src0);
+         scalar = src1;
+      } else {
+         break;
+      }
+   }
+
+   entry->base = scalar;
+   entry->offset = offset;
+}
+
+static bool
+create_entry(nir_intrinsic_instr *intrin, const struct intrinsic_info *info,
+             struct entry *entry)
+{
+   if (nir_intrinsic_infos[intrin->intrinsic].index_map[NIR_INTRINSIC_ACCESS] &&
+       (nir_intrinsic_access(intrin) & ACCESS_VOLATILE))
+      return false;
+
+   if (!intrin->src[info->offset_src].is_ssa ||
+       (info->value_src >= 0 && !intrin->src[info->value_src].is_ssa) ||
+       (info->value_src < 0 && !intrin->dest.is_ssa))
+      return false;
+
+   entry->intrin = intrin;
+   entry->info = info;
+
+   int64_t base = 0;
+   if (nir_intrinsic_infos[intrin->intrinsic].index_map[NIR_INTRINSIC_BASE])
+      base = nir_intrinsic_base(intrin);
+   parse_offset(&intrin->src[info->offset_src], base, entry);
+
+   if (is_store(entry)) {
+      nir_ssa_def *value = intrin->src[info->value_src].ssa;
+      entry->bit_size = value->bit_size;
+      entry->num_components = value->num_components;
+      entry->write_mask = nir_intrinsic_write_mask(intrin);
+   } else {
+      entry->bit_size = intrin->dest.ssa.bit_size;
+      entry->num_components = intrin->dest.ssa.num_components;
+      entry->write_mask = 0;
+   }
+
+   /* Booleans have no memory layout we could reason about */
+   return entry->bit_size >= 8;
+}
+
+static bool
+may_alias(const struct entry *a, const struct entry *b)
+{
+   const nir_variable_mode physical = nir_var_mem_ssbo | nir_var_mem_global;
+
+   if (a->info->mode == b->info->mode)
+      return true;
+
+   return (a->info->mode & physical) && (b->info->mode & physical);
+}
+
+static bool
+entries_match(const struct entry *a, const struct entry *b)
+{
+   if (a->info != b->info || a->bit_size != b->bit_size)
+      return false;
+
+   if (a->base.def != b->base.def || a->base.comp != b->base.comp)
+      return false;
+
+   if (a->info->resource_src >= 0) {
+      nir_src a_res = a->intrin->src[a->info->resource_src];
+      nir_src b_res = b->intrin->src[b->info->resource_src];
+      if (nir_src_is_const(a_res) && nir_src_is_const(b_res) &&
+          a_res.ssa->num_components == 1) {
+         if (nir_src_as_uint(a_res) != nir_src_as_uint(b_res))
+            return false;
+      } else if (!nir_srcs_equal(a_res, b_res)) {
+         return false;
+      }
+   }
+
+   if (nir_intrinsic_infos[a->intrin->intrinsic].index_map[NIR_INTRINSIC_ACCESS] &&
+       nir_intrinsic_access(a->intrin) != nir_intrinsic_access(b->intrin))
+      return false;
+
+   return true;
+}
+
+static unsigned
+get_alignment(nir_intrinsic_instr *intrin, unsigned bit_size)
+{
+   unsigned align_mul = nir_intrinsic_align_mul(intrin);
+   unsigned align_offset = nir_intrinsic_align_offset(intrin);
+
+   if (!align_mul)
+      return bit_size / 8;
+
+   return align_offset ? 1 << (ffs(align_offset) - 1) : align_mul;
+}
+
+/* Builds the offset source for the combined access, which starts at "low",
+ * from the offset of "place", the access it gets inserted next to.
+ */
+static nir_ssa_def *
+get_new_offset(nir_builder *b, struct entry *place, struct entry *low)
+{
+   nir_ssa_def *offset = place->intrin->src[place->info->offset_src].ssa;
+
+   if (place == low)
+      return offset;
+
+   return nir_iadd_imm(b, offset, low->offset - place->offset);
+}
+
+static nir_intrinsic_instr *
+create_combined(nir_builder *b, struct entry *place, struct entry *low,
+                unsigned num_components)
+{
+   nir_intrinsic_instr *intrin =
+      nir_intrinsic_instr_create(b->shader, low->intrin->intrinsic);
+   const struct intrinsic_info *info = low->info;
+
+   intrin->num_components = num_components;
+   memcpy(intrin->const_index, place->intrin->const_index,
+          sizeof(intrin->const_index));
+   nir_intrinsic_set_align(intrin, nir_intrinsic_align_mul(low->intrin),
+                           nir_intrinsic_align_offset(low->intrin));
+
+   if (info->resource_src >= 0)
+      intrin->src[info->resource_src] =
+         nir_src_for_ssa(place->intrin->src[info->resource_src].ssa);
+   intrin->src[info->offset_src] = nir_src_for_ssa(get_new_offset(b, place, low));
+
+   return intrin;
+}
+
+static bool
+try_combine_loads(nir_builder *b, struct vectorize_ctx *ctx,
+                  struct entry *first, struct entry *second)
+{
+   struct entry *low = first->offset <= second->offset ? first : second;
+   struct entry *high = low == first ? second : first;
+   unsigned size = low->bit_size / 8;
+   int64_t delta = high->offset - low->offset;
+
+   if (delta % size || delta > low->num_components * size)
+      return false;
+
+   unsigned high_start = delta / size;
+   unsigned num_components =
+      MAX2(low->num_components, high_start + high->num_components);
+   if (num_components > NIR_MAX_VEC_COMPONENTS)
+      return false;
+
+   if (!ctx->callback(get_alignment(low->intrin, low->bit_size),
+                      low->bit_size, num_components, delta,
+                      low->intrin, high->intrin))
+      return false;
+
+   /* The combined load goes where the first one was so that all of the
+    * uses of both still come after it.
+    */
+   b->cursor = nir_before_instr(&first->intrin->instr);
+   nir_intrinsic_instr *load = create_combined(b, first, low, num_components);
+   nir_ssa_dest_init(&load->instr, &load->dest, num_components,
+                     low->bit_size, NULL);
+   nir_builder_instr_insert(b, &load->instr);
+
+   unsigned swiz[NIR_MAX_VEC_COMPONENTS];
+   for (unsigned i = 0; i < high->num_components; i++)
+      swiz[i] = high_start + i;
+
+   nir_ssa_def *low_def =
+      nir_channels(b, &load->dest.ssa, (1 << low->num_components) - 1);
+   nir_ssa_def *high_def =
+      nir_swizzle(b, &load->dest.ssa, swiz, high->num_components);
+
+   nir_ssa_def_rewrite_uses(&low->intrin->dest.ssa, nir_src_for_ssa(low_def));
+   nir_ssa_def_rewrite_uses(&high->intrin->dest.ssa,
+                            nir_src_for_ssa(high_def));
+
+   nir_instr_remove(&first->intrin->instr);
+   nir_instr_remove(&second->intrin->instr);
+
+   first->intrin = load;
+   first->offset = low->offset;
+   first->num_components = num_components;
+   second->intrin = NULL;
+
+   return true;
+}
+
+static bool
+try_combine_stores(nir_builder *b, struct vectorize_ctx *ctx,
+                   struct entry *first, struct entry *second)
+{
+   struct entry *low = first->offset <= second->offset ? first : second;
+   struct entry *high = low == first ? second : first;
+   unsigned size = low->bit_size / 8;
+   int64_t delta = high->offset - low->offset;
+
+   if (delta % size || delta / size >= NIR_MAX_VEC_COMPONENTS)
+      return false;
+
+   unsigned high_start = delta / size;
+   nir_component_mask_t high_mask = high->write_mask << high_start;
+   if (low->write_mask & high_mask)
+      return false;
+
+   unsigned num_components =
+      MAX2(low->num_components, high_start + high->num_components);
+   if (num_components > NIR_MAX_VEC_COMPONENTS)
+      return false;
+
+   if (!ctx->callback(get_alignment(low->intrin, low->bit_size),
+                      low->bit_size, num_components, delta,
+                      low->intrin, high->intrin))
+      return false;
+
+   /* The combined store goes where the second one was so that both values
+    * are available.
+    */
+   b->cursor = nir_before_instr(&second->intrin->instr);
+
+   nir_ssa_def *low_val = low->intrin->src[low->info->value_src].ssa;
+   nir_ssa_def *high_val = high->intrin->src[high->info->value_src].ssa;
+   nir_ssa_def *undef = NULL;
+   nir_ssa_def *comps[NIR_MAX_VEC_COMPONENTS];
+   for (unsigned i = 0; i < num_components; i++) {
+      if (low->write_mask & (1 << i)) {
+         comps[i] = nir_channel(b, low_val, i);
+      } else if (high_mask & (1 << i)) {
+         comps[i] = nir_channel(b, high_val, i - high_start);
+      } else {
+         if (!undef)
+            undef = nir_ssa_undef(b, 1, low->bit_size);
+         comps[i] = undef;
+      }
+   }
+
+   nir_intrinsic_instr *store =
+      create_combined(b, second, low, num_components);
+   nir_intrinsic_set_write_mask(store, low->write_mask | high_mask);
+   store->src[low->info->value_src] =
+      nir_src_for_ssa(nir_vec(b, comps, num_components));
+   nir_builder_instr_insert(b, &store->instr);
+
+   nir_instr_remove(&first->intrin->instr);
+   nir_instr_remove(&second->intrin->instr);
+
+   second->intrin = store;
+   second->offset = low->offset;
+   second->num_components = num_components;
+   second->write_mask = low->write_mask | high_mask;
+   first->intrin = NULL;
+
+   return true;
+}
+
+/* Whether anything between entries i and j keeps them from being combined */
+static bool
+blocked_between(struct entry *entries, unsigned i, unsigned j)
+{
+   for (unsigned k = i + 1; k < j; k++) {
+      if (!entries[k].intrin)
+         continue;
+
+      if ((is_store(&entries[i]) || is_store(&entries[k])) &&
+          may_alias(&entries[i], &entries[k]))
+         return true;
+   }
+
+   return false;
+}
+
+static bool
+vectorize_entries(nir_builder *b, struct vectorize_ctx *ctx)
+{
+   struct entry *entries = ctx->entries.data;
+   unsigned num_entries =
+      util_dynarray_num_elements(&ctx->entries, struct entry);
+   bool progress = false;
+
+   for (unsigned i = 0; i < num_entries; i++) {
+      for (unsigned j = i + 1; j < num_entries; j++) {
+         if (!entries[i].intrin)
+            break;
+
+         if (!entries[j].intrin || !entries_match(&entries[i], &entries[j]))
+            continue;
+
+         if (blocked_between(entries, i, j))
+            continue;
+
+         bool combined = is_store(&entries[i]) ?
+            try_combine_stores(b, ctx, &entries[i], &entries[j]) :
+            try_combine_loads(b, ctx, &entries[i], &entries[j]);
+
+         if (combined) {
+            progress = true;
+            /* The combined entry may now reach accesses we skipped */
+            j = i;
+         }
+      }
+   }
+
+   util_dynarray_clear(&ctx->entries);
+
+   return progress;
+}
+
+static bool
+ends_group(nir_instr *instr)
+{
+   if (instr->type == nir_instr_type_call)
+      return true;
+
+   if (instr->type != nir_instr_type_intrinsic)
+      return false;
+
+   nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
+   return !nir_intrinsic_can_reorder(intrin);
+}
+
+static bool
+vectorize_block(nir_builder *b, struct vectorize_ctx *ctx, nir_block *block)
+{
+   bool progress = false;
+
+   nir_foreach_instr_safe(instr, block) {
+      const struct intrinsic_info *info = NULL;
+      if (instr->type == nir_instr_type_intrinsic)
+         info = get_info(nir_instr_as_intrinsic(instr)->intrinsic);
+
+      if (info && (info->mode & ctx->modes)) {
+         struct entry entry;
+         if (create_entry(nir_instr_as_intrinsic(instr), info, &entry)) {
+            util_dynarray_append(&ctx->entries, struct entry, entry);
+            continue;
+         }
+      }
+
+      if (ends_group(instr))
+         progress |= vectorize_entries(b, ctx);
+   }
+
+   progress |= vectorize_entries(b, ctx);
+
+   return progress;
+}
+
+static bool
+vectorize_impl(struct vectorize_ctx *ctx, nir_function_impl *impl)
+{
+   nir_builder b;
+   nir_builder_init(&b, impl);
+
+   bool progress = false;
+   nir_foreach_block(block, impl)
+      progress |= vectorize_block(&b, ctx, block);
+
+   if (progress) {
+      nir_metadata_preserve(impl, nir_metadata_block_index |
+                                  nir_metadata_dominance);
+   } else {
+#ifndef NDEBUG
+      impl->valid_metadata &= ~nir_metadata_not_properly_reset;
+#endif
+   }
+
+   return progress;
+}
+
+bool
+nir_opt_load_store_vectorize(nir_shader *shader, nir_variable_mode modes,
+                             nir_should_vectorize_mem_func callback)
+{
+   struct vectorize_ctx ctx = {
+      .modes = modes,
+      .callback = callback,
+   };
+   util_dynarray_init(&ctx.entries, NULL);
+
+   bool progress = false;
+   nir_foreach_function(function, shader) {
+      if (function->impl)
+         progress |= vectorize_impl(&ctx, function->impl);
+   }
+
+   util_dynarray_fini(&ctx.entries);
+
+   return progress;
+}
@@ -746,6 +746,167 @@ partial_unroll(nir_shader *shader, nir_loop *loop, unsigned trip_count)
    _mesa_hash_table_destroy(remap_table, NULL);
 }
 
+/* Moves the continue-from branch of the loop's terminator after it and
+ * plucks out the header before it and the body after it, leaving the loop
+ * holding just the terminator.
+ */
+static void
+extract_header_and_body(nir_loop *loop, nir_loop_terminator *term,
+                        nir_cf_list *lp_header, nir_cf_list *lp_body)
+{
+   nir_block *first_break_block;
+   nir_block *first_continue_block;
+   get_first_blocks_in_terminator(term, &first_break_block,
+                                  &first_continue_block);
+
+   nir_cf_list continue_from_lst;
+   nir_cf_extract(&continue_from_lst, nir_before_block(first_continue_block),
+                  nir_after_block(term->continue_from_block));
+   nir_cf_reinsert(&continue_from_lst,
+                   nir_after_cf_node(&term->nif->cf_node));
+
+   nir_cf_extract(lp_header, nir_before_block(nir_loop_first_block(loop)),
+                  nir_before_cf_node(&term->nif->cf_node));
+   nir_cf_extract(lp_body, nir_after_cf_node(&term->nif->cf_node),
+                  nir_after_block(nir_loop_last_block(loop)));
+}
+
+/**
+ * Peel the first iteration off a loop with a known trip count of at least
+ * one, so that it never needs to test the terminator:
+ *
+ *     loop {
+ *         ...header...
+ *         if (cond) break;
+ *         ...body...
+ *     }
+ *
+ * becomes:
+ *
+ *     ...header... ...body...
+ *     loop {
+ *         ...header...
+ *         if (cond) break;
+ *         ...body...
+ *     }
+ */
+static void
+peel_first_iteration(nir_loop *loop)
+{
+   nir_loop_terminator *term = loop->info->limiting_terminator;
+
+   loop_prepare_for_unroll(loop);
+
+   nir_cf_list lp_header, lp_body;
+   extract_header_and_body(loop, term, &lp_header, &lp_body);
+
+   struct hash_table *remap_table = _mesa_pointer_hash_table_create(NULL);
+
+   nir_cf_list_clone_and_reinsert(&lp_header, loop->cf_node.parent,
+                                  nir_before_cf_node(&loop->cf_node),
+                                  remap_table);
+   nir_cf_list_clone_and_reinsert(&lp_body, loop->cf_node.parent,
+                                  nir_before_cf_node(&loop->cf_node),
+                                  remap_table);
+
+   nir_cf_reinsert(&lp_header, nir_before_cf_node(&term->nif->cf_node));
+   nir_cf_reinsert(&lp_body, nir_after_cf_node(&term->nif->cf_node));
+
+   _mesa_hash_table_destroy(remap_table, NULL);
+}
+
+/**
+ * Partially unroll a loop whose exact trip count is a multiple of factor.
+ * Only the first copy of the header keeps the terminator since the loop
+ * can only exit every factor iterations:
+ *
+ *     loop {
+ *         ...header...
+ *         if (cond) break;
+ *         ...body... ...header... ...body... ...header... ...body...
+ *     }
+ */
+static void
+partial_unroll_by_factor(nir_loop *loop, unsigned factor)
+{
+   nir_loop_terminator *term = loop->info->limiting_terminator;
+   assert(loop->info->max_trip_count % factor == 0);
+
+   loop_prepare_for_unroll(loop);
+
+   nir_cf_list lp_header, lp_body;
+   extract_header_and_body(loop, term, &lp_header, &lp_body);
+
+   struct hash_table *remap_table = _mesa_pointer_hash_table_create(NULL);
+
+   for (unsigned i = 1; i < factor; i++) {
+      nir_cf_list_clone_and_reinsert(&lp_header, &loop->cf_node,
+                                     nir_after_cf_list(&loop->body),
+                                     remap_table);
+      nir_cf_list_clone_and_reinsert(&lp_body, &loop->cf_node,
+                                     nir_after_cf_list(&loop->body),
+                                     remap_table);
+   }
+
+   nir_cf_reinsert(&lp_header, nir_before_cf_node(&term->nif->cf_node));
+   nir_cf_reinsert(&lp_body, nir_after_cf_node(&term->nif->cf_node));
+
+   loop->partially_unrolled = true;
+
+   _mesa_hash_table_destroy(remap_table, NULL);
+}
+
+/* Picks the largest factor allowed by the driver that divides the trip
+ * count and keeps the unrolled body within the full unrolling budget.
+ */
+static unsigned
+get_partial_unroll_factor(nir_shader *shader, nir_loop *loop)
+{
+   nir_loop_info *li = loop->info;
+   unsigned max_factor = shader->options->max_partial_unroll_factor;
+   unsigned budget = shader->options->max_unroll_iterations * LOOP_UNROLL_LIMIT;
+
+   for (unsigned factor = MIN2(max_factor, li->max_trip_count / 2);
+        factor > 1; factor--) {
+      if (li->max_trip_count % factor == 0 &&
+          li->instr_cost * factor <= budget)
+         return factor;
+   }
+
+   return 0;
+}
+
+/* Loops that are too large to unroll fully may still get their first
+ * iteration peeled or be partially unrolled.
+ */
+static bool
+try_peel_or_partial_unroll(nir_shader *shader, nir_loop *loop)
+{
+   nir_loop_info *li = loop->info;
+
+   if (!li->exact_trip_count_known || li->max_trip_count < 2 ||
+       loop->partially_unrolled ||
+       list_length(&li->loop_terminator_list) != 1 ||
+       !nir_is_trivial_loop_if(li->limiting_terminator->nif,
+                               li->limiting_terminator->break_block))
+      return false;
+
+   if (shader->options->peel_loop_first_iteration &&
+       li->peel_first_iteration &&
+       li->instr_cost <= shader->options->max_unroll_iterations *
+                         LOOP_UNROLL_LIMIT) {
+      peel_first_iteration(loop);
+      return true;
+   }
+
+   unsigned factor = get_partial_unroll_factor(shader, loop);
+   if (!factor)
+      return false;
+
+   partial_unroll_by_factor(loop, factor);
+   return true;
+}
+
 /*
  * Returns true if we should unroll the loop, otherwise false.
  */
@@ -842,8 +1003,10 @@ process_loops(nir_shader *sh, nir_cf_node *cf_node, bool *has_nested_loop_out)
       if (has_nested_loop || !loop->info->limiting_terminator)
          goto exit;
 
-      if (!check_unrolling_restrictions(sh, loop))
+      if (!check_unrolling_restrictions(sh, loop)) {
+         progress = try_peel_or_partial_unroll(sh, loop);
          goto exit;
+      }
 
       if (loop->info->exact_trip_count_known) {
          simple_unroll(loop);
@@ -153,6 +153,16 @@ sweep_function(nir_shader *nir, nir_function *f)
 void
 nir_sweep(nir_shader *nir)
 {
+   /* Instructions in an arena can't be freed one by one, and moving them
+    * would mean fixing up every pointer to them, so compact the arena by
+    * cloning the shader into a fresh one instead.
+    */
+   if (nir->instr_arena) {
+      nir_shader *clone = nir_shader_clone(ralloc_parent(nir), nir);
+      nir_shader_replace(nir, clone);
+      return;
+   }
+
    void *rubbish = ralloc_context(NULL);
 
    /* First, move ownership of all the memory to a temporary context; assume dead. */
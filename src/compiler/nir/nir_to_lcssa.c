@@ -234,7 +234,8 @@ convert_loop_exit_for_ssa(nir_ssa_def *def, void *void_state)
     * the block has predecessors.
     */
    set_foreach(block_after_loop->predecessors, entry) {
-      nir_phi_src *phi_src = ralloc(phi, nir_phi_src);
+      nir_phi_src *phi_src =
+         nir_instr_alloc_data(&phi->instr, sizeof(nir_phi_src));
       phi_src->src = nir_src_for_ssa(def);
       phi_src->pred = (nir_block *) entry->key;
 
@@ -1165,7 +1165,7 @@ validate_function(nir_function *func, validate_state *state)
 static void
 init_validate_state(validate_state *state)
 {
-   state->mem_ctx = ralloc_context(NULL);
+   state->mem_ctx = ralloc_arena_context(NULL);
    state->regs = _mesa_pointer_hash_table_create(state->mem_ctx);
    state->ssa_srcs = _mesa_pointer_set_create(state->mem_ctx);
    state->ssa_defs_found = NULL;
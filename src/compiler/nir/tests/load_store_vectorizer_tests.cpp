@@ -0,0 +1,212 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include "nir.h"
+#include "nir_builder.h"
+
+class nir_load_store_vectorize_test : public ::testing::Test {
+protected:
+   nir_load_store_vectorize_test()
+   {
+      glsl_type_singleton_init_or_ref();
+
+      mem_ctx = ralloc_context(NULL);
+      nir_builder_init_simple_shader(&b, mem_ctx, MESA_SHADER_COMPUTE,
+                                     &options);
+   }
+
+   ~nir_load_store_vectorize_test()
+   {
+      ralloc_free(mem_ctx);
+      glsl_type_singleton_decref();
+   }
+
+   static bool vec4_callback(unsigned align, unsigned bit_size,
+                             unsigned num_components, unsigned high_offset,
+                             nir_intrinsic_instr *low,
+                             nir_intrinsic_instr *high)
+   {
+      return bit_size / 8 * num_components <= 16;
+   }
+
+   bool run(nir_variable_mode modes)
+   {
+      bool progress = nir_opt_load_store_vectorize(b.shader, modes,
+                                                   vec4_callback);
+      nir_validate_shader(b.shader, "after vectorization");
+      return progress;
+   }
+
+   nir_intrinsic_instr *create_load(nir_intrinsic_op op, unsigned offset,
+                                    unsigned num_components = 1);
+   nir_intrinsic_instr *create_store(nir_intrinsic_op op, unsigned offset,
+                                     nir_ssa_def *value);
+   unsigned count_intrinsics(nir_intrinsic_op op);
+
+   const nir_shader_compiler_options options = { };
+   void *mem_ctx;
+   nir_builder b;
+};
+
+nir_intrinsic_instr *
+nir_load_store_vectorize_test::create_load(nir_intrinsic_op op,
+                                           unsigned offset,
+                                           unsigned num_components)
+{
+   nir_intrinsic_instr *load = nir_intrinsic_instr_create(b.shader, op);
+   load->num_components = num_components;
+
+   unsigned src = 0;
+   if (op != nir_intrinsic_load_shared)
+      load->src[src++] = nir_src_for_ssa(nir_imm_int(&b, 0));
+   load->src[src] = nir_src_for_ssa(nir_imm_int(&b, offset));
+
+   nir_intrinsic_set_align(load, 4, 0);
+   nir_ssa_dest_init(&load->instr, &load->dest, num_components, 32, NULL);
+   nir_builder_instr_insert(&b, &load->instr);
+
+   return load;
+}
+
+nir_intrinsic_instr *
+nir_load_store_vectorize_test::create_store(nir_intrinsic_op op,
+                                            unsigned offset,
+                                            nir_ssa_def *value)
+{
+   nir_intrinsic_instr *store = nir_intrinsic_instr_create(b.shader, op);
+   store->num_components = value->num_components;
+   store->src[0] = nir_src_for_ssa(value);
+   store->src[1] = nir_src_for_ssa(nir_imm_int(&b, 0));
+   store->src[2] = nir_src_for_ssa(nir_imm_int(&b, offset));
+
+   nir_intrinsic_set_write_mask(store, (1 << value->num_components) - 1);
+   nir_intrinsic_set_align(store, 4, 0);
+   nir_builder_instr_insert(&b, &store->instr);
+
+   return store;
+}
+
+unsigned
+nir_load_store_vectorize_test::count_intrinsics(nir_intrinsic_op op)
+{
+   unsigned count = 0;
+   nir_foreach_block(block, b.impl) {
+      nir_foreach_instr(instr, block) {
+         if (instr->type == nir_instr_type_intrinsic &&
+             nir_instr_as_intrinsic(instr)->intrinsic == op)
+            count++;
+      }
+   }
+
+   return count;
+}
+
+TEST_F(nir_load_store_vectorize_test, ubo_adjacent)
+{
+   nir_intrinsic_instr *x = create_load(nir_intrinsic_load_ubo, 0);
+   nir_intrinsic_instr *y = create_load(nir_intrinsic_load_ubo, 4, 2);
+   create_store(nir_intrinsic_store_ssbo, 0,
+                nir_iadd(&b, &x->dest.ssa, nir_channel(&b, &y->dest.ssa, 1)));
+
+   EXPECT_TRUE(run(nir_var_mem_ubo));
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ubo), 1);
+
+   nir_foreach_block(block, b.impl) {
+      nir_foreach_instr(instr, block) {
+         if (instr->type == nir_instr_type_intrinsic &&
+             nir_instr_as_intrinsic(instr)->intrinsic == nir_intrinsic_load_ubo)
+            EXPECT_EQ(nir_instr_as_intrinsic(instr)->num_components, 3);
+      }
+   }
+}
+
+TEST_F(nir_load_store_vectorize_test, ubo_too_wide)
+{
+   create_load(nir_intrinsic_load_ubo, 0, 3);
+   create_load(nir_intrinsic_load_ubo, 12, 2);
+
+   EXPECT_FALSE(run(nir_var_mem_ubo));
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ubo), 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, ubo_gap)
+{
+   create_load(nir_intrinsic_load_ubo, 0);
+   create_load(nir_intrinsic_load_ubo, 8);
+
+   EXPECT_FALSE(run(nir_var_mem_ubo));
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_store_adjacent)
+{
+   create_store(nir_intrinsic_store_ssbo, 4, nir_imm_int(&b, 1));
+   create_store(nir_intrinsic_store_ssbo, 0, nir_imm_int(&b, 2));
+   create_store(nir_intrinsic_store_ssbo, 8, nir_imm_int(&b, 3));
+
+   EXPECT_TRUE(run(nir_var_mem_ssbo));
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_store_ssbo), 1);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_across_store)
+{
+   create_load(nir_intrinsic_load_ssbo, 0);
+   create_store(nir_intrinsic_store_ssbo, 64, nir_imm_int(&b, 1));
+   create_load(nir_intrinsic_load_ssbo, 4);
+
+   EXPECT_FALSE(run(nir_var_mem_ssbo));
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_across_barrier)
+{
+   create_load(nir_intrinsic_load_ssbo, 0);
+   nir_intrinsic_instr *barrier =
+      nir_intrinsic_instr_create(b.shader, nir_intrinsic_memory_barrier);
+   nir_builder_instr_insert(&b, &barrier->instr);
+   create_load(nir_intrinsic_load_ssbo, 4);
+
+   EXPECT_FALSE(run(nir_var_mem_ssbo));
+}
+
+TEST_F(nir_load_store_vectorize_test, shared_variable_base)
+{
+   nir_ssa_def *index = nir_channel(&b, nir_load_local_invocation_id(&b), 0);
+   nir_ssa_def *base = nir_imul(&b, index, nir_imm_int(&b, 16));
+
+   nir_ssa_def *defs[4];
+   for (unsigned i = 0; i < 4; i++) {
+      nir_intrinsic_instr *load =
+         nir_intrinsic_instr_create(b.shader, nir_intrinsic_load_shared);
+      load->num_components = 1;
+      load->src[0] = nir_src_for_ssa(nir_iadd_imm(&b, base, i * 4));
+      nir_intrinsic_set_base(load, 0);
+      nir_intrinsic_set_align(load, 16, i * 4);
+      nir_ssa_dest_init(&load->instr, &load->dest, 1, 32, NULL);
+      nir_builder_instr_insert(&b, &load->instr);
+      defs[i] = &load->dest.ssa;
+   }
+   create_store(nir_intrinsic_store_ssbo, 0, nir_vec(&b, defs, 4));
+
+   EXPECT_TRUE(run(nir_var_mem_shared));
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_shared), 1);
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include "nir.h"
+#include "nir_builder.h"
+#include "nir_serialize.h"
+
+class nir_serialize_test : public ::testing::Test {
+protected:
+   nir_serialize_test()
+   {
+      glsl_type_singleton_init_or_ref();
+
+      mem_ctx = ralloc_context(NULL);
+      nir_builder_init_simple_shader(&b, mem_ctx, MESA_SHADER_COMPUTE,
+                                     &options);
+   }
+
+   ~nir_serialize_test()
+   {
+      ralloc_free(mem_ctx);
+      glsl_type_singleton_decref();
+   }
+
+   /* Serializes the shader, reads it back and serializes the copy again.
+    * The two blobs have to be identical.  Returns the copy.
+    */
+   nir_shader *round_trip(size_t *size);
+
+   const nir_shader_compiler_options options = { };
+   void *mem_ctx;
+   nir_builder b;
+};
+
+nir_shader *
+nir_serialize_test::round_trip(size_t *size)
+{
+   nir_validate_shader(b.shader, "before serialization");
+
+   struct blob first;
+   blob_init(&first);
+   nir_serialize(&first, b.shader);
+
+   struct blob_reader reader;
+   blob_reader_init(&reader, first.data, first.size);
+   nir_shader *copy = nir_deserialize(mem_ctx, &options, &reader);
+   EXPECT_FALSE(reader.overrun);
+   EXPECT_EQ(reader.current, reader.end);
+   nir_validate_shader(copy, "after deserialization");
+
+   struct blob second;
+   blob_init(&second);
+   nir_serialize(&second, copy);
+
+   EXPECT_EQ(first.size, second.size);
+   if (first.size == second.size) {
+      EXPECT_EQ(memcmp(first.data, second.data, first.size), 0);
+   }
+
+   if (size)
+      *size = first.size;
+
+   blob_finish(&first);
+   blob_finish(&second);
+
+   return copy;
+}
+
+static nir_alu_instr *
+last_alu(nir_shader *shader)
+{
+   nir_function_impl *impl = nir_shader_get_entrypoint(shader);
+   nir_block *block = nir_impl_last_block(impl);
+
+   nir_foreach_instr_reverse(instr, block) {
+      if (instr->type == nir_instr_type_alu)
+         return nir_instr_as_alu(instr);
+   }
+
+   return NULL;
+}
+
+TEST_F(nir_serialize_test, alu)
+{
+   nir_ssa_def *v = nir_imm_vec4(&b, 1.0, 2.0, 3.0, 4.0);
+   nir_ssa_def *u = nir_ssa_undef(&b, 4, 32);
+
+   b.exact = true;
+   nir_ssa_def *sum = nir_fadd(&b, v, u);
+   b.exact = false;
+
+   nir_alu_instr *fadd = nir_instr_as_alu(sum->parent_instr);
+   fadd->dest.saturate = true;
+   fadd->dest.write_mask = 0x5;
+   fadd->src[0].swizzle[0] = 3;
+   fadd->src[0].swizzle[1] = 2;
+   fadd->src[1].negate = true;
+   fadd->src[1].abs = true;
+
+   nir_shader *copy = round_trip(NULL);
+
+   nir_alu_instr *alu = last_alu(copy);
+   ASSERT_NE(alu, nullptr);
+   EXPECT_EQ(alu->op, nir_op_fadd);
+   EXPECT_TRUE(alu->exact);
+   EXPECT_TRUE(alu->dest.saturate);
+   EXPECT_EQ(alu->dest.write_mask, 0x5u);
+   EXPECT_EQ(alu->src[0].swizzle[0], 3);
+   EXPECT_EQ(alu->src[0].swizzle[1], 2);
+   EXPECT_FALSE(alu->src[0].negate);
+   EXPECT_TRUE(alu->src[1].negate);
+   EXPECT_TRUE(alu->src[1].abs);
+   EXPECT_EQ(alu->src[1].src.ssa->parent_instr->type,
+             nir_instr_type_ssa_undef);
+}
+
+TEST_F(nir_serialize_test, control_flow)
+{
+   nir_ssa_def *id = nir_channel(&b, nir_load_local_invocation_id(&b), 0);
+   nir_ssa_def *zero = nir_imm_int(&b, 0);
+
+   nir_push_loop(&b);
+   {
+      nir_push_if(&b, nir_ieq(&b, id, zero));
+      nir_jump(&b, nir_jump_break);
+      nir_pop_if(&b, NULL);
+   }
+   nir_pop_loop(&b, NULL);
+
+   nir_push_if(&b, nir_ilt(&b, id, nir_imm_int(&b, 4)));
+   nir_ssa_def *then_val = nir_iadd(&b, id, nir_imm_int(&b, 1));
+   nir_push_else(&b, NULL);
+   nir_ssa_def *else_val = nir_imul(&b, id, id);
+   nir_pop_if(&b, NULL);
+   nir_ssa_def *phi = nir_if_phi(&b, then_val, else_val);
+   nir_iadd(&b, phi, id);
+
+   nir_shader *copy = round_trip(NULL);
+
+   nir_alu_instr *alu = last_alu(copy);
+   ASSERT_NE(alu, nullptr);
+   EXPECT_EQ(alu->op, nir_op_iadd);
+   EXPECT_EQ(alu->src[0].src.ssa->parent_instr->type, nir_instr_type_phi);
+   EXPECT_EQ(alu->src[1].src.ssa->parent_instr->type,
+             nir_instr_type_alu);
+}
+
+TEST_F(nir_serialize_test, alu_size)
+{
+   /* A single-source ALU instruction with an SSA source and destination
+    * takes a header, a destination, a source and the source modifiers, one
+    * dword each.
+    */
+   nir_ssa_def *v = nir_imm_float(&b, 1.0);
+
+   size_t base_size;
+   round_trip(&base_size);
+
+   for (unsigned i = 0; i < 100; i++)
+      v = nir_fneg(&b, v);
+
+   size_t size;
+   round_trip(&size);
+
+   EXPECT_EQ(size - base_size, 100 * 4 * sizeof(uint32_t));
+}
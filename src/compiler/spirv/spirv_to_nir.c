@@ -4672,9 +4672,7 @@ spirv_to_nir(const uint32_t *words, size_t word_count,
       b->shader->info.cs.local_size[2] = const_size[2].u32;
    }
 
-   /* Set types on all vtn_values */
-   vtn_foreach_instruction(b, words, word_end, vtn_set_instruction_result_type);
-
+   /* Set types on all vtn_values and find the functions and their blocks */
    vtn_build_cfg(b, words, word_end);
 
    assert(b->entry_point->value_type == vtn_value_type_function);
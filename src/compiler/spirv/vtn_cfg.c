@@ -240,6 +240,12 @@ static bool
 vtn_cfg_handle_prepass_instruction(struct vtn_builder *b, SpvOp opcode,
                                    const uint32_t *w, unsigned count)
 {
+   /* Nothing below looks at the type of a value defined later in the
+    * module, so the result types of the function section can be recorded
+    * in this same walk instead of a separate one.
+    */
+   vtn_set_instruction_result_type(b, opcode, w, count);
+
    switch (opcode) {
    case SpvOpFunction: {
       vtn_assert(b->func == NULL);
@@ -752,13 +758,12 @@ vtn_cfg_walk_blocks(struct vtn_builder *b, struct list_head *cf_list,
 void
 vtn_build_cfg(struct vtn_builder *b, const uint32_t *words, const uint32_t *end)
 {
+   /* The structured CFG of each function is only built once the function
+    * is emitted.  A module with many entry points has a lot of functions
+    * that the one being compiled never calls.
+    */
    vtn_foreach_instruction(b, words, end,
                            vtn_cfg_handle_prepass_instruction);
-
-   foreach_list_typed(struct vtn_function, func, node, &b->functions) {
-      vtn_cfg_walk_blocks(b, &func->body, func->start_block,
-                          NULL, NULL, NULL, NULL, NULL);
-   }
 }
 
 static bool
@@ -1075,6 +1080,9 @@ void
 vtn_function_emit(struct vtn_builder *b, struct vtn_function *func,
                   vtn_instruction_handler instruction_handler)
 {
+   vtn_cfg_walk_blocks(b, &func->body, func->start_block,
+                       NULL, NULL, NULL, NULL, NULL);
+
    nir_builder_init(&b->nb, func->impl);
    b->func = func;
    b->nb.cursor = nir_after_cf_list(&func->impl->body);
@@ -29,6 +29,7 @@
 
 #include <c11/threads.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <linux/memfd.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -36,10 +37,12 @@
 #include <string.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <time.h>
 #include <unistd.h>
 #include "drm-uapi/drm.h"
 #include "drm_shim.h"
 #include "util/hash_table.h"
+#include "util/os_time.h"
 #include "util/u_atomic.h"
 
 static mtx_t handle_lock = _MTX_INITIALIZER_NP;
@@ -57,6 +60,15 @@ memfd_create(const char *name, unsigned int flags)
 /* Global state for the shim shared between libc, core, and driver. */
 struct shim_device shim_device;
 
+/* DRM_SHIM_STATS counters, indexed by ioctl number.  Core ioctls come
+ * first, then the driver's from DRM_COMMAND_BASE.
+ */
+static struct {
+   uint64_t count;
+   uint64_t time_ns;
+} ioctl_stats[DRM_COMMAND_END];
+static uint64_t bo_count, bo_bytes;
+
 static uint32_t
 uint_key_hash(const void *key)
 {
@@ -216,17 +228,26 @@ drm_shim_ioctl(int fd, unsigned long request, void *arg)
 
    assert(type == DRM_IOCTL_BASE);
 
+   ioctl_fn_t fn = NULL;
    if (nr >= DRM_COMMAND_BASE && nr < DRM_COMMAND_END) {
       int driver_nr = nr - DRM_COMMAND_BASE;
 
-      if (driver_nr < shim_device.driver_ioctl_count &&
-          shim_device.driver_ioctls[driver_nr]) {
-         return shim_device.driver_ioctls[driver_nr](fd, request, arg);
-      }
+      if (driver_nr < shim_device.driver_ioctl_count)
+         fn = shim_device.driver_ioctls[driver_nr];
    } else {
-      if (nr < ARRAY_SIZE(core_ioctls) && core_ioctls[nr]) {
-         return core_ioctls[nr](fd, request, arg);
-      }
+      if (nr < ARRAY_SIZE(core_ioctls))
+         fn = core_ioctls[nr];
+   }
+
+   if (fn) {
+      if (!drm_shim_stats)
+         return fn(fd, request, arg);
+
+      int64_t start = os_time_get_nano();
+      int ret = fn(fd, request, arg);
+      p_atomic_add(&ioctl_stats[nr].time_ns, os_time_get_nano() - start);
+      p_atomic_inc(&ioctl_stats[nr].count);
+      return ret;
    }
 
    if (nr >= DRM_COMMAND_BASE && nr < DRM_COMMAND_END) {
@@ -256,6 +277,11 @@ drm_shim_bo_init(struct shim_bo *bo, size_t size)
       fprintf(stderr, "Failed to size BO: %s\n", strerror(errno));
       abort();
    }
+
+   if (drm_shim_stats) {
+      p_atomic_inc(&bo_count);
+      p_atomic_add(&bo_bytes, size);
+   }
 }
 
 struct shim_bo *
@@ -341,3 +367,38 @@ drm_shim_mmap(struct shim_fd *shim_fd, size_t length, int prot, int flags,
 
    return mmap(NULL, length, prot, flags, bo->fd, 0);
 }
+
+/**
+ * Prints the DRM_SHIM_STATS counters.  Since the ioctls don't do any GPU
+ * work, the process CPU time per call of the driver's submit ioctl is the
+ * CPU overhead of the driver per batch.
+ */
+void
+drm_shim_print_stats(void)
+{
+   struct timespec cpu;
+   clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+   double cpu_us = cpu.tv_sec * 1e6 + cpu.tv_nsec / 1e3;
+
+   fprintf(stderr, "DRM_SHIM: %.0f us of process CPU time\n", cpu_us);
+   fprintf(stderr, "DRM_SHIM: %-12s %10s %12s %14s\n",
+           "ioctl", "calls", "shim us", "CPU us/call");
+
+   for (int nr = 0; nr < ARRAY_SIZE(ioctl_stats); nr++) {
+      if (!ioctl_stats[nr].count)
+         continue;
+
+      char name[16];
+      if (nr >= DRM_COMMAND_BASE)
+         snprintf(name, sizeof(name), "driver 0x%02x", nr - DRM_COMMAND_BASE);
+      else
+         snprintf(name, sizeof(name), "core 0x%02x", nr);
+
+      fprintf(stderr, "DRM_SHIM: %-12s %10"PRIu64" %12.0f %14.3f\n",
+              name, ioctl_stats[nr].count, ioctl_stats[nr].time_ns / 1e3,
+              cpu_us / ioctl_stats[nr].count);
+   }
+
+   fprintf(stderr, "DRM_SHIM: %"PRIu64" BOs created, %"PRIu64" bytes\n",
+           bo_count, bo_bytes);
+}
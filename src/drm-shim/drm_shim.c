@@ -57,6 +57,7 @@
 static mtx_t shim_lock = _MTX_INITIALIZER_NP;
 struct set *opendir_set;
 bool drm_shim_debug;
+bool drm_shim_stats;
 
 /* If /dev/dri doesn't exist, we'll need an arbitrary pointer that wouldn't be
  * returned by any other opendir() call so we can return just our fake node.
@@ -148,6 +149,9 @@ drm_shim_override_file(const char *contents, const char *path_format, ...)
 static void
 destroy_shim(void)
 {
+   if (drm_shim_stats)
+      drm_shim_print_stats();
+
    _mesa_set_destroy(opendir_set, NULL);
    free(render_node_path);
    free(render_node_dirent_name);
@@ -162,6 +166,7 @@ init_shim(void)
 {
    static bool inited = false;
    drm_shim_debug = debug_get_bool_option("DRM_SHIM_DEBUG", false);
+   drm_shim_stats = debug_get_bool_option("DRM_SHIM_STATS", false);
 
    /* We can't lock this, because we recurse during initialization. */
    if (inited)
@@ -63,7 +63,9 @@ struct shim_bo {
 
 /* Core support. */
 extern int render_node_minor;
+extern bool drm_shim_stats;
 void drm_shim_device_init(void);
+void drm_shim_print_stats(void);
 void drm_shim_override_file(const char *contents,
                             const char *path_format, ...) PRINTFLIKE(2, 3);
 void drm_shim_fd_register(int fd, struct shim_fd *shim_fd);
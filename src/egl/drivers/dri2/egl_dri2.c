@@ -62,6 +62,7 @@
 #include "egl_dri2.h"
 #include "GL/mesa_glinterop.h"
 #include "loader/loader.h"
+#include "util/os_time.h"
 #include "util/u_atomic.h"
 #include "util/u_vector.h"
 #include "mapi/glapi/glapi.h"
@@ -549,6 +550,7 @@ static const struct dri2_extension_match swrast_core_extensions[] = {
 
 static const struct dri2_extension_match optional_driver_extensions[] = {
    { __DRI_CONFIG_OPTIONS, 1, offsetof(struct dri2_egl_display, configOptions) },
+   { __DRI_COPY_SUB_BUFFER, 1, offsetof(struct dri2_egl_display, copy_sub_buffer) },
    { NULL, 0, 0 }
 };
 
@@ -979,6 +981,8 @@ dri2_initialize(_EGLDriver *drv, _EGLDisplay *disp)
 
    loader_set_logger(_eglLog);
 
+   int64_t start = os_time_get_nano();
+
    switch (disp->Platform) {
    case _EGL_PLATFORM_SURFACELESS:
       ret = dri2_initialize_surfaceless(drv, disp);
@@ -1003,6 +1007,10 @@ dri2_initialize(_EGLDriver *drv, _EGLDisplay *disp)
       return EGL_FALSE;
    }
 
+   _eglLog(_EGL_DEBUG, "DRI2: display initialization %s after %.3f ms",
+           ret ? "succeeded" : "failed",
+           (os_time_get_nano() - start) / 1000000.0);
+
    if (!ret)
       return EGL_FALSE;
 
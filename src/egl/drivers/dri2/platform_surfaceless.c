@@ -36,6 +36,7 @@
 #include "egl_dri2.h"
 #include "egl_dri2_fallbacks.h"
 #include "loader.h"
+#include "util/os_time.h"
 
 static __DRIimage*
 surfaceless_alloc_image(struct dri2_egl_display *dri2_dpy,
@@ -283,7 +284,10 @@ surfaceless_probe_device(_EGLDisplay *disp, bool swrast)
       if (dri2_dpy->fd < 0)
          continue;
 
-      disp->Device = _eglAddDevice(dri2_dpy->fd, swrast);
+      if (swrast)
+         disp->Device = _eglAddDevice(dri2_dpy->fd, true);
+      else
+         disp->Device = _eglAddEnumeratedDevice(&devices[i]);
       if (!disp->Device) {
          close(dri2_dpy->fd);
          dri2_dpy->fd = -1;
@@ -307,7 +311,14 @@ surfaceless_probe_device(_EGLDisplay *disp, bool swrast)
          dri2_dpy->driver_name = driver_name;
       }
 
-      if (dri2_dpy->driver_name && dri2_load_driver_dri3(disp))
+      int64_t start = os_time_get_nano();
+      bool loaded = dri2_dpy->driver_name && dri2_load_driver_dri3(disp);
+
+      _eglLog(_EGL_DEBUG, "surfaceless: probing %s with %s took %.3f ms",
+              device->nodes[node_type],
+              dri2_dpy->driver_name ? dri2_dpy->driver_name : "no driver",
+              (os_time_get_nano() - start) / 1000000.0);
+      if (loaded)
          break;
 
       free(dri2_dpy->driver_name);
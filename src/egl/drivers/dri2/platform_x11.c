@@ -143,8 +143,14 @@ swrastGetDrawableInfo(__DRIdrawable * draw,
                       int *x, int *y, int *w, int *h,
                       void *loaderPrivate)
 {
+   struct dri2_egl_surface *dri2_surf = loaderPrivate;
+
    *x = *y = *w = *h = 0;
-   x11_get_drawable_info(draw, x, y, w, h, loaderPrivate);
+   if (x11_get_drawable_info(draw, x, y, w, h, loaderPrivate)) {
+      /* The driver sizes its back buffer from this. */
+      dri2_surf->base.Width = *w;
+      dri2_surf->base.Height = *h;
+   }
 }
 
 static void
@@ -173,6 +179,32 @@ swrastPutImage(__DRIdrawable * draw, int op,
                  w*h*dri2_surf->bytes_per_pixel, (const uint8_t *)data);
 }
 
+static void
+swrastPutImage2(__DRIdrawable * draw, int op,
+                int x, int y, int w, int h, int stride,
+                char *data, void *loaderPrivate)
+{
+   struct dri2_egl_surface *dri2_surf = loaderPrivate;
+   int row_size = w * dri2_surf->bytes_per_pixel;
+   char *packed;
+
+   if (stride == row_size) {
+      swrastPutImage(draw, op, x, y, w, h, data, loaderPrivate);
+      return;
+   }
+
+   /* A sub-rectangle of the back buffer: X wants its rows packed. */
+   packed = malloc(row_size * h);
+   if (!packed)
+      return;
+
+   for (int i = 0; i < h; i++)
+      memcpy(packed + i * row_size, data + i * stride, row_size);
+
+   swrastPutImage(draw, op, x, y, w, h, packed, loaderPrivate);
+   free(packed);
+}
+
 static void
 swrastGetImage(__DRIdrawable * read,
                int x, int y, int w, int h,
@@ -1038,6 +1070,41 @@ dri2_x11_swap_buffers(_EGLDriver *drv, _EGLDisplay *disp, _EGLSurface *draw)
    return EGL_TRUE;
 }
 
+/**
+ * Only put the damaged rectangles of the back buffer into the window,
+ * instead of the whole of it.
+ *
+ * The partial copies don't make the driver look at the window size again
+ * like a full swap does, so fall back to one whenever the window has been
+ * resized since the back buffer was allocated.
+ */
+static EGLBoolean
+dri2_x11_swrast_swap_buffers_with_damage(_EGLDriver *drv, _EGLDisplay *disp,
+                                         _EGLSurface *draw,
+                                         const EGLint *rects, EGLint n_rects)
+{
+   struct dri2_egl_display *dri2_dpy = dri2_egl_display(disp);
+   struct dri2_egl_surface *dri2_surf = dri2_egl_surface(draw);
+   int x, y, w, h;
+
+   if (n_rects == 0 || draw->Type != EGL_WINDOW_BIT ||
+       !x11_get_drawable_info(dri2_surf->dri_drawable, &x, &y, &w, &h,
+                              dri2_surf) ||
+       w != draw->Width || h != draw->Height)
+      return dri2_x11_swap_buffers(drv, disp, draw);
+
+   /* Both EGL and copySubBuffer have the origin in the bottom left. */
+   for (int i = 0; i < n_rects; i++) {
+      const EGLint *rect = &rects[i * 4];
+
+      dri2_dpy->copy_sub_buffer->copySubBuffer(dri2_surf->dri_drawable,
+                                               rect[0], rect[1],
+                                               rect[2], rect[3]);
+   }
+
+   return EGL_TRUE;
+}
+
 static EGLBoolean
 dri2_x11_swap_buffers_region(_EGLDriver *drv, _EGLDisplay *disp,
                              _EGLSurface *draw,
@@ -1270,6 +1337,7 @@ static const struct dri2_egl_display_vtbl dri2_x11_swrast_display_vtbl = {
    .destroy_surface = dri2_x11_destroy_surface,
    .create_image = dri2_create_image_khr,
    .swap_buffers = dri2_x11_swap_buffers,
+   .swap_buffers_with_damage = dri2_x11_swrast_swap_buffers_with_damage,
    .swap_buffers_region = dri2_fallback_swap_buffers_region,
    .post_sub_buffer = dri2_fallback_post_sub_buffer,
    /* XXX: should really implement this since X11 has pixmaps */
@@ -1302,11 +1370,12 @@ static const struct dri2_egl_display_vtbl dri2_x11_display_vtbl = {
 };
 
 static const __DRIswrastLoaderExtension swrast_loader_extension = {
-   .base = { __DRI_SWRAST_LOADER, 1 },
+   .base = { __DRI_SWRAST_LOADER, 2 },
 
    .getDrawableInfo = swrastGetDrawableInfo,
    .putImage        = swrastPutImage,
    .getImage        = swrastGetImage,
+   .putImage2       = swrastPutImage2,
 };
 
 static const __DRIextension *swrast_loader_extensions[] = {
@@ -1407,6 +1476,9 @@ dri2_initialize_x11_swrast(_EGLDriver *drv, _EGLDisplay *disp)
 
    dri2_setup_screen(disp);
 
+   if (dri2_dpy->copy_sub_buffer)
+      disp->Extensions.EXT_swap_buffers_with_damage = EGL_TRUE;
+
    if (!dri2_x11_add_configs_for_visuals(dri2_dpy, disp, true, false))
       goto cleanup;
 
@@ -149,6 +149,27 @@ _eglAddDRMDevice(drmDevicePtr device, _EGLDevice **out_dev)
 }
 #endif
 
+#ifdef HAVE_LIBDRM
+/* Adds a device from a drmGetDevices2() list in DeviceList, if needed,
+ * which saves _eglAddDevice() looking its information up again.
+ *
+ * The list takes ownership of *device when it keeps it, and *device is then
+ * set to NULL.
+ */
+_EGLDevice *
+_eglAddEnumeratedDevice(drmDevicePtr *device)
+{
+   _EGLDevice *dev = NULL;
+
+   mtx_lock(_eglGlobal.Mutex);
+   if (_eglAddDRMDevice(*device, &dev) == 0)
+      *device = NULL;
+   mtx_unlock(_eglGlobal.Mutex);
+
+   return dev;
+}
+#endif
+
 /* Adds a device in DeviceList, if needed for the given fd.
  *
  * If a software device, the fd is ignored.
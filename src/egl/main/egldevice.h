@@ -58,6 +58,13 @@ _eglLookupDevice(EGLDeviceEXT device)
 _EGLDevice *
 _eglAddDevice(int fd, bool software);
 
+#ifdef HAVE_LIBDRM
+struct _drmDevice;
+
+_EGLDevice *
+_eglAddEnumeratedDevice(struct _drmDevice **device);
+#endif
+
 enum _egl_device_extension {
    _EGL_DEVICE_SOFTWARE,
    _EGL_DEVICE_DRM,
@@ -58,6 +58,7 @@ struct ir3_compiler * ir3_compiler_create(struct fd_device *dev, uint32_t gpu_id
 
 	if (compiler->gpu_id >= 600) {
 		compiler->samgq_workaround = true;
+		compiler->reg_size_vec4 = 96;
 	}
 
 	if (compiler->gpu_id >= 400) {
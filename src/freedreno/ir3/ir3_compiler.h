@@ -30,6 +30,7 @@
 #include "ir3_shader.h"
 
 struct ir3_ra_reg_set;
+struct disk_cache;
 
 struct ir3_compiler {
 	struct fd_device *dev;
@@ -37,6 +38,9 @@ struct ir3_compiler {
 	struct ir3_ra_reg_set *set;
 	uint32_t shader_count;
 
+	/* on-disk variant cache, if the driver set one up: */
+	struct disk_cache *disk_cache;
+
 	/*
 	 * Configuration options for things that are handled differently on
 	 * different generations:
@@ -67,6 +71,12 @@ struct ir3_compiler {
 	/* on a6xx, rewrite samgp to sequence of samgq0-3 in vertex shaders:
 	 */
 	bool samgq_workaround;
+
+	/* size of the register file shared by the waves on a SP, in vec4
+	 * registers, so the # of waves in flight is roughly this divided by
+	 * the per-thread footprint.  Zero if we don't know:
+	 */
+	uint32_t reg_size_vec4;
 };
 
 struct ir3_compiler * ir3_compiler_create(struct fd_device *dev, uint32_t gpu_id);
@@ -74,6 +84,14 @@ struct ir3_compiler * ir3_compiler_create(struct fd_device *dev, uint32_t gpu_id
 int ir3_compile_shader_nir(struct ir3_compiler *compiler,
 		struct ir3_shader_variant *so);
 
+void ir3_disk_cache_init(struct ir3_compiler *compiler);
+void ir3_disk_cache_init_shader_key(struct ir3_compiler *compiler,
+		struct ir3_shader *shader);
+void * ir3_disk_cache_retrieve(struct ir3_shader *shader,
+		struct ir3_shader_variant *v);
+void ir3_disk_cache_store(struct ir3_shader *shader,
+		struct ir3_shader_variant *v, const void *bin);
+
 /* gpu pointer size in units of 32bit registers/slots */
 static inline
 unsigned ir3_pointer_size(struct ir3_compiler *compiler)
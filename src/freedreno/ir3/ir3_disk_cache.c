@@ -0,0 +1,262 @@
+/*
+ * Copyright © 2019 Google, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "compiler/blob.h"
+#include "compiler/nir/nir_serialize.h"
+#include "util/debug.h"
+#include "util/disk_cache.h"
+#include "util/mesa-sha1.h"
+#include "util/u_debug.h"
+
+#include "ir3_compiler.h"
+#include "ir3_shader.h"
+
+/*
+ * Shader variant disk cache.
+ *
+ * A variant is keyed by the hash of the shader's NIR (after the
+ * key-independent optimizations done at shader creation), the variant
+ * key and the streamout info.  Binning pass variants also hash the
+ * inputs of their non-binning variant, since RA matches its registers.
+ *
+ * Immediates are allocated in the const_state shared by all variants of
+ * a shader, so each entry also records the immediates which existed once
+ * it was compiled.  An entry can only be used when the immediates we have
+ * so far are a prefix of those.
+ */
+
+static bool debug = false;
+
+void
+ir3_disk_cache_init(struct ir3_compiler *compiler)
+{
+#ifdef ENABLE_SHADER_CACHE
+	if (env_var_as_boolean("IR3_DISABLE_SHADER_CACHE", false))
+		return;
+
+	/* array length = print length + nul char + 1 extra to verify it's unused */
+	char renderer[7];
+	ASSERTED int len =
+		snprintf(renderer, sizeof(renderer), "FD%03d", compiler->gpu_id);
+	assert(len == sizeof(renderer) - 2);
+
+	uint32_t mesa_timestamp;
+	if (!disk_cache_get_function_timestamp(ir3_disk_cache_init,
+			&mesa_timestamp))
+		return;
+
+	char timestamp[9];
+	snprintf(timestamp, sizeof(timestamp), "%08x", mesa_timestamp);
+
+	/* Only the debug options which change the generated code: */
+	uint64_t driver_flags =
+		ir3_shader_debug & (IR3_DBG_FORCES2EN | IR3_DBG_NOUBOOPT);
+
+	compiler->disk_cache = disk_cache_create(renderer, timestamp, driver_flags);
+#endif
+}
+
+void
+ir3_disk_cache_init_shader_key(struct ir3_compiler *compiler,
+		struct ir3_shader *shader)
+{
+	if (!compiler->disk_cache)
+		return;
+
+	struct blob blob;
+	blob_init(&blob);
+	nir_serialize(&blob, shader->nir);
+	_mesa_sha1_compute(blob.data, blob.size, shader->cache_key);
+	blob_finish(&blob);
+}
+
+static void
+compute_variant_key(struct ir3_shader *shader, struct ir3_shader_variant *v,
+		cache_key cache_key)
+{
+	struct blob blob;
+	blob_init(&blob);
+
+	blob_write_bytes(&blob, shader->cache_key, sizeof(shader->cache_key));
+	blob_write_bytes(&blob, &v->key, sizeof(v->key));
+	blob_write_uint32(&blob, v->binning_pass);
+	blob_write_bytes(&blob, &shader->stream_output,
+			sizeof(shader->stream_output));
+
+	if (v->binning_pass) {
+		blob_write_bytes(&blob, v->nonbinning->inputs,
+				sizeof(v->nonbinning->inputs));
+	}
+
+	disk_cache_compute_key(shader->compiler->disk_cache, blob.data, blob.size,
+			cache_key);
+	blob_finish(&blob);
+}
+
+/* The part of the variant filled in by the compiler, minus the bo and
+ * linked list pointers which come before and after it:
+ */
+#define VARIANT_CACHE_START offsetof(struct ir3_shader_variant, info)
+#define VARIANT_CACHE_END   offsetof(struct ir3_shader_variant, next)
+#define VARIANT_CACHE_SIZE  (VARIANT_CACHE_END - VARIANT_CACHE_START)
+
+static bool
+restore_immediates(struct ir3_const_state *const_state,
+		struct blob_reader *blob)
+{
+	unsigned immediate_idx = blob_read_uint32(blob);
+	unsigned immediates_count = blob_read_uint32(blob);
+	const uint32_t (*imm)[4] = blob_read_bytes(blob,
+			immediates_count * sizeof(imm[0]));
+
+	if (blob->overrun || immediate_idx < const_state->immediate_idx)
+		return false;
+
+	for (unsigned i = 0; i < const_state->immediate_idx; i++) {
+		if (const_state->immediates[i / 4].val[i % 4] != imm[i / 4][i % 4])
+			return false;
+	}
+
+	if (immediates_count > const_state->immediates_size) {
+		const_state->immediates_size = immediates_count;
+		const_state->immediates = realloc(const_state->immediates,
+				immediates_count * sizeof(const_state->immediates[0]));
+	}
+
+	memcpy(const_state->immediates, imm, immediates_count * sizeof(imm[0]));
+	const_state->immediate_idx = immediate_idx;
+	const_state->immediates_count = immediates_count;
+
+	return true;
+}
+
+/**
+ * Look up a variant in the disk cache, filling in everything the compiler
+ * and assembler would.  Returns the binary, to be freed by the caller,
+ * or NULL on a miss.
+ */
+void *
+ir3_disk_cache_retrieve(struct ir3_shader *shader,
+		struct ir3_shader_variant *v)
+{
+#ifdef ENABLE_SHADER_CACHE
+	struct disk_cache *cache = shader->compiler->disk_cache;
+
+	if (!cache)
+		return NULL;
+
+	cache_key cache_key;
+	compute_variant_key(shader, v, cache_key);
+
+	if (debug) {
+		char sha1[41];
+		_mesa_sha1_format(sha1, cache_key);
+		fprintf(stderr, "[mesa disk cache] retrieving %s: ", sha1);
+	}
+
+	size_t size;
+	void *buffer = disk_cache_get(cache, cache_key, &size);
+
+	if (debug)
+		fprintf(stderr, "%s\n", buffer ? "found" : "missing");
+
+	if (!buffer)
+		return NULL;
+
+	struct blob_reader blob;
+	blob_reader_init(&blob, buffer, size);
+
+	/* We read the following data from the cache blob:
+	 *
+	 * 1. The compiler-filled part of the variant
+	 * 2. The shader's immediates, as of the compile
+	 * 3. Assembly
+	 */
+	const void *data = blob_read_bytes(&blob, VARIANT_CACHE_SIZE);
+	if (blob.overrun)
+		goto miss;
+
+	struct ir3_shader_variant tmp;
+	memcpy((char *)&tmp + VARIANT_CACHE_START, data, VARIANT_CACHE_SIZE);
+
+	if (!restore_immediates(&shader->const_state, &blob))
+		goto miss;
+
+	unsigned sz = tmp.info.sizedwords * 4;
+	const void *bin_data = blob_read_bytes(&blob, sz);
+	if (blob.overrun)
+		goto miss;
+
+	memcpy((char *)v + VARIANT_CACHE_START, data, VARIANT_CACHE_SIZE);
+	v->ir = NULL;
+
+	void *bin = malloc(sz);
+	memcpy(bin, bin_data, sz);
+	free(buffer);
+	return bin;
+
+miss:
+	free(buffer);
+#endif
+	return NULL;
+}
+
+/**
+ * Store a newly compiled variant and its binary in the disk cache.
+ */
+void
+ir3_disk_cache_store(struct ir3_shader *shader,
+		struct ir3_shader_variant *v, const void *bin)
+{
+#ifdef ENABLE_SHADER_CACHE
+	struct disk_cache *cache = shader->compiler->disk_cache;
+	const struct ir3_const_state *const_state = &shader->const_state;
+
+	if (!cache)
+		return;
+
+	cache_key cache_key;
+	compute_variant_key(shader, v, cache_key);
+
+	if (debug) {
+		char sha1[41];
+		_mesa_sha1_format(sha1, cache_key);
+		fprintf(stderr, "[mesa disk cache] storing %s\n", sha1);
+	}
+
+	struct blob blob;
+	blob_init(&blob);
+
+	blob_write_bytes(&blob, (char *)v + VARIANT_CACHE_START,
+			VARIANT_CACHE_SIZE);
+	blob_write_uint32(&blob, const_state->immediate_idx);
+	blob_write_uint32(&blob, const_state->immediates_count);
+	blob_write_bytes(&blob, const_state->immediates,
+			const_state->immediates_count *
+			sizeof(const_state->immediates[0]));
+	blob_write_bytes(&blob, bin, v->info.sizedwords * 4);
+
+	disk_cache_put(cache, cache_key, blob.data, blob.size, NULL);
+	blob_finish(&blob);
+#endif
+}
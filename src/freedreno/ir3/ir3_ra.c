@@ -879,6 +879,65 @@ print_bitset(const char *name, BITSET_WORD *bs, unsigned cnt)
 	debug_printf("\n");
 }
 
+/* live range of a ra name, for building the interference graph: */
+struct ir3_ra_interval {
+	unsigned start, end, name;
+};
+
+static int
+interval_cmp(const void *a, const void *b)
+{
+	const struct ir3_ra_interval *ia = a, *ib = b;
+	return (ia->start > ib->start) - (ia->start < ib->start);
+}
+
+/* Add interference between every pair of names with intersecting live
+ * ranges.  Rather than testing all pairs, which gets expensive with the
+ * thousands of names in large shaders, sweep over the ranges in order of
+ * their start while keeping a list of the ones which haven't ended yet.
+ * Once a range has ended before the current start, it cannot intersect
+ * any later one either.
+ */
+static void
+ra_add_range_interference(struct ir3_ra_ctx *ctx)
+{
+	struct ir3_ra_interval *intervals =
+		ralloc_array(ctx->g, struct ir3_ra_interval, ctx->alloc_count);
+	unsigned *active = ralloc_array(ctx->g, unsigned, ctx->alloc_count);
+	unsigned nactive = 0;
+
+	for (unsigned i = 0; i < ctx->alloc_count; i++) {
+		intervals[i].start = ctx->def[i];
+		intervals[i].end = ctx->use[i];
+		intervals[i].name = i;
+	}
+
+	qsort(intervals, ctx->alloc_count, sizeof(intervals[0]), interval_cmp);
+
+	for (unsigned i = 0; i < ctx->alloc_count; i++) {
+		struct ir3_ra_interval *cur = &intervals[i];
+		unsigned n = 0;
+
+		for (unsigned j = 0; j < nactive; j++) {
+			struct ir3_ra_interval *other = &intervals[active[j]];
+
+			if (other->end <= cur->start)
+				continue;
+
+			active[n++] = active[j];
+
+			if (intersects(cur->start, cur->end, other->start, other->end))
+				ra_add_node_interference(ctx->g, cur->name, other->name);
+		}
+
+		nactive = n;
+		active[nactive++] = i;
+	}
+
+	ralloc_free(active);
+	ralloc_free(intervals);
+}
+
 static void
 ra_add_interference(struct ir3_ra_ctx *ctx)
 {
@@ -957,14 +1016,7 @@ ra_add_interference(struct ir3_ra_ctx *ctx)
 		ctx->use[name] = ctx->instr_cnt;
 	}
 
-	for (unsigned i = 0; i < ctx->alloc_count; i++) {
-		for (unsigned j = 0; j < ctx->alloc_count; j++) {
-			if (intersects(ctx->def[i], ctx->use[i],
-					ctx->def[j], ctx->use[j])) {
-				ra_add_node_interference(ctx->g, i, j);
-			}
-		}
-	}
+	ra_add_range_interference(ctx);
 }
 
 /* some instructions need fix-up if dst register is half precision: */
@@ -28,6 +28,7 @@
 #include "util/u_math.h"
 
 #include "ir3.h"
+#include "ir3_compiler.h"
 
 /*
  * Instruction Scheduling:
@@ -56,6 +57,8 @@ struct ir3_sched_ctx {
 	struct ir3_instruction *addr;      /* current a0.x user, if any */
 	struct ir3_instruction *pred;      /* current p0.x user, if any */
 	int live_values;                   /* estimate of current live values */
+	int soft_live_limit;               /* start trading latency for pressure */
+	int hard_live_limit;               /* only schedule for pressure */
 	bool error;
 };
 
@@ -624,7 +627,7 @@ find_eligible_instr(struct ir3_sched_ctx *ctx, struct ir3_sched_notes *notes,
 		if (le >= 1) {
 			unsigned threshold;
 
-			if (ctx->live_values > 4*4) {
+			if (ctx->live_values > ctx->soft_live_limit) {
 				threshold = 4;
 			} else {
 				threshold = 6;
@@ -649,12 +652,15 @@ find_eligible_instr(struct ir3_sched_ctx *ctx, struct ir3_sched_notes *notes,
 		int rank = delay_calc(ctx->block, candidate, soft, false);
 
 		/* if too many live values, prioritize instructions that reduce the
-		 * number of live values:
+		 * number of live values, increasingly so as we approach the point
+		 * where we would lose occupancy:
 		 */
-		if (ctx->live_values > 16*4) {
+		if (ctx->live_values > ctx->hard_live_limit) {
 			rank = le;
-		} else if (ctx->live_values > 4*4) {
-			rank += le;
+		} else if (ctx->live_values > ctx->soft_live_limit) {
+			int range = ctx->hard_live_limit - ctx->soft_live_limit;
+			int over = ctx->live_values - ctx->soft_live_limit;
+			rank += le * (1 + (3 * over) / range);
 		}
 
 		if (rank < best_rank) {
@@ -939,10 +945,34 @@ sched_intra_block(struct ir3_sched_ctx *ctx, struct ir3_block *block)
 	}
 }
 
+/* Pick the live value limits (in scalar registers) for the scheduler.
+ * Where we know the register file size, the hard limit is the footprint
+ * at which we'd drop below a target # of waves.  Compute shaders tend to
+ * be occupancy bound (and have nothing else running on the SP to hide
+ * their latency), so they get a higher target.
+ */
+static void
+setup_live_limits(struct ir3_sched_ctx *ctx, struct ir3 *ir)
+{
+	unsigned reg_size_vec4 = ir->compiler->reg_size_vec4;
+
+	ctx->soft_live_limit = 4 * 4;
+	ctx->hard_live_limit = 16 * 4;
+
+	if (reg_size_vec4) {
+		unsigned target_waves = (ir->type == MESA_SHADER_COMPUTE) ? 8 : 6;
+		ctx->hard_live_limit = 4 * (reg_size_vec4 / target_waves);
+	}
+
+	debug_assert(ctx->hard_live_limit > ctx->soft_live_limit);
+}
+
 int ir3_sched(struct ir3 *ir)
 {
 	struct ir3_sched_ctx ctx = {0};
 
+	setup_live_limits(&ctx, ir);
+
 	ir3_clear_mark(ir);
 	update_use_count(ir);
 
@@ -138,15 +138,11 @@ void * ir3_shader_assemble(struct ir3_shader_variant *v, uint32_t gpu_id)
 }
 
 static void
-assemble_variant(struct ir3_shader_variant *v)
+upload_variant(struct ir3_shader_variant *v, uint32_t *bin)
 {
 	struct ir3_compiler *compiler = v->shader->compiler;
 	struct shader_info *info = &v->shader->nir->info;
-	uint32_t gpu_id = compiler->gpu_id;
-	uint32_t sz, *bin;
-
-	bin = ir3_shader_assemble(v, gpu_id);
-	sz = v->info.sizedwords * 4;
+	uint32_t sz = v->info.sizedwords * 4;
 
 	v->bo = fd_bo_new(compiler->dev, sz,
 			DRM_FREEDRENO_GEM_CACHE_WCOMBINE |
@@ -154,6 +150,19 @@ assemble_variant(struct ir3_shader_variant *v)
 			"%s:%s", ir3_shader_stage(v->shader), info->name);
 
 	memcpy(fd_bo_map(v->bo), bin, sz);
+}
+
+static void
+assemble_variant(struct ir3_shader_variant *v)
+{
+	struct ir3_compiler *compiler = v->shader->compiler;
+	uint32_t gpu_id = compiler->gpu_id;
+	uint32_t *bin;
+
+	bin = ir3_shader_assemble(v, gpu_id);
+
+	upload_variant(v, bin);
+	ir3_disk_cache_store(v->shader, v, bin);
 
 	if (ir3_shader_debug & IR3_DBG_DISASM) {
 		struct ir3_shader_key key = v->key;
@@ -200,6 +209,17 @@ create_variant(struct ir3_shader *shader, struct ir3_shader_key *key,
 	v->key = *key;
 	v->type = shader->type;
 
+	/* skip the cache when asked to dump the shader: */
+	if (!(ir3_shader_debug & IR3_DBG_DISASM) &&
+			!shader_debug_enabled(shader->type)) {
+		uint32_t *bin = ir3_disk_cache_retrieve(shader, v);
+		if (bin) {
+			upload_variant(v, bin);
+			free(bin);
+			return v;
+		}
+	}
+
 	ret = ir3_compile_shader_nir(shader->compiler, v);
 	if (ret) {
 		debug_error("compile failed!");
@@ -307,6 +327,7 @@ ir3_shader_from_nir(struct ir3_compiler *compiler, nir_shader *nir)
 	ir3_optimize_nir(shader, nir, NULL);
 
 	shader->nir = nir;
+	ir3_disk_cache_init_shader_key(compiler, shader);
 	if (ir3_shader_debug & IR3_DBG_DISASM) {
 		printf("dump nir%d: type=%d", shader->id, shader->type);
 		nir_print_shader(shader->nir, stdout);
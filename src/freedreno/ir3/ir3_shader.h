@@ -548,6 +548,9 @@ struct ir3_shader {
 	struct nir_shader *nir;
 	struct ir3_stream_output_info stream_output;
 
+	/* sha1 of the serialized nir, for the disk cache: */
+	uint8_t cache_key[20];
+
 	struct ir3_shader_variant *variants;
 	mtx_t variants_lock;
 };
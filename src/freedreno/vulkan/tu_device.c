@@ -1091,6 +1091,15 @@ tu_CreateDevice(VkPhysicalDevice physicalDevice,
    if (!device->compiler)
       goto fail;
 
+   /* The NIR and ir3 dumps of the different stages would get interleaved. */
+   long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+   if (num_cpus > 1 &&
+       !(device->instance->debug_flags & (TU_DEBUG_NIR | TU_DEBUG_IR3))) {
+      util_queue_init(&device->compile_queue, "tu_compile", 8,
+                      MIN2(num_cpus, MESA_SHADER_STAGES),
+                      UTIL_QUEUE_INIT_RESIZE_IF_FULL);
+   }
+
    VkPipelineCacheCreateInfo ci;
    ci.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
    ci.pNext = NULL;
@@ -1116,6 +1125,9 @@ fail:
          vk_free(&device->alloc, device->queues[i]);
    }
 
+   if (util_queue_is_initialized(&device->compile_queue))
+      util_queue_destroy(&device->compile_queue);
+
    if (device->compiler)
       ralloc_free(device->compiler);
 
@@ -1138,6 +1150,9 @@ tu_DestroyDevice(VkDevice _device, const VkAllocationCallbacks *pAllocator)
          vk_free(&device->alloc, device->queues[i]);
    }
 
+   if (util_queue_is_initialized(&device->compile_queue))
+      util_queue_destroy(&device->compile_queue);
+
    /* the compiler does not use pAllocator */
    ralloc_free(device->compiler);
 
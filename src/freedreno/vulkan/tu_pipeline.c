@@ -1393,9 +1393,41 @@ tu_pipeline_builder_create_pipeline(struct tu_pipeline_builder *builder,
    return VK_SUCCESS;
 }
 
+struct tu_shader_compile_job
+{
+   struct tu_pipeline_builder *builder;
+   gl_shader_stage stage;
+   const VkPipelineShaderStageCreateInfo *stage_info;
+   const struct tu_shader_compile_options *options;
+
+   struct tu_shader *shader;
+   VkResult result;
+
+   struct util_queue_fence fence;
+};
+
+static void
+tu_shader_compile_job_execute(void *data, int thread_index)
+{
+   struct tu_shader_compile_job *job = data;
+   struct tu_pipeline_builder *builder = job->builder;
+
+   job->shader = tu_shader_create(builder->device, job->stage,
+                                  job->stage_info, builder->alloc);
+   if (!job->shader) {
+      job->result = VK_ERROR_OUT_OF_HOST_MEMORY;
+      return;
+   }
+
+   /* tu_shader_compile() does not look at the next stage yet */
+   job->result = tu_shader_compile(builder->device, job->shader, NULL,
+                                   job->options, builder->alloc);
+}
+
 static VkResult
 tu_pipeline_builder_compile_shaders(struct tu_pipeline_builder *builder)
 {
+   struct tu_device *dev = builder->device;
    const VkPipelineShaderStageCreateInfo *stage_infos[MESA_SHADER_STAGES] = {
       NULL
    };
@@ -1408,31 +1440,95 @@ tu_pipeline_builder_compile_shaders(struct tu_pipeline_builder *builder)
    struct tu_shader_compile_options options;
    tu_shader_compile_options_init(&options, builder->create_info);
 
-   /* compile shaders in reverse order */
-   struct tu_shader *next_stage_shader = NULL;
-   for (gl_shader_stage stage = MESA_SHADER_STAGES - 1;
-        stage > MESA_SHADER_NONE; stage--) {
+   /* a cache hit would skip the NIR and ir3 dumps */
+   struct tu_pipeline_cache *cache =
+      builder->cache ? builder->cache : dev->mem_cache;
+   if (dev->physical_device->instance->debug_flags &
+       (TU_DEBUG_NIR | TU_DEBUG_IR3))
+      cache = NULL;
+
+   unsigned char sha1[MESA_SHADER_STAGES][20];
+   struct tu_shader_compile_job jobs[MESA_SHADER_STAGES];
+   uint32_t job_count = 0;
+   for (gl_shader_stage stage = MESA_SHADER_VERTEX;
+        stage < MESA_SHADER_STAGES; stage++) {
       const VkPipelineShaderStageCreateInfo *stage_info = stage_infos[stage];
       if (!stage_info)
          continue;
 
-      struct tu_shader *shader =
-         tu_shader_create(builder->device, stage, stage_info, builder->alloc);
-      if (!shader)
-         return VK_ERROR_OUT_OF_HOST_MEMORY;
+      if (cache) {
+         tu_hash_shader(sha1[stage], stage, stage_info, &options);
+         builder->shaders[stage] =
+            tu_shader_create_from_cache(dev, cache, stage, sha1[stage],
+                                        &options, builder->alloc);
+         if (builder->shaders[stage])
+            continue;
+      }
 
-      VkResult result =
-         tu_shader_compile(builder->device, shader, next_stage_shader,
-                           &options, builder->alloc);
-      if (result != VK_SUCCESS)
-         return result;
+      jobs[job_count++] = (struct tu_shader_compile_job) {
+         .builder = builder,
+         .stage = stage,
+         .stage_info = stage_info,
+         .options = &options,
+      };
+   }
+
+   /* Nothing is linked between the stages yet, so they are compiled
+    * independently.  The last one, usually the fragment shader, is compiled
+    * on this thread and the others on the device's compile queue if there
+    * is one.
+    */
+   struct util_queue *queue = &dev->compile_queue;
+   const bool use_queue = util_queue_is_initialized(queue);
+   for (uint32_t i = 0; i + 1 < job_count; i++) {
+      if (use_queue) {
+         util_queue_fence_init(&jobs[i].fence);
+         util_queue_add_job(queue, &jobs[i], &jobs[i].fence,
+                            tu_shader_compile_job_execute, NULL);
+      } else {
+         tu_shader_compile_job_execute(&jobs[i], 0);
+      }
+   }
+
+   if (job_count)
+      tu_shader_compile_job_execute(&jobs[job_count - 1], 0);
+
+   if (use_queue) {
+      for (uint32_t i = 0; i + 1 < job_count; i++) {
+         util_queue_fence_wait(&jobs[i].fence);
+         util_queue_fence_destroy(&jobs[i].fence);
+      }
+   }
+
+   /* hand every shader to the builder first, so that
+    * tu_pipeline_builder_finish frees them on failure
+    */
+   VkResult result = VK_SUCCESS;
+   for (uint32_t i = 0; i < job_count; i++) {
+      builder->shaders[jobs[i].stage] = jobs[i].shader;
+      if (jobs[i].result != VK_SUCCESS)
+         result = jobs[i].result;
+   }
+   if (result != VK_SUCCESS)
+      return result;
+
+   if (cache) {
+      for (uint32_t i = 0; i < job_count; i++) {
+         tu_pipeline_cache_insert_shader(cache, sha1[jobs[i].stage],
+                                         jobs[i].shader);
+      }
+   }
+
+   /* lay the shaders out in reverse order, as they used to be compiled */
+   for (gl_shader_stage stage = MESA_SHADER_STAGES - 1;
+        stage > MESA_SHADER_NONE; stage--) {
+      const struct tu_shader *shader = builder->shaders[stage];
+      if (!shader)
+         continue;
 
-      builder->shaders[stage] = shader;
       builder->shader_offsets[stage] = builder->shader_total_size;
       builder->shader_total_size +=
          sizeof(uint32_t) * shader->variants[0].info.sizedwords;
-
-      next_stage_shader = shader;
    }
 
    if (builder->shaders[MESA_SHADER_VERTEX]->has_binning_pass) {
@@ -28,18 +28,28 @@
 #include "util/mesa-sha1.h"
 #include "util/u_atomic.h"
 
-struct cache_entry_variant_info
-{
-};
+/* The part of the variant filled in by the compiler, minus the bo and
+ * linked list pointers which come before and after it:
+ */
+#define VARIANT_CACHE_START offsetof(struct ir3_shader_variant, info)
+#define VARIANT_CACHE_END offsetof(struct ir3_shader_variant, next)
+#define VARIANT_CACHE_SIZE (VARIANT_CACHE_END - VARIANT_CACHE_START)
 
+/* An entry holds one compiled shader stage.  The code is made of the
+ * variants, the immediates and then the binary of each variant, in that
+ * order.
+ */
 struct cache_entry
 {
    union {
       unsigned char sha1[20];
       uint32_t sha1_dw[5];
    };
-   uint32_t code_sizes[MESA_SHADER_STAGES];
-   struct tu_shader_variant *variants[MESA_SHADER_STAGES];
+   /* 2 when there is a binning pass variant */
+   uint32_t variant_count;
+   uint32_t immediate_idx;
+   uint32_t immediates_count;
+   uint32_t code_sizes[2];
    char code[0];
 };
 
@@ -80,14 +90,30 @@ tu_pipeline_cache_finish(struct tu_pipeline_cache *cache)
 static uint32_t
 entry_size(struct cache_entry *entry)
 {
-   size_t ret = sizeof(*entry);
-   for (int i = 0; i < MESA_SHADER_STAGES; ++i)
-      if (entry->code_sizes[i])
-         ret +=
-            sizeof(struct cache_entry_variant_info) + entry->code_sizes[i];
+   size_t ret = sizeof(*entry) + entry->variant_count * VARIANT_CACHE_SIZE +
+                entry->immediates_count * 4 * sizeof(uint32_t);
+   for (uint32_t i = 0; i < entry->variant_count; i++)
+      ret += entry->code_sizes[i];
    return ret;
 }
 
+static void
+tu_hash_stage(struct mesa_sha1 *ctx,
+              const VkPipelineShaderStageCreateInfo *stage_info)
+{
+   TU_FROM_HANDLE(tu_shader_module, module, stage_info->module);
+   const VkSpecializationInfo *spec_info = stage_info->pSpecializationInfo;
+
+   _mesa_sha1_update(ctx, module->sha1, sizeof(module->sha1));
+   _mesa_sha1_update(ctx, stage_info->pName, strlen(stage_info->pName));
+   if (spec_info) {
+      _mesa_sha1_update(
+         ctx, spec_info->pMapEntries,
+         spec_info->mapEntryCount * sizeof spec_info->pMapEntries[0]);
+      _mesa_sha1_update(ctx, spec_info->pData, spec_info->dataSize);
+   }
+}
+
 void
 tu_hash_shaders(unsigned char *hash,
                 const VkPipelineShaderStageCreateInfo **stages,
@@ -104,25 +130,38 @@ tu_hash_shaders(unsigned char *hash,
       _mesa_sha1_update(&ctx, layout->sha1, sizeof(layout->sha1));
 
    for (int i = 0; i < MESA_SHADER_STAGES; ++i) {
-      if (stages[i]) {
-         TU_FROM_HANDLE(tu_shader_module, module, stages[i]->module);
-         const VkSpecializationInfo *spec_info =
-            stages[i]->pSpecializationInfo;
-
-         _mesa_sha1_update(&ctx, module->sha1, sizeof(module->sha1));
-         _mesa_sha1_update(&ctx, stages[i]->pName, strlen(stages[i]->pName));
-         if (spec_info) {
-            _mesa_sha1_update(
-               &ctx, spec_info->pMapEntries,
-               spec_info->mapEntryCount * sizeof spec_info->pMapEntries[0]);
-            _mesa_sha1_update(&ctx, spec_info->pData, spec_info->dataSize);
-         }
-      }
+      if (stages[i])
+         tu_hash_stage(&ctx, stages[i]);
    }
    _mesa_sha1_update(&ctx, &flags, 4);
    _mesa_sha1_final(&ctx, hash);
 }
 
+/**
+ * Hash a single stage along with everything that changes the code
+ * tu_shader_compile() generates for it.
+ */
+void
+tu_hash_shader(unsigned char *hash,
+               gl_shader_stage stage,
+               const VkPipelineShaderStageCreateInfo *stage_info,
+               const struct tu_shader_compile_options *options)
+{
+   struct mesa_sha1 ctx;
+   const uint32_t stage32 = stage;
+   const uint8_t optimize = options->optimize;
+   const uint8_t include_binning_pass = options->include_binning_pass;
+
+   _mesa_sha1_init(&ctx);
+   _mesa_sha1_update(&ctx, &stage32, sizeof(stage32));
+   tu_hash_stage(&ctx, stage_info);
+   _mesa_sha1_update(&ctx, &options->key, sizeof(options->key));
+   _mesa_sha1_update(&ctx, &optimize, sizeof(optimize));
+   _mesa_sha1_update(&ctx, &include_binning_pass,
+                     sizeof(include_binning_pass));
+   _mesa_sha1_final(&ctx, hash);
+}
+
 static struct cache_entry *
 tu_pipeline_cache_search_unlocked(struct tu_pipeline_cache *cache,
                                   const unsigned char *sha1)
@@ -231,6 +270,119 @@ tu_pipeline_cache_add_entry(struct tu_pipeline_cache *cache,
       tu_pipeline_cache_set_entry(cache, entry);
 }
 
+/**
+ * Fill in the variants, binaries and immediates of a new shader from the
+ * cache, the way tu_shader_compile() would.  Returns false on a miss.
+ */
+bool
+tu_pipeline_cache_load_shader(struct tu_pipeline_cache *cache,
+                              const unsigned char *sha1,
+                              struct tu_shader *shader)
+{
+   struct ir3_const_state *const_state = &shader->ir3_shader.const_state;
+   struct cache_entry *entry = tu_pipeline_cache_search(cache, sha1);
+   if (!entry)
+      return false;
+
+   /* only vertex shaders have room for a binning pass variant */
+   if (entry->variant_count > 1 &&
+       shader->ir3_shader.type != MESA_SHADER_VERTEX)
+      return false;
+
+   /* entries are never removed or modified once added */
+   const char *p = entry->code;
+   void *binaries[2] = { NULL, NULL };
+   for (uint32_t i = 0; i < entry->variant_count; i++) {
+      memcpy((char *) &shader->variants[i] + VARIANT_CACHE_START, p,
+             VARIANT_CACHE_SIZE);
+      shader->variants[i].ir = NULL;
+      p += VARIANT_CACHE_SIZE;
+   }
+
+   const size_t immediates_size =
+      entry->immediates_count * 4 * sizeof(uint32_t);
+   if (immediates_size) {
+      const_state->immediates = malloc(immediates_size);
+      if (!const_state->immediates)
+         return false;
+      memcpy(const_state->immediates, p, immediates_size);
+   }
+   const_state->immediate_idx = entry->immediate_idx;
+   const_state->immediates_count = entry->immediates_count;
+   const_state->immediates_size = entry->immediates_count;
+   p += immediates_size;
+
+   for (uint32_t i = 0; i < entry->variant_count; i++) {
+      binaries[i] = malloc(entry->code_sizes[i]);
+      if (!binaries[i]) {
+         free(binaries[0]);
+         return false;
+      }
+      memcpy(binaries[i], p, entry->code_sizes[i]);
+      p += entry->code_sizes[i];
+   }
+
+   shader->binary = binaries[0];
+   shader->binning_binary = binaries[1];
+   shader->has_binning_pass = entry->variant_count > 1;
+
+   return true;
+}
+
+void
+tu_pipeline_cache_insert_shader(struct tu_pipeline_cache *cache,
+                                const unsigned char *sha1,
+                                const struct tu_shader *shader)
+{
+   const struct ir3_const_state *const_state =
+      &shader->ir3_shader.const_state;
+   const void *binaries[2] = { shader->binary, shader->binning_binary };
+
+   pthread_mutex_lock(&cache->mutex);
+
+   if (!cache->table_size || tu_pipeline_cache_search_unlocked(cache, sha1)) {
+      pthread_mutex_unlock(&cache->mutex);
+      return;
+   }
+
+   struct cache_entry header = {
+      .variant_count = 1 + shader->has_binning_pass,
+      .immediate_idx = const_state->immediate_idx,
+      .immediates_count = const_state->immediates_count,
+   };
+   memcpy(header.sha1, sha1, sizeof(header.sha1));
+   for (uint32_t i = 0; i < header.variant_count; i++)
+      header.code_sizes[i] = shader->variants[i].info.sizedwords * 4;
+
+   const size_t size = entry_size(&header);
+   struct cache_entry *entry =
+      vk_alloc(&cache->alloc, size, 8, VK_SYSTEM_ALLOCATION_SCOPE_CACHE);
+   if (!entry) {
+      pthread_mutex_unlock(&cache->mutex);
+      return;
+   }
+
+   memcpy(entry, &header, sizeof(header));
+   char *p = entry->code;
+   for (uint32_t i = 0; i < header.variant_count; i++) {
+      memcpy(p, (const char *) &shader->variants[i] + VARIANT_CACHE_START,
+             VARIANT_CACHE_SIZE);
+      p += VARIANT_CACHE_SIZE;
+   }
+   memcpy(p, const_state->immediates,
+          header.immediates_count * 4 * sizeof(uint32_t));
+   p += header.immediates_count * 4 * sizeof(uint32_t);
+   for (uint32_t i = 0; i < header.variant_count; i++) {
+      memcpy(p, binaries[i], header.code_sizes[i]);
+      p += header.code_sizes[i];
+   }
+
+   tu_pipeline_cache_add_entry(cache, entry);
+   cache->modified = true;
+
+   pthread_mutex_unlock(&cache->mutex);
+}
+
 struct cache_header
 {
    uint32_t header_size;
@@ -269,6 +421,10 @@ tu_pipeline_cache_load(struct tu_pipeline_cache *cache,
    while (end - p >= sizeof(struct cache_entry)) {
       struct cache_entry *entry = (struct cache_entry *) p;
       struct cache_entry *dest_entry;
+      if (entry->variant_count < 1 ||
+          entry->variant_count > ARRAY_SIZE(entry->code_sizes))
+         break;
+
       size_t size = entry_size(entry);
       if (end - p < size)
          break;
@@ -277,8 +433,6 @@ tu_pipeline_cache_load(struct tu_pipeline_cache *cache,
          vk_alloc(&cache->alloc, size, 8, VK_SYSTEM_ALLOCATION_SCOPE_CACHE);
       if (dest_entry) {
          memcpy(dest_entry, entry, size);
-         for (int i = 0; i < MESA_SHADER_STAGES; ++i)
-            dest_entry->variants[i] = NULL;
          tu_pipeline_cache_add_entry(cache, dest_entry);
       }
       p += size;
@@ -379,8 +533,6 @@ tu_GetPipelineCacheData(VkDevice _device,
       }
 
       memcpy(p, entry, size);
-      for (int j = 0; j < MESA_SHADER_STAGES; ++j)
-         ((struct cache_entry *) p)->variants[j] = NULL;
       p += size;
    }
    *pDataSize = p - pData;
@@ -48,6 +48,7 @@
 #include "main/macros.h"
 #include "util/list.h"
 #include "util/macros.h"
+#include "util/u_queue.h"
 #include "vk_alloc.h"
 #include "vk_debug_report.h"
 #include "wsi_common.h"
@@ -384,22 +385,17 @@ tu_pipeline_cache_load(struct tu_pipeline_cache *cache,
                        const void *data,
                        size_t size);
 
-struct tu_shader_variant;
+struct tu_shader;
 
 bool
-tu_create_shader_variants_from_pipeline_cache(
-   struct tu_device *device,
-   struct tu_pipeline_cache *cache,
-   const unsigned char *sha1,
-   struct tu_shader_variant **variants);
+tu_pipeline_cache_load_shader(struct tu_pipeline_cache *cache,
+                              const unsigned char *sha1,
+                              struct tu_shader *shader);
 
 void
-tu_pipeline_cache_insert_shaders(struct tu_device *device,
-                                 struct tu_pipeline_cache *cache,
-                                 const unsigned char *sha1,
-                                 struct tu_shader_variant **variants,
-                                 const void *const *codes,
-                                 const unsigned *code_sizes);
+tu_pipeline_cache_insert_shader(struct tu_pipeline_cache *cache,
+                                const unsigned char *sha1,
+                                const struct tu_shader *shader);
 
 struct tu_meta_state
 {
@@ -464,6 +460,11 @@ struct tu_device
    /* Backup in-memory cache to be used if the app doesn't provide one */
    struct tu_pipeline_cache *mem_cache;
 
+   /* Compiles the stages of a pipeline in parallel.  Not initialized on
+    * single-core systems.
+    */
+   struct util_queue compile_queue;
+
    struct list_head shader_slabs;
    mtx_t shader_slab_mutex;
 
@@ -1054,6 +1055,20 @@ tu_shader_compile(struct tu_device *dev,
                   const struct tu_shader_compile_options *options,
                   const VkAllocationCallbacks *alloc);
 
+struct tu_shader *
+tu_shader_create_from_cache(struct tu_device *dev,
+                            struct tu_pipeline_cache *cache,
+                            gl_shader_stage stage,
+                            const unsigned char *sha1,
+                            const struct tu_shader_compile_options *options,
+                            const VkAllocationCallbacks *alloc);
+
+void
+tu_hash_shader(unsigned char *hash,
+               gl_shader_stage stage,
+               const VkPipelineShaderStageCreateInfo *stage_info,
+               const struct tu_shader_compile_options *options);
+
 struct tu_pipeline
 {
    struct tu_cs cs;
@@ -107,14 +107,11 @@ tu_sort_variables_by_location(struct exec_list *variables)
    exec_list_move_nodes_to(&sorted, variables);
 }
 
-struct tu_shader *
-tu_shader_create(struct tu_device *dev,
-                 gl_shader_stage stage,
-                 const VkPipelineShaderStageCreateInfo *stage_info,
-                 const VkAllocationCallbacks *alloc)
+static struct tu_shader *
+tu_shader_alloc(struct tu_device *dev,
+                gl_shader_stage stage,
+                const VkAllocationCallbacks *alloc)
 {
-   const struct tu_shader_module *module =
-      tu_shader_module_from_handle(stage_info->module);
    struct tu_shader *shader;
 
    const uint32_t max_variant_count = (stage == MESA_SHADER_VERTEX) ? 2 : 1;
@@ -125,6 +122,24 @@ tu_shader_create(struct tu_device *dev,
    if (!shader)
       return NULL;
 
+   shader->ir3_shader.compiler = dev->compiler;
+   shader->ir3_shader.type = stage;
+
+   return shader;
+}
+
+struct tu_shader *
+tu_shader_create(struct tu_device *dev,
+                 gl_shader_stage stage,
+                 const VkPipelineShaderStageCreateInfo *stage_info,
+                 const VkAllocationCallbacks *alloc)
+{
+   const struct tu_shader_module *module =
+      tu_shader_module_from_handle(stage_info->module);
+   struct tu_shader *shader = tu_shader_alloc(dev, stage, alloc);
+   if (!shader)
+      return NULL;
+
    /* translate SPIR-V to NIR */
    assert(module->code_size % 4 == 0);
    nir_shader *nir = tu_spirv_to_nir(
@@ -175,8 +190,6 @@ tu_shader_create(struct tu_device *dev,
 
    nir_shader_gather_info(nir, nir_shader_get_entrypoint(nir));
 
-   shader->ir3_shader.compiler = dev->compiler;
-   shader->ir3_shader.type = stage;
    shader->ir3_shader.nir = nir;
 
    return shader;
@@ -219,16 +232,25 @@ tu_shader_compile_options_init(
    };
 }
 
+static void
+tu_shader_variant_init(struct ir3_shader *shader,
+                       const struct ir3_shader_key *key,
+                       bool binning_pass,
+                       struct ir3_shader_variant *variant)
+{
+   variant->shader = shader;
+   variant->type = shader->type;
+   variant->key = *key;
+   variant->binning_pass = binning_pass;
+}
+
 static uint32_t *
 tu_compile_shader_variant(struct ir3_shader *shader,
                           const struct ir3_shader_key *key,
                           bool binning_pass,
                           struct ir3_shader_variant *variant)
 {
-   variant->shader = shader;
-   variant->type = shader->type;
-   variant->key = *key;
-   variant->binning_pass = binning_pass;
+   tu_shader_variant_init(shader, key, binning_pass, variant);
 
    int ret = ir3_compile_shader_nir(shader->compiler, variant);
    if (ret)
@@ -292,6 +314,37 @@ tu_shader_compile(struct tu_device *dev,
    return VK_SUCCESS;
 }
 
+/**
+ * Create an already compiled shader from the pipeline cache, skipping
+ * spirv_to_nir and the compiler.  Returns NULL on a miss.
+ *
+ * The shader has no NIR, so it cannot be compiled again.
+ */
+struct tu_shader *
+tu_shader_create_from_cache(struct tu_device *dev,
+                            struct tu_pipeline_cache *cache,
+                            gl_shader_stage stage,
+                            const unsigned char *sha1,
+                            const struct tu_shader_compile_options *options,
+                            const VkAllocationCallbacks *alloc)
+{
+   struct tu_shader *shader = tu_shader_alloc(dev, stage, alloc);
+   if (!shader)
+      return NULL;
+
+   if (!tu_pipeline_cache_load_shader(cache, sha1, shader)) {
+      tu_shader_destroy(dev, shader, alloc);
+      return NULL;
+   }
+
+   for (uint32_t i = 0; i < 1 + shader->has_binning_pass; i++) {
+      tu_shader_variant_init(&shader->ir3_shader, &options->key, i > 0,
+                             &shader->variants[i]);
+   }
+
+   return shader;
+}
+
 VkResult
 tu_CreateShaderModule(VkDevice _device,
                       const VkShaderModuleCreateInfo *pCreateInfo,
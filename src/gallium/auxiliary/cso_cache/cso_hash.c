@@ -35,380 +35,245 @@
 
 #include "cso_hash.h"
 
-#ifndef MAX
-#define MAX(a, b) ((a > b) ? (a) : (b))
-#endif
+#define CSO_HASH_MIN_NODES 16
 
-static const int MinNumBits = 4;
+/* Marks the value of an erased node. Lookups have to probe past erased
+ * nodes, while empty nodes (value == NULL) end a probe sequence.
+ */
+static char cso_hash_deleted_marker;
+#define CSO_HASH_DELETED ((void *)&cso_hash_deleted_marker)
 
-static const unsigned char prime_deltas[] = {
-   0,  0,  1,  3,  1,  5,  3,  3,  1,  9,  7,  5,  3,  9, 25,  3,
-   1, 21,  3, 21,  7, 15,  9,  5,  3, 29, 15,  0,  0,  0,  0,  0
-};
-
-static int primeForNumBits(int numBits)
+static inline boolean
+cso_node_is_used(const struct cso_node *node)
 {
-   return (1 << numBits) + prime_deltas[numBits];
+   return node->value && node->value != CSO_HASH_DELETED;
 }
 
-/*
-    Returns the smallest integer n such that
-    primeForNumBits(n) >= hint.
-*/
-static int countBits(int hint)
+/* Keys are usually XORs of state words, so mix them before they select
+ * the home node.
+ */
+static inline unsigned
+cso_hash_home(const struct cso_hash *hash, unsigned key)
 {
-   int numBits = 0;
-   int bits = hint;
-
-   while (bits > 1) {
-      bits >>= 1;
-      numBits++;
-   }
-
-   if (numBits >= (int)sizeof(prime_deltas)) {
-      numBits = sizeof(prime_deltas) - 1;
-   } else if (primeForNumBits(numBits) < hint) {
-      ++numBits;
-   }
-   return numBits;
+   return (key * 0x9e3779b1u) & (hash->num_nodes - 1);
 }
 
-struct cso_hash_data {
-   struct cso_node *fakeNext;
-   struct cso_node **buckets;
-   int size;
-   int nodeSize;
-   short userNumBits;
-   short numBits;
-   int numBuckets;
-};
-
-static void *cso_data_allocate_node(struct cso_hash_data *hash)
+static struct cso_hash_iter
+cso_hash_iter_at(struct cso_hash *hash, struct cso_node *node)
 {
-   return MALLOC(hash->nodeSize);
+   struct cso_hash_iter iter = {hash, node};
+   return iter;
 }
 
-static void cso_free_node(struct cso_node *node)
+/* Return the first used node at or after index i, or NULL. */
+static struct cso_node *
+cso_hash_next_used(struct cso_hash *hash, unsigned i)
 {
-   FREE(node);
+   for (; i < hash->num_nodes; ++i) {
+      if (cso_node_is_used(&hash->nodes[i]))
+         return &hash->nodes[i];
+   }
+   return NULL;
 }
 
+/* Return the next node with the given key in the probe sequence, starting
+ * at index i.
+ */
 static struct cso_node *
-cso_hash_create_node(struct cso_hash *hash,
-                      unsigned akey, void *avalue,
-                      struct cso_node **anextNode)
+cso_hash_probe(struct cso_hash *hash, unsigned i, unsigned key)
 {
-   struct cso_node *node = cso_data_allocate_node(hash->data.d);
+   unsigned mask = hash->num_nodes - 1;
 
-   if (!node)
+   if (!hash->num_nodes)
       return NULL;
 
-   node->key = akey;
-   node->value = avalue;
+   for (;; i = (i + 1) & mask) {
+      struct cso_node *node = &hash->nodes[i];
 
-   node->next = (struct cso_node*)(*anextNode);
-   *anextNode = node;
-   ++hash->data.d->size;
-   return node;
+      if (!node->value)
+         return NULL;
+      if (node->key == key && node->value != CSO_HASH_DELETED)
+         return node;
+   }
 }
 
-static void cso_data_rehash(struct cso_hash_data *hash, int hint)
+static boolean
+cso_hash_rehash(struct cso_hash *hash)
 {
-   if (hint < 0) {
-      hint = countBits(-hint);
-      if (hint < MinNumBits)
-         hint = MinNumBits;
-      hash->userNumBits = (short)hint;
-      while (primeForNumBits(hint) < (hash->size >> 1))
-         ++hint;
-   } else if (hint < MinNumBits) {
-      hint = MinNumBits;
+   struct cso_node *old_nodes = hash->nodes;
+   unsigned old_num_nodes = hash->num_nodes;
+   unsigned num_nodes = CSO_HASH_MIN_NODES;
+   unsigned i;
+
+   /* Leave the table at most a quarter full, it's rehashed at half. */
+   while (num_nodes < (hash->size + 1) * 4)
+      num_nodes *= 2;
+
+   hash->nodes = CALLOC(num_nodes, sizeof(*hash->nodes));
+   if (!hash->nodes) {
+      hash->nodes = old_nodes;
+      return FALSE;
    }
+   hash->num_nodes = num_nodes;
+   hash->num_deleted = 0;
 
-   if (hash->numBits != hint) {
-      struct cso_node *e = (struct cso_node *)(hash);
-      struct cso_node **oldBuckets = hash->buckets;
-      int oldNumBuckets = hash->numBuckets;
-      int  i = 0;
-
-      hash->numBits = (short)hint;
-      hash->numBuckets = primeForNumBits(hint);
-      hash->buckets = MALLOC(sizeof(struct cso_node*) * hash->numBuckets);
-      for (i = 0; i < hash->numBuckets; ++i)
-         hash->buckets[i] = e;
-
-      for (i = 0; i < oldNumBuckets; ++i) {
-         struct cso_node *firstNode = oldBuckets[i];
-         while (firstNode != e) {
-            unsigned h = firstNode->key;
-            struct cso_node *lastNode = firstNode;
-            struct cso_node *afterLastNode;
-            struct cso_node **beforeFirstNode;
-            
-            while (lastNode->next != e && lastNode->next->key == h)
-               lastNode = lastNode->next;
-
-            afterLastNode = lastNode->next;
-            beforeFirstNode = &hash->buckets[h % hash->numBuckets];
-            while (*beforeFirstNode != e)
-               beforeFirstNode = &(*beforeFirstNode)->next;
-            lastNode->next = *beforeFirstNode;
-            *beforeFirstNode = firstNode;
-            firstNode = afterLastNode;
-         }
-      }
-      FREE(oldBuckets);
-   }
-}
+   for (i = 0; i < old_num_nodes; ++i) {
+      struct cso_node *node = &old_nodes[i];
+      unsigned j;
 
-static void cso_data_might_grow(struct cso_hash_data *hash)
-{
-   if (hash->size >= hash->numBuckets)
-      cso_data_rehash(hash, hash->numBits + 1);
-}
-
-static void cso_data_has_shrunk(struct cso_hash_data *hash)
-{
-   if (hash->size <= (hash->numBuckets >> 3) &&
-       hash->numBits > hash->userNumBits) {
-      int max = MAX(hash->numBits-2, hash->userNumBits);
-      cso_data_rehash(hash,  max);
-   }
-}
+      if (!cso_node_is_used(node))
+         continue;
 
-static struct cso_node *cso_data_first_node(struct cso_hash_data *hash)
-{
-   struct cso_node *e = (struct cso_node *)(hash);
-   struct cso_node **bucket = hash->buckets;
-   int n = hash->numBuckets;
-   while (n--) {
-      if (*bucket != e)
-         return *bucket;
-      ++bucket;
+      for (j = cso_hash_home(hash, node->key); hash->nodes[j].value;
+           j = (j + 1) & (num_nodes - 1))
+         ;
+      hash->nodes[j] = *node;
    }
-   return e;
-}
 
-static struct cso_node **cso_hash_find_node(struct cso_hash *hash, unsigned akey)
-{
-   struct cso_node **node;
-
-   if (hash->data.d->numBuckets) {
-      node = (struct cso_node **)(&hash->data.d->buckets[akey % hash->data.d->numBuckets]);
-      assert(*node == hash->data.e || (*node)->next);
-      while (*node != hash->data.e && (*node)->key != akey)
-         node = &(*node)->next;
-   } else {
-      node = (struct cso_node **)((const struct cso_node * const *)(&hash->data.e));
-   }
-   return node;
+   FREE(old_nodes);
+   return TRUE;
 }
 
 struct cso_hash_iter cso_hash_insert(struct cso_hash *hash,
                                        unsigned key, void *data)
 {
-   cso_data_might_grow(hash->data.d);
-
-   {
-      struct cso_node **nextNode = cso_hash_find_node(hash, key);
-      struct cso_node *node = cso_hash_create_node(hash, key, data, nextNode);
-      if (!node) {
-         struct cso_hash_iter null_iter = {hash, 0};
-         return null_iter;
-      }
-
-      {
-         struct cso_hash_iter iter = {hash, node};
-         return iter;
-      }
-   }
-}
+   struct cso_node *node;
+   unsigned i;
 
-struct cso_hash * cso_hash_create(void)
-{
-   struct cso_hash *hash = MALLOC_STRUCT(cso_hash);
-   if (!hash)
-      return NULL;
+   assert(data);
 
-   hash->data.d = MALLOC_STRUCT(cso_hash_data);
-   if (!hash->data.d) {
-      FREE(hash);
-      return NULL;
-   }
+   if ((hash->size + hash->num_deleted + 1) * 2 > hash->num_nodes &&
+       !cso_hash_rehash(hash))
+      return cso_hash_iter_at(hash, NULL);
+
+   /* Reuse the first erased node of the probe sequence, if any. */
+   for (i = cso_hash_home(hash, key); cso_node_is_used(&hash->nodes[i]);
+        i = (i + 1) & (hash->num_nodes - 1))
+      ;
+
+   node = &hash->nodes[i];
+   if (node->value == CSO_HASH_DELETED)
+      hash->num_deleted--;
+   node->key = key;
+   node->value = data;
+   hash->size++;
 
-   hash->data.d->fakeNext = 0;
-   hash->data.d->buckets = 0;
-   hash->data.d->size = 0;
-   hash->data.d->nodeSize = sizeof(struct cso_node);
-   hash->data.d->userNumBits = (short)MinNumBits;
-   hash->data.d->numBits = 0;
-   hash->data.d->numBuckets = 0;
+   return cso_hash_iter_at(hash, node);
+}
 
-   return hash;
+struct cso_hash * cso_hash_create(void)
+{
+   return CALLOC_STRUCT(cso_hash);
 }
 
 void cso_hash_delete(struct cso_hash *hash)
 {
-   struct cso_node *e_for_x = (struct cso_node *)(hash->data.d);
-   struct cso_node **bucket = (struct cso_node **)(hash->data.d->buckets);
-   int n = hash->data.d->numBuckets;
-   while (n--) {
-      struct cso_node *cur = *bucket++;
-      while (cur != e_for_x) {
-         struct cso_node *next = cur->next;
-         cso_free_node(cur);
-         cur = next;
-      }
-   }
-   FREE(hash->data.d->buckets);
-   FREE(hash->data.d);
+   FREE(hash->nodes);
    FREE(hash);
 }
 
 struct cso_hash_iter cso_hash_find(struct cso_hash *hash,
                                      unsigned key)
 {
-   struct cso_node **nextNode = cso_hash_find_node(hash, key);
-   struct cso_hash_iter iter = {hash, *nextNode};
-   return iter;
+   if (!hash->num_nodes)
+      return cso_hash_iter_at(hash, NULL);
+
+   return cso_hash_iter_at(hash,
+                           cso_hash_probe(hash, cso_hash_home(hash, key), key));
+}
+
+struct cso_hash_iter cso_hash_find_next(struct cso_hash_iter iter)
+{
+   struct cso_hash *hash = iter.hash;
+   unsigned i;
+
+   if (!iter.node)
+      return iter;
+
+   i = (iter.node - hash->nodes + 1) & (hash->num_nodes - 1);
+   return cso_hash_iter_at(hash, cso_hash_probe(hash, i, iter.node->key));
 }
 
 unsigned cso_hash_iter_key(struct cso_hash_iter iter)
 {
-   if (!iter.node || iter.hash->data.e == iter.node)
+   if (!iter.node)
       return 0;
    return iter.node->key;
 }
 
-static struct cso_node *cso_hash_data_next(struct cso_node *node)
+struct cso_hash_iter cso_hash_iter_next(struct cso_hash_iter iter)
 {
-   union {
-      struct cso_node *next;
-      struct cso_node *e;
-      struct cso_hash_data *d;
-   } a;
-   int start;
-   struct cso_node **bucket;
-   int n;
-
-   a.next = node->next;
-   if (!a.next) {
+   struct cso_hash *hash = iter.hash;
+
+   if (!iter.node) {
       debug_printf("iterating beyond the last element\n");
-      return 0;
-   }
-   if (a.next->next)
-      return a.next;
-
-   start = (node->key % a.d->numBuckets) + 1;
-   bucket = a.d->buckets + start;
-   n = a.d->numBuckets - start;
-   while (n--) {
-      if (*bucket != a.e)
-         return *bucket;
-      ++bucket;
+      return iter;
    }
-   return a.e;
-}
 
+   return cso_hash_iter_at(hash,
+                           cso_hash_next_used(hash,
+                                              iter.node - hash->nodes + 1));
+}
 
-static struct cso_node *cso_hash_data_prev(struct cso_node *node)
+struct cso_hash_iter cso_hash_iter_prev(struct cso_hash_iter iter)
 {
-   union {
-      struct cso_node *e;
-      struct cso_hash_data *d;
-   } a;
-   int start;
-   struct cso_node *sentinel;
-   struct cso_node **bucket;
-
-   a.e = node;
-   while (a.e->next)
-      a.e = a.e->next;
-
-   if (node == a.e)
-      start = a.d->numBuckets - 1;
-   else
-      start = node->key % a.d->numBuckets;
-
-   sentinel = node;
-   bucket = a.d->buckets + start;
-   while (start >= 0) {
-      if (*bucket != sentinel) {
-         struct cso_node *prev = *bucket;
-         while (prev->next != sentinel)
-            prev = prev->next;
-         return prev;
-      }
-
-      sentinel = a.e;
-      --bucket;
-      --start;
+   struct cso_hash *hash = iter.hash;
+   int i = iter.node ? iter.node - hash->nodes : (int)hash->num_nodes;
+
+   while (--i >= 0) {
+      if (cso_node_is_used(&hash->nodes[i]))
+         return cso_hash_iter_at(hash, &hash->nodes[i]);
    }
+
    debug_printf("iterating backward beyond first element\n");
-   return a.e;
+   return cso_hash_iter_at(hash, NULL);
 }
 
-struct cso_hash_iter cso_hash_iter_next(struct cso_hash_iter iter)
+static void cso_hash_erase_node(struct cso_hash *hash, struct cso_node *node)
 {
-   struct cso_hash_iter next = {iter.hash, cso_hash_data_next(iter.node)};
-   return next;
+   /* Nodes are never moved on removal, so iterators stay valid. */
+   node->value = CSO_HASH_DELETED;
+   hash->size--;
+   hash->num_deleted++;
 }
 
 void * cso_hash_take(struct cso_hash *hash,
                       unsigned akey)
 {
-   struct cso_node **node = cso_hash_find_node(hash, akey);
-   if (*node != hash->data.e) {
-      void *t = (*node)->value;
-      struct cso_node *next = (*node)->next;
-      cso_free_node(*node);
-      *node = next;
-      --hash->data.d->size;
-      cso_data_has_shrunk(hash->data.d);
-      return t;
-   }
-   return 0;
-}
+   struct cso_hash_iter iter = cso_hash_find(hash, akey);
+   void *value;
 
-struct cso_hash_iter cso_hash_iter_prev(struct cso_hash_iter iter)
-{
-   struct cso_hash_iter prev = {iter.hash,
-                                 cso_hash_data_prev(iter.node)};
-   return prev;
+   if (!iter.node)
+      return NULL;
+
+   value = iter.node->value;
+   cso_hash_erase_node(hash, iter.node);
+   return value;
 }
 
 struct cso_hash_iter cso_hash_first_node(struct cso_hash *hash)
 {
-   struct cso_hash_iter iter = {hash, cso_data_first_node(hash->data.d)};
-   return iter;
+   return cso_hash_iter_at(hash, cso_hash_next_used(hash, 0));
 }
 
 int cso_hash_size(struct cso_hash *hash)
 {
-   return hash->data.d->size;
+   return hash->size;
 }
 
 struct cso_hash_iter cso_hash_erase(struct cso_hash *hash, struct cso_hash_iter iter)
 {
-   struct cso_hash_iter ret = iter;
-   struct cso_node *node = iter.node;
-   struct cso_node **node_ptr;
+   struct cso_hash_iter ret;
 
-   if (node == hash->data.e)
+   if (!iter.node)
       return iter;
 
-   ret = cso_hash_iter_next(ret);
-   node_ptr = (struct cso_node**)(&hash->data.d->buckets[node->key % hash->data.d->numBuckets]);
-   while (*node_ptr != node)
-      node_ptr = &(*node_ptr)->next;
-   *node_ptr = node->next;
-   cso_free_node(node);
-   --hash->data.d->size;
+   ret = cso_hash_iter_next(iter);
+   cso_hash_erase_node(hash, iter.node);
    return ret;
 }
 
 boolean cso_hash_contains(struct cso_hash *hash, unsigned key)
 {
-   struct cso_node **node = cso_hash_find_node(hash, key);
-   return (*node != hash->data.e);
+   return cso_hash_find(hash, key).node != NULL;
 }
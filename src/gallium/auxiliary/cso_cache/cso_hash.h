@@ -29,14 +29,13 @@
  * @file
  * Hash table implementation.
  * 
- * This file provides a hash implementation that is capable of dealing
- * with collisions. It stores colliding entries in linked list. All
- * functions operating on the hash return an iterator. The iterator
- * itself points to the collision list. If there wasn't any collision
- * the list will have just one entry, otherwise client code should
- * iterate over the entries to find the exact entry among ones that
- * had the same key (e.g. memcmp could be used on the data to check
- * that)
+ * This file provides an open-addressed hash table with linear probing,
+ * stored in a single flat array of nodes. Several entries may have the
+ * same key. All functions operating on the hash return an iterator.
+ * cso_hash_find returns the first entry with the given key, and
+ * cso_hash_find_next the following ones, so client code should iterate
+ * over those to find the exact entry among ones that had the same key
+ * (e.g. memcmp could be used on the data to check that)
  * 
  * @author Zack Rusin <zackr@vmware.com>
  */
@@ -52,16 +51,15 @@ extern "C" {
 
 
 struct cso_node {
-   struct cso_node *next;
+   void *value; /* NULL for empty nodes */
    unsigned key;
-   void *value;
 };
 
 struct cso_hash {
-   union {
-      struct cso_hash_data *d;
-      struct cso_node      *e;
-   } data;
+   struct cso_node *nodes;
+   unsigned num_nodes; /* a power of two */
+   unsigned size;
+   unsigned num_deleted;
 };
 
 struct cso_hash_iter {
@@ -78,10 +76,10 @@ int              cso_hash_size(struct cso_hash *hash);
 
 
 /**
- * Adds a data with the given key to the hash. If entry with the given
- * key is already in the hash, this current entry is instered before it
- * in the collision list.
+ * Adds a data with the given key to the hash. Data must not be NULL.
+ * Entries with the same key are kept.
  * Function returns iterator pointing to the inserted item in the hash.
+ * Iterators obtained before an insertion are invalidated.
  */
 struct cso_hash_iter cso_hash_insert(struct cso_hash *hash, unsigned key,
                                      void *data);
@@ -101,10 +99,16 @@ void  *cso_hash_take(struct cso_hash *hash, unsigned key);
 struct cso_hash_iter cso_hash_first_node(struct cso_hash *hash);
 
 /**
- * Return an iterator pointing to the first entry in the collision list.
+ * Return an iterator pointing to the first entry with the given key.
  */
 struct cso_hash_iter cso_hash_find(struct cso_hash *hash, unsigned key);
 
+/**
+ * Return an iterator pointing to the next entry with the same key as the
+ * given one, or a null iterator.
+ */
+struct cso_hash_iter cso_hash_find_next(struct cso_hash_iter iter);
+
 /**
  * Returns true if a value with the given key exists in the hash
  */
@@ -131,15 +135,13 @@ void *cso_hash_find_data_from_template( struct cso_hash *hash,
 static inline int
 cso_hash_iter_is_null(struct cso_hash_iter iter)
 {
-   if (!iter.node || iter.node == iter.hash->data.e)
-      return 1;
-   return 0;
+   return !iter.node;
 }
 
 static inline void *
 cso_hash_iter_data(struct cso_hash_iter iter)
 {
-   if (!iter.node || iter.hash->data.e == iter.node)
+   if (!iter.node)
       return 0;
    return iter.node->value;
 }
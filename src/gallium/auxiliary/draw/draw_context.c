@@ -119,6 +119,26 @@ draw_create_with_llvm_context(struct pipe_context *pipe,
 {
    return draw_create_context(pipe, context, TRUE);
 }
+
+
+/**
+ * Let the driver provide a persistent cache for the JIT-compiled vertex
+ * and geometry shader variants.
+ */
+void
+draw_set_disk_cache_callbacks(struct draw_context *draw,
+                              void *data_cookie,
+                              void (*find_shader)(void *cookie,
+                                                  struct lp_cached_code *cache,
+                                                  unsigned char ir_sha1_cache_key[20]),
+                              void (*insert_shader)(void *cookie,
+                                                    struct lp_cached_code *cache,
+                                                    unsigned char ir_sha1_cache_key[20]))
+{
+   draw->disk_cache_find_shader = find_shader;
+   draw->disk_cache_insert_shader = insert_shader;
+   draw->disk_cache_cookie = data_cookie;
+}
 #endif
 
 /**
@@ -1155,6 +1175,19 @@ draw_collect_pipeline_statistics(struct draw_context *draw,
    draw->collect_statistics = enable;
 }
 
+/**
+ * Returns the number of indices processed by indexed draws so far, and
+ * the number of vertices fetched and shaded for them.  Their ratio is the
+ * vertex reuse achieved by the vertex cache.
+ */
+void
+draw_get_vertex_cache_stats(const struct draw_context *draw,
+                            uint64_t *indices, uint64_t *fetches)
+{
+   *indices = draw->vcache_stats.indices;
+   *fetches = draw->vcache_stats.fetches;
+}
+
 /**
  * Computes clipper invocation statistics.
  *
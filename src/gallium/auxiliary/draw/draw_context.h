@@ -49,6 +49,7 @@ struct draw_fragment_shader;
 struct tgsi_sampler;
 struct tgsi_image;
 struct tgsi_buffer;
+struct lp_cached_code;
 
 /*
  * structure to contain driver internal information 
@@ -68,6 +69,15 @@ struct draw_context *draw_create( struct pipe_context *pipe );
 #ifdef LLVM_AVAILABLE
 struct draw_context *draw_create_with_llvm_context(struct pipe_context *pipe,
                                                    void *context);
+
+void draw_set_disk_cache_callbacks(struct draw_context *draw,
+                                   void *data_cookie,
+                                   void (*find_shader)(void *cookie,
+                                                       struct lp_cached_code *cache,
+                                                       unsigned char ir_sha1_cache_key[20]),
+                                   void (*insert_shader)(void *cookie,
+                                                         struct lp_cached_code *cache,
+                                                         unsigned char ir_sha1_cache_key[20]));
 #endif
 
 struct draw_context *draw_create_no_llvm(struct pipe_context *pipe);
@@ -312,6 +322,9 @@ void draw_set_force_passthrough( struct draw_context *draw,
 void draw_collect_pipeline_statistics(struct draw_context *draw,
                                       boolean enable);
 
+void draw_get_vertex_cache_stats(const struct draw_context *draw,
+                                 uint64_t *indices, uint64_t *fetches);
+
 /*******************************************************************************
  * Draw pipeline 
  */
@@ -52,11 +52,14 @@
 
 #include "tgsi/tgsi_exec.h"
 #include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_parse.h"
 
+#include "util/u_cpu_detect.h"
 #include "util/u_math.h"
 #include "util/u_pointer.h"
 #include "util/u_string.h"
 #include "util/simple_list.h"
+#include "util/mesa-sha1.h"
 
 
 #define DEBUG_STORE 0
@@ -590,6 +593,24 @@ draw_llvm_create(struct draw_context *draw, LLVMContextRef context)
    llvm->nr_gs_variants = 0;
    make_empty_list(&llvm->gs_variants_list);
 
+   if (gallivm_tier_up_uses &&
+       !util_queue_init(&llvm->compile_queue, "drawvs", 16, 1,
+                        UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+                        UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY)) {
+      debug_printf("draw: failed to create the vertex shader compile queue\n");
+   }
+
+   llvm->num_vs_threads =
+      debug_get_num_option("DRAW_VS_THREADS",
+                           MIN2(util_cpu_caps.nr_cpus - 1,
+                                DRAW_LLVM_MAX_VS_THREADS));
+   llvm->num_vs_threads = MIN2(llvm->num_vs_threads, DRAW_LLVM_MAX_VS_THREADS);
+   if (llvm->num_vs_threads &&
+       !util_queue_init(&llvm->vs_queue, "drawvsw", DRAW_LLVM_MAX_VS_THREADS,
+                        llvm->num_vs_threads, 0)) {
+      llvm->num_vs_threads = 0;
+   }
+
    return llvm;
 
 fail:
@@ -604,6 +625,11 @@ fail:
 void
 draw_llvm_destroy(struct draw_llvm *llvm)
 {
+   if (util_queue_is_initialized(&llvm->compile_queue))
+      util_queue_destroy(&llvm->compile_queue);
+   if (util_queue_is_initialized(&llvm->vs_queue))
+      util_queue_destroy(&llvm->vs_queue);
+
    if (llvm->context_owned)
       LLVMContextDispose(llvm->context);
    llvm->context = NULL;
@@ -613,6 +639,60 @@ draw_llvm_destroy(struct draw_llvm *llvm)
 }
 
 
+/**
+ * Compute the disk cache key of a vertex or geometry shader variant.
+ *
+ * The function names embed the variant number, so the module name is
+ * part of the key along with everything the in-memory variant lookup
+ * compares.
+ */
+static void
+draw_get_ir_cache_key(const struct tgsi_token *tokens,
+                      const void *key, size_t key_size,
+                      unsigned num_io,
+                      const char *module_name,
+                      unsigned char ir_sha1_cache_key[20])
+{
+   struct mesa_sha1 ctx;
+
+   _mesa_sha1_init(&ctx);
+   _mesa_sha1_update(&ctx, module_name, strlen(module_name));
+   _mesa_sha1_update(&ctx, tokens,
+                     tgsi_num_tokens(tokens) * sizeof(struct tgsi_token));
+   _mesa_sha1_update(&ctx, key, key_size);
+   _mesa_sha1_update(&ctx, &num_io, sizeof(num_io));
+   _mesa_sha1_final(&ctx, ir_sha1_cache_key);
+}
+
+
+/**
+ * Build the IR of a vertex shader variant in the given LLVM context.
+ * This reads the current vertex shader state of the draw context.
+ */
+static void
+draw_llvm_build_variant(struct draw_llvm_variant *variant,
+                        LLVMContextRef context,
+                        struct lp_cached_code *cached)
+{
+   char module_name[64];
+   LLVMTypeRef vertex_header;
+
+   snprintf(module_name, sizeof(module_name), "draw_llvm_vs_variant%u",
+            variant->no);
+
+   variant->gallivm = gallivm_create(module_name, context, cached);
+
+   create_jit_types(variant);
+
+   vertex_header = create_jit_vertex_header(variant->gallivm,
+                                            variant->num_inputs);
+
+   variant->vertex_header_ptr_type = LLVMPointerType(vertex_header, 0);
+
+   draw_llvm_generate(variant->llvm, variant);
+}
+
+
 /**
  * Create LLVM-generated code for a vertex shader.
  */
@@ -624,8 +704,10 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
    struct draw_llvm_variant *variant;
    struct llvm_vertex_shader *shader =
       llvm_vertex_shader(llvm->draw->vs.vertex_shader);
-   LLVMTypeRef vertex_header;
+   struct draw_context *draw = llvm->draw;
    char module_name[64];
+   struct lp_cached_code cached = { 0 };
+   bool needs_caching = false;
 
    variant = MALLOC(sizeof *variant +
                     shader->variant_key_size -
@@ -635,13 +717,25 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
 
    variant->llvm = llvm;
    variant->shader = shader;
+   variant->uses = 0;
+   variant->no = shader->variants_cached;
+   variant->num_inputs = num_inputs;
+   variant->tier_up = NULL;
+   variant->gallivm_opt = NULL;
+   util_queue_fence_init(&variant->ready);
 
    snprintf(module_name, sizeof(module_name), "draw_llvm_vs_variant%u",
-            variant->shader->variants_cached);
-
-   variant->gallivm = gallivm_create(module_name, llvm->context);
-
-   create_jit_types(variant);
+            variant->no);
+
+   if (draw->disk_cache_find_shader) {
+      draw_get_ir_cache_key(draw->vs.vertex_shader->state.tokens,
+                            key, shader->variant_key_size, num_inputs,
+                            module_name, variant->ir_sha1_cache_key);
+      draw->disk_cache_find_shader(draw->disk_cache_cookie,
+                                   &cached, variant->ir_sha1_cache_key);
+      if (!cached.data_size)
+         needs_caching = true;
+   }
 
    memcpy(&variant->key, key, shader->variant_key_size);
 
@@ -650,18 +744,29 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
       draw_llvm_dump_variant_key(&variant->key);
    }
 
-   vertex_header = create_jit_vertex_header(variant->gallivm, num_inputs);
+   draw_llvm_build_variant(variant, llvm->context, &cached);
 
-   variant->vertex_header_ptr_type = LLVMPointerType(vertex_header, 0);
-
-   draw_llvm_generate(llvm, variant);
+   /*
+    * Code that is not in the disk cache starts out unoptimized; the
+    * optimized code replaces it once the variant is hot, and that is
+    * the code stored in the disk cache.
+    */
+   if (util_queue_is_initialized(&llvm->compile_queue) && !cached.data_size) {
+      variant->gallivm->no_opt = TRUE;
+      needs_caching = false;
+   }
 
    gallivm_compile_module(variant->gallivm);
 
    variant->jit_func = (draw_jit_vert_func)
          gallivm_jit_function(variant->gallivm, variant->function);
 
+   if (needs_caching)
+      draw->disk_cache_insert_shader(draw->disk_cache_cookie,
+                                     &cached, variant->ir_sha1_cache_key);
+
    gallivm_free_ir(variant->gallivm);
+   free(cached.data);
 
    variant->list_item_global.base = variant;
    variant->list_item_local.base = variant;
@@ -672,6 +777,85 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
 }
 
 
+/**
+ * Compile the optimized code of a vertex shader variant on the compile
+ * queue.  The IR was already built in variant->tier_up, with an LLVM
+ * context and a disk cache entry of its own, by draw_llvm_variant_use().
+ */
+static void
+draw_llvm_variant_optimize(void *data, int thread_index)
+{
+   struct draw_llvm_variant *variant = data;
+   struct draw_llvm_variant *tmp = variant->tier_up;
+   struct draw_context *draw = variant->llvm->draw;
+   struct lp_cached_code *cached = tmp->gallivm->cache;
+   LLVMContextRef context = tmp->gallivm->context;
+
+   gallivm_compile_module(tmp->gallivm);
+
+   variant->gallivm_opt = tmp->gallivm;
+   variant->jit_func = (draw_jit_vert_func)
+         gallivm_jit_function(tmp->gallivm, tmp->function);
+
+   if (draw->disk_cache_find_shader)
+      draw->disk_cache_insert_shader(draw->disk_cache_cookie,
+                                     cached, variant->ir_sha1_cache_key);
+
+   gallivm_free_ir(tmp->gallivm);
+   LLVMContextDispose(context);
+   free(cached->data);
+   FREE(cached);
+
+   variant->tier_up = NULL;
+   FREE(tmp);
+}
+
+
+/**
+ * Count a run of a vertex shader variant.  When it still runs unoptimized
+ * code and got hot, rebuild its IR and queue the optimized compilation.
+ *
+ * The IR depends on the vertex shader state of the draw context, so it
+ * must be built here, while the variant is the current one.
+ */
+void
+draw_llvm_variant_use(struct draw_llvm_variant *variant)
+{
+   struct draw_llvm *llvm = variant->llvm;
+   struct draw_llvm_variant *tmp;
+   struct lp_cached_code *cached;
+   LLVMContextRef context;
+
+   if (!variant->gallivm->no_opt || !gallivm_tier_up(&variant->uses))
+      return;
+
+   tmp = MALLOC(sizeof *tmp +
+                variant->shader->variant_key_size -
+                sizeof tmp->key);
+   cached = CALLOC_STRUCT(lp_cached_code);
+   context = LLVMContextCreate();
+   if (!tmp || !cached || !context) {
+      if (context)
+         LLVMContextDispose(context);
+      FREE(cached);
+      FREE(tmp);
+      return;
+   }
+
+   tmp->llvm = llvm;
+   tmp->shader = variant->shader;
+   tmp->no = variant->no;
+   tmp->num_inputs = variant->num_inputs;
+   memcpy(&tmp->key, &variant->key, variant->shader->variant_key_size);
+
+   draw_llvm_build_variant(tmp, context, cached);
+
+   variant->tier_up = tmp;
+   util_queue_add_job(&llvm->compile_queue, variant, &variant->ready,
+                      draw_llvm_variant_optimize, NULL);
+}
+
+
 static void
 generate_vs(struct draw_llvm_variant *variant,
             LLVMBuilderRef builder,
@@ -1662,7 +1846,7 @@ draw_llvm_generate(struct draw_llvm *llvm, struct draw_llvm_variant *variant)
    memset(&system_values, 0, sizeof(system_values));
 
    snprintf(func_name, sizeof(func_name), "draw_llvm_vs_variant%u",
-            variant->shader->variants_cached);
+            variant->no);
 
    i = 0;
    arg_types[i++] = get_context_ptr_type(variant);       /* context */
@@ -2307,6 +2491,21 @@ draw_llvm_destroy_variant(struct draw_llvm_variant *variant)
                     variant->shader->variants_cached, llvm->nr_variants);
    }
 
+   if (util_queue_is_initialized(&llvm->compile_queue))
+      util_queue_drop_job(&llvm->compile_queue, &variant->ready);
+   if (variant->tier_up) {
+      struct gallivm_state *gallivm = variant->tier_up->gallivm;
+      LLVMContextRef context = gallivm->context;
+      struct lp_cached_code *cached = gallivm->cache;
+      gallivm_destroy(gallivm);
+      LLVMContextDispose(context);
+      FREE(cached);
+      FREE(variant->tier_up);
+   }
+   util_queue_fence_destroy(&variant->ready);
+
+   if (variant->gallivm_opt)
+      gallivm_destroy(variant->gallivm_opt);
    gallivm_destroy(variant->gallivm);
 
    remove_from_list(&variant->list_item_local);
@@ -2537,8 +2736,12 @@ draw_gs_llvm_create_variant(struct draw_llvm *llvm,
    struct draw_gs_llvm_variant *variant;
    struct llvm_geometry_shader *shader =
       llvm_geometry_shader(llvm->draw->gs.geometry_shader);
+   struct draw_context *draw = llvm->draw;
    LLVMTypeRef vertex_header;
    char module_name[64];
+   unsigned char ir_sha1_cache_key[20];
+   struct lp_cached_code cached = { 0 };
+   bool needs_caching = false;
 
    variant = MALLOC(sizeof *variant +
                     shader->variant_key_size -
@@ -2552,7 +2755,17 @@ draw_gs_llvm_create_variant(struct draw_llvm *llvm,
    snprintf(module_name, sizeof(module_name), "draw_llvm_gs_variant%u",
             variant->shader->variants_cached);
 
-   variant->gallivm = gallivm_create(module_name, llvm->context);
+   if (draw->disk_cache_find_shader) {
+      draw_get_ir_cache_key(draw->gs.geometry_shader->state.tokens,
+                            key, shader->variant_key_size, num_outputs,
+                            module_name, ir_sha1_cache_key);
+      draw->disk_cache_find_shader(draw->disk_cache_cookie,
+                                   &cached, ir_sha1_cache_key);
+      if (!cached.data_size)
+         needs_caching = true;
+   }
+
+   variant->gallivm = gallivm_create(module_name, llvm->context, &cached);
 
    create_gs_jit_types(variant);
 
@@ -2569,7 +2782,12 @@ draw_gs_llvm_create_variant(struct draw_llvm *llvm,
    variant->jit_func = (draw_gs_jit_func)
          gallivm_jit_function(variant->gallivm, variant->function);
 
+   if (needs_caching)
+      draw->disk_cache_insert_shader(draw->disk_cache_cookie,
+                                     &cached, ir_sha1_cache_key);
+
    gallivm_free_ir(variant->gallivm);
+   free(cached.data);
 
    variant->list_item_global.base = variant;
    variant->list_item_local.base = variant;
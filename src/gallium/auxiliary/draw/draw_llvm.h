@@ -38,6 +38,11 @@
 
 #include "pipe/p_context.h"
 #include "util/simple_list.h"
+#include "util/u_queue.h"
+
+
+/** Maximum number of vertex shading worker threads */
+#define DRAW_LLVM_MAX_VS_THREADS 8
 
 
 struct draw_llvm;
@@ -468,6 +473,21 @@ struct draw_llvm_variant
    struct draw_llvm_variant_list_item list_item_global;
    struct draw_llvm_variant_list_item list_item_local;
 
+   /*
+    * Unless it came from the disk cache, the code is first compiled without
+    * optimizations.  Once the variant turns out to be used often, an
+    * optimized copy is built in tier_up and compiled on the compile queue
+    * of the draw_llvm, which signals ready and swaps jit_func when done.
+    * The rebuilt code must match the first one, hence no and num_inputs.
+    */
+   unsigned uses;
+   unsigned no;
+   unsigned num_inputs;
+   struct draw_llvm_variant *tier_up;
+   struct gallivm_state *gallivm_opt;
+   struct util_queue_fence ready;
+   unsigned char ir_sha1_cache_key[20];
+
    /* key is variable-sized, must be last */
    struct draw_llvm_variant_key key;
 };
@@ -531,6 +551,13 @@ struct draw_llvm {
 
    struct draw_gs_llvm_variant_list_item gs_variants_list;
    int nr_gs_variants;
+
+   /** Background compilation of hot vertex shader variants */
+   struct util_queue compile_queue;
+
+   /** Worker threads shading parts of large vertex chunks */
+   struct util_queue vs_queue;
+   unsigned num_vs_threads;
 };
 
 
@@ -563,6 +590,9 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
 void
 draw_llvm_destroy_variant(struct draw_llvm_variant *variant);
 
+void
+draw_llvm_variant_use(struct draw_llvm_variant *variant);
+
 struct draw_llvm_variant_key *
 draw_llvm_make_variant_key(struct draw_llvm *llvm, char *store);
 
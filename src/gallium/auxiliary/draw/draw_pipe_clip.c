@@ -340,6 +340,37 @@ static inline float getclipdist(const struct clip_stage *clipper,
    return dp;
 }
 
+/*
+ * Compute the distances of a vertex to all the planes in clipmask at
+ * once, indexed by plane.  Distances are linear in clip space, so the
+ * triangle clipper only has to interpolate them for the vertices it
+ * creates instead of evaluating every remaining plane again.
+ */
+static inline void
+getclipdists(const struct clip_stage *clipper,
+             struct vertex_header *vert,
+             unsigned clipmask,
+             float *dist)
+{
+   while (clipmask) {
+      const unsigned plane_idx = u_bit_scan(&clipmask);
+      dist[plane_idx] = getclipdist(clipper, vert, plane_idx);
+   }
+}
+
+static inline void
+interp_clipdists(float *dst,
+                 float t,
+                 const float *out,
+                 const float *in,
+                 unsigned clipmask)
+{
+   while (clipmask) {
+      const unsigned plane_idx = u_bit_scan(&clipmask);
+      dst[plane_idx] = LINTERP(t, out[plane_idx], in[plane_idx]);
+   }
+}
+
 /* Clip a triangle against the viewport and user clip planes.
  */
 static void
@@ -360,12 +391,23 @@ do_clip_tri(struct draw_stage *stage,
    boolean bEdges[MAX_CLIPPED_VERTICES];
    boolean *inEdges = aEdges;
    boolean *outEdges = bEdges;
+   /* plane distances, slots 0-2 for the input vertices, then stage->tmp */
+   float dists[3 + MAX_CLIPPED_VERTICES + 1][6 + PIPE_MAX_CLIP_PLANES];
+   unsigned aSlots[MAX_CLIPPED_VERTICES];
+   unsigned bSlots[MAX_CLIPPED_VERTICES];
+   unsigned *inSlots = aSlots;
+   unsigned *outSlots = bSlots;
    int viewport_index = 0;
 
    inlist[0] = header->v[0];
    inlist[1] = header->v[1];
    inlist[2] = header->v[2];
 
+   for (i = 0; i < 3; i++) {
+      inSlots[i] = i;
+      getclipdists(clipper, inlist[i], clipmask, dists[i]);
+   }
+
    /*
     * For d3d10, we need to take this from the leading (first) vertex.
     * For GL, we could do anything (as long as we advertize
@@ -417,10 +459,11 @@ do_clip_tri(struct draw_stage *stage,
       const boolean is_user_clip_plane = plane_idx >= 6;
       struct vertex_header *vert_prev = inlist[0];
       boolean *edge_prev = &inEdges[0];
+      unsigned slot_prev = inSlots[0];
       float dp_prev;
       unsigned outcount = 0;
 
-      dp_prev = getclipdist(clipper, vert_prev, plane_idx);
+      dp_prev = dists[slot_prev][plane_idx];
       clipmask &= ~(1<<plane_idx);
 
       if (util_is_inf_or_nan(dp_prev))
@@ -431,13 +474,15 @@ do_clip_tri(struct draw_stage *stage,
          return;
       inlist[n] = inlist[0]; /* prevent rotation of vertices */
       inEdges[n] = inEdges[0];
+      inSlots[n] = inSlots[0];
 
       for (i = 1; i <= n; i++) {
          struct vertex_header *vert = inlist[i];
          boolean *edge = &inEdges[i];
+         const unsigned slot = inSlots[i];
          boolean different_sign;
 
-         float dp = getclipdist(clipper, vert, plane_idx);
+         float dp = dists[slot][plane_idx];
 
          if (util_is_inf_or_nan(dp))
             return; //discard nan
@@ -447,6 +492,7 @@ do_clip_tri(struct draw_stage *stage,
             if (outcount >= MAX_CLIPPED_VERTICES)
                return;
             outEdges[outcount] = *edge_prev;
+            outSlots[outcount] = slot_prev;
             outlist[outcount++] = vert_prev;
             different_sign = dp < 0.0f;
          } else {
@@ -456,10 +502,12 @@ do_clip_tri(struct draw_stage *stage,
          if (different_sign) {
             struct vertex_header *new_vert;
             boolean *new_edge;
+            unsigned new_slot;
 
             assert(tmpnr < MAX_CLIPPED_VERTICES + 1);
             if (tmpnr >= MAX_CLIPPED_VERTICES + 1)
                return;
+            new_slot = 3 + tmpnr;
             new_vert = clipper->stage.tmp[tmpnr++];
 
             assert(outcount < MAX_CLIPPED_VERTICES);
@@ -467,6 +515,7 @@ do_clip_tri(struct draw_stage *stage,
                return;
 
             new_edge = &outEdges[outcount];
+            outSlots[outcount] = new_slot;
             outlist[outcount++] = new_vert;
 
             if (dp < 0.0f) {
@@ -475,6 +524,8 @@ do_clip_tri(struct draw_stage *stage,
                 */
                float t = dp / (dp - dp_prev);
                interp( clipper, new_vert, t, vert, vert_prev, viewport_index );
+               interp_clipdists(dists[new_slot], t, dists[slot],
+                                dists[slot_prev], clipmask);
 
                /* Whether or not to set edge flag for the new vert depends
                 * on whether it's a user-defined clipping plane.  We're
@@ -496,6 +547,8 @@ do_clip_tri(struct draw_stage *stage,
                 */
                float t = dp_prev / (dp_prev - dp);
                interp( clipper, new_vert, t, vert_prev, vert, viewport_index );
+               interp_clipdists(dists[new_slot], t, dists[slot_prev],
+                                dists[slot], clipmask);
 
                /* Copy starting vert's edgeflag:
                 */
@@ -506,6 +559,7 @@ do_clip_tri(struct draw_stage *stage,
 
          vert_prev = vert;
          edge_prev = edge;
+         slot_prev = slot;
          dp_prev = dp;
       }
 
@@ -521,6 +575,11 @@ do_clip_tri(struct draw_stage *stage,
          inEdges = outEdges;
          outEdges = tmp;
       }
+      {
+         unsigned *tmp = inSlots;
+         inSlots = outSlots;
+         outSlots = tmp;
+      }
 
    }
 
@@ -71,6 +71,7 @@ struct tgsi_buffer;
 struct draw_pt_front_end;
 struct draw_assembler;
 struct draw_llvm;
+struct lp_cached_code;
 
 
 /**
@@ -332,6 +333,15 @@ struct draw_context
 
    struct draw_llvm *llvm;
 
+   /** Optional persistent cache for the LLVM shader variants */
+   void *disk_cache_cookie;
+   void (*disk_cache_find_shader)(void *cookie,
+                                  struct lp_cached_code *cache,
+                                  unsigned char ir_sha1_cache_key[20]);
+   void (*disk_cache_insert_shader)(void *cookie,
+                                    struct lp_cached_code *cache,
+                                    unsigned char ir_sha1_cache_key[20]);
+
    /** Texture sampler and sampler view state.
     * Note that we have arrays indexed by shader type.  At this time
     * we only handle vertex and geometry shaders in the draw module, but
@@ -348,6 +358,12 @@ struct draw_context
    struct pipe_query_data_pipeline_statistics statistics;
    boolean collect_statistics;
 
+   /** Indices of indexed draws, and the vertices fetched for them */
+   struct {
+      uint64_t indices;
+      uint64_t fetches;
+   } vcache_stats;
+
    struct draw_assembler *ia;
 
    void *driver_private;
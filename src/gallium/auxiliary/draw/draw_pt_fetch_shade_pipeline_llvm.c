@@ -28,6 +28,7 @@
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_prim.h"
+#include "util/u_queue.h"
 #include "draw/draw_context.h"
 #include "draw/draw_gs.h"
 #include "draw/draw_vbuf.h"
@@ -364,6 +365,121 @@ emit(struct pt_emit *emit,
 }
 
 
+/**
+ * Below this many vertices a part of a chunk is not worth handing over to
+ * a vertex shading worker thread.
+ */
+#define LLVM_VS_JOB_MIN_VERTICES 256
+
+
+/**
+ * A part of a vertex chunk, shaded by one thread.
+ */
+struct llvm_vs_job {
+   struct util_queue_fence fence;
+   struct llvm_middle_end *fpme;
+   draw_jit_vert_func jit_func;
+   struct vertex_header *verts;
+   unsigned count;
+   unsigned start_or_maxelt;
+   unsigned vid_base;
+   const unsigned *elts;
+   boolean clipped;
+};
+
+
+static void
+llvm_vs_job_run(void *data, int thread_index)
+{
+   struct llvm_vs_job *job = data;
+   struct llvm_middle_end *fpme = job->fpme;
+   struct draw_context *draw = fpme->draw;
+
+   job->clipped = job->jit_func(&fpme->llvm->jit_context,
+                                job->verts,
+                                draw->pt.user.vbuffer,
+                                job->count,
+                                job->start_or_maxelt,
+                                fpme->vertex_size,
+                                draw->pt.vertex_buffer,
+                                draw->instance_id,
+                                job->vid_base,
+                                draw->start_instance,
+                                job->elts);
+}
+
+
+/**
+ * Run fetch, the vertex shader and clip testing over a chunk of vertices.
+ *
+ * Large chunks are split into parts, each a whole number of SIMD vectors,
+ * shaded concurrently by the vertex shading threads and the calling
+ * thread.  Every part writes its own slice of the output, so the vertices
+ * stay in order for the rest of the pipeline.  Shaders with side effects
+ * are always run on the calling thread.
+ */
+static boolean
+llvm_pipeline_shade(struct llvm_middle_end *fpme,
+                    struct vertex_header *verts,
+                    unsigned count,
+                    unsigned start_or_maxelt,
+                    unsigned vid_base,
+                    const unsigned *elts)
+{
+   struct draw_llvm *llvm = fpme->llvm;
+   const unsigned vector_length = lp_native_vector_width / 32;
+   struct llvm_vs_job jobs[DRAW_LLVM_MAX_VS_THREADS + 1];
+   unsigned num_jobs = 1, per_job, i;
+   boolean clipped = FALSE;
+
+   if (llvm->num_vs_threads &&
+       !fpme->draw->vs.vertex_shader->info.writes_memory) {
+      num_jobs = MIN2(count / LLVM_VS_JOB_MIN_VERTICES,
+                      llvm->num_vs_threads + 1);
+   }
+
+   per_job = align(DIV_ROUND_UP(count, MAX2(num_jobs, 1)), vector_length);
+   num_jobs = DIV_ROUND_UP(count, per_job);
+
+   for (i = 0; i < num_jobs; i++) {
+      struct llvm_vs_job *job = &jobs[i];
+      unsigned offset = i * per_job;
+
+      job->fpme = fpme;
+      job->jit_func = fpme->current_variant->jit_func;
+      job->verts = (struct vertex_header *)
+         ((char *)verts + offset * fpme->vertex_size);
+      job->count = MIN2(per_job, count - offset);
+      job->vid_base = vid_base;
+      if (elts) {
+         job->start_or_maxelt = start_or_maxelt;
+         job->elts = elts + offset;
+      }
+      else {
+         job->start_or_maxelt = start_or_maxelt + offset;
+         job->elts = NULL;
+      }
+
+      if (i) {
+         util_queue_fence_init(&job->fence);
+         util_queue_add_job(&llvm->vs_queue, job, &job->fence,
+                            llvm_vs_job_run, NULL);
+      }
+   }
+
+   llvm_vs_job_run(&jobs[0], 0);
+   clipped = jobs[0].clipped;
+
+   for (i = 1; i < num_jobs; i++) {
+      util_queue_fence_wait(&jobs[i].fence);
+      util_queue_fence_destroy(&jobs[i].fence);
+      clipped |= jobs[i].clipped;
+   }
+
+   return clipped;
+}
+
+
 static void
 llvm_pipeline_generic(struct draw_pt_middle_end *middle,
                       const struct draw_fetch_info *fetch_info,
@@ -414,17 +530,10 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
       vid_base = draw->pt.user.eltBias;
       elts = fetch_info->elts;
    }
-   clipped = fpme->current_variant->jit_func(&fpme->llvm->jit_context,
-                                             llvm_vert_info.verts,
-                                             draw->pt.user.vbuffer,
-                                             fetch_info->count,
-                                             start_or_maxelt,
-                                             fpme->vertex_size,
-                                             draw->pt.vertex_buffer,
-                                             draw->instance_id,
-                                             vid_base,
-                                             draw->start_instance,
-                                             elts);
+   draw_llvm_variant_use(fpme->current_variant);
+   clipped = llvm_pipeline_shade(fpme, llvm_vert_info.verts,
+                                 fetch_info->count, start_or_maxelt,
+                                 vid_base, elts);
 
    /* Finished with fetch and vs:
     */
@@ -23,6 +23,7 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include "util/u_debug.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 
@@ -31,7 +32,13 @@
 #include "draw/draw_pt.h"
 
 #define SEGMENT_SIZE 1024
-#define MAP_SIZE     256
+
+/*
+ * The vertex cache is a hash table of the fetch elements of the segment,
+ * with room for all of them.  It is cleared by bumping the stamp.
+ */
+#define MAP_BITS     11
+#define MAP_SIZE     (1 << MAP_BITS)
 
 /* The largest possible index within an index buffer */
 #define MAX_ELT_IDX 0xffffffff
@@ -56,7 +63,12 @@ struct vsplit_frontend {
       /* map a fetch element to a draw element */
       unsigned fetches[MAP_SIZE];
       ushort draws[MAP_SIZE];
-      boolean has_max_fetch;
+      /* an entry is valid when its stamp is the current one */
+      unsigned stamps[MAP_SIZE];
+      unsigned stamp;
+
+      /* a cached fetch is reused if it's one of the last 'size' ones */
+      unsigned size;
 
       ushort num_fetch_elts;
       ushort num_draw_elts;
@@ -67,8 +79,10 @@ struct vsplit_frontend {
 static void
 vsplit_clear_cache(struct vsplit_frontend *vsplit)
 {
-   memset(vsplit->cache.fetches, 0xff, sizeof(vsplit->cache.fetches));
-   vsplit->cache.has_max_fetch = FALSE;
+   if (++vsplit->cache.stamp == 0) {
+      memset(vsplit->cache.stamps, 0, sizeof(vsplit->cache.stamps));
+      vsplit->cache.stamp = 1;
+   }
    vsplit->cache.num_fetch_elts = 0;
    vsplit->cache.num_draw_elts = 0;
 }
@@ -76,6 +90,11 @@ vsplit_clear_cache(struct vsplit_frontend *vsplit)
 static void
 vsplit_flush_cache(struct vsplit_frontend *vsplit, unsigned flags)
 {
+   struct draw_context *draw = vsplit->draw;
+
+   draw->vcache_stats.indices += vsplit->cache.num_draw_elts;
+   draw->vcache_stats.fetches += vsplit->cache.num_fetch_elts;
+
    vsplit->middle->run(vsplit->middle,
          vsplit->fetch_elts, vsplit->cache.num_fetch_elts,
          vsplit->draw_elts, vsplit->cache.num_draw_elts, flags);
@@ -83,18 +102,27 @@ vsplit_flush_cache(struct vsplit_frontend *vsplit, unsigned flags)
 
 /**
  * Add a fetch element and add it to the draw elements.
+ *
+ * This works like a FIFO post-transform cache: the element is fetched
+ * again unless it was among the last cache.size fetches of the segment.
  */
 static inline void
 vsplit_add_cache(struct vsplit_frontend *vsplit, unsigned fetch)
 {
    unsigned hash;
 
-   hash = fetch % MAP_SIZE;
+   hash = (fetch * 2654435761u) >> (32 - MAP_BITS);
 
-   /* If the value isn't in the cache or it's an overflow due to the
-    * element bias */
-   if (vsplit->cache.fetches[hash] != fetch) {
+   /* open addressing, the table never gets more than half full */
+   while (vsplit->cache.stamps[hash] == vsplit->cache.stamp &&
+          vsplit->cache.fetches[hash] != fetch)
+      hash = (hash + 1) & (MAP_SIZE - 1);
+
+   if (vsplit->cache.stamps[hash] != vsplit->cache.stamp ||
+       vsplit->cache.num_fetch_elts - vsplit->cache.draws[hash] >
+       vsplit->cache.size) {
       /* update cache */
+      vsplit->cache.stamps[hash] = vsplit->cache.stamp;
       vsplit->cache.fetches[hash] = fetch;
       vsplit->cache.draws[hash] = vsplit->cache.num_fetch_elts;
 
@@ -125,12 +153,6 @@ vsplit_add_cache_ubyte(struct vsplit_frontend *vsplit, const ubyte *elts,
    unsigned elt_idx;
    elt_idx = vsplit_get_base_idx(start, fetch);
    elt_idx = (unsigned)((int)(DRAW_GET_IDX(elts, elt_idx)) + elt_bias);
-   /* unlike the uint case this can only happen with elt_bias */
-   if (elt_bias && elt_idx == DRAW_MAX_FETCH_IDX && !vsplit->cache.has_max_fetch) {
-      unsigned hash = elt_idx % MAP_SIZE;
-      vsplit->cache.fetches[hash] = 0;
-      vsplit->cache.has_max_fetch = TRUE;
-   }
    vsplit_add_cache(vsplit, elt_idx);
 }
 
@@ -142,12 +164,6 @@ vsplit_add_cache_ushort(struct vsplit_frontend *vsplit, const ushort *elts,
    unsigned elt_idx;
    elt_idx = vsplit_get_base_idx(start, fetch);
    elt_idx = (unsigned)((int)(DRAW_GET_IDX(elts, elt_idx)) + elt_bias);
-   /* unlike the uint case this can only happen with elt_bias */
-   if (elt_bias && elt_idx == DRAW_MAX_FETCH_IDX && !vsplit->cache.has_max_fetch) {
-      unsigned hash = elt_idx % MAP_SIZE;
-      vsplit->cache.fetches[hash] = 0;
-      vsplit->cache.has_max_fetch = TRUE;
-   }
    vsplit_add_cache(vsplit, elt_idx);
 }
 
@@ -167,13 +183,6 @@ vsplit_add_cache_uint(struct vsplit_frontend *vsplit, const uint *elts,
     */
    elt_idx = vsplit_get_base_idx(start, fetch);
    elt_idx = (unsigned)((int)(DRAW_GET_IDX(elts, elt_idx)) + elt_bias);
-   /* Take care for DRAW_MAX_FETCH_IDX (since cache is initialized to -1). */
-   if (elt_idx == DRAW_MAX_FETCH_IDX && !vsplit->cache.has_max_fetch) {
-      unsigned hash = elt_idx % MAP_SIZE;
-      /* force update - any value will do except DRAW_MAX_FETCH_IDX */
-      vsplit->cache.fetches[hash] = 0;
-      vsplit->cache.has_max_fetch = TRUE;
-   }
    vsplit_add_cache(vsplit, elt_idx);
 }
 
@@ -266,5 +275,8 @@ struct draw_pt_front_end *draw_pt_vsplit(struct draw_context *draw)
    for (i = 0; i < SEGMENT_SIZE; i++)
       vsplit->identity_draw_elts[i] = i;
 
+   vsplit->cache.size = debug_get_num_option("DRAW_VCACHE_SIZE", SEGMENT_SIZE);
+   vsplit->cache.size = CLAMP(vsplit->cache.size, 1, SEGMENT_SIZE);
+
    return &vsplit->base;
 }
@@ -30,10 +30,19 @@
  * @file
  * Trace dumping functions.
  *
- * For now we just use standard XML for dumping the trace calls, as this is
- * simple to write, parse, and visually inspect, but the actual representation
- * is abstracted out of this file, so that we can switch to a binary
- * representation if/when it becomes justified.
+ * By default we use standard XML for dumping the trace calls, as this is
+ * simple to write, parse, and visually inspect.  The actual representation
+ * is abstracted out of this file, which also implements a compact binary
+ * representation that is selected with GALLIUM_TRACE_BINARY.
+ *
+ * The binary trace is a sequence of records that mirror the dumping
+ * functions below.  Names of classes, methods, arguments, struct members and
+ * enums are written to a string table the first time they are used and
+ * referred to by index afterwards.  Large byte blobs (buffer contents) are
+ * deduplicated by their SHA-1.  The records are buffered in blocks which a
+ * writer thread writes to the file, so that tracing doesn't stall on I/O,
+ * and the number of blocks in flight is bounded.  The trace tools in
+ * src/gallium/tools/trace convert binary traces to XML.
  *
  * @author Jose Fonseca <jfonseca@vmware.com>
  */
@@ -51,6 +60,10 @@
 #include "util/u_string.h"
 #include "util/u_math.h"
 #include "util/u_format.h"
+#include "util/u_queue.h"
+#include "util/hash_table.h"
+#include "util/mesa-sha1.h"
+#include "util/ralloc.h"
 
 #include "tr_dump.h"
 #include "tr_screen.h"
@@ -64,6 +77,273 @@ static long unsigned call_no = 0;
 static bool dumping = false;
 
 
+/*
+ * Binary trace records.  Keep in sync with src/gallium/tools/trace/binary.py.
+ *
+ * The file starts with TRACE_BIN_MAGIC and the format version as a varint.
+ * Integers are LEB128 varints (zigzag encoded for signed values), strings
+ * and blobs are a varint length followed by the bytes, and floats are the
+ * 64 bit IEEE representation in little endian byte order.
+ */
+#define TRACE_BIN_MAGIC "GTRB"
+#define TRACE_BIN_VERSION 1
+
+enum trace_bin_op {
+   TRACE_BIN_STRING_DEF = 1,  /* string id, string */
+   TRACE_BIN_CALL,            /* call no, class id, method id */
+   TRACE_BIN_CALL_END,        /* time */
+   TRACE_BIN_ARG,             /* name id, value */
+   TRACE_BIN_RET,             /* value */
+   TRACE_BIN_NULL,
+   TRACE_BIN_BOOL,            /* 0 or 1 */
+   TRACE_BIN_INT,             /* signed varint */
+   TRACE_BIN_UINT,            /* varint */
+   TRACE_BIN_FLOAT,           /* double */
+   TRACE_BIN_STRING,          /* string */
+   TRACE_BIN_ENUM,            /* string id */
+   TRACE_BIN_BYTES,           /* bytes */
+   TRACE_BIN_BLOB_DEF,        /* blob id, bytes */
+   TRACE_BIN_BLOB,            /* blob id of an earlier TRACE_BIN_BLOB_DEF */
+   TRACE_BIN_ARRAY,           /* values, TRACE_BIN_END */
+   TRACE_BIN_STRUCT,          /* name id, members, TRACE_BIN_END */
+   TRACE_BIN_MEMBER,          /* name id, value */
+   TRACE_BIN_END,
+   TRACE_BIN_PTR,             /* varint */
+};
+
+/* Blocks are handed to the writer thread once they are this full. */
+#define TRACE_BIN_BLOCK_SIZE (64 * 1024)
+/* Blocks queued for the writer thread before tracing waits for it. */
+#define TRACE_BIN_MAX_BLOCKS 16
+/* Smaller byte arrays are written inline instead of being deduplicated. */
+#define TRACE_BIN_MIN_BLOB_SIZE 64
+
+struct trace_bin_block {
+   struct util_queue_fence fence;
+   size_t size;
+   size_t capacity;
+   uint8_t *data;
+};
+
+static bool binary = false;
+static struct util_queue writer_queue;
+static struct trace_bin_block *block = NULL;
+static struct hash_table *string_ids = NULL;
+static struct hash_table *blob_ids = NULL;
+
+
+static void
+trace_bin_block_write(void *job, int thread_index)
+{
+   struct trace_bin_block *blk = (struct trace_bin_block *)job;
+
+   fwrite(blk->data, blk->size, 1, stream);
+   fflush(stream);
+}
+
+
+static void
+trace_bin_block_destroy(void *job, int thread_index)
+{
+   struct trace_bin_block *blk = (struct trace_bin_block *)job;
+
+   util_queue_fence_destroy(&blk->fence);
+   FREE(blk->data);
+   FREE(blk);
+}
+
+
+/* Hand the current block to the writer thread. */
+static void
+trace_bin_submit(void)
+{
+   if (!block || !block->size)
+      return;
+
+   util_queue_add_job(&writer_queue, block, &block->fence,
+                      trace_bin_block_write, trace_bin_block_destroy);
+   block = NULL;
+}
+
+
+static uint8_t *
+trace_bin_reserve(size_t size)
+{
+   uint8_t *ptr;
+
+   if (!block) {
+      block = CALLOC_STRUCT(trace_bin_block);
+      if (!block)
+         return NULL;
+      util_queue_fence_init(&block->fence);
+   }
+
+   if (block->size + size > block->capacity) {
+      size_t capacity = MAX2(MAX2(block->capacity * 2, TRACE_BIN_BLOCK_SIZE),
+                             block->size + size);
+      uint8_t *data = REALLOC(block->data, block->capacity, capacity);
+      if (!data)
+         return NULL;
+      block->data = data;
+      block->capacity = capacity;
+   }
+
+   ptr = block->data + block->size;
+   block->size += size;
+   return ptr;
+}
+
+
+static inline void
+trace_bin_write(const void *data, size_t size)
+{
+   uint8_t *ptr = trace_bin_reserve(size);
+   if (ptr)
+      memcpy(ptr, data, size);
+}
+
+
+static inline void
+trace_bin_op(enum trace_bin_op op)
+{
+   uint8_t *ptr = trace_bin_reserve(1);
+   if (ptr)
+      *ptr = op;
+}
+
+
+static inline void
+trace_bin_uint(uint64_t value)
+{
+   uint8_t buf[10];
+   unsigned len = 0;
+
+   do {
+      buf[len] = value & 0x7f;
+      value >>= 7;
+      if (value)
+         buf[len] |= 0x80;
+      len++;
+   } while (value);
+
+   trace_bin_write(buf, len);
+}
+
+
+static inline void
+trace_bin_int(int64_t value)
+{
+   trace_bin_uint(((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+
+static inline void
+trace_bin_data(const void *data, size_t size)
+{
+   trace_bin_uint(size);
+   trace_bin_write(data, size);
+}
+
+
+/*
+ * Return the string table index of a name, defining it first if necessary.
+ * This must be called before the record that uses the index is started.
+ */
+static unsigned
+trace_bin_string_id(const char *str)
+{
+   struct hash_entry *entry;
+   unsigned id;
+
+   entry = _mesa_hash_table_search(string_ids, str);
+   if (entry)
+      return (uintptr_t)entry->data;
+
+   id = string_ids->entries;
+   _mesa_hash_table_insert(string_ids, ralloc_strdup(string_ids, str),
+                           (void *)(uintptr_t)id);
+
+   trace_bin_op(TRACE_BIN_STRING_DEF);
+   trace_bin_uint(id);
+   trace_bin_data(str, strlen(str));
+   return id;
+}
+
+
+static uint32_t
+trace_bin_hash_sha1(const void *key)
+{
+   uint32_t hash;
+   memcpy(&hash, key, sizeof(hash));
+   return hash;
+}
+
+
+static bool
+trace_bin_sha1_equal(const void *a, const void *b)
+{
+   return memcmp(a, b, 20) == 0;
+}
+
+
+static void
+trace_bin_bytes(const void *data, size_t size)
+{
+   struct hash_entry *entry;
+   unsigned char sha1[20];
+   unsigned char *key;
+   unsigned id;
+
+   if (size < TRACE_BIN_MIN_BLOB_SIZE) {
+      trace_bin_op(TRACE_BIN_BYTES);
+      trace_bin_data(data, size);
+      return;
+   }
+
+   _mesa_sha1_compute(data, size, sha1);
+
+   entry = _mesa_hash_table_search(blob_ids, sha1);
+   if (entry) {
+      trace_bin_op(TRACE_BIN_BLOB);
+      trace_bin_uint((uintptr_t)entry->data);
+      return;
+   }
+
+   id = blob_ids->entries;
+   key = ralloc_size(blob_ids, sizeof(sha1));
+   if (key) {
+      memcpy(key, sha1, sizeof(sha1));
+      _mesa_hash_table_insert(blob_ids, key, (void *)(uintptr_t)id);
+   }
+
+   trace_bin_op(TRACE_BIN_BLOB_DEF);
+   trace_bin_uint(id);
+   trace_bin_data(data, size);
+}
+
+
+static bool
+trace_bin_begin(void)
+{
+   string_ids = _mesa_hash_table_create(NULL, _mesa_hash_string,
+                                        _mesa_key_string_equal);
+   blob_ids = _mesa_hash_table_create(NULL, trace_bin_hash_sha1,
+                                      trace_bin_sha1_equal);
+   if (!string_ids || !blob_ids)
+      return false;
+
+   /* The writer thread must not be resized: waiting for a free slot is
+    * what bounds the memory used by the queued blocks.
+    */
+   if (!util_queue_init(&writer_queue, "gtrace", TRACE_BIN_MAX_BLOCKS, 1, 0))
+      return false;
+
+   trace_bin_write(TRACE_BIN_MAGIC, 4);
+   trace_bin_uint(TRACE_BIN_VERSION);
+   return true;
+}
+
+
 static inline void
 trace_dump_write(const char *buf, size_t size)
 {
@@ -166,7 +446,11 @@ trace_dump_tag_end(const char *name)
 void
 trace_dump_trace_flush(void)
 {
-   if (stream) {
+   /* This is called before calls that may crash, so that they are in the
+    * trace.  Binary traces are written asynchronously anyway, so they don't
+    * submit partial blocks here.
+    */
+   if (stream && !binary) {
       fflush(stream);
    }
 }
@@ -175,7 +459,14 @@ static void
 trace_dump_trace_close(void)
 {
    if (stream) {
-      trace_dump_writes("</trace>\n");
+      if (binary) {
+         mtx_lock(&call_mutex);
+         trace_bin_submit();
+         mtx_unlock(&call_mutex);
+         util_queue_finish(&writer_queue);
+      } else {
+         trace_dump_writes("</trace>\n");
+      }
       if (close_stream) {
          fclose(stream);
          close_stream = false;
@@ -209,6 +500,7 @@ trace_dump_trace_begin(void)
       return false;
 
    if (!stream) {
+      binary = debug_get_bool_option("GALLIUM_TRACE_BINARY", false);
 
       if (strcmp(filename, "stderr") == 0) {
          close_stream = false;
@@ -220,18 +512,30 @@ trace_dump_trace_begin(void)
       }
       else {
          close_stream = true;
-         stream = fopen(filename, "wt");
+         stream = fopen(filename, binary ? "wb" : "wt");
          if (!stream)
             return false;
       }
 
-      trace_dump_writes("<?xml version='1.0' encoding='UTF-8'?>\n");
-      trace_dump_writes("<?xml-stylesheet type='text/xsl' href='trace.xsl'?>\n");
-      trace_dump_writes("<trace version='0.1'>\n");
+      if (binary) {
+         if (!trace_bin_begin()) {
+            if (close_stream)
+               fclose(stream);
+            stream = NULL;
+            return false;
+         }
+      } else {
+         trace_dump_writes("<?xml version='1.0' encoding='UTF-8'?>\n");
+         trace_dump_writes("<?xml-stylesheet type='text/xsl' href='trace.xsl'?>\n");
+         trace_dump_writes("<trace version='0.1'>\n");
+      }
 
       /* Many applications don't exit cleanly, others may create and destroy a
        * screen multiple times, so we only write </trace> tag and close at exit
        * time.
+       *
+       * This is registered after the writer thread has been created, so that
+       * it runs before the thread is killed at exit.
        */
       atexit(trace_dump_trace_close);
    }
@@ -312,6 +616,19 @@ void trace_dump_call_begin_locked(const char *klass, const char *method)
       return;
 
    ++call_no;
+
+   if (binary) {
+      unsigned klass_id = trace_bin_string_id(klass);
+      unsigned method_id = trace_bin_string_id(method);
+
+      trace_bin_op(TRACE_BIN_CALL);
+      trace_bin_uint(call_no);
+      trace_bin_uint(klass_id);
+      trace_bin_uint(method_id);
+      call_start_time = os_time_get();
+      return;
+   }
+
    trace_dump_indent(1);
    trace_dump_writes("<call no=\'");
    trace_dump_writef("%lu", call_no);
@@ -334,6 +651,14 @@ void trace_dump_call_end_locked(void)
 
    call_end_time = os_time_get();
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_CALL_END);
+      trace_bin_int(call_end_time - call_start_time);
+      if (block && block->size >= TRACE_BIN_BLOCK_SIZE)
+         trace_bin_submit();
+      return;
+   }
+
    trace_dump_call_time(call_end_time - call_start_time);
    trace_dump_indent(1);
    trace_dump_tag_end("call");
@@ -358,13 +683,21 @@ void trace_dump_arg_begin(const char *name)
    if (!dumping)
       return;
 
+   if (binary) {
+      unsigned id = trace_bin_string_id(name);
+
+      trace_bin_op(TRACE_BIN_ARG);
+      trace_bin_uint(id);
+      return;
+   }
+
    trace_dump_indent(2);
    trace_dump_tag_begin1("arg", "name", name);
 }
 
 void trace_dump_arg_end(void)
 {
-   if (!dumping)
+   if (!dumping || binary)
       return;
 
    trace_dump_tag_end("arg");
@@ -376,13 +709,18 @@ void trace_dump_ret_begin(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_RET);
+      return;
+   }
+
    trace_dump_indent(2);
    trace_dump_tag_begin("ret");
 }
 
 void trace_dump_ret_end(void)
 {
-   if (!dumping)
+   if (!dumping || binary)
       return;
 
    trace_dump_tag_end("ret");
@@ -394,6 +732,12 @@ void trace_dump_bool(int value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_BOOL);
+      trace_bin_uint(value ? 1 : 0);
+      return;
+   }
+
    trace_dump_writef("<bool>%c</bool>", value ? '1' : '0');
 }
 
@@ -402,6 +746,12 @@ void trace_dump_int(long long int value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_INT);
+      trace_bin_int(value);
+      return;
+   }
+
    trace_dump_writef("<int>%lli</int>", value);
 }
 
@@ -410,6 +760,12 @@ void trace_dump_uint(long long unsigned value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_UINT);
+      trace_bin_uint(value);
+      return;
+   }
+
    trace_dump_writef("<uint>%llu</uint>", value);
 }
 
@@ -418,6 +774,19 @@ void trace_dump_float(double value)
    if (!dumping)
       return;
 
+   if (binary) {
+      uint64_t bits;
+      uint8_t buf[8];
+      unsigned i;
+
+      memcpy(&bits, &value, sizeof(bits));
+      for (i = 0; i < 8; i++)
+         buf[i] = bits >> (i * 8);
+      trace_bin_op(TRACE_BIN_FLOAT);
+      trace_bin_write(buf, sizeof(buf));
+      return;
+   }
+
    trace_dump_writef("<float>%g</float>", value);
 }
 
@@ -431,6 +800,11 @@ void trace_dump_bytes(const void *data,
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_bytes(data, size);
+      return;
+   }
+
    trace_dump_writes("<bytes>");
    for(i = 0; i < size; ++i) {
       uint8_t byte = *p++;
@@ -474,6 +848,12 @@ void trace_dump_string(const char *str)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_STRING);
+      trace_bin_data(str, strlen(str));
+      return;
+   }
+
    trace_dump_writes("<string>");
    trace_dump_escape(str);
    trace_dump_writes("</string>");
@@ -484,6 +864,14 @@ void trace_dump_enum(const char *value)
    if (!dumping)
       return;
 
+   if (binary) {
+      unsigned id = trace_bin_string_id(value);
+
+      trace_bin_op(TRACE_BIN_ENUM);
+      trace_bin_uint(id);
+      return;
+   }
+
    trace_dump_writes("<enum>");
    trace_dump_escape(value);
    trace_dump_writes("</enum>");
@@ -494,6 +882,11 @@ void trace_dump_array_begin(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_ARRAY);
+      return;
+   }
+
    trace_dump_writes("<array>");
 }
 
@@ -502,12 +895,17 @@ void trace_dump_array_end(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_END);
+      return;
+   }
+
    trace_dump_writes("</array>");
 }
 
 void trace_dump_elem_begin(void)
 {
-   if (!dumping)
+   if (!dumping || binary)
       return;
 
    trace_dump_writes("<elem>");
@@ -515,7 +913,7 @@ void trace_dump_elem_begin(void)
 
 void trace_dump_elem_end(void)
 {
-   if (!dumping)
+   if (!dumping || binary)
       return;
 
    trace_dump_writes("</elem>");
@@ -526,6 +924,14 @@ void trace_dump_struct_begin(const char *name)
    if (!dumping)
       return;
 
+   if (binary) {
+      unsigned id = trace_bin_string_id(name);
+
+      trace_bin_op(TRACE_BIN_STRUCT);
+      trace_bin_uint(id);
+      return;
+   }
+
    trace_dump_writef("<struct name='%s'>", name);
 }
 
@@ -534,6 +940,11 @@ void trace_dump_struct_end(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_END);
+      return;
+   }
+
    trace_dump_writes("</struct>");
 }
 
@@ -542,12 +953,20 @@ void trace_dump_member_begin(const char *name)
    if (!dumping)
       return;
 
+   if (binary) {
+      unsigned id = trace_bin_string_id(name);
+
+      trace_bin_op(TRACE_BIN_MEMBER);
+      trace_bin_uint(id);
+      return;
+   }
+
    trace_dump_writef("<member name='%s'>", name);
 }
 
 void trace_dump_member_end(void)
 {
-   if (!dumping)
+   if (!dumping || binary)
       return;
 
    trace_dump_writes("</member>");
@@ -558,6 +977,11 @@ void trace_dump_null(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_op(TRACE_BIN_NULL);
+      return;
+   }
+
    trace_dump_writes("<null/>");
 }
 
@@ -566,10 +990,13 @@ void trace_dump_ptr(const void *value)
    if (!dumping)
       return;
 
-   if(value)
-      trace_dump_writef("<ptr>0x%08lx</ptr>", (unsigned long)(uintptr_t)value);
-   else
+   if (!value)
       trace_dump_null();
+   else if (binary) {
+      trace_bin_op(TRACE_BIN_PTR);
+      trace_bin_uint((uintptr_t)value);
+   } else
+      trace_dump_writef("<ptr>0x%08lx</ptr>", (unsigned long)(uintptr_t)value);
 }
 
 void trace_dump_surface_ptr(struct pipe_surface *_surface)
@@ -343,38 +343,76 @@ lp_build_gather_avx2(struct gallivm_state *gallivm,
 
       assert(src_width == 32 || src_width == 64);
       if (src_width == 32) {
-         assert(length == 4 || length == 8);
+         assert(length == 4 || length == 8 || length == 16);
       } else {
-         assert(length == 2 || length == 4);
+         assert(length == 2 || length == 4 || length == 8);
       }
 
-      static const char *intrinsics[2][2][2] = {
-
-         {{"llvm.x86.avx2.gather.d.d",
-           "llvm.x86.avx2.gather.d.d.256"},
-          {"llvm.x86.avx2.gather.d.q",
-           "llvm.x86.avx2.gather.d.q.256"}},
+      if (src_width * length == 512) {
+         /*
+          * The avx512 gathers take a scalar or i1 vector mask instead of
+          * a sign-bit vector, and the older names went away with llvm 7.
+          */
+         static const char *intrinsics512[2][2] = {
+#if LLVM_VERSION_MAJOR >= 7
+            {"llvm.x86.avx512.mask.gather.dpi.512",
+             "llvm.x86.avx512.mask.gather.dpq.512"},
+            {"llvm.x86.avx512.mask.gather.dps.512",
+             "llvm.x86.avx512.mask.gather.dpd.512"},
+#else
+            {"llvm.x86.avx512.gather.dpi.512",
+             "llvm.x86.avx512.gather.dpq.512"},
+            {"llvm.x86.avx512.gather.dps.512",
+             "llvm.x86.avx512.gather.dpd.512"},
+#endif
+         };
+         LLVMTypeRef i32_type = LLVMIntTypeInContext(gallivm->context, 32);
+         LLVMValueRef passthru = LLVMGetUndef(src_vec_type);
+         LLVMValueRef scale = LLVMConstInt(i32_type, 1, 0);
+         LLVMValueRef mask;
+
+#if LLVM_VERSION_MAJOR >= 7
+         mask = LLVMConstAllOnes(LLVMVectorType(
+                   LLVMIntTypeInContext(gallivm->context, 1), length));
+#else
+         mask = LLVMConstAllOnes(LLVMIntTypeInContext(gallivm->context,
+                                                      MAX2(length, 8)));
+#endif
+         intrinsic = intrinsics512[dst_type.floating][src_width == 64];
 
-         {{"llvm.x86.avx2.gather.d.ps",
-           "llvm.x86.avx2.gather.d.ps.256"},
-          {"llvm.x86.avx2.gather.d.pd",
-           "llvm.x86.avx2.gather.d.pd.256"}},
-      };
+         LLVMValueRef args[] = { passthru, base_ptr, offsets, mask, scale };
 
-      if ((src_width == 32 && length == 8) ||
-          (src_width == 64 && length == 4)) {
-         l_idx = 1;
+         res = lp_build_intrinsic(builder, intrinsic, src_vec_type, args, 5, 0);
       }
-      intrinsic = intrinsics[dst_type.floating][src_width == 64][l_idx];
+      else {
+         static const char *intrinsics[2][2][2] = {
+
+            {{"llvm.x86.avx2.gather.d.d",
+              "llvm.x86.avx2.gather.d.d.256"},
+             {"llvm.x86.avx2.gather.d.q",
+              "llvm.x86.avx2.gather.d.q.256"}},
+
+            {{"llvm.x86.avx2.gather.d.ps",
+              "llvm.x86.avx2.gather.d.ps.256"},
+             {"llvm.x86.avx2.gather.d.pd",
+              "llvm.x86.avx2.gather.d.pd.256"}},
+         };
+
+         if ((src_width == 32 && length == 8) ||
+             (src_width == 64 && length == 4)) {
+            l_idx = 1;
+         }
+         intrinsic = intrinsics[dst_type.floating][src_width == 64][l_idx];
 
-      LLVMValueRef passthru = LLVMGetUndef(src_vec_type);
-      LLVMValueRef mask = LLVMConstAllOnes(src_vec_type);
-      mask = LLVMConstBitCast(mask, src_vec_type);
-      LLVMValueRef scale = LLVMConstInt(i8_type, 1, 0);
+         LLVMValueRef passthru = LLVMGetUndef(src_vec_type);
+         LLVMValueRef mask = LLVMConstAllOnes(src_vec_type);
+         mask = LLVMConstBitCast(mask, src_vec_type);
+         LLVMValueRef scale = LLVMConstInt(i8_type, 1, 0);
 
-      LLVMValueRef args[] = { passthru, base_ptr, offsets, mask, scale };
+         LLVMValueRef args[] = { passthru, base_ptr, offsets, mask, scale };
 
-      res = lp_build_intrinsic(builder, intrinsic, src_vec_type, args, 5, 0);
+         res = lp_build_intrinsic(builder, intrinsic, src_vec_type, args, 5, 0);
+      }
    }
    res = LLVMBuildBitCast(builder, res, lp_build_vec_type(gallivm, res_type), "");
 
@@ -489,19 +527,23 @@ lp_build_gather(struct gallivm_state *gallivm,
        * conversion) and it would be awkward for floats.
        */
    } else if (util_cpu_caps.has_avx2 && !need_expansion &&
-              src_width == 32 && (length == 4 || length == 8)) {
+              src_width == 32 && (length == 4 || length == 8 ||
+                                  (length == 16 && util_cpu_caps.has_avx512f))) {
       return lp_build_gather_avx2(gallivm, length, src_width, dst_type,
                                   base_ptr, offsets);
    /*
     * This looks bad on paper wrt throughtput/latency on Haswell.
     * Even on Broadwell it doesn't look stellar.
     * Albeit no measurements were done (but tested to work).
-    * Should definitely enable on Skylake.
+    * Skylake and later do much better, and we have no cpu model to go by,
+    * so use avx512 as the indicator (this is what makes 2x32 and 4x16
+    * formats like rgba16f fetch with one gather instead of per-texel loads).
     * (In general, should be more of a win if the fetch is 256bit wide -
     * this is true for the 32bit case above too.)
     */
-   } else if (0 && util_cpu_caps.has_avx2 && !need_expansion &&
-              src_width == 64 && (length == 2 || length == 4)) {
+   } else if (util_cpu_caps.has_avx2 && util_cpu_caps.has_avx512f &&
+              !need_expansion &&
+              src_width == 64 && (length == 2 || length == 4 || length == 8)) {
       return lp_build_gather_avx2(gallivm, length, src_width, dst_type,
                                   base_ptr, offsets);
    } else {
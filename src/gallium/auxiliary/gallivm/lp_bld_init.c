@@ -31,6 +31,7 @@
 #include "util/u_cpu_detect.h"
 #include "util/u_debug.h"
 #include "util/u_memory.h"
+#include "util/u_atomic.h"
 #include "util/simple_list.h"
 #include "util/os_time.h"
 #include "lp_bld.h"
@@ -62,6 +63,8 @@ static const struct debug_named_value lp_bld_perf_flags[] = {
    DEBUG_NAMED_VALUE_END
 };
 
+unsigned gallivm_tier_up_uses = 0;
+
 #ifdef DEBUG
 unsigned gallivm_debug = 0;
 
@@ -81,6 +84,10 @@ DEBUG_GET_ONCE_FLAGS_OPTION(gallivm_debug, "GALLIVM_DEBUG", lp_bld_debug_flags,
 
 static boolean gallivm_initialized = FALSE;
 
+/* Running totals of all compiles, see gallivm_get_compile_stats() */
+static uint64_t gallivm_num_compiled_modules = 0;
+static uint64_t gallivm_compile_time = 0;
+
 unsigned lp_native_vector_width;
 
 
@@ -102,8 +109,7 @@ enum LLVM_CodeGenOpt_Level {
 
 
 /**
- * Create the LLVM (optimization) pass manager and install
- * relevant optimization passes.
+ * Create the LLVM (optimization) pass manager.
  * \return  TRUE for success, FALSE for failure
  */
 static boolean
@@ -133,13 +139,24 @@ create_pass_manager(struct gallivm_state *gallivm)
       free(td_str);
    }
 
+   return TRUE;
+}
+
+
+/**
+ * Install the optimization passes.  This is deferred to compilation time
+ * so that gallivm_state::no_opt can be set after creation.
+ */
+static void
+add_optimization_passes(struct gallivm_state *gallivm)
+{
 #if GALLIVM_HAVE_CORO
    LLVMAddCoroEarlyPass(gallivm->cgpassmgr);
    LLVMAddCoroSplitPass(gallivm->cgpassmgr);
    LLVMAddCoroElidePass(gallivm->cgpassmgr);
 #endif
 
-   if ((gallivm_perf & GALLIVM_PERF_NO_OPT) == 0) {
+   if ((gallivm_perf & GALLIVM_PERF_NO_OPT) == 0 && !gallivm->no_opt) {
       /*
        * TODO: Evaluate passes some more - keeping in mind
        * both quality of generated code and compile times.
@@ -175,8 +192,6 @@ create_pass_manager(struct gallivm_state *gallivm)
        */
       LLVMAddPromoteMemoryToRegisterPass(gallivm->passmgr);
    }
-
-   return TRUE;
 }
 
 
@@ -215,6 +230,11 @@ gallivm_free_ir(struct gallivm_state *gallivm)
 
    /* The LLVMContext should be owned by the parent of gallivm. */
 
+   if (gallivm->cache && gallivm->cache->jit_obj_cache) {
+      lp_free_objcache(gallivm->cache->jit_obj_cache);
+      gallivm->cache->jit_obj_cache = NULL;
+   }
+
    gallivm->engine = NULL;
    gallivm->target = NULL;
    gallivm->module = NULL;
@@ -223,6 +243,7 @@ gallivm_free_ir(struct gallivm_state *gallivm)
    gallivm->passmgr = NULL;
    gallivm->context = NULL;
    gallivm->builder = NULL;
+   gallivm->cache = NULL;
 }
 
 
@@ -249,7 +270,7 @@ init_gallivm_engine(struct gallivm_state *gallivm)
       char *error = NULL;
       int ret;
 
-      if (gallivm_perf & GALLIVM_PERF_NO_OPT) {
+      if ((gallivm_perf & GALLIVM_PERF_NO_OPT) || gallivm->no_opt) {
          optlevel = None;
       }
       else {
@@ -258,6 +279,7 @@ init_gallivm_engine(struct gallivm_state *gallivm)
 
       ret = lp_build_create_jit_compiler_for_module(&gallivm->engine,
                                                     &gallivm->code,
+                                                    gallivm->cache,
                                                     gallivm->module,
                                                     gallivm->memorymgr,
                                                     (unsigned) optlevel,
@@ -303,7 +325,7 @@ fail:
  */
 static boolean
 init_gallivm_state(struct gallivm_state *gallivm, const char *name,
-                   LLVMContextRef context)
+                   LLVMContextRef context, struct lp_cached_code *cache)
 {
    assert(!gallivm->context);
    assert(!gallivm->module);
@@ -312,6 +334,7 @@ init_gallivm_state(struct gallivm_state *gallivm, const char *name,
       return FALSE;
 
    gallivm->context = context;
+   gallivm->cache = cache;
 
    if (!gallivm->context)
       goto fail;
@@ -409,6 +432,8 @@ lp_build_init(void)
 
    gallivm_perf = debug_get_flags_option("GALLIVM_PERF", lp_bld_perf_flags, 0 );
 
+   gallivm_tier_up_uses = debug_get_num_option("GALLIVM_TIER_UP", 16);
+
    lp_set_target_options();
 
    util_cpu_detect();
@@ -462,6 +487,24 @@ lp_build_init(void)
       util_cpu_caps.has_fma = 0;
    }
 
+   /*
+    * 16-wide fragment shading with AVX-512 is still experimental, so
+    * only expose it on request, and never without 256-bit vectors since
+    * the rest of the code is built around those.
+    */
+   if (!debug_get_bool_option("LP_AVX512", FALSE) ||
+       lp_native_vector_width < 256) {
+      util_cpu_caps.has_avx512f = 0;
+      util_cpu_caps.has_avx512dq = 0;
+      util_cpu_caps.has_avx512ifma = 0;
+      util_cpu_caps.has_avx512pf = 0;
+      util_cpu_caps.has_avx512er = 0;
+      util_cpu_caps.has_avx512cd = 0;
+      util_cpu_caps.has_avx512bw = 0;
+      util_cpu_caps.has_avx512vl = 0;
+      util_cpu_caps.has_avx512vbmi = 0;
+   }
+
 #ifdef PIPE_ARCH_PPC_64
    /* Set the NJ bit in VSCR to 0 so denormalized values are handled as
     * specified by IEEE standard (PowerISA 2.06 - Section 6.3). This guarantees
@@ -493,15 +536,18 @@ lp_build_init(void)
 
 /**
  * Create a new gallivm_state object.
+ *
+ * \param cache  optional machine code cache entry; see lp_cached_code.
  */
 struct gallivm_state *
-gallivm_create(const char *name, LLVMContextRef context)
+gallivm_create(const char *name, LLVMContextRef context,
+               struct lp_cached_code *cache)
 {
    struct gallivm_state *gallivm;
 
    gallivm = CALLOC_STRUCT(gallivm_state);
    if (gallivm) {
-      if (!init_gallivm_state(gallivm, name, context)) {
+      if (!init_gallivm_state(gallivm, name, context, cache)) {
          FREE(gallivm);
          gallivm = NULL;
       }
@@ -556,6 +602,7 @@ void
 gallivm_compile_module(struct gallivm_state *gallivm)
 {
    LLVMValueRef func;
+   int64_t compile_begin = os_time_get();
    int64_t time_begin = 0;
 
    assert(!gallivm->compiled);
@@ -581,9 +628,16 @@ gallivm_compile_module(struct gallivm_state *gallivm)
                    "[-mattr=<-mattr option(s)>]");
    }
 
+   if (gallivm->cache && gallivm->cache->data_size) {
+      /* The machine code comes from the cache, skip the IR passes. */
+      goto skip_cached;
+   }
+
    if (gallivm_debug & GALLIVM_DEBUG_PERF)
       time_begin = os_time_get();
 
+   add_optimization_passes(gallivm);
+
 #if GALLIVM_HAVE_CORO
    LLVMRunPassManager(gallivm->cgpassmgr, gallivm->module);
 #endif
@@ -615,6 +669,8 @@ gallivm_compile_module(struct gallivm_state *gallivm)
                    gallivm->module_name, time_msec);
    }
 
+skip_cached:
+
    /* Setting the module's DataLayout to an empty string will cause the
     * ExecutionEngine to copy to the DataLayout string from its target machine
     * to the module.  As of LLVM 3.8 the module and the execution engine are
@@ -641,6 +697,9 @@ gallivm_compile_module(struct gallivm_state *gallivm)
 
    ++gallivm->compiled;
 
+   p_atomic_inc(&gallivm_num_compiled_modules);
+   p_atomic_add(&gallivm_compile_time, os_time_get() - compile_begin);
+
    if (gallivm_debug & GALLIVM_DEBUG_ASM) {
       LLVMValueRef llvm_func = LLVMGetFirstFunction(gallivm->module);
 
@@ -681,20 +740,22 @@ gallivm_jit_function(struct gallivm_state *gallivm,
 {
    void *code;
    func_pointer jit_func;
-   int64_t time_begin = 0;
+   int64_t time_begin, time_end;
 
    assert(gallivm->compiled);
    assert(gallivm->engine);
 
-   if (gallivm_debug & GALLIVM_DEBUG_PERF)
-      time_begin = os_time_get();
+   time_begin = os_time_get();
 
    code = LLVMGetPointerToGlobal(gallivm->engine, func);
    assert(code);
    jit_func = pointer_to_func(code);
 
+   /* MCJIT emits the machine code of the module on the first lookup */
+   time_end = os_time_get();
+   p_atomic_add(&gallivm_compile_time, time_end - time_begin);
+
    if (gallivm_debug & GALLIVM_DEBUG_PERF) {
-      int64_t time_end = os_time_get();
       int time_msec = (int)(time_end - time_begin) / 1000;
       debug_printf("   jitting func %s took %d msec\n",
                    LLVMGetValueName(func), time_msec);
@@ -702,3 +763,15 @@ gallivm_jit_function(struct gallivm_state *gallivm,
 
    return jit_func;
 }
+
+
+/**
+ * Return the number of modules compiled so far, by all users of gallivm,
+ * and the total time spent in compiling them, in microseconds.
+ */
+void
+gallivm_get_compile_stats(uint64_t *num_modules, uint64_t *compile_time)
+{
+   *num_modules = p_atomic_read(&gallivm_num_compiled_modules);
+   *compile_time = p_atomic_read(&gallivm_compile_time);
+}
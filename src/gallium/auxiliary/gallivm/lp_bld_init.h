@@ -39,6 +39,22 @@
 extern "C" {
 #endif
 
+/**
+ * Machine code of a previously compiled module, as stored in or retrieved
+ * from a shader cache.
+ *
+ * When data_size is non-zero the object code in data is handed to the JIT
+ * instead of compiling the module.  After a compilation, data holds the
+ * freshly generated object code (allocated with malloc) unless dont_cache
+ * was set because the module references process-specific addresses.
+ */
+struct lp_cached_code {
+   void *data;
+   size_t data_size;
+   boolean dont_cache;
+   void *jit_obj_cache;
+};
+
 struct gallivm_state
 {
    char *module_name;
@@ -51,16 +67,40 @@ struct gallivm_state
    LLVMBuilderRef builder;
    LLVMMCJITMemoryManagerRef memorymgr;
    struct lp_generated_code *code;
+   struct lp_cached_code *cache;
    unsigned compiled;
+   /** Compile quickly at the expense of code quality (set before compile) */
+   boolean no_opt;
 };
 
 
+/**
+ * Number of uses after which a variant compiled with no_opt is worth
+ * recompiling with optimizations; zero means right away.
+ */
+extern unsigned gallivm_tier_up_uses;
+
+
+/**
+ * Count a use of a variant running no_opt code.
+ * \return TRUE the one time it becomes hot enough to be optimized
+ */
+static inline boolean
+gallivm_tier_up(unsigned *uses)
+{
+   if (*uses >= gallivm_tier_up_uses)
+      return FALSE;
+   return ++*uses == gallivm_tier_up_uses;
+}
+
+
 boolean
 lp_build_init(void);
 
 
 struct gallivm_state *
-gallivm_create(const char *name, LLVMContextRef context);
+gallivm_create(const char *name, LLVMContextRef context,
+               struct lp_cached_code *cache);
 
 void
 gallivm_destroy(struct gallivm_state *gallivm);
@@ -79,6 +119,9 @@ func_pointer
 gallivm_jit_function(struct gallivm_state *gallivm,
                      LLVMValueRef func);
 
+void
+gallivm_get_compile_stats(uint64_t *num_modules, uint64_t *compile_time);
+
 #ifdef __cplusplus
 }
 #endif
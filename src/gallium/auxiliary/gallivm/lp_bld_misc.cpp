@@ -57,8 +57,10 @@
 #include <llvm/ADT/Triple.h>
 #include <llvm/Analysis/TargetLibraryInfo.h>
 #include <llvm/ExecutionEngine/SectionMemoryManager.h>
+#include <llvm/ExecutionEngine/ObjectCache.h>
 #include <llvm/Support/CommandLine.h>
 #include <llvm/Support/Host.h>
+#include <llvm/Support/Memory.h>
 #include <llvm/Support/PrettyStackTrace.h>
 
 #include <llvm/Support/TargetSelect.h>
@@ -84,6 +86,7 @@
 
 #include "lp_bld_misc.h"
 #include "lp_bld_debug.h"
+#include "lp_bld_init.h"
 
 namespace {
 
@@ -221,6 +224,131 @@ class DelegatingJITMemoryManager : public BaseMemoryManager {
 };
 
 
+/*
+ * Executable memory shared by the code of all modules.
+ *
+ * Every engine otherwise gets its own SectionMemoryManager, which rounds
+ * the code and data of each module up to whole pages; with thousands of
+ * small shader variants most of that memory is padding.  Here sections are
+ * instead packed into large slabs which are mapped read/write/execute, so
+ * that new code can be appended next to code which is running on other
+ * threads.  A slab is unmapped once all the modules using it are freed.
+ * Systems refusing such mappings get the per-engine managers as before.
+ */
+class CodeArena {
+
+   public:
+      struct Slab {
+         llvm::sys::MemoryBlock block;
+         size_t size, used;
+         unsigned live;   /* allocations which have not been released */
+      };
+
+   private:
+      static const size_t SlabSize = 1024 * 1024;
+
+      mtx_t mutex;
+      Slab *current[2];   /* data and code slabs being filled */
+      bool disabled;
+
+      Slab *createSlab(size_t size, bool code) {
+         std::error_code ec;
+         unsigned flags = llvm::sys::Memory::MF_READ |
+                          llvm::sys::Memory::MF_WRITE;
+         Slab *slab;
+
+         if (code)
+            flags |= llvm::sys::Memory::MF_EXEC;
+
+         slab = new Slab;
+         slab->block = llvm::sys::Memory::allocateMappedMemory(size, NULL,
+                                                               flags, ec);
+         if (ec) {
+            delete slab;
+            return NULL;
+         }
+         slab->size = size;
+         slab->used = 0;
+         slab->live = 0;
+         return slab;
+      }
+
+      void destroySlab(Slab *slab) {
+         llvm::sys::Memory::releaseMappedMemory(slab->block);
+         delete slab;
+      }
+
+   public:
+      CodeArena() {
+         (void) mtx_init(&mutex, mtx_plain);
+         current[0] = current[1] = NULL;
+         disabled = false;
+      }
+
+      /*
+       * Returns NULL when the allocation has to be done elsewhere.
+       */
+      uint8_t *allocate(uintptr_t size, unsigned alignment, bool code,
+                        Slab **out) {
+         Slab *slab;
+         uintptr_t offset = 0;
+
+         if (!alignment)
+            alignment = 16;
+
+         mtx_lock(&mutex);
+
+         if (disabled) {
+            mtx_unlock(&mutex);
+            return NULL;
+         }
+
+         slab = current[code];
+         if (slab)
+            offset = (slab->used + alignment - 1) & ~(uintptr_t)(alignment - 1);
+
+         if (!slab || offset + size > slab->size) {
+            if (size + alignment > SlabSize / 4) {
+               /* Big sections get a slab of their own. */
+               slab = createSlab(size + alignment, code);
+            }
+            else {
+               if (slab && !slab->live)
+                  destroySlab(slab);
+               slab = current[code] = createSlab(SlabSize, code);
+            }
+            if (!slab) {
+               disabled = true;
+               mtx_unlock(&mutex);
+               return NULL;
+            }
+            /* Mappings are page aligned. */
+            offset = 0;
+         }
+
+         slab->used = offset + size;
+         slab->live++;
+         *out = slab;
+
+         mtx_unlock(&mutex);
+
+         return (uint8_t *)slab->block.base() + offset;
+      }
+
+      void release(Slab *slab) {
+         mtx_lock(&mutex);
+         assert(slab->live);
+         if (!--slab->live &&
+             slab != current[0] && slab != current[1]) {
+            destroySlab(slab);
+         }
+         mtx_unlock(&mutex);
+      }
+};
+
+static CodeArena TheArena;
+
+
 /*
  * Delegate memory management to one shared manager for more efficient use
  * of memory than creating a separate pool for each LLVM engine.
@@ -231,6 +359,8 @@ class DelegatingJITMemoryManager : public BaseMemoryManager {
  * All methods are delegated to the shared manager except destruction and
  * deallocating code.  For the latter we just remember what needs to be
  * deallocated later.  The shared manager is deleted once it is empty.
+ * Sections go to the CodeArena when it is usable, and are released
+ * together with the generated code.
  */
 class ShaderMemoryManager : public DelegatingJITMemoryManager {
 
@@ -239,6 +369,7 @@ class ShaderMemoryManager : public DelegatingJITMemoryManager {
    struct GeneratedCode {
       typedef std::vector<void *> Vec;
       Vec FunctionBody, ExceptionTable;
+      std::vector<CodeArena::Slab *> Slabs;
       BaseMemoryManager *TheMM;
 
       GeneratedCode(BaseMemoryManager *MM) {
@@ -246,11 +377,16 @@ class ShaderMemoryManager : public DelegatingJITMemoryManager {
       }
 
       ~GeneratedCode() {
+         for (unsigned i = 0; i < Slabs.size(); i++)
+            TheArena.release(Slabs[i]);
       }
    };
 
    GeneratedCode *code;
 
+   /* Code placed in the arena since the last finalizeMemory() */
+   std::vector<std::pair<uint8_t *, uintptr_t> > PendingCode;
+
    BaseMemoryManager *mgr() const {
       return TheMM;
    }
@@ -281,6 +417,88 @@ class ShaderMemoryManager : public DelegatingJITMemoryManager {
          // remember for later deallocation
          code->FunctionBody.push_back(Body);
       }
+
+      virtual uint8_t *allocateCodeSection(uintptr_t Size,
+                                           unsigned Alignment,
+                                           unsigned SectionID,
+                                           llvm::StringRef SectionName) {
+         CodeArena::Slab *slab;
+         uint8_t *ptr = TheArena.allocate(Size, Alignment, true, &slab);
+         if (!ptr) {
+            return DelegatingJITMemoryManager::allocateCodeSection(
+               Size, Alignment, SectionID, SectionName);
+         }
+         code->Slabs.push_back(slab);
+         PendingCode.push_back(std::make_pair(ptr, Size));
+         return ptr;
+      }
+
+      virtual uint8_t *allocateDataSection(uintptr_t Size,
+                                           unsigned Alignment,
+                                           unsigned SectionID,
+                                           llvm::StringRef SectionName,
+                                           bool IsReadOnly) {
+         CodeArena::Slab *slab;
+         uint8_t *ptr = TheArena.allocate(Size, Alignment, false, &slab);
+         if (!ptr) {
+            return DelegatingJITMemoryManager::allocateDataSection(
+               Size, Alignment, SectionID, SectionName, IsReadOnly);
+         }
+         code->Slabs.push_back(slab);
+         return ptr;
+      }
+
+      virtual bool finalizeMemory(std::string *ErrMsg = 0) {
+         /*
+          * Arena memory is never remapped, so the only thing left to do is
+          * to make sure the new code is visible to instruction fetch.
+          */
+         for (unsigned i = 0; i < PendingCode.size(); i++) {
+            llvm::sys::Memory::InvalidateInstructionCache(
+               PendingCode[i].first, PendingCode[i].second);
+         }
+         PendingCode.clear();
+         return DelegatingJITMemoryManager::finalizeMemory(ErrMsg);
+      }
+};
+
+
+/**
+ * Object cache handing MCJIT the machine code stored in a lp_cached_code,
+ * and recording newly generated code into it.
+ */
+class LPObjectCache : public llvm::ObjectCache {
+private:
+   struct lp_cached_code *cache_out;
+
+public:
+   LPObjectCache(struct lp_cached_code *cache) {
+      cache_out = cache;
+   }
+
+   ~LPObjectCache() {
+   }
+
+   void notifyObjectCompiled(const llvm::Module *M,
+                             llvm::MemoryBufferRef Obj) {
+      /* MCJIT only compiles modules getObject() returned nothing for. */
+      assert(!cache_out->data);
+      cache_out->data_size = Obj.getBufferSize();
+      cache_out->data = malloc(cache_out->data_size);
+      if (cache_out->data)
+         memcpy(cache_out->data, Obj.getBufferStart(), cache_out->data_size);
+      else
+         cache_out->data_size = 0;
+   }
+
+   virtual std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *M) {
+      if (cache_out->data_size) {
+         return llvm::MemoryBuffer::getMemBuffer(
+            llvm::StringRef((const char *)cache_out->data,
+                            cache_out->data_size), "", false);
+      }
+      return NULL;
+   }
 };
 
 
@@ -298,6 +516,7 @@ extern "C"
 LLVMBool
 lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
                                         lp_generated_code **OutCode,
+                                        struct lp_cached_code *cache_out,
                                         LLVMModuleRef M,
                                         LLVMMCJITMemoryManagerRef CMM,
                                         unsigned OptLevel,
@@ -379,14 +598,14 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
    MAttrs.push_back(util_cpu_caps.has_f16c ? "+f16c" : "-f16c");
    MAttrs.push_back(util_cpu_caps.has_fma  ? "+fma"  : "-fma");
    MAttrs.push_back(util_cpu_caps.has_avx2 ? "+avx2" : "-avx2");
-   /* disable avx512 and all subvariants */
-   MAttrs.push_back("-avx512cd");
-   MAttrs.push_back("-avx512er");
-   MAttrs.push_back("-avx512f");
-   MAttrs.push_back("-avx512pf");
-   MAttrs.push_back("-avx512bw");
-   MAttrs.push_back("-avx512dq");
-   MAttrs.push_back("-avx512vl");
+   /* avx512 stays disabled unless lp_build_init() left it enabled */
+   MAttrs.push_back(util_cpu_caps.has_avx512cd ? "+avx512cd" : "-avx512cd");
+   MAttrs.push_back(util_cpu_caps.has_avx512er ? "+avx512er" : "-avx512er");
+   MAttrs.push_back(util_cpu_caps.has_avx512f  ? "+avx512f"  : "-avx512f");
+   MAttrs.push_back(util_cpu_caps.has_avx512pf ? "+avx512pf" : "-avx512pf");
+   MAttrs.push_back(util_cpu_caps.has_avx512bw ? "+avx512bw" : "-avx512bw");
+   MAttrs.push_back(util_cpu_caps.has_avx512dq ? "+avx512dq" : "-avx512dq");
+   MAttrs.push_back(util_cpu_caps.has_avx512vl ? "+avx512vl" : "-avx512vl");
 #endif
 #if defined(PIPE_ARCH_ARM)
    if (!util_cpu_caps.has_neon) {
@@ -472,6 +691,11 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
    JIT->RegisterJITEventListener(JEL);
 #endif
    if (JIT) {
+      if (cache_out) {
+         LPObjectCache *objcache = new LPObjectCache(cache_out);
+         JIT->setObjectCache(objcache);
+         cache_out->jit_obj_cache = (void *)objcache;
+      }
       *OutJIT = wrap(JIT);
       return 0;
    }
@@ -506,6 +730,14 @@ lp_free_memory_manager(LLVMMCJITMemoryManagerRef memorymgr)
    delete reinterpret_cast<BaseMemoryManager*>(memorymgr);
 }
 
+extern "C"
+void
+lp_free_objcache(void *objcache_ptr)
+{
+   LPObjectCache *objcache = (LPObjectCache *)objcache_ptr;
+   delete objcache;
+}
+
 extern "C" LLVMValueRef
 lp_get_called_value(LLVMValueRef call)
 {
@@ -2058,16 +2058,60 @@ lp_build_sample_partial_offset(struct lp_build_context *bld,
 }
 
 
+/**
+ * Compute the partial offset of a texel along x (axis 0) or y (axis 1)
+ * of a texture stored in micro-tiles, see LP_SAMPLE_TILE_SIZE.
+ *
+ * @param texel_size  texel size in bytes
+ * @param stride  texel size (x) or row stride (y) vector, in bytes
+ */
+LLVMValueRef
+lp_build_sample_tiled_partial_offset(struct lp_build_context *bld,
+                                     unsigned axis,
+                                     unsigned texel_size,
+                                     LLVMValueRef coord,
+                                     LLVMValueRef stride)
+{
+   LLVMBuilderRef builder = bld->gallivm->builder;
+   const unsigned tile = LP_SAMPLE_TILE_SIZE;
+   LLVMValueRef tile_mask = lp_build_const_int_vec(bld->gallivm, bld->type,
+                                                   tile - 1);
+   LLVMValueRef inner, outer;
+
+   inner = LLVMBuildAnd(builder, coord, tile_mask, "");
+   outer = LLVMBuildAnd(builder, coord, LLVMBuildNot(builder, tile_mask, ""), "");
+
+   if (axis == 0) {
+      /* (x & ~3) * 4 + (x & 3) texels */
+      outer = LLVMBuildShl(builder, outer,
+                           lp_build_const_int_vec(bld->gallivm, bld->type,
+                                                  util_logbase2(tile)), "");
+      return lp_build_mul(bld, LLVMBuildOr(builder, outer, inner, ""), stride);
+   }
+   else {
+      /* (y & ~3) rows plus (y & 3) rows of a tile */
+      assert(axis == 1);
+      inner = lp_build_mul(bld, inner,
+                           lp_build_const_int_vec(bld->gallivm, bld->type,
+                                                  tile * texel_size));
+      return lp_build_add(bld, lp_build_mul(bld, outer, stride), inner);
+   }
+}
+
+
 /**
  * Compute the offset of a pixel block.
  *
  * x, y, z, y_stride, z_stride are vectors, and they refer to pixels.
+ * If tiled is set the texture uses the micro-tiled layout (which is only
+ * used for formats with 1x1 blocks).
  *
  * Returns the relative offset and i,j sub-block coordinates
  */
 void
 lp_build_sample_offset(struct lp_build_context *bld,
                        const struct util_format_description *format_desc,
+                       boolean tiled,
                        LLVMValueRef x,
                        LLVMValueRef y,
                        LLVMValueRef z,
@@ -2083,21 +2127,35 @@ lp_build_sample_offset(struct lp_build_context *bld,
    x_stride = lp_build_const_vec(bld->gallivm, bld->type,
                                  format_desc->block.bits/8);
 
-   lp_build_sample_partial_offset(bld,
-                                  format_desc->block.width,
-                                  x, x_stride,
-                                  &offset, out_i);
+   if (tiled && y && y_stride) {
+      unsigned texel_size = format_desc->block.bits/8;
 
-   if (y && y_stride) {
-      LLVMValueRef y_offset;
-      lp_build_sample_partial_offset(bld,
-                                     format_desc->block.height,
-                                     y, y_stride,
-                                     &y_offset, out_j);
-      offset = lp_build_add(bld, offset, y_offset);
+      assert(format_desc->block.width == 1 && format_desc->block.height == 1);
+      offset = lp_build_add(bld,
+                            lp_build_sample_tiled_partial_offset(bld, 0, texel_size,
+                                                                 x, x_stride),
+                            lp_build_sample_tiled_partial_offset(bld, 1, texel_size,
+                                                                 y, y_stride));
+      *out_i = bld->zero;
+      *out_j = bld->zero;
    }
    else {
-      *out_j = bld->zero;
+      lp_build_sample_partial_offset(bld,
+                                     format_desc->block.width,
+                                     x, x_stride,
+                                     &offset, out_i);
+
+      if (y && y_stride) {
+         LLVMValueRef y_offset;
+         lp_build_sample_partial_offset(bld,
+                                        format_desc->block.height,
+                                        y, y_stride,
+                                        &y_offset, out_j);
+         offset = lp_build_add(bld, offset, y_offset);
+      }
+      else {
+         *out_j = bld->zero;
+      }
    }
 
    if (z && z_stride) {
@@ -165,9 +165,23 @@ struct lp_static_texture_state
    unsigned pot_height:1;
    unsigned pot_depth:1;
    unsigned level_zero_only:1;
+   unsigned tiled:1;         /**< stored in LP_SAMPLE_TILE_SIZE micro-tiles */
 };
 
 
+/**
+ * Square micro-tile size (in texels) for textures with the tiled
+ * static state bit.  Within a level texel (x, y) is stored at
+ *
+ *    (y & ~3) * row_stride + ((y & 3) * 4 + (x & 3)) * texel_size +
+ *    (x & ~3) * 4 * texel_size
+ *
+ * i.e. each 4x4 block is contiguous, and a row of blocks takes up as
+ * much memory as 4 rows of the linear layout.
+ */
+#define LP_SAMPLE_TILE_SIZE 4
+
+
 /**
  * Sampler static state.
  *
@@ -615,9 +629,18 @@ lp_build_sample_partial_offset(struct lp_build_context *bld,
                                LLVMValueRef *out_i);
 
 
+LLVMValueRef
+lp_build_sample_tiled_partial_offset(struct lp_build_context *bld,
+                                     unsigned axis,
+                                     unsigned texel_size,
+                                     LLVMValueRef coord,
+                                     LLVMValueRef stride);
+
+
 void
 lp_build_sample_offset(struct lp_build_context *bld,
                        const struct util_format_description *format_desc,
+                       boolean tiled,
                        LLVMValueRef x,
                        LLVMValueRef y,
                        LLVMValueRef z,
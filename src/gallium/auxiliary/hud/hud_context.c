@@ -951,20 +951,66 @@ hud_pane_add_graph(struct hud_pane *pane, struct hud_graph *gr)
    pane->next_color++;
 }
 
+struct hud_dump_job {
+   struct util_queue_fence fence;
+   FILE *fd;
+   char line[64];
+};
+
+static void
+hud_dump_job_execute(void *data, int thread_index)
+{
+   struct hud_dump_job *job = data;
+
+   fputs(job->line, job->fd);
+}
+
+static void
+hud_dump_job_cleanup(void *data, int thread_index)
+{
+   struct hud_dump_job *job = data;
+
+   util_queue_fence_destroy(&job->fence);
+   FREE(job);
+}
+
+static void
+hud_graph_dump_value(struct hud_graph *gr, double value)
+{
+   struct util_queue *queue = &gr->pane->hud->dump_queue;
+   struct hud_dump_job *job = NULL;
+   char line[64];
+
+   if (fabs(value - lround(value)) > FLT_EPSILON) {
+      snprintf(line, sizeof(line), "%f\n", value);
+   }
+   else {
+      snprintf(line, sizeof(line), "%" PRIu64 "\n", (uint64_t) lround(value));
+   }
+
+   /* Keep file I/O off the thread that is being measured. */
+   if (util_queue_is_initialized(queue))
+      job = CALLOC_STRUCT(hud_dump_job);
+
+   if (job) {
+      job->fd = gr->fd;
+      strcpy(job->line, line);
+      util_queue_fence_init(&job->fence);
+      util_queue_add_job(queue, job, &job->fence, hud_dump_job_execute,
+                         hud_dump_job_cleanup);
+   } else {
+      fputs(line, gr->fd);
+   }
+}
+
 void
 hud_graph_add_value(struct hud_graph *gr, double value)
 {
    gr->current_value = value;
    value = value > gr->pane->ceiling ? gr->pane->ceiling : value;
 
-   if (gr->fd) {
-      if (fabs(value - lround(value)) > FLT_EPSILON) {
-         fprintf(gr->fd, "%f\n", value);
-      }
-      else {
-         fprintf(gr->fd, "%" PRIu64 "\n", (uint64_t) lround(value));
-      }
-   }
+   if (gr->fd)
+      hud_graph_dump_value(gr, value);
 
    if (gr->index == gr->pane->max_num_vertices) {
       gr->vertices[0] = 0;
@@ -993,8 +1039,13 @@ hud_graph_destroy(struct hud_graph *graph, struct pipe_context *pipe)
    FREE(graph->vertices);
    if (graph->free_query_data)
       graph->free_query_data(graph->query_data, pipe);
-   if (graph->fd)
+   if (graph->fd) {
+      struct util_queue *queue = &graph->pane->hud->dump_queue;
+
+      if (util_queue_is_initialized(queue))
+         util_queue_finish(queue);
       fclose(graph->fd);
+   }
    FREE(graph);
 }
 
@@ -1039,6 +1090,7 @@ static void
 hud_graph_set_dump_file(struct hud_graph *gr)
 {
    const char *hud_dump_dir = getenv("GALLIUM_HUD_DUMP_DIR");
+   struct hud_context *hud = gr->pane->hud;
 
    if (hud_dump_dir && access(hud_dump_dir, W_OK) == 0) {
       char *dump_file = malloc(strlen(hud_dump_dir) + sizeof(PATH_SEP)
@@ -1051,6 +1103,13 @@ hud_graph_set_dump_file(struct hud_graph *gr)
          if (gr->fd) {
             /* flush output after each line is written */
             setvbuf(gr->fd, NULL, _IOLBF, 0);
+
+            /* One thread, so the lines of a file stay in order. If it
+             * can't be started, the values are written synchronously.
+             */
+            if (!util_queue_is_initialized(&hud->dump_queue))
+               util_queue_init(&hud->dump_queue, "hud_dump", 64, 1,
+                               UTIL_QUEUE_INIT_RESIZE_IF_FULL);
          }
          free(dump_file);
       }
@@ -1270,6 +1329,9 @@ hud_parse_env_var(struct hud_context *hud, struct pipe_screen *screen,
       else if (strcmp(name, "API-thread-num-syncs") == 0) {
          hud_thread_counter_install(pane, name, HUD_COUNTER_SYNCS);
       }
+      else if (strcmp(name, "API-thread-sync-calls") == 0) {
+         hud_thread_counter_install(pane, name, HUD_COUNTER_SYNC_CALLS);
+      }
       else if (strcmp(name, "main-thread-busy") == 0) {
          hud_thread_busy_install(pane, name, true);
       }
@@ -1926,6 +1988,8 @@ hud_destroy(struct hud_context *hud, struct cso_context *cso)
       hud_unset_draw_context(hud);
 
    if (p_atomic_dec_zero(&hud->refcount)) {
+      if (util_queue_is_initialized(&hud->dump_queue))
+         util_queue_destroy(&hud->dump_queue);
       pipe_resource_reference(&hud->font.texture, NULL);
       FREE(hud);
    }
@@ -413,6 +413,8 @@ static unsigned get_counter(struct hud_graph *gr, enum hud_counter counter)
       return mon->num_direct_items;
    case HUD_COUNTER_SYNCS:
       return mon->num_syncs;
+   case HUD_COUNTER_SYNC_CALLS:
+      return mon->num_sync_calls;
    default:
       assert(0);
       return 0;
@@ -29,11 +29,16 @@
  * for displaying on the HUD. To prevent stalls when reading queries, we
  * keep a list of busy queries in a ring. We read only those queries which
  * are idle.
+ *
+ * If the driver can write query results into a buffer, the GPU does that
+ * at the end of each frame and we map the buffers a few frames later, so
+ * get_query_result is never called and can't make the driver flush.
  */
 
 #include "hud/hud_private.h"
 #include "pipe/p_screen.h"
 #include "util/os_time.h"
+#include "util/u_inlines.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include <stdio.h>
@@ -41,6 +46,9 @@
 // Must be a power of two
 #define NUM_QUERIES 8
 
+/* Frames to wait before mapping a result buffer. */
+#define READBACK_DELAY 2
+
 struct hud_batch_query_context {
    unsigned num_query_types;
    unsigned allocated_query_types;
@@ -207,6 +215,14 @@ struct query_info {
    struct pipe_query *query[NUM_QUERIES];
    unsigned head, tail;
 
+   /* Result buffers of the ring slots and the frame their result was
+    * written in, if use_buffer is set.
+    */
+   boolean use_buffer;
+   struct pipe_resource *buffer[NUM_QUERIES];
+   unsigned buffer_frame[NUM_QUERIES];
+   unsigned frame;
+
    uint64_t last_time;
    uint64_t results_cumulative;
    unsigned num_results;
@@ -229,6 +245,94 @@ query_new_value_batch(struct query_info *info)
    }
 }
 
+static boolean
+can_use_buffer(struct query_info *info, struct pipe_context *pipe)
+{
+   if (!pipe->get_query_result_resource ||
+       !pipe->screen->get_param(pipe->screen, PIPE_CAP_QUERY_BUFFER_OBJECT) ||
+       info->type == PIPE_DRIVER_QUERY_TYPE_FLOAT)
+      return FALSE;
+
+   /* Only the query types of ARB_query_buffer_object, drivers don't have to
+    * support buffers for anything else.
+    */
+   switch (info->query_type) {
+   case PIPE_QUERY_OCCLUSION_COUNTER:
+   case PIPE_QUERY_PRIMITIVES_GENERATED:
+   case PIPE_QUERY_PRIMITIVES_EMITTED:
+   case PIPE_QUERY_TIME_ELAPSED:
+   case PIPE_QUERY_PIPELINE_STATISTICS:
+      return TRUE;
+   default:
+      return FALSE;
+   }
+}
+
+static boolean
+create_buffer_slot(struct query_info *info, struct pipe_context *pipe,
+                   unsigned idx)
+{
+   if (!info->query[idx])
+      info->query[idx] = pipe->create_query(pipe, info->query_type, 0);
+   if (!info->buffer[idx])
+      info->buffer[idx] = pipe_buffer_create(pipe->screen,
+                                             PIPE_BIND_QUERY_BUFFER,
+                                             PIPE_USAGE_STAGING,
+                                             sizeof(uint64_t));
+   return info->query[idx] && info->buffer[idx];
+}
+
+static void
+query_new_value_buffer(struct query_info *info, struct pipe_context *pipe)
+{
+   unsigned next;
+
+   if (info->query[info->head]) {
+      pipe->end_query(pipe, info->query[info->head]);
+      /* The GPU waits for the result, not us. */
+      pipe->get_query_result_resource(pipe, info->query[info->head], TRUE,
+                                      PIPE_QUERY_TYPE_U64,
+                                      info->result_index,
+                                      info->buffer[info->head], 0);
+      info->buffer_frame[info->head] = info->frame;
+   }
+   info->frame++;
+
+   /* read the results of earlier frames that have landed */
+   while (info->tail != info->head &&
+          info->frame - info->buffer_frame[info->tail] >= READBACK_DELAY) {
+      struct pipe_transfer *transfer;
+      uint64_t *map = pipe_buffer_map(pipe, info->buffer[info->tail],
+                                      PIPE_TRANSFER_READ |
+                                      PIPE_TRANSFER_DONTBLOCK,
+                                      &transfer);
+      if (!map)
+         break;
+
+      info->results_cumulative += *map;
+      info->num_results++;
+      pipe_buffer_unmap(pipe, transfer);
+
+      info->tail = (info->tail + 1) % NUM_QUERIES;
+   }
+
+   next = (info->head + 1) % NUM_QUERIES;
+   if (next == info->tail) {
+      fprintf(stderr,
+              "gallium_hud: all query buffers are busy after %i frames, "
+              "dropping data\n", NUM_QUERIES);
+      info->tail = (info->tail + 1) % NUM_QUERIES;
+   }
+   info->head = next;
+
+   if (!create_buffer_slot(info, pipe, info->head)) {
+      fprintf(stderr, "gallium_hud: couldn't create a query buffer\n");
+      if (info->query[info->head])
+         pipe->destroy_query(pipe, info->query[info->head]);
+      info->query[info->head] = NULL;
+   }
+}
+
 static void
 query_new_value_normal(struct query_info *info, struct pipe_context *pipe)
 {
@@ -286,7 +390,11 @@ query_new_value_normal(struct query_info *info, struct pipe_context *pipe)
    }
    else {
       /* initialize */
-      info->query[info->head] = pipe->create_query(pipe, info->query_type, 0);
+      info->use_buffer = can_use_buffer(info, pipe) &&
+                         create_buffer_slot(info, pipe, info->head);
+      if (!info->query[info->head])
+         info->query[info->head] =
+               pipe->create_query(pipe, info->query_type, 0);
    }
 }
 
@@ -308,6 +416,8 @@ query_new_value(struct hud_graph *gr, struct pipe_context *pipe)
 
    if (info->batch) {
       query_new_value_batch(info);
+   } else if (info->use_buffer) {
+      query_new_value_buffer(info, pipe);
    } else {
       query_new_value_normal(info, pipe);
    }
@@ -350,12 +460,14 @@ free_query_info(void *ptr, struct pipe_context *pipe)
    if (!info->batch && info->last_time) {
       int i;
 
-      pipe->end_query(pipe, info->query[info->head]);
+      if (info->query[info->head])
+         pipe->end_query(pipe, info->query[info->head]);
 
       for (i = 0; i < ARRAY_SIZE(info->query); i++) {
          if (info->query[i]) {
             pipe->destroy_query(pipe, info->query[i]);
          }
+         pipe_resource_reference(&info->buffer[i], NULL);
       }
    }
    FREE(info);
@@ -31,12 +31,14 @@
 #include "pipe/p_context.h"
 #include "pipe/p_state.h"
 #include "util/list.h"
+#include "util/u_queue.h"
 #include "hud/font.h"
 
 enum hud_counter {
    HUD_COUNTER_OFFLOADED,
    HUD_COUNTER_DIRECT,
    HUD_COUNTER_SYNCS,
+   HUD_COUNTER_SYNC_CALLS,
 };
 
 struct hud_context {
@@ -55,6 +57,9 @@ struct hud_context {
 
    struct util_queue_monitoring *monitored_queue;
 
+   /* Writes the values of graphs to GALLIUM_HUD_DUMP_DIR. */
+   struct util_queue dump_queue;
+
    /* states */
    struct pipe_blend_state no_blend, alpha_blend;
    struct pipe_depth_stencil_alpha_state dsa;
@@ -24,6 +24,11 @@
 
 #include "u_indices.h"
 #include "u_indices_priv.h"
+#include "util/u_cpu_detect.h"
+
+#if defined(USE_SSE41)
+#include "u_indices_sse41.h"
+#endif
 
 static void translate_memcpy_ushort( const void *in,
                                      unsigned start,
@@ -46,6 +51,102 @@ static void translate_memcpy_uint( const void *in,
 }
                               
 
+#if defined(USE_SSE41)
+
+/* The quad vertices of the two triangles, see do_quad() in u_indices_gen.py
+ * (indexed by in_pv and out_pv).
+ */
+static const uint8_t quad_pattern[PV_COUNT][PV_COUNT][6] = {
+   { { 0, 1, 2, 0, 2, 3 }, { 1, 2, 0, 2, 3, 0 } },
+   { { 3, 0, 1, 3, 1, 2 }, { 0, 1, 3, 1, 2, 3 } },
+};
+
+static void translate_widen_ubyte2ushort_sse41( const void *in,
+                                                unsigned start,
+                                                unsigned in_nr,
+                                                unsigned out_nr,
+                                                unsigned restart_index,
+                                                void *out )
+{
+   u_index_widen_ubyte_ushort_sse41((const uint8_t *)in + start, out_nr, out);
+}
+
+#define TRANSLATE_QUADS_SSE41(intype, outtype, func, inpv, outpv)           \
+static void translate_quads_##intype##2##outtype##_##inpv##2##outpv##_sse41( \
+   const void *in, unsigned start, unsigned in_nr, unsigned out_nr,        \
+   unsigned restart_index, void *out )                                     \
+{                                                                          \
+   func((const intype *)in + start, out_nr / 6,                            \
+        quad_pattern[PV_##inpv][PV_##outpv], (outtype *)out);              \
+}
+
+#define TRANSLATE_QUADS_SSE41_PV(intype, outtype, func)                     \
+   TRANSLATE_QUADS_SSE41(intype, outtype, func, FIRST, FIRST)              \
+   TRANSLATE_QUADS_SSE41(intype, outtype, func, FIRST, LAST)               \
+   TRANSLATE_QUADS_SSE41(intype, outtype, func, LAST, FIRST)               \
+   TRANSLATE_QUADS_SSE41(intype, outtype, func, LAST, LAST)
+
+TRANSLATE_QUADS_SSE41_PV(ubyte, ushort, u_index_quads_ubyte_ushort_sse41)
+TRANSLATE_QUADS_SSE41_PV(ushort, ushort, u_index_quads_ushort_sse41)
+TRANSLATE_QUADS_SSE41_PV(uint, uint, u_index_quads_uint_sse41)
+
+#define INIT_QUADS_SSE41(in, out, intype, outtype, inpv, outpv)             \
+   translate[in][out][PV_##inpv][PV_##outpv][PR_DISABLE][PIPE_PRIM_QUADS] = \
+      translate_quads_##intype##2##outtype##_##inpv##2##outpv##_sse41
+
+#define INIT_QUADS_SSE41_PV(in, out, intype, outtype)                       \
+   INIT_QUADS_SSE41(in, out, intype, outtype, FIRST, FIRST);               \
+   INIT_QUADS_SSE41(in, out, intype, outtype, FIRST, LAST);                \
+   INIT_QUADS_SSE41(in, out, intype, outtype, LAST, FIRST);                \
+   INIT_QUADS_SSE41(in, out, intype, outtype, LAST, LAST)
+
+#endif
+
+/**
+ * Replace the generated translate functions of the most common conversions
+ * with vectorized ones, if the CPU supports them.
+ */
+static void u_index_init_simd( void )
+{
+#if defined(USE_SSE41)
+   /* Primitives whose indices are copied as they are. */
+   static const enum pipe_prim_type copy_prims[] = {
+      PIPE_PRIM_POINTS,
+      PIPE_PRIM_LINES,
+      PIPE_PRIM_TRIANGLES,
+      PIPE_PRIM_LINES_ADJACENCY,
+      PIPE_PRIM_TRIANGLES_ADJACENCY,
+   };
+   unsigned i, pv, pr;
+
+   util_cpu_detect();
+   if (!util_cpu_caps.has_sse4_1)
+      return;
+
+   for (i = 0; i < ARRAY_SIZE(copy_prims); i++) {
+      for (pv = 0; pv < PV_COUNT; pv++) {
+         for (pr = 0; pr < PR_COUNT; pr++) {
+            translate[IN_UBYTE][OUT_USHORT][pv][pv][pr][copy_prims[i]] =
+               translate_widen_ubyte2ushort_sse41;
+         }
+      }
+   }
+
+   /* Points don't have a provoking vertex. */
+   for (pr = 0; pr < PR_COUNT; pr++) {
+      translate[IN_UBYTE][OUT_USHORT][PV_FIRST][PV_LAST][pr][PIPE_PRIM_POINTS] =
+         translate_widen_ubyte2ushort_sse41;
+      translate[IN_UBYTE][OUT_USHORT][PV_LAST][PV_FIRST][pr][PIPE_PRIM_POINTS] =
+         translate_widen_ubyte2ushort_sse41;
+   }
+
+   INIT_QUADS_SSE41_PV(IN_UBYTE, OUT_USHORT, ubyte, ushort);
+   INIT_QUADS_SSE41_PV(IN_USHORT, OUT_USHORT, ushort, ushort);
+   INIT_QUADS_SSE41_PV(IN_UINT, OUT_UINT, uint, uint);
+#endif
+}
+
+
 /**
  * Translate indexes when a driver can't support certain types
  * of drawing.  Example include:
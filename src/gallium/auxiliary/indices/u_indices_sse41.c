@@ -0,0 +1,271 @@
+/*
+ * Copyright 2019 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * on the rights to use, copy, modify, merge, publish, distribute, sub
+ * license, and/or sell copies of the Software, and to permit persons to whom
+ * the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.  IN NO EVENT SHALL
+ * VMWARE AND/OR THEIR SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "indices/u_indices_sse41.h"
+
+#include <smmintrin.h>
+#include <string.h>
+
+#include "util/bitscan.h"
+
+
+void
+u_index_widen_ubyte_ushort_sse41(const uint8_t *in, unsigned n, uint16_t *out)
+{
+   unsigned i = 0;
+
+   for (; i + 16 <= n; i += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+
+      _mm_storeu_si128((__m128i *)(out + i), _mm_cvtepu8_epi16(v));
+      _mm_storeu_si128((__m128i *)(out + i + 8),
+                       _mm_cvtepu8_epi16(_mm_srli_si128(v, 8)));
+   }
+
+   for (; i < n; i++)
+      out[i] = in[i];
+}
+
+
+/*
+ * Shuffle masks that turn two quads of ushorts into 12 ushorts: the first
+ * mask makes the 6 indices of the first quad and the first 2 indices of the
+ * second one, the second mask the remaining 4 in the low half.
+ */
+static void
+quads_ushort_masks(const uint8_t pattern[6], __m128i *lo, __m128i *hi)
+{
+   uint8_t mask[32];
+   unsigned e;
+
+   for (e = 0; e < 12; e++) {
+      unsigned src = (e / 6) * 4 + pattern[e % 6];
+
+      mask[e * 2 + 0] = src * 2;
+      mask[e * 2 + 1] = src * 2 + 1;
+   }
+   memset(mask + 24, 0x80, 8);
+
+   *lo = _mm_loadu_si128((const __m128i *)mask);
+   *hi = _mm_loadu_si128((const __m128i *)(mask + 16));
+}
+
+
+static inline void
+quads_ushort_store(__m128i v, __m128i lo, __m128i hi, uint16_t *out)
+{
+   _mm_storeu_si128((__m128i *)out, _mm_shuffle_epi8(v, lo));
+   _mm_storel_epi64((__m128i *)(out + 8), _mm_shuffle_epi8(v, hi));
+}
+
+
+void
+u_index_quads_ubyte_ushort_sse41(const uint8_t *in, unsigned num_quads,
+                                 const uint8_t pattern[6], uint16_t *out)
+{
+   __m128i lo, hi;
+   unsigned q = 0, e;
+
+   quads_ushort_masks(pattern, &lo, &hi);
+
+   for (; q + 2 <= num_quads; q += 2) {
+      __m128i v = _mm_loadl_epi64((const __m128i *)(in + q * 4));
+
+      quads_ushort_store(_mm_cvtepu8_epi16(v), lo, hi, out + q * 6);
+   }
+
+   for (; q < num_quads; q++) {
+      for (e = 0; e < 6; e++)
+         out[q * 6 + e] = in[q * 4 + pattern[e]];
+   }
+}
+
+
+void
+u_index_quads_ushort_sse41(const uint16_t *in, unsigned num_quads,
+                           const uint8_t pattern[6], uint16_t *out)
+{
+   __m128i lo, hi;
+   unsigned q = 0, e;
+
+   quads_ushort_masks(pattern, &lo, &hi);
+
+   for (; q + 2 <= num_quads; q += 2) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(in + q * 4));
+
+      quads_ushort_store(v, lo, hi, out + q * 6);
+   }
+
+   for (; q < num_quads; q++) {
+      for (e = 0; e < 6; e++)
+         out[q * 6 + e] = in[q * 4 + pattern[e]];
+   }
+}
+
+
+void
+u_index_quads_uint_sse41(const uint32_t *in, unsigned num_quads,
+                         const uint8_t pattern[6], uint32_t *out)
+{
+   uint8_t mask[32];
+   __m128i lo, hi;
+   unsigned q = 0, e, b;
+
+   for (e = 0; e < 6; e++) {
+      for (b = 0; b < 4; b++)
+         mask[e * 4 + b] = pattern[e] * 4 + b;
+   }
+   memset(mask + 24, 0x80, 8);
+   lo = _mm_loadu_si128((const __m128i *)mask);
+   hi = _mm_loadu_si128((const __m128i *)(mask + 16));
+
+   for (; q < num_quads; q++) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(in + q * 4));
+
+      _mm_storeu_si128((__m128i *)(out + q * 6), _mm_shuffle_epi8(v, lo));
+      _mm_storel_epi64((__m128i *)(out + q * 6 + 4), _mm_shuffle_epi8(v, hi));
+   }
+}
+
+
+/*
+ * The restart index is replaced by OR-ing the indices with the result of
+ * the comparison, which is all ones where they match.
+ */
+
+void
+u_index_restart_ubyte_ushort_sse41(const uint8_t *in, unsigned n,
+                                   unsigned restart_index, uint16_t *out)
+{
+   __m128i restart = _mm_set1_epi16((short)restart_index);
+   unsigned i = 0;
+
+   if (restart_index > 0xff) {
+      u_index_widen_ubyte_ushort_sse41(in, n, out);
+      return;
+   }
+
+   for (; i + 16 <= n; i += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+      __m128i v0 = _mm_cvtepu8_epi16(v);
+      __m128i v1 = _mm_cvtepu8_epi16(_mm_srli_si128(v, 8));
+
+      _mm_storeu_si128((__m128i *)(out + i),
+                       _mm_or_si128(v0, _mm_cmpeq_epi16(v0, restart)));
+      _mm_storeu_si128((__m128i *)(out + i + 8),
+                       _mm_or_si128(v1, _mm_cmpeq_epi16(v1, restart)));
+   }
+
+   for (; i < n; i++)
+      out[i] = in[i] == restart_index ? 0xffff : in[i];
+}
+
+
+void
+u_index_restart_ushort_sse41(const uint16_t *in, unsigned n,
+                             unsigned restart_index, uint16_t *out)
+{
+   __m128i restart = _mm_set1_epi16((short)restart_index);
+   unsigned i = 0;
+
+   if (restart_index > 0xffff) {
+      memcpy(out, in, n * sizeof(*out));
+      return;
+   }
+
+   for (; i + 8 <= n; i += 8) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+
+      _mm_storeu_si128((__m128i *)(out + i),
+                       _mm_or_si128(v, _mm_cmpeq_epi16(v, restart)));
+   }
+
+   for (; i < n; i++)
+      out[i] = in[i] == restart_index ? 0xffff : in[i];
+}
+
+
+void
+u_index_restart_uint_sse41(const uint32_t *in, unsigned n,
+                           unsigned restart_index, uint32_t *out)
+{
+   __m128i restart = _mm_set1_epi32((int)restart_index);
+   unsigned i = 0;
+
+   for (; i + 4 <= n; i += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+
+      _mm_storeu_si128((__m128i *)(out + i),
+                       _mm_or_si128(v, _mm_cmpeq_epi32(v, restart)));
+   }
+
+   for (; i < n; i++)
+      out[i] = in[i] == restart_index ? 0xffffffff : in[i];
+}
+
+
+/* The comparison results are read with _mm_movemask_epi8, so the position
+ * is the bit index divided by the index size.
+ */
+#define FIND_RESTART(type, size, cmpeq, set1, max)                         \
+   __m128i restart = set1((type)restart_index);                          \
+   unsigned i = start;                                                   \
+                                                                         \
+   if (restart_index > max)                                              \
+      return n;                                                          \
+                                                                         \
+   for (; i + 16 / size <= n; i += 16 / size) {                          \
+      __m128i v = _mm_loadu_si128((const __m128i *)(in + i));            \
+      unsigned mask = _mm_movemask_epi8(cmpeq(v, restart));              \
+                                                                         \
+      if (mask)                                                          \
+         return i + (ffs(mask) - 1) / size;                              \
+   }                                                                     \
+                                                                         \
+   for (; i < n; i++) {                                                  \
+      if (in[i] == restart_index)                                        \
+         return i;                                                       \
+   }                                                                     \
+   return n;
+
+unsigned
+u_index_find_restart_ubyte_sse41(const uint8_t *in, unsigned start,
+                                 unsigned n, unsigned restart_index)
+{
+   FIND_RESTART(char, 1, _mm_cmpeq_epi8, _mm_set1_epi8, 0xff)
+}
+
+unsigned
+u_index_find_restart_ushort_sse41(const uint16_t *in, unsigned start,
+                                  unsigned n, unsigned restart_index)
+{
+   FIND_RESTART(short, 2, _mm_cmpeq_epi16, _mm_set1_epi16, 0xffff)
+}
+
+unsigned
+u_index_find_restart_uint_sse41(const uint32_t *in, unsigned start,
+                                unsigned n, unsigned restart_index)
+{
+   FIND_RESTART(int, 4, _mm_cmpeq_epi32, _mm_set1_epi32, 0xffffffff)
+}
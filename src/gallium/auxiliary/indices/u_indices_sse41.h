@@ -0,0 +1,83 @@
+/*
+ * Copyright 2019 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * on the rights to use, copy, modify, merge, publish, distribute, sub
+ * license, and/or sell copies of the Software, and to permit persons to whom
+ * the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.  IN NO EVENT SHALL
+ * VMWARE AND/OR THEIR SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file
+ * SSE4.1 index translation kernels.
+ *
+ * These are built with -msse4.1 into a separate library, so callers must
+ * check for USE_SSE41 and util_cpu_caps.has_sse4_1.
+ */
+
+#ifndef U_INDICES_SSE41_H
+#define U_INDICES_SSE41_H
+
+#include <stdint.h>
+
+/* Convert n ubyte indices to ushort. */
+void
+u_index_widen_ubyte_ushort_sse41(const uint8_t *in, unsigned n, uint16_t *out);
+
+/*
+ * Split quads into two triangles each.  pattern[] holds the vertex of the
+ * quad (0-3) used for each of the 6 output indices.
+ */
+void
+u_index_quads_ubyte_ushort_sse41(const uint8_t *in, unsigned num_quads,
+                                 const uint8_t pattern[6], uint16_t *out);
+void
+u_index_quads_ushort_sse41(const uint16_t *in, unsigned num_quads,
+                           const uint8_t pattern[6], uint16_t *out);
+void
+u_index_quads_uint_sse41(const uint32_t *in, unsigned num_quads,
+                         const uint8_t pattern[6], uint32_t *out);
+
+/*
+ * Copy n indices, replacing restart_index with 0xffff or 0xffffffff.
+ */
+void
+u_index_restart_ubyte_ushort_sse41(const uint8_t *in, unsigned n,
+                                   unsigned restart_index, uint16_t *out);
+void
+u_index_restart_ushort_sse41(const uint16_t *in, unsigned n,
+                             unsigned restart_index, uint16_t *out);
+void
+u_index_restart_uint_sse41(const uint32_t *in, unsigned n,
+                           unsigned restart_index, uint32_t *out);
+
+/*
+ * Return the position of the first restart_index in in[start, n), or n if
+ * there is none.
+ */
+unsigned
+u_index_find_restart_ubyte_sse41(const uint8_t *in, unsigned start,
+                                 unsigned n, unsigned restart_index);
+unsigned
+u_index_find_restart_ushort_sse41(const uint16_t *in, unsigned start,
+                                  unsigned n, unsigned restart_index);
+unsigned
+u_index_find_restart_uint_sse41(const uint32_t *in, unsigned start,
+                                unsigned n, unsigned restart_index);
+
+#endif
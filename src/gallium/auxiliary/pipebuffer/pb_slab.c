@@ -29,6 +29,12 @@
 
 #include "util/u_math.h"
 #include "util/u_memory.h"
+#include "util/simple_mtx.h"
+
+#define PB_SLAB_NUM_FRONT_CACHES 8
+
+/* Maximum number of entries moved into a front cache at once. */
+#define PB_SLAB_FRONT_CACHE_BATCH 8
 
 /* All slab allocations from the same heap and with the same size belong
  * to the same group.
@@ -47,8 +53,44 @@ struct pb_slab_group
     * can be fully allocated as well.
     */
    struct list_head slabs;
+
+   /* Free entries of this group held by each front cache. They are counted
+    * as allocated by their slabs. Protected by the front cache's lock.
+    */
+   struct list_head cached[PB_SLAB_NUM_FRONT_CACHES];
+};
+
+struct pb_slab_front_cache
+{
+   simple_mtx_t lock;
+   struct pb_slabs_stats stats;
 };
 
+static unsigned
+pb_slabs_front_cache_index(void)
+{
+#if defined(HAVE_PTHREAD)
+   uint64_t id = (uintptr_t)pthread_self();
+
+   /* Fibonacci hashing, thread IDs tend to share their low bits. */
+   return (id * 0x9e3779b97f4a7c15ull) >> (64 - 3);
+#else
+   return 0;
+#endif
+}
+
+static unsigned
+pb_slabs_class_size(struct pb_slabs *slabs, unsigned order, unsigned size_class)
+{
+   unsigned half;
+
+   if (slabs->num_classes == 1)
+      return 1u << order;
+
+   half = 1u << (order - 1);
+   return half + (size_class + 1) * (half / slabs->num_classes);
+}
+
 
 static void
 pb_slab_reclaim(struct pb_slabs *slabs, struct pb_slab_entry *entry)
@@ -71,6 +113,30 @@ pb_slab_reclaim(struct pb_slabs *slabs, struct pb_slab_entry *entry)
    }
 }
 
+/* Give the free entries of all front caches back to their slabs, by way of
+ * the reclaim list.
+ */
+static void
+pb_slabs_drain_front_caches_locked(struct pb_slabs *slabs)
+{
+   unsigned num_groups = slabs->num_heaps * slabs->num_orders *
+                         slabs->num_classes;
+
+   for (unsigned i = 0; i < PB_SLAB_NUM_FRONT_CACHES; ++i) {
+      struct pb_slab_front_cache *front = &slabs->front_caches[i];
+
+      simple_mtx_lock(&front->lock);
+      for (unsigned g = 0; g < num_groups; ++g) {
+         struct list_head *cached = &slabs->groups[g].cached[i];
+
+         /* The entries are idle, put them in front of the busy ones. */
+         list_splice(cached, &slabs->reclaim);
+         LIST_INITHEAD(cached);
+      }
+      simple_mtx_unlock(&front->lock);
+   }
+}
+
 static void
 pb_slabs_reclaim_locked(struct pb_slabs *slabs)
 {
@@ -85,31 +151,82 @@ pb_slabs_reclaim_locked(struct pb_slabs *slabs)
    }
 }
 
-/* Allocate a slab entry of the given size from the given heap.
+/* Allocate a slab entry of the given size and alignment from the given heap.
  *
  * This will try to re-use entries that have previously been freed. However,
  * if no entries are free (or all free entries are still "in flight" as
  * determined by the can_reclaim fallback function), a new slab will be
  * requested via the slab_alloc callback.
  *
+ * The alignment must not exceed the power of two the size is rounded up to.
+ * It only matters when entry sizes aren't powers of two.
+ *
  * Note that slab_free can also be called by this function.
  */
 struct pb_slab_entry *
-pb_slab_alloc(struct pb_slabs *slabs, unsigned size, unsigned heap)
+pb_slab_alloc(struct pb_slabs *slabs, unsigned size, unsigned alignment,
+              unsigned heap)
 {
    unsigned order = MAX2(slabs->min_order, util_logbase2_ceil(size));
-   unsigned group_index;
+   unsigned size_class = slabs->num_classes - 1;
+   unsigned entry_size, group_index, front_index;
+   struct pb_slab_front_cache *front;
    struct pb_slab_group *group;
    struct pb_slab *slab;
    struct pb_slab_entry *entry;
+   struct list_head *cached;
+   struct list_head batch;
+   unsigned batch_size = 0;
+   bool contended = false;
 
    assert(order < slabs->min_order + slabs->num_orders);
    assert(heap < slabs->num_heaps);
+   assert(alignment <= (1u << order));
+
+   /* Use the smallest class that fits and is aligned enough. */
+   if (slabs->num_classes > 1) {
+      unsigned half = 1u << (order - 1);
+      unsigned step = half / slabs->num_classes;
+
+      size_class = size > half ? DIV_ROUND_UP(size - half, step) - 1 : 0;
+      while (size_class < slabs->num_classes - 1) {
+         entry_size = pb_slabs_class_size(slabs, order, size_class);
+         if ((entry_size & -entry_size) >= alignment)
+            break;
+         size_class++;
+      }
+   }
+   entry_size = pb_slabs_class_size(slabs, order, size_class);
 
-   group_index = heap * slabs->num_orders + (order - slabs->min_order);
+   group_index = (heap * slabs->num_orders + (order - slabs->min_order)) *
+                 slabs->num_classes + size_class;
    group = &slabs->groups[group_index];
 
-   mtx_lock(&slabs->mutex);
+   front_index = pb_slabs_front_cache_index();
+   front = &slabs->front_caches[front_index];
+   cached = &group->cached[front_index];
+
+   simple_mtx_lock(&front->lock);
+   front->stats.num_allocs++;
+   front->stats.requested_bytes += size;
+   front->stats.allocated_bytes += entry_size;
+
+   if (!LIST_IS_EMPTY(cached)) {
+      entry = LIST_ENTRY(struct pb_slab_entry, cached->next, head);
+      LIST_DEL(&entry->head);
+      front->stats.num_front_cache_hits++;
+      simple_mtx_unlock(&front->lock);
+      return entry;
+   }
+   /* Don't hold the front cache lock across slab_alloc, which may call back
+    * into pb_slab_alloc.
+    */
+   simple_mtx_unlock(&front->lock);
+
+   if (mtx_trylock(&slabs->mutex) != thrd_success) {
+      mtx_lock(&slabs->mutex);
+      contended = true;
+   }
 
    /* If there is no candidate slab at all, or the first slab has no free
     * entries, try reclaiming entries.
@@ -136,7 +253,7 @@ pb_slab_alloc(struct pb_slabs *slabs, unsigned size, unsigned heap)
        * slabs for the same group, but that doesn't hurt correctness.
        */
       mtx_unlock(&slabs->mutex);
-      slab = slabs->slab_alloc(slabs->priv, heap, 1 << order, group_index);
+      slab = slabs->slab_alloc(slabs->priv, heap, entry_size, group_index);
       if (!slab)
          return NULL;
       mtx_lock(&slabs->mutex);
@@ -148,8 +265,31 @@ pb_slab_alloc(struct pb_slabs *slabs, unsigned size, unsigned heap)
    LIST_DEL(&entry->head);
    slab->num_free--;
 
+   /* Refill the front cache from the same slab, but don't pin more than an
+    * eighth of a slab, which matters for big entries.
+    */
+   LIST_INITHEAD(&batch);
+   while (batch_size < MIN2(PB_SLAB_FRONT_CACHE_BATCH - 1,
+                            slab->num_entries / 8) &&
+          !LIST_IS_EMPTY(&slab->free)) {
+      struct pb_slab_entry *extra =
+         LIST_ENTRY(struct pb_slab_entry, slab->free.next, head);
+
+      LIST_DEL(&extra->head);
+      LIST_ADDTAIL(&extra->head, &batch);
+      slab->num_free--;
+      batch_size++;
+   }
+
    mtx_unlock(&slabs->mutex);
 
+   if (batch_size || contended) {
+      simple_mtx_lock(&front->lock);
+      list_splicetail(&batch, cached);
+      front->stats.num_contended_locks += contended;
+      simple_mtx_unlock(&front->lock);
+   }
+
    return entry;
 }
 
@@ -177,20 +317,43 @@ void
 pb_slabs_reclaim(struct pb_slabs *slabs)
 {
    mtx_lock(&slabs->mutex);
+   pb_slabs_drain_front_caches_locked(slabs);
    pb_slabs_reclaim_locked(slabs);
    mtx_unlock(&slabs->mutex);
 }
 
+void
+pb_slabs_get_stats(struct pb_slabs *slabs, struct pb_slabs_stats *stats)
+{
+   memset(stats, 0, sizeof(*stats));
+
+   for (unsigned i = 0; i < PB_SLAB_NUM_FRONT_CACHES; ++i) {
+      struct pb_slab_front_cache *front = &slabs->front_caches[i];
+
+      simple_mtx_lock(&front->lock);
+      stats->num_allocs += front->stats.num_allocs;
+      stats->num_front_cache_hits += front->stats.num_front_cache_hits;
+      stats->num_contended_locks += front->stats.num_contended_locks;
+      stats->requested_bytes += front->stats.requested_bytes;
+      stats->allocated_bytes += front->stats.allocated_bytes;
+      simple_mtx_unlock(&front->lock);
+   }
+}
+
 /* Initialize the slabs manager.
  *
  * The minimum and maximum size of slab entries are 2^min_order and
  * 2^max_order, respectively.
  *
+ * num_classes must be a power of two. If it is greater than 1, the sizes
+ * between two powers of two are divided into that many size classes.
+ *
  * priv will be passed to the given callback functions.
  */
 bool
 pb_slabs_init(struct pb_slabs *slabs,
               unsigned min_order, unsigned max_order,
+              unsigned num_classes,
               unsigned num_heaps,
               void *priv,
               slab_can_reclaim_fn *can_reclaim,
@@ -198,13 +361,16 @@ pb_slabs_init(struct pb_slabs *slabs,
               slab_free_fn *slab_free)
 {
    unsigned num_groups;
-   unsigned i;
+   unsigned i, j;
 
    assert(min_order <= max_order);
    assert(max_order < sizeof(unsigned) * 8 - 1);
+   assert(util_is_power_of_two_nonzero(num_classes));
+   assert(num_classes == 1 || (1u << min_order) >= 2 * num_classes);
 
    slabs->min_order = min_order;
    slabs->num_orders = max_order - min_order + 1;
+   slabs->num_classes = num_classes;
    slabs->num_heaps = num_heaps;
 
    slabs->priv = priv;
@@ -214,16 +380,28 @@ pb_slabs_init(struct pb_slabs *slabs,
 
    LIST_INITHEAD(&slabs->reclaim);
 
-   num_groups = slabs->num_orders * slabs->num_heaps;
+   num_groups = slabs->num_orders * slabs->num_classes * slabs->num_heaps;
    slabs->groups = CALLOC(num_groups, sizeof(*slabs->groups));
    if (!slabs->groups)
       return false;
 
+   slabs->front_caches = CALLOC(PB_SLAB_NUM_FRONT_CACHES,
+                                sizeof(*slabs->front_caches));
+   if (!slabs->front_caches) {
+      FREE(slabs->groups);
+      return false;
+   }
+
    for (i = 0; i < num_groups; ++i) {
       struct pb_slab_group *group = &slabs->groups[i];
       LIST_INITHEAD(&group->slabs);
+      for (j = 0; j < PB_SLAB_NUM_FRONT_CACHES; ++j)
+         LIST_INITHEAD(&group->cached[j]);
    }
 
+   for (i = 0; i < PB_SLAB_NUM_FRONT_CACHES; ++i)
+      simple_mtx_init(&slabs->front_caches[i].lock, mtx_plain);
+
    (void) mtx_init(&slabs->mutex, mtx_plain);
 
    return true;
@@ -241,12 +419,17 @@ pb_slabs_deinit(struct pb_slabs *slabs)
    /* Reclaim all slab entries (even those that are still in flight). This
     * implicitly calls slab_free for everything.
     */
+   pb_slabs_drain_front_caches_locked(slabs);
    while (!LIST_IS_EMPTY(&slabs->reclaim)) {
       struct pb_slab_entry *entry =
          LIST_ENTRY(struct pb_slab_entry, slabs->reclaim.next, head);
       pb_slab_reclaim(slabs, entry);
    }
 
+   for (unsigned i = 0; i < PB_SLAB_NUM_FRONT_CACHES; ++i)
+      simple_mtx_destroy(&slabs->front_caches[i].lock);
+
+   FREE(slabs->front_caches);
    FREE(slabs->groups);
    mtx_destroy(&slabs->mutex);
 }
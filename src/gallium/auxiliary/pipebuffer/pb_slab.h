@@ -39,6 +39,14 @@
  * region is still in use by the GPU. A callback function is called to
  * determine when it is safe to allocate the entry again; the user of this
  * library is expected to maintain the required fences or similar.
+ *
+ * Entry sizes are powers of two by default. Optionally, each power of two
+ * can be split into several size classes (e.g. 1.25x, 1.5x, 1.75x and 2x of
+ * the next lower power of two) to waste less memory per entry.
+ *
+ * Allocations are served from a small number of front caches of free
+ * entries, which are selected by the calling thread and refilled in batches,
+ * so that threads rarely contend for the mutex protecting the slabs.
  */
 
 #ifndef PB_SLAB_H
@@ -51,6 +59,7 @@
 struct pb_slab;
 struct pb_slabs;
 struct pb_slab_group;
+struct pb_slab_front_cache;
 
 /* Descriptor of a slab entry.
  *
@@ -104,6 +113,16 @@ typedef void (slab_free_fn)(void *priv, struct pb_slab *);
  */
 typedef bool (slab_can_reclaim_fn)(void *priv, struct pb_slab_entry *);
 
+/* Debug counters of a slab manager. */
+struct pb_slabs_stats
+{
+   uint64_t num_allocs;
+   uint64_t num_front_cache_hits; /* allocations that didn't lock the mutex */
+   uint64_t num_contended_locks; /* mutex acquisitions that had to wait */
+   uint64_t requested_bytes; /* sum of requested sizes */
+   uint64_t allocated_bytes; /* sum of entry sizes handed out */
+};
+
 /* Manager of slab allocations. The user of this utility library should embed
  * this in a structure somewhere and call pb_slab_init/deinit at init/shutdown
  * time.
@@ -114,11 +133,14 @@ struct pb_slabs
 
    unsigned min_order;
    unsigned num_orders;
+   unsigned num_classes; /* size classes per order */
    unsigned num_heaps;
 
-   /* One group per (heap, order) pair. */
+   /* One group per (heap, order, class) triple. */
    struct pb_slab_group *groups;
 
+   struct pb_slab_front_cache *front_caches;
+
    /* List of entries waiting to be reclaimed, i.e. they have been passed to
     * pb_slab_free, but may not be safe for re-use yet. The tail points at
     * the most-recently freed entry.
@@ -132,7 +154,8 @@ struct pb_slabs
 };
 
 struct pb_slab_entry *
-pb_slab_alloc(struct pb_slabs *slabs, unsigned size, unsigned heap);
+pb_slab_alloc(struct pb_slabs *slabs, unsigned size, unsigned alignment,
+              unsigned heap);
 
 void
 pb_slab_free(struct pb_slabs* slabs, struct pb_slab_entry *entry);
@@ -140,9 +163,13 @@ pb_slab_free(struct pb_slabs* slabs, struct pb_slab_entry *entry);
 void
 pb_slabs_reclaim(struct pb_slabs *slabs);
 
+void
+pb_slabs_get_stats(struct pb_slabs *slabs, struct pb_slabs_stats *stats);
+
 bool
 pb_slabs_init(struct pb_slabs *slabs,
               unsigned min_order, unsigned max_order,
+              unsigned num_classes,
               unsigned num_heaps,
               void *priv,
               slab_can_reclaim_fn *can_reclaim,
@@ -58,6 +58,7 @@
 #include "tgsi/tgsi_parse.h"
 #include "tgsi/tgsi_util.h"
 #include "tgsi_exec.h"
+#include "tgsi_exec_ops.h"
 #include "util/u_half.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
@@ -1108,6 +1109,9 @@ tgsi_exec_machine_bind_shader(
       mach->Instructions = NULL;
       mach->NumInstructions = 0;
 
+      FREE(mach->Ops);
+      mach->Ops = NULL;
+
       return;
    }
 
@@ -1264,6 +1268,9 @@ tgsi_exec_machine_bind_shader(
    FREE(mach->Instructions);
    mach->Instructions = instructions;
    mach->NumInstructions = numInstructions;
+
+   FREE(mach->Ops);
+   mach->Ops = tgsi_exec_ops_decode(mach);
 }
 
 
@@ -1319,6 +1326,7 @@ tgsi_exec_machine_destroy(struct tgsi_exec_machine *mach)
 {
    if (mach) {
       FREE(mach->Instructions);
+      FREE(mach->Ops);
       FREE(mach->Declarations);
       FREE(mach->Imms);
 
@@ -6361,6 +6369,7 @@ tgsi_exec_machine_run( struct tgsi_exec_machine *mach, int start_pc )
 
       /* execute instructions, until pc is set to -1 */
       while (mach->pc != -1) {
+         const struct tgsi_exec_op *op;
          boolean barrier_hit;
 #if DEBUG_EXECUTION
          uint i;
@@ -6369,7 +6378,14 @@ tgsi_exec_machine_run( struct tgsi_exec_machine *mach, int start_pc )
 #endif
 
          assert(mach->pc < (int) mach->NumInstructions);
-         barrier_hit = exec_instruction(mach, mach->Instructions + mach->pc, &mach->pc);
+         op = mach->Ops ? &mach->Ops[mach->pc] : NULL;
+         if (op && op->func) {
+            op->func(mach, op);
+            mach->pc++;
+            barrier_hit = FALSE;
+         } else {
+            barrier_hit = exec_instruction(mach, mach->Instructions + mach->pc, &mach->pc);
+         }
 
          /* for compute shaders if we hit a barrier return now for later rescheduling */
          if (barrier_hit && mach->ShaderType == PIPE_SHADER_COMPUTE)
@@ -322,6 +322,7 @@ enum tgsi_break_type {
 typedef float float4[4];
 
 struct tgsi_exec_machine;
+struct tgsi_exec_op;
 
 typedef void (* apply_sample_offset_func)(
    const struct tgsi_exec_machine *mach,
@@ -432,6 +433,9 @@ struct tgsi_exec_machine
    struct tgsi_full_instruction *Instructions;
    uint NumInstructions;
 
+   /** Pre-decoded Instructions, or NULL */
+   struct tgsi_exec_op *Ops;
+
    struct tgsi_full_declaration *Declarations;
    uint NumDeclarations;
 
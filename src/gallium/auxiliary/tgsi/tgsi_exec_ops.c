@@ -0,0 +1,653 @@
+/**************************************************************************
+ *
+ * Copyright 2019 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Pre-decoded TGSI ALU instructions.
+ *
+ * Each handler works on a whole channel (the four quad lanes) at a time,
+ * with SSE2 or NEON where available.  The results must match what
+ * exec_instruction() computes, so the operations are done in the same
+ * order, and MIN/MAX/saturate keep the NaN behaviour of the C code.
+ */
+
+#include "pipe/p_shader_tokens.h"
+#include "tgsi/tgsi_parse.h"
+#include "util/u_debug.h"
+#include "util/u_memory.h"
+#include "tgsi_exec.h"
+#include "tgsi_exec_ops.h"
+
+#if defined(PIPE_ARCH_SSE)
+#include <emmintrin.h>
+#elif defined(PIPE_ARCH_AARCH64)
+#include <arm_neon.h>
+#endif
+
+
+DEBUG_GET_ONCE_BOOL_OPTION(tgsi_no_predecode, "TGSI_NO_PREDECODE", FALSE)
+
+
+/* Lane masks for the 16 possible execution masks. */
+PIPE_ALIGN_VAR(16) static const uint32_t exec_lane_masks[16][4] = {
+   {  0,  0,  0,  0 }, { ~0,  0,  0,  0 }, {  0, ~0,  0,  0 }, { ~0, ~0,  0,  0 },
+   {  0,  0, ~0,  0 }, { ~0,  0, ~0,  0 }, {  0, ~0, ~0,  0 }, { ~0, ~0, ~0,  0 },
+   {  0,  0,  0, ~0 }, { ~0,  0,  0, ~0 }, {  0, ~0,  0, ~0 }, { ~0, ~0,  0, ~0 },
+   {  0,  0, ~0, ~0 }, { ~0,  0, ~0, ~0 }, {  0, ~0, ~0, ~0 }, { ~0, ~0, ~0, ~0 },
+};
+
+
+#if defined(PIPE_ARCH_SSE)
+
+typedef __m128 exec_vec;
+
+static inline exec_vec
+vec_load(const union tgsi_exec_channel *c)
+{
+   return _mm_loadu_ps(c->f);
+}
+
+static inline exec_vec
+vec_splat(uint bits)
+{
+   return _mm_castsi128_ps(_mm_set1_epi32((int)bits));
+}
+
+static inline void
+vec_store(union tgsi_exec_channel *c, exec_vec v, uint execmask)
+{
+   if (execmask != 0xf) {
+      __m128 mask = _mm_load_ps((const float *)exec_lane_masks[execmask]);
+
+      v = _mm_or_ps(_mm_and_ps(mask, v),
+                    _mm_andnot_ps(mask, _mm_loadu_ps(c->f)));
+   }
+   _mm_storeu_ps(c->f, v);
+}
+
+static inline exec_vec
+vec_add(exec_vec a, exec_vec b)
+{
+   return _mm_add_ps(a, b);
+}
+
+static inline exec_vec
+vec_sub(exec_vec a, exec_vec b)
+{
+   return _mm_sub_ps(a, b);
+}
+
+static inline exec_vec
+vec_mul(exec_vec a, exec_vec b)
+{
+   return _mm_mul_ps(a, b);
+}
+
+/* MINPS/MAXPS return the second operand unless the comparison is true,
+ * just like micro_min()/micro_max().
+ */
+static inline exec_vec
+vec_min(exec_vec a, exec_vec b)
+{
+   return _mm_min_ps(a, b);
+}
+
+static inline exec_vec
+vec_max(exec_vec a, exec_vec b)
+{
+   return _mm_max_ps(a, b);
+}
+
+static inline exec_vec
+vec_abs(exec_vec a)
+{
+   return _mm_and_ps(a, vec_splat(0x7fffffff));
+}
+
+static inline exec_vec
+vec_neg(exec_vec a)
+{
+   return _mm_xor_ps(a, vec_splat(0x80000000));
+}
+
+static inline exec_vec
+vec_sat(exec_vec a)
+{
+   const __m128 one = _mm_set1_ps(1.0f);
+   __m128 lt = _mm_cmplt_ps(a, _mm_setzero_ps());
+   __m128 gt = _mm_cmpgt_ps(a, one);
+
+   return _mm_or_ps(_mm_andnot_ps(_mm_or_ps(lt, gt), a),
+                    _mm_and_ps(gt, one));
+}
+
+#elif defined(PIPE_ARCH_AARCH64)
+
+typedef float32x4_t exec_vec;
+
+static inline exec_vec
+vec_load(const union tgsi_exec_channel *c)
+{
+   return vld1q_f32(c->f);
+}
+
+static inline exec_vec
+vec_splat(uint bits)
+{
+   return vreinterpretq_f32_u32(vdupq_n_u32(bits));
+}
+
+static inline void
+vec_store(union tgsi_exec_channel *c, exec_vec v, uint execmask)
+{
+   if (execmask != 0xf)
+      v = vbslq_f32(vld1q_u32(exec_lane_masks[execmask]), v, vld1q_f32(c->f));
+   vst1q_f32(c->f, v);
+}
+
+static inline exec_vec
+vec_add(exec_vec a, exec_vec b)
+{
+   return vaddq_f32(a, b);
+}
+
+static inline exec_vec
+vec_sub(exec_vec a, exec_vec b)
+{
+   return vsubq_f32(a, b);
+}
+
+static inline exec_vec
+vec_mul(exec_vec a, exec_vec b)
+{
+   return vmulq_f32(a, b);
+}
+
+/* FMIN/FMAX differ from the C code for NaNs and signed zeros, so select
+ * on the comparison instead.
+ */
+static inline exec_vec
+vec_min(exec_vec a, exec_vec b)
+{
+   return vbslq_f32(vcltq_f32(a, b), a, b);
+}
+
+static inline exec_vec
+vec_max(exec_vec a, exec_vec b)
+{
+   return vbslq_f32(vcgtq_f32(a, b), a, b);
+}
+
+static inline exec_vec
+vec_abs(exec_vec a)
+{
+   return vabsq_f32(a);
+}
+
+static inline exec_vec
+vec_neg(exec_vec a)
+{
+   return vnegq_f32(a);
+}
+
+static inline exec_vec
+vec_sat(exec_vec a)
+{
+   const float32x4_t zero = vdupq_n_f32(0.0f);
+   const float32x4_t one = vdupq_n_f32(1.0f);
+
+   return vbslq_f32(vcgtq_f32(a, one), one,
+                    vbslq_f32(vcltq_f32(a, zero), zero, a));
+}
+
+#else
+
+typedef union tgsi_exec_channel exec_vec;
+
+static inline exec_vec
+vec_load(const union tgsi_exec_channel *c)
+{
+   return *c;
+}
+
+static inline exec_vec
+vec_splat(uint bits)
+{
+   exec_vec v;
+
+   v.u[0] = v.u[1] = v.u[2] = v.u[3] = bits;
+   return v;
+}
+
+static inline void
+vec_store(union tgsi_exec_channel *c, exec_vec v, uint execmask)
+{
+   uint i;
+
+   for (i = 0; i < TGSI_QUAD_SIZE; i++)
+      c->u[i] = (v.u[i] & exec_lane_masks[execmask][i]) |
+                (c->u[i] & ~exec_lane_masks[execmask][i]);
+}
+
+#define VEC_LANES(expr) \
+   exec_vec r; \
+   uint i; \
+   for (i = 0; i < TGSI_QUAD_SIZE; i++) \
+      expr; \
+   return r
+
+static inline exec_vec
+vec_add(exec_vec a, exec_vec b)
+{
+   VEC_LANES(r.f[i] = a.f[i] + b.f[i]);
+}
+
+static inline exec_vec
+vec_sub(exec_vec a, exec_vec b)
+{
+   VEC_LANES(r.f[i] = a.f[i] - b.f[i]);
+}
+
+static inline exec_vec
+vec_mul(exec_vec a, exec_vec b)
+{
+   VEC_LANES(r.f[i] = a.f[i] * b.f[i]);
+}
+
+static inline exec_vec
+vec_min(exec_vec a, exec_vec b)
+{
+   VEC_LANES(r.u[i] = a.f[i] < b.f[i] ? a.u[i] : b.u[i]);
+}
+
+static inline exec_vec
+vec_max(exec_vec a, exec_vec b)
+{
+   VEC_LANES(r.u[i] = a.f[i] > b.f[i] ? a.u[i] : b.u[i]);
+}
+
+static inline exec_vec
+vec_abs(exec_vec a)
+{
+   VEC_LANES(r.u[i] = a.u[i] & 0x7fffffff);
+}
+
+static inline exec_vec
+vec_neg(exec_vec a)
+{
+   VEC_LANES(r.u[i] = a.u[i] ^ 0x80000000);
+}
+
+static inline exec_vec
+vec_sat(exec_vec a)
+{
+   VEC_LANES(r.u[i] = a.f[i] < 0.0f ? 0 :
+                     a.f[i] > 1.0f ? 0x3f800000 : a.u[i]);
+}
+
+#undef VEC_LANES
+
+#endif
+
+
+static inline exec_vec
+vec_mov(exec_vec a)
+{
+   return a;
+}
+
+static inline exec_vec
+vec_mad(exec_vec a, exec_vec b, exec_vec c)
+{
+   return vec_add(vec_mul(a, b), c);
+}
+
+static inline exec_vec
+vec_lrp(exec_vec a, exec_vec b, exec_vec c)
+{
+   return vec_add(vec_mul(a, vec_sub(b, c)), c);
+}
+
+
+static inline exec_vec
+fetch_src(const struct tgsi_exec_machine *mach,
+          const struct tgsi_exec_op_src *src,
+          uint chan)
+{
+   const uint swizzle = src->swizzle[chan];
+   exec_vec v;
+
+   if (src->reg) {
+      v = vec_load(&src->reg->xyzw[swizzle]);
+   } else if (src->imm) {
+      v = vec_splat(src->imm[swizzle]);
+   } else {
+      const uint *buf = (const uint *)mach->Consts[src->const_buf];
+      const int pos = src->const_index * 4 + swizzle;
+
+      /* same bounds check as fetch_src_file_channel() */
+      if (pos < 0 || pos >= (int) mach->ConstsSize[src->const_buf])
+         v = vec_splat(0);
+      else
+         v = vec_splat(buf[pos]);
+   }
+
+   if (src->abs)
+      v = vec_abs(v);
+   if (src->neg)
+      v = vec_neg(v);
+   return v;
+}
+
+static inline void
+store_dst(struct tgsi_exec_machine *mach,
+          const struct tgsi_exec_op *op,
+          const exec_vec *dst)
+{
+   struct tgsi_exec_vector *reg = op->dst;
+   const uint execmask = mach->ExecMask;
+   uint chan;
+
+   if (!reg) {
+      reg = &mach->Outputs[mach->Temps[TGSI_EXEC_TEMP_OUTPUT_I].xyzw[TGSI_EXEC_TEMP_OUTPUT_C].u[0] +
+                           op->dst_index];
+   }
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (op->writemask & (1 << chan)) {
+         vec_store(&reg->xyzw[chan],
+                   op->saturate ? vec_sat(dst[chan]) : dst[chan], execmask);
+      }
+   }
+}
+
+
+/* All the sources are fetched before anything is stored, since the
+ * destination may also be one of the sources.
+ */
+
+#define EXEC_OP_UNARY(name, vec_op)                                        \
+static void                                                                \
+exec_op_##name(struct tgsi_exec_machine *mach,                             \
+               const struct tgsi_exec_op *op)                              \
+{                                                                          \
+   exec_vec dst[TGSI_NUM_CHANNELS];                                        \
+   uint chan;                                                              \
+                                                                           \
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {                      \
+      if (op->writemask & (1 << chan))                                     \
+         dst[chan] = vec_op(fetch_src(mach, &op->src[0], chan));           \
+   }                                                                       \
+   store_dst(mach, op, dst);                                               \
+}
+
+#define EXEC_OP_BINARY(name, vec_op)                                       \
+static void                                                                \
+exec_op_##name(struct tgsi_exec_machine *mach,                             \
+               const struct tgsi_exec_op *op)                              \
+{                                                                          \
+   exec_vec dst[TGSI_NUM_CHANNELS];                                        \
+   uint chan;                                                              \
+                                                                           \
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {                      \
+      if (op->writemask & (1 << chan))                                     \
+         dst[chan] = vec_op(fetch_src(mach, &op->src[0], chan),            \
+                            fetch_src(mach, &op->src[1], chan));           \
+   }                                                                       \
+   store_dst(mach, op, dst);                                               \
+}
+
+#define EXEC_OP_TRINARY(name, vec_op)                                      \
+static void                                                                \
+exec_op_##name(struct tgsi_exec_machine *mach,                             \
+               const struct tgsi_exec_op *op)                              \
+{                                                                          \
+   exec_vec dst[TGSI_NUM_CHANNELS];                                        \
+   uint chan;                                                              \
+                                                                           \
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {                      \
+      if (op->writemask & (1 << chan))                                     \
+         dst[chan] = vec_op(fetch_src(mach, &op->src[0], chan),            \
+                            fetch_src(mach, &op->src[1], chan),            \
+                            fetch_src(mach, &op->src[2], chan));           \
+   }                                                                       \
+   store_dst(mach, op, dst);                                               \
+}
+
+EXEC_OP_UNARY(mov, vec_mov)
+EXEC_OP_BINARY(add, vec_add)
+EXEC_OP_BINARY(mul, vec_mul)
+EXEC_OP_BINARY(min, vec_min)
+EXEC_OP_BINARY(max, vec_max)
+EXEC_OP_TRINARY(mad, vec_mad)
+EXEC_OP_TRINARY(lrp, vec_lrp)
+
+/* The products are summed from X on, as in exec_dp4(). */
+static inline void
+exec_op_dp(struct tgsi_exec_machine *mach,
+           const struct tgsi_exec_op *op,
+           uint num_chans)
+{
+   exec_vec dst[TGSI_NUM_CHANNELS];
+   exec_vec sum;
+   uint chan;
+
+   sum = vec_mul(fetch_src(mach, &op->src[0], TGSI_CHAN_X),
+                 fetch_src(mach, &op->src[1], TGSI_CHAN_X));
+   for (chan = TGSI_CHAN_Y; chan < num_chans; chan++) {
+      sum = vec_mad(fetch_src(mach, &op->src[0], chan),
+                    fetch_src(mach, &op->src[1], chan), sum);
+   }
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++)
+      dst[chan] = sum;
+   store_dst(mach, op, dst);
+}
+
+static void
+exec_op_dp2(struct tgsi_exec_machine *mach, const struct tgsi_exec_op *op)
+{
+   exec_op_dp(mach, op, 2);
+}
+
+static void
+exec_op_dp3(struct tgsi_exec_machine *mach, const struct tgsi_exec_op *op)
+{
+   exec_op_dp(mach, op, 3);
+}
+
+static void
+exec_op_dp4(struct tgsi_exec_machine *mach, const struct tgsi_exec_op *op)
+{
+   exec_op_dp(mach, op, 4);
+}
+
+
+static tgsi_exec_op_func
+get_op_func(uint opcode)
+{
+   switch (opcode) {
+   case TGSI_OPCODE_MOV:
+      return exec_op_mov;
+   case TGSI_OPCODE_ADD:
+      return exec_op_add;
+   case TGSI_OPCODE_MUL:
+      return exec_op_mul;
+   case TGSI_OPCODE_MIN:
+      return exec_op_min;
+   case TGSI_OPCODE_MAX:
+      return exec_op_max;
+   case TGSI_OPCODE_MAD:
+      return exec_op_mad;
+   case TGSI_OPCODE_LRP:
+      return exec_op_lrp;
+   case TGSI_OPCODE_DP2:
+      return exec_op_dp2;
+   case TGSI_OPCODE_DP3:
+      return exec_op_dp3;
+   case TGSI_OPCODE_DP4:
+      return exec_op_dp4;
+   default:
+      return NULL;
+   }
+}
+
+static boolean
+decode_src(struct tgsi_exec_machine *mach,
+           const struct tgsi_full_src_register *reg,
+           struct tgsi_exec_op_src *src)
+{
+   const int index = reg->Register.Index;
+
+   if (reg->Register.Indirect || index < 0)
+      return FALSE;
+
+   /* Only constant buffers may have a (direct) second index. */
+   if (reg->Register.Dimension &&
+       (reg->Register.File != TGSI_FILE_CONSTANT || reg->Dimension.Indirect))
+      return FALSE;
+
+   switch (reg->Register.File) {
+   case TGSI_FILE_TEMPORARY:
+      if (index >= TGSI_EXEC_NUM_TEMPS)
+         return FALSE;
+      src->reg = &mach->Temps[index];
+      break;
+   case TGSI_FILE_INPUT:
+      if (!mach->Inputs)
+         return FALSE;
+      src->reg = &mach->Inputs[index];
+      break;
+   case TGSI_FILE_OUTPUT:
+      if (!mach->Outputs)
+         return FALSE;
+      src->reg = &mach->Outputs[index];
+      break;
+   case TGSI_FILE_SYSTEM_VALUE:
+      if (index >= TGSI_MAX_MISC_INPUTS)
+         return FALSE;
+      src->reg = &mach->SystemValue[index];
+      break;
+   case TGSI_FILE_IMMEDIATE:
+      if (index >= (int)mach->ImmLimit)
+         return FALSE;
+      src->imm = (const uint *)mach->Imms[index];
+      break;
+   case TGSI_FILE_CONSTANT:
+      src->const_buf = reg->Register.Dimension ? reg->Dimension.Index : 0;
+      if (src->const_buf >= PIPE_MAX_CONSTANT_BUFFERS)
+         return FALSE;
+      src->const_index = index;
+      break;
+   default:
+      return FALSE;
+   }
+
+   src->swizzle[0] = reg->Register.SwizzleX;
+   src->swizzle[1] = reg->Register.SwizzleY;
+   src->swizzle[2] = reg->Register.SwizzleZ;
+   src->swizzle[3] = reg->Register.SwizzleW;
+   src->abs = reg->Register.Absolute;
+   src->neg = reg->Register.Negate;
+   return TRUE;
+}
+
+static void
+decode_instruction(struct tgsi_exec_machine *mach,
+                   const struct tgsi_full_instruction *inst,
+                   struct tgsi_exec_op *op)
+{
+   const struct tgsi_full_dst_register *dst = &inst->Dst[0];
+   tgsi_exec_op_func func = get_op_func(inst->Instruction.Opcode);
+   uint i;
+
+   if (!func || inst->Instruction.NumDstRegs != 1)
+      return;
+
+   /* MOV applies the integer source modifiers. */
+   if (inst->Instruction.Opcode == TGSI_OPCODE_MOV &&
+       (inst->Src[0].Register.Absolute || inst->Src[0].Register.Negate))
+      return;
+
+   if (dst->Register.Indirect || dst->Register.Dimension ||
+       dst->Register.Index < 0)
+      return;
+
+   switch (dst->Register.File) {
+   case TGSI_FILE_TEMPORARY:
+      if (dst->Register.Index >= TGSI_EXEC_NUM_TEMPS)
+         return;
+      op->dst = &mach->Temps[dst->Register.Index];
+      break;
+   case TGSI_FILE_OUTPUT:
+      if (!mach->Outputs)
+         return;
+      op->dst_index = dst->Register.Index;
+      break;
+   default:
+      return;
+   }
+
+   for (i = 0; i < inst->Instruction.NumSrcRegs; i++) {
+      if (!decode_src(mach, &inst->Src[i], &op->src[i]))
+         return;
+   }
+
+   op->writemask = dst->Register.WriteMask;
+   op->saturate = inst->Instruction.Saturate;
+   op->func = func;
+}
+
+
+/**
+ * Decode the machine's instructions, for tgsi_exec_machine_run().
+ * Returns NULL if none of them could be.
+ */
+struct tgsi_exec_op *
+tgsi_exec_ops_decode(struct tgsi_exec_machine *mach)
+{
+   struct tgsi_exec_op *ops;
+   boolean any = FALSE;
+   uint i;
+
+   if (!mach->NumInstructions || debug_get_option_tgsi_no_predecode())
+      return NULL;
+
+   ops = CALLOC(mach->NumInstructions, sizeof(*ops));
+   if (!ops)
+      return NULL;
+
+   for (i = 0; i < mach->NumInstructions; i++) {
+      decode_instruction(mach, &mach->Instructions[i], &ops[i]);
+      any |= ops[i].func != NULL;
+   }
+
+   if (!any) {
+      FREE(ops);
+      return NULL;
+   }
+   return ops;
+}
@@ -0,0 +1,89 @@
+/**************************************************************************
+ *
+ * Copyright 2019 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Pre-decoded form of the common TGSI ALU instructions, used by the
+ * interpreter to skip operand decoding in its inner loop.
+ *
+ * Only instructions whose operands are all directly addressed registers
+ * are decoded.  Everything else is left to exec_instruction().
+ */
+
+#ifndef TGSI_EXEC_OPS_H
+#define TGSI_EXEC_OPS_H
+
+#include "pipe/p_compiler.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+struct tgsi_exec_machine;
+struct tgsi_exec_vector;
+struct tgsi_exec_op;
+
+typedef void (*tgsi_exec_op_func)(struct tgsi_exec_machine *mach,
+                                  const struct tgsi_exec_op *op);
+
+struct tgsi_exec_op_src
+{
+   /** TEMPORARY, INPUT, OUTPUT and SYSTEM_VALUE registers */
+   const struct tgsi_exec_vector *reg;
+   /** IMMEDIATE registers */
+   const uint *imm;
+   /** CONSTANT registers, when neither of the above is set */
+   int const_index;
+   ubyte const_buf;
+
+   ubyte swizzle[4];
+   boolean abs;
+   boolean neg;
+};
+
+struct tgsi_exec_op
+{
+   /** NULL to run the instruction with exec_instruction() */
+   tgsi_exec_op_func func;
+
+   /** TEMPORARY destination, or NULL for OUTPUT */
+   struct tgsi_exec_vector *dst;
+   /** OUTPUT index, before the geometry shader vertex offset */
+   int dst_index;
+   ubyte writemask;
+   boolean saturate;
+
+   struct tgsi_exec_op_src src[3];
+};
+
+struct tgsi_exec_op *
+tgsi_exec_ops_decode(struct tgsi_exec_machine *mach);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif /* TGSI_EXEC_OPS_H */
@@ -35,6 +35,10 @@
 
 struct translate_cache {
    struct cso_hash *hash;
+
+   /* lookups, and those returning the C fallback */
+   unsigned lookups;
+   unsigned generic_lookups;
 };
 
 struct translate_cache * translate_cache_create( void )
@@ -45,6 +49,8 @@ struct translate_cache * translate_cache_create( void )
    }
 
    cache->hash = cso_hash_create();
+   cache->lookups = 0;
+   cache->generic_lookups = 0;
    return cache;
 }
 
@@ -102,5 +108,18 @@ struct translate * translate_cache_find(struct translate_cache *cache,
       cso_hash_insert(cache->hash, hash_key, translate);
    }
 
+   cache->lookups++;
+   if (translate && translate_is_generic(translate))
+      cache->generic_lookups++;
+
    return translate;
 }
+
+
+void translate_cache_get_stats(const struct translate_cache *cache,
+                               unsigned *lookups,
+                               unsigned *generic_lookups)
+{
+   *lookups = cache->lookups;
+   *generic_lookups = cache->generic_lookups;
+}
@@ -51,4 +51,12 @@ void translate_cache_destroy(struct translate_cache *cache);
 struct translate *translate_cache_find(struct translate_cache *cache,
                                        struct translate_key *key);
 
+/**
+ * Returns the number of lookups so far, and how many of them returned
+ * the C fallback instead of generated code.
+ */
+void translate_cache_get_stats(const struct translate_cache *cache,
+                               unsigned *lookups,
+                               unsigned *generic_lookups);
+
 #endif
@@ -855,6 +855,15 @@ translate_generic_create(const struct translate_key *key)
    return &tg->translate;
 }
 
+/**
+ * Whether a translate is the C fallback rather than generated code.
+ */
+boolean
+translate_is_generic(const struct translate *translate)
+{
+   return translate->release == generic_release;
+}
+
 boolean
 translate_generic_is_output_format_supported(enum pipe_format format)
 {
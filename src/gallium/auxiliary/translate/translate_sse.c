@@ -64,7 +64,7 @@ struct translate_buffer_variant
 
 #define ELEMENT_BUFFER_INSTANCE_ID  1001
 
-#define NUM_CONSTS 7
+#define NUM_CONSTS 14
 
 enum
 {
@@ -74,22 +74,45 @@ enum
    CONST_INV_32767,
    CONST_INV_65535,
    CONST_INV_2147483647,
-   CONST_255
+   CONST_255,
+   CONST_NEG_ONE,
+   CONST_SCALE_1010102,
+   CONST_UNORM_1010102,
+   CONST_SNORM_1010102,
+   /* the integer constants follow the float ones */
+   CONST_MASK_1010102,
+   CONST_SIGN_1010102,
+   CONST_MASK_W
 };
 
+#define NUM_FLOAT_CONSTS CONST_MASK_1010102
+
 #define C(v) {(float)(v), (float)(v), (float)(v), (float)(v)}
-static float consts[NUM_CONSTS][4] = {
+static float consts[NUM_FLOAT_CONSTS][4] = {
    {0, 0, 0, 1},
    C(1.0 / 127.0),
    C(1.0 / 255.0),
    C(1.0 / 32767.0),
    C(1.0 / 65535.0),
    C(1.0 / 2147483647.0),
-   C(255.0)
+   C(255.0),
+   C(-1.0),
+   /* the x, y and z fields of 10_10_10_2 are converted in place */
+   {1.0, 1.0 / (1 << 10), 1.0 / (1 << 20), 1.0},
+   {1.0 / 1023.0, 1.0 / (1023.0 * (1 << 10)),
+    1.0 / (1023.0 * (1 << 20)), 1.0 / 3.0},
+   {1.0 / 511.0, 1.0 / (511.0 * (1 << 10)),
+    1.0 / (511.0 * (1 << 20)), 1.0}
 };
 
 #undef C
 
+static uint32_t int_consts[NUM_CONSTS - NUM_FLOAT_CONSTS][4] = {
+   {0x3ff, 0x3ff << 10, 0x3ff << 20, 0},
+   {0x200, 0x200 << 10, 0x200 << 20, 0},
+   {0, 0, 0, ~0u}
+};
+
 struct translate_sse
 {
    struct translate translate;
@@ -329,6 +352,87 @@ emit_load_float64to32(struct translate_sse *p, struct x86_reg data,
 }
 
 
+/* Compare two channels, except for their position. */
+static boolean
+same_channel_type(const struct util_format_channel_description *a,
+                  const struct util_format_channel_description *b)
+{
+   return a->type == b->type &&
+          a->normalized == b->normalized &&
+          a->pure_integer == b->pure_integer &&
+          a->size == b->size;
+}
+
+
+/* Check for the 10_10_10_2 layouts with all channels of the same type,
+ * stored from the lowest bits up.
+ */
+static boolean
+is_packed_1010102(const struct util_format_description *desc)
+{
+   unsigned i;
+
+   if (desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       desc->block.bits != 32 || desc->nr_channels != 4)
+      return FALSE;
+
+   for (i = 0; i < 4; ++i) {
+      if (desc->channel[i].size != (i < 3 ? 10 : 2) ||
+          desc->channel[i].shift != i * 10 ||
+          desc->channel[i].type != desc->channel[0].type ||
+          desc->channel[i].normalized != desc->channel[0].normalized ||
+          desc->channel[i].pure_integer)
+         return FALSE;
+   }
+
+   return desc->channel[0].type == UTIL_FORMAT_TYPE_UNSIGNED ||
+          desc->channel[0].type == UTIL_FORMAT_TYPE_SIGNED;
+}
+
+
+/* Load a 10_10_10_2 value and convert its four channels to floats.
+ *
+ * The dword is broadcast, and each lane keeps its own field in place, so
+ * the x, y and z fields end up scaled by 2^0, 2^10 and 2^20 which the
+ * final multiply takes out along with the normalization.  The w field
+ * reaches bit 31, so it is shifted down in a separate register.
+ */
+static void
+emit_load_1010102(struct translate_sse *p, struct x86_reg data,
+                  struct x86_reg src,
+                  const struct util_format_channel_description *chan)
+{
+   struct x86_reg tmpXMM = x86_make_reg(file_XMM, 1);
+   boolean is_signed = chan->type == UTIL_FORMAT_TYPE_SIGNED;
+
+   sse2_movd(p->func, data, src);
+   sse2_pshufd(p->func, data, data, SHUF(X, X, X, X));
+   sse_movaps(p->func, tmpXMM, data);
+   if (is_signed)
+      sse2_psrad_imm(p->func, tmpXMM, 30);
+   else
+      sse2_psrld_imm(p->func, tmpXMM, 30);
+   sse_andps(p->func, tmpXMM, get_const(p, CONST_MASK_W));
+   sse_andps(p->func, data, get_const(p, CONST_MASK_1010102));
+   if (is_signed) {
+      /* sign extend each field in place */
+      sse_xorps(p->func, data, get_const(p, CONST_SIGN_1010102));
+      sse2_psubd(p->func, data, get_const(p, CONST_SIGN_1010102));
+   }
+   sse_orps(p->func, data, tmpXMM);
+   sse2_cvtdq2ps(p->func, data, data);
+
+   if (!chan->normalized)
+      sse_mulps(p->func, data, get_const(p, CONST_SCALE_1010102));
+   else if (!is_signed)
+      sse_mulps(p->func, data, get_const(p, CONST_UNORM_1010102));
+   else {
+      sse_mulps(p->func, data, get_const(p, CONST_SNORM_1010102));
+      sse_maxps(p->func, data, get_const(p, CONST_NEG_ONE));
+   }
+}
+
+
 static void
 emit_mov64(struct translate_sse *p, struct x86_reg dst_gpr,
            struct x86_reg dst_xmm, struct x86_reg src_gpr,
@@ -471,28 +575,29 @@ translate_attr_convert(struct translate_sse *p,
         PIPE_SWIZZLE_NONE, PIPE_SWIZZLE_NONE };
    unsigned needed_chans = 0;
    unsigned imms[2] = { 0, 0x3f800000 };
+   boolean packed_1010102;
 
    if (a->output_format == PIPE_FORMAT_NONE
        || a->input_format == PIPE_FORMAT_NONE)
       return FALSE;
 
-   if (input_desc->channel[0].size & 7)
+   packed_1010102 = is_packed_1010102(input_desc);
+
+   if ((input_desc->channel[0].size & 7) && !packed_1010102)
       return FALSE;
 
    if (input_desc->colorspace != output_desc->colorspace)
       return FALSE;
 
-   for (i = 1; i < input_desc->nr_channels; ++i) {
-      if (memcmp
-          (&input_desc->channel[i], &input_desc->channel[0],
-           sizeof(input_desc->channel[0])))
+   for (i = 1; i < input_desc->nr_channels && !packed_1010102; ++i) {
+      if (!same_channel_type(&input_desc->channel[i],
+                             &input_desc->channel[0]))
          return FALSE;
    }
 
    for (i = 1; i < output_desc->nr_channels; ++i) {
-      if (memcmp
-          (&output_desc->channel[i], &output_desc->channel[0],
-           sizeof(output_desc->channel[0]))) {
+      if (!same_channel_type(&output_desc->channel[i],
+                             &output_desc->channel[0])) {
          return FALSE;
       }
    }
@@ -527,6 +632,10 @@ translate_attr_convert(struct translate_sse *p,
          case UTIL_FORMAT_TYPE_UNSIGNED:
             if (!(x86_target_caps(p->func) & X86_SSE2))
                return FALSE;
+            if (packed_1010102) {
+               emit_load_1010102(p, dataXMM, src, &input_desc->channel[0]);
+               break;
+            }
             emit_load_sse2(p, dataXMM, src,
                            input_desc->channel[0].size *
                            input_desc->nr_channels >> 3);
@@ -579,6 +688,10 @@ translate_attr_convert(struct translate_sse *p,
          case UTIL_FORMAT_TYPE_SIGNED:
             if (!(x86_target_caps(p->func) & X86_SSE2))
                return FALSE;
+            if (packed_1010102) {
+               emit_load_1010102(p, dataXMM, src, &input_desc->channel[0]);
+               break;
+            }
             emit_load_sse2(p, dataXMM, src,
                            input_desc->channel[0].size *
                            input_desc->nr_channels >> 3);
@@ -627,7 +740,9 @@ translate_attr_convert(struct translate_sse *p,
             break;
          case UTIL_FORMAT_TYPE_FLOAT:
             if (input_desc->channel[0].size != 32
-                && input_desc->channel[0].size != 64) {
+                && input_desc->channel[0].size != 64
+                && !(input_desc->channel[0].size == 16
+                     && (x86_target_caps(p->func) & X86_F16C))) {
                return FALSE;
             }
             if (swizzle[3] == PIPE_SWIZZLE_1
@@ -646,6 +761,13 @@ translate_attr_convert(struct translate_sse *p,
                emit_load_float64to32(p, dataXMM, src, needed_chans,
                                      input_desc->nr_channels);
                break;
+            case 16:
+               /* the missing channels are loaded as zeros */
+               emit_load_sse2(p, dataXMM, src, input_desc->nr_channels * 2);
+               f16c_vcvtph2ps(p->func, dataXMM, dataXMM);
+               if (needed_chans == CHANNELS_0001)
+                  sse_orps(p->func, dataXMM, get_const(p, CONST_IDENTITY));
+               break;
             default:
                return FALSE;
             }
@@ -1491,6 +1613,7 @@ translate_sse2_create(const struct translate_key *key)
 
    memset(p, 0, sizeof(*p));
    memcpy(p->consts, consts, sizeof(consts));
+   memcpy(p->consts[NUM_FLOAT_CONSTS], int_consts, sizeof(int_consts));
 
    p->translate.key = *key;
    p->translate.release = translate_sse_release;
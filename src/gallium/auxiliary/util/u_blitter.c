@@ -616,6 +616,10 @@ void util_blitter_restore_vertex_states(struct blitter_context *blitter)
    struct pipe_context *pipe = ctx->base.pipe;
    unsigned i;
 
+   /* Batches restore everything at the end. */
+   if (blitter->batch_depth)
+      return;
+
    /* Vertex buffer. */
    if (ctx->base.saved_vertex_buffer.buffer.resource) {
       pipe->set_vertex_buffers(pipe, ctx->base.vb_slot, 1,
@@ -678,6 +682,9 @@ void util_blitter_restore_fragment_states(struct blitter_context *blitter)
    struct blitter_context_priv *ctx = (struct blitter_context_priv*)blitter;
    struct pipe_context *pipe = ctx->base.pipe;
 
+   if (blitter->batch_depth)
+      return;
+
    /* Fragment shader. */
    ctx->bind_fs_state(pipe, ctx->base.saved_fs);
    ctx->base.saved_fs = INVALID_PTR;
@@ -731,6 +738,9 @@ void util_blitter_restore_render_cond(struct blitter_context *blitter)
    struct blitter_context_priv *ctx = (struct blitter_context_priv*)blitter;
    struct pipe_context *pipe = ctx->base.pipe;
 
+   if (blitter->batch_depth)
+      return;
+
    if (ctx->base.saved_render_cond_query) {
       pipe->render_condition(pipe, ctx->base.saved_render_cond_query,
                              ctx->base.saved_render_cond_cond,
@@ -744,6 +754,9 @@ void util_blitter_restore_fb_state(struct blitter_context *blitter)
    struct blitter_context_priv *ctx = (struct blitter_context_priv*)blitter;
    struct pipe_context *pipe = ctx->base.pipe;
 
+   if (blitter->batch_depth)
+      return;
+
    pipe->set_framebuffer_state(pipe, &ctx->base.saved_fb_state);
    util_unreference_framebuffer_state(&ctx->base.saved_fb_state);
 }
@@ -760,6 +773,9 @@ void util_blitter_restore_textures(struct blitter_context *blitter)
    struct pipe_context *pipe = ctx->base.pipe;
    unsigned i;
 
+   if (blitter->batch_depth)
+      return;
+
    /* Fragment sampler states. */
    pipe->bind_sampler_states(pipe, PIPE_SHADER_FRAGMENT, 0,
                              ctx->base.saved_num_sampler_states,
@@ -782,11 +798,63 @@ void util_blitter_restore_constant_buffer_state(struct blitter_context *blitter)
 {
    struct pipe_context *pipe = blitter->pipe;
 
+   if (blitter->batch_depth)
+      return;
+
    pipe->set_constant_buffer(pipe, PIPE_SHADER_FRAGMENT, blitter->cb_slot,
                             &blitter->saved_fs_constant_buffer);
    pipe_resource_reference(&blitter->saved_fs_constant_buffer.buffer, NULL);
 }
 
+void util_blitter_begin_batch(struct blitter_context *blitter)
+{
+   if (!blitter->batch_depth++)
+      blitter->batch_saved = 0;
+}
+
+void util_blitter_end_batch(struct blitter_context *blitter)
+{
+   unsigned saved;
+
+   assert(blitter->batch_depth);
+   if (--blitter->batch_depth)
+      return;
+
+   saved = blitter->batch_saved;
+   if (!saved)
+      return;
+
+   /* Restore like at the end of a blitter operation. */
+   util_blitter_set_running_flag(blitter);
+   if (saved & (UTIL_BLITTER_SAVED_VELEM |
+                UTIL_BLITTER_SAVED_RS |
+                UTIL_BLITTER_SAVED_VS |
+                UTIL_BLITTER_SAVED_GS |
+                UTIL_BLITTER_SAVED_TCS |
+                UTIL_BLITTER_SAVED_TES |
+                UTIL_BLITTER_SAVED_VERTEX_BUFFER |
+                UTIL_BLITTER_SAVED_SO_TARGETS))
+      util_blitter_restore_vertex_states(blitter);
+   if (saved & (UTIL_BLITTER_SAVED_BLEND |
+                UTIL_BLITTER_SAVED_DSA |
+                UTIL_BLITTER_SAVED_FS |
+                UTIL_BLITTER_SAVED_STENCIL_REF |
+                UTIL_BLITTER_SAVED_VIEWPORT |
+                UTIL_BLITTER_SAVED_SCISSOR |
+                UTIL_BLITTER_SAVED_SAMPLE_MASK |
+                UTIL_BLITTER_SAVED_WINDOW_RECTS))
+      util_blitter_restore_fragment_states(blitter);
+   if (saved & (UTIL_BLITTER_SAVED_SAMPLER_STATES |
+                UTIL_BLITTER_SAVED_SAMPLER_VIEWS))
+      util_blitter_restore_textures(blitter);
+   if (saved & UTIL_BLITTER_SAVED_FB)
+      util_blitter_restore_fb_state(blitter);
+   if (saved & UTIL_BLITTER_SAVED_CONSTANT_BUFFER)
+      util_blitter_restore_constant_buffer_state(blitter);
+   util_blitter_restore_render_cond(blitter);
+   util_blitter_unset_running_flag(blitter);
+}
+
 static void blitter_set_rectangle(struct blitter_context_priv *ctx,
                                   int x1, int y1, int x2, int y2,
                                   float depth)
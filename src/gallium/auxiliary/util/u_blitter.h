@@ -55,6 +55,31 @@ union blitter_attrib {
 
 struct blitter_context;
 
+/* Bits of blitter_context::batch_saved, one per util_blitter_save_*. */
+enum {
+   UTIL_BLITTER_SAVED_BLEND            = 1 << 0,
+   UTIL_BLITTER_SAVED_DSA              = 1 << 1,
+   UTIL_BLITTER_SAVED_VELEM            = 1 << 2,
+   UTIL_BLITTER_SAVED_STENCIL_REF      = 1 << 3,
+   UTIL_BLITTER_SAVED_RS               = 1 << 4,
+   UTIL_BLITTER_SAVED_FS               = 1 << 5,
+   UTIL_BLITTER_SAVED_VS               = 1 << 6,
+   UTIL_BLITTER_SAVED_GS               = 1 << 7,
+   UTIL_BLITTER_SAVED_TCS              = 1 << 8,
+   UTIL_BLITTER_SAVED_TES              = 1 << 9,
+   UTIL_BLITTER_SAVED_FB               = 1 << 10,
+   UTIL_BLITTER_SAVED_VIEWPORT         = 1 << 11,
+   UTIL_BLITTER_SAVED_SCISSOR          = 1 << 12,
+   UTIL_BLITTER_SAVED_SAMPLER_STATES   = 1 << 13,
+   UTIL_BLITTER_SAVED_SAMPLER_VIEWS    = 1 << 14,
+   UTIL_BLITTER_SAVED_CONSTANT_BUFFER  = 1 << 15,
+   UTIL_BLITTER_SAVED_VERTEX_BUFFER    = 1 << 16,
+   UTIL_BLITTER_SAVED_SO_TARGETS       = 1 << 17,
+   UTIL_BLITTER_SAVED_SAMPLE_MASK      = 1 << 18,
+   UTIL_BLITTER_SAVED_RENDER_COND      = 1 << 19,
+   UTIL_BLITTER_SAVED_WINDOW_RECTS     = 1 << 20,
+};
+
 typedef void *(*blitter_get_vs_func)(struct blitter_context *blitter);
 
 struct blitter_context
@@ -100,6 +125,11 @@ struct blitter_context
    /* Whether the blitter is running. */
    bool running;
 
+   /* Nesting depth of util_blitter_begin_batch, and the states saved since
+    * the outermost call (UTIL_BLITTER_SAVED_*). */
+   unsigned batch_depth;
+   unsigned batch_saved;
+
    bool use_index_buffer;
 
    /* Private members, really. */
@@ -405,11 +435,29 @@ void util_blitter_custom_shader(struct blitter_context *blitter,
  * of the util_blitter_{clear, copy_region, fill_region} functions and then
  * forgotten.
  *
+ * Inside util_blitter_begin_batch/end_batch, only the first save of each
+ * state is kept, because later ones would see the blitter's own states.
+ *
  * States not listed here are not affected by util_blitter. */
 
+static inline bool
+util_blitter_skip_save(struct blitter_context *blitter, unsigned state)
+{
+   if (!blitter->batch_depth)
+      return false;
+   if (blitter->batch_saved & state)
+      return true;
+
+   blitter->batch_saved |= state;
+   return false;
+}
+
 static inline void
 util_blitter_save_blend(struct blitter_context *blitter, void *state)
 {
+   if (util_blitter_skip_save(blitter, UTIL_BLITTER_SAVED_BLEND))
+      return;
+
    blitter->saved_blend_state = state;
 }
 
@@ -417,12 +465,18 @@ static inline void
 util_blitter_save_depth_stencil_alpha(struct blitter_context *blitter,
                                       void *state)
 {
+   if (util_blitter_skip_save(blitter, UTIL_BLITTER_SAVED_DSA))
+      return;
+
    blitter->saved_dsa_state = state;
 }
 
 static inline void
 util_blitter_save_vertex_elements(struct blitter_context *blitter, void *state)
 {
+   if (util_blitter_skip_save(blitter, UTIL_BLITTER_SAVED_VELEM))
+      return;
+
    blitter->saved_velem_state = state;
 }
 
@@ -430,30 +484,45 @@ static inline void
 util_blitter_save_stencil_ref(struct blitter_context *blitter,
                               const struct pipe_stencil_ref *state)
 {
+   if (util_blitter_skip_save(blitter, UTIL_BLITTER_SAVED_STENCIL_REF))
+      return;
+
    blitter->saved_stencil_ref = *state;
 }
 
 static inline void
 util_blitter_save_rasterizer(struct blitter_context *blitter, void *state)
 {
+   if (util_blitter_skip_save(blitter, UTIL_BLITTER_SAVED_RS))
+      return;
+
    blitter->saved_rs_state = state;
 }
 
 static inline void
 util_blitter_save_fragment_shader(struct blitter_context *blitter, void *fs)
 {
+   if (util_blitter_skip_save(blitter, UTIL_BLITTER_SAVED_FS))
+      return;
+
    blitter->saved_fs = fs;
 }
 
 static inline void
 util_blitter_save_vertex_shader(struct blitter_context *blitter, void *vs)
 {
+   if (util_blitter_skip_save(blitter, UTIL_BLITTER_SAVED_VS))
+      return;
+
    blitter->saved_vs = vs;
 }
 
 static inline void
 util_blitter_save_geometry_shader(struct blitter_context *blitter, void *gs)
 {
+   if (util_blitter_skip_save(blitter, UTIL_BLITTER_SAVED_GS))
+      return;
+
    blitter->saved_gs = gs;
 }
 
@@ -461,6 +530,9 @@ static inline void
 util_blitter_save_tessctrl_shader(struct blitter_context *blitter,
                                   void *sh)
 {
+   if (util_blitter_skip_save(blitter, UTIL_BLITTER_SAVED_TCS))
+      return;
+
    blitter->saved_tcs = sh;
 }
 
@@ -468,6 +540,9 @@ static inline void
 util_blitter_save_tesseval_shader(struct blitter_context *blitter,
                                   void *sh)
 {
+   if (util_blitter_skip_save(blitter, UTIL_BLITTER_SAVED_TES))
+      return;
+
    blitter->saved_tes = sh;
 }
 
@@ -475,6 +550,9 @@ static inline void
 util_blitter_save_framebuffer(struct blitter_context *blitter,
                               const struct pipe_framebuffer_state *state)
 {
+   if (util_blitter_skip_save(blitter, UTIL_BLITTER_SAVED_FB))
+      return;
+
    blitter->saved_fb_state.nr_cbufs = 0; /* It's ~0 now, meaning it's unsaved. */
    util_copy_framebuffer_state(&blitter->saved_fb_state, state);
 }
@@ -483,6 +561,9 @@ static inline void
 util_blitter_save_viewport(struct blitter_context *blitter,
                            struct pipe_viewport_state *state)
 {
+   if (util_blitter_skip_save(blitter, UTIL_BLITTER_SAVED_VIEWPORT))
+      return;
+
    blitter->saved_viewport = *state;
 }
 
@@ -490,6 +571,9 @@ static inline void
 util_blitter_save_scissor(struct blitter_context *blitter,
                           struct pipe_scissor_state *state)
 {
+   if (util_blitter_skip_save(blitter, UTIL_BLITTER_SAVED_SCISSOR))
+      return;
+
    blitter->saved_scissor = *state;
 }
 
@@ -499,6 +583,9 @@ util_blitter_save_fragment_sampler_states(
                   unsigned num_sampler_states,
                   void **sampler_states)
 {
+   if (util_blitter_skip_save(blitter, UTIL_BLITTER_SAVED_SAMPLER_STATES))
+      return;
+
    assert(num_sampler_states <= ARRAY_SIZE(blitter->saved_sampler_states));
 
    blitter->saved_num_sampler_states = num_sampler_states;
@@ -512,6 +599,9 @@ util_blitter_save_fragment_sampler_views(struct blitter_context *blitter,
                                          struct pipe_sampler_view **views)
 {
    unsigned i;
+
+   if (util_blitter_skip_save(blitter, UTIL_BLITTER_SAVED_SAMPLER_VIEWS))
+      return;
    assert(num_views <= ARRAY_SIZE(blitter->saved_sampler_views));
 
    blitter->saved_num_sampler_views = num_views;
@@ -525,6 +615,9 @@ util_blitter_save_fragment_constant_buffer_slot(
                   struct blitter_context *blitter,
                   struct pipe_constant_buffer *constant_buffers)
 {
+   if (util_blitter_skip_save(blitter, UTIL_BLITTER_SAVED_CONSTANT_BUFFER))
+      return;
+
    pipe_resource_reference(&blitter->saved_fs_constant_buffer.buffer,
                            constant_buffers[blitter->cb_slot].buffer);
    memcpy(&blitter->saved_fs_constant_buffer, &constant_buffers[blitter->cb_slot],
@@ -535,6 +628,9 @@ static inline void
 util_blitter_save_vertex_buffer_slot(struct blitter_context *blitter,
                                      struct pipe_vertex_buffer *vertex_buffers)
 {
+   if (util_blitter_skip_save(blitter, UTIL_BLITTER_SAVED_VERTEX_BUFFER))
+      return;
+
    pipe_vertex_buffer_reference(&blitter->saved_vertex_buffer,
                                 &vertex_buffers[blitter->vb_slot]);
 }
@@ -545,6 +641,9 @@ util_blitter_save_so_targets(struct blitter_context *blitter,
                              struct pipe_stream_output_target **targets)
 {
    unsigned i;
+
+   if (util_blitter_skip_save(blitter, UTIL_BLITTER_SAVED_SO_TARGETS))
+      return;
    assert(num_targets <= ARRAY_SIZE(blitter->saved_so_targets));
 
    blitter->saved_num_so_targets = num_targets;
@@ -557,6 +656,9 @@ static inline void
 util_blitter_save_sample_mask(struct blitter_context *blitter,
                               unsigned sample_mask)
 {
+   if (util_blitter_skip_save(blitter, UTIL_BLITTER_SAVED_SAMPLE_MASK))
+      return;
+
    blitter->is_sample_mask_saved = true;
    blitter->saved_sample_mask = sample_mask;
 }
@@ -567,6 +669,9 @@ util_blitter_save_render_condition(struct blitter_context *blitter,
                                    bool condition,
                                    enum pipe_render_cond_flag mode)
 {
+   if (util_blitter_skip_save(blitter, UTIL_BLITTER_SAVED_RENDER_COND))
+      return;
+
    blitter->saved_render_cond_query = query;
    blitter->saved_render_cond_mode = mode;
    blitter->saved_render_cond_cond = condition;
@@ -578,6 +683,9 @@ util_blitter_save_window_rectangles(struct blitter_context *blitter,
                                     unsigned num_rectangles,
                                     const struct pipe_scissor_state *rects)
 {
+   if (util_blitter_skip_save(blitter, UTIL_BLITTER_SAVED_WINDOW_RECTS))
+      return;
+
    blitter->saved_window_rectangles_include = include;
    blitter->saved_num_window_rectangles = num_rectangles;
    if (num_rectangles > 0) {
@@ -602,6 +710,17 @@ void util_blitter_restore_fb_state(struct blitter_context *blitter);
 void util_blitter_restore_textures(struct blitter_context *blitter);
 void util_blitter_restore_constant_buffer_state(struct blitter_context *blitter);
 
+/**
+ * Batch the blitter operations until the matching util_blitter_end_batch.
+ *
+ * The states saved by the driver before the first operation are restored
+ * once at the end instead of after each operation, and the blitter's states
+ * stay bound from one operation to the next.  Nothing but blitter
+ * operations may be issued in between, and calls may be nested.
+ */
+void util_blitter_begin_batch(struct blitter_context *blitter);
+void util_blitter_end_batch(struct blitter_context *blitter);
+
 /* These are supported combinations of blits from ZS to color and vice versa.
  * The blitter will do the packing/unpacking of depth and stencil
  * in the fragment shader.
@@ -619,6 +619,62 @@ def generate_pack_kernel(format, src_channel, src_native_type):
         print_channels(format, pack_into_struct)
 
 
+def is_format_4x8unorm(format):
+    '''Whether the format has four 8 bit unorm (or padding) channels in a
+    32 bit pixel, so that converting it to/from RGBA8 is a byte shuffle.'''
+
+    if format.layout != PLAIN or format.colorspace != RGB:
+        return False
+    if format.block_width != 1 or format.block_height != 1 or format.block_size() != 32:
+        return False
+    for channel in format.le_channels:
+        if channel.size != 8:
+            return False
+        if channel.type != VOID and (channel.type != UNSIGNED or not channel.norm or channel.pure):
+            return False
+    return True
+
+
+def generate_format_shuffle(format):
+    '''Generate the pshufb controls to go to/from RGBA8 for a 4x8 unorm format.
+
+    Only the little endian layout is described, as the kernels using these
+    are x86 only and return FALSE everywhere else.'''
+
+    name = format.short_name()
+    channels = format.le_channels
+    swizzles = format.le_swizzles
+
+    unpack = []
+    or_mask = 0
+    for i in range(4):
+        swizzle = swizzles[i]
+        if swizzle < 4:
+            unpack.append(channels[swizzle].shift // 8)
+        else:
+            unpack.append(0x80)
+            if swizzle == SWIZZLE_1:
+                or_mask |= 0xff << (8 * i)
+
+    pack = [0x80]*4
+    inv_swizzle = inv_swizzles(swizzles)
+    for j in range(4):
+        if channels[j].type != VOID and inv_swizzle[j] is not None:
+            pack[channels[j].shift // 8] = inv_swizzle[j]
+
+    def print_shuffle(kind, shuffle, or_mask):
+        shuffle = [s if s & 0x80 else s + 4*p for p in range(4) for s in shuffle]
+        print('static const struct util_format_shuffle_4x8')
+        print('util_format_%s_%s_shuffle = {' % (name, kind))
+        print('   { %s },' % ', '.join(['0x%02x' % s for s in shuffle]))
+        print('   0x%08x' % or_mask)
+        print('};')
+        print()
+
+    print_shuffle('unpack', unpack, or_mask)
+    print_shuffle('pack', pack, 0)
+
+
 def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
     '''Generate the function to unpack pixels from a particular format'''
 
@@ -630,6 +686,10 @@ def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
 
     if is_format_supported(format):
         print('   unsigned x, y;')
+        if is_format_4x8unorm(format) and dst_suffix in ('rgba_8unorm', 'rgba_float'):
+            kernel = 'shuffle_4x8' if dst_suffix == 'rgba_8unorm' else 'unpack_4x8unorm_float'
+            print('   if (util_format_%s_rows(dst_row, dst_stride, src_row, src_stride, width, height, &util_format_%s_unpack_shuffle))' % (kernel, name))
+            print('      return;')
         print('   for(y = 0; y < height; y += %u) {' % (format.block_height,))
         print('      %s *dst = dst_row;' % (dst_native_type))
         print('      const uint8_t *src = src_row;')
@@ -659,6 +719,10 @@ def generate_format_pack(format, src_channel, src_native_type, src_suffix):
     
     if is_format_supported(format):
         print('   unsigned x, y;')
+        if is_format_4x8unorm(format) and src_suffix in ('rgba_8unorm', 'rgba_float'):
+            kernel = 'shuffle_4x8' if src_suffix == 'rgba_8unorm' else 'pack_4x8unorm_float'
+            print('   if (util_format_%s_rows(dst_row, dst_stride, src_row, src_stride, width, height, &util_format_%s_pack_shuffle))' % (kernel, name))
+            print('      return;')
         print('   for(y = 0; y < height; y += %u) {' % (format.block_height,))
         print('      const %s *src = src_row;' % (src_native_type))
         print('      uint8_t *dst = dst_row;')
@@ -707,6 +771,7 @@ def generate(formats):
     print('#include "util/format_srgb.h"')
     print('#include "u_format_yuv.h"')
     print('#include "u_format_zs.h"')
+    print('#include "u_format_simd.h"')
     print()
 
     for format in formats:
@@ -715,6 +780,9 @@ def generate(formats):
             if is_format_supported(format) and not format.is_bitmask():
                 generate_format_type(format)
 
+            if is_format_4x8unorm(format):
+                generate_format_shuffle(format)
+
             if format.is_pure_unsigned():
                 native_type = 'unsigned'
                 suffix = 'unsigned'
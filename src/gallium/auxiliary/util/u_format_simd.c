@@ -0,0 +1,290 @@
+/**************************************************************************
+ *
+ * Copyright 2019 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDERS, AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * SIMD row kernels for formats with four 8 bit unorm channels.
+ *
+ * The generated pack/unpack functions of such formats call these first and
+ * only fall back to their per-pixel code when they return FALSE, i.e. when
+ * the CPU lacks the needed instructions.  Converting between two such
+ * layouts is a single byte shuffle, which pshufb does for four pixels.
+ * The conversions to and from floats do exactly the same arithmetic as
+ * ubyte_to_float() and float_to_ubyte(), so results are bit identical.
+ *
+ * Only little endian layouts are handled, which is all SSSE3 CPUs are.
+ */
+
+
+#include "pipe/p_config.h"
+#include "util/u_debug.h"
+#include "util/u_math.h"
+#include "util/u_cpu_detect.h"
+
+#include "u_format_simd.h"
+
+#if defined(PIPE_ARCH_SSE)
+
+#include <emmintrin.h>
+
+#if defined(__SSSE3__) || !defined(__GNUC__)
+
+#include <tmmintrin.h>
+
+#define pshufb(a, mask) _mm_shuffle_epi8(a, mask)
+
+#else
+
+/*
+ * The file is not built with -mssse3, so the intrinsic can't be inlined
+ * here; emit the instruction directly.  It only runs after checking
+ * util_cpu_caps.has_ssse3.
+ */
+static inline __m128i
+pshufb(__m128i a, __m128i mask)
+{
+   __m128i result;
+   __asm__("pshufb %1, %0"
+           : "=x" (result)
+           : "xm" (mask), "0" (a));
+   return result;
+}
+
+#endif
+
+
+/**
+ * Shuffle a single pixel, for the remainder of a row.
+ */
+static inline void
+shuffle_pixel(uint8_t *dst, const uint8_t *src,
+              const struct util_format_shuffle_4x8 *shuffle)
+{
+   unsigned i;
+
+   for (i = 0; i < 4; i++) {
+      const uint8_t sel = shuffle->shuffle[i];
+      dst[i] = ((sel & 0x80) ? 0 : src[sel]) | (shuffle->or_mask >> (8 * i));
+   }
+}
+
+
+boolean
+util_format_shuffle_4x8_rows(uint8_t *dst_row, unsigned dst_stride,
+                             const uint8_t *src_row, unsigned src_stride,
+                             unsigned width, unsigned height,
+                             const struct util_format_shuffle_4x8 *shuffle)
+{
+   const __m128i ctl = _mm_loadu_si128((const __m128i *)shuffle->shuffle);
+   const __m128i or_mask = _mm_set1_epi32(shuffle->or_mask);
+   unsigned x, y;
+
+   if (!util_cpu_caps.has_ssse3)
+      return FALSE;
+
+   for (y = 0; y < height; y++) {
+      uint8_t *dst = dst_row;
+      const uint8_t *src = src_row;
+
+      for (x = 0; x + 4 <= width; x += 4) {
+         __m128i pixels = _mm_loadu_si128((const __m128i *)src);
+         pixels = _mm_or_si128(pshufb(pixels, ctl), or_mask);
+         _mm_storeu_si128((__m128i *)dst, pixels);
+         src += 16;
+         dst += 16;
+      }
+      for (; x < width; x++) {
+         shuffle_pixel(dst, src, shuffle);
+         src += 4;
+         dst += 4;
+      }
+
+      dst_row += dst_stride;
+      src_row += src_stride;
+   }
+
+   return TRUE;
+}
+
+
+boolean
+util_format_unpack_4x8unorm_float_rows(float *dst_row, unsigned dst_stride,
+                                       const uint8_t *src_row, unsigned src_stride,
+                                       unsigned width, unsigned height,
+                                       const struct util_format_shuffle_4x8 *shuffle)
+{
+   const __m128i ctl = _mm_loadu_si128((const __m128i *)shuffle->shuffle);
+   const __m128i or_mask = _mm_set1_epi32(shuffle->or_mask);
+   const __m128i zero = _mm_setzero_si128();
+   const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+   unsigned x, y, i;
+
+   if (!util_cpu_caps.has_ssse3)
+      return FALSE;
+
+   for (y = 0; y < height; y++) {
+      float *dst = dst_row;
+      const uint8_t *src = src_row;
+
+      for (x = 0; x + 4 <= width; x += 4) {
+         __m128i pixels = _mm_loadu_si128((const __m128i *)src);
+         __m128i lo, hi;
+
+         pixels = _mm_or_si128(pshufb(pixels, ctl), or_mask);
+         lo = _mm_unpacklo_epi8(pixels, zero);
+         hi = _mm_unpackhi_epi8(pixels, zero);
+
+         _mm_storeu_ps(dst + 0, _mm_mul_ps(_mm_cvtepi32_ps(
+                          _mm_unpacklo_epi16(lo, zero)), scale));
+         _mm_storeu_ps(dst + 4, _mm_mul_ps(_mm_cvtepi32_ps(
+                          _mm_unpackhi_epi16(lo, zero)), scale));
+         _mm_storeu_ps(dst + 8, _mm_mul_ps(_mm_cvtepi32_ps(
+                          _mm_unpacklo_epi16(hi, zero)), scale));
+         _mm_storeu_ps(dst + 12, _mm_mul_ps(_mm_cvtepi32_ps(
+                          _mm_unpackhi_epi16(hi, zero)), scale));
+         src += 16;
+         dst += 16;
+      }
+      for (; x < width; x++) {
+         uint8_t rgba[4];
+
+         shuffle_pixel(rgba, src, shuffle);
+         for (i = 0; i < 4; i++)
+            dst[i] = ubyte_to_float(rgba[i]);
+         src += 4;
+         dst += 4;
+      }
+
+      dst_row += dst_stride / sizeof(*dst_row);
+      src_row += src_stride;
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * float_to_ubyte() of four floats, in the low byte of each dword.
+ * Clamping with max before min turns NaNs into zero, like the scalar code.
+ */
+static inline __m128i
+float_to_ubyte_4(__m128 value)
+{
+   const __m128 zero = _mm_setzero_ps();
+   const __m128 one = _mm_set1_ps(1.0f);
+   const __m128 scale = _mm_set1_ps(255.0f / 256.0f);
+   const __m128 magic = _mm_set1_ps(32768.0f);
+
+   value = _mm_min_ps(_mm_max_ps(value, zero), one);
+   value = _mm_add_ps(_mm_mul_ps(value, scale), magic);
+   return _mm_and_si128(_mm_castps_si128(value), _mm_set1_epi32(0xff));
+}
+
+
+boolean
+util_format_pack_4x8unorm_float_rows(uint8_t *dst_row, unsigned dst_stride,
+                                     const float *src_row, unsigned src_stride,
+                                     unsigned width, unsigned height,
+                                     const struct util_format_shuffle_4x8 *shuffle)
+{
+   const __m128i ctl = _mm_loadu_si128((const __m128i *)shuffle->shuffle);
+   const __m128i or_mask = _mm_set1_epi32(shuffle->or_mask);
+   unsigned x, y, i;
+
+   if (!util_cpu_caps.has_ssse3)
+      return FALSE;
+
+   for (y = 0; y < height; y++) {
+      uint8_t *dst = dst_row;
+      const float *src = src_row;
+
+      for (x = 0; x + 4 <= width; x += 4) {
+         __m128i p0 = float_to_ubyte_4(_mm_loadu_ps(src + 0));
+         __m128i p1 = float_to_ubyte_4(_mm_loadu_ps(src + 4));
+         __m128i p2 = float_to_ubyte_4(_mm_loadu_ps(src + 8));
+         __m128i p3 = float_to_ubyte_4(_mm_loadu_ps(src + 12));
+         __m128i pixels = _mm_packus_epi16(_mm_packs_epi32(p0, p1),
+                                           _mm_packs_epi32(p2, p3));
+
+         pixels = _mm_or_si128(pshufb(pixels, ctl), or_mask);
+         _mm_storeu_si128((__m128i *)dst, pixels);
+         src += 16;
+         dst += 16;
+      }
+      for (; x < width; x++) {
+         uint8_t rgba[4];
+
+         for (i = 0; i < 4; i++)
+            rgba[i] = float_to_ubyte(src[i]);
+         shuffle_pixel(dst, rgba, shuffle);
+         src += 4;
+         dst += 4;
+      }
+
+      dst_row += dst_stride;
+      src_row += src_stride / sizeof(*src_row);
+   }
+
+   return TRUE;
+}
+
+
+#else /* !PIPE_ARCH_SSE */
+
+
+boolean
+util_format_shuffle_4x8_rows(uint8_t *dst_row, unsigned dst_stride,
+                             const uint8_t *src_row, unsigned src_stride,
+                             unsigned width, unsigned height,
+                             const struct util_format_shuffle_4x8 *shuffle)
+{
+   return FALSE;
+}
+
+
+boolean
+util_format_unpack_4x8unorm_float_rows(float *dst_row, unsigned dst_stride,
+                                       const uint8_t *src_row, unsigned src_stride,
+                                       unsigned width, unsigned height,
+                                       const struct util_format_shuffle_4x8 *shuffle)
+{
+   return FALSE;
+}
+
+
+boolean
+util_format_pack_4x8unorm_float_rows(uint8_t *dst_row, unsigned dst_stride,
+                                     const float *src_row, unsigned src_stride,
+                                     unsigned width, unsigned height,
+                                     const struct util_format_shuffle_4x8 *shuffle)
+{
+   return FALSE;
+}
+
+
+#endif /* !PIPE_ARCH_SSE */
@@ -0,0 +1,85 @@
+/**************************************************************************
+ *
+ * Copyright 2019 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDERS, AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * SIMD row kernels for the pack/unpack functions of formats with four
+ * 8 bit channels, used by the code generated by u_format_pack.py.
+ */
+
+
+#ifndef U_FORMAT_SIMD_H_
+#define U_FORMAT_SIMD_H_
+
+
+#include "pipe/p_compiler.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * Byte shuffle from one 32 bit per pixel layout into another, for four
+ * pixels at a time.
+ */
+struct util_format_shuffle_4x8
+{
+   /** pshufb control, 0x80 selects a zero byte */
+   uint8_t shuffle[16];
+   /** bits to set in every destination pixel */
+   uint32_t or_mask;
+};
+
+
+boolean
+util_format_shuffle_4x8_rows(uint8_t *dst_row, unsigned dst_stride,
+                             const uint8_t *src_row, unsigned src_stride,
+                             unsigned width, unsigned height,
+                             const struct util_format_shuffle_4x8 *shuffle);
+
+boolean
+util_format_unpack_4x8unorm_float_rows(float *dst_row, unsigned dst_stride,
+                                       const uint8_t *src_row, unsigned src_stride,
+                                       unsigned width, unsigned height,
+                                       const struct util_format_shuffle_4x8 *shuffle);
+
+boolean
+util_format_pack_4x8unorm_float_rows(uint8_t *dst_row, unsigned dst_stride,
+                                     const float *src_row, unsigned src_stride,
+                                     unsigned width, unsigned height,
+                                     const struct util_format_shuffle_4x8 *shuffle);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* U_FORMAT_SIMD_H_ */
@@ -100,6 +100,9 @@ util_gen_mipmap(struct pipe_context *pipe, struct pipe_resource *pt,
    blit.mask = is_zs ? PIPE_MASK_Z : PIPE_MASK_RGBA;
    blit.filter = filter;
 
+   if (pipe->begin_blit_batch)
+      pipe->begin_blit_batch(pipe);
+
    for (dstLevel = base_level + 1; dstLevel <= last_level; dstLevel++) {
       blit.src.level = dstLevel - 1;
       blit.dst.level = dstLevel;
@@ -124,5 +127,8 @@ util_gen_mipmap(struct pipe_context *pipe, struct pipe_resource *pt,
 
       pipe->blit(pipe, &blit);
    }
+
+   if (pipe->end_blit_batch)
+      pipe->end_blit_batch(pipe);
    return TRUE;
 }
@@ -26,9 +26,14 @@
 
 
 #include "u_inlines.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_memory.h"
 #include "u_prim_restart.h"
 
+#if defined(USE_SSE41)
+#include "indices/u_indices_sse41.h"
+#endif
+
 
 /**
  * Translate an index buffer for primitive restart.
@@ -77,6 +82,21 @@ util_translate_prim_restart_ib(struct pipe_context *context,
    if (!src_map)
       goto error;
 
+#if defined(USE_SSE41)
+   util_cpu_detect();
+   if (util_cpu_caps.has_sse4_1) {
+      if (src_index_size == 1)
+         u_index_restart_ubyte_ushort_sse41(src_map, info->count,
+                                            info->restart_index, dst_map);
+      else if (src_index_size == 2)
+         u_index_restart_ushort_sse41(src_map, info->count,
+                                      info->restart_index, dst_map);
+      else
+         u_index_restart_uint_sse41(src_map, info->count,
+                                    info->restart_index, dst_map);
+   }
+   else
+#endif
    if (src_index_size == 1 && dst_index_size == 2) {
       uint8_t *src = (uint8_t *) src_map;
       uint16_t *dst = (uint16_t *) dst_map;
@@ -167,6 +187,57 @@ add_range(struct range_info *info, unsigned start, unsigned count)
 }
 
 
+/**
+ * Helper function for util_draw_vbo_without_prim_restart()
+ * \return the position of the first restart index at or after 'start', or
+ *         'count' if there is none
+ */
+static unsigned
+find_restart_index(const void *indices, unsigned index_size,
+                   unsigned start, unsigned count, unsigned restart_index)
+{
+   unsigned i;
+
+#if defined(USE_SSE41)
+   util_cpu_detect();
+   if (util_cpu_caps.has_sse4_1) {
+      switch (index_size) {
+      case 1:
+         return u_index_find_restart_ubyte_sse41(indices, start, count,
+                                                 restart_index);
+      case 2:
+         return u_index_find_restart_ushort_sse41(indices, start, count,
+                                                  restart_index);
+      default:
+         return u_index_find_restart_uint_sse41(indices, start, count,
+                                                restart_index);
+      }
+   }
+#endif
+
+#define SCAN_INDEXES(TYPE) \
+   for (i = start; i < count; i++) { \
+      if (((const TYPE *) indices)[i] == restart_index) \
+         return i; \
+   }
+
+   switch (index_size) {
+   case 1:
+      SCAN_INDEXES(uint8_t);
+      break;
+   case 2:
+      SCAN_INDEXES(uint16_t);
+      break;
+   default:
+      SCAN_INDEXES(uint32_t);
+      break;
+   }
+#undef SCAN_INDEXES
+
+   return count;
+}
+
+
 /**
  * Implement primitive restart by breaking an indexed primitive into
  * pieces which do not contain restart indexes.  Each piece is then
@@ -207,43 +278,28 @@ util_draw_vbo_without_prim_restart(struct pipe_context *context,
          + info->start * info->index_size;
    }
 
-#define SCAN_INDEXES(TYPE) \
-   for (i = 0; i <= info->count; i++) { \
-      if (i == info->count || \
-          ((const TYPE *) src_map)[i] == info->restart_index) { \
-         /* cut / restart */ \
-         if (count > 0) { \
-            if (!add_range(&ranges, info->start + start, count)) { \
-               if (src_transfer) \
-                  pipe_buffer_unmap(context, src_transfer); \
-               return PIPE_ERROR_OUT_OF_MEMORY; \
-            } \
-         } \
-         start = i + 1; \
-         count = 0; \
-      } \
-      else { \
-         count++; \
-      } \
-   }
-
-   start = 0;
-   count = 0;
-   switch (info->index_size) {
-   case 1:
-      SCAN_INDEXES(uint8_t);
-      break;
-   case 2:
-      SCAN_INDEXES(uint16_t);
-      break;
-   case 4:
-      SCAN_INDEXES(uint32_t);
-      break;
-   default:
+   if (info->index_size != 1 && info->index_size != 2 &&
+       info->index_size != 4) {
       assert(!"Bad index size");
+      if (src_transfer)
+         pipe_buffer_unmap(context, src_transfer);
       return PIPE_ERROR_BAD_INPUT;
    }
 
+   /* add the ranges between the restart indexes */
+   for (start = 0; start < info->count; start = i + 1) {
+      i = find_restart_index(src_map, info->index_size, start, info->count,
+                             info->restart_index);
+      count = i - start;
+      if (count > 0) {
+         if (!add_range(&ranges, info->start + start, count)) {
+            if (src_transfer)
+               pipe_buffer_unmap(context, src_transfer);
+            return PIPE_ERROR_OUT_OF_MEMORY;
+         }
+      }
+   }
+
    /* unmap index buffer */
    if (src_transfer)
       pipe_buffer_unmap(context, src_transfer);
@@ -36,12 +36,20 @@
 #include "pipe/p_screen.h"
 #include "pipe/p_state.h"
 
+#include "util/u_cpu_detect.h"
+#include "util/u_debug.h"
 #include "util/u_format.h"
 #include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_queue.h"
 #include "util/u_rect.h"
 #include "util/u_surface.h"
 #include "util/u_pack_color.h"
 
+#if defined(PIPE_ARCH_SSE)
+#include <emmintrin.h>
+#endif
+
 
 /**
  * Initialize a pipe_surface object.  'view' is considered to have
@@ -57,6 +65,296 @@ u_surface_default_template(struct pipe_surface *surf,
 }
 
 
+/*
+ * Large copies and fills are split by rows across a pool of worker
+ * threads, shared by all contexts, and the destination is written with
+ * streaming stores once it no longer fits in the last level cache.
+ */
+
+/** Don't bother with the worker threads for less than this many bytes */
+#define SURFACE_THREAD_MIN_BYTES  (4 * 1024 * 1024)
+
+/** Minimum number of bytes handed to one thread */
+#define SURFACE_THREAD_CHUNK_BYTES (1024 * 1024)
+
+/** Streaming store threshold when the L3 size is unknown */
+#define SURFACE_STREAM_DEFAULT_BYTES (8 * 1024 * 1024)
+
+#define SURFACE_MAX_THREADS 8
+
+static struct util_queue surface_queue;
+static unsigned surface_num_threads;
+static once_flag surface_queue_once = ONCE_FLAG_INIT;
+
+static void
+surface_queue_init(void)
+{
+   unsigned num_threads;
+
+   util_cpu_detect();
+
+   num_threads = debug_get_num_option("GALLIUM_SURFACE_THREADS",
+                                      MIN2(util_cpu_caps.nr_cpus - 1,
+                                           SURFACE_MAX_THREADS));
+   num_threads = MIN2(num_threads, SURFACE_MAX_THREADS);
+
+   if (num_threads &&
+       util_queue_init(&surface_queue, "gsurf", SURFACE_MAX_THREADS * 2,
+                       num_threads, 0))
+      surface_num_threads = num_threads;
+}
+
+
+struct surface_rows
+{
+   ubyte *dst;
+   const ubyte *src;
+   unsigned dst_stride;
+   int src_stride;
+   unsigned width;            /**< in bytes */
+   unsigned height;
+   unsigned blocksize;        /**< fills only */
+   const union util_color *uc; /**< fills only */
+   boolean stream;
+   struct util_queue_fence fence;
+};
+
+
+#if defined(PIPE_ARCH_SSE)
+
+static void
+copy_row_stream(ubyte *dst, const ubyte *src, unsigned width)
+{
+   unsigned head = MIN2((16 - ((uintptr_t)dst & 15)) & 15, width);
+
+   memcpy(dst, src, head);
+   dst += head;
+   src += head;
+   width -= head;
+
+   while (width >= 64) {
+      __m128i a = _mm_loadu_si128((const __m128i *)src + 0);
+      __m128i b = _mm_loadu_si128((const __m128i *)src + 1);
+      __m128i c = _mm_loadu_si128((const __m128i *)src + 2);
+      __m128i d = _mm_loadu_si128((const __m128i *)src + 3);
+      _mm_stream_si128((__m128i *)dst + 0, a);
+      _mm_stream_si128((__m128i *)dst + 1, b);
+      _mm_stream_si128((__m128i *)dst + 2, c);
+      _mm_stream_si128((__m128i *)dst + 3, d);
+      dst += 64;
+      src += 64;
+      width -= 64;
+   }
+   while (width >= 16) {
+      _mm_stream_si128((__m128i *)dst,
+                       _mm_loadu_si128((const __m128i *)src));
+      dst += 16;
+      src += 16;
+      width -= 16;
+   }
+
+   memcpy(dst, src, width);
+}
+
+
+/**
+ * Fill a row with streaming stores.  Returns FALSE if the value can't be
+ * expressed as a 16 byte pattern starting at the first aligned address.
+ */
+static boolean
+fill_row_stream(ubyte *dst, unsigned width, unsigned blocksize,
+                const union util_color *uc)
+{
+   unsigned head = MIN2((16 - ((uintptr_t)dst & 15)) & 15, width);
+   ubyte pattern[16];
+   unsigned i;
+
+   if (16 % blocksize || head % blocksize)
+      return FALSE;
+
+   for (i = 0; i < 16; i += blocksize)
+      memcpy(pattern + i, uc, blocksize);
+
+   memcpy(dst, pattern, head);
+   dst += head;
+   width -= head;
+
+   {
+      const __m128i value = _mm_loadu_si128((const __m128i *)pattern);
+
+      while (width >= 16) {
+         _mm_stream_si128((__m128i *)dst, value);
+         dst += 16;
+         width -= 16;
+      }
+   }
+
+   memcpy(dst, pattern, width);
+   return TRUE;
+}
+
+#endif /* PIPE_ARCH_SSE */
+
+
+static void
+copy_rows(void *data, UNUSED int thread_index)
+{
+   struct surface_rows *rows = (struct surface_rows *)data;
+   ubyte *dst = rows->dst;
+   const ubyte *src = rows->src;
+   unsigned i;
+
+#if defined(PIPE_ARCH_SSE)
+   if (rows->stream) {
+      for (i = 0; i < rows->height; i++) {
+         copy_row_stream(dst, src, rows->width);
+         dst += rows->dst_stride;
+         src += rows->src_stride;
+      }
+      _mm_sfence();
+      return;
+   }
+#endif
+
+   if (rows->width == rows->dst_stride &&
+       rows->width == (unsigned)rows->src_stride)
+      memcpy(dst, src, rows->height * rows->width);
+   else {
+      for (i = 0; i < rows->height; i++) {
+         memcpy(dst, src, rows->width);
+         dst += rows->dst_stride;
+         src += rows->src_stride;
+      }
+   }
+}
+
+
+static void
+fill_rows(void *data, UNUSED int thread_index)
+{
+   struct surface_rows *rows = (struct surface_rows *)data;
+   const union util_color *uc = rows->uc;
+   ubyte *dst = rows->dst;
+   unsigned width = rows->width / rows->blocksize;
+   unsigned i, j;
+
+#if defined(PIPE_ARCH_SSE)
+   if (rows->stream) {
+      for (i = 0; i < rows->height; i++) {
+         if (!fill_row_stream(dst, rows->width, rows->blocksize, uc))
+            break;
+         dst += rows->dst_stride;
+      }
+      _mm_sfence();
+      if (i == rows->height)
+         return;
+      /* Misaligned rows, finish with the plain code. */
+      rows->dst = dst;
+      rows->height -= i;
+   }
+#endif
+
+   switch (rows->blocksize) {
+   case 1:
+      if(rows->dst_stride == rows->width)
+         memset(dst, uc->ub, rows->height * rows->width);
+      else {
+         for (i = 0; i < rows->height; i++) {
+            memset(dst, uc->ub, rows->width);
+            dst += rows->dst_stride;
+         }
+      }
+      break;
+   case 2:
+      for (i = 0; i < rows->height; i++) {
+         uint16_t *row = (uint16_t *)dst;
+         for (j = 0; j < width; j++)
+            *row++ = uc->us;
+         dst += rows->dst_stride;
+      }
+      break;
+   case 4:
+      for (i = 0; i < rows->height; i++) {
+         uint32_t *row = (uint32_t *)dst;
+         for (j = 0; j < width; j++)
+            *row++ = uc->ui[0];
+         dst += rows->dst_stride;
+      }
+      break;
+   default:
+      for (i = 0; i < rows->height; i++) {
+         ubyte *row = dst;
+         for (j = 0; j < width; j++) {
+            memcpy(row, uc, rows->blocksize);
+            row += rows->blocksize;
+         }
+         dst += rows->dst_stride;
+      }
+      break;
+   }
+}
+
+
+/**
+ * Run a copy or fill, splitting it across the worker threads when it is
+ * large enough.  The calling thread does the last part itself.
+ */
+static void
+surface_run_rows(struct surface_rows *rows, util_queue_execute_func func)
+{
+   const uint64_t size = (uint64_t)rows->width * rows->height;
+   struct surface_rows parts[SURFACE_MAX_THREADS];
+   unsigned num_parts, rows_per_part, y, i;
+
+#if defined(PIPE_ARCH_SSE)
+   util_cpu_detect();
+   rows->stream = util_cpu_caps.has_sse2 &&
+                  size > (util_cpu_caps.L3_size ? util_cpu_caps.L3_size :
+                          SURFACE_STREAM_DEFAULT_BYTES);
+#else
+   rows->stream = FALSE;
+#endif
+
+   if (size < SURFACE_THREAD_MIN_BYTES) {
+      func(rows, 0);
+      return;
+   }
+
+   call_once(&surface_queue_once, surface_queue_init);
+
+   num_parts = MIN2(surface_num_threads + 1, size / SURFACE_THREAD_CHUNK_BYTES);
+   num_parts = MIN3(num_parts, rows->height, SURFACE_MAX_THREADS);
+   if (num_parts <= 1) {
+      func(rows, 0);
+      return;
+   }
+
+   rows_per_part = DIV_ROUND_UP(rows->height, num_parts);
+   num_parts = DIV_ROUND_UP(rows->height, rows_per_part);
+
+   for (i = 0, y = 0; i < num_parts; i++, y += rows_per_part) {
+      parts[i] = *rows;
+      parts[i].dst = rows->dst + (size_t)y * rows->dst_stride;
+      if (rows->src)
+         parts[i].src = rows->src + (ptrdiff_t)y * rows->src_stride;
+      parts[i].height = MIN2(rows_per_part, rows->height - y);
+   }
+
+   for (i = 0; i < num_parts - 1; i++) {
+      util_queue_fence_init(&parts[i].fence);
+      util_queue_add_job(&surface_queue, &parts[i], &parts[i].fence,
+                         func, NULL);
+   }
+
+   func(&parts[num_parts - 1], 0);
+
+   for (i = 0; i < num_parts - 1; i++) {
+      util_queue_fence_wait(&parts[i].fence);
+      util_queue_fence_destroy(&parts[i].fence);
+   }
+}
+
+
 /**
  * Copy 2D rect from one place to another.
  * Position and sizes are in pixels.
@@ -75,7 +373,7 @@ util_copy_rect(ubyte * dst,
                unsigned src_x,
                unsigned src_y)
 {
-   unsigned i;
+   struct surface_rows rows;
    int src_stride_pos = src_stride < 0 ? -src_stride : src_stride;
    int blocksize = util_format_get_blocksize(format);
    int blockwidth = util_format_get_blockwidth(format);
@@ -98,15 +396,38 @@ util_copy_rect(ubyte * dst,
    src += src_y * src_stride_pos;
    width *= blocksize;
 
-   if (width == dst_stride && width == (unsigned)src_stride)
-      memcpy(dst, src, height * width);
-   else {
-      for (i = 0; i < height; i++) {
-         memcpy(dst, src, width);
-         dst += dst_stride;
-         src += src_stride;
-      }
-   }
+   memset(&rows, 0, sizeof rows);
+   rows.dst = dst;
+   rows.src = src;
+   rows.dst_stride = dst_stride;
+   rows.src_stride = src_stride;
+   rows.width = width;
+   rows.height = height;
+   surface_run_rows(&rows, copy_rows);
+}
+
+
+/**
+ * Copy a linear range of bytes.  Large ranges are split into rows so
+ * they go through the same threaded/streaming path as rectangles.
+ */
+void
+util_copy_buffer(ubyte *dst, const ubyte *src, unsigned size)
+{
+   struct surface_rows rows;
+   unsigned tail;
+
+   memset(&rows, 0, sizeof rows);
+   rows.dst = dst;
+   rows.src = src;
+   rows.width = SURFACE_THREAD_CHUNK_BYTES / 16;
+   rows.dst_stride = rows.width;
+   rows.src_stride = rows.width;
+   rows.height = size / rows.width;
+   surface_run_rows(&rows, copy_rows);
+
+   tail = size % rows.width;
+   memcpy(dst + size - tail, src + size - tail, tail);
 }
 
 
@@ -154,7 +475,7 @@ util_fill_rect(ubyte * dst,
                union util_color *uc)
 {
    const struct util_format_description *desc = util_format_description(format);
-   unsigned i, j;
+   struct surface_rows rows;
    unsigned width_size;
    int blocksize = desc->block.bits / 8;
    int blockwidth = desc->block.width;
@@ -173,44 +494,14 @@ util_fill_rect(ubyte * dst,
    dst += dst_y * dst_stride;
    width_size = width * blocksize;
 
-   switch (blocksize) {
-   case 1:
-      if(dst_stride == width_size)
-         memset(dst, uc->ub, height * width_size);
-      else {
-         for (i = 0; i < height; i++) {
-            memset(dst, uc->ub, width_size);
-            dst += dst_stride;
-         }
-      }
-      break;
-   case 2:
-      for (i = 0; i < height; i++) {
-         uint16_t *row = (uint16_t *)dst;
-         for (j = 0; j < width; j++)
-            *row++ = uc->us;
-         dst += dst_stride;
-      }
-      break;
-   case 4:
-      for (i = 0; i < height; i++) {
-         uint32_t *row = (uint32_t *)dst;
-         for (j = 0; j < width; j++)
-            *row++ = uc->ui[0];
-         dst += dst_stride;
-      }
-      break;
-   default:
-      for (i = 0; i < height; i++) {
-         ubyte *row = dst;
-         for (j = 0; j < width; j++) {
-            memcpy(row, uc, blocksize);
-            row += blocksize;
-         }
-         dst += dst_stride;
-      }
-      break;
-   }
+   memset(&rows, 0, sizeof rows);
+   rows.dst = dst;
+   rows.dst_stride = dst_stride;
+   rows.width = width_size;
+   rows.height = height;
+   rows.blocksize = blocksize;
+   rows.uc = uc;
+   surface_run_rows(&rows, fill_rows);
 }
 
 
@@ -361,7 +652,7 @@ util_resource_copy_region(struct pipe_context *pipe,
    if (dst->target == PIPE_BUFFER && src->target == PIPE_BUFFER) {
       assert(src_box.height == 1);
       assert(src_box.depth == 1);
-      memcpy(dst_map, src_map, src_box.width);
+      util_copy_buffer(dst_map, src_map, src_box.width);
    } else {
       util_copy_box(dst_map,
                     src_format,
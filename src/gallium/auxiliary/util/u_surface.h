@@ -50,6 +50,9 @@ util_copy_rect(ubyte * dst, enum pipe_format format,
                unsigned width, unsigned height, const ubyte * src,
                int src_stride, unsigned src_x, unsigned src_y);
 
+extern void
+util_copy_buffer(ubyte *dst, const ubyte *src, unsigned size);
+
 extern void
 util_copy_box(ubyte * dst,
               enum pipe_format format,
@@ -67,7 +67,7 @@ static void
 tc_batch_check(UNUSED struct tc_batch *batch)
 {
    tc_assert(batch->sentinel == TC_SENTINEL);
-   tc_assert(batch->num_total_call_slots <= TC_CALLS_PER_BATCH);
+   tc_assert(batch->num_total_call_slots <= TC_SLOTS_PER_BATCH);
 }
 
 static void
@@ -79,21 +79,32 @@ tc_debug_check(struct threaded_context *tc)
    }
 }
 
+static uint64_t *
+tc_execute_draws(struct pipe_context *pipe, uint64_t *iter, uint64_t *last);
+
 static void
 tc_batch_execute(void *job, UNUSED int thread_index)
 {
    struct tc_batch *batch = job;
    struct pipe_context *pipe = batch->pipe;
-   struct tc_call *last = &batch->call[batch->num_total_call_slots];
+   uint64_t *last = &batch->slots[batch->num_total_call_slots];
 
    tc_batch_check(batch);
 
    assert(!batch->token);
 
-   for (struct tc_call *iter = batch->call; iter != last;
-        iter += iter->num_call_slots) {
-      tc_assert(iter->sentinel == TC_SENTINEL);
-      execute_func[iter->call_id](pipe, &iter->payload);
+   for (uint64_t *iter = batch->slots; iter != last;) {
+      struct tc_call *call = (struct tc_call *)iter;
+
+      tc_assert(call->sentinel == TC_SENTINEL);
+
+      if (call->call_id == TC_CALL_draw_vbo && pipe->multi_draw) {
+         iter = tc_execute_draws(pipe, iter, last);
+         continue;
+      }
+
+      execute_func[call->call_id](pipe, &call->payload);
+      iter += call->num_call_slots;
    }
 
    tc_batch_check(batch);
@@ -131,11 +142,11 @@ tc_add_sized_call(struct threaded_context *tc, enum tc_call_id id,
 {
    struct tc_batch *next = &tc->batch_slots[tc->next];
    unsigned total_size = offsetof(struct tc_call, payload) + payload_size;
-   unsigned num_call_slots = DIV_ROUND_UP(total_size, sizeof(struct tc_call));
+   unsigned num_call_slots = DIV_ROUND_UP(total_size, sizeof(uint64_t));
 
    tc_debug_check(tc);
 
-   if (unlikely(next->num_total_call_slots + num_call_slots > TC_CALLS_PER_BATCH)) {
+   if (unlikely(next->num_total_call_slots + num_call_slots > TC_SLOTS_PER_BATCH)) {
       tc_batch_flush(tc);
       next = &tc->batch_slots[tc->next];
       tc_assert(next->num_total_call_slots == 0);
@@ -143,7 +154,8 @@ tc_add_sized_call(struct threaded_context *tc, enum tc_call_id id,
 
    tc_assert(util_queue_fence_is_signalled(&next->fence));
 
-   struct tc_call *call = &next->call[next->num_total_call_slots];
+   struct tc_call *call =
+      (struct tc_call *)&next->slots[next->num_total_call_slots];
    next->num_total_call_slots += num_call_slots;
 
    call->sentinel = TC_SENTINEL;
@@ -166,7 +178,7 @@ tc_add_sized_call(struct threaded_context *tc, enum tc_call_id id,
 static union tc_payload *
 tc_add_small_call(struct threaded_context *tc, enum tc_call_id id)
 {
-   return tc_add_sized_call(tc, id, 0);
+   return tc_add_sized_call(tc, id, sizeof(union tc_payload));
 }
 
 static bool
@@ -2052,11 +2064,8 @@ struct tc_full_draw_info {
 };
 
 static void
-tc_call_draw_vbo(struct pipe_context *pipe, union tc_payload *payload)
+tc_release_draw_info(struct tc_full_draw_info *info)
 {
-   struct tc_full_draw_info *info = (struct tc_full_draw_info*)payload;
-
-   pipe->draw_vbo(pipe, &info->draw);
    pipe_so_target_reference(&info->draw.count_from_stream_output, NULL);
    if (info->draw.index_size)
       pipe_resource_reference(&info->draw.index.resource, NULL);
@@ -2066,6 +2075,101 @@ tc_call_draw_vbo(struct pipe_context *pipe, union tc_payload *payload)
    }
 }
 
+static void
+tc_call_draw_vbo(struct pipe_context *pipe, union tc_payload *payload)
+{
+   struct tc_full_draw_info *info = (struct tc_full_draw_info*)payload;
+
+   pipe->draw_vbo(pipe, &info->draw);
+   tc_release_draw_info(info);
+}
+
+/* Whether a draw can be merged into a multi_draw after the draw "first",
+ * given the number of draws merged so far.
+ */
+static bool
+tc_can_merge_draw(const struct pipe_draw_info *first,
+                  const struct pipe_draw_info *next,
+                  unsigned num_draws)
+{
+   if (next->indirect || next->count_from_stream_output)
+      return false;
+
+   /* Everything but start, count, drawid and the index bounds must match. */
+   if (next->index_size != first->index_size ||
+       next->mode != first->mode ||
+       next->primitive_restart != first->primitive_restart ||
+       next->vertices_per_patch != first->vertices_per_patch ||
+       next->start_instance != first->start_instance ||
+       next->instance_count != first->instance_count ||
+       next->index_bias != first->index_bias ||
+       (next->primitive_restart &&
+        next->restart_index != first->restart_index) ||
+       (next->index_size && next->index.resource != first->index.resource))
+      return false;
+
+   /* The draw IDs must either all be the same or count up. */
+   if (num_draws == 1)
+      return next->drawid == first->drawid ||
+             next->drawid == first->drawid + 1;
+
+   return next->drawid == (first->increment_draw_id ?
+                           first->drawid + num_draws : first->drawid);
+}
+
+/* Execute a draw_vbo call together with all following draw_vbo calls that
+ * can be merged with it, and return the first call after them.
+ */
+static uint64_t *
+tc_execute_draws(struct pipe_context *pipe, uint64_t *iter, uint64_t *last)
+{
+   struct tc_call *call = (struct tc_call *)iter;
+   struct tc_full_draw_info *first = (struct tc_full_draw_info *)&call->payload;
+   struct pipe_draw_start_count draws[TC_MAX_MERGED_DRAWS];
+   unsigned num_draws = 1;
+
+   iter += call->num_call_slots;
+
+   if (first->draw.indirect || first->draw.count_from_stream_output) {
+      tc_call_draw_vbo(pipe, &call->payload);
+      return iter;
+   }
+
+   draws[0].start = first->draw.start;
+   draws[0].count = first->draw.count;
+   first->draw.increment_draw_id = false;
+
+   while (iter != last && num_draws < TC_MAX_MERGED_DRAWS) {
+      struct tc_call *next_call = (struct tc_call *)iter;
+      struct tc_full_draw_info *next =
+         (struct tc_full_draw_info *)&next_call->payload;
+
+      if (next_call->call_id != TC_CALL_draw_vbo ||
+          !tc_can_merge_draw(&first->draw, &next->draw, num_draws))
+         break;
+
+      if (num_draws == 1)
+         first->draw.increment_draw_id = next->draw.drawid != first->draw.drawid;
+
+      first->draw.min_index = MIN2(first->draw.min_index, next->draw.min_index);
+      first->draw.max_index = MAX2(first->draw.max_index, next->draw.max_index);
+      draws[num_draws].start = next->draw.start;
+      draws[num_draws].count = next->draw.count;
+      num_draws++;
+
+      tc_release_draw_info(next);
+      iter += next_call->num_call_slots;
+   }
+
+   if (num_draws == 1)
+      pipe->draw_vbo(pipe, &first->draw);
+   else
+      pipe->multi_draw(pipe, &first->draw, draws, num_draws);
+
+   tc_release_draw_info(first);
+   return iter;
+}
+
 static struct tc_full_draw_info *
 tc_add_draw_vbo(struct pipe_context *_pipe, bool indirect)
 {
@@ -2210,6 +2314,30 @@ tc_blit(struct pipe_context *_pipe, const struct pipe_blit_info *info)
    memcpy(blit, info, sizeof(*info));
 }
 
+static void
+tc_call_begin_blit_batch(struct pipe_context *pipe, union tc_payload *payload)
+{
+   pipe->begin_blit_batch(pipe);
+}
+
+static void
+tc_begin_blit_batch(struct pipe_context *_pipe)
+{
+   tc_add_small_call(threaded_context(_pipe), TC_CALL_begin_blit_batch);
+}
+
+static void
+tc_call_end_blit_batch(struct pipe_context *pipe, union tc_payload *payload)
+{
+   pipe->end_blit_batch(pipe);
+}
+
+static void
+tc_end_blit_batch(struct pipe_context *_pipe)
+{
+   tc_add_small_call(threaded_context(_pipe), TC_CALL_end_blit_batch);
+}
+
 struct tc_generate_mipmap {
    struct pipe_resource *res;
    enum pipe_format format;
@@ -2564,7 +2692,7 @@ threaded_context_create(struct pipe_context *pipe,
    struct threaded_context *tc;
 
    STATIC_ASSERT(sizeof(union tc_payload) <= 8);
-   STATIC_ASSERT(sizeof(struct tc_call) <= 16);
+   STATIC_ASSERT(offsetof(struct tc_call, payload) == sizeof(uint64_t));
 
    if (!pipe)
       return NULL;
@@ -2583,10 +2711,8 @@ threaded_context_create(struct pipe_context *pipe,
 
    assert((uintptr_t)tc % 16 == 0);
    /* These should be static asserts, but they don't work with MSVC */
-   assert(offsetof(struct threaded_context, batch_slots) % 16 == 0);
-   assert(offsetof(struct threaded_context, batch_slots[0].call) % 16 == 0);
-   assert(offsetof(struct threaded_context, batch_slots[0].call[1]) % 16 == 0);
-   assert(offsetof(struct threaded_context, batch_slots[1].call) % 16 == 0);
+   assert(offsetof(struct threaded_context, batch_slots[0].slots) % 8 == 0);
+   assert(offsetof(struct threaded_context, batch_slots[1].slots) % 8 == 0);
 
    /* The driver context isn't wrapped, so set its "priv" to NULL. */
    pipe->priv = NULL;
@@ -2637,6 +2763,8 @@ threaded_context_create(struct pipe_context *pipe,
    CTX_INIT(launch_grid);
    CTX_INIT(resource_copy_region);
    CTX_INIT(blit);
+   CTX_INIT(begin_blit_batch);
+   CTX_INIT(end_blit_batch);
    CTX_INIT(clear);
    CTX_INIT(clear_render_target);
    CTX_INIT(clear_depth_stencil);
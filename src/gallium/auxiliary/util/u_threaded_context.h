@@ -158,18 +158,19 @@
  * ---------------------------------
  *
  * There is a multithreaded queue consisting of batches, each batch consisting
- * of call slots. Each call slot consists of an 8-byte header (call ID +
- * call size + constant 32-bit marker for integrity checking) and an 8-byte
- * body for per-call data. That is 16 bytes per call slot.
- *
- * Simple calls such as bind_xx_state(CSO) occupy only one call slot. Bigger
- * calls occupy multiple call slots depending on the size needed by call
- * parameters. That means that calls can have a variable size in the batch.
- * For example, set_vertex_buffers(count = any, buffers = NULL) occupies only
- * 1 call slot, but set_vertex_buffers(count = 5) occupies 6 call slots.
- * Even though the first call slot can use only 8 bytes for data, additional
- * call slots used by the same call can use all 16 bytes for data.
- * For example, a call using 2 call slots has 24 bytes of space for data.
+ * of 8-byte call slots. Each call starts with an 8-byte header (call ID +
+ * call size in slots + constant 32-bit marker for integrity checking),
+ * followed by as many slots as its per-call data needs.
+ *
+ * Simple calls such as bind_xx_state(CSO) occupy 2 call slots (16 bytes).
+ * Bigger calls occupy more call slots depending on the size needed by call
+ * parameters, rounded up to 8 bytes. That means that calls can have
+ * a variable size in the batch. For example, a call with 20 bytes of
+ * parameters occupies 4 call slots (32 bytes).
+ *
+ * When the driver implements pipe_context::multi_draw, consecutive draw_vbo
+ * calls in a batch that differ only in start/count (and drawid) are merged
+ * into one multi_draw call when the batch is executed.
  *
  * Once a batch is full and there is no space for the next call, it's flushed,
  * meaning that it's added to the queue for execution in the other thread.
@@ -214,13 +215,16 @@ struct tc_unflushed_batch_token;
  */
 #define TC_MAX_BATCHES        10
 
-/* The size of one batch. Non-trivial calls (i.e. not setting a CSO pointer)
- * can occupy multiple call slots.
+/* The size of one batch in 8-byte call slots. Every call occupies at least
+ * 2 call slots.
  *
  * The idea is to have batches as small as possible but large enough so that
  * the queuing and mutex overhead is negligible.
  */
-#define TC_CALLS_PER_BATCH    768
+#define TC_SLOTS_PER_BATCH    1536
+
+/* The maximum number of draw_vbo calls merged into one multi_draw. */
+#define TC_MAX_MERGED_DRAWS   256
 
 /* Threshold for when to use the queue or sync. */
 #define TC_MAX_STRING_MARKER_BYTES  512
@@ -313,14 +317,10 @@ union tc_payload {
    uint64_t handle;
 };
 
-#ifdef _MSC_VER
-#define ALIGN16 __declspec(align(16))
-#else
-#define ALIGN16 __attribute__((aligned(16)))
-#endif
-
-/* Each call slot should be aligned to its own size for optimal cache usage. */
-struct ALIGN16 tc_call {
+/* The header of a call, followed by its payload. Calls are stored aligned
+ * to 8-byte call slots.
+ */
+struct tc_call {
    unsigned sentinel;
    ushort num_call_slots;
    ushort call_id;
@@ -343,7 +343,7 @@ struct tc_batch {
    unsigned num_total_call_slots;
    struct tc_unflushed_batch_token *token;
    struct util_queue_fence fence;
-   struct tc_call call[TC_CALLS_PER_BATCH];
+   uint64_t slots[TC_SLOTS_PER_BATCH];
 };
 
 struct threaded_context {
@@ -29,6 +29,8 @@ CALL(draw_vbo)
 CALL(launch_grid)
 CALL(resource_copy_region)
 CALL(blit)
+CALL(begin_blit_batch)
+CALL(end_blit_batch)
 CALL(generate_mipmap)
 CALL(flush_resource)
 CALL(invalidate_resource)
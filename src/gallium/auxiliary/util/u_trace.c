@@ -0,0 +1,281 @@
+/*
+ * Copyright 2019 Advanced Micro Devices, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * on the rights to use, copy, modify, merge, publish, distribute, sub
+ * license, and/or sell copies of the Software, and to permit persons to whom
+ * the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHOR(S) AND/OR THEIR SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "u_trace.h"
+
+#include <stdio.h>
+
+#include "util/u_debug.h"
+#include "util/u_memory.h"
+
+struct u_trace_event {
+   const char *name;
+   const char *category;
+   char phase;
+};
+
+struct u_trace_chunk {
+   struct list_head list;
+   struct u_trace_context *utctx;
+   void *timestamps;
+   unsigned num_events;
+   struct util_queue_fence fence;
+   struct u_trace_event events[U_TRACE_CHUNK_SIZE];
+};
+
+/* The output file shared by all contexts. It stays open until the process
+ * exits, and it is in the JSON array format, which can be loaded without the
+ * closing bracket.
+ */
+static struct {
+   mtx_t lock;
+   FILE *out;
+   unsigned num_tracks;
+} trace_file;
+
+static once_flag trace_file_once = ONCE_FLAG_INIT;
+
+static void
+trace_file_init_once(void)
+{
+   (void) mtx_init(&trace_file.lock, mtx_plain);
+}
+
+/* Called with trace_file.lock held. */
+static void
+trace_file_write_separator(void)
+{
+   fputs(trace_file.num_tracks ? ",\n" : "[\n", trace_file.out);
+}
+
+static void
+u_trace_chunk_process(void *job, int thread_index)
+{
+   struct u_trace_chunk *chunk = (struct u_trace_chunk *)job;
+   struct u_trace_context *utctx = chunk->utctx;
+   uint64_t ts[U_TRACE_CHUNK_SIZE];
+   unsigned i;
+
+   /* Wait for the GPU before taking the file lock. */
+   for (i = 0; i < chunk->num_events; i++)
+      ts[i] = utctx->read_timestamp(utctx, chunk->timestamps, i);
+
+   mtx_lock(&trace_file.lock);
+   for (i = 0; i < chunk->num_events; i++) {
+      const struct u_trace_event *ev = &chunk->events[i];
+
+      trace_file_write_separator();
+      if (ev->phase == 'B') {
+         fprintf(trace_file.out,
+                 "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"B\",\"pid\":0,"
+                 "\"tid\":%u,\"ts\":%.3f}",
+                 ev->name, ev->category, utctx->track, ts[i] / 1000.0);
+      } else {
+         fprintf(trace_file.out,
+                 "{\"ph\":\"E\",\"pid\":0,\"tid\":%u,\"ts\":%.3f}",
+                 utctx->track, ts[i] / 1000.0);
+      }
+   }
+   fflush(trace_file.out);
+   mtx_unlock(&trace_file.lock);
+}
+
+static void
+u_trace_chunk_release(void *job, int thread_index)
+{
+   struct u_trace_chunk *chunk = (struct u_trace_chunk *)job;
+   struct u_trace_context *utctx = chunk->utctx;
+
+   chunk->num_events = 0;
+
+   mtx_lock(&utctx->lock);
+   list_add(&chunk->list, &utctx->free_chunks);
+   mtx_unlock(&utctx->lock);
+}
+
+static struct u_trace_chunk *
+u_trace_chunk_get(struct u_trace_context *utctx)
+{
+   struct u_trace_chunk *chunk = NULL;
+
+   mtx_lock(&utctx->lock);
+   if (!LIST_IS_EMPTY(&utctx->free_chunks)) {
+      chunk = LIST_ENTRY(struct u_trace_chunk, utctx->free_chunks.next, list);
+      list_del(&chunk->list);
+   }
+   mtx_unlock(&utctx->lock);
+
+   if (chunk)
+      return chunk;
+
+   chunk = CALLOC_STRUCT(u_trace_chunk);
+   if (!chunk)
+      return NULL;
+
+   chunk->timestamps = utctx->create_timestamp_buffer(utctx,
+                                                      U_TRACE_CHUNK_SIZE);
+   if (!chunk->timestamps) {
+      FREE(chunk);
+      return NULL;
+   }
+
+   chunk->utctx = utctx;
+   util_queue_fence_init(&chunk->fence);
+   return chunk;
+}
+
+static void
+u_trace_chunk_destroy(struct u_trace_chunk *chunk)
+{
+   chunk->utctx->delete_timestamp_buffer(chunk->utctx, chunk->timestamps);
+   util_queue_fence_destroy(&chunk->fence);
+   FREE(chunk);
+}
+
+void
+u_trace_context_init(struct u_trace_context *utctx, void *pctx,
+                     const char *name,
+                     u_trace_create_ts_buffer create_timestamp_buffer,
+                     u_trace_delete_ts_buffer delete_timestamp_buffer,
+                     u_trace_record_ts record_timestamp,
+                     u_trace_read_ts read_timestamp)
+{
+   const char *filename = debug_get_option("GALLIUM_GPU_TRACE", NULL);
+
+   memset(utctx, 0, sizeof(*utctx));
+   utctx->pctx = pctx;
+   utctx->create_timestamp_buffer = create_timestamp_buffer;
+   utctx->delete_timestamp_buffer = delete_timestamp_buffer;
+   utctx->record_timestamp = record_timestamp;
+   utctx->read_timestamp = read_timestamp;
+   list_inithead(&utctx->free_chunks);
+
+   if (!filename)
+      return;
+
+   (void) mtx_init(&utctx->lock, mtx_plain);
+
+   if (!util_queue_init(&utctx->queue, "u_trace", 64, 1,
+                        UTIL_QUEUE_INIT_RESIZE_IF_FULL))
+      return;
+
+   call_once(&trace_file_once, trace_file_init_once);
+
+   mtx_lock(&trace_file.lock);
+   if (!trace_file.out) {
+      trace_file.out = fopen(filename, "w");
+      if (!trace_file.out) {
+         mtx_unlock(&trace_file.lock);
+         fprintf(stderr, "u_trace: can't open %s\n", filename);
+         util_queue_destroy(&utctx->queue);
+         mtx_destroy(&utctx->lock);
+         return;
+      }
+   }
+   trace_file_write_separator();
+   utctx->track = ++trace_file.num_tracks;
+   fprintf(trace_file.out,
+           "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,"
+           "\"args\":{\"name\":\"%s %u\"}}",
+           utctx->track, name, utctx->track);
+   fflush(trace_file.out);
+   mtx_unlock(&trace_file.lock);
+}
+
+void
+u_trace_context_fini(struct u_trace_context *utctx)
+{
+   if (!utctx->track)
+      return;
+
+   util_queue_finish(&utctx->queue);
+   util_queue_destroy(&utctx->queue);
+
+   list_for_each_entry_safe(struct u_trace_chunk, chunk,
+                            &utctx->free_chunks, list)
+      u_trace_chunk_destroy(chunk);
+
+   mtx_destroy(&utctx->lock);
+   utctx->track = 0;
+}
+
+void
+u_trace_init(struct u_trace *ut, struct u_trace_context *utctx)
+{
+   ut->utctx = utctx;
+   ut->depth = 0;
+   list_inithead(&ut->chunks);
+}
+
+/* Unflushed tracepoints are dropped. */
+void
+u_trace_fini(struct u_trace *ut)
+{
+   if (!ut->utctx)
+      return;
+
+   list_for_each_entry_safe(struct u_trace_chunk, chunk, &ut->chunks, list) {
+      list_del(&chunk->list);
+      u_trace_chunk_release(chunk, 0);
+   }
+   ut->utctx = NULL;
+}
+
+void
+u_trace_flush(struct u_trace *ut)
+{
+   if (!u_trace_is_enabled(ut))
+      return;
+
+   list_for_each_entry_safe(struct u_trace_chunk, chunk, &ut->chunks, list) {
+      list_del(&chunk->list);
+      util_queue_add_job(&ut->utctx->queue, chunk, &chunk->fence,
+                         u_trace_chunk_process, u_trace_chunk_release);
+   }
+}
+
+bool
+_u_trace_record(struct u_trace *ut, const char *name, const char *category,
+                char phase)
+{
+   struct u_trace_chunk *chunk = NULL;
+   struct u_trace_event *ev;
+
+   if (!LIST_IS_EMPTY(&ut->chunks))
+      chunk = LIST_ENTRY(struct u_trace_chunk, ut->chunks.prev, list);
+
+   if (!chunk || chunk->num_events == U_TRACE_CHUNK_SIZE) {
+      chunk = u_trace_chunk_get(ut->utctx);
+      if (!chunk)
+         return false;
+      list_addtail(&chunk->list, &ut->chunks);
+   }
+
+   ev = &chunk->events[chunk->num_events];
+   ev->name = name;
+   ev->category = category;
+   ev->phase = phase;
+
+   ut->utctx->record_timestamp(ut, chunk->timestamps, chunk->num_events++);
+   return true;
+}
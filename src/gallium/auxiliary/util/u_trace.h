@@ -0,0 +1,163 @@
+/*
+ * Copyright 2019 Advanced Micro Devices, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * on the rights to use, copy, modify, merge, publish, distribute, sub
+ * license, and/or sell copies of the Software, and to permit persons to whom
+ * the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHOR(S) AND/OR THEIR SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file u_trace.h
+ * @brief GPU timestamp tracepoints
+ *
+ * Drivers mark the start and the end of GPU work (render passes, blits,
+ * compute dispatches, ...) with \ref u_trace_begin and \ref u_trace_end.
+ * Each tracepoint makes the driver write a GPU timestamp into a buffer slot.
+ *
+ * The slots are grouped into chunks. When the driver submits the command
+ * buffer, it calls \ref u_trace_flush, and the chunks of the batch are handed
+ * to a thread that reads the timestamps back once the GPU is done with them
+ * and writes them out in the Chrome trace event JSON format, which
+ * chrome://tracing and Perfetto can load. The timestamp buffers of processed
+ * chunks are reused for later chunks.
+ *
+ * Tracing is enabled by setting GALLIUM_GPU_TRACE to the name of the output
+ * file. All contexts of the process share that file, and each context is a
+ * separate track in it. When tracing is disabled, a tracepoint is a single
+ * branch.
+ *
+ * Names and categories of tracepoints must be string literals or otherwise
+ * outlive the context, because they are only printed after the batch has
+ * executed.
+ */
+
+#ifndef U_TRACE_H
+#define U_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util/list.h"
+#include "util/u_queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct u_trace;
+struct u_trace_context;
+
+/* Timestamp slots per chunk. */
+#define U_TRACE_CHUNK_SIZE 256
+
+/* Allocate a buffer for "num_timestamps" GPU timestamps. */
+typedef void *(*u_trace_create_ts_buffer)(struct u_trace_context *utctx,
+                                          unsigned num_timestamps);
+typedef void (*u_trace_delete_ts_buffer)(struct u_trace_context *utctx,
+                                         void *timestamps);
+
+/* Emit a GPU timestamp write into slot "idx" of the buffer. Called in the
+ * thread the driver records commands with.
+ */
+typedef void (*u_trace_record_ts)(struct u_trace *ut, void *timestamps,
+                                  unsigned idx);
+
+/* Wait until the timestamp in slot "idx" has been written and return it in
+ * nanoseconds. Called in the trace thread, so it must not use the context.
+ */
+typedef uint64_t (*u_trace_read_ts)(struct u_trace_context *utctx,
+                                    void *timestamps, unsigned idx);
+
+struct u_trace_context {
+   void *pctx;
+
+   u_trace_create_ts_buffer create_timestamp_buffer;
+   u_trace_delete_ts_buffer delete_timestamp_buffer;
+   u_trace_record_ts record_timestamp;
+   u_trace_read_ts read_timestamp;
+
+   /* The track of this context in the trace, or 0 if tracing is disabled. */
+   unsigned track;
+
+   struct util_queue queue;
+
+   /* Chunks that have been processed, protected by "lock". Their timestamp
+    * buffers are reused.
+    */
+   mtx_t lock;
+   struct list_head free_chunks;
+};
+
+/* The tracepoints of one command buffer. */
+struct u_trace {
+   struct u_trace_context *utctx;
+   struct list_head chunks;
+   unsigned depth; /* number of unfinished u_trace_begin */
+};
+
+void u_trace_context_init(struct u_trace_context *utctx, void *pctx,
+                          const char *name,
+                          u_trace_create_ts_buffer create_timestamp_buffer,
+                          u_trace_delete_ts_buffer delete_timestamp_buffer,
+                          u_trace_record_ts record_timestamp,
+                          u_trace_read_ts read_timestamp);
+
+/* Process all flushed batches and free everything. */
+void u_trace_context_fini(struct u_trace_context *utctx);
+
+void u_trace_init(struct u_trace *ut, struct u_trace_context *utctx);
+
+/* Must be called before u_trace_context_fini. */
+void u_trace_fini(struct u_trace *ut);
+
+/* Hand the tracepoints recorded so far to the trace thread. Call this after
+ * the command buffer has been submitted.
+ */
+void u_trace_flush(struct u_trace *ut);
+
+bool _u_trace_record(struct u_trace *ut, const char *name,
+                     const char *category, char phase);
+
+static inline bool
+u_trace_is_enabled(const struct u_trace *ut)
+{
+   return ut->utctx && ut->utctx->track;
+}
+
+static inline void
+u_trace_begin(struct u_trace *ut, const char *name, const char *category)
+{
+   if (u_trace_is_enabled(ut) && _u_trace_record(ut, name, category, 'B'))
+      ut->depth++;
+}
+
+/* End the most recent unfinished u_trace_begin. */
+static inline void
+u_trace_end(struct u_trace *ut)
+{
+   if (u_trace_is_enabled(ut) && ut->depth) {
+      _u_trace_record(ut, NULL, NULL, 'E');
+      ut->depth--;
+   }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
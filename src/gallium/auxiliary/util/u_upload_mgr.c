@@ -38,6 +38,14 @@
 #include "u_upload_mgr.h"
 
 
+/* A buffer of the ring, see u_upload_enable_ring. */
+struct u_upload_ring_buffer {
+   struct pipe_resource *buffer;
+   struct pipe_fence_handle *fence; /* Signalled when the GPU is done with
+                                     * all fenced uses of the buffer. */
+   boolean unfenced; /* Used since the last u_upload_fence call. */
+};
+
 struct u_upload_mgr {
    struct pipe_context *pipe;
 
@@ -54,6 +62,16 @@ struct u_upload_mgr {
    unsigned offset; /* Aligned offset to the upload buffer, pointing
                      * at the first unused byte. */
    unsigned flushed_size; /* Size we have flushed by transfer_flush_region. */
+
+   /* Ring mode. */
+   struct u_upload_ring_buffer *ring;
+   unsigned ring_size;
+   unsigned ring_index; /* The last ring buffer switched to. */
+   struct u_upload_ring_buffer *ring_current; /* NULL if the current buffer
+                                               * isn't part of the ring. */
+   struct u_upload_fence_funcs fence_funcs;
+
+   struct u_upload_stats stats;
 };
 
 
@@ -131,6 +149,41 @@ u_upload_disable_persistent(struct u_upload_mgr *upload)
    upload->map_flags |= PIPE_TRANSFER_FLUSH_EXPLICIT;
 }
 
+void
+u_upload_enable_ring(struct u_upload_mgr *upload, unsigned num_buffers,
+                     const struct u_upload_fence_funcs *funcs)
+{
+   assert(!upload->ring && !upload->buffer && num_buffers);
+
+   upload->ring = CALLOC(num_buffers, sizeof(*upload->ring));
+   if (!upload->ring)
+      return;
+
+   upload->ring_size = num_buffers;
+   upload->ring_index = num_buffers - 1;
+   upload->fence_funcs = *funcs;
+}
+
+void
+u_upload_fence(struct u_upload_mgr *upload, struct pipe_fence_handle *fence)
+{
+   for (unsigned i = 0; i < upload->ring_size; i++) {
+      struct u_upload_ring_buffer *rb = &upload->ring[i];
+
+      if (rb->unfenced) {
+         upload->fence_funcs.reference(upload->fence_funcs.data,
+                                       &rb->fence, fence);
+         rb->unfenced = FALSE;
+      }
+   }
+}
+
+void
+u_upload_get_stats(struct u_upload_mgr *upload, struct u_upload_stats *stats)
+{
+   *stats = upload->stats;
+}
+
 static void
 upload_unmap_internal(struct u_upload_mgr *upload, boolean destroying)
 {
@@ -178,24 +231,22 @@ void
 u_upload_destroy(struct u_upload_mgr *upload)
 {
    u_upload_release_buffer(upload);
+
+   for (unsigned i = 0; i < upload->ring_size; i++) {
+      pipe_resource_reference(&upload->ring[i].buffer, NULL);
+      upload->fence_funcs.reference(upload->fence_funcs.data,
+                                    &upload->ring[i].fence, NULL);
+   }
+   FREE(upload->ring);
    FREE(upload);
 }
 
 
-static void
-u_upload_alloc_buffer(struct u_upload_mgr *upload, unsigned min_size)
+static struct pipe_resource *
+u_upload_create_buffer(struct u_upload_mgr *upload, unsigned size)
 {
    struct pipe_screen *screen = upload->pipe->screen;
    struct pipe_resource buffer;
-   unsigned size;
-
-   /* Release the old buffer, if present:
-    */
-   u_upload_release_buffer(upload);
-
-   /* Allocate a new one:
-    */
-   size = align(MAX2(upload->default_size, min_size), 4096);
 
    memset(&buffer, 0, sizeof buffer);
    buffer.target = PIPE_BUFFER;
@@ -213,7 +264,73 @@ u_upload_alloc_buffer(struct u_upload_mgr *upload, unsigned min_size)
                       PIPE_RESOURCE_FLAG_MAP_COHERENT;
    }
 
-   upload->buffer = screen->resource_create(screen, &buffer);
+   upload->stats.num_allocations++;
+   return screen->resource_create(screen, &buffer);
+}
+
+/**
+ * Switch to the next buffer of the ring.  Its fence tells us whether the GPU
+ * is done with it, in which case it's rewritten in place.  A buffer that is
+ * still referenced by unflushed commands is replaced, since there is no
+ * fence to wait for yet.
+ */
+static void
+u_upload_ring_next(struct u_upload_mgr *upload, unsigned size)
+{
+   struct u_upload_ring_buffer *rb;
+
+   upload->ring_index = (upload->ring_index + 1) % upload->ring_size;
+   rb = &upload->ring[upload->ring_index];
+
+   if (rb->buffer && rb->unfenced) {
+      pipe_resource_reference(&rb->buffer, NULL);
+      upload->fence_funcs.reference(upload->fence_funcs.data,
+                                    &rb->fence, NULL);
+      rb->unfenced = FALSE;
+   }
+
+   if (rb->buffer) {
+      if (rb->fence) {
+         void *data = upload->fence_funcs.data;
+
+         if (!upload->fence_funcs.wait(data, rb->fence, 0)) {
+            upload->fence_funcs.wait(data, rb->fence,
+                                     PIPE_TIMEOUT_INFINITE);
+            upload->stats.num_stalls++;
+         }
+         upload->fence_funcs.reference(data, &rb->fence, NULL);
+      }
+      upload->stats.num_wraps++;
+   } else {
+      rb->buffer = u_upload_create_buffer(upload, size);
+   }
+
+   pipe_resource_reference(&upload->buffer, rb->buffer);
+   upload->ring_current = rb;
+}
+
+static void
+u_upload_alloc_buffer(struct u_upload_mgr *upload, unsigned min_size)
+{
+   unsigned size;
+
+   /* Release the old buffer, if present:
+    */
+   u_upload_release_buffer(upload);
+
+   /* Allocate a new one:
+    */
+   size = align(MAX2(upload->default_size, min_size), 4096);
+
+   /* Ring buffers have the default size.  Bigger requests get a buffer of
+    * their own.
+    */
+   upload->ring_current = NULL;
+   if (upload->ring && size == align(upload->default_size, 4096))
+      u_upload_ring_next(upload, size);
+   else
+      upload->buffer = u_upload_create_buffer(upload, size);
+
    if (upload->buffer == NULL)
       return;
 
@@ -285,6 +402,9 @@ u_upload_alloc(struct u_upload_mgr *upload,
    assert(offset + size <= buffer_size);
    assert(size);
 
+   if (upload->ring_current)
+      upload->ring_current->unfenced = TRUE;
+
    /* Emit the return values: */
    *ptr = upload->map + offset;
    pipe_resource_reference(outbuf, upload->buffer);
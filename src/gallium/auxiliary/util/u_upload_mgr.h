@@ -36,8 +36,25 @@
 #include "pipe/p_defines.h"
 
 struct pipe_context;
+struct pipe_fence_handle;
 struct pipe_resource;
 
+/** Fence callbacks of the owner, used by the ring mode. */
+struct u_upload_fence_funcs {
+   void (*reference)(void *data, struct pipe_fence_handle **dst,
+                     struct pipe_fence_handle *src);
+   /** Return true if the fence is signalled, timeout in nanoseconds. */
+   bool (*wait)(void *data, struct pipe_fence_handle *fence,
+                uint64_t timeout);
+   void *data;
+};
+
+struct u_upload_stats {
+   uint64_t num_allocations; /* Upload buffers created. */
+   uint64_t num_wraps;       /* Ring buffers reused in place. */
+   uint64_t num_stalls;      /* Reuses that had to wait for the GPU. */
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -77,6 +94,28 @@ u_upload_enable_flush_explicit(struct u_upload_mgr *upload);
 void
 u_upload_disable_persistent(struct u_upload_mgr *upload);
 
+/**
+ * Recycle a ring of up to num_buffers upload buffers instead of allocating
+ * a new buffer every time the current one is full.  The ring only grows
+ * until it has num_buffers buffers; after that, the next buffer is reused
+ * once the GPU is done with it.
+ *
+ * The owner must call u_upload_fence after each command stream submission.
+ */
+void
+u_upload_enable_ring(struct u_upload_mgr *upload, unsigned num_buffers,
+                     const struct u_upload_fence_funcs *funcs);
+
+/**
+ * Attach a fence to all ring buffers that have been suballocated from since
+ * the last call.  The fence must signal after the GPU is done with them.
+ */
+void
+u_upload_fence(struct u_upload_mgr *upload, struct pipe_fence_handle *fence);
+
+void
+u_upload_get_stats(struct u_upload_mgr *upload, struct u_upload_stats *stats);
+
 /**
  * Destroy the upload manager.
  */
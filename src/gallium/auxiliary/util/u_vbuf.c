@@ -83,6 +83,16 @@
  *
  * If there is nothing to do, it forwards every command to the driver.
  * The module also has its own CSO cache of vertex element states.
+ *
+ *
+ * Translations of a single real buffer without index unrolling are also
+ * cached. A cache entry is keyed by the buffer, the translate key and the
+ * translated range, and it remembers a checksum of the source vertices.
+ * Writes to the buffer don't go through u_vbuf, so the source range is
+ * still mapped and checksummed every draw, but when the checksum matches,
+ * the converted vertices from an earlier draw are used instead of being
+ * translated and uploaded again. Ranges that keep changing stop being
+ * checksummed. Very large translations are split across worker threads.
  */
 
 #include "util/u_vbuf.h"
@@ -91,6 +101,8 @@
 #include "util/u_format.h"
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_queue.h"
 #include "util/u_upload_mgr.h"
 #include "translate/translate.h"
 #include "translate/translate_cache.h"
@@ -133,6 +145,47 @@ struct u_vbuf_elements {
    void *driver_cso;
 };
 
+/** Converted sizes from which a translation is cached */
+#define VBUF_CACHE_MIN_BYTES 4096
+
+/** Limit of the total size of the cached buffers */
+#define VBUF_CACHE_MAX_BYTES (64 * 1024 * 1024)
+
+#define VBUF_CACHE_SIZE 32
+
+/** Number of source changes after which a range isn't checksummed anymore */
+#define VBUF_CACHE_MAX_CHANGES 3
+
+/** Converted sizes from which a translation is split across threads */
+#define VBUF_THREAD_MIN_BYTES  (4 * 1024 * 1024)
+
+/** Minimum number of bytes converted by one thread */
+#define VBUF_THREAD_CHUNK_BYTES (1024 * 1024)
+
+#define VBUF_MAX_THREADS 8
+
+/* A cached translation of a range of one vertex buffer. */
+struct u_vbuf_translation {
+   /* The source buffer isn't referenced, it's only compared. A new buffer
+    * at the same address is caught by the checksum. */
+   const struct pipe_resource *src;
+   unsigned src_offset;
+   unsigned src_stride;
+   unsigned src_size;
+   int start_vertex;
+   unsigned num_vertices;
+   struct translate_key key;
+
+   uint64_t checksum;
+   unsigned num_changes;
+   unsigned last_use;
+
+   /* The converted vertices, or NULL if the range hasn't been seen twice
+    * with the same contents yet. */
+   struct pipe_resource *buffer;
+   unsigned buffer_offset;
+};
+
 enum {
    VB_VERTEX = 0,
    VB_INSTANCE = 1,
@@ -180,6 +233,16 @@ struct u_vbuf {
    uint32_t incompatible_vb_mask; /* each bit describes a corresp. buffer */
    /* Which buffer has a non-zero stride. */
    uint32_t nonzero_stride_vb_mask; /* each bit describes a corresp. buffer */
+
+   /* Cached translations, evicted in LRU order. */
+   struct u_vbuf_translation translations[VBUF_CACHE_SIZE];
+   unsigned translation_clock;
+   unsigned translation_cache_bytes;
+
+   /* Translate objects for the parts run by worker threads. The translate
+    * objects can't be shared between threads, because they keep their
+    * buffer pointers and generated code state in themselves. */
+   struct translate_cache *part_translate_cache[VBUF_MAX_THREADS - 1];
 };
 
 static void *
@@ -380,11 +443,258 @@ void u_vbuf_destroy(struct u_vbuf *mgr)
 
    pipe_vertex_buffer_unreference(&mgr->vertex_buffer0_saved);
 
+   for (i = 0; i < VBUF_CACHE_SIZE; i++)
+      pipe_resource_reference(&mgr->translations[i].buffer, NULL);
+
+   for (i = 0; i < VBUF_MAX_THREADS - 1; i++) {
+      if (mgr->part_translate_cache[i])
+         translate_cache_destroy(mgr->part_translate_cache[i]);
+   }
+
    translate_cache_destroy(mgr->translate_cache);
    cso_cache_delete(mgr->cso_cache);
    FREE(mgr);
 }
 
+static struct util_queue vbuf_queue;
+static unsigned vbuf_num_threads;
+static once_flag vbuf_queue_once = ONCE_FLAG_INIT;
+
+static void
+u_vbuf_queue_init(void)
+{
+   unsigned num_threads;
+
+   util_cpu_detect();
+
+   num_threads = debug_get_num_option("GALLIUM_VBUF_THREADS",
+                                      MIN2(util_cpu_caps.nr_cpus - 1,
+                                           VBUF_MAX_THREADS - 1));
+   num_threads = MIN2(num_threads, VBUF_MAX_THREADS - 1);
+
+   if (num_threads &&
+       util_queue_init(&vbuf_queue, "gvbuf", VBUF_MAX_THREADS * 2,
+                       num_threads, 0))
+      vbuf_num_threads = num_threads;
+}
+
+struct u_vbuf_translate_part {
+   struct translate *tr;
+   unsigned start;
+   unsigned count;
+   uint8_t *out_map;
+   struct util_queue_fence fence;
+};
+
+static void
+u_vbuf_translate_part_run(void *job, int thread_index)
+{
+   struct u_vbuf_translate_part *part = (struct u_vbuf_translate_part*)job;
+
+   part->tr->run(part->tr, part->start, part->count, 0, 0, part->out_map);
+}
+
+/**
+ * Translate num_vertices vertices, splitting the work across the worker
+ * threads when it is large enough. The calling thread does the last part
+ * itself with the translate object that was set up by the caller.
+ */
+static void
+u_vbuf_translate_run(struct u_vbuf *mgr, struct translate *tr,
+                     const struct translate_key *key, unsigned vb_mask,
+                     uint8_t *const maps[], unsigned max_index,
+                     unsigned num_vertices, uint8_t *out_map)
+{
+   const uint64_t size = (uint64_t)key->output_stride * num_vertices;
+   struct u_vbuf_translate_part parts[VBUF_MAX_THREADS];
+   unsigned num_parts, vertices_per_part, start, i;
+
+   if (size < VBUF_THREAD_MIN_BYTES) {
+      tr->run(tr, 0, num_vertices, 0, 0, out_map);
+      return;
+   }
+
+   call_once(&vbuf_queue_once, u_vbuf_queue_init);
+
+   num_parts = MIN2(vbuf_num_threads + 1, size / VBUF_THREAD_CHUNK_BYTES);
+   num_parts = MIN2(num_parts, VBUF_MAX_THREADS);
+   if (num_parts <= 1) {
+      tr->run(tr, 0, num_vertices, 0, 0, out_map);
+      return;
+   }
+
+   vertices_per_part = DIV_ROUND_UP(num_vertices, num_parts);
+   num_parts = DIV_ROUND_UP(num_vertices, vertices_per_part);
+
+   for (i = 0, start = 0; i < num_parts; i++, start += vertices_per_part) {
+      parts[i].start = start;
+      parts[i].count = MIN2(vertices_per_part, num_vertices - start);
+      parts[i].out_map = out_map + (size_t)key->output_stride * start;
+
+      if (i == num_parts - 1) {
+         parts[i].tr = tr;
+      } else {
+         unsigned mask = vb_mask;
+
+         if (!mgr->part_translate_cache[i])
+            mgr->part_translate_cache[i] = translate_cache_create();
+
+         parts[i].tr = translate_cache_find(mgr->part_translate_cache[i],
+                                            (struct translate_key*)key);
+         while (mask) {
+            unsigned vb = u_bit_scan(&mask);
+
+            if (maps[vb])
+               parts[i].tr->set_buffer(parts[i].tr, vb, maps[vb],
+                                       mgr->vertex_buffer[vb].stride,
+                                       max_index);
+         }
+      }
+   }
+
+   for (i = 0; i < num_parts - 1; i++) {
+      util_queue_fence_init(&parts[i].fence);
+      util_queue_add_job(&vbuf_queue, &parts[i], &parts[i].fence,
+                         u_vbuf_translate_part_run, NULL);
+   }
+
+   u_vbuf_translate_part_run(&parts[num_parts - 1], 0);
+
+   for (i = 0; i < num_parts - 1; i++) {
+      util_queue_fence_wait(&parts[i].fence);
+      util_queue_fence_destroy(&parts[i].fence);
+   }
+}
+
+/* Not a cryptographic hash, only meant to catch the vertex data changing.
+ * It works on 4 independent 64-bit lanes, so that it runs at close to
+ * memory speed. */
+static uint64_t
+u_vbuf_checksum(const uint8_t *data, unsigned size)
+{
+   const uint64_t prime = 0x100000001b3ull;
+   uint64_t h[4] = {
+      0xcbf29ce484222325ull ^ size, 0x9e3779b97f4a7c15ull,
+      0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull
+   };
+   const uint8_t *end = data + (size & ~31u);
+   uint64_t w[4];
+   unsigned i;
+
+   for (; data < end; data += sizeof(w)) {
+      memcpy(w, data, sizeof(w));
+      for (i = 0; i < 4; i++) {
+         h[i] = (h[i] ^ w[i]) * prime;
+         h[i] ^= h[i] >> 32;
+      }
+   }
+
+   if (size & 31) {
+      memset(w, 0, sizeof(w));
+      memcpy(w, data, size & 31);
+      for (i = 0; i < 4; i++) {
+         h[i] = (h[i] ^ w[i]) * prime;
+         h[i] ^= h[i] >> 32;
+      }
+   }
+
+   return (h[0] ^ (h[1] * prime)) + (h[2] ^ (h[3] * prime));
+}
+
+static void
+u_vbuf_translation_release(struct u_vbuf *mgr,
+                           struct u_vbuf_translation *tr)
+{
+   if (tr->buffer) {
+      mgr->translation_cache_bytes -= tr->buffer->width0;
+      pipe_resource_reference(&tr->buffer, NULL);
+   }
+}
+
+/**
+ * Return the cached translation of the range, or claim the least recently
+ * used entry for it. A claimed entry has src == NULL.
+ */
+static struct u_vbuf_translation *
+u_vbuf_translation_find(struct u_vbuf *mgr, const struct translate_key *key,
+                        const struct pipe_vertex_buffer *vb,
+                        unsigned src_offset, unsigned src_size,
+                        int start_vertex, unsigned num_vertices)
+{
+   struct u_vbuf_translation *lru = &mgr->translations[0];
+   unsigned i;
+
+   for (i = 0; i < VBUF_CACHE_SIZE; i++) {
+      struct u_vbuf_translation *tr = &mgr->translations[i];
+
+      if (tr->src == vb->buffer.resource &&
+          tr->src_offset == src_offset &&
+          tr->src_stride == vb->stride &&
+          tr->src_size == src_size &&
+          tr->start_vertex == start_vertex &&
+          tr->num_vertices == num_vertices &&
+          translate_key_compare(&tr->key, key) == 0) {
+         tr->last_use = ++mgr->translation_clock;
+         return tr;
+      }
+
+      if ((int)(tr->last_use - lru->last_use) < 0)
+         lru = &mgr->translations[i];
+   }
+
+   u_vbuf_translation_release(mgr, lru);
+   lru->src = NULL;
+   lru->num_changes = 0;
+   lru->last_use = ++mgr->translation_clock;
+   return lru;
+}
+
+/**
+ * Convert the vertices into a new buffer owned by the cache entry.
+ */
+static boolean
+u_vbuf_translation_create_buffer(struct u_vbuf *mgr,
+                                 struct u_vbuf_translation *entry,
+                                 struct translate *tr,
+                                 const struct translate_key *key,
+                                 unsigned vb_mask, uint8_t *const maps[],
+                                 unsigned max_index)
+{
+   struct pipe_transfer *transfer;
+   unsigned offset, size;
+   uint8_t *map;
+
+   offset = mgr->has_signed_vb_offset ?
+               0 : key->output_stride * entry->start_vertex;
+   size = offset + key->output_stride * entry->num_vertices;
+
+   if (mgr->translation_cache_bytes + size > VBUF_CACHE_MAX_BYTES)
+      return FALSE;
+
+   entry->buffer = pipe_buffer_create(mgr->pipe->screen,
+                                      PIPE_BIND_VERTEX_BUFFER,
+                                      PIPE_USAGE_DEFAULT, size);
+   if (!entry->buffer)
+      return FALSE;
+
+   map = pipe_buffer_map(mgr->pipe, entry->buffer,
+                         PIPE_TRANSFER_WRITE |
+                         PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE,
+                         &transfer);
+   if (!map) {
+      pipe_resource_reference(&entry->buffer, NULL);
+      return FALSE;
+   }
+
+   u_vbuf_translate_run(mgr, tr, key, vb_mask, maps, max_index,
+                        entry->num_vertices, map + offset);
+   pipe_buffer_unmap(mgr->pipe, transfer);
+
+   entry->buffer_offset = offset;
+   mgr->translation_cache_bytes += size;
+   return TRUE;
+}
+
 static enum pipe_error
 u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
                          const struct pipe_draw_info *info,
@@ -394,6 +704,8 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
 {
    struct translate *tr;
    struct pipe_transfer *vb_transfer[PIPE_MAX_ATTRIBS] = {0};
+   uint8_t *maps[PIPE_MAX_ATTRIBS] = {0};
+   unsigned offsets[PIPE_MAX_ATTRIBS], sizes[PIPE_MAX_ATTRIBS];
    struct pipe_resource *out_buffer = NULL;
    uint8_t *out_map;
    unsigned out_offset, mask;
@@ -441,6 +753,8 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
 
          map = pipe_buffer_map_range(mgr->pipe, vb->buffer.resource, offset, size,
                                      PIPE_TRANSFER_READ, &vb_transfer[i]);
+         offsets[i] = offset;
+         sizes[i] = size;
       }
 
       /* Subtract min_index so that indexing with the index buffer works. */
@@ -448,6 +762,7 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
          map -= (ptrdiff_t)vb->stride * min_index;
       }
 
+      maps[i] = map;
       tr->set_buffer(tr, i, map, vb->stride, info->max_index);
    }
 
@@ -489,19 +804,65 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
          pipe_buffer_unmap(mgr->pipe, transfer);
       }
    } else {
-      /* Create and map the output buffer. */
-      u_upload_alloc(mgr->pipe->stream_uploader,
-                     mgr->has_signed_vb_offset ?
-                        0 : key->output_stride * start_vertex,
-                     key->output_stride * num_vertices, 4,
-                     &out_offset, &out_buffer,
-                     (void**)&out_map);
-      if (!out_buffer)
-         return PIPE_ERROR_OUT_OF_MEMORY;
+      struct u_vbuf_translation *entry = NULL;
+      unsigned vb = ffs(vb_mask) - 1;
+
+      /* Look for a cached translation. */
+      if (util_is_power_of_two_nonzero(vb_mask) && vb_transfer[vb] &&
+          start_vertex >= 0 &&
+          key->output_stride * num_vertices >= VBUF_CACHE_MIN_BYTES) {
+         entry = u_vbuf_translation_find(mgr, key, &mgr->vertex_buffer[vb],
+                                         offsets[vb], sizes[vb],
+                                         start_vertex, num_vertices);
+
+         if (entry->num_changes < VBUF_CACHE_MAX_CHANGES) {
+            uint64_t checksum = u_vbuf_checksum(maps[vb], sizes[vb]);
+
+            if (!entry->src) {
+               entry->src = mgr->vertex_buffer[vb].buffer.resource;
+               entry->src_offset = offsets[vb];
+               entry->src_stride = mgr->vertex_buffer[vb].stride;
+               entry->src_size = sizes[vb];
+               entry->start_vertex = start_vertex;
+               entry->num_vertices = num_vertices;
+               entry->key = *key;
+               entry->checksum = checksum;
+               entry = NULL;
+            } else if (entry->checksum != checksum) {
+               u_vbuf_translation_release(mgr, entry);
+               entry->checksum = checksum;
+               entry->num_changes++;
+               entry = NULL;
+            } else if (!entry->buffer &&
+                       !u_vbuf_translation_create_buffer(mgr, entry, tr, key,
+                                                         vb_mask, maps,
+                                                         info->max_index)) {
+               entry = NULL;
+            }
+         } else {
+            entry = NULL;
+         }
+      }
 
-      out_offset -= key->output_stride * start_vertex;
+      if (entry) {
+         pipe_resource_reference(&out_buffer, entry->buffer);
+         out_offset = entry->buffer_offset;
+      } else {
+         /* Create and map the output buffer. */
+         u_upload_alloc(mgr->pipe->stream_uploader,
+                        mgr->has_signed_vb_offset ?
+                           0 : key->output_stride * start_vertex,
+                        key->output_stride * num_vertices, 4,
+                        &out_offset, &out_buffer,
+                        (void**)&out_map);
+         if (!out_buffer)
+            return PIPE_ERROR_OUT_OF_MEMORY;
+
+         u_vbuf_translate_run(mgr, tr, key, vb_mask, maps, info->max_index,
+                              num_vertices, out_map);
+      }
 
-      tr->run(tr, 0, num_vertices, 0, 0, out_map);
+      out_offset -= key->output_stride * start_vertex;
    }
 
    /* Unmap all buffers. */
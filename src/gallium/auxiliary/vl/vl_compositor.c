@@ -25,11 +25,40 @@
  *
  **************************************************************************/
 
+#include "util/u_debug.h"
 #include "util/u_sampler.h"
 
 #include "vl_compositor_gfx.h"
 #include "vl_compositor_cs.h"
 
+DEBUG_GET_ONCE_BOOL_OPTION(vl_compute, "VL_COMPOSITOR_COMPUTE", true)
+
+/* The compute back end does deinterlacing, colour space conversion and
+ * scaling of a layer in a single dispatch straight into the destination,
+ * so use it whenever the driver can run it.  VL_COMPOSITOR_COMPUTE=false
+ * falls back to the graphics back end.
+ */
+static bool
+cs_composit_supported(struct pipe_screen *screen, bool gfx_supported)
+{
+   if (!screen->get_param(screen, PIPE_CAP_TGSI_TEX_TXF_LZ) ||
+       !screen->get_param(screen, PIPE_CAP_TGSI_DIV))
+      return false;
+
+   if (gfx_supported && !debug_get_option_vl_compute())
+      return false;
+
+   if (screen->get_param(screen, PIPE_CAP_PREFER_COMPUTE_FOR_MULTIMEDIA))
+      return true;
+
+   return screen->get_param(screen, PIPE_CAP_COMPUTE) &&
+          (screen->get_shader_param(screen, PIPE_SHADER_COMPUTE,
+                                    PIPE_SHADER_CAP_SUPPORTED_IRS) &
+           (1 << PIPE_SHADER_IR_TGSI)) &&
+          screen->get_shader_param(screen, PIPE_SHADER_COMPUTE,
+                                   PIPE_SHADER_CAP_MAX_SHADER_IMAGES) > 0;
+}
+
 static bool
 init_shaders(struct vl_compositor *c)
 {
@@ -764,11 +793,9 @@ vl_compositor_init(struct vl_compositor *c, struct pipe_context *pipe)
 
    memset(c, 0, sizeof(*c));
 
-   c->pipe_cs_composit_supported = pipe->screen->get_param(pipe->screen, PIPE_CAP_PREFER_COMPUTE_FOR_MULTIMEDIA) &&
-            pipe->screen->get_param(pipe->screen, PIPE_CAP_TGSI_TEX_TXF_LZ) &&
-            pipe->screen->get_param(pipe->screen, PIPE_CAP_TGSI_DIV);
-
    c->pipe_gfx_supported = pipe->screen->get_param(pipe->screen, PIPE_CAP_GRAPHICS);
+   c->pipe_cs_composit_supported = cs_composit_supported(pipe->screen,
+                                                         c->pipe_gfx_supported);
    c->pipe = pipe;
 
    if (!init_pipe_state(c)) {
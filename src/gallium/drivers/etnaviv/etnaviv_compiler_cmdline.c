@@ -113,7 +113,8 @@ main(int argc, char **argv)
       return 1;
    }
 
-   etna_mesa_debug = ETNA_DBG_MSGS;
+   /* this reads TGSI, so always use the TGSI compiler */
+   etna_mesa_debug = ETNA_DBG_MSGS | ETNA_DBG_TGSI;
 
    while (n < argc) {
       if (!strcmp(argv[n], "--verbose")) {
@@ -536,6 +536,28 @@ etna_optimize_loop(nir_shader *s)
    while (progress);
 }
 
+static unsigned
+etna_count_loops(struct exec_list *list)
+{
+   unsigned count = 0;
+
+   foreach_list_typed(nir_cf_node, node, node, list) {
+      switch (node->type) {
+      case nir_cf_node_if:
+         count += etna_count_loops(&nir_cf_node_as_if(node)->then_list);
+         count += etna_count_loops(&nir_cf_node_as_if(node)->else_list);
+         break;
+      case nir_cf_node_loop:
+         count += 1 + etna_count_loops(&nir_cf_node_as_loop(node)->body);
+         break;
+      default:
+         break;
+      }
+   }
+
+   return count;
+}
+
 static int
 etna_glsl_type_size(const struct glsl_type *type, bool bindless)
 {
@@ -579,7 +601,6 @@ etna_compile_shader_nir(struct etna_shader_variant *v)
    const struct etna_specs *specs = c->specs;
 
    v->stage = s->info.stage;
-   v->num_loops = 0; /* TODO */
    v->vs_id_in_reg = -1;
    v->vs_pos_out_reg = -1;
    v->vs_pointsize_out_reg = -1;
@@ -620,6 +641,12 @@ etna_compile_shader_nir(struct etna_shader_variant *v)
 
    etna_optimize_loop(s);
 
+   /* shorten live ranges: comparisons are cheap to keep next to their users,
+    * and ubo loads occupy a temp from the LOAD on
+    */
+   OPT_V(s, nir_opt_sink, nir_move_comparisons | nir_move_load_ubo);
+   OPT_V(s, nir_opt_move, nir_move_comparisons | nir_move_load_ubo);
+
    /* use opt_algebraic between int_to_float and boot_to_float because
     * int_to_float emits ftrunc, and ftrunc lowering generates bool ops
     */
@@ -652,6 +679,8 @@ etna_compile_shader_nir(struct etna_shader_variant *v)
 
    NIR_PASS_V(s, etna_lower_alu, c);
 
+   v->num_loops = etna_count_loops(&nir_shader_get_entrypoint(s)->body);
+
    if (DBG_ENABLED(ETNA_DBG_DUMP_SHADERS))
       nir_print_shader(s, stdout);
 
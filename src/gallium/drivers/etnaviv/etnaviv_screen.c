@@ -72,7 +72,7 @@ static const struct debug_named_value debug_options[] = {
    {"draw_stall",     ETNA_DBG_DRAW_STALL, "Stall FE/PE after each rendered primitive"},
    {"shaderdb",       ETNA_DBG_SHADERDB, "Enable shaderdb output"},
    {"no_singlebuffer",ETNA_DBG_NO_SINGLEBUF, "Disable single buffer feature"},
-   {"nir",            ETNA_DBG_NIR, "use new NIR compiler"},
+   {"tgsi",           ETNA_DBG_TGSI, "use old TGSI compiler"},
    DEBUG_NAMED_VALUE_END
 };
 
@@ -157,7 +157,7 @@ etna_screen_get_param(struct pipe_screen *pscreen, enum pipe_cap param)
       return screen->drm_version >= ETNA_DRM_VERSION_FENCE_FD;
    case PIPE_CAP_TGSI_FS_POSITION_IS_SYSVAL:
    case PIPE_CAP_TGSI_FS_FACE_IS_INTEGER_SYSVAL: /* note: not integer */
-      return DBG_ENABLED(ETNA_DBG_NIR);
+      return !DBG_ENABLED(ETNA_DBG_TGSI);
    case PIPE_CAP_TGSI_FS_POINT_IS_SYSVAL:
       return 0;
 
@@ -329,7 +329,7 @@ etna_screen_get_shader_param(struct pipe_screen *pscreen,
                 ? screen->specs.fragment_sampler_count
                 : screen->specs.vertex_sampler_count;
    case PIPE_SHADER_CAP_PREFERRED_IR:
-      return DBG_ENABLED(ETNA_DBG_NIR) ? PIPE_SHADER_IR_NIR : PIPE_SHADER_IR_TGSI;
+      return !DBG_ENABLED(ETNA_DBG_TGSI) ? PIPE_SHADER_IR_NIR : PIPE_SHADER_IR_TGSI;
    case PIPE_SHADER_CAP_MAX_CONST_BUFFER_SIZE:
       return shader == PIPE_SHADER_FRAGMENT
                 ? screen->specs.max_ps_uniforms * sizeof(float[4])
@@ -74,7 +74,7 @@ etna_link_shaders(struct etna_context *ctx, struct compiled_shader_state *cs,
 
 #ifdef DEBUG
    if (DBG_ENABLED(ETNA_DBG_DUMP_SHADERS)) {
-      if (DBG_ENABLED(ETNA_DBG_NIR)) {
+      if (!DBG_ENABLED(ETNA_DBG_TGSI)) {
          etna_dump_shader_nir(vs);
          etna_dump_shader_nir(fs);
       } else {
@@ -84,7 +84,7 @@ etna_link_shaders(struct etna_context *ctx, struct compiled_shader_state *cs,
    }
 #endif
 
-   if (DBG_ENABLED(ETNA_DBG_NIR))
+   if (!DBG_ENABLED(ETNA_DBG_TGSI))
       failed = etna_link_shader_nir(&link, vs, fs);
    else
       failed = etna_link_shader(&link, vs, fs);
@@ -308,7 +308,7 @@ dump_shader_info(struct etna_shader_variant *v, struct pipe_debug_callback *debu
          "SHADER-DB: %s prog %d/%d: %u immediates %u loops\n",
          etna_shader_stage(v),
          v->shader->id, v->id,
-         v->code_size,
+         v->code_size / 4,
          v->num_temps,
          etna_shader_stage(v),
          v->shader->id, v->id,
@@ -385,7 +385,7 @@ etna_create_shader_state(struct pipe_context *pctx,
    shader->id = id++;
    shader->specs = &ctx->specs;
 
-   if (DBG_ENABLED(ETNA_DBG_NIR))
+   if (!DBG_ENABLED(ETNA_DBG_TGSI))
       shader->nir = (pss->type == PIPE_SHADER_IR_NIR) ? pss->ir.nir :
                      tgsi_to_nir(pss->tokens, pctx->screen);
    else
@@ -418,7 +418,7 @@ etna_delete_shader_state(struct pipe_context *pctx, void *ss)
       if (t->bo)
          etna_bo_del(t->bo);
 
-      if (DBG_ENABLED(ETNA_DBG_NIR))
+      if (!DBG_ENABLED(ETNA_DBG_TGSI))
          etna_destroy_shader_nir(t);
       else
          etna_destroy_shader(t);
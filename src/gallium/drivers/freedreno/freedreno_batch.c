@@ -432,6 +432,19 @@ fd_batch_add_dep(struct fd_batch *batch, struct fd_batch *dep)
 	DBG("%p: added dependency on %p", batch, dep);
 }
 
+/* With reordering, a batch touching a resource written by another batch
+ * can just depend on the writer, rather than flushing it right away, as
+ * long as the writer doesn't (recursively) depend on the batch already:
+ */
+static bool
+defer_write_batch(struct fd_batch *batch, struct fd_resource *rsc)
+{
+	if (!batch->ctx->screen->reorder)
+		return false;
+
+	return !(recursive_dependents_mask(rsc->write_batch) & (1 << batch->idx));
+}
+
 static void
 flush_write_batch(struct fd_resource *rsc)
 {
@@ -469,7 +482,11 @@ fd_batch_resource_used(struct fd_batch *batch, struct fd_resource *rsc, bool wri
 			struct fd_batch_cache *cache = &batch->ctx->screen->batch_cache;
 			struct fd_batch *dep;
 
-			if (rsc->write_batch && rsc->write_batch != batch)
+			/* the writer is also in batch_mask, so a dependency on it
+			 * gets added below:
+			 */
+			if (rsc->write_batch && rsc->write_batch != batch &&
+					!defer_write_batch(batch, rsc))
 				flush_write_batch(rsc);
 
 			foreach_batch(dep, cache, rsc->batch_mask) {
@@ -488,12 +505,23 @@ fd_batch_resource_used(struct fd_batch *batch, struct fd_resource *rsc, bool wri
 		}
 		fd_batch_reference_locked(&rsc->write_batch, batch);
 	} else {
-		/* If reading a resource pending a write, go ahead and flush the
-		 * writer.  This avoids situations where we end up having to
-		 * flush the current batch in _resource_used()
+		/* If reading a resource pending a write, make the writer a
+		 * dependency, and take it out of the cache so further draws
+		 * to it don't end up being visible to us.  Otherwise go ahead
+		 * and flush the writer.  This avoids situations where we end
+		 * up having to flush the current batch in _resource_used()
 		 */
-		if (rsc->write_batch && rsc->write_batch != batch)
-			flush_write_batch(rsc);
+		if (rsc->write_batch && rsc->write_batch != batch) {
+			if (defer_write_batch(batch, rsc)) {
+				struct fd_batch *b = NULL;
+				fd_batch_reference_locked(&b, rsc->write_batch);
+				fd_batch_add_dep(batch, b);
+				fd_bc_invalidate_batch(b, false);
+				fd_batch_reference_locked(&b, NULL);
+			} else {
+				flush_write_batch(rsc);
+			}
+		}
 	}
 
 	if (rsc->batch_mask & (1 << batch->idx)) {
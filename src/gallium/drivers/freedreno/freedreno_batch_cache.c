@@ -362,6 +362,11 @@ batch_from_key(struct fd_batch_cache *cache, struct key *key,
 	if (entry) {
 		free(key);
 		fd_batch_reference(&batch, (struct fd_batch *)entry->data);
+		/* picking up where an earlier batch for this framebuffer left
+		 * off saves resolving and then restoring its tiles:
+		 */
+		if (batch->needs_flush)
+			ctx->stats.batch_restore_skipped++;
 		return batch;
 	}
 
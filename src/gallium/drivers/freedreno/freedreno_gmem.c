@@ -409,6 +409,68 @@ render_sysmem(struct fd_batch *batch)
 		ctx->emit_sysmem_fini(batch);
 }
 
+/* Rough per-bin costs of tiled rendering, in bytes of memory traffic
+ * we'd rather spend instead: the tile setup and binning overhead, and
+ * replaying each draw once per bin.
+ */
+#define BIN_COST          (16 * 1024)
+#define BIN_DRAW_COST     (2 * 1024)
+
+/* Rendering to sysmem, a draw is assumed to write this fraction of the
+ * batch's scissor area:
+ */
+#define DRAW_COVERAGE_DIV 4
+
+/* For batches which could go either way (ie. no clears, blending, depth/
+ * stencil, etc), compare the restore/resolve traffic and per-bin overhead
+ * of GMEM against the color writes of rendering straight to sysmem:
+ */
+static bool
+sysmem_is_cheaper(struct fd_batch *batch)
+{
+	struct fd_context *ctx = batch->ctx;
+	struct fd_gmem_stateobj *gmem = &ctx->gmem;
+	struct pipe_framebuffer_state *pfb = &batch->framebuffer;
+	struct pipe_scissor_state *scissor = &batch->max_scissor;
+	uint32_t cpp = 0, restore_cpp = 0, resolve_cpp = 0;
+	uint64_t area, gmem_cost, sysmem_cost;
+	unsigned nbins;
+	unsigned i;
+
+	if (batch->num_draws == 0)
+		return true;
+
+	for (i = 0; i < pfb->nr_cbufs; i++) {
+		uint32_t c;
+
+		if (!pfb->cbufs[i])
+			continue;
+
+		c = util_format_get_blocksize(pfb->cbufs[i]->format);
+		cpp += c;
+		if (batch->restore & (PIPE_CLEAR_COLOR0 << i))
+			restore_cpp += c;
+		if (batch->resolve & (PIPE_CLEAR_COLOR0 << i))
+			resolve_cpp += c;
+	}
+
+	calculate_tiles(batch);
+
+	area = (uint64_t)(scissor->maxx - scissor->minx) *
+		(scissor->maxy - scissor->miny);
+	nbins = gmem->nbins_x * gmem->nbins_y;
+
+	gmem_cost = area * (restore_cpp + resolve_cpp) +
+		nbins * (BIN_COST + batch->num_draws * BIN_DRAW_COST);
+	sysmem_cost = area * cpp * batch->num_draws / DRAW_COVERAGE_DIV;
+
+	DBG("%p: gmem_cost=%uK, sysmem_cost=%uK (%u draws, %u bins)", batch,
+		(unsigned)(gmem_cost / 1024), (unsigned)(sysmem_cost / 1024),
+		batch->num_draws, nbins);
+
+	return sysmem_cost < gmem_cost;
+}
+
 static void
 flush_ring(struct fd_batch *batch)
 {
@@ -430,19 +492,16 @@ fd_gmem_render_tiles(struct fd_batch *batch)
 	bool sysmem = false;
 
 	if (ctx->emit_sysmem_prep && !batch->nondraw) {
-		if (batch->cleared || batch->gmem_reason ||
-				((batch->num_draws > 5) && !batch->blit) ||
+		if ((pfb->nr_cbufs == 0) && !pfb->zsbuf) {
+			/* For ARB_framebuffer_no_attachments: */
+			sysmem = true;
+		} else if (batch->cleared || batch->gmem_reason ||
 				(pfb->samples > 1)) {
 			DBG("GMEM: cleared=%x, gmem_reason=%x, num_draws=%u, samples=%u",
 				batch->cleared, batch->gmem_reason, batch->num_draws,
 				pfb->samples);
 		} else if (!(fd_mesa_debug & FD_DBG_NOBYPASS)) {
-			sysmem = true;
-		}
-
-		/* For ARB_framebuffer_no_attachments: */
-		if ((pfb->nr_cbufs == 0) && !pfb->zsbuf) {
-			sysmem = true;
+			sysmem = batch->blit || sysmem_is_cheaper(batch);
 		}
 	}
 
@@ -138,6 +138,7 @@ static const struct pipe_driver_query_info sw_query_list[] = {
 	FQ("batches-gmem", BATCH_GMEM, UINT64, AVERAGE),
 	FQ("batches-nondraw", BATCH_NONDRAW, UINT64, AVERAGE),
 	FQ("restores", BATCH_RESTORE, UINT64, AVERAGE),
+	FQ("restores-skipped", BATCH_RESTORE_SKIPPED, UINT64, AVERAGE),
 	PQ("prims-emitted", PRIMITIVES_EMITTED, UINT64, AVERAGE),
 	FQ("staging", STAGING_UPLOADS, UINT64, AVERAGE),
 	FQ("shadow", SHADOW_UPLOADS, UINT64, AVERAGE),
@@ -53,6 +53,7 @@
 #include "compiler/spirv/nir_spirv.h"
 
 #include "pipe/p_context.h"
+#include "util/os_time.h"
 
 static void dump_info(struct ir3_shader_variant *so, const char *str)
 {
@@ -272,6 +273,7 @@ static void print_usage(void)
 	printf("    --stream-out      - enable stream-out (aka transform feedback)\n");
 	printf("    --ucp MASK        - bitmask of enabled user-clip-planes\n");
 	printf("    --gpu GPU_ID      - specify gpu-id (default 320)\n");
+	printf("    --stats           - print shader-db stats and compile time to stderr\n");
 	printf("    --help            - show this message\n");
 }
 
@@ -290,6 +292,8 @@ int main(int argc, char **argv)
 	const char *entry;
 	void *ptr;
 	bool from_spirv = false;
+	bool stats = false;
+	int64_t start;
 	size_t size;
 
 	memset(&s, 0, sizeof(s));
@@ -390,6 +394,12 @@ int main(int argc, char **argv)
 			continue;
 		}
 
+		if (!strcmp(argv[n], "--stats")) {
+			stats = true;
+			n++;
+			continue;
+		}
+
 		if (!strcmp(argv[n], "--help")) {
 			print_usage();
 			return 0;
@@ -491,6 +501,7 @@ int main(int argc, char **argv)
 	s.compiler = compiler;
 	s.nir = nir;
 
+	start = os_time_get_nano();
 	ir3_optimize_nir(&s, nir, NULL);
 
 	v.key = key;
@@ -503,5 +514,27 @@ int main(int argc, char **argv)
 		fprintf(stderr, "compiler failed!\n");
 		return ret;
 	}
+	int64_t compile_time = os_time_get_nano() - start;
+
 	dump_info(&v, info);
+
+	/* The counts of the driver's shader-db message (filled in when
+	 * dump_info() assembles the shader), and how long NIR optimization
+	 * and the compile took.  ir3 never spills.
+	 */
+	if (stats) {
+		fprintf(stderr, "%s%s shader: %u inst, %u dwords, "
+				"%u half, %u full, %u constlen, "
+				"%u (ss), %u (sy), %d max_sun, %d loops, %.3f ms\n",
+				v.binning_pass ? "B" : "",
+				ir3_shader_stage(&s),
+				v.info.instrs_count,
+				v.info.sizedwords,
+				v.info.max_half_reg + 1,
+				v.info.max_reg + 1,
+				v.constlen,
+				v.info.ss, v.info.sy,
+				v.max_sun, v.loops,
+				compile_time / 1e6);
+	}
 }
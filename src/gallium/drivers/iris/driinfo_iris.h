@@ -12,6 +12,10 @@ DRI_CONF_SECTION_PERFORMANCE
    DRI_CONF_OPT_BEGIN_V(bo_reuse, enum, 1, "0:1")
       DRI_CONF_DESC(en, "Buffer object reuse")
    DRI_CONF_OPT_END
+
+   DRI_CONF_OPT_BEGIN_B(disable_threaded_context, "false")
+      DRI_CONF_DESC(en, "Disable offloading state emission to a driver thread (u_threaded_context)")
+   DRI_CONF_OPT_END
 //= END VERBATIM
 
 DRI_CONF_SECTION_END
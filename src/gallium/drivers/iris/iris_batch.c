@@ -244,6 +244,8 @@ iris_init_batch(struct iris_batch *batch,
       batch->decoder.max_vbo_decoded_lines = 32;
    }
 
+   iris_init_batch_gpu_trace(batch);
+
    iris_batch_reset(batch);
 }
 
@@ -416,6 +418,9 @@ iris_batch_free(struct iris_batch *batch)
 
    iris_destroy_hw_context(bufmgr, batch->hw_ctx_id);
 
+   u_trace_fini(&batch->trace);
+   u_trace_context_fini(&batch->trace_context);
+
    _mesa_hash_table_destroy(batch->cache.render, NULL);
    _mesa_set_destroy(batch->cache.depth, NULL);
 
@@ -618,6 +623,12 @@ _iris_batch_flush(struct iris_batch *batch, const char *file, int line)
    if (iris_batch_bytes_used(batch) == 0)
       return;
 
+   /* Split the traced render pass at the end of the batch. */
+   if (batch->trace_render_pass_open && batch->trace.depth == 1) {
+      u_trace_end(&batch->trace);
+      batch->trace_render_pass_open = false;
+   }
+
    iris_finish_batch(batch);
 
    if (unlikely(INTEL_DEBUG &
@@ -648,6 +659,8 @@ _iris_batch_flush(struct iris_batch *batch, const char *file, int line)
 
    int ret = submit_batch(batch);
 
+   u_trace_flush(&batch->trace);
+
    batch->exec_count = 0;
    batch->aperture_space = 0;
 
@@ -29,6 +29,7 @@
 #include <string.h>
 
 #include "util/u_dynarray.h"
+#include "util/u_trace.h"
 
 #include "drm-uapi/i915_drm.h"
 #include "common/gen_decoder.h"
@@ -126,6 +127,13 @@ struct iris_batch {
 
    /** Have we emitted any draw calls to this batch? */
    bool contains_draw;
+
+   /** GPU timestamp tracepoints of this batch, see iris_gpu_trace.c */
+   struct u_trace_context trace_context;
+   struct u_trace trace;
+   /** Is a render pass active, and is it currently traced in this batch? */
+   bool trace_render_pass;
+   bool trace_render_pass_open;
 };
 
 void iris_init_batch(struct iris_batch *batch,
@@ -452,7 +452,7 @@ iris_blit(struct pipe_context *ctx, const struct pipe_blit_info *info)
    if (iris_batch_references(batch, src_res->bo))
       tex_cache_flush_hack(batch, src_fmt.fmt, src_res->surf.format);
 
-   if (dst_res->base.target == PIPE_BUFFER)
+   if (dst_res->base.b.target == PIPE_BUFFER)
       util_range_add(&dst_res->valid_buffer_range, dst_x0, dst_x1);
 
    struct blorp_batch blorp_batch;
@@ -485,9 +485,9 @@ iris_blit(struct pipe_context *ctx, const struct pipe_blit_info *info)
       struct iris_resource *src_res, *dst_res, *junk;
       iris_get_depth_stencil_resources(info->src.resource, &junk, &src_res);
       iris_get_depth_stencil_resources(info->dst.resource, &junk, &dst_res);
-      iris_blorp_surf_for_resource(&ice->vtbl, &src_surf, &src_res->base,
+      iris_blorp_surf_for_resource(&ice->vtbl, &src_surf, &src_res->base.b,
                                    ISL_AUX_USAGE_NONE, info->src.level, false);
-      iris_blorp_surf_for_resource(&ice->vtbl, &dst_surf, &dst_res->base,
+      iris_blorp_surf_for_resource(&ice->vtbl, &dst_surf, &dst_res->base.b,
                                    ISL_AUX_USAGE_NONE, info->dst.level, true);
 
       for (int slice = 0; slice < info->dst.box.depth; slice++) {
@@ -683,8 +683,8 @@ iris_resource_copy_region(struct pipe_context *ctx,
       iris_get_depth_stencil_resources(src, &junk, &s_src_res);
       iris_get_depth_stencil_resources(dst, &junk, &s_dst_res);
 
-      iris_copy_region(&ice->blorp, batch, &s_dst_res->base, dst_level, dstx,
-                       dsty, dstz, &s_src_res->base, src_level, src_box);
+      iris_copy_region(&ice->blorp, batch, &s_dst_res->base.b, dst_level, dstx,
+                       dsty, dstz, &s_src_res->base.b, src_level, src_box);
    }
 
    iris_flush_and_dirty_for_history(ice, batch, (struct iris_resource *) dst,
@@ -144,6 +144,23 @@ struct iris_bufmgr {
 
    struct util_vma_heap vma_allocator[IRIS_MEMZONE_COUNT];
 
+   /**
+    * Thread trimming the BO cache and closing idle zombies once a second,
+    * so that doesn't happen inline when freeing BOs.
+    */
+   thrd_t cleanup_thread;
+   cnd_t cleanup_cond;
+   bool has_cleanup_thread;
+   bool cleanup_thread_exit;
+
+   /** BO cache statistics, printed on destroy with INTEL_DEBUG=buf. */
+   struct {
+      unsigned hits;
+      unsigned neighbor_hits;
+      unsigned misses;
+      unsigned purged;
+   } cache_stats;
+
    bool has_llc:1;
    bool bo_reuse:1;
 };
@@ -379,13 +396,17 @@ alloc_bo_from_cache(struct iris_bufmgr *bufmgr,
 
       list_del(&cur->head);
 
-      /* Tell the kernel we need this BO.  If it still exists, we're done! */
-      if (iris_bo_madvise(cur, I915_MADV_WILLNEED)) {
+      /* If the BO was marked purgeable, tell the kernel we need it again.
+       * If it still exists, we're done!
+       */
+      if (!cur->purgeable || iris_bo_madvise(cur, I915_MADV_WILLNEED)) {
+         cur->purgeable = false;
          bo = cur;
          break;
       }
 
       /* This BO was purged, throw it out and keep looking. */
+      bufmgr->cache_stats.purged++;
       bo_free(cur);
    }
 
@@ -493,6 +514,26 @@ bo_alloc_internal(struct iris_bufmgr *bufmgr,
                                false);
    }
 
+   /* Failing that, an idle BO from the next size class is still much
+    * cheaper than a fresh one, as long as it isn't too much bigger.
+    */
+   struct bo_cache_bucket *next_bucket =
+      bucket && bucket + 1 < &bufmgr->cache_bucket[bufmgr->num_buckets] ?
+      bucket + 1 : NULL;
+   if (!bo && next_bucket && next_bucket->size * 3 <= bucket->size * 4) {
+      bo = alloc_bo_from_cache(bufmgr, next_bucket, alignment, memzone,
+                               flags, false);
+      if (bo)
+         bufmgr->cache_stats.neighbor_hits++;
+   }
+
+   if (bucket) {
+      if (bo)
+         bufmgr->cache_stats.hits++;
+      else
+         bufmgr->cache_stats.misses++;
+   }
+
    mtx_unlock(&bufmgr->lock);
 
    if (!bo) {
@@ -761,7 +802,10 @@ bo_free(struct iris_bo *bo)
    }
 }
 
-/** Frees all cached buffers significantly older than @time. */
+/**
+ * Frees all cached buffers significantly older than @time, and lets the
+ * kernel purge the ones which were freed before @time.
+ */
 static void
 cleanup_bo_cache(struct iris_bufmgr *bufmgr, time_t time)
 {
@@ -773,13 +817,22 @@ cleanup_bo_cache(struct iris_bufmgr *bufmgr, time_t time)
    for (i = 0; i < bufmgr->num_buckets; i++) {
       struct bo_cache_bucket *bucket = &bufmgr->cache_bucket[i];
 
+      /* The buckets are in the order the BOs were freed in. */
       list_for_each_entry_safe(struct iris_bo, bo, &bucket->head, head) {
-         if (time - bo->free_time <= 1)
+         if (bo->free_time == time)
             break;
 
-         list_del(&bo->head);
-
-         bo_free(bo);
+         if (time - bo->free_time > 1) {
+            list_del(&bo->head);
+            bo_free(bo);
+         } else if (!bo->purgeable) {
+            if (iris_bo_madvise(bo, I915_MADV_DONTNEED)) {
+               bo->purgeable = true;
+            } else {
+               list_del(&bo->head);
+               bo_free(bo);
+            }
+         }
       }
    }
 
@@ -797,6 +850,30 @@ cleanup_bo_cache(struct iris_bufmgr *bufmgr, time_t time)
    bufmgr->time = time;
 }
 
+static int
+bo_cache_cleanup_thread(void *data)
+{
+   struct iris_bufmgr *bufmgr = data;
+
+   mtx_lock(&bufmgr->lock);
+
+   while (!bufmgr->cleanup_thread_exit) {
+      struct timespec time, wake;
+
+      clock_gettime(CLOCK_MONOTONIC, &time);
+      cleanup_bo_cache(bufmgr, time.tv_sec);
+
+      /* cnd_timedwait() takes an absolute TIME_UTC timeout. */
+      timespec_get(&wake, TIME_UTC);
+      wake.tv_sec += 1;
+      cnd_timedwait(&bufmgr->cleanup_cond, &bufmgr->lock, &wake);
+   }
+
+   mtx_unlock(&bufmgr->lock);
+
+   return 0;
+}
+
 static void
 bo_unreference_final(struct iris_bo *bo, time_t time)
 {
@@ -808,8 +885,10 @@ bo_unreference_final(struct iris_bo *bo, time_t time)
    bucket = NULL;
    if (bo->reusable)
       bucket = bucket_for_size(bufmgr, bo->size);
-   /* Put the buffer into our internal cache for reuse if we can. */
-   if (bucket && iris_bo_madvise(bo, I915_MADV_DONTNEED)) {
+   /* Put the buffer into our internal cache for reuse if we can.  It stays
+    * resident until cleanup_bo_cache() marks it purgeable.
+    */
+   if (bucket) {
       bo->free_time = time;
       bo->name = NULL;
 
@@ -837,7 +916,8 @@ iris_bo_unreference(struct iris_bo *bo)
 
       if (p_atomic_dec_zero(&bo->refcount)) {
          bo_unreference_final(bo, time.tv_sec);
-         cleanup_bo_cache(bufmgr, time.tv_sec);
+         if (!bufmgr->has_cleanup_thread)
+            cleanup_bo_cache(bufmgr, time.tv_sec);
       }
 
       mtx_unlock(&bufmgr->lock);
@@ -1193,6 +1273,21 @@ iris_bo_wait(struct iris_bo *bo, int64_t timeout_ns)
 void
 iris_bufmgr_destroy(struct iris_bufmgr *bufmgr)
 {
+   if (bufmgr->has_cleanup_thread) {
+      mtx_lock(&bufmgr->lock);
+      bufmgr->cleanup_thread_exit = true;
+      cnd_signal(&bufmgr->cleanup_cond);
+      mtx_unlock(&bufmgr->lock);
+
+      thrd_join(bufmgr->cleanup_thread, NULL);
+      cnd_destroy(&bufmgr->cleanup_cond);
+   }
+
+   DBG("BO cache: %u hits (%u from a bigger size class), %u misses, "
+       "%u purged\n", bufmgr->cache_stats.hits,
+       bufmgr->cache_stats.neighbor_hits, bufmgr->cache_stats.misses,
+       bufmgr->cache_stats.purged);
+
    mtx_destroy(&bufmgr->lock);
 
    /* Free any cached buffer objects we were going to reuse */
@@ -1627,5 +1722,14 @@ iris_bufmgr_init(struct gen_device_info *devinfo, int fd, bool bo_reuse)
    bufmgr->handle_table =
       _mesa_hash_table_create(NULL, key_hash_uint, key_uint_equal);
 
+   /* If the thread can't be started, clean up whenever a BO is freed. */
+   if (cnd_init(&bufmgr->cleanup_cond) == thrd_success) {
+      if (thrd_create(&bufmgr->cleanup_thread, bo_cache_cleanup_thread,
+                      bufmgr) == thrd_success)
+         bufmgr->has_cleanup_thread = true;
+      else
+         cnd_destroy(&bufmgr->cleanup_cond);
+   }
+
    return bufmgr;
 }
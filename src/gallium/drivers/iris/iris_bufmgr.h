@@ -156,6 +156,13 @@ struct iris_bo {
 
    time_t free_time;
 
+   /**
+    * Whether this cached BO has been marked I915_MADV_DONTNEED.  That only
+    * happens once it has sat in the cache for a while, so BOs which get
+    * reused right away never need a madvise round trip.
+    */
+   bool purgeable;
+
    /** Mapped address for the buffer, saved across map/unmap cycles */
    void *map_cpu;
    /** GTT virtual address for the buffer, saved across map/unmap cycles */
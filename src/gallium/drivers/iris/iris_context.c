@@ -204,6 +204,7 @@ iris_destroy_context(struct pipe_context *ctx)
    u_upload_destroy(ice->query_buffer_uploader);
 
    slab_destroy_child(&ice->transfer_pool);
+   slab_destroy_child(&ice->transfer_pool_unsync);
 
    iris_batch_free(&ice->batches[IRIS_BATCH_RENDER]);
    iris_batch_free(&ice->batches[IRIS_BATCH_COMPUTE]);
@@ -280,6 +281,7 @@ iris_create_context(struct pipe_screen *pscreen, void *priv, unsigned flags)
    iris_init_binder(ice);
 
    slab_create_child(&ice->transfer_pool, &screen->transfer_pool);
+   slab_create_child(&ice->transfer_pool_unsync, &screen->transfer_pool);
 
    ice->state.surface_uploader =
       u_upload_create(ctx, 16384, PIPE_BIND_CUSTOM, PIPE_USAGE_IMMUTABLE,
@@ -317,5 +319,18 @@ iris_create_context(struct pipe_screen *pscreen, void *priv, unsigned flags)
    ice->vtbl.init_compute_context(screen, &ice->batches[IRIS_BATCH_COMPUTE],
                                   &ice->vtbl, &ice->dbg);
 
-   return ctx;
+   iris_init_gpu_trace(ice);
+
+   if (!(flags & PIPE_CONTEXT_PREFER_THREADED) ||
+       (flags & PIPE_CONTEXT_COMPUTE_ONLY) ||
+       screen->driconf.disable_threaded_context)
+      return ctx;
+
+   /* Offload state emission and batch building to a driver thread.  We
+    * don't implement create_fence, so flushes that want a fence still
+    * synchronize with that thread.
+    */
+   return threaded_context_create(ctx, &screen->transfer_pool,
+                                  iris_replace_buffer_storage,
+                                  NULL, &ice->thrctx);
 }
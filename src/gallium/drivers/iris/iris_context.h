@@ -284,6 +284,9 @@ struct iris_uncompiled_shader {
 
    /** Surface state for const_data */
    struct iris_state_ref const_data_state;
+
+   /** The guessed variant compiled at create time, if any */
+   struct iris_precompile *precompile;
 };
 
 enum iris_surface_group {
@@ -531,6 +534,15 @@ struct iris_context {
    /** Slab allocator for iris_transfer_map objects. */
    struct slab_child_pool transfer_pool;
 
+   /**
+    * Slab allocator for unsynchronized transfers, which u_threaded_context
+    * calls from the application thread.
+    */
+   struct slab_child_pool transfer_pool_unsync;
+
+   /** The u_threaded_context wrapping us, if any. */
+   struct threaded_context *thrctx;
+
    struct iris_vtable vtbl;
 
    struct blorp_context blorp;
@@ -539,6 +551,45 @@ struct iris_context {
 
    struct u_upload_mgr *query_buffer_uploader;
 
+   /** The functions wrapped by GPU timestamp tracing. */
+   struct {
+      void (*blit)(struct pipe_context *ctx,
+                   const struct pipe_blit_info *info);
+      void (*resource_copy_region)(struct pipe_context *ctx,
+                                   struct pipe_resource *dst,
+                                   unsigned dst_level,
+                                   unsigned dstx, unsigned dsty, unsigned dstz,
+                                   struct pipe_resource *src,
+                                   unsigned src_level,
+                                   const struct pipe_box *src_box);
+      void (*clear)(struct pipe_context *ctx, unsigned buffers,
+                    const union pipe_color_union *color,
+                    double depth, unsigned stencil);
+      void (*clear_render_target)(struct pipe_context *ctx,
+                                  struct pipe_surface *dst,
+                                  const union pipe_color_union *color,
+                                  unsigned dstx, unsigned dsty,
+                                  unsigned width, unsigned height,
+                                  bool render_condition_enabled);
+      void (*clear_depth_stencil)(struct pipe_context *ctx,
+                                  struct pipe_surface *dst,
+                                  unsigned clear_flags,
+                                  double depth, unsigned stencil,
+                                  unsigned dstx, unsigned dsty,
+                                  unsigned width, unsigned height,
+                                  bool render_condition_enabled);
+      void (*launch_grid)(struct pipe_context *ctx,
+                          const struct pipe_grid_info *info);
+      void (*set_framebuffer_state)(struct pipe_context *ctx,
+                                    const struct pipe_framebuffer_state *state);
+      void (*draw_vbo)(struct pipe_context *ctx,
+                       const struct pipe_draw_info *info);
+      void (*multi_draw)(struct pipe_context *ctx,
+                         const struct pipe_draw_info *info,
+                         const struct pipe_draw_start_count *draws,
+                         unsigned num_draws);
+   } traced;
+
    struct {
       struct {
          /**
@@ -762,6 +813,7 @@ void iris_lost_context_state(struct iris_batch *batch);
 void iris_init_blit_functions(struct pipe_context *ctx);
 void iris_init_clear_functions(struct pipe_context *ctx);
 void iris_init_program_functions(struct pipe_context *ctx);
+void iris_init_screen_program_functions(struct pipe_screen *pscreen);
 void iris_init_resource_functions(struct pipe_context *ctx);
 void iris_update_compiled_shaders(struct iris_context *ice);
 void iris_update_compiled_compute_shader(struct iris_context *ice);
@@ -785,9 +837,18 @@ void iris_copy_region(struct blorp_context *blorp,
                       unsigned src_level,
                       const struct pipe_box *src_box);
 
+/* iris_gpu_trace.c */
+
+void iris_init_batch_gpu_trace(struct iris_batch *batch);
+void iris_init_gpu_trace(struct iris_context *ice);
+
 /* iris_draw.c */
 
 void iris_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *info);
+void iris_multi_draw(struct pipe_context *ctx,
+                     const struct pipe_draw_info *info,
+                     const struct pipe_draw_start_count *draws,
+                     unsigned num_draws);
 void iris_launch_grid(struct pipe_context *, const struct pipe_grid_info *);
 
 /* iris_pipe_control.c */
@@ -845,6 +906,13 @@ iris_disk_cache_retrieve(struct iris_context *ice,
                          const struct iris_uncompiled_shader *ish,
                          const void *prog_key,
                          uint32_t prog_key_size);
+void iris_disk_cache_store_blorp(struct disk_cache *cache,
+                                 const void *key, uint32_t key_size,
+                                 const struct iris_compiled_shader *shader,
+                                 uint32_t prog_data_size);
+struct iris_compiled_shader *
+iris_disk_cache_retrieve_blorp(struct iris_context *ice,
+                               const void *key, uint32_t key_size);
 
 /* iris_program_cache.c */
 
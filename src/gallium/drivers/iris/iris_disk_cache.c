@@ -228,6 +228,131 @@ iris_disk_cache_retrieve(struct iris_context *ice,
 #endif
 }
 
+/**
+ * Compute a disk cache key for a blorp shader key.
+ *
+ * Blorp keys are plain data, but they're tagged so they can never alias
+ * the NIR hash + program key used for API shaders.
+ */
+static void
+iris_disk_cache_compute_blorp_key(struct disk_cache *cache,
+                                  const void *key, uint32_t key_size,
+                                  cache_key cache_key)
+{
+   static const char tag[] = "blorp";
+   struct blob blob;
+
+   blob_init(&blob);
+   blob_write_bytes(&blob, tag, sizeof(tag));
+   blob_write_bytes(&blob, key, key_size);
+   disk_cache_compute_key(cache, blob.data, blob.size, cache_key);
+   blob_finish(&blob);
+}
+
+/**
+ * Store a newly compiled blorp shader in the disk cache.
+ */
+void
+iris_disk_cache_store_blorp(struct disk_cache *cache,
+                            const void *key, uint32_t key_size,
+                            const struct iris_compiled_shader *shader,
+                            uint32_t prog_data_size)
+{
+#ifdef ENABLE_SHADER_CACHE
+   if (!cache)
+      return;
+
+   /* Blorp shaders have no uniforms, system values or binding table. */
+   assert(shader->prog_data->nr_params == 0);
+   assert(shader->num_system_values == 0);
+
+   cache_key cache_key;
+   iris_disk_cache_compute_blorp_key(cache, key, key_size, cache_key);
+
+   if (debug) {
+      char sha1[41];
+      _mesa_sha1_format(sha1, cache_key);
+      fprintf(stderr, "[mesa disk cache] storing blorp %s\n", sha1);
+   }
+
+   struct blob blob;
+   blob_init(&blob);
+
+   /* Blorp has several kinds of prog data, so its size comes first. */
+   blob_write_uint32(&blob, prog_data_size);
+   blob_write_bytes(&blob, shader->prog_data, prog_data_size);
+   blob_write_bytes(&blob, shader->map, shader->prog_data->program_size);
+
+   disk_cache_put(cache, cache_key, blob.data, blob.size, NULL);
+   blob_finish(&blob);
+#endif
+}
+
+/**
+ * Search for a blorp shader in the disk cache.  If found, upload it to the
+ * in-memory program cache so we can use it.
+ */
+struct iris_compiled_shader *
+iris_disk_cache_retrieve_blorp(struct iris_context *ice,
+                               const void *key, uint32_t key_size)
+{
+#ifdef ENABLE_SHADER_CACHE
+   struct iris_screen *screen = (void *) ice->ctx.screen;
+   struct disk_cache *cache = screen->disk_cache;
+
+   if (!cache)
+      return NULL;
+
+   cache_key cache_key;
+   iris_disk_cache_compute_blorp_key(cache, key, key_size, cache_key);
+
+   if (debug) {
+      char sha1[41];
+      _mesa_sha1_format(sha1, cache_key);
+      fprintf(stderr, "[mesa disk cache] retrieving blorp %s: ", sha1);
+   }
+
+   size_t size;
+   void *buffer = disk_cache_get(cache, cache_key, &size);
+
+   if (debug)
+      fprintf(stderr, "%s\n", buffer ? "found" : "missing");
+
+   if (!buffer)
+      return NULL;
+
+   struct blob_reader blob;
+   blob_reader_init(&blob, buffer, size);
+
+   const uint32_t prog_data_size = blob_read_uint32(&blob);
+   struct brw_stage_prog_data *prog_data = ralloc_size(NULL, prog_data_size);
+   blob_copy_bytes(&blob, prog_data, prog_data_size);
+   const void *assembly = blob_read_bytes(&blob, prog_data->program_size);
+
+   if (blob.overrun) {
+      ralloc_free(prog_data);
+      free(buffer);
+      return NULL;
+   }
+
+   prog_data->param = NULL;
+   prog_data->pull_param = NULL;
+
+   struct iris_binding_table bt;
+   memset(&bt, 0, sizeof(bt));
+
+   struct iris_compiled_shader *shader =
+      iris_upload_shader(ice, IRIS_CACHE_BLORP, key_size, key, assembly,
+                         prog_data, NULL, NULL, 0, 0, &bt);
+
+   free(buffer);
+
+   return shader;
+#else
+   return NULL;
+#endif
+}
+
 /**
  * Initialize the on-disk shader cache.
  */
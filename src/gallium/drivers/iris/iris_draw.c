@@ -200,13 +200,43 @@ iris_simple_draw_vbo(struct iris_context *ice,
    ice->vtbl.upload_render_state(ice, batch, draw);
 }
 
+static void
+iris_multi_draw_vbo(struct iris_context *ice,
+                    const struct pipe_draw_info *dinfo,
+                    const struct pipe_draw_start_count *draws,
+                    unsigned num_draws)
+{
+   struct pipe_draw_info info = *dinfo;
+
+   uint64_t orig_dirty = ice->state.dirty;
+
+   for (unsigned i = 0; i < num_draws; i++) {
+      info.start = draws[i].start;
+      info.count = draws[i].count;
+      if (dinfo->increment_draw_id)
+         info.drawid = dinfo->drawid + i;
+
+      iris_simple_draw_vbo(ice, &info);
+
+      ice->state.dirty &= ~IRIS_ALL_DIRTY_FOR_RENDER;
+   }
+
+   /* Put this back for post-draw resolves, we'll clear it again after. */
+   ice->state.dirty = orig_dirty;
+}
+
 /**
- * The pipe->draw_vbo() driver hook.  Performs a draw on the GPU.
+ * Common code for the draw_vbo() and multi_draw() hooks.
+ *
+ * Shaders, resolves and the binder are only updated once for all of the
+ * draws, which then just re-emit the packets that change between them.
  */
-void
-iris_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *info)
+static void
+iris_draw(struct iris_context *ice,
+          const struct pipe_draw_info *info,
+          const struct pipe_draw_start_count *draws,
+          unsigned num_draws)
 {
-   struct iris_context *ice = (struct iris_context *) ctx;
    struct iris_screen *screen = (struct iris_screen*)ice->ctx.screen;
    const struct gen_device_info *devinfo = &screen->devinfo;
    struct iris_batch *batch = &ice->batches[IRIS_BATCH_RENDER];
@@ -245,6 +275,8 @@ iris_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *info)
 
    if (info->indirect)
       iris_indirect_draw_vbo(ice, info);
+   else if (draws)
+      iris_multi_draw_vbo(ice, info, draws, num_draws);
    else
       iris_simple_draw_vbo(ice, info);
 
@@ -255,6 +287,28 @@ iris_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *info)
    ice->state.dirty &= ~IRIS_ALL_DIRTY_FOR_RENDER;
 }
 
+/**
+ * The pipe->draw_vbo() driver hook.  Performs a draw on the GPU.
+ */
+void
+iris_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *info)
+{
+   iris_draw((struct iris_context *) ctx, info, NULL, 1);
+}
+
+/**
+ * The pipe->multi_draw() driver hook.  Performs several draws which only
+ * differ in their vertex or index range.
+ */
+void
+iris_multi_draw(struct pipe_context *ctx,
+                const struct pipe_draw_info *info,
+                const struct pipe_draw_start_count *draws,
+                unsigned num_draws)
+{
+   iris_draw((struct iris_context *) ctx, info, draws, num_draws);
+}
+
 static void
 iris_update_grid_size_resource(struct iris_context *ice,
                                const struct pipe_grid_info *grid)
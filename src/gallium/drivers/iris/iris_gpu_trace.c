@@ -0,0 +1,275 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file iris_gpu_trace.c
+ *
+ * GPU timestamp tracepoints (GALLIUM_GPU_TRACE), using util/u_trace.h.
+ *
+ * Each batch is a separate track, because the render and compute batches
+ * execute independently.  Render passes are traced on the render batch from
+ * one framebuffer change to the next.  They are split at batch boundaries,
+ * and reopened by the next draw, so that empty batches still aren't
+ * submitted.
+ *
+ * The pipe_context functions are only wrapped when tracing is enabled.
+ */
+
+#include "iris_context.h"
+#include "iris_resource.h"
+
+static void *
+iris_gpu_trace_create_ts_buffer(struct u_trace_context *utctx,
+                                unsigned num_timestamps)
+{
+   struct iris_batch *batch = utctx->pctx;
+
+   return iris_bo_alloc(batch->screen->bufmgr, "gpu trace timestamps",
+                        num_timestamps * 8, IRIS_MEMZONE_OTHER);
+}
+
+static void
+iris_gpu_trace_delete_ts_buffer(struct u_trace_context *utctx,
+                                void *timestamps)
+{
+   iris_bo_unreference(timestamps);
+}
+
+static void
+iris_gpu_trace_record_ts(struct u_trace *ut, void *timestamps, unsigned idx)
+{
+   struct iris_batch *batch = ut->utctx->pctx;
+
+   iris_emit_pipe_control_write(batch, "gpu trace timestamp",
+                                PIPE_CONTROL_WRITE_TIMESTAMP,
+                                timestamps, idx * 8, 0ull);
+}
+
+static uint64_t
+iris_gpu_trace_read_ts(struct u_trace_context *utctx,
+                       void *timestamps, unsigned idx)
+{
+   struct iris_batch *batch = utctx->pctx;
+   const uint64_t freq = batch->screen->devinfo.timestamp_frequency;
+   uint64_t *map, ticks;
+
+   /* This waits for the batch that wrote the timestamps. */
+   map = iris_bo_map(NULL, timestamps, MAP_READ);
+   if (!map)
+      return 0;
+
+   /* Split up the scaling, 1000000000 * ticks would overflow after a few
+    * minutes of uptime.
+    */
+   ticks = map[idx];
+   return ticks / freq * 1000000000ull +
+          ticks % freq * 1000000000ull / freq;
+}
+
+void
+iris_init_batch_gpu_trace(struct iris_batch *batch)
+{
+   u_trace_context_init(&batch->trace_context, batch,
+                        batch->name == IRIS_BATCH_RENDER ? "iris render" :
+                                                           "iris compute",
+                        iris_gpu_trace_create_ts_buffer,
+                        iris_gpu_trace_delete_ts_buffer,
+                        iris_gpu_trace_record_ts,
+                        iris_gpu_trace_read_ts);
+   u_trace_init(&batch->trace, &batch->trace_context);
+}
+
+static void
+iris_gpu_trace_blit(struct pipe_context *ctx,
+                    const struct pipe_blit_info *info)
+{
+   struct iris_context *ice = (struct iris_context *) ctx;
+   struct u_trace *ut = &ice->batches[IRIS_BATCH_RENDER].trace;
+
+   u_trace_begin(ut, "blit", "blit");
+   ice->traced.blit(ctx, info);
+   u_trace_end(ut);
+}
+
+static void
+iris_gpu_trace_resource_copy_region(struct pipe_context *ctx,
+                                    struct pipe_resource *dst,
+                                    unsigned dst_level,
+                                    unsigned dstx, unsigned dsty,
+                                    unsigned dstz,
+                                    struct pipe_resource *src,
+                                    unsigned src_level,
+                                    const struct pipe_box *src_box)
+{
+   struct iris_context *ice = (struct iris_context *) ctx;
+   struct iris_batch *batch = &ice->batches[IRIS_BATCH_RENDER];
+
+   /* Buffer copies go to the compute batch if it uses the buffer. */
+   if (dst->target == PIPE_BUFFER &&
+       iris_batch_references(&ice->batches[IRIS_BATCH_COMPUTE],
+                             iris_resource_bo(dst)))
+      batch = &ice->batches[IRIS_BATCH_COMPUTE];
+
+   u_trace_begin(&batch->trace, "resource_copy_region", "blit");
+   ice->traced.resource_copy_region(ctx, dst, dst_level, dstx, dsty, dstz,
+                                    src, src_level, src_box);
+   u_trace_end(&batch->trace);
+}
+
+static void
+iris_gpu_trace_clear(struct pipe_context *ctx, unsigned buffers,
+                     const union pipe_color_union *color,
+                     double depth, unsigned stencil)
+{
+   struct iris_context *ice = (struct iris_context *) ctx;
+   struct u_trace *ut = &ice->batches[IRIS_BATCH_RENDER].trace;
+
+   u_trace_begin(ut, "clear", "clear");
+   ice->traced.clear(ctx, buffers, color, depth, stencil);
+   u_trace_end(ut);
+}
+
+static void
+iris_gpu_trace_clear_render_target(struct pipe_context *ctx,
+                                   struct pipe_surface *dst,
+                                   const union pipe_color_union *color,
+                                   unsigned dstx, unsigned dsty,
+                                   unsigned width, unsigned height,
+                                   bool render_condition_enabled)
+{
+   struct iris_context *ice = (struct iris_context *) ctx;
+   struct u_trace *ut = &ice->batches[IRIS_BATCH_RENDER].trace;
+
+   u_trace_begin(ut, "clear_render_target", "clear");
+   ice->traced.clear_render_target(ctx, dst, color, dstx, dsty,
+                                   width, height, render_condition_enabled);
+   u_trace_end(ut);
+}
+
+static void
+iris_gpu_trace_clear_depth_stencil(struct pipe_context *ctx,
+                                   struct pipe_surface *dst,
+                                   unsigned clear_flags,
+                                   double depth, unsigned stencil,
+                                   unsigned dstx, unsigned dsty,
+                                   unsigned width, unsigned height,
+                                   bool render_condition_enabled)
+{
+   struct iris_context *ice = (struct iris_context *) ctx;
+   struct u_trace *ut = &ice->batches[IRIS_BATCH_RENDER].trace;
+
+   u_trace_begin(ut, "clear_depth_stencil", "clear");
+   ice->traced.clear_depth_stencil(ctx, dst, clear_flags, depth, stencil,
+                                   dstx, dsty, width, height,
+                                   render_condition_enabled);
+   u_trace_end(ut);
+}
+
+static void
+iris_gpu_trace_launch_grid(struct pipe_context *ctx,
+                           const struct pipe_grid_info *info)
+{
+   struct iris_context *ice = (struct iris_context *) ctx;
+   struct u_trace *ut = &ice->batches[IRIS_BATCH_COMPUTE].trace;
+
+   u_trace_begin(ut, "launch_grid", "compute");
+   ice->traced.launch_grid(ctx, info);
+   u_trace_end(ut);
+}
+
+static void
+iris_gpu_trace_set_framebuffer_state(struct pipe_context *ctx,
+                                     const struct pipe_framebuffer_state *state)
+{
+   struct iris_context *ice = (struct iris_context *) ctx;
+   struct iris_batch *batch = &ice->batches[IRIS_BATCH_RENDER];
+
+   ice->traced.set_framebuffer_state(ctx, state);
+
+   if (batch->trace_render_pass_open) {
+      u_trace_end(&batch->trace);
+      batch->trace_render_pass_open = false;
+   }
+
+   /* The render pass is opened by the first draw. */
+   batch->trace_render_pass = state->nr_cbufs || state->zsbuf;
+}
+
+static inline void
+iris_gpu_trace_before_draw(struct iris_batch *batch)
+{
+   if (batch->trace_render_pass && !batch->trace_render_pass_open) {
+      u_trace_begin(&batch->trace, "render_pass", "render_pass");
+      batch->trace_render_pass_open = true;
+   }
+}
+
+static void
+iris_gpu_trace_draw_vbo(struct pipe_context *ctx,
+                        const struct pipe_draw_info *info)
+{
+   struct iris_context *ice = (struct iris_context *) ctx;
+
+   iris_gpu_trace_before_draw(&ice->batches[IRIS_BATCH_RENDER]);
+   ice->traced.draw_vbo(ctx, info);
+}
+
+static void
+iris_gpu_trace_multi_draw(struct pipe_context *ctx,
+                          const struct pipe_draw_info *info,
+                          const struct pipe_draw_start_count *draws,
+                          unsigned num_draws)
+{
+   struct iris_context *ice = (struct iris_context *) ctx;
+
+   iris_gpu_trace_before_draw(&ice->batches[IRIS_BATCH_RENDER]);
+   ice->traced.multi_draw(ctx, info, draws, num_draws);
+}
+
+#define IRIS_GPU_TRACE_WRAP(func)              \
+   if (ctx->func) {                            \
+      ice->traced.func = ctx->func;            \
+      ctx->func = iris_gpu_trace_##func;       \
+   }
+
+/**
+ * Wrap the traced context functions.  Must be called after the batches have
+ * been initialized and all context functions have been set.
+ */
+void
+iris_init_gpu_trace(struct iris_context *ice)
+{
+   struct pipe_context *ctx = &ice->ctx;
+
+   if (!u_trace_is_enabled(&ice->batches[IRIS_BATCH_RENDER].trace))
+      return;
+
+   IRIS_GPU_TRACE_WRAP(blit);
+   IRIS_GPU_TRACE_WRAP(resource_copy_region);
+   IRIS_GPU_TRACE_WRAP(clear);
+   IRIS_GPU_TRACE_WRAP(clear_render_target);
+   IRIS_GPU_TRACE_WRAP(clear_depth_stencil);
+   IRIS_GPU_TRACE_WRAP(launch_grid);
+   IRIS_GPU_TRACE_WRAP(set_framebuffer_state);
+   IRIS_GPU_TRACE_WRAP(draw_vbo);
+   IRIS_GPU_TRACE_WRAP(multi_draw);
+}
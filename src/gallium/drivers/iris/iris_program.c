@@ -915,14 +915,123 @@ last_vue_stage(struct iris_context *ice)
 }
 
 /**
- * Compile a vertex shader, and upload the assembly.
+ * A compiled shader variant which hasn't been uploaded to a context's
+ * program cache yet.  Everything hangs off of mem_ctx.
+ */
+struct iris_shader_variant {
+   void *mem_ctx;
+   const unsigned *program;
+   struct brw_stage_prog_data *prog_data;
+   enum brw_param_builtin *system_values;
+   unsigned num_system_values;
+   unsigned num_cbufs;
+   struct iris_binding_table bt;
+};
+
+/**
+ * Upload a compiled variant to the in-memory program cache, and store it
+ * in the disk cache.  The variant's memory is freed.
  */
 static struct iris_compiled_shader *
-iris_compile_vs(struct iris_context *ice,
-                struct iris_uncompiled_shader *ish,
-                const struct brw_vs_prog_key *key)
+iris_upload_variant(struct iris_context *ice,
+                    struct iris_uncompiled_shader *ish,
+                    enum iris_program_cache_id cache_id,
+                    const void *key, uint32_t key_size,
+                    struct iris_shader_variant *v)
 {
    struct iris_screen *screen = (struct iris_screen *)ice->ctx.screen;
+   uint32_t *so_decls = NULL;
+
+   if (ish) {
+      if (ish->compiled_once) {
+         iris_debug_recompile(ice, &ish->nir->info, key);
+      } else {
+         ish->compiled_once = true;
+      }
+   }
+
+   if (cache_id == IRIS_CACHE_VS || cache_id == IRIS_CACHE_TES ||
+       cache_id == IRIS_CACHE_GS) {
+      struct brw_vue_prog_data *vue_prog_data = (void *) v->prog_data;
+      so_decls = ice->vtbl.create_so_decl_list(&ish->stream_output,
+                                               &vue_prog_data->vue_map);
+   }
+
+   struct iris_compiled_shader *shader =
+      iris_upload_shader(ice, cache_id, key_size, key, v->program,
+                         v->prog_data, so_decls, v->system_values,
+                         v->num_system_values, v->num_cbufs, &v->bt);
+
+   if (ish)
+      iris_disk_cache_store(screen->disk_cache, ish, shader, key, key_size);
+
+   ralloc_free(v->mem_ctx);
+   v->mem_ctx = NULL;
+   return shader;
+}
+
+/**
+ * A guessed variant compiled on the screen's compile queue.
+ *
+ * The first context which needs the shader uploads the result into its
+ * program cache; other contexts compile their own (or hit the disk cache).
+ */
+struct iris_precompile {
+   struct util_queue_fence ready;
+   struct iris_screen *screen;
+   struct iris_uncompiled_shader *ish;
+
+   union brw_any_prog_key key;
+
+   /** Compiler messages have nowhere to go on the queue. */
+   struct pipe_debug_callback dbg;
+
+   bool compiled;
+   struct iris_shader_variant variant;
+
+   /** Set once a context (or the CSO's destruction) takes the variant. */
+   int claimed;
+};
+
+/**
+ * Upload the precompiled variant of a shader, if nobody has yet.
+ *
+ * We only block on the compile queue if the job is building the variant
+ * we're about to look for; otherwise we'll pick it up on a later update.
+ */
+static void
+iris_publish_precompile(struct iris_context *ice,
+                        struct iris_uncompiled_shader *ish,
+                        enum iris_program_cache_id cache_id,
+                        const void *key, uint32_t key_size)
+{
+   struct iris_precompile *pc = ish ? ish->precompile : NULL;
+
+   if (!pc || p_atomic_read(&pc->claimed))
+      return;
+
+   if (!util_queue_fence_is_signalled(&pc->ready) &&
+       memcmp(&pc->key, key, key_size) != 0)
+      return;
+
+   util_queue_fence_wait(&pc->ready);
+
+   if (p_atomic_cmpxchg(&pc->claimed, 0, 1) != 0 || !pc->compiled)
+      return;
+
+   iris_upload_variant(ice, ish, cache_id, &pc->key, key_size, &pc->variant);
+}
+
+/**
+ * Compile a vertex shader variant, without uploading it.
+ */
+static bool
+iris_compile_vs_variant(const struct iris_screen *screen,
+                        struct pipe_debug_callback *dbg,
+                        const struct iris_uncompiled_shader *ish,
+                        const struct brw_vs_prog_key *key,
+                        struct iris_shader_variant *v)
+{
    const struct brw_compiler *compiler = screen->compiler;
    const struct gen_device_info *devinfo = &screen->devinfo;
    void *mem_ctx = ralloc_context(NULL);
@@ -968,7 +1077,7 @@ iris_compile_vs(struct iris_context *ice,
 
    char *error_str = NULL;
    const unsigned *program =
-      brw_compile_vs(compiler, &ice->dbg, mem_ctx, &key_no_ucp, vs_prog_data,
+      brw_compile_vs(compiler, dbg, mem_ctx, &key_no_ucp, vs_prog_data,
                      nir, -1, NULL, &error_str);
    if (program == NULL) {
       dbg_printf("Failed to compile vertex shader: %s\n", error_str);
@@ -976,25 +1085,31 @@ iris_compile_vs(struct iris_context *ice,
       return false;
    }
 
-   if (ish->compiled_once) {
-      iris_debug_recompile(ice, &nir->info, &key->base);
-   } else {
-      ish->compiled_once = true;
-   }
-
-   uint32_t *so_decls =
-      ice->vtbl.create_so_decl_list(&ish->stream_output,
-                                    &vue_prog_data->vue_map);
+   v->mem_ctx = mem_ctx;
+   v->program = program;
+   v->prog_data = prog_data;
+   v->system_values = system_values;
+   v->num_system_values = num_system_values;
+   v->num_cbufs = num_cbufs;
+   v->bt = bt;
+   return true;
+}
 
-   struct iris_compiled_shader *shader =
-      iris_upload_shader(ice, IRIS_CACHE_VS, sizeof(*key), key, program,
-                         prog_data, so_decls, system_values, num_system_values,
-                         num_cbufs, &bt);
+/**
+ * Compile a vertex shader, and upload the assembly.
+ */
+static struct iris_compiled_shader *
+iris_compile_vs(struct iris_context *ice,
+                struct iris_uncompiled_shader *ish,
+                const struct brw_vs_prog_key *key)
+{
+   struct iris_screen *screen = (struct iris_screen *)ice->ctx.screen;
+   struct iris_shader_variant v;
 
-   iris_disk_cache_store(screen->disk_cache, ish, shader, key, sizeof(*key));
+   if (!iris_compile_vs_variant(screen, &ice->dbg, ish, key, &v))
+      return NULL;
 
-   ralloc_free(mem_ctx);
-   return shader;
+   return iris_upload_variant(ice, ish, IRIS_CACHE_VS, key, sizeof(*key), &v);
 }
 
 /**
@@ -1014,6 +1129,8 @@ iris_update_compiled_vs(struct iris_context *ice)
    struct brw_vs_prog_key key = { KEY_INIT(devinfo->gen) };
    ice->vtbl.populate_vs_key(ice, &ish->nir->info, last_vue_stage(ice), &key);
 
+   iris_publish_precompile(ice, ish, IRIS_CACHE_VS, &key, sizeof(key));
+
    struct iris_compiled_shader *old = ice->shaders.prog[IRIS_CACHE_VS];
    struct iris_compiled_shader *shader =
       iris_find_cached_shader(ice, IRIS_CACHE_VS, sizeof(key), &key);
@@ -1107,14 +1224,15 @@ get_unified_tess_slots(const struct iris_context *ice,
 }
 
 /**
- * Compile a tessellation control shader, and upload the assembly.
+ * Compile a tessellation control shader variant, without uploading it.
  */
-static struct iris_compiled_shader *
-iris_compile_tcs(struct iris_context *ice,
-                 struct iris_uncompiled_shader *ish,
-                 const struct brw_tcs_prog_key *key)
+static bool
+iris_compile_tcs_variant(const struct iris_screen *screen,
+                         struct pipe_debug_callback *dbg,
+                         const struct iris_uncompiled_shader *ish,
+                         const struct brw_tcs_prog_key *key,
+                         struct iris_shader_variant *v)
 {
-   struct iris_screen *screen = (struct iris_screen *)ice->ctx.screen;
    const struct brw_compiler *compiler = screen->compiler;
    const struct nir_shader_compiler_options *options =
       compiler->glsl_compiler_options[MESA_SHADER_TESS_CTRL].NirOptions;
@@ -1179,7 +1297,7 @@ iris_compile_tcs(struct iris_context *ice,
 
    char *error_str = NULL;
    const unsigned *program =
-      brw_compile_tcs(compiler, &ice->dbg, mem_ctx, key, tcs_prog_data, nir,
+      brw_compile_tcs(compiler, dbg, mem_ctx, key, tcs_prog_data, nir,
                       -1, NULL, &error_str);
    if (program == NULL) {
       dbg_printf("Failed to compile control shader: %s\n", error_str);
@@ -1187,24 +1305,31 @@ iris_compile_tcs(struct iris_context *ice,
       return false;
    }
 
-   if (ish) {
-      if (ish->compiled_once) {
-         iris_debug_recompile(ice, &nir->info, &key->base);
-      } else {
-         ish->compiled_once = true;
-      }
-   }
+   v->mem_ctx = mem_ctx;
+   v->program = program;
+   v->prog_data = prog_data;
+   v->system_values = system_values;
+   v->num_system_values = num_system_values;
+   v->num_cbufs = num_cbufs;
+   v->bt = bt;
+   return true;
+}
 
-   struct iris_compiled_shader *shader =
-      iris_upload_shader(ice, IRIS_CACHE_TCS, sizeof(*key), key, program,
-                         prog_data, NULL, system_values, num_system_values,
-                         num_cbufs, &bt);
+/**
+ * Compile a tessellation control shader, and upload the assembly.
+ */
+static struct iris_compiled_shader *
+iris_compile_tcs(struct iris_context *ice,
+                 struct iris_uncompiled_shader *ish,
+                 const struct brw_tcs_prog_key *key)
+{
+   struct iris_screen *screen = (struct iris_screen *)ice->ctx.screen;
+   struct iris_shader_variant v;
 
-   if (ish)
-      iris_disk_cache_store(screen->disk_cache, ish, shader, key, sizeof(*key));
+   if (!iris_compile_tcs_variant(screen, &ice->dbg, ish, key, &v))
+      return NULL;
 
-   ralloc_free(mem_ctx);
-   return shader;
+   return iris_upload_variant(ice, ish, IRIS_CACHE_TCS, key, sizeof(*key), &v);
 }
 
 /**
@@ -1235,6 +1360,8 @@ iris_update_compiled_tcs(struct iris_context *ice)
                           &key.patch_outputs_written);
    ice->vtbl.populate_tcs_key(ice, &key);
 
+   iris_publish_precompile(ice, tcs, IRIS_CACHE_TCS, &key, sizeof(key));
+
    struct iris_compiled_shader *old = ice->shaders.prog[IRIS_CACHE_TCS];
    struct iris_compiled_shader *shader =
       iris_find_cached_shader(ice, IRIS_CACHE_TCS, sizeof(key), &key);
@@ -1255,14 +1382,15 @@ iris_update_compiled_tcs(struct iris_context *ice)
 }
 
 /**
- * Compile a tessellation evaluation shader, and upload the assembly.
+ * Compile a tessellation evaluation shader variant, without uploading it.
  */
-static struct iris_compiled_shader *
-iris_compile_tes(struct iris_context *ice,
-                 struct iris_uncompiled_shader *ish,
-                 const struct brw_tes_prog_key *key)
+static bool
+iris_compile_tes_variant(const struct iris_screen *screen,
+                         struct pipe_debug_callback *dbg,
+                         const struct iris_uncompiled_shader *ish,
+                         const struct brw_tes_prog_key *key,
+                         struct iris_shader_variant *v)
 {
-   struct iris_screen *screen = (struct iris_screen *)ice->ctx.screen;
    const struct brw_compiler *compiler = screen->compiler;
    void *mem_ctx = ralloc_context(NULL);
    struct brw_tes_prog_data *tes_prog_data =
@@ -1300,7 +1428,7 @@ iris_compile_tes(struct iris_context *ice,
 
    char *error_str = NULL;
    const unsigned *program =
-      brw_compile_tes(compiler, &ice->dbg, mem_ctx, key, &input_vue_map,
+      brw_compile_tes(compiler, dbg, mem_ctx, key, &input_vue_map,
                       tes_prog_data, nir, -1, NULL, &error_str);
    if (program == NULL) {
       dbg_printf("Failed to compile evaluation shader: %s\n", error_str);
@@ -1308,26 +1436,31 @@ iris_compile_tes(struct iris_context *ice,
       return false;
    }
 
-   if (ish->compiled_once) {
-      iris_debug_recompile(ice, &nir->info, &key->base);
-   } else {
-      ish->compiled_once = true;
-   }
-
-   uint32_t *so_decls =
-      ice->vtbl.create_so_decl_list(&ish->stream_output,
-                                    &vue_prog_data->vue_map);
-
+   v->mem_ctx = mem_ctx;
+   v->program = program;
+   v->prog_data = prog_data;
+   v->system_values = system_values;
+   v->num_system_values = num_system_values;
+   v->num_cbufs = num_cbufs;
+   v->bt = bt;
+   return true;
+}
 
-   struct iris_compiled_shader *shader =
-      iris_upload_shader(ice, IRIS_CACHE_TES, sizeof(*key), key, program,
-                         prog_data, so_decls, system_values, num_system_values,
-                         num_cbufs, &bt);
+/**
+ * Compile a tessellation evaluation shader, and upload the assembly.
+ */
+static struct iris_compiled_shader *
+iris_compile_tes(struct iris_context *ice,
+                 struct iris_uncompiled_shader *ish,
+                 const struct brw_tes_prog_key *key)
+{
+   struct iris_screen *screen = (struct iris_screen *)ice->ctx.screen;
+   struct iris_shader_variant v;
 
-   iris_disk_cache_store(screen->disk_cache, ish, shader, key, sizeof(*key));
+   if (!iris_compile_tes_variant(screen, &ice->dbg, ish, key, &v))
+      return NULL;
 
-   ralloc_free(mem_ctx);
-   return shader;
+   return iris_upload_variant(ice, ish, IRIS_CACHE_TES, key, sizeof(*key), &v);
 }
 
 /**
@@ -1348,6 +1481,8 @@ iris_update_compiled_tes(struct iris_context *ice)
    get_unified_tess_slots(ice, &key.inputs_read, &key.patch_inputs_read);
    ice->vtbl.populate_tes_key(ice, &ish->nir->info, last_vue_stage(ice), &key);
 
+   iris_publish_precompile(ice, ish, IRIS_CACHE_TES, &key, sizeof(key));
+
    struct iris_compiled_shader *old = ice->shaders.prog[IRIS_CACHE_TES];
    struct iris_compiled_shader *shader =
       iris_find_cached_shader(ice, IRIS_CACHE_TES, sizeof(key), &key);
@@ -1375,14 +1510,15 @@ iris_update_compiled_tes(struct iris_context *ice)
 }
 
 /**
- * Compile a geometry shader, and upload the assembly.
+ * Compile a geometry shader variant, without uploading it.
  */
-static struct iris_compiled_shader *
-iris_compile_gs(struct iris_context *ice,
-                struct iris_uncompiled_shader *ish,
-                const struct brw_gs_prog_key *key)
+static bool
+iris_compile_gs_variant(const struct iris_screen *screen,
+                        struct pipe_debug_callback *dbg,
+                        const struct iris_uncompiled_shader *ish,
+                        const struct brw_gs_prog_key *key,
+                        struct iris_shader_variant *v)
 {
-   struct iris_screen *screen = (struct iris_screen *)ice->ctx.screen;
    const struct brw_compiler *compiler = screen->compiler;
    const struct gen_device_info *devinfo = &screen->devinfo;
    void *mem_ctx = ralloc_context(NULL);
@@ -1420,7 +1556,7 @@ iris_compile_gs(struct iris_context *ice,
 
    char *error_str = NULL;
    const unsigned *program =
-      brw_compile_gs(compiler, &ice->dbg, mem_ctx, key, gs_prog_data, nir,
+      brw_compile_gs(compiler, dbg, mem_ctx, key, gs_prog_data, nir,
                      NULL, -1, NULL, &error_str);
    if (program == NULL) {
       dbg_printf("Failed to compile geometry shader: %s\n", error_str);
@@ -1428,25 +1564,31 @@ iris_compile_gs(struct iris_context *ice,
       return false;
    }
 
-   if (ish->compiled_once) {
-      iris_debug_recompile(ice, &nir->info, &key->base);
-   } else {
-      ish->compiled_once = true;
-   }
-
-   uint32_t *so_decls =
-      ice->vtbl.create_so_decl_list(&ish->stream_output,
-                                    &vue_prog_data->vue_map);
+   v->mem_ctx = mem_ctx;
+   v->program = program;
+   v->prog_data = prog_data;
+   v->system_values = system_values;
+   v->num_system_values = num_system_values;
+   v->num_cbufs = num_cbufs;
+   v->bt = bt;
+   return true;
+}
 
-   struct iris_compiled_shader *shader =
-      iris_upload_shader(ice, IRIS_CACHE_GS, sizeof(*key), key, program,
-                         prog_data, so_decls, system_values, num_system_values,
-                         num_cbufs, &bt);
+/**
+ * Compile a geometry shader, and upload the assembly.
+ */
+static struct iris_compiled_shader *
+iris_compile_gs(struct iris_context *ice,
+                struct iris_uncompiled_shader *ish,
+                const struct brw_gs_prog_key *key)
+{
+   struct iris_screen *screen = (struct iris_screen *)ice->ctx.screen;
+   struct iris_shader_variant v;
 
-   iris_disk_cache_store(screen->disk_cache, ish, shader, key, sizeof(*key));
+   if (!iris_compile_gs_variant(screen, &ice->dbg, ish, key, &v))
+      return NULL;
 
-   ralloc_free(mem_ctx);
-   return shader;
+   return iris_upload_variant(ice, ish, IRIS_CACHE_GS, key, sizeof(*key), &v);
 }
 
 /**
@@ -1469,6 +1611,8 @@ iris_update_compiled_gs(struct iris_context *ice)
       struct brw_gs_prog_key key = { KEY_INIT(devinfo->gen) };
       ice->vtbl.populate_gs_key(ice, &ish->nir->info, last_vue_stage(ice), &key);
 
+      iris_publish_precompile(ice, ish, IRIS_CACHE_GS, &key, sizeof(key));
+
       shader =
          iris_find_cached_shader(ice, IRIS_CACHE_GS, sizeof(key), &key);
 
@@ -1489,15 +1633,16 @@ iris_update_compiled_gs(struct iris_context *ice)
 }
 
 /**
- * Compile a fragment (pixel) shader, and upload the assembly.
+ * Compile a fragment (pixel) shader variant, without uploading it.
  */
-static struct iris_compiled_shader *
-iris_compile_fs(struct iris_context *ice,
-                struct iris_uncompiled_shader *ish,
-                const struct brw_wm_prog_key *key,
-                struct brw_vue_map *vue_map)
+static bool
+iris_compile_fs_variant(const struct iris_screen *screen,
+                        struct pipe_debug_callback *dbg,
+                        const struct iris_uncompiled_shader *ish,
+                        const struct brw_wm_prog_key *key,
+                        struct brw_vue_map *vue_map,
+                        struct iris_shader_variant *v)
 {
-   struct iris_screen *screen = (struct iris_screen *)ice->ctx.screen;
    const struct brw_compiler *compiler = screen->compiler;
    void *mem_ctx = ralloc_context(NULL);
    struct brw_wm_prog_data *fs_prog_data =
@@ -1530,7 +1675,7 @@ iris_compile_fs(struct iris_context *ice,
 
    char *error_str = NULL;
    const unsigned *program =
-      brw_compile_fs(compiler, &ice->dbg, mem_ctx, key, fs_prog_data,
+      brw_compile_fs(compiler, dbg, mem_ctx, key, fs_prog_data,
                      nir, -1, -1, -1, true, false, vue_map,
                      NULL, &error_str);
    if (program == NULL) {
@@ -1539,21 +1684,32 @@ iris_compile_fs(struct iris_context *ice,
       return false;
    }
 
-   if (ish->compiled_once) {
-      iris_debug_recompile(ice, &nir->info, &key->base);
-   } else {
-      ish->compiled_once = true;
-   }
+   v->mem_ctx = mem_ctx;
+   v->program = program;
+   v->prog_data = prog_data;
+   v->system_values = system_values;
+   v->num_system_values = num_system_values;
+   v->num_cbufs = num_cbufs;
+   v->bt = bt;
+   return true;
+}
 
-   struct iris_compiled_shader *shader =
-      iris_upload_shader(ice, IRIS_CACHE_FS, sizeof(*key), key, program,
-                         prog_data, NULL, system_values, num_system_values,
-                         num_cbufs, &bt);
+/**
+ * Compile a fragment (pixel) shader, and upload the assembly.
+ */
+static struct iris_compiled_shader *
+iris_compile_fs(struct iris_context *ice,
+                struct iris_uncompiled_shader *ish,
+                const struct brw_wm_prog_key *key,
+                struct brw_vue_map *vue_map)
+{
+   struct iris_screen *screen = (struct iris_screen *)ice->ctx.screen;
+   struct iris_shader_variant v;
 
-   iris_disk_cache_store(screen->disk_cache, ish, shader, key, sizeof(*key));
+   if (!iris_compile_fs_variant(screen, &ice->dbg, ish, key, vue_map, &v))
+      return NULL;
 
-   ralloc_free(mem_ctx);
-   return shader;
+   return iris_upload_variant(ice, ish, IRIS_CACHE_FS, key, sizeof(*key), &v);
 }
 
 /**
@@ -1575,6 +1731,8 @@ iris_update_compiled_fs(struct iris_context *ice)
    if (ish->nos & (1ull << IRIS_NOS_LAST_VUE_MAP))
       key.input_slots_valid = ice->shaders.last_vue_map->slots_valid;
 
+   iris_publish_precompile(ice, ish, IRIS_CACHE_FS, &key, sizeof(key));
+
    struct iris_compiled_shader *old = ice->shaders.prog[IRIS_CACHE_FS];
    struct iris_compiled_shader *shader =
       iris_find_cached_shader(ice, IRIS_CACHE_FS, sizeof(key), &key);
@@ -1749,12 +1907,13 @@ iris_update_compiled_shaders(struct iris_context *ice)
    }
 }
 
-static struct iris_compiled_shader *
-iris_compile_cs(struct iris_context *ice,
-                struct iris_uncompiled_shader *ish,
-                const struct brw_cs_prog_key *key)
+static bool
+iris_compile_cs_variant(const struct iris_screen *screen,
+                        struct pipe_debug_callback *dbg,
+                        const struct iris_uncompiled_shader *ish,
+                        const struct brw_cs_prog_key *key,
+                        struct iris_shader_variant *v)
 {
-   struct iris_screen *screen = (struct iris_screen *)ice->ctx.screen;
    const struct brw_compiler *compiler = screen->compiler;
    void *mem_ctx = ralloc_context(NULL);
    struct brw_cs_prog_data *cs_prog_data =
@@ -1776,7 +1935,7 @@ iris_compile_cs(struct iris_context *ice,
 
    char *error_str = NULL;
    const unsigned *program =
-      brw_compile_cs(compiler, &ice->dbg, mem_ctx, key, cs_prog_data,
+      brw_compile_cs(compiler, dbg, mem_ctx, key, cs_prog_data,
                      nir, -1, NULL, &error_str);
    if (program == NULL) {
       dbg_printf("Failed to compile compute shader: %s\n", error_str);
@@ -1784,21 +1943,28 @@ iris_compile_cs(struct iris_context *ice,
       return false;
    }
 
-   if (ish->compiled_once) {
-      iris_debug_recompile(ice, &nir->info, &key->base);
-   } else {
-      ish->compiled_once = true;
-   }
+   v->mem_ctx = mem_ctx;
+   v->program = program;
+   v->prog_data = prog_data;
+   v->system_values = system_values;
+   v->num_system_values = num_system_values;
+   v->num_cbufs = num_cbufs;
+   v->bt = bt;
+   return true;
+}
 
-   struct iris_compiled_shader *shader =
-      iris_upload_shader(ice, IRIS_CACHE_CS, sizeof(*key), key, program,
-                         prog_data, NULL, system_values, num_system_values,
-                         num_cbufs, &bt);
+static struct iris_compiled_shader *
+iris_compile_cs(struct iris_context *ice,
+                struct iris_uncompiled_shader *ish,
+                const struct brw_cs_prog_key *key)
+{
+   struct iris_screen *screen = (struct iris_screen *)ice->ctx.screen;
+   struct iris_shader_variant v;
 
-   iris_disk_cache_store(screen->disk_cache, ish, shader, key, sizeof(*key));
+   if (!iris_compile_cs_variant(screen, &ice->dbg, ish, key, &v))
+      return NULL;
 
-   ralloc_free(mem_ctx);
-   return shader;
+   return iris_upload_variant(ice, ish, IRIS_CACHE_CS, key, sizeof(*key), &v);
 }
 
 void
@@ -1813,6 +1979,8 @@ iris_update_compiled_compute_shader(struct iris_context *ice)
    struct brw_cs_prog_key key = { KEY_INIT(devinfo->gen) };
    ice->vtbl.populate_cs_key(ice, &key);
 
+   iris_publish_precompile(ice, ish, IRIS_CACHE_CS, &key, sizeof(key));
+
    struct iris_compiled_shader *old = ice->shaders.prog[IRIS_CACHE_CS];
    struct iris_compiled_shader *shader =
       iris_find_cached_shader(ice, IRIS_CACHE_CS, sizeof(key), &key);
@@ -1911,7 +2079,6 @@ iris_create_uncompiled_shader(struct pipe_context *ctx,
                               nir_shader *nir,
                               const struct pipe_stream_output_info *so_info)
 {
-   struct iris_context *ice = (void *)ctx;
    struct iris_screen *screen = (struct iris_screen *)ctx->screen;
    const struct gen_device_info *devinfo = &screen->devinfo;
 
@@ -1927,19 +2094,6 @@ iris_create_uncompiled_shader(struct pipe_context *ctx,
 
    nir_sweep(nir);
 
-   if (nir->constant_data_size > 0) {
-      unsigned data_offset;
-      u_upload_data(ice->shaders.uploader, 0, nir->constant_data_size,
-                    32, nir->constant_data, &data_offset, &ish->const_data);
-
-      struct pipe_shader_buffer psb = {
-         .buffer = ish->const_data,
-         .buffer_offset = data_offset,
-         .buffer_size = nir->constant_data_size,
-      };
-      iris_upload_ubo_ssbo_surf_state(ice, &psb, &ish->const_data_state, false);
-   }
-
    ish->program_id = get_new_program_id(screen);
    ish->nir = nir;
    if (so_info) {
@@ -1974,6 +2128,113 @@ iris_create_uncompiled_shader(struct pipe_context *ctx,
    return ish;
 }
 
+/**
+ * Upload the shader's constant data (and a SURFACE_STATE for it).
+ *
+ * This happens when the shader is first bound rather than when it's
+ * created, since u_threaded_context calls the create_*_state hooks from
+ * the application thread, where we can't use our uploaders.
+ */
+static void
+iris_upload_shader_const_data(struct iris_context *ice,
+                              struct iris_uncompiled_shader *ish)
+{
+   nir_shader *nir = ish->nir;
+   unsigned data_offset;
+
+   u_upload_data(ice->shaders.uploader, 0, nir->constant_data_size,
+                 32, nir->constant_data, &data_offset, &ish->const_data);
+
+   struct pipe_shader_buffer psb = {
+      .buffer = ish->const_data,
+      .buffer_offset = data_offset,
+      .buffer_size = nir->constant_data_size,
+   };
+   iris_upload_ubo_ssbo_surf_state(ice, &psb, &ish->const_data_state, false);
+}
+
+/**
+ * Whether to compile a guessed variant at create_*_state() time.
+ */
+static bool
+should_precompile(const struct iris_context *ice)
+{
+   const struct iris_screen *screen = (void *) ice->ctx.screen;
+
+   return screen->precompile;
+}
+
+static void
+iris_precompile_job(void *job, int thread_index)
+{
+   struct iris_precompile *pc = job;
+   const struct iris_screen *screen = pc->screen;
+   const struct iris_uncompiled_shader *ish = pc->ish;
+   struct iris_shader_variant *v = &pc->variant;
+
+   switch (ish->nir->info.stage) {
+   case MESA_SHADER_VERTEX:
+      pc->compiled =
+         iris_compile_vs_variant(screen, &pc->dbg, ish, &pc->key.vs, v);
+      break;
+   case MESA_SHADER_TESS_CTRL:
+      pc->compiled =
+         iris_compile_tcs_variant(screen, &pc->dbg, ish, &pc->key.tcs, v);
+      break;
+   case MESA_SHADER_TESS_EVAL:
+      pc->compiled =
+         iris_compile_tes_variant(screen, &pc->dbg, ish, &pc->key.tes, v);
+      break;
+   case MESA_SHADER_GEOMETRY:
+      pc->compiled =
+         iris_compile_gs_variant(screen, &pc->dbg, ish, &pc->key.gs, v);
+      break;
+   case MESA_SHADER_FRAGMENT:
+      pc->compiled =
+         iris_compile_fs_variant(screen, &pc->dbg, ish, &pc->key.wm, NULL, v);
+      break;
+   case MESA_SHADER_COMPUTE:
+      pc->compiled =
+         iris_compile_cs_variant(screen, &pc->dbg, ish, &pc->key.cs, v);
+      break;
+   default:
+      unreachable("invalid shader stage");
+   }
+}
+
+/**
+ * Compile the guessed variant of a new shader on the screen's compile
+ * queue.  iris_publish_precompile() picks up the result at draw time.
+ *
+ * The disk cache is checked first when we can; uploading a hit needs the
+ * context's uploaders, which u_threaded_context won't let us use from the
+ * create_*_state() hooks.
+ */
+static void
+iris_precompile(struct iris_context *ice,
+                struct iris_uncompiled_shader *ish,
+                const void *key, uint32_t key_size)
+{
+   struct iris_screen *screen = (void *) ice->ctx.screen;
+
+   if (!ice->thrctx && iris_disk_cache_retrieve(ice, ish, key, key_size))
+      return;
+
+   struct iris_precompile *pc = calloc(1, sizeof(*pc));
+   if (!pc)
+      return;
+
+   pc->screen = screen;
+   pc->ish = ish;
+   memcpy(&pc->key, key, key_size);
+
+   util_queue_fence_init(&pc->ready);
+
+   ish->precompile = pc;
+   util_queue_add_job(&screen->shader_compiler_queue, pc, &pc->ready,
+                      iris_precompile_job, NULL);
+}
+
 static struct iris_uncompiled_shader *
 iris_create_shader_state(struct pipe_context *ctx,
                          const struct pipe_shader_state *state)
@@ -2000,12 +2261,11 @@ iris_create_vs_state(struct pipe_context *ctx,
    if (ish->nir->info.clip_distance_array_size == 0)
       ish->nos |= (1ull << IRIS_NOS_RASTERIZER);
 
-   if (screen->precompile) {
+   if (should_precompile(ice)) {
       const struct gen_device_info *devinfo = &screen->devinfo;
       struct brw_vs_prog_key key = { KEY_INIT(devinfo->gen) };
 
-      if (!iris_disk_cache_retrieve(ice, ish, &key, sizeof(key)))
-         iris_compile_vs(ice, ish, &key);
+      iris_precompile(ice, ish, &key, sizeof(key));
    }
 
    return ish;
@@ -2021,7 +2281,7 @@ iris_create_tcs_state(struct pipe_context *ctx,
    struct iris_uncompiled_shader *ish = iris_create_shader_state(ctx, state);
    struct shader_info *info = &ish->nir->info;
 
-   if (screen->precompile) {
+   if (should_precompile(ice)) {
       const unsigned _GL_TRIANGLES = 0x0004;
       const struct gen_device_info *devinfo = &screen->devinfo;
       struct brw_tcs_prog_key key = {
@@ -2042,8 +2302,7 @@ iris_create_tcs_state(struct pipe_context *ctx,
       if (compiler->use_tcs_8_patch)
          key.input_vertices = info->tess.tcs_vertices_out;
 
-      if (!iris_disk_cache_retrieve(ice, ish, &key, sizeof(key)))
-         iris_compile_tcs(ice, ish, &key);
+      iris_precompile(ice, ish, &key, sizeof(key));
    }
 
    return ish;
@@ -2062,7 +2321,7 @@ iris_create_tes_state(struct pipe_context *ctx,
    if (ish->nir->info.clip_distance_array_size == 0)
       ish->nos |= (1ull << IRIS_NOS_RASTERIZER);
 
-   if (screen->precompile) {
+   if (should_precompile(ice)) {
       const struct gen_device_info *devinfo = &screen->devinfo;
       struct brw_tes_prog_key key = {
          KEY_INIT(devinfo->gen),
@@ -2071,8 +2330,7 @@ iris_create_tes_state(struct pipe_context *ctx,
          .patch_inputs_read = info->patch_inputs_read,
       };
 
-      if (!iris_disk_cache_retrieve(ice, ish, &key, sizeof(key)))
-         iris_compile_tes(ice, ish, &key);
+      iris_precompile(ice, ish, &key, sizeof(key));
    }
 
    return ish;
@@ -2090,12 +2348,11 @@ iris_create_gs_state(struct pipe_context *ctx,
    if (ish->nir->info.clip_distance_array_size == 0)
       ish->nos |= (1ull << IRIS_NOS_RASTERIZER);
 
-   if (screen->precompile) {
+   if (should_precompile(ice)) {
       const struct gen_device_info *devinfo = &screen->devinfo;
       struct brw_gs_prog_key key = { KEY_INIT(devinfo->gen) };
 
-      if (!iris_disk_cache_retrieve(ice, ish, &key, sizeof(key)))
-         iris_compile_gs(ice, ish, &key);
+      iris_precompile(ice, ish, &key, sizeof(key));
    }
 
    return ish;
@@ -2121,7 +2378,7 @@ iris_create_fs_state(struct pipe_context *ctx,
       ish->nos |= (1ull << IRIS_NOS_LAST_VUE_MAP);
    }
 
-   if (screen->precompile) {
+   if (should_precompile(ice)) {
       const uint64_t color_outputs = info->outputs_written &
          ~(BITFIELD64_BIT(FRAG_RESULT_DEPTH) |
            BITFIELD64_BIT(FRAG_RESULT_STENCIL) |
@@ -2139,8 +2396,7 @@ iris_create_fs_state(struct pipe_context *ctx,
             can_rearrange_varyings ? 0 : info->inputs_read | VARYING_BIT_POS,
       };
 
-      if (!iris_disk_cache_retrieve(ice, ish, &key, sizeof(key)))
-         iris_compile_fs(ice, ish, &key, NULL);
+      iris_precompile(ice, ish, &key, sizeof(key));
    }
 
    return ish;
@@ -2159,12 +2415,11 @@ iris_create_compute_state(struct pipe_context *ctx,
 
    // XXX: disallow more than 64KB of shared variables
 
-   if (screen->precompile) {
+   if (should_precompile(ice)) {
       const struct gen_device_info *devinfo = &screen->devinfo;
       struct brw_cs_prog_key key = { KEY_INIT(devinfo->gen) };
 
-      if (!iris_disk_cache_retrieve(ice, ish, &key, sizeof(key)))
-         iris_compile_cs(ice, ish, &key);
+      iris_precompile(ice, ish, &key, sizeof(key));
    }
 
    return ish;
@@ -2181,6 +2436,16 @@ iris_delete_shader_state(struct pipe_context *ctx, void *state, gl_shader_stage
    struct iris_uncompiled_shader *ish = state;
    struct iris_context *ice = (void *) ctx;
 
+   if (ish->precompile) {
+      struct iris_precompile *pc = ish->precompile;
+
+      util_queue_fence_wait(&pc->ready);
+      if (p_atomic_cmpxchg(&pc->claimed, 0, 1) == 0)
+         ralloc_free(pc->variant.mem_ctx);
+      util_queue_fence_destroy(&pc->ready);
+      free(pc);
+   }
+
    if (ice->shaders.uncompiled[stage] == ish) {
       ice->shaders.uncompiled[stage] = NULL;
       ice->state.dirty |= IRIS_DIRTY_UNCOMPILED_VS << stage;
@@ -2253,6 +2518,9 @@ bind_shader_state(struct iris_context *ice,
       ice->state.dirty |= IRIS_DIRTY_SAMPLER_STATES_VS << stage;
    }
 
+   if (ish && ish->nir->constant_data_size > 0 && !ish->const_data)
+      iris_upload_shader_const_data(ice, ish);
+
    ice->shaders.uncompiled[stage] = ish;
    ice->state.dirty |= dirty_bit;
 
@@ -2344,6 +2612,34 @@ iris_bind_cs_state(struct pipe_context *ctx, void *state)
    bind_shader_state((void *) ctx, state, MESA_SHADER_COMPUTE);
 }
 
+static void
+iris_set_max_shader_compiler_threads(struct pipe_screen *pscreen,
+                                     unsigned max_threads)
+{
+   struct iris_screen *screen = (struct iris_screen *) pscreen;
+   util_queue_adjust_num_threads(&screen->shader_compiler_queue, max_threads);
+}
+
+static bool
+iris_is_parallel_shader_compilation_finished(struct pipe_screen *pscreen,
+                                             void *v_shader,
+                                             unsigned p_stage)
+{
+   struct iris_uncompiled_shader *ish = v_shader;
+
+   return !ish->precompile ||
+          util_queue_fence_is_signalled(&ish->precompile->ready);
+}
+
+void
+iris_init_screen_program_functions(struct pipe_screen *pscreen)
+{
+   pscreen->set_max_shader_compiler_threads =
+      iris_set_max_shader_compiler_threads;
+   pscreen->is_parallel_shader_compilation_finished =
+      iris_is_parallel_shader_compilation_finished;
+}
+
 void
 iris_init_program_functions(struct pipe_context *ctx)
 {
@@ -208,6 +208,9 @@ iris_blorp_lookup_shader(struct blorp_batch *blorp_batch,
    struct iris_compiled_shader *shader =
       iris_find_cached_shader(ice, IRIS_CACHE_BLORP, key_size, key);
 
+   if (!shader)
+      shader = iris_disk_cache_retrieve_blorp(ice, key, key_size);
+
    if (!shader)
       return false;
 
@@ -226,7 +229,7 @@ iris_blorp_upload_shader(struct blorp_batch *blorp_batch,
                          const void *key, uint32_t key_size,
                          const void *kernel, UNUSED uint32_t kernel_size,
                          const struct brw_stage_prog_data *prog_data_templ,
-                         UNUSED uint32_t prog_data_size,
+                         uint32_t prog_data_size,
                          uint32_t *kernel_out, void *prog_data_out)
 {
    struct blorp_context *blorp = blorp_batch->blorp;
@@ -243,6 +246,10 @@ iris_blorp_upload_shader(struct blorp_batch *blorp_batch,
       iris_upload_shader(ice, IRIS_CACHE_BLORP, key_size, key, kernel,
                          prog_data, NULL, NULL, 0, 0, &bt);
 
+   struct iris_screen *screen = (void *) ice->ctx.screen;
+   iris_disk_cache_store_blorp(screen->disk_cache, key, key_size, shader,
+                               prog_data_size);
+
    struct iris_bo *bo = iris_resource_bo(shader->assembly.res);
    *kernel_out =
       iris_bo_offset_from_base_address(bo) + shader->assembly.offset;
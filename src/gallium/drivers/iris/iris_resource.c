@@ -304,8 +304,10 @@ iris_resource_destroy(struct pipe_screen *screen,
 {
    struct iris_resource *res = (struct iris_resource *)resource;
 
-   if (resource->target == PIPE_BUFFER)
+   if (resource->target == PIPE_BUFFER) {
       util_range_destroy(&res->valid_buffer_range);
+      threaded_resource_deinit(resource);
+   }
 
    iris_resource_disable_aux(res);
 
@@ -321,15 +323,17 @@ iris_alloc_resource(struct pipe_screen *pscreen,
    if (!res)
       return NULL;
 
-   res->base = *templ;
-   res->base.screen = pscreen;
-   pipe_reference_init(&res->base.reference, 1);
+   res->base.b = *templ;
+   res->base.b.screen = pscreen;
+   pipe_reference_init(&res->base.b.reference, 1);
 
    res->aux.possible_usages = 1 << ISL_AUX_USAGE_NONE;
    res->aux.sampler_usages = 1 << ISL_AUX_USAGE_NONE;
 
-   if (templ->target == PIPE_BUFFER)
+   if (templ->target == PIPE_BUFFER) {
       util_range_init(&res->valid_buffer_range);
+      threaded_resource_init(&res->base.b);
+   }
 
    return res;
 }
@@ -571,7 +575,7 @@ iris_resource_finish_aux_import(struct pipe_screen *pscreen,
    assert(iris_resource_unfinished_aux_import(res));
    assert(!res->mod_info->supports_clear_color);
 
-   struct iris_resource *aux_res = (void *) res->base.next;
+   struct iris_resource *aux_res = (void *) res->base.b.next;
    assert(aux_res->aux.surf.row_pitch_B && aux_res->aux.offset &&
           aux_res->aux.bo);
 
@@ -597,8 +601,8 @@ iris_resource_finish_aux_import(struct pipe_screen *pscreen,
       res->aux.clear_color_offset = 0;
    }
 
-   iris_resource_destroy(&screen->base, res->base.next);
-   res->base.next = NULL;
+   iris_resource_destroy(&screen->base, res->base.b.next);
+   res->base.b.next = NULL;
 }
 
 static bool
@@ -659,11 +663,11 @@ iris_resource_create_for_buffer(struct pipe_screen *pscreen,
 
    res->bo = iris_bo_alloc(screen->bufmgr, name, templ->width0, memzone);
    if (!res->bo) {
-      iris_resource_destroy(pscreen, &res->base);
+      iris_resource_destroy(pscreen, &res->base.b);
       return NULL;
    }
 
-   return &res->base;
+   return &res->base.b;
 }
 
 static struct pipe_resource *
@@ -843,11 +847,11 @@ iris_resource_create_with_modifiers(struct pipe_screen *pscreen,
    if (!aux_enabled)
       iris_resource_disable_aux(res);
 
-   return &res->base;
+   return &res->base.b;
 
 fail:
    fprintf(stderr, "XXX: resource creation failed\n");
-   iris_resource_destroy(pscreen, &res->base);
+   iris_resource_destroy(pscreen, &res->base.b);
    return NULL;
 
 }
@@ -898,9 +902,10 @@ iris_resource_from_user_memory(struct pipe_screen *pscreen,
       return NULL;
    }
 
+   res->base.is_user_ptr = true;
    util_range_add(&res->valid_buffer_range, 0, templ->width0);
 
-   return &res->base;
+   return &res->base.b;
 }
 
 static struct pipe_resource *
@@ -931,6 +936,7 @@ iris_resource_from_handle(struct pipe_screen *pscreen,
       return NULL;
 
    res->offset = whandle->offset;
+   res->base.is_shared = true;
 
    uint64_t modifier = whandle->modifier;
    if (modifier == DRM_FORMAT_MOD_INVALID) {
@@ -1001,10 +1007,10 @@ iris_resource_from_handle(struct pipe_screen *pscreen,
       }
    }
 
-   return &res->base;
+   return &res->base.b;
 
 fail:
-   iris_resource_destroy(pscreen, &res->base);
+   iris_resource_destroy(pscreen, &res->base.b);
    return NULL;
 }
 
@@ -1033,6 +1039,11 @@ iris_resource_get_param(struct pipe_screen *screen,
    struct iris_resource *res = (struct iris_resource *)resource;
    bool mod_with_aux =
       res->mod_info && res->mod_info->aux_usage != ISL_AUX_USAGE_NONE;
+
+   /* Someone else may now be looking at our BO, so the threaded context
+    * must not swap out its storage behind their back.
+    */
+   res->base.is_shared = true;
    bool wants_aux = mod_with_aux && plane > 0;
    struct iris_bo *bo = wants_aux ? res->aux.bo : res->bo;
    bool result;
@@ -1198,6 +1209,46 @@ iris_invalidate_resource(struct pipe_context *ctx,
    iris_bo_unreference(old_bo);
 }
 
+/**
+ * The u_threaded_context replace_buffer_storage() callback.
+ *
+ * u_threaded_context invalidates buffers on the application thread by
+ * allocating a fresh resource and handing us both; we steal the new BO
+ * for the original resource and rebind it, just like invalidate_resource.
+ */
+void
+iris_replace_buffer_storage(struct pipe_context *ctx,
+                            struct pipe_resource *p_dst,
+                            struct pipe_resource *p_src)
+{
+   struct iris_context *ice = (void *) ctx;
+   struct iris_resource *dst = (void *) p_dst;
+   struct iris_resource *src = (void *) p_src;
+
+   assert(p_dst->target == PIPE_BUFFER && p_dst->width0 == p_src->width0);
+
+   struct iris_bo *old_bo = dst->bo;
+
+   /* Swap out the backing storage */
+   iris_bo_reference(src->bo);
+   dst->bo = src->bo;
+
+   /* Rebind the buffer, replacing any state referring to the old BO's
+    * address, and marking state dirty so it's reemitted.
+    */
+   ice->vtbl.rebind_buffer(ice, dst, old_bo->gtt_offset);
+
+   /* The new storage only holds what was written through the new resource,
+    * which may already have been mapped from the application thread.
+    */
+   util_range_set_empty(&dst->valid_buffer_range);
+   util_range_add(&dst->valid_buffer_range,
+                  src->valid_buffer_range.start,
+                  src->valid_buffer_range.end);
+
+   iris_bo_unreference(old_bo);
+}
+
 static void
 iris_flush_staging_region(struct pipe_transfer *xfer,
                           const struct pipe_box *flush_box)
@@ -1239,7 +1290,7 @@ static void
 iris_map_copy_region(struct iris_transfer *map)
 {
    struct pipe_screen *pscreen = &map->batch->screen->base;
-   struct pipe_transfer *xfer = &map->base;
+   struct pipe_transfer *xfer = &map->base.b;
    struct pipe_box *box = &xfer->box;
    struct iris_resource *res = (void *) xfer->resource;
 
@@ -1456,7 +1507,7 @@ s8_offset(uint32_t stride, uint32_t x, uint32_t y)
 static void
 iris_unmap_s8(struct iris_transfer *map)
 {
-   struct pipe_transfer *xfer = &map->base;
+   struct pipe_transfer *xfer = &map->base.b;
    const struct pipe_box *box = &xfer->box;
    struct iris_resource *res = (struct iris_resource *) xfer->resource;
    struct isl_surf *surf = &res->surf;
@@ -1488,7 +1539,7 @@ iris_unmap_s8(struct iris_transfer *map)
 static void
 iris_map_s8(struct iris_transfer *map)
 {
-   struct pipe_transfer *xfer = &map->base;
+   struct pipe_transfer *xfer = &map->base.b;
    const struct pipe_box *box = &xfer->box;
    struct iris_resource *res = (struct iris_resource *) xfer->resource;
    struct isl_surf *surf = &res->surf;
@@ -1560,13 +1611,17 @@ tile_extents(const struct isl_surf *surf,
 static void
 iris_unmap_tiled_memcpy(struct iris_transfer *map)
 {
-   struct pipe_transfer *xfer = &map->base;
+   struct pipe_transfer *xfer = &map->base.b;
    const struct pipe_box *box = &xfer->box;
    struct iris_resource *res = (struct iris_resource *) xfer->resource;
    struct isl_surf *surf = &res->surf;
 
    const bool has_swizzling = false;
 
+   /* Write-combined mappings are much faster with non-temporal stores. */
+   const isl_memcpy_type copy_type =
+      res->bo->cache_coherent ? ISL_MEMCPY : ISL_MEMCPY_STREAMING_STORE;
+
    if (xfer->usage & PIPE_TRANSFER_WRITE) {
       char *dst =
          iris_bo_map(map->dbg, res->bo, (xfer->usage | MAP_RAW) & MAP_FLAGS);
@@ -1579,7 +1634,7 @@ iris_unmap_tiled_memcpy(struct iris_transfer *map)
 
          isl_memcpy_linear_to_tiled(x1, x2, y1, y2, dst, ptr,
                                     surf->row_pitch_B, xfer->stride,
-                                    has_swizzling, surf->tiling, ISL_MEMCPY);
+                                    has_swizzling, surf->tiling, copy_type);
       }
    }
    os_free_aligned(map->buffer);
@@ -1589,7 +1644,7 @@ iris_unmap_tiled_memcpy(struct iris_transfer *map)
 static void
 iris_map_tiled_memcpy(struct iris_transfer *map)
 {
-   struct pipe_transfer *xfer = &map->base;
+   struct pipe_transfer *xfer = &map->base.b;
    const struct pipe_box *box = &xfer->box;
    struct iris_resource *res = (struct iris_resource *) xfer->resource;
    struct isl_surf *surf = &res->surf;
@@ -1634,13 +1689,13 @@ iris_map_tiled_memcpy(struct iris_transfer *map)
 static void
 iris_map_direct(struct iris_transfer *map)
 {
-   struct pipe_transfer *xfer = &map->base;
+   struct pipe_transfer *xfer = &map->base.b;
    struct pipe_box *box = &xfer->box;
    struct iris_resource *res = (struct iris_resource *) xfer->resource;
 
    void *ptr = iris_bo_map(map->dbg, res->bo, xfer->usage & MAP_FLAGS);
 
-   if (res->base.target == PIPE_BUFFER) {
+   if (res->base.b.target == PIPE_BUFFER) {
       xfer->stride = 0;
       xfer->layer_stride = 0;
 
@@ -1670,7 +1725,7 @@ can_promote_to_async(const struct iris_resource *res,
     * initialized with useful data, then we can safely promote this write
     * to be unsynchronized.  This helps the common pattern of appending data.
     */
-   return res->base.target == PIPE_BUFFER && (usage & PIPE_TRANSFER_WRITE) &&
+   return res->base.b.target == PIPE_BUFFER && (usage & PIPE_TRANSFER_WRITE) &&
           !(usage & TC_TRANSFER_MAP_NO_INFER_UNSYNCHRONIZED) &&
           !util_ranges_intersect(&res->valid_buffer_range, box->x,
                                  box->x + box->width);
@@ -1731,8 +1786,18 @@ iris_transfer_map(struct pipe_context *ctx,
        (usage & PIPE_TRANSFER_MAP_DIRECTLY))
       return NULL;
 
-   struct iris_transfer *map = slab_alloc(&ice->transfer_pool);
-   struct pipe_transfer *xfer = &map->base;
+   /* u_threaded_context calls us from the application thread for
+    * unsynchronized buffer maps, so use a pool owned by that thread.
+    * The unmap always happens on the driver thread.
+    */
+   struct iris_transfer *map;
+
+   if (usage & TC_TRANSFER_MAP_THREADED_UNSYNC)
+      map = slab_alloc(&ice->transfer_pool_unsync);
+   else
+      map = slab_alloc(&ice->transfer_pool);
+
+   struct pipe_transfer *xfer = &map->base.b;
 
    if (!map)
       return NULL;
@@ -1829,7 +1894,7 @@ iris_transfer_flush_region(struct pipe_context *ctx,
 
    uint32_t history_flush = 0;
 
-   if (res->base.target == PIPE_BUFFER) {
+   if (res->base.b.target == PIPE_BUFFER) {
       if (map->staging)
          history_flush |= PIPE_CONTROL_RENDER_TARGET_FLUSH;
 
@@ -1936,7 +2001,7 @@ iris_flush_and_dirty_for_history(struct iris_context *ice,
                                  uint32_t extra_flags,
                                  const char *reason)
 {
-   if (res->base.target != PIPE_BUFFER)
+   if (res->base.b.target != PIPE_BUFFER)
       return;
 
    uint32_t flush = iris_flush_bits_for_history(res) | extra_flags;
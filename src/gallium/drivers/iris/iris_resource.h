@@ -26,6 +26,7 @@
 #include "pipe/p_state.h"
 #include "util/u_inlines.h"
 #include "util/u_range.h"
+#include "util/u_threaded_context.h"
 #include "intel/isl/isl.h"
 
 struct iris_batch;
@@ -53,7 +54,7 @@ enum gen9_astc5x5_wa_tex_type {
  * They contain the storage (BO) and layout information (ISL surface).
  */
 struct iris_resource {
-   struct pipe_resource base;
+   struct threaded_resource base;
    enum pipe_format internal_format;
 
    /**
@@ -188,6 +189,12 @@ struct iris_sampler_view {
 
    /** The resource (BO) holding our SURFACE_STATE. */
    struct iris_state_ref surface_state;
+
+   /**
+    * A CPU copy of the texture SURFACE_STATE, filled out at creation and
+    * uploaded on first use (NULL for buffers, which are filled at upload).
+    */
+   void *surface_state_cpu;
 };
 
 /**
@@ -216,13 +223,17 @@ struct iris_surface {
    struct iris_state_ref surface_state;
    /** The resource (BO) holding our SURFACE_STATE for read. */
    struct iris_state_ref surface_state_read;
+
+   /** CPU copies of the above, uploaded on first use. */
+   void *surface_state_cpu;
+   void *surface_state_read_cpu;
 };
 
 /**
  * Transfer object - information about a buffer mapping.
  */
 struct iris_transfer {
-   struct pipe_transfer base;
+   struct threaded_transfer base;
    struct pipe_debug_callback *dbg;
    void *buffer;
    void *ptr;
@@ -281,6 +292,10 @@ unsigned iris_get_num_logical_layers(const struct iris_resource *res,
 
 void iris_resource_disable_aux(struct iris_resource *res);
 
+void iris_replace_buffer_storage(struct pipe_context *ctx,
+                                 struct pipe_resource *dst,
+                                 struct pipe_resource *src);
+
 #define INTEL_REMAINING_LAYERS UINT32_MAX
 #define INTEL_REMAINING_LEVELS UINT32_MAX
 
@@ -422,7 +437,7 @@ void iris_resource_prepare_image(struct iris_context *ice,
 static inline bool
 iris_resource_unfinished_aux_import(struct iris_resource *res)
 {
-   return res->base.next != NULL && res->mod_info &&
+   return res->base.b.next != NULL && res->mod_info &&
       res->mod_info->aux_usage != ISL_AUX_USAGE_NONE;
 }
 
@@ -39,6 +39,7 @@
 #include "pipe/p_screen.h"
 #include "util/debug.h"
 #include "util/u_inlines.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_format.h"
 #include "util/u_transfer_helper.h"
 #include "util/u_upload_mgr.h"
@@ -521,6 +522,7 @@ static void
 iris_destroy_screen(struct pipe_screen *pscreen)
 {
    struct iris_screen *screen = (struct iris_screen *) pscreen;
+   util_queue_destroy(&screen->shader_compiler_queue);
    iris_bo_unreference(screen->workaround_bo);
    u_transfer_helper_destroy(pscreen->transfer_helper);
    iris_bufmgr_destroy(screen->bufmgr);
@@ -661,6 +663,8 @@ iris_screen_create(int fd, const struct pipe_screen_config *config)
       driQueryOptionb(config->options, "disable_throttling");
    screen->driconf.always_flush_cache =
       driQueryOptionb(config->options, "always_flush_cache");
+   screen->driconf.disable_threaded_context =
+      driQueryOptionb(config->options, "disable_threaded_context");
 
    screen->precompile = env_var_as_boolean("shader_precompile", true);
 
@@ -674,6 +678,14 @@ iris_screen_create(int fd, const struct pipe_screen_config *config)
 
    iris_disk_cache_init(screen);
 
+   util_cpu_detect();
+
+   if (!util_queue_init(&screen->shader_compiler_queue, "sh", 64,
+                        MAX2(util_cpu_caps.nr_cpus - 1, 1),
+                        UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+                        UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY))
+      return NULL;
+
    slab_create_parent(&screen->transfer_pool,
                       sizeof(struct iris_transfer), 64);
 
@@ -685,6 +697,7 @@ iris_screen_create(int fd, const struct pipe_screen_config *config)
 
    iris_init_screen_fence_functions(pscreen);
    iris_init_screen_resource_functions(pscreen);
+   iris_init_screen_program_functions(pscreen);
 
    pscreen->destroy = iris_destroy_screen;
    pscreen->get_name = iris_get_name;
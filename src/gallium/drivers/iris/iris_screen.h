@@ -27,6 +27,7 @@
 #include "state_tracker/drm_driver.h"
 #include "util/disk_cache.h"
 #include "util/slab.h"
+#include "util/u_queue.h"
 #include "util/u_screen.h"
 #include "intel/dev/gen_device_info.h"
 #include "intel/isl/isl.h"
@@ -68,6 +69,7 @@ struct iris_screen {
       bool dual_color_blend_by_location;
       bool disable_throttling;
       bool always_flush_cache;
+      bool disable_threaded_context;
    } driconf;
 
    unsigned subslice_total;
@@ -87,6 +89,9 @@ struct iris_screen {
    struct iris_bo *workaround_bo;
 
    struct disk_cache *disk_cache;
+
+   /** Compiles the guessed variants of new shaders in the background. */
+   struct util_queue shader_compiler_queue;
 };
 
 struct pipe_screen *
@@ -1807,6 +1807,37 @@ alloc_surface_states(struct u_upload_mgr *mgr,
    return map;
 }
 
+/**
+ * Allocate CPU memory for a set of SURFACE_STATEs, one for each
+ * supported auxiliary surface mode.
+ *
+ * u_threaded_context calls the create_sampler_view and create_surface
+ * hooks from the application thread, where we can't use our uploaders.
+ * They fill out a CPU copy instead, and upload_surface_states() moves it
+ * into the surface state memory zone the first time the view is used.
+ */
+static void *
+alloc_cpu_surface_states(unsigned aux_usages)
+{
+   assert(aux_usages != 0);
+
+   return malloc(util_bitcount(aux_usages) * SURFACE_STATE_ALIGNMENT);
+}
+
+static void
+upload_surface_states(struct u_upload_mgr *mgr,
+                      struct iris_state_ref *ref,
+                      const void *cpu_map,
+                      unsigned aux_usages)
+{
+   void *map = alloc_surface_states(mgr, ref, aux_usages);
+
+   if (likely(map)) {
+      memcpy(map, cpu_map,
+             util_bitcount(aux_usages) * SURFACE_STATE_ALIGNMENT);
+   }
+}
+
 #if GEN_GEN == 8
 /**
  * Return an ISL surface for use with non-coherent render target reads.
@@ -1914,7 +1945,6 @@ iris_create_sampler_view(struct pipe_context *ctx,
                          struct pipe_resource *tex,
                          const struct pipe_sampler_view *tmpl)
 {
-   struct iris_context *ice = (struct iris_context *) ctx;
    struct iris_screen *screen = (struct iris_screen *)ctx->screen;
    const struct gen_device_info *devinfo = &screen->devinfo;
    struct iris_sampler_view *isv = calloc(1, sizeof(struct iris_sampler_view));
@@ -1936,17 +1966,11 @@ iris_create_sampler_view(struct pipe_context *ctx,
 
       iris_get_depth_stencil_resources(tex, &zres, &sres);
 
-      tex = util_format_has_depth(desc) ? &zres->base : &sres->base;
+      tex = util_format_has_depth(desc) ? &zres->base.b : &sres->base.b;
    }
 
    isv->res = (struct iris_resource *) tex;
 
-   void *map = alloc_surface_states(ice->state.surface_uploader,
-                                    &isv->surface_state,
-                                    isv->res->aux.sampler_usages);
-   if (!unlikely(map))
-      return NULL;
-
    isl_surf_usage_flags_t usage = ISL_SURF_USAGE_TEXTURE_BIT;
 
    if (isv->base.target == PIPE_TEXTURE_CUBE ||
@@ -1969,7 +1993,9 @@ iris_create_sampler_view(struct pipe_context *ctx,
       .usage = usage,
    };
 
-   /* Fill out SURFACE_STATE for this view. */
+   /* Fill out SURFACE_STATE for this view.  Buffer views are filled out
+    * on first use instead, as the buffer's storage may be replaced by then.
+    */
    if (tmpl->target != PIPE_BUFFER) {
       isv->view.base_level = tmpl->u.tex.first_level;
       isv->view.levels = tmpl->u.tex.last_level - tmpl->u.tex.first_level + 1;
@@ -1981,6 +2007,12 @@ iris_create_sampler_view(struct pipe_context *ctx,
       if (iris_resource_unfinished_aux_import(isv->res))
          iris_resource_finish_aux_import(&screen->base, isv->res);
 
+      void *map = alloc_cpu_surface_states(isv->res->aux.sampler_usages);
+      if (!unlikely(map))
+         return NULL;
+
+      isv->surface_state_cpu = map;
+
       unsigned aux_modes = isv->res->aux.sampler_usages;
       while (aux_modes) {
          enum isl_aux_usage aux_usage = u_bit_scan(&aux_modes);
@@ -1993,10 +2025,6 @@ iris_create_sampler_view(struct pipe_context *ctx,
 
          map += SURFACE_STATE_ALIGNMENT;
       }
-   } else {
-      fill_buffer_surface_state(&screen->isl_dev, isv->res, map,
-                                isv->view.format, isv->view.swizzle,
-                                tmpl->u.buf.offset, tmpl->u.buf.size);
    }
 
    return &isv->base;
@@ -2009,6 +2037,7 @@ iris_sampler_view_destroy(struct pipe_context *ctx,
    struct iris_sampler_view *isv = (void *) state;
    pipe_resource_reference(&state->texture, NULL);
    pipe_resource_reference(&isv->surface_state.res, NULL);
+   free(isv->surface_state_cpu);
    free(isv);
 }
 
@@ -2023,7 +2052,6 @@ iris_create_surface(struct pipe_context *ctx,
                     struct pipe_resource *tex,
                     const struct pipe_surface *tmpl)
 {
-   struct iris_context *ice = (struct iris_context *) ctx;
    struct iris_screen *screen = (struct iris_screen *)ctx->screen;
    const struct gen_device_info *devinfo = &screen->devinfo;
 
@@ -2104,27 +2132,24 @@ iris_create_surface(struct pipe_context *ctx,
       return psurf;
 
 
-   void *map = alloc_surface_states(ice->state.surface_uploader,
-                                    &surf->surface_state,
-                                    res->aux.possible_usages);
-   if (!unlikely(map)) {
-      pipe_resource_reference(&surf->surface_state.res, NULL);
+   if (iris_resource_unfinished_aux_import(res))
+      iris_resource_finish_aux_import(&screen->base, res);
+
+   void *map = alloc_cpu_surface_states(res->aux.possible_usages);
+   if (!unlikely(map))
       return NULL;
-   }
+
+   surf->surface_state_cpu = map;
 
 #if GEN_GEN == 8
-   void *map_read = alloc_surface_states(ice->state.surface_uploader,
-                                         &surf->surface_state_read,
-                                         res->aux.possible_usages);
-   if (!unlikely(map_read)) {
-      pipe_resource_reference(&surf->surface_state_read.res, NULL);
+   void *map_read = alloc_cpu_surface_states(res->aux.possible_usages);
+   if (!unlikely(map_read))
       return NULL;
-   }
+
+   surf->surface_state_read_cpu = map_read;
 #endif
 
    if (!isl_format_is_compressed(res->surf.format)) {
-      if (iris_resource_unfinished_aux_import(res))
-         iris_resource_finish_aux_import(&screen->base, res);
 
       /* This is a normal surface.  Fill out a SURFACE_STATE for each possible
        * auxiliary surface mode and return the pipe_surface.
@@ -2326,7 +2351,7 @@ iris_set_shader_images(struct pipe_context *ctx,
                isl_fmt = isl_lower_storage_image_format(devinfo, isl_fmt);
          }
 
-         if (res->base.target != PIPE_BUFFER) {
+         if (res->base.b.target != PIPE_BUFFER) {
             struct isl_view view = {
                .format = isl_fmt,
                .base_level = img->u.tex.level,
@@ -2444,6 +2469,8 @@ iris_surface_destroy(struct pipe_context *ctx, struct pipe_surface *p_surf)
    pipe_resource_reference(&p_surf->texture, NULL);
    pipe_resource_reference(&surf->surface_state.res, NULL);
    pipe_resource_reference(&surf->surface_state_read.res, NULL);
+   free(surf->surface_state_cpu);
+   free(surf->surface_state_read_cpu);
    free(surf);
 }
 
@@ -2878,7 +2905,7 @@ iris_set_shader_buffers(struct pipe_context *ctx,
          struct pipe_shader_buffer *ssbo = &shs->ssbo[start_slot + i];
          struct iris_state_ref *surf_state =
             &shs->ssbo_surf_state[start_slot + i];
-         pipe_resource_reference(&ssbo->buffer, &res->base);
+         pipe_resource_reference(&ssbo->buffer, &res->base.b);
          ssbo->buffer_offset = buffers[i].buffer_offset;
          ssbo->buffer_size =
             MIN2(buffers[i].buffer_size, res->bo->size - ssbo->buffer_offset);
@@ -3125,6 +3152,11 @@ iris_create_stream_output_target(struct pipe_context *ctx,
 
    res->bind_history |= PIPE_BIND_STREAM_OUTPUT;
 
+   /* We can't rebind streamout buffers yet (see iris_rebind_buffer), so
+    * don't let u_threaded_context reallocate their storage either.
+    */
+   res->base.is_shared = true;
+
    pipe_reference_init(&cso->base.reference, 1);
    pipe_resource_reference(&cso->base.buffer, p_res);
    cso->base.buffer_offset = buffer_offset;
@@ -4173,6 +4205,18 @@ use_surface(struct iris_context *ice,
    struct iris_resource *res = (void *) p_surf->texture;
    uint32_t offset = 0;
 
+   if (!surf->surface_state.res) {
+      upload_surface_states(ice->state.surface_uploader, &surf->surface_state,
+                            surf->surface_state_cpu,
+                            res->aux.possible_usages);
+#if GEN_GEN == 8
+      upload_surface_states(ice->state.surface_uploader,
+                            &surf->surface_state_read,
+                            surf->surface_state_read_cpu,
+                            res->aux.possible_usages);
+#endif
+   }
+
    iris_use_pinned_bo(batch, iris_resource_bo(p_surf->texture), writeable);
    if (GEN_GEN == 8 && is_read_surface) {
       iris_use_pinned_bo(batch, iris_resource_bo(surf->surface_state_read.res), false);
@@ -4213,6 +4257,22 @@ use_sampler_view(struct iris_context *ice,
    enum isl_aux_usage aux_usage =
       iris_resource_texture_aux_usage(ice, isv->res, isv->view.format, 0);
 
+   if (!isv->surface_state.res) {
+      if (isv->base.target == PIPE_BUFFER) {
+         void *map = alloc_surface_states(ice->state.surface_uploader,
+                                          &isv->surface_state,
+                                          isv->res->aux.sampler_usages);
+         fill_buffer_surface_state(&batch->screen->isl_dev, isv->res, map,
+                                   isv->view.format, isv->view.swizzle,
+                                   isv->base.u.buf.offset,
+                                   isv->base.u.buf.size);
+      } else {
+         upload_surface_states(ice->state.surface_uploader,
+                               &isv->surface_state, isv->surface_state_cpu,
+                               isv->res->aux.sampler_usages);
+      }
+   }
+
    iris_use_pinned_bo(batch, isv->res->bo, false);
    iris_use_pinned_bo(batch, iris_resource_bo(isv->surface_state.res), false);
 
@@ -5993,7 +6053,7 @@ iris_rebind_buffer(struct iris_context *ice,
    struct iris_screen *screen = (void *) ctx->screen;
    struct iris_genx_state *genx = ice->state.genx;
 
-   assert(res->base.target == PIPE_BUFFER);
+   assert(res->base.b.target == PIPE_BUFFER);
 
    /* Buffers can't be framebuffer attachments, nor display related,
     * and we don't have upstream Clover support.
@@ -6064,7 +6124,7 @@ iris_rebind_buffer(struct iris_context *ice,
 
             if (res->bo == iris_resource_bo(ssbo->buffer)) {
                struct pipe_shader_buffer buf = {
-                  .buffer = &res->base,
+                  .buffer = &res->base.b,
                   .buffer_offset = ssbo->buffer_offset,
                   .buffer_size = ssbo->buffer_size,
                };
@@ -6931,6 +6991,7 @@ genX(init_state)(struct iris_context *ice)
    ctx->sampler_view_destroy = iris_sampler_view_destroy;
    ctx->surface_destroy = iris_surface_destroy;
    ctx->draw_vbo = iris_draw_vbo;
+   ctx->multi_draw = iris_multi_draw;
    ctx->launch_grid = iris_launch_grid;
    ctx->create_stream_output_target = iris_create_stream_output_target;
    ctx->stream_output_target_destroy = iris_stream_output_target_destroy;
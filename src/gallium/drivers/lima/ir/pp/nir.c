@@ -755,10 +755,16 @@ static void ppir_print_shader_db(struct nir_shader *nir, ppir_compiler *comp,
 {
    const struct shader_info *info = &nir->info;
    char *shaderdb;
+   int num_instr = 0;
+
+   /* cur_instr_index also counts the instrs merged away by node_to_instr */
+   list_for_each_entry(ppir_block, block, &comp->block_list, list)
+      num_instr += list_length(&block->instr_list);
+
    int ret = asprintf(&shaderdb,
                       "%s shader: %d inst, %d loops, %d:%d spills:fills\n",
                       gl_shader_stage_name(info->stage),
-                      comp->cur_instr_index,
+                      num_instr,
                       comp->num_loops,
                       comp->num_spills,
                       comp->num_fills);
@@ -22,6 +22,8 @@
  *
  */
 
+#include "util/set.h"
+
 #include "ppir.h"
 
 
@@ -241,6 +243,139 @@ static void ppir_build_instr_dependency(ppir_compiler *comp)
    }
 }
 
+static bool ppir_instr_reaches(ppir_instr *from, ppir_instr *to,
+                               struct set *visited)
+{
+   ppir_instr_foreach_succ(from, dep) {
+      ppir_instr *succ = dep->succ;
+
+      if (succ == to)
+         return true;
+
+      if (_mesa_set_search(visited, succ))
+         continue;
+      _mesa_set_add(visited, succ);
+
+      if (ppir_instr_reaches(succ, to, visited))
+         return true;
+   }
+
+   return false;
+}
+
+static bool ppir_instr_can_combine(ppir_instr *a, ppir_instr *b,
+                                   struct set *visited)
+{
+   if (a->is_end || b->is_end ||
+       a->slots[PPIR_INSTR_SLOT_BRANCH] || b->slots[PPIR_INSTR_SLOT_BRANCH])
+      return false;
+
+   for (int i = 0; i < PPIR_INSTR_SLOT_NUM; i++) {
+      if (a->slots[i] && b->slots[i])
+         return false;
+   }
+
+   /* b's const0 can move to a's unused const1, but only if b doesn't
+    * need const1 itself */
+   if (b->constant[0].num || b->constant[1].num) {
+      if (a->constant[1].num)
+         return false;
+      if (a->constant[0].num && b->constant[1].num)
+         return false;
+   }
+
+   /* Merging is only safe when neither instr depends on the other,
+    * otherwise the dependency graph gets a cycle */
+   _mesa_set_clear(visited, NULL);
+   if (ppir_instr_reaches(a, b, visited))
+      return false;
+   _mesa_set_clear(visited, NULL);
+   if (ppir_instr_reaches(b, a, visited))
+      return false;
+
+   return true;
+}
+
+static void ppir_instr_combine(ppir_instr *a, ppir_instr *b)
+{
+   bool move_const = a->constant[0].num && b->constant[0].num;
+
+   for (int i = 0; i < PPIR_INSTR_SLOT_NUM; i++) {
+      ppir_node *node = b->slots[i];
+      if (!node)
+         continue;
+
+      if (move_const) {
+         for (int j = 0; j < ppir_node_get_src_num(node); j++) {
+            ppir_src *src = ppir_node_get_src(node, j);
+            if (src->type == ppir_target_pipeline &&
+                src->pipeline == ppir_pipeline_reg_const0)
+               src->pipeline = ppir_pipeline_reg_const1;
+         }
+      }
+
+      a->slots[i] = node;
+      node->instr = a;
+   }
+
+   if (move_const)
+      a->constant[1] = b->constant[0];
+   else if (!a->constant[0].num) {
+      a->constant[0] = b->constant[0];
+      a->constant[1] = b->constant[1];
+   }
+
+   ppir_instr_foreach_pred_safe(b, dep) {
+      list_del(&dep->succ_link);
+      ppir_instr_add_dep(a, dep->pred);
+   }
+
+   ppir_instr_foreach_succ_safe(b, dep) {
+      list_del(&dep->pred_link);
+      ppir_instr_add_dep(dep->succ, a);
+   }
+
+   list_del(&b->list);
+}
+
+/* Try to pack instrs feeding the same instr into one, when they use
+ * different slots. Their results have to be live at the same time
+ * anyway, so this doesn't add register pressure. */
+static bool ppir_combine_block_instrs(ppir_block *block, struct set *visited)
+{
+   list_for_each_entry(ppir_instr, instr, &block->instr_list, list) {
+      ppir_instr_foreach_pred(instr, dep_a) {
+         ppir_instr *a = dep_a->pred;
+
+         ppir_instr_foreach_pred(instr, dep_b) {
+            ppir_instr *b = dep_b->pred;
+
+            if (a == b || !ppir_instr_can_combine(a, b, visited))
+               continue;
+
+            ppir_debug("combine instr %d into %d\n", b->index, a->index);
+            ppir_instr_combine(a, b);
+            return true;
+         }
+      }
+   }
+
+   return false;
+}
+
+static void ppir_combine_instrs(ppir_compiler *comp)
+{
+   struct set *visited = _mesa_set_create(NULL, _mesa_hash_pointer,
+                                          _mesa_key_pointer_equal);
+
+   list_for_each_entry(ppir_block, block, &comp->block_list, list) {
+      while (ppir_combine_block_instrs(block, visited))
+         ;
+   }
+
+   _mesa_set_destroy(visited, NULL);
+}
+
 bool ppir_node_to_instr(ppir_compiler *comp)
 {
    if (!ppir_create_instr_from_node(comp))
@@ -250,5 +385,8 @@ bool ppir_node_to_instr(ppir_compiler *comp)
    ppir_build_instr_dependency(comp);
    ppir_instr_print_dep(comp);
 
+   ppir_combine_instrs(comp);
+   ppir_instr_print_list(comp);
+
    return true;
 }
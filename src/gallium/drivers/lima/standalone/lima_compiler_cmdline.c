@@ -179,7 +179,7 @@ main(int argc, char **argv)
 {
    int n;
 
-   lima_debug = LIMA_DEBUG_GP | LIMA_DEBUG_PP;
+   lima_debug = LIMA_DEBUG_GP | LIMA_DEBUG_PP | LIMA_DEBUG_SHADERDB;
 
    if (argc < 2) {
       print_usage();
@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+# Copyright 2019 VMware, Inc.
+# All Rights Reserved.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sub license,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice (including the next
+# paragraph) shall be included in all copies or substantial portions of the
+# Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.  IN NO EVENT SHALL
+# VMWARE AND/OR THEIR SUPPLIERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+# DEALINGS IN THE SOFTWARE.
+
+"""Run the lp_test_* programs under several CPU feature sets and collect
+the cycle counts they write with -o into a single TSV file.
+
+Each row of the output is a row of one program's TSV, prefixed with the
+name of the configuration and of the program.  The rows of a program
+have the columns of its own header, which is printed once per program
+as a comment.
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+
+# name, environment
+CONFIGS = [
+    ('native', {}),
+    # Hides AVX, so this is SSE4.1 on most machines.
+    ('128bit', {'LP_NATIVE_VECTOR_WIDTH': '128'}),
+    # Only honoured by debug builds.
+    ('sse2', {'LP_NATIVE_VECTOR_WIDTH': '128', 'LP_FORCE_SSE2': 'true'}),
+    ('256bit', {'LP_NATIVE_VECTOR_WIDTH': '256'}),
+    ('avx512', {'LP_NATIVE_VECTOR_WIDTH': '256', 'LP_AVX512': 'true'}),
+]
+
+
+def run(program, env):
+    fd, path = tempfile.mkstemp(suffix='.tsv')
+    os.close(fd)
+    try:
+        full_env = dict(os.environ)
+        full_env.update(env)
+        ret = subprocess.call([program, '-o', path], env=full_env,
+                              stdout=subprocess.DEVNULL)
+        with open(path) as f:
+            lines = f.read().splitlines()
+    finally:
+        os.unlink(path)
+
+    if not lines:
+        return ret, None, []
+    return ret, lines[0], lines[1:]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('-o', '--output', type=argparse.FileType('w'),
+                        default=sys.stdout, help='TSV file to write to')
+    parser.add_argument('-c', '--config', action='append',
+                        choices=[name for name, _ in CONFIGS],
+                        help='only run these configurations')
+    parser.add_argument('programs', nargs='+',
+                        help='lp_test_* programs to run')
+    args = parser.parse_args()
+
+    out = args.output
+    failed = False
+    headers = {}
+    for name, env in CONFIGS:
+        if args.config and name not in args.config:
+            continue
+
+        for program in args.programs:
+            test = os.path.basename(program)
+            ret, header, rows = run(program, env)
+            if ret != 0:
+                sys.stderr.write('%s failed with %s\n' % (test, name))
+                failed = True
+
+            if header and headers.get(test) != header:
+                out.write('# config\ttest\t%s\n' % header)
+                headers[test] = header
+
+            for row in rows:
+                out.write('%s\t%s\t%s\n' % (name, test, row))
+            out.flush()
+
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
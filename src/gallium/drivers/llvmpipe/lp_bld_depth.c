@@ -548,55 +548,88 @@ lp_build_depth_stencil_load_swizzled(struct gallivm_state *gallivm,
    zs_load_type.length = zs_load_type.length / 2;
    load_ptr_type = LLVMPointerType(lp_build_vec_type(gallivm, zs_load_type), 0);
 
-   if (z_src_type.length == 4) {
+   if (z_src_type.length == 16) {
+      /*
+       * The whole 4x4 block at once: load the four rows and swizzle each
+       * pair of them like the 8-wide path does.
+       */
+      struct lp_type half_type = zs_type;
+      LLVMValueRef rows[4], halves[2];
       unsigned i;
-      LLVMValueRef looplsb = LLVMBuildAnd(builder, loop_counter,
-                                          lp_build_const_int32(gallivm, 1), "");
-      LLVMValueRef loopmsb = LLVMBuildAnd(builder, loop_counter,
-                                          lp_build_const_int32(gallivm, 2), "");
-      LLVMValueRef offset2 = LLVMBuildMul(builder, loopmsb,
-                                          depth_stride, "");
-      depth_offset1 = LLVMBuildMul(builder, looplsb,
-                                   lp_build_const_int32(gallivm, depth_bytes * 2), "");
-      depth_offset1 = LLVMBuildAdd(builder, depth_offset1, offset2, "");
 
-      /* just concatenate the loaded 2x2 values into 4-wide vector */
+      assert(!is_1d);
+      zs_load_type.length = 4;
+      load_ptr_type = LLVMPointerType(lp_build_vec_type(gallivm, zs_load_type), 0);
+      half_type.length = 8;
+
       for (i = 0; i < 4; i++) {
-         shuffles[i] = lp_build_const_int32(gallivm, i);
+         LLVMValueRef offset = LLVMBuildMul(builder,
+                                            lp_build_const_int32(gallivm, i),
+                                            depth_stride, "");
+         zs_dst_ptr = LLVMBuildGEP(builder, depth_ptr, &offset, 1, "");
+         zs_dst_ptr = LLVMBuildBitCast(builder, zs_dst_ptr, load_ptr_type, "");
+         rows[i] = LLVMBuildLoad(builder, zs_dst_ptr, "");
       }
-   }
-   else {
-      unsigned i;
-      LLVMValueRef loopx2 = LLVMBuildShl(builder, loop_counter,
-                                         lp_build_const_int32(gallivm, 1), "");
-      assert(z_src_type.length == 8);
-      depth_offset1 = LLVMBuildMul(builder, loopx2, depth_stride, "");
-      /*
-       * We load 2x4 values, and need to swizzle them (order
-       * 0,1,4,5,2,3,6,7) - not so hot with avx unfortunately.
-       */
       for (i = 0; i < 8; i++) {
          shuffles[i] = lp_build_const_int32(gallivm, (i&1) + (i&2) * 2 + (i&4) / 2);
       }
+      halves[0] = LLVMBuildShuffleVector(builder, rows[0], rows[1],
+                                         LLVMConstVector(shuffles, 8), "");
+      halves[1] = LLVMBuildShuffleVector(builder, rows[2], rows[3],
+                                         LLVMConstVector(shuffles, 8), "");
+      *z_fb = lp_build_concat(gallivm, halves, half_type, 2);
    }
+   else {
+      if (z_src_type.length == 4) {
+         unsigned i;
+         LLVMValueRef looplsb = LLVMBuildAnd(builder, loop_counter,
+                                             lp_build_const_int32(gallivm, 1), "");
+         LLVMValueRef loopmsb = LLVMBuildAnd(builder, loop_counter,
+                                             lp_build_const_int32(gallivm, 2), "");
+         LLVMValueRef offset2 = LLVMBuildMul(builder, loopmsb,
+                                             depth_stride, "");
+         depth_offset1 = LLVMBuildMul(builder, looplsb,
+                                      lp_build_const_int32(gallivm, depth_bytes * 2), "");
+         depth_offset1 = LLVMBuildAdd(builder, depth_offset1, offset2, "");
+
+         /* just concatenate the loaded 2x2 values into 4-wide vector */
+         for (i = 0; i < 4; i++) {
+            shuffles[i] = lp_build_const_int32(gallivm, i);
+         }
+      }
+      else {
+         unsigned i;
+         LLVMValueRef loopx2 = LLVMBuildShl(builder, loop_counter,
+                                            lp_build_const_int32(gallivm, 1), "");
+         assert(z_src_type.length == 8);
+         depth_offset1 = LLVMBuildMul(builder, loopx2, depth_stride, "");
+         /*
+          * We load 2x4 values, and need to swizzle them (order
+          * 0,1,4,5,2,3,6,7) - not so hot with avx unfortunately.
+          */
+         for (i = 0; i < 8; i++) {
+            shuffles[i] = lp_build_const_int32(gallivm, (i&1) + (i&2) * 2 + (i&4) / 2);
+         }
+      }
 
-   depth_offset2 = LLVMBuildAdd(builder, depth_offset1, depth_stride, "");
+      depth_offset2 = LLVMBuildAdd(builder, depth_offset1, depth_stride, "");
 
-   /* Load current z/stencil values from z/stencil buffer */
-   zs_dst_ptr = LLVMBuildGEP(builder, depth_ptr, &depth_offset1, 1, "");
-   zs_dst_ptr = LLVMBuildBitCast(builder, zs_dst_ptr, load_ptr_type, "");
-   zs_dst1 = LLVMBuildLoad(builder, zs_dst_ptr, "");
-   if (is_1d) {
-      zs_dst2 = lp_build_undef(gallivm, zs_load_type);
-   }
-   else {
-      zs_dst_ptr = LLVMBuildGEP(builder, depth_ptr, &depth_offset2, 1, "");
+      /* Load current z/stencil values from z/stencil buffer */
+      zs_dst_ptr = LLVMBuildGEP(builder, depth_ptr, &depth_offset1, 1, "");
       zs_dst_ptr = LLVMBuildBitCast(builder, zs_dst_ptr, load_ptr_type, "");
-      zs_dst2 = LLVMBuildLoad(builder, zs_dst_ptr, "");
-   }
+      zs_dst1 = LLVMBuildLoad(builder, zs_dst_ptr, "");
+      if (is_1d) {
+         zs_dst2 = lp_build_undef(gallivm, zs_load_type);
+      }
+      else {
+         zs_dst_ptr = LLVMBuildGEP(builder, depth_ptr, &depth_offset2, 1, "");
+         zs_dst_ptr = LLVMBuildBitCast(builder, zs_dst_ptr, load_ptr_type, "");
+         zs_dst2 = LLVMBuildLoad(builder, zs_dst_ptr, "");
+      }
 
-   *z_fb = LLVMBuildShuffleVector(builder, zs_dst1, zs_dst2,
-                                  LLVMConstVector(shuffles, zs_type.length), "");
+      *z_fb = LLVMBuildShuffleVector(builder, zs_dst1, zs_dst2,
+                                     LLVMConstVector(shuffles, zs_type.length), "");
+   }
    *s_fb = *z_fb;
 
    if (format_desc->block.bits < z_src_type.width) {
@@ -695,7 +728,14 @@ lp_build_depth_stencil_write_swizzled(struct gallivm_state *gallivm,
     * This is far from ideal, at least for late depth write we should do this
     * outside the fs loop to avoid all the swizzle stuff.
     */
-   if (z_src_type.length == 4) {
+   if (z_src_type.length == 16) {
+      /* all four rows get stored below, relative to depth_ptr */
+      assert(!is_1d);
+      zs_load_type.length = 4;
+      load_ptr_type = LLVMPointerType(lp_build_vec_type(gallivm, zs_load_type), 0);
+      depth_offset1 = lp_build_const_int32(gallivm, 0);
+   }
+   else if (z_src_type.length == 4) {
       LLVMValueRef looplsb = LLVMBuildAnd(builder, loop_counter,
                                           lp_build_const_int32(gallivm, 1), "");
       LLVMValueRef loopmsb = LLVMBuildAnd(builder, loop_counter,
@@ -747,6 +787,45 @@ lp_build_depth_stencil_write_swizzled(struct gallivm_state *gallivm,
                                lp_build_int_vec_type(gallivm, zs_type), "");
    }
 
+   if (z_src_type.length == 16) {
+      /*
+       * Pixel order within the 4x4 block is quad after quad, so row r
+       * consists of lanes (r&1)*2 + (r&2)*4 + {0,1,4,5}.
+       */
+      unsigned r, i;
+      LLVMValueRef row_shuffles[LP_MAX_VECTOR_LENGTH / 4];
+      for (r = 0; r < 4; r++) {
+         LLVMValueRef row, offset, row_ptr;
+         for (i = 0; i < 4; i++) {
+            unsigned lane = (r & 1) * 2 + (r & 2) * 4 + (i & 1) + (i & 2) * 2;
+            if (format_desc->block.bits <= 32) {
+               row_shuffles[i] = lp_build_const_int32(gallivm, lane);
+            }
+            else {
+               row_shuffles[i*2] = lp_build_const_int32(gallivm, lane);
+               row_shuffles[i*2+1] = lp_build_const_int32(gallivm, lane +
+                                                          z_src_type.length);
+            }
+         }
+         if (format_desc->block.bits <= 32) {
+            row = LLVMBuildShuffleVector(builder, z_value, z_value,
+                                         LLVMConstVector(row_shuffles, 4), "");
+         }
+         else {
+            row = LLVMBuildShuffleVector(builder, z_value, s_value,
+                                         LLVMConstVector(row_shuffles, 8), "");
+            row = LLVMBuildBitCast(builder, row,
+                                   lp_build_vec_type(gallivm, zs_load_type), "");
+         }
+         offset = LLVMBuildMul(builder, lp_build_const_int32(gallivm, r),
+                               depth_stride, "");
+         row_ptr = LLVMBuildGEP(builder, depth_ptr, &offset, 1, "");
+         row_ptr = LLVMBuildBitCast(builder, row_ptr, load_ptr_type, "");
+         LLVMBuildStore(builder, row, row_ptr);
+      }
+      return;
+   }
+
    if (format_desc->block.bits <= 32) {
       if (z_src_type.length == 4) {
          zs_dst1 = lp_build_extract_range(gallivm, z_value, 0, 2);
@@ -30,8 +30,114 @@
 
 #include "util/u_thread.h"
 #include "util/u_memory.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_atomic.h"
 #include "lp_cs_tpool.h"
 
+/* Each claim takes this fraction of what is left in the own range, so
+ * chunks start big and get down to single iterations towards the end.
+ */
+#define LP_CS_CHUNK_DIVISOR 4
+
+static void
+run_iters(struct lp_cs_tpool_task *task, unsigned start, unsigned end,
+          struct lp_cs_local_mem *lmem)
+{
+   for (unsigned i = start; i < end; i++)
+      task->work(task->data, i, lmem);
+}
+
+/**
+ * Take the back half of the fullest range of the task other than
+ * \p own.  The sizes are peeked at without locking, so this is just a
+ * heuristic, the victim's lock is taken for the actual steal.
+ * \return false if there is nothing left anywhere
+ */
+static bool
+steal_iters(struct lp_cs_tpool_task *task, int own,
+            unsigned *start, unsigned *end)
+{
+   for (;;) {
+      struct lp_cs_tpool_range *victim = NULL;
+      unsigned most = 0;
+
+      for (unsigned i = 0; i < task->num_ranges; i++) {
+         struct lp_cs_tpool_range *range = &task->ranges[i];
+         unsigned left = p_atomic_read(&range->end) -
+                         p_atomic_read(&range->start);
+         if ((int)i != own && (int)left > (int)most) {
+            most = left;
+            victim = range;
+         }
+      }
+      if (!victim)
+         return false;
+
+      simple_mtx_lock(&victim->lock);
+      if (victim->end > victim->start) {
+         unsigned take = (victim->end - victim->start + 1) / 2;
+         *end = victim->end;
+         victim->end -= take;
+         *start = victim->end;
+         simple_mtx_unlock(&victim->lock);
+         return true;
+      }
+      simple_mtx_unlock(&victim->lock);
+   }
+}
+
+/**
+ * Work through range \p own of the task (if any), then keep stealing
+ * until all iterations have been handed out.
+ * \return the number of iterations run
+ */
+static unsigned
+run_task(struct lp_cs_tpool_task *task, int own, struct lp_cs_local_mem *lmem)
+{
+   unsigned done = 0;
+   unsigned start, end;
+
+   for (;;) {
+      if (own >= 0) {
+         struct lp_cs_tpool_range *range = &task->ranges[own];
+
+         simple_mtx_lock(&range->lock);
+         start = range->start;
+         end = range->end;
+         if (end > start) {
+            end = start + MAX2(1, (end - start) / LP_CS_CHUNK_DIVISOR);
+            range->start = end;
+         }
+         simple_mtx_unlock(&range->lock);
+
+         if (end > start) {
+            run_iters(task, start, end, lmem);
+            done += end - start;
+            continue;
+         }
+      }
+
+      if (!steal_iters(task, own, &start, &end))
+         break;
+
+      if (own >= 0) {
+         /* Make the stolen work our own, so it can be stolen back in
+          * smaller pieces if we end up being the slow one.
+          */
+         struct lp_cs_tpool_range *range = &task->ranges[own];
+         simple_mtx_lock(&range->lock);
+         range->start = start;
+         range->end = end;
+         simple_mtx_unlock(&range->lock);
+      }
+      else {
+         run_iters(task, start, end, lmem);
+         done += end - start;
+      }
+   }
+   return done;
+}
+
 static int
 lp_cs_tpool_worker(void *data)
 {
@@ -43,6 +149,8 @@ lp_cs_tpool_worker(void *data)
 
    while (!pool->shutdown) {
       struct lp_cs_tpool_task *task;
+      unsigned done;
+      int own = -1;
 
       while (list_empty(&pool->workqueue) && !pool->shutdown)
          cnd_wait(&pool->new_work, &pool->m);
@@ -52,16 +160,22 @@ lp_cs_tpool_worker(void *data)
 
       task = list_first_entry(&pool->workqueue, struct lp_cs_tpool_task,
                               list);
-      unsigned this_iter = task->iter_start++;
-
-      if (task->iter_start == task->iter_total)
-         list_del(&task->list);
+      if (task->next_range < task->num_ranges)
+         own = task->next_range++;
+      task->active_workers++;
 
       mtx_unlock(&pool->m);
-      task->work(task->data, this_iter, &lmem);
+      done = run_task(task, own, &lmem);
       mtx_lock(&pool->m);
-      task->iter_finished++;
-      if (task->iter_finished == task->iter_total)
+
+      /* Everything has been handed out, don't let anyone else pick it up. */
+      if (task->queued) {
+         list_del(&task->list);
+         task->queued = false;
+      }
+      task->iter_finished += done;
+      task->active_workers--;
+      if (task->iter_finished == task->iter_total && !task->active_workers)
          cnd_broadcast(&task->finish);
    }
    mtx_unlock(&pool->m);
@@ -70,21 +184,36 @@ lp_cs_tpool_worker(void *data)
 }
 
 struct lp_cs_tpool *
-lp_cs_tpool_create(unsigned num_threads)
+lp_cs_tpool_create(unsigned num_threads, bool pin_threads)
 {
+   const unsigned cores_per_L3 = util_cpu_caps.cores_per_L3;
+   const unsigned num_L3_caches = util_cpu_caps.nr_cpus / cores_per_L3;
    struct lp_cs_tpool *pool = CALLOC_STRUCT(lp_cs_tpool);
 
    if (!pool)
       return NULL;
 
+   pool->threads = CALLOC(MAX2(1, num_threads), sizeof(pool->threads[0]));
+   if (!pool->threads) {
+      FREE(pool);
+      return NULL;
+   }
+
    (void) mtx_init(&pool->m, mtx_plain);
    cnd_init(&pool->new_work);
 
    list_inithead(&pool->workqueue);
    assert (num_threads <= LP_MAX_THREADS);
    pool->num_threads = num_threads;
-   for (unsigned i = 0; i < num_threads; i++)
+   for (unsigned i = 0; i < num_threads; i++) {
       pool->threads[i] = u_thread_create(lp_cs_tpool_worker, pool);
+
+      /* Same placement as the rasterizer threads. */
+      if (pin_threads)
+         util_pin_thread_to_L3(pool->threads[i],
+                               (i / cores_per_L3) % num_L3_caches,
+                               cores_per_L3);
+   }
    return pool;
 }
 
@@ -105,6 +234,7 @@ lp_cs_tpool_destroy(struct lp_cs_tpool *pool)
 
    cnd_destroy(&pool->new_work);
    mtx_destroy(&pool->m);
+   FREE(pool->threads);
    FREE(pool);
 }
 
@@ -121,14 +251,40 @@ lp_cs_tpool_queue_task(struct lp_cs_tpool *pool,
 
    task->work = work;
    task->data = data;
-   task->iter_total = num_iters;
+   task->iter_total = MAX2(num_iters, 0);
    cnd_init(&task->finish);
 
+   /* Without any threads there's nobody to wake up, so just run it here. */
+   if (!pool->num_threads || num_iters <= 0) {
+      struct lp_cs_local_mem lmem;
+
+      memset(&lmem, 0, sizeof(lmem));
+      run_iters(task, 0, task->iter_total, &lmem);
+      FREE(lmem.local_mem_ptr);
+      task->iter_finished = task->iter_total;
+      return task;
+   }
+
+   task->num_ranges = MAX2(1, MIN2(pool->num_threads, (unsigned)num_iters));
+   task->ranges = CALLOC(task->num_ranges, sizeof(task->ranges[0]));
+   if (!task->ranges) {
+      cnd_destroy(&task->finish);
+      FREE(task);
+      return NULL;
+   }
+   for (unsigned i = 0; i < task->num_ranges; i++) {
+      simple_mtx_init(&task->ranges[i].lock, mtx_plain);
+      task->ranges[i].start = (uint64_t)num_iters * i / task->num_ranges;
+      task->ranges[i].end = (uint64_t)num_iters * (i + 1) / task->num_ranges;
+   }
+
    mtx_lock(&pool->m);
 
    list_addtail(&task->list, &pool->workqueue);
+   task->queued = true;
 
-   cnd_signal(&pool->new_work);
+   /* Every thread gets a range of its own. */
+   cnd_broadcast(&pool->new_work);
    mtx_unlock(&pool->m);
    return task;
 }
@@ -143,10 +299,13 @@ lp_cs_tpool_wait_for_task(struct lp_cs_tpool *pool,
       return;
 
    mtx_lock(&pool->m);
-   while (task->iter_finished < task->iter_total)
+   while (task->iter_finished < task->iter_total || task->active_workers)
       cnd_wait(&task->finish, &pool->m);
    mtx_unlock(&pool->m);
 
+   for (unsigned i = 0; i < task->num_ranges; i++)
+      simple_mtx_destroy(&task->ranges[i].lock);
+   FREE(task->ranges);
    cnd_destroy(&task->finish);
    FREE(task);
    *task_handle = NULL;
@@ -28,6 +28,10 @@
  * The item is added to the work queue once, but it must execute
  * number of iterations times. This saves storing a bunch of queue
  * structs with just unique indexes in them.
+ * The iterations are split into one contiguous range per thread, which
+ * the thread works through in shrinking chunks without touching the pool
+ * lock.  Threads which run out of work steal from the back of the
+ * fullest range left.
  * It also supports a local memory support struct to be passed from
  * outside the thread exec function.
  */
@@ -37,6 +41,7 @@
 #include "pipe/p_compiler.h"
 
 #include "util/u_thread.h"
+#include "util/simple_mtx.h"
 #include "util/list.h"
 
 #include "lp_limits.h"
@@ -45,7 +50,7 @@ struct lp_cs_tpool {
    mtx_t m;
    cnd_t new_work;
 
-   thrd_t threads[LP_MAX_THREADS];
+   thrd_t *threads;
    unsigned num_threads;
    struct list_head workqueue;
    bool shutdown;
@@ -58,17 +63,32 @@ struct lp_cs_local_mem {
 
 typedef void (*lp_cs_tpool_task_func)(void *data, int iter_idx, struct lp_cs_local_mem *lmem);
 
+/* Iterations [start, end) not yet handed out, owned by one thread. */
+struct lp_cs_tpool_range {
+   simple_mtx_t lock;
+   unsigned start;
+   unsigned end;
+};
+
 struct lp_cs_tpool_task {
    lp_cs_tpool_task_func work;
    void *data;
    struct list_head list;
    cnd_t finish;
    unsigned iter_total;
-   unsigned iter_start;
    unsigned iter_finished;
+
+   /* protected by the pool mutex */
+   unsigned next_range;
+   unsigned active_workers;
+   bool queued;
+
+   unsigned num_ranges;
+   struct lp_cs_tpool_range *ranges;
 };
 
-struct lp_cs_tpool *lp_cs_tpool_create(unsigned num_threads);
+struct lp_cs_tpool *lp_cs_tpool_create(unsigned num_threads,
+                                       bool pin_threads);
 void lp_cs_tpool_destroy(struct lp_cs_tpool *);
 
 struct lp_cs_tpool_task *lp_cs_tpool_queue_task(struct lp_cs_tpool *,
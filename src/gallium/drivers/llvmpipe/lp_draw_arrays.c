@@ -69,6 +69,9 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
    if (lp->dirty)
       llvmpipe_update_derived( lp );
 
+   if (lp->fs_variant)
+      llvmpipe_fs_variant_use(lp, lp->fs_variant);
+
    /*
     * Map vertex buffers
     */
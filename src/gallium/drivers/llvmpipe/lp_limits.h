@@ -61,7 +61,11 @@
 #define LP_MAX_WIDTH  (1 << (LP_MAX_TEXTURE_LEVELS - 1))
 
 
-#define LP_MAX_THREADS 16
+/**
+ * Sanity limit on the number of rasterizer/compute threads.  Per-thread
+ * state is allocated at runtime so this doesn't size any arrays.
+ */
+#define LP_MAX_THREADS 256
 
 
 /**
@@ -82,6 +82,7 @@ lp_print_counters(void)
       debug_printf("llvmpipe:   nr_fully_covered_16x16:     %9u (%3.0f%% of %u)\n", lp_count.nr_fully_covered_16, p2, total_16);
       debug_printf("llvmpipe:   nr_partially_covered_16x16: %9u (%3.0f%% of %u)\n", lp_count.nr_partially_covered_16, p3, total_16);
       debug_printf("llvmpipe:   nr_empty_16x16:             %9u (%3.0f%% of %u)\n", lp_count.nr_empty_16, p1, total_16);
+      debug_printf("llvmpipe:   nr_hiz_culled_16x16:        %9u\n", lp_count.nr_hiz_culled_16);
 
       total_4 = (lp_count.nr_empty_4 +
                  lp_count.nr_fully_covered_4 +
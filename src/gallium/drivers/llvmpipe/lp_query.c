@@ -34,6 +34,7 @@
 #include "pipe/p_defines.h"
 #include "util/u_memory.h"
 #include "util/os_time.h"
+#include "gallivm/lp_bld_init.h"
 #include "lp_context.h"
 #include "lp_flush.h"
 #include "lp_fence.h"
@@ -48,19 +49,79 @@ static struct llvmpipe_query *llvmpipe_query( struct pipe_query *p )
    return (struct llvmpipe_query *)p;
 }
 
+/**
+ * Sample the running total behind a driver specific query.
+ */
+static uint64_t
+llvmpipe_sample_driver_query(struct llvmpipe_context *llvmpipe,
+                             unsigned type)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(llvmpipe->pipe.screen);
+   struct lp_rast_stats stats;
+   uint64_t num_modules, compile_time, value = 0;
+   unsigned i;
+
+   switch (type) {
+   case LP_QUERY_NUM_COMPILED_VARIANTS:
+      gallivm_get_compile_stats(&num_modules, &compile_time);
+      return num_modules;
+   case LP_QUERY_COMPILE_TIME:
+      gallivm_get_compile_stats(&num_modules, &compile_time);
+      return compile_time;
+   case LP_QUERY_NUM_TRIS_BINNED:
+      return lp_setup_get_num_tris_binned(llvmpipe->setup);
+   default:
+      break;
+   }
+
+   if (type >= LP_QUERY_RAST_BUSY_TIME) {
+      lp_rast_get_stats(screen->rast, type - LP_QUERY_RAST_BUSY_TIME, &stats);
+      return stats.busy_time / 1000;
+   }
+
+   for (i = 0; i < lp_rast_get_num_threads(screen->rast); i++) {
+      lp_rast_get_stats(screen->rast, i, &stats);
+      switch (type) {
+      case LP_QUERY_NUM_BINS:
+         value += stats.nr_bins;
+         break;
+      case LP_QUERY_NUM_FULL_TILES:
+         value += stats.nr_full_tiles;
+         break;
+      case LP_QUERY_NUM_PARTIAL_TILES:
+         value += stats.nr_partial_tiles;
+         break;
+      default:
+         assert(0);
+         break;
+      }
+   }
+
+   return value;
+}
+
+
 static struct pipe_query *
 llvmpipe_create_query(struct pipe_context *pipe, 
                       unsigned type,
                       unsigned index)
 {
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+   unsigned num_threads = MAX2(1, screen->num_threads);
    struct llvmpipe_query *pq;
 
-   assert(type < PIPE_QUERY_TYPES);
+   assert(type < PIPE_QUERY_TYPES ||
+          (type >= PIPE_QUERY_DRIVER_SPECIFIC &&
+           type < LP_QUERY_RAST_BUSY_TIME + num_threads));
 
-   pq = CALLOC_STRUCT( llvmpipe_query );
+   /* The per-thread counters are allocated along with the query. */
+   pq = CALLOC(1, sizeof(*pq) + 2 * num_threads * sizeof(uint64_t));
 
    if (pq) {
       pq->type = type;
+      pq->num_threads = num_threads;
+      pq->start = (uint64_t *)(pq + 1);
+      pq->end = pq->start + num_threads;
    }
 
    return (struct pipe_query *) pq;
@@ -101,6 +162,12 @@ llvmpipe_get_query_result(struct pipe_context *pipe,
    uint64_t *result = (uint64_t *)vresult;
    int i;
 
+   if (pq->type >= PIPE_QUERY_DRIVER_SPECIFIC) {
+      /* sampled at begin/end, nothing to wait for */
+      vresult->u64 = pq->driver_value;
+      return true;
+   }
+
    if (pq->fence) {
       /* only have a fence if there was a scene */
       if (!lp_fence_signalled(pq->fence)) {
@@ -192,6 +259,11 @@ llvmpipe_begin_query(struct pipe_context *pipe, struct pipe_query *q)
    struct llvmpipe_context *llvmpipe = llvmpipe_context( pipe );
    struct llvmpipe_query *pq = llvmpipe_query(q);
 
+   if (pq->type >= PIPE_QUERY_DRIVER_SPECIFIC) {
+      pq->driver_value = llvmpipe_sample_driver_query(llvmpipe, pq->type);
+      return true;
+   }
+
    /* Check if the query is already in the scene.  If so, we need to
     * flush the scene now.  Real apps shouldn't re-use a query in a
     * frame of rendering.
@@ -201,8 +273,8 @@ llvmpipe_begin_query(struct pipe_context *pipe, struct pipe_query *q)
    }
 
 
-   memset(pq->start, 0, sizeof(pq->start));
-   memset(pq->end, 0, sizeof(pq->end));
+   memset(pq->start, 0, pq->num_threads * sizeof(pq->start[0]));
+   memset(pq->end, 0, pq->num_threads * sizeof(pq->end[0]));
    lp_setup_begin_query(llvmpipe->setup, pq);
 
    switch (pq->type) {
@@ -249,6 +321,12 @@ llvmpipe_end_query(struct pipe_context *pipe, struct pipe_query *q)
    struct llvmpipe_context *llvmpipe = llvmpipe_context( pipe );
    struct llvmpipe_query *pq = llvmpipe_query(q);
 
+   if (pq->type >= PIPE_QUERY_DRIVER_SPECIFIC) {
+      pq->driver_value =
+         llvmpipe_sample_driver_query(llvmpipe, pq->type) - pq->driver_value;
+      return true;
+   }
+
    lp_setup_end_query(llvmpipe->setup, pq);
 
    switch (pq->type) {
@@ -34,6 +34,7 @@
 #define LP_QUERY_H
 
 #include <limits.h>
+#include "pipe/p_defines.h"
 #include "os/os_thread.h"
 #include "lp_limits.h"
 
@@ -41,13 +42,32 @@
 struct llvmpipe_context;
 
 
+/**
+ * Driver specific queries, see llvmpipe_get_driver_query_info().
+ * They sample running totals on the CPU at begin and end, so rasterizer
+ * work is accounted when it happens, not to the frame which binned it.
+ */
+enum llvmpipe_query_type {
+   LP_QUERY_NUM_COMPILED_VARIANTS = PIPE_QUERY_DRIVER_SPECIFIC,
+   LP_QUERY_COMPILE_TIME,
+   LP_QUERY_NUM_TRIS_BINNED,
+   LP_QUERY_NUM_BINS,
+   LP_QUERY_NUM_FULL_TILES,
+   LP_QUERY_NUM_PARTIAL_TILES,
+   /* busy time of rasterizer thread N is LP_QUERY_RAST_BUSY_TIME + N */
+   LP_QUERY_RAST_BUSY_TIME,
+};
+
+
 struct llvmpipe_query {
-   uint64_t start[LP_MAX_THREADS];  /* start count value for each thread */
-   uint64_t end[LP_MAX_THREADS];    /* end count value for each thread */
+   uint64_t *start;                 /* start count value for each thread */
+   uint64_t *end;                   /* end count value for each thread */
+   unsigned num_threads;            /* size of the start/end arrays */
    struct lp_fence *fence;          /* fence from last scene this was binned in */
    unsigned type;                   /* PIPE_QUERY_* */
    unsigned num_primitives_generated;
    unsigned num_primitives_written;
+   uint64_t driver_value;           /* LP_QUERY_*: value at begin, then result */
 
    struct pipe_query_data_pipeline_statistics stats;
 };
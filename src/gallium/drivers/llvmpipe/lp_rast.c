@@ -26,6 +26,7 @@
  **************************************************************************/
 
 #include <limits.h>
+#include <float.h>
 #include "util/u_memory.h"
 #include "util/u_math.h"
 #include "util/u_rect.h"
@@ -33,6 +34,8 @@
 #include "util/u_pack_color.h"
 #include "util/u_string.h"
 #include "util/u_thread.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_atomic.h"
 
 #include "util/os_time.h"
 
@@ -57,6 +60,10 @@ const struct lp_rasterizer_task *jit_task = NULL;
 #endif
 
 
+static void
+lp_rast_schedule_bins(struct lp_rasterizer *rast, struct lp_scene *scene);
+
+
 /**
  * Begin rasterizing a scene.
  * Called once per scene by one thread.
@@ -70,7 +77,7 @@ lp_rast_begin( struct lp_rasterizer *rast,
    LP_DBG(DEBUG_RAST, "%s\n", __FUNCTION__);
 
    lp_scene_begin_rasterization( scene );
-   lp_scene_bin_iter_begin( scene );
+   lp_rast_schedule_bins( rast, scene );
 }
 
 
@@ -83,6 +90,248 @@ lp_rast_end( struct lp_rasterizer *rast )
 }
 
 
+/**
+ * Set up the coarse depth culling for the task's scene.
+ * Only single layer framebuffers whose depth is a 32 bit float or an unorm
+ * value are handled.
+ */
+static void
+lp_rast_hiz_begin_scene(struct lp_rasterizer_task *task)
+{
+   const struct lp_scene *scene = task->scene;
+   const struct util_format_description *desc;
+   const struct util_format_channel_description *chan;
+
+   task->hiz_enabled = FALSE;
+
+   if (!scene->zsbuf.map || scene->fb_max_layer > 0 ||
+       (LP_PERF & PERF_NO_HIZ))
+      return;
+
+   desc = util_format_description(scene->fb.zsbuf->format);
+   if (desc->colorspace != UTIL_FORMAT_COLORSPACE_ZS ||
+       desc->swizzle[0] > PIPE_SWIZZLE_W ||
+       desc->block.bits < 16)
+      return;
+
+   chan = &desc->channel[desc->swizzle[0]];
+   if (chan->type == UTIL_FORMAT_TYPE_FLOAT && chan->size == 32)
+      task->hiz_float = TRUE;
+   else if (chan->type == UTIL_FORMAT_TYPE_UNSIGNED && chan->normalized &&
+            chan->size <= 32)
+      task->hiz_float = FALSE;
+   else
+      return;
+
+   task->hiz_shift = chan->shift;
+   task->hiz_bits = chan->size;
+   task->hiz_epsilon = 1.0f / (1 << 20);
+   if (!task->hiz_float)
+      task->hiz_epsilon += 1.0 / ((UINT64_C(1) << chan->size) - 1);
+   task->hiz_enabled = TRUE;
+}
+
+
+/**
+ * Convert a z/stencil texel of the scene's zsbuf to its depth value.
+ */
+static inline float
+lp_rast_hiz_depth(const struct lp_rasterizer_task *task, uint64_t texel)
+{
+   const uint64_t z = (texel >> task->hiz_shift) &
+                      ((UINT64_C(1) << task->hiz_bits) - 1);
+
+   if (task->hiz_float) {
+      union fi fi;
+      fi.ui = (uint32_t)z;
+      return fi.f;
+   }
+
+   return (float)((double)z / (double)((UINT64_C(1) << task->hiz_bits) - 1));
+}
+
+
+/**
+ * Compute the maximum stored depth of the i-th 16x16 block of the tile.
+ */
+static float
+lp_rast_hiz_scan_16(const struct lp_rasterizer_task *task, unsigned i)
+{
+   const struct lp_scene *scene = task->scene;
+   const unsigned x0 = (i & 3) * 16;
+   const unsigned y0 = (i >> 2) * 16;
+   const unsigned width = x0 < task->width ? MIN2(task->width - x0, 16) : 0;
+   const unsigned height = y0 < task->height ? MIN2(task->height - y0, 16) : 0;
+   const unsigned bytes = scene->zsbuf.format_bytes;
+   float zmax = -FLT_MAX;
+   unsigned x, y;
+
+   for (y = 0; y < height; y++) {
+      const uint8_t *row = task->depth_tile +
+                           (y0 + y) * scene->zsbuf.stride + x0 * bytes;
+
+      for (x = 0; x < width; x++) {
+         uint64_t texel;
+         float z;
+
+         switch (bytes) {
+         case 2:
+            texel = ((const uint16_t *)row)[x];
+            break;
+         case 4:
+            texel = ((const uint32_t *)row)[x];
+            break;
+         default:
+            texel = ((const uint64_t *)row)[x];
+            break;
+         }
+
+         z = lp_rast_hiz_depth(task, texel);
+         zmax = MAX2(zmax, z);
+      }
+   }
+
+   return zmax;
+}
+
+
+/**
+ * Upper bound of the depth stored in the i-th 16x16 block, reading it
+ * back from the depth buffer the first time it is needed in a tile.
+ */
+static inline float
+lp_rast_hiz_block_max(struct lp_rasterizer_task *task, unsigned i)
+{
+   if (!(task->hiz_valid & (1 << i))) {
+      task->hiz_max[i] = lp_rast_hiz_scan_16(task, i);
+      task->hiz_valid |= 1 << i;
+   }
+   return task->hiz_max[i];
+}
+
+
+/**
+ * Range of the interpolated depth over a size x size block of pixels.
+ */
+static inline void
+lp_rast_hiz_plane_range(const struct lp_rast_shader_inputs *inputs,
+                        int x, int y, int size,
+                        float *zmin, float *zmax)
+{
+   const float dzdx = GET_DADX(inputs)[0][2];
+   const float dzdy = GET_DADY(inputs)[0][2];
+   const float z = GET_A0(inputs)[0][2] + dzdx * x + dzdy * y;
+   const float ex = dzdx * size;
+   const float ey = dzdy * size;
+
+   *zmin = z + MIN2(ex, 0.0f) + MIN2(ey, 0.0f);
+   *zmax = z + MAX2(ex, 0.0f) + MAX2(ey, 0.0f);
+}
+
+
+/**
+ * Whether all fragments of the size x size block at x, y fail the depth
+ * test against a stored depth of at most hiz.
+ */
+static inline boolean
+lp_rast_hiz_occluded(const struct lp_rasterizer_task *task,
+                     const struct lp_rast_shader_inputs *inputs,
+                     int x, int y, int size, float hiz)
+{
+   float zmin, zmax;
+
+   lp_rast_hiz_plane_range(inputs, x, y, size, &zmin, &zmax);
+
+   /* unorm depth is clamped by the conversion */
+   if (!task->hiz_float)
+      zmin = MIN2(zmin, 1.0f);
+
+   return zmin > hiz + task->hiz_epsilon;
+}
+
+
+/**
+ * Drop the 16x16 blocks of the tile in mask which are known to be occluded.
+ * Only valid when task->hiz_test is set.
+ * \return the remaining blocks
+ */
+unsigned
+lp_rast_hiz_cull_16(struct lp_rasterizer_task *task,
+                    const struct lp_rast_shader_inputs *inputs,
+                    unsigned mask)
+{
+   unsigned blocks = mask;
+
+   while (blocks) {
+      const int i = ffs(blocks) - 1;
+
+      blocks &= ~(1 << i);
+
+      if (lp_rast_hiz_occluded(task, inputs,
+                               task->x + (i & 3) * 16,
+                               task->y + (i >> 2) * 16, 16,
+                               lp_rast_hiz_block_max(task, i))) {
+         mask &= ~(1 << i);
+         LP_COUNT(nr_hiz_culled_16);
+      }
+   }
+
+   return mask;
+}
+
+
+/**
+ * Whether the size x size block of pixels at window position x, y is known
+ * to be occluded.  The block needs not be aligned, but must start inside
+ * the tile.  Only valid when task->hiz_test is set.
+ */
+boolean
+lp_rast_hiz_cull_rect(struct lp_rasterizer_task *task,
+                      const struct lp_rast_shader_inputs *inputs,
+                      int x, int y, int size)
+{
+   const int bx0 = (x - (int)task->x) / 16;
+   const int by0 = (y - (int)task->y) / 16;
+   const int bx1 = MIN2((x + size - 1 - (int)task->x) / 16, 3);
+   const int by1 = MIN2((y + size - 1 - (int)task->y) / 16, 3);
+   float hiz = -FLT_MAX;
+   int bx, by;
+
+   for (by = by0; by <= by1; by++)
+      for (bx = bx0; bx <= bx1; bx++)
+         hiz = MAX2(hiz, lp_rast_hiz_block_max(task, by * 4 + bx));
+
+   if (lp_rast_hiz_occluded(task, inputs, x, y, size, hiz)) {
+      LP_COUNT(nr_hiz_culled_16);
+      return TRUE;
+   }
+
+   return FALSE;
+}
+
+
+/**
+ * Lower the coarse depth of the 16x16 block at x, y after it was fully
+ * covered and shaded.  Only valid when task->hiz_update is set.
+ */
+void
+lp_rast_hiz_update_16(struct lp_rasterizer_task *task,
+                      const struct lp_rast_shader_inputs *inputs,
+                      int x, int y)
+{
+   const unsigned i = ((y - task->y) / 16) * 4 + (x - task->x) / 16;
+   float zmin, zmax;
+
+   lp_rast_hiz_plane_range(inputs, x, y, 16, &zmin, &zmax);
+   zmax += task->hiz_epsilon;
+
+   if (!(task->hiz_valid & (1 << i)) || zmax < task->hiz_max[i]) {
+      task->hiz_max[i] = zmax;
+      task->hiz_valid |= 1 << i;
+   }
+}
+
+
 /**
  * Beginning rasterization of a tile.
  * \param x  window X position of the tile, in pixels
@@ -109,6 +358,10 @@ lp_rast_tile_begin(struct lp_rasterizer_task *task,
    task->thread_data.vis_counter = 0;
    task->thread_data.ps_invocations = 0;
 
+   task->hiz_test = FALSE;
+   task->hiz_update = FALSE;
+   task->hiz_valid = 0;
+
    for (i = 0; i < task->scene->fb.nr_cbufs; i++) {
       if (task->scene->fb.cbufs[i]) {
          task->color_tiles[i] = scene->cbufs[i].map +
@@ -281,6 +534,21 @@ lp_rast_clear_zstencil(struct lp_rasterizer_task *task,
          }
          dst_layer += scene->zsbuf.layer_stride;
       }
+
+      if (task->hiz_enabled) {
+         const uint64_t z_mask =
+            ((UINT64_C(1) << task->hiz_bits) - 1) << task->hiz_shift;
+
+         if ((clear_mask64 & z_mask) == z_mask) {
+            const float z = lp_rast_hiz_depth(task, arg.clear_zstencil.value);
+            for (i = 0; i < LP_HIZ_BLOCKS; i++)
+               task->hiz_max[i] = z;
+            task->hiz_valid = (1 << LP_HIZ_BLOCKS) - 1;
+         }
+         else if (clear_mask64 & z_mask) {
+            task->hiz_valid = 0;
+         }
+      }
    }
 }
 
@@ -300,6 +568,7 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
    const struct lp_rast_state *state;
    struct lp_fragment_shader_variant *variant;
    const unsigned tile_x = task->x, tile_y = task->y;
+   unsigned blocks = 0xffff;
    unsigned x, y;
 
    if (inputs->disable) {
@@ -316,6 +585,12 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
    }
    variant = state->variant;
 
+   if (task->hiz_test) {
+      blocks = lp_rast_hiz_cull_16(task, inputs, blocks);
+      if (!blocks)
+         return;
+   }
+
    /* render the whole 64x64 tile in 4x4 chunks */
    for (y = 0; y < task->height; y += 4){
       for (x = 0; x < task->width; x += 4) {
@@ -325,6 +600,9 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
          unsigned depth_stride = 0;
          unsigned i;
 
+         if (!(blocks & (1 << ((y / 16) * 4 + x / 16))))
+            continue;
+
          /* color buffer */
          for (i = 0; i < scene->fb.nr_cbufs; i++){
             if (scene->fb.cbufs[i]) {
@@ -365,6 +643,15 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
          END_JIT_CALL();
       }
    }
+
+   if (task->hiz_update) {
+      while (blocks) {
+         const int i = ffs(blocks) - 1;
+         blocks &= ~(1 << i);
+         lp_rast_hiz_update_16(task, inputs,
+                               tile_x + (i & 3) * 16, tile_y + (i >> 2) * 16);
+      }
+   }
 }
 
 
@@ -534,7 +821,19 @@ void
 lp_rast_set_state(struct lp_rasterizer_task *task,
                   const union lp_rast_cmd_arg arg)
 {
+   const struct lp_fragment_shader_variant *variant = arg.state->variant;
+
    task->state = arg.state;
+
+   /*
+    * set_state is only binned ahead of commands using the state, so it is a
+    * convenient point to forget the coarse depth of the tile when they may
+    * raise the stored depth.
+    */
+   task->hiz_test = task->hiz_enabled && variant->hiz_test;
+   task->hiz_update = task->hiz_enabled && variant->hiz_update;
+   if (variant->hiz_invalidate)
+      task->hiz_valid = 0;
 }
 
 
@@ -605,7 +904,17 @@ do_rasterize_bin(struct lp_rasterizer_task *task,
 
    for (block = bin->head; block; block = block->next) {
       for (k = 0; k < block->count; k++) {
-         dispatch[block->cmd[k]]( task, block->arg[k] );
+         const unsigned cmd = block->cmd[k];
+
+         if (cmd == LP_RAST_OP_SHADE_TILE ||
+             cmd == LP_RAST_OP_SHADE_TILE_OPAQUE)
+            task->stats.nr_full_tiles++;
+         else if ((cmd >= LP_RAST_OP_TRIANGLE_1 &&
+                   cmd <= LP_RAST_OP_TRIANGLE_4_16) ||
+                  cmd >= LP_RAST_OP_TRIANGLE_32_1)
+            task->stats.nr_partial_tiles++;
+
+         dispatch[cmd]( task, block->arg[k] );
       }
    }
 }
@@ -628,6 +937,8 @@ rasterize_bin(struct lp_rasterizer_task *task,
 
    lp_rast_tile_end(task);
 
+   task->stats.nr_bins++;
+
 
    /* Debug/Perf flags:
     */
@@ -654,6 +965,105 @@ is_empty_bin( const struct cmd_bin *bin )
 }
 
 
+/**
+ * Distribute the scene's non-empty bins over the rasterizer threads.
+ *
+ * Each thread gets a contiguous run of bins in raster order, so that
+ * neighbouring tiles (which tend to touch the same textures) stay on one
+ * thread, with runs balanced by the number of commands binned in them.
+ * Threads which finish early steal bins from the far end of the other
+ * threads' runs, see lp_rast_next_bin().
+ */
+static void
+lp_rast_schedule_bins(struct lp_rasterizer *rast, struct lp_scene *scene)
+{
+   const unsigned num_tasks = MAX2(1, rast->num_threads);
+   unsigned total_cost = 0, cost = 0;
+   unsigned x, y, i, t;
+
+   rast->num_bins = 0;
+
+   for (y = 0; y < scene->tiles_y; y++) {
+      for (x = 0; x < scene->tiles_x; x++) {
+         const struct cmd_bin *bin = lp_scene_get_bin(scene, x, y);
+         struct lp_rast_bin_ref *ref = &rast->bins[rast->num_bins];
+         const struct cmd_block *block;
+
+         if (is_empty_bin(bin))
+            continue;
+
+         /* Count the tile load/store itself as one command. */
+         ref->x = x;
+         ref->y = y;
+         ref->cost = 1;
+         for (block = bin->head; block; block = block->next)
+            ref->cost += block->count;
+
+         total_cost += ref->cost;
+         rast->num_bins++;
+      }
+   }
+
+   t = 0;
+   rast->tasks[0].bin_head = 0;
+   for (i = 0; i < rast->num_bins; i++) {
+      cost += rast->bins[i].cost;
+      if (t + 1 < num_tasks &&
+          (uint64_t)cost * num_tasks >= (uint64_t)total_cost * (t + 1)) {
+         rast->tasks[t].bin_tail = i + 1;
+         rast->tasks[++t].bin_head = i + 1;
+      }
+   }
+   rast->tasks[t].bin_tail = rast->num_bins;
+
+   while (++t < num_tasks) {
+      rast->tasks[t].bin_head = rast->num_bins;
+      rast->tasks[t].bin_tail = rast->num_bins;
+   }
+
+   p_atomic_set(&rast->bins_remaining, rast->num_bins);
+}
+
+
+/**
+ * Get the next bin for this thread to rasterize: the front of its own run
+ * or, once that's exhausted, the back of another thread's run.
+ * Returns NULL when the scene is done.
+ */
+static const struct lp_rast_bin_ref *
+lp_rast_next_bin(struct lp_rasterizer_task *task)
+{
+   struct lp_rasterizer *rast = task->rast;
+   const unsigned num_tasks = MAX2(1, rast->num_threads);
+   unsigned i;
+
+   for (i = 0; i < num_tasks; i++) {
+      struct lp_rasterizer_task *victim =
+         &rast->tasks[(task->thread_index + i) % num_tasks];
+      int idx = -1;
+
+      if (p_atomic_read(&rast->bins_remaining) <= 0)
+         return NULL;
+
+      mtx_lock(&victim->bin_mutex);
+      if (victim->bin_head < victim->bin_tail) {
+         if (victim == task)
+            idx = victim->bin_head++;
+         else
+            idx = --victim->bin_tail;
+      }
+      mtx_unlock(&victim->bin_mutex);
+
+      if (idx >= 0) {
+         p_atomic_dec(&rast->bins_remaining);
+         return &rast->bins[idx];
+      }
+   }
+
+   return NULL;
+}
+
+
 /**
  * Rasterize/execute all bins within a scene.
  * Called per thread.
@@ -664,6 +1074,8 @@ rasterize_scene(struct lp_rasterizer_task *task,
 {
    task->scene = scene;
 
+   lp_rast_hiz_begin_scene(task);
+
    /* Clear the cache tags. This should not always be necessary but
       simpler for now. */
 #if LP_USE_TEXTURE_CACHE
@@ -678,14 +1090,16 @@ rasterize_scene(struct lp_rasterizer_task *task,
    if (!task->rast->no_rast) {
       /* loop over scene bins, rasterize each */
       {
-         struct cmd_bin *bin;
-         int i, j;
+         const struct lp_rast_bin_ref *ref;
+         int64_t start = os_time_get_nano();
 
          assert(scene);
-         while ((bin = lp_scene_bin_iter_next(scene, &i, &j))) {
-            if (!is_empty_bin( bin ))
-               rasterize_bin(task, bin, i, j);
+         while ((ref = lp_rast_next_bin(task))) {
+            rasterize_bin(task, lp_scene_get_bin(scene, ref->x, ref->y),
+                          ref->x, ref->y);
          }
+
+         task->stats.busy_time += os_time_get_nano() - start;
       }
    }
 
@@ -704,10 +1118,6 @@ rasterize_scene(struct lp_rasterizer_task *task,
    }
 #endif
 
-   if (scene->fence) {
-      lp_fence_signal(scene->fence);
-   }
-
    task->scene = NULL;
 }
 
@@ -730,12 +1140,17 @@ lp_rast_queue_scene( struct lp_rasterizer *rast,
        */
       util_fpstate_set_denorms_to_zero(fpstate);
 
+      lp_fence_reference(&rast->last_fence, scene->fence);
+
       lp_rast_begin( rast, scene );
 
       rasterize_scene( &rast->tasks[0], scene );
 
       lp_rast_end( rast );
 
+      if (scene->fence)
+         lp_fence_signal(scene->fence);
+
       util_fpstate_set(fpstate);
 
       rast->curr_scene = NULL;
@@ -744,6 +1159,11 @@ lp_rast_queue_scene( struct lp_rasterizer *rast,
       /* threaded rendering! */
       unsigned i;
 
+      /* Setup doesn't wait for the rasterizer; it reuses the scene once
+       * its fence has signalled.  Several scenes may be queued at once.
+       */
+      lp_fence_reference(&rast->last_fence, scene->fence);
+
       lp_scene_enqueue( rast->full_scenes, scene );
 
       /* signal the threads that there's work to do */
@@ -756,20 +1176,37 @@ lp_rast_queue_scene( struct lp_rasterizer *rast,
 }
 
 
+/**
+ * Wait until every scene queued so far has been rasterized.
+ * Scenes are rasterized in order, so it's enough to wait on the fence of
+ * the last one.  Must be called with the screen's rast_mutex held.
+ */
 void
 lp_rast_finish( struct lp_rasterizer *rast )
 {
-   if (rast->num_threads == 0) {
-      /* nothing to do */
-   }
-   else {
-      int i;
+   if (rast->last_fence && lp_fence_issued(rast->last_fence))
+      lp_fence_wait(rast->last_fence);
+}
 
-      /* wait for work to complete */
-      for (i = 0; i < rast->num_threads; i++) {
-         pipe_semaphore_wait(&rast->tasks[i].work_done);
-      }
-   }
+
+unsigned
+lp_rast_get_num_threads( const struct lp_rasterizer *rast )
+{
+   return MAX2(1, rast->num_threads);
+}
+
+
+/**
+ * Return the running totals of one rasterizer thread.  They are read
+ * while the thread may be updating them, which is fine for statistics.
+ */
+void
+lp_rast_get_stats( const struct lp_rasterizer *rast,
+                   unsigned thread_index,
+                   struct lp_rast_stats *stats )
+{
+   assert(thread_index < lp_rast_get_num_threads(rast));
+   *stats = rast->tasks[thread_index].stats;
 }
 
 
@@ -788,6 +1225,7 @@ thread_function(void *init_data)
    boolean debug = false;
    char thread_name[16];
    unsigned fpstate;
+   struct lp_scene *scene;
 
    snprintf(thread_name, sizeof thread_name, "llvmpipe-%u", task->thread_index);
    u_thread_setname(thread_name);
@@ -821,27 +1259,30 @@ thread_function(void *init_data)
        */
       util_barrier_wait( &rast->barrier );
 
+      scene = rast->curr_scene;
+
       /* do work */
       if (debug)
          debug_printf("thread %d doing work\n", task->thread_index);
 
-      rasterize_scene(task,
-                      rast->curr_scene);
+      rasterize_scene(task, scene);
       
       /* wait for all threads to finish with this scene */
       util_barrier_wait( &rast->barrier );
 
-      /* XXX: shouldn't be necessary:
+      /* thread[0] unmaps the framebuffer surfaces before signalling, so
+       * the scene is fully retired once its fence is signalled.
        */
       if (task->thread_index == 0) {
          lp_rast_end( rast );
       }
 
-      /* signal done with work */
+      /* signal done with work; setup may recycle the scene after this */
       if (debug)
          debug_printf("thread %d done working\n", task->thread_index);
 
-      pipe_semaphore_signal(&task->work_done);
+      if (scene->fence)
+         lp_fence_signal(scene->fence);
    }
 
 #ifdef _WIN32
@@ -856,8 +1297,10 @@ thread_function(void *init_data)
  * Initialize semaphores and spawn the threads.
  */
 static void
-create_rast_threads(struct lp_rasterizer *rast)
+create_rast_threads(struct lp_rasterizer *rast, boolean pin_threads)
 {
+   const unsigned cores_per_L3 = util_cpu_caps.cores_per_L3;
+   const unsigned num_L3_caches = util_cpu_caps.nr_cpus / cores_per_L3;
    unsigned i;
 
    /* NOTE: if num_threads is zero, we won't use any threads */
@@ -866,6 +1309,15 @@ create_rast_threads(struct lp_rasterizer *rast)
       pipe_semaphore_init(&rast->tasks[i].work_done, 0);
       rast->threads[i] = u_thread_create(thread_function,
                                             (void *) &rast->tasks[i]);
+
+      /* Fill one L3 domain before moving on to the next one, so that
+       * consecutive threads (which tend to work on neighbouring tiles)
+       * share a cache.
+       */
+      if (pin_threads)
+         util_pin_thread_to_L3(rast->threads[i],
+                               (i / cores_per_L3) % num_L3_caches,
+                               cores_per_L3);
    }
 }
 
@@ -875,9 +1327,10 @@ create_rast_threads(struct lp_rasterizer *rast)
  * Create new lp_rasterizer.  If num_threads is zero, don't create any
  * new threads, do rendering synchronously.
  * \param num_threads  number of rasterizer threads to create
+ * \param pin_threads  whether to pin the threads to L3 cache domains
  */
 struct lp_rasterizer *
-lp_rast_create( unsigned num_threads )
+lp_rast_create( unsigned num_threads, boolean pin_threads )
 {
    struct lp_rasterizer *rast;
    unsigned i;
@@ -887,6 +1340,13 @@ lp_rast_create( unsigned num_threads )
       goto no_rast;
    }
 
+   rast->tasks = CALLOC(MAX2(1, num_threads), sizeof(rast->tasks[0]));
+   rast->threads = CALLOC(MAX2(1, num_threads), sizeof(rast->threads[0]));
+   rast->bins = CALLOC(TILES_X * TILES_Y, sizeof(rast->bins[0]));
+   if (!rast->tasks || !rast->threads || !rast->bins) {
+      goto no_tasks;
+   }
+
    rast->full_scenes = lp_scene_queue_create();
    if (!rast->full_scenes) {
       goto no_full_scenes;
@@ -896,6 +1356,7 @@ lp_rast_create( unsigned num_threads )
       struct lp_rasterizer_task *task = &rast->tasks[i];
       task->rast = rast;
       task->thread_index = i;
+      (void) mtx_init(&task->bin_mutex, mtx_plain);
       task->thread_data.cache = align_malloc(sizeof(struct lp_build_format_cache),
                                              16);
       if (!task->thread_data.cache) {
@@ -907,7 +1368,7 @@ lp_rast_create( unsigned num_threads )
 
    rast->no_rast = debug_get_bool_option("LP_NO_RAST", FALSE);
 
-   create_rast_threads(rast);
+   create_rast_threads(rast, pin_threads);
 
    /* for synchronizing rasterization threads */
    if (rast->num_threads > 0) {
@@ -927,6 +1388,10 @@ no_thread_data_cache:
 
    lp_scene_queue_destroy(rast->full_scenes);
 no_full_scenes:
+no_tasks:
+   FREE(rast->bins);
+   FREE(rast->threads);
+   FREE(rast->tasks);
    FREE(rast);
 no_rast:
    return NULL;
@@ -966,6 +1431,7 @@ void lp_rast_destroy( struct lp_rasterizer *rast )
    }
    for (i = 0; i < MAX2(1, rast->num_threads); i++) {
       align_free(rast->tasks[i].thread_data.cache);
+      mtx_destroy(&rast->tasks[i].bin_mutex);
    }
 
    /* for synchronizing rasterization threads */
@@ -973,8 +1439,13 @@ void lp_rast_destroy( struct lp_rasterizer *rast )
       util_barrier_destroy( &rast->barrier );
    }
 
+   lp_fence_reference(&rast->last_fence, NULL);
+
    lp_scene_queue_destroy(rast->full_scenes);
 
+   FREE(rast->bins);
+   FREE(rast->threads);
+   FREE(rast->tasks);
    FREE(rast);
 }
 
@@ -155,9 +155,20 @@ struct lp_rast_clear_rb {
 #define GET_PLANES(tri) ((struct lp_rast_plane *)((char *)(&(tri)->inputs + 1) + 3 * (tri)->inputs.stride))
 
 
+/**
+ * Running totals of a rasterizer thread, reported as driver queries.
+ */
+struct lp_rast_stats {
+   uint64_t nr_bins;           /**< bins (tiles) rasterized */
+   uint64_t nr_full_tiles;     /**< whole tiles shaded, fully covered */
+   uint64_t nr_partial_tiles;  /**< triangles rasterized within a tile */
+   uint64_t busy_time;         /**< in nanoseconds */
+};
+
+
 
 struct lp_rasterizer *
-lp_rast_create( unsigned num_threads );
+lp_rast_create( unsigned num_threads, boolean pin_threads );
 
 void
 lp_rast_destroy( struct lp_rasterizer * );
@@ -169,6 +180,14 @@ lp_rast_queue_scene( struct lp_rasterizer *rast,
 void
 lp_rast_finish( struct lp_rasterizer *rast );
 
+unsigned
+lp_rast_get_num_threads( const struct lp_rasterizer *rast );
+
+void
+lp_rast_get_stats( const struct lp_rasterizer *rast,
+                   unsigned thread_index,
+                   struct lp_rast_stats *stats );
+
 
 union lp_rast_cmd_arg {
    const struct lp_rast_shader_inputs *shade_tile;
@@ -76,6 +76,9 @@ extern const struct lp_rasterizer_task *jit_task;
 struct lp_rasterizer;
 struct cmd_bin;
 
+/** Number of 16x16 blocks in a tile tracked by the coarse depth */
+#define LP_HIZ_BLOCKS ((TILE_SIZE / 16) * (TILE_SIZE / 16))
+
 /**
  * Per-thread rasterization state
  */
@@ -100,8 +103,43 @@ struct lp_rasterizer_task
    /** Non-interpolated passthru state and occlude counter for visible pixels */
    struct lp_jit_thread_data thread_data;
 
+   /** Only written by this thread, read unlocked by the driver queries */
+   struct lp_rast_stats stats;
+
    pipe_semaphore work_ready;
    pipe_semaphore work_done;
+
+   /** This thread's run of lp_rasterizer::bins, see lp_rast_schedule_bins */
+   mtx_t bin_mutex;
+   unsigned bin_head, bin_tail;
+
+   /**
+    * Coarse depth of the current tile.  hiz_max[i] is an upper bound of
+    * the depth stored in the i-th 16x16 block (numbered like the block
+    * masks of the triangle rasterizer) when bit i of hiz_valid is set.
+    * hiz_test/hiz_update cache the current state's variant flags.
+    */
+   boolean hiz_enabled;
+   boolean hiz_test;
+   boolean hiz_update;
+   unsigned hiz_valid;
+   float hiz_max[LP_HIZ_BLOCKS];
+
+   /** Depth channel of the scene's zsbuf, for computing hiz_max */
+   unsigned hiz_shift, hiz_bits;
+   boolean hiz_float;
+   /** Margin covering depth quantization and interpolation rounding */
+   float hiz_epsilon;
+};
+
+
+/**
+ * A non-empty bin of the current scene and its estimated cost.
+ */
+struct lp_rast_bin_ref
+{
+   uint16_t x, y;
+   unsigned cost;
 };
 
 
@@ -118,14 +156,22 @@ struct lp_rasterizer
    /** The incoming queue of scenes ready to rasterize */
    struct lp_scene_queue *full_scenes;
 
+   /** Fence of the most recently queued scene, for lp_rast_finish() */
+   struct lp_fence *last_fence;
+
    /** The scene currently being rasterized by the threads */
    struct lp_scene *curr_scene;
 
    /** A task object for each rasterization thread */
-   struct lp_rasterizer_task tasks[LP_MAX_THREADS];
+   struct lp_rasterizer_task *tasks;
+
+   /** The current scene's non-empty bins, in raster order */
+   struct lp_rast_bin_ref *bins;
+   unsigned num_bins;
+   int bins_remaining;
 
    unsigned num_threads;
-   thrd_t threads[LP_MAX_THREADS];
+   thrd_t *threads;
 
    /** For synchronizing the rasterization threads */
    util_barrier barrier;
@@ -278,6 +324,21 @@ lp_rast_shade_quads_all( struct lp_rasterizer_task *task,
    }
 }
 
+unsigned
+lp_rast_hiz_cull_16(struct lp_rasterizer_task *task,
+                    const struct lp_rast_shader_inputs *inputs,
+                    unsigned mask);
+
+boolean
+lp_rast_hiz_cull_rect(struct lp_rasterizer_task *task,
+                      const struct lp_rast_shader_inputs *inputs,
+                      int x, int y, int size);
+
+void
+lp_rast_hiz_update_16(struct lp_rasterizer_task *task,
+                      const struct lp_rast_shader_inputs *inputs,
+                      int x, int y);
+
 void lp_rast_triangle_1( struct lp_rasterizer_task *, 
                          const union lp_rast_cmd_arg );
 void lp_rast_triangle_2( struct lp_rasterizer_task *, 
@@ -284,6 +284,15 @@ TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
 
    LP_COUNT_ADD(nr_empty_16, util_bitcount(0xffff & ~(partial_mask | inmask)));
 
+   /* Drop the blocks the triangle is known to be behind:
+    */
+   if (task->hiz_test) {
+      const unsigned visible =
+         lp_rast_hiz_cull_16(task, &tri->inputs, partial_mask | inmask);
+      partial_mask &= visible;
+      inmask &= visible;
+   }
+
    /* Iterate over partials:
     */
    while (partial_mask) {
@@ -345,6 +354,9 @@ TRI_16(struct lp_rasterizer_task *task,
    x += task->x;
    y += task->y;
 
+   if (task->hiz_test && lp_rast_hiz_cull_rect(task, &tri->inputs, x, y, 16))
+      return;
+
    for (j = 0; j < NR_PLANES; j++) {
       const int dcdx = -plane[j].dcdx * 4;
       const int dcdy = plane[j].dcdy * 4;
@@ -62,8 +62,6 @@ lp_scene_create( struct pipe_context *pipe )
    scene->data.head =
       CALLOC_STRUCT(data_block);
 
-   (void) mtx_init(&scene->mutex, mtx_plain);
-
 #ifdef DEBUG
    /* Do some scene limit sanity checks here */
    {
@@ -90,7 +88,6 @@ void
 lp_scene_destroy(struct lp_scene *scene)
 {
    lp_fence_reference(&scene->fence, NULL);
-   mtx_destroy(&scene->mutex);
    assert(scene->data.head->next == NULL);
    FREE(scene->data.head);
    FREE(scene);
@@ -204,12 +201,13 @@ lp_scene_begin_rasterization(struct lp_scene *scene)
 
 
 /**
- * Free all the temporary data in a scene.
+ * Unmap the framebuffer surfaces mapped by lp_scene_begin_rasterization().
+ * Called once per scene by one rasterizer thread.
  */
 void
 lp_scene_end_rasterization(struct lp_scene *scene )
 {
-   int i, j;
+   int i;
 
    /* Unmap color buffers */
    for (i = 0; i < scene->fb.nr_cbufs; i++) {
@@ -232,6 +230,18 @@ lp_scene_end_rasterization(struct lp_scene *scene )
                               zsbuf->u.tex.first_layer);
       scene->zsbuf.map = NULL;
    }
+}
+
+
+/**
+ * Free all the temporary data in a scene so it can be reused for binning.
+ * Called by setup once the scene's fence has signalled (or when binning
+ * failed and the scene was never rasterized).
+ */
+void
+lp_scene_reset(struct lp_scene *scene )
+{
+   int i, j;
 
    /* Reset all command lists:
     */
@@ -449,64 +459,6 @@ lp_scene_is_resource_referenced(const struct lp_scene *scene,
 
 
 
-/** advance curr_x,y to the next bin */
-static boolean
-next_bin(struct lp_scene *scene)
-{
-   scene->curr_x++;
-   if (scene->curr_x >= scene->tiles_x) {
-      scene->curr_x = 0;
-      scene->curr_y++;
-   }
-   if (scene->curr_y >= scene->tiles_y) {
-      /* no more bins */
-      return FALSE;
-   }
-   return TRUE;
-}
-
-
-void
-lp_scene_bin_iter_begin( struct lp_scene *scene )
-{
-   scene->curr_x = scene->curr_y = -1;
-}
-
-
-/**
- * Return pointer to next bin to be rendered.
- * The lp_scene::curr_x and ::curr_y fields will be advanced.
- * Multiple rendering threads will call this function to get a chunk
- * of work (a bin) to work on.
- */
-struct cmd_bin *
-lp_scene_bin_iter_next( struct lp_scene *scene , int *x, int *y)
-{
-   struct cmd_bin *bin = NULL;
-
-   mtx_lock(&scene->mutex);
-
-   if (scene->curr_x < 0) {
-      /* first bin */
-      scene->curr_x = 0;
-      scene->curr_y = 0;
-   }
-   else if (!next_bin(scene)) {
-      /* no more bins left */
-      goto end;
-   }
-
-   bin = lp_scene_get_bin(scene, scene->curr_x, scene->curr_y);
-   *x = scene->curr_x;
-   *y = scene->curr_y;
-
-end:
-   /*printf("return bin %p at %d, %d\n", (void *) bin, *bin_x, *bin_y);*/
-   mtx_unlock(&scene->mutex);
-   return bin;
-}
-
-
 void lp_scene_begin_binning(struct lp_scene *scene,
                             struct pipe_framebuffer_state *fb)
 {
@@ -548,6 +500,92 @@ void lp_scene_begin_binning(struct lp_scene *scene,
 }
 
 
+/**
+ * Prepare an empty scene to bin a batch of primitives on behalf of
+ * 'scene' from a setup worker thread.  The worker may allocate at most
+ * 'budget' bytes of scene data.  The results are appended to 'scene'
+ * with lp_scene_merge_bins().
+ */
+void
+lp_scene_begin_worker_binning(struct lp_scene *worker,
+                              const struct lp_scene *scene,
+                              unsigned budget)
+{
+   assert(lp_scene_is_empty(worker));
+
+   util_copy_framebuffer_state(&worker->fb, &scene->fb);
+
+   worker->tiles_x = scene->tiles_x;
+   worker->tiles_y = scene->tiles_y;
+   worker->fb_max_layer = scene->fb_max_layer;
+   worker->had_queries = scene->had_queries;
+
+   worker->scene_size = LP_SCENE_MAX_SIZE - MIN2(budget, LP_SCENE_MAX_SIZE);
+}
+
+
+/**
+ * Append the commands binned by a setup worker to the scene's bins and
+ * hand over the worker's data blocks, which the commands point into.
+ * The worker scene is left empty.
+ *
+ * Returns FALSE (and leaves both scenes untouched) if we're out of memory.
+ */
+boolean
+lp_scene_merge_bins(struct lp_scene *scene, struct lp_scene *worker)
+{
+   struct data_block *fresh, *block, *last;
+   unsigned x, y;
+
+   /* The worker needs a new current block once its own are handed over. */
+   fresh = MALLOC_STRUCT(data_block);
+   if (!fresh)
+      return FALSE;
+
+   fresh->used = 0;
+   fresh->next = NULL;
+
+   for (x = 0; x < worker->tiles_x; x++) {
+      for (y = 0; y < worker->tiles_y; y++) {
+         struct cmd_bin *src = lp_scene_get_bin(worker, x, y);
+         struct cmd_bin *dst = lp_scene_get_bin(scene, x, y);
+
+         if (!src->head)
+            continue;
+
+         if (dst->tail)
+            dst->tail->next = src->head;
+         else
+            dst->head = src->head;
+
+         dst->tail = src->tail;
+         dst->last_state = src->last_state;
+
+         src->head = NULL;
+         src->tail = NULL;
+         src->last_state = NULL;
+      }
+   }
+
+   /* Splice the worker's blocks in behind the scene's current block so the
+    * scene can keep allocating from it.
+    */
+   for (last = worker->data.head; last->next; last = last->next)
+      scene->scene_size += sizeof *last;
+   scene->scene_size += sizeof *last;
+
+   block = worker->data.head;
+   last->next = scene->data.head->next;
+   scene->data.head->next = block;
+
+   worker->data.head = fresh;
+
+   lp_scene_reset(worker);
+
+   return TRUE;
+}
+
+
 void lp_scene_end_binning( struct lp_scene *scene )
 {
    if (LP_DEBUG & DEBUG_SCENE) {
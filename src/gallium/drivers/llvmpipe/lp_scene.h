@@ -172,9 +172,6 @@ struct lp_scene {
     */
    unsigned tiles_x, tiles_y;
 
-   int curr_x, curr_y;  /**< for iterating over bins */
-   mtx_t mutex;
-
    struct cmd_bin tile[TILES_X][TILES_Y];
    struct data_block_list data;
 };
@@ -377,13 +374,6 @@ lp_scene_get_num_bins( const struct lp_scene *scene )
 }
 
 
-void
-lp_scene_bin_iter_begin( struct lp_scene *scene );
-
-struct cmd_bin *
-lp_scene_bin_iter_next( struct lp_scene *scene, int *x, int *y );
-
-
 
 /* Begin/end binning of a scene
  */
@@ -394,6 +384,14 @@ lp_scene_begin_binning(struct lp_scene *scene,
 void
 lp_scene_end_binning(struct lp_scene *scene);
 
+void
+lp_scene_begin_worker_binning(struct lp_scene *worker,
+                              const struct lp_scene *scene,
+                              unsigned budget);
+
+boolean
+lp_scene_merge_bins(struct lp_scene *scene, struct lp_scene *worker);
+
 
 /* Begin/end rasterization of a scene
  */
@@ -404,6 +402,12 @@ void
 lp_scene_end_rasterization(struct lp_scene *scene);
 
 
+/* Release the scene's resources and memory so it can be binned again
+ */
+void
+lp_scene_reset(struct lp_scene *scene);
+
+
 
 
 
@@ -33,10 +33,15 @@
 #include "util/u_screen.h"
 #include "util/u_string.h"
 #include "util/u_format_s3tc.h"
+#include "util/simple_list.h"
+#include "util/disk_cache.h"
+#include "util/mesa-sha1.h"
 #include "pipe/p_defines.h"
 #include "pipe/p_screen.h"
 #include "draw/draw_context.h"
 #include "gallivm/lp_bld_type.h"
+#include "gallivm/lp_bld_debug.h"
+#include "gallivm/lp_bld_init.h"
 
 #include "util/os_misc.h"
 #include "util/os_time.h"
@@ -48,8 +53,10 @@
 #include "lp_debug.h"
 #include "lp_public.h"
 #include "lp_limits.h"
+#include "lp_query.h"
 #include "lp_rast.h"
 #include "lp_cs_tpool.h"
+#include "lp_state_fs.h"
 
 #include "state_tracker/sw_winsys.h"
 
@@ -84,6 +91,7 @@ static const struct debug_named_value lp_perf_flags[] = {
    { "no_blend",       PERF_NO_BLEND, NULL },
    { "no_depth",       PERF_NO_DEPTH, NULL },
    { "no_alphatest",   PERF_NO_ALPHATEST, NULL },
+   { "no_hiz",         PERF_NO_HIZ, NULL },
    DEBUG_NAMED_VALUE_END
 };
 
@@ -640,6 +648,14 @@ llvmpipe_flush_frontbuffer(struct pipe_screen *_screen,
    struct llvmpipe_resource *texture = llvmpipe_resource(resource);
 
    assert(texture->dt);
+
+   /* Scenes are rasterized asynchronously; make sure everything queued so
+    * far has landed in the display target before presenting it.
+    */
+   mtx_lock(&screen->rast_mutex);
+   lp_rast_finish(screen->rast);
+   mtx_unlock(&screen->rast_mutex);
+
    if (texture->dt)
       winsys->displaytarget_display(winsys, texture->dt, context_private, sub_box);
 }
@@ -658,6 +674,11 @@ llvmpipe_destroy_screen( struct pipe_screen *_screen )
 
    lp_jit_screen_cleanup(screen);
 
+   if (util_queue_is_initialized(&screen->fs_compile_queue))
+      util_queue_destroy(&screen->fs_compile_queue);
+
+   disk_cache_destroy(screen->disk_shader_cache);
+
    if(winsys->destroy)
       winsys->destroy(winsys);
 
@@ -707,12 +728,173 @@ llvmpipe_fence_finish(struct pipe_screen *screen,
    return true;
 }
 
+static void
+llvmpipe_set_max_shader_compiler_threads(struct pipe_screen *_screen,
+                                         unsigned max_threads)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(_screen);
+
+   if (!util_queue_is_initialized(&screen->fs_compile_queue))
+      return;
+
+   /* Zero threads means no background compilation at all; the queue can't
+    * grow beyond the number of threads it was created with.
+    */
+   screen->async_fs_compile = max_threads != 0;
+   if (max_threads)
+      util_queue_adjust_num_threads(&screen->fs_compile_queue, max_threads);
+}
+
+static bool
+llvmpipe_is_parallel_shader_compilation_finished(struct pipe_screen *_screen,
+                                                 void *shader,
+                                                 unsigned shader_type)
+{
+   struct lp_fragment_shader *fs = shader;
+   struct lp_fs_variant_list_item *li;
+
+   if (shader_type != PIPE_SHADER_FRAGMENT)
+      return true;
+
+   for (li = first_elem(&fs->variants); !at_end(&fs->variants, li);
+        li = next_elem(li)) {
+      if (!util_queue_fence_is_signalled(&li->base->ready))
+         return false;
+   }
+   return true;
+}
+
 static uint64_t
 llvmpipe_get_timestamp(struct pipe_screen *_screen)
 {
    return os_time_get_nano();
 }
 
+
+static int
+llvmpipe_get_driver_query_info(struct pipe_screen *_screen,
+                               unsigned index,
+                               struct pipe_driver_query_info *info)
+{
+#define QUERY(NAME, ENUM, UNITS) \
+   {NAME, ENUM, {0}, UNITS, PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE, 0, 0x0}
+
+   static const struct pipe_driver_query_info queries[] = {
+      QUERY("compiled-variants", LP_QUERY_NUM_COMPILED_VARIANTS,
+            PIPE_DRIVER_QUERY_TYPE_UINT64),
+      QUERY("compile-time", LP_QUERY_COMPILE_TIME,
+            PIPE_DRIVER_QUERY_TYPE_MICROSECONDS),
+      QUERY("triangles-binned", LP_QUERY_NUM_TRIS_BINNED,
+            PIPE_DRIVER_QUERY_TYPE_UINT64),
+      QUERY("bins-rasterized", LP_QUERY_NUM_BINS,
+            PIPE_DRIVER_QUERY_TYPE_UINT64),
+      QUERY("tiles-full", LP_QUERY_NUM_FULL_TILES,
+            PIPE_DRIVER_QUERY_TYPE_UINT64),
+      QUERY("tiles-partial", LP_QUERY_NUM_PARTIAL_TILES,
+            PIPE_DRIVER_QUERY_TYPE_UINT64),
+   };
+   struct llvmpipe_screen *screen = llvmpipe_screen(_screen);
+   unsigned num_threads = MAX2(1, screen->num_threads);
+
+   if (!info)
+      return ARRAY_SIZE(queries) + num_threads;
+
+   if (index < ARRAY_SIZE(queries)) {
+      *info = queries[index];
+      return 1;
+   }
+
+   index -= ARRAY_SIZE(queries);
+   if (index >= num_threads)
+      return 0;
+
+   *info = (struct pipe_driver_query_info)
+      QUERY(screen->rast_busy_query_names[index],
+            LP_QUERY_RAST_BUSY_TIME + index,
+            PIPE_DRIVER_QUERY_TYPE_MICROSECONDS);
+#undef QUERY
+   return 1;
+}
+
+/**
+ * Create the on-disk cache for JIT-compiled shader variants.
+ *
+ * The cache is keyed on the driver and LLVM binaries as well as on anything
+ * else which changes the generated code for a given IR, so that stale or
+ * foreign machine code is never picked up.
+ */
+static void
+lp_disk_cache_create(struct llvmpipe_screen *screen)
+{
+#ifdef ENABLE_SHADER_CACHE
+   struct mesa_sha1 ctx;
+   unsigned char sha1[20];
+   char cache_id[20 * 2 + 1];
+
+   _mesa_sha1_init(&ctx);
+
+   if (!disk_cache_get_function_identifier(lp_disk_cache_create, &ctx) ||
+       !disk_cache_get_function_identifier(LLVMLinkInMCJIT, &ctx))
+      return;
+
+   _mesa_sha1_update(&ctx, &gallivm_perf, sizeof(gallivm_perf));
+   _mesa_sha1_update(&ctx, &lp_native_vector_width,
+                     sizeof(lp_native_vector_width));
+   _mesa_sha1_update(&ctx, &util_cpu_caps, sizeof(util_cpu_caps));
+   _mesa_sha1_final(&ctx, sha1);
+   disk_cache_format_hex_id(cache_id, sha1, 20 * 2);
+
+   screen->disk_shader_cache = disk_cache_create("llvmpipe", cache_id, 0);
+#endif
+}
+
+
+/**
+ * Look up the machine code for the given cache key.
+ *
+ * On a hit the code is stored in cache->data/data_size for the JIT to
+ * consume, otherwise cache is left untouched.
+ */
+void
+lp_disk_cache_find_shader(struct llvmpipe_screen *screen,
+                          struct lp_cached_code *cache,
+                          unsigned char ir_sha1_cache_key[20])
+{
+   unsigned char sha1[CACHE_KEY_SIZE];
+
+   if (!screen->disk_shader_cache)
+      return;
+
+   disk_cache_compute_key(screen->disk_shader_cache, ir_sha1_cache_key,
+                          20, sha1);
+
+   cache->data = disk_cache_get(screen->disk_shader_cache, sha1,
+                                &cache->data_size);
+   if (!cache->data)
+      cache->data_size = 0;
+}
+
+
+/**
+ * Store freshly generated machine code under the given cache key.
+ */
+void
+lp_disk_cache_insert_shader(struct llvmpipe_screen *screen,
+                            struct lp_cached_code *cache,
+                            unsigned char ir_sha1_cache_key[20])
+{
+   unsigned char sha1[CACHE_KEY_SIZE];
+
+   if (!screen->disk_shader_cache || !cache->data_size || cache->dont_cache)
+      return;
+
+   disk_cache_compute_key(screen->disk_shader_cache, ir_sha1_cache_key,
+                          20, sha1);
+   disk_cache_put(screen->disk_shader_cache, sha1, cache->data,
+                  cache->data_size, NULL);
+}
+
+
 /**
  * Create a new pipe_screen object
  * Note: we're not presently subclassing pipe_screen (no llvmpipe_screen).
@@ -721,6 +903,8 @@ struct pipe_screen *
 llvmpipe_create_screen(struct sw_winsys *winsys)
 {
    struct llvmpipe_screen *screen;
+   boolean pin_threads;
+   unsigned i;
 
    util_cpu_detect();
 
@@ -758,6 +942,11 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    screen->base.fence_finish = llvmpipe_fence_finish;
 
    screen->base.get_timestamp = llvmpipe_get_timestamp;
+   screen->base.get_driver_query_info = llvmpipe_get_driver_query_info;
+   screen->base.set_max_shader_compiler_threads =
+      llvmpipe_set_max_shader_compiler_threads;
+   screen->base.is_parallel_shader_compilation_finished =
+      llvmpipe_is_parallel_shader_compilation_finished;
 
    llvmpipe_init_screen_resource_funcs(&screen->base);
 
@@ -768,7 +957,19 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    screen->num_threads = debug_get_num_option("LP_NUM_THREADS", screen->num_threads);
    screen->num_threads = MIN2(screen->num_threads, LP_MAX_THREADS);
 
-   screen->rast = lp_rast_create(screen->num_threads);
+   for (i = 0; i < MAX2(1, screen->num_threads); i++) {
+      snprintf(screen->rast_busy_query_names[i],
+               sizeof screen->rast_busy_query_names[i],
+               "rast-busy-thread%u", i);
+   }
+
+   /* Pin the rasterizer and compute threads to L3 cache domains on CPUs
+    * which have more than one of them (e.g. AMD Zen, multi-socket hosts).
+    */
+   pin_threads = util_cpu_caps.nr_cpus != util_cpu_caps.cores_per_L3 &&
+                 debug_get_bool_option("LP_PIN_THREADS", TRUE);
+
+   screen->rast = lp_rast_create(screen->num_threads, pin_threads);
    if (!screen->rast) {
       lp_jit_screen_cleanup(screen);
       FREE(screen);
@@ -776,7 +977,7 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    }
    (void) mtx_init(&screen->rast_mutex, mtx_plain);
 
-   screen->cs_tpool = lp_cs_tpool_create(screen->num_threads);
+   screen->cs_tpool = lp_cs_tpool_create(screen->num_threads, pin_threads);
    if (!screen->cs_tpool) {
       lp_rast_destroy(screen->rast);
       lp_jit_screen_cleanup(screen);
@@ -785,5 +986,24 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    }
    (void) mtx_init(&screen->cs_mutex, mtx_plain);
 
+   lp_disk_cache_create(screen);
+
+   screen->tiled_textures = debug_get_bool_option("LP_TILED_TEXTURES", FALSE);
+
+   /* Compile optimized fragment shader variants in the background, drawing
+    * with quickly compiled unoptimized code in the meantime.
+    */
+   if (util_cpu_caps.nr_cpus > 1 &&
+       debug_get_bool_option("LP_ASYNC_FS_COMPILE", TRUE)) {
+      unsigned num_compile_threads = CLAMP(util_cpu_caps.nr_cpus / 2, 1, 4);
+
+      screen->async_fs_compile =
+         util_queue_init(&screen->fs_compile_queue, "lpfs", 64,
+                         num_compile_threads,
+                         UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+                         UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY |
+                         UTIL_QUEUE_INIT_SHARED_POOL);
+   }
+
    return &screen->base;
 }
@@ -37,11 +37,15 @@
 #include "pipe/p_screen.h"
 #include "pipe/p_defines.h"
 #include "os/os_thread.h"
+#include "util/u_queue.h"
 #include "gallivm/lp_bld.h"
+#include "lp_limits.h"
 
 
 struct sw_winsys;
 struct lp_cs_tpool;
+struct lp_cached_code;
+struct disk_cache;
 
 struct llvmpipe_screen
 {
@@ -60,8 +64,31 @@ struct llvmpipe_screen
 
    struct lp_cs_tpool *cs_tpool;
    mtx_t cs_mutex;
+
+   /* Persistent cache of JIT-compiled shader variants, may be NULL. */
+   struct disk_cache *disk_shader_cache;
+
+   /* Background compilation of optimized fragment shader variants */
+   struct util_queue fs_compile_queue;
+   boolean async_fs_compile;
+
+   /* Store textures in micro-tiles where possible */
+   boolean tiled_textures;
+
+   /* Names of the LP_QUERY_RAST_BUSY_TIME queries */
+   char rast_busy_query_names[LP_MAX_THREADS][24];
 };
 
+void
+lp_disk_cache_find_shader(struct llvmpipe_screen *screen,
+                          struct lp_cached_code *cache,
+                          unsigned char ir_sha1_cache_key[20]);
+
+void
+lp_disk_cache_insert_shader(struct llvmpipe_screen *screen,
+                            struct lp_cached_code *cache,
+                            unsigned char ir_sha1_cache_key[20]);
+
 
 
 
@@ -169,6 +169,9 @@ void
 lp_setup_end_query(struct lp_setup_context *setup,
                    struct llvmpipe_query *pq);
 
+uint64_t
+lp_setup_get_num_tris_binned(const struct lp_setup_context *setup);
+
 static inline unsigned
 lp_clamp_viewport_idx(int idx)
 {
@@ -53,11 +53,17 @@
 #define LP_SETUP_NEW_IMAGES      0x40
 
 struct lp_setup_variant;
+struct lp_setup_bin_worker;
 
 
 /** Max number of scenes */
-/* XXX: make multiple scenes per context work, see lp_setup_rasterize_scene */
-#define MAX_SCENES 1
+#define MAX_SCENES 8
+
+/** Default number of scenes, may be overridden with LP_NUM_SCENES */
+#define DEFAULT_SCENES 4
+
+/** Max number of threads binning a single vbuf batch, see lp_setup_vbuf.c */
+#define LP_MAX_BIN_WORKERS 8
 
 
 
@@ -88,10 +94,20 @@ struct lp_setup_context
     */
    struct draw_stage *vbuf;
    unsigned num_threads;
+   unsigned num_scenes;
    unsigned scene_idx;
    struct lp_scene *scenes[MAX_SCENES];  /**< all the scenes */
    struct lp_scene *scene;               /**< current scene being built */
 
+   /** Split large triangle batches over the compute thread pool */
+   boolean parallel_binning;
+   boolean bin_worker;   /**< this is a worker's copy of the context */
+   boolean bin_failed;   /**< worker ran out of scene memory */
+   struct lp_setup_bin_worker *bin_workers[LP_MAX_BIN_WORKERS];
+
+   /** Running total of triangles binned, for the driver queries */
+   uint64_t num_tris_binned;
+
    struct lp_fence *last_fence;
    struct llvmpipe_query *active_queries[LP_MAX_ACTIVE_BINNED_QUERIES];
    unsigned active_binned_queries;
@@ -198,6 +214,7 @@ void lp_setup_choose_line( struct lp_setup_context *setup );
 void lp_setup_choose_point( struct lp_setup_context *setup );
 
 void lp_setup_init_vbuf(struct lp_setup_context *setup);
+void lp_setup_destroy_bin_workers(struct lp_setup_context *setup);
 
 boolean lp_setup_update_state( struct lp_setup_context *setup,
                             boolean update_scene);
@@ -717,7 +717,11 @@ do_triangle_ccw(struct lp_setup_context *setup,
       assert(plane_s == &plane[nr_planes]);
    }
 
-   return lp_setup_bin_triangle(setup, tri, &bbox, &bboxpos, nr_planes, viewport_index);
+   if (!lp_setup_bin_triangle(setup, tri, &bbox, &bboxpos, nr_planes, viewport_index))
+      return FALSE;
+
+   setup->num_tris_binned++;
+   return TRUE;
 }
 
 /*
@@ -987,6 +991,12 @@ static void retry_triangle_ccw( struct lp_setup_context *setup,
 {
    if (!do_triangle_ccw( setup, position, v0, v1, v2, front ))
    {
+      /* Binning workers can't flush; the triangle gets redone serially. */
+      if (setup->bin_worker) {
+         setup->bin_failed = TRUE;
+         return;
+      }
+
       if (!lp_setup_flush_and_restart(setup))
          return;
 
@@ -38,6 +38,8 @@
 
 #include "lp_setup_context.h"
 #include "lp_context.h"
+#include "lp_screen.h"
+#include "lp_cs_tpool.h"
 #include "draw/draw_vbuf.h"
 #include "draw/draw_vertex.h"
 #include "util/u_memory.h"
@@ -46,6 +48,29 @@
 #define LP_MAX_VBUF_INDEXES 1024
 #define LP_MAX_VBUF_SIZE    4096
 
+/* With parallel binning the batches need to be large enough to be worth
+ * splitting, and each worker should get at least this many triangles.
+ */
+#define LP_MAX_VBUF_INDEXES_PARALLEL (16 * 1024)
+#define LP_MAX_VBUF_SIZE_PARALLEL    (1024 * 1024)
+#define LP_MIN_BIN_WORKER_TRIS       256
+
+
+/**
+ * A setup worker bins a contiguous range of a batch's triangles into its
+ * own scene, using a private copy of the setup context.
+ */
+struct lp_setup_bin_worker {
+   struct lp_setup_context setup;
+   struct lp_scene *scene;
+
+   const void *vertex_buffer;
+   const ushort *indices;       /**< NULL for draw_arrays */
+   unsigned stride;
+   unsigned first, last;        /**< triangle range */
+   unsigned failed;             /**< first triangle not binned, or ~0 */
+};
+
   
 
 /** cast wrapper */
@@ -129,6 +154,168 @@ static inline const_float4_ptr get_vert( const void *vertex_buffer,
    return (const_float4_ptr)((char *)vertex_buffer + index * stride);
 }
 
+static void
+lp_setup_bin_worker_run(void *data, int iter_idx,
+                        struct lp_cs_local_mem *lmem)
+{
+   struct lp_setup_context *setup = (struct lp_setup_context *) data;
+   struct lp_setup_bin_worker *worker = setup->bin_workers[iter_idx];
+   struct lp_setup_context *wsetup = &worker->setup;
+   const ushort *indices = worker->indices;
+   unsigned i;
+
+   for (i = worker->first; i < worker->last; i++) {
+      if (indices) {
+         wsetup->triangle( wsetup,
+                           get_vert(worker->vertex_buffer, indices[i*3+0], worker->stride),
+                           get_vert(worker->vertex_buffer, indices[i*3+1], worker->stride),
+                           get_vert(worker->vertex_buffer, indices[i*3+2], worker->stride) );
+      }
+      else {
+         wsetup->triangle( wsetup,
+                           get_vert(worker->vertex_buffer, i*3+0, worker->stride),
+                           get_vert(worker->vertex_buffer, i*3+1, worker->stride),
+                           get_vert(worker->vertex_buffer, i*3+2, worker->stride) );
+      }
+
+      if (wsetup->bin_failed) {
+         worker->failed = i;
+         return;
+      }
+   }
+}
+
+
+/**
+ * Bin a batch of PIPE_PRIM_TRIANGLES on several threads.  Each worker bins
+ * its share of the triangles into a private scene, then the results are
+ * appended to the current scene in primitive order.
+ *
+ * \param indices  the batch's indices, or NULL for draw_arrays
+ * \return  the number of vertices consumed; the caller bins the remaining
+ *          triangles serially
+ */
+static unsigned
+lp_setup_bin_triangles_parallel(struct lp_setup_context *setup,
+                                const void *vertex_buffer,
+                                unsigned stride,
+                                const ushort *indices,
+                                unsigned nr)
+{
+   struct llvmpipe_context *lp = llvmpipe_context(setup->pipe);
+   struct llvmpipe_screen *screen = llvmpipe_screen(setup->pipe->screen);
+   struct lp_scene *scene = setup->scene;
+   struct lp_cs_tpool_task *task;
+   unsigned nr_tris = nr / 3;
+   unsigned nr_workers, budget, i;
+   unsigned done = 0;
+   boolean failed = FALSE;
+   uint64_t num_tris_binned;
+
+   if (!setup->parallel_binning)
+      return 0;
+
+   /* The primitive counter can't be bumped from several threads. */
+   if (lp->active_statistics_queries)
+      return 0;
+
+   nr_workers = MIN3(setup->num_threads, LP_MAX_BIN_WORKERS,
+                     nr_tris / LP_MIN_BIN_WORKER_TRIS);
+   if (nr_workers < 2)
+      return 0;
+
+   /* Split what's left of the scene's memory budget between the workers,
+    * so the merged scene doesn't exceed it.
+    */
+   budget = (LP_SCENE_MAX_SIZE - MIN2(scene->scene_size, LP_SCENE_MAX_SIZE)) /
+            nr_workers;
+
+   for (i = 0; i < nr_workers; i++) {
+      struct lp_setup_bin_worker *worker = setup->bin_workers[i];
+
+      if (!worker) {
+         worker = CALLOC_STRUCT(lp_setup_bin_worker);
+         if (!worker)
+            return 0;
+         worker->scene = lp_scene_create(setup->pipe);
+         if (!worker->scene) {
+            FREE(worker);
+            return 0;
+         }
+         setup->bin_workers[i] = worker;
+      }
+
+      memcpy(&worker->setup, setup, sizeof *setup);
+      worker->setup.scene = worker->scene;
+      worker->setup.bin_worker = TRUE;
+      worker->setup.bin_failed = FALSE;
+
+      worker->vertex_buffer = vertex_buffer;
+      worker->indices = indices;
+      worker->stride = stride;
+      worker->first = nr_tris * i / nr_workers;
+      worker->last = nr_tris * (i + 1) / nr_workers;
+      worker->failed = ~0;
+
+      lp_scene_begin_worker_binning(worker->scene, scene, budget);
+   }
+
+   mtx_lock(&screen->cs_mutex);
+   task = lp_cs_tpool_queue_task(screen->cs_tpool, lp_setup_bin_worker_run,
+                                 setup, nr_workers);
+   if (task)
+      lp_cs_tpool_wait_for_task(screen->cs_tpool, &task);
+   else
+      failed = TRUE;
+   mtx_unlock(&screen->cs_mutex);
+
+   /* Merge in order.  Once a worker failed, everything binned after it is
+    * thrown away and redone serially by the caller.
+    */
+   num_tris_binned = setup->num_tris_binned;
+   for (i = 0; i < nr_workers; i++) {
+      struct lp_setup_bin_worker *worker = setup->bin_workers[i];
+
+      if (failed || !lp_scene_merge_bins(scene, worker->scene)) {
+         lp_scene_reset(worker->scene);
+         failed = TRUE;
+         continue;
+      }
+
+      num_tris_binned += worker->setup.num_tris_binned -
+                         setup->num_tris_binned;
+
+      if (worker->failed != ~0) {
+         done = worker->failed;
+         failed = TRUE;
+         continue;
+      }
+
+      done = worker->last;
+   }
+   setup->num_tris_binned = num_tris_binned;
+
+   return done * 3;
+}
+
+
+void
+lp_setup_destroy_bin_workers(struct lp_setup_context *setup)
+{
+   unsigned i;
+
+   for (i = 0; i < ARRAY_SIZE(setup->bin_workers); i++) {
+      struct lp_setup_bin_worker *worker = setup->bin_workers[i];
+
+      if (worker) {
+         lp_scene_destroy(worker->scene);
+         FREE(worker);
+         setup->bin_workers[i] = NULL;
+      }
+   }
+}
+
+
 /**
  * draw elements / indexed primitives
  */
@@ -184,7 +371,9 @@ lp_setup_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       break;
 
    case PIPE_PRIM_TRIANGLES:
-      for (i = 2; i < nr; i += 3) {
+      i = lp_setup_bin_triangles_parallel(setup, vertex_buffer, stride,
+                                          indices, nr);
+      for (i += 2; i < nr; i += 3) {
          setup->triangle( setup,
                           get_vert(vertex_buffer, indices[i-2], stride),
                           get_vert(vertex_buffer, indices[i-1], stride),
@@ -382,7 +571,9 @@ lp_setup_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       break;
 
    case PIPE_PRIM_TRIANGLES:
-      for (i = 2; i < nr; i += 3) {
+      i = lp_setup_bin_triangles_parallel(setup, vertex_buffer, stride,
+                                          NULL, nr);
+      for (i += 2; i < nr; i += 3) {
          setup->triangle( setup,
                           get_vert(vertex_buffer, i-2, stride),
                           get_vert(vertex_buffer, i-1, stride),
@@ -585,8 +776,17 @@ lp_setup_pipeline_statistics(
 void
 lp_setup_init_vbuf(struct lp_setup_context *setup)
 {
-   setup->base.max_indices = LP_MAX_VBUF_INDEXES;
-   setup->base.max_vertex_buffer_bytes = LP_MAX_VBUF_SIZE;
+   setup->parallel_binning = setup->num_threads > 1 &&
+                             debug_get_bool_option("LP_PARALLEL_SETUP", FALSE);
+
+   if (setup->parallel_binning) {
+      setup->base.max_indices = LP_MAX_VBUF_INDEXES_PARALLEL;
+      setup->base.max_vertex_buffer_bytes = LP_MAX_VBUF_SIZE_PARALLEL;
+   }
+   else {
+      setup->base.max_indices = LP_MAX_VBUF_INDEXES;
+      setup->base.max_vertex_buffer_bytes = LP_MAX_VBUF_SIZE;
+   }
 
    setup->base.get_vertex_info = lp_setup_get_vertex_info;
    setup->base.allocate_vertices = lp_setup_allocate_vertices;
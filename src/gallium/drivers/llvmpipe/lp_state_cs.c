@@ -27,6 +27,7 @@
 #include "util/os_time.h"
 #include "util/u_dump.h"
 #include "util/u_string.h"
+#include "util/mesa-sha1.h"
 #include "tgsi/tgsi_dump.h"
 #include "tgsi/tgsi_parse.h"
 #include "gallivm/lp_bld_const.h"
@@ -45,6 +46,12 @@
 #include "lp_cs_tpool.h"
 #include "state_tracker/sw_winsys.h"
 
+/**
+ * Grids with at most this many invocations run on the calling thread,
+ * waking up the pool would cost more than the dispatch itself.
+ */
+#define LP_CS_INLINE_INVOCATIONS 256
+
 struct lp_cs_job_info {
    unsigned grid_size[3];
    unsigned block_size[3];
@@ -504,8 +511,8 @@ make_variant_key(struct llvmpipe_context *lp,
           * used views may be included in the shader key.
           */
          if(shader->info.base.file_mask[TGSI_FILE_SAMPLER_VIEW] & (1u << (i & 31))) {
-            lp_sampler_static_texture_state(&key->state[i].texture_state,
-                                            lp->sampler_views[PIPE_SHADER_COMPUTE][i]);
+            llvmpipe_sampler_static_texture_state(&key->state[i].texture_state,
+                                                  lp->sampler_views[PIPE_SHADER_COMPUTE][i]);
          }
       }
    }
@@ -513,8 +520,8 @@ make_variant_key(struct llvmpipe_context *lp,
       key->nr_sampler_views = key->nr_samplers;
       for(i = 0; i < key->nr_sampler_views; ++i) {
          if(shader->info.base.file_mask[TGSI_FILE_SAMPLER] & (1 << i)) {
-            lp_sampler_static_texture_state(&key->state[i].texture_state,
-                                            lp->sampler_views[PIPE_SHADER_COMPUTE][i]);
+            llvmpipe_sampler_static_texture_state(&key->state[i].texture_state,
+                                                  lp->sampler_views[PIPE_SHADER_COMPUTE][i]);
          }
       }
    }
@@ -564,6 +571,8 @@ dump_cs_variant_key(const struct lp_compute_shader_variant_key *key)
                    util_str_tex_target(texture->target, TRUE));
       debug_printf("  .level_zero_only = %u\n",
                    texture->level_zero_only);
+      debug_printf("  .tiled = %u\n",
+                   texture->tiled);
       debug_printf("  .pot = %u %u %u\n",
                    texture->pot_width,
                    texture->pot_height,
@@ -595,13 +604,42 @@ lp_debug_cs_variant(const struct lp_compute_shader_variant *variant)
    debug_printf("\n");
 }
 
+/**
+ * Compute the disk cache key of a compute shader variant, see
+ * lp_fs_get_ir_cache_key().
+ */
+static void
+lp_cs_get_ir_cache_key(const struct lp_compute_shader *shader,
+                       const struct lp_compute_shader_variant_key *key,
+                       const char *module_name,
+                       unsigned char ir_sha1_cache_key[20])
+{
+   struct mesa_sha1 ctx;
+
+   _mesa_sha1_init(&ctx);
+   _mesa_sha1_update(&ctx, module_name, strlen(module_name));
+   _mesa_sha1_update(&ctx, shader->base.tokens,
+                     tgsi_num_tokens(shader->base.tokens) *
+                     sizeof(struct tgsi_token));
+   _mesa_sha1_update(&ctx, key, shader->variant_key_size);
+   _mesa_sha1_update(&ctx, &LP_PERF, sizeof(LP_PERF));
+#ifdef DEBUG
+   _mesa_sha1_update(&ctx, &LP_DEBUG, sizeof(LP_DEBUG));
+#endif
+   _mesa_sha1_final(&ctx, ir_sha1_cache_key);
+}
+
 static struct lp_compute_shader_variant *
 generate_variant(struct llvmpipe_context *lp,
                  struct lp_compute_shader *shader,
                  const struct lp_compute_shader_variant_key *key)
 {
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
    struct lp_compute_shader_variant *variant;
    char module_name[64];
+   unsigned char ir_sha1_cache_key[20];
+   struct lp_cached_code cached = { 0 };
+   boolean needs_caching = FALSE;
 
    variant = CALLOC_STRUCT(lp_compute_shader_variant);
    if (!variant)
@@ -610,8 +648,16 @@ generate_variant(struct llvmpipe_context *lp,
    snprintf(module_name, sizeof(module_name), "cs%u_variant%u",
             shader->no, shader->variants_created);
 
-   variant->gallivm = gallivm_create(module_name, lp->context);
+   if (screen->disk_shader_cache) {
+      lp_cs_get_ir_cache_key(shader, key, module_name, ir_sha1_cache_key);
+      lp_disk_cache_find_shader(screen, &cached, ir_sha1_cache_key);
+      if (!cached.data_size)
+         needs_caching = TRUE;
+   }
+
+   variant->gallivm = gallivm_create(module_name, lp->context, &cached);
    if (!variant->gallivm) {
+      free(cached.data);
       FREE(variant);
       return NULL;
    }
@@ -637,7 +683,11 @@ generate_variant(struct llvmpipe_context *lp,
 
    variant->jit_function = (lp_jit_cs_func)gallivm_jit_function(variant->gallivm, variant->function);
 
+   if (needs_caching)
+      lp_disk_cache_insert_shader(screen, &cached, ir_sha1_cache_key);
+
    gallivm_free_ir(variant->gallivm);
+   free(cached.data);
    return variant;
 }
 
@@ -1079,7 +1129,11 @@ update_csctx_ssbo(struct llvmpipe_context *llvmpipe)
 static void
 llvmpipe_cs_update_derived(struct llvmpipe_context *llvmpipe)
 {
-   if (llvmpipe->cs_dirty & (LP_CSNEW_CS))
+   /* the variant key depends on the bound views (and their layout) too */
+   if (llvmpipe->cs_dirty & (LP_CSNEW_CS |
+                             LP_CSNEW_SAMPLER_VIEW |
+                             LP_CSNEW_SAMPLER |
+                             LP_CSNEW_IMAGES))
       llvmpipe_update_cs(llvmpipe);
 
    if (llvmpipe->cs_dirty & LP_CSNEW_CONSTANTS) {
@@ -1188,7 +1242,17 @@ static void llvmpipe_launch_grid(struct pipe_context *pipe,
    job_info.current = &llvmpipe->csctx->cs.current;
 
    int num_tasks = job_info.grid_size[2] * job_info.grid_size[1] * job_info.grid_size[0];
-   if (num_tasks) {
+   if (num_tasks &&
+       (uint64_t)num_tasks * info->block[0] * info->block[1] * info->block[2] <=
+          LP_CS_INLINE_INVOCATIONS) {
+      struct lp_cs_local_mem lmem;
+
+      memset(&lmem, 0, sizeof(lmem));
+      for (int i = 0; i < num_tasks; i++)
+         cs_exec_fn(&job_info, i, &lmem);
+      FREE(lmem.local_mem_ptr);
+   }
+   else if (num_tasks) {
       struct lp_cs_tpool_task *task;
       mtx_lock(&screen->cs_mutex);
       task = lp_cs_tpool_queue_task(screen->cs_tpool, cs_exec_fn, &job_info, num_tasks);
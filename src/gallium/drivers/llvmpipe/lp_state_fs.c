@@ -67,7 +67,9 @@
 #include "util/u_string.h"
 #include "util/simple_list.h"
 #include "util/u_dual_blend.h"
+#include "util/u_cpu_detect.h"
 #include "util/os_time.h"
+#include "util/mesa-sha1.h"
 #include "pipe/p_shader_tokens.h"
 #include "draw/draw_context.h"
 #include "tgsi/tgsi_dump.h"
@@ -96,6 +98,7 @@
 #include "lp_context.h"
 #include "lp_debug.h"
 #include "lp_perf.h"
+#include "lp_screen.h"
 #include "lp_setup.h"
 #include "lp_state.h"
 #include "lp_tex_sample.h"
@@ -2420,8 +2423,7 @@ generate_unswizzled_blend(struct gallivm_state *gallivm,
  * 2x2 pixels.
  */
 static void
-generate_fragment(struct llvmpipe_context *lp,
-                  struct lp_fragment_shader *shader,
+generate_fragment(struct lp_fragment_shader *shader,
                   struct lp_fragment_shader_variant *variant,
                   unsigned partial_mask)
 {
@@ -2493,6 +2495,12 @@ generate_fragment(struct llvmpipe_context *lp,
    fs_type.norm = FALSE;         /* values are not limited to [0,1] or [-1,1] */
    fs_type.width = 32;           /* 32-bit float */
    fs_type.length = MIN2(lp_native_vector_width / 32, 16); /* n*4 elements per vector */
+   /*
+    * With AVX-512 shade the whole 4x4 stamp in one go. 1d resources only
+    * cover the upper half of the stamp so they keep the narrower vectors.
+    */
+   if (util_cpu_caps.has_avx512f && !key->resource_1d)
+      fs_type.length = 16;
 
    memset(&blend_type, 0, sizeof blend_type);
    blend_type.floating = FALSE; /* values are integers */
@@ -2690,6 +2698,39 @@ generate_fragment(struct llvmpipe_context *lp,
 
    sampler->destroy(sampler);
    image->destroy(image);
+
+   /*
+    * Blending only knows about 4 and 8 wide fs vectors, so hand it the
+    * 16 wide stamp as two 8 wide halves.
+    */
+   if (fs_type.length == 16) {
+      struct lp_type half_type = fs_type;
+      LLVMTypeRef half_ptr_type;
+      LLVMValueRef half_index[2];
+
+      half_type.length = 8;
+      half_ptr_type = LLVMPointerType(lp_build_vec_type(gallivm, half_type), 0);
+      half_index[0] = lp_build_const_int32(gallivm, 0);
+      half_index[1] = lp_build_const_int32(gallivm, 1);
+
+      assert(num_fs == 1);
+      fs_mask[1] = lp_build_extract_range(gallivm, fs_mask[0], 8, 8);
+      fs_mask[0] = lp_build_extract_range(gallivm, fs_mask[0], 0, 8);
+      for (cbuf = 0; cbuf < MAX2(key->nr_cbufs, dual_source_blend ? 2 : 0); cbuf++) {
+         for (chan = 0; chan < TGSI_NUM_CHANNELS; ++chan) {
+            LLVMValueRef ptr = LLVMBuildBitCast(builder,
+                                                fs_out_color[cbuf][chan][0],
+                                                half_ptr_type, "");
+            fs_out_color[cbuf][chan][0] = LLVMBuildGEP(builder, ptr,
+                                                       &half_index[0], 1, "");
+            fs_out_color[cbuf][chan][1] = LLVMBuildGEP(builder, ptr,
+                                                       &half_index[1], 1, "");
+         }
+      }
+      fs_type = half_type;
+      num_fs = 2;
+   }
+
    /* Loop over color outputs / color buffers to do blending.
     */
    for(cbuf = 0; cbuf < key->nr_cbufs; cbuf++) {
@@ -2813,6 +2854,8 @@ dump_fs_variant_key(struct lp_fragment_shader_variant_key *key)
                    util_str_tex_target(texture->target, TRUE));
       debug_printf("  .level_zero_only = %u\n",
                    texture->level_zero_only);
+      debug_printf("  .tiled = %u\n",
+                   texture->tiled);
       debug_printf("  .pot = %u %u %u\n",
                    texture->pot_width,
                    texture->pot_height,
@@ -2848,6 +2891,149 @@ lp_debug_fs_variant(struct lp_fragment_shader_variant *variant)
 }
 
 
+/**
+ * Compute the disk cache key of a fragment shader variant.
+ *
+ * The generated function names embed the shader and variant numbers, so
+ * the module name is hashed along with the tokens and the variant key.
+ */
+static void
+lp_fs_get_ir_cache_key(const struct lp_fragment_shader_variant *variant,
+                       unsigned char ir_sha1_cache_key[20])
+{
+   const struct lp_fragment_shader *shader = variant->shader;
+   struct mesa_sha1 ctx;
+   char module_name[64];
+
+   snprintf(module_name, sizeof(module_name), "fs%u_variant%u",
+            shader->no, variant->no);
+
+   _mesa_sha1_init(&ctx);
+   _mesa_sha1_update(&ctx, module_name, strlen(module_name));
+   _mesa_sha1_update(&ctx, shader->base.tokens,
+                     tgsi_num_tokens(shader->base.tokens) *
+                     sizeof(struct tgsi_token));
+   _mesa_sha1_update(&ctx, &variant->key, shader->variant_key_size);
+   _mesa_sha1_update(&ctx, &LP_PERF, sizeof(LP_PERF));
+#ifdef DEBUG
+   _mesa_sha1_update(&ctx, &LP_DEBUG, sizeof(LP_DEBUG));
+#endif
+   _mesa_sha1_final(&ctx, ir_sha1_cache_key);
+}
+
+
+/**
+ * Build the LLVM IR of a fragment shader variant and compile it.
+ *
+ * \param no_opt  skip the optimizations, for code which only has to bridge
+ *                the time until the optimized one is ready
+ * \param cached  optional disk cache entry, see lp_cached_code
+ */
+static boolean
+compile_variant(LLVMContextRef context,
+                struct lp_fragment_shader_variant *variant,
+                boolean no_opt,
+                struct lp_cached_code *cached)
+{
+   struct lp_fragment_shader *shader = variant->shader;
+   char module_name[64];
+
+   snprintf(module_name, sizeof(module_name), "fs%u_variant%u",
+            shader->no, variant->no);
+
+   variant->gallivm = gallivm_create(module_name, context, cached);
+   if (!variant->gallivm)
+      return FALSE;
+   variant->gallivm->no_opt = no_opt;
+
+   lp_jit_init_types(variant);
+
+   generate_fragment(shader, variant, RAST_EDGE_TEST);
+
+   if (variant->opaque) {
+      /* Specialized shader, which doesn't need to read the color buffer. */
+      generate_fragment(shader, variant, RAST_WHOLE);
+   }
+
+   /*
+    * Compile everything
+    */
+
+   gallivm_compile_module(variant->gallivm);
+
+   variant->nr_instrs += lp_build_count_ir_module(variant->gallivm->module);
+
+   if (variant->function[RAST_EDGE_TEST]) {
+      variant->jit_function[RAST_EDGE_TEST] = (lp_jit_frag_func)
+            gallivm_jit_function(variant->gallivm,
+                                 variant->function[RAST_EDGE_TEST]);
+   }
+
+   if (variant->function[RAST_WHOLE]) {
+         variant->jit_function[RAST_WHOLE] = (lp_jit_frag_func)
+               gallivm_jit_function(variant->gallivm,
+                                    variant->function[RAST_WHOLE]);
+   } else {
+      variant->jit_function[RAST_WHOLE] = variant->jit_function[RAST_EDGE_TEST];
+   }
+
+   gallivm_free_ir(variant->gallivm);
+
+   return TRUE;
+}
+
+
+/**
+ * Compile the optimized code of a variant on the shader compiler queue.
+ *
+ * The variant initially runs unoptimized code.  Compilation happens on a
+ * scratch copy of the variant with an LLVM context of its own, since the
+ * one of the llvmpipe context may be in use concurrently; once done, the
+ * jit functions are swapped in.  The rasterizer reads them anew for every
+ * block it shades, so scenes already queued pick up the new code too.
+ */
+static void
+lp_fs_variant_optimize(void *data, int thread_index)
+{
+   struct lp_fragment_shader_variant *variant = data;
+   struct lp_fragment_shader *shader = variant->shader;
+   struct llvmpipe_screen *screen = variant->screen;
+   struct lp_fragment_shader_variant *tmp;
+   unsigned char ir_sha1_cache_key[20];
+   struct lp_cached_code cached = { 0 };
+   LLVMContextRef context;
+
+   tmp = MALLOC(sizeof *tmp + shader->variant_key_size - sizeof tmp->key);
+   if (!tmp)
+      return;
+
+   memset(tmp, 0, sizeof(*tmp));
+   tmp->shader = shader;
+   tmp->no = variant->no;
+   tmp->opaque = variant->opaque;
+   memcpy(&tmp->key, &variant->key, shader->variant_key_size);
+
+   context = LLVMContextCreate();
+   if (context) {
+      if (compile_variant(context, tmp, FALSE, &cached)) {
+         variant->gallivm_opt = tmp->gallivm;
+         variant->jit_function[RAST_WHOLE] = tmp->jit_function[RAST_WHOLE];
+         variant->jit_function[RAST_EDGE_TEST] =
+            tmp->jit_function[RAST_EDGE_TEST];
+
+         if (screen->disk_shader_cache) {
+            lp_fs_get_ir_cache_key(tmp, ir_sha1_cache_key);
+            lp_disk_cache_insert_shader(screen, &cached, ir_sha1_cache_key);
+         }
+      }
+      LLVMContextDispose(context);
+   }
+
+   free(cached.data);
+   FREE(tmp);
+}
+
+
 /**
  * Generate a new fragment shader variant from the shader code and
  * other state indicated by the key.
@@ -2857,29 +3043,27 @@ generate_variant(struct llvmpipe_context *lp,
                  struct lp_fragment_shader *shader,
                  const struct lp_fragment_shader_variant_key *key)
 {
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
    struct lp_fragment_shader_variant *variant;
    const struct util_format_description *cbuf0_format_desc = NULL;
    boolean fullcolormask;
-   char module_name[64];
+   unsigned char ir_sha1_cache_key[20];
+   struct lp_cached_code cached = { 0 };
+   boolean needs_caching = FALSE;
+   boolean async;
 
    variant = MALLOC(sizeof *variant + shader->variant_key_size - sizeof variant->key);
    if (!variant)
       return NULL;
 
    memset(variant, 0, sizeof(*variant));
-   snprintf(module_name, sizeof(module_name), "fs%u_variant%u",
-            shader->no, shader->variants_created);
-
-   variant->gallivm = gallivm_create(module_name, lp->context);
-   if (!variant->gallivm) {
-      FREE(variant);
-      return NULL;
-   }
 
    variant->shader = shader;
+   variant->screen = screen;
    variant->list_item_global.base = variant;
    variant->list_item_local.base = variant;
    variant->no = shader->variants_created++;
+   util_queue_fence_init(&variant->ready);
 
    memcpy(&variant->key, key, shader->variant_key_size);
 
@@ -2904,47 +3088,96 @@ generate_variant(struct llvmpipe_context *lp,
          !shader->info.base.writes_samplemask
       ? TRUE : FALSE;
 
+   /*
+    * Only LESS/LEQUAL depth writes are known to never raise the stored
+    * depth.  Culling additionally needs the fragment depth to be the
+    * interpolated one, and failing fragments to have no other effect.
+    */
+   {
+      const boolean less = key->depth.enabled &&
+                           (key->depth.func == PIPE_FUNC_LESS ||
+                            key->depth.func == PIPE_FUNC_LEQUAL);
+
+      variant->hiz_test =
+            less &&
+            !key->depth_clamp &&
+            !shader->info.base.writes_z &&
+            !shader->info.base.writes_memory &&
+            (!key->stencil[0].enabled ||
+             key->stencil[0].zfail_op == PIPE_STENCIL_OP_KEEP) &&
+            (!key->stencil[1].enabled ||
+             key->stencil[1].zfail_op == PIPE_STENCIL_OP_KEEP);
+
+      variant->hiz_update =
+            variant->hiz_test &&
+            key->depth.writemask &&
+            !key->stencil[0].enabled &&
+            !key->alpha.enabled &&
+            !key->blend.alpha_to_coverage &&
+            !shader->info.base.uses_kill &&
+            !shader->info.base.writes_samplemask;
+
+      variant->hiz_invalidate =
+            key->depth.enabled &&
+            key->depth.writemask &&
+            !less &&
+            key->depth.func != PIPE_FUNC_NEVER &&
+            key->depth.func != PIPE_FUNC_EQUAL;
+   }
+
    if ((LP_DEBUG & DEBUG_FS) || (gallivm_debug & GALLIVM_DEBUG_IR)) {
       lp_debug_fs_variant(variant);
    }
 
-   lp_jit_init_types(variant);
-   
-   if (variant->jit_function[RAST_EDGE_TEST] == NULL)
-      generate_fragment(lp, shader, variant, RAST_EDGE_TEST);
-
-   if (variant->jit_function[RAST_WHOLE] == NULL) {
-      if (variant->opaque) {
-         /* Specialized shader, which doesn't need to read the color buffer. */
-         generate_fragment(lp, shader, variant, RAST_WHOLE);
-      }
+   if (screen->disk_shader_cache) {
+      lp_fs_get_ir_cache_key(variant, ir_sha1_cache_key);
+      lp_disk_cache_find_shader(screen, &cached, ir_sha1_cache_key);
+      needs_caching = !cached.data_size;
    }
 
    /*
-    * Compile everything
+    * Without a disk cache hit, stall the draw only for a quick unoptimized
+    * compilation and let the compiler queue produce the real code once the
+    * variant is hot, see llvmpipe_fs_variant_use().
     */
+   async = screen->async_fs_compile && !cached.data_size;
 
-   gallivm_compile_module(variant->gallivm);
+   if (!compile_variant(lp->context, variant, async,
+                        async ? NULL : &cached)) {
+      free(cached.data);
+      util_queue_fence_destroy(&variant->ready);
+      FREE(variant);
+      return NULL;
+   }
 
-   variant->nr_instrs += lp_build_count_ir_module(variant->gallivm->module);
+   if (needs_caching && !async)
+      lp_disk_cache_insert_shader(screen, &cached, ir_sha1_cache_key);
+   free(cached.data);
 
-   if (variant->function[RAST_EDGE_TEST]) {
-      variant->jit_function[RAST_EDGE_TEST] = (lp_jit_frag_func)
-            gallivm_jit_function(variant->gallivm,
-                                 variant->function[RAST_EDGE_TEST]);
+   if (async && !gallivm_tier_up_uses) {
+      util_queue_add_job(&screen->fs_compile_queue, variant, &variant->ready,
+                         lp_fs_variant_optimize, NULL);
    }
 
-   if (variant->function[RAST_WHOLE]) {
-         variant->jit_function[RAST_WHOLE] = (lp_jit_frag_func)
-               gallivm_jit_function(variant->gallivm,
-                                    variant->function[RAST_WHOLE]);
-   } else if (!variant->jit_function[RAST_WHOLE]) {
-      variant->jit_function[RAST_WHOLE] = variant->jit_function[RAST_EDGE_TEST];
-   }
+   return variant;
+}
 
-   gallivm_free_ir(variant->gallivm);
 
-   return variant;
+/**
+ * Count a draw with the given variant, queueing the compilation of its
+ * optimized code when it still runs unoptimized code and got hot.
+ */
+void
+llvmpipe_fs_variant_use(struct llvmpipe_context *lp,
+                        struct lp_fragment_shader_variant *variant)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
+
+   if (variant->gallivm->no_opt && screen->async_fs_compile &&
+       gallivm_tier_up(&variant->uses)) {
+      util_queue_add_job(&screen->fs_compile_queue, variant, &variant->ready,
+                         lp_fs_variant_optimize, NULL);
+   }
 }
 
 
@@ -3078,7 +3311,17 @@ llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
                    lp->nr_fs_variants, variant->nr_instrs, lp->nr_fs_instrs);
    }
 
+   if (lp->fs_variant == variant)
+      lp->fs_variant = NULL;
+
+   /* Wait for or cancel the optimized compile still referencing it. */
+   util_queue_drop_job(&llvmpipe_screen(lp->pipe.screen)->fs_compile_queue,
+                       &variant->ready);
+   util_queue_fence_destroy(&variant->ready);
+
    gallivm_destroy(variant->gallivm);
+   if (variant->gallivm_opt)
+      gallivm_destroy(variant->gallivm_opt);
 
    /* remove from shader's list */
    remove_from_list(&variant->list_item_local);
@@ -3223,6 +3466,9 @@ llvmpipe_set_shader_images(struct pipe_context *pipe,
    for (i = start_slot, idx = 0; i < start_slot + count; i++, idx++) {
       const struct pipe_image_view *image = images ? &images[idx] : NULL;
 
+      /* image access is always linear */
+      if (image && image->resource)
+         llvmpipe_resource_untile(pipe, image->resource);
       util_copy_image_view(&llvmpipe->images[shader][i], image);
    }
 
@@ -3451,8 +3697,8 @@ make_variant_key(struct llvmpipe_context *lp,
           * used views may be included in the shader key.
           */
          if(shader->info.base.file_mask[TGSI_FILE_SAMPLER_VIEW] & (1u << (i & 31))) {
-            lp_sampler_static_texture_state(&fs_sampler[i].texture_state,
-                                            lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
+            llvmpipe_sampler_static_texture_state(&fs_sampler[i].texture_state,
+                                                  lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
          }
       }
    }
@@ -3460,8 +3706,8 @@ make_variant_key(struct llvmpipe_context *lp,
       key->nr_sampler_views = key->nr_samplers;
       for(i = 0; i < key->nr_sampler_views; ++i) {
          if(shader->info.base.file_mask[TGSI_FILE_SAMPLER] & (1 << i)) {
-            lp_sampler_static_texture_state(&fs_sampler[i].texture_state,
-                                            lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
+            llvmpipe_sampler_static_texture_state(&fs_sampler[i].texture_state,
+                                                  lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
          }
       }
    }
@@ -3587,6 +3833,7 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
    }
 
    /* Bind this variant */
+   lp->fs_variant = variant;
    lp_setup_set_fs_variant(lp->setup, variant);
 }
 
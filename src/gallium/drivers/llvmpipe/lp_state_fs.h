@@ -32,6 +32,7 @@
 
 #include "pipe/p_compiler.h"
 #include "pipe/p_state.h"
+#include "util/u_queue.h"
 #include "tgsi/tgsi_scan.h" /* for tgsi_shader_info */
 #include "gallivm/lp_bld_sample.h" /* for struct lp_sampler_static_state */
 #include "gallivm/lp_bld_tgsi.h" /* for lp_tgsi_info */
@@ -40,6 +41,8 @@
 
 struct tgsi_token;
 struct lp_fragment_shader;
+struct llvmpipe_context;
+struct llvmpipe_screen;
 
 
 /** Indexes into jit_function[] array */
@@ -125,8 +128,29 @@ struct lp_fragment_shader_variant
 
    boolean opaque;
 
+   /*
+    * Coarse depth culling, see lp_rast_hiz_cull_16(): whether fragments
+    * failing a LESS/LEQUAL depth test may be dropped without running the
+    * shader, whether fully covered blocks lower the stored depth to at most
+    * the plane's maximum, and whether depth writes may raise the stored
+    * depth instead.
+    */
+   boolean hiz_test;
+   boolean hiz_update;
+   boolean hiz_invalidate;
+
    struct gallivm_state *gallivm;
 
+   /* Optimized code compiled on the screen's fs_compile_queue, if any;
+    * ready is signalled when it is done.
+    */
+   struct gallivm_state *gallivm_opt;
+   struct util_queue_fence ready;
+   struct llvmpipe_screen *screen;
+
+   /* Draws made with the unoptimized code, see llvmpipe_fs_variant_use() */
+   unsigned uses;
+
    LLVMTypeRef jit_context_ptr_type;
    LLVMTypeRef jit_thread_data_ptr_type;
    LLVMTypeRef jit_linear_context_ptr_type;
@@ -174,4 +198,8 @@ struct lp_fragment_shader
 void
 lp_debug_fs_variant(struct lp_fragment_shader_variant *variant);
 
+void
+llvmpipe_fs_variant_use(struct llvmpipe_context *lp,
+                        struct lp_fragment_shader_variant *variant);
+
 #endif /* LP_STATE_FS_H_ */
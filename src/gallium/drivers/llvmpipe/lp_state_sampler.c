@@ -31,6 +31,7 @@
 
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
+#include "util/u_format.h"
 
 #include "draw/draw_context.h"
 
@@ -38,6 +39,7 @@
 #include "lp_screen.h"
 #include "lp_state.h"
 #include "lp_debug.h"
+#include "lp_texture.h"
 #include "state_tracker/sw_winsys.h"
 
 
@@ -125,6 +127,11 @@ llvmpipe_set_sampler_views(struct pipe_context *pipe,
 
    /* set the new sampler views */
    for (i = 0; i < num; i++) {
+      /* draw only knows about linear textures */
+      if (views[i] && views[i]->texture &&
+          (shader == PIPE_SHADER_VERTEX || shader == PIPE_SHADER_GEOMETRY))
+         llvmpipe_resource_untile(pipe, views[i]->texture);
+
       /*
        * Warn if someone tries to set a view created in a different context
        * (which is why we need the hack above in the first place).
@@ -175,6 +182,12 @@ llvmpipe_create_sampler_view(struct pipe_context *pipe,
       texture->bind |= PIPE_BIND_SAMPLER_VIEW;
    }
 
+   /* Views reinterpreting the texels as blocks need the linear layout. */
+   if (texture->target != PIPE_BUFFER &&
+       (util_format_get_blockwidth(templ->format) != 1 ||
+        util_format_get_blockheight(templ->format) != 1))
+      llvmpipe_resource_untile(pipe, texture);
+
    if (view) {
       *view = *templ;
       view->reference.count = 1;
@@ -482,3 +495,17 @@ llvmpipe_init_sampler_funcs(struct llvmpipe_context *llvmpipe)
    llvmpipe->pipe.sampler_view_destroy = llvmpipe_sampler_view_destroy;
    llvmpipe->pipe.delete_sampler_state = llvmpipe_delete_sampler_state;
 }
+
+
+/**
+ * lp_sampler_static_texture_state() plus the llvmpipe specific bits.
+ */
+void
+llvmpipe_sampler_static_texture_state(struct lp_static_texture_state *state,
+                                      const struct pipe_sampler_view *view)
+{
+   lp_sampler_static_texture_state(state, view);
+
+   if (view && view->texture)
+      state->tiled = llvmpipe_resource_const(view->texture)->tiled;
+}
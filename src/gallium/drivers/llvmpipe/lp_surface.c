@@ -141,6 +141,10 @@ llvmpipe_create_surface(struct pipe_context *pipe,
       }
    }
 
+   /* rendering is always done to linear storage */
+   if (llvmpipe_resource_is_texture(pt))
+      llvmpipe_resource_untile(pipe, pt);
+
    ps = CALLOC_STRUCT(pipe_surface);
    if (ps) {
       pipe_reference_init(&ps->reference, 1);
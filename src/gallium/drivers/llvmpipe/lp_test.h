@@ -96,6 +96,10 @@ float
 random_float(void);
 
 
+double
+average_cycles(const int64_t *cycles, unsigned n);
+
+
 void
 dump_type(FILE *fp, struct lp_type type);
 
@@ -43,12 +43,18 @@
 #include "lp_test.h"
 
 
+/* calls of a function timed by each sample */
+#define TEST_BATCH_SIZE 16
+
+
 void
 write_tsv_header(FILE *fp)
 {
    fprintf(fp,
            "result\t"
-           "format\n");
+           "cycles_per_element\t"
+           "function\t"
+           "length\n");
 
    fflush(fp);
 }
@@ -392,6 +398,20 @@ flush_denorm_to_zero(float val)
    return fi_val.f;
 }
 
+static void
+write_tsv_row(FILE *fp, const struct unary_test_t *test, unsigned length,
+              double cycles, boolean success)
+{
+   fprintf(fp, "%s\t", success ? "pass" : "fail");
+
+   fprintf(fp, "%.1f\t", cycles / (TEST_BATCH_SIZE * length));
+
+   fprintf(fp, "%s\t%u\n", test->name, length);
+
+   fflush(fp);
+}
+
+
 /*
  * Test one LLVM unary arithmetic builder function.
  */
@@ -417,7 +437,7 @@ test_unary(unsigned verbose, FILE *fp, const struct unary_test_t *test, unsigned
    }
 
    context = LLVMContextCreate();
-   gallivm = gallivm_create("test_module", context);
+   gallivm = gallivm_create("test_module", context, NULL);
 
    test_func = build_unary_test_func(gallivm, test, length, test_name);
 
@@ -488,6 +508,25 @@ test_unary(unsigned verbose, FILE *fp, const struct unary_test_t *test, unsigned
       }
    }
 
+   if (fp) {
+      int64_t cycles[LP_TEST_NUM_SAMPLES];
+
+      for (i = 0; i < length; i++) {
+         in[i] = 1.0;
+      }
+
+      for (i = 0; i < LP_TEST_NUM_SAMPLES; i++) {
+         int64_t start_counter = rdtsc();
+         for (j = 0; j < TEST_BATCH_SIZE; j++) {
+            test_func_jit(out, in);
+         }
+         cycles[i] = rdtsc() - start_counter;
+      }
+
+      write_tsv_row(fp, test, length,
+                    average_cycles(cycles, LP_TEST_NUM_SAMPLES), success);
+   }
+
    gallivm_destroy(gallivm);
    LLVMContextDispose(context);
 
@@ -452,7 +452,7 @@ test_one(unsigned verbose,
       dump_blend_type(stdout, blend, type);
 
    context = LLVMContextCreate();
-   gallivm = gallivm_create("test_module", context);
+   gallivm = gallivm_create("test_module", context, NULL);
 
    func = add_blend_test(gallivm, blend, type);
 
@@ -546,36 +546,7 @@ test_one(unsigned verbose,
       align_free(ref);
    }
 
-   /*
-    * Unfortunately the output of cycle counter is not very reliable as it comes
-    * -- sometimes we get outliers (due IRQs perhaps?) which are
-    * better removed to avoid random or biased data.
-    */
-   {
-      double sum = 0.0, sum2 = 0.0;
-      double avg, std;
-      unsigned m;
-
-      for(i = 0; i < n; ++i) {
-         sum += cycles[i];
-         sum2 += cycles[i]*cycles[i];
-      }
-
-      avg = sum/n;
-      std = sqrtf((sum2 - n*avg*avg)/n);
-
-      m = 0;
-      sum = 0.0;
-      for(i = 0; i < n; ++i) {
-         if(fabs(cycles[i] - avg) <= 4.0*std) {
-            sum += cycles[i];
-            ++m;
-         }
-      }
-
-      cycles_avg = sum/m;
-
-   }
+   cycles_avg = average_cycles(cycles, n);
 
    if(fp)
       write_tsv_row(fp, blend, type, cycles_avg, success);
@@ -46,12 +46,19 @@
 
 static struct lp_build_format_cache *cache_ptr;
 
+/* fetches timed by each sample */
+#define TEST_BATCH_SIZE 16
+
+
 void
 write_tsv_header(FILE *fp)
 {
    fprintf(fp,
            "result\t"
-           "format\n");
+           "cycles_per_fetch\t"
+           "format\t"
+           "type\t"
+           "cache\n");
 
    fflush(fp);
 }
@@ -60,11 +67,16 @@ write_tsv_header(FILE *fp)
 static void
 write_tsv_row(FILE *fp,
               const struct util_format_description *desc,
+              const char *type,
+              unsigned use_cache,
+              double cycles,
               boolean success)
 {
    fprintf(fp, "%s\t", success ? "pass" : "fail");
 
-   fprintf(fp, "%s\n", desc->name);
+   fprintf(fp, "%.1f\t", cycles / TEST_BATCH_SIZE);
+
+   fprintf(fp, "%s\t%s\t%u\n", desc->name, type, use_cache);
 
    fflush(fp);
 }
@@ -75,6 +87,27 @@ typedef void
                unsigned i, unsigned j, struct lp_build_format_cache *cache);
 
 
+/**
+ * Time fetching the first pixel of the last test case's block.
+ */
+static double
+time_fetch(fetch_ptr_t fetch_ptr, void *unpacked, const void *packed,
+           unsigned use_cache)
+{
+   int64_t cycles[LP_TEST_NUM_SAMPLES];
+   unsigned i, j;
+
+   for (i = 0; i < LP_TEST_NUM_SAMPLES; ++i) {
+      int64_t start_counter = rdtsc();
+      for (j = 0; j < TEST_BATCH_SIZE; ++j)
+         fetch_ptr(unpacked, packed, 0, 0, use_cache ? cache_ptr : NULL);
+      cycles[i] = rdtsc() - start_counter;
+   }
+
+   return average_cycles(cycles, LP_TEST_NUM_SAMPLES);
+}
+
+
 static LLVMValueRef
 add_fetch_rgba_test(struct gallivm_state *gallivm, unsigned verbose,
                     const struct util_format_description *desc,
@@ -147,10 +180,11 @@ test_format_float(unsigned verbose, FILE *fp,
    PIPE_ALIGN_VAR(16) float unpacked[4];
    boolean first = TRUE;
    boolean success = TRUE;
+   double cycles;
    unsigned i, j, k, l;
 
    context = LLVMContextCreate();
-   gallivm = gallivm_create("test_module_float", context);
+   gallivm = gallivm_create("test_module_float", context, NULL);
 
    fetch = add_fetch_rgba_test(gallivm, verbose, desc,
                                lp_float32_vec4_type(), use_cache);
@@ -224,11 +258,14 @@ test_format_float(unsigned verbose, FILE *fp,
       }
    }
 
+   cycles = fp && !first ?
+            time_fetch(fetch_ptr, unpacked, packed, use_cache) : 0.0;
+
    gallivm_destroy(gallivm);
    LLVMContextDispose(context);
 
    if(fp)
-      write_tsv_row(fp, desc, success);
+      write_tsv_row(fp, desc, "float", use_cache, cycles, success);
 
    return success;
 }
@@ -248,10 +285,11 @@ test_format_unorm8(unsigned verbose, FILE *fp,
    uint8_t unpacked[4];
    boolean first = TRUE;
    boolean success = TRUE;
+   double cycles;
    unsigned i, j, k, l;
 
    context = LLVMContextCreate();
-   gallivm = gallivm_create("test_module_unorm8", context);
+   gallivm = gallivm_create("test_module_unorm8", context, NULL);
 
    fetch = add_fetch_rgba_test(gallivm, verbose, desc,
                                lp_unorm8_vec4_type(), use_cache);
@@ -324,11 +362,14 @@ test_format_unorm8(unsigned verbose, FILE *fp,
       }
    }
 
+   cycles = fp && !first ?
+            time_fetch(fetch_ptr, unpacked, packed, use_cache) : 0.0;
+
    gallivm_destroy(gallivm);
    LLVMContextDispose(context);
 
    if(fp)
-      write_tsv_row(fp, desc, success);
+      write_tsv_row(fp, desc, "unorm8", use_cache, cycles, success);
 
    return success;
 }
@@ -243,6 +243,41 @@ write_vec(struct lp_type type, void *dst, const double *src)
 }
 
 
+/**
+ * Average of the cycle counter samples.
+ *
+ * Unfortunately the output of cycle counter is not very reliable as it comes
+ * -- sometimes we get outliers (due IRQs perhaps?) which are
+ * better removed to avoid random or biased data.
+ */
+double
+average_cycles(const int64_t *cycles, unsigned n)
+{
+   double sum = 0.0, sum2 = 0.0;
+   double avg, std;
+   unsigned i, m;
+
+   for(i = 0; i < n; ++i) {
+      sum += cycles[i];
+      sum2 += cycles[i]*cycles[i];
+   }
+
+   avg = sum/n;
+   std = sqrtf((sum2 - n*avg*avg)/n);
+
+   m = 0;
+   sum = 0.0;
+   for(i = 0; i < n; ++i) {
+      if(fabs(cycles[i] - avg) <= 4.0*std) {
+         sum += cycles[i];
+         ++m;
+      }
+   }
+
+   return sum/m;
+}
+
+
 float
 random_float(void)
 {
@@ -42,6 +42,7 @@
 #include "util/u_memory.h"
 #include "util/simple_list.h"
 #include "util/u_transfer.h"
+#include "util/u_box.h"
 
 #include "lp_context.h"
 #include "lp_flush.h"
@@ -51,6 +52,8 @@
 #include "lp_state.h"
 #include "lp_rast.h"
 
+#include "gallivm/lp_bld_sample.h"
+
 #include "state_tracker/sw_winsys.h"
 
 
@@ -166,6 +169,8 @@ llvmpipe_texture_layout(struct llvmpipe_screen *screen,
       depth = u_minify(depth, 1);
    }
 
+   lpr->total_alloc_size = total_size;
+
    if (allocate) {
       lpr->tex_data = align_malloc(total_size, mip_align);
       if (!lpr->tex_data) {
@@ -183,6 +188,160 @@ fail:
 }
 
 
+/**
+ * Whether a texture can use the micro-tiled layout.  That's limited to
+ * uncompressed 2D (or 3D, cube, array) textures the CPU never looks at
+ * directly other than through transfers.
+ */
+static boolean
+llvmpipe_texture_can_tile(const struct llvmpipe_screen *screen,
+                          const struct pipe_resource *pt)
+{
+   const struct util_format_description *desc =
+      util_format_description(pt->format);
+
+   if (!screen->tiled_textures)
+      return FALSE;
+
+   if (!(pt->bind & PIPE_BIND_SAMPLER_VIEW) ||
+       (pt->bind & (PIPE_BIND_LINEAR |
+                    PIPE_BIND_SHARED |
+                    PIPE_BIND_SCANOUT |
+                    PIPE_BIND_DISPLAY_TARGET)) ||
+       (pt->flags & (PIPE_RESOURCE_FLAG_MAP_PERSISTENT |
+                     PIPE_RESOURCE_FLAG_MAP_COHERENT)) ||
+       pt->usage == PIPE_USAGE_STAGING ||
+       pt->nr_samples > 1)
+      return FALSE;
+
+   if (llvmpipe_resource_is_1d(pt))
+      return FALSE;
+
+   return desc && desc->block.width == 1 && desc->block.height == 1 &&
+          desc->block.bits >= 8;
+}
+
+
+/**
+ * Number of 3D slices, cube faces or array layers of a mipmap level.
+ */
+static unsigned
+llvmpipe_texture_num_slices(const struct pipe_resource *pt, unsigned level)
+{
+   if (pt->target == PIPE_TEXTURE_3D)
+      return u_minify(pt->depth0, level);
+   else if (pt->target == PIPE_TEXTURE_1D_ARRAY ||
+            pt->target == PIPE_TEXTURE_2D_ARRAY ||
+            pt->target == PIPE_TEXTURE_CUBE ||
+            pt->target == PIPE_TEXTURE_CUBE_ARRAY)
+      return pt->array_size;
+   else
+      return 1;
+}
+
+
+/**
+ * Copy a box of texels between a tiled texture and a linear buffer,
+ * in the direction given by to_tiled.
+ */
+static void
+llvmpipe_tiled_copy(struct llvmpipe_resource *lpr,
+                    unsigned level,
+                    const struct pipe_box *box,
+                    ubyte *linear,
+                    unsigned stride,
+                    unsigned layer_stride,
+                    boolean to_tiled)
+{
+   const unsigned tile = LP_SAMPLE_TILE_SIZE;
+   const unsigned bpp = util_format_get_blocksize(lpr->base.format);
+   const unsigned row_stride = lpr->row_stride[level];
+   int x, y, z;
+
+   assert(lpr->tiled);
+
+   for (z = 0; z < box->depth; z++) {
+      ubyte *image = llvmpipe_get_texture_image_address(lpr, box->z + z, level);
+
+      for (y = 0; y < box->height; y++) {
+         unsigned ty = box->y + y;
+         ubyte *tiled_row = image + (ty & ~(tile - 1)) * row_stride +
+                            (ty & (tile - 1)) * tile * bpp;
+         ubyte *linear_row = linear + z * layer_stride + y * stride;
+
+         /* texels within a tile row are contiguous in both layouts */
+         for (x = 0; x < box->width; ) {
+            unsigned tx = box->x + x;
+            unsigned n = MIN2(tile - (tx & (tile - 1)), box->width - x);
+            ubyte *texel = tiled_row + (tx & ~(tile - 1)) * tile * bpp +
+                           (tx & (tile - 1)) * bpp;
+
+            if (to_tiled)
+               memcpy(texel, linear_row + x * bpp, n * bpp);
+            else
+               memcpy(linear_row + x * bpp, texel, n * bpp);
+            x += n;
+         }
+      }
+   }
+}
+
+
+/**
+ * Convert a tiled texture to the linear layout for good, for uses other
+ * than sampling from fragment or compute shaders (rendering, images,
+ * vertex texturing).  The strides don't change, so this is done in place.
+ */
+void
+llvmpipe_resource_untile(struct pipe_context *pipe,
+                         struct pipe_resource *resource)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   struct llvmpipe_resource *lpr = llvmpipe_resource(resource);
+   unsigned level;
+   ubyte *tmp;
+
+   if (!lpr->tiled)
+      return;
+
+   llvmpipe_flush_resource(pipe, resource, 0, FALSE, TRUE, FALSE,
+                           __FUNCTION__);
+
+   tmp = MALLOC(lpr->img_stride[0]);
+   if (!tmp)
+      return;
+
+   for (level = 0; level <= resource->last_level; level++) {
+      unsigned num_slices = llvmpipe_texture_num_slices(resource, level);
+      unsigned slice;
+      struct pipe_box box;
+
+      /* everything up to the 4x4 aligned size, padding included */
+      u_box_3d(0, 0, 0,
+               align(u_minify(resource->width0, level), LP_SAMPLE_TILE_SIZE),
+               align(u_minify(resource->height0, level), LP_SAMPLE_TILE_SIZE),
+               1, &box);
+
+      for (slice = 0; slice < num_slices; slice++) {
+         box.z = slice;
+         llvmpipe_tiled_copy(lpr, level, &box, tmp, lpr->row_stride[level],
+                             lpr->img_stride[level], FALSE);
+         memcpy(llvmpipe_get_texture_image_address(lpr, slice, level), tmp,
+                lpr->img_stride[level]);
+      }
+   }
+   FREE(tmp);
+
+   lpr->tiled = FALSE;
+
+   /* The sampler code of this context depends on the layout.  Other
+    * contexts pick it up the next time their views change.
+    */
+   llvmpipe->dirty |= LP_NEW_SAMPLER_VIEW;
+   llvmpipe->cs_dirty |= LP_CSNEW_SAMPLER_VIEW;
+}
+
+
 /**
  * Check the size of the texture specified by 'res'.
  * \return TRUE if OK, FALSE if too large.
@@ -262,6 +421,7 @@ llvmpipe_resource_create_front(struct pipe_screen *_screen,
       }
       else {
          /* texture map */
+         lpr->tiled = llvmpipe_texture_can_tile(screen, &lpr->base);
          if (!llvmpipe_texture_layout(screen, lpr, true))
             goto fail;
       }
@@ -313,6 +473,54 @@ llvmpipe_resource_create(struct pipe_screen *_screen,
 }
 
 
+/**
+ * Wrap caller-owned memory in a texture.  The memory has to be laid out
+ * the way llvmpipe_texture_layout() would lay it out, including the rows
+ * padding the height to LP_RASTER_BLOCK_SIZE which rendering may touch,
+ * so only single-level textures with block-aligned heights are allowed.
+ * Callers check the resulting layout with transfer_map().
+ */
+static struct pipe_resource *
+llvmpipe_resource_from_user_memory(struct pipe_screen *_screen,
+                                   const struct pipe_resource *templat,
+                                   void *user_memory)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(_screen);
+   struct llvmpipe_resource *lpr;
+
+   if (!llvmpipe_resource_is_texture(templat) ||
+       templat->last_level != 0 ||
+       templat->nr_samples > 1 ||
+       util_format_is_compressed(templat->format) ||
+       (!llvmpipe_resource_is_1d(templat) &&
+        templat->height0 % LP_RASTER_BLOCK_SIZE))
+      return NULL;
+
+   lpr = CALLOC_STRUCT(llvmpipe_resource);
+   if (!lpr)
+      return NULL;
+
+   lpr->base = *templat;
+   pipe_reference_init(&lpr->base.reference, 1);
+   lpr->base.screen = &screen->base;
+
+   if (!llvmpipe_texture_layout(screen, lpr, false)) {
+      FREE(lpr);
+      return NULL;
+   }
+
+   lpr->tex_data = user_memory;
+   lpr->userBuffer = TRUE;
+   lpr->id = id_counter++;
+
+#ifdef DEBUG
+   insert_at_tail(&resource_list, lpr);
+#endif
+
+   return &lpr->base;
+}
+
+
 static void
 llvmpipe_resource_destroy(struct pipe_screen *pscreen,
                           struct pipe_resource *pt)
@@ -327,7 +535,7 @@ llvmpipe_resource_destroy(struct pipe_screen *pscreen,
    }
    else if (llvmpipe_resource_is_texture(pt)) {
       /* free linear image data */
-      if (lpr->tex_data) {
+      if (lpr->tex_data && !lpr->userBuffer) {
          align_free(lpr->tex_data);
          lpr->tex_data = NULL;
       }
@@ -559,6 +767,10 @@ llvmpipe_transfer_map( struct pipe_context *pipe,
       }
    }
 
+   /* Tiled textures can only be mapped through a linear copy. */
+   if (lpr->tiled && (usage & PIPE_TRANSFER_MAP_DIRECTLY))
+      return NULL;
+
    lpt = CALLOC_STRUCT(llvmpipe_transfer);
    if (!lpt)
       return NULL;
@@ -571,6 +783,31 @@ llvmpipe_transfer_map( struct pipe_context *pipe,
    pt->usage = usage;
    *transfer = pt;
 
+   if (lpr->tiled) {
+      const unsigned bpp = util_format_get_blocksize(resource->format);
+
+      pt->stride = box->width * bpp;
+      pt->layer_stride = pt->stride * box->height;
+      lpt->staging = MALLOC(pt->layer_stride * box->depth);
+      if (!lpt->staging) {
+         pipe_resource_reference(&pt->resource, NULL);
+         FREE(lpt);
+         *transfer = NULL;
+         return NULL;
+      }
+
+      if (!(usage & (PIPE_TRANSFER_DISCARD_RANGE |
+                     PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE))) {
+         llvmpipe_tiled_copy(lpr, level, box, lpt->staging,
+                             pt->stride, pt->layer_stride, FALSE);
+      }
+
+      if (usage & PIPE_TRANSFER_WRITE)
+         screen->timestamp++;
+
+      return lpt->staging;
+   }
+
    assert(level < LP_MAX_TEXTURE_LEVELS);
 
    /*
@@ -623,16 +860,28 @@ static void
 llvmpipe_transfer_unmap(struct pipe_context *pipe,
                         struct pipe_transfer *transfer)
 {
-   assert(transfer->resource);
+   struct llvmpipe_transfer *lpt = llvmpipe_transfer(transfer);
 
-   llvmpipe_resource_unmap(transfer->resource,
-                           transfer->level,
-                           transfer->box.z);
+   assert(transfer->resource);
 
    /* Effectively do the texture_update work here - if texture images
     * needed post-processing to put them into hardware layout, this is
-    * where it would happen.  For llvmpipe, nothing to do.
+    * where it would happen.  For llvmpipe, that's only tiled textures.
     */
+   if (lpt->staging) {
+      if (transfer->usage & PIPE_TRANSFER_WRITE) {
+         llvmpipe_tiled_copy(llvmpipe_resource(transfer->resource),
+                             transfer->level, &transfer->box, lpt->staging,
+                             transfer->stride, transfer->layer_stride, TRUE);
+      }
+      FREE(lpt->staging);
+   }
+   else {
+      llvmpipe_resource_unmap(transfer->resource,
+                              transfer->level,
+                              transfer->box.z);
+   }
+
    assert (transfer->resource);
    pipe_resource_reference(&transfer->resource, NULL);
    FREE(transfer);
@@ -815,6 +1064,7 @@ llvmpipe_init_screen_resource_funcs(struct pipe_screen *screen)
 
    screen->resource_create = llvmpipe_resource_create;
 /*   screen->resource_create_front = llvmpipe_resource_create_front; */
+   screen->resource_from_user_memory = llvmpipe_resource_from_user_memory;
    screen->resource_destroy = llvmpipe_resource_destroy;
    screen->resource_from_handle = llvmpipe_resource_from_handle;
    screen->resource_get_handle = llvmpipe_resource_get_handle;
@@ -85,6 +85,13 @@ struct llvmpipe_resource
     */
    void *data;
 
+   /**
+    * Texture data is stored in 4x4 texel micro-tiles rather than linearly
+    * (see LP_SAMPLE_TILE_SIZE).  Only the sampler and transfers know how to
+    * deal with that, anything else has to llvmpipe_resource_untile() first.
+    */
+   boolean tiled;
+
    boolean userBuffer;  /** Is this a user-space buffer? */
    unsigned timestamp;
 
@@ -102,6 +109,9 @@ struct llvmpipe_transfer
    struct pipe_transfer base;
 
    unsigned long offset;
+
+   /** Linear copy of the mapped box, for tiled textures */
+   void *staging;
 };
 
 
@@ -195,6 +205,11 @@ llvmpipe_resource_stride(struct pipe_resource *resource,
 }
 
 
+void
+llvmpipe_resource_untile(struct pipe_context *pipe,
+                         struct pipe_resource *resource);
+
+
 void *
 llvmpipe_resource_map(struct pipe_resource *resource,
                       unsigned level,
@@ -786,8 +786,8 @@ private:
 
    inline void checkInterference(const RIG_Node *, Graph::EdgeIterator&);
 
-   inline void insertOrderedTail(std::list<RIG_Node *>&, RIG_Node *);
-   void checkList(std::list<RIG_Node *>&);
+   static bool compareLiveBegin(const RIG_Node *, const RIG_Node *);
+   void checkList(std::vector<RIG_Node *>&);
 
 private:
    std::stack<uint32_t> stack;
@@ -1178,11 +1178,11 @@ GCRA::~GCRA()
 }
 
 void
-GCRA::checkList(std::list<RIG_Node *>& lst)
+GCRA::checkList(std::vector<RIG_Node *>& lst)
 {
    GCRA::RIG_Node *prev = NULL;
 
-   for (std::list<RIG_Node *>::iterator it = lst.begin();
+   for (std::vector<RIG_Node *>::iterator it = lst.begin();
         it != lst.end();
         ++it) {
       assert((*it)->getValue()->join == (*it)->getValue());
@@ -1192,56 +1192,59 @@ GCRA::checkList(std::list<RIG_Node *>& lst)
    }
 }
 
-void
-GCRA::insertOrderedTail(std::list<RIG_Node *>& list, RIG_Node *node)
+bool
+GCRA::compareLiveBegin(const RIG_Node *a, const RIG_Node *b)
 {
-   if (node->livei.isEmpty())
-      return;
-   // only the intervals of joined values don't necessarily arrive in order
-   std::list<RIG_Node *>::iterator prev, it;
-   for (it = list.end(); it != list.begin(); it = prev) {
-      prev = it;
-      --prev;
-      if ((*prev)->livei.begin() <= node->livei.begin())
-         break;
-   }
-   list.insert(it, node);
+   return a->livei.begin() < b->livei.begin();
 }
 
 void
 GCRA::buildRIG(ArrayList& insns)
 {
-   std::list<RIG_Node *> values, active;
+   std::vector<RIG_Node *> values, active;
 
+   // Values are collected in definition order and sorted by the start of
+   // their live interval in one go: only the intervals of joined values
+   // don't necessarily arrive in order, but on large functions there are
+   // enough of them to make sorted insertion quadratic.  The sort is stable
+   // to keep the order of the interference edges, and so the allocation,
+   // as it was.
    for (std::deque<ValueDef>::iterator it = func->ins.begin();
-        it != func->ins.end(); ++it)
-      insertOrderedTail(values, getNode(it->get()->asLValue()));
+        it != func->ins.end(); ++it) {
+      RIG_Node *node = getNode(it->get()->asLValue());
+      if (!node->livei.isEmpty())
+         values.push_back(node);
+   }
 
    for (int i = 0; i < insns.getSize(); ++i) {
       Instruction *insn = reinterpret_cast<Instruction *>(insns.get(i));
-      for (int d = 0; insn->defExists(d); ++d)
-         if (insn->getDef(d)->rep() == insn->getDef(d))
-            insertOrderedTail(values, getNode(insn->getDef(d)->asLValue()));
+      for (int d = 0; insn->defExists(d); ++d) {
+         if (insn->getDef(d)->rep() == insn->getDef(d)) {
+            RIG_Node *node = getNode(insn->getDef(d)->asLValue());
+            if (!node->livei.isEmpty())
+               values.push_back(node);
+         }
+      }
    }
+   std::stable_sort(values.begin(), values.end(), compareLiveBegin);
    checkList(values);
 
-   while (!values.empty()) {
-      RIG_Node *cur = values.front();
+   for (std::vector<RIG_Node *>::iterator cur = values.begin();
+        cur != values.end(); ++cur) {
+      size_t n = 0;
 
-      for (std::list<RIG_Node *>::iterator it = active.begin();
-           it != active.end();) {
-         RIG_Node *node = *it;
+      // drop the values which are dead by now, compacting in place
+      for (size_t i = 0; i < active.size(); ++i) {
+         RIG_Node *node = active[i];
 
-         if (node->livei.end() <= cur->livei.begin()) {
-            it = active.erase(it);
-         } else {
-            if (node->f == cur->f && node->livei.overlaps(cur->livei))
-               cur->addInterference(node);
-            ++it;
-         }
+         if (node->livei.end() <= (*cur)->livei.begin())
+            continue;
+         if (node->f == (*cur)->f && node->livei.overlaps((*cur)->livei))
+            (*cur)->addInterference(node);
+         active[n++] = node;
       }
-      values.pop_front();
-      active.push_back(cur);
+      active.resize(n);
+      active.push_back(*cur);
    }
 }
 
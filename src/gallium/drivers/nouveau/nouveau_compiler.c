@@ -23,6 +23,7 @@
 #include <errno.h>
 
 #include "tgsi/tgsi_text.h"
+#include "util/os_time.h"
 #include "util/u_debug.h"
 
 #include "codegen/nv50_ir_driver.h"
@@ -105,6 +106,7 @@ static int
 nouveau_codegen(int chipset, int type, struct tgsi_token tokens[],
                 unsigned *size, unsigned **code) {
    struct nv50_ir_prog_info info = {0};
+   int64_t start;
    int ret;
 
    info.type = type;
@@ -124,12 +126,22 @@ nouveau_codegen(int chipset, int type, struct tgsi_token tokens[],
    info.dbgFlags = debug_get_num_option("NV50_PROG_DEBUG", 0);
    info.omitLineNum = debug_get_num_option("NV50_PROG_DEBUG_OMIT_LINENUM", 0);
 
+   start = os_time_get_nano();
    ret = nv50_ir_generate_code(&info);
    if (ret) {
       _debug_printf("Error compiling program: %d\n", ret);
       return ret;
    }
 
+   /* The counts of the drivers' shader-db messages, and how long the
+    * compile took. */
+   _debug_printf("type: %d, local: %d, shared: %d, gpr: %d, inst: %d, "
+                 "bytes: %d, time: %.3f ms\n",
+                 type, info.bin.tlsSpace, info.bin.smemSize,
+                 info.bin.maxGPR + 1, info.bin.instructions,
+                 info.bin.codeSize,
+                 (os_time_get_nano() - start) / 1000000.0);
+
    *size = info.bin.codeSize;
    *code = info.bin.code;
    return 0;
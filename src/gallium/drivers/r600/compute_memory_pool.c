@@ -206,9 +206,42 @@ static void compute_memory_shadow(struct compute_memory_pool* pool,
 				pool->shadow, 0, pool->size_in_dw*4);
 }
 
+/**
+ * Looks for a free range of \a size_in_dw between the items of the pool,
+ * or after the last one.
+ * \return the start of the range, or -1 if there's no room in the pool
+ * \see compute_memory_finalize_pending
+ */
+static int64_t compute_memory_find_gap(struct compute_memory_pool *pool,
+	int64_t size_in_dw)
+{
+	struct compute_memory_item *item;
+	int64_t last_end = 0;
+
+	size_in_dw = align(size_in_dw, ITEM_ALIGNMENT);
+
+	LIST_FOR_EACH_ENTRY(item, pool->item_list, link) {
+		if (item->start_in_dw - last_end >= size_in_dw)
+			return last_end;
+
+		last_end = item->start_in_dw + align(item->size_in_dw, ITEM_ALIGNMENT);
+	}
+
+	if (pool->size_in_dw - last_end >= size_in_dw)
+		return last_end;
+
+	return -1;
+}
+
 /**
  * Moves all the items marked for promotion from the \a unallocated_list
  * to the \a item_list.
+ *
+ * The items are placed in the first gap they fit in, so freeing and
+ * demoting items doesn't require a defragmentation.  The pool is only
+ * grown (and defragmented while at it) when an item doesn't fit anywhere,
+ * and then by at least half of the pool size, so that growing, which
+ * copies the whole pool, stays rare.
  * \return -1 if it fails, 0 otherwise
  * \see evergreen_set_global_binding
  */
@@ -219,7 +252,7 @@ int compute_memory_finalize_pending(struct compute_memory_pool* pool,
 
 	int64_t allocated = 0;
 	int64_t unallocated = 0;
-	int64_t last_pos;
+	int64_t start_in_dw;
 
 	int err = 0;
 
@@ -247,28 +280,30 @@ int compute_memory_finalize_pending(struct compute_memory_pool* pool,
 		return 0;
 	}
 
-	if (pool->size_in_dw < allocated + unallocated) {
-		err = compute_memory_grow_defrag_pool(pool, pipe, allocated + unallocated);
-		if (err == -1)
-			return -1;
-	}
-	else if (pool->status & POOL_FRAGMENTED) {
-		struct pipe_resource *src = (struct pipe_resource *)pool->bo;
-		compute_memory_defrag(pool, src, src, pipe);
-	}
-
-	/* After defragmenting the pool, allocated is equal to the first available
-	 * position for new items in the pool */
-	last_pos = allocated;
-
 	/* Loop through all the unallocated items, check if they are marked
 	 * for promoting, allocate space for them and add them to the item_list. */
 	LIST_FOR_EACH_ENTRY_SAFE(item, next, pool->unallocated_list, link) {
 		if (item->status & ITEM_FOR_PROMOTING) {
-			err = compute_memory_promote_item(pool, item, pipe, last_pos);
+			start_in_dw = compute_memory_find_gap(pool, item->size_in_dw);
+
+			if (start_in_dw == -1) {
+				err = compute_memory_grow_defrag_pool(pool, pipe,
+					MAX2(allocated + unallocated,
+					     pool->size_in_dw + pool->size_in_dw / 2));
+				if (err == -1)
+					return -1;
+
+				/* The pool is packed now, so the item fits after
+				 * the last one */
+				start_in_dw = compute_memory_find_gap(pool, item->size_in_dw);
+				assert(start_in_dw != -1);
+			}
+
+			err = compute_memory_promote_item(pool, item, pipe, start_in_dw);
 			item->status &= ~ITEM_FOR_PROMOTING;
 
-			last_pos += align(item->size_in_dw, ITEM_ALIGNMENT);
+			allocated += align(item->size_in_dw, ITEM_ALIGNMENT);
+			unallocated -= align(item->size_in_dw, ITEM_ALIGNMENT);
 
 			if (err == -1)
 				return -1;
@@ -323,6 +358,7 @@ static int compute_memory_promote_item(struct compute_memory_pool *pool,
 	struct r600_context *rctx = (struct r600_context *)pipe;
 	struct pipe_resource *src = (struct pipe_resource *)item->real_buffer;
 	struct pipe_resource *dst = (struct pipe_resource *)pool->bo;
+	struct compute_memory_item *pos;
 	struct pipe_box box;
 
 	COMPUTE_DBG(pool->screen, "* compute_memory_promote_item()\n"
@@ -335,8 +371,12 @@ static int compute_memory_promote_item(struct compute_memory_pool *pool,
 	/* Remove the item from the unallocated list */
 	list_del(&item->link);
 
-	/* Add it back to the item_list */
-	list_addtail(&item->link, pool->item_list);
+	/* Add it back to the item_list, which is kept ordered by start_in_dw */
+	LIST_FOR_EACH_ENTRY(pos, pool->item_list, link) {
+		if (pos->start_in_dw > start_in_dw)
+			break;
+	}
+	list_addtail(&item->link, &pos->link);
 	item->start_in_dw = start_in_dw;
 
 	if (src) {
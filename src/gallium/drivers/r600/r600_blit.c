@@ -974,6 +974,16 @@ static void r600_flush_resource(struct pipe_context *ctx,
 	}
 }
 
+static void r600_begin_blit_batch(struct pipe_context *ctx)
+{
+	util_blitter_begin_batch(((struct r600_context *)ctx)->blitter);
+}
+
+static void r600_end_blit_batch(struct pipe_context *ctx)
+{
+	util_blitter_end_batch(((struct r600_context *)ctx)->blitter);
+}
+
 void r600_init_blit_functions(struct r600_context *rctx)
 {
 	rctx->b.b.clear = r600_clear;
@@ -981,6 +991,8 @@ void r600_init_blit_functions(struct r600_context *rctx)
 	rctx->b.b.clear_depth_stencil = r600_clear_depth_stencil;
 	rctx->b.b.resource_copy_region = r600_resource_copy_region;
 	rctx->b.b.blit = r600_blit;
+	rctx->b.b.begin_blit_batch = r600_begin_blit_batch;
+	rctx->b.b.end_blit_batch = r600_end_blit_batch;
 	rctx->b.b.flush_resource = r600_flush_resource;
 	rctx->b.clear_buffer = r600_clear_buffer;
 	rctx->b.blit_decompress_depth = r600_blit_decompress_depth;
@@ -657,6 +657,9 @@ public:
 	static unsigned dskip_end;
 	static unsigned dskip_mode;
 
+	static unsigned max_ndw;
+	static unsigned time_budget_ms;
+
 	sb_context() : src_stats(), opt_stats(), isa(0),
 			hw_chip(HW_CHIP_UNKNOWN), hw_class(HW_CLASS_UNKNOWN) {}
 
@@ -67,6 +67,9 @@ sb_context *r600_sb_context_create(struct r600_context *rctx) {
 	sb_context::dskip_end = debug_get_num_option("R600_SB_DSKIP_END", 0);
 	sb_context::dskip_mode = debug_get_num_option("R600_SB_DSKIP_MODE", 0);
 
+	sb_context::max_ndw = debug_get_num_option("R600_SB_MAX_DWORDS", 0);
+	sb_context::time_budget_ms = debug_get_num_option("R600_SB_TIME_BUDGET", 0);
+
 	return sctx;
 }
 
@@ -101,7 +104,7 @@ int r600_sb_bytecode_process(struct r600_context *rctx,
 	}
 
 	int64_t time_start = 0;
-	if (sb_context::dump_stat) {
+	if (sb_context::dump_stat || sb_context::time_budget_ms) {
 		time_start = os_time_get_nano();
 	}
 
@@ -150,6 +153,18 @@ int r600_sb_bytecode_process(struct r600_context *rctx,
 		}
 	}
 
+	/* compile time budget: the optimizer's run time grows faster than
+	 * linearly with the shader size, so very large shaders keep the
+	 * bytecode of the default backend (R600_SB_MAX_DWORDS), and so do the
+	 * shaders which are still not done after R600_SB_TIME_BUDGET ms.
+	 */
+	if (sb_context::max_ndw && (unsigned)bc->ndw > sb_context::max_ndw) {
+		SB_DUMP_STAT( sblog << "sb: shader " << shader_id << " is too large ("
+				<< bc->ndw << " dw), not optimized\n"; );
+		delete sh;
+		return 0;
+	}
+
 	if ((r = parser.prepare())) {
 		assert(!"sb: bytecode parsing error");
 		return r;
@@ -173,6 +188,13 @@ int r600_sb_bytecode_process(struct r600_context *rctx,
 				sh->dump_ir();); \
 		} \
 		assert(!r); \
+		if (sb_context::time_budget_ms && os_time_get_nano() - time_start > \
+				(int64_t)sb_context::time_budget_ms * 1000000) { \
+			SB_DUMP_STAT( sblog << "sb: shader " << shader_id << " over the " \
+					"time budget after the " << #n << " pass, not optimized\n"; ); \
+			delete sh; \
+			return 0; \
+		} \
 	} while (0)
 
 	SB_RUN_PASS(ssa_prepare,		0);
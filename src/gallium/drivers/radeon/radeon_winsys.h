@@ -124,6 +124,7 @@ enum radeon_value_id {
     RADEON_NUM_SDMA_IBS,
     RADEON_GFX_BO_LIST_COUNTER, /* number of BOs submitted in gfx IBs */
     RADEON_GFX_IB_SIZE_COUNTER,
+    RADEON_NUM_REUSED_BO_LISTS, /* submissions with the BO list of the previous one */
     RADEON_NUM_BYTES_MOVED,
     RADEON_NUM_EVICTIONS,
     RADEON_NUM_VRAM_CPU_PAGE_FAULTS,
@@ -62,7 +62,9 @@ struct gfx10_sh_query_buffer_mem {
 		uint64_t emitted_primitives;
 	} stream[4];
 	uint32_t fence; /* bottom-of-pipe fence: set to ~0 when draws have finished */
-	uint32_t pad[31];
+	uint32_t pad0;
+	uint64_t culled_primitives; /* by NGG primitive culling */
+	uint32_t pad[28];
 };
 
 /* Shader-based queries. */
@@ -168,6 +170,7 @@ static bool gfx10_alloc_query_buffer(struct si_context *sctx)
 		for (unsigned j = 0; j < 16; ++j)
 			results[32 * i + j] = (uint64_t)1 << 63;
 		results[32 * i + 16] = 0;
+		results[32 * i + 17] = 0;
 	}
 
 	LIST_ADDTAIL(&qbuf->list, &sctx->shader_query_buffers);
@@ -283,6 +286,9 @@ static void gfx10_sh_query_add_result(struct gfx10_sh_query *query,
 				     qmem->stream[query->stream].generated_primitives;
 		}
 		break;
+	case SI_QUERY_NGG_CULLED_PRIMS:
+		result->u64 += qmem->culled_primitives;
+		break;
 	default:
 		assert(0);
 	}
@@ -25,6 +25,7 @@
 #include "si_shader_internal.h"
 
 #include "sid.h"
+#include "ac_llvm_cull.h"
 
 #include "util/u_memory.h"
 #include "util/u_prim.h"
@@ -496,20 +497,79 @@ static void build_streamout(struct si_shader_context *ctx,
 	}
 }
 
+/* The position for culling is stored after the streamout outputs. */
+static unsigned ngg_nogs_vertex_pos_offset(struct si_shader *shader)
+{
+	if (shader->selector->so.num_outputs)
+		return 4 * shader->selector->info.num_outputs;
+	return 0;
+}
+
 static unsigned ngg_nogs_vertex_size(struct si_shader *shader)
 {
-	unsigned lds_vertex_size = 0;
+	unsigned lds_vertex_size = ngg_nogs_vertex_pos_offset(shader);
+
+	if (shader->key.opt.ngg_culling)
+		lds_vertex_size += 4;
 
 	/* The edgeflag is always stored in the last element that's also
 	 * used for padding to reduce LDS bank conflicts. */
-	if (shader->selector->so.num_outputs)
-		lds_vertex_size = 4 * shader->selector->info.num_outputs + 1;
-	if (shader->selector->info.writes_edgeflag)
-		lds_vertex_size = MAX2(lds_vertex_size, 1);
+	if (lds_vertex_size || shader->selector->info.writes_edgeflag)
+		lds_vertex_size++;
 
 	return lds_vertex_size;
 }
 
+/**
+ * Cull the primitive of a GS thread using the positions that ES threads
+ * stored in LDS. Returns i1 true if the primitive is accepted.
+ */
+static LLVMValueRef ngg_nogs_cull_primitive(struct si_shader_context *ctx,
+					    LLVMValueRef vertex_ptr[3])
+{
+	struct si_shader_key *key = &ctx->shader->key;
+	LLVMValueRef pos[3][4], vp_scale[2], vp_translate[2];
+	unsigned pos_offset = ngg_nogs_vertex_pos_offset(ctx->shader);
+
+	for (unsigned i = 0; i < 3; i++) {
+		for (unsigned chan = 0; chan < 4; chan++) {
+			LLVMValueRef tmp =
+				ac_build_gep0(&ctx->ac, vertex_ptr[i],
+					      LLVMConstInt(ctx->i32, pos_offset + chan, 0));
+			tmp = LLVMBuildLoad(ctx->ac.builder, tmp, "");
+			pos[i][chan] = ac_to_float(&ctx->ac, tmp);
+		}
+	}
+
+	/* Load the viewport state (see si_update_ngg_culling_constants). */
+	LLVMValueRef ptr = LLVMGetParam(ctx->main_fn, ctx->param_rw_buffers);
+	LLVMValueRef consts =
+		ac_build_load_to_sgpr(&ctx->ac, ptr,
+				      LLVMConstInt(ctx->i32, SI_VS_CONST_NGG_CULLING, 0));
+	LLVMValueRef values[5];
+
+	for (unsigned i = 0; i < 5; i++) {
+		values[i] = ac_build_buffer_load(&ctx->ac, consts, 1, NULL,
+						 LLVMConstInt(ctx->i32, i * 4, 0),
+						 NULL, 0, 0, true, true);
+	}
+	vp_scale[0] = values[0];
+	vp_scale[1] = values[1];
+	vp_translate[0] = values[2];
+	vp_translate[1] = values[3];
+
+	struct ac_cull_options options = {};
+	options.cull_front = key->opt.ngg_cull_front;
+	options.cull_back = key->opt.ngg_cull_back;
+	options.cull_view_xy = true;
+	options.cull_small_prims = true;
+	options.cull_zero_area = true;
+	options.cull_w = true;
+
+	return ac_cull_triangle(&ctx->ac, pos, ctx->i1true, vp_scale,
+				vp_translate, values[4], &options);
+}
+
 /**
  * Returns an `[N x i32] addrspace(LDS)*` pointing at contiguous LDS storage
  * for the vertex outputs.
@@ -544,13 +604,32 @@ void gfx10_emit_ngg_epilogue(struct ac_shader_abi *abi,
 
 	LLVMValueRef vertex_ptr = NULL;
 
-	if (sel->so.num_outputs || sel->info.writes_edgeflag)
+	if (sel->so.num_outputs || sel->info.writes_edgeflag ||
+	    ctx->shader->key.opt.ngg_culling)
 		vertex_ptr = ngg_nogs_vertex_ptr(ctx, get_thread_id_in_tg(ctx));
 
 	for (unsigned i = 0; i < info->num_outputs; i++) {
 		outputs[i].semantic_name = info->output_semantic_name[i];
 		outputs[i].semantic_index = info->output_semantic_index[i];
 
+		/* Store the position divided by W for culling. */
+		if (info->output_semantic_name[i] == TGSI_SEMANTIC_POSITION &&
+		    ctx->shader->key.opt.ngg_culling) {
+			unsigned pos_offset = ngg_nogs_vertex_pos_offset(ctx->shader);
+			LLVMValueRef pos[4];
+
+			for (unsigned j = 0; j < 4; j++)
+				pos[j] = LLVMBuildLoad(builder, addrs[4 * i + j], "");
+			for (unsigned j = 0; j < 3; j++)
+				pos[j] = ac_build_fdiv(&ctx->ac, pos[j], pos[3]);
+
+			for (unsigned j = 0; j < 4; j++) {
+				tmp = ac_build_gep0(&ctx->ac, vertex_ptr,
+					LLVMConstInt(ctx->i32, pos_offset + j, false));
+				LLVMBuildStore(builder, ac_to_integer(&ctx->ac, pos[j]), tmp);
+			}
+		}
+
 		for (unsigned j = 0; j < 4; j++) {
 			outputs[i].vertex_stream[j] =
 				(info->output_streams[i] >> (2 * j)) & 3;
@@ -661,13 +740,78 @@ void gfx10_emit_ngg_epilogue(struct ac_shader_abi *abi,
 		ac_build_endif(&ctx->ac, 5400);
 	}
 
+	/* Primitive culling. Culled primitives are exported as null
+	 * primitives, so that the rasterizer doesn't have to reject them.
+	 */
+	LLVMValueRef prim_accepted = NULL;
+
+	if (ctx->shader->key.opt.ngg_culling) {
+		/* Streamout and edge flags already inserted the barrier. */
+		if (!sel->so.num_outputs && !sel->info.writes_edgeflag)
+			ac_build_s_barrier(&ctx->ac);
+
+		prim_accepted = ac_build_alloca_undef(&ctx->ac, ctx->i1, "");
+		LLVMBuildStore(builder, ctx->i1true, prim_accepted);
+
+		ac_build_ifcc(&ctx->ac, is_gs_thread, 5450);
+		{
+			LLVMValueRef vertex_ptrs[3];
+
+			for (unsigned i = 0; i < 3; i++)
+				vertex_ptrs[i] = ngg_nogs_vertex_ptr(ctx, vtxindex[i]);
+
+			/* Points and lines aren't culled. */
+			tmp = LLVMBuildICmp(builder, LLVMIntNE, num_vertices_val,
+					    LLVMConstInt(ctx->i32, 3, 0), "");
+			tmp = LLVMBuildOr(builder, tmp,
+					  ngg_nogs_cull_primitive(ctx, vertex_ptrs), "");
+			LLVMBuildStore(builder, tmp, prim_accepted);
+		}
+		ac_build_endif(&ctx->ac, 5450);
+
+		/* Count culled primitives for queries. */
+		tmp = si_unpack_param(ctx, ctx->param_vs_state_bits, 6, 1);
+		tmp = LLVMBuildTrunc(builder, tmp, ctx->i1, "");
+		ac_build_ifcc(&ctx->ac, tmp, 5451); /* if (STREAMOUT_QUERY_ENABLED) */
+		{
+			tmp = LLVMBuildLoad(builder, prim_accepted, "");
+			tmp = LLVMBuildAnd(builder, is_gs_thread,
+					   LLVMBuildNot(builder, tmp, ""), "");
+			tmp = ac_build_ballot(&ctx->ac,
+					      LLVMBuildZExt(builder, tmp, ctx->i32, ""));
+			LLVMValueRef num_culled = ac_build_bit_count(&ctx->ac, tmp);
+
+			tmp = LLVMBuildICmp(builder, LLVMIntEQ, ac_get_thread_id(&ctx->ac),
+					    ctx->i32_0, "");
+			tmp = LLVMBuildAnd(builder, tmp,
+					   LLVMBuildICmp(builder, LLVMIntNE, num_culled,
+							 ctx->i32_0, ""), "");
+			ac_build_ifcc(&ctx->ac, tmp, 5452);
+			{
+				LLVMValueRef args[] = {
+					num_culled,
+					ngg_get_query_buf(ctx),
+					LLVMConstInt(ctx->i32, 136, false), /* offset of culled_primitives */
+					ctx->i32_0, /* soffset */
+					ctx->i32_0, /* cachepolicy */
+				};
+
+				ac_build_intrinsic(&ctx->ac, "llvm.amdgcn.raw.buffer.atomic.add.i32",
+						   ctx->i32, args, 5, 0);
+			}
+			ac_build_endif(&ctx->ac, 5452);
+		}
+		ac_build_endif(&ctx->ac, 5451);
+	}
+
 	/* Copy Primitive IDs from GS threads to the LDS address corresponding
 	 * to the ES thread of the provoking vertex.
 	 */
 	if (ctx->type == PIPE_SHADER_VERTEX &&
 	    ctx->shader->key.mono.u.vs_export_prim_id) {
-		/* Streamout and edge flags use LDS. Make it idle, so that we can reuse it. */
-		if (sel->so.num_outputs || sel->info.writes_edgeflag)
+		/* Streamout, edge flags and culling use LDS. Make it idle, so that we can reuse it. */
+		if (sel->so.num_outputs || sel->info.writes_edgeflag ||
+		    ctx->shader->key.opt.ngg_culling)
 			ac_build_s_barrier(&ctx->ac);
 
 		ac_build_ifcc(&ctx->ac, is_gs_thread, 5400);
@@ -746,6 +890,11 @@ void gfx10_emit_ngg_epilogue(struct ac_shader_abi *abi,
 		prim.isnull = ctx->ac.i1false;
 		memcpy(prim.index, vtxindex, sizeof(vtxindex[0]) * 3);
 
+		if (prim_accepted) {
+			tmp = LLVMBuildLoad(builder, prim_accepted, "");
+			prim.isnull = LLVMBuildNot(builder, tmp, "");
+		}
+
 		for (unsigned i = 0; i < num_vertices; ++i) {
 			if (ctx->type != PIPE_SHADER_VERTEX) {
 				prim.edgeflag[i] = ctx->i1false;
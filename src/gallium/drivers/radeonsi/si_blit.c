@@ -1341,12 +1341,24 @@ void si_decompress_dcc(struct si_context *sctx, struct si_texture *tex)
 				 true);
 }
 
+static void si_begin_blit_batch(struct pipe_context *ctx)
+{
+	util_blitter_begin_batch(((struct si_context*)ctx)->blitter);
+}
+
+static void si_end_blit_batch(struct pipe_context *ctx)
+{
+	util_blitter_end_batch(((struct si_context*)ctx)->blitter);
+}
+
 void si_init_blit_functions(struct si_context *sctx)
 {
 	sctx->b.resource_copy_region = si_resource_copy_region;
 
 	if (sctx->has_graphics) {
 		sctx->b.blit = si_blit;
+		sctx->b.begin_blit_batch = si_begin_blit_batch;
+		sctx->b.end_blit_batch = si_end_blit_batch;
 		sctx->b.flush_resource = si_flush_resource;
 		sctx->b.generate_mipmap = si_generate_mipmap;
 	}
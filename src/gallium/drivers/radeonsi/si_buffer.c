@@ -29,6 +29,9 @@
 #include <inttypes.h>
 #include <stdio.h>
 
+/* Staging uploads at least this large are copied by SDMA. */
+#define SI_SDMA_UPLOAD_MIN_SIZE		(64 * 1024)
+
 bool si_rings_is_buffer_referenced(struct si_context *sctx,
 				   struct pb_buffer *buf,
 				   enum radeon_bo_usage usage)
@@ -532,6 +535,29 @@ static void *si_buffer_transfer_map(struct pipe_context *ctx,
 					ptransfer, data, NULL, 0);
 }
 
+/**
+ * Whether a staging upload into the buffer can be done by SDMA, so that it
+ * overlaps with rendering instead of being serialized in the gfx IB.
+ *
+ * The SDMA IB is submitted before the gfx IB that it's flushed with, and the
+ * winsys makes the first gfx IB using the buffer wait for the SDMA fence.
+ * That's only correct if the current gfx IB hasn't used the buffer yet.
+ */
+static bool si_can_upload_via_sdma(struct si_context *sctx,
+				   struct si_resource *buf, unsigned size)
+{
+	return sctx->dma_cs &&
+	       sctx->screen->info.has_dedicated_vram &&
+	       buf->domains & RADEON_DOMAIN_VRAM &&
+	       !(buf->flags & RADEON_FLAG_SPARSE) &&
+	       size >= SI_SDMA_UPLOAD_MIN_SIZE &&
+	       !sctx->ws->cs_is_buffer_referenced(sctx->gfx_cs, buf->buf,
+						  RADEON_USAGE_READWRITE) &&
+	       (!sctx->prim_discard_compute_cs ||
+		!sctx->ws->cs_is_buffer_referenced(sctx->prim_discard_compute_cs,
+						   buf->buf, RADEON_USAGE_READWRITE));
+}
+
 static void si_buffer_do_flush_region(struct pipe_context *ctx,
 				      struct pipe_transfer *transfer,
 				      const struct pipe_box *box)
@@ -586,8 +612,17 @@ static void si_buffer_do_flush_region(struct pipe_context *ctx,
 		}
 
 		/* Copy the staging buffer into the original one. */
-		si_copy_buffer(sctx, transfer->resource, &stransfer->staging->b.b,
-			       box->x, src_offset, box->width);
+		if (si_can_upload_via_sdma(sctx, buf, box->width)) {
+			struct pipe_box src_box;
+
+			u_box_1d(src_offset, box->width, &src_box);
+			sctx->dma_copy(ctx, transfer->resource, 0, box->x, 0, 0,
+				       &stransfer->staging->b.b, 0, &src_box);
+			sctx->sdma_staging_uploads = true;
+		} else {
+			si_copy_buffer(sctx, transfer->resource, &stransfer->staging->b.b,
+				       box->x, src_offset, box->width);
+		}
 	}
 
 	util_range_add(&buf->valid_buffer_range, box->x,
@@ -25,6 +25,7 @@
 
 #include "nir/tgsi_to_nir.h"
 #include "tgsi/tgsi_parse.h"
+#include "util/hash_table.h"
 #include "util/u_async_debug.h"
 #include "util/u_memory.h"
 #include "util/u_upload_mgr.h"
@@ -69,7 +70,7 @@ static const amd_kernel_code_t *si_compute_get_code_object(
 	if (!ac_rtld_open(&rtld, (struct ac_rtld_open_info){
 			.info = &sel->screen->info,
 			.shader_type = MESA_SHADER_COMPUTE,
-			.wave_size = sel->screen->compute_wave_size,
+			.wave_size = sel->wave_size,
 			.num_parts = 1,
 			.elf_ptrs = &program->shader.binary.elf_buffer,
 			.elf_sizes = &program->shader.binary.elf_size }))
@@ -107,6 +108,136 @@ static void code_object_to_config(const amd_kernel_code_t *code_object,
 }
 
 /* Asynchronous compute shader compilation. */
+static bool si_nir_uses_subgroups(nir_shader *nir)
+{
+	nir_foreach_function(function, nir) {
+		if (!function->impl)
+			continue;
+
+		nir_foreach_block(block, function->impl) {
+			nir_foreach_instr(instr, block) {
+				if (instr->type != nir_instr_type_intrinsic)
+					continue;
+
+				switch (nir_instr_as_intrinsic(instr)->intrinsic) {
+				case nir_intrinsic_ballot:
+				case nir_intrinsic_read_invocation:
+				case nir_intrinsic_read_first_invocation:
+				case nir_intrinsic_first_invocation:
+				case nir_intrinsic_elect:
+				case nir_intrinsic_vote_any:
+				case nir_intrinsic_vote_all:
+				case nir_intrinsic_vote_feq:
+				case nir_intrinsic_vote_ieq:
+				case nir_intrinsic_shuffle:
+				case nir_intrinsic_shuffle_xor:
+				case nir_intrinsic_shuffle_up:
+				case nir_intrinsic_shuffle_down:
+				case nir_intrinsic_quad_broadcast:
+				case nir_intrinsic_quad_swap_horizontal:
+				case nir_intrinsic_quad_swap_vertical:
+				case nir_intrinsic_quad_swap_diagonal:
+				case nir_intrinsic_reduce:
+				case nir_intrinsic_inclusive_scan:
+				case nir_intrinsic_exclusive_scan:
+				case nir_intrinsic_load_subgroup_size:
+				case nir_intrinsic_load_subgroup_invocation:
+				case nir_intrinsic_load_subgroup_eq_mask:
+				case nir_intrinsic_load_subgroup_ge_mask:
+				case nir_intrinsic_load_subgroup_gt_mask:
+				case nir_intrinsic_load_subgroup_le_mask:
+				case nir_intrinsic_load_subgroup_lt_mask:
+					return true;
+				default:
+					break;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+static bool si_tgsi_uses_subgroups(const struct tgsi_shader_info *info)
+{
+	if (info->opcode_count[TGSI_OPCODE_BALLOT] ||
+	    info->opcode_count[TGSI_OPCODE_READ_INVOC] ||
+	    info->opcode_count[TGSI_OPCODE_READ_FIRST] ||
+	    info->opcode_count[TGSI_OPCODE_VOTE_ANY] ||
+	    info->opcode_count[TGSI_OPCODE_VOTE_ALL] ||
+	    info->opcode_count[TGSI_OPCODE_VOTE_EQ])
+		return true;
+
+	for (unsigned i = 0; i < info->num_system_values; i++) {
+		if (info->system_value_semantic_name[i] >= TGSI_SEMANTIC_SUBGROUP_SIZE &&
+		    info->system_value_semantic_name[i] <= TGSI_SEMANTIC_SUBGROUP_LT_MASK)
+			return true;
+	}
+	return false;
+}
+
+/* Return the fraction of branches with a divergent condition, in percent. */
+static unsigned si_nir_divergent_branch_percentage(nir_shader *nir)
+{
+	/* The analysis needs LCSSA, which would change the shader. */
+	nir_shader *clone = nir_shader_clone(NULL, nir);
+	unsigned num_ifs = 0, num_divergent_ifs = 0;
+
+	nir_convert_to_lcssa(clone, true, true);
+	bool *divergent = nir_divergence_analysis(clone, 0);
+
+	nir_foreach_block(block, nir_shader_get_entrypoint(clone)) {
+		nir_if *nif = nir_block_get_following_if(block);
+
+		if (!nif)
+			continue;
+
+		num_ifs++;
+		if (divergent[nif->condition.ssa->index])
+			num_divergent_ifs++;
+	}
+
+	ralloc_free(clone);
+	return num_ifs ? num_divergent_ifs * 100 / num_ifs : 0;
+}
+
+/* Choose the wave size of a compute shader on GFX10.
+ *
+ * Wave32 is better when a wave64 would leave many lanes without work,
+ * either because the thread group is small or because many branches are
+ * divergent. Shaders using subgroup operations keep the wave size reported
+ * as the subgroup size.
+ */
+static unsigned si_choose_compute_wave_size(struct si_screen *sscreen,
+					    struct si_compute *program)
+{
+	struct si_shader_selector *sel = &program->sel;
+
+	util_dynarray_foreach(&sscreen->cs_wave_size_table,
+			      struct si_wave_size_override, entry) {
+		if (entry->ir_hash == sel->ir_hash)
+			return entry->wave_size;
+	}
+
+	if (!(sscreen->debug_flags & DBG(W_AUTO_CS)) ||
+	    (sel->nir ? si_nir_uses_subgroups(sel->nir) :
+			si_tgsi_uses_subgroups(&sel->info)))
+		return sscreen->compute_wave_size;
+
+	unsigned threads =
+		sel->info.properties[TGSI_PROPERTY_CS_FIXED_BLOCK_WIDTH] *
+		sel->info.properties[TGSI_PROPERTY_CS_FIXED_BLOCK_HEIGHT] *
+		sel->info.properties[TGSI_PROPERTY_CS_FIXED_BLOCK_DEPTH];
+
+	/* At least a quarter of the lanes of the last wave64 would be idle. */
+	if (threads && threads % 64 && threads % 64 <= 48)
+		return 32;
+
+	if (sel->nir && si_nir_divergent_branch_percentage(sel->nir) >= 25)
+		return 32;
+
+	return 64;
+}
+
 static void si_create_compute_state_async(void *job, int thread_index)
 {
 	struct si_compute *program = (struct si_compute *)job;
@@ -149,6 +280,21 @@ static void si_create_compute_state_async(void *job, int thread_index)
 
 	void *ir_binary = si_get_ir_binary(sel, false, false);
 
+	if (sscreen->info.chip_class >= GFX10 && ir_binary) {
+		/* The hash skips the size and the flags that depend on the
+		 * wave size.
+		 */
+		sel->ir_hash = _mesa_hash_data((char*)ir_binary + 8,
+					       *(uint32_t*)ir_binary - 8);
+
+		unsigned wave_size = si_choose_compute_wave_size(sscreen, program);
+		if (wave_size != sel->wave_size) {
+			sel->wave_size = wave_size;
+			FREE(ir_binary);
+			ir_binary = si_get_ir_binary(sel, false, false);
+		}
+	}
+
 	/* Try to load the shader from the shader cache. */
 	mtx_lock(&sscreen->shader_cache_mutex);
 
@@ -180,7 +326,7 @@ static void si_create_compute_state_async(void *job, int thread_index)
 
 		shader->config.rsrc1 =
 			S_00B848_VGPRS((shader->config.num_vgprs - 1) /
-				       (sscreen->compute_wave_size == 32 ? 8 : 4)) |
+				       (sel->wave_size == 32 ? 8 : 4)) |
 			S_00B848_DX10_CLAMP(1) |
 			S_00B848_MEM_ORDERED(sscreen->info.chip_class >= GFX10) |
 			S_00B848_WGP_MODE(sscreen->info.chip_class >= GFX10) |
@@ -225,6 +371,7 @@ static void *si_create_compute_state(
 	pipe_reference_init(&sel->reference, 1);
 	sel->type = PIPE_SHADER_COMPUTE;
 	sel->screen = sscreen;
+	sel->wave_size = sscreen->compute_wave_size;
 	program->shader.selector = &program->sel;
 	program->ir_type = cso->ir_type;
 	program->local_size = cso->req_local_mem;
@@ -767,12 +914,13 @@ static void si_emit_dispatch_packets(struct si_context *sctx,
                                      const struct pipe_grid_info *info)
 {
 	struct si_screen *sscreen = sctx->screen;
+	struct si_compute *program = sctx->cs_shader_state.program;
 	struct radeon_cmdbuf *cs = sctx->gfx_cs;
 	bool render_cond_bit = sctx->render_cond && !sctx->render_cond_force_off;
 	unsigned threads_per_threadgroup =
 		info->block[0] * info->block[1] * info->block[2];
 	unsigned waves_per_threadgroup =
-		DIV_ROUND_UP(threads_per_threadgroup, sscreen->compute_wave_size);
+		DIV_ROUND_UP(threads_per_threadgroup, program->sel.wave_size);
 	unsigned threadgroups_per_cu = 1;
 
 	if (sctx->chip_class >= GFX10 && waves_per_threadgroup == 1)
@@ -790,7 +938,7 @@ static void si_emit_dispatch_packets(struct si_context *sctx,
 		/* If the KMD allows it (there is a KMD hw register for it),
 		 * allow launching waves out-of-order. (same as Vulkan) */
 		S_00B800_ORDER_MODE(sctx->chip_class >= GFX7) |
-		S_00B800_CS_W32_EN(sscreen->compute_wave_size == 32);
+		S_00B800_CS_W32_EN(program->sel.wave_size == 32);
 
 	const uint *last_block = info->last_block;
 	bool partial_block_en = last_block[0] || last_block[1] || last_block[2];
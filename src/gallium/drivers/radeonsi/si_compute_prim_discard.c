@@ -151,6 +151,12 @@
  *   Set THREADGROUP_SIZE to 2 to exercise both intra-wave and inter-wave
  *   primitive orientation flips with small draw calls, which is what most tests use.
  *   You can also enable draw call splitting into draw calls with just 2 primitives.
+ *
+ * Culling feedback:
+ *   After each draw packet, the gfx IB copies its final vertex count into
+ *   a feedback buffer, which is read when the IB is idle. If the compute
+ *   shader doesn't cull enough primitives with a VS, draws with that VS skip
+ *   it for a while, and then it's measured again.
  */
 
 /* At least 256 is needed for the fastest wave launch rate from compute queues
@@ -187,6 +193,13 @@
 /* For emulating the rewind packet on CI. */
 #define FORCE_REWIND_EMULATION		0
 
+/* Culling feedback: how many vertices to measure before deciding, the minimum
+ * culled percentage, and how many vertices to draw without the compute shader
+ * if it doesn't cull enough. */
+#define PD_FEEDBACK_MIN_VERTS		(1024 * 1024)
+#define PD_FEEDBACK_MIN_CULLED_PERCENT	15
+#define PD_FEEDBACK_SKIP_VERTS		(64 * 1024 * 1024)
+
 void si_initialize_prim_discard_tunables(struct si_context *sctx)
 {
 	sctx->prim_discard_vertex_count_threshold = UINT_MAX; /* disable */
@@ -1081,6 +1094,8 @@ si_prepare_prim_discard_or_split_draw(struct si_context *sctx,
 	else
 		need_gfx_dw += num_subdraws * 8; /* use REWIND(2) + DRAW(6) */
 
+	need_gfx_dw += num_subdraws * 6; /* COPY_DATA for the culling feedback */
+
 	if (ring_full ||
 	    (VERTEX_COUNTER_GDS_MODE == 1 && sctx->compute_gds_offset + 8 > GDS_SIZE_UNORDERED) ||
 	    !sctx->ws->cs_check_space(gfx_cs, need_gfx_dw, false)) {
@@ -1104,6 +1119,124 @@ si_prepare_prim_discard_or_split_draw(struct si_context *sctx,
 	return SI_PRIM_DISCARD_ENABLED;
 }
 
+static void si_emit_prim_discard_feedback(struct si_context *sctx,
+					  unsigned num_verts, uint64_t count_va)
+{
+	struct si_pd_feedback *fb = &sctx->pd_feedback[sctx->pd_feedback_current];
+	struct radeon_cmdbuf *gfx_cs = sctx->gfx_cs;
+
+	if (fb->num_draws == SI_PD_FEEDBACK_MAX_DRAWS)
+		return;
+
+	if (!fb->buf) {
+		fb->buf = si_resource(pipe_buffer_create(sctx->b.screen, 0,
+							 PIPE_USAGE_STAGING,
+							 SI_PD_FEEDBACK_MAX_DRAWS * 4));
+		if (!fb->buf)
+			return;
+	}
+
+	radeon_add_to_buffer_list(sctx, gfx_cs, fb->buf, RADEON_USAGE_WRITE,
+				  RADEON_PRIO_QUERY);
+
+	/* The count has been written by the compute shader before the draw
+	 * packet was allowed to execute. */
+	uint64_t dst_va = fb->buf->gpu_address + fb->num_draws * 4;
+
+	radeon_emit(gfx_cs, PKT3(PKT3_COPY_DATA, 4, 0));
+	radeon_emit(gfx_cs, COPY_DATA_SRC_SEL(COPY_DATA_SRC_MEM) |
+			    COPY_DATA_DST_SEL(COPY_DATA_DST_MEM) |
+			    COPY_DATA_WR_CONFIRM);
+	radeon_emit(gfx_cs, count_va);
+	radeon_emit(gfx_cs, count_va >> 32);
+	radeon_emit(gfx_cs, dst_va);
+	radeon_emit(gfx_cs, dst_va >> 32);
+
+	si_shader_selector_reference(sctx, &fb->vs[fb->num_draws],
+				     sctx->vs_shader.cso);
+	fb->num_verts[fb->num_draws++] = num_verts;
+}
+
+static void si_reset_prim_discard_feedback(struct si_context *sctx,
+					   struct si_pd_feedback *fb,
+					   bool busy)
+{
+	for (unsigned i = 0; i < fb->num_draws; i++)
+		si_shader_selector_reference(sctx, &fb->vs[i], NULL);
+
+	fb->num_draws = 0;
+	sctx->ws->fence_reference(&fb->fence, NULL);
+
+	/* The GPU might still write into the buffer. */
+	if (busy)
+		si_resource_reference(&fb->buf, NULL);
+}
+
+static void si_read_prim_discard_feedback(struct si_context *sctx,
+					  struct si_pd_feedback *fb)
+{
+	uint32_t *map = sctx->ws->buffer_map(fb->buf->buf, NULL,
+					     PIPE_TRANSFER_READ |
+					     PIPE_TRANSFER_UNSYNCHRONIZED);
+
+	for (unsigned i = 0; map && i < fb->num_draws; i++) {
+		struct si_shader_selector *vs = fb->vs[i];
+
+		vs->pd_num_verts_in += fb->num_verts[i];
+		vs->pd_num_verts_out += MIN2(map[i], fb->num_verts[i]);
+
+		if (vs->pd_num_verts_in < PD_FEEDBACK_MIN_VERTS)
+			continue;
+
+		uint64_t num_culled = vs->pd_num_verts_in - vs->pd_num_verts_out;
+
+		if (num_culled * 100 <
+		    (uint64_t)vs->pd_num_verts_in * PD_FEEDBACK_MIN_CULLED_PERCENT) {
+			if (SI_PRIM_DISCARD_DEBUG)
+				printf("PD disabled for a while: %u%% culled\n",
+				       (unsigned)(num_culled * 100 / vs->pd_num_verts_in));
+			vs->pd_skip_verts = PD_FEEDBACK_SKIP_VERTS;
+		}
+		vs->pd_num_verts_in = 0;
+		vs->pd_num_verts_out = 0;
+	}
+
+	si_reset_prim_discard_feedback(sctx, fb, false);
+}
+
+/* Called after a gfx IB has been flushed. */
+void si_prim_discard_feedback_flush(struct si_context *sctx)
+{
+	struct si_pd_feedback *fb = &sctx->pd_feedback[sctx->pd_feedback_current];
+
+	/* Read the feedback of finished IBs. */
+	for (unsigned i = 0; i < SI_NUM_PD_FEEDBACK; i++) {
+		struct si_pd_feedback *pending = &sctx->pd_feedback[i];
+
+		if (pending->fence &&
+		    sctx->ws->fence_wait(sctx->ws, pending->fence, 0))
+			si_read_prim_discard_feedback(sctx, pending);
+	}
+
+	if (!fb->num_draws)
+		return;
+
+	sctx->ws->fence_reference(&fb->fence, sctx->last_gfx_fence);
+	sctx->pd_feedback_current = (sctx->pd_feedback_current + 1) %
+				    SI_NUM_PD_FEEDBACK;
+
+	/* Don't wait for the oldest IB, drop its feedback instead. */
+	fb = &sctx->pd_feedback[sctx->pd_feedback_current];
+	if (fb->fence)
+		si_reset_prim_discard_feedback(sctx, fb, true);
+}
+
+void si_prim_discard_feedback_fini(struct si_context *sctx)
+{
+	for (unsigned i = 0; i < SI_NUM_PD_FEEDBACK; i++)
+		si_reset_prim_discard_feedback(sctx, &sctx->pd_feedback[i], true);
+}
+
 void si_compute_signal_gfx(struct si_context *sctx)
 {
 	struct radeon_cmdbuf *cs = sctx->prim_discard_compute_cs;
@@ -1484,6 +1617,10 @@ void si_dispatch_prim_discard_cs_and_draw(struct si_context *sctx,
 		radeon_emit(gfx_cs, 0);
 		radeon_emit(gfx_cs, V_0287F0_DI_SRC_SEL_DMA);
 
+		si_emit_prim_discard_feedback(sctx, num_subdraw_prims * vertices_per_prim,
+					      count_va |
+					      (uint64_t)sctx->screen->info.address32_hi << 32);
+
 		/* Continue with the compute IB. */
 		if (start_prim == 0) {
 			uint32_t gds_prim_restart_continue_bit = 0;
@@ -28,7 +28,9 @@
  *
  * This file is responsible for managing such lists. It keeps a copy of all
  * descriptors in CPU memory and re-uploads a whole list if some slots have
- * been changed.
+ * been changed. Uploads that would be identical to the previous one are
+ * skipped, and new bindless descriptors are written in place (see
+ * si_create_bindless_descriptor).
  *
  * This code is also reponsible for updating shader pointers to those lists.
  *
@@ -125,6 +127,7 @@ static void si_init_descriptors(struct si_descriptors *desc,
 				unsigned num_elements)
 {
 	desc->list = CALLOC(num_elements, element_dw_size * 4);
+	desc->uploaded_list = CALLOC(num_elements, element_dw_size * 4);
 	desc->element_dw_size = element_dw_size;
 	desc->num_elements = num_elements;
 	desc->shader_userdata_offset = shader_userdata_rel_index * 4;
@@ -135,6 +138,7 @@ static void si_release_descriptors(struct si_descriptors *desc)
 {
 	si_resource_reference(&desc->buffer, NULL);
 	FREE(desc->list);
+	FREE(desc->uploaded_list);
 }
 
 static bool si_upload_descriptors(struct si_context *sctx,
@@ -165,6 +169,17 @@ static bool si_upload_descriptors(struct si_context *sctx,
 		return true;
 	}
 
+	/* Keep the previous upload if the slots are the same, e.g. when a
+	 * binding is changed and changed back before the next draw. The buffer
+	 * stays in the buffer list of new IBs.
+	 */
+	if (desc->uploaded_list && desc->buffer && desc->gpu_list &&
+	    desc->uploaded_first_slot == desc->first_active_slot &&
+	    desc->uploaded_num_slots == desc->num_active_slots &&
+	    !memcmp((char*)desc->uploaded_list + first_slot_offset,
+		    (char*)desc->list + first_slot_offset, upload_size))
+		return true;
+
 	uint32_t *ptr;
 	unsigned buffer_offset;
 	u_upload_alloc(sctx->b.const_uploader, first_slot_offset, upload_size,
@@ -179,6 +194,14 @@ static bool si_upload_descriptors(struct si_context *sctx,
 	util_memcpy_cpu_to_le32(ptr, (char*)desc->list + first_slot_offset,
 				upload_size);
 	desc->gpu_list = ptr - first_slot_offset / 4;
+	sctx->num_descriptor_upload_bytes += upload_size;
+
+	if (desc->uploaded_list) {
+		memcpy((char*)desc->uploaded_list + first_slot_offset,
+		       (char*)desc->list + first_slot_offset, upload_size);
+		desc->uploaded_first_slot = desc->first_active_slot;
+		desc->uploaded_num_slots = desc->num_active_slots;
+	}
 
 	radeon_add_to_buffer_list(sctx, sctx->gfx_cs, desc->buffer,
                             RADEON_USAGE_READ, RADEON_PRIO_DESCRIPTORS);
@@ -1139,6 +1162,7 @@ bool si_upload_vertex_buffer_descriptors(struct si_context *sctx)
 	}
 
 	sctx->vb_descriptors_gpu_list = ptr;
+	sctx->num_descriptor_upload_bytes += desc_list_byte_size;
 	radeon_add_to_buffer_list(sctx, sctx->gfx_cs,
 				  sctx->vb_descriptors_buffer, RADEON_USAGE_READ,
 				  RADEON_PRIO_DESCRIPTORS);
@@ -1909,6 +1933,7 @@ static void si_upload_bindless_descriptor(struct si_context *sctx,
 
 	si_cp_write_data(sctx, desc->buffer, va - desc->buffer->gpu_address,
 			 num_dwords * 4, V_370_TC_L2, V_370_ME, data);
+	sctx->num_descriptor_upload_bytes += num_dwords * 4;
 }
 
 static void si_upload_bindless_descriptors(struct si_context *sctx)
@@ -2326,6 +2351,10 @@ static void si_init_bindless_descriptors(struct si_context *sctx,
 	si_init_descriptors(desc, shader_userdata_rel_index, 16, num_elements);
 	sctx->bindless_descriptors.num_active_slots = num_elements;
 
+	/* The list is resized and updated in place. */
+	FREE(desc->uploaded_list);
+	desc->uploaded_list = NULL;
+
 	/* The first bindless descriptor is stored at slot 1, because 0 is not
 	 * considered to be a valid handle.
 	 */
@@ -2372,10 +2401,15 @@ si_create_bindless_descriptor(struct si_context *sctx, uint32_t *desc_list,
 			      unsigned size)
 {
 	struct si_descriptors *desc = &sctx->bindless_descriptors;
+	unsigned num_elements = desc->num_elements;
 	unsigned desc_slot, desc_slot_offset;
+	bool new_slot;
 
 	/* Find a free slot. */
 	desc_slot = si_get_first_free_bindless_slot(sctx);
+	new_slot = desc_slot >= sctx->num_bindless_descriptors;
+	sctx->num_bindless_descriptors = MAX2(sctx->num_bindless_descriptors,
+					      desc_slot + 1);
 
 	/* For simplicity, sampler and image bindless descriptors use fixed
 	 * 16-dword slots for now. Image descriptors only need 8-dword but this
@@ -2386,6 +2420,20 @@ si_create_bindless_descriptor(struct si_context *sctx, uint32_t *desc_list,
 	/* Copy the descriptor into the array. */
 	memcpy(desc->list + desc_slot_offset, desc_list, size);
 
+	/* Slots that have never been used can't be read by the GPU, so they
+	 * are written in place unless the array has been resized. Reused slots
+	 * might still be read by previous draws.
+	 */
+	if (new_slot && desc->buffer && desc->num_elements == num_elements) {
+		si_need_gfx_cs_space(sctx);
+		si_upload_bindless_descriptor(sctx, desc_slot, size / 4);
+
+		/* The scalar cache might have the slot from a neighbouring
+		 * descriptor's cache line. */
+		sctx->flags |= SI_CONTEXT_INV_SCACHE;
+		return desc_slot;
+	}
+
 	/* Re-upload the whole array of bindless descriptors into a new buffer.
 	 */
 	if (!si_upload_descriptors(sctx, desc))
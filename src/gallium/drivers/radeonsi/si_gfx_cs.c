@@ -132,8 +132,20 @@ void si_flush_gfx_cs(struct si_context *ctx, unsigned flags,
 	si_unref_sdma_uploads(ctx);
 
 	/* Flush SDMA (preamble IB). */
-	if (radeon_emitted(ctx->dma_cs, 0))
+	if (ctx->sdma_staging_uploads) {
+		struct pipe_fence_handle *sdma_fence = NULL;
+
+		/* The stream uploader recycles staging buffers when the gfx
+		 * fence signals, so the gfx IB must not finish before the SDMA
+		 * copies reading them.
+		 */
+		si_flush_dma_cs(ctx, flags, &sdma_fence);
+		ws->cs_add_fence_dependency(cs, sdma_fence, 0);
+		ws->fence_reference(&sdma_fence, NULL);
+		ctx->sdma_staging_uploads = false;
+	} else if (radeon_emitted(ctx->dma_cs, 0)) {
 		si_flush_dma_cs(ctx, flags, NULL);
+	}
 
 	if (radeon_emitted(ctx->prim_discard_compute_cs, 0)) {
 		struct radeon_cmdbuf *compute_cs = ctx->prim_discard_compute_cs;
@@ -157,6 +169,10 @@ void si_flush_gfx_cs(struct si_context *ctx, unsigned flags,
 		if (!LIST_IS_EMPTY(&ctx->active_queries))
 			si_suspend_queries(ctx);
 
+		/* Split the traced render pass at the end of the IB. */
+		if (ctx->trace_render_pass && ctx->trace.depth == 1)
+			u_trace_end(&ctx->trace);
+
 		ctx->streamout.suspended = false;
 		if (ctx->streamout.begin_emitted) {
 			si_emit_streamout_end(ctx);
@@ -225,6 +241,12 @@ void si_flush_gfx_cs(struct si_context *ctx, unsigned flags,
 	if (fence)
 		ws->fence_reference(fence, ctx->last_gfx_fence);
 
+	u_upload_fence(ctx->b.stream_uploader, ctx->last_gfx_fence);
+	u_trace_flush(&ctx->trace);
+
+	if (si_compute_prim_discard_enabled(ctx))
+		si_prim_discard_feedback_flush(ctx);
+
 	ctx->num_gfx_cs_flushes++;
 
 	if (si_compute_prim_discard_enabled(ctx)) {
@@ -322,6 +344,9 @@ void si_begin_new_gfx_cs(struct si_context *ctx)
 
 	si_add_gds_to_buffer_list(ctx);
 
+	if (ctx->trace_render_pass && !ctx->trace.depth)
+		u_trace_begin(&ctx->trace, "render_pass", "render_pass");
+
 	/* Always invalidate caches at the beginning of IBs, because external
 	 * users (e.g. BO evictions and SDMA/UVD/VCE IBs) can modify our
 	 * buffers.
@@ -0,0 +1,234 @@
+/*
+ * Copyright 2019 Advanced Micro Devices, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * on the rights to use, copy, modify, merge, publish, distribute, sub
+ * license, and/or sell copies of the Software, and to permit persons to whom
+ * the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHOR(S) AND/OR THEIR SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* GPU timestamp tracepoints (GALLIUM_GPU_TRACE).
+ *
+ * Render passes are traced from one non-blitter framebuffer change to the
+ * next, and they are split at IB boundaries. The pipe_context functions
+ * that do blits, clears and dispatches are wrapped only when tracing is
+ * enabled, so that they cost nothing otherwise.
+ */
+
+#include "si_pipe.h"
+#include "sid.h"
+
+static void *si_gpu_trace_create_ts_buffer(struct u_trace_context *utctx,
+					   unsigned num_timestamps)
+{
+	struct si_context *sctx = utctx->pctx;
+
+	return si_resource(pipe_buffer_create(sctx->b.screen, 0,
+					      PIPE_USAGE_STAGING,
+					      num_timestamps * 8));
+}
+
+static void si_gpu_trace_delete_ts_buffer(struct u_trace_context *utctx,
+					  void *timestamps)
+{
+	struct si_resource *buf = timestamps;
+
+	si_resource_reference(&buf, NULL);
+}
+
+static void si_gpu_trace_record_ts(struct u_trace *ut, void *timestamps,
+				   unsigned idx)
+{
+	struct si_context *sctx = ut->utctx->pctx;
+	struct si_resource *buf = timestamps;
+
+	si_cp_release_mem(sctx, sctx->gfx_cs, V_028A90_BOTTOM_OF_PIPE_TS, 0,
+			  EOP_DST_SEL_MEM, EOP_INT_SEL_NONE,
+			  EOP_DATA_SEL_TIMESTAMP, buf, buf->gpu_address + idx * 8,
+			  0, PIPE_QUERY_TIMESTAMP);
+}
+
+static uint64_t si_gpu_trace_read_ts(struct u_trace_context *utctx,
+				     void *timestamps, unsigned idx)
+{
+	struct si_context *sctx = utctx->pctx;
+	struct si_resource *buf = timestamps;
+	uint64_t freq = sctx->screen->info.clock_crystal_freq; /* kHz */
+	uint64_t *map, ticks;
+
+	/* This waits for the IB that wrote the timestamps. */
+	map = sctx->ws->buffer_map(buf->buf, NULL, PIPE_TRANSFER_READ);
+	if (!map)
+		return 0;
+
+	ticks = map[idx];
+	return ticks / freq * 1000000 + ticks % freq * 1000000 / freq;
+}
+
+static void si_gpu_trace_blit(struct pipe_context *ctx,
+			      const struct pipe_blit_info *info)
+{
+	struct si_context *sctx = (struct si_context *)ctx;
+
+	u_trace_begin(&sctx->trace, "blit", "blit");
+	sctx->traced.blit(ctx, info);
+	u_trace_end(&sctx->trace);
+}
+
+static void si_gpu_trace_resource_copy_region(struct pipe_context *ctx,
+					      struct pipe_resource *dst,
+					      unsigned dst_level,
+					      unsigned dstx, unsigned dsty,
+					      unsigned dstz,
+					      struct pipe_resource *src,
+					      unsigned src_level,
+					      const struct pipe_box *src_box)
+{
+	struct si_context *sctx = (struct si_context *)ctx;
+
+	u_trace_begin(&sctx->trace, "resource_copy_region", "blit");
+	sctx->traced.resource_copy_region(ctx, dst, dst_level, dstx, dsty, dstz,
+					  src, src_level, src_box);
+	u_trace_end(&sctx->trace);
+}
+
+static void si_gpu_trace_clear(struct pipe_context *ctx, unsigned buffers,
+			       const union pipe_color_union *color,
+			       double depth, unsigned stencil)
+{
+	struct si_context *sctx = (struct si_context *)ctx;
+
+	u_trace_begin(&sctx->trace, "clear", "clear");
+	sctx->traced.clear(ctx, buffers, color, depth, stencil);
+	u_trace_end(&sctx->trace);
+}
+
+static void si_gpu_trace_clear_render_target(struct pipe_context *ctx,
+					     struct pipe_surface *dst,
+					     const union pipe_color_union *color,
+					     unsigned dstx, unsigned dsty,
+					     unsigned width, unsigned height,
+					     bool render_condition_enabled)
+{
+	struct si_context *sctx = (struct si_context *)ctx;
+
+	u_trace_begin(&sctx->trace, "clear_render_target", "clear");
+	sctx->traced.clear_render_target(ctx, dst, color, dstx, dsty,
+					 width, height,
+					 render_condition_enabled);
+	u_trace_end(&sctx->trace);
+}
+
+static void si_gpu_trace_clear_depth_stencil(struct pipe_context *ctx,
+					     struct pipe_surface *dst,
+					     unsigned clear_flags,
+					     double depth, unsigned stencil,
+					     unsigned dstx, unsigned dsty,
+					     unsigned width, unsigned height,
+					     bool render_condition_enabled)
+{
+	struct si_context *sctx = (struct si_context *)ctx;
+
+	u_trace_begin(&sctx->trace, "clear_depth_stencil", "clear");
+	sctx->traced.clear_depth_stencil(ctx, dst, clear_flags, depth, stencil,
+					 dstx, dsty, width, height,
+					 render_condition_enabled);
+	u_trace_end(&sctx->trace);
+}
+
+static void si_gpu_trace_clear_buffer(struct pipe_context *ctx,
+				      struct pipe_resource *dst,
+				      unsigned offset, unsigned size,
+				      const void *clear_value,
+				      int clear_value_size)
+{
+	struct si_context *sctx = (struct si_context *)ctx;
+
+	u_trace_begin(&sctx->trace, "clear_buffer", "clear");
+	sctx->traced.clear_buffer(ctx, dst, offset, size, clear_value,
+				  clear_value_size);
+	u_trace_end(&sctx->trace);
+}
+
+static void si_gpu_trace_launch_grid(struct pipe_context *ctx,
+				     const struct pipe_grid_info *info)
+{
+	struct si_context *sctx = (struct si_context *)ctx;
+
+	u_trace_begin(&sctx->trace, "launch_grid", "compute");
+	sctx->traced.launch_grid(ctx, info);
+	u_trace_end(&sctx->trace);
+}
+
+#define SI_GPU_TRACE_WRAP(func) do { \
+	if (sctx->b.func) { \
+		sctx->traced.func = sctx->b.func; \
+		sctx->b.func = si_gpu_trace_##func; \
+	} \
+} while (0)
+
+/* Must be called after all context functions have been set. */
+void si_init_gpu_trace(struct si_context *sctx)
+{
+	u_trace_context_init(&sctx->trace_context, sctx, "radeonsi",
+			     si_gpu_trace_create_ts_buffer,
+			     si_gpu_trace_delete_ts_buffer,
+			     si_gpu_trace_record_ts,
+			     si_gpu_trace_read_ts);
+	u_trace_init(&sctx->trace, &sctx->trace_context);
+
+	if (!u_trace_is_enabled(&sctx->trace))
+		return;
+
+	SI_GPU_TRACE_WRAP(blit);
+	SI_GPU_TRACE_WRAP(resource_copy_region);
+	SI_GPU_TRACE_WRAP(clear);
+	SI_GPU_TRACE_WRAP(clear_render_target);
+	SI_GPU_TRACE_WRAP(clear_depth_stencil);
+	SI_GPU_TRACE_WRAP(clear_buffer);
+	SI_GPU_TRACE_WRAP(launch_grid);
+}
+
+void si_destroy_gpu_trace(struct si_context *sctx)
+{
+	/* Submit the remaining tracepoints. */
+	if (u_trace_is_enabled(&sctx->trace) &&
+	    !LIST_IS_EMPTY(&sctx->trace.chunks))
+		si_flush_gfx_cs(sctx, 0, NULL);
+
+	u_trace_fini(&sctx->trace);
+	u_trace_context_fini(&sctx->trace_context);
+}
+
+void si_gpu_trace_framebuffer_changed(struct si_context *sctx)
+{
+	const struct pipe_framebuffer_state *fb = &sctx->framebuffer.state;
+
+	if (sctx->blitter->running)
+		return;
+
+	if (sctx->trace_render_pass) {
+		u_trace_end(&sctx->trace);
+		sctx->trace_render_pass = false;
+	}
+
+	if (fb->nr_cbufs || fb->zsbuf) {
+		u_trace_begin(&sctx->trace, "render_pass", "render_pass");
+		sctx->trace_render_pass = true;
+	}
+}
@@ -69,6 +69,7 @@ static const struct debug_named_value debug_options[] = {
 	{ "w64ge", DBG(W64_GE), "Use Wave64 for vertex, tessellation, and geometry shaders." },
 	{ "w64ps", DBG(W64_PS), "Use Wave64 for pixel shaders." },
 	{ "w64cs", DBG(W64_CS), "Use Wave64 for computes shaders." },
+	{ "wautocs", DBG(W_AUTO_CS), "Choose the wave size of each compute shader based on its thread group size and divergence." },
 
 	/* Shader compiler options (with no effect on the shader cache): */
 	{ "checkir", DBG(CHECK_IR), "Enable additional sanity checks on shader IR" },
@@ -88,10 +89,12 @@ static const struct debug_named_value debug_options[] = {
 	{ "check_vm", DBG(CHECK_VM), "Check VM faults and dump debug info." },
 	{ "reserve_vmid", DBG(RESERVE_VMID), "Force VMID reservation per context." },
 	{ "zerovram", DBG(ZERO_VRAM), "Clear VRAM allocations." },
+	{ "slabstats", DBG(SLAB_STATS), "Print slab allocator statistics at exit (amdgpu only)." },
 
 	/* 3D engine options: */
 	{ "nogfx", DBG(NO_GFX), "Disable graphics. Only multimedia compute paths can be used." },
 	{ "nongg", DBG(NO_NGG), "Disable NGG and use the legacy pipeline." },
+	{ "nonggc", DBG(NO_NGG_CULLING), "Disable NGG primitive culling." },
 	{ "alwayspd", DBG(ALWAYS_PD), "Always enable the primitive discard compute shader." },
 	{ "pd", DBG(PD), "Enable the primitive discard compute shader for large draw calls." },
 	{ "nopd", DBG(NO_PD), "Disable the primitive discard compute shader." },
@@ -101,6 +104,7 @@ static const struct debug_named_value debug_options[] = {
 	{ "nodfsm", DBG(NO_DFSM), "Disable DFSM." },
 	{ "dpbb", DBG(DPBB), "Enable DPBB." },
 	{ "dfsm", DBG(DFSM), "Enable DFSM." },
+	{ "dpbbtune", DBG(DPBB_TUNE), "Enable DPBB and tune its parameters per framebuffer." },
 	{ "nohyperz", DBG(NO_HYPERZ), "Disable Hyper-Z" },
 	{ "norbplus", DBG(NO_RB_PLUS), "Disable RB+." },
 	{ "no2d", DBG(NO_2D_TILING), "Disable 2D tiling" },
@@ -124,8 +128,8 @@ static const struct debug_named_value debug_options[] = {
 	DEBUG_NAMED_VALUE_END /* must be last */
 };
 
-static void si_init_compiler(struct si_screen *sscreen,
-			     struct ac_llvm_compiler *compiler)
+void si_init_compiler(struct si_screen *sscreen,
+		      struct ac_llvm_compiler *compiler)
 {
 	/* Only create the less-optimizing version of the compiler on APUs
 	 * predating Ryzen (Raven). */
@@ -154,6 +158,7 @@ static void si_init_compiler(struct si_screen *sscreen,
 static void si_destroy_compiler(struct ac_llvm_compiler *compiler)
 {
 	ac_destroy_llvm_compiler(compiler);
+	memset(compiler, 0, sizeof(*compiler));
 }
 
 /*
@@ -174,6 +179,10 @@ static void si_destroy_context(struct pipe_context *context)
 	if (context->set_framebuffer_state)
 		context->set_framebuffer_state(context, &fb);
 
+	si_dpbb_tune_destroy(sctx);
+	si_destroy_gpu_trace(sctx);
+	si_prim_discard_feedback_fini(sctx);
+
 	si_release_all_descriptors(sctx);
 
 	if (sctx->chip_class >= GFX10 && sctx->has_graphics)
@@ -300,6 +309,23 @@ static void si_destroy_context(struct pipe_context *context)
 	FREE(sctx);
 }
 
+static void si_upload_fence_reference(void *data,
+				      struct pipe_fence_handle **dst,
+				      struct pipe_fence_handle *src)
+{
+	struct radeon_winsys *ws = data;
+
+	ws->fence_reference(dst, src);
+}
+
+static bool si_upload_fence_wait(void *data, struct pipe_fence_handle *fence,
+				 uint64_t timeout)
+{
+	struct radeon_winsys *ws = data;
+
+	return ws->fence_wait(ws, fence, timeout);
+}
+
 static enum pipe_reset_status si_get_reset_status(struct pipe_context *ctx)
 {
 	struct si_context *sctx = (struct si_context *)ctx;
@@ -454,6 +480,14 @@ static struct pipe_context *si_create_context(struct pipe_screen *screen,
 	if (!sctx->b.stream_uploader)
 		goto fail;
 
+	/* Recycle stream upload buffers. si_flush_gfx_cs fences them. */
+	struct u_upload_fence_funcs upload_fence_funcs = {
+		.reference = si_upload_fence_reference,
+		.wait = si_upload_fence_wait,
+		.data = sctx->ws,
+	};
+	u_upload_enable_ring(sctx->b.stream_uploader, 8, &upload_fence_funcs);
+
 	sctx->cached_gtt_allocator = u_upload_create(&sctx->b, 16 * 1024,
 						       0, PIPE_USAGE_STAGING, 0);
 	if (!sctx->cached_gtt_allocator)
@@ -559,6 +593,10 @@ static struct pipe_context *si_create_context(struct pipe_screen *screen,
 
 		si_init_draw_functions(sctx);
 		si_initialize_prim_discard_tunables(sctx);
+
+		if (sscreen->dpbb_allowed && sctx->chip_class >= GFX9 &&
+		    sscreen->debug_flags & DBG(DPBB_TUNE))
+			sctx->dpbb_tune.table = _mesa_hash_table_u64_create(NULL);
 	}
 
 	/* Initialize SDMA functions. */
@@ -618,6 +656,8 @@ static struct pipe_context *si_create_context(struct pipe_screen *screen,
 				 &sctx->null_const_buf);
 		si_set_rw_buffer(sctx, SI_VS_CONST_CLIP_PLANES,
 				 &sctx->null_const_buf);
+		si_set_rw_buffer(sctx, SI_VS_CONST_NGG_CULLING,
+				 &sctx->null_const_buf);
 		si_set_rw_buffer(sctx, SI_PS_CONST_POLY_STIPPLE,
 				 &sctx->null_const_buf);
 		si_set_rw_buffer(sctx, SI_PS_CONST_SAMPLE_POSITIONS,
@@ -644,8 +684,6 @@ static struct pipe_context *si_create_context(struct pipe_screen *screen,
 	sctx->scratch_waves = MAX2(32 * sscreen->info.num_good_compute_units,
 				   max_threads_per_block / 64);
 
-	si_init_compiler(sscreen, &sctx->compiler);
-
 	/* Bindless handles. */
 	sctx->tex_handles = _mesa_hash_table_create(NULL, _mesa_hash_pointer,
 						    _mesa_key_pointer_equal);
@@ -664,6 +702,8 @@ static struct pipe_context *si_create_context(struct pipe_screen *screen,
 	pipe_buffer_write(&sctx->b, sctx->sample_pos_buffer, 0,
 			  sizeof(sctx->sample_positions), &sctx->sample_positions);
 
+	si_init_gpu_trace(sctx);
+
 	/* this must be last */
 	si_begin_new_gfx_cs(sctx);
 
@@ -746,6 +786,7 @@ static void si_destroy_screen(struct pipe_screen* pscreen)
 
 	util_queue_destroy(&sscreen->shader_compiler_queue);
 	util_queue_destroy(&sscreen->shader_compiler_queue_low_priority);
+	util_dynarray_fini(&sscreen->cs_wave_size_table);
 
 	/* Release the reference on glsl types of the compiler threads. */
 	glsl_type_singleton_decref();
@@ -891,6 +932,33 @@ static void si_disk_cache_create(struct si_screen *sscreen)
 				  shader_debug_flags);
 }
 
+/* Read the compute wave sizes forced per shader. Each line of the file is
+ * "<IR hash> <32|64>", where the hash is the one printed in shader dumps.
+ */
+static void si_init_cs_wave_size_table(struct si_screen *sscreen)
+{
+	const char *path = debug_get_option("AMD_CS_WAVE_SIZE_TABLE", NULL);
+	struct si_wave_size_override entry;
+	FILE *f;
+
+	if (!path)
+		return;
+
+	f = fopen(path, "r");
+	if (!f) {
+		fprintf(stderr, "radeonsi: can't open %s\n", path);
+		return;
+	}
+
+	while (fscanf(f, "%x %u", &entry.ir_hash, &entry.wave_size) == 2) {
+		if (entry.wave_size == 32 || entry.wave_size == 64) {
+			util_dynarray_append(&sscreen->cs_wave_size_table,
+					     struct si_wave_size_override, entry);
+		}
+	}
+	fclose(f);
+}
+
 static void si_set_max_shader_compiler_threads(struct pipe_screen *screen,
 					       unsigned max_threads)
 {
@@ -901,6 +969,23 @@ static void si_set_max_shader_compiler_threads(struct pipe_screen *screen,
 	util_queue_adjust_num_threads(&sscreen->shader_compiler_queue,
 				      max_threads);
 	/* Don't change the number of threads on the low priority queue. */
+
+	/* Release the compilers of the threads that are no longer used.
+	 * Threads of the shared pool don't go away, so wait for the jobs
+	 * that might still be running with them.
+	 */
+	unsigned num_threads = sscreen->shader_compiler_queue.num_threads;
+	bool release = false;
+
+	for (unsigned i = num_threads; i < ARRAY_SIZE(sscreen->compiler); i++)
+		release |= sscreen->compiler[i].passes != NULL;
+
+	if (release) {
+		util_queue_finish(&sscreen->shader_compiler_queue);
+
+		for (unsigned i = num_threads; i < ARRAY_SIZE(sscreen->compiler); i++)
+			si_destroy_compiler(&sscreen->compiler[i]);
+	}
 }
 
 static bool si_is_parallel_shader_compilation_finished(struct pipe_screen *screen,
@@ -917,7 +1002,7 @@ radeonsi_screen_create_impl(struct radeon_winsys *ws,
 			    const struct pipe_screen_config *config)
 {
 	struct si_screen *sscreen = CALLOC_STRUCT(si_screen);
-	unsigned hw_threads, num_comp_hi_threads, num_comp_lo_threads, i;
+	unsigned hw_threads, num_comp_hi_threads, num_comp_lo_threads;
 
 	if (!sscreen) {
 		return NULL;
@@ -1029,7 +1114,9 @@ radeonsi_screen_create_impl(struct radeon_winsys *ws,
 	if (!util_queue_init(&sscreen->shader_compiler_queue, "sh",
 			     64, num_comp_hi_threads,
 			     UTIL_QUEUE_INIT_RESIZE_IF_FULL |
-			     UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY)) {
+			     UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY |
+			     UTIL_QUEUE_INIT_SHARED_POOL |
+			     UTIL_QUEUE_INIT_HIGH_PRIORITY)) {
 		si_destroy_shader_cache(sscreen);
 		FREE(sscreen);
 		glsl_type_singleton_decref();
@@ -1041,7 +1128,8 @@ radeonsi_screen_create_impl(struct radeon_winsys *ws,
 			     64, num_comp_lo_threads,
 			     UTIL_QUEUE_INIT_RESIZE_IF_FULL |
 			     UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY |
-			     UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY)) {
+			     UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY |
+			     UTIL_QUEUE_INIT_SHARED_POOL)) {
 	       si_destroy_shader_cache(sscreen);
 	       FREE(sscreen);
 	       glsl_type_singleton_decref();
@@ -1129,6 +1217,8 @@ radeonsi_screen_create_impl(struct radeon_winsys *ws,
 	sscreen->use_ngg = sscreen->info.chip_class >= GFX10 &&
 			   sscreen->info.family != CHIP_NAVI14 &&
 			   !(sscreen->debug_flags & DBG(NO_NGG));
+	sscreen->use_ngg_culling = sscreen->use_ngg &&
+				   !(sscreen->debug_flags & DBG(NO_NGG_CULLING));
 	sscreen->use_ngg_streamout = false;
 
 	/* Only enable primitive binning on APUs by default. */
@@ -1141,7 +1231,7 @@ radeonsi_screen_create_impl(struct radeon_winsys *ws,
 	}
 
 	/* Process DPBB enable flags. */
-	if (sscreen->debug_flags & DBG(DPBB)) {
+	if (sscreen->debug_flags & (DBG(DPBB) | DBG(DPBB_TUNE))) {
 		sscreen->dpbb_allowed = true;
 		if (sscreen->debug_flags & DBG(DFSM))
 			sscreen->dfsm_allowed = true;
@@ -1202,11 +1292,6 @@ radeonsi_screen_create_impl(struct radeon_winsys *ws,
 		}
 	}
 
-	for (i = 0; i < num_comp_hi_threads; i++)
-		si_init_compiler(sscreen, &sscreen->compiler[i]);
-	for (i = 0; i < num_comp_lo_threads; i++)
-		si_init_compiler(sscreen, &sscreen->compiler_lowp[i]);
-
 	sscreen->ge_wave_size = 64;
 	sscreen->ps_wave_size = 64;
 	sscreen->compute_wave_size = 64;
@@ -1230,6 +1315,8 @@ radeonsi_screen_create_impl(struct radeon_winsys *ws,
 			sscreen->ps_wave_size = 64;
 		if (sscreen->debug_flags & DBG(W64_CS))
 			sscreen->compute_wave_size = 64;
+
+		si_init_cs_wave_size_table(sscreen);
 	}
 
 	/* Create the auxiliary context. This must be done last. */
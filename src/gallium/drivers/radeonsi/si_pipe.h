@@ -31,6 +31,7 @@
 #include "util/u_dynarray.h"
 #include "util/u_idalloc.h"
 #include "util/u_threaded_context.h"
+#include "util/u_trace.h"
 
 #ifdef PIPE_ARCH_BIG_ENDIAN
 #define SI_BIG_ENDIAN 1
@@ -106,6 +107,9 @@
 #define SI_MAP_BUFFER_ALIGNMENT		64
 #define SI_MAX_VARIABLE_THREADS_PER_BLOCK 1024
 
+#define SI_NUM_PD_FEEDBACK	4
+#define SI_PD_FEEDBACK_MAX_DRAWS 256
+
 #define SI_RESOURCE_FLAG_TRANSFER	(PIPE_RESOURCE_FLAG_DRV_PRIV << 0)
 #define SI_RESOURCE_FLAG_FLUSHED_DEPTH	(PIPE_RESOURCE_FLAG_DRV_PRIV << 1)
 #define SI_RESOURCE_FLAG_FORCE_MSAA_TILING (PIPE_RESOURCE_FLAG_DRV_PRIV << 2)
@@ -153,6 +157,7 @@ enum {
 	DBG_W64_GE,
 	DBG_W64_PS,
 	DBG_W64_CS,
+	DBG_W_AUTO_CS,
 
 	/* Shader compiler options (with no effect on the shader cache): */
 	DBG_CHECK_IR,
@@ -172,10 +177,12 @@ enum {
 	DBG_CHECK_VM,
 	DBG_RESERVE_VMID,
 	DBG_ZERO_VRAM,
+	DBG_SLAB_STATS,
 
 	/* 3D engine options: */
 	DBG_NO_GFX,
 	DBG_NO_NGG,
+	DBG_NO_NGG_CULLING,
 	DBG_ALWAYS_PD,
 	DBG_PD,
 	DBG_NO_PD,
@@ -185,6 +192,7 @@ enum {
 	DBG_NO_DFSM,
 	DBG_DPBB,
 	DBG_DFSM,
+	DBG_DPBB_TUNE,
 	DBG_NO_HYPERZ,
 	DBG_NO_RB_PLUS,
 	DBG_NO_2D_TILING,
@@ -452,6 +460,12 @@ struct radeon_saved_cs {
 	unsigned			bo_count;
 };
 
+/* An entry of AMD_CS_WAVE_SIZE_TABLE. */
+struct si_wave_size_override {
+	uint32_t			ir_hash;
+	unsigned			wave_size;
+};
+
 struct si_screen {
 	struct pipe_screen		b;
 	struct radeon_winsys		*ws;
@@ -493,6 +507,7 @@ struct si_screen {
 	bool				dfsm_allowed;
 	bool				llvm_has_working_vgpr_indexing;
 	bool				use_ngg;
+	bool				use_ngg_culling;
 	bool				use_ngg_streamout;
 
 	struct {
@@ -589,6 +604,7 @@ struct si_screen {
 	/* Use at most 3 normal compiler threads on quadcore and better.
 	 * Hyperthreaded CPUs report the number of threads, but we want
 	 * the number of cores. We only need this many threads for shader-db. */
+	/* Compilers are created on first use, see si_shader_create. */
 	struct ac_llvm_compiler		compiler[24]; /* used by the queue only */
 
 	struct util_queue		shader_compiler_queue_low_priority;
@@ -597,6 +613,7 @@ struct si_screen {
 	struct ac_llvm_compiler		compiler_lowp[10];
 
 	unsigned			compute_wave_size;
+	struct util_dynarray		cs_wave_size_table; /* si_wave_size_override */
 	unsigned			ps_wave_size;
 	unsigned			ge_wave_size;
 };
@@ -824,6 +841,37 @@ struct si_image_handle
 	struct pipe_image_view		view;
 };
 
+/* Final vertex counts of the draw packets generated by the primitive discard
+ * compute shader in one gfx IB.
+ */
+struct si_pd_feedback {
+	struct si_resource		*buf; /* 1 dword per draw packet */
+	struct pipe_fence_handle	*fence; /* NULL until the IB is flushed */
+	unsigned			num_draws;
+	struct si_shader_selector	*vs[SI_PD_FEEDBACK_MAX_DRAWS];
+	unsigned			num_verts[SI_PD_FEEDBACK_MAX_DRAWS];
+};
+
+#define SI_DPBB_TUNE_MAX_PENDING	8
+
+/* A GPU time measurement of one binning configuration. */
+struct si_dpbb_tune_sample {
+	struct pipe_query		*query; /* PIPE_QUERY_TIME_ELAPSED */
+	struct si_dpbb_tune_entry	*entry;
+	unsigned			config;
+	unsigned			gfx_ib_index; /* num_gfx_cs_flushes at the end */
+};
+
+/* Online tuning of the binning parameters (DBG_DPBB_TUNE). */
+struct si_dpbb_tune {
+	struct hash_table_u64		*table; /* framebuffer -> si_dpbb_tune_entry */
+	unsigned			config; /* used by si_emit_dpbb_state */
+	struct si_dpbb_tune_sample	active;
+	unsigned			active_num_draw_calls;
+	struct si_dpbb_tune_sample	pending[SI_DPBB_TUNE_MAX_PENDING];
+	unsigned			num_pending;
+};
+
 struct si_saved_cs {
 	struct pipe_reference	reference;
 	struct si_context	*ctx;
@@ -867,6 +915,47 @@ struct si_context {
 	struct pipe_device_reset_callback device_reset_callback;
 	struct u_log_context		*log;
 	void				*query_result_shader;
+
+	/* GPU timestamp tracepoints. "traced" has the functions that tracing
+	 * wraps. */
+	struct u_trace_context		trace_context;
+	struct u_trace			trace;
+	bool				trace_render_pass;
+	struct {
+		void (*blit)(struct pipe_context *ctx,
+			     const struct pipe_blit_info *info);
+		void (*resource_copy_region)(struct pipe_context *ctx,
+					     struct pipe_resource *dst,
+					     unsigned dst_level,
+					     unsigned dstx, unsigned dsty,
+					     unsigned dstz,
+					     struct pipe_resource *src,
+					     unsigned src_level,
+					     const struct pipe_box *src_box);
+		void (*clear)(struct pipe_context *ctx, unsigned buffers,
+			      const union pipe_color_union *color,
+			      double depth, unsigned stencil);
+		void (*clear_render_target)(struct pipe_context *ctx,
+					    struct pipe_surface *dst,
+					    const union pipe_color_union *color,
+					    unsigned dstx, unsigned dsty,
+					    unsigned width, unsigned height,
+					    bool render_condition_enabled);
+		void (*clear_depth_stencil)(struct pipe_context *ctx,
+					    struct pipe_surface *dst,
+					    unsigned clear_flags,
+					    double depth, unsigned stencil,
+					    unsigned dstx, unsigned dsty,
+					    unsigned width, unsigned height,
+					    bool render_condition_enabled);
+		void (*clear_buffer)(struct pipe_context *ctx,
+				     struct pipe_resource *dst,
+				     unsigned offset, unsigned size,
+				     const void *clear_value,
+				     int clear_value_size);
+		void (*launch_grid)(struct pipe_context *ctx,
+				    const struct pipe_grid_info *info);
+	} traced;
 	void				*sh_query_result_shader;
 
 	void (*emit_cache_flush)(struct si_context *ctx);
@@ -894,7 +983,7 @@ struct si_context {
 	void				*cs_dcc_retile;
 	struct si_screen		*screen;
 	struct pipe_debug_callback	debug;
-	struct ac_llvm_compiler		compiler; /* only non-threaded compilation */
+	struct ac_llvm_compiler		compiler; /* only non-threaded compilation, created on demand */
 	struct si_shader_ctx_state	fixed_func_tcs_shader;
 	/* Offset 0: EOP flush number; Offset 4: GDS prim restart counter */
 	struct si_resource		*wait_mem_scratch;
@@ -933,6 +1022,8 @@ struct si_context {
 	unsigned			index_ring_offset; /* offset within a per-IB portion */
 	unsigned			index_ring_size_per_ib; /* max available size per IB */
 	bool				prim_discard_compute_ib_initialized;
+	struct si_pd_feedback		pd_feedback[SI_NUM_PD_FEEDBACK];
+	unsigned			pd_feedback_current;
 	/* For tracking the last execution barrier - it can be either
 	 * a WRITE_DATA packet or a fence. */
 	uint32_t			*last_pkt3_write_data;
@@ -1096,6 +1187,7 @@ struct si_context {
 	bool need_check_render_feedback;
 	bool			decompression_enabled;
 	bool			dpbb_force_off;
+	struct si_dpbb_tune	dpbb_tune;
 	bool			vs_writes_viewport_index;
 	bool			vs_disables_clipping_viewport;
 
@@ -1106,7 +1198,7 @@ struct si_context {
 	/* Bindless descriptors. */
 	struct si_descriptors	bindless_descriptors;
 	struct util_idalloc	bindless_used_slots;
-	unsigned		num_bindless_descriptors;
+	unsigned		num_bindless_descriptors; /* highest used slot + 1 */
 	bool			bindless_descriptors_dirty;
 	bool			graphics_bindless_pointer_dirty;
 	bool			compute_bindless_pointer_dirty;
@@ -1159,6 +1251,7 @@ struct si_context {
 	unsigned			num_L2_writebacks;
 	unsigned			num_resident_handles;
 	uint64_t			num_alloc_tex_transfer_bytes;
+	uint64_t			num_descriptor_upload_bytes;
 	unsigned			last_tex_ps_draw_ratio; /* for query */
 	unsigned			compute_num_verts_accepted;
 	unsigned			compute_num_verts_rejected;
@@ -1184,6 +1277,8 @@ struct si_context {
 	struct si_sdma_upload		*sdma_uploads;
 	unsigned			num_sdma_uploads;
 	unsigned			max_sdma_uploads;
+	/* Staging buffer uploads were copied by SDMA since the last gfx flush. */
+	bool				sdma_staging_uploads;
 
 	/* Shader-based queries. */
 	struct list_head		shader_query_buffers;
@@ -1382,6 +1477,11 @@ struct pipe_fence_handle *si_create_fence(struct pipe_context *ctx,
 /* si_get.c */
 void si_init_screen_get_functions(struct si_screen *sscreen);
 
+/* si_gpu_trace.c */
+void si_init_gpu_trace(struct si_context *sctx);
+void si_destroy_gpu_trace(struct si_context *sctx);
+void si_gpu_trace_framebuffer_changed(struct si_context *sctx);
+
 /* si_gfx_cs.c */
 void si_flush_gfx_cs(struct si_context *ctx, unsigned flags,
 		     struct pipe_fence_handle **fence);
@@ -1420,6 +1520,8 @@ void si_dispatch_prim_discard_cs_and_draw(struct si_context *sctx,
 					  uint64_t input_indexbuf_va,
 					  unsigned input_indexbuf_max_elements);
 void si_initialize_prim_discard_tunables(struct si_context *sctx);
+void si_prim_discard_feedback_flush(struct si_context *sctx);
+void si_prim_discard_feedback_fini(struct si_context *sctx);
 
 /* si_perfcounters.c */
 void si_init_perfcounters(struct si_screen *screen);
@@ -1427,6 +1529,8 @@ void si_destroy_perfcounters(struct si_screen *screen);
 
 /* si_pipe.c */
 bool si_check_device_reset(struct si_context *sctx);
+void si_init_compiler(struct si_screen *sscreen,
+		      struct ac_llvm_compiler *compiler);
 
 /* si_query.c */
 void si_init_screen_query_functions(struct si_screen *sscreen);
@@ -1468,6 +1572,7 @@ struct pipe_video_buffer *si_video_buffer_create(struct pipe_context *pipe,
 
 /* si_viewport.c */
 void si_update_vs_viewport_state(struct si_context *ctx);
+void si_update_ngg_culling_constants(struct si_context *ctx);
 void si_init_viewport_functions(struct si_context *ctx);
 
 /* si_texture.c */
@@ -1891,6 +1996,23 @@ static inline bool si_compute_prim_discard_enabled(struct si_context *sctx)
 	return sctx->prim_discard_vertex_count_threshold != UINT_MAX;
 }
 
+/* Whether the primitive discard compute shader has culled enough primitives
+ * with this VS lately. If not, it's skipped for a number of vertices, after
+ * which it's measured again.
+ */
+static inline bool
+si_prim_discard_culls_enough(struct si_context *sctx,
+			     struct si_shader_selector *vs,
+			     unsigned num_verts)
+{
+	if (likely(!vs->pd_skip_verts) ||
+	    sctx->screen->debug_flags & DBG(ALWAYS_PD))
+		return true;
+
+	vs->pd_skip_verts -= MIN2(vs->pd_skip_verts, num_verts);
+	return false;
+}
+
 static inline unsigned si_get_wave_size(struct si_screen *sscreen,
 					enum pipe_shader_type shader_type,
 					bool ngg, bool es)
@@ -1909,6 +2031,10 @@ static inline unsigned si_get_wave_size(struct si_screen *sscreen,
 
 static inline unsigned si_get_shader_wave_size(struct si_shader *shader)
 {
+	/* Compute shaders choose their wave size individually. */
+	if (shader->selector->type == PIPE_SHADER_COMPUTE)
+		return shader->selector->wave_size;
+
 	return si_get_wave_size(shader->selector->screen, shader->selector->type,
 				shader->key.as_ngg, shader->key.as_es);
 }
@@ -78,6 +78,7 @@ static enum radeon_value_id winsys_id_from_type(unsigned type)
 	case SI_QUERY_NUM_SDMA_IBS: return RADEON_NUM_SDMA_IBS;
 	case SI_QUERY_GFX_BO_LIST_SIZE: return RADEON_GFX_BO_LIST_COUNTER;
 	case SI_QUERY_GFX_IB_SIZE: return RADEON_GFX_IB_SIZE_COUNTER;
+	case SI_QUERY_NUM_REUSED_BO_LISTS: return RADEON_NUM_REUSED_BO_LISTS;
 	case SI_QUERY_NUM_BYTES_MOVED: return RADEON_NUM_BYTES_MOVED;
 	case SI_QUERY_NUM_EVICTIONS: return RADEON_NUM_EVICTIONS;
 	case SI_QUERY_NUM_VRAM_CPU_PAGE_FAULTS: return RADEON_NUM_VRAM_CPU_PAGE_FAULTS;
@@ -105,10 +106,37 @@ static int64_t si_finish_dma_get_cpu_time(struct si_context *sctx)
 	return os_time_get_nano();
 }
 
+static uint64_t si_upload_ring_counter(struct si_context *sctx, unsigned type)
+{
+	struct u_upload_stats stats;
+
+	u_upload_get_stats(sctx->b.stream_uploader, &stats);
+	return type == SI_QUERY_UPLOAD_RING_WRAPS ? stats.num_wraps :
+						     stats.num_stalls;
+}
+
+/* Sum of the statistics of both shader compiler queues. */
+static void si_get_shader_compile_stats(struct si_screen *sscreen,
+					struct util_queue_stats *stats)
+{
+	struct util_queue_stats lowp;
+
+	util_queue_get_stats(&sscreen->shader_compiler_queue, stats);
+	util_queue_get_stats(&sscreen->shader_compiler_queue_low_priority,
+			     &lowp);
+
+	stats->num_jobs += lowp.num_jobs;
+	stats->wait_time += lowp.wait_time;
+	stats->max_wait_time = MAX2(stats->max_wait_time, lowp.max_wait_time);
+	stats->run_time += lowp.run_time;
+	stats->num_queued += lowp.num_queued;
+}
+
 static bool si_query_sw_begin(struct si_context *sctx,
 			      struct si_query *squery)
 {
 	struct si_query_sw *query = (struct si_query_sw *)squery;
+	struct util_queue_stats stats;
 	enum radeon_value_id ws_id;
 
 	switch(query->b.type) {
@@ -145,6 +173,13 @@ static bool si_query_sw_begin(struct si_context *sctx,
 	case SI_QUERY_CP_DMA_CALLS:
 		query->begin_result = sctx->num_cp_dma_calls;
 		break;
+	case SI_QUERY_DESCRIPTOR_UPLOAD_BYTES:
+		query->begin_result = sctx->num_descriptor_upload_bytes;
+		break;
+	case SI_QUERY_NGG_CULLED_PRIMS:
+		/* Only used without NGG culling. */
+		query->begin_result = 0;
+		break;
 	case SI_QUERY_NUM_VS_FLUSHES:
 		query->begin_result = sctx->num_vs_flushes;
 		break;
@@ -196,6 +231,7 @@ static bool si_query_sw_begin(struct si_context *sctx,
 	case SI_QUERY_GFX_IB_SIZE:
 	case SI_QUERY_NUM_GFX_IBS:
 	case SI_QUERY_NUM_SDMA_IBS:
+	case SI_QUERY_NUM_REUSED_BO_LISTS:
 	case SI_QUERY_NUM_BYTES_MOVED:
 	case SI_QUERY_NUM_EVICTIONS:
 	case SI_QUERY_NUM_VRAM_CPU_PAGE_FAULTS: {
@@ -253,6 +289,18 @@ static bool si_query_sw_begin(struct si_context *sctx,
 		query->begin_result =
 			p_atomic_read(&sctx->screen->num_shader_cache_hits);
 		break;
+	case SI_QUERY_SHADER_COMPILE_QUEUE_DEPTH:
+		query->begin_result = 0;
+		break;
+	case SI_QUERY_SHADER_COMPILE_WAIT_TIME:
+		si_get_shader_compile_stats(sctx->screen, &stats);
+		query->begin_result = stats.wait_time;
+		query->begin_time = stats.num_jobs;
+		break;
+	case SI_QUERY_UPLOAD_RING_WRAPS:
+	case SI_QUERY_UPLOAD_RING_STALLS:
+		query->begin_result = si_upload_ring_counter(sctx, query->b.type);
+		break;
 	case SI_QUERY_PD_NUM_PRIMS_ACCEPTED:
 		query->begin_result = sctx->compute_num_verts_accepted;
 		break;
@@ -279,6 +327,7 @@ static bool si_query_sw_end(struct si_context *sctx,
 			    struct si_query *squery)
 {
 	struct si_query_sw *query = (struct si_query_sw *)squery;
+	struct util_queue_stats stats;
 	enum radeon_value_id ws_id;
 
 	switch(query->b.type) {
@@ -317,6 +366,12 @@ static bool si_query_sw_end(struct si_context *sctx,
 	case SI_QUERY_CP_DMA_CALLS:
 		query->end_result = sctx->num_cp_dma_calls;
 		break;
+	case SI_QUERY_DESCRIPTOR_UPLOAD_BYTES:
+		query->end_result = sctx->num_descriptor_upload_bytes;
+		break;
+	case SI_QUERY_NGG_CULLED_PRIMS:
+		query->end_result = 0;
+		break;
 	case SI_QUERY_NUM_VS_FLUSHES:
 		query->end_result = sctx->num_vs_flushes;
 		break;
@@ -365,6 +420,7 @@ static bool si_query_sw_end(struct si_context *sctx,
 	case SI_QUERY_NUM_MAPPED_BUFFERS:
 	case SI_QUERY_NUM_GFX_IBS:
 	case SI_QUERY_NUM_SDMA_IBS:
+	case SI_QUERY_NUM_REUSED_BO_LISTS:
 	case SI_QUERY_NUM_BYTES_MOVED:
 	case SI_QUERY_NUM_EVICTIONS:
 	case SI_QUERY_NUM_VRAM_CPU_PAGE_FAULTS: {
@@ -427,6 +483,19 @@ static bool si_query_sw_end(struct si_context *sctx,
 		query->end_result =
 			p_atomic_read(&sctx->screen->num_shader_cache_hits);
 		break;
+	case SI_QUERY_SHADER_COMPILE_QUEUE_DEPTH:
+		si_get_shader_compile_stats(sctx->screen, &stats);
+		query->end_result = stats.num_queued;
+		break;
+	case SI_QUERY_SHADER_COMPILE_WAIT_TIME:
+		si_get_shader_compile_stats(sctx->screen, &stats);
+		query->end_result = stats.wait_time;
+		query->end_time = stats.num_jobs;
+		break;
+	case SI_QUERY_UPLOAD_RING_WRAPS:
+	case SI_QUERY_UPLOAD_RING_STALLS:
+		query->end_result = si_upload_ring_counter(sctx, query->b.type);
+		break;
 	case SI_QUERY_PD_NUM_PRIMS_ACCEPTED:
 		query->end_result = sctx->compute_num_verts_accepted;
 		break;
@@ -476,6 +545,12 @@ static bool si_query_sw_get_result(struct si_context *sctx,
 		result->u64 = (query->end_result - query->begin_result) /
 			      (query->end_time - query->begin_time);
 		return true;
+	case SI_QUERY_SHADER_COMPILE_WAIT_TIME:
+		/* Average per job in microseconds. */
+		result->u64 = query->end_time == query->begin_time ? 0 :
+			      (query->end_result - query->begin_result) / 1000 /
+			      (query->end_time - query->begin_time);
+		return true;
 	case SI_QUERY_CS_THREAD_BUSY:
 	case SI_QUERY_GALLIUM_THREAD_BUSY:
 		result->u64 = (query->end_result - query->begin_result) * 100 /
@@ -1094,6 +1169,10 @@ static struct pipe_query *si_create_query(struct pipe_context *ctx, unsigned que
 	struct si_screen *sscreen =
 		(struct si_screen *)ctx->screen;
 
+	/* Culled primitives are counted by NGG shaders. */
+	if (query_type == SI_QUERY_NGG_CULLED_PRIMS && sscreen->use_ngg_culling)
+		return gfx10_sh_query_create(sscreen, query_type, 0);
+
 	if (query_type == PIPE_QUERY_TIMESTAMP_DISJOINT ||
 	    query_type == PIPE_QUERY_GPU_FINISHED ||
 	    (query_type >= PIPE_QUERY_DRIVER_SPECIFIC &&
@@ -1721,6 +1800,10 @@ static struct pipe_driver_query_info si_driver_query_list[] = {
 	X("num-compilations",		NUM_COMPILATIONS,	UINT64, CUMULATIVE),
 	X("num-shaders-created",	NUM_SHADERS_CREATED,	UINT64, CUMULATIVE),
 	X("num-shader-cache-hits",	NUM_SHADER_CACHE_HITS,	UINT64, CUMULATIVE),
+	X("shader-compile-queue-depth",	SHADER_COMPILE_QUEUE_DEPTH, UINT64, AVERAGE),
+	X("shader-compile-wait-time",	SHADER_COMPILE_WAIT_TIME, MICROSECONDS, AVERAGE),
+	X("upload-ring-wraps",		UPLOAD_RING_WRAPS,	UINT64, CUMULATIVE),
+	X("upload-ring-stalls",		UPLOAD_RING_STALLS,	UINT64, CUMULATIVE),
 	X("draw-calls",			DRAW_CALLS,		UINT64, AVERAGE),
 	X("decompress-calls",		DECOMPRESS_CALLS,	UINT64, AVERAGE),
 	X("MRT-draw-calls",		MRT_DRAW_CALLS,		UINT64, AVERAGE),
@@ -1730,6 +1813,8 @@ static struct pipe_driver_query_info si_driver_query_list[] = {
 	X("spill-compute-calls",	SPILL_COMPUTE_CALLS,	UINT64, AVERAGE),
 	X("dma-calls",			DMA_CALLS,		UINT64, AVERAGE),
 	X("cp-dma-calls",		CP_DMA_CALLS,		UINT64, AVERAGE),
+	X("descriptor-upload-bytes",	DESCRIPTOR_UPLOAD_BYTES, BYTES, AVERAGE),
+	X("ngg-culled-primitives",	NGG_CULLED_PRIMS,	UINT64, AVERAGE),
 	X("num-vs-flushes",		NUM_VS_FLUSHES,		UINT64, AVERAGE),
 	X("num-ps-flushes",		NUM_PS_FLUSHES,		UINT64, AVERAGE),
 	X("num-cs-flushes",		NUM_CS_FLUSHES,		UINT64, AVERAGE),
@@ -1753,6 +1838,7 @@ static struct pipe_driver_query_info si_driver_query_list[] = {
 	X("num-SDMA-IBs",		NUM_SDMA_IBS,		UINT64, AVERAGE),
 	X("GFX-BO-list-size",		GFX_BO_LIST_SIZE,	UINT64, AVERAGE),
 	X("GFX-IB-size",		GFX_IB_SIZE,		UINT64, AVERAGE),
+	X("num-reused-BO-lists",	NUM_REUSED_BO_LISTS,	UINT64, AVERAGE),
 	X("num-bytes-moved",		NUM_BYTES_MOVED,	BYTES, CUMULATIVE),
 	X("num-evictions",		NUM_EVICTIONS,		UINT64, CUMULATIVE),
 	X("VRAM-CPU-page-faults",	NUM_VRAM_CPU_PAGE_FAULTS, UINT64, CUMULATIVE),
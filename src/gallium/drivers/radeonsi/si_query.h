@@ -50,6 +50,7 @@ enum {
 	SI_QUERY_SPILL_COMPUTE_CALLS,
 	SI_QUERY_DMA_CALLS,
 	SI_QUERY_CP_DMA_CALLS,
+	SI_QUERY_DESCRIPTOR_UPLOAD_BYTES,
 	SI_QUERY_NUM_VS_FLUSHES,
 	SI_QUERY_NUM_PS_FLUSHES,
 	SI_QUERY_NUM_CS_FLUSHES,
@@ -73,6 +74,7 @@ enum {
 	SI_QUERY_NUM_SDMA_IBS,
 	SI_QUERY_GFX_BO_LIST_SIZE,
 	SI_QUERY_GFX_IB_SIZE,
+	SI_QUERY_NUM_REUSED_BO_LISTS,
 	SI_QUERY_NUM_BYTES_MOVED,
 	SI_QUERY_NUM_EVICTIONS,
 	SI_QUERY_NUM_VRAM_CPU_PAGE_FAULTS,
@@ -107,6 +109,10 @@ enum {
 	SI_QUERY_NUM_SHADERS_CREATED,
 	SI_QUERY_BACK_BUFFER_PS_DRAW_RATIO,
 	SI_QUERY_NUM_SHADER_CACHE_HITS,
+	SI_QUERY_SHADER_COMPILE_QUEUE_DEPTH,
+	SI_QUERY_SHADER_COMPILE_WAIT_TIME,
+	SI_QUERY_UPLOAD_RING_WRAPS,
+	SI_QUERY_UPLOAD_RING_STALLS,
 	SI_QUERY_GPIN_ASIC_ID,
 	SI_QUERY_GPIN_NUM_SIMD,
 	SI_QUERY_GPIN_NUM_RB,
@@ -117,6 +123,7 @@ enum {
 	SI_QUERY_PD_NUM_PRIMS_ACCEPTED,
 	SI_QUERY_PD_NUM_PRIMS_REJECTED,
 	SI_QUERY_PD_NUM_PRIMS_INELIGIBLE,
+	SI_QUERY_NGG_CULLED_PRIMS,
 
 	SI_QUERY_FIRST_PERFCOUNTER = PIPE_QUERY_DRIVER_SPECIFIC + 100,
 };
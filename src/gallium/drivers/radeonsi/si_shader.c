@@ -5444,7 +5444,7 @@ static void si_calculate_max_simd_waves(struct si_shader *shader)
 				si_get_max_workgroup_size(shader);
 			lds_per_wave = (conf->lds_size * lds_increment) /
 				       DIV_ROUND_UP(max_workgroup_size,
-						    sscreen->compute_wave_size);
+						    shader->selector->wave_size);
 		}
 		break;
 	default:;
@@ -5492,12 +5492,13 @@ void si_shader_dump_stats_for_shader_db(struct si_screen *screen,
 	pipe_debug_message(debug, SHADER_INFO,
 			   "Shader Stats: SGPRS: %d VGPRS: %d Code Size: %d "
 			   "LDS: %d Scratch: %d Max Waves: %d Spilled SGPRs: %d "
-			   "Spilled VGPRs: %d PrivMem VGPRs: %d",
+			   "Spilled VGPRs: %d PrivMem VGPRs: %d Wave Size: %d",
 			   conf->num_sgprs, conf->num_vgprs,
 			   si_get_shader_binary_size(screen, shader),
 			   conf->lds_size, conf->scratch_bytes_per_wave,
 			   shader->info.max_simd_waves, conf->spilled_sgprs,
-			   conf->spilled_vgprs, shader->info.private_mem_vgprs);
+			   conf->spilled_vgprs, shader->info.private_mem_vgprs,
+			   si_get_shader_wave_size(shader));
 }
 
 static void si_shader_dump_stats(struct si_screen *sscreen,
@@ -5526,13 +5527,19 @@ static void si_shader_dump_stats(struct si_screen *sscreen,
 			"LDS: %d blocks\n"
 			"Scratch: %d bytes per wave\n"
 			"Max Waves: %d\n"
-			"********************\n\n\n",
+			"Wave Size: %d\n",
 			conf->num_sgprs, conf->num_vgprs,
 			conf->spilled_sgprs, conf->spilled_vgprs,
 			shader->info.private_mem_vgprs,
 			si_get_shader_binary_size(sscreen, shader),
 			conf->lds_size, conf->scratch_bytes_per_wave,
-			shader->info.max_simd_waves);
+			shader->info.max_simd_waves,
+			si_get_shader_wave_size(shader));
+
+		if (shader->selector->type == PIPE_SHADER_COMPUTE)
+			fprintf(file, "IR hash: %08x\n", shader->selector->ir_hash);
+
+		fprintf(file, "********************\n\n\n");
 	}
 }
 
@@ -6933,6 +6940,9 @@ int si_compile_tgsi_shader(struct si_screen *sscreen,
 	struct si_shader_context ctx;
 	int r = -1;
 
+	if (!compiler->passes)
+		si_init_compiler(sscreen, compiler);
+
 	/* Dump TGSI code before doing TGSI->LLVM conversion in case the
 	 * conversion fails. */
 	if (si_can_dump_shader(sscreen, sel->type) &&
@@ -8279,6 +8289,12 @@ bool si_shader_create(struct si_screen *sscreen, struct ac_llvm_compiler *compil
 	struct si_shader *mainp = *si_get_main_shader_part(sel, &shader->key);
 	int r;
 
+	/* Compilers are created by the thread that uses them first, which
+	 * owns them exclusively.
+	 */
+	if (!compiler->passes)
+		si_init_compiler(sscreen, compiler);
+
 	/* LS, ES, VS are compiled on demand if the main part hasn't been
 	 * compiled for that stage.
 	 *
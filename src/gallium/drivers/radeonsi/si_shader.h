@@ -134,6 +134,8 @@
 #include <llvm-c/Core.h> /* LLVMModuleRef */
 #include <llvm-c/TargetMachine.h>
 #include "tgsi/tgsi_scan.h"
+#include "util/disk_cache.h"
+#include "util/u_dynarray.h"
 #include "util/u_inlines.h"
 #include "util/u_queue.h"
 
@@ -314,6 +316,12 @@ struct si_shader_selector {
 	struct si_shader	*first_variant; /* immutable after the first variant */
 	struct si_shader	*last_variant; /* mutable */
 
+	/* Keys of the variants built by this and previous runs, which are
+	 * saved in the disk cache (protected by mutex). */
+	bool			has_variant_history;
+	uint8_t			variant_history_key[CACHE_KEY_SIZE];
+	struct util_dynarray	variant_history; /* struct si_shader_key */
+
 	/* The compiled TGSI shader expecting a prolog and/or epilog (not
 	 * uploaded to a buffer).
 	 */
@@ -333,9 +341,18 @@ struct si_shader_selector {
 
 	/* PIPE_SHADER_[VERTEX|FRAGMENT|...] */
 	enum pipe_shader_type type;
+	/* Compute only: the wave size chosen for the shader, and the hash of
+	 * the IR that selects it in AMD_CS_WAVE_SIZE_TABLE. */
+	unsigned	wave_size;
+	uint32_t	ir_hash;
 	bool		vs_needs_prolog;
 	bool		force_correct_derivs_after_kill;
 	bool		prim_discard_cs_allowed;
+	/* Measured culling rate of the primitive discard compute shader.
+	 * It's shared by all contexts, so it's only approximate. */
+	unsigned	pd_num_verts_in;
+	unsigned	pd_num_verts_out;
+	unsigned	pd_skip_verts; /* vertices to draw without it */
 	unsigned	pa_cl_vs_out_cntl;
 	ubyte		clipdist_mask;
 	ubyte		culldist_mask;
@@ -573,6 +590,11 @@ struct si_shader_key {
 		unsigned	cs_cull_back:1;
 		unsigned	cs_cull_z:1;
 		unsigned	cs_halfz_clip_space:1;
+
+		/* NGG primitive culling (VS and TES without GS). */
+		unsigned	ngg_culling:1;
+		unsigned	ngg_cull_front:1;
+		unsigned	ngg_cull_back:1;
 	} opt;
 };
 
@@ -628,6 +650,7 @@ struct si_shader {
 	bool				compilation_failed;
 	bool				is_monolithic;
 	bool				is_optimized;
+	bool				is_precompiled; /* from the variant history */
 	bool				is_binary_shared;
 	bool				is_gs_copy_shader;
 
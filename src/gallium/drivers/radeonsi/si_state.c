@@ -897,6 +897,8 @@ static void *si_create_rs_state(struct pipe_context *ctx,
 		rs->cull_back = !!(state->cull_face & PIPE_FACE_FRONT);
 		rs->cull_front = !!(state->cull_face & PIPE_FACE_BACK);
 	}
+	rs->polygon_mode_enabled = state->fill_front != PIPE_POLYGON_MODE_FILL ||
+				   state->fill_back != PIPE_POLYGON_MODE_FILL;
 	rs->depth_clamp_any = !state->depth_clip_near || !state->depth_clip_far;
 	rs->provoking_vertex_first = state->flatshade_first;
 	rs->scissor_enable = state->scissor;
@@ -1085,7 +1087,11 @@ static void si_bind_rs_state(struct pipe_context *ctx, void *state)
 	    old_rs->poly_smooth != rs->poly_smooth ||
 	    old_rs->line_smooth != rs->line_smooth ||
 	    old_rs->clamp_fragment_color != rs->clamp_fragment_color ||
-	    old_rs->force_persample_interp != rs->force_persample_interp)
+	    old_rs->force_persample_interp != rs->force_persample_interp ||
+	    (sctx->screen->use_ngg_culling &&
+	     (old_rs->cull_front != rs->cull_front ||
+	      old_rs->cull_back != rs->cull_back ||
+	      old_rs->polygon_mode_enabled != rs->polygon_mode_enabled)))
 		sctx->do_update_shaders = true;
 }
 
@@ -3090,8 +3096,10 @@ static void si_set_framebuffer_state(struct pipe_context *ctx,
 	si_mark_atom_dirty(sctx, &sctx->atoms.s.cb_render_state);
 	si_mark_atom_dirty(sctx, &sctx->atoms.s.framebuffer);
 
-	if (sctx->screen->dpbb_allowed)
+	if (sctx->screen->dpbb_allowed) {
+		si_dpbb_tune_framebuffer(sctx);
 		si_mark_atom_dirty(sctx, &sctx->atoms.s.dpbb_state);
+	}
 
 	if (sctx->framebuffer.any_dst_linear != old_any_dst_linear)
 		si_mark_atom_dirty(sctx, &sctx->atoms.s.msaa_config);
@@ -3108,6 +3116,10 @@ static void si_set_framebuffer_state(struct pipe_context *ctx,
 		si_mark_atom_dirty(sctx, &sctx->atoms.s.msaa_config);
 		si_mark_atom_dirty(sctx, &sctx->atoms.s.db_render_state);
 
+		/* Small primitive culling depends on the sample count. */
+		if (sctx->screen->use_ngg_culling)
+			si_update_ngg_culling_constants(sctx);
+
 		constbuf.buffer = sctx->sample_pos_buffer;
 
 		/* Set sample locations as fragment shader constants. */
@@ -3150,6 +3162,9 @@ static void si_set_framebuffer_state(struct pipe_context *ctx,
 		 */
 		sctx->need_check_render_feedback = true;
 	}
+
+	if (u_trace_is_enabled(&sctx->trace))
+		si_gpu_trace_framebuffer_changed(sctx);
 }
 
 static void si_emit_framebuffer_state(struct si_context *sctx)
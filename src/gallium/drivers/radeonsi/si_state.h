@@ -91,6 +91,7 @@ struct si_state_rasterizer {
 	unsigned		clip_halfz:1;
 	unsigned		cull_front:1;
 	unsigned		cull_back:1;
+	unsigned		polygon_mode_enabled:1;
 	unsigned		depth_clamp_any:1;
 	unsigned		provoking_vertex_first:1;
 };
@@ -374,6 +375,7 @@ enum {
 	SI_HS_CONST_DEFAULT_TESS_LEVELS,
 	SI_VS_CONST_INSTANCE_DIVISORS,
 	SI_VS_CONST_CLIP_PLANES,
+	SI_VS_CONST_NGG_CULLING,
 	SI_PS_CONST_POLY_STIPPLE,
 	SI_PS_CONST_SAMPLE_POSITIONS,
 
@@ -439,6 +441,10 @@ struct si_descriptors {
 	uint32_t *list;
 	/* The list in mapped GPU memory. */
 	uint32_t *gpu_list;
+	/* A copy of the last uploaded list in malloc'd memory, which is used to
+	 * skip uploads that wouldn't change anything.  NULL for bindless
+	 * descriptors, which are also updated in place. */
+	uint32_t *uploaded_list;
 
 	/* The buffer where the descriptors have been uploaded. */
 	struct si_resource *buffer;
@@ -452,6 +458,9 @@ struct si_descriptors {
 	 */
 	uint32_t first_active_slot;
 	uint32_t num_active_slots;
+	/* The active slots of the last upload. */
+	uint32_t uploaded_first_slot;
+	uint32_t uploaded_num_slots;
 
 	/* The SH register offset relative to USER_DATA*_0 where the pointer
 	 * to the descriptor array will be stored. */
@@ -580,6 +589,8 @@ si_compute_fast_udiv_info32(uint32_t D, unsigned num_bits);
 
 /* si_state_binning.c */
 void si_emit_dpbb_state(struct si_context *sctx);
+void si_dpbb_tune_framebuffer(struct si_context *sctx);
+void si_dpbb_tune_destroy(struct si_context *sctx);
 
 /* si_state_shaders.c */
 void *si_get_ir_binary(struct si_shader_selector *sel, bool ngg, bool es);
@@ -26,6 +26,7 @@
 
 #include "si_build_pm4.h"
 #include "sid.h"
+#include "util/hash_table.h"
 
 struct uvec2 {
 	unsigned x, y;
@@ -474,6 +475,185 @@ static void si_emit_dpbb_disable(struct si_context *sctx)
 	sctx->last_binning_enabled = false;
 }
 
+/* Binning configurations tried by the online tuning. Each one is measured
+ * SI_DPBB_TUNE_SAMPLES times for every framebuffer signature, and the one
+ * with the lowest average GPU time between framebuffer changes is kept.
+ */
+static const struct {
+	bool disable;
+	unsigned context_states_per_bin; /* 0 = driver default */
+	unsigned persistent_states_per_bin;
+} si_dpbb_tune_configs[] = {
+	{false, 0, 0},
+	{true, 0, 0},
+	{false, 1, 1},
+	{false, 6, 16},
+};
+
+#define SI_DPBB_TUNE_NUM_CONFIGS	ARRAY_SIZE(si_dpbb_tune_configs)
+#define SI_DPBB_TUNE_SAMPLES		4
+
+struct si_dpbb_tune_entry {
+	unsigned num_started[SI_DPBB_TUNE_NUM_CONFIGS];
+	unsigned num_results[SI_DPBB_TUNE_NUM_CONFIGS];
+	uint64_t time[SI_DPBB_TUNE_NUM_CONFIGS]; /* nanoseconds */
+	int best; /* -1 while tuning */
+};
+
+static uint64_t si_dpbb_tune_signature(struct si_context *sctx)
+{
+	struct pipe_framebuffer_state *state = &sctx->framebuffer.state;
+	uint32_t key[3 + PIPE_MAX_COLOR_BUFS];
+	unsigned n = 0;
+
+	key[n++] = state->width | state->height << 16;
+	key[n++] = sctx->framebuffer.nr_samples | state->nr_cbufs << 8;
+	key[n++] = state->zsbuf ? state->zsbuf->format : PIPE_FORMAT_NONE;
+	for (unsigned i = 0; i < state->nr_cbufs; i++)
+		key[n++] = state->cbufs[i] ? state->cbufs[i]->format : PIPE_FORMAT_NONE;
+
+	/* Keys 0 and 1 are reserved by the hash table. */
+	return _mesa_hash_data(key, n * 4) | (1ull << 32);
+}
+
+static void si_dpbb_tune_add_result(struct si_dpbb_tune_entry *entry,
+				    unsigned config, uint64_t time)
+{
+	entry->num_results[config]++;
+	entry->time[config] += time;
+
+	if (entry->best >= 0)
+		return;
+
+	for (unsigned i = 0; i < SI_DPBB_TUNE_NUM_CONFIGS; i++) {
+		if (entry->num_results[i] < SI_DPBB_TUNE_SAMPLES)
+			return;
+	}
+
+	unsigned best = 0;
+	for (unsigned i = 1; i < SI_DPBB_TUNE_NUM_CONFIGS; i++) {
+		if (entry->time[i] / entry->num_results[i] <
+		    entry->time[best] / entry->num_results[best])
+			best = i;
+	}
+	entry->best = best;
+}
+
+/* Read the results that are available without waiting or flushing. */
+static void si_dpbb_tune_poll(struct si_context *sctx)
+{
+	struct si_dpbb_tune *tune = &sctx->dpbb_tune;
+
+	for (unsigned i = 0; i < tune->num_pending;) {
+		struct si_dpbb_tune_sample *sample = &tune->pending[i];
+		union pipe_query_result result;
+
+		/* Getting the result of a query in the current IB would
+		 * flush it.
+		 */
+		if (sample->gfx_ib_index == sctx->num_gfx_cs_flushes ||
+		    !sctx->b.get_query_result(&sctx->b, sample->query, false,
+					      &result)) {
+			i++;
+			continue;
+		}
+
+		si_dpbb_tune_add_result(sample->entry, sample->config, result.u64);
+		sctx->b.destroy_query(&sctx->b, sample->query);
+		*sample = tune->pending[--tune->num_pending];
+	}
+}
+
+/* Called when the framebuffer changes. This ends the measurement of the
+ * previous framebuffer and selects the binning configuration of the new one.
+ */
+void si_dpbb_tune_framebuffer(struct si_context *sctx)
+{
+	struct si_dpbb_tune *tune = &sctx->dpbb_tune;
+
+	/* Blits are accounted to the framebuffer they interrupt. */
+	if (!tune->table || sctx->blitter->running)
+		return;
+
+	if (tune->active.query) {
+		sctx->b.end_query(&sctx->b, tune->active.query);
+
+		if (sctx->num_draw_calls != tune->active_num_draw_calls) {
+			tune->active.gfx_ib_index = sctx->num_gfx_cs_flushes;
+			tune->pending[tune->num_pending++] = tune->active;
+		} else {
+			/* Nothing was drawn. */
+			tune->active.entry->num_started[tune->active.config]--;
+			sctx->b.destroy_query(&sctx->b, tune->active.query);
+		}
+		tune->active.query = NULL;
+	}
+
+	si_dpbb_tune_poll(sctx);
+
+	uint64_t key = si_dpbb_tune_signature(sctx);
+	struct si_dpbb_tune_entry *entry =
+		_mesa_hash_table_u64_search(tune->table, key);
+
+	if (!entry) {
+		entry = CALLOC_STRUCT(si_dpbb_tune_entry);
+		if (!entry) {
+			tune->config = 0;
+			return;
+		}
+		entry->best = -1;
+		_mesa_hash_table_u64_insert(tune->table, key, entry);
+	}
+
+	if (entry->best >= 0) {
+		tune->config = entry->best;
+		return;
+	}
+
+	/* Measure the configuration with the fewest measurements. */
+	unsigned config = 0;
+	for (unsigned i = 1; i < SI_DPBB_TUNE_NUM_CONFIGS; i++) {
+		if (entry->num_started[i] < entry->num_started[config])
+			config = i;
+	}
+	tune->config = config;
+
+	if (tune->num_pending == SI_DPBB_TUNE_MAX_PENDING)
+		return;
+
+	tune->active.query = sctx->b.create_query(&sctx->b,
+						  PIPE_QUERY_TIME_ELAPSED, 0);
+	if (!tune->active.query)
+		return;
+
+	sctx->b.begin_query(&sctx->b, tune->active.query);
+	tune->active.entry = entry;
+	tune->active.config = config;
+	tune->active_num_draw_calls = sctx->num_draw_calls;
+	entry->num_started[config]++;
+}
+
+static void si_dpbb_tune_free_entry(struct hash_entry *entry)
+{
+	FREE(entry->data);
+}
+
+void si_dpbb_tune_destroy(struct si_context *sctx)
+{
+	struct si_dpbb_tune *tune = &sctx->dpbb_tune;
+
+	if (!tune->table)
+		return;
+
+	if (tune->active.query)
+		sctx->b.destroy_query(&sctx->b, tune->active.query);
+	for (unsigned i = 0; i < tune->num_pending; i++)
+		sctx->b.destroy_query(&sctx->b, tune->pending[i].query);
+
+	_mesa_hash_table_u64_destroy(tune->table, si_dpbb_tune_free_entry);
+	tune->table = NULL;
+}
+
 void si_emit_dpbb_state(struct si_context *sctx)
 {
 	struct si_screen *sscreen = sctx->screen;
@@ -483,7 +663,8 @@ void si_emit_dpbb_state(struct si_context *sctx)
 
 	assert(sctx->chip_class >= GFX9);
 
-	if (!sscreen->dpbb_allowed || sctx->dpbb_force_off) {
+	if (!sscreen->dpbb_allowed || sctx->dpbb_force_off ||
+	    si_dpbb_tune_configs[sctx->dpbb_tune.config].disable) {
 		si_emit_dpbb_disable(sctx);
 		return;
 	}
@@ -573,6 +754,14 @@ void si_emit_dpbb_state(struct si_context *sctx)
 	}
 	fpovs_per_batch = 63;
 
+	if (si_dpbb_tune_configs[sctx->dpbb_tune.config].context_states_per_bin) {
+		context_states_per_bin =
+			sscreen->info.has_gfx9_scissor_bug ? 1 :
+			si_dpbb_tune_configs[sctx->dpbb_tune.config].context_states_per_bin;
+		persistent_states_per_bin =
+			si_dpbb_tune_configs[sctx->dpbb_tune.config].persistent_states_per_bin;
+	}
+
 	/* Emit registers. */
 	struct uvec2 bin_size_extend = {};
 	if (bin_size.x >= 32)
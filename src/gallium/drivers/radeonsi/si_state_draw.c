@@ -806,8 +806,14 @@ static void si_emit_draw_registers(struct si_context *sctx,
 	}
 }
 
+/* The maximum number of dwords emitted per direct draw by si_emit_draw_packets:
+ * SET_SH_REG with 3 draw SGPRs and DRAW_INDEX_2. */
+#define SI_MAX_DIRECT_DRAW_DWORDS	11
+
 static void si_emit_draw_packets(struct si_context *sctx,
 				 const struct pipe_draw_info *info,
+				 const struct pipe_draw_start_count *draws,
+				 unsigned num_draws,
 				 struct pipe_resource *indexbuf,
 				 unsigned index_size,
 				 unsigned index_offset,
@@ -963,8 +969,6 @@ static void si_emit_draw_packets(struct si_context *sctx,
 			radeon_emit(cs, di_src_sel);
 		}
 	} else {
-		int base_vertex;
-
 		if (sctx->last_instance_count == SI_INSTANCE_COUNT_UNKNOWN ||
 		    sctx->last_instance_count != instance_count) {
 			radeon_emit(cs, PKT3(PKT3_NUM_INSTANCES, 0, 0));
@@ -972,9 +976,6 @@ static void si_emit_draw_packets(struct si_context *sctx,
 			sctx->last_instance_count = instance_count;
 		}
 
-		/* Base vertex and start instance. */
-		base_vertex = original_index_size ? info->index_bias : info->start;
-
 		if (sctx->num_vs_blit_sgprs) {
 			/* Re-emit draw constants after we leave u_blitter. */
 			si_invalidate_draw_sh_constants(sctx);
@@ -984,47 +985,68 @@ static void si_emit_draw_packets(struct si_context *sctx,
 					      sctx->num_vs_blit_sgprs);
 			radeon_emit_array(cs, sctx->vs_blit_sh_data,
 					  sctx->num_vs_blit_sgprs);
-		} else if (base_vertex != sctx->last_base_vertex ||
-			   sctx->last_base_vertex == SI_BASE_VERTEX_UNKNOWN ||
-			   info->start_instance != sctx->last_start_instance ||
-			   info->drawid != sctx->last_drawid ||
-			   sh_base_reg != sctx->last_sh_base_reg) {
-			radeon_set_sh_reg_seq(cs, sh_base_reg + SI_SGPR_BASE_VERTEX * 4, 3);
-			radeon_emit(cs, base_vertex);
-			radeon_emit(cs, info->start_instance);
-			radeon_emit(cs, info->drawid);
-
-			sctx->last_base_vertex = base_vertex;
-			sctx->last_start_instance = info->start_instance;
-			sctx->last_drawid = info->drawid;
-			sctx->last_sh_base_reg = sh_base_reg;
 		}
 
-		if (index_size) {
-			if (dispatch_prim_discard_cs) {
-				index_va += info->start * original_index_size;
-				index_max_size = MIN2(index_max_size, info->count);
-
-				si_dispatch_prim_discard_cs_and_draw(sctx, info,
-								     original_index_size,
-								     base_vertex,
-								     index_va, index_max_size);
-				return;
-			}
+		/* All states have been emitted, only the draw SGPRs and the draw
+		 * packet are emitted per draw.
+		 */
+		for (unsigned i = 0; i < num_draws; i++) {
+			unsigned drawid = info->drawid +
+					  (info->increment_draw_id ? i : 0);
+			int base_vertex;
 
-			index_va += info->start * index_size;
+			/* Single draws with count == 0 are skipped by si_draw. */
+			if (!draws[i].count && num_draws > 1)
+				continue;
 
-			radeon_emit(cs, PKT3(PKT3_DRAW_INDEX_2, 4, render_cond_bit));
-			radeon_emit(cs, index_max_size);
-			radeon_emit(cs, index_va);
-			radeon_emit(cs, index_va >> 32);
-			radeon_emit(cs, info->count);
-			radeon_emit(cs, V_0287F0_DI_SRC_SEL_DMA);
-		} else {
-			radeon_emit(cs, PKT3(PKT3_DRAW_INDEX_AUTO, 1, render_cond_bit));
-			radeon_emit(cs, info->count);
-			radeon_emit(cs, V_0287F0_DI_SRC_SEL_AUTO_INDEX |
-				        S_0287F0_USE_OPAQUE(!!info->count_from_stream_output));
+			/* Base vertex and start instance. */
+			base_vertex = original_index_size ? info->index_bias
+							  : draws[i].start;
+
+			if (!sctx->num_vs_blit_sgprs &&
+			    (base_vertex != sctx->last_base_vertex ||
+			     sctx->last_base_vertex == SI_BASE_VERTEX_UNKNOWN ||
+			     info->start_instance != sctx->last_start_instance ||
+			     drawid != sctx->last_drawid ||
+			     sh_base_reg != sctx->last_sh_base_reg)) {
+				radeon_set_sh_reg_seq(cs, sh_base_reg + SI_SGPR_BASE_VERTEX * 4, 3);
+				radeon_emit(cs, base_vertex);
+				radeon_emit(cs, info->start_instance);
+				radeon_emit(cs, drawid);
+
+				sctx->last_base_vertex = base_vertex;
+				sctx->last_start_instance = info->start_instance;
+				sctx->last_drawid = drawid;
+				sctx->last_sh_base_reg = sh_base_reg;
+			}
+
+			if (index_size) {
+				if (dispatch_prim_discard_cs) {
+					assert(num_draws == 1);
+					index_va += info->start * original_index_size;
+					index_max_size = MIN2(index_max_size, info->count);
+
+					si_dispatch_prim_discard_cs_and_draw(sctx, info,
+									     original_index_size,
+									     base_vertex,
+									     index_va, index_max_size);
+					return;
+				}
+
+				uint64_t va = index_va + draws[i].start * index_size;
+
+				radeon_emit(cs, PKT3(PKT3_DRAW_INDEX_2, 4, render_cond_bit));
+				radeon_emit(cs, index_max_size);
+				radeon_emit(cs, va);
+				radeon_emit(cs, va >> 32);
+				radeon_emit(cs, draws[i].count);
+				radeon_emit(cs, V_0287F0_DI_SRC_SEL_DMA);
+			} else {
+				radeon_emit(cs, PKT3(PKT3_DRAW_INDEX_AUTO, 1, render_cond_bit));
+				radeon_emit(cs, draws[i].count);
+				radeon_emit(cs, V_0287F0_DI_SRC_SEL_AUTO_INDEX |
+					        S_0287F0_USE_OPAQUE(!!info->count_from_stream_output));
+			}
 		}
 	}
 }
@@ -1749,7 +1771,11 @@ static ALWAYS_INLINE bool pd_msg(const char *s)
 	return false;
 }
 
-static void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *info)
+/* Draw the draws of the same state. Only direct draws can have more than one
+ * draw. The state is emitted once, followed by the packets of all draws.
+ */
+static void si_draw(struct pipe_context *ctx, const struct pipe_draw_info *info,
+		    const struct pipe_draw_start_count *draws, unsigned num_draws)
 {
 	struct si_context *sctx = (struct si_context *)ctx;
 	struct si_state_rasterizer *rs = sctx->queued.named.rasterizer;
@@ -1773,7 +1799,7 @@ static void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *i
 			return;
 
 		/* Handle count == 0. */
-		if (unlikely(!info->count &&
+		if (unlikely(num_draws == 1 && !draws[0].count &&
 			     (index_size || !info->count_from_stream_output)))
 			return;
 	}
@@ -1994,6 +2020,8 @@ static void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *i
 #else
 	    (sctx->vs_shader.cso->prim_discard_cs_allowed || pd_msg("VS shader uses unsupported features")) &&
 #endif
+	    (si_prim_discard_culls_enough(sctx, sctx->vs_shader.cso, direct_count) ||
+	     pd_msg("not enough primitives culled recently")) &&
 	    /* Check that all buffers are used for read only, because compute
 	     * dispatches can run ahead. */
 	    (si_all_vs_resources_read_only(sctx, index_size ? indexbuf : NULL) || pd_msg("write reference"))) {
@@ -2029,6 +2057,13 @@ static void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *i
 
 	si_need_gfx_cs_space(sctx);
 
+	/* The minimum CS space only covers a few draw packets. */
+	if (num_draws > 1 &&
+	    !sctx->ws->cs_check_space(sctx->gfx_cs,
+				      si_get_minimum_num_gfx_cs_dwords(sctx) +
+				      num_draws * SI_MAX_DIRECT_DRAW_DWORDS, false))
+		si_flush_gfx_cs(sctx, RADEON_FLUSH_ASYNC_START_NEXT_GFX_IB_NOW, NULL);
+
 	if (sctx->bo_list_add_all_gfx_resources)
 		si_gfx_resources_add_all_to_bo_list(sctx);
 
@@ -2086,7 +2121,8 @@ static void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *i
 
 		sctx->dirty_atoms = 0;
 
-		si_emit_draw_packets(sctx, info, indexbuf, index_size, index_offset,
+		si_emit_draw_packets(sctx, info, draws, num_draws,
+				     indexbuf, index_size, index_offset,
 				     instance_count, dispatch_prim_discard_cs,
 				     original_index_size);
 		/* <-- CUs are busy here. */
@@ -2120,7 +2156,8 @@ static void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *i
 
 		sctx->dirty_atoms = 0;
 
-		si_emit_draw_packets(sctx, info, indexbuf, index_size, index_offset,
+		si_emit_draw_packets(sctx, info, draws, num_draws,
+				     indexbuf, index_size, index_offset,
 				     instance_count, dispatch_prim_discard_cs,
 				     original_index_size);
 
@@ -2150,13 +2187,13 @@ static void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *i
 	if (unlikely(sctx->decompression_enabled)) {
 		sctx->num_decompress_calls++;
 	} else {
-		sctx->num_draw_calls++;
+		sctx->num_draw_calls += num_draws;
 		if (sctx->framebuffer.state.nr_cbufs > 1)
-			sctx->num_mrt_draw_calls++;
+			sctx->num_mrt_draw_calls += num_draws;
 		if (primitive_restart)
-			sctx->num_prim_restart_calls++;
+			sctx->num_prim_restart_calls += num_draws;
 		if (G_0286E8_WAVESIZE(sctx->spi_tmpring_size))
-			sctx->num_spill_draw_calls++;
+			sctx->num_spill_draw_calls += num_draws;
 	}
 
 return_cleanup:
@@ -2164,6 +2201,44 @@ return_cleanup:
 		pipe_resource_reference(&indexbuf, NULL);
 }
 
+static void si_draw_vbo(struct pipe_context *ctx, const struct pipe_draw_info *info)
+{
+	struct pipe_draw_start_count draw = { info->start, info->count };
+
+	si_draw(ctx, info, &draw, 1);
+}
+
+static void si_multi_draw(struct pipe_context *ctx,
+			  const struct pipe_draw_info *info,
+			  const struct pipe_draw_start_count *draws,
+			  unsigned num_draws)
+{
+	struct si_context *sctx = (struct si_context *)ctx;
+
+	/* Index buffer translation and uploads and the primitive discard
+	 * compute shader handle one draw at a time.
+	 */
+	if ((sctx->chip_class <= GFX7 && info->index_size == 1) ||
+	    info->has_user_indices ||
+	    si_compute_prim_discard_enabled(sctx)) {
+		struct pipe_draw_info single = *info;
+
+		single.increment_draw_id = false;
+
+		for (unsigned i = 0; i < num_draws; i++) {
+			single.start = draws[i].start;
+			single.count = draws[i].count;
+			si_draw_vbo(ctx, &single);
+
+			if (info->increment_draw_id)
+				single.drawid++;
+		}
+		return;
+	}
+
+	si_draw(ctx, info, draws, num_draws);
+}
+
 static void
 si_draw_rectangle(struct blitter_context *blitter,
 		  void *vertex_elements_cso,
@@ -2228,6 +2303,7 @@ void si_trace_emit(struct si_context *sctx)
 void si_init_draw_functions(struct si_context *sctx)
 {
 	sctx->b.draw_vbo = si_draw_vbo;
+	sctx->b.multi_draw = si_multi_draw;
 
 	sctx->blitter->draw_rectangle = si_draw_rectangle;
 
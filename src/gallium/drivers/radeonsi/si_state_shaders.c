@@ -73,7 +73,8 @@ void *si_get_ir_binary(struct si_shader_selector *sel, bool ngg, bool es)
 		shader_variant_flags |= 1 << 0;
 	if (sel->nir)
 		shader_variant_flags |= 1 << 1;
-	if (si_get_wave_size(sel->screen, sel->type, ngg, es) == 32)
+	if ((sel->type == PIPE_SHADER_COMPUTE ? sel->wave_size :
+	     si_get_wave_size(sel->screen, sel->type, ngg, es)) == 32)
 		shader_variant_flags |= 1 << 2;
 	if (sel->force_correct_derivs_after_kill)
 		shader_variant_flags |= 1 << 3;
@@ -1838,6 +1839,37 @@ static void si_shader_selector_key_hw_vs(struct si_context *sctx,
 	key->opt.kill_outputs = ~linked & outputs_written;
 }
 
+static void si_shader_selector_key_ngg_culling(struct si_context *sctx,
+					       struct si_shader_selector *sel,
+					       struct si_shader_key *key)
+{
+	struct si_state_rasterizer *rs = sctx->queued.named.rasterizer;
+
+	if (!sctx->screen->use_ngg_culling ||
+	    !key->as_ngg ||
+	    !sel->info.writes_position ||
+	    sel->info.writes_viewport_index ||
+	    sel->info.properties[TGSI_PROPERTY_VS_WINDOW_SPACE_POSITION] ||
+	    sel->info.properties[TGSI_PROPERTY_VS_BLIT_SGPRS_AMD] ||
+	    rs->rasterizer_discard ||
+	    /* Zero-area culling would remove visible edges and points. */
+	    rs->polygon_mode_enabled)
+		return;
+
+	/* Only triangles are culled. */
+	if (sel->type == PIPE_SHADER_TESS_EVAL &&
+	    (sel->info.properties[TGSI_PROPERTY_TES_POINT_MODE] ||
+	     sel->info.properties[TGSI_PROPERTY_TES_PRIM_MODE] == PIPE_PRIM_LINES))
+		return;
+
+	/* Same as the primitive discard compute shader. */
+	key->opt.ngg_culling = 1;
+	key->opt.ngg_cull_front =
+		sctx->viewports.y_inverted ? rs->cull_back : rs->cull_front;
+	key->opt.ngg_cull_back =
+		sctx->viewports.y_inverted ? rs->cull_front : rs->cull_back;
+}
+
 /* Compute the key for the hw shader variant */
 static inline void si_shader_selector_key(struct pipe_context *ctx,
 					  struct si_shader_selector *sel,
@@ -1860,6 +1892,7 @@ static inline void si_shader_selector_key(struct pipe_context *ctx,
 		} else {
 			key->as_ngg = stages_key.u.ngg;
 			si_shader_selector_key_hw_vs(sctx, sel, key);
+			si_shader_selector_key_ngg_culling(sctx, sel, key);
 
 			if (sctx->ps_shader.cso && sctx->ps_shader.cso->info.uses_primid)
 				key->mono.u.vs_export_prim_id = 1;
@@ -1903,6 +1936,7 @@ static inline void si_shader_selector_key(struct pipe_context *ctx,
 			key->as_es = 1;
 		else {
 			si_shader_selector_key_hw_vs(sctx, sel, key);
+			si_shader_selector_key_ngg_culling(sctx, sel, key);
 
 			if (sctx->ps_shader.cso && sctx->ps_shader.cso->info.uses_primid)
 				key->mono.u.vs_export_prim_id = 1;
@@ -2169,6 +2203,131 @@ static bool si_check_missing_main_part(struct si_screen *sscreen,
 	return true;
 }
 
+/* VARIANT HISTORY
+ *
+ * The keys of the variants built for a shader are saved in the disk cache,
+ * under a key derived from the IR. When the same shader is created again,
+ * usually in a later run of the application, these variants are compiled
+ * on the low priority queue right away instead of when a draw needs them.
+ *
+ * Keys of merged shaders on GFX9+ point to the other selector, so they
+ * aren't saved.
+ */
+
+#define SI_MAX_VARIANT_HISTORY 32
+
+static void si_init_variant_history(struct si_shader_selector *sel,
+				    void *ir_binary)
+{
+	static const char tag[] = "radeonsi variant history";
+	struct disk_cache *cache = sel->screen->disk_shader_cache;
+	uint8_t data[CACHE_KEY_SIZE + sizeof(tag)];
+
+	if (!cache)
+		return;
+
+	disk_cache_compute_key(cache, ir_binary, *(uint32_t*)ir_binary, data);
+	memcpy(data + CACHE_KEY_SIZE, tag, sizeof(tag));
+	disk_cache_compute_key(cache, data, sizeof(data),
+			       sel->variant_history_key);
+	sel->has_variant_history = true;
+}
+
+/* Add a key to the history. The selector mutex must be locked. */
+static void si_record_variant(struct si_shader_selector *sel,
+			      const struct si_shader_key *key)
+{
+	if (!sel->has_variant_history ||
+	    util_dynarray_num_elements(&sel->variant_history,
+				       struct si_shader_key) >= SI_MAX_VARIANT_HISTORY)
+		return;
+
+	util_dynarray_foreach(&sel->variant_history, struct si_shader_key, iter) {
+		if (memcmp(iter, key, sizeof(*key)) == 0)
+			return;
+	}
+
+	util_dynarray_append(&sel->variant_history, struct si_shader_key, *key);
+	disk_cache_put(sel->screen->disk_shader_cache, sel->variant_history_key,
+		       sel->variant_history.data, sel->variant_history.size,
+		       NULL);
+}
+
+static bool si_is_pure_monolithic(struct si_screen *sscreen,
+				  const struct si_shader_key *key)
+{
+	return sscreen->use_monolithic_shaders ||
+	       memcmp(&key->mono, &zeroed.mono, sizeof(key->mono)) != 0;
+}
+
+/* Queue the variants of the history. Called at the end of the initial
+ * compilation.
+ */
+static void si_precompile_variants(struct si_shader_selector *sel)
+{
+	struct si_screen *sscreen = sel->screen;
+	struct si_shader_key *keys;
+	size_t size;
+	unsigned i, num_keys;
+
+	if (!sel->has_variant_history)
+		return;
+
+	keys = disk_cache_get(sscreen->disk_shader_cache,
+			      sel->variant_history_key, &size);
+	if (!keys)
+		return;
+
+	num_keys = size % sizeof(*keys) ? 0 : size / sizeof(*keys);
+	num_keys = MIN2(num_keys, SI_MAX_VARIANT_HISTORY);
+
+	mtx_lock(&sel->mutex);
+	for (i = 0; i < num_keys; i++) {
+		struct si_shader_key *key = &keys[i];
+		bool is_pure_monolithic = si_is_pure_monolithic(sscreen, key);
+		bool has_opt = memcmp(&key->opt, &zeroed.opt, sizeof(key->opt)) != 0;
+		struct si_shader *shader;
+
+		util_dynarray_append(&sel->variant_history, struct si_shader_key,
+				     *key);
+
+		/* Only use main parts that have already been compiled. */
+		if (!is_pure_monolithic && !key->opt.vs_as_prim_discard_cs &&
+		    !*si_get_main_shader_part(sel, key))
+			continue;
+
+		shader = CALLOC_STRUCT(si_shader);
+		if (!shader)
+			break;
+
+		util_queue_fence_init(&shader->ready);
+
+		/* Same as in si_shader_select_with_key. */
+		shader->selector = sel;
+		shader->key = *key;
+		shader->is_monolithic = is_pure_monolithic || has_opt;
+		shader->is_optimized =
+			(!is_pure_monolithic || key->opt.vs_as_prim_discard_cs) &&
+			has_opt;
+		shader->is_precompiled = true;
+
+		util_queue_add_job(&sscreen->shader_compiler_queue_low_priority,
+				   shader, &shader->ready,
+				   si_build_shader_variant_low_priority, NULL);
+
+		if (!sel->last_variant) {
+			sel->first_variant = shader;
+			sel->last_variant = shader;
+		} else {
+			sel->last_variant->next_variant = shader;
+			sel->last_variant = shader;
+		}
+	}
+	mtx_unlock(&sel->mutex);
+
+	free(keys);
+}
+
 /**
  * Select a shader variant according to the shader key.
  *
@@ -2279,9 +2438,7 @@ current_not_ready:
 			util_queue_fence_wait(&previous_stage_sel->ready);
 	}
 
-	bool is_pure_monolithic =
-		sscreen->use_monolithic_shaders ||
-		memcmp(&key->mono, &zeroed.mono, sizeof(key->mono)) != 0;
+	bool is_pure_monolithic = si_is_pure_monolithic(sscreen, key);
 
 	/* Compile the main shader part if it doesn't exist. This can happen
 	 * if the initial guess was wrong.
@@ -2342,6 +2499,9 @@ current_not_ready:
 	si_shader_selector_reference(NULL, &shader->previous_stage_sel,
 				     previous_stage_sel);
 
+	if (!previous_stage_sel)
+		si_record_variant(sel, key);
+
 	/* Monolithic-only shaders don't make a distinction between optimized
 	 * and unoptimized. */
 	shader->is_monolithic =
@@ -2507,6 +2667,8 @@ static void si_init_shader_selector_async(void *job, int thread_index)
 		if (sel->tokens || sel->nir) {
 			ir_binary = si_get_ir_binary(sel, shader->key.as_ngg,
 						     shader->key.as_es);
+			if (ir_binary)
+				si_init_variant_history(sel, ir_binary);
 		}
 
 		/* Try to load the shader from the shader cache. */
@@ -2594,6 +2756,8 @@ static void si_init_shader_selector_async(void *job, int thread_index)
 
 		si_shader_vs(sscreen, sel->gs_copy_shader, sel);
 	}
+
+	si_precompile_variants(sel);
 }
 
 void si_schedule_initial_compile(struct si_context *sctx, unsigned processor,
@@ -3185,7 +3349,7 @@ static void si_bind_ps_shader(struct pipe_context *ctx, void *state)
 
 static void si_delete_shader(struct si_context *sctx, struct si_shader *shader)
 {
-	if (shader->is_optimized) {
+	if (shader->is_optimized || shader->is_precompiled) {
 		util_queue_drop_job(&sctx->screen->shader_compiler_queue_low_priority,
 				    &shader->ready);
 	}
@@ -3281,6 +3445,7 @@ void si_destroy_shader_selector(struct si_context *sctx,
 
 	util_queue_fence_destroy(&sel->ready);
 	mtx_destroy(&sel->mutex);
+	util_dynarray_fini(&sel->variant_history);
 	free(sel->tokens);
 	ralloc_free(sel->nir);
 	free(sel);
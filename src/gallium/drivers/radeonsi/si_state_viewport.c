@@ -310,6 +310,42 @@ static void si_emit_scissors(struct si_context *ctx)
 	}
 }
 
+/**
+ * Upload the constants of NGG primitive culling: the scale and translation of
+ * viewport 0 in samples, and the small primitive culling precision.
+ * See si_dispatch_prim_discard_cs_and_draw, which computes the same values.
+ */
+void si_update_ngg_culling_constants(struct si_context *ctx)
+{
+	struct pipe_viewport_state *vp = &ctx->viewports.states[0];
+	unsigned num_samples = MAX2(ctx->framebuffer.nr_samples, 1);
+	unsigned quant_mode = ctx->viewports.as_scissor[0].quant_mode;
+	struct pipe_constant_buffer cb = {};
+	float consts[8] = {};
+
+	for (unsigned i = 0; i < 2; i++) {
+		consts[i] = vp->scale[i] * num_samples;
+		consts[2 + i] = vp->translate[i] * num_samples;
+	}
+
+	/* The bounding box of the clip space has to stay min <= max. */
+	if (ctx->viewports.y_inverted) {
+		consts[1] = -consts[1];
+		consts[3] = -consts[3];
+	}
+
+	if (quant_mode == SI_QUANT_MODE_12_12_FIXED_POINT_1_4096TH)
+		consts[4] = num_samples / 4096.0;
+	else if (quant_mode == SI_QUANT_MODE_14_10_FIXED_POINT_1_1024TH)
+		consts[4] = num_samples / 1024.0;
+	else
+		consts[4] = num_samples / 256.0;
+
+	cb.user_buffer = consts;
+	cb.buffer_size = sizeof(consts);
+	si_set_rw_buffer(ctx, SI_VS_CONST_NGG_CULLING, &cb);
+}
+
 static void si_set_viewport_states(struct pipe_context *pctx,
 				   unsigned start_slot,
 				   unsigned num_viewports,
@@ -381,9 +417,19 @@ static void si_set_viewport_states(struct pipe_context *pctx,
 	}
 
 	if (start_slot == 0) {
+		bool y_inverted = ctx->viewports.y_inverted;
+
 		ctx->viewports.y_inverted =
 			-state->scale[1] + state->translate[1] >
 			state->scale[1] + state->translate[1];
+
+		if (ctx->screen->use_ngg_culling) {
+			/* Face culling in the shader key depends on it. */
+			if (ctx->viewports.y_inverted != y_inverted)
+				ctx->do_update_shaders = true;
+
+			si_update_ngg_culling_constants(ctx);
+		}
 	}
 
 	si_mark_atom_dirty(ctx, &ctx->atoms.s.viewports);
@@ -0,0 +1,716 @@
+/**************************************************************************
+ *
+ * Copyright 2019 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Tile-binned, multithreaded rasterization.
+ *
+ * Points, lines and triangles coming out of the draw module are not
+ * rasterized right away.  Instead, they're binned by the screen-space
+ * tiles their bounding box touches.  At the end of each vbuf batch, the
+ * worker threads replay the bins through their own setup context and quad
+ * pipeline, with the cliprect narrowed to the tile.
+ *
+ * Tiles are statically assigned to threads and have the same size as
+ * the color/depth tile cache tiles, so each cached tile is only ever
+ * touched by one thread.  Since primitives are replayed in submission
+ * order within a tile, and the 16-pixel quad batches of flush_spans()
+ * never straddle a tile boundary, the result is the same as that of the
+ * single-threaded path.
+ *
+ * All of this is synchronous: the batch is finished when sp_bin_flush()
+ * returns, so the vertex data can be referenced directly and no state
+ * needs to be snapshotted beyond a copy of the context per thread.
+ */
+
+#include "sp_bin.h"
+#include "sp_context.h"
+#include "sp_flush.h"
+#include "sp_quad_pipe.h"
+#include "sp_setup.h"
+#include "sp_state.h"
+#include "sp_texture.h"
+#include "sp_tex_sample.h"
+#include "sp_tex_tile_cache.h"
+#include "sp_tile_cache.h"
+#include "pipe/p_shader_tokens.h"
+#include "tgsi/tgsi_exec.h"
+#include "os/os_thread.h"
+#include "util/u_dynarray.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_thread.h"
+
+
+struct sp_bin_prim {
+   const float (*v[3])[4];
+   unsigned first_tile;   /**< the tile which counts the primitive */
+};
+
+
+struct sp_bin_thread {
+   struct sp_bin_context *bin;
+   unsigned index;
+
+   thrd_t thread;
+   pipe_semaphore work_ready;
+   pipe_semaphore work_done;
+
+   /**
+    * Copy of the context, refreshed for every batch, with the objects
+    * below swapped in for the shared ones.
+    */
+   struct softpipe_context sp;
+   struct setup_context *setup;
+
+   struct tgsi_exec_machine *fs_machine;
+   const struct sp_fragment_shader_variant *fs_variant; /**< bound to fs_machine */
+   struct sp_tgsi_sampler *sampler;
+
+   struct softpipe_tile_cache *cbuf_cache[PIPE_MAX_COLOR_BUFS];
+   struct softpipe_tile_cache *zsbuf_cache;
+   struct softpipe_tex_tile_cache *tex_cache[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+
+   struct {
+      struct quad_stage *shade;
+      struct quad_stage *depth_test;
+      struct quad_stage *blend;
+      struct quad_stage *pstipple;
+   } quad;
+};
+
+
+struct sp_bin_context {
+   struct softpipe_context *softpipe;
+
+   unsigned num_threads;
+   unsigned num_started;
+   struct sp_bin_thread *threads;
+   boolean exit_flag;
+
+   /**
+    * Whether the threads' color/depth caches may hold tiles, in which
+    * case the context's own caches are empty until sp_bin_flush_caches().
+    */
+   boolean workers_own_caches;
+
+   /** Primitives of the current batch */
+   struct util_dynarray prims;
+
+   /** Per-tile lists of indices into prims */
+   struct util_dynarray *tiles;
+   unsigned max_tiles;
+   unsigned tiles_x, tiles_y;
+};
+
+
+/**
+ * Bin a primitive by the bounding box of its vertices, grown by 'pad'
+ * pixels.
+ */
+static void
+bin_prim(struct sp_bin_context *bin,
+         const float (*v0)[4],
+         const float (*v1)[4],
+         const float (*v2)[4],
+         float pad)
+{
+   const struct pipe_framebuffer_state *fb = &bin->softpipe->framebuffer;
+   const float (*v[3])[4] = { v0, v1, v2 };
+   float xmin = v0[0][0], ymin = v0[0][1];
+   float xmax = v0[0][0], ymax = v0[0][1];
+   boolean nan = util_is_nan(v0[0][0]) || util_is_nan(v0[0][1]);
+   struct sp_bin_prim prim;
+   unsigned index, tx0, ty0, tx1, ty1, tx, ty, i;
+
+   for (i = 1; i < 3 && v[i]; i++) {
+      nan |= util_is_nan(v[i][0][0]) || util_is_nan(v[i][0][1]);
+      xmin = MIN2(xmin, v[i][0][0]);
+      ymin = MIN2(ymin, v[i][0][1]);
+      xmax = MAX2(xmax, v[i][0][0]);
+      ymax = MAX2(ymax, v[i][0][1]);
+   }
+
+   xmin -= pad;
+   ymin -= pad;
+   xmax += pad;
+   ymax += pad;
+
+   if (nan || util_is_nan(pad)) {
+      /* There's no telling which pixels setup will produce, so the
+       * primitive goes everywhere and the cliprect sorts it out.
+       */
+      tx0 = ty0 = 0;
+      tx1 = bin->tiles_x - 1;
+      ty1 = bin->tiles_y - 1;
+   }
+   else if (xmax < 0.0f || ymax < 0.0f ||
+            xmin >= (float) fb->width || ymin >= (float) fb->height) {
+      /* Nothing to draw, but setup still has to count the primitive. */
+      tx0 = tx1 = ty0 = ty1 = 0;
+   }
+   else {
+      tx0 = (unsigned) MAX2(xmin, 0.0f) / TILE_SIZE;
+      ty0 = (unsigned) MAX2(ymin, 0.0f) / TILE_SIZE;
+      tx1 = (unsigned) MIN2(xmax, (float) (fb->width - 1)) / TILE_SIZE;
+      ty1 = (unsigned) MIN2(ymax, (float) (fb->height - 1)) / TILE_SIZE;
+   }
+
+   prim.v[0] = v0;
+   prim.v[1] = v1;
+   prim.v[2] = v2;
+   prim.first_tile = ty0 * bin->tiles_x + tx0;
+
+   index = util_dynarray_num_elements(&bin->prims, struct sp_bin_prim);
+   util_dynarray_append(&bin->prims, struct sp_bin_prim, prim);
+
+   for (ty = ty0; ty <= ty1; ty++) {
+      for (tx = tx0; tx <= tx1; tx++) {
+         util_dynarray_append(&bin->tiles[ty * bin->tiles_x + tx],
+                              unsigned, index);
+      }
+   }
+}
+
+
+/*
+ * Lines and triangles are padded by a pixel, which covers any rounding in
+ * setup and the pixel center offset.
+ */
+
+void
+sp_bin_tri(struct sp_bin_context *bin,
+           const float (*v0)[4],
+           const float (*v1)[4],
+           const float (*v2)[4])
+{
+   bin_prim(bin, v0, v1, v2, 1.0f);
+}
+
+
+void
+sp_bin_line(struct sp_bin_context *bin,
+            const float (*v0)[4],
+            const float (*v1)[4])
+{
+   bin_prim(bin, v0, v1, NULL, 1.0f);
+}
+
+
+void
+sp_bin_point(struct sp_bin_context *bin,
+             const float (*v0)[4])
+{
+   const struct softpipe_context *sp = bin->softpipe;
+   const float size = sp->psize_slot > 0 ? v0[sp->psize_slot][0]
+                                         : sp->rasterizer->point_size;
+
+   bin_prim(bin, v0, NULL, NULL, 0.5f * fabsf(size) + 1.0f);
+}
+
+
+/**
+ * Called from setup for each new batch of primitives.  Returns whether
+ * they should be binned; if not, the context's own caches are brought up
+ * to date for the single-threaded path.
+ */
+boolean
+sp_bin_prepare(struct sp_bin_context *bin)
+{
+   struct softpipe_context *sp = bin->softpipe;
+   const struct tgsi_shader_info *info;
+   unsigned num_tiles, i, j;
+
+   if (!sp->fs_variant || !sp->framebuffer.width || !sp->framebuffer.height)
+      goto serial;
+
+   /* Stores from shaders running on different threads would race. */
+   info = &sp->fs_variant->info;
+   if (info->file_count[TGSI_FILE_IMAGE] ||
+       info->file_count[TGSI_FILE_BUFFER] ||
+       info->file_count[TGSI_FILE_HW_ATOMIC])
+      goto serial;
+
+   for (i = 0; i < bin->num_threads; i++) {
+      struct sp_bin_thread *t = &bin->threads[i];
+
+      for (j = 0; j < sp->num_sampler_views[PIPE_SHADER_FRAGMENT]; j++) {
+         if (!t->tex_cache[j]) {
+            t->tex_cache[j] = sp_create_tex_tile_cache(&sp->pipe);
+            if (!t->tex_cache[j])
+               goto serial;
+         }
+      }
+   }
+
+   bin->tiles_x = DIV_ROUND_UP(sp->framebuffer.width, TILE_SIZE);
+   bin->tiles_y = DIV_ROUND_UP(sp->framebuffer.height, TILE_SIZE);
+   num_tiles = bin->tiles_x * bin->tiles_y;
+
+   if (num_tiles > bin->max_tiles) {
+      struct util_dynarray *tiles =
+         REALLOC(bin->tiles, bin->max_tiles * sizeof(*tiles),
+                 num_tiles * sizeof(*tiles));
+      if (!tiles)
+         goto serial;
+
+      for (i = bin->max_tiles; i < num_tiles; i++)
+         util_dynarray_init(&tiles[i], NULL);
+
+      bin->tiles = tiles;
+      bin->max_tiles = num_tiles;
+   }
+
+   return TRUE;
+
+serial:
+   sp_bin_flush_caches(bin, 0);
+   return FALSE;
+}
+
+
+static void
+update_samplers(struct sp_bin_thread *t)
+{
+   const struct softpipe_context *sp = t->bin->softpipe;
+   unsigned i;
+
+   memcpy(t->sampler, sp->tgsi.sampler[PIPE_SHADER_FRAGMENT],
+          sizeof(*t->sampler));
+
+   for (i = 0; i < sp->num_sampler_views[PIPE_SHADER_FRAGMENT]; i++) {
+      struct pipe_sampler_view *view =
+         sp->sampler_views[PIPE_SHADER_FRAGMENT][i];
+      struct softpipe_tex_tile_cache *tc = t->tex_cache[i];
+
+      sp_tex_tile_cache_set_sampler_view(tc, view);
+
+      if (tc->texture) {
+         struct softpipe_resource *spt = softpipe_resource(tc->texture);
+         if (spt->timestamp != tc->timestamp) {
+            sp_tex_tile_cache_validate_texture(tc);
+            tc->timestamp = spt->timestamp;
+         }
+      }
+
+      if (view)
+         t->sampler->sp_sview[i].cache = tc;
+   }
+}
+
+
+/**
+ * Refresh a thread's copy of the context.  Runs on the context's thread.
+ */
+static void
+thread_begin(struct sp_bin_thread *t)
+{
+   struct softpipe_context *sp = t->bin->softpipe;
+   struct softpipe_context *tsp = &t->sp;
+
+   memcpy(tsp, sp, sizeof(*tsp));
+
+   tsp->bin = NULL;
+   tsp->dirty = 0;
+   tsp->occlusion_count = 0;
+   memset(&tsp->pipeline_statistics, 0, sizeof(tsp->pipeline_statistics));
+
+   memcpy(tsp->cbuf_cache, t->cbuf_cache, sizeof(tsp->cbuf_cache));
+   tsp->zsbuf_cache = t->zsbuf_cache;
+
+   tsp->quad.shade = t->quad.shade;
+   tsp->quad.depth_test = t->quad.depth_test;
+   tsp->quad.blend = t->quad.blend;
+   tsp->quad.pstipple = t->quad.pstipple;
+   sp_build_quad_pipeline(tsp);
+
+   update_samplers(t);
+   tsp->tgsi.sampler[PIPE_SHADER_FRAGMENT] = t->sampler;
+
+   tsp->fs_machine = t->fs_machine;
+   if (t->fs_variant != sp->fs_variant) {
+      sp->fs_variant->prepare(sp->fs_variant, t->fs_machine,
+                              (struct tgsi_sampler *) t->sampler,
+                              (struct tgsi_image *)
+                              sp->tgsi.image[PIPE_SHADER_FRAGMENT],
+                              (struct tgsi_buffer *)
+                              sp->tgsi.buffer[PIPE_SHADER_FRAGMENT]);
+      t->fs_variant = sp->fs_variant;
+   }
+}
+
+
+/**
+ * Fold a thread's counters back into the context.
+ */
+static void
+thread_end(struct sp_bin_thread *t)
+{
+   struct softpipe_context *sp = t->bin->softpipe;
+
+   sp->occlusion_count += t->sp.occlusion_count;
+   sp->pipeline_statistics.ps_invocations +=
+      t->sp.pipeline_statistics.ps_invocations;
+   sp->pipeline_statistics.c_primitives +=
+      t->sp.pipeline_statistics.c_primitives;
+}
+
+
+static void
+set_tile_cliprects(struct sp_bin_thread *t, unsigned tx, unsigned ty)
+{
+   const struct softpipe_context *sp = t->bin->softpipe;
+   const unsigned x0 = tx * TILE_SIZE, x1 = x0 + TILE_SIZE;
+   const unsigned y0 = ty * TILE_SIZE, y1 = y0 + TILE_SIZE;
+   unsigned i;
+
+   for (i = 0; i < PIPE_MAX_VIEWPORTS; i++) {
+      const struct pipe_scissor_state *src = &sp->cliprect[i];
+      struct pipe_scissor_state *dst = &t->sp.cliprect[i];
+
+      dst->minx = MAX2(src->minx, x0);
+      dst->miny = MAX2(src->miny, y0);
+      dst->maxx = MAX2(MIN2(src->maxx, x1), dst->minx);
+      dst->maxy = MAX2(MIN2(src->maxy, y1), dst->miny);
+   }
+}
+
+
+static void
+rasterize_tiles(struct sp_bin_thread *t)
+{
+   const struct sp_bin_context *bin = t->bin;
+   const struct sp_bin_prim *prims = bin->prims.data;
+   const unsigned num_tiles = bin->tiles_x * bin->tiles_y;
+   unsigned tile;
+
+   sp_setup_prepare(t->setup);
+
+   for (tile = t->index; tile < num_tiles; tile += bin->num_threads) {
+      const struct util_dynarray *list = &bin->tiles[tile];
+
+      if (!list->size)
+         continue;
+
+      set_tile_cliprects(t, tile % bin->tiles_x, tile / bin->tiles_x);
+
+      util_dynarray_foreach(list, unsigned, index) {
+         const struct sp_bin_prim *prim = &prims[*index];
+
+         sp_setup_count_prims(t->setup, prim->first_tile == tile);
+
+         switch (t->sp.reduced_prim) {
+         case PIPE_PRIM_TRIANGLES:
+            sp_setup_tri(t->setup, prim->v[0], prim->v[1], prim->v[2]);
+            break;
+         case PIPE_PRIM_LINES:
+            sp_setup_line(t->setup, prim->v[0], prim->v[1]);
+            break;
+         case PIPE_PRIM_POINTS:
+            sp_setup_point(t->setup, prim->v[0]);
+            break;
+         default:
+            assert(0);
+         }
+      }
+   }
+}
+
+
+/**
+ * Rasterize the binned primitives and wait for the threads to finish.
+ */
+void
+sp_bin_flush(struct sp_bin_context *bin)
+{
+   struct softpipe_context *sp = bin->softpipe;
+   const unsigned num_tiles = bin->tiles_x * bin->tiles_y;
+   unsigned i;
+
+   if (!bin->prims.size)
+      return;
+
+   if (!bin->workers_own_caches) {
+      for (i = 0; i < sp->framebuffer.nr_cbufs; i++)
+         if (sp->cbuf_cache[i])
+            sp_flush_tile_cache(sp->cbuf_cache[i]);
+
+      if (sp->zsbuf_cache)
+         sp_flush_tile_cache(sp->zsbuf_cache);
+
+      bin->workers_own_caches = TRUE;
+   }
+
+   for (i = 0; i < bin->num_threads; i++) {
+      thread_begin(&bin->threads[i]);
+      pipe_semaphore_signal(&bin->threads[i].work_ready);
+   }
+
+   for (i = 0; i < bin->num_threads; i++) {
+      pipe_semaphore_wait(&bin->threads[i].work_done);
+      thread_end(&bin->threads[i]);
+   }
+
+   util_dynarray_clear(&bin->prims);
+   for (i = 0; i < num_tiles; i++)
+      util_dynarray_clear(&bin->tiles[i]);
+}
+
+
+/**
+ * Write back the threads' color/depth tiles, so the context can access
+ * the surfaces again.  With SP_FLUSH_TEXTURE_CACHE, drop the threads'
+ * cached texture tiles as well.
+ */
+void
+sp_bin_flush_caches(struct sp_bin_context *bin, unsigned flags)
+{
+   unsigned i, j;
+
+   for (i = 0; i < bin->num_threads; i++) {
+      struct sp_bin_thread *t = &bin->threads[i];
+
+      if (bin->workers_own_caches) {
+         for (j = 0; j < PIPE_MAX_COLOR_BUFS; j++)
+            sp_flush_tile_cache(t->cbuf_cache[j]);
+         sp_flush_tile_cache(t->zsbuf_cache);
+      }
+
+      if (flags & SP_FLUSH_TEXTURE_CACHE) {
+         for (j = 0; j < PIPE_MAX_SHADER_SAMPLER_VIEWS; j++)
+            if (t->tex_cache[j])
+               sp_flush_tex_tile_cache(t->tex_cache[j]);
+      }
+   }
+
+   bin->workers_own_caches = FALSE;
+}
+
+
+/**
+ * Point the threads' caches at a new framebuffer.  Called before the
+ * context's framebuffer state changes, while the old surfaces are alive.
+ */
+void
+sp_bin_set_framebuffer(struct sp_bin_context *bin,
+                       const struct pipe_framebuffer_state *fb)
+{
+   unsigned i, j;
+
+   sp_bin_flush_caches(bin, 0);
+
+   for (i = 0; i < bin->num_threads; i++) {
+      struct sp_bin_thread *t = &bin->threads[i];
+
+      for (j = 0; j < PIPE_MAX_COLOR_BUFS; j++)
+         sp_tile_cache_set_surface(t->cbuf_cache[j],
+                                   j < fb->nr_cbufs ? fb->cbufs[j] : NULL);
+      sp_tile_cache_set_surface(t->zsbuf_cache, fb->zsbuf);
+   }
+}
+
+
+/**
+ * Unbind a fragment shader variant which is about to be deleted.
+ */
+void
+sp_bin_delete_fs_variant(struct sp_bin_context *bin,
+                         const struct sp_fragment_shader_variant *var)
+{
+   unsigned i;
+
+   for (i = 0; i < bin->num_threads; i++) {
+      struct sp_bin_thread *t = &bin->threads[i];
+
+      if (t->fs_variant == var) {
+         tgsi_exec_machine_bind_shader(t->fs_machine, NULL, NULL, NULL, NULL);
+         t->fs_variant = NULL;
+      }
+   }
+}
+
+
+static int
+thread_function(void *init_data)
+{
+   struct sp_bin_thread *t = (struct sp_bin_thread *) init_data;
+   char thread_name[16];
+
+   snprintf(thread_name, sizeof thread_name, "softpipe-%u", t->index);
+   u_thread_setname(thread_name);
+
+   while (1) {
+      pipe_semaphore_wait(&t->work_ready);
+
+      if (t->bin->exit_flag)
+         break;
+
+      rasterize_tiles(t);
+
+      pipe_semaphore_signal(&t->work_done);
+   }
+
+#ifdef _WIN32
+   pipe_semaphore_signal(&t->work_done);
+#endif
+
+   return 0;
+}
+
+
+static boolean
+init_thread(struct sp_bin_context *bin, struct sp_bin_thread *t,
+            unsigned index)
+{
+   struct pipe_context *pipe = &bin->softpipe->pipe;
+   unsigned i;
+
+   t->bin = bin;
+   t->index = index;
+
+   t->setup = sp_setup_create_context(&t->sp);
+   t->fs_machine = tgsi_exec_machine_create(PIPE_SHADER_FRAGMENT);
+   t->sampler = sp_create_tgsi_sampler();
+   if (!t->setup || !t->fs_machine || !t->sampler)
+      return FALSE;
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+      t->cbuf_cache[i] = sp_create_tile_cache(pipe);
+      if (!t->cbuf_cache[i])
+         return FALSE;
+   }
+   t->zsbuf_cache = sp_create_tile_cache(pipe);
+
+   t->quad.shade = sp_quad_shade_stage(&t->sp);
+   t->quad.depth_test = sp_quad_depth_test_stage(&t->sp);
+   t->quad.blend = sp_quad_blend_stage(&t->sp);
+   t->quad.pstipple = sp_quad_polygon_stipple_stage(&t->sp);
+
+   return t->zsbuf_cache && t->quad.shade && t->quad.depth_test &&
+          t->quad.blend && t->quad.pstipple;
+}
+
+
+static void
+destroy_thread(struct sp_bin_thread *t)
+{
+   unsigned i;
+
+   if (t->quad.shade)
+      t->quad.shade->destroy(t->quad.shade);
+   if (t->quad.depth_test)
+      t->quad.depth_test->destroy(t->quad.depth_test);
+   if (t->quad.blend)
+      t->quad.blend->destroy(t->quad.blend);
+   if (t->quad.pstipple)
+      t->quad.pstipple->destroy(t->quad.pstipple);
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++)
+      sp_destroy_tile_cache(t->cbuf_cache[i]);
+   sp_destroy_tile_cache(t->zsbuf_cache);
+
+   for (i = 0; i < PIPE_MAX_SHADER_SAMPLER_VIEWS; i++)
+      sp_destroy_tex_tile_cache(t->tex_cache[i]);
+
+   FREE(t->sampler);
+   tgsi_exec_machine_destroy(t->fs_machine);
+   if (t->setup)
+      sp_setup_destroy_context(t->setup);
+}
+
+
+struct sp_bin_context *
+sp_bin_create(struct softpipe_context *softpipe, unsigned num_threads)
+{
+   struct sp_bin_context *bin = CALLOC_STRUCT(sp_bin_context);
+   unsigned i;
+
+   if (!bin)
+      return NULL;
+
+   bin->softpipe = softpipe;
+   bin->num_threads = MIN2(num_threads, SP_BIN_MAX_THREADS);
+   util_dynarray_init(&bin->prims, NULL);
+
+   bin->threads = CALLOC(bin->num_threads, sizeof(bin->threads[0]));
+   if (!bin->threads)
+      goto fail;
+
+   for (i = 0; i < bin->num_threads; i++) {
+      if (!init_thread(bin, &bin->threads[i], i))
+         goto fail;
+   }
+
+   for (i = 0; i < bin->num_threads; i++) {
+      struct sp_bin_thread *t = &bin->threads[i];
+
+      pipe_semaphore_init(&t->work_ready, 0);
+      pipe_semaphore_init(&t->work_done, 0);
+      t->thread = u_thread_create(thread_function, t);
+      bin->num_started++;
+   }
+
+   return bin;
+
+fail:
+   sp_bin_destroy(bin);
+   return NULL;
+}
+
+
+void
+sp_bin_destroy(struct sp_bin_context *bin)
+{
+   unsigned i;
+
+   /* Wake the threads up with exit_flag set, so they leave their loop. */
+   bin->exit_flag = TRUE;
+   for (i = 0; i < bin->num_started; i++)
+      pipe_semaphore_signal(&bin->threads[i].work_ready);
+
+   for (i = 0; i < bin->num_started; i++) {
+#ifdef _WIN32
+      pipe_semaphore_wait(&bin->threads[i].work_done);
+#else
+      thrd_join(bin->threads[i].thread, NULL);
+#endif
+      pipe_semaphore_destroy(&bin->threads[i].work_ready);
+      pipe_semaphore_destroy(&bin->threads[i].work_done);
+   }
+
+   if (bin->threads) {
+      for (i = 0; i < bin->num_threads; i++)
+         destroy_thread(&bin->threads[i]);
+      FREE(bin->threads);
+   }
+
+   for (i = 0; i < bin->max_tiles; i++)
+      util_dynarray_fini(&bin->tiles[i]);
+   FREE(bin->tiles);
+   util_dynarray_fini(&bin->prims);
+
+   FREE(bin);
+}
@@ -35,6 +35,7 @@
 #include "pipe/p_defines.h"
 #include "util/u_pack_color.h"
 #include "util/u_surface.h"
+#include "sp_bin.h"
 #include "sp_clear.h"
 #include "sp_context.h"
 #include "sp_query.h"
@@ -62,6 +63,10 @@ softpipe_clear(struct pipe_context *pipe, unsigned buffers,
    if (!softpipe_check_render_cond(softpipe))
       return;
 
+   /* The clear goes through the context's tile caches. */
+   if (softpipe->bin)
+      sp_bin_flush_caches(softpipe->bin, 0);
+
 #if 0
    softpipe_update_derived(softpipe, PIPE_PRIM_TRIANGLES); /* not needed?? */
 #endif
@@ -39,6 +39,7 @@
 #include "util/u_inlines.h"
 #include "util/u_upload_mgr.h"
 #include "tgsi/tgsi_exec.h"
+#include "sp_bin.h"
 #include "sp_buffer.h"
 #include "sp_clear.h"
 #include "sp_context.h"
@@ -60,6 +61,11 @@ softpipe_destroy( struct pipe_context *pipe )
    struct softpipe_context *softpipe = softpipe_context( pipe );
    uint i, sh;
 
+   if (softpipe->bin) {
+      sp_bin_destroy(softpipe->bin);
+      softpipe->bin = NULL;
+   }
+
 #if DO_PSTIPPLE_IN_HELPER_MODULE
    if (softpipe->pstipple.sampler)
       pipe->delete_sampler_state(pipe, softpipe->pstipple.sampler);
@@ -198,6 +204,7 @@ softpipe_create_context(struct pipe_screen *screen,
 {
    struct softpipe_screen *sp_screen = softpipe_screen(screen);
    struct softpipe_context *softpipe = CALLOC_STRUCT(softpipe_context);
+   unsigned num_threads;
    uint i, sh;
 
    util_init_math();
@@ -319,6 +326,13 @@ softpipe_create_context(struct pipe_screen *screen,
    if (debug_get_bool_option( "SOFTPIPE_NO_RAST", false ))
       softpipe->no_rast = TRUE;
 
+   /* Bin primitives by tile and rasterize them on this many threads.
+    * If that can't be set up, we just stay single-threaded.
+    */
+   num_threads = debug_get_num_option("SOFTPIPE_NUM_THREADS", 0);
+   if (num_threads > 0)
+      softpipe->bin = sp_bin_create(softpipe, num_threads);
+
    softpipe->vbuf_backend = sp_create_vbuf_backend(softpipe);
    if (!softpipe->vbuf_backend)
       goto fail;
@@ -48,6 +48,7 @@
 
 
 struct softpipe_vbuf_render;
+struct sp_bin_context;
 struct draw_context;
 struct draw_stage;
 struct softpipe_tile_cache;
@@ -183,6 +184,9 @@ struct softpipe_context {
    /** The primitive drawing context */
    struct draw_context *draw;
 
+   /** Tile binning for threaded rasterization, or NULL */
+   struct sp_bin_context *bin;
+
    /** Draw module backend */
    struct vbuf_render *vbuf_backend;
    struct draw_stage *vbuf;
@@ -32,6 +32,7 @@
  * \author  Brian Paul
  */
 
+#include "sp_bin.h"
 #include "sp_context.h"
 #include "sp_quad.h"
 #include "sp_quad_pipe.h"
@@ -113,6 +114,9 @@ struct setup_context {
 
    unsigned cull_face;		/* which faces cull */
    unsigned nr_vertex_attrs;
+
+   struct sp_bin_context *bin;  /**< if set, primitives are binned */
+   boolean count_prims;         /**< update the clipper primitive count */
 };
 
 
@@ -810,6 +814,11 @@ sp_setup_tri(struct setup_context *setup,
 
    if (setup->softpipe->no_rast || setup->softpipe->rasterizer->rasterizer_discard)
       return;
+
+   if (setup->bin) {
+      sp_bin_tri(setup->bin, v0, v1, v2);
+      return;
+   }
    
    det = calc_det(v0, v1, v2);
    /*
@@ -862,7 +871,7 @@ sp_setup_tri(struct setup_context *setup,
 
    flush_spans( setup );
 
-   if (setup->softpipe->active_statistics_queries) {
+   if (setup->softpipe->active_statistics_queries && setup->count_prims) {
       setup->softpipe->pipeline_statistics.c_primitives++;
    }
 
@@ -1099,6 +1108,11 @@ sp_setup_line(struct setup_context *setup,
    if (dx == 0 && dy == 0)
       return;
 
+   if (setup->bin) {
+      sp_bin_line(setup->bin, v0, v1);
+      return;
+   }
+
    if (!setup_line_coefficients(setup, v0, v1))
       return;
 
@@ -1243,6 +1257,11 @@ sp_setup_point(struct setup_context *setup,
    if (setup->softpipe->no_rast || setup->softpipe->rasterizer->rasterizer_discard)
       return;
 
+   if (setup->bin) {
+      sp_bin_point(setup->bin, v0);
+      return;
+   }
+
    assert(setup->softpipe->reduced_prim == PIPE_PRIM_POINTS);
 
    if (setup->softpipe->layer_slot > 0) {
@@ -1447,6 +1466,8 @@ sp_setup_prepare(struct setup_context *setup)
       softpipe_update_derived(sp, sp->reduced_api_prim);
    }
 
+   setup->bin = sp->bin && sp_bin_prepare(sp->bin) ? sp->bin : NULL;
+
    /* Note: nr_attrs is only used for debugging (vertex printing) */
    setup->nr_vertex_attrs = draw_num_shader_outputs(sp->draw);
 
@@ -1492,6 +1513,18 @@ sp_setup_prepare(struct setup_context *setup)
 }
 
 
+/**
+ * Tell setup whether to count the primitives it processes towards the
+ * clipper statistics.  Used when the same primitive is set up once per
+ * tile.
+ */
+void
+sp_setup_count_prims(struct setup_context *setup, boolean count)
+{
+   setup->count_prims = count;
+}
+
+
 void
 sp_setup_destroy_context(struct setup_context *setup)
 {
@@ -1509,6 +1542,7 @@ sp_setup_create_context(struct softpipe_context *softpipe)
    unsigned i;
 
    setup->softpipe = softpipe;
+   setup->count_prims = TRUE;
 
    for (i = 0; i < MAX_QUADS; i++) {
       setup->quad[i].coef = setup->coef;
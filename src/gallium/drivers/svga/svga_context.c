@@ -58,6 +58,7 @@ static void
 svga_destroy(struct pipe_context *pipe)
 {
    struct svga_context *svga = svga_context(pipe);
+   struct svga_winsys_screen *sws = svga_screen(pipe->screen)->sws;
    unsigned shader, i;
 
    /* free any alternate rasterizer states used for point sprite */
@@ -95,6 +96,7 @@ svga_destroy(struct pipe_context *pipe)
    svga_destroy_swtnl(svga);
    svga_hwtnl_destroy(svga->hwtnl);
 
+   sws->fence_reference(sws, &svga->last_fence, NULL);
    svga->swc->destroy(svga->swc);
 
    util_bitmask_destroy(svga->blend_object_id_bm);
@@ -380,6 +382,8 @@ svga_context_flush(struct svga_context *svga,
    svga->hud.flush_time += (svga_get_time(svga) - t0);
 
    svga->hud.num_flushes++;
+   svga->flush_count++;
+   svgascreen->sws->fence_reference(svgascreen->sws, &svga->last_fence, fence);
 
    svga_screen_cache_flush(svgascreen, svga, fence);
 
@@ -59,6 +59,9 @@ enum svga_hud {
    SVGA_QUERY_COMMAND_BUFFER_SIZE,
    SVGA_QUERY_FLUSH_TIME,
    SVGA_QUERY_SURFACE_WRITE_FLUSHES,
+   SVGA_QUERY_PIPE_FLUSHES,
+   SVGA_QUERY_MAP_FLUSHES,
+   SVGA_QUERY_QUERY_FLUSHES,
    SVGA_QUERY_NUM_READBACKS,
    SVGA_QUERY_NUM_RESOURCE_UPDATES,
    SVGA_QUERY_NUM_BUFFER_UPLOADS,
@@ -533,6 +536,10 @@ struct svga_context
                                               /**< query mem block mapping */
    struct svga_query *sq[SVGA_QUERY_MAX];     /**< queries currently in progress */
 
+   /** Number of command buffer flushes and the fence of the last one */
+   unsigned flush_count;
+   struct pipe_fence_handle *last_fence;
+
    /** List of buffers with queued transfers */
    struct list_head dirty_buffers;
 
@@ -548,6 +555,9 @@ struct svga_context
       uint64_t command_buffer_size;     /**< SVGA_QUERY_COMMAND_BUFFER_SIZE */
       uint64_t flush_time;              /**< SVGA_QUERY_FLUSH_TIME */
       uint64_t surface_write_flushes;   /**< SVGA_QUERY_SURFACE_WRITE_FLUSHES */
+      uint64_t pipe_flushes;            /**< SVGA_QUERY_PIPE_FLUSHES */
+      uint64_t map_flushes;             /**< SVGA_QUERY_MAP_FLUSHES */
+      uint64_t query_flushes;           /**< SVGA_QUERY_QUERY_FLUSHES */
       uint64_t num_readbacks;           /**< SVGA_QUERY_NUM_READBACKS */
       uint64_t num_resource_updates;    /**< SVGA_QUERY_NUM_RESOURCE_UPDATES */
       uint64_t num_buffer_uploads;      /**< SVGA_QUERY_NUM_BUFFER_UPLOADS */
@@ -37,6 +37,7 @@ static void svga_flush( struct pipe_context *pipe,
                         unsigned flags)
 {
    struct svga_context *svga = svga_context(pipe);
+   uint64_t num_flushes = svga->hud.num_flushes;
 
    /* Emit buffered drawing commands, and any back copies.
     */
@@ -49,6 +50,8 @@ static void svga_flush( struct pipe_context *pipe,
     */
    svga_context_flush(svga, fence);
 
+   svga->hud.pipe_flushes += svga->hud.num_flushes - num_flushes;
+
    SVGA_DBG(DEBUG_DMA|DEBUG_PERF, "%s fence_ptr %p\n",
             __FUNCTION__, fence ? *fence : 0x0);
 
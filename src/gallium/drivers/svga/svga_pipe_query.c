@@ -52,6 +52,7 @@ struct svga_query {
    unsigned id;                    /** Per-context query identifier */
 
    struct pipe_fence_handle *fence;
+   unsigned end_flush_count;       /**< svga->flush_count at end_query */
 
    /** For PIPE_QUERY_OCCLUSION_COUNTER / SVGA3D_QUERYTYPE_OCCLUSION */
 
@@ -622,6 +623,7 @@ end_query_vgpu10(struct svga_context *svga, struct svga_query *sq)
       svga_context_flush(svga, NULL);
       ret = SVGA3D_vgpu10_EndQuery(svga->swc, sq->id);
    }
+   sq->end_flush_count = svga->flush_count;
 
    return ret;
 }
@@ -640,12 +642,20 @@ get_query_result_vgpu10(struct svga_context *svga, struct svga_query *sq,
    sws->query_get_result(sws, sq->gb_query, sq->offset, &queryState, result, resultLen);
 
    if (queryState != SVGA3D_QUERYSTATE_SUCCEEDED && !sq->fence) {
-      /* We don't have the query result yet, and the query hasn't been
-       * submitted.  We need to submit it now since the GL spec says
-       * "Querying the state for a given occlusion query forces that
-       * occlusion query to complete within a finite amount of time."
-       */
-      svga_context_flush(svga, &sq->fence);
+      if (svga->flush_count != sq->end_flush_count && svga->last_fence) {
+         /* The query was submitted by a flush after it ended, for example
+          * a SwapBuffers, so any later fence covers it.
+          */
+         sws->fence_reference(sws, &sq->fence, svga->last_fence);
+      }
+      else {
+         /* We don't have the query result yet, and the query hasn't been
+          * submitted.  We need to submit it now since the GL spec says
+          * "Querying the state for a given occlusion query forces that
+          * occlusion query to complete within a finite amount of time."
+          */
+         svga_context_flush(svga, &sq->fence);
+      }
    }
 
    if (queryState == SVGA3D_QUERYSTATE_PENDING ||
@@ -739,6 +749,9 @@ svga_create_query(struct pipe_context *pipe,
    case SVGA_QUERY_NUM_BYTES_UPLOADED:
    case SVGA_QUERY_COMMAND_BUFFER_SIZE:
    case SVGA_QUERY_SURFACE_WRITE_FLUSHES:
+   case SVGA_QUERY_PIPE_FLUSHES:
+   case SVGA_QUERY_MAP_FLUSHES:
+   case SVGA_QUERY_QUERY_FLUSHES:
    case SVGA_QUERY_MEMORY_USED:
    case SVGA_QUERY_NUM_SHADERS:
    case SVGA_QUERY_NUM_RESOURCES:
@@ -821,6 +834,9 @@ svga_destroy_query(struct pipe_context *pipe, struct pipe_query *q)
    case SVGA_QUERY_COMMAND_BUFFER_SIZE:
    case SVGA_QUERY_FLUSH_TIME:
    case SVGA_QUERY_SURFACE_WRITE_FLUSHES:
+   case SVGA_QUERY_PIPE_FLUSHES:
+   case SVGA_QUERY_MAP_FLUSHES:
+   case SVGA_QUERY_QUERY_FLUSHES:
    case SVGA_QUERY_MEMORY_USED:
    case SVGA_QUERY_NUM_SHADERS:
    case SVGA_QUERY_NUM_RESOURCES:
@@ -925,6 +941,15 @@ svga_begin_query(struct pipe_context *pipe, struct pipe_query *q)
    case SVGA_QUERY_SURFACE_WRITE_FLUSHES:
       sq->begin_count = svga->hud.surface_write_flushes;
       break;
+   case SVGA_QUERY_PIPE_FLUSHES:
+      sq->begin_count = svga->hud.pipe_flushes;
+      break;
+   case SVGA_QUERY_MAP_FLUSHES:
+      sq->begin_count = svga->hud.map_flushes;
+      break;
+   case SVGA_QUERY_QUERY_FLUSHES:
+      sq->begin_count = svga->hud.query_flushes;
+      break;
    case SVGA_QUERY_NUM_READBACKS:
       sq->begin_count = svga->hud.num_readbacks;
       break;
@@ -1040,6 +1065,15 @@ svga_end_query(struct pipe_context *pipe, struct pipe_query *q)
    case SVGA_QUERY_SURFACE_WRITE_FLUSHES:
       sq->end_count = svga->hud.surface_write_flushes;
       break;
+   case SVGA_QUERY_PIPE_FLUSHES:
+      sq->end_count = svga->hud.pipe_flushes;
+      break;
+   case SVGA_QUERY_MAP_FLUSHES:
+      sq->end_count = svga->hud.map_flushes;
+      break;
+   case SVGA_QUERY_QUERY_FLUSHES:
+      sq->end_count = svga->hud.query_flushes;
+      break;
    case SVGA_QUERY_NUM_READBACKS:
       sq->end_count = svga->hud.num_readbacks;
       break;
@@ -1083,6 +1117,7 @@ svga_get_query_result(struct pipe_context *pipe,
    struct svga_context *svga = svga_context(pipe);
    struct svga_query *sq = svga_query(q);
    uint64_t *result = (uint64_t *)vresult;
+   uint64_t num_flushes = svga->hud.num_flushes;
    bool ret = true;
 
    assert(sq);
@@ -1166,6 +1201,9 @@ svga_get_query_result(struct pipe_context *pipe,
    case SVGA_QUERY_COMMAND_BUFFER_SIZE:
    case SVGA_QUERY_FLUSH_TIME:
    case SVGA_QUERY_SURFACE_WRITE_FLUSHES:
+   case SVGA_QUERY_PIPE_FLUSHES:
+   case SVGA_QUERY_MAP_FLUSHES:
+   case SVGA_QUERY_QUERY_FLUSHES:
    case SVGA_QUERY_NUM_READBACKS:
    case SVGA_QUERY_NUM_RESOURCE_UPDATES:
    case SVGA_QUERY_NUM_BUFFER_UPLOADS:
@@ -1210,6 +1248,8 @@ svga_get_query_result(struct pipe_context *pipe,
 
    SVGA_DBG(DEBUG_QUERY, "%s result %d\n", __FUNCTION__, *((uint64_t *)vresult));
 
+   svga->hud.query_flushes += svga->hud.num_flushes - num_flushes;
+
    return ret;
 }
 
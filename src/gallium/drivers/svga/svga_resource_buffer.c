@@ -102,6 +102,7 @@ svga_buffer_transfer_map(struct pipe_context *pipe,
    struct pipe_transfer *transfer;
    uint8_t *map = NULL;
    int64_t begin = svga_get_time(svga);
+   uint64_t num_flushes = svga->hud.num_flushes;
 
    SVGA_STATS_TIME_PUSH(svga_sws(svga), SVGA_STATS_TIME_BUFFERTRANSFERMAP);
 
@@ -303,6 +304,7 @@ svga_buffer_transfer_map(struct pipe_context *pipe,
    svga->hud.map_buffer_time += (svga_get_time(svga) - begin);
 
 done:
+   svga->hud.map_flushes += svga->hud.num_flushes - num_flushes;
    SVGA_STATS_TIME_POP(svga_sws(svga));
    return map;
 }
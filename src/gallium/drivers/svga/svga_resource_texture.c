@@ -534,6 +534,7 @@ svga_texture_transfer_map(struct pipe_context *pipe,
                             !svga_have_gb_dma(svga);
    void *map = NULL;
    int64_t begin = svga_get_time(svga);
+   uint64_t num_flushes = svga->hud.num_flushes;
 
    SVGA_STATS_TIME_PUSH(sws, SVGA_STATS_TIME_TEXTRANSFERMAP);
 
@@ -667,6 +668,7 @@ svga_texture_transfer_map(struct pipe_context *pipe,
 
 done:
    svga->hud.map_buffer_time += (svga_get_time(svga) - begin);
+   svga->hud.map_flushes += svga->hud.num_flushes - num_flushes;
    SVGA_STATS_TIME_POP(sws);
    (void) sws;
 
@@ -101,7 +101,7 @@ svga_sampler_view_reference(struct svga_sampler_view **ptr, struct svga_sampler_
 
 boolean
 svga_check_sampler_view_resource_collision(const struct svga_context *svga,
-                                           const struct svga_winsys_surface *res,
+                                           const struct svga_surface *s,
                                            enum pipe_shader_type shader);
 
 boolean
@@ -850,6 +850,12 @@ svga_get_driver_query_info(struct pipe_screen *screen,
             PIPE_DRIVER_QUERY_TYPE_MICROSECONDS),
       QUERY("surface-write-flushes", SVGA_QUERY_SURFACE_WRITE_FLUSHES,
             PIPE_DRIVER_QUERY_TYPE_UINT64),
+      QUERY("pipe-flushes", SVGA_QUERY_PIPE_FLUSHES,
+            PIPE_DRIVER_QUERY_TYPE_UINT64),
+      QUERY("map-flushes", SVGA_QUERY_MAP_FLUSHES,
+            PIPE_DRIVER_QUERY_TYPE_UINT64),
+      QUERY("query-flushes", SVGA_QUERY_QUERY_FLUSHES,
+            PIPE_DRIVER_QUERY_TYPE_UINT64),
       QUERY("num-readbacks", SVGA_QUERY_NUM_READBACKS,
             PIPE_DRIVER_QUERY_TYPE_UINT64),
       QUERY("num-resource-updates", SVGA_QUERY_NUM_RESOURCE_UPDATES,
@@ -60,12 +60,37 @@ svga_resource_handle(struct pipe_resource *res)
 
 
 /**
- * This helper function returns TRUE if the specified resource collides with
- * any of the resources bound to any of the currently bound sampler views.
+ * Return TRUE if the surface and the sampler view share a subresource.
+ * Views of different mip levels or array slices of a resource may be
+ * bound as render target and shader resource at the same time.
+ */
+static boolean
+subresources_overlap(const struct svga_surface *s,
+                     const struct pipe_sampler_view *sv)
+{
+   if (sv->target == PIPE_BUFFER)
+      return TRUE;
+
+   if (s->base.u.tex.level < sv->u.tex.first_level ||
+       s->base.u.tex.level > sv->u.tex.last_level)
+      return FALSE;
+
+   /* The slices of a 3D texture level are a single subresource. */
+   if (sv->target == PIPE_TEXTURE_3D)
+      return TRUE;
+
+   return s->base.u.tex.first_layer <= sv->u.tex.last_layer &&
+          s->base.u.tex.last_layer >= sv->u.tex.first_layer;
+}
+
+
+/**
+ * This helper function returns TRUE if the specified surface collides with
+ * any of the subresources bound to any of the currently bound sampler views.
  */
 boolean
 svga_check_sampler_view_resource_collision(const struct svga_context *svga,
-                                           const struct svga_winsys_surface *res,
+                                           const struct svga_surface *s,
                                            enum pipe_shader_type shader)
 {
    struct pipe_screen *screen = svga->pipe.screen;
@@ -79,7 +104,8 @@ svga_check_sampler_view_resource_collision(const struct svga_context *svga,
       struct svga_pipe_sampler_view *sv =
          svga_pipe_sampler_view(svga->curr.sampler_views[shader][i]);
 
-      if (sv && res == svga_resource_handle(sv->base.texture)) {
+      if (sv && s->handle == svga_resource_handle(sv->base.texture) &&
+          subresources_overlap(s, &sv->base)) {
          return TRUE;
       }
    }
@@ -102,15 +128,14 @@ svga_check_sampler_framebuffer_resource_collision(struct svga_context *svga,
    for (i = 0; i < svga->curr.framebuffer.nr_cbufs; i++) {
       surf = svga_surface(svga->curr.framebuffer.cbufs[i]);
       if (surf &&
-          svga_check_sampler_view_resource_collision(svga, surf->handle,
-                                                     shader)) {
+          svga_check_sampler_view_resource_collision(svga, surf, shader)) {
          return TRUE;
       }
    }
 
    surf = svga_surface(svga->curr.framebuffer.zsbuf);
    if (surf &&
-       svga_check_sampler_view_resource_collision(svga, surf->handle, shader)) {
+       svga_check_sampler_view_resource_collision(svga, surf, shader)) {
       return TRUE;
    }
 
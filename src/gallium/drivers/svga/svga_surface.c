@@ -564,7 +564,7 @@ svga_validate_surface_view(struct svga_context *svga, struct svga_surface *s)
     * render target.
     */
    for (shader = PIPE_SHADER_VERTEX; shader <= PIPE_SHADER_GEOMETRY; shader++) {
-      if (svga_check_sampler_view_resource_collision(svga, s->handle, shader)) {
+      if (svga_check_sampler_view_resource_collision(svga, s, shader)) {
          SVGA_DBG(DEBUG_VIEWS,
                   "same resource used in shaderResource and renderTarget 0x%x\n",
                   s->handle);
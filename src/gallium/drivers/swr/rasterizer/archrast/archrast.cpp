@@ -25,6 +25,7 @@
  * @brief Implementation for archrast.
  *
  ******************************************************************************/
+#include <algorithm>
 #include <atomic>
 #include <map>
 
@@ -636,13 +637,143 @@ namespace ArchRast
 
     };
 
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Event handler for worker threads in sampling mode. Counters are
+    ///        only kept in memory and added to the published SampledStats
+    ///        once per group of KNOB_AR_SAMPLING_DRAW_GROUP draws, so there
+    ///        is no per-event output to slow the workers down.
+    class EventHandlerWorkerSampler : public EventHandler
+    {
+    public:
+        EventHandlerWorkerSampler(SampledStats* pPublished) : mpPublished(pPublished)
+        {
+            SWR_ASSERT(pPublished != nullptr);
+        }
+
+        virtual void Handle(const EarlyDepthStencilInfoSingleSample& event)
+        {
+            AddEarlyZ(event.data.depthPassMask, event.data.coverageMask);
+        }
+
+        virtual void Handle(const EarlyDepthStencilInfoSampleRate& event)
+        {
+            AddEarlyZ(event.data.depthPassMask, event.data.coverageMask);
+        }
+
+        virtual void Handle(const LateDepthStencilInfoSingleSample& event)
+        {
+            AddLateZ(event.data.depthPassMask, event.data.coverageMask);
+        }
+
+        virtual void Handle(const LateDepthStencilInfoSampleRate& event)
+        {
+            AddLateZ(event.data.depthPassMask, event.data.coverageMask);
+        }
+
+        virtual void Handle(const EarlyDepthInfoPixelRate& event)
+        {
+            mGroup.EarlyZPassCount += event.data.depthPassCount;
+            mGroup.EarlyZFailCount +=
+                _mm_popcnt_u32(event.data.activeLanes) - event.data.depthPassCount;
+        }
+
+        virtual void Handle(const LateDepthInfoPixelRate& event)
+        {
+            mGroup.LateZPassCount += event.data.depthPassCount;
+            mGroup.LateZFailCount +=
+                _mm_popcnt_u32(event.data.activeLanes) - event.data.depthPassCount;
+        }
+
+        virtual void Handle(const RasterTileCount& event)
+        {
+            mDrawTiles += event.data.rasterTiles;
+        }
+
+        virtual void Handle(const CullInfoEvent& event)
+        {
+            mGroup.DegeneratePrims += _mm_popcnt_u32(
+                event.data.validMask ^ (event.data.validMask & ~event.data.degeneratePrimMask));
+            mGroup.BackfacePrims += _mm_popcnt_u32(
+                event.data.validMask ^ (event.data.validMask & ~event.data.backfacePrimMask));
+        }
+
+        virtual void Handle(const PSStats& event)
+        {
+            SWR_SHADER_STATS* pStats = (SWR_SHADER_STATS*)event.data.hStats;
+            mGroup.PsInstExecuted += pStats->numInstExecuted;
+        }
+
+        virtual void Handle(const WorkerIdleEvent& event)
+        {
+            mGroup.WorkerIdleCycles += event.data.idleCycles;
+        }
+
+        virtual void FlushDraw(uint32_t drawId)
+        {
+            uint32_t bucket = 0;
+            if (mDrawTiles)
+            {
+                DWORD msb;
+                _BitScanReverse(&msb, mDrawTiles);
+                bucket = std::min<uint32_t>(msb + 1, SWR_AR_NUM_HISTOGRAM_BUCKETS - 1);
+            }
+
+            mGroup.DrawCount++;
+            mGroup.RasterTiles += mDrawTiles;
+            mGroup.DrawTileHistogram[bucket]++;
+            mDrawTiles = 0;
+
+            if (++mDrawsInGroup >= KNOB_AR_SAMPLING_DRAW_GROUP)
+            {
+                Publish();
+            }
+        }
+
+    private:
+        void AddEarlyZ(uint32_t depthPassMask, uint32_t coverageMask)
+        {
+            mGroup.EarlyZPassCount += _mm_popcnt_u32(depthPassMask);
+            mGroup.EarlyZFailCount += _mm_popcnt_u32((!depthPassMask) & coverageMask);
+        }
+
+        void AddLateZ(uint32_t depthPassMask, uint32_t coverageMask)
+        {
+            mGroup.LateZPassCount += _mm_popcnt_u32(depthPassMask);
+            mGroup.LateZFailCount += _mm_popcnt_u32((!depthPassMask) & coverageMask);
+        }
+
+        void Publish()
+        {
+            const uint64_t* pGroup = reinterpret_cast<const uint64_t*>(&mGroup);
+
+            // We are the only writer, so no read-modify-write is needed.
+            for (uint32_t i = 0; i < SampledStats::NUM_COUNTERS; ++i)
+            {
+                if (pGroup[i])
+                {
+                    std::atomic<uint64_t>& counter = mpPublished->counters[i];
+                    counter.store(counter.load(std::memory_order_relaxed) + pGroup[i],
+                                  std::memory_order_relaxed);
+                }
+            }
+
+            mGroup        = {};
+            mDrawsInGroup = 0;
+        }
+
+        SampledStats*        mpPublished;
+        SWR_AR_SAMPLED_STATS mGroup        = {};
+        uint32_t             mDrawsInGroup = 0;
+        uint32_t             mDrawTiles    = 0;
+    };
+
     static EventManager* FromHandle(HANDLE hThreadContext)
     {
         return reinterpret_cast<EventManager*>(hThreadContext);
     }
 
     // Construct an event manager and associate a handler with it.
-    HANDLE CreateThreadContext(AR_THREAD type)
+    HANDLE CreateThreadContext(AR_THREAD type, SampledStats* pSampledStats)
     {
         // Can we assume single threaded here?
         static std::atomic<uint32_t> counter(0);
@@ -650,6 +781,18 @@ namespace ArchRast
 
         EventManager* pManager = new EventManager();
 
+        if (pManager && KNOB_AR_SAMPLING_MODE)
+        {
+            // Nothing is written out in sampling mode, and the API thread
+            // doesn't contribute to the sampled counters.
+            if (type == AR_THREAD::WORKER)
+            {
+                pManager->Attach(new EventHandlerWorkerSampler(pSampledStats));
+            }
+
+            return pManager;
+        }
+
         if (pManager)
         {
             EventHandlerFile* pHandler = nullptr;
@@ -703,4 +846,14 @@ namespace ArchRast
 
         pManager->FlushDraw(drawId);
     }
+
+    void AccumulateSampledStats(const SampledStats& stats, SWR_AR_SAMPLED_STATS* pTotals)
+    {
+        uint64_t* pTotal = reinterpret_cast<uint64_t*>(pTotals);
+
+        for (uint32_t i = 0; i < SampledStats::NUM_COUNTERS; ++i)
+        {
+            pTotal[i] += stats.counters[i].load(std::memory_order_relaxed);
+        }
+    }
 } // namespace ArchRast
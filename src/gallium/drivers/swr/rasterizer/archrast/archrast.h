@@ -28,9 +28,12 @@
 #pragma once
 
 #include "common/os.h"
+#include "core/state.h"
 #include "gen_ar_event.hpp"
 #include "eventmanager.h"
 
+#include <atomic>
+
 namespace ArchRast
 {
     enum class AR_THREAD
@@ -39,11 +42,24 @@ namespace ArchRast
         WORKER = 1
     };
 
-    HANDLE CreateThreadContext(AR_THREAD type);
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Counters a worker publishes in sampling mode. Only the owning
+    ///        worker writes them, any thread may read them.
+    struct SampledStats
+    {
+        static const uint32_t NUM_COUNTERS = sizeof(SWR_AR_SAMPLED_STATS) / sizeof(uint64_t);
+
+        std::atomic<uint64_t> counters[NUM_COUNTERS];
+    };
+
+    HANDLE CreateThreadContext(AR_THREAD type, SampledStats* pSampledStats = nullptr);
     void   DestroyThreadContext(HANDLE hThreadContext);
 
     // Dispatch event for this thread.
     void Dispatch(HANDLE hThreadContext, const Event& event);
 
     void FlushDraw(HANDLE hThreadContext, uint32_t drawId);
+
+    // Add a worker's published counters to pTotals.
+    void AccumulateSampledStats(const SampledStats& stats, SWR_AR_SAMPLED_STATS* pTotals);
 }; // namespace ArchRast
@@ -371,6 +371,25 @@ KNOBS = [
         'category'  : 'archrast',
     }],
 
+    ['AR_SAMPLING_MODE', {
+        'type'      : 'bool',
+        'default'   : 'false',
+        'desc'      : ['Aggregate ArchRast counters in memory instead of writing',
+                       'per-thread event files. The summaries can be read with',
+                       'SwrGetArchRastSampledStats.',
+                       'ONLY ACTIVE UNDER ArchRast.'],
+        'category'  : 'archrast',
+    }],
+
+    ['AR_SAMPLING_DRAW_GROUP', {
+        'type'      : 'uint32_t',
+        'default'   : '64',
+        'desc'      : ['Number of draws each worker aggregates before publishing',
+                       'its counters in sampling mode.',
+                       'ONLY ACTIVE UNDER ArchRast.'],
+        'category'  : 'archrast',
+    }],
+
     ['AR_MEM_SET_BYTE_GRANULARITY', {
         'type'      : 'uint32_t',
         'default'   : '64',
@@ -148,6 +148,26 @@ HANDLE SwrCreateContext(SWR_CREATECONTEXT_INFO* pCreateInfo)
 
     CreateThreadPool(pContext, &pContext->threadPool);
 
+    // The BE work fifos of a macrotile are only read by the workers of the
+    // NUMA node which owns the tile, so keep them in that node's memory.
+    pContext->pNumaArenaAllocators = nullptr;
+    if (pContext->threadPool.numaMask)
+    {
+        uint32_t numNodes              = pContext->threadPool.numaMask + 1;
+        pContext->pNumaArenaAllocators = new NumaCachingAllocator[numNodes];
+        for (uint32_t n = 0; n < numNodes; ++n)
+        {
+            pContext->pNumaArenaAllocators[n].SetNumaNode(n +
+                                                          pContext->threadInfo.BASE_NUMA_NODE);
+        }
+
+        for (uint32_t dc = 0; dc < pContext->MAX_DRAWS_IN_FLIGHT; ++dc)
+        {
+            pContext->pMacroTileManagerArray[dc].initNumaArenas(pContext->pNumaArenaAllocators,
+                                                                pContext->threadPool.numaMask);
+        }
+    }
+
     if (pContext->apiThreadInfo.bindAPIThread0)
     {
         BindApiThread(pContext, 0);
@@ -167,6 +187,7 @@ HANDLE SwrCreateContext(SWR_CREATECONTEXT_INFO* pCreateInfo)
     pContext->pArContext = new HANDLE[pContext->NumWorkerThreads + 1];
     pContext->pArContext[pContext->NumWorkerThreads] =
         ArchRast::CreateThreadContext(ArchRast::AR_THREAD::API);
+    pContext->pArSampledStats = new ArchRast::SampledStats[pContext->NumWorkerThreads]();
 #endif
 
 #if defined(KNOB_ENABLE_RDTSC)
@@ -195,7 +216,8 @@ HANDLE SwrCreateContext(SWR_CREATECONTEXT_INFO* pCreateInfo)
 
 #if defined(KNOB_ENABLE_AR)
         // Initialize worker thread context for ArchRast.
-        pContext->pArContext[i] = ArchRast::CreateThreadContext(ArchRast::AR_THREAD::WORKER);
+        pContext->pArContext[i] = ArchRast::CreateThreadContext(ArchRast::AR_THREAD::WORKER,
+                                                                &pContext->pArSampledStats[i]);
 
         SWR_WORKER_DATA* pWorkerData = (SWR_WORKER_DATA*)pContext->threadPool.pThreadData[i].pWorkerPrivateData;
         pWorkerData->hArContext = pContext->pArContext[i];
@@ -330,6 +352,13 @@ DRAW_CONTEXT* GetDrawContext(SWR_CONTEXT* pContext, bool isSplitDraw = false)
         {
             // Take this opportunity to clean-up old arena allocations
             pContext->cachingArenaAllocator.FreeOldBlocks();
+            if (pContext->pNumaArenaAllocators)
+            {
+                for (uint32_t n = 0; n <= pContext->threadPool.numaMask; ++n)
+                {
+                    pContext->pNumaArenaAllocators[n].FreeOldBlocks();
+                }
+            }
 
             pContext->lastFrameChecked = pContext->frameCount;
             pContext->lastDrawChecked  = curDraw;
@@ -438,6 +467,7 @@ void SwrDestroyContext(HANDLE hContext)
 
     AlignedFree(pContext->pDispatchQueueArray);
     AlignedFree(pContext->pMacroTileManagerArray);
+    delete[] pContext->pNumaArenaAllocators;
 
     // Free scratch space.
     for (uint32_t i = 0; i < pContext->NumWorkerThreads; ++i)
@@ -453,6 +483,10 @@ void SwrDestroyContext(HANDLE hContext)
 #endif
     }
 
+#if defined(KNOB_ENABLE_AR)
+    delete[] pContext->pArSampledStats;
+#endif
+
 #if defined(KNOB_ENABLE_RDTSC)
     delete pContext->pBucketMgr;
 #endif
@@ -1725,6 +1759,35 @@ void SWR_API SwrEndFrame(HANDLE hContext)
     pContext->frameCount++;
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Get the counters aggregated by the ArchRast sampling mode.
+/// @param hContext - Handle passed back from SwrCreateContext, or NULL
+/// @param pStats - Receives the totals, or NULL
+bool SwrGetArchRastSampledStats(HANDLE hContext, SWR_AR_SAMPLED_STATS* pStats)
+{
+#if defined(KNOB_ENABLE_AR)
+    if (!KNOB_AR_SAMPLING_MODE)
+    {
+        return false;
+    }
+
+    if (pStats)
+    {
+        SWR_CONTEXT* pContext = GetContext(hContext);
+
+        *pStats = {};
+        for (uint32_t i = 0; i < pContext->NumWorkerThreads; ++i)
+        {
+            ArchRast::AccumulateSampledStats(pContext->pArSampledStats[i], pStats);
+        }
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
 void InitSimLoadTilesTable();
 void InitSimStoreTilesTable();
 void InitSimClearTilesTable();
@@ -1790,4 +1853,5 @@ void SwrGetInterface(SWR_INTERFACE& out_funcs)
     out_funcs.pfnSwrEnableStatsBE          = SwrEnableStatsBE;
     out_funcs.pfnSwrEndFrame               = SwrEndFrame;
     out_funcs.pfnSwrInit                   = SwrInit;
+    out_funcs.pfnSwrGetArchRastSampledStats = SwrGetArchRastSampledStats;
 }
@@ -701,6 +701,17 @@ SWR_FUNC(void, SwrEnableStatsBE, HANDLE hContext, bool enable);
 /// @param hContext - Handle passed back from SwrCreateContext
 SWR_FUNC(void, SwrEndFrame, HANDLE hContext);
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Get the counters aggregated by the ArchRast sampling mode
+///        (KNOB_AR_SAMPLING_MODE). Workers publish their counters every
+///        KNOB_AR_SAMPLING_DRAW_GROUP draws, so these trail the work that
+///        has been submitted.
+/// @param hContext - Handle passed back from SwrCreateContext, or NULL
+///        together with a NULL pStats to only check for support.
+/// @param pStats - Receives the totals since the context was created.
+/// @return false if ArchRast is not built in or sampling is disabled.
+SWR_FUNC(bool, SwrGetArchRastSampledStats, HANDLE hContext, SWR_AR_SAMPLED_STATS* pStats);
+
 //////////////////////////////////////////////////////////////////////////
 /// @brief Initialize swr backend and memory internal tables
 SWR_FUNC(void, SwrInit);
@@ -755,6 +766,7 @@ struct SWR_INTERFACE
     PFNSwrEnableStatsBE          pfnSwrEnableStatsBE;
     PFNSwrEndFrame               pfnSwrEndFrame;
     PFNSwrInit                   pfnSwrInit;
+    PFNSwrGetArchRastSampledStats pfnSwrGetArchRastSampledStats;
 };
 
 extern "C" {
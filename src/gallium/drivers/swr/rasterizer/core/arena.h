@@ -68,9 +68,57 @@ public:
     }
 };
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Allocates blocks from a specific NUMA node, for arenas whose
+///        memory is mostly read by the worker threads of that node.
+class NumaAllocator
+{
+public:
+    void SetNumaNode(uint32_t numaNode) { m_numaNode = numaNode; }
+
+    ArenaBlock* AllocateAligned(size_t size, size_t align)
+    {
+        SWR_ASSUME_ASSERT(size >= sizeof(ArenaBlock));
+
+#if defined(_WIN32)
+        // Pages are always aligned to more than ARENA_BLOCK_ALIGN
+        void* pMem = VirtualAllocExNuma(GetCurrentProcess(),
+                                        nullptr,
+                                        size,
+                                        MEM_COMMIT | MEM_RESERVE,
+                                        PAGE_READWRITE,
+                                        m_numaNode);
+#else
+        void* pMem = AlignedMalloc(size, align);
+#endif
+
+        ArenaBlock* p = new (pMem) ArenaBlock();
+        p->blockSize  = size;
+        return p;
+    }
+
+    void Free(ArenaBlock* pMem)
+    {
+        if (pMem)
+        {
+            SWR_ASSUME_ASSERT(pMem->blockSize < size_t(0xdddddddd));
+#if defined(_WIN32)
+            VirtualFree(pMem, 0, MEM_RELEASE);
+#else
+            AlignedFree(pMem);
+#endif
+        }
+    }
+
+private:
+    uint32_t m_numaNode = 0;
+};
+
 // Caching Allocator for Arena
-template <uint32_t NumBucketsT = 8, uint32_t StartBucketBitT = 12>
-struct CachingAllocatorT : DefaultAllocator
+template <uint32_t NumBucketsT     = 8,
+          uint32_t StartBucketBitT = 12,
+          typename BaseAllocatorT  = DefaultAllocator>
+struct CachingAllocatorT : BaseAllocatorT
 {
     ArenaBlock* AllocateAligned(size_t size, size_t align)
     {
@@ -135,7 +183,7 @@ struct CachingAllocatorT : DefaultAllocator
             size = size_t(1) << (bucket + 1 + CACHE_START_BUCKET_BIT);
         }
 
-        return this->DefaultAllocator::AllocateAligned(size, align);
+        return this->BaseAllocatorT::AllocateAligned(size, align);
     }
 
     void Free(ArenaBlock* pMem)
@@ -167,7 +215,7 @@ struct CachingAllocatorT : DefaultAllocator
                     ArenaBlock* pNext = pBlock->pNext;
                     m_oldCachedSize -= pBlock->blockSize;
                     m_totalAllocated -= pBlock->blockSize;
-                    this->DefaultAllocator::Free(pBlock);
+                    this->BaseAllocatorT::Free(pBlock);
                     pBlock = pNext;
                 }
                 m_oldCachedBlocks[i].pNext = nullptr;
@@ -231,14 +279,14 @@ struct CachingAllocatorT : DefaultAllocator
             while (pBlock)
             {
                 ArenaBlock* pNext = pBlock->pNext;
-                this->DefaultAllocator::Free(pBlock);
+                this->BaseAllocatorT::Free(pBlock);
                 pBlock = pNext;
             }
             pBlock = m_oldCachedBlocks[i].pNext;
             while (pBlock)
             {
                 ArenaBlock* pNext = pBlock->pNext;
-                this->DefaultAllocator::Free(pBlock);
+                this->BaseAllocatorT::Free(pBlock);
                 pBlock = pNext;
             }
         }
@@ -366,6 +414,7 @@ private:
     size_t m_oldCachedSize = 0;
 };
 typedef CachingAllocatorT<> CachingAllocator;
+typedef CachingAllocatorT<8, 12, NumaAllocator> NumaCachingAllocator;
 
 template <typename T = DefaultAllocator, size_t BlockSizeT = 128 * sizeof(KILOBYTE)>
 class TArena
@@ -486,5 +535,6 @@ private:
     T&               m_allocator;
 };
 
-using StdArena     = TArena<DefaultAllocator>;
-using CachingArena = TArena<CachingAllocator>;
+using StdArena         = TArena<DefaultAllocator>;
+using CachingArena     = TArena<CachingAllocator>;
+using NumaCachingArena = TArena<NumaCachingAllocator>;
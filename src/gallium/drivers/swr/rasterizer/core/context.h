@@ -551,6 +551,7 @@ struct SWR_CONTEXT
     volatile OSALIGNLINE(uint32_t) drawsOutstandingFE;
 
     OSALIGNLINE(CachingAllocator) cachingArenaAllocator;
+    NumaCachingAllocator*         pNumaArenaAllocators; // one per NUMA node, if more than one
     uint32_t frameCount;
 
     uint32_t lastFrameChecked;
@@ -560,6 +561,9 @@ struct SWR_CONTEXT
     // ArchRast thread contexts.
     HANDLE* pArContext;
 
+    // Counters published by each worker in ArchRast sampling mode.
+    ArchRast::SampledStats* pArSampledStats;
+
     // handle to external memory for worker datas to create memory contexts
     HANDLE hExternalMemory;
 
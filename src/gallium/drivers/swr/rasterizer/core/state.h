@@ -638,6 +638,34 @@ OSALIGNLINE(struct) SWR_STATS_FE
     uint64_t SoNumPrimsWritten[4];
 };
 
+#define SWR_AR_NUM_HISTOGRAM_BUCKETS 8
+
+//////////////////////////////////////////////////////////////////////////
+/// SWR_AR_SAMPLED_STATS
+///
+/// @brief Counters aggregated by the ArchRast sampling mode, summed over
+///        all workers. All members are uint64_t so workers can publish
+///        them as an array.
+/////////////////////////////////////////////////////////////////////////
+struct SWR_AR_SAMPLED_STATS
+{
+    uint64_t DrawCount;        // Draws completed, counted once per worker.
+    uint64_t EarlyZPassCount;  // Samples passing early depth test.
+    uint64_t EarlyZFailCount;  // Samples failing early depth test.
+    uint64_t LateZPassCount;   // Samples passing late depth test.
+    uint64_t LateZFailCount;   // Samples failing late depth test.
+    uint64_t RasterTiles;      // Raster tiles rasterized.
+    uint64_t BackfacePrims;    // Prims culled as backfacing.
+    uint64_t DegeneratePrims;  // Prims culled as degenerate.
+    uint64_t PsInstExecuted;   // Pixel shader instructions executed.
+    uint64_t WorkerIdleCycles; // rdtsc cycles workers spent without work.
+
+    // Draws by the number of raster tiles a worker rasterized for them.
+    // Bucket 0 is no tiles, bucket i holds 2^(i-1) to 2^i - 1 tiles and the
+    // last bucket everything above.
+    uint64_t DrawTileHistogram[SWR_AR_NUM_HISTOGRAM_BUCKETS];
+};
+
     //////////////////////////////////////////////////////////////////////////
     /// STREAMOUT_BUFFERS
     /////////////////////////////////////////////////////////////////////////
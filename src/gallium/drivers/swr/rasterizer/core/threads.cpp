@@ -714,6 +714,9 @@ INLINE void CompleteDrawFE(SWR_CONTEXT* pContext, uint32_t workerId, DRAW_CONTEX
         }
     }
 
+    // BE workers pick up tiles in dirty list order
+    pDC->pTileMgr->sortDirtyTilesByCost();
+
     // Ensure all streaming writes are globally visible before marking this FE done
     _mm_mfence();
     pDC->doneFE = true;
@@ -914,6 +917,11 @@ DWORD workerThreadMain(LPVOID pData)
             break;
         }
 
+#ifdef KNOB_ENABLE_AR
+        bool     bIdle     = !threadHasWork(curDrawBE);
+        uint64_t idleStart = bIdle ? __rdtsc() : 0;
+#endif
+
         uint32_t loop = 0;
         while (loop++ < KNOB_WORKER_SPIN_LOOP_COUNT && !threadHasWork(curDrawBE))
         {
@@ -935,6 +943,13 @@ DWORD workerThreadMain(LPVOID pData)
             lock.unlock();
         }
 
+#ifdef KNOB_ENABLE_AR
+        if (bIdle)
+        {
+            _AR_EVENT(pContext->pArContext[workerId], WorkerIdleEvent(__rdtsc() - idleStart));
+        }
+#endif
+
         if (IsBEThread)
         {
             RDTSC_BEGIN(pContext->pBucketMgr, WorkerWorkOnFifoBE, 0);
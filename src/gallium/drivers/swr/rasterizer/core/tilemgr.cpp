@@ -26,6 +26,7 @@
  *        for threads to work on an macro tile.
  *
  ******************************************************************************/
+#include <algorithm>
 #include <unordered_map>
 
 #include "fifo.hpp"
@@ -35,6 +36,34 @@
 
 MacroTileMgr::MacroTileMgr(CachingArena& arena) : mArena(arena) {}
 
+template <typename ArenaT>
+static INLINE void
+EnqueueTileWork(ArenaT& arena, MacroTileQueue* pTile, BE_WORK* pWork, bool firstWork)
+{
+    // The fifo still points at the previous draw's blocks, which were freed
+    // along with its arena.
+    if (firstWork)
+    {
+        pTile->clear(arena);
+    }
+
+    pTile->enqueue_try_nosync(arena, pWork);
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Allocate the work fifos of each tile from the NUMA node whose
+///        workers will process the tile, see WorkOnFifoBE.
+void MacroTileMgr::initNumaArenas(NumaCachingAllocator* pAllocators, uint32_t numaMask)
+{
+    SWR_ASSERT(mNumaArenas.empty());
+
+    mNumaMask = numaMask;
+    for (uint32_t n = 0; n <= numaMask; ++n)
+    {
+        mNumaArenas.push_back(new NumaCachingArena(pAllocators[n]));
+    }
+}
+
 void MacroTileMgr::enqueue(uint32_t x, uint32_t y, BE_WORK* pWork)
 {
     // Should not enqueue more then what we have backing for in the hot tile manager.
@@ -61,14 +90,21 @@ void MacroTileMgr::enqueue(uint32_t x, uint32_t y, BE_WORK* pWork)
     pTile->mWorkItemsFE++;
     pTile->mId = id;
 
-    if (pTile->mWorkItemsFE == 1)
+    bool firstWork = pTile->mWorkItemsFE == 1;
+    if (firstWork)
     {
-        pTile->clear(mArena);
         mDirtyTiles.push_back(pTile);
     }
 
     mWorkItemsProduced++;
-    pTile->enqueue_try_nosync(mArena, pWork);
+    if (mNumaArenas.empty())
+    {
+        EnqueueTileWork(mArena, pTile, pWork, firstWork);
+    }
+    else
+    {
+        EnqueueTileWork(*mNumaArenas[(x ^ y) & mNumaMask], pTile, pWork, firstWork);
+    }
 }
 
 void MacroTileMgr::markTileComplete(uint32_t id)
@@ -88,6 +124,26 @@ void MacroTileMgr::markTileComplete(uint32_t id)
     tile.mWorkItemsBE = 0;
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Orders the dirty tiles from most to least work items queued.
+///        Workers take tiles in dirty list order, so handing out the
+///        expensive tiles first keeps a single heavy tile from being picked
+///        up last and leaving the other workers idle at the end of the draw.
+///        Must be called before the draw is marked doneFE.
+void MacroTileMgr::sortDirtyTilesByCost()
+{
+    if (mDirtyTiles.size() <= 1)
+    {
+        return;
+    }
+
+    std::stable_sort(mDirtyTiles.begin(),
+                     mDirtyTiles.end(),
+                     [](const MacroTileQueue* a, const MacroTileQueue* b) {
+                         return a->mWorkItemsFE > b->mWorkItemsFE;
+                     });
+}
+
 HOTTILE* HotTileMgr::GetHotTile(SWR_CONTEXT*                pContext,
                                 DRAW_CONTEXT*               pDC,
                                 HANDLE                      hWorkerPrivateData,
@@ -100,6 +100,11 @@ public:
         {
             delete pTile;
         }
+
+        for (auto* pArena : mNumaArenas)
+        {
+            delete pArena;
+        }
     }
 
     INLINE void initialize()
@@ -108,10 +113,18 @@ public:
         mWorkItemsConsumed = 0;
 
         mDirtyTiles.clear();
+
+        for (auto* pArena : mNumaArenas)
+        {
+            pArena->Reset(true);
+        }
     }
 
+    void initNumaArenas(NumaCachingAllocator* pAllocators, uint32_t numaMask);
+
     INLINE std::vector<MacroTileQueue*>& getDirtyTiles() { return mDirtyTiles; }
     void                                 markTileComplete(uint32_t id);
+    void                                 sortDirtyTilesByCost();
 
     INLINE bool isWorkComplete() { return mWorkItemsProduced == mWorkItemsConsumed; }
 
@@ -134,6 +147,11 @@ private:
     CachingArena&                mArena;
     std::vector<MacroTileQueue*> mTiles;
 
+    // Per NUMA node arenas for the work fifos of the tiles owned by that
+    // node, if there is more than one node.
+    std::vector<NumaCachingArena*> mNumaArenas;
+    uint32_t                       mNumaMask = 0;
+
     // Any tile that has work queued to it is a dirty tile.
     std::vector<MacroTileQueue*> mDirtyTiles;
 
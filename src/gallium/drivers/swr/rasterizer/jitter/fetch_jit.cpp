@@ -78,6 +78,7 @@ struct FetchJit : public BuilderGfxMem
         Shuffle8bpcArgs;
 
     void Shuffle8bpcGatherd16(Shuffle8bpcArgs& args);
+    void Shuffle8bpcGatherd16AVX512(Shuffle8bpcArgs& args);
     void Shuffle8bpcGatherd(Shuffle8bpcArgs& args);
 
     typedef std::tuple<Value* (&)[2],
@@ -92,6 +93,7 @@ struct FetchJit : public BuilderGfxMem
         Shuffle16bpcArgs;
 
     void Shuffle16bpcGather16(Shuffle16bpcArgs& args);
+    void Shuffle16bpcGather16AVX512(Shuffle16bpcArgs& args);
     void Shuffle16bpcGather(Shuffle16bpcArgs& args);
 
     void StoreVertexElements(Value*         pVtxOut,
@@ -1299,6 +1301,12 @@ Value* FetchJit::GetSimdValid32bitIndices(Value* pIndices, Value* pLastIndex)
 ///   @param swizzle[4] - component swizzle location
 void FetchJit::Shuffle8bpcGatherd16(Shuffle8bpcArgs& args)
 {
+    if (JM()->mUsingAVX512)
+    {
+        Shuffle8bpcGatherd16AVX512(args);
+        return;
+    }
+
     // Unpack tuple args
     Value*&                    vGatherResult        = std::get<0>(args);
     Value*                     pVtxOut              = std::get<1>(args);
@@ -1559,6 +1567,111 @@ void FetchJit::Shuffle8bpcGatherd16(Shuffle8bpcArgs& args)
     }
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Extract the components of 16 gathered 8bpc vertices with full
+///        width shifts. AVX-512 has 512-bit shifts, but no 512-bit PSHUFB
+///        on KNL, so this avoids splitting the gather result into SIMD8
+///        halves.
+void FetchJit::Shuffle8bpcGatherd16AVX512(Shuffle8bpcArgs& args)
+{
+    // Unpack tuple args
+    Value*&                    vGatherResult        = std::get<0>(args);
+    Value*                     pVtxOut              = std::get<1>(args);
+    const Instruction::CastOps extendType           = std::get<2>(args);
+    const ConversionType       conversionType       = std::get<3>(args);
+    uint32_t&                  currentVertexElement = std::get<4>(args);
+    uint32_t&                  outputElt            = std::get<5>(args);
+    const ComponentEnable      compMask             = std::get<6>(args);
+    const ComponentControl(&compCtrl)[4]            = std::get<7>(args);
+    Value*(&vVertexElements)[4]                     = std::get<8>(args);
+    const uint32_t(&swizzle)[4]                     = std::get<9>(args);
+
+    bool bSigned = (extendType == Instruction::CastOps::SExt) ||
+                   (extendType == Instruction::CastOps::SIToFP);
+    if (!bSigned && (extendType != Instruction::CastOps::ZExt) &&
+        (extendType != Instruction::CastOps::UIToFP))
+    {
+        SWR_INVALID("Unsupported conversion type");
+        return;
+    }
+
+    // init denormalize variables if needed
+    Instruction::CastOps fpCast = bSigned ? Instruction::CastOps::SIToFP
+                                          : Instruction::CastOps::UIToFP;
+    Value*               conversionFactor;
+
+    switch (conversionType)
+    {
+    case CONVERT_NORMALIZED:
+        conversionFactor = VIMMED1((float)(bSigned ? 1.0 / 127.0 : 1.0 / 255.0));
+        break;
+    case CONVERT_SSCALED:
+    case CONVERT_USCALED:
+        SWR_ASSERT(bSigned == (conversionType == CONVERT_SSCALED));
+        conversionFactor = VIMMED1((float)(1.0));
+        break;
+    default:
+        SWR_ASSERT(conversionType == CONVERT_NONE);
+        conversionFactor = nullptr;
+        break;
+    }
+
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        if (isComponentEnabled(compMask, i))
+        {
+            if (compCtrl[i] == ComponentControl::StoreSrc)
+            {
+                // each 32bit lane holds one vertex as wzyx bytes
+                uint32_t shift = swizzle[i] * 8;
+                Value*   temp  = vGatherResult;
+
+                if (bSigned)
+                {
+                    // move the byte to the top, then shift it back down sign extending
+                    if (shift != 24)
+                    {
+                        temp = SHL(temp, VIMMED1(24 - (int)shift));
+                    }
+                    temp = ASHR(temp, VIMMED1(24));
+                }
+                else
+                {
+                    if (shift != 0)
+                    {
+                        temp = LSHR(temp, VIMMED1((int)shift));
+                    }
+                    if (shift != 24)
+                    {
+                        temp = AND(temp, VIMMED1(0xff));
+                    }
+                }
+
+                // denormalize if needed
+                if (conversionType != CONVERT_NONE)
+                {
+                    temp = FMUL(CAST(fpCast, temp, mSimdFP32Ty), conversionFactor);
+                }
+
+                vVertexElements[currentVertexElement] = temp;
+
+                currentVertexElement += 1;
+            }
+            else
+            {
+                vVertexElements[currentVertexElement++] = GenerateCompCtrlVector(compCtrl[i]);
+            }
+
+            if (currentVertexElement > 3)
+            {
+                StoreVertexElements(pVtxOut, outputElt++, 4, vVertexElements);
+                // reset to the next vVertexElement to output
+                currentVertexElement = 0;
+            }
+        }
+    }
+}
+
 void FetchJit::Shuffle8bpcGatherd(Shuffle8bpcArgs& args)
 {
     // Unpack tuple args
@@ -1671,6 +1784,12 @@ void FetchJit::Shuffle8bpcGatherd(Shuffle8bpcArgs& args)
 ///   @param vVertexElements[4] - vertex components to output
 void FetchJit::Shuffle16bpcGather16(Shuffle16bpcArgs& args)
 {
+    if (JM()->mUsingAVX512 && std::get<2>(args) != Instruction::CastOps::FPExt)
+    {
+        Shuffle16bpcGather16AVX512(args);
+        return;
+    }
+
     // Unpack tuple args
     Value*(&vGatherResult)[2]                       = std::get<0>(args);
     Value*                     pVtxOut              = std::get<1>(args);
@@ -1938,6 +2057,105 @@ void FetchJit::Shuffle16bpcGather16(Shuffle16bpcArgs& args)
     }
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Extract the components of 16 gathered 16bpc integer vertices with
+///        full width shifts, see Shuffle8bpcGatherd16AVX512. Half floats keep
+///        going through the SIMD8 CVTPH2PS path.
+void FetchJit::Shuffle16bpcGather16AVX512(Shuffle16bpcArgs& args)
+{
+    // Unpack tuple args
+    Value*(&vGatherResult)[2]                       = std::get<0>(args);
+    Value*                     pVtxOut              = std::get<1>(args);
+    const Instruction::CastOps extendType           = std::get<2>(args);
+    const ConversionType       conversionType       = std::get<3>(args);
+    uint32_t&                  currentVertexElement = std::get<4>(args);
+    uint32_t&                  outputElt            = std::get<5>(args);
+    const ComponentEnable      compMask             = std::get<6>(args);
+    const ComponentControl(&compCtrl)[4]            = std::get<7>(args);
+    Value*(&vVertexElements)[4]                     = std::get<8>(args);
+
+    bool bSigned = (extendType == Instruction::CastOps::SExt) ||
+                   (extendType == Instruction::CastOps::SIToFP);
+    if (!bSigned && (extendType != Instruction::CastOps::ZExt) &&
+        (extendType != Instruction::CastOps::UIToFP))
+    {
+        SWR_INVALID("Unsupported conversion type");
+        return;
+    }
+
+    // init denormalize variables if needed
+    Instruction::CastOps fpCast = bSigned ? Instruction::CastOps::SIToFP
+                                          : Instruction::CastOps::UIToFP;
+    Value*               conversionFactor;
+
+    switch (conversionType)
+    {
+    case CONVERT_NORMALIZED:
+        conversionFactor = VIMMED1((float)(bSigned ? 1.0 / 32767.0 : 1.0 / 65535.0));
+        break;
+    case CONVERT_SSCALED:
+    case CONVERT_USCALED:
+        SWR_ASSERT(bSigned == (conversionType == CONVERT_SSCALED));
+        conversionFactor = VIMMED1((float)(1.0));
+        break;
+    default:
+        SWR_ASSERT(conversionType == CONVERT_NONE);
+        conversionFactor = nullptr;
+        break;
+    }
+
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        if (isComponentEnabled(compMask, i))
+        {
+            if (compCtrl[i] == ComponentControl::StoreSrc)
+            {
+                // xy are in the first gather and zw in the second, x and z in the low words
+                Value* temp  = vGatherResult[i < 2 ? 0 : 1];
+                bool   bHigh = (i & 1) != 0;
+
+                if (bSigned)
+                {
+                    if (!bHigh)
+                    {
+                        temp = SHL(temp, VIMMED1(16));
+                    }
+                    temp = ASHR(temp, VIMMED1(16));
+                }
+                else if (bHigh)
+                {
+                    temp = LSHR(temp, VIMMED1(16));
+                }
+                else
+                {
+                    temp = AND(temp, VIMMED1(0xffff));
+                }
+
+                // denormalize if needed
+                if (conversionType != CONVERT_NONE)
+                {
+                    temp = FMUL(CAST(fpCast, temp, mSimdFP32Ty), conversionFactor);
+                }
+
+                vVertexElements[currentVertexElement] = temp;
+
+                currentVertexElement += 1;
+            }
+            else
+            {
+                vVertexElements[currentVertexElement++] = GenerateCompCtrlVector(compCtrl[i]);
+            }
+
+            if (currentVertexElement > 3)
+            {
+                StoreVertexElements(pVtxOut, outputElt++, 4, vVertexElements);
+                // reset to the next vVertexElement to output
+                currentVertexElement = 0;
+            }
+        }
+    }
+}
+
 void FetchJit::Shuffle16bpcGather(Shuffle16bpcArgs& args)
 {
     // Unpack tuple args
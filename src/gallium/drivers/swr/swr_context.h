@@ -124,6 +124,7 @@ struct swr_context {
 
    struct swr_vertex_shader *vs;
    struct swr_fragment_shader *fs;
+   VariantFS *fs_variant; /**< bound variant of fs, see swr_fs_variant_use() */
    struct swr_geometry_shader *gs;
    struct swr_vertex_element_state *velems;
 
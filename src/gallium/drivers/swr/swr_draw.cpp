@@ -60,6 +60,9 @@ swr_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
    /* Update derived state, pass draw info to update function. */
    swr_update_derived(pipe, info);
 
+   if (ctx->fs_variant)
+      swr_fs_variant_use(ctx, ctx->fs_variant);
+
    swr_update_draw_context(ctx);
 
    if (ctx->vs->pipe.stream_output.num_outputs) {
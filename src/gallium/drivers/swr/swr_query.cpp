@@ -42,7 +42,9 @@ swr_create_query(struct pipe_context *pipe, unsigned type, unsigned index)
 {
    struct swr_query *pq;
 
-   assert(type < PIPE_QUERY_TYPES);
+   assert(type < PIPE_QUERY_TYPES ||
+          (type >= SWR_QUERY_AR_FIRST &&
+           type < SWR_QUERY_AR_FIRST + SWR_QUERY_AR_COUNT));
    assert(index < MAX_SO_STREAMS);
 
    pq = (struct swr_query *) AlignedMalloc(sizeof(struct swr_query), 64);
@@ -89,6 +91,13 @@ swr_get_query_result(struct pipe_context *pipe,
       swr_fence_reference(pipe->screen, &pq->fence, NULL);
    }
 
+   if (pq->type >= SWR_QUERY_AR_FIRST) {
+      unsigned i = pq->type - SWR_QUERY_AR_FIRST;
+      result->u64 = ((const uint64_t *)&pq->result.ar_end)[i] -
+                    ((const uint64_t *)&pq->result.ar_start)[i];
+      return true;
+   }
+
    /* All values are reset to 0 at swr_begin_query, except starting timestamp.
     * Counters become simply end values.  */
    switch (pq->type) {
@@ -166,6 +175,14 @@ swr_begin_query(struct pipe_context *pipe, struct pipe_query *q)
 
    /* Initialize Results */
    memset(&pq->result, 0, sizeof(pq->result));
+
+   /* The sampled counters are always running, so only need a snapshot. */
+   if (pq->type >= SWR_QUERY_AR_FIRST) {
+      ctx->api.pfnSwrGetArchRastSampledStats(ctx->swrContext,
+                                             &pq->result.ar_start);
+      return true;
+   }
+
    switch (pq->type) {
    case PIPE_QUERY_GPU_FINISHED:
    case PIPE_QUERY_TIMESTAMP:
@@ -198,6 +215,12 @@ swr_end_query(struct pipe_context *pipe, struct pipe_query *q)
    struct swr_context *ctx = swr_context(pipe);
    struct swr_query *pq = swr_query(q);
 
+   if (pq->type >= SWR_QUERY_AR_FIRST) {
+      ctx->api.pfnSwrGetArchRastSampledStats(ctx->swrContext,
+                                             &pq->result.ar_end);
+      return true;
+   }
+
    switch (pq->type) {
    case PIPE_QUERY_GPU_FINISHED:
       /* nothing to do, but don't want the default */
@@ -256,6 +279,60 @@ swr_set_active_query_state(struct pipe_context *pipe, bool enable)
 {
 }
 
+
+/* Names of the SWR_AR_SAMPLED_STATS members, for the HUD */
+static const char *swr_ar_query_names[] = {
+   "AR-draws",
+   "AR-early-z-pass",
+   "AR-early-z-fail",
+   "AR-late-z-pass",
+   "AR-late-z-fail",
+   "AR-raster-tiles",
+   "AR-backface-prims",
+   "AR-degenerate-prims",
+   "AR-ps-instructions",
+   "AR-worker-idle-cycles",
+   "AR-draws-0-tiles",
+   "AR-draws-1-tiles",
+   "AR-draws-2-3-tiles",
+   "AR-draws-4-7-tiles",
+   "AR-draws-8-15-tiles",
+   "AR-draws-16-31-tiles",
+   "AR-draws-32-63-tiles",
+   "AR-draws-64+-tiles",
+};
+
+static_assert(ARRAY_SIZE(swr_ar_query_names) == SWR_QUERY_AR_COUNT,
+              "swr_ar_query_names doesn't match SWR_AR_SAMPLED_STATS");
+
+int
+swr_get_driver_query_info(struct pipe_screen *p_screen,
+                          unsigned index,
+                          struct pipe_driver_query_info *info)
+{
+   struct swr_screen *screen = swr_screen(p_screen);
+   SWR_INTERFACE api;
+
+   /* Only advertised when the backend was built with ArchRast and
+    * KNOB_AR_SAMPLING_MODE is set. */
+   screen->pfnSwrGetInterface(api);
+   if (!api.pfnSwrGetArchRastSampledStats(NULL, NULL))
+      return 0;
+
+   if (!info)
+      return SWR_QUERY_AR_COUNT;
+
+   if (index >= SWR_QUERY_AR_COUNT)
+      return 0;
+
+   memset(info, 0, sizeof(*info));
+   info->name = swr_ar_query_names[index];
+   info->query_type = SWR_QUERY_AR_FIRST + index;
+   info->type = PIPE_DRIVER_QUERY_TYPE_UINT64;
+   info->result_type = PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE;
+   return 1;
+}
+
 void
 swr_query_init(struct pipe_context *pipe)
 {
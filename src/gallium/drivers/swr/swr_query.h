@@ -27,11 +27,18 @@
 
 #include <limits.h>
 
+/* Driver queries reading the ArchRast sampled counters, one for each
+ * member of SWR_AR_SAMPLED_STATS in order. */
+#define SWR_QUERY_AR_FIRST PIPE_QUERY_DRIVER_SPECIFIC
+#define SWR_QUERY_AR_COUNT (sizeof(SWR_AR_SAMPLED_STATS) / sizeof(uint64_t))
+
 struct swr_query_result {
    SWR_STATS core;
    SWR_STATS_FE coreFE;
    uint64_t timestamp_start;
    uint64_t timestamp_end;
+   SWR_AR_SAMPLED_STATS ar_start;
+   SWR_AR_SAMPLED_STATS ar_end;
 };
 
 OSALIGNLINE(struct) swr_query {
@@ -44,5 +51,9 @@ OSALIGNLINE(struct) swr_query {
 
 extern void swr_query_init(struct pipe_context *pipe);
 
+extern int swr_get_driver_query_info(struct pipe_screen *screen,
+                                     unsigned index,
+                                     struct pipe_driver_query_info *info);
+
 extern bool swr_check_render_cond(struct pipe_context *pipe);
 #endif
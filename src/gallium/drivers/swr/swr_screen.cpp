@@ -26,6 +26,7 @@
 #include "swr_screen.h"
 #include "swr_resource.h"
 #include "swr_fence.h"
+#include "swr_query.h"
 #include "gen_knobs.h"
 
 #include "pipe/p_screen.h"
@@ -1105,6 +1106,12 @@ swr_destroy_screen_internal(struct swr_screen **screen)
    swr_fence_finish(p_screen, NULL, (*screen)->flush_fence, 0);
    swr_fence_reference(p_screen, &(*screen)->flush_fence, NULL);
 
+   if ((*screen)->async_fs_compile) {
+      util_queue_destroy(&(*screen)->fs_compile_queue);
+      mtx_destroy(&(*screen)->fs_compile_mutex);
+      JitDestroyContext((*screen)->hJitMgrAsync);
+   }
+
    JitDestroyContext((*screen)->hJitMgr);
 
    if ((*screen)->pLibrary)
@@ -1169,6 +1176,11 @@ swr_validate_env_options(struct swr_screen *screen)
          "SWR_MSAA_FORCE_ENABLE", false);
    if (screen->msaa_force_enable)
       fprintf(stderr, "SWR_MSAA_FORCE_ENABLE: true\n");
+
+   /* Draw with unoptimized fragment shaders until the optimized code,
+    * compiled in the background, is ready. */
+   screen->async_fs_compile = util_cpu_caps.nr_cpus > 1 &&
+      debug_get_bool_option("SWR_ASYNC_FS_COMPILE", true);
 }
 
 
@@ -1202,6 +1214,8 @@ swr_create_screen_internal(struct sw_winsys *winsys)
 
    screen->base.flush_frontbuffer = swr_flush_frontbuffer;
 
+   screen->base.get_driver_query_info = swr_get_driver_query_info;
+
    // Pass in "" for architecture for run-time determination
    screen->hJitMgr = JitCreateContext(KNOB_SIMD_WIDTH, "", "swr");
 
@@ -1209,5 +1223,18 @@ swr_create_screen_internal(struct sw_winsys *winsys)
 
    swr_validate_env_options(screen);
 
+   /* A single compile thread, since the background JitManager can only
+    * build one module at a time. */
+   if (screen->async_fs_compile) {
+      screen->async_fs_compile =
+         util_queue_init(&screen->fs_compile_queue, "swrfs", 16, 1,
+                         UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+                         UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY);
+   }
+   if (screen->async_fs_compile) {
+      mtx_init(&screen->fs_compile_mutex, mtx_plain);
+      screen->hJitMgrAsync = JitCreateContext(KNOB_SIMD_WIDTH, "", "swr");
+   }
+
    return &screen->base;
 }
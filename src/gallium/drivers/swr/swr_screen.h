@@ -30,6 +30,7 @@
 #include "pipe/p_defines.h"
 #include "util/u_dl.h"
 #include "util/u_format.h"
+#include "util/u_queue.h"
 #include "api.h"
 
 #include "memory/TilingFunctions.h"
@@ -52,6 +53,14 @@ struct swr_screen {
 
    HANDLE hJitMgr;
 
+   /* Optimized fragment shader code, compiled in the background with a
+    * JitManager of its own; see swr_fs_variant_use(). */
+   bool async_fs_compile;
+   HANDLE hJitMgrAsync;
+   struct util_queue fs_compile_queue;
+   mtx_t fs_compile_mutex;
+   bool fs_compile_busy;
+
    /* Dynamic backend implementations */
    util_dl_library *pLibrary;
    PFNSwrGetInterface pfnSwrGetInterface;
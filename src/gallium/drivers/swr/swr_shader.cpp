@@ -216,7 +216,7 @@ struct BuilderSWR : public Builder {
       : Builder(pJitMgr)
    {
       pJitMgr->SetupNewModule();
-      gallivm = gallivm_create(pName, wrap(&JM()->mContext));
+      gallivm = gallivm_create(pName, wrap(&JM()->mContext), NULL);
       pJitMgr->mpCurrentModule = unwrap(gallivm->module);
    }
 
@@ -230,6 +230,8 @@ struct BuilderSWR : public Builder {
    struct gallivm_state *gallivm;
    PFN_VERTEX_FUNC CompileVS(struct swr_context *ctx, swr_jit_vs_key &key);
    PFN_PIXEL_KERNEL CompileFS(struct swr_context *ctx, swr_jit_fs_key &key);
+   Function *BuildFS(struct swr_context *ctx, swr_jit_fs_key &key);
+   PFN_PIXEL_KERNEL FinishFS(Function *pFunction);
    PFN_GS_FUNC CompileGS(struct swr_context *ctx, swr_jit_gs_key &key);
 
    LLVMValueRef
@@ -1030,6 +1032,13 @@ locate_linkage(ubyte name, ubyte index, struct tgsi_shader_info *info)
 
 PFN_PIXEL_KERNEL
 BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_fs_key &key)
+{
+   return FinishFS(BuildFS(ctx, key));
+}
+
+/* Build the IR of a fragment shader variant; FinishFS() compiles it. */
+Function *
+BuilderSWR::BuildFS(struct swr_context *ctx, swr_jit_fs_key &key)
 {
    struct swr_fragment_shader *swr_fs = ctx->fs;
 
@@ -1423,6 +1432,13 @@ BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_fs_key &key)
 
    gallivm_verify_function(gallivm, wrap(pFunction));
 
+   return pFunction;
+}
+
+/* Only touches the builder's own JitManager, see swr_fs_variant_use(). */
+PFN_PIXEL_KERNEL
+BuilderSWR::FinishFS(Function *pFunction)
+{
    gallivm_compile_module(gallivm);
 
    // after the gallivm passes, we have to lower the core's intrinsics
@@ -1440,17 +1456,99 @@ BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_fs_key &key)
    return kernel;
 }
 
-PFN_PIXEL_KERNEL
+VariantFS *
 swr_compile_fs(struct swr_context *ctx, swr_jit_fs_key &key)
 {
+   struct swr_screen *screen = swr_screen(ctx->pipe.screen);
+
    if (!ctx->fs->pipe.tokens)
       return NULL;
 
-   BuilderSWR builder(
-      reinterpret_cast<JitManager *>(swr_screen(ctx->pipe.screen)->hJitMgr),
-      "FS");
+   BuilderSWR builder(reinterpret_cast<JitManager *>(screen->hJitMgr), "FS");
+   /* Get the draw going quickly, the optimized code comes later. */
+   builder.gallivm->no_opt = screen->async_fs_compile;
    PFN_PIXEL_KERNEL func = builder.CompileFS(ctx, key);
 
-   ctx->fs->map.insert(std::make_pair(key, std::make_unique<VariantFS>(builder.gallivm, func)));
-   return func;
+   auto variant = new VariantFS(builder.gallivm, func);
+   ctx->fs->map.insert(std::make_pair(key, std::unique_ptr<VariantFS>(variant)));
+   return variant;
+}
+
+struct swr_fs_compile_job {
+   struct swr_screen *screen;
+   VariantFS *variant;
+   BuilderSWR *builder;
+   Function *pFunction;
+};
+
+static void
+swr_fs_compile_job_execute(void *data, int thread_index)
+{
+   struct swr_fs_compile_job *job = (struct swr_fs_compile_job *)data;
+   struct swr_screen *screen = job->screen;
+
+   job->variant->shader_opt = job->builder->FinishFS(job->pFunction);
+   job->variant->gallivm_opt = job->builder->gallivm;
+   delete job->builder;
+
+   mtx_lock(&screen->fs_compile_mutex);
+   screen->fs_compile_busy = false;
+   mtx_unlock(&screen->fs_compile_mutex);
+
+   delete job;
+}
+
+/*
+ * Count a draw with the fragment shader variant which is currently bound,
+ * for variants running the unoptimized code swr_compile_fs() made.
+ *
+ * Once the variant is hot, its IR is rebuilt here with the screen's second
+ * JitManager, and optimized and compiled on the fs_compile_queue.  LLVM
+ * contexts are not thread safe, so only one such job runs at a time; other
+ * variants wait for a later draw.  When the job is done, the optimized code
+ * is swapped in by flagging SWR_NEW_FS for the next draw.
+ *
+ * Called after swr_update_derived(), so the context state matches the
+ * variant's key.
+ */
+void
+swr_fs_variant_use(struct swr_context *ctx, VariantFS *variant)
+{
+   struct swr_screen *screen = swr_screen(ctx->pipe.screen);
+
+   if (!variant->gallivm->no_opt || variant->shader == variant->shader_opt)
+      return;
+
+   if (variant->opt_queued) {
+      if (variant->shader_opt && util_queue_fence_is_signalled(&variant->ready)) {
+         variant->shader = variant->shader_opt;
+         ctx->dirty |= SWR_NEW_FS;
+      }
+      return;
+   }
+
+   if (variant->uses < gallivm_tier_up_uses) {
+      variant->uses++;
+      return;
+   }
+
+   mtx_lock(&screen->fs_compile_mutex);
+   if (!screen->fs_compile_busy) {
+      struct swr_fs_compile_job *job = new swr_fs_compile_job;
+      swr_jit_fs_key key;
+
+      swr_generate_fs_key(key, ctx, ctx->fs);
+
+      job->screen = screen;
+      job->variant = variant;
+      job->builder = new BuilderSWR(
+         reinterpret_cast<JitManager *>(screen->hJitMgrAsync), "FS");
+      job->pFunction = job->builder->BuildFS(ctx, key);
+
+      screen->fs_compile_busy = true;
+      variant->opt_queued = true;
+      util_queue_add_job(&screen->fs_compile_queue, job, &variant->ready,
+                         swr_fs_compile_job_execute, NULL);
+   }
+   mtx_unlock(&screen->fs_compile_mutex);
 }
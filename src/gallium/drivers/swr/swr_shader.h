@@ -29,6 +29,7 @@ struct swr_geometry_shader;
 struct swr_jit_fs_key;
 struct swr_jit_vs_key;
 struct swr_jit_gs_key;
+struct VariantFS;
 
 unsigned swr_so_adjust_attrib(unsigned in_attrib,
                               swr_vertex_shader *swr_vs);
@@ -36,9 +37,12 @@ unsigned swr_so_adjust_attrib(unsigned in_attrib,
 PFN_VERTEX_FUNC
 swr_compile_vs(struct swr_context *ctx, swr_jit_vs_key &key);
 
-PFN_PIXEL_KERNEL
+VariantFS *
 swr_compile_fs(struct swr_context *ctx, swr_jit_fs_key &key);
 
+void
+swr_fs_variant_use(struct swr_context *ctx, VariantFS *variant);
+
 PFN_GS_FUNC
 swr_compile_gs(struct swr_context *ctx, swr_jit_gs_key &key);
 
@@ -405,6 +405,7 @@ swr_bind_fs_state(struct pipe_context *pipe, void *fs)
       return;
 
    ctx->fs = (swr_fragment_shader *)fs;
+   ctx->fs_variant = NULL;
    ctx->dirty |= SWR_NEW_FS;
 }
 
@@ -1495,12 +1496,14 @@ swr_update_derived(struct pipe_context *pipe,
       swr_jit_fs_key key;
       swr_generate_fs_key(key, ctx, ctx->fs);
       auto search = ctx->fs->map.find(key);
-      PFN_PIXEL_KERNEL func;
+      VariantFS *variant;
       if (search != ctx->fs->map.end()) {
-         func = search->second->shader;
+         variant = search->second.get();
       } else {
-         func = swr_compile_fs(ctx, key);
+         variant = swr_compile_fs(ctx, key);
       }
+      ctx->fs_variant = variant;
+      PFN_PIXEL_KERNEL func = variant ? variant->shader : NULL;
       SWR_PS_STATE psState = {0};
       psState.pfnPixelShader = func;
       psState.killsPixel = ctx->fs->info.base.uses_kill;
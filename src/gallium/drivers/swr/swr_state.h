@@ -31,6 +31,7 @@
 #include "gallivm/lp_bld_init.h"
 #include "gallivm/lp_bld_tgsi.h"
 #include "util/crc32.h"
+#include "util/u_queue.h"
 #include "api.h"
 #include "swr_tex_sample.h"
 #include "swr_shader.h"
@@ -47,9 +48,34 @@ struct ShaderVariant {
 };
 
 typedef ShaderVariant<PFN_VERTEX_FUNC> VariantVS;
-typedef ShaderVariant<PFN_PIXEL_KERNEL> VariantFS;
 typedef ShaderVariant<PFN_GS_FUNC> VariantGS;
 
+/* Fragment shader variants may start out with unoptimized code and get
+ * optimized code compiled in the background, see swr_fs_variant_use().
+ * The unoptimized code is kept alive, since queued draws may still use it.
+ */
+struct VariantFS : ShaderVariant<PFN_PIXEL_KERNEL> {
+   struct gallivm_state *gallivm_opt = NULL;
+   PFN_PIXEL_KERNEL shader_opt = NULL;
+   unsigned uses = 0;
+   bool opt_queued = false;
+   struct util_queue_fence ready;
+
+   VariantFS(struct gallivm_state *gs, PFN_PIXEL_KERNEL code)
+      : ShaderVariant(gs, code)
+   {
+      util_queue_fence_init(&ready);
+   }
+
+   ~VariantFS()
+   {
+      util_queue_fence_wait(&ready);
+      util_queue_fence_destroy(&ready);
+      if (gallivm_opt)
+         gallivm_destroy(gallivm_opt);
+   }
+};
+
 /* skeleton */
 struct swr_vertex_shader {
    struct pipe_shader_state pipe;
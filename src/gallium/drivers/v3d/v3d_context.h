@@ -42,6 +42,7 @@
 
 struct v3d_job;
 struct v3d_bo;
+struct v3d_key;
 void v3d_job_add_bo(struct v3d_job *job, struct v3d_bo *bo);
 
 #include "v3d_bufmgr.h"
@@ -186,12 +187,18 @@ struct v3d_shader_uniform_info {
         uint32_t count;
 };
 
+struct v3d_precompile;
+
 struct v3d_uncompiled_shader {
         /** A name for this program, so you can track it in shader-db output. */
         uint32_t program_id;
         /** How many variants of this program were compiled, for shader-db. */
         uint32_t compiled_variant_count;
         struct pipe_shader_state base;
+        /** SHA1 of the NIR, for the disk cache keys of the variants. */
+        unsigned char sha1[20];
+        /** Variants being compiled on the screen's compile queue, if any. */
+        struct v3d_precompile *precompile;
         uint32_t num_tf_outputs;
         struct v3d_varying_slot *tf_outputs;
         uint16_t tf_specs[16];
@@ -594,6 +601,7 @@ struct pipe_context *v3d_context_create(struct pipe_screen *pscreen,
                                         void *priv, unsigned flags);
 void v3d_program_init(struct pipe_context *pctx);
 void v3d_program_fini(struct pipe_context *pctx);
+void v3d_program_screen_init(struct pipe_screen *pscreen);
 void v3d_query_init(struct pipe_context *pctx);
 
 void v3d_simulator_init(struct v3d_screen *screen);
@@ -619,6 +627,19 @@ v3d_transform_feedback_enabled(struct v3d_context *v3d)
 }
 
 void v3d_set_shader_uniform_dirty_flags(struct v3d_compiled_shader *shader);
+
+void v3d_disk_cache_init(struct v3d_screen *screen);
+void v3d_disk_cache_init_shader_key(struct v3d_screen *screen,
+                                    struct v3d_uncompiled_shader *so);
+struct v3d_prog_data *
+v3d_disk_cache_retrieve(struct v3d_screen *screen,
+                        const struct v3d_key *key,
+                        uint64_t **qpu_insts, uint32_t *qpu_size);
+void v3d_disk_cache_store(struct v3d_screen *screen,
+                          const struct v3d_key *key,
+                          const struct v3d_prog_data *prog_data,
+                          const uint64_t *qpu_insts, uint32_t qpu_size);
+
 struct v3d_cl_reloc v3d_write_uniforms(struct v3d_context *v3d,
                                        struct v3d_compiled_shader *shader,
                                        enum pipe_shader_type stage);
@@ -0,0 +1,285 @@
+/*
+ * Copyright © 2019 Broadcom
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file v3d_disk_cache.c
+ *
+ * Functions for storing compiled shader variants in the on-disk shader
+ * cache, keyed by the SHA1 of the shader's NIR and the variant key.
+ *
+ * Everything here only touches the screen, so it may be called from the
+ * compile queue as well as from the context's thread.
+ */
+
+#include "compiler/blob.h"
+#include "compiler/nir/nir_serialize.h"
+#include "util/disk_cache.h"
+#include "util/mesa-sha1.h"
+#include "util/ralloc.h"
+#include "compiler/v3d_compiler.h"
+#include "v3d_context.h"
+
+/* Debug flags asking for compiler output, which a cache hit would skip.
+ * shader-db reads its statistics from the precompiles' debug messages.
+ */
+#define V3D_DEBUG_COMPILE_OUTPUT (V3D_DEBUG_SHADERDB | V3D_DEBUG_VIR | \
+                                  V3D_DEBUG_QPU | V3D_DEBUG_FS | \
+                                  V3D_DEBUG_VS | V3D_DEBUG_CS | \
+                                  V3D_DEBUG_PRECOMPILE)
+
+static bool debug = false;
+
+static size_t
+v3d_key_size(gl_shader_stage stage)
+{
+        switch (stage) {
+        case MESA_SHADER_VERTEX:
+                return sizeof(struct v3d_vs_key);
+        case MESA_SHADER_FRAGMENT:
+                return sizeof(struct v3d_fs_key);
+        case MESA_SHADER_COMPUTE:
+                return sizeof(struct v3d_key);
+        default:
+                unreachable("unsupported shader stage");
+        }
+}
+
+static size_t
+v3d_prog_data_size(gl_shader_stage stage)
+{
+        switch (stage) {
+        case MESA_SHADER_VERTEX:
+                return sizeof(struct v3d_vs_prog_data);
+        case MESA_SHADER_FRAGMENT:
+                return sizeof(struct v3d_fs_prog_data);
+        case MESA_SHADER_COMPUTE:
+                return sizeof(struct v3d_compute_prog_data);
+        default:
+                unreachable("unsupported shader stage");
+        }
+}
+
+void
+v3d_disk_cache_init(struct v3d_screen *screen)
+{
+#ifdef ENABLE_SHADER_CACHE
+        if (V3D_DEBUG & V3D_DEBUG_COMPILE_OUTPUT)
+                return;
+
+        char *renderer = ralloc_asprintf(NULL, "V3D %d.%d",
+                                         screen->devinfo.ver / 10,
+                                         screen->devinfo.ver % 10);
+
+        uint32_t mesa_timestamp;
+        if (disk_cache_get_function_timestamp(v3d_disk_cache_init,
+                                              &mesa_timestamp)) {
+                char timestamp[9];
+                snprintf(timestamp, sizeof(timestamp), "%08x",
+                         mesa_timestamp);
+
+                screen->disk_cache = disk_cache_create(renderer, timestamp, 0);
+        }
+
+        ralloc_free(renderer);
+#endif
+}
+
+/**
+ * Hash the NIR of a new shader, once it has had the variant-independent
+ * lowering and optimization done to it.
+ */
+void
+v3d_disk_cache_init_shader_key(struct v3d_screen *screen,
+                               struct v3d_uncompiled_shader *so)
+{
+        if (!screen->disk_cache)
+                return;
+
+        struct blob blob;
+        blob_init(&blob);
+        nir_serialize(&blob, so->base.ir.nir);
+        _mesa_sha1_compute(blob.data, blob.size, so->sha1);
+        blob_finish(&blob);
+}
+
+static void
+v3d_disk_cache_compute_key(struct v3d_screen *screen,
+                           const struct v3d_key *key,
+                           cache_key cache_key)
+{
+        struct v3d_uncompiled_shader *so = key->shader_state;
+        nir_shader *s = so->base.ir.nir;
+        size_t key_size = v3d_key_size(s->info.stage);
+
+        struct blob blob;
+        blob_init(&blob);
+
+        /* The shader_state pointer is different on every run, and the
+         * NIR's SHA1 stands in for it.
+         */
+        blob_write_bytes(&blob, so->sha1, sizeof(so->sha1));
+        size_t offset = blob_reserve_bytes(&blob, key_size);
+        if (!blob.out_of_memory) {
+                struct v3d_key *key_copy = (void *)(blob.data + offset);
+
+                memcpy(key_copy, key, key_size);
+                key_copy->shader_state = NULL;
+        }
+
+        disk_cache_compute_key(screen->disk_cache, blob.data, blob.size,
+                               cache_key);
+        blob_finish(&blob);
+}
+
+/**
+ * Look up a variant in the disk cache.
+ *
+ * Returns a new prog_data and sets *qpu_insts to a malloc()ed copy of the
+ * code, or returns NULL on a miss.
+ */
+struct v3d_prog_data *
+v3d_disk_cache_retrieve(struct v3d_screen *screen,
+                        const struct v3d_key *key,
+                        uint64_t **qpu_insts, uint32_t *qpu_size)
+{
+#ifdef ENABLE_SHADER_CACHE
+        struct disk_cache *cache = screen->disk_cache;
+
+        if (!cache)
+                return NULL;
+
+        struct v3d_uncompiled_shader *so = key->shader_state;
+        nir_shader *s = so->base.ir.nir;
+        gl_shader_stage stage = s->info.stage;
+        size_t prog_data_size = v3d_prog_data_size(stage);
+
+        cache_key cache_key;
+        v3d_disk_cache_compute_key(screen, key, cache_key);
+
+        if (debug) {
+                char sha1[41];
+                _mesa_sha1_format(sha1, cache_key);
+                fprintf(stderr, "[mesa disk cache] retrieving %s: ", sha1);
+        }
+
+        size_t size;
+        void *buffer = disk_cache_get(cache, cache_key, &size);
+
+        if (debug)
+                fprintf(stderr, "%s\n", buffer ? "found" : "missing");
+
+        if (!buffer)
+                return NULL;
+
+        /* We read the following data from the cache blob:
+         *
+         * 1. the v3d_prog_data struct
+         * 2. the uniform contents and data arrays
+         * 3. the QPU instructions
+         */
+        struct blob_reader blob;
+        blob_reader_init(&blob, buffer, size);
+
+        const void *prog_data_bytes = blob_read_bytes(&blob, prog_data_size);
+        uint32_t count = blob_read_uint32(&blob);
+        const void *contents =
+                blob_read_bytes(&blob, count * sizeof(enum quniform_contents));
+        const void *data = blob_read_bytes(&blob, count * sizeof(uint32_t));
+        uint32_t code_size = blob_read_uint32(&blob);
+        const void *code = blob_read_bytes(&blob, code_size);
+
+        if (blob.overrun) {
+                free(buffer);
+                return NULL;
+        }
+
+        struct v3d_prog_data *prog_data = rzalloc_size(NULL, prog_data_size);
+        memcpy(prog_data, prog_data_bytes, prog_data_size);
+
+        struct v3d_uniform_list *ulist = &prog_data->uniforms;
+        ulist->count = count;
+        ulist->contents = ralloc_array(prog_data, enum quniform_contents,
+                                       count);
+        memcpy(ulist->contents, contents,
+               count * sizeof(enum quniform_contents));
+        ulist->data = ralloc_array(prog_data, uint32_t, count);
+        memcpy(ulist->data, data, count * sizeof(uint32_t));
+
+        *qpu_insts = malloc(code_size);
+        memcpy(*qpu_insts, code, code_size);
+        *qpu_size = code_size;
+
+        free(buffer);
+        return prog_data;
+#else
+        return NULL;
+#endif
+}
+
+/**
+ * Store a newly compiled variant in the disk cache.
+ */
+void
+v3d_disk_cache_store(struct v3d_screen *screen,
+                     const struct v3d_key *key,
+                     const struct v3d_prog_data *prog_data,
+                     const uint64_t *qpu_insts, uint32_t qpu_size)
+{
+#ifdef ENABLE_SHADER_CACHE
+        struct disk_cache *cache = screen->disk_cache;
+
+        if (!cache)
+                return;
+
+        struct v3d_uncompiled_shader *so = key->shader_state;
+        nir_shader *s = so->base.ir.nir;
+        gl_shader_stage stage = s->info.stage;
+        const struct v3d_uniform_list *ulist = &prog_data->uniforms;
+
+        cache_key cache_key;
+        v3d_disk_cache_compute_key(screen, key, cache_key);
+
+        if (debug) {
+                char sha1[41];
+                _mesa_sha1_format(sha1, cache_key);
+                fprintf(stderr, "[mesa disk cache] storing %s\n", sha1);
+        }
+
+        struct blob blob;
+        blob_init(&blob);
+
+        /* The uniform list pointers are written too, but get replaced on
+         * retrieval.
+         */
+        blob_write_bytes(&blob, prog_data, v3d_prog_data_size(stage));
+        blob_write_uint32(&blob, ulist->count);
+        blob_write_bytes(&blob, ulist->contents,
+                         ulist->count * sizeof(enum quniform_contents));
+        blob_write_bytes(&blob, ulist->data, ulist->count * sizeof(uint32_t));
+        blob_write_uint32(&blob, qpu_size);
+        blob_write_bytes(&blob, qpu_insts, qpu_size);
+
+        disk_cache_put(cache, cache_key, blob.data, blob.size, NULL);
+        blob_finish(&blob);
+#endif
+}
@@ -28,6 +28,8 @@
 #include "util/ralloc.h"
 #include "util/hash_table.h"
 #include "util/u_upload_mgr.h"
+#include "util/u_atomic.h"
+#include "util/u_cpu_detect.h"
 #include "tgsi/tgsi_dump.h"
 #include "tgsi/tgsi_parse.h"
 #include "compiler/nir/nir.h"
@@ -43,6 +45,9 @@ v3d_get_compiled_shader(struct v3d_context *v3d,
 static void
 v3d_setup_shared_precompile_key(struct v3d_uncompiled_shader *uncompiled,
                                 struct v3d_key *key);
+static void
+v3d_queue_precompile(struct v3d_context *v3d,
+                     struct v3d_uncompiled_shader *so);
 
 static gl_varying_slot
 v3d_get_slot_for_driver_location(nir_shader *s, uint32_t driver_location)
@@ -180,29 +185,41 @@ type_size(const struct glsl_type *type, bool bindless)
  * V3D_DEBUG=precompile is set.  Used for shader-db
  * (https://gitlab.freedesktop.org/mesa/shader-db)
  */
+/**
+ * Guesses the FS key: a render target for each output, and no other state.
+ */
 static void
-v3d_shader_precompile(struct v3d_context *v3d,
-                      struct v3d_uncompiled_shader *so)
+v3d_setup_fs_precompile_key(struct v3d_uncompiled_shader *so,
+                            struct v3d_fs_key *key)
 {
         nir_shader *s = so->base.ir.nir;
 
-        if (s->info.stage == MESA_SHADER_FRAGMENT) {
-                struct v3d_fs_key key = {
-                        .base.shader_state = so,
-                };
+        key->base.shader_state = so;
 
-                nir_foreach_variable(var, &s->outputs) {
-                        if (var->data.location == FRAG_RESULT_COLOR) {
-                                key.cbufs |= 1 << 0;
-                        } else if (var->data.location >= FRAG_RESULT_DATA0) {
-                                key.cbufs |= 1 << (var->data.location -
-                                                   FRAG_RESULT_DATA0);
-                        }
+        nir_foreach_variable(var, &s->outputs) {
+                if (var->data.location == FRAG_RESULT_COLOR) {
+                        key->cbufs |= 1 << 0;
+                } else if (var->data.location >= FRAG_RESULT_DATA0) {
+                        key->cbufs |= 1 << (var->data.location -
+                                            FRAG_RESULT_DATA0);
                 }
+        }
 
-                key.logicop_func = PIPE_LOGICOP_COPY;
+        key->logicop_func = PIPE_LOGICOP_COPY;
 
-                v3d_setup_shared_precompile_key(so, &key.base);
+        v3d_setup_shared_precompile_key(so, &key->base);
+}
+
+static void
+v3d_shader_precompile(struct v3d_context *v3d,
+                      struct v3d_uncompiled_shader *so)
+{
+        nir_shader *s = so->base.ir.nir;
+
+        if (s->info.stage == MESA_SHADER_FRAGMENT) {
+                struct v3d_fs_key key = { 0 };
+
+                v3d_setup_fs_precompile_key(so, &key);
                 v3d_get_compiled_shader(v3d, &key.base, sizeof(key));
         } else {
                 struct v3d_vs_key key = {
@@ -301,6 +318,8 @@ v3d_uncompiled_shader_create(struct pipe_context *pctx,
                 fprintf(stderr, "\n");
         }
 
+        v3d_disk_cache_init_shader_key(v3d->screen, so);
+
         if (V3D_DEBUG & V3D_DEBUG_PRECOMPILE)
                 v3d_shader_precompile(v3d, so);
 
@@ -328,9 +347,40 @@ v3d_shader_state_create(struct pipe_context *pctx,
 
         v3d_set_transform_feedback_outputs(so, &cso->stream_output);
 
+        v3d_queue_precompile(v3d_context(pctx), so);
+
         return so;
 }
 
+/**
+ * Wraps a compiled variant's prog_data and code up for the context, taking
+ * ownership of the prog_data.
+ */
+static struct v3d_compiled_shader *
+v3d_upload_compiled_shader(struct v3d_context *v3d,
+                           struct v3d_prog_data *prog_data,
+                           const uint64_t *qpu_insts, uint32_t shader_size)
+{
+        struct v3d_compiled_shader *shader =
+                rzalloc(NULL, struct v3d_compiled_shader);
+
+        shader->prog_data.base = prog_data;
+        ralloc_steal(shader, shader->prog_data.base);
+
+        v3d_set_shader_uniform_dirty_flags(shader);
+
+        if (shader_size) {
+                u_upload_data(v3d->state_uploader, 0, shader_size, 8,
+                              qpu_insts, &shader->offset, &shader->resource);
+        }
+
+        return shader;
+}
+
+static struct v3d_compiled_shader *
+v3d_claim_precompile(struct v3d_context *v3d, struct v3d_key *key,
+                     size_t key_size);
+
 struct v3d_compiled_shader *
 v3d_get_compiled_shader(struct v3d_context *v3d,
                         struct v3d_key *key,
@@ -345,30 +395,35 @@ v3d_get_compiled_shader(struct v3d_context *v3d,
                 return entry->data;
 
         struct v3d_compiled_shader *shader =
-                rzalloc(NULL, struct v3d_compiled_shader);
-
-        int program_id = shader_state->program_id;
-        int variant_id =
-                p_atomic_inc_return(&shader_state->compiled_variant_count);
-        uint64_t *qpu_insts;
-        uint32_t shader_size;
-
-        qpu_insts = v3d_compile(v3d->screen->compiler, key,
-                                &shader->prog_data.base, s,
-                                v3d_shader_debug_output,
-                                v3d,
-                                program_id, variant_id, &shader_size);
-        ralloc_steal(shader, shader->prog_data.base);
-
-        v3d_set_shader_uniform_dirty_flags(shader);
+                v3d_claim_precompile(v3d, key, key_size);
+
+        if (!shader) {
+                struct v3d_prog_data *prog_data;
+                uint64_t *qpu_insts;
+                uint32_t shader_size;
+
+                prog_data = v3d_disk_cache_retrieve(v3d->screen, key,
+                                                    &qpu_insts, &shader_size);
+                if (!prog_data) {
+                        int program_id = shader_state->program_id;
+                        int variant_id =
+                                p_atomic_inc_return(&shader_state->compiled_variant_count);
+
+                        qpu_insts = v3d_compile(v3d->screen->compiler, key,
+                                                &prog_data, s,
+                                                v3d_shader_debug_output,
+                                                v3d,
+                                                program_id, variant_id,
+                                                &shader_size);
+                        v3d_disk_cache_store(v3d->screen, key, prog_data,
+                                             qpu_insts, shader_size);
+                }
 
-        if (shader_size) {
-                u_upload_data(v3d->state_uploader, 0, shader_size, 8,
-                              qpu_insts, &shader->offset, &shader->resource);
+                shader = v3d_upload_compiled_shader(v3d, prog_data,
+                                                    qpu_insts, shader_size);
+                free(qpu_insts);
         }
 
-        free(qpu_insts);
-
         if (ht) {
                 struct v3d_key *dup_key;
                 dup_key = ralloc_size(shader, key_size);
@@ -396,6 +451,147 @@ v3d_get_compiled_shader(struct v3d_context *v3d,
         return shader;
 }
 
+/**
+ * A variant guessed at shader creation, compiled on the screen's compile
+ * queue so that the first draw with the shader doesn't have to.
+ */
+struct v3d_precompile {
+        struct util_queue_fence ready;
+        struct v3d_screen *screen;
+
+        union {
+                struct v3d_key base;
+                struct v3d_vs_key vs;
+                struct v3d_fs_key fs;
+        } key;
+
+        struct v3d_prog_data *prog_data;
+        uint64_t *qpu_insts;
+        uint32_t qpu_size;
+
+        /** Set once a context takes the variant. */
+        int claimed;
+};
+
+static void
+v3d_precompile_debug_output(const char *message, void *data)
+{
+        /* Compiler messages have nowhere to go from the queue. */
+}
+
+static void
+v3d_precompile_job(void *job, int thread_index)
+{
+        struct v3d_precompile *pc = job;
+        struct v3d_uncompiled_shader *so = pc->key.base.shader_state;
+
+        pc->prog_data = v3d_disk_cache_retrieve(pc->screen, &pc->key.base,
+                                                &pc->qpu_insts,
+                                                &pc->qpu_size);
+        if (pc->prog_data)
+                return;
+
+        int variant_id = p_atomic_inc_return(&so->compiled_variant_count);
+
+        pc->qpu_insts = v3d_compile(pc->screen->compiler, &pc->key.base,
+                                    &pc->prog_data, so->base.ir.nir,
+                                    v3d_precompile_debug_output, NULL,
+                                    so->program_id, variant_id,
+                                    &pc->qpu_size);
+
+        v3d_disk_cache_store(pc->screen, &pc->key.base, pc->prog_data,
+                             pc->qpu_insts, pc->qpu_size);
+}
+
+/**
+ * Queues the compile of the variant we expect a new shader to be used with.
+ *
+ * The render VS key depends on the FS it gets linked with, so for the VS we
+ * only guess the coordinate shader, which outputs just the TF varyings.
+ */
+static void
+v3d_queue_precompile(struct v3d_context *v3d,
+                     struct v3d_uncompiled_shader *so)
+{
+        struct v3d_screen *screen = v3d->screen;
+        nir_shader *s = so->base.ir.nir;
+
+        /* V3D_DEBUG=precompile compiles its guesses synchronously instead. */
+        if ((V3D_DEBUG & V3D_DEBUG_PRECOMPILE) ||
+            !util_queue_is_initialized(&screen->compile_queue))
+                return;
+
+        struct v3d_precompile *pc = calloc(1, sizeof(*pc));
+        if (!pc)
+                return;
+
+        pc->screen = screen;
+
+        switch (s->info.stage) {
+        case MESA_SHADER_FRAGMENT:
+                v3d_setup_fs_precompile_key(so, &pc->key.fs);
+                break;
+        case MESA_SHADER_VERTEX:
+                v3d_setup_shared_precompile_key(so, &pc->key.base);
+                pc->key.vs.is_coord = true;
+                memcpy(pc->key.vs.fs_inputs, so->tf_outputs,
+                       sizeof(*so->tf_outputs) * so->num_tf_outputs);
+                pc->key.vs.num_fs_inputs = so->num_tf_outputs;
+                break;
+        default:
+                v3d_setup_shared_precompile_key(so, &pc->key.base);
+                break;
+        }
+        pc->key.base.shader_state = so;
+
+        util_queue_fence_init(&pc->ready);
+
+        so->precompile = pc;
+        util_queue_add_job(&screen->compile_queue, pc, &pc->ready,
+                           v3d_precompile_job, NULL);
+}
+
+/**
+ * Takes the precompiled variant of a shader if it has the key we need,
+ * waiting for the compile queue to finish it first.
+ */
+static struct v3d_compiled_shader *
+v3d_claim_precompile(struct v3d_context *v3d, struct v3d_key *key,
+                     size_t key_size)
+{
+        struct v3d_uncompiled_shader *so = key->shader_state;
+        struct v3d_precompile *pc = so->precompile;
+
+        if (!pc || p_atomic_read(&pc->claimed) ||
+            memcmp(&pc->key, key, key_size) != 0) {
+                return NULL;
+        }
+
+        util_queue_fence_wait(&pc->ready);
+
+        if (p_atomic_cmpxchg(&pc->claimed, 0, 1) != 0)
+                return NULL;
+
+        struct v3d_compiled_shader *shader =
+                v3d_upload_compiled_shader(v3d, pc->prog_data,
+                                           pc->qpu_insts, pc->qpu_size);
+        free(pc->qpu_insts);
+        pc->prog_data = NULL;
+        pc->qpu_insts = NULL;
+
+        return shader;
+}
+
+static void
+v3d_free_precompile(struct v3d_precompile *pc)
+{
+        util_queue_fence_wait(&pc->ready);
+        util_queue_fence_destroy(&pc->ready);
+        ralloc_free(pc->prog_data);
+        free(pc->qpu_insts);
+        free(pc);
+}
+
 static void
 v3d_free_compiled_shader(struct v3d_compiled_shader *shader)
 {
@@ -759,6 +955,9 @@ v3d_shader_state_delete(struct pipe_context *pctx, void *hwcso)
                 v3d_free_compiled_shader(shader);
         }
 
+        if (so->precompile)
+                v3d_free_precompile(so->precompile);
+
         ralloc_free(so->base.ir.nir);
         free(so);
 }
@@ -792,8 +991,53 @@ static void *
 v3d_create_compute_state(struct pipe_context *pctx,
                          const struct pipe_compute_state *cso)
 {
-        return v3d_uncompiled_shader_create(pctx, cso->ir_type,
-                                            (void *)cso->prog);
+        struct v3d_uncompiled_shader *so =
+                v3d_uncompiled_shader_create(pctx, cso->ir_type,
+                                             (void *)cso->prog);
+
+        v3d_queue_precompile(v3d_context(pctx), so);
+
+        return so;
+}
+
+static void
+v3d_set_max_shader_compiler_threads(struct pipe_screen *pscreen,
+                                    unsigned max_threads)
+{
+        struct v3d_screen *screen = v3d_screen(pscreen);
+
+        util_queue_adjust_num_threads(&screen->compile_queue, max_threads);
+}
+
+static bool
+v3d_is_parallel_shader_compilation_finished(struct pipe_screen *pscreen,
+                                            void *shader,
+                                            unsigned shader_type)
+{
+        struct v3d_uncompiled_shader *so = shader;
+
+        return !so->precompile ||
+               util_queue_fence_is_signalled(&so->precompile->ready);
+}
+
+void
+v3d_program_screen_init(struct pipe_screen *pscreen)
+{
+        struct v3d_screen *screen = v3d_screen(pscreen);
+
+        util_cpu_detect();
+
+        if (!util_queue_init(&screen->compile_queue, "v3d_compile", 64,
+                             MAX2(util_cpu_caps.nr_cpus - 1, 1),
+                             UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+                             UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY)) {
+                return;
+        }
+
+        pscreen->set_max_shader_compiler_threads =
+                v3d_set_max_shader_compiler_threads;
+        pscreen->is_parallel_shader_compilation_finished =
+                v3d_is_parallel_shader_compilation_finished;
 }
 
 void
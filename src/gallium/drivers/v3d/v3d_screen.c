@@ -30,6 +30,7 @@
 #include "pipe/p_screen.h"
 #include "pipe/p_state.h"
 
+#include "util/disk_cache.h"
 #include "util/u_debug.h"
 #include "util/u_memory.h"
 #include "util/u_format.h"
@@ -67,6 +68,14 @@ v3d_screen_get_vendor(struct pipe_screen *pscreen)
         return "Broadcom";
 }
 
+static struct disk_cache *
+v3d_screen_get_disk_shader_cache(struct pipe_screen *pscreen)
+{
+        struct v3d_screen *screen = v3d_screen(pscreen);
+
+        return screen->disk_cache;
+}
+
 static void
 v3d_screen_destroy(struct pipe_screen *pscreen)
 {
@@ -80,6 +89,9 @@ v3d_screen_destroy(struct pipe_screen *pscreen)
         if (using_v3d_simulator)
                 v3d_simulator_destroy(screen);
 
+        if (util_queue_is_initialized(&screen->compile_queue))
+                util_queue_destroy(&screen->compile_queue);
+        disk_cache_destroy(screen->disk_cache);
         v3d_compiler_free(screen->compiler);
         u_transfer_helper_destroy(pscreen->transfer_helper);
 
@@ -677,11 +689,14 @@ v3d_screen_create(int fd, const struct pipe_screen_config *config,
         v3d_resource_screen_init(pscreen);
 
         screen->compiler = v3d_compiler_init(&screen->devinfo);
+        v3d_disk_cache_init(screen);
+        v3d_program_screen_init(pscreen);
 
         pscreen->get_name = v3d_screen_get_name;
         pscreen->get_vendor = v3d_screen_get_vendor;
         pscreen->get_device_vendor = v3d_screen_get_vendor;
         pscreen->get_compiler_options = v3d_screen_get_compiler_options;
+        pscreen->get_disk_shader_cache = v3d_screen_get_disk_shader_cache;
         pscreen->query_dmabuf_modifiers = v3d_screen_query_dmabuf_modifiers;
 
         return pscreen;
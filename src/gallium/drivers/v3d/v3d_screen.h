@@ -29,11 +29,13 @@
 #include "os/os_thread.h"
 #include "state_tracker/drm_driver.h"
 #include "util/list.h"
+#include "util/u_queue.h"
 #include "util/slab.h"
 #include "broadcom/common/v3d_debug.h"
 #include "broadcom/common/v3d_device_info.h"
 
 struct v3d_bo;
+struct disk_cache;
 
 /* These are tunable parameters in the HW design, but all the V3D
  * implementations agree.
@@ -70,6 +72,10 @@ struct v3d_screen {
         } bo_cache;
 
         const struct v3d_compiler *compiler;
+        struct disk_cache *disk_cache;
+
+        /** Compiles the guessed variants of new shaders in the background. */
+        struct util_queue compile_queue;
 
         struct util_hash_table *bo_handles;
         mtx_t bo_handles_mutex;
@@ -21,6 +21,7 @@
  * USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <inttypes.h>
 #include <libsync.h>
 #include "pipe/p_shader_tokens.h"
 
@@ -493,13 +494,48 @@ static void virgl_delete_rasterizer_state(struct pipe_context *ctx,
    FREE(vrs);
 }
 
+/* Returns whether the host already has this framebuffer, and records it as
+ * the host's if not.
+ */
+static bool virgl_host_framebuffer_equal(struct virgl_context *vctx,
+                                         const struct pipe_framebuffer_state *state)
+{
+   struct virgl_surface *zsurf = virgl_surface(state->zsbuf);
+   bool equal = vctx->host_framebuffer.valid &&
+                vctx->host_framebuffer.nr_cbufs == state->nr_cbufs &&
+                vctx->host_framebuffer.zsbuf == (zsurf ? zsurf->handle : 0) &&
+                vctx->host_framebuffer.width == state->width &&
+                vctx->host_framebuffer.height == state->height &&
+                vctx->host_framebuffer.layers == state->layers &&
+                vctx->host_framebuffer.samples == state->samples;
+   unsigned i;
+
+   for (i = 0; i < state->nr_cbufs; i++) {
+      struct virgl_surface *surf = virgl_surface(state->cbufs[i]);
+      uint32_t handle = surf ? surf->handle : 0;
+
+      equal = equal && vctx->host_framebuffer.cbufs[i] == handle;
+      vctx->host_framebuffer.cbufs[i] = handle;
+   }
+
+   vctx->host_framebuffer.valid = true;
+   vctx->host_framebuffer.nr_cbufs = state->nr_cbufs;
+   vctx->host_framebuffer.zsbuf = zsurf ? zsurf->handle : 0;
+   vctx->host_framebuffer.width = state->width;
+   vctx->host_framebuffer.height = state->height;
+   vctx->host_framebuffer.layers = state->layers;
+   vctx->host_framebuffer.samples = state->samples;
+   return equal;
+}
+
 static void virgl_set_framebuffer_state(struct pipe_context *ctx,
                                                 const struct pipe_framebuffer_state *state)
 {
    struct virgl_context *vctx = virgl_context(ctx);
 
    vctx->framebuffer = *state;
-   virgl_encoder_set_framebuffer_state(vctx, state);
+   if (!virgl_host_framebuffer_equal(vctx, state))
+      virgl_encoder_set_framebuffer_state(vctx, state);
    virgl_attach_res_framebuffer(vctx);
 }
 
@@ -630,6 +666,43 @@ static void virgl_hw_set_index_buffer(struct virgl_context *vctx,
    virgl_attach_res_index_buffer(vctx, ib);
 }
 
+/* Like virgl_host_framebuffer_equal(), for inline constants.  GL state
+ * trackers upload all of a stage's constants whenever any of them changes,
+ * so the comparison is on the whole buffer.
+ */
+static bool virgl_host_constants_equal(struct virgl_context *vctx,
+                                       enum pipe_shader_type shader,
+                                       uint32_t index, uint32_t size,
+                                       const void *data)
+{
+   uint32_t bytes = data ? size * 4 : 0;
+
+   if (vctx->host_constants[shader].valid &&
+       vctx->host_constants[shader].index == index &&
+       vctx->host_constants[shader].size == bytes &&
+       (!bytes || !memcmp(vctx->host_constants[shader].data, data, bytes)))
+      return true;
+
+   if (bytes > vctx->host_constants[shader].alloc_size) {
+      uint32_t *copy = REALLOC(vctx->host_constants[shader].data,
+                               vctx->host_constants[shader].alloc_size,
+                               bytes);
+      if (!copy) {
+         vctx->host_constants[shader].valid = false;
+         return false;
+      }
+      vctx->host_constants[shader].data = copy;
+      vctx->host_constants[shader].alloc_size = bytes;
+   }
+
+   if (bytes)
+      memcpy(vctx->host_constants[shader].data, data, bytes);
+   vctx->host_constants[shader].valid = true;
+   vctx->host_constants[shader].index = index;
+   vctx->host_constants[shader].size = bytes;
+   return false;
+}
+
 static void virgl_set_constant_buffer(struct pipe_context *ctx,
                                      enum pipe_shader_type shader, uint index,
                                      const struct pipe_constant_buffer *buf)
@@ -645,6 +718,8 @@ static void virgl_set_constant_buffer(struct pipe_context *ctx,
       virgl_encoder_set_uniform_buffer(vctx, shader, index,
                                        buf->buffer_offset,
                                        buf->buffer_size, res);
+      if (vctx->host_constants[shader].index == index)
+         vctx->host_constants[shader].valid = false;
 
       pipe_resource_reference(&binding->ubos[index].buffer, buf->buffer);
       binding->ubos[index] = *buf;
@@ -653,9 +728,12 @@ static void virgl_set_constant_buffer(struct pipe_context *ctx,
       static const struct pipe_constant_buffer dummy_ubo;
       if (!buf)
          buf = &dummy_ubo;
-      virgl_encoder_write_constant_buffer(vctx, shader, index,
-                                          buf->buffer_size / 4,
-                                          buf->user_buffer);
+      if (!virgl_host_constants_equal(vctx, shader, index,
+                                      buf->buffer_size / 4,
+                                      buf->user_buffer))
+         virgl_encoder_write_constant_buffer(vctx, shader, index,
+                                             buf->buffer_size / 4,
+                                             buf->user_buffer);
 
       pipe_resource_reference(&binding->ubos[index].buffer, NULL);
       binding->ubo_enabled_mask &= ~(1 << index);
@@ -909,6 +987,7 @@ static void virgl_flush_eq(struct virgl_context *ctx, void *closure,
    virgl_transfer_queue_clear(&ctx->queue, ctx->cbuf);
 
    virgl_submit_cmd(rs->vws, ctx->cbuf, fence);
+   ctx->last_copy_transfer.end_cdw = 0;
 
    /* Reserve some space for transfers. */
    if (ctx->encoded_transfers)
@@ -1365,8 +1444,16 @@ virgl_context_destroy( struct pipe_context *ctx )
    virgl_encoder_destroy_sub_ctx(vctx, vctx->hw_sub_ctx_id);
    virgl_flush_eq(vctx, vctx, NULL);
 
-   for (shader_type = 0; shader_type < PIPE_SHADER_TYPES; shader_type++)
+   if (virgl_debug & VIRGL_DEBUG_XFER_STATS) {
+      debug_printf("virgl: %u transfers merged into others, %"PRIu64" bytes\n",
+                   vctx->transfer_stats.merged_transfers,
+                   vctx->transfer_stats.merged_bytes);
+   }
+
+   for (shader_type = 0; shader_type < PIPE_SHADER_TYPES; shader_type++) {
       virgl_release_shader_binding(vctx, shader_type);
+      FREE(vctx->host_constants[shader_type].data);
+   }
 
    while (vctx->atomic_buffer_enabled_mask) {
       int i = u_bit_scan(&vctx->atomic_buffer_enabled_mask);
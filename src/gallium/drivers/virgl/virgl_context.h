@@ -66,6 +66,21 @@ struct virgl_shader_binding_state {
    uint32_t image_enabled_mask;
 };
 
+/* The copy transfer encoded last, as long as it is still the last command in
+ * the cbuf, so that a copy transfer of the next range of the same buffer can
+ * be merged into it.  The cbuf holds references to both resources.
+ */
+struct virgl_copy_transfer_record {
+   unsigned start_cdw;
+   unsigned end_cdw;
+   const struct virgl_hw_res *hw_res;
+   const struct virgl_hw_res *src_hw_res;
+   unsigned usage;
+   int x;
+   int width;
+   unsigned src_offset;
+};
+
 struct virgl_context {
    struct pipe_context base;
    struct virgl_cmd_buf *cbuf;
@@ -101,6 +116,38 @@ struct virgl_context {
 
    /* The total size of staging resources used in queued copy transfers. */
    uint64_t queued_staging_res_size;
+
+   struct virgl_copy_transfer_record last_copy_transfer;
+
+   /* Transfers which didn't need a command of their own, for
+    * VIRGL_DEBUG=xferstats.
+    */
+   struct {
+      unsigned merged_transfers;
+      uint64_t merged_bytes;
+   } transfer_stats;
+
+   /* The framebuffer the host last got.  Object handles are never reused,
+    * so equal handles mean equal surfaces.
+    */
+   struct {
+      bool valid;
+      uint32_t nr_cbufs;
+      uint32_t zsbuf;
+      uint32_t cbufs[PIPE_MAX_COLOR_BUFS];
+      uint32_t width, height, layers, samples;
+   } host_framebuffer;
+
+   /* The inline constants the host last got for each stage, so unchanged
+    * ones aren't resent with every draw.
+    */
+   struct {
+      bool valid;
+      uint32_t index;
+      uint32_t size;
+      uint32_t alloc_size;
+      uint32_t *data;
+   } host_constants[PIPE_SHADER_TYPES];
 };
 
 static inline struct virgl_sampler_view *
@@ -1383,6 +1383,44 @@ void virgl_encode_transfer(struct virgl_screen *vs, struct virgl_cmd_buf *buf,
    virgl_encoder_write_dword(buf, direction);
 }
 
+/* Grow the copy transfer encoded last to cover \p trans as well, if nothing
+ * was encoded after it and \p trans copies the next range of the same
+ * buffer from the next range of the same staging buffer.
+ */
+static bool virgl_encoder_extend_copy_transfer(struct virgl_context *ctx,
+                                               const struct virgl_transfer *trans)
+{
+   const struct pipe_transfer *transfer = &trans->base;
+   const struct pipe_resource *pres = transfer->resource;
+   struct virgl_cmd_buf *buf = ctx->cbuf;
+   struct virgl_copy_transfer_record *last = &ctx->last_copy_transfer;
+
+   if (pres->target != PIPE_BUFFER ||
+       unlikely(virgl_debug & VIRGL_DEBUG_XFER))
+      return false;
+
+   if (last->end_cdw != buf->cdw ||
+       last->hw_res != trans->hw_res ||
+       last->src_hw_res != trans->copy_src_hw_res ||
+       last->usage != transfer->usage ||
+       last->x + last->width != transfer->box.x ||
+       last->src_offset + last->width != trans->copy_src_offset)
+      return false;
+
+   /* The dwords after the command header are laid out as in
+    * virgl_encoder_transfer3d_common().
+    */
+   last->width += transfer->box.width;
+   buf->buf[last->start_cdw + 4] = util_format_get_stride(pres->format,
+                                                          last->width);
+   buf->buf[last->start_cdw + 5] = buf->buf[last->start_cdw + 4];
+   buf->buf[last->start_cdw + 9] = last->width;
+
+   ctx->transfer_stats.merged_transfers++;
+   ctx->transfer_stats.merged_bytes += transfer->box.width;
+   return true;
+}
+
 void virgl_encode_copy_transfer(struct virgl_context *ctx,
                                 struct virgl_transfer *trans)
 {
@@ -1391,8 +1429,12 @@ void virgl_encode_copy_transfer(struct virgl_context *ctx,
 
    assert(trans->copy_src_hw_res);
 
+   if (virgl_encoder_extend_copy_transfer(ctx, trans))
+      return;
+
    command = VIRGL_CMD0(VIRGL_CCMD_COPY_TRANSFER3D, 0, VIRGL_COPY_TRANSFER3D_SIZE);
    virgl_encoder_write_cmd_dword(ctx, command);
+   ctx->last_copy_transfer.start_cdw = ctx->cbuf->cdw - 1;
    /* Copy transfers need to explicitly specify the stride, since it may differ
     * from the image stride.
     */
@@ -1401,6 +1443,14 @@ void virgl_encode_copy_transfer(struct virgl_context *ctx,
    virgl_encoder_write_dword(ctx->cbuf, trans->copy_src_offset);
    /* At the moment all copy transfers are synchronized. */
    virgl_encoder_write_dword(ctx->cbuf, 1);
+
+   ctx->last_copy_transfer.end_cdw = ctx->cbuf->cdw;
+   ctx->last_copy_transfer.hw_res = trans->hw_res;
+   ctx->last_copy_transfer.src_hw_res = trans->copy_src_hw_res;
+   ctx->last_copy_transfer.usage = trans->base.usage;
+   ctx->last_copy_transfer.x = trans->base.box.x;
+   ctx->last_copy_transfer.width = trans->base.box.width;
+   ctx->last_copy_transfer.src_offset = trans->copy_src_offset;
 }
 
 void virgl_encode_end_transfers(struct virgl_cmd_buf *buf)
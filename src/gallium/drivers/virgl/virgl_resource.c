@@ -272,6 +272,7 @@ virgl_staging_map(struct virgl_context *vctx,
    struct virgl_resource *vres = virgl_resource(vtransfer->base.resource);
    unsigned size;
    unsigned align_offset;
+   unsigned alignment;
    unsigned stride;
    unsigned layer_stride;
    void *map_addr;
@@ -297,10 +298,24 @@ virgl_staging_map(struct virgl_context *vctx,
    align_offset = vres->u.b.target == PIPE_BUFFER ?
                   vtransfer->base.box.x % VIRGL_MAP_BUFFER_ALIGNMENT :
                   0;
+   alignment = VIRGL_MAP_BUFFER_ALIGNMENT;
+
+   /* If the unused part of the staging buffer already starts at the right
+    * offset modulo VIRGL_MAP_BUFFER_ALIGNMENT, use it without padding.  When
+    * a buffer is written range by range, consecutive ranges then end up
+    * next to each other in the staging buffer too, and their copy transfers
+    * get merged into one.
+    */
+   if (vres->u.b.target == PIPE_BUFFER &&
+       vctx->staging.offset % VIRGL_MAP_BUFFER_ALIGNMENT == align_offset &&
+       vctx->staging.offset + size <= vctx->staging.size) {
+      align_offset = 0;
+      alignment = 1;
+   }
 
    alloc_succeeded =
       virgl_staging_alloc(&vctx->staging, size + align_offset,
-                          VIRGL_MAP_BUFFER_ALIGNMENT,
+                          alignment,
                           &vtransfer->copy_src_offset,
                           &vtransfer->copy_src_hw_res,
                           &map_addr);
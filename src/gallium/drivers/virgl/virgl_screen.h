@@ -34,6 +34,7 @@ enum virgl_debug_flags {
    VIRGL_DEBUG_BGRA_DEST_SWIZZLE    = 1 << 3,
    VIRGL_DEBUG_SYNC                 = 1 << 4,
    VIRGL_DEBUG_XFER                 = 1 << 5,
+   VIRGL_DEBUG_XFER_STATS           = 1 << 6,
 };
 
 extern int virgl_debug;
@@ -175,6 +175,9 @@ static void replace_unmapped_transfer(struct virgl_transfer_queue *queue,
    u_box_union_2d(&current->base.box, &current->base.box, &queued->base.box);
    current->offset = current->base.box.x;
 
+   queue->vctx->transfer_stats.merged_transfers++;
+   queue->vctx->transfer_stats.merged_bytes += queued->base.box.width;
+
    remove_transfer(queue, queued);
    queue->num_dwords -= (VIRGL_TRANSFER3D_SIZE + 1);
 }
@@ -376,5 +379,8 @@ virgl_transfer_queue_extend_buffer(struct virgl_transfer_queue *queue,
    u_box_union_2d(&queued->base.box, &queued->base.box, &box);
    queued->offset = queued->base.box.x;
 
+   queue->vctx->transfer_stats.merged_transfers++;
+   queue->vctx->transfer_stats.merged_bytes += size;
+
    return true;
 }
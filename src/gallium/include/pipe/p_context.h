@@ -49,6 +49,7 @@ struct pipe_debug_callback;
 struct pipe_depth_stencil_alpha_state;
 struct pipe_device_reset_callback;
 struct pipe_draw_info;
+struct pipe_draw_start_count;
 struct pipe_grid_info;
 struct pipe_fence_handle;
 struct pipe_framebuffer_state;
@@ -108,6 +109,18 @@ struct pipe_context {
    /*@{*/
    void (*draw_vbo)( struct pipe_context *pipe,
                      const struct pipe_draw_info *info );
+
+   /**
+    * Optional.  Equivalent to calling draw_vbo once per element of
+    * \p draws, with info->start and info->count replaced by its start and
+    * count, and info->drawid incremented for each draw if
+    * info->increment_draw_id is set.  info->min_index and info->max_index
+    * cover all draws.  Never used with indirect or stream output draws.
+    */
+   void (*multi_draw)( struct pipe_context *pipe,
+                       const struct pipe_draw_info *info,
+                       const struct pipe_draw_start_count *draws,
+                       unsigned num_draws );
    /*@}*/
 
    /**
@@ -450,6 +463,15 @@ struct pipe_context {
    void (*blit)(struct pipe_context *pipe,
                 const struct pipe_blit_info *info);
 
+   /**
+    * Optional hints around a sequence of blit, resource_copy_region,
+    * clear_render_target and clear_depth_stencil calls, so that drivers
+    * using u_blitter can save and restore their states once for all of
+    * them.  No other state may be changed in between.  Calls may be nested.
+    */
+   void (*begin_blit_batch)(struct pipe_context *pipe);
+   void (*end_blit_batch)(struct pipe_context *pipe);
+
    /*@}*/
 
    /**
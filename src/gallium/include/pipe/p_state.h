@@ -719,6 +719,7 @@ struct pipe_draw_info
    enum pipe_prim_type mode:8;  /**< the mode of the primitive */
    unsigned primitive_restart:1;
    unsigned has_user_indices:1; /**< if true, use index.user_buffer */
+   unsigned increment_draw_id:1; /**< only for pipe_context::multi_draw */
    ubyte vertices_per_patch; /**< the number of vertices per patch */
 
    /**
@@ -779,6 +780,16 @@ struct pipe_draw_info
 };
 
 
+/**
+ * One draw of a pipe_context::multi_draw call.
+ */
+struct pipe_draw_start_count
+{
+   unsigned start;
+   unsigned count;
+};
+
+
 /**
  * Information to describe a blit call.
  */
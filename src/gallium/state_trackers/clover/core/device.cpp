@@ -26,6 +26,7 @@
 #include "pipe/p_screen.h"
 #include "pipe/p_state.h"
 #include "util/bitscan.h"
+#include "util/disk_cache.h"
 #include "util/u_debug.h"
 
 using namespace clover;
@@ -41,10 +42,26 @@ namespace {
       pipe->get_compute_param(pipe, ir_format, cap, &v.front());
       return v;
    }
+
+   disk_cache *
+   create_program_cache(pipe_screen *pipe) {
+      uint32_t mesa_timestamp;
+      char timestamp[9];
+
+      // Any function of ours will do to date the build.
+      if (!disk_cache_get_function_timestamp((void *)create_program_cache,
+                                             &mesa_timestamp))
+         return NULL;
+
+      snprintf(timestamp, sizeof(timestamp), "%08x", mesa_timestamp);
+      return disk_cache_create((std::string("clover-") +
+                                pipe->get_name(pipe)).c_str(),
+                               timestamp, 0);
+   }
 }
 
 device::device(clover::platform &platform, pipe_loader_device *ldev) :
-   platform(platform), ldev(ldev) {
+   platform(platform), ldev(ldev), _program_cache(NULL) {
    pipe = pipe_loader_create_screen(ldev);
    if (!pipe || !pipe->get_param(pipe, PIPE_CAP_COMPUTE) ||
        !supports_ir(PIPE_SHADER_IR_NATIVE)) {
@@ -52,9 +69,13 @@ device::device(clover::platform &platform, pipe_loader_device *ldev) :
          pipe->destroy(pipe);
       throw error(CL_INVALID_DEVICE);
    }
+
+   _program_cache = create_program_cache(pipe);
 }
 
 device::~device() {
+   if (_program_cache)
+      disk_cache_destroy(_program_cache);
    if (pipe)
       pipe->destroy(pipe);
    if (ldev)
@@ -294,3 +315,8 @@ device::supported_extensions() const {
       + std::string(has_doubles() ? " cl_khr_fp64" : "")
       + std::string(has_halves() ? " cl_khr_fp16" : "");
 }
+
+disk_cache *
+device::program_cache() const {
+   return _program_cache;
+}
@@ -127,7 +127,7 @@ event::wait() const {
 hard_event::hard_event(command_queue &q, cl_command_type command,
                        const ref_vector<event> &deps, action action) :
    event(q.context(), deps, profile(q, action), [](event &ev){}),
-   _queue(q), _command(command), _fence(NULL) {
+   _queue(q), _command(command) {
    if (q.profiling_enabled())
       _time_queued = timestamp::current(q);
 
@@ -136,21 +136,17 @@ hard_event::hard_event(command_queue &q, cl_command_type command,
 }
 
 hard_event::~hard_event() {
-   pipe_screen *screen = queue()->device().pipe;
-   screen->fence_reference(screen, &_fence, NULL);
 }
 
 cl_int
 hard_event::status() const {
-   pipe_screen *screen = queue()->device().pipe;
-
    if (event::status() < 0)
       return event::status();
 
-   else if (!_fence)
+   else if (!_batch)
       return CL_QUEUED;
 
-   else if (!screen->fence_finish(screen, NULL, _fence, 0))
+   else if (!_batch->finish(0))
       return CL_SUBMITTED;
 
    else
@@ -169,15 +165,12 @@ hard_event::command() const {
 
 void
 hard_event::wait() const {
-   pipe_screen *screen = queue()->device().pipe;
-
    event::wait();
 
    if (status() == CL_QUEUED)
       queue()->flush();
 
-   if (!_fence ||
-       !screen->fence_finish(screen, NULL, _fence, PIPE_TIMEOUT_INFINITE))
+   if (!_batch || !_batch->finish(PIPE_TIMEOUT_INFINITE))
       throw error(CL_EXEC_STATUS_ERROR_FOR_EVENTS_IN_WAIT_LIST);
 }
 
@@ -201,12 +194,6 @@ hard_event::time_end() const {
    return _time_end;
 }
 
-void
-hard_event::fence(pipe_fence_handle *fence) {
-   pipe_screen *screen = queue()->device().pipe;
-   screen->fence_reference(screen, &_fence, fence);
-}
-
 event::action
 hard_event::profile(command_queue &q, const action &action) const {
    if (q.profiling_enabled()) {
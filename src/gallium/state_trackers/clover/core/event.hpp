@@ -129,16 +129,15 @@ namespace clover {
       friend class command_queue;
 
       virtual struct pipe_fence_handle *fence() const {
-         return _fence;
+         return _batch ? _batch->fence() : NULL;
       }
 
    private:
-      virtual void fence(pipe_fence_handle *fence);
       action profile(command_queue &q, const action &action) const;
 
       const intrusive_ref<command_queue> _queue;
       cl_command_type _command;
-      pipe_fence_handle *_fence;
+      intrusive_ptr<batch_fence> _batch;
       lazy<cl_ulong> _time_queued, _time_submit, _time_start, _time_end;
    };
 
@@ -20,11 +20,98 @@
 // OTHER DEALINGS IN THE SOFTWARE.
 //
 
+#include <sstream>
+
 #include "core/program.hpp"
 #include "llvm/invocation.hpp"
+#include "util/disk_cache.h"
+#include "util/u_debug.h"
 
 using namespace clover;
 
+namespace {
+   void
+   write_string(std::ostream &os, const std::string &s) {
+      const uint32_t n = s.size();
+      os.write(reinterpret_cast<const char *>(&n), sizeof(n));
+      os.write(s.data(), n);
+   }
+
+   std::string
+   read_string(std::istream &is) {
+      uint32_t n = 0;
+      is.read(reinterpret_cast<char *>(&n), sizeof(n));
+      std::string s(is ? n : 0, '\0');
+      is.read(&s[0], s.size());
+      return s;
+   }
+
+   //
+   // Builds are kept in the device's disk cache, keyed by everything
+   // which goes into them.  The cache is bypassed when CLOVER_DEBUG asks
+   // for compiler output a hit wouldn't produce.
+   //
+   disk_cache *
+   get_program_cache(const device &dev) {
+      static const bool debug = debug_get_option("CLOVER_DEBUG", NULL);
+      return debug ? NULL : dev.program_cache();
+   }
+
+   std::string
+   device_key(const device &dev) {
+      std::ostringstream os;
+      write_string(os, dev.device_name());
+      write_string(os, dev.ir_target());
+      write_string(os, dev.device_clc_version());
+      return os.str();
+   }
+
+   bool
+   retrieve_build(const device &dev, const std::string &key_data,
+                  module &m, std::string &log) {
+      disk_cache *cache = get_program_cache(dev);
+      cache_key key;
+      size_t size;
+
+      if (!cache)
+         return false;
+
+      disk_cache_compute_key(cache, key_data.data(), key_data.size(), key);
+      void *data = disk_cache_get(cache, key, &size);
+      if (!data)
+         return false;
+
+      std::istringstream is(std::string(static_cast<char *>(data), size));
+      free(data);
+
+      try {
+         log = read_string(is);
+         m = module::deserialize(is);
+      } catch (...) {
+         return false;
+      }
+      return !is.fail();
+   }
+
+   void
+   store_build(const device &dev, const std::string &key_data,
+               const module &m, const std::string &log) {
+      disk_cache *cache = get_program_cache(dev);
+      std::ostringstream os;
+      cache_key key;
+
+      if (!cache)
+         return;
+
+      disk_cache_compute_key(cache, key_data.data(), key_data.size(), key);
+      write_string(os, log);
+      m.serialize(os);
+
+      const std::string data = os.str();
+      disk_cache_put(cache, key, data.data(), data.size(), NULL);
+   }
+}
+
 program::program(clover::context &ctx, const std::string &source) :
    has_source(true), context(ctx), _devices(ctx.devices()), _source(source),
    _kernel_ref_counter(0) {
@@ -48,12 +135,28 @@ program::compile(const ref_vector<device> &devs, const std::string &opts,
       _devices = devs;
 
       for (auto &dev : devs) {
+         std::ostringstream key;
          std::string log;
+         module m;
+
+         write_string(key, "compile");
+         write_string(key, device_key(dev));
+         write_string(key, opts);
+         write_string(key, _source);
+         for (auto &header : headers) {
+            write_string(key, header.first);
+            write_string(key, header.second);
+         }
+
+         if (retrieve_build(dev, key.str(), m, log)) {
+            _builds[&dev] = { m, opts, log };
+            continue;
+         }
 
          try {
             assert(dev.ir_format() == PIPE_SHADER_IR_NATIVE);
-            const module m = llvm::compile_program(_source, headers, dev, opts,
-                                                   log);
+            m = llvm::compile_program(_source, headers, dev, opts, log);
+            store_build(dev, key.str(), m, log);
             _builds[&dev] = { m, opts, log };
          } catch (...) {
             _builds[&dev] = { module(), opts, log };
@@ -73,10 +176,25 @@ program::link(const ref_vector<device> &devs, const std::string &opts,
          return prog.build(dev).binary;
          }, progs);
       std::string log = _builds[&dev].log;
+      std::ostringstream key;
+      module m;
+
+      write_string(key, "link");
+      write_string(key, device_key(dev));
+      write_string(key, opts);
+      write_string(key, log);
+      for (auto &bin : ms)
+         bin.serialize(key);
+
+      if (retrieve_build(dev, key.str(), m, log)) {
+         _builds[&dev] = { m, opts, log };
+         continue;
+      }
 
       try {
          assert(dev.ir_format() == PIPE_SHADER_IR_NATIVE);
-         const module m = llvm::link_program(ms, dev, opts, log);
+         m = llvm::link_program(ms, dev, opts, log);
+         store_build(dev, key.str(), m, log);
          _builds[&dev] = { m, opts, log };
       } catch (...) {
          _builds[&dev] = { module(), opts, log };
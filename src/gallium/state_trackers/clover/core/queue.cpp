@@ -42,6 +42,27 @@ namespace {
    }
 }
 
+batch_fence::batch_fence(pipe_screen *screen, pipe_fence_handle *fence) :
+   screen(screen), _fence(NULL), complete(false) {
+   screen->fence_reference(screen, &_fence, fence);
+}
+
+batch_fence::~batch_fence() {
+   screen->fence_reference(screen, &_fence, NULL);
+}
+
+bool
+batch_fence::finish(uint64_t timeout) const {
+   if (complete)
+      return true;
+
+   if (!_fence || !screen->fence_finish(screen, NULL, _fence, timeout))
+      return false;
+
+   complete = true;
+   return true;
+}
+
 command_queue::command_queue(clover::context &ctx, clover::device &dev,
                              cl_command_queue_properties props) :
    context(ctx), device(dev), props(props) {
@@ -69,12 +90,15 @@ command_queue::flush() {
    pipe_fence_handle *fence = NULL;
 
    std::lock_guard<std::mutex> lock(queued_events_mutex);
-   if (!queued_events.empty()) {
+
+   // Events still waiting on others haven't submitted anything yet.
+   if (!queued_events.empty() && queued_events.front()().signalled()) {
       pipe->flush(pipe, &fence, 0);
+      auto batch = create<batch_fence>(screen, fence);
 
       while (!queued_events.empty() &&
              queued_events.front()().signalled()) {
-         queued_events.front()().fence(fence);
+         queued_events.front()()._batch = &batch();
          queued_events.pop_front();
       }
 
@@ -95,7 +119,11 @@ command_queue::profiling_enabled() const {
 void
 command_queue::sequence(hard_event &ev) {
    std::lock_guard<std::mutex> lock(queued_events_mutex);
-   if (!queued_events.empty())
+
+   // Nothing to wait for once the previous event has run, and chaining
+   // to it anyway would keep every event of the queue alive through the
+   // dependency lists.
+   if (!queued_events.empty() && !queued_events.back()().signalled())
       queued_events.back()().chain(ev);
 
    queued_events.push_back(ev);
@@ -23,6 +23,7 @@
 #ifndef CLOVER_CORE_QUEUE_HPP
 #define CLOVER_CORE_QUEUE_HPP
 
+#include <atomic>
 #include <deque>
 #include <mutex>
 
@@ -36,6 +37,32 @@ namespace clover {
    class mapping;
    class hard_event;
 
+   ///
+   /// Fence of a single pipe flush, shared by every hard_event the
+   /// flush submitted.  Once it has been seen signalled, the result is
+   /// remembered, so status queries for the rest of the batch are free.
+   ///
+   class batch_fence : public ref_counter {
+   public:
+      batch_fence(pipe_screen *screen, pipe_fence_handle *fence);
+      ~batch_fence();
+
+      batch_fence(const batch_fence &f) = delete;
+      batch_fence &
+      operator=(const batch_fence &f) = delete;
+
+      bool finish(uint64_t timeout) const;
+
+      pipe_fence_handle *fence() const {
+         return _fence;
+      }
+
+   private:
+      pipe_screen *screen;
+      pipe_fence_handle *_fence;
+      mutable std::atomic<bool> complete;
+   };
+
    class command_queue : public ref_counter, public _cl_command_queue {
    public:
       command_queue(clover::context &ctx, clover::device &dev,
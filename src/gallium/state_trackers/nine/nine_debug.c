@@ -54,6 +54,7 @@ static const struct debug_named_value nine_debug_flags[] = {
     { "error",   DBG_ERROR,                "Driver errors, always visible." },
     { "warn",    DBG_WARN,                 "Driver warnings, always visible in debug builds." },
     { "tid",     DBG_TID,                  "Display thread-ids." },
+    { "csmt",    DBG_CSMT,                 "CSMT queue flush and stall counts." },
     DEBUG_NAMED_VALUE_END
 };
 
@@ -23,9 +23,15 @@
 #include "nine_queue.h"
 #include "os/os_thread.h"
 #include "util/macros.h"
+#include "util/u_queue.h"
 #include "nine_helpers.h"
 
-#define NINE_CMD_BUF_INSTR (256)
+/* A cmdbuf is handed to the worker early, once it has this many
+ * instructions and the worker has nothing left to do.  Otherwise it is
+ * filled up to NINE_CMD_BUF_INSTR or NINE_QUEUE_SIZE.
+ */
+#define NINE_CMD_BUF_MIN_INSTR (256)
+#define NINE_CMD_BUF_INSTR (4096)
 
 #define NINE_CMD_BUFS (32)
 #define NINE_CMD_BUFS_MASK (NINE_CMD_BUFS - 1)
@@ -40,8 +46,9 @@
  * Producer:
  * Calls nine_queue_alloc to get a slice of memory in current cmdbuf.
  * Calls nine_queue_flush to flush the queue by request.
- * The queue is flushed automatically on insufficient space or once the
- * cmdbuf contains NINE_CMD_BUF_INSTR instructions.
+ * The queue is flushed automatically on insufficient space, once the
+ * cmdbuf contains NINE_CMD_BUF_INSTR instructions, or once it contains
+ * NINE_CMD_BUF_MIN_INSTR instructions while the consumer is idle.
  *
  * nine_queue_flush does block, while nine_queue_alloc doesn't block.
  *
@@ -56,6 +63,10 @@
  * Constrains:
  * Only a single consumer and a single producer are supported.
  *
+ * Each cmdbuf changes hands through a pair of fences, so neither side
+ * takes a lock, and a syscall is only made when the other side sleeps.
+ * The producer resets "processed" and signals "flushed"; the consumer
+ * resets "flushed" and signals "processed".
  */
 
 struct nine_cmdbuf {
@@ -63,7 +74,8 @@ struct nine_cmdbuf {
     unsigned num_instr;
     unsigned offset;
     void *mem_pool;
-    BOOL full;
+    struct util_queue_fence flushed;
+    struct util_queue_fence processed;
 };
 
 struct nine_queue_pool {
@@ -71,11 +83,15 @@ struct nine_queue_pool {
     unsigned head;
     unsigned tail;
     unsigned cur_instr;
-    BOOL worker_wait;
-    cnd_t event_pop;
-    cnd_t event_push;
-    mtx_t mutex_pop;
-    mtx_t mutex_push;
+
+    /* Written by the producer, except for consumer_stalls. */
+    struct {
+        unsigned flushes_explicit;
+        unsigned flushes_full;
+        unsigned flushes_idle;
+        unsigned producer_stalls;
+        unsigned consumer_stalls;
+    } stats;
 };
 
 /* Consumer functions: */
@@ -85,14 +101,13 @@ nine_queue_wait_flush(struct nine_queue_pool* ctx)
     struct nine_cmdbuf *cmdbuf = &ctx->pool[ctx->tail];
 
     /* wait for cmdbuf full */
-    mtx_lock(&ctx->mutex_push);
-    while (!cmdbuf->full)
-    {
+    if (!util_queue_fence_is_signalled(&cmdbuf->flushed)) {
         DBG("waiting for full cmdbuf\n");
-        cnd_wait(&ctx->event_push, &ctx->mutex_push);
+        ctx->stats.consumer_stalls++;
+        util_queue_fence_wait(&cmdbuf->flushed);
     }
     DBG("got cmdbuf=%p\n", cmdbuf);
-    mtx_unlock(&ctx->mutex_push);
+    util_queue_fence_reset(&cmdbuf->flushed);
 
     cmdbuf->offset = 0;
     ctx->cur_instr = 0;
@@ -110,14 +125,11 @@ nine_queue_get(struct nine_queue_pool* ctx)
     /* At this pointer there's always a cmdbuf. */
 
     if (ctx->cur_instr == cmdbuf->num_instr) {
-        /* signal waiting producer */
-        mtx_lock(&ctx->mutex_pop);
         DBG("freeing cmdbuf=%p\n", cmdbuf);
-        cmdbuf->full = 0;
-        cnd_signal(&ctx->event_pop);
-        mtx_unlock(&ctx->mutex_pop);
+        p_atomic_set(&ctx->tail, (ctx->tail + 1) & NINE_CMD_BUFS_MASK);
 
-        ctx->tail = (ctx->tail + 1) & NINE_CMD_BUFS_MASK;
+        /* signal waiting producer */
+        util_queue_fence_signal(&cmdbuf->processed);
 
         return NULL;
     }
@@ -132,44 +144,49 @@ nine_queue_get(struct nine_queue_pool* ctx)
 
 /* Producer functions: */
 
-/* Flushes the queue.
- * Moves the current cmdbuf to worker thread.
- * Blocks until next cmdbuf is free. */
-void
-nine_queue_flush(struct nine_queue_pool* ctx)
+static void
+nine_queue_submit(struct nine_queue_pool* ctx)
 {
     struct nine_cmdbuf *cmdbuf = &ctx->pool[ctx->head];
 
     DBG("flushing cmdbuf=%p instr=%d size=%d\n",
            cmdbuf, cmdbuf->num_instr, cmdbuf->offset);
 
-    /* Nothing to flush */
-    if (!cmdbuf->num_instr)
-        return;
-
     /* signal waiting worker */
-    mtx_lock(&ctx->mutex_push);
-    cmdbuf->full = 1;
-    cnd_signal(&ctx->event_push);
-    mtx_unlock(&ctx->mutex_push);
+    util_queue_fence_reset(&cmdbuf->processed);
+    util_queue_fence_signal(&cmdbuf->flushed);
 
     ctx->head = (ctx->head + 1) & NINE_CMD_BUFS_MASK;
 
     cmdbuf = &ctx->pool[ctx->head];
 
     /* wait for queue empty */
-    mtx_lock(&ctx->mutex_pop);
-    while (cmdbuf->full)
-    {
+    if (!util_queue_fence_is_signalled(&cmdbuf->processed)) {
         DBG("waiting for empty cmdbuf\n");
-        cnd_wait(&ctx->event_pop, &ctx->mutex_pop);
+        ctx->stats.producer_stalls++;
+        util_queue_fence_wait(&cmdbuf->processed);
     }
     DBG("got empty cmdbuf=%p\n", cmdbuf);
-    mtx_unlock(&ctx->mutex_pop);
     cmdbuf->offset = 0;
     cmdbuf->num_instr = 0;
 }
 
+/* Flushes the queue.
+ * Moves the current cmdbuf to worker thread.
+ * Blocks until next cmdbuf is free. */
+void
+nine_queue_flush(struct nine_queue_pool* ctx)
+{
+    struct nine_cmdbuf *cmdbuf = &ctx->pool[ctx->head];
+
+    /* Nothing to flush */
+    if (!cmdbuf->num_instr)
+        return;
+
+    ctx->stats.flushes_explicit++;
+    nine_queue_submit(ctx);
+}
+
 /* Gets a a pointer to slice of memory with size @space.
  * Does block if queue is full.
  * Returns NULL on @space > NINE_QUEUE_SIZE. */
@@ -186,8 +203,14 @@ nine_queue_alloc(struct nine_queue_pool* ctx, unsigned space)
 
     if ((cmdbuf->offset + space > NINE_QUEUE_SIZE) ||
         (cmdbuf->num_instr == NINE_CMD_BUF_INSTR)) {
+        ctx->stats.flushes_full++;
+        nine_queue_submit(ctx);
 
-        nine_queue_flush(ctx);
+        cmdbuf = &ctx->pool[ctx->head];
+    } else if (cmdbuf->num_instr >= NINE_CMD_BUF_MIN_INSTR &&
+               nine_queue_no_flushed_work(ctx)) {
+        ctx->stats.flushes_idle++;
+        nine_queue_submit(ctx);
 
         cmdbuf = &ctx->pool[ctx->head];
     }
@@ -210,7 +233,7 @@ nine_queue_alloc(struct nine_queue_pool* ctx, unsigned space)
 bool
 nine_queue_no_flushed_work(struct nine_queue_pool* ctx)
 {
-    return (ctx->tail == ctx->head);
+    return (p_atomic_read(&ctx->tail) == ctx->head);
 }
 
 /* Returns the current queue empty state.
@@ -221,7 +244,7 @@ nine_queue_isempty(struct nine_queue_pool* ctx)
 {
     struct nine_cmdbuf *cmdbuf = &ctx->pool[ctx->head];
 
-    return (ctx->tail == ctx->head) && !cmdbuf->num_instr;
+    return nine_queue_no_flushed_work(ctx) && !cmdbuf->num_instr;
 }
 
 struct nine_queue_pool*
@@ -240,14 +263,12 @@ nine_queue_create(void)
             goto failed;
     }
 
-    cnd_init(&ctx->event_pop);
-    (void) mtx_init(&ctx->mutex_pop, mtx_plain);
-
-    cnd_init(&ctx->event_push);
-    (void) mtx_init(&ctx->mutex_push, mtx_plain);
-
     /* Block until first cmdbuf has been flushed. */
-    ctx->worker_wait = TRUE;
+    for (i = 0; i < NINE_CMD_BUFS; i++) {
+        util_queue_fence_init(&ctx->pool[i].flushed);
+        util_queue_fence_reset(&ctx->pool[i].flushed);
+        util_queue_fence_init(&ctx->pool[i].processed);
+    }
 
     return ctx;
 failed:
@@ -266,14 +287,23 @@ nine_queue_delete(struct nine_queue_pool *ctx)
 {
     unsigned i;
 
-    mtx_destroy(&ctx->mutex_pop);
-    cnd_destroy(&ctx->event_pop);
-
-    mtx_destroy(&ctx->mutex_push);
-    cnd_destroy(&ctx->event_push);
+    DBG_FLAG(DBG_CSMT, "flushes: %u explicit, %u full, %u to idle worker; "
+             "stalls: %u producer, %u consumer\n",
+             ctx->stats.flushes_explicit, ctx->stats.flushes_full,
+             ctx->stats.flushes_idle, ctx->stats.producer_stalls,
+             ctx->stats.consumer_stalls);
 
-    for (i = 0; i < NINE_CMD_BUFS; i++)
+    for (i = 0; i < NINE_CMD_BUFS; i++) {
+        /* The cmdbufs the worker was going to wait for next, and the one
+         * it stopped in when told to terminate. */
+        if (!util_queue_fence_is_signalled(&ctx->pool[i].flushed))
+            util_queue_fence_signal(&ctx->pool[i].flushed);
+        if (!util_queue_fence_is_signalled(&ctx->pool[i].processed))
+            util_queue_fence_signal(&ctx->pool[i].processed);
+        util_queue_fence_destroy(&ctx->pool[i].flushed);
+        util_queue_fence_destroy(&ctx->pool[i].processed);
         FREE(ctx->pool[i].mem_pool);
+    }
 
     FREE(ctx);
 }
@@ -28,12 +28,15 @@
 #include "nine_state.h"
 #include "vertexdeclaration9.h"
 
+#include "compiler/blob.h"
+#include "util/disk_cache.h"
 #include "util/macros.h"
 #include "util/u_memory.h"
 #include "util/u_inlines.h"
 #include "pipe/p_shader_tokens.h"
 #include "tgsi/tgsi_ureg.h"
 #include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_parse.h"
 #include "nir/tgsi_to_nir.h"
 
 #define DBG_CHANNEL DBG_SHADER
@@ -3843,18 +3846,13 @@ nine_pipe_nir_shader_state_from_tgsi(struct pipe_shader_state *state, const stru
 }
 
 static void *
-nine_ureg_create_shader(struct ureg_program                  *ureg,
+nine_tgsi_create_shader(const struct tgsi_token              *tgsi_tokens,
                         struct pipe_context                  *pipe,
                         const struct pipe_stream_output_info   *so)
 {
     struct pipe_shader_state state;
-    const struct tgsi_token *tgsi_tokens;
     struct pipe_screen *screen = pipe->screen;
 
-    tgsi_tokens = ureg_finalize(ureg);
-    if (!tgsi_tokens)
-        return NULL;
-
     assert(((struct tgsi_header *) &tgsi_tokens[0])->HeaderSize >= 2);
     enum pipe_shader_type shader_type = ((struct tgsi_processor *) &tgsi_tokens[1])->Processor;
 
@@ -3896,6 +3894,20 @@ nine_ureg_create_shader(struct ureg_program                  *ureg,
     }
 }
 
+static void *
+nine_ureg_create_shader(struct ureg_program                  *ureg,
+                        struct pipe_context                  *pipe,
+                        const struct pipe_stream_output_info   *so)
+{
+    const struct tgsi_token *tgsi_tokens;
+
+    tgsi_tokens = ureg_finalize(ureg);
+    if (!tgsi_tokens)
+        return NULL;
+
+    return nine_tgsi_create_shader(tgsi_tokens, pipe, so);
+}
+
 
 void *
 nine_create_shader_with_so_and_destroy(struct ureg_program                   *p,
@@ -3907,6 +3919,407 @@ nine_create_shader_with_so_and_destroy(struct ureg_program                   *p,
     return result;
 }
 
+/* Shader disk cache
+ *
+ * Translated shaders are stored as TGSI, together with everything the
+ * translation reports back in nine_shader_info, under the hash of the
+ * byte code and every input which can change the result.  The driver
+ * caches its own binary for the TGSI.
+ *
+ * For each byte code we also keep the inputs of the variants created
+ * from it, so that they can be created again with the shader.
+ */
+
+#define NINE_SHADER_CACHE_MAX_VARIANTS 32
+
+struct nine_shader_cache_inputs {
+    uint32_t type;
+    uint32_t const_i_base;
+    uint32_t const_b_base;
+    uint32_t max_vs_const_f;
+    uint32_t sampler_mask_shadow;
+    uint32_t sampler_ps1xtypes;
+    uint32_t fog_enable;
+    uint32_t fog_mode;
+    uint32_t force_color_in_centroid;
+    uint32_t projected;
+    uint32_t swvp_on;
+    float point_size_min;
+    float point_size_max;
+};
+
+struct nine_shader_cache_variant {
+    uint64_t key;
+    struct nine_shader_cache_inputs inputs;
+    uint32_t pad;
+};
+
+static struct disk_cache *
+nine_shader_get_disk_cache(struct NineDevice9 *device,
+                           const struct nine_shader_info *info)
+{
+    struct pipe_screen *screen = device->screen;
+
+    /* Shaders for swvp vertex processing go to another screen, and would
+     * need the vertex declaration hashed too. */
+    if (info->process_vertices || !screen->get_disk_shader_cache)
+        return NULL;
+    /* A cache hit wouldn't print anything. */
+    if (nine_shader_get_debug_flag(NINE_SHADER_DEBUG_OPTION_DUMP_NIR |
+                                   NINE_SHADER_DEBUG_OPTION_DUMP_TGSI))
+        return NULL;
+    return screen->get_disk_shader_cache(screen);
+}
+
+/* The parser finds the end of the byte code as it goes, but the hash has
+ * to be computed first. */
+static unsigned
+sm1_byte_code_size(const DWORD *byte_code)
+{
+    const DWORD *tok = byte_code;
+    const unsigned major = D3DSHADER_VERSION_MAJOR(*tok);
+
+    for (tok++; *tok != NINED3DSP_END;) {
+        if ((*tok & D3DSI_OPCODE_MASK) == D3DSIO_COMMENT)
+            tok += 1 + ((*tok & D3DSI_COMMENTSIZE_MASK) >> D3DSI_COMMENTSIZE_SHIFT);
+        else if (major >= 2)
+            tok += 1 + ((*tok & D3DSI_INSTLENGTH_MASK) >> D3DSI_INSTLENGTH_SHIFT);
+        else if ((*tok & D3DSI_OPCODE_MASK) == D3DSIO_DEF)
+            tok += 6; /* raw float values could look like an END token */
+        else
+            tok++; /* parameter tokens have bit 31 set */
+    }
+    return (tok + 1 - byte_code) * sizeof(DWORD);
+}
+
+static void
+nine_shader_cache_inputs_init(struct NineDevice9 *device,
+                              const struct nine_shader_info *info,
+                              struct nine_shader_cache_inputs *inputs)
+{
+    memset(inputs, 0, sizeof(*inputs));
+    inputs->type = info->type;
+    inputs->const_i_base = info->const_i_base;
+    inputs->const_b_base = info->const_b_base;
+    inputs->max_vs_const_f = device->max_vs_const_f;
+    inputs->sampler_mask_shadow = info->sampler_mask_shadow;
+    inputs->fog_enable = info->fog_enable;
+    inputs->swvp_on = info->swvp_on;
+
+    /* Only the fields the translator reads for this type are set. */
+    if (info->type == PIPE_SHADER_VERTEX) {
+        inputs->point_size_min = info->point_size_min;
+        inputs->point_size_max = info->point_size_max;
+    } else {
+        inputs->sampler_ps1xtypes = info->sampler_ps1xtypes;
+        inputs->fog_mode = info->fog_enable ? info->fog_mode : 0;
+        inputs->force_color_in_centroid = info->force_color_in_centroid;
+        inputs->projected = info->projected;
+    }
+}
+
+static void
+nine_shader_cache_compute_key(struct disk_cache *cache,
+                              struct NineDevice9 *device,
+                              const struct nine_shader_info *info,
+                              unsigned byte_size, cache_key key)
+{
+    const struct nine_shader_constant_combination *c =
+        info->add_constants_defs.c_combination;
+    struct nine_shader_cache_inputs inputs;
+    struct blob blob;
+    unsigned i;
+
+    nine_shader_cache_inputs_init(device, info, &inputs);
+
+    blob_init(&blob);
+    blob_write_bytes(&blob, &inputs, sizeof(inputs));
+    blob_write_bytes(&blob, info->byte_code, byte_size);
+    if (c) {
+        for (i = 0; i < NINE_MAX_CONST_I; ++i) {
+            if ((*info->add_constants_defs.int_const_added)[i]) {
+                blob_write_uint32(&blob, i);
+                blob_write_bytes(&blob, c->const_i[i], sizeof(c->const_i[i]));
+            }
+        }
+        for (i = 0; i < NINE_MAX_CONST_B; ++i) {
+            if ((*info->add_constants_defs.bool_const_added)[i]) {
+                blob_write_uint32(&blob, NINE_MAX_CONST_I + i);
+                blob_write_uint32(&blob, c->const_b[i] != 0);
+            }
+        }
+    }
+    disk_cache_compute_key(cache, blob.data, blob.size, key);
+    blob_finish(&blob);
+}
+
+static void
+nine_shader_cache_variants_key(struct disk_cache *cache,
+                               const struct nine_shader_info *info,
+                               unsigned byte_size, cache_key key)
+{
+    struct blob blob;
+
+    blob_init(&blob);
+    blob_write_string(&blob, "variants");
+    blob_write_uint32(&blob, info->type);
+    blob_write_bytes(&blob, info->byte_code, byte_size);
+    disk_cache_compute_key(cache, blob.data, blob.size, key);
+    blob_finish(&blob);
+}
+
+static void
+nine_shader_cache_store(struct disk_cache *cache, struct NineDevice9 *device,
+                        const struct nine_shader_info *info,
+                        const struct tgsi_token *tokens, unsigned num_tokens)
+{
+    const struct nine_range *r;
+    struct blob blob;
+    cache_key key;
+    unsigned i, n;
+
+    nine_shader_cache_compute_key(cache, device, info, info->byte_size, key);
+
+    blob_init(&blob);
+    blob_write_uint32(&blob, num_tokens);
+    blob_write_bytes(&blob, tokens, num_tokens * sizeof(tokens[0]));
+
+    blob_write_uint32(&blob, info->version);
+    blob_write_uint32(&blob, info->byte_size);
+    blob_write_bytes(&blob, info->input_map, sizeof(info->input_map));
+    blob_write_uint32(&blob, info->num_inputs);
+    blob_write_uint32(&blob, info->position_t);
+    blob_write_uint32(&blob, info->point_size);
+    blob_write_uint32(&blob, info->sampler_mask);
+    blob_write_uint32(&blob, info->rt_mask);
+    blob_write_uint32(&blob, info->bumpenvmat_needed);
+    blob_write_uint32(&blob, info->const_used_size);
+    blob_write_bytes(&blob, info->int_slots_used, sizeof(info->int_slots_used));
+    blob_write_bytes(&blob, info->bool_slots_used, sizeof(info->bool_slots_used));
+    blob_write_uint32(&blob, info->const_float_slots);
+    blob_write_uint32(&blob, info->const_int_slots);
+    blob_write_uint32(&blob, info->const_bool_slots);
+
+    /* const_ranges ends with a range of size 0, and may be NULL */
+    n = 0;
+    if (info->const_ranges) {
+        while (info->const_ranges[2 * n + 1])
+            n++;
+        n++;
+    }
+    blob_write_uint32(&blob, n);
+    blob_write_bytes(&blob, info->const_ranges, n * 2 * sizeof(unsigned));
+
+    n = 0;
+    for (r = info->lconstf.ranges; r; r = r->next)
+        n++;
+    blob_write_uint32(&blob, n);
+    for (n = 0, r = info->lconstf.ranges; r; r = r->next) {
+        blob_write_uint32(&blob, r->bgn);
+        blob_write_uint32(&blob, r->end);
+        n += r->end - r->bgn;
+    }
+    for (i = 0; i < n * 4; i++)
+        blob_write_uint32(&blob, fui(info->lconstf.data[i]));
+
+    if (!blob.out_of_memory)
+        disk_cache_put(cache, key, blob.data, blob.size, NULL);
+    blob_finish(&blob);
+}
+
+/* Fills in the outputs of the translation and creates the cso from the
+ * cached TGSI.  Returns FALSE on a miss. */
+static boolean
+nine_shader_cache_retrieve(struct disk_cache *cache, struct NineDevice9 *device,
+                           struct nine_shader_info *info,
+                           struct pipe_context *pipe)
+{
+    struct blob_reader blob;
+    const struct tgsi_token *tokens;
+    unsigned *const_ranges = NULL;
+    struct nine_range *ranges = NULL;
+    float *data = NULL;
+    unsigned num_ranges, num_consts = 0, i;
+    cache_key key;
+    size_t size;
+    void *buffer;
+
+    nine_shader_cache_compute_key(cache, device, info,
+                                  sm1_byte_code_size(info->byte_code), key);
+    buffer = disk_cache_get(cache, key, &size);
+    if (!buffer)
+        return FALSE;
+
+    blob_reader_init(&blob, buffer, size);
+    i = blob_read_uint32(&blob);
+    tokens = blob_read_bytes(&blob, i * sizeof(tokens[0]));
+
+    info->version = blob_read_uint32(&blob);
+    info->byte_size = blob_read_uint32(&blob);
+    blob_copy_bytes(&blob, info->input_map, sizeof(info->input_map));
+    info->num_inputs = blob_read_uint32(&blob);
+    info->position_t = blob_read_uint32(&blob);
+    info->point_size = blob_read_uint32(&blob);
+    info->sampler_mask = blob_read_uint32(&blob);
+    info->rt_mask = blob_read_uint32(&blob);
+    info->bumpenvmat_needed = blob_read_uint32(&blob);
+    info->const_used_size = blob_read_uint32(&blob);
+    blob_copy_bytes(&blob, info->int_slots_used, sizeof(info->int_slots_used));
+    blob_copy_bytes(&blob, info->bool_slots_used, sizeof(info->bool_slots_used));
+    info->const_float_slots = blob_read_uint32(&blob);
+    info->const_int_slots = blob_read_uint32(&blob);
+    info->const_bool_slots = blob_read_uint32(&blob);
+
+    i = blob_read_uint32(&blob);
+    if (i && !blob.overrun) {
+        const_ranges = MALLOC(i * 2 * sizeof(unsigned));
+        if (!const_ranges)
+            goto miss;
+        blob_copy_bytes(&blob, const_ranges, i * 2 * sizeof(unsigned));
+    }
+
+    num_ranges = blob_read_uint32(&blob);
+    if (num_ranges && !blob.overrun) {
+        ranges = MALLOC(num_ranges * sizeof(ranges[0]));
+        if (!ranges)
+            goto miss;
+        for (i = 0; i < num_ranges; i++) {
+            ranges[i].bgn = blob_read_uint32(&blob);
+            ranges[i].end = blob_read_uint32(&blob);
+            ranges[i].next = i + 1 < num_ranges ? &ranges[i + 1] : NULL;
+            num_consts += ranges[i].end - ranges[i].bgn;
+        }
+        data = MALLOC(num_consts * 4 * sizeof(float));
+        if (!data)
+            goto miss;
+        for (i = 0; i < num_consts * 4; i++)
+            data[i] = uif(blob_read_uint32(&blob));
+    }
+
+    if (blob.overrun)
+        goto miss;
+
+    info->cso = nine_tgsi_create_shader(tokens, pipe, NULL);
+    if (!info->cso)
+        goto miss;
+
+    info->const_ranges = const_ranges;
+    info->lconstf.ranges = ranges;
+    info->lconstf.data = data;
+    free(buffer);
+    return TRUE;
+
+miss:
+    FREE(const_ranges);
+    FREE(ranges);
+    FREE(data);
+    free(buffer);
+    return FALSE;
+}
+
+/* Remembers the inputs of a new variant, to create it along with its
+ * shader from now on. */
+void
+nine_shader_cache_add_variant(struct NineDevice9 *device,
+                              const struct nine_shader_info *info,
+                              uint64_t key)
+{
+    struct disk_cache *cache = nine_shader_get_disk_cache(device, info);
+    struct nine_shader_cache_variant *variants, *entry;
+    cache_key list_key;
+    size_t size = 0;
+    unsigned i, n;
+
+    /* Constant combinations are numbered in the order they are seen. */
+    if (!cache || info->add_constants_defs.c_combination)
+        return;
+
+    nine_shader_cache_variants_key(cache, info, info->byte_size, list_key);
+    variants = (void *)disk_cache_get(cache, list_key, &size);
+    n = size / sizeof(*variants);
+
+    for (i = 0; i < n; i++) {
+        if (variants[i].key == key) {
+            free(variants);
+            return;
+        }
+    }
+    if (n == NINE_SHADER_CACHE_MAX_VARIANTS) {
+        free(variants);
+        return;
+    }
+
+    entry = realloc(variants, (n + 1) * sizeof(*variants));
+    if (!entry) {
+        free(variants);
+        return;
+    }
+    variants = entry;
+    entry = &variants[n];
+    memset(entry, 0, sizeof(*entry));
+    entry->key = key;
+    nine_shader_cache_inputs_init(device, info, &entry->inputs);
+
+    disk_cache_put(cache, list_key, variants, (n + 1) * sizeof(*variants), NULL);
+    free(variants);
+}
+
+/* Creates the variants of the shader seen in earlier runs.  @base is the
+ * info the shader's first variant was translated with. */
+void
+nine_shader_cache_load_variants(struct NineDevice9 *device,
+                                const struct nine_shader_info *base,
+                                struct nine_shader_variant *list,
+                                struct pipe_context *pipe)
+{
+    struct disk_cache *cache = nine_shader_get_disk_cache(device, base);
+    struct nine_shader_cache_variant *variants;
+    cache_key list_key;
+    size_t size = 0;
+    unsigned i, n;
+
+    if (!cache)
+        return;
+
+    nine_shader_cache_variants_key(cache, base, base->byte_size, list_key);
+    variants = (void *)disk_cache_get(cache, list_key, &size);
+    n = size / sizeof(*variants);
+
+    for (i = 0; i < n; i++) {
+        const struct nine_shader_cache_inputs *inputs = &variants[i].inputs;
+        struct nine_shader_info info = *base;
+        unsigned *const_ranges;
+        unsigned const_used_size;
+
+        if (nine_shader_variant_get(list, &const_ranges, &const_used_size,
+                                    variants[i].key) ||
+            inputs->type != base->type ||
+            inputs->max_vs_const_f != device->max_vs_const_f)
+            continue;
+
+        info.sampler_mask_shadow = inputs->sampler_mask_shadow;
+        info.sampler_ps1xtypes = inputs->sampler_ps1xtypes;
+        info.fog_enable = inputs->fog_enable;
+        info.fog_mode = inputs->fog_mode;
+        info.force_color_in_centroid = inputs->force_color_in_centroid;
+        info.projected = inputs->projected;
+        info.swvp_on = inputs->swvp_on;
+        info.point_size_min = inputs->point_size_min;
+        info.point_size_max = inputs->point_size_max;
+        info.add_constants_defs.c_combination = NULL;
+        info.add_constants_defs.int_const_added = NULL;
+        info.add_constants_defs.bool_const_added = NULL;
+
+        if (FAILED(nine_translate_shader(device, &info, pipe)))
+            continue;
+        FREE(info.lconstf.data);
+        FREE(info.lconstf.ranges);
+        nine_shader_variant_add(list, variants[i].key, info.cso,
+                                info.const_ranges, info.const_used_size);
+    }
+    free(variants);
+}
+
 HRESULT
 nine_translate_shader(struct NineDevice9 *device, struct nine_shader_info *info, struct pipe_context *pipe)
 {
@@ -3914,10 +4327,15 @@ nine_translate_shader(struct NineDevice9 *device, struct nine_shader_info *info,
     HRESULT hr = D3D_OK;
     const unsigned processor = info->type;
     struct pipe_screen *screen = info->process_vertices ? device->screen_sw : device->screen;
+    struct disk_cache *cache = nine_shader_get_disk_cache(device, info);
+    struct tgsi_token *cached_tokens = NULL;
     unsigned *const_ranges = NULL;
 
     user_assert(processor != ~0, D3DERR_INVALIDCALL);
 
+    if (cache && nine_shader_cache_retrieve(cache, device, info, pipe))
+        return D3D_OK;
+
     tx = MALLOC_STRUCT(shader_translator);
     if (!tx)
         return E_OUTOFMEMORY;
@@ -4114,8 +4532,14 @@ nine_translate_shader(struct NineDevice9 *device, struct nine_shader_info *info,
                                                     tx->num_outputs,
                                                     &(info->so));
         info->cso = nine_create_shader_with_so_and_destroy(tx->ureg, pipe, &(info->so));
-    } else
-        info->cso = nine_create_shader_with_so_and_destroy(tx->ureg, pipe, NULL);
+    } else {
+        const struct tgsi_token *tokens = ureg_finalize(tx->ureg);
+
+        if (tokens && cache)
+            cached_tokens = tgsi_dup_tokens(tokens);
+        info->cso = tokens ? nine_tgsi_create_shader(tokens, pipe, NULL) : NULL;
+        ureg_destroy(tx->ureg);
+    }
     if (!info->cso) {
         hr = D3DERR_DRIVERINTERNALERROR;
         FREE(info->lconstf.data);
@@ -4126,9 +4550,14 @@ nine_translate_shader(struct NineDevice9 *device, struct nine_shader_info *info,
     info->const_ranges = const_ranges;
     const_ranges = NULL;
     info->byte_size = (tx->parse - tx->byte_code) * sizeof(DWORD);
+
+    if (cached_tokens)
+        nine_shader_cache_store(cache, device, info, cached_tokens,
+                                tgsi_num_tokens(cached_tokens));
 out:
     if (const_ranges)
         FREE(const_ranges);
+    FREE(cached_tokens);
     tx_dtor(tx);
     return hr;
 }
@@ -42,6 +42,7 @@ struct nine_lconstf /* NOTE: both pointers should be FREE'd by the user */
 };
 
 struct nine_shader_constant_combination;
+struct nine_shader_variant;
 
 struct nine_shader_info
 {
@@ -114,6 +115,17 @@ nine_create_shader_with_so_and_destroy(struct ureg_program *p,
                                        struct pipe_context *pipe,
                                        const struct pipe_stream_output_info *so);
 
+void
+nine_shader_cache_add_variant(struct NineDevice9 *device,
+                              const struct nine_shader_info *info,
+                              uint64_t key);
+
+void
+nine_shader_cache_load_variants(struct NineDevice9 *device,
+                                const struct nine_shader_info *base,
+                                struct nine_shader_variant *list,
+                                struct pipe_context *pipe);
+
 HRESULT
 nine_translate_shader(struct NineDevice9 *device,
                       struct nine_shader_info *,
@@ -59,6 +59,8 @@ NinePixelShader9_ctor( struct NinePixelShader9 *This,
     info.sampler_mask_shadow = 0x0;
     info.sampler_ps1xtypes = 0x0;
     info.fog_enable = 0;
+    info.fog_mode = 0;
+    info.force_color_in_centroid = 0;
     info.projected = 0;
     info.add_constants_defs.c_combination = NULL;
     info.add_constants_defs.int_const_added = NULL;
@@ -98,6 +100,10 @@ NinePixelShader9_ctor( struct NinePixelShader9 *This,
 
     This->c_combinations = NULL;
 
+    pipe = nine_context_get_pipe_acquire(device);
+    nine_shader_cache_load_variants(device, &info, &This->variant, pipe);
+    nine_context_get_pipe_release(device);
+
     /* no constant relative addressing for ps */
     assert(info.lconstf.data == NULL);
     assert(info.lconstf.ranges == NULL);
@@ -216,6 +222,7 @@ NinePixelShader9_GetVariant( struct NinePixelShader9 *This,
             return NULL;
         nine_shader_variant_add(&This->variant, key, info.cso,
                                 info.const_ranges, info.const_used_size);
+        nine_shader_cache_add_variant(device, &info, key);
         cso = info.cso;
         *const_ranges = info.const_ranges;
         *const_used_size = info.const_used_size;
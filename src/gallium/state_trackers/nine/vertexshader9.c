@@ -114,6 +114,10 @@ NineVertexShader9_ctor( struct NineVertexShader9 *This,
 
     This->c_combinations = NULL;
 
+    pipe = nine_context_get_pipe_acquire(device);
+    nine_shader_cache_load_variants(device, &info, &This->variant, pipe);
+    nine_context_get_pipe_release(device);
+
     for (i = 0; i < info.num_inputs && i < ARRAY_SIZE(This->input_map); ++i)
         This->input_map[i].ndecl = info.input_map[i];
     This->num_inputs = i;
@@ -229,6 +233,7 @@ NineVertexShader9_GetVariant( struct NineVertexShader9 *This,
             return NULL;
         nine_shader_variant_add(&This->variant, key, info.cso,
                                 info.const_ranges, info.const_used_size);
+        nine_shader_cache_add_variant(device, &info, key);
         cso = info.cso;
         *const_ranges = info.const_ranges;
         *const_used_size = info.const_used_size;
@@ -31,16 +31,15 @@
  * Otherwise we use softpipe.  The GALLIUM_DRIVER environment variable
  * may be set to "softpipe" or "llvmpipe" to override.
  *
- * With softpipe we could render directly into the user's buffer by using a
- * display target resource.  However, softpipe doesn't support "upside-down"
- * rendering which would be needed for the OSMESA_Y_UP=TRUE case.
+ * Gallium doesn't support "upside-down" rendering into window-system
+ * buffers, which would be needed for the OSMESA_Y_UP=TRUE case.  So with
+ * OSMESA_Y_UP=FALSE, when the driver implements resource_from_user_memory
+ * (llvmpipe) and wants the same row stride as the user's buffer, we render
+ * directly into the user's buffer.
  *
- * With llvmpipe we could only render directly into the user's buffer when its
- * width and height is a multiple of the tile size (64 pixels).
- *
- * Because of these constraints we always render into ordinary resources then
- * copy the results to the user's buffer in the flush_front() function which
- * is called when the app calls glFlush/Finish.
+ * Otherwise we render into ordinary resources then copy the results to the
+ * user's buffer in the flush_front() function which is called when the app
+ * calls glFlush/Finish.
  *
  * In general, the OSMesa interface is pretty ugly and not a good match
  * for Gallium.  But we're interested in doing the best we can to preserve
@@ -88,6 +87,10 @@ struct osmesa_buffer
    struct pipe_resource *textures[ST_ATTACHMENT_COUNT];
 
    void *map;
+   unsigned map_stride;         /**< bytes per row of map */
+   boolean map_y_up;            /**< rows of map are stored bottom first */
+   /** The color buffer is a user memory resource wrapping map */
+   boolean map_is_color_buffer;
 
    struct osmesa_buffer *next;  /**< next in linked list */
 };
@@ -357,6 +360,14 @@ osmesa_st_framebuffer_flush_front(struct st_context_iface *stctx,
    map = pipe->transfer_map(pipe, res, 0, PIPE_TRANSFER_READ, &box,
                             &transfer);
 
+   /* Mapping waited for the rendering, which is all there is to do when
+    * it went straight into the user's buffer.
+    */
+   if (statt == ST_ATTACHMENT_FRONT_LEFT && osbuffer->map_is_color_buffer) {
+      pipe->transfer_unmap(pipe, transfer);
+      return true;
+   }
+
    /*
     * Copy the color buffer from the resource to the user's buffer.
     */
@@ -387,6 +398,45 @@ osmesa_st_framebuffer_flush_front(struct st_context_iface *stctx,
 }
 
 
+/**
+ * Try to use the user's buffer itself as the color buffer.  Returns NULL
+ * if its rows are bottom first, or if the driver can't wrap it or would
+ * lay it out with a different stride.
+ */
+static struct pipe_resource *
+osmesa_wrap_user_buffer(struct pipe_context *pipe,
+                        struct osmesa_buffer *osbuffer,
+                        const struct pipe_resource *templat)
+{
+   struct pipe_screen *screen = pipe->screen;
+   struct pipe_resource *res;
+   struct pipe_transfer *transfer;
+   struct pipe_box box;
+   void *map;
+   bool ok = false;
+
+   if (osbuffer->map_y_up || !screen->resource_from_user_memory)
+      return NULL;
+
+   res = screen->resource_from_user_memory(screen, templat, osbuffer->map);
+   if (!res)
+      return NULL;
+
+   u_box_2d(0, 0, res->width0, res->height0, &box);
+   map = pipe->transfer_map(pipe, res, 0, PIPE_TRANSFER_READ, &box,
+                            &transfer);
+   if (map) {
+      ok = map == osbuffer->map && transfer->stride == osbuffer->map_stride;
+      pipe->transfer_unmap(pipe, transfer);
+   }
+
+   if (!ok)
+      pipe_resource_reference(&res, NULL);
+
+   return res;
+}
+
+
 /**
  * Called by the st manager to validate the framebuffer (allocate
  * its resources).
@@ -444,8 +494,15 @@ osmesa_st_framebuffer_validate(struct st_context_iface *stctx,
       templat.format = format;
       templat.bind = bind;
       pipe_resource_reference(&out[i], NULL);
-      out[i] = osbuffer->textures[statts[i]] =
-         screen->resource_create(screen, &templat);
+
+      if (statts[i] == ST_ATTACHMENT_FRONT_LEFT) {
+         out[i] = osmesa_wrap_user_buffer(stctx->pipe, osbuffer, &templat);
+         osbuffer->map_is_color_buffer = out[i] != NULL;
+      }
+      if (!out[i])
+         out[i] = screen->resource_create(screen, &templat);
+
+      osbuffer->textures[statts[i]] = out[i];
    }
 
    return true;
@@ -495,6 +552,35 @@ osmesa_create_buffer(enum pipe_format color_format,
 }
 
 
+/**
+ * Record where and how the user's buffer stores the image.  When the
+ * color buffer can be, or was, the user's buffer itself, a change makes
+ * the framebuffer get validated again.  Anything rendered into the old
+ * color buffer is lost then, which is fine for the usual case of changing
+ * the pixel store parameters before rendering.
+ */
+static void
+osmesa_set_buffer_layout(struct osmesa_buffer *osbuffer, void *map,
+                         GLint row_length, GLboolean y_up)
+{
+   struct pipe_screen *screen = get_st_manager()->screen;
+   unsigned bpp = util_format_get_blocksize(osbuffer->visual.color_format);
+   unsigned stride = bpp * (row_length ? row_length : osbuffer->width);
+
+   if (map == osbuffer->map && stride == osbuffer->map_stride &&
+       y_up == osbuffer->map_y_up)
+      return;
+
+   if (osbuffer->map_is_color_buffer ||
+       (!y_up && screen->resource_from_user_memory))
+      p_atomic_inc(&osbuffer->stfb->stamp);
+
+   osbuffer->map = map;
+   osbuffer->map_stride = stride;
+   osbuffer->map_y_up = y_up;
+}
+
+
 /**
  * Search linked list for a buffer with matching pixel formats and size.
  */
@@ -793,7 +879,8 @@ OSMesaMakeCurrent(OSMesaContext osmesa, void *buffer, GLenum type,
 
    osbuffer->width = width;
    osbuffer->height = height;
-   osbuffer->map = buffer;
+   osmesa_set_buffer_layout(osbuffer, buffer, osmesa->user_row_length,
+                            osmesa->y_up);
 
    /* XXX unused for now */
    (void) osmesa_destroy_buffer;
@@ -857,6 +944,13 @@ OSMesaPixelStore(GLint pname, GLint value)
       fprintf(stderr, "Invalid pname in OSMesaPixelStore()\n");
       return;
    }
+
+   if (osmesa->current_buffer) {
+      struct osmesa_buffer *osbuffer = osmesa->current_buffer;
+
+      osmesa_set_buffer_layout(osbuffer, osbuffer->map,
+                               osmesa->user_row_length, osmesa->y_up);
+   }
 }
 
 
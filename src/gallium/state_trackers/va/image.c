@@ -28,6 +28,8 @@
 
 #include "pipe/p_screen.h"
 
+#include "util/u_box.h"
+#include "util/u_inlines.h"
 #include "util/u_memory.h"
 #include "util/u_handle_table.h"
 #include "util/u_surface.h"
@@ -69,6 +71,49 @@ vlVaVideoSurfaceSize(vlVaSurface *p_surf, int component,
                                p_surf->templat.interlaced);
 }
 
+/* Upload one layer of a plane through a linear staging texture and a GPU
+ * copy, so a tiled surface that is still in use by the decoder or encoder
+ * is neither stalled on nor detiled by the CPU.  Linear surfaces, and
+ * drivers which can't give us the staging texture, go through
+ * texture_subdata.
+ */
+static void
+vlVaUploadPlane(struct pipe_context *pipe, struct pipe_resource *tex,
+                const struct pipe_box *dst_box, const void *data,
+                unsigned stride)
+{
+   struct pipe_resource templ, *staging = NULL;
+   struct pipe_box box;
+
+   if (!(tex->bind & PIPE_BIND_LINEAR) && pipe->resource_copy_region) {
+      memset(&templ, 0, sizeof(templ));
+      templ.target = PIPE_TEXTURE_2D;
+      templ.format = tex->format;
+      templ.width0 = dst_box->width;
+      templ.height0 = dst_box->height;
+      templ.depth0 = 1;
+      templ.array_size = 1;
+      templ.bind = PIPE_BIND_LINEAR;
+      templ.usage = PIPE_USAGE_STREAM;
+      staging = pipe->screen->resource_create(pipe->screen, &templ);
+   }
+
+   if (!staging) {
+      pipe->texture_subdata(pipe, tex, 0, PIPE_TRANSFER_WRITE, dst_box,
+                            data, stride, 0);
+      return;
+   }
+
+   u_box_2d(0, 0, dst_box->width, dst_box->height, &box);
+   pipe->texture_subdata(pipe, staging, 0,
+                         PIPE_TRANSFER_WRITE |
+                         PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE,
+                         &box, data, stride, 0);
+   pipe->resource_copy_region(pipe, tex, 0, dst_box->x, dst_box->y,
+                              dst_box->z, staging, 0, &box);
+   pipe_resource_reference(&staging, NULL);
+}
+
 VAStatus
 vlVaQueryImageFormats(VADriverContextP ctx, VAImageFormat *format_list, int *num_formats)
 {
@@ -518,12 +563,6 @@ vlVaPutImage(VADriverContextP ctx, VASurfaceID surface, VAImageID image,
       return VA_STATUS_ERROR_INVALID_BUFFER;
    }
 
-   if (img_buf->derived_surface.resource) {
-      /* Attempting to transfer derived image to surface */
-      mtx_unlock(&drv->mutex);
-      return VA_STATUS_ERROR_UNIMPLEMENTED;
-   }
-
    format = VaFourccToPipeFormat(vaimage->format.fourcc);
 
    if (format == PIPE_FORMAT_NONE) {
@@ -558,6 +597,32 @@ vlVaPutImage(VADriverContextP ctx, VASurfaceID surface, VAImageID image,
       return VA_STATUS_ERROR_OPERATION_FAILED;
    }
 
+   if (img_buf->derived_surface.resource) {
+      /* A derived image is a single plane surface's own texture, so it
+       * only needs a GPU copy, or nothing at all when it is put back into
+       * the surface it came from.
+       */
+      struct pipe_resource *src = img_buf->derived_surface.resource;
+      struct pipe_resource *dst = views[0] ? views[0]->texture : NULL;
+      struct pipe_box box;
+
+      if (!dst || dst->format != src->format ||
+          dst->array_size != src->array_size) {
+         mtx_unlock(&drv->mutex);
+         return VA_STATUS_ERROR_UNIMPLEMENTED;
+      }
+
+      if (dst != src) {
+         u_box_3d(0, 0, 0, MIN2(src->width0, dst->width0),
+                  MIN2(src->height0, dst->height0), src->array_size, &box);
+         drv->pipe->resource_copy_region(drv->pipe, dst, 0, 0, 0, 0,
+                                         src, 0, &box);
+      }
+      mtx_unlock(&drv->mutex);
+
+      return VA_STATUS_SUCCESS;
+   }
+
    for (i = 0; i < vaimage->num_planes; i++) {
       data[i] = img_buf->data + vaimage->offsets[i];
       pitches[i] = vaimage->pitches[i];
@@ -606,10 +671,9 @@ vlVaPutImage(VADriverContextP ctx, VASurfaceID surface, VAImageID image,
                                   map, dst_box.width, dst_box.height);
             pipe_transfer_unmap(drv->pipe, transfer);
          } else {
-            drv->pipe->texture_subdata(drv->pipe, tex, 0,
-                                       PIPE_TRANSFER_WRITE, &dst_box,
-                                       data[i] + pitches[i] * j,
-                                       pitches[i] * views[i]->texture->array_size, 0);
+            vlVaUploadPlane(drv->pipe, tex, &dst_box,
+                            data[i] + pitches[i] * j,
+                            pitches[i] * tex->array_size);
          }
       }
    }
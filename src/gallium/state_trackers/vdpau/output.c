@@ -93,6 +93,13 @@ vlVdpOutputSurfaceCreate(VdpDevice device,
                    PIPE_BIND_SHARED | PIPE_BIND_SCANOUT;
    res_tmpl.usage = PIPE_USAGE_DEFAULT;
 
+   /* The compute compositor writes the surface as an image. */
+   if (dev->compositor.pipe_cs_composit_supported &&
+       pipe->screen->is_format_supported(pipe->screen, res_tmpl.format,
+                                         res_tmpl.target, 0, 0,
+                                         PIPE_BIND_SHADER_IMAGE))
+      res_tmpl.bind |= PIPE_BIND_SHADER_IMAGE;
+
    mtx_lock(&dev->mutex);
 
    if (!CheckSurfaceParams(pipe->screen, &res_tmpl))
@@ -0,0 +1,258 @@
+/*
+ * Checks that the pre-decoded instructions of tgsi_exec give the same
+ * results as the generic interpreter, and with "-b" measures how fast
+ * both are.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "tgsi/tgsi_exec.h"
+#include "tgsi/tgsi_text.h"
+#include "util/os_time.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+
+#define NUM_INPUTS 2
+#define NUM_OUTPUTS 2
+#define NUM_CONSTS 4
+
+static const char *shaders[] = {
+   /* vertex transform and some lighting-like math */
+   "VERT\n"
+   "DCL IN[0]\n"
+   "DCL IN[1]\n"
+   "DCL OUT[0], POSITION\n"
+   "DCL OUT[1], GENERIC[0]\n"
+   "DCL CONST[0..3]\n"
+   "DCL TEMP[0..2]\n"
+   "IMM[0] FLT32 { 0.5, 2.0, -1.0, 0.0 }\n"
+   "  0: MUL TEMP[0], IN[0].xxxx, CONST[0]\n"
+   "  1: MAD TEMP[0], IN[0].yyyy, CONST[1], TEMP[0]\n"
+   "  2: MAD TEMP[0], IN[0].zzzz, CONST[2], TEMP[0]\n"
+   "  3: MAD OUT[0], IN[0].wwww, CONST[3], TEMP[0]\n"
+   "  4: DP3 TEMP[1].x, IN[1], IN[1]\n"
+   "  5: RSQ TEMP[1].x, TEMP[1].xxxx\n"
+   "  6: MUL TEMP[1].xyz, IN[1], TEMP[1].xxxx\n"
+   "  7: DP3_SAT TEMP[2].x, TEMP[1], CONST[0]\n"
+   "  8: LRP TEMP[2], TEMP[2].xxxx, IN[1], IMM[0]\n"
+   "  9: MAX TEMP[2], TEMP[2], -|IN[0]|\n"
+   " 10: MIN TEMP[2].xy, TEMP[2], IMM[0].yyyy\n"
+   " 11: ADD TEMP[2].zw, TEMP[2].zwzw, -IN[1].wzyx\n"
+   " 12: DP4 TEMP[0].w, TEMP[2], IN[1]\n"
+   " 13: DP2 TEMP[0].z, TEMP[2], IMM[0]\n"
+   " 14: MOV OUT[1], TEMP[2]\n"
+   " 15: MOV_SAT OUT[1].zw, TEMP[0]\n"
+   " 16: END\n",
+
+   /* masked stores, aliasing and out of bounds constants */
+   "VERT\n"
+   "DCL IN[0]\n"
+   "DCL IN[1]\n"
+   "DCL OUT[0], POSITION\n"
+   "DCL OUT[1], GENERIC[0]\n"
+   "DCL CONST[0..3]\n"
+   "DCL TEMP[0..1]\n"
+   "IMM[0] FLT32 { 1.0, 0.0, -0.0, 3.0 }\n"
+   "  0: MOV TEMP[0], IN[0].wzyx\n"
+   "  1: MOV OUT[0], IMM[0]\n"
+   "  2: MOV OUT[1], CONST[7]\n"
+   "  3: IF IN[1].xxxx :0\n"
+   "  4:   MUL_SAT OUT[0].xy, TEMP[0], IN[1]\n"
+   "  5:   ADD TEMP[0], TEMP[0].yzwx, TEMP[0]\n"
+   "  6: ELSE :0\n"
+   "  7:   MAD OUT[1], TEMP[0], CONST[3].wzyx, -IN[0]\n"
+   "  8: ENDIF\n"
+   "  9: DP4 TEMP[1].xz, TEMP[0], TEMP[0]\n"
+   " 10: MIN OUT[0].zw, TEMP[1], |IN[1]|\n"
+   " 11: MAX_SAT OUT[1].x, TEMP[1].zzzz, -IN[1]\n"
+   " 12: END\n",
+};
+
+static float
+random_float(void)
+{
+   switch (rand() % 16) {
+   case 0: return 0.0f;
+   case 1: return -0.0f;
+   case 2: return NAN;
+   case 3: return INFINITY;
+   case 4: return 1.0f;
+   default: return (float)(rand() % 2001 - 1000) / 250.0f;
+   }
+}
+
+static void
+fill_inputs(struct tgsi_exec_vector *inputs, unsigned num)
+{
+   unsigned i, c, q;
+
+   for (i = 0; i < num; i++) {
+      for (c = 0; c < TGSI_NUM_CHANNELS; c++) {
+         for (q = 0; q < TGSI_QUAD_SIZE; q++)
+            inputs[i].xyzw[c].f[q] = random_float();
+      }
+   }
+}
+
+/* The sign and payload of NaNs depend on the order the compiler put the
+ * operands of the generic code in, so any two NaNs match.
+ */
+static bool
+same_value(const union tgsi_exec_channel *a, const union tgsi_exec_channel *b,
+           unsigned q)
+{
+   return a->u[q] == b->u[q] || (util_is_nan(a->f[q]) && util_is_nan(b->f[q]));
+}
+
+static bool
+same_outputs(const struct tgsi_exec_vector *a, const struct tgsi_exec_vector *b)
+{
+   unsigned i, c, q;
+
+   for (i = 0; i < NUM_OUTPUTS; i++) {
+      for (c = 0; c < TGSI_NUM_CHANNELS; c++) {
+         for (q = 0; q < TGSI_QUAD_SIZE; q++) {
+            if (!same_value(&a[i].xyzw[c], &b[i].xyzw[c], q))
+               return false;
+         }
+      }
+   }
+   return true;
+}
+
+static struct tgsi_exec_machine *
+create_machine(const struct tgsi_token *tokens, const float *consts)
+{
+   struct tgsi_exec_machine *mach = tgsi_exec_machine_create(PIPE_SHADER_VERTEX);
+   const void *bufs[1] = { consts };
+   const unsigned sizes[1] = { NUM_CONSTS * 4 };
+
+   tgsi_exec_machine_bind_shader(mach, tokens, NULL, NULL, NULL);
+   tgsi_exec_set_constant_buffers(mach, 1, bufs, sizes);
+   return mach;
+}
+
+static void
+run(struct tgsi_exec_machine *mach, const struct tgsi_exec_vector *inputs,
+    struct tgsi_exec_vector *outputs)
+{
+   memcpy(mach->Inputs, inputs, NUM_INPUTS * sizeof(*inputs));
+   memset(mach->Outputs, 0, NUM_OUTPUTS * sizeof(*outputs));
+   memset(mach->Temps, 0, 4 * sizeof(mach->Temps[0]));
+   tgsi_exec_machine_run(mach, 0);
+   memcpy(outputs, mach->Outputs, NUM_OUTPUTS * sizeof(*outputs));
+}
+
+static bool
+test_shader(unsigned s, const struct tgsi_token *tokens, const float *consts)
+{
+   struct tgsi_exec_machine *fast = create_machine(tokens, consts);
+   struct tgsi_exec_machine *generic = create_machine(tokens, consts);
+   bool success = true;
+   unsigned n;
+
+   if (!fast->Ops) {
+      printf("Failure! shader %u has no pre-decoded instructions\n", s);
+      success = false;
+   }
+
+   FREE(generic->Ops);
+   generic->Ops = NULL;
+
+   for (n = 0; n < 1000 && success; n++) {
+      struct tgsi_exec_vector inputs[NUM_INPUTS];
+      struct tgsi_exec_vector expected[NUM_OUTPUTS], result[NUM_OUTPUTS];
+
+      fill_inputs(inputs, NUM_INPUTS);
+      run(generic, inputs, expected);
+      run(fast, inputs, result);
+
+      if (!same_outputs(expected, result)) {
+         unsigned i, c, q;
+
+         printf("Failure! shader %u, run %u:\n", s, n);
+         for (i = 0; i < NUM_OUTPUTS; i++) {
+            for (c = 0; c < TGSI_NUM_CHANNELS; c++) {
+               for (q = 0; q < TGSI_QUAD_SIZE; q++) {
+                  if (!same_value(&expected[i].xyzw[c], &result[i].xyzw[c], q)) {
+                     printf("  OUT[%u].%c[%u]: %g (0x%08x) != %g (0x%08x)\n",
+                            i, "xyzw"[c], q,
+                            result[i].xyzw[c].f[q], result[i].xyzw[c].u[q],
+                            expected[i].xyzw[c].f[q], expected[i].xyzw[c].u[q]);
+                  }
+               }
+            }
+         }
+         success = false;
+      }
+   }
+
+   tgsi_exec_machine_destroy(fast);
+   tgsi_exec_machine_destroy(generic);
+   return success;
+}
+
+static void
+benchmark_shader(unsigned s, const struct tgsi_token *tokens,
+                 const float *consts)
+{
+   const unsigned iterations = 1000000;
+   struct tgsi_exec_vector inputs[NUM_INPUTS], outputs[NUM_OUTPUTS];
+   unsigned pass, i;
+
+   fill_inputs(inputs, NUM_INPUTS);
+
+   for (pass = 0; pass < 2; pass++) {
+      struct tgsi_exec_machine *mach = create_machine(tokens, consts);
+      int64_t start, time;
+
+      if (pass == 1) {
+         FREE(mach->Ops);
+         mach->Ops = NULL;
+      }
+
+      start = os_time_get_nano();
+      for (i = 0; i < iterations; i++)
+         run(mach, inputs, outputs);
+      time = os_time_get_nano() - start;
+
+      printf("shader %u, %s: %.3f ns/quad\n", s,
+             pass == 0 ? "pre-decoded" : "generic",
+             (double)time / iterations);
+
+      tgsi_exec_machine_destroy(mach);
+   }
+}
+
+int
+main(int argc, char **argv)
+{
+   struct tgsi_token tokens[ARRAY_SIZE(shaders)][1024];
+   float consts[NUM_CONSTS * 4];
+   bool success = true;
+   unsigned s, i;
+
+   for (i = 0; i < ARRAY_SIZE(consts); i++)
+      consts[i] = random_float();
+
+   for (s = 0; s < ARRAY_SIZE(shaders); s++) {
+      if (!tgsi_text_translate(shaders[s], tokens[s], ARRAY_SIZE(tokens[s]))) {
+         printf("Failure! shader %u doesn't parse\n", s);
+         return 1;
+      }
+      success &= test_shader(s, tokens[s], consts);
+   }
+
+   if (!success)
+      return 1;
+
+   if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+      for (s = 0; s < ARRAY_SIZE(shaders); s++)
+         benchmark_shader(s, tokens[s], consts);
+   }
+
+   printf("Success!\n");
+   return 0;
+}
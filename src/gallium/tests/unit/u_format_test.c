@@ -28,12 +28,16 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <float.h>
 
 #include "util/u_half.h"
 #include "util/u_format.h"
 #include "util/u_format_tests.h"
 #include "util/u_format_s3tc.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_memory.h"
+#include "util/os_time.h"
 
 
 static boolean
@@ -709,6 +713,89 @@ test_format_norm_flags(const struct util_format_description *format_desc)
    return success;
 }
 
+
+#define ROW_PIXELS 37
+
+
+/*
+ * Check that converting a whole row, which may take the SIMD paths, gives
+ * the same result as the plain C code, by running it with and without
+ * SSSE3 enabled in util_cpu_caps.
+ */
+static boolean
+test_format_rows(const struct util_format_description *format_desc)
+{
+   static uint8_t packed[2][ROW_PIXELS * UTIL_FORMAT_MAX_PACKED_BYTES];
+   static uint8_t unpacked_8unorm[2][ROW_PIXELS * 4];
+   static float unpacked_float[2][ROW_PIXELS * 4];
+   static uint8_t src_8unorm[ROW_PIXELS * 4];
+   static float src_float[ROW_PIXELS * 4];
+   const unsigned packed_stride = ROW_PIXELS * format_desc->block.bits / 8;
+   const unsigned has_ssse3 = util_cpu_caps.has_ssse3;
+   boolean success = TRUE;
+   unsigned i, pass;
+
+   if (format_desc->block.width != 1 || format_desc->block.height != 1 ||
+       format_desc->block.bits % 8)
+      return TRUE;
+
+   srand(format_desc->format);
+   for (i = 0; i < packed_stride; ++i)
+      packed[0][i] = rand();
+   for (i = 0; i < ROW_PIXELS * 4; ++i) {
+      src_8unorm[i] = rand();
+      src_float[i] = (float)rand() / RAND_MAX * 1.5f - 0.25f;
+   }
+
+   for (pass = 0; pass < 2; ++pass) {
+      util_cpu_caps.has_ssse3 = pass ? has_ssse3 : 0;
+
+      if (format_desc->unpack_rgba_8unorm)
+         format_desc->unpack_rgba_8unorm(unpacked_8unorm[pass], 0,
+                                         packed[0], 0, ROW_PIXELS, 1);
+      if (format_desc->unpack_rgba_float)
+         format_desc->unpack_rgba_float(unpacked_float[pass], 0,
+                                        packed[0], 0, ROW_PIXELS, 1);
+   }
+
+   if (memcmp(unpacked_8unorm[0], unpacked_8unorm[1], sizeof unpacked_8unorm[0]) ||
+       memcmp(unpacked_float[0], unpacked_float[1], sizeof unpacked_float[0])) {
+      printf("FAILED: %s row unpack mismatch\n", format_desc->short_name);
+      success = FALSE;
+   }
+
+   if (format_desc->pack_rgba_8unorm) {
+      for (pass = 0; pass < 2; ++pass) {
+         util_cpu_caps.has_ssse3 = pass ? has_ssse3 : 0;
+         memset(packed[pass], 0, packed_stride);
+         format_desc->pack_rgba_8unorm(packed[pass], 0,
+                                       src_8unorm, 0, ROW_PIXELS, 1);
+      }
+      if (memcmp(packed[0], packed[1], packed_stride)) {
+         printf("FAILED: %s row pack_rgba_8unorm mismatch\n", format_desc->short_name);
+         success = FALSE;
+      }
+   }
+
+   if (format_desc->pack_rgba_float) {
+      for (pass = 0; pass < 2; ++pass) {
+         util_cpu_caps.has_ssse3 = pass ? has_ssse3 : 0;
+         memset(packed[pass], 0, packed_stride);
+         format_desc->pack_rgba_float(packed[pass], 0,
+                                      src_float, 0, ROW_PIXELS, 1);
+      }
+      if (memcmp(packed[0], packed[1], packed_stride)) {
+         printf("FAILED: %s row pack_rgba_float mismatch\n", format_desc->short_name);
+         success = FALSE;
+      }
+   }
+
+   util_cpu_caps.has_ssse3 = has_ssse3;
+
+   return success;
+}
+
+
 typedef boolean
 (*test_func_t)(const struct util_format_description *format_desc,
                const struct util_format_test_case *test);
@@ -800,6 +887,7 @@ test_all(void)
       TEST_ONE_FUNC(pack_s_8uint);
 
       TEST_FORMAT_METADATA(norm_flags);
+      TEST_FORMAT_METADATA(rows);
 
 #     undef TEST_ONE_FUNC
 #     undef TEST_ONE_FORMAT
@@ -809,10 +897,95 @@ test_all(void)
 }
 
 
+#define BENCH_WIDTH  1024
+#define BENCH_HEIGHT 256
+#define BENCH_RUNS   4
+
+
+/*
+ * Report the best row conversion throughput of every format, e.g. to
+ * compare the SIMD paths against the plain C ones.
+ */
+static void
+bench_all(void)
+{
+   const unsigned unpacked_stride = BENCH_WIDTH * 4 * sizeof(float);
+   uint8_t *packed = CALLOC(BENCH_WIDTH * BENCH_HEIGHT, UTIL_FORMAT_MAX_PACKED_BYTES);
+   float *unpacked = CALLOC(BENCH_WIDTH * BENCH_HEIGHT * 4, sizeof(float));
+   enum pipe_format format;
+   unsigned i;
+
+   /* Fault the pages in so the first format isn't penalized. */
+   memset(packed, 0x55, BENCH_WIDTH * BENCH_HEIGHT * UTIL_FORMAT_MAX_PACKED_BYTES);
+   memset(unpacked, 0, BENCH_WIDTH * BENCH_HEIGHT * 4 * sizeof(float));
+
+   for (format = 1; format < PIPE_FORMAT_COUNT; ++format) {
+      const struct util_format_description *format_desc;
+      unsigned packed_stride;
+      int64_t best[4] = { INT64_MAX, INT64_MAX, INT64_MAX, INT64_MAX };
+      int64_t t[5];
+      unsigned run;
+
+      format_desc = util_format_description(format);
+      if (!format_desc ||
+          format_desc->block.width != 1 || format_desc->block.height != 1 ||
+          !format_desc->unpack_rgba_8unorm || !format_desc->pack_rgba_8unorm ||
+          !format_desc->unpack_rgba_float || !format_desc->pack_rgba_float)
+         continue;
+
+      packed_stride = BENCH_WIDTH * format_desc->block.bits / 8;
+
+      for (run = 0; run < BENCH_RUNS; ++run) {
+         t[0] = os_time_get_nano();
+         format_desc->unpack_rgba_8unorm((uint8_t *)unpacked, BENCH_WIDTH * 4,
+                                         packed, packed_stride,
+                                         BENCH_WIDTH, BENCH_HEIGHT);
+         t[1] = os_time_get_nano();
+         format_desc->pack_rgba_8unorm(packed, packed_stride,
+                                       (uint8_t *)unpacked, BENCH_WIDTH * 4,
+                                       BENCH_WIDTH, BENCH_HEIGHT);
+         t[2] = os_time_get_nano();
+         format_desc->unpack_rgba_float(unpacked, unpacked_stride,
+                                        packed, packed_stride,
+                                        BENCH_WIDTH, BENCH_HEIGHT);
+         t[3] = os_time_get_nano();
+         format_desc->pack_rgba_float(packed, packed_stride,
+                                      unpacked, unpacked_stride,
+                                      BENCH_WIDTH, BENCH_HEIGHT);
+         t[4] = os_time_get_nano();
+
+         for (i = 0; i < 4; ++i)
+            best[i] = MIN2(best[i], t[i + 1] - t[i]);
+      }
+
+#     define MPIX_PER_S(t) \
+         ((double)BENCH_WIDTH * BENCH_HEIGHT * 1000.0 / MAX2((t), 1))
+
+      printf("%-32s unpack_8unorm %8.1f  pack_8unorm %8.1f  "
+             "unpack_float %8.1f  pack_float %8.1f Mpix/s\n",
+             format_desc->short_name,
+             MPIX_PER_S(best[0]), MPIX_PER_S(best[1]),
+             MPIX_PER_S(best[2]), MPIX_PER_S(best[3]));
+
+#     undef MPIX_PER_S
+   }
+
+   FREE(packed);
+   FREE(unpacked);
+}
+
+
 int main(int argc, char **argv)
 {
    boolean success;
 
+   util_cpu_detect();
+
+   if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+      bench_all();
+      return 0;
+   }
+
    success = test_all();
 
    return success ? 0 : 1;
@@ -0,0 +1,268 @@
+/*
+ * Checks the index translation functions of u_indices against reference
+ * implementations, and with "-b" measures how fast they are.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "indices/u_indices.h"
+#include "util/os_time.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_memory.h"
+#include "util/u_prim.h"
+
+#if defined(USE_SSE41)
+#include "indices/u_indices_sse41.h"
+#endif
+
+/* Quad vertices of the two triangles, by in_pv and out_pv. */
+static const unsigned quad_tris[PV_COUNT][PV_COUNT][6] = {
+   { { 0, 1, 2, 0, 2, 3 }, { 1, 2, 0, 2, 3, 0 } },
+   { { 3, 0, 1, 3, 1, 2 }, { 0, 1, 3, 1, 2, 3 } },
+};
+
+/* Triangle vertices, by in_pv and out_pv. */
+static const unsigned tri[PV_COUNT][PV_COUNT][3] = {
+   { { 0, 1, 2 }, { 1, 2, 0 } },
+   { { 2, 0, 1 }, { 0, 1, 2 } },
+};
+
+static unsigned
+get_index(const void *indices, unsigned index_size, unsigned i)
+{
+   switch (index_size) {
+   case 1: return ((const uint8_t *)indices)[i];
+   case 2: return ((const uint16_t *)indices)[i];
+   default: return ((const uint32_t *)indices)[i];
+   }
+}
+
+static void
+set_index(void *indices, unsigned index_size, unsigned i, unsigned value)
+{
+   switch (index_size) {
+   case 1: ((uint8_t *)indices)[i] = value; break;
+   case 2: ((uint16_t *)indices)[i] = value; break;
+   default: ((uint32_t *)indices)[i] = value; break;
+   }
+}
+
+static void
+fill_indices(void *indices, unsigned index_size, unsigned nr)
+{
+   unsigned mask = index_size == 4 ? ~0u : (1u << (index_size * 8)) - 1;
+   unsigned i;
+
+   for (i = 0; i < nr; i++)
+      set_index(indices, index_size, i, (unsigned)rand() & mask);
+}
+
+static unsigned
+reference_index(enum pipe_prim_type prim, const void *in, unsigned in_size,
+                unsigned in_pv, unsigned out_pv, unsigned j)
+{
+   switch (prim) {
+   case PIPE_PRIM_QUADS:
+      return get_index(in, in_size,
+                       j / 6 * 4 + quad_tris[in_pv][out_pv][j % 6]);
+   case PIPE_PRIM_TRIANGLES:
+      return get_index(in, in_size, j / 3 * 3 + tri[in_pv][out_pv][j % 3]);
+   default:
+      return get_index(in, in_size, j);
+   }
+}
+
+static bool
+test_translate(enum pipe_prim_type prim, unsigned in_size,
+               unsigned in_pv, unsigned out_pv, unsigned nr)
+{
+   const unsigned hw_mask = (1 << PIPE_PRIM_POINTS) |
+                            (1 << PIPE_PRIM_LINES) |
+                            (1 << PIPE_PRIM_TRIANGLES);
+   enum pipe_prim_type out_prim;
+   unsigned out_size, out_nr, j;
+   u_translate_func translate;
+   void *in, *out;
+   bool success = true;
+
+   in = MALLOC(nr * in_size + 1);
+   out = MALLOC(nr * 4 * 2 + 1);
+   fill_indices(in, in_size, nr);
+
+   u_index_translator(hw_mask, prim, in_size, nr, in_pv, out_pv, PR_DISABLE,
+                      &out_prim, &out_size, &out_nr, &translate);
+   translate(in, 0, nr, out_nr, 0, out);
+
+   for (j = 0; j < out_nr; j++) {
+      unsigned expected = reference_index(prim, in, in_size, in_pv, out_pv, j);
+      unsigned value = get_index(out, out_size, j);
+
+      if (value != expected) {
+         printf("Failure! %s, %u byte indices, pv %u -> %u, %u vertices: "
+                "index %u is %u instead of %u\n", u_prim_name(prim), in_size,
+                in_pv, out_pv, nr, j, value, expected);
+         success = false;
+         break;
+      }
+   }
+
+   FREE(in);
+   FREE(out);
+   return success;
+}
+
+#if defined(USE_SSE41)
+static bool
+test_restart(unsigned in_size, unsigned nr, unsigned restart_index)
+{
+   unsigned out_size = MAX2(in_size, 2);
+   unsigned out_restart = out_size == 4 ? 0xffffffff : 0xffff;
+   void *in = MALLOC(nr * in_size + 1);
+   void *out = MALLOC(nr * out_size + 1);
+   bool success = true;
+   unsigned i, pos;
+
+   fill_indices(in, in_size, nr);
+   /* Make the restart index reasonably frequent. */
+   for (i = 0; i < nr; i += 1 + rand() % 20)
+      set_index(in, in_size, i, restart_index);
+
+   switch (in_size) {
+   case 1:
+      u_index_restart_ubyte_ushort_sse41(in, nr, restart_index, out);
+      break;
+   case 2:
+      u_index_restart_ushort_sse41(in, nr, restart_index, out);
+      break;
+   default:
+      u_index_restart_uint_sse41(in, nr, restart_index, out);
+      break;
+   }
+
+   pos = 0;
+   for (i = 0; i < nr; i++) {
+      unsigned index = get_index(in, in_size, i);
+      unsigned expected = index == restart_index ? out_restart : index;
+      unsigned found;
+
+      if (get_index(out, out_size, i) != expected) {
+         printf("Failure! %u byte restart conversion of %u indices: "
+                "index %u is %u instead of %u\n", in_size, nr, i,
+                get_index(out, out_size, i), expected);
+         success = false;
+         break;
+      }
+
+      if (index != restart_index && i + 1 < nr)
+         continue;
+
+      switch (in_size) {
+      case 1:
+         found = u_index_find_restart_ubyte_sse41(in, pos, nr, restart_index);
+         break;
+      case 2:
+         found = u_index_find_restart_ushort_sse41(in, pos, nr, restart_index);
+         break;
+      default:
+         found = u_index_find_restart_uint_sse41(in, pos, nr, restart_index);
+         break;
+      }
+      if (found != (index == restart_index ? i : nr)) {
+         printf("Failure! %u byte restart search in %u indices from %u "
+                "found %u instead of %u\n", in_size, nr, pos, found,
+                index == restart_index ? i : nr);
+         success = false;
+         break;
+      }
+      pos = i + 1;
+   }
+
+   FREE(in);
+   FREE(out);
+   return success;
+}
+#endif
+
+static void
+benchmark_translate(enum pipe_prim_type prim, unsigned in_size)
+{
+   const unsigned nr = 1024 * 1024;
+   const unsigned iterations = 100;
+   enum pipe_prim_type out_prim;
+   unsigned out_size, out_nr, i;
+   u_translate_func translate;
+   int64_t start, time;
+   void *in = MALLOC(nr * in_size);
+   void *out = MALLOC(nr * 4 * 2);
+
+   fill_indices(in, in_size, nr);
+   u_index_translator(1 << PIPE_PRIM_TRIANGLES, prim, in_size, nr,
+                      PV_LAST, PV_LAST, PR_DISABLE,
+                      &out_prim, &out_size, &out_nr, &translate);
+
+   start = os_time_get_nano();
+   for (i = 0; i < iterations; i++)
+      translate(in, 0, nr, out_nr, 0, out);
+   time = os_time_get_nano() - start;
+
+   printf("%s, %u -> %u byte indices: %.3f ns/index\n",
+          u_prim_name(prim), in_size, out_size,
+          (double)time / iterations / out_nr);
+
+   FREE(in);
+   FREE(out);
+}
+
+int
+main(int argc, char **argv)
+{
+   static const enum pipe_prim_type prims[] = {
+      PIPE_PRIM_POINTS, PIPE_PRIM_TRIANGLES, PIPE_PRIM_QUADS,
+   };
+   unsigned p, in_size, in_pv, out_pv, n;
+   bool success = true;
+
+   util_cpu_detect();
+
+   for (p = 0; p < ARRAY_SIZE(prims); p++) {
+      for (in_size = 1; in_size <= 4; in_size *= 2) {
+         for (in_pv = 0; in_pv < PV_COUNT; in_pv++) {
+            for (out_pv = 0; out_pv < PV_COUNT; out_pv++) {
+               for (n = 0; n < 100; n++)
+                  success &= test_translate(prims[p], in_size,
+                                            in_pv, out_pv, n * 12);
+               success &= test_translate(prims[p], in_size,
+                                         in_pv, out_pv, 12000);
+            }
+         }
+      }
+   }
+
+#if defined(USE_SSE41)
+   if (util_cpu_caps.has_sse4_1) {
+      for (n = 0; n < 100; n++) {
+         success &= test_restart(1, n, 0xff);
+         success &= test_restart(1, n, 0xffff);
+         success &= test_restart(2, n, 0xffff);
+         success &= test_restart(2, n, 1234);
+         success &= test_restart(4, n, 0xffffffff);
+         success &= test_restart(4, n, 123456);
+      }
+   }
+#endif
+
+   if (!success)
+      return 1;
+
+   if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+      for (p = 0; p < ARRAY_SIZE(prims); p++) {
+         for (in_size = 1; in_size <= 4; in_size *= 2)
+            benchmark_translate(prims[p], in_size);
+      }
+   }
+
+   printf("Success!\n");
+   return 0;
+}
@@ -0,0 +1,272 @@
+#!/usr/bin/env python2
+##########################################################################
+#
+# Copyright 2019 VMware, Inc.
+# All Rights Reserved.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the
+# "Software"), to deal in the Software without restriction, including
+# without limitation the rights to use, copy, modify, merge, publish,
+# distribute, sub license, and/or sell copies of the Software, and to
+# permit persons to whom the Software is furnished to do so, subject to
+# the following conditions:
+#
+# The above copyright notice and this permission notice (including the
+# next paragraph) shall be included in all copies or substantial portions
+# of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+# OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+# MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+# IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+# ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+# TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+# SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+##########################################################################
+
+
+'''Binary trace reader.
+
+Binary traces (GALLIUM_TRACE_BINARY) are converted to the same XML that the
+trace driver writes otherwise, so that all tools can read them. The record
+format is described in src/gallium/auxiliary/driver_trace/tr_dump.c.
+'''
+
+
+import struct
+import sys
+
+
+MAGIC = b'GTRB'
+VERSION = 1
+
+(
+    STRING_DEF,
+    CALL,
+    CALL_END,
+    ARG,
+    RET,
+    NULL,
+    BOOL,
+    INT,
+    UINT,
+    FLOAT,
+    STRING,
+    ENUM,
+    BYTES,
+    BLOB_DEF,
+    BLOB,
+    ARRAY,
+    STRUCT,
+    MEMBER,
+    END,
+    PTR,
+) = range(1, 21)
+
+
+class TruncatedTrace(Exception):
+    pass
+
+
+def escape(data):
+    '''Escape bytes like trace_dump_escape.'''
+    out = []
+    for c in bytearray(data):
+        if c == ord('<'):
+            out.append('&lt;')
+        elif c == ord('>'):
+            out.append('&gt;')
+        elif c == ord('&'):
+            out.append('&amp;')
+        elif c == ord('\''):
+            out.append('&apos;')
+        elif c == ord('"'):
+            out.append('&quot;')
+        elif c >= 0x20 and c <= 0x7e:
+            out.append(chr(c))
+        else:
+            out.append('&#%u;' % c)
+    return ''.join(out)
+
+
+class BinaryTraceReader:
+    '''File-like object that returns a binary trace as XML.'''
+
+    def __init__(self, fp):
+        self.fp = fp
+        self.buf = bytearray()
+        self.pos = 0
+        self.strings = {}
+        self.blobs = {}
+        self.pending = ''
+        if self.read_bytes(len(MAGIC)) != bytearray(MAGIC):
+            raise ValueError('not a binary trace')
+        version = self.read_uint()
+        if version != VERSION:
+            raise ValueError('unsupported binary trace version %u' % version)
+        self.chunks = self.generate()
+
+    def read_bytes(self, size):
+        while len(self.buf) - self.pos < size:
+            data = self.fp.read(max(size, 64*1024))
+            if not data:
+                raise TruncatedTrace
+            self.buf = self.buf[self.pos:] + bytearray(data)
+            self.pos = 0
+        data = self.buf[self.pos:self.pos + size]
+        self.pos += size
+        return data
+
+    def read_uint(self):
+        value = 0
+        shift = 0
+        while True:
+            byte = self.read_bytes(1)[0]
+            value |= (byte & 0x7f) << shift
+            shift += 7
+            if not byte & 0x80:
+                return value
+
+    def read_int(self):
+        value = self.read_uint()
+        return (value >> 1) ^ -(value & 1)
+
+    def read_data(self):
+        return self.read_bytes(self.read_uint())
+
+    def read_op(self):
+        while True:
+            op = self.read_bytes(1)[0]
+            if op != STRING_DEF:
+                return op
+            id = self.read_uint()
+            self.strings[id] = escape(self.read_data())
+
+    def read_string_id(self):
+        return self.strings[self.read_uint()]
+
+    def read_value(self, op = None):
+        if op is None:
+            op = self.read_op()
+        if op == NULL:
+            return '<null/>'
+        if op == BOOL:
+            return '<bool>%u</bool>' % self.read_uint()
+        if op == INT:
+            return '<int>%i</int>' % self.read_int()
+        if op == UINT:
+            return '<uint>%u</uint>' % self.read_uint()
+        if op == FLOAT:
+            value, = struct.unpack('<d', bytes(self.read_bytes(8)))
+            return '<float>%g</float>' % value
+        if op == STRING:
+            return '<string>%s</string>' % escape(self.read_data())
+        if op == ENUM:
+            return '<enum>%s</enum>' % self.read_string_id()
+        if op == BYTES:
+            return self.bytes(self.read_data())
+        if op == BLOB_DEF:
+            id = self.read_uint()
+            self.blobs[id] = self.bytes(self.read_data())
+            return self.blobs[id]
+        if op == BLOB:
+            return self.blobs[self.read_uint()]
+        if op == ARRAY:
+            elems = []
+            op = self.read_op()
+            while op != END:
+                elems.append('<elem>%s</elem>' % self.read_value(op))
+                op = self.read_op()
+            return '<array>%s</array>' % ''.join(elems)
+        if op == STRUCT:
+            name = self.read_string_id()
+            members = []
+            op = self.read_op()
+            while op != END:
+                if op != MEMBER:
+                    raise ValueError('member expected, found record %u' % op)
+                member = self.read_string_id()
+                members.append("<member name='%s'>%s</member>" % (member, self.read_value()))
+                op = self.read_op()
+            return "<struct name='%s'>%s</struct>" % (name, ''.join(members))
+        if op == PTR:
+            return '<ptr>0x%08x</ptr>' % self.read_uint()
+        raise ValueError('value expected, found record %u' % op)
+
+    def bytes(self, data):
+        return '<bytes>%s</bytes>' % ''.join(['%02X' % c for c in data])
+
+    def read_call(self):
+        op = self.read_op()
+        if op != CALL:
+            raise ValueError('call expected, found record %u' % op)
+        no = self.read_uint()
+        klass = self.read_string_id()
+        method = self.read_string_id()
+        lines = ["\t<call no='%u' class='%s' method='%s'>\n" % (no, klass, method)]
+        while True:
+            op = self.read_op()
+            if op == ARG:
+                name = self.read_string_id()
+                lines.append("\t\t<arg name='%s'>%s</arg>\n" % (name, self.read_value()))
+            elif op == RET:
+                lines.append('\t\t<ret>%s</ret>\n' % self.read_value())
+            elif op == CALL_END:
+                lines.append('\t\t<time><int>%i</int></time>\n' % self.read_int())
+                lines.append('\t</call>\n')
+                return ''.join(lines)
+            else:
+                raise ValueError('argument expected, found record %u' % op)
+
+    def generate(self):
+        yield "<?xml version='1.0' encoding='UTF-8'?>\n"
+        yield "<?xml-stylesheet type='text/xsl' href='trace.xsl'?>\n"
+        yield "<trace version='0.1'>\n"
+        # Traces of applications that didn't exit cleanly end with a partial
+        # call, which is dropped.
+        try:
+            while True:
+                yield self.read_call()
+        except TruncatedTrace:
+            pass
+        yield '</trace>\n'
+
+    def read(self, size = -1):
+        while size < 0 or len(self.pending) < size:
+            try:
+                self.pending += next(self.chunks)
+            except StopIteration:
+                break
+        if size < 0:
+            size = len(self.pending)
+        data = self.pending[:size]
+        self.pending = self.pending[size:]
+        return data
+
+
+def open_trace(stream):
+    '''Return a stream with the XML of an XML or binary trace.'''
+    magic = stream.read(len(MAGIC))
+    stream.seek(0)
+    if bytearray(magic) == bytearray(MAGIC):
+        return BinaryTraceReader(stream)
+    return stream
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.stderr.write('usage: %s TRACE > TRACE.xml\n' % sys.argv[0])
+        sys.exit(1)
+
+    reader = BinaryTraceReader(open(sys.argv[1], 'rb'))
+    while True:
+        data = reader.read(64*1024)
+        if not data:
+            break
+        sys.stdout.write(data)
+
+
+if __name__ == '__main__':
+    main()
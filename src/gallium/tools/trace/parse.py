@@ -31,6 +31,7 @@ import sys
 import xml.parsers.expat
 import optparse
 
+import binary
 from model import *
 
 
@@ -383,7 +384,8 @@ class Main:
                 from bz2 import BZ2File
                 stream = BZ2File(arg, 'rU')
             else:
-                stream = open(arg, 'rt')
+                stream = open(arg, 'rb')
+            stream = binary.open_trace(stream)
             self.process_arg(stream, options)
 
     def get_optparser(self):
@@ -189,6 +189,7 @@ void amdgpu_bo_destroy(struct pb_buffer *_buf)
       amdgpu_bo_va_op(bo->bo, 0, bo->base.size, bo->va, 0, AMDGPU_VA_OP_UNMAP);
       amdgpu_va_range_free(bo->u.real.va_handle);
    }
+   p_atomic_inc(&ws->bo_destroy_counter);
    amdgpu_bo_free(bo->bo);
 
    amdgpu_bo_remove_fences(bo);
@@ -672,7 +673,7 @@ struct pb_slab *amdgpu_bo_slab_alloc(void *priv, unsigned heap,
       struct amdgpu_winsys_bo *bo = &slab->entries[i];
 
       simple_mtx_init(&bo->lock, mtx_plain);
-      bo->base.alignment = entry_size;
+      bo->base.alignment = entry_size & -entry_size;
       bo->base.usage = slab->buffer->base.usage;
       bo->base.size = entry_size;
       bo->base.vtbl = &amdgpu_winsys_bo_slab_vtbl;
@@ -1330,12 +1331,12 @@ amdgpu_bo_create(struct amdgpu_winsys *ws,
          goto no_slab;
 
       struct pb_slabs *slabs = get_slabs(ws, size);
-      entry = pb_slab_alloc(slabs, size, heap);
+      entry = pb_slab_alloc(slabs, size, alignment, heap);
       if (!entry) {
          /* Clean up buffer managers and try again. */
          amdgpu_clean_up_buffer_managers(ws);
 
-         entry = pb_slab_alloc(slabs, size, heap);
+         entry = pb_slab_alloc(slabs, size, alignment, heap);
       }
       if (!entry)
          return NULL;
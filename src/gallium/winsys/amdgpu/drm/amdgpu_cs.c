@@ -1354,6 +1354,50 @@ static bool amdgpu_add_sparse_backing_buffers(struct amdgpu_cs_context *cs)
    return true;
 }
 
+static void amdgpu_cs_release_last_bo_list(struct amdgpu_cs *acs)
+{
+   if (acs->last_bo_list_handle) {
+      amdgpu_bo_list_destroy_raw(acs->ctx->ws->dev, acs->last_bo_list_handle);
+      acs->last_bo_list_handle = 0;
+   }
+}
+
+/* Return whether the BO list is the same as in the last submission, and
+ * remember it for the next one if it isn't.
+ */
+static bool amdgpu_cs_update_last_bo_list(struct amdgpu_cs *acs,
+                                          struct drm_amdgpu_bo_list_entry *list,
+                                          unsigned num_handles)
+{
+   struct amdgpu_winsys *ws = acs->ctx->ws;
+   unsigned destroy_counter = p_atomic_read(&ws->bo_destroy_counter);
+
+   if (num_handles == acs->num_last_bo_list &&
+       destroy_counter == acs->last_bo_list_destroy_counter &&
+       !memcmp(list, acs->last_bo_list, num_handles * sizeof(*list)))
+      return true;
+
+   amdgpu_cs_release_last_bo_list(acs);
+
+   if (num_handles > acs->max_last_bo_list) {
+      struct drm_amdgpu_bo_list_entry *new_list =
+         REALLOC(acs->last_bo_list,
+                 acs->max_last_bo_list * sizeof(*list),
+                 num_handles * sizeof(*list));
+      if (!new_list) {
+         acs->num_last_bo_list = 0;
+         return false;
+      }
+      acs->last_bo_list = new_list;
+      acs->max_last_bo_list = num_handles;
+   }
+
+   memcpy(acs->last_bo_list, list, num_handles * sizeof(*list));
+   acs->num_last_bo_list = num_handles;
+   acs->last_bo_list_destroy_counter = destroy_counter;
+   return false;
+}
+
 void amdgpu_cs_submit_ib(void *job, int thread_index)
 {
    struct amdgpu_cs *acs = (struct amdgpu_cs*)job;
@@ -1361,6 +1405,7 @@ void amdgpu_cs_submit_ib(void *job, int thread_index)
    struct amdgpu_cs_context *cs = acs->cst;
    int i, r;
    uint32_t bo_list = 0;
+   bool bo_list_is_cached = false;
    uint64_t seq_no = 0;
    bool has_user_fence = amdgpu_cs_has_user_fence(cs);
    bool use_bo_list_create = ws->info.drm_minor < 27;
@@ -1416,7 +1461,31 @@ void amdgpu_cs_submit_ib(void *job, int thread_index)
          ++num_handles;
       }
 
-      if (use_bo_list_create) {
+      bool same_bo_list = amdgpu_cs_update_last_bo_list(acs, list, num_handles);
+
+      if (same_bo_list) {
+         /* Same buffers as in the last submission. The handle is created
+          * when the list is repeated for the first time.
+          */
+         if (!acs->last_bo_list_handle &&
+             amdgpu_bo_list_create_raw(ws->dev, num_handles, list,
+                                       &acs->last_bo_list_handle))
+            acs->last_bo_list_handle = 0;
+      } else if (use_bo_list_create) {
+         /* The legacy path needs a handle anyway, keep it for the next
+          * submission.
+          */
+         if (amdgpu_bo_list_create_raw(ws->dev, num_handles, list,
+                                       &acs->last_bo_list_handle))
+            acs->last_bo_list_handle = 0;
+      }
+
+      if (acs->last_bo_list_handle) {
+         bo_list = acs->last_bo_list_handle;
+         bo_list_is_cached = true;
+         if (same_bo_list)
+            ws->num_reused_bo_lists++;
+      } else if (use_bo_list_create) {
          /* Legacy path creating the buffer list handle and passing it to the CS ioctl. */
          r = amdgpu_bo_list_create_raw(ws->dev, num_handles, list, &bo_list);
          if (r) {
@@ -1443,7 +1512,7 @@ void amdgpu_cs_submit_ib(void *job, int thread_index)
       unsigned num_chunks = 0;
 
       /* BO list */
-      if (!use_bo_list_create) {
+      if (!bo_list) {
          chunks[num_chunks].chunk_id = AMDGPU_CHUNK_ID_BO_HANDLES;
          chunks[num_chunks].length_dw = sizeof(struct drm_amdgpu_bo_list_in) / 4;
          chunks[num_chunks].chunk_data = (uintptr_t)&bo_list_in;
@@ -1617,7 +1686,7 @@ finalize:
    }
 
    /* Cleanup. */
-   if (bo_list)
+   if (bo_list && !bo_list_is_cached)
       amdgpu_bo_list_destroy_raw(ws->dev, bo_list);
 
 cleanup:
@@ -1788,6 +1857,8 @@ static void amdgpu_cs_destroy(struct radeon_cmdbuf *rcs)
    struct amdgpu_cs *cs = amdgpu_cs(rcs);
 
    amdgpu_cs_sync_flush(rcs);
+   amdgpu_cs_release_last_bo_list(cs);
+   FREE(cs->last_bo_list);
    util_queue_fence_destroy(&cs->flush_completed);
    p_atomic_dec(&cs->ctx->ws->num_cs);
    pb_reference(&cs->main.big_ib_buffer, NULL);
@@ -148,6 +148,16 @@ struct amdgpu_cs {
 
    struct util_queue_fence flush_completed;
    struct pipe_fence_handle *next_fence;
+
+   /* The BO list of the last submission. Only used by the submit thread.
+    * If the next submission has the same buffers, the kernel BO list handle
+    * is reused, so that the kernel doesn't have to look up all buffers again.
+    */
+   struct drm_amdgpu_bo_list_entry *last_bo_list;
+   unsigned num_last_bo_list;
+   unsigned max_last_bo_list;
+   unsigned last_bo_list_destroy_counter; /* ws->bo_destroy_counter */
+   uint32_t last_bo_list_handle;
 };
 
 struct amdgpu_fence {
@@ -109,6 +109,7 @@ static bool do_winsys_init(struct amdgpu_winsys *ws,
    ws->check_vm = strstr(debug_get_option("R600_DEBUG", ""), "check_vm") != NULL ||
                   strstr(debug_get_option("AMD_DEBUG", ""), "check_vm") != NULL;
    ws->debug_all_bos = debug_get_option_all_bos();
+   ws->debug_slab_stats = strstr(debug_get_option("AMD_DEBUG", ""), "slabstats") != NULL;
    ws->reserve_vmid = strstr(debug_get_option("R600_DEBUG", ""), "reserve_vmid") != NULL ||
                       strstr(debug_get_option("AMD_DEBUG", ""), "reserve_vmid") != NULL;
    ws->zero_all_vram_allocs = strstr(debug_get_option("R600_DEBUG", ""), "zerovram") != NULL ||
@@ -123,6 +124,25 @@ fail:
    return false;
 }
 
+static void amdgpu_print_slab_stats(struct amdgpu_winsys *ws, unsigned index)
+{
+   struct pb_slabs *slabs = &ws->bo_slabs[index];
+   struct pb_slabs_stats stats;
+
+   pb_slabs_get_stats(slabs, &stats);
+   fprintf(stderr, "amdgpu: slab allocator %u (%u - %u bytes):\n", index,
+           1u << slabs->min_order,
+           1u << (slabs->min_order + slabs->num_orders - 1));
+   fprintf(stderr, "amdgpu:    allocations      : %"PRIu64"\n", stats.num_allocs);
+   fprintf(stderr, "amdgpu:    front cache hits : %"PRIu64"\n",
+           stats.num_front_cache_hits);
+   fprintf(stderr, "amdgpu:    contended locks  : %"PRIu64"\n",
+           stats.num_contended_locks);
+   fprintf(stderr, "amdgpu:    wasted bytes     : %"PRIu64" of %"PRIu64"\n",
+           stats.allocated_bytes - stats.requested_bytes,
+           stats.allocated_bytes);
+}
+
 static void do_winsys_deinit(struct amdgpu_winsys *ws)
 {
    if (ws->reserve_vmid)
@@ -133,8 +153,12 @@ static void do_winsys_deinit(struct amdgpu_winsys *ws)
 
    simple_mtx_destroy(&ws->bo_fence_lock);
    for (unsigned i = 0; i < NUM_SLAB_ALLOCATORS; i++) {
-      if (ws->bo_slabs[i].groups)
-         pb_slabs_deinit(&ws->bo_slabs[i]);
+      if (!ws->bo_slabs[i].groups)
+         continue;
+
+      if (ws->debug_slab_stats)
+         amdgpu_print_slab_stats(ws, i);
+      pb_slabs_deinit(&ws->bo_slabs[i]);
    }
    pb_cache_deinit(&ws->bo_cache);
    util_hash_table_destroy(ws->bo_export_table);
@@ -220,6 +244,8 @@ static uint64_t amdgpu_query_value(struct radeon_winsys *rws,
       return ws->num_sdma_IBs;
    case RADEON_GFX_BO_LIST_COUNTER:
       return ws->gfx_bo_list_counter;
+   case RADEON_NUM_REUSED_BO_LISTS:
+      return ws->num_reused_bo_lists;
    case RADEON_GFX_IB_SIZE_COUNTER:
       return ws->gfx_ib_size_counter;
    case RADEON_NUM_BYTES_MOVED:
@@ -356,6 +382,10 @@ amdgpu_winsys_create(int fd, const struct pipe_screen_config *config,
       unsigned max_slab_order = 18; /* 256 KB - higher numbers increase memory usage */
       unsigned num_slab_orders_per_allocator = (max_slab_order - min_slab_order) /
                                                NUM_SLAB_ALLOCATORS;
+      /* Split each power of two into 4 classes (1.25x, 1.5x, 1.75x, 2x)
+       * to reduce the memory wasted by rounding up.
+       */
+      unsigned num_slab_classes = 4;
 
       /* Divide the size order range among slab managers. */
       for (unsigned i = 0; i < NUM_SLAB_ALLOCATORS; i++) {
@@ -365,6 +395,7 @@ amdgpu_winsys_create(int fd, const struct pipe_screen_config *config,
 
          if (!pb_slabs_init(&aws->bo_slabs[i],
                             min_order, max_order,
+                            num_slab_classes,
                             RADEON_MAX_SLAB_HEAPS,
                             aws,
                             amdgpu_bo_can_reclaim_slab,
@@ -67,6 +67,7 @@ struct amdgpu_winsys {
    uint64_t num_sdma_IBs;
    uint64_t num_mapped_buffers;
    uint64_t gfx_bo_list_counter;
+   uint64_t num_reused_bo_lists;
    uint64_t gfx_ib_size_counter;
 
    struct radeon_info info;
@@ -79,6 +80,7 @@ struct amdgpu_winsys {
 
    bool check_vm;
    bool debug_all_bos;
+   bool debug_slab_stats;
    bool reserve_vmid;
    bool zero_all_vram_allocs;
 
@@ -87,6 +89,10 @@ struct amdgpu_winsys {
    struct list_head global_bo_list;
    unsigned num_buffers;
 
+   /* Incremented when a real buffer is freed, because its KMS handle can be
+    * reused by a new buffer. This invalidates cached BO lists. */
+   unsigned bo_destroy_counter;
+
    /* For returning the same amdgpu_winsys_bo instance for exported
     * and re-imported buffers. */
    struct util_hash_table *bo_export_table;
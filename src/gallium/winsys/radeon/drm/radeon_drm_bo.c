@@ -986,12 +986,12 @@ radeon_winsys_bo_create(struct radeon_winsys *rws,
         if (heap < 0 || heap >= RADEON_MAX_SLAB_HEAPS)
             goto no_slab;
 
-        entry = pb_slab_alloc(&ws->bo_slabs, size, heap);
+        entry = pb_slab_alloc(&ws->bo_slabs, size, alignment, heap);
         if (!entry) {
             /* Clear the cache and try again. */
             pb_cache_release_all_buffers(&ws->bo_cache);
 
-            entry = pb_slab_alloc(&ws->bo_slabs, size, heap);
+            entry = pb_slab_alloc(&ws->bo_slabs, size, alignment, heap);
         }
         if (!entry)
             return NULL;
@@ -709,6 +709,7 @@ static uint64_t radeon_query_value(struct radeon_winsys *rws,
     case RADEON_VRAM_VIS_USAGE:
     case RADEON_GFX_BO_LIST_COUNTER:
     case RADEON_GFX_IB_SIZE_COUNTER:
+    case RADEON_NUM_REUSED_BO_LISTS:
         return 0; /* unimplemented */
     case RADEON_VRAM_USAGE:
         radeon_get_drm_value(ws->fd, RADEON_INFO_VRAM_USAGE,
@@ -866,7 +867,7 @@ radeon_drm_winsys_create(int fd, const struct pipe_screen_config *config,
          */
         if (!pb_slabs_init(&ws->bo_slabs,
                            RADEON_SLAB_MIN_SIZE_LOG2, RADEON_SLAB_MAX_SIZE_LOG2,
-                           RADEON_MAX_SLAB_HEAPS,
+                           1, RADEON_MAX_SLAB_HEAPS,
                            ws,
                            radeon_bo_can_reclaim_slab,
                            radeon_bo_slab_alloc,
@@ -28,6 +28,7 @@
 #include "brw_eu.h"
 #include "brw_fs.h"
 #include "brw_cfg.h"
+#include "util/os_time.h"
 #include "util/register_allocate.h"
 
 using namespace brw;
@@ -1146,9 +1147,13 @@ fs_reg_alloc::spill_reg(unsigned spill_reg)
 bool
 fs_reg_alloc::assign_regs(bool allow_spilling, bool spill_all)
 {
+   const int64_t start_time = os_time_get_nano();
+
    build_interference_graph(fs->spilled_any_registers || spill_all);
 
    bool spilled = false;
+   unsigned spill_count = 0;
+   unsigned rounds = 0;
    while (1) {
       /* Debug of register spilling: Go spill everything. */
       if (unlikely(spill_all)) {
@@ -1165,6 +1170,8 @@ fs_reg_alloc::assign_regs(bool allow_spilling, bool spill_all)
       if (!allow_spilling)
          return false;
 
+      rounds++;
+
       /* Failed to allocate registers.  Spill a reg, and the caller will
        * loop back into here to try again.
        */
@@ -1182,12 +1189,38 @@ fs_reg_alloc::assign_regs(bool allow_spilling, bool spill_all)
 
       spilled = true;
 
-      spill_reg(reg);
+      /* Every failed ra_allocate() costs about as much as a successful one,
+       * so shaders that have already spilled a lot get several registers
+       * spilled per round, taking the next best candidates from the same
+       * graph.  This keeps the first few rounds as precise as before while
+       * bounding the number of rounds for heavily spilling shaders.
+       */
+      const unsigned round_spills = MAX2(1, spill_count / 8);
+      for (unsigned i = 0; i < round_spills; i++) {
+         if (i > 0) {
+            reg = choose_spill_reg();
+            if (reg == -1)
+               break;
+         }
+
+         spill_reg(reg);
+         if (fs->failed)
+            return false;
+         spill_count++;
+      }
    }
 
-   if (spilled)
+   if (spilled) {
       fs->invalidate_live_intervals();
 
+      fs->compiler->shader_perf_log(fs->log_data,
+                                    "%s SIMD%d register allocation spilled "
+                                    "%u registers in %u rounds (%.3f ms)\n",
+                                    fs->stage_abbrev, fs->dispatch_width,
+                                    spill_count, rounds,
+                                    (os_time_get_nano() - start_time) / 1e6);
+   }
+
    /* Get the chosen virtual registers for each node, and map virtual
     * regs in the register classes back down to real hardware reg
     * numbers.
@@ -75,6 +75,14 @@ public:
    int unblocked_time;
    int latency;
 
+   /**
+    * The node that most recently got this one as a child, and the index of
+    * that edge in its children array.  Used by add_dep() to find existing
+    * dependencies without walking the children.
+    */
+   schedule_node *dep_parent;
+   int dep_index;
+
    /**
     * Which iteration of pushing groups of children onto the candidates list
     * this node was a part of.
@@ -541,6 +549,8 @@ public:
       this->hw_reg_count = hw_reg_count;
       this->instructions.make_empty();
       this->instructions_to_schedule = 0;
+      this->pending_barriers = NULL;
+      this->pending_barrier_count = 0;
       this->post_reg_alloc = (mode == SCHEDULE_POST);
       this->mode = mode;
       if (!post_reg_alloc) {
@@ -582,6 +592,8 @@ public:
       ralloc_free(this->mem_ctx);
    }
    void add_barrier_deps(schedule_node *n);
+   void add_pending_barrier_deps(schedule_node *n);
+   void mark_children(schedule_node *n);
    void add_dep(schedule_node *before, schedule_node *after, int latency);
    void add_dep(schedule_node *before, schedule_node *after);
 
@@ -612,6 +624,14 @@ public:
 
    bool post_reg_alloc;
    int instructions_to_schedule;
+
+   /**
+    * Nodes that have to be scheduled before everything up to and including
+    * the next scheduling barrier, see add_barrier_deps().
+    */
+   schedule_node **pending_barriers;
+   int pending_barrier_count;
+
    int grf_count;
    unsigned hw_reg_count;
    int reg_pressure;
@@ -901,6 +921,8 @@ schedule_node::schedule_node(backend_instruction *inst,
    this->cand_generation = 0;
    this->delay = 0;
    this->exit = NULL;
+   this->dep_parent = NULL;
+   this->dep_index = -1;
 
    /* We can't measure Gen6 timings directly but expect them to be much
     * closer to Gen7 than Gen4.
@@ -923,6 +945,11 @@ instruction_scheduler::add_insts_from_block(bblock_t *block)
    }
 
    this->instructions_to_schedule = block->end_ip - block->start_ip + 1;
+
+   this->pending_barriers = reralloc(mem_ctx, this->pending_barriers,
+                                     schedule_node *,
+                                     this->instructions_to_schedule);
+   this->pending_barrier_count = 0;
 }
 
 /** Computation of the delay member of each node. */
@@ -986,11 +1013,24 @@ instruction_scheduler::add_dep(schedule_node *before, schedule_node *after,
 
    assert(before != after);
 
-   for (int i = 0; i < before->child_count; i++) {
-      if (before->children[i] == after) {
-         before->child_latency[i] = MAX2(before->child_latency[i], latency);
-         return;
-      }
+   /* calculate_deps() only adds edges to the node it is visiting in its
+    * top-to-bottom pass, and only edges from it in its bottom-to-top pass,
+    * which starts each node with mark_children().  So an existing edge is
+    * either the last one added to @before or the one recorded in @after,
+    * and we never have to walk the children.
+    */
+   int existing = -1;
+   if (before->child_count > 0 &&
+       before->children[before->child_count - 1] == after)
+      existing = before->child_count - 1;
+   else if (after->dep_parent == before)
+      existing = after->dep_index;
+
+   if (existing >= 0) {
+      assert(before->children[existing] == after);
+      before->child_latency[existing] =
+         MAX2(before->child_latency[existing], latency);
+      return;
    }
 
    if (before->child_array_size <= before->child_count) {
@@ -1006,12 +1046,28 @@ instruction_scheduler::add_dep(schedule_node *before, schedule_node *after,
                                        int, before->child_array_size);
    }
 
+   after->dep_parent = before;
+   after->dep_index = before->child_count;
+
    before->children[before->child_count] = after;
    before->child_latency[before->child_count] = latency;
    before->child_count++;
    after->parent_count++;
 }
 
+/**
+ * Records @n as the parent of all of its current children, so that add_dep()
+ * finds the existing edges when more are added from @n.
+ */
+void
+instruction_scheduler::mark_children(schedule_node *n)
+{
+   for (int i = 0; i < n->child_count; i++) {
+      n->children[i]->dep_parent = n;
+      n->children[i]->dep_index = i;
+   }
+}
+
 void
 instruction_scheduler::add_dep(schedule_node *before, schedule_node *after)
 {
@@ -1032,13 +1088,18 @@ is_scheduling_barrier(const backend_instruction *inst)
 /**
  * Sometimes we really want this node to execute after everything that
  * was before it and before everything that followed it.  This adds
- * the deps to do so.
+ * the deps on the preceding nodes, the following ones pick theirs up in
+ * add_pending_barrier_deps() as the top-to-bottom pass reaches them.
  */
 void
 instruction_scheduler::add_barrier_deps(schedule_node *n)
 {
+   /* Nodes can be barriers for more than one reason. */
+   if (pending_barrier_count > 0 &&
+       pending_barriers[pending_barrier_count - 1] == n)
+      return;
+
    schedule_node *prev = (schedule_node *)n->prev;
-   schedule_node *next = (schedule_node *)n->next;
 
    if (prev) {
       while (!prev->is_head_sentinel()) {
@@ -1049,14 +1110,23 @@ instruction_scheduler::add_barrier_deps(schedule_node *n)
       }
    }
 
-   if (next) {
-      while (!next->is_tail_sentinel()) {
-         add_dep(n, next, 0);
-         if (is_scheduling_barrier(next->inst))
-            break;
-         next = (schedule_node *)next->next;
-      }
-   }
+   assert(pending_barrier_count < instructions_to_schedule);
+   pending_barriers[pending_barrier_count++] = n;
+}
+
+/**
+ * Makes @n depend on the nodes passed to add_barrier_deps() since the last
+ * scheduling barrier.  Must be called on every node, in order, before any
+ * other dependency is added to it in the top-to-bottom pass.
+ */
+void
+instruction_scheduler::add_pending_barrier_deps(schedule_node *n)
+{
+   for (int i = 0; i < pending_barrier_count; i++)
+      add_dep(pending_barriers[i], n, 0);
+
+   if (is_scheduling_barrier(n->inst))
+      pending_barrier_count = 0;
 }
 
 /* instruction scheduling needs to be aware of when an MRF write
@@ -1093,6 +1163,8 @@ fs_instruction_scheduler::calculate_deps()
    foreach_in_list(schedule_node, n, &instructions) {
       fs_inst *inst = (fs_inst *)n->inst;
 
+      add_pending_barrier_deps(n);
+
       if (is_scheduling_barrier(inst))
          add_barrier_deps(n);
 
@@ -1222,6 +1294,8 @@ fs_instruction_scheduler::calculate_deps()
    foreach_in_list_reverse_safe(schedule_node, n, &instructions) {
       fs_inst *inst = (fs_inst *)n->inst;
 
+      mark_children(n);
+
       /* write-after-read deps. */
       for (int i = 0; i < inst->sources; i++) {
          if (inst->src[i].file == VGRF) {
@@ -1243,8 +1317,6 @@ fs_instruction_scheduler::calculate_deps()
             }
          } else if (inst->src[i].is_accumulator()) {
             add_dep(n, last_accumulator_write, 0);
-         } else if (inst->src[i].file == ARF) {
-            add_barrier_deps(n);
          }
       }
 
@@ -1306,8 +1378,6 @@ fs_instruction_scheduler::calculate_deps()
          }
       } else if (inst->dst.is_accumulator()) {
          last_accumulator_write = n;
-      } else if (inst->dst.file == ARF && !inst->dst.is_null()) {
-         add_barrier_deps(n);
       }
 
       if (inst->mlen > 0 && inst->base_mrf != -1) {
@@ -1354,6 +1424,8 @@ vec4_instruction_scheduler::calculate_deps()
    foreach_in_list(schedule_node, n, &instructions) {
       vec4_instruction *inst = (vec4_instruction *)n->inst;
 
+      add_pending_barrier_deps(n);
+
       if (is_scheduling_barrier(inst))
          add_barrier_deps(n);
 
@@ -1442,6 +1514,8 @@ vec4_instruction_scheduler::calculate_deps()
    foreach_in_list_reverse_safe(schedule_node, n, &instructions) {
       vec4_instruction *inst = (vec4_instruction *)n->inst;
 
+      mark_children(n);
+
       /* write-after-read deps. */
       for (int i = 0; i < 3; i++) {
          if (inst->src[i].file == VGRF) {
@@ -1451,8 +1525,6 @@ vec4_instruction_scheduler::calculate_deps()
             add_dep(n, last_fixed_grf_write);
          } else if (inst->src[i].is_accumulator()) {
             add_dep(n, last_accumulator_write);
-         } else if (inst->src[i].file == ARF) {
-            add_barrier_deps(n);
          }
       }
 
@@ -1486,8 +1558,6 @@ vec4_instruction_scheduler::calculate_deps()
          last_fixed_grf_write = n;
       } else if (inst->dst.is_accumulator()) {
          last_accumulator_write = n;
-      } else if (inst->dst.file == ARF && !inst->dst.is_null()) {
-         add_barrier_deps(n);
       }
 
       if (inst->mlen > 0 && !inst->is_send_from_grf()) {
@@ -45,7 +45,7 @@ isl_memcpy_linear_to_tiled(uint32_t xt1, uint32_t xt2,
                            isl_memcpy_type copy_type)
 {
 #ifdef USE_SSE41
-   if (copy_type == ISL_MEMCPY_STREAMING_LOAD) {
+   if (copy_type == ISL_MEMCPY_STREAMING_STORE) {
       _isl_memcpy_linear_to_tiled_sse41(
          xt1, xt2, yt1, yt2, dst, src, dst_pitch, src_pitch, has_swizzling,
          tiling, copy_type);
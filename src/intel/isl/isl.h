@@ -953,6 +953,7 @@ typedef enum {
   ISL_MEMCPY = 0,
   ISL_MEMCPY_BGRA8,
   ISL_MEMCPY_STREAMING_LOAD,
+  ISL_MEMCPY_STREAMING_STORE,
   ISL_MEMCPY_INVALID,
 } isl_memcpy_type;
 
@@ -592,6 +592,34 @@ _memcpy_streaming_load(void *dest, const void *src, size_t count)
       return memcpy(dest, src, count);
    }
 }
+
+/* Non-temporal stores bypass the cache, which avoids read-for-ownership
+ * traffic on write-combined mappings and leaves the CPU caches alone on big
+ * uploads.  They need a 16-byte aligned destination, which is guaranteed
+ * for whole spans on the tiled side.
+ */
+static ALWAYS_INLINE void *
+_memcpy_streaming_store(void *dest, const void *src, size_t count)
+{
+   if (count == 16) {
+      __m128i val = _mm_loadu_si128((const __m128i *)src);
+      _mm_stream_si128((__m128i *)dest, val);
+      return dest;
+   } else if (count == 64) {
+      __m128i val0 = _mm_loadu_si128(((const __m128i *)src) + 0);
+      __m128i val1 = _mm_loadu_si128(((const __m128i *)src) + 1);
+      __m128i val2 = _mm_loadu_si128(((const __m128i *)src) + 2);
+      __m128i val3 = _mm_loadu_si128(((const __m128i *)src) + 3);
+      _mm_stream_si128(((__m128i *)dest) + 0, val0);
+      _mm_stream_si128(((__m128i *)dest) + 1, val1);
+      _mm_stream_si128(((__m128i *)dest) + 2, val2);
+      _mm_stream_si128(((__m128i *)dest) + 3, val3);
+      return dest;
+   } else {
+      assert(count < 64); /* and (count < 16) for ytiled */
+      return memcpy(dest, src, count);
+   }
+}
 #endif
 
 static isl_mem_copy_fn
@@ -607,6 +635,13 @@ choose_copy_function(isl_memcpy_type copy_type)
       return _memcpy_streaming_load;
 #else
       unreachable("ISL_MEMCOPY_STREAMING_LOAD requires sse4.1");
+#endif
+   case ISL_MEMCPY_STREAMING_STORE:
+#if defined(INLINE_SSE41)
+      return _memcpy_streaming_store;
+#else
+      /* Streaming stores are only a hint, plain stores are fine too. */
+      return memcpy;
 #endif
    case ISL_MEMCPY_INVALID:
       unreachable("invalid copy_type");
@@ -642,6 +677,12 @@ linear_to_xtiled_faster(uint32_t x0, uint32_t x1, uint32_t x2, uint32_t x3,
          return linear_to_xtiled(0, 0, xtile_width, xtile_width, 0, xtile_height,
                                  dst, src, src_pitch, swizzle_bit,
                                  rgba8_copy, rgba8_copy_aligned_dst);
+#if defined(INLINE_SSE41)
+      else if (mem_copy == _memcpy_streaming_store)
+         return linear_to_xtiled(0, 0, xtile_width, xtile_width, 0, xtile_height,
+                                 dst, src, src_pitch, swizzle_bit,
+                                 memcpy, _memcpy_streaming_store);
+#endif
       else
          unreachable("not reached");
    } else {
@@ -653,6 +694,12 @@ linear_to_xtiled_faster(uint32_t x0, uint32_t x1, uint32_t x2, uint32_t x3,
          return linear_to_xtiled(x0, x1, x2, x3, y0, y1,
                                  dst, src, src_pitch, swizzle_bit,
                                  rgba8_copy, rgba8_copy_aligned_dst);
+#if defined(INLINE_SSE41)
+      else if (mem_copy == _memcpy_streaming_store)
+         return linear_to_xtiled(x0, x1, x2, x3, y0, y1,
+                                 dst, src, src_pitch, swizzle_bit,
+                                 memcpy, _memcpy_streaming_store);
+#endif
       else
          unreachable("not reached");
    }
@@ -687,6 +734,12 @@ linear_to_ytiled_faster(uint32_t x0, uint32_t x1, uint32_t x2, uint32_t x3,
          return linear_to_ytiled(0, 0, ytile_width, ytile_width, 0, ytile_height,
                                  dst, src, src_pitch, swizzle_bit,
                                  rgba8_copy, rgba8_copy_aligned_dst);
+#if defined(INLINE_SSE41)
+      else if (mem_copy == _memcpy_streaming_store)
+         return linear_to_ytiled(0, 0, ytile_width, ytile_width, 0, ytile_height,
+                                 dst, src, src_pitch, swizzle_bit,
+                                 memcpy, _memcpy_streaming_store);
+#endif
       else
          unreachable("not reached");
    } else {
@@ -697,6 +750,12 @@ linear_to_ytiled_faster(uint32_t x0, uint32_t x1, uint32_t x2, uint32_t x3,
          return linear_to_ytiled(x0, x1, x2, x3, y0, y1,
                                  dst, src, src_pitch, swizzle_bit,
                                  rgba8_copy, rgba8_copy_aligned_dst);
+#if defined(INLINE_SSE41)
+      else if (mem_copy == _memcpy_streaming_store)
+         return linear_to_ytiled(x0, x1, x2, x3, y0, y1,
+                                 dst, src, src_pitch, swizzle_bit,
+                                 memcpy, _memcpy_streaming_store);
+#endif
       else
          unreachable("not reached");
    }
@@ -905,6 +964,14 @@ intel_linear_to_tiled(uint32_t xt1, uint32_t xt2,
                    copy_type);
       }
    }
+
+#if defined(INLINE_SSE41)
+   /* Non-temporal stores are weakly ordered, make them visible before the
+    * caller hands the buffer to the GPU.
+    */
+   if (copy_type == ISL_MEMCPY_STREAMING_STORE)
+      _mm_sfence();
+#endif
 }
 
 /**
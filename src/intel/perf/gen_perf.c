@@ -26,6 +26,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
 #include <errno.h>
 
@@ -39,7 +40,9 @@
 #include "dev/gen_debug.h"
 #include "dev/gen_device_info.h"
 #include "util/bitscan.h"
+#include "util/u_atomic.h"
 #include "util/u_math.h"
+#include "util/u_thread.h"
 
 #define FILE_DEBUG_FLAG DEBUG_PERFMON
 #define MI_RPC_BO_SIZE              4096
@@ -2476,3 +2479,249 @@ gen_perf_dump_query(struct gen_perf_context *ctx,
       break;
    }
 }
+
+/**
+ * A system-wide i915 perf stream sampling the OA unit periodically, for
+ * profiling without wrapping work in queries.
+ *
+ * The reports are read and accumulated on a thread of their own.  The
+ * kernel's OA buffer is the ring holding reports until we get to them;
+ * if we fall behind it tells us with REPORT_LOST/BUFFER_LOST records.
+ */
+struct gen_perf_stream {
+   struct gen_perf_config *perf;
+   const struct gen_device_info *devinfo;
+   const struct gen_perf_query_info *query;
+   int fd;
+
+   gen_perf_stream_callback callback;
+   void *callback_data;
+
+   thrd_t thread;
+   bool stop;
+
+   /** Protects result and reports_lost. */
+   mtx_t lock;
+   struct gen_perf_query_result result;
+   uint32_t reports_lost;
+
+   /** The previous report, used as the start of the next delta. */
+   uint32_t last_report[(I915_PERF_OA_SAMPLE_SIZE - 8) / 4];
+   bool have_last_report;
+};
+
+static int
+gen_perf_stream_thread(void *data)
+{
+   struct gen_perf_stream *stream = data;
+   struct pollfd pollfd = { .fd = stream->fd, .events = POLLIN };
+   uint8_t buf[I915_PERF_OA_SAMPLE_SIZE * 32];
+
+   u_thread_setname("gen_perf_stream");
+
+   while (!p_atomic_read(&stream->stop)) {
+      /* Wake up regularly to notice gen_perf_stream_close(). */
+      if (poll(&pollfd, 1, 100) <= 0)
+         continue;
+
+      int len;
+      while ((len = read(stream->fd, buf, sizeof(buf))) < 0 && errno == EINTR)
+         ;
+
+      if (len < 0 && errno == EAGAIN)
+         continue;
+
+      if (len <= 0) {
+         DBG("Error reading i915 perf stream: %m\n");
+         break;
+      }
+
+      struct gen_perf_query_result delta;
+      uint32_t lost = 0;
+      int offset = 0;
+
+      query_result_clear(&delta);
+
+      while (offset < len) {
+         const struct drm_i915_perf_record_header *header =
+            (const struct drm_i915_perf_record_header *)(buf + offset);
+
+         assert(header->size != 0);
+         offset += header->size;
+
+         switch (header->type) {
+         case DRM_I915_PERF_RECORD_SAMPLE: {
+            const uint32_t *report = (const uint32_t *)(header + 1);
+
+            if (stream->have_last_report) {
+               query_result_accumulate(&delta, stream->query,
+                                       stream->last_report, report);
+               query_result_read_frequencies(&delta, stream->devinfo,
+                                             stream->last_report, report);
+            }
+            memcpy(stream->last_report, report, sizeof(stream->last_report));
+            stream->have_last_report = true;
+            break;
+         }
+
+         case DRM_I915_PERF_RECORD_OA_BUFFER_LOST:
+            /* The deltas across the gap are meaningless; start over. */
+            DBG("i915 perf: OA error: all reports lost\n");
+            stream->have_last_report = false;
+            lost++;
+            break;
+         case DRM_I915_PERF_RECORD_OA_REPORT_LOST:
+            DBG("i915 perf: OA report lost\n");
+            lost++;
+            break;
+         }
+      }
+
+      if (delta.reports_accumulated == 0 && lost == 0)
+         continue;
+
+      mtx_lock(&stream->lock);
+      for (int i = 0; i < MAX_OA_REPORT_COUNTERS; i++)
+         stream->result.accumulator[i] += delta.accumulator[i];
+      stream->result.reports_accumulated += delta.reports_accumulated;
+      if (delta.reports_accumulated) {
+         stream->result.hw_id = delta.hw_id;
+         memcpy(stream->result.slice_frequency, delta.slice_frequency,
+                sizeof(delta.slice_frequency));
+         memcpy(stream->result.unslice_frequency, delta.unslice_frequency,
+                sizeof(delta.unslice_frequency));
+      }
+      stream->reports_lost += lost;
+      mtx_unlock(&stream->lock);
+
+      if (stream->callback && delta.reports_accumulated)
+         stream->callback(stream->callback_data, stream->query, &delta);
+   }
+
+   return 0;
+}
+
+/**
+ * Find the largest OA exponent whose sampling period doesn't exceed
+ * period_ns (sample_period = timestamp_period * 2^(exponent + 1)).
+ */
+static int
+stream_period_exponent(const struct gen_device_info *devinfo,
+                       uint64_t period_ns)
+{
+   int exponent = 0;
+
+   for (int e = 1; e < 32; e++) {
+      uint64_t period =
+         1000000000ull * (2ull << e) / devinfo->timestamp_frequency;
+
+      if (period > period_ns)
+         break;
+      exponent = e;
+   }
+
+   return exponent;
+}
+
+struct gen_perf_stream *
+gen_perf_stream_open(struct gen_perf_config *perf_cfg,
+                     const struct gen_device_info *devinfo,
+                     int drm_fd,
+                     const struct gen_perf_query_info *query,
+                     uint64_t period_ns,
+                     gen_perf_stream_callback callback,
+                     void *callback_data)
+{
+   if (query->kind != GEN_PERF_QUERY_TYPE_OA &&
+       query->kind != GEN_PERF_QUERY_TYPE_RAW)
+      return NULL;
+
+   uint64_t metric_id = get_metric_id(perf_cfg, query);
+   if (metric_id == 0)
+      return NULL;
+
+   int period_exponent = stream_period_exponent(devinfo, period_ns);
+
+   uint64_t properties[] = {
+      /* Include OA reports in samples */
+      DRM_I915_PERF_PROP_SAMPLE_OA, true,
+
+      /* OA unit configuration */
+      DRM_I915_PERF_PROP_OA_METRICS_SET, metric_id,
+      DRM_I915_PERF_PROP_OA_FORMAT, query->oa_format,
+      DRM_I915_PERF_PROP_OA_EXPONENT, period_exponent,
+   };
+   struct drm_i915_perf_open_param param = {
+      .flags = I915_PERF_FLAG_FD_CLOEXEC |
+               I915_PERF_FLAG_FD_NONBLOCK,
+      .num_properties = ARRAY_SIZE(properties) / 2,
+      .properties_ptr = (uintptr_t) properties,
+   };
+
+   struct gen_perf_stream *stream = calloc(1, sizeof(*stream));
+   if (!stream)
+      return NULL;
+
+   stream->perf = perf_cfg;
+   stream->devinfo = devinfo;
+   stream->query = query;
+   stream->callback = callback;
+   stream->callback_data = callback_data;
+   query_result_clear(&stream->result);
+
+   /* Sampling all contexts needs CAP_SYS_ADMIN, or the
+    * dev.i915.perf_stream_paranoid sysctl set to 0.
+    */
+   stream->fd = gen_ioctl(drm_fd, DRM_IOCTL_I915_PERF_OPEN, &param);
+   if (stream->fd == -1) {
+      DBG("Error opening gen perf OA stream: %m\n");
+      free(stream);
+      return NULL;
+   }
+
+   DBG("OA stream '%s', exponent %i\n", query->name, period_exponent);
+
+   if (mtx_init(&stream->lock, mtx_plain) != thrd_success)
+      goto fail_fd;
+
+   if (thrd_create(&stream->thread, gen_perf_stream_thread,
+                   stream) != thrd_success)
+      goto fail_lock;
+
+   return stream;
+
+fail_lock:
+   mtx_destroy(&stream->lock);
+fail_fd:
+   close(stream->fd);
+   free(stream);
+   return NULL;
+}
+
+void
+gen_perf_stream_read(struct gen_perf_stream *stream,
+                     struct gen_perf_query_result *result,
+                     uint32_t *reports_lost,
+                     bool reset)
+{
+   mtx_lock(&stream->lock);
+   *result = stream->result;
+   if (reports_lost)
+      *reports_lost = stream->reports_lost;
+   if (reset) {
+      query_result_clear(&stream->result);
+      stream->reports_lost = 0;
+   }
+   mtx_unlock(&stream->lock);
+}
+
+void
+gen_perf_stream_close(struct gen_perf_stream *stream)
+{
+   p_atomic_set(&stream->stop, true);
+   thrd_join(stream->thread, NULL);
+
+   close(stream->fd);
+   mtx_destroy(&stream->lock);
+   free(stream);
+}
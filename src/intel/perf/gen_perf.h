@@ -327,4 +327,32 @@ void gen_perf_dump_query(struct gen_perf_context *perf_ctx,
                          struct gen_perf_query_object *obj,
                          void *current_batch);
 
+/*
+ * Continuous sampling of an OA metric set across all contexts.
+ *
+ * The callback runs on the stream's thread with the counters accumulated
+ * from each batch of reports read; gen_perf_stream_read() returns the
+ * running totals.  Counter values are decoded from result->accumulator
+ * with the query's oa_counter_read_* functions.
+ */
+struct gen_perf_stream;
+
+typedef void (*gen_perf_stream_callback)(void *data,
+                                         const struct gen_perf_query_info *query,
+                                         const struct gen_perf_query_result *result);
+
+struct gen_perf_stream *
+gen_perf_stream_open(struct gen_perf_config *perf_cfg,
+                     const struct gen_device_info *devinfo,
+                     int drm_fd,
+                     const struct gen_perf_query_info *query,
+                     uint64_t period_ns,
+                     gen_perf_stream_callback callback,
+                     void *callback_data);
+void gen_perf_stream_read(struct gen_perf_stream *stream,
+                          struct gen_perf_query_result *result,
+                          uint32_t *reports_lost,
+                          bool reset);
+void gen_perf_stream_close(struct gen_perf_stream *stream);
+
 #endif /* GEN_PERF_H */
@@ -929,6 +929,7 @@ anv_state_pool_init(struct anv_state_pool *pool,
       pool->buckets[i].block.next = 0;
       pool->buckets[i].block.end = 0;
    }
+   memset(&pool->stats, 0, sizeof(pool->stats));
    VG(VALGRIND_CREATE_MEMPOOL(pool, 0, false));
 
    return VK_SUCCESS;
@@ -947,7 +948,8 @@ anv_fixed_size_state_pool_alloc_new(struct anv_fixed_size_state_pool *pool,
                                     struct anv_block_pool *block_pool,
                                     uint32_t state_size,
                                     uint32_t block_size,
-                                    uint32_t *padding)
+                                    uint32_t *padding,
+                                    uint32_t *waits)
 {
    struct anv_block_state block, old, new;
    uint32_t offset;
@@ -979,6 +981,8 @@ anv_fixed_size_state_pool_alloc_new(struct anv_fixed_size_state_pool *pool,
          futex_wake(&pool->block.end, INT_MAX);
       return offset;
    } else {
+      if (unlikely(INTEL_DEBUG & DEBUG_STATE_POOL))
+         p_atomic_inc(waits);
       futex_wait(&pool->block.end, block.end, NULL);
       goto restart;
    }
@@ -1158,7 +1162,8 @@ anv_state_pool_alloc_no_vg(struct anv_state_pool *pool,
                                                 &pool->block_pool,
                                                 alloc_size,
                                                 pool->block_size,
-                                                &padding);
+                                                &padding,
+                                                &pool->stats.block_waits);
    /* Everytime we allocate a new state, add it to the state pool */
    uint32_t idx;
    UNUSED VkResult result = anv_state_table_add(&pool->table, &idx, 1);
@@ -1244,6 +1249,123 @@ anv_state_pool_free(struct anv_state_pool *pool, struct anv_state state)
    anv_state_pool_free_no_vg(pool, state);
 }
 
+void
+anv_state_pool_print_stats(struct anv_state_pool *pool, const char *name)
+{
+   fprintf(stderr, "%s state pool: %u block waits, %u cache hits, "
+           "%u cache refills, %u cache spills\n", name,
+           pool->stats.block_waits, pool->stats.cache_hits,
+           pool->stats.cache_refills, pool->stats.cache_spills);
+}
+
+/* Block caches sit between state streams and the state pool.  Streams of
+ * many command buffers being recorded on different threads all hammer the
+ * same free lists with compare-and-swaps, but the command buffers of a
+ * given command pool can't be recorded concurrently.  A cache owned by the
+ * command pool can therefore hand blocks out and take them back without any
+ * atomics, and only goes to the state pool to refill or spill in bulk.
+ */
+void
+anv_state_block_cache_init(struct anv_state_block_cache *cache,
+                           struct anv_state_pool *state_pool,
+                           uint32_t block_size)
+{
+   assert(util_is_power_of_two_nonzero(block_size));
+   cache->state_pool = state_pool;
+   cache->block_size = block_size;
+   cache->count = 0;
+}
+
+/* Returns every cached block to the state pool.  The cache remains usable. */
+void
+anv_state_block_cache_trim(struct anv_state_block_cache *cache)
+{
+   while (cache->count > 0) {
+      anv_state_pool_free_no_vg(cache->state_pool,
+                                cache->blocks[--cache->count]);
+   }
+}
+
+/* Refills the cache from a single allocation of several blocks, which is
+ * then split into block sized states just like
+ * anv_state_pool_return_blocks() does.
+ */
+static void
+anv_state_block_cache_refill(struct anv_state_block_cache *cache)
+{
+   struct anv_state_pool *pool = cache->state_pool;
+   uint32_t block_size = cache->block_size;
+   uint32_t count = MIN2(ANV_STATE_BLOCK_CACHE_REFILL,
+                         (1u << ANV_MAX_STATE_SIZE_LOG2) / block_size);
+
+   assert(cache->count == 0);
+   assert(util_is_power_of_two_nonzero(count));
+
+   struct anv_state chunk =
+      anv_state_pool_alloc_no_vg(pool, block_size * count, block_size);
+
+   /* The blocks are popped from the end, so store them from the top down to
+    * hand out the lowest addresses first.
+    */
+   struct anv_state *first = anv_state_table_get(&pool->table, chunk.idx);
+   first->alloc_size = block_size;
+   cache->blocks[count - 1] = *first;
+   cache->count = count;
+
+   if (count == 1)
+      return;
+
+   uint32_t st_idx;
+   UNUSED VkResult result =
+      anv_state_table_add(&pool->table, &st_idx, count - 1);
+   assert(result == VK_SUCCESS);
+   for (uint32_t i = 1; i < count; i++) {
+      struct anv_state *state_i = anv_state_table_get(&pool->table,
+                                                      st_idx + i - 1);
+      state_i->alloc_size = block_size;
+      state_i->offset = chunk.offset + block_size * i;
+      state_i->map = anv_block_pool_map(&pool->block_pool, state_i->offset);
+      cache->blocks[count - 1 - i] = *state_i;
+   }
+}
+
+static struct anv_state
+anv_state_block_cache_alloc(struct anv_state_block_cache *cache)
+{
+   if (cache->count == 0) {
+      anv_state_block_cache_refill(cache);
+      if (unlikely(INTEL_DEBUG & DEBUG_STATE_POOL))
+         p_atomic_inc(&cache->state_pool->stats.cache_refills);
+   } else {
+      if (unlikely(INTEL_DEBUG & DEBUG_STATE_POOL))
+         p_atomic_inc(&cache->state_pool->stats.cache_hits);
+   }
+
+   return cache->blocks[--cache->count];
+}
+
+static void
+anv_state_block_cache_free(struct anv_state_block_cache *cache,
+                           struct anv_state state)
+{
+   assert(state.alloc_size == cache->block_size);
+
+   /* Spill down to half full so that a command buffer freeing and then
+    * allocating again right at the limit doesn't bounce blocks through the
+    * state pool.
+    */
+   if (cache->count == ANV_STATE_BLOCK_CACHE_SIZE) {
+      while (cache->count > ANV_STATE_BLOCK_CACHE_SIZE / 2) {
+         anv_state_pool_free_no_vg(cache->state_pool,
+                                   cache->blocks[--cache->count]);
+      }
+      if (unlikely(INTEL_DEBUG & DEBUG_STATE_POOL))
+         p_atomic_inc(&cache->state_pool->stats.cache_spills);
+   }
+
+   cache->blocks[cache->count++] = state;
+}
+
 struct anv_state_stream_block {
    struct anv_state block;
 
@@ -1267,6 +1389,7 @@ anv_state_stream_init(struct anv_state_stream *stream,
                       uint32_t block_size)
 {
    stream->state_pool = state_pool;
+   stream->block_cache = NULL;
    stream->block_size = block_size;
 
    stream->block = ANV_STATE_NULL;
@@ -1281,6 +1404,17 @@ anv_state_stream_init(struct anv_state_stream *stream,
    VG(VALGRIND_CREATE_MEMPOOL(stream, 0, false));
 }
 
+/* Same as anv_state_stream_init() but regular sized blocks go through the
+ * given cache, which must outlive the stream.
+ */
+void
+anv_state_stream_init_cached(struct anv_state_stream *stream,
+                             struct anv_state_block_cache *cache)
+{
+   anv_state_stream_init(stream, cache->state_pool, cache->block_size);
+   stream->block_cache = cache;
+}
+
 void
 anv_state_stream_finish(struct anv_state_stream *stream)
 {
@@ -1289,7 +1423,11 @@ anv_state_stream_finish(struct anv_state_stream *stream)
       struct anv_state_stream_block sb = VG_NOACCESS_READ(next);
       VG(VALGRIND_MEMPOOL_FREE(stream, sb._vg_ptr));
       VG(VALGRIND_MAKE_MEM_UNDEFINED(next, stream->block_size));
-      anv_state_pool_free_no_vg(stream->state_pool, sb.block);
+      if (stream->block_cache &&
+          sb.block.alloc_size == stream->block_cache->block_size)
+         anv_state_block_cache_free(stream->block_cache, sb.block);
+      else
+         anv_state_pool_free_no_vg(stream->state_pool, sb.block);
       next = sb.next;
    }
 
@@ -1311,8 +1449,13 @@ anv_state_stream_alloc(struct anv_state_stream *stream,
       if (block_size < size)
          block_size = round_to_power_of_two(size);
 
-      stream->block = anv_state_pool_alloc_no_vg(stream->state_pool,
-                                                 block_size, PAGE_SIZE);
+      if (stream->block_cache &&
+          block_size == stream->block_cache->block_size) {
+         stream->block = anv_state_block_cache_alloc(stream->block_cache);
+      } else {
+         stream->block = anv_state_pool_alloc_no_vg(stream->state_pool,
+                                                    block_size, PAGE_SIZE);
+      }
 
       struct anv_state_stream_block *sb = stream->block.map;
       VG_NOACCESS_WRITE(&sb->block, stream->block);
@@ -46,48 +46,47 @@
  * Functions related to anv_reloc_list
  *-----------------------------------------------------------------------*/
 
+/* The relocation arrays are only allocated once the first relocation is
+ * added.  With softpin every BO is pinned and only ends up in the deps set,
+ * so batch BOs and command buffers never pay for them.
+ */
 static VkResult
 anv_reloc_list_init_clone(struct anv_reloc_list *list,
                           const VkAllocationCallbacks *alloc,
                           const struct anv_reloc_list *other_list)
 {
-   if (other_list) {
-      list->num_relocs = other_list->num_relocs;
-      list->array_length = other_list->array_length;
-   } else {
-      list->num_relocs = 0;
-      list->array_length = 256;
-   }
-
-   list->relocs =
-      vk_alloc(alloc, list->array_length * sizeof(*list->relocs), 8,
-                VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
-
-   if (list->relocs == NULL)
-      return vk_error(VK_ERROR_OUT_OF_HOST_MEMORY);
+   list->num_relocs = 0;
+   list->array_length = 0;
+   list->relocs = NULL;
+   list->reloc_bos = NULL;
 
-   list->reloc_bos =
-      vk_alloc(alloc, list->array_length * sizeof(*list->reloc_bos), 8,
-                VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
-
-   if (list->reloc_bos == NULL) {
-      vk_free(alloc, list->relocs);
+   list->deps = _mesa_pointer_set_create(NULL);
+   if (!list->deps)
       return vk_error(VK_ERROR_OUT_OF_HOST_MEMORY);
-   }
 
-   list->deps = _mesa_pointer_set_create(NULL);
+   if (other_list && other_list->num_relocs > 0) {
+      list->relocs =
+         vk_alloc(alloc, other_list->array_length * sizeof(*list->relocs), 8,
+                  VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+      list->reloc_bos =
+         vk_alloc(alloc, other_list->array_length * sizeof(*list->reloc_bos),
+                  8, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+      if (list->relocs == NULL || list->reloc_bos == NULL) {
+         vk_free(alloc, list->relocs);
+         vk_free(alloc, list->reloc_bos);
+         _mesa_set_destroy(list->deps, NULL);
+         return vk_error(VK_ERROR_OUT_OF_HOST_MEMORY);
+      }
 
-   if (!list->deps) {
-      vk_free(alloc, list->relocs);
-      vk_free(alloc, list->reloc_bos);
-      return vk_error(VK_ERROR_OUT_OF_HOST_MEMORY);
+      list->num_relocs = other_list->num_relocs;
+      list->array_length = other_list->array_length;
+      memcpy(list->relocs, other_list->relocs,
+             list->num_relocs * sizeof(*list->relocs));
+      memcpy(list->reloc_bos, other_list->reloc_bos,
+             list->num_relocs * sizeof(*list->reloc_bos));
    }
 
    if (other_list) {
-      memcpy(list->relocs, other_list->relocs,
-             list->array_length * sizeof(*list->relocs));
-      memcpy(list->reloc_bos, other_list->reloc_bos,
-             list->array_length * sizeof(*list->reloc_bos));
       set_foreach(other_list->deps, entry) {
          _mesa_set_add_pre_hashed(list->deps, entry->hash, entry->key);
       }
@@ -120,7 +119,7 @@ anv_reloc_list_grow(struct anv_reloc_list *list,
    if (list->num_relocs + num_additional_relocs <= list->array_length)
       return VK_SUCCESS;
 
-   size_t new_length = list->array_length * 2;
+   size_t new_length = MAX2(list->array_length * 2, 256);
    while (new_length < list->num_relocs + num_additional_relocs)
       new_length *= 2;
 
@@ -138,9 +137,12 @@ anv_reloc_list_grow(struct anv_reloc_list *list,
       return vk_error(VK_ERROR_OUT_OF_HOST_MEMORY);
    }
 
-   memcpy(new_relocs, list->relocs, list->num_relocs * sizeof(*list->relocs));
-   memcpy(new_reloc_bos, list->reloc_bos,
-          list->num_relocs * sizeof(*list->reloc_bos));
+   if (list->num_relocs > 0) {
+      memcpy(new_relocs, list->relocs,
+             list->num_relocs * sizeof(*list->relocs));
+      memcpy(new_reloc_bos, list->reloc_bos,
+             list->num_relocs * sizeof(*list->reloc_bos));
+   }
 
    vk_free(alloc, list->relocs);
    vk_free(alloc, list->reloc_bos);
@@ -189,19 +191,21 @@ anv_reloc_list_append(struct anv_reloc_list *list,
                       const VkAllocationCallbacks *alloc,
                       struct anv_reloc_list *other, uint32_t offset)
 {
-   VkResult result = anv_reloc_list_grow(list, alloc, other->num_relocs);
-   if (result != VK_SUCCESS)
-      return result;
+   if (other->num_relocs > 0) {
+      VkResult result = anv_reloc_list_grow(list, alloc, other->num_relocs);
+      if (result != VK_SUCCESS)
+         return result;
 
-   memcpy(&list->relocs[list->num_relocs], &other->relocs[0],
-          other->num_relocs * sizeof(other->relocs[0]));
-   memcpy(&list->reloc_bos[list->num_relocs], &other->reloc_bos[0],
-          other->num_relocs * sizeof(other->reloc_bos[0]));
+      memcpy(&list->relocs[list->num_relocs], &other->relocs[0],
+             other->num_relocs * sizeof(other->relocs[0]));
+      memcpy(&list->reloc_bos[list->num_relocs], &other->reloc_bos[0],
+             other->num_relocs * sizeof(other->reloc_bos[0]));
 
-   for (uint32_t i = 0; i < other->num_relocs; i++)
-      list->relocs[i + list->num_relocs].offset += offset;
+      for (uint32_t i = 0; i < other->num_relocs; i++)
+         list->relocs[i + list->num_relocs].offset += offset;
 
-   list->num_relocs += other->num_relocs;
+      list->num_relocs += other->num_relocs;
+   }
 
    set_foreach(other->deps, entry) {
       _mesa_set_add_pre_hashed(list->deps, entry->hash, entry->key);
@@ -1377,12 +1381,12 @@ setup_execbuf_for_cmd_buffer(struct anv_execbuf *execbuf,
    struct anv_batch *batch = &cmd_buffer->batch;
    struct anv_state_pool *ss_pool =
       &cmd_buffer->device->surface_state_pool;
+   const bool use_softpin =
+      cmd_buffer->device->instance->physicalDevice.use_softpin;
 
-   adjust_relocations_from_state_pool(ss_pool, &cmd_buffer->surface_relocs,
-                                      cmd_buffer->last_ss_pool_center);
    VkResult result;
    struct anv_bo *bo;
-   if (cmd_buffer->device->instance->physicalDevice.use_softpin) {
+   if (use_softpin) {
       anv_block_pool_foreach_bo(bo, &ss_pool->block_pool) {
          result = anv_execbuf_add_bo(execbuf, bo, NULL, 0,
                                      &cmd_buffer->device->alloc);
@@ -1427,6 +1431,9 @@ setup_execbuf_for_cmd_buffer(struct anv_execbuf *execbuf,
             return result;
       }
    } else {
+      adjust_relocations_from_state_pool(ss_pool, &cmd_buffer->surface_relocs,
+                                         cmd_buffer->last_ss_pool_center);
+
       /* Since we aren't in the softpin case, all of our STATE_BASE_ADDRESS BOs
        * will get added automatically by processing relocations on the batch
        * buffer.  We have to add the surface state BO manually because it has
@@ -1444,8 +1451,11 @@ setup_execbuf_for_cmd_buffer(struct anv_execbuf *execbuf,
     */
    struct anv_batch_bo **bbo;
    u_vector_foreach(bbo, &cmd_buffer->seen_bbos) {
-      adjust_relocations_to_state_pool(ss_pool, &(*bbo)->bo, &(*bbo)->relocs,
-                                       cmd_buffer->last_ss_pool_center);
+      if (!use_softpin) {
+         adjust_relocations_to_state_pool(ss_pool, &(*bbo)->bo,
+                                          &(*bbo)->relocs,
+                                          cmd_buffer->last_ss_pool_center);
+      }
 
       result = anv_execbuf_add_bo(execbuf, &(*bbo)->bo, &(*bbo)->relocs, 0,
                                   &cmd_buffer->device->alloc);
@@ -1484,7 +1494,7 @@ setup_execbuf_for_cmd_buffer(struct anv_execbuf *execbuf,
    }
 
    /* If we are pinning our BOs, we shouldn't have to relocate anything */
-   if (cmd_buffer->device->instance->physicalDevice.use_softpin)
+   if (use_softpin)
       assert(!execbuf->has_relocs);
 
    /* Now we go through and fixup all of the relocation lists to point to
@@ -1520,6 +1530,14 @@ setup_execbuf_for_cmd_buffer(struct anv_execbuf *execbuf,
       .rsvd2 = 0,
    };
 
+   /* With softpin every address written into the batch is final, so there
+    * is no relocation list at all and the kernel never has to look at one.
+    */
+   if (use_softpin) {
+      execbuf->execbuf.flags |= I915_EXEC_NO_RELOC;
+      return VK_SUCCESS;
+   }
+
    if (relocate_cmd_buffer(cmd_buffer, execbuf)) {
       /* If we were able to successfully relocate everything, tell the kernel
        * that it can skip doing relocations. The requirement for using
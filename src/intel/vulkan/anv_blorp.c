@@ -34,8 +34,13 @@ lookup_blorp_shader(struct blorp_batch *batch,
    /* The default cache must be a real cache */
    assert(device->default_pipeline_cache.cache);
 
+   /* This also looks in the disk cache, so blorp shaders compiled by
+    * earlier runs don't have to be compiled again.
+    */
+   bool user_cache_hit;
    struct anv_shader_bin *bin =
-      anv_pipeline_cache_search(&device->default_pipeline_cache, key, key_size);
+      anv_device_search_for_kernel(device, &device->default_pipeline_cache,
+                                   key, key_size, &user_cache_hit);
    if (!bin)
       return false;
 
@@ -70,11 +75,11 @@ upload_blorp_shader(struct blorp_batch *batch,
    };
 
    struct anv_shader_bin *bin =
-      anv_pipeline_cache_upload_kernel(&device->default_pipeline_cache,
-                                       key, key_size, kernel, kernel_size,
-                                       NULL, 0,
-                                       prog_data, prog_data_size,
-                                       NULL, 0, NULL, &bind_map);
+      anv_device_upload_kernel(device, &device->default_pipeline_cache,
+                               key, key_size, kernel, kernel_size,
+                               NULL, 0,
+                               prog_data, prog_data_size,
+                               NULL, 0, NULL, &bind_map);
 
    if (!bin)
       return false;
@@ -189,6 +189,25 @@ anv_cmd_state_reset(struct anv_cmd_buffer *cmd_buffer)
    anv_cmd_state_init(cmd_buffer);
 }
 
+static void
+anv_cmd_buffer_init_state_streams(struct anv_cmd_buffer *cmd_buffer)
+{
+   struct anv_cmd_pool *pool = cmd_buffer->pool;
+   struct anv_device *device = cmd_buffer->device;
+
+   if (pool) {
+      anv_state_stream_init_cached(&cmd_buffer->surface_state_stream,
+                                   &pool->surface_state_blocks);
+      anv_state_stream_init_cached(&cmd_buffer->dynamic_state_stream,
+                                   &pool->dynamic_state_blocks);
+   } else {
+      anv_state_stream_init(&cmd_buffer->surface_state_stream,
+                            &device->surface_state_pool, 4096);
+      anv_state_stream_init(&cmd_buffer->dynamic_state_stream,
+                            &device->dynamic_state_pool, 16384);
+   }
+}
+
 static VkResult anv_create_cmd_buffer(
     struct anv_device *                         device,
     struct anv_cmd_pool *                       pool,
@@ -214,10 +233,7 @@ static VkResult anv_create_cmd_buffer(
    if (result != VK_SUCCESS)
       goto fail;
 
-   anv_state_stream_init(&cmd_buffer->surface_state_stream,
-                         &device->surface_state_pool, 4096);
-   anv_state_stream_init(&cmd_buffer->dynamic_state_stream,
-                         &device->dynamic_state_pool, 16384);
+   anv_cmd_buffer_init_state_streams(cmd_buffer);
 
    anv_cmd_state_init(cmd_buffer);
 
@@ -307,12 +323,8 @@ anv_cmd_buffer_reset(struct anv_cmd_buffer *cmd_buffer)
    anv_cmd_state_reset(cmd_buffer);
 
    anv_state_stream_finish(&cmd_buffer->surface_state_stream);
-   anv_state_stream_init(&cmd_buffer->surface_state_stream,
-                         &cmd_buffer->device->surface_state_pool, 4096);
-
    anv_state_stream_finish(&cmd_buffer->dynamic_state_stream);
-   anv_state_stream_init(&cmd_buffer->dynamic_state_stream,
-                         &cmd_buffer->device->dynamic_state_pool, 16384);
+   anv_cmd_buffer_init_state_streams(cmd_buffer);
    return VK_SUCCESS;
 }
 
@@ -912,6 +924,11 @@ VkResult anv_CreateCommandPool(
 
    list_inithead(&pool->cmd_buffers);
 
+   anv_state_block_cache_init(&pool->surface_state_blocks,
+                              &device->surface_state_pool, 4096);
+   anv_state_block_cache_init(&pool->dynamic_state_blocks,
+                              &device->dynamic_state_pool, 16384);
+
    *pCmdPool = anv_cmd_pool_to_handle(pool);
 
    return VK_SUCCESS;
@@ -933,6 +950,9 @@ void anv_DestroyCommandPool(
       anv_cmd_buffer_destroy(cmd_buffer);
    }
 
+   anv_state_block_cache_trim(&pool->surface_state_blocks);
+   anv_state_block_cache_trim(&pool->dynamic_state_blocks);
+
    vk_free2(&device->alloc, pAllocator, pool);
 }
 
@@ -956,7 +976,10 @@ void anv_TrimCommandPool(
     VkCommandPool                               commandPool,
     VkCommandPoolTrimFlags                      flags)
 {
-   /* Nothing for us to do here.  Our pools stay pretty tidy. */
+   ANV_FROM_HANDLE(anv_cmd_pool, pool, commandPool);
+
+   anv_state_block_cache_trim(&pool->surface_state_blocks);
+   anv_state_block_cache_trim(&pool->dynamic_state_blocks);
 }
 
 /**
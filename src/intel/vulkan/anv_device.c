@@ -2559,6 +2559,16 @@ VkResult anv_CreateDevice(
 
    anv_pipeline_cache_init(&device->default_pipeline_cache, device, true);
 
+   /* Shader dumps from the different stages would get interleaved. */
+   memset(&device->compile_queue, 0, sizeof(device->compile_queue));
+   long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+   if (num_cpus > 1 &&
+       !(INTEL_DEBUG & (DEBUG_VS | DEBUG_TCS | DEBUG_TES |
+                        DEBUG_GS | DEBUG_WM))) {
+      util_queue_init(&device->compile_queue, "anv_compile", 32,
+                      MIN2(num_cpus, 8), UTIL_QUEUE_INIT_RESIZE_IF_FULL);
+   }
+
    anv_device_init_blorp(device);
 
    anv_device_init_border_colors(device);
@@ -2612,6 +2622,9 @@ void anv_DestroyDevice(
 
    anv_device_finish_blorp(device);
 
+   if (util_queue_is_initialized(&device->compile_queue))
+      util_queue_destroy(&device->compile_queue);
+
    anv_pipeline_cache_finish(&device->default_pipeline_cache);
 
    anv_queue_finish(&device->queue);
@@ -2635,6 +2648,13 @@ void anv_DestroyDevice(
    if (device->info.gen >= 10)
       anv_gem_close(device, device->hiz_clear_bo.gem_handle);
 
+   if (unlikely(INTEL_DEBUG & DEBUG_STATE_POOL)) {
+      anv_state_pool_print_stats(&device->dynamic_state_pool, "dynamic");
+      anv_state_pool_print_stats(&device->instruction_state_pool,
+                                 "instruction");
+      anv_state_pool_print_stats(&device->surface_state_pool, "surface");
+   }
+
    if (physical_device->use_softpin)
       anv_state_pool_finish(&device->binding_table_pool);
    anv_state_pool_finish(&device->surface_state_pool);
@@ -752,11 +752,6 @@ anv_pipeline_compile_vs(const struct brw_compiler *compiler,
                         struct anv_device *device,
                         struct anv_pipeline_stage *vs_stage)
 {
-   brw_compute_vue_map(compiler->devinfo,
-                       &vs_stage->prog_data.vs.base.vue_map,
-                       vs_stage->nir->info.outputs_written,
-                       vs_stage->nir->info.separate_shader);
-
    vs_stage->num_stats = 1;
    vs_stage->code = brw_compile_vs(compiler, device, mem_ctx,
                                    &vs_stage->key.vs,
@@ -836,14 +831,8 @@ static void
 anv_pipeline_compile_tcs(const struct brw_compiler *compiler,
                          void *mem_ctx,
                          struct anv_device *device,
-                         struct anv_pipeline_stage *tcs_stage,
-                         struct anv_pipeline_stage *prev_stage)
+                         struct anv_pipeline_stage *tcs_stage)
 {
-   tcs_stage->key.tcs.outputs_written =
-      tcs_stage->nir->info.outputs_written;
-   tcs_stage->key.tcs.patch_outputs_written =
-      tcs_stage->nir->info.patch_outputs_written;
-
    tcs_stage->num_stats = 1;
    tcs_stage->code = brw_compile_tcs(compiler, device, mem_ctx,
                                      &tcs_stage->key.tcs,
@@ -866,17 +855,12 @@ anv_pipeline_compile_tes(const struct brw_compiler *compiler,
                          void *mem_ctx,
                          struct anv_device *device,
                          struct anv_pipeline_stage *tes_stage,
-                         struct anv_pipeline_stage *tcs_stage)
+                         const struct brw_vue_map *tcs_vue_map)
 {
-   tes_stage->key.tes.inputs_read =
-      tcs_stage->nir->info.outputs_written;
-   tes_stage->key.tes.patch_inputs_read =
-      tcs_stage->nir->info.patch_outputs_written;
-
    tes_stage->num_stats = 1;
    tes_stage->code = brw_compile_tes(compiler, device, mem_ctx,
                                      &tes_stage->key.tes,
-                                     &tcs_stage->prog_data.tcs.base.vue_map,
+                                     tcs_vue_map,
                                      &tes_stage->prog_data.tes,
                                      tes_stage->nir, -1,
                                      tes_stage->stats, NULL);
@@ -895,14 +879,8 @@ static void
 anv_pipeline_compile_gs(const struct brw_compiler *compiler,
                         void *mem_ctx,
                         struct anv_device *device,
-                        struct anv_pipeline_stage *gs_stage,
-                        struct anv_pipeline_stage *prev_stage)
+                        struct anv_pipeline_stage *gs_stage)
 {
-   brw_compute_vue_map(compiler->devinfo,
-                       &gs_stage->prog_data.gs.base.vue_map,
-                       gs_stage->nir->info.outputs_written,
-                       gs_stage->nir->info.separate_shader);
-
    gs_stage->num_stats = 1;
    gs_stage->code = brw_compile_gs(compiler, device, mem_ctx,
                                    &gs_stage->key.gs,
@@ -1030,16 +1008,8 @@ static void
 anv_pipeline_compile_fs(const struct brw_compiler *compiler,
                         void *mem_ctx,
                         struct anv_device *device,
-                        struct anv_pipeline_stage *fs_stage,
-                        struct anv_pipeline_stage *prev_stage)
+                        struct anv_pipeline_stage *fs_stage)
 {
-   /* TODO: we could set this to 0 based on the information in nir_shader, but
-    * we need this before we call spirv_to_nir.
-    */
-   assert(prev_stage);
-   fs_stage->key.wm.input_slots_valid =
-      prev_stage->prog_data.vue.vue_map.slots_valid;
-
    fs_stage->code = brw_compile_fs(compiler, device, mem_ctx,
                                    &fs_stage->key.wm,
                                    &fs_stage->prog_data.wm,
@@ -1065,6 +1035,114 @@ anv_pipeline_compile_fs(const struct brw_compiler *compiler,
    }
 }
 
+struct anv_pipeline_compile_job {
+   const struct brw_compiler *compiler;
+   struct anv_device *device;
+   struct anv_pipeline_stage *stage;
+
+   void *mem_ctx;
+   nir_xfb_info *xfb_info;
+
+   /* The TES gets its own copy of the TCS output VUE map so that it doesn't
+    * have to wait for the TCS to be compiled.
+    */
+   struct brw_vue_map tcs_vue_map;
+
+   struct util_queue_fence fence;
+};
+
+/* Sets up the parts of a stage's key and prog_data that come from the other
+ * stages, so that the backend compiles themselves are independent.
+ */
+static void
+anv_pipeline_prepare_stage(const struct brw_compiler *compiler,
+                           struct anv_pipeline_compile_job *job,
+                           struct anv_pipeline_stage *prev_stage)
+{
+   struct anv_pipeline_stage *stage = job->stage;
+
+   switch (stage->stage) {
+   case MESA_SHADER_VERTEX:
+      brw_compute_vue_map(compiler->devinfo,
+                          &stage->prog_data.vs.base.vue_map,
+                          stage->nir->info.outputs_written,
+                          stage->nir->info.separate_shader);
+      break;
+   case MESA_SHADER_TESS_CTRL:
+      stage->key.tcs.outputs_written =
+         stage->nir->info.outputs_written;
+      stage->key.tcs.patch_outputs_written =
+         stage->nir->info.patch_outputs_written;
+      break;
+   case MESA_SHADER_TESS_EVAL:
+      assert(prev_stage && prev_stage->stage == MESA_SHADER_TESS_CTRL);
+      stage->key.tes.inputs_read = prev_stage->key.tcs.outputs_written;
+      stage->key.tes.patch_inputs_read =
+         prev_stage->key.tcs.patch_outputs_written;
+      brw_compute_tess_vue_map(&job->tcs_vue_map,
+                               prev_stage->key.tcs.outputs_written,
+                               prev_stage->key.tcs.patch_outputs_written);
+      break;
+   case MESA_SHADER_GEOMETRY:
+      brw_compute_vue_map(compiler->devinfo,
+                          &stage->prog_data.gs.base.vue_map,
+                          stage->nir->info.outputs_written,
+                          stage->nir->info.separate_shader);
+      break;
+   case MESA_SHADER_FRAGMENT:
+      /* TODO: we could set this to 0 based on the information in nir_shader,
+       * but we need this before we call spirv_to_nir.
+       *
+       * The TES only computes its output VUE map while being compiled, so
+       * in that case the caller fills this in once the TES is done.
+       */
+      assert(prev_stage);
+      if (prev_stage->stage != MESA_SHADER_TESS_EVAL) {
+         stage->key.wm.input_slots_valid =
+            prev_stage->prog_data.vue.vue_map.slots_valid;
+      }
+      break;
+   default:
+      unreachable("Invalid graphics shader stage");
+   }
+}
+
+static void
+anv_pipeline_compile_job_execute(void *data, int thread_index)
+{
+   struct anv_pipeline_compile_job *job = data;
+   struct anv_pipeline_stage *stage = job->stage;
+
+   int64_t stage_start = os_time_get_nano();
+
+   switch (stage->stage) {
+   case MESA_SHADER_VERTEX:
+      anv_pipeline_compile_vs(job->compiler, job->mem_ctx, job->device,
+                              stage);
+      break;
+   case MESA_SHADER_TESS_CTRL:
+      anv_pipeline_compile_tcs(job->compiler, job->mem_ctx, job->device,
+                               stage);
+      break;
+   case MESA_SHADER_TESS_EVAL:
+      anv_pipeline_compile_tes(job->compiler, job->mem_ctx, job->device,
+                               stage, &job->tcs_vue_map);
+      break;
+   case MESA_SHADER_GEOMETRY:
+      anv_pipeline_compile_gs(job->compiler, job->mem_ctx, job->device,
+                              stage);
+      break;
+   case MESA_SHADER_FRAGMENT:
+      anv_pipeline_compile_fs(job->compiler, job->mem_ctx, job->device,
+                              stage);
+      break;
+   default:
+      unreachable("Invalid graphics shader stage");
+   }
+
+   stage->feedback.duration += os_time_get_nano() - stage_start;
+}
+
 static void
 anv_pipeline_add_executable(struct anv_pipeline *pipeline,
                             struct anv_pipeline_stage *stage,
@@ -1294,6 +1372,7 @@ anv_pipeline_compile_graphics(struct anv_pipeline *pipeline,
       }
    }
 
+   struct anv_pipeline_compile_job jobs[MESA_SHADER_STAGES] = {};
    void *pipeline_ctx = ralloc_context(NULL);
 
    for (unsigned s = 0; s < MESA_SHADER_STAGES; s++) {
@@ -1357,42 +1436,73 @@ anv_pipeline_compile_graphics(struct anv_pipeline *pipeline,
 
       int64_t stage_start = os_time_get_nano();
 
-      void *stage_ctx = ralloc_context(NULL);
+      jobs[s].compiler = compiler;
+      jobs[s].device = pipeline->device;
+      jobs[s].stage = &stages[s];
+      jobs[s].mem_ctx = ralloc_context(NULL);
 
-      nir_xfb_info *xfb_info = NULL;
       if (s == MESA_SHADER_VERTEX ||
           s == MESA_SHADER_TESS_EVAL ||
           s == MESA_SHADER_GEOMETRY)
-         xfb_info = nir_gather_xfb_info(stages[s].nir, stage_ctx);
+         jobs[s].xfb_info = nir_gather_xfb_info(stages[s].nir,
+                                                jobs[s].mem_ctx);
 
-      anv_pipeline_lower_nir(pipeline, stage_ctx, &stages[s], layout);
+      anv_pipeline_lower_nir(pipeline, jobs[s].mem_ctx, &stages[s], layout);
 
-      switch (s) {
-      case MESA_SHADER_VERTEX:
-         anv_pipeline_compile_vs(compiler, stage_ctx, pipeline->device,
-                                 &stages[s]);
-         break;
-      case MESA_SHADER_TESS_CTRL:
-         anv_pipeline_compile_tcs(compiler, stage_ctx, pipeline->device,
-                                  &stages[s], prev_stage);
-         break;
-      case MESA_SHADER_TESS_EVAL:
-         anv_pipeline_compile_tes(compiler, stage_ctx, pipeline->device,
-                                  &stages[s], prev_stage);
-         break;
-      case MESA_SHADER_GEOMETRY:
-         anv_pipeline_compile_gs(compiler, stage_ctx, pipeline->device,
-                                 &stages[s], prev_stage);
-         break;
-      case MESA_SHADER_FRAGMENT:
-         anv_pipeline_compile_fs(compiler, stage_ctx, pipeline->device,
-                                 &stages[s], prev_stage);
-         break;
-      default:
-         unreachable("Invalid graphics shader stage");
+      anv_pipeline_prepare_stage(compiler, &jobs[s], prev_stage);
+
+      stages[s].feedback.duration += os_time_get_nano() - stage_start;
+
+      prev_stage = &stages[s];
+   }
+
+   /* The stages are now independent of each other.  Compile the fragment
+    * shader, which is usually the most expensive one, on this thread and the
+    * others on the device's compile queue if there is one.
+    */
+   struct util_queue *queue = &pipeline->device->compile_queue;
+   const bool use_queue = util_queue_is_initialized(queue);
+   for (unsigned s = 0; s < MESA_SHADER_FRAGMENT; s++) {
+      if (!stages[s].entrypoint)
+         continue;
+
+      if (use_queue) {
+         util_queue_fence_init(&jobs[s].fence);
+         util_queue_add_job(queue, &jobs[s], &jobs[s].fence,
+                            anv_pipeline_compile_job_execute, NULL);
+      } else {
+         anv_pipeline_compile_job_execute(&jobs[s], 0);
+      }
+   }
+
+   if (stages[MESA_SHADER_FRAGMENT].entrypoint) {
+      if (stages[MESA_SHADER_TESS_EVAL].entrypoint &&
+          !stages[MESA_SHADER_GEOMETRY].entrypoint) {
+         if (use_queue)
+            util_queue_fence_wait(&jobs[MESA_SHADER_TESS_EVAL].fence);
+         stages[MESA_SHADER_FRAGMENT].key.wm.input_slots_valid =
+            stages[MESA_SHADER_TESS_EVAL].prog_data.vue.vue_map.slots_valid;
       }
+      anv_pipeline_compile_job_execute(&jobs[MESA_SHADER_FRAGMENT], 0);
+   }
+
+   if (use_queue) {
+      for (unsigned s = 0; s < MESA_SHADER_FRAGMENT; s++) {
+         if (!stages[s].entrypoint)
+            continue;
+
+         util_queue_fence_wait(&jobs[s].fence);
+         util_queue_fence_destroy(&jobs[s].fence);
+      }
+   }
+
+   for (unsigned s = 0; s < MESA_SHADER_STAGES; s++) {
+      if (!stages[s].entrypoint)
+         continue;
+
+      int64_t stage_start = os_time_get_nano();
+
       if (stages[s].code == NULL) {
-         ralloc_free(stage_ctx);
          result = vk_error(VK_ERROR_OUT_OF_HOST_MEMORY);
          goto fail;
       }
@@ -1408,9 +1518,8 @@ anv_pipeline_compile_graphics(struct anv_pipeline *pipeline,
                                   &stages[s].prog_data.base,
                                   brw_prog_data_size(s),
                                   stages[s].stats, stages[s].num_stats,
-                                  xfb_info, &stages[s].bind_map);
+                                  jobs[s].xfb_info, &stages[s].bind_map);
       if (!bin) {
-         ralloc_free(stage_ctx);
          result = vk_error(VK_ERROR_OUT_OF_HOST_MEMORY);
          goto fail;
       }
@@ -1418,11 +1527,10 @@ anv_pipeline_compile_graphics(struct anv_pipeline *pipeline,
       anv_pipeline_add_executables(pipeline, &stages[s], bin);
 
       pipeline->shaders[s] = bin;
-      ralloc_free(stage_ctx);
+      ralloc_free(jobs[s].mem_ctx);
+      jobs[s].mem_ctx = NULL;
 
       stages[s].feedback.duration += os_time_get_nano() - stage_start;
-
-      prev_stage = &stages[s];
    }
 
    ralloc_free(pipeline_ctx);
@@ -1460,6 +1568,7 @@ fail:
    ralloc_free(pipeline_ctx);
 
    for (unsigned s = 0; s < MESA_SHADER_STAGES; s++) {
+      ralloc_free(jobs[s].mem_ctx);
       if (pipeline->shaders[s])
          anv_shader_bin_unref(pipeline->device, pipeline->shaders[s]);
    }
@@ -56,6 +56,7 @@
 #include "util/u_atomic.h"
 #include "util/u_vector.h"
 #include "util/u_math.h"
+#include "util/u_queue.h"
 #include "util/vma.h"
 #include "util/xmlconfig.h"
 #include "vk_alloc.h"
@@ -760,6 +761,29 @@ struct anv_state_pool {
    union anv_free_list back_alloc_free_list;
 
    struct anv_fixed_size_state_pool buckets[ANV_STATE_BUCKETS];
+
+   /* Contention counters, only maintained with INTEL_DEBUG=statepool */
+   struct {
+      uint32_t block_waits;
+      uint32_t cache_hits;
+      uint32_t cache_refills;
+      uint32_t cache_spills;
+   } stats;
+};
+
+#define ANV_STATE_BLOCK_CACHE_SIZE 16
+#define ANV_STATE_BLOCK_CACHE_REFILL 8
+
+/* A small stash of state pool blocks of a single size.  It does no locking
+ * at all, so it has to be owned by something externally synchronized, like
+ * a command pool.
+ */
+struct anv_state_block_cache {
+   struct anv_state_pool *state_pool;
+   uint32_t block_size;
+
+   uint32_t count;
+   struct anv_state blocks[ANV_STATE_BLOCK_CACHE_SIZE];
 };
 
 struct anv_state_stream_block;
@@ -767,6 +791,9 @@ struct anv_state_stream_block;
 struct anv_state_stream {
    struct anv_state_pool *state_pool;
 
+   /* Optional cache to take blocks of block_size from */
+   struct anv_state_block_cache *block_cache;
+
    /* The size of blocks to allocate from the state pool */
    uint32_t block_size;
 
@@ -805,9 +832,17 @@ struct anv_state anv_state_pool_alloc(struct anv_state_pool *pool,
                                       uint32_t state_size, uint32_t alignment);
 struct anv_state anv_state_pool_alloc_back(struct anv_state_pool *pool);
 void anv_state_pool_free(struct anv_state_pool *pool, struct anv_state state);
+void anv_state_pool_print_stats(struct anv_state_pool *pool,
+                                const char *name);
+void anv_state_block_cache_init(struct anv_state_block_cache *cache,
+                                struct anv_state_pool *state_pool,
+                                uint32_t block_size);
+void anv_state_block_cache_trim(struct anv_state_block_cache *cache);
 void anv_state_stream_init(struct anv_state_stream *stream,
                            struct anv_state_pool *state_pool,
                            uint32_t block_size);
+void anv_state_stream_init_cached(struct anv_state_stream *stream,
+                                  struct anv_state_block_cache *cache);
 void anv_state_stream_finish(struct anv_state_stream *stream);
 struct anv_state anv_state_stream_alloc(struct anv_state_stream *stream,
                                         uint32_t size, uint32_t alignment);
@@ -1141,6 +1176,9 @@ struct anv_device {
     struct anv_pipeline_cache                   default_pipeline_cache;
     struct blorp_context                        blorp;
 
+    /** Threads for the backend compiles of graphics pipeline stages */
+    struct util_queue                           compile_queue;
+
     struct anv_state                            border_colors;
 
     struct anv_state                            slice_hash;
@@ -2465,6 +2503,10 @@ struct anv_cmd_state {
 struct anv_cmd_pool {
    VkAllocationCallbacks                        alloc;
    struct list_head                             cmd_buffers;
+
+   /* State stream blocks shared by the command buffers of this pool */
+   struct anv_state_block_cache                 surface_state_blocks;
+   struct anv_state_block_cache                 dynamic_state_blocks;
 };
 
 #define ANV_CMD_BUFFER_BATCH_SIZE 8192
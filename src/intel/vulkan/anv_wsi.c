@@ -214,6 +214,26 @@ VkResult anv_GetSwapchainImagesKHR(
                                 pSwapchainImages);
 }
 
+VkResult anv_GetRefreshCycleDurationGOOGLE(
+    VkDevice                                     device,
+    VkSwapchainKHR                               swapchain,
+    VkRefreshCycleDurationGOOGLE*                pDisplayTimingProperties)
+{
+   return wsi_common_get_refresh_cycle_duration(swapchain,
+                                                pDisplayTimingProperties);
+}
+
+VkResult anv_GetPastPresentationTimingGOOGLE(
+    VkDevice                                     device,
+    VkSwapchainKHR                               swapchain,
+    uint32_t*                                    pPresentationTimingCount,
+    VkPastPresentationTimingGOOGLE*              pPresentationTimings)
+{
+   return wsi_common_get_past_presentation_timing(swapchain,
+                                                  pPresentationTimingCount,
+                                                  pPresentationTimings);
+}
+
 VkResult anv_AcquireNextImageKHR(
     VkDevice                                     device,
     VkSwapchainKHR                               swapchain,
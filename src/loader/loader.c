@@ -46,6 +46,7 @@
 #endif
 #include <GL/gl.h>
 #include <GL/internal/dri_interface.h>
+#include "c11/threads.h"
 #include "loader.h"
 
 #ifdef HAVE_LIBDRM
@@ -514,6 +515,108 @@ loader_get_extensions_name(const char *driver_name)
    return name;
 }
 
+/* Drivers looked up so far in this process.  Probing several devices or
+ * creating several displays tends to open the same driver over and over,
+ * and each time the search paths were walked again and, if the last user
+ * had closed it, the library was mapped and relocated again.  Every entry
+ * which was found keeps a reference on the library, so it stays loaded.
+ */
+struct loader_driver {
+   struct loader_driver *next;
+   char *name;
+   char *search_paths;
+   char *path; /* NULL if the driver wasn't found */
+};
+
+static struct loader_driver *loader_drivers;
+static mtx_t loader_drivers_mutex = _MTX_INITIALIZER_NP;
+
+static void *
+loader_search_driver(const char *driver_name, const char *search_paths,
+                     char *path, size_t path_size)
+{
+   const char *next, *end;
+   void *driver = NULL;
+
+   end = search_paths + strlen(search_paths);
+   for (const char *p = search_paths; p < end; p = next + 1) {
+      int len;
+      next = strchr(p, ':');
+      if (next == NULL)
+         next = end;
+
+      len = next - p;
+#if USE_ELF_TLS
+      snprintf(path, path_size, "%.*s/tls/%s_dri.so", len, p, driver_name);
+      driver = dlopen(path, RTLD_NOW | RTLD_GLOBAL);
+#endif
+      if (driver == NULL) {
+         snprintf(path, path_size, "%.*s/%s_dri.so", len, p, driver_name);
+         driver = dlopen(path, RTLD_NOW | RTLD_GLOBAL);
+         if (driver == NULL)
+            log_(_LOADER_DEBUG, "MESA-LOADER: failed to open %s: %s\n",
+                 path, dlerror());
+      }
+      /* not need continue to loop all paths once the driver is found */
+      if (driver != NULL)
+         break;
+   }
+
+   return driver;
+}
+
+/* Open a driver, searching for it only the first time it is asked for with
+ * these search paths.
+ */
+static void *
+loader_dlopen_driver(const char *driver_name, const char *search_paths,
+                     char *path, size_t path_size)
+{
+   struct loader_driver *entry;
+   void *driver = NULL;
+
+   mtx_lock(&loader_drivers_mutex);
+
+   for (entry = loader_drivers; entry; entry = entry->next) {
+      if (strcmp(entry->name, driver_name) == 0 &&
+          strcmp(entry->search_paths, search_paths) == 0)
+         break;
+   }
+
+   if (entry) {
+      if (entry->path) {
+         snprintf(path, path_size, "%s", entry->path);
+         driver = dlopen(path, RTLD_NOW | RTLD_GLOBAL);
+      }
+      mtx_unlock(&loader_drivers_mutex);
+      return driver;
+   }
+
+   driver = loader_search_driver(driver_name, search_paths, path, path_size);
+
+   entry = calloc(1, sizeof(*entry));
+   if (entry) {
+      entry->name = strdup(driver_name);
+      entry->search_paths = strdup(search_paths);
+      /* The cache's own reference, which is never dropped. */
+      if (driver && dlopen(path, RTLD_NOW | RTLD_GLOBAL))
+         entry->path = strdup(path);
+
+      if (entry->name && entry->search_paths && (!driver || entry->path)) {
+         entry->next = loader_drivers;
+         loader_drivers = entry;
+      } else {
+         free(entry->name);
+         free(entry->search_paths);
+         free(entry->path);
+         free(entry);
+      }
+   }
+
+   mtx_unlock(&loader_drivers_mutex);
+   return driver;
+}
+
 /**
  * Opens a DRI driver using its driver name, returning the __DRIextension
  * entrypoints.
@@ -528,7 +631,7 @@ loader_open_driver(const char *driver_name,
                    void **out_driver_handle,
                    const char **search_path_vars)
 {
-   char path[PATH_MAX], *search_paths, *next, *end;
+   char path[PATH_MAX], *search_paths;
    char *get_extensions_name;
    const struct __DRIextensionRec **extensions = NULL;
    const struct __DRIextensionRec **(*get_extensions)(void);
@@ -544,31 +647,8 @@ loader_open_driver(const char *driver_name,
    if (search_paths == NULL)
       search_paths = DEFAULT_DRIVER_DIR;
 
-   void *driver = NULL;
-   end = search_paths + strlen(search_paths);
-   for (char *p = search_paths; p < end; p = next + 1) {
-      int len;
-      next = strchr(p, ':');
-      if (next == NULL)
-         next = end;
-
-      len = next - p;
-#if USE_ELF_TLS
-      snprintf(path, sizeof(path), "%.*s/tls/%s_dri.so", len, p, driver_name);
-      driver = dlopen(path, RTLD_NOW | RTLD_GLOBAL);
-#endif
-      if (driver == NULL) {
-         snprintf(path, sizeof(path), "%.*s/%s_dri.so", len, p, driver_name);
-         driver = dlopen(path, RTLD_NOW | RTLD_GLOBAL);
-         if (driver == NULL)
-            log_(_LOADER_DEBUG, "MESA-LOADER: failed to open %s: %s\n",
-                 path, dlerror());
-      }
-      /* not need continue to loop all paths once the driver is found */
-      if (driver != NULL)
-         break;
-   }
-
+   void *driver = loader_dlopen_driver(driver_name, search_paths,
+                                       path, sizeof(path));
    if (driver == NULL) {
       log_(_LOADER_WARNING, "MESA-LOADER: failed to open %s (search paths %s)\n",
            driver_name, search_paths);
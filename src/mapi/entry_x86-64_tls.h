@@ -61,18 +61,78 @@ __asm__(".text\n"
 #define MAPI_TMP_STUB_ASM_GCC
 #include "mapi_tmp.h"
 
+__asm__(".balign 32\n"
+        "x86_64_entry_end:");
+
 #ifndef MAPI_MODE_BRIDGE
 
 #include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include "u_execmem.h"
 
+extern char
+x86_64_entry_start[] HIDDEN;
+extern char
+x86_64_entry_end[] HIDDEN;
+
+static unsigned long long
+x86_64_current_tls(void)
+{
+   unsigned long long addr;
+
+   __asm__("movq " ENTRY_CURRENT_TABLE "@GOTTPOFF(%%rip), %0"
+           : "=r" (addr));
+
+   return addr;
+}
+
+/**
+ * Rewrite the public stubs to address the current table by its TLS offset,
+ * saving the load of the offset from the GOT on every call.  The stubs are
+ * still correct for any number of contexts and threads.
+ *
+ * This runs before the first dispatch table is made current.  If the text
+ * can't be made writable, e.g. because of an execmod policy, the stubs are
+ * left as they are.
+ */
 void
 entry_patch_public(void)
 {
-}
+#ifndef __ILP32__
+   const char code_templ[] = {
+      /* movq %fs:0, %r11 */
+      0x64, 0x4c, 0x8b, 0x1c, 0x25, 0x00, 0x00, 0x00, 0x00,
+      /* jmp *0x1234(%r11) */
+      0x41, 0xff, 0xa3, 0x34, 0x12, 0x00, 0x00,
+   };
+   unsigned long long addr = x86_64_current_tls();
+   uintptr_t page_size = sysconf(_SC_PAGESIZE);
+   uintptr_t start = (uintptr_t) x86_64_entry_start & ~(page_size - 1);
+   uintptr_t end = ((uintptr_t) x86_64_entry_end + page_size - 1) &
+                   ~(page_size - 1);
+   char *entry;
+   int slot;
 
-extern char
-x86_64_entry_start[] HIDDEN;
+   if ((addr >> 32) != 0xffffffff)
+      return;
+   addr &= 0xffffffff;
+
+   if (mprotect((void *) start, end - start,
+                PROT_READ | PROT_WRITE | PROT_EXEC))
+      return;
+
+   for (entry = x86_64_entry_start, slot = 0; entry < x86_64_entry_end;
+        entry += 32, slot++) {
+      memcpy(entry, code_templ, sizeof(code_templ));
+      *((unsigned int *) (entry + 5)) = addr;
+      entry_patch((mapi_func) entry, slot);
+   }
+
+   mprotect((void *) start, end - start, PROT_READ | PROT_EXEC);
+#endif
+}
 
 mapi_func
 entry_get_public(int slot)
@@ -109,12 +169,10 @@ entry_generate(int slot)
       0x41, 0xff, 0xe3,
 #endif
    };
-   unsigned long long addr;
+   unsigned long long addr = x86_64_current_tls();
    char *code;
    mapi_func entry;
 
-   __asm__("movq " ENTRY_CURRENT_TABLE "@GOTTPOFF(%%rip), %0"
-           : "=r" (addr));
    if ((addr >> 32) != 0xffffffff)
       return NULL;
    addr &= 0xffffffff;
@@ -88,9 +88,13 @@ class PrintCode(gl_XML.gl_print_base):
             out('return {0};'.format(call))
 
     def print_sync_dispatch(self, func):
-        out('debug_print_sync_fallback("{0}");'.format(func.name))
+        out('debug_print_sync_fallback(ctx, "{0}");'.format(func.name))
         self.print_sync_call(func)
 
+    def print_call_after(self, func):
+        if func.marshal_call_after:
+            out(func.marshal_call_after)
+
     def print_sync_body(self, func):
         out('/* {0}: marshalled synchronously */'.format(func.name))
         out('static {0} GLAPIENTRY'.format(func.return_type))
@@ -99,8 +103,13 @@ class PrintCode(gl_XML.gl_print_base):
         with indent():
             out('GET_CURRENT_CONTEXT(ctx);')
             out('_mesa_glthread_finish(ctx);')
-            out('debug_print_sync("{0}");'.format(func.name))
+            if func.marshal_fail:
+                out('if ({0})'.format(func.marshal_fail))
+                with indent():
+                    out('_mesa_glthread_restore_dispatch(ctx, __func__);')
+            out('debug_print_sync(ctx, "{0}");'.format(func.name))
             self.print_sync_call(func)
+            self.print_call_after(func)
         out('}')
         out('')
         out('')
@@ -254,9 +263,19 @@ class PrintCode(gl_XML.gl_print_base):
                     out('return;')
                 out('}')
 
+            if func.marshal_sync:
+                out('if ({0}) {{'.format(func.marshal_sync))
+                with indent():
+                    out('_mesa_glthread_finish(ctx);')
+                    self.print_sync_dispatch(func)
+                    self.print_call_after(func)
+                    out('return;')
+                out('}')
+
             out('if (cmd_size <= MARSHAL_MAX_CMD_SIZE) {')
             with indent():
                 self.print_async_dispatch(func)
+                self.print_call_after(func)
                 out('return;')
             out('}')
 
@@ -266,6 +285,7 @@ class PrintCode(gl_XML.gl_print_base):
         with indent():
             out('_mesa_glthread_finish(ctx);')
             self.print_sync_dispatch(func)
+            self.print_call_after(func)
 
         out('}')
 
@@ -286,8 +306,7 @@ class PrintCode(gl_XML.gl_print_base):
             out('const struct marshal_cmd_base *cmd_base = cmd;')
             out('switch (cmd_base->cmd_id) {')
             for func in api.functionIterateAll():
-                flavor = func.marshal_flavor()
-                if flavor in ('skip', 'sync'):
+                if not func.marshal_has_cmd():
                     continue
                 out('case DISPATCH_CMD_{0}:'.format(func.name))
                 with indent():
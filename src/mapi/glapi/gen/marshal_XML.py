@@ -58,6 +58,8 @@ class marshal_function(gl_XML.gl_function):
         # Store the "marshal" attribute, if present.
         self.marshal = element.get('marshal')
         self.marshal_fail = element.get('marshal_fail')
+        self.marshal_sync = element.get('marshal_sync')
+        self.marshal_call_after = element.get('marshal_call_after')
 
     def marshal_flavor(self):
         """Find out how this function should be marshalled between
@@ -84,3 +86,13 @@ class marshal_function(gl_XML.gl_function):
                 # written logic to handle this yet.  TODO: fix.
                 return 'sync'
         return 'async'
+
+    def marshal_has_cmd(self):
+        """Whether calls are queued as a command for the worker thread.
+        Custom functions that return a value or write to output parameters
+        are implemented synchronously and don't get a command."""
+        flavor = self.marshal_flavor()
+        if flavor == 'custom':
+            return (self.return_type == 'void' and
+                    not any(p.is_output for p in self.parameters))
+        return flavor not in ('skip', 'sync')
@@ -48,7 +48,7 @@
  * Upload a shader stage's binding table as indirect state.
  *
  * This copies brw_stage_state::surf_offset[] into the indirect state section
- * of the batchbuffer (allocated by brw_state_batch()).
+ * of the batchbuffer (allocated by brw_state_batch_cached()).
  */
 void
 brw_upload_binding_table(struct brw_context *brw,
@@ -73,13 +73,14 @@ brw_upload_binding_table(struct brw_context *brw,
             brw->shader_time.bo, 0, ISL_FORMAT_RAW,
             brw->shader_time.bo->size, 1, RELOC_WRITE);
       }
-      uint32_t *bind =
-         brw_state_batch(brw, prog_data->binding_table.size_bytes,
-                         32, &stage_state->bind_bo_offset);
-
-      /* BRW_NEW_SURFACES and BRW_NEW_*_CONSTBUF */
-      memcpy(bind, stage_state->surf_offset,
-             prog_data->binding_table.size_bytes);
+      /* Switching back to a set of surfaces we already used in this batch
+       * reuses the binding table uploaded for it then.
+       *
+       * BRW_NEW_SURFACES and BRW_NEW_*_CONSTBUF
+       */
+      brw_state_batch_cached(brw, stage_state->surf_offset,
+                             prog_data->binding_table.size_bytes,
+                             32, &stage_state->bind_bo_offset);
    }
 
    brw->ctx.NewDriverState |= BRW_NEW_BINDING_TABLE_POINTERS;
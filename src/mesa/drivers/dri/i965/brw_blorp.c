@@ -49,7 +49,10 @@ brw_blorp_lookup_shader(struct blorp_batch *batch,
 {
    struct brw_context *brw = batch->driver_batch;
    return brw_search_cache(&brw->cache, BRW_CACHE_BLORP_PROG, key, key_size,
-                           kernel_out, prog_data_out, true);
+                           kernel_out, prog_data_out, true) ||
+          brw_disk_cache_upload_keyed_prog(brw, BRW_CACHE_BLORP_PROG,
+                                           key, key_size,
+                                           kernel_out, prog_data_out);
 }
 
 static bool
@@ -64,6 +67,11 @@ brw_blorp_upload_shader(struct blorp_batch *batch,
    brw_upload_cache(&brw->cache, BRW_CACHE_BLORP_PROG, key, key_size,
                     kernel, kernel_size, prog_data, prog_data_size,
                     kernel_out, prog_data_out);
+   /* Blorp programs don't have any uniforms to store. */
+   assert(prog_data->nr_params == 0);
+   brw_disk_cache_write_keyed_prog(brw, BRW_CACHE_BLORP_PROG, key, key_size,
+                                   kernel, kernel_size,
+                                   prog_data, prog_data_size);
    return true;
 }
 
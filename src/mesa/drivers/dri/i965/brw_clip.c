@@ -61,6 +61,10 @@ static void compile_clip_prog( struct brw_context *brw,
 		    program, program_size,
 		    &prog_data, sizeof(prog_data),
 		    &brw->clip.prog_offset, &brw->clip.prog_data);
+   brw_disk_cache_write_keyed_prog(brw, BRW_CACHE_CLIP_PROG,
+                                   key, sizeof(*key),
+                                   program, program_size,
+                                   &prog_data, sizeof(prog_data));
    ralloc_free(mem_ctx);
 }
 
@@ -204,7 +208,11 @@ brw_upload_clip_prog(struct brw_context *brw)
    }
 
    if (!brw_search_cache(&brw->cache, BRW_CACHE_CLIP_PROG, &key, sizeof(key),
-                         &brw->clip.prog_offset, &brw->clip.prog_data, true)) {
+                         &brw->clip.prog_offset, &brw->clip.prog_data, true) &&
+       !brw_disk_cache_upload_keyed_prog(brw, BRW_CACHE_CLIP_PROG,
+                                         &key, sizeof(key),
+                                         &brw->clip.prog_offset,
+                                         &brw->clip.prog_data)) {
       compile_clip_prog( brw, &key );
    }
 }
@@ -626,6 +626,12 @@ brw_initialize_context_constants(struct brw_context *brw)
    ctx->Const.GLSLTessLevelsAsInputs = true;
    ctx->Const.PrimitiveRestartForPatches = true;
 
+   /* All stages go through NIR, which repeats the GLSL IR optimizations
+    * much more cheaply, so run do_common_optimization() just once at compile
+    * and link time instead of looping it until it makes no progress.
+    */
+   ctx->Const.GLSLOptimizeConservatively = true;
+
    ctx->Const.Program[MESA_SHADER_VERTEX].MaxNativeInstructions = 16 * 1024;
    ctx->Const.Program[MESA_SHADER_VERTEX].MaxAluInstructions = 0;
    ctx->Const.Program[MESA_SHADER_VERTEX].MaxTexInstructions = 0;
@@ -332,6 +332,12 @@ struct brw_program {
    GLuint id;
 
    bool compiled_once;
+
+   /**
+    * Disk cache hash of the NIR of ARB and fixed-function programs.  Zero
+    * for GLSL programs, whose linker-computed hash is used instead.
+    */
+   unsigned char sha1[20];
 };
 
 
@@ -527,6 +533,12 @@ struct intel_batchbuffer {
    /** Map from batch offset to brw_state_batch data (with DEBUG_BATCH) */
    struct hash_table_u64 *state_batch_sizes;
 
+   /**
+    * State uploaded by brw_state_batch_cached() in the current batch, keyed
+    * by its contents.
+    */
+   struct hash_table *state_cache;
+
    struct gen_batch_decode_ctx decoder;
 };
 
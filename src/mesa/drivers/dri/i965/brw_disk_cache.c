@@ -24,6 +24,7 @@
 #include "compiler/blob.h"
 #include "compiler/glsl/ir_uniform.h"
 #include "compiler/glsl/shader_cache.h"
+#include "compiler/nir/nir_serialize.h"
 #include "main/mtypes.h"
 #include "util/build_id.h"
 #include "util/debug.h"
@@ -52,6 +53,70 @@ debug_enabled_for_stage(gl_shader_stage stage)
    return (INTEL_DEBUG & stage_debug_flags[stage]) != 0;
 }
 
+/* The number of variant keys remembered for each program, to be loaded
+ * again when the program is next created.
+ */
+#define MAX_RECORDED_VARIANTS 16
+
+static bool
+sha1_is_zero(const unsigned char *sha1)
+{
+   static const unsigned char zero[20] = {0};
+   return memcmp(sha1, zero, sizeof(zero)) == 0;
+}
+
+/**
+ * Return the SHA1 identifying the program's source, or NULL if it can't be
+ * cached.
+ *
+ * GLSL programs use the hash computed by the linker from their shader
+ * sources.  ARB and fixed-function programs, which the linker doesn't see,
+ * use the hash of their NIR taken by brw_disk_cache_hash_program().
+ */
+static const unsigned char *
+program_sha1(struct gl_program *prog)
+{
+   if (prog == NULL)
+      return NULL;
+
+   const struct brw_program *bprog = brw_program(prog);
+   if (!sha1_is_zero(bprog->sha1))
+      return bprog->sha1;
+
+   if (prog->is_arb_asm || prog->sh.data == NULL || prog->sh.data->spirv ||
+       sha1_is_zero(prog->sh.data->sha1))
+      return NULL;
+
+   return prog->sh.data->sha1;
+}
+
+/**
+ * Hash the NIR of a program which doesn't come from an application's GLSL
+ * shaders, so its compiled variants can be found in the disk cache.
+ *
+ * This has to be done before any variant is compiled, while the NIR is
+ * still the one made from the program string.
+ */
+void
+brw_disk_cache_hash_program(struct brw_context *brw, struct gl_program *prog)
+{
+   struct brw_program *bprog = brw_program(prog);
+
+   memset(bprog->sha1, 0, sizeof(bprog->sha1));
+   prog->program_written_to_cache = false;
+
+   if (brw->ctx.Cache == NULL || prog->nir == NULL)
+      return;
+
+   struct blob blob;
+   blob_init(&blob);
+   blob_write_uint32(&blob, prog->is_arb_asm);
+   nir_serialize(&blob, prog->nir);
+   if (!blob.out_of_memory)
+      _mesa_sha1_compute(blob.data, blob.size, bprog->sha1);
+   blob_finish(&blob);
+}
+
 static void
 gen_shader_sha1(struct gl_program *prog, gl_shader_stage stage,
                 void *key, unsigned char *out_sha1)
@@ -61,7 +126,7 @@ gen_shader_sha1(struct gl_program *prog, gl_shader_stage stage,
    char manifest[256];
    int offset = 0;
 
-   _mesa_sha1_format(sha1_buf, prog->sh.data->sha1);
+   _mesa_sha1_format(sha1_buf, program_sha1(prog));
    offset += snprintf(manifest, sizeof(manifest), "program: %s\n", sha1_buf);
 
    _mesa_sha1_compute(key, brw_prog_key_size(stage), sha1);
@@ -83,44 +148,42 @@ read_blob_program_data(struct blob_reader *binary, struct gl_program *prog,
       (binary->current == binary->end);
 }
 
-static bool
-read_and_upload(struct brw_context *brw, struct disk_cache *cache,
-                struct gl_program *prog, gl_shader_stage stage)
+static struct brw_stage_state *
+get_stage_state(struct brw_context *brw, gl_shader_stage stage)
 {
-   unsigned char binary_sha1[20];
-
-   union brw_any_prog_key prog_key;
-
    switch (stage) {
    case MESA_SHADER_VERTEX:
-      brw_vs_populate_key(brw, &prog_key.vs);
-      break;
+      return &brw->vs.base;
    case MESA_SHADER_TESS_CTRL:
-      brw_tcs_populate_key(brw, &prog_key.tcs);
-      break;
+      return &brw->tcs.base;
    case MESA_SHADER_TESS_EVAL:
-      brw_tes_populate_key(brw, &prog_key.tes);
-      break;
+      return &brw->tes.base;
    case MESA_SHADER_GEOMETRY:
-      brw_gs_populate_key(brw, &prog_key.gs);
-      break;
+      return &brw->gs.base;
    case MESA_SHADER_FRAGMENT:
-      brw_wm_populate_key(brw, &prog_key.wm);
-      break;
+      return &brw->wm.base;
    case MESA_SHADER_COMPUTE:
-      brw_cs_populate_key(brw, &prog_key.cs);
-      break;
+      return &brw->cs.base;
    default:
       unreachable("Unsupported stage!");
    }
+}
 
-   /* We don't care what instance of the program it is for the disk cache hash
-    * lookup, so set the id to 0 for the sha1 hashing. program_string_id will
-    * be set below.
-    */
-   prog_key.base.program_string_id = 0;
+/**
+ * Load the variant of \p prog for \p prog_key from the disk cache into the
+ * program cache.  The key's program_string_id must be 0, and is set to the
+ * program's id for the upload.
+ */
+static bool
+upload_variant(struct brw_context *brw, struct disk_cache *cache,
+               struct gl_program *prog, gl_shader_stage stage,
+               union brw_any_prog_key *prog_key,
+               uint32_t *prog_offset_out, void *prog_data_out)
+{
+   unsigned char binary_sha1[20];
 
-   gen_shader_sha1(prog, stage, &prog_key, binary_sha1);
+   assert(prog_key->base.program_string_id == 0);
+   gen_shader_sha1(prog, stage, prog_key, binary_sha1);
 
    size_t buffer_size;
    uint8_t *buffer = disk_cache_get(cache, binary_sha1, &buffer_size);
@@ -162,65 +225,84 @@ read_and_upload(struct brw_context *brw, struct disk_cache *cache,
       return false;
    }
 
-   enum brw_cache_id cache_id;
-   struct brw_stage_state *stage_state;
+   prog_key->base.program_string_id = brw_program(prog)->id;
+
+   brw_alloc_stage_scratch(brw, get_stage_state(brw, stage),
+                           prog_data->total_scratch);
 
+   if (unlikely(debug_enabled_for_stage(stage))) {
+      fprintf(stderr, "NIR for %s program %d loaded from disk shader cache:\n",
+              _mesa_shader_stage_to_abbrev(stage), brw_program(prog)->id);
+      brw_program_deserialize_driver_blob(&brw->ctx, prog, stage);
+      nir_shader *nir = prog->nir;
+      nir_print_shader(nir, stderr);
+      fprintf(stderr, "Native code for %s %s shader %s from disk cache:\n",
+              nir->info.label ? nir->info.label : "unnamed",
+              _mesa_shader_stage_to_string(nir->info.stage), nir->info.name);
+      brw_disassemble(&brw->screen->devinfo, program, 0,
+                      prog_data->program_size, stderr);
+   }
+
+   brw_upload_cache(&brw->cache, brw_stage_cache_id(stage),
+                    prog_key, brw_prog_key_size(stage),
+                    program, prog_data->program_size, prog_data,
+                    brw_prog_data_size(stage), prog_offset_out,
+                    prog_data_out);
+
+   ralloc_free(prog_data);
+   free(buffer);
+
+   return true;
+}
+
+static void
+populate_key(struct brw_context *brw, gl_shader_stage stage,
+             union brw_any_prog_key *prog_key)
+{
    switch (stage) {
    case MESA_SHADER_VERTEX:
-      cache_id = BRW_CACHE_VS_PROG;
-      stage_state = &brw->vs.base;
+      brw_vs_populate_key(brw, &prog_key->vs);
       break;
    case MESA_SHADER_TESS_CTRL:
-      cache_id = BRW_CACHE_TCS_PROG;
-      stage_state = &brw->tcs.base;
+      brw_tcs_populate_key(brw, &prog_key->tcs);
       break;
    case MESA_SHADER_TESS_EVAL:
-      cache_id = BRW_CACHE_TES_PROG;
-      stage_state = &brw->tes.base;
+      brw_tes_populate_key(brw, &prog_key->tes);
       break;
    case MESA_SHADER_GEOMETRY:
-      cache_id = BRW_CACHE_GS_PROG;
-      stage_state = &brw->gs.base;
+      brw_gs_populate_key(brw, &prog_key->gs);
       break;
    case MESA_SHADER_FRAGMENT:
-      cache_id = BRW_CACHE_FS_PROG;
-      stage_state = &brw->wm.base;
+      brw_wm_populate_key(brw, &prog_key->wm);
       break;
    case MESA_SHADER_COMPUTE:
-      cache_id = BRW_CACHE_CS_PROG;
-      stage_state = &brw->cs.base;
+      brw_cs_populate_key(brw, &prog_key->cs);
       break;
    default:
       unreachable("Unsupported stage!");
    }
 
-   prog_key.base.program_string_id = brw_program(prog)->id;
+   /* We don't care what instance of the program it is for the disk cache hash
+    * lookup, so set the id to 0 for the sha1 hashing. program_string_id will
+    * be set when uploading.
+    */
+   prog_key->base.program_string_id = 0;
+}
 
-   brw_alloc_stage_scratch(brw, stage_state, prog_data->total_scratch);
+static bool
+read_and_upload(struct brw_context *brw, struct disk_cache *cache,
+                struct gl_program *prog, gl_shader_stage stage)
+{
+   struct brw_stage_state *stage_state = get_stage_state(brw, stage);
+   union brw_any_prog_key prog_key;
 
-   if (unlikely(debug_enabled_for_stage(stage))) {
-      fprintf(stderr, "NIR for %s program %d loaded from disk shader cache:\n",
-              _mesa_shader_stage_to_abbrev(stage), brw_program(prog)->id);
-      brw_program_deserialize_driver_blob(&brw->ctx, prog, stage);
-      nir_shader *nir = prog->nir;
-      nir_print_shader(nir, stderr);
-      fprintf(stderr, "Native code for %s %s shader %s from disk cache:\n",
-              nir->info.label ? nir->info.label : "unnamed",
-              _mesa_shader_stage_to_string(nir->info.stage), nir->info.name);
-      brw_disassemble(&brw->screen->devinfo, program, 0,
-                      prog_data->program_size, stderr);
-   }
+   populate_key(brw, stage, &prog_key);
 
-   brw_upload_cache(&brw->cache, cache_id, &prog_key, brw_prog_key_size(stage),
-                    program, prog_data->program_size, prog_data,
-                    brw_prog_data_size(stage), &stage_state->prog_offset,
-                    &stage_state->prog_data);
+   if (!upload_variant(brw, cache, prog, stage, &prog_key,
+                       &stage_state->prog_offset, &stage_state->prog_data))
+      return false;
 
    prog->program_written_to_cache = true;
-
-   ralloc_free(prog_data);
-   free(buffer);
-
    return true;
 }
 
@@ -231,11 +313,8 @@ brw_disk_cache_upload_program(struct brw_context *brw, gl_shader_stage stage)
    if (cache == NULL)
       return false;
 
-   struct gl_program *prog = brw->ctx._Shader->CurrentProgram[stage];
-   if (prog == NULL)
-      return false;
-
-   if (prog->sh.data->spirv)
+   struct gl_program *prog = brw->programs[stage];
+   if (program_sha1(prog) == NULL)
       return false;
 
    if (brw->ctx._Shader->Flags & GLSL_CACHE_FALLBACK)
@@ -262,6 +341,151 @@ fail:
    return false;
 }
 
+static void
+variant_list_sha1(struct disk_cache *cache, struct gl_program *prog,
+                  gl_shader_stage stage, unsigned char *out_sha1)
+{
+   static const char tag[] = "variants";
+   struct blob blob;
+
+   blob_init(&blob);
+   blob_write_bytes(&blob, tag, sizeof(tag));
+   blob_write_bytes(&blob, program_sha1(prog), 20);
+   blob_write_uint32(&blob, stage);
+   disk_cache_compute_key(cache, blob.data, blob.size, out_sha1);
+   blob_finish(&blob);
+}
+
+/**
+ * Read the keys of the program's variants recorded by record_variant().
+ *
+ * Returns the malloc()ed cache item, with *keys pointing into it, or NULL if
+ * there is none.
+ */
+static void *
+read_variant_list(struct disk_cache *cache, struct gl_program *prog,
+                  gl_shader_stage stage, const void **keys, uint32_t *count)
+{
+   const uint32_t key_size = brw_prog_key_size(stage);
+   unsigned char list_sha1[20];
+   size_t size;
+
+   variant_list_sha1(cache, prog, stage, list_sha1);
+   void *buffer = disk_cache_get(cache, list_sha1, &size);
+   if (buffer == NULL)
+      return NULL;
+
+   struct blob_reader blob;
+   blob_reader_init(&blob, buffer, size);
+   *count = blob_read_uint32(&blob);
+   *keys = blob_read_bytes(&blob, *count * key_size);
+
+   if (blob.overrun || *count > MAX_RECORDED_VARIANTS) {
+      free(buffer);
+      return NULL;
+   }
+
+   return buffer;
+}
+
+/**
+ * Remember that a variant of the program was compiled for \p key, so that
+ * brw_disk_cache_upload_variants() can load it before it is needed.
+ *
+ * The most recently compiled variants come first, and the oldest ones are
+ * dropped once MAX_RECORDED_VARIANTS are known.
+ */
+static void
+record_variant(struct disk_cache *cache, struct gl_program *prog,
+               gl_shader_stage stage, const void *key)
+{
+   const uint32_t key_size = brw_prog_key_size(stage);
+   const void *old_keys = NULL;
+   uint32_t old_count = 0;
+   void *buffer = read_variant_list(cache, prog, stage, &old_keys, &old_count);
+
+   struct blob blob;
+   blob_init(&blob);
+
+   uint32_t count = 1;
+   size_t count_offset = blob_reserve_uint32(&blob);
+   blob_write_bytes(&blob, key, key_size);
+
+   for (uint32_t i = 0; i < old_count && count < MAX_RECORDED_VARIANTS; i++) {
+      const void *old_key = (const char *)old_keys + i * key_size;
+
+      if (memcmp(old_key, key, key_size) == 0) {
+         /* Already recorded as the newest one, so there's nothing to do. */
+         if (i == 0)
+            goto done;
+         continue;
+      }
+
+      blob_write_bytes(&blob, old_key, key_size);
+      count++;
+   }
+
+   blob_overwrite_uint32(&blob, count_offset, count);
+
+   unsigned char list_sha1[20];
+   variant_list_sha1(cache, prog, stage, list_sha1);
+   disk_cache_put(cache, list_sha1, blob.data, blob.size, NULL);
+
+done:
+   blob_finish(&blob);
+   free(buffer);
+}
+
+/**
+ * Load every variant of a newly created program which was compiled in an
+ * earlier run and is in the disk cache, so that drawing with it doesn't
+ * have to wait for a compile.
+ *
+ * Variants which are missing from the disk cache are left to be compiled
+ * when first needed.
+ */
+void
+brw_disk_cache_upload_variants(struct brw_context *brw,
+                               struct gl_program *prog)
+{
+   struct disk_cache *cache = brw->ctx.Cache;
+   if (cache == NULL || program_sha1(prog) == NULL)
+      return;
+
+   if (brw->ctx._Shader->Flags & GLSL_CACHE_FALLBACK)
+      return;
+
+   const gl_shader_stage stage = prog->info.stage;
+   const uint32_t key_size = brw_prog_key_size(stage);
+   const void *keys;
+   uint32_t count;
+   void *buffer = read_variant_list(cache, prog, stage, &keys, &count);
+   if (buffer == NULL)
+      return;
+
+   for (uint32_t i = 0; i < count; i++) {
+      union brw_any_prog_key prog_key;
+      memcpy(&prog_key, (const char *)keys + i * key_size, key_size);
+      if (prog_key.base.program_string_id != 0)
+         continue;
+
+      union brw_any_prog_key search_key = prog_key;
+      search_key.base.program_string_id = brw_program(prog)->id;
+
+      uint32_t prog_offset;
+      void *prog_data;
+      if (brw_search_cache(&brw->cache, brw_stage_cache_id(stage),
+                           &search_key, key_size, &prog_offset, &prog_data,
+                           false))
+         continue;
+
+      upload_variant(brw, cache, prog, stage, &prog_key,
+                     &prog_offset, &prog_data);
+   }
+
+   free(buffer);
+}
+
 static void
 write_program_data(struct brw_context *brw, struct gl_program *prog,
                    void *key, struct brw_stage_prog_data *prog_data,
@@ -287,11 +511,29 @@ write_program_data(struct brw_context *brw, struct gl_program *prog,
    }
 
    disk_cache_put(cache, sha1, binary.data, binary.size, NULL);
+   record_variant(cache, prog, stage, key);
 
    prog->program_written_to_cache = true;
    blob_finish(&binary);
 }
 
+static void
+write_stage_program(struct brw_context *brw, struct disk_cache *cache,
+                    gl_shader_stage stage)
+{
+   struct gl_program *prog = brw->programs[stage];
+   if (program_sha1(prog) == NULL || prog->program_written_to_cache)
+      return;
+
+   struct brw_stage_state *stage_state = get_stage_state(brw, stage);
+   union brw_any_prog_key prog_key;
+
+   populate_key(brw, stage, &prog_key);
+
+   write_program_data(brw, prog, &prog_key, stage_state->prog_data,
+                      stage_state->prog_offset, cache, stage);
+}
+
 void
 brw_disk_cache_write_render_programs(struct brw_context *brw)
 {
@@ -299,92 +541,118 @@ brw_disk_cache_write_render_programs(struct brw_context *brw)
    if (cache == NULL)
       return;
 
-   struct gl_program *prog;
    gl_shader_stage stage;
    for (stage = MESA_SHADER_VERTEX; stage <= MESA_SHADER_FRAGMENT; stage++) {
-      prog = brw->ctx._Shader->CurrentProgram[stage];
-      if (prog && prog->sh.data->spirv)
+      struct gl_program *prog = brw->programs[stage];
+      if (prog && !prog->is_arb_asm && prog->sh.data &&
+          prog->sh.data->spirv)
          return;
    }
 
-   prog = brw->ctx._Shader->CurrentProgram[MESA_SHADER_VERTEX];
-   if (prog && !prog->program_written_to_cache) {
-      struct brw_vs_prog_key vs_key;
-      brw_vs_populate_key(brw, &vs_key);
-      vs_key.base.program_string_id = 0;
+   for (stage = MESA_SHADER_VERTEX; stage <= MESA_SHADER_FRAGMENT; stage++)
+      write_stage_program(brw, cache, stage);
+}
 
-      write_program_data(brw, prog, &vs_key, brw->vs.base.prog_data,
-                         brw->vs.base.prog_offset, cache,
-                         MESA_SHADER_VERTEX);
-   }
+void
+brw_disk_cache_write_compute_program(struct brw_context *brw)
+{
+   struct disk_cache *cache = brw->ctx.Cache;
+   if (cache == NULL)
+      return;
 
-   prog = brw->ctx._Shader->CurrentProgram[MESA_SHADER_TESS_CTRL];
-   if (prog && !prog->program_written_to_cache) {
-      struct brw_tcs_prog_key tcs_key;
-      brw_tcs_populate_key(brw, &tcs_key);
-      tcs_key.base.program_string_id = 0;
+   write_stage_program(brw, cache, MESA_SHADER_COMPUTE);
+}
 
-      write_program_data(brw, prog, &tcs_key, brw->tcs.base.prog_data,
-                         brw->tcs.base.prog_offset, cache,
-                         MESA_SHADER_TESS_CTRL);
-   }
+static void
+keyed_prog_sha1(struct disk_cache *cache, enum brw_cache_id cache_id,
+                const void *key, uint32_t key_size, unsigned char *out_sha1)
+{
+   /* Tag the key so it can't collide with the hashes of GL programs, or
+    * with the keys of the other kinds of programs.
+    */
+   static const char tag[] = "keyed";
+   struct blob blob;
+
+   blob_init(&blob);
+   blob_write_bytes(&blob, tag, sizeof(tag));
+   blob_write_uint32(&blob, cache_id);
+   blob_write_bytes(&blob, key, key_size);
+   disk_cache_compute_key(cache, blob.data, blob.size, out_sha1);
+   blob_finish(&blob);
+}
+
+/**
+ * Look up a program which is identified by its key alone (blorp, clip, SF
+ * and fixed-function GS programs) in the disk cache, and upload it to the
+ * program cache.
+ */
+bool
+brw_disk_cache_upload_keyed_prog(struct brw_context *brw,
+                                 enum brw_cache_id cache_id,
+                                 const void *key, uint32_t key_size,
+                                 uint32_t *kernel_out, void *prog_data_out)
+{
+   struct disk_cache *cache = brw->ctx.Cache;
+   if (cache == NULL)
+      return false;
 
-   prog = brw->ctx._Shader->CurrentProgram[MESA_SHADER_TESS_EVAL];
-   if (prog && !prog->program_written_to_cache) {
-      struct brw_tes_prog_key tes_key;
-      brw_tes_populate_key(brw, &tes_key);
-      tes_key.base.program_string_id = 0;
+   unsigned char binary_sha1[20];
+   keyed_prog_sha1(cache, cache_id, key, key_size, binary_sha1);
 
-      write_program_data(brw, prog, &tes_key, brw->tes.base.prog_data,
-                         brw->tes.base.prog_offset, cache,
-                         MESA_SHADER_TESS_EVAL);
-   }
+   size_t buffer_size;
+   uint8_t *buffer = disk_cache_get(cache, binary_sha1, &buffer_size);
+   if (buffer == NULL)
+      return false;
+
+   struct blob_reader binary;
+   blob_reader_init(&binary, buffer, buffer_size);
 
-   prog = brw->ctx._Shader->CurrentProgram[MESA_SHADER_GEOMETRY];
-   if (prog && !prog->program_written_to_cache) {
-      struct brw_gs_prog_key gs_key;
-      brw_gs_populate_key(brw, &gs_key);
-      gs_key.base.program_string_id = 0;
+   const uint32_t prog_data_size = blob_read_uint32(&binary);
+   const void *prog_data = blob_read_bytes(&binary, prog_data_size);
+   const uint32_t kernel_size = blob_read_uint32(&binary);
+   const void *kernel = blob_read_bytes(&binary, kernel_size);
 
-      write_program_data(brw, prog, &gs_key, brw->gs.base.prog_data,
-                         brw->gs.base.prog_offset, cache,
-                         MESA_SHADER_GEOMETRY);
+   if (binary.overrun) {
+      free(buffer);
+      return false;
    }
 
-   prog = brw->ctx._Shader->CurrentProgram[MESA_SHADER_FRAGMENT];
-   if (prog && !prog->program_written_to_cache) {
-      struct brw_wm_prog_key wm_key;
-      brw_wm_populate_key(brw, &wm_key);
-      wm_key.base.program_string_id = 0;
+   brw_upload_cache(&brw->cache, cache_id, key, key_size,
+                    kernel, kernel_size, prog_data, prog_data_size,
+                    kernel_out, prog_data_out);
 
-      write_program_data(brw, prog, &wm_key, brw->wm.base.prog_data,
-                         brw->wm.base.prog_offset, cache,
-                         MESA_SHADER_FRAGMENT);
-   }
+   free(buffer);
+   return true;
 }
 
+/**
+ * Store a program which is identified by its key alone in the disk cache.
+ * Its prog_data must not point to anything, as it is stored as is.
+ */
 void
-brw_disk_cache_write_compute_program(struct brw_context *brw)
+brw_disk_cache_write_keyed_prog(struct brw_context *brw,
+                                enum brw_cache_id cache_id,
+                                const void *key, uint32_t key_size,
+                                const void *kernel, uint32_t kernel_size,
+                                const void *prog_data,
+                                uint32_t prog_data_size)
 {
    struct disk_cache *cache = brw->ctx.Cache;
    if (cache == NULL)
       return;
 
-   struct gl_program *prog =
-      brw->ctx._Shader->CurrentProgram[MESA_SHADER_COMPUTE];
-
-   if (prog && prog->sh.data->spirv)
-      return;
+   unsigned char binary_sha1[20];
+   keyed_prog_sha1(cache, cache_id, key, key_size, binary_sha1);
 
-   if (prog && !prog->program_written_to_cache) {
-      struct brw_cs_prog_key cs_key;
-      brw_cs_populate_key(brw, &cs_key);
-      cs_key.base.program_string_id = 0;
+   struct blob binary;
+   blob_init(&binary);
+   blob_write_uint32(&binary, prog_data_size);
+   blob_write_bytes(&binary, prog_data, prog_data_size);
+   blob_write_uint32(&binary, kernel_size);
+   blob_write_bytes(&binary, kernel, kernel_size);
 
-      write_program_data(brw, prog, &cs_key, brw->cs.base.prog_data,
-                         brw->cs.base.prog_offset, cache,
-                         MESA_SHADER_COMPUTE);
-   }
+   disk_cache_put(cache, binary_sha1, binary.data, binary.size, NULL);
+   blob_finish(&binary);
 }
 
 void
@@ -145,6 +145,10 @@ brw_codegen_ff_gs_prog(struct brw_context *brw,
 		    program, program_size,
 		    &c.prog_data, sizeof(c.prog_data),
 		    &brw->ff_gs.prog_offset, &brw->ff_gs.prog_data);
+   brw_disk_cache_write_keyed_prog(brw, BRW_CACHE_FF_GS_PROG,
+                                   &c.key, sizeof(c.key),
+                                   program, program_size,
+                                   &c.prog_data, sizeof(c.prog_data));
    ralloc_free(mem_ctx);
 }
 
@@ -253,7 +257,11 @@ brw_upload_ff_gs_prog(struct brw_context *brw)
    if (brw->ff_gs.prog_active) {
       if (!brw_search_cache(&brw->cache, BRW_CACHE_FF_GS_PROG, &key,
                             sizeof(key), &brw->ff_gs.prog_offset,
-                            &brw->ff_gs.prog_data, true)) {
+                            &brw->ff_gs.prog_data, true) &&
+          !brw_disk_cache_upload_keyed_prog(brw, BRW_CACHE_FF_GS_PROG,
+                                            &key, sizeof(key),
+                                            &brw->ff_gs.prog_offset,
+                                            &brw->ff_gs.prog_data)) {
          brw_codegen_ff_gs_prog(brw, &key);
       }
    }
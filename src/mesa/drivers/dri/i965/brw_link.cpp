@@ -355,6 +355,10 @@ brw_link_shader(struct gl_context *ctx, struct gl_shader_program *shProg)
             _mesa_add_state_reference(prog->Parameters, slots[i].tokens);
          }
       }
+
+      /* Fixed-function fragment programs aren't hashed by the linker. */
+      if (shProg->Name == 0)
+         brw_disk_cache_hash_program(brw, prog);
    }
 
    /* The linker tries to dead code eliminate unused varying components,
@@ -382,6 +386,12 @@ brw_link_shader(struct gl_context *ctx, struct gl_shader_program *shProg)
    if (brw->precompile && !brw_shader_precompile(ctx, shProg))
       return GL_FALSE;
 
+   for (stage = 0; stage < ARRAY_SIZE(shProg->_LinkedShaders); stage++) {
+      struct gl_linked_shader *shader = shProg->_LinkedShaders[stage];
+      if (shader)
+         brw_disk_cache_upload_variants(brw, shader->Program);
+   }
+
    /* SPIR-V programs build its resource list from linked NIR shaders. */
    if (!shProg->data->spirv)
       build_program_resource_list(ctx, shProg);
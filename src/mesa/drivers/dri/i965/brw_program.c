@@ -291,7 +291,9 @@ brwProgramStringNotify(struct gl_context *ctx,
 
       brw_shader_gather_info(prog->nir, prog);
 
+      brw_disk_cache_hash_program(brw, prog);
       brw_fs_precompile(ctx, prog);
+      brw_disk_cache_upload_variants(brw, prog);
       break;
    }
    case GL_VERTEX_PROGRAM_ARB: {
@@ -317,7 +319,9 @@ brwProgramStringNotify(struct gl_context *ctx,
 
       brw_shader_gather_info(prog->nir, prog);
 
+      brw_disk_cache_hash_program(brw, prog);
       brw_vs_precompile(ctx, prog);
+      brw_disk_cache_upload_variants(brw, prog);
       break;
    }
    default:
@@ -138,6 +138,12 @@ bool brw_read_blob_program_data(struct blob_reader *binary,
                                 const uint8_t **program,
                                 struct brw_stage_prog_data *prog_data);
 
+/* brw_disk_cache.c */
+void brw_disk_cache_hash_program(struct brw_context *brw,
+                                 struct gl_program *prog);
+void brw_disk_cache_upload_variants(struct brw_context *brw,
+                                    struct gl_program *prog);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -64,6 +64,10 @@ static void compile_sf_prog( struct brw_context *brw,
 		    program, program_size,
 		    &prog_data, sizeof(prog_data),
 		    &brw->sf.prog_offset, &brw->sf.prog_data);
+   brw_disk_cache_write_keyed_prog(brw, BRW_CACHE_SF_PROG,
+                                   key, sizeof(*key),
+                                   program, program_size,
+                                   &prog_data, sizeof(prog_data));
    ralloc_free(mem_ctx);
 }
 
@@ -165,7 +169,11 @@ brw_upload_sf_prog(struct brw_context *brw)
    }
 
    if (!brw_search_cache(&brw->cache, BRW_CACHE_SF_PROG, &key, sizeof(key),
-                         &brw->sf.prog_offset, &brw->sf.prog_data, true)) {
+                         &brw->sf.prog_offset, &brw->sf.prog_data, true) &&
+       !brw_disk_cache_upload_keyed_prog(brw, BRW_CACHE_SF_PROG,
+                                         &key, sizeof(key),
+                                         &brw->sf.prog_offset,
+                                         &brw->sf.prog_data)) {
       compile_sf_prog( brw, &key );
    }
 }
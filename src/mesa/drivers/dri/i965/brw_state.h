@@ -157,6 +157,17 @@ bool brw_disk_cache_upload_program(struct brw_context *brw,
                                    gl_shader_stage stage);
 void brw_disk_cache_write_compute_program(struct brw_context *brw);
 void brw_disk_cache_write_render_programs(struct brw_context *brw);
+bool brw_disk_cache_upload_keyed_prog(struct brw_context *brw,
+                                      enum brw_cache_id cache_id,
+                                      const void *key, uint32_t key_size,
+                                      uint32_t *kernel_out,
+                                      void *prog_data_out);
+void brw_disk_cache_write_keyed_prog(struct brw_context *brw,
+                                     enum brw_cache_id cache_id,
+                                     const void *key, uint32_t key_size,
+                                     const void *kernel, uint32_t kernel_size,
+                                     const void *prog_data,
+                                     uint32_t prog_data_size);
 
 /***********************************************************************
  * brw_state_upload.c
@@ -216,6 +227,8 @@ enum brw_cache_id brw_stage_cache_id(gl_shader_stage stage);
 void brw_require_statebuffer_space(struct brw_context *brw, int size);
 void *brw_state_batch(struct brw_context *brw,
                       int size, int alignment, uint32_t *out_offset);
+void brw_state_batch_cached(struct brw_context *brw, const void *data,
+                            int size, int alignment, uint32_t *out_offset);
 
 /* brw_wm_surface_state.c */
 uint32_t brw_get_surface_tiling_bits(uint32_t tiling);
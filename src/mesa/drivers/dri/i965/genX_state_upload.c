@@ -4995,10 +4995,7 @@ genX(upload_default_color)(struct brw_context *brw,
       alignment = 512;
    }
 
-   uint32_t *sdc = brw_state_batch(
-      brw, GENX(SAMPLER_BORDER_COLOR_STATE_length) * sizeof(uint32_t),
-      alignment, sdc_offset);
-
+   uint32_t sdc[GENX(SAMPLER_BORDER_COLOR_STATE_length)];
    struct GENX(SAMPLER_BORDER_COLOR_STATE) state = { 0 };
 
 #define ASSIGN(dst, src) \
@@ -5105,6 +5102,11 @@ genX(upload_default_color)(struct brw_context *brw,
 #undef BORDER_COLOR_ATTR
 
    GENX(SAMPLER_BORDER_COLOR_STATE_pack)(brw, sdc, &state);
+
+   /* Samplers sharing a border color share its SAMPLER_BORDER_COLOR_STATE,
+    * which in turn lets identical sampler state tables be shared.
+    */
+   brw_state_batch_cached(brw, sdc, sizeof(sdc), alignment, sdc_offset);
 }
 
 static uint32_t
@@ -5373,10 +5375,22 @@ genX(upload_sampler_state_table)(struct brw_context *brw,
    const int dwords = GENX(SAMPLER_STATE_length);
    const int size_in_bytes = dwords * sizeof(uint32_t);
 
+#if GEN_GEN >= 6
+   /* Pack the table on the stack first, so that switching back to samplers
+    * used earlier in the batch reuses the table uploaded then.  Before Gen6
+    * SAMPLER_STATE points at its border color with a relocation, so it
+    * can't be shared that way.
+    */
+   uint32_t table[BRW_MAX_TEX_UNIT * GENX(SAMPLER_STATE_length)];
+   assert(sampler_count <= BRW_MAX_TEX_UNIT);
+   memset(table, 0, sampler_count * size_in_bytes);
+   uint32_t *sampler_state = table;
+#else
    uint32_t *sampler_state = brw_state_batch(brw,
                                              sampler_count * size_in_bytes,
                                              32, &stage_state->sampler_offset);
    /* memset(sampler_state, 0, sampler_count * size_in_bytes); */
+#endif
 
    for (unsigned s = 0; s < sampler_count; s++) {
       if (SamplersUsed & (1 << s)) {
@@ -5389,6 +5403,11 @@ genX(upload_sampler_state_table)(struct brw_context *brw,
       sampler_state += dwords;
    }
 
+#if GEN_GEN >= 6
+   brw_state_batch_cached(brw, table, sampler_count * size_in_bytes,
+                          32, &stage_state->sampler_offset);
+#endif
+
    if (GEN_GEN >= 7 && stage_state->stage != MESA_SHADER_COMPUTE) {
       /* Emit a 3DSTATE_SAMPLER_STATE_POINTERS_XS packet. */
       genX(emit_sampler_state_pointers_xs)(brw, stage_state);
@@ -122,6 +122,39 @@ init_reloc_list(struct brw_reloc_list *rlist, int count)
                           sizeof(struct drm_i915_gem_relocation_entry));
 }
 
+/**
+ * A piece of state uploaded by brw_state_batch_cached(), along with a copy
+ * of its contents to compare against.
+ */
+struct state_batch_entry {
+   uint32_t size;
+   uint32_t alignment;
+   uint32_t offset;
+   const void *data;
+};
+
+static uint32_t
+hash_state_batch_entry(const void *key)
+{
+   const struct state_batch_entry *entry = key;
+   return _mesa_hash_data(entry->data, entry->size);
+}
+
+static bool
+state_batch_entries_equal(const void *a, const void *b)
+{
+   const struct state_batch_entry *entry_a = a, *entry_b = b;
+   return entry_a->size == entry_b->size &&
+          entry_a->alignment == entry_b->alignment &&
+          memcmp(entry_a->data, entry_b->data, entry_a->size) == 0;
+}
+
+static void
+free_state_batch_entry(struct hash_entry *entry)
+{
+   ralloc_free((void *) entry->key);
+}
+
 void
 intel_batchbuffer_init(struct brw_context *brw)
 {
@@ -159,6 +192,10 @@ intel_batchbuffer_init(struct brw_context *brw)
       batch->decoder.max_vbo_decoded_lines = 100;
    }
 
+   batch->state_cache =
+      _mesa_hash_table_create(NULL, hash_state_batch_entry,
+                              state_batch_entries_equal);
+
    batch->use_batch_first =
       screen->kernel_features & KERNEL_ALLOWS_EXEC_BATCH_FIRST;
 
@@ -272,6 +309,8 @@ intel_batchbuffer_reset(struct brw_context *brw)
 
    if (batch->state_batch_sizes)
       _mesa_hash_table_u64_clear(batch->state_batch_sizes, NULL);
+
+   _mesa_hash_table_clear(batch->state_cache, free_state_batch_entry);
 }
 
 static void
@@ -332,6 +371,7 @@ intel_batchbuffer_free(struct intel_batchbuffer *batch)
    brw_bo_unreference(batch->last_bo);
    brw_bo_unreference(batch->batch.bo);
    brw_bo_unreference(batch->state.bo);
+   _mesa_hash_table_destroy(batch->state_cache, NULL);
    if (batch->state_batch_sizes) {
       _mesa_hash_table_u64_destroy(batch->state_batch_sizes, NULL);
       gen_batch_decode_ctx_finish(&batch->decoder);
@@ -1049,6 +1089,49 @@ brw_state_batch(struct brw_context *brw,
    return batch->state.map + (offset >> 2);
 }
 
+/**
+ * Copies a block of indirect state into the statebuffer, unless the same
+ * bytes were already uploaded by an earlier call in this batch, in which
+ * case that copy's offset is returned instead.
+ *
+ * Only state which doesn't need relocations may be uploaded this way, and
+ * it must not be modified afterwards.
+ */
+void
+brw_state_batch_cached(struct brw_context *brw, const void *data,
+                       int size, int alignment, uint32_t *out_offset)
+{
+   struct intel_batchbuffer *batch = &brw->batch;
+   struct state_batch_entry lookup = {
+      .size = size,
+      .alignment = alignment,
+      .data = data,
+   };
+   const uint32_t hash = hash_state_batch_entry(&lookup);
+
+   struct hash_entry *entry =
+      _mesa_hash_table_search_pre_hashed(batch->state_cache, hash, &lookup);
+   if (entry) {
+      *out_offset = ((const struct state_batch_entry *) entry->key)->offset;
+      return;
+   }
+
+   /* This may flush the batch, which empties the cache. */
+   void *map = brw_state_batch(brw, size, alignment, out_offset);
+   memcpy(map, data, size);
+
+   struct state_batch_entry *new_entry =
+      ralloc_size(batch->state_cache, sizeof(*new_entry) + size);
+   void *copy = new_entry + 1;
+   memcpy(copy, data, size);
+   *new_entry = lookup;
+   new_entry->offset = *out_offset;
+   new_entry->data = copy;
+
+   _mesa_hash_table_insert_pre_hashed(batch->state_cache, hash,
+                                      new_entry, new_entry);
+}
+
 void
 intel_batchbuffer_data(struct brw_context *brw,
                        const void *data, GLuint bytes)
@@ -2933,9 +2933,16 @@ intel_miptree_unmap_tiled_memcpy(struct brw_context *brw,
       char *dst = intel_miptree_map_raw(brw, mt, map->mode | MAP_RAW);
       dst += mt->offset;
 
+      const isl_memcpy_type copy_type =
+#if defined(USE_SSE41)
+         !mt->bo->cache_coherent && cpu_has_sse4_1 ?
+         ISL_MEMCPY_STREAMING_STORE :
+#endif
+         ISL_MEMCPY;
+
       isl_memcpy_linear_to_tiled(
          x1, x2, y1, y2, dst, map->ptr, mt->surf.row_pitch_B, map->stride,
-         brw->has_swizzling, mt->surf.tiling, ISL_MEMCPY);
+         brw->has_swizzling, mt->surf.tiling, copy_type);
 
       intel_miptree_unmap_raw(mt);
    }
@@ -317,6 +317,7 @@ _mesa_delete_vao(struct gl_context *ctx, struct gl_vertex_array_object *obj)
 {
    unbind_array_object_vbos(ctx, obj);
    _mesa_reference_buffer_object(ctx, &obj->IndexBufferObj, NULL);
+   free(obj->DriverCache);
    free(obj->Label);
    free(obj);
 }
@@ -573,6 +574,8 @@ _mesa_update_vao_derived_arrays(struct gl_context *ctx,
    /* Make sure we do not run into problems with shared objects */
    assert(!vao->SharedAndImmutable || vao->NewArrays == 0);
 
+   vao->_Generation++;
+
    /* Limit used for common binding scanning below. */
    const GLsizeiptr MaxRelativeOffset =
       ctx->Const.MaxVertexAttribRelativeOffset;
@@ -1583,6 +1583,8 @@ copy_array_object(struct gl_context *ctx,
    dest->VertexAttribBufferMask = src->VertexAttribBufferMask;
    dest->_AttributeMapMode = src->_AttributeMapMode;
    dest->NewArrays = src->NewArrays;
+   /* Invalidate driver state derived from the previous arrays. */
+   dest->_Generation++;
 }
 
 /**
@@ -1327,6 +1327,10 @@ _mesa_free_context_data(struct gl_context *ctx, bool destroy_compiler_types)
       _mesa_make_current(ctx, NULL, NULL);
    }
 
+   /* Background compiles use the context; let them finish first. */
+   if (util_queue_is_initialized(&ctx->ShaderCompilerQueue))
+      util_queue_destroy(&ctx->ShaderCompilerQueue);
+
    /* unreference WinSysDraw/Read buffers */
    _mesa_reference_framebuffer(&ctx->WinSysDrawBuffer, NULL);
    _mesa_reference_framebuffer(&ctx->WinSysReadBuffer, NULL);
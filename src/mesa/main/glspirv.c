@@ -26,11 +26,14 @@
 #include "shaderobj.h"
 #include "mtypes.h"
 
+#include "compiler/blob.h"
 #include "compiler/nir/nir.h"
+#include "compiler/nir/nir_serialize.h"
 #include "compiler/spirv/nir_spirv.h"
 
 #include "program/program.h"
 
+#include "util/disk_cache.h"
 #include "util/u_atomic.h"
 
 void
@@ -215,6 +218,81 @@ _mesa_spirv_link_shaders(struct gl_context *ctx, struct gl_shader_program *prog)
    }
 }
 
+/**
+ * Compute the disk cache key of the NIR translated from a specialized SPIR-V
+ * shader: everything spirv_to_nir() and the passes after it depend on.
+ */
+static void
+spirv_nir_cache_key(struct gl_context *ctx,
+                    const struct gl_shader_spirv_data *spirv_data,
+                    gl_shader_stage stage,
+                    const nir_shader_compiler_options *options,
+                    cache_key key)
+{
+   const struct gl_spirv_module *spirv_module = spirv_data->SpirVModule;
+   struct blob blob;
+
+   blob_init(&blob);
+   blob_write_string(&blob, "spirv_to_nir");
+   blob_write_uint32(&blob, stage);
+   blob_write_bytes(&blob, spirv_module->Binary, spirv_module->Length);
+   blob_write_string(&blob, spirv_data->SpirVEntryPoint);
+   blob_write_uint32(&blob, spirv_data->NumSpecializationConstants);
+   blob_write_bytes(&blob, spirv_data->SpecializationConstantsIndex,
+                    spirv_data->NumSpecializationConstants * sizeof(GLuint));
+   blob_write_bytes(&blob, spirv_data->SpecializationConstantsValue,
+                    spirv_data->NumSpecializationConstants * sizeof(GLuint));
+   blob_write_uint32(&blob, ctx->Const.GLSLFragCoordIsSysVal);
+   blob_write_bytes(&blob, &ctx->Const.SpirVCapabilities,
+                    sizeof(ctx->Const.SpirVCapabilities));
+   blob_write_bytes(&blob, options, sizeof(*options));
+
+   disk_cache_compute_key(ctx->Cache, blob.data, blob.size, key);
+   blob_finish(&blob);
+}
+
+/**
+ * Look up translated NIR in the disk cache.  The entry holds the dual-slot
+ * inputs of vertex shaders followed by the serialized NIR.
+ */
+static nir_shader *
+spirv_nir_cache_load(struct gl_context *ctx, const cache_key key,
+                     const nir_shader_compiler_options *options,
+                     struct gl_program *prog)
+{
+   size_t size;
+   void *buffer = disk_cache_get(ctx->Cache, key, &size);
+   if (!buffer)
+      return NULL;
+
+   struct blob_reader blob;
+   blob_reader_init(&blob, buffer, size);
+
+   GLbitfield64 dual_slot_inputs = blob_read_uint64(&blob);
+   nir_shader *nir = blob.overrun ? NULL :
+                     nir_deserialize(NULL, options, &blob);
+   free(buffer);
+
+   if (nir)
+      prog->DualSlotInputs = dual_slot_inputs;
+
+   return nir;
+}
+
+static void
+spirv_nir_cache_store(struct gl_context *ctx, const cache_key key,
+                      const nir_shader *nir, const struct gl_program *prog)
+{
+   struct blob blob;
+
+   blob_init(&blob);
+   blob_write_uint64(&blob, prog->DualSlotInputs);
+   nir_serialize(&blob, nir);
+   if (!blob.out_of_memory)
+      disk_cache_put(ctx->Cache, key, blob.data, blob.size, NULL);
+   blob_finish(&blob);
+}
+
 nir_shader *
 _mesa_spirv_to_nir(struct gl_context *ctx,
                    const struct gl_shader_program *prog,
@@ -227,6 +305,17 @@ _mesa_spirv_to_nir(struct gl_context *ctx,
    struct gl_shader_spirv_data *spirv_data = linked_shader->spirv_data;
    assert(spirv_data);
 
+   /* Relinking the same specialized module skips the translation. */
+   cache_key key;
+   nir_shader *nir = NULL;
+
+   if (ctx->Cache) {
+      spirv_nir_cache_key(ctx, spirv_data, stage, options, key);
+      nir = spirv_nir_cache_load(ctx, key, options, linked_shader->Program);
+      if (nir)
+         goto done;
+   }
+
    struct gl_spirv_module *spirv_module = spirv_data->SpirVModule;
    assert (spirv_module != NULL);
 
@@ -258,7 +347,7 @@ _mesa_spirv_to_nir(struct gl_context *ctx,
 
    };
 
-   nir_shader *nir =
+   nir =
       spirv_to_nir((const uint32_t *) &spirv_module->Binary[0],
                    spirv_module->Length / 4,
                    spec_entries, spirv_data->NumSpecializationConstants,
@@ -272,14 +361,8 @@ _mesa_spirv_to_nir(struct gl_context *ctx,
 
    nir->options = options;
 
-   nir->info.name =
-      ralloc_asprintf(nir, "SPIRV:%s:%d",
-                      _mesa_shader_stage_to_abbrev(nir->info.stage),
-                      prog->Name);
    nir_validate_shader(nir, "after spirv_to_nir");
 
-   nir->info.separate_shader = linked_shader->Program->info.separate_shader;
-
    /* We have to lower away local constant initializers right before we
     * inline functions.  That way they get properly initialized at the top
     * of the function and not at the top of its caller.
@@ -307,6 +390,17 @@ _mesa_spirv_to_nir(struct gl_context *ctx,
 
    NIR_PASS_V(nir, nir_lower_frexp);
 
+   if (ctx->Cache)
+      spirv_nir_cache_store(ctx, key, nir, linked_shader->Program);
+
+done:
+   /* The name and separate_shader come from the program, not the module. */
+   nir->info.name =
+      ralloc_asprintf(nir, "SPIRV:%s:%d",
+                      _mesa_shader_stage_to_abbrev(nir->info.stage),
+                      prog->Name);
+   nir->info.separate_shader = linked_shader->Program->info.separate_shader;
+
    return nir;
 }
 
@@ -56,6 +56,36 @@ glthread_unmarshal_batch(void *job, int thread_index)
    batch->used = 0;
 }
 
+/**
+ * The worker job.  It executes submitted batches until the ring is empty and
+ * then goes idle.  The main thread queues a new job only after it has seen
+ * the worker go idle, so the steady state doesn't touch the queue mutex.
+ */
+static void
+glthread_drain_ring(void *job, int thread_index)
+{
+   struct glthread_state *glthread = (struct glthread_state*)job;
+
+   do {
+      while (glthread->executed != p_atomic_read(&glthread->submitted)) {
+         struct glthread_batch *batch =
+            glthread->ring[glthread->executed % MARSHAL_MAX_BATCHES];
+
+         glthread_unmarshal_batch(batch, thread_index);
+         glthread->executed++;
+         util_queue_fence_signal(&batch->fence);
+      }
+
+      p_atomic_cmpxchg(&glthread->worker_running, 1, 0);
+
+      /* The main thread may have submitted a batch after the loop above
+       * ended, but before it could see that the worker went idle.  Whoever
+       * wins the compare-and-swap executes it.
+       */
+   } while (glthread->executed != p_atomic_read(&glthread->submitted) &&
+            p_atomic_cmpxchg(&glthread->worker_running, 0, 1) == 0);
+}
+
 static void
 glthread_thread_initialization(void *job, int thread_index)
 {
@@ -65,6 +95,18 @@ glthread_thread_initialization(void *job, int thread_index)
    _glapi_set_context(ctx);
 }
 
+static void
+glthread_free_batches(struct glthread_state *glthread)
+{
+   for (unsigned i = 0; i < glthread->num_batches; i++) {
+      util_queue_fence_destroy(&glthread->batches[i]->fence);
+      free(glthread->batches[i]);
+   }
+
+   for (unsigned i = 0; i < ARRAY_SIZE(glthread->wakeup_fences); i++)
+      util_queue_fence_destroy(&glthread->wakeup_fences[i]);
+}
+
 void
 _mesa_glthread_init(struct gl_context *ctx)
 {
@@ -73,27 +115,48 @@ _mesa_glthread_init(struct gl_context *ctx)
    if (!glthread)
       return;
 
-   if (!util_queue_init(&glthread->queue, "gl", MARSHAL_MAX_BATCHES - 2,
-                        1, 0)) {
+   /* At most one job runs and one is queued, see _mesa_glthread_flush_batch. */
+   if (!util_queue_init(&glthread->queue, "gl", 2, 1, 0)) {
       free(glthread);
       return;
    }
 
+   for (unsigned i = 0; i < MARSHAL_MIN_BATCHES; i++) {
+      struct glthread_batch *batch = calloc(1, sizeof(*batch));
+
+      if (!batch) {
+         for (unsigned j = 0; j < i; j++) {
+            util_queue_fence_destroy(&glthread->batches[j]->fence);
+            free(glthread->batches[j]);
+         }
+         util_queue_destroy(&glthread->queue);
+         free(glthread);
+         return;
+      }
+
+      batch->ctx = ctx;
+      util_queue_fence_init(&batch->fence);
+      glthread->batches[i] = batch;
+   }
+   glthread->num_batches = MARSHAL_MIN_BATCHES;
+   glthread->batch_size = MARSHAL_MAX_CMD_SIZE;
+
+   for (unsigned i = 0; i < ARRAY_SIZE(glthread->wakeup_fences); i++)
+      util_queue_fence_init(&glthread->wakeup_fences[i]);
+
    ctx->MarshalExec = _mesa_create_marshal_table(ctx);
    if (!ctx->MarshalExec) {
       util_queue_destroy(&glthread->queue);
+      glthread_free_batches(glthread);
       free(glthread);
       return;
    }
 
-   for (unsigned i = 0; i < MARSHAL_MAX_BATCHES; i++) {
-      glthread->batches[i].ctx = ctx;
-      util_queue_fence_init(&glthread->batches[i].fence);
-   }
-
    glthread->stats.queue = &glthread->queue;
    ctx->CurrentClientDispatch = ctx->MarshalExec;
    ctx->GLThread = glthread;
+   _mesa_glthread_init_vaos(ctx);
+   _mesa_glthread_refresh_shadow_state(ctx);
 
    /* Execute the thread initialization function in the thread. */
    struct util_queue_fence fence;
@@ -114,10 +177,10 @@ _mesa_glthread_destroy(struct gl_context *ctx)
 
    _mesa_glthread_finish(ctx);
    util_queue_destroy(&glthread->queue);
+   glthread_free_batches(glthread);
 
-   for (unsigned i = 0; i < MARSHAL_MAX_BATCHES; i++)
-      util_queue_fence_destroy(&glthread->batches[i].fence);
-
+   _mesa_glthread_destroy_vaos(ctx);
+   _mesa_glthread_upload_buffer_unref(glthread->upload_buffer);
    free(glthread);
    ctx->GLThread = NULL;
 
@@ -149,7 +212,7 @@ _mesa_glthread_flush_batch(struct gl_context *ctx)
    if (!glthread)
       return;
 
-   struct glthread_batch *next = &glthread->batches[glthread->next];
+   struct glthread_batch *next = glthread->batches[glthread->next];
    if (!next->used)
       return;
 
@@ -166,10 +229,57 @@ _mesa_glthread_flush_batch(struct gl_context *ctx)
 
    p_atomic_add(&glthread->stats.num_offloaded_items, next->used);
 
-   util_queue_add_job(&glthread->queue, next, &next->fence,
-                      glthread_unmarshal_batch, NULL);
-   glthread->last = glthread->next;
-   glthread->next = (glthread->next + 1) % MARSHAL_MAX_BATCHES;
+   /* Publish the batch to the worker.  The ring can't overflow, because the
+    * ring is as large as the maximum number of batches and every batch is
+    * executed before it's filled again.
+    */
+   util_queue_fence_reset(&next->fence);
+   glthread->ring[glthread->submitted % MARSHAL_MAX_BATCHES] = next;
+   p_atomic_inc(&glthread->submitted);
+   glthread->last = next;
+
+   /* Wake up the worker if it's idle.  The previous job has at least started
+    * when the worker is seen idle, and the job before it has completed, so
+    * alternating between two fences is enough.
+    */
+   if (p_atomic_cmpxchg(&glthread->worker_running, 0, 1) == 0) {
+      struct util_queue_fence *fence =
+         &glthread->wakeup_fences[glthread->num_wakeups++ %
+                                  ARRAY_SIZE(glthread->wakeup_fences)];
+
+      util_queue_add_job(&glthread->queue, glthread, fence,
+                         glthread_drain_ring, NULL);
+   }
+
+   glthread->next = (glthread->next + 1) % glthread->num_batches;
+   next = glthread->batches[glthread->next];
+
+   if (util_queue_fence_is_signalled(&next->fence))
+      return;
+
+   /* The worker is behind.  Add another batch, so that the main thread can
+    * keep going.  Once there are enough batches, use bigger ones instead,
+    * which makes the handoff cheaper relative to the work in a batch.
+    */
+   if (glthread->num_batches < MARSHAL_MAX_BATCHES) {
+      struct glthread_batch *batch = calloc(1, sizeof(*batch));
+
+      if (batch) {
+         batch->ctx = ctx;
+         util_queue_fence_init(&batch->fence);
+         memmove(&glthread->batches[glthread->next + 1],
+                 &glthread->batches[glthread->next],
+                 (glthread->num_batches - glthread->next) *
+                 sizeof(glthread->batches[0]));
+         glthread->batches[glthread->next] = batch;
+         glthread->num_batches++;
+         return;
+      }
+   }
+
+   glthread->batch_size = MIN2(glthread->batch_size * 2,
+                               MARSHAL_MAX_BATCH_SIZE);
+   util_queue_fence_wait(&next->fence);
 }
 
 /**
@@ -193,11 +303,11 @@ _mesa_glthread_finish(struct gl_context *ctx)
    if (u_thread_is_self(glthread->queue.threads[0]))
       return;
 
-   struct glthread_batch *last = &glthread->batches[glthread->last];
-   struct glthread_batch *next = &glthread->batches[glthread->next];
+   struct glthread_batch *last = glthread->last;
+   struct glthread_batch *next = glthread->batches[glthread->next];
    bool synced = false;
 
-   if (!util_queue_fence_is_signalled(&last->fence)) {
+   if (last && !util_queue_fence_is_signalled(&last->fence)) {
       util_queue_fence_wait(&last->fence);
       synced = true;
    }
@@ -205,6 +315,13 @@ _mesa_glthread_finish(struct gl_context *ctx)
    if (next->used) {
       p_atomic_add(&glthread->stats.num_direct_items, next->used);
 
+      /* A large partial batch means the worker sat idle while the main
+       * thread filled it.  Submit smaller batches to start the worker sooner.
+       */
+      if (next->used > glthread->batch_size / 2)
+         glthread->batch_size = MAX2(glthread->batch_size / 2,
+                                     MARSHAL_MIN_BATCH_SIZE);
+
       /* Since glthread_unmarshal_batch changes the dispatch to direct,
        * restore it after it's done.
        */
@@ -24,31 +24,98 @@
 #ifndef _GLTHREAD_H
 #define _GLTHREAD_H
 
-/* The size of one batch and the maximum size of one call.
+/* The maximum size of one call, and the initial size of one batch.
  *
- * This should be as low as possible, so that:
+ * Batches should be as small as possible, so that:
  * - multiple synchronizations within a frame don't slow us down much
  * - a smaller number of calls per frame can still get decent parallelism
  * - the memory footprint of the queue is low, and with that comes a lower
  *   chance of experiencing CPU cache thrashing
- * but it should be high enough so that u_queue overhead remains negligible.
+ * but they should be big enough so that the handoff overhead remains
+ * negligible.  Since the best size depends on the application, the batch
+ * size adapts between MARSHAL_MIN_BATCH_SIZE and MARSHAL_MAX_BATCH_SIZE,
+ * see glthread.c.
  */
 #define MARSHAL_MAX_CMD_SIZE (8 * 1024)
+#define MARSHAL_MIN_BATCH_SIZE (2 * 1024)
+#define MARSHAL_MAX_BATCH_SIZE (32 * 1024)
 
 /* The number of batch slots in memory.
  *
  * One batch is being executed, one batch is being filled, the rest are
- * waiting batches. There must be at least 1 slot for a waiting batch,
- * so the minimum number of batches is 3.
+ * waiting batches.  The number of batches starts at MARSHAL_MIN_BATCHES and
+ * grows up to MARSHAL_MAX_BATCHES while the main thread has to wait for free
+ * batches.  MARSHAL_MAX_BATCHES must be a power of two.
  */
-#define MARSHAL_MAX_BATCHES 8
+#define MARSHAL_MIN_BATCHES 4
+#define MARSHAL_MAX_BATCHES 32
 
 #include <inttypes.h>
 #include <stdbool.h>
 #include "util/u_queue.h"
+#include "main/glheader.h"
+#include "compiler/shader_enums.h"
+#include "main/config.h"
 
 enum marshal_dispatch_cmd_id;
 struct gl_context;
+struct _mesa_HashTable;
+
+/** Vertex attrib array state needed to copy user arrays for a draw. */
+struct glthread_attrib
+{
+   const void *Pointer;
+
+   /** The effective stride, never 0. */
+   GLsizei Stride;
+
+   GLuint ElementSize;
+   GLuint Divisor;
+};
+
+/**
+ * The subset of a vertex array object that the main thread tracks, so that
+ * draws with user vertex arrays or user indices don't need to synchronize.
+ */
+struct glthread_vao
+{
+   GLuint Name;
+   GLuint CurrentElementBufferName;
+
+   /** Enabled arrays (VERT_BIT_*). */
+   GLbitfield Enabled;
+
+   /** Arrays that were last set while no VBO was bound (VERT_BIT_*). */
+   GLbitfield UserPointerMask;
+
+   struct glthread_attrib Attrib[VERT_ATTRIB_MAX];
+};
+
+/** The GL_CLIENT_VERTEX_ARRAY_BIT state saved by glPushClientAttrib. */
+struct glthread_client_attrib
+{
+   struct glthread_vao VAO;
+   GLuint CurrentArrayBufferName;
+   GLuint ClientActiveTexture;
+   GLuint RestartIndex;
+   bool PrimitiveRestart;
+   bool PrimitiveRestartFixedIndex;
+
+   /** Whether GL_CLIENT_VERTEX_ARRAY_BIT was pushed at this level. */
+   bool Valid;
+};
+
+/**
+ * A reference-counted block of memory that user vertex arrays and indices
+ * are copied into.  Draw commands hold a reference until they have been
+ * executed by the worker thread.
+ */
+struct glthread_upload_buffer
+{
+   int RefCount;
+   unsigned Size;
+   uint8_t Data[];
+};
 
 /** A single batch of commands queued up for execution. */
 struct glthread_batch
@@ -63,37 +130,86 @@ struct glthread_batch
    size_t used;
 
    /** Data contained in the command buffer. */
-   uint8_t buffer[MARSHAL_MAX_CMD_SIZE];
+   uint8_t buffer[MARSHAL_MAX_BATCH_SIZE];
 };
 
 struct glthread_state
 {
-   /** Multithreaded queue. */
+   /** Multithreaded queue.  It is only used to wake up the idle worker. */
    struct util_queue queue;
 
    /** This is sent to the driver for framebuffer overlay / HUD. */
    struct util_queue_monitoring stats;
 
-   /** The ring of batches in memory. */
-   struct glthread_batch batches[MARSHAL_MAX_BATCHES];
+   /** The batches in memory, in the order they are filled. */
+   struct glthread_batch *batches[MARSHAL_MAX_BATCHES];
+   unsigned num_batches;
 
-   /** Index of the last submitted batch. */
-   unsigned last;
+   /** The last submitted batch, or NULL. */
+   struct glthread_batch *last;
 
    /** Index of the batch being filled and about to be submitted. */
    unsigned next;
 
+   /** The batch is submitted when it would grow beyond this. */
+   unsigned batch_size;
+
    /**
-    * Tracks on the main thread side whether the current vertex array binding
-    * is in a VBO.
+    * Single-producer, single-consumer ring of submitted batches.  The main
+    * thread fills ring[submitted % MARSHAL_MAX_BATCHES] and then increments
+    * "submitted".  The worker executes batches until "executed" catches up.
     */
-   bool vertex_array_is_vbo;
+   struct glthread_batch *ring[MARSHAL_MAX_BATCHES];
+   uint32_t submitted;
+   uint32_t executed;
 
    /**
-    * Tracks on the main thread side whether the current element array (index
-    * buffer) binding is in a VBO.
+    * Whether the worker is executing batches.  Whoever changes it from 0 to
+    * 1 is responsible for the batches in the ring, so the main thread only
+    * queues a job when the worker has gone idle.
     */
-   bool element_array_is_vbo;
+   uint32_t worker_running;
+
+   /** Fences of the last two jobs that woke up the worker. */
+   struct util_queue_fence wakeup_fences[2];
+   unsigned num_wakeups;
+
+   /** Vertex array objects tracked by the main thread. */
+   struct _mesa_HashTable *VAOs;
+   struct glthread_vao DefaultVAO;
+   struct glthread_vao *CurrentVAO;
+   struct glthread_vao *LastLookedUpVAO;
+
+   /** The GL_ARRAY_BUFFER binding as seen by the main thread. */
+   GLuint CurrentArrayBufferName;
+
+   /** glClientActiveTexture as a texture coordinate unit index. */
+   GLuint ClientActiveTexture;
+
+   /** Primitive restart state, needed to compute index bounds. */
+   bool PrimitiveRestart;
+   bool PrimitiveRestartFixedIndex;
+   GLuint RestartIndex;
+
+   /** glPushClientAttrib stack. */
+   struct glthread_client_attrib ClientAttribStack[MAX_CLIENT_ATTRIB_STACK_DEPTH];
+   unsigned ClientAttribStackTop;
+
+   /**
+    * Server state that glGet* and glIsEnabled can answer without
+    * synchronizing, see glthread_get.c.  ShadowValid has a bit for each
+    * piece of state that is currently known.
+    */
+   GLbitfield ShadowValid;
+   GLbitfield ShadowEnabled;
+   GLuint ActiveTexture;
+   GLenum MatrixMode;
+   GLuint CurrentProgram;
+   GLfloat Viewport[4];
+
+   /** The buffer that user vertex arrays and indices are copied into. */
+   struct glthread_upload_buffer *upload_buffer;
+   unsigned upload_offset;
 };
 
 void _mesa_glthread_init(struct gl_context *ctx);
@@ -103,4 +219,52 @@ void _mesa_glthread_restore_dispatch(struct gl_context *ctx, const char *func);
 void _mesa_glthread_flush_batch(struct gl_context *ctx);
 void _mesa_glthread_finish(struct gl_context *ctx);
 
+void _mesa_glthread_init_vaos(struct gl_context *ctx);
+void _mesa_glthread_destroy_vaos(struct gl_context *ctx);
+void _mesa_glthread_BindBuffer(struct gl_context *ctx, GLenum target,
+                               GLuint buffer);
+void _mesa_glthread_DeleteBuffers(struct gl_context *ctx, GLsizei n,
+                                  const GLuint *buffers);
+void _mesa_glthread_BindVertexArray(struct gl_context *ctx, GLuint id);
+void _mesa_glthread_GenVertexArrays(struct gl_context *ctx, GLsizei n,
+                                    GLuint *arrays);
+void _mesa_glthread_DeleteVertexArrays(struct gl_context *ctx, GLsizei n,
+                                       const GLuint *ids);
+void _mesa_glthread_VertexArrayElementBuffer(struct gl_context *ctx,
+                                             GLuint vaobj, GLuint buffer);
+void _mesa_glthread_ClientState(struct gl_context *ctx, GLenum array,
+                                bool enable);
+void _mesa_glthread_ClientStatei(struct gl_context *ctx, GLenum array,
+                                 GLuint index, bool enable);
+void _mesa_glthread_AttribArray(struct gl_context *ctx, GLuint index,
+                                bool enable);
+void _mesa_glthread_VertexArrayAttrib(struct gl_context *ctx, GLuint vaobj,
+                                      GLuint index, bool enable);
+void _mesa_glthread_AttribPointer(struct gl_context *ctx, GLuint attrib,
+                                  GLint size, GLenum type, GLsizei stride,
+                                  const void *pointer);
+void _mesa_glthread_AttribDivisor(struct gl_context *ctx, GLuint index,
+                                  GLuint divisor);
+void _mesa_glthread_ClientActiveTexture(struct gl_context *ctx,
+                                        GLenum texture);
+void _mesa_glthread_PrimitiveRestartIndex(struct gl_context *ctx,
+                                          GLuint index);
+void _mesa_glthread_PushClientAttrib(struct gl_context *ctx,
+                                     GLbitfield mask);
+void _mesa_glthread_PopClientAttrib(struct gl_context *ctx);
+
+void _mesa_glthread_refresh_shadow_state(struct gl_context *ctx);
+void _mesa_glthread_set_enable(struct gl_context *ctx, GLenum cap,
+                               bool enable);
+void _mesa_glthread_Enablei(struct gl_context *ctx, GLenum cap);
+void _mesa_glthread_ActiveTexture(struct gl_context *ctx, GLenum texture);
+void _mesa_glthread_MatrixMode(struct gl_context *ctx, GLenum mode);
+void _mesa_glthread_Viewport(struct gl_context *ctx, GLint x, GLint y,
+                             GLsizei width, GLsizei height);
+void _mesa_glthread_ViewportArray(struct gl_context *ctx);
+void _mesa_glthread_UseProgram(struct gl_context *ctx, GLuint program);
+void _mesa_glthread_PopAttrib(struct gl_context *ctx);
+
+void _mesa_glthread_upload_buffer_unref(struct glthread_upload_buffer *buf);
+
 #endif /* _GLTHREAD_H*/
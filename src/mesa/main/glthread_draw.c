@@ -0,0 +1,976 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** \file glthread_draw.c
+ *
+ * Draw calls that use user vertex arrays or user indices.
+ *
+ * The application may change user memory as soon as a draw call returns,
+ * so instead of synchronizing with the worker thread, the main thread
+ * copies the vertices and indices that the draw reads into an upload
+ * buffer.  The worker thread points the user arrays at the copies for the
+ * duration of the draw and then puts the application's pointers back, so
+ * the change is invisible to queries.
+ *
+ * Draws where the main thread can't tell which vertices are read, like
+ * user vertex arrays with indices in a buffer object, are executed
+ * synchronously.
+ */
+
+#include "main/glthread.h"
+#include "main/bufferobj.h"
+#include "main/dispatch.h"
+#include "main/marshal.h"
+#include "main/marshal_generated.h"
+#include "main/mtypes.h"
+#include "util/bitscan.h"
+#include "util/u_atomic.h"
+
+/** Size of one upload buffer.  Bigger draws get a buffer of their own. */
+#define GLTHREAD_UPLOAD_BUFFER_SIZE (1024 * 1024)
+
+/** Draws that would copy more than this are executed synchronously. */
+#define GLTHREAD_MAX_UPLOAD_SIZE (64 * 1024 * 1024)
+
+#define GLTHREAD_UPLOAD_ALIGNMENT 8
+
+/** A contiguous piece of user memory that one draw reads. */
+struct upload_range
+{
+   uintptr_t start;
+   uintptr_t end;
+};
+
+/** The user memory that one draw reads, by vertex array. */
+struct draw_uploads
+{
+   /** Arrays to copy (VERT_BIT_*). */
+   GLbitfield arrays;
+
+   /**
+    * Arrays that overlap, like interleaved ones, share a range, so that
+    * they are copied once and stay interleaved for the driver.
+    */
+   unsigned num_ranges;
+   struct upload_range ranges[VERT_ATTRIB_MAX];
+   uint8_t array_range[VERT_ATTRIB_MAX];
+   uintptr_t array_start[VERT_ATTRIB_MAX];
+
+   /** Total size of the copies. */
+   uint64_t size;
+};
+
+
+void
+_mesa_glthread_upload_buffer_unref(struct glthread_upload_buffer *buf)
+{
+   if (buf && p_atomic_dec_zero(&buf->RefCount))
+      free(buf);
+}
+
+
+/**
+ * Make room for \p size bytes of copies in one upload buffer and return it
+ * with a reference for the draw command.
+ */
+static struct glthread_upload_buffer *
+upload_begin(struct glthread_state *glthread, unsigned size)
+{
+   struct glthread_upload_buffer *buf = glthread->upload_buffer;
+
+   if (!buf || glthread->upload_offset + size > buf->Size) {
+      const unsigned buf_size = MAX2(size, GLTHREAD_UPLOAD_BUFFER_SIZE);
+      struct glthread_upload_buffer *new_buf =
+         malloc(sizeof(*new_buf) + buf_size);
+
+      if (!new_buf)
+         return NULL;
+
+      new_buf->RefCount = 1;
+      new_buf->Size = buf_size;
+
+      _mesa_glthread_upload_buffer_unref(buf);
+      glthread->upload_buffer = buf = new_buf;
+      glthread->upload_offset = 0;
+   }
+
+   p_atomic_inc(&buf->RefCount);
+   return buf;
+}
+
+
+static const uint8_t *
+upload(struct glthread_state *glthread, const void *data, size_t size)
+{
+   uint8_t *ptr = glthread->upload_buffer->Data + glthread->upload_offset;
+
+   memcpy(ptr, data, size);
+   glthread->upload_offset += ALIGN(size, GLTHREAD_UPLOAD_ALIGNMENT);
+   return ptr;
+}
+
+
+static unsigned
+get_index_size(GLenum type)
+{
+   switch (type) {
+   case GL_UNSIGNED_BYTE:
+      return 1;
+   case GL_UNSIGNED_SHORT:
+      return 2;
+   case GL_UNSIGNED_INT:
+      return 4;
+   default:
+      return 0;
+   }
+}
+
+
+/**
+ * Compute the smallest and largest index, skipping the restart index like
+ * vbo_get_minmax_index.  min > max if all indices are restarts.
+ */
+static void
+get_index_bounds(struct glthread_state *glthread, const void *indices,
+                 unsigned index_size, unsigned count,
+                 unsigned *min_index, unsigned *max_index)
+{
+   const bool restart = glthread->PrimitiveRestart ||
+                        glthread->PrimitiveRestartFixedIndex;
+   const unsigned restart_index = glthread->PrimitiveRestartFixedIndex ?
+      0xffffffffu >> 8 * (4 - index_size) : glthread->RestartIndex;
+   unsigned min = ~0u, max = 0;
+
+#define FIND_BOUNDS(type)                                       \
+   do {                                                         \
+      const type *typed = (const type *) indices;               \
+      for (unsigned i = 0; i < count; i++) {                    \
+         const unsigned index = typed[i];                       \
+         if (restart && index == restart_index)                 \
+            continue;                                           \
+         min = MIN2(min, index);                                \
+         max = MAX2(max, index);                                \
+      }                                                         \
+   } while (0)
+
+   switch (index_size) {
+   case 1:
+      FIND_BOUNDS(GLubyte);
+      break;
+   case 2:
+      FIND_BOUNDS(GLushort);
+      break;
+   default:
+      FIND_BOUNDS(GLuint);
+      break;
+   }
+
+#undef FIND_BOUNDS
+
+   *min_index = min;
+   *max_index = max;
+}
+
+
+/**
+ * Find out which user memory a draw reads from enabled user vertex arrays.
+ *
+ * \param min_index   first vertex read by arrays without a divisor
+ * \param max_index   last vertex read by arrays without a divisor
+ */
+static bool
+get_draw_uploads(const struct glthread_vao *vao, GLbitfield arrays,
+                 unsigned min_index, unsigned max_index,
+                 unsigned instance_count, unsigned baseinstance,
+                 struct draw_uploads *uploads)
+{
+   uploads->arrays = 0;
+   uploads->num_ranges = 0;
+   uploads->size = 0;
+
+   while (arrays) {
+      const unsigned i = u_bit_scan(&arrays);
+      const struct glthread_attrib *attrib = &vao->Attrib[i];
+      uint64_t first, last;
+      unsigned r;
+
+      /* Enabled but unused arrays are often left as NULL. */
+      if (!attrib->Pointer)
+         continue;
+
+      if (attrib->Divisor) {
+         first = baseinstance;
+         last = baseinstance + (instance_count - 1) / attrib->Divisor;
+      } else {
+         first = min_index;
+         last = max_index;
+      }
+
+      const uint64_t start_offset = first * attrib->Stride;
+      const uint64_t end_offset = last * attrib->Stride + attrib->ElementSize;
+      if (end_offset - start_offset > GLTHREAD_MAX_UPLOAD_SIZE)
+         return false;
+
+      const uintptr_t start = (uintptr_t) attrib->Pointer + start_offset;
+      const uintptr_t end = (uintptr_t) attrib->Pointer + end_offset;
+
+      for (r = 0; r < uploads->num_ranges; r++) {
+         struct upload_range *range = &uploads->ranges[r];
+
+         if (start <= range->end && end >= range->start) {
+            range->start = MIN2(range->start, start);
+            range->end = MAX2(range->end, end);
+            break;
+         }
+      }
+
+      if (r == uploads->num_ranges) {
+         uploads->ranges[r].start = start;
+         uploads->ranges[r].end = end;
+         uploads->num_ranges++;
+      }
+
+      uploads->array_start[i] = start;
+      uploads->arrays |= VERT_BIT(i);
+   }
+
+   /* Growing a range can make it overlap later ones, so merge those. */
+   for (unsigned r = 0; r < uploads->num_ranges; r++) {
+      struct upload_range *range = &uploads->ranges[r];
+
+      for (unsigned s = r + 1; s < uploads->num_ranges;) {
+         struct upload_range *other = &uploads->ranges[s];
+
+         if (other->start <= range->end && other->end >= range->start) {
+            range->start = MIN2(range->start, other->start);
+            range->end = MAX2(range->end, other->end);
+            *other = uploads->ranges[--uploads->num_ranges];
+            s = r + 1;
+         } else {
+            s++;
+         }
+      }
+   }
+
+   for (unsigned r = 0; r < uploads->num_ranges; r++) {
+      uploads->size += ALIGN(uploads->ranges[r].end - uploads->ranges[r].start,
+                             GLTHREAD_UPLOAD_ALIGNMENT);
+   }
+
+   GLbitfield mask = uploads->arrays;
+   while (mask) {
+      const unsigned i = u_bit_scan(&mask);
+
+      for (unsigned r = 0; r < uploads->num_ranges; r++) {
+         if (uploads->array_start[i] >= uploads->ranges[r].start &&
+             uploads->array_start[i] < uploads->ranges[r].end) {
+            uploads->array_range[i] = r;
+            break;
+         }
+      }
+   }
+
+   return uploads->size <= GLTHREAD_MAX_UPLOAD_SIZE;
+}
+
+
+/**
+ * Copy the ranges and return the pairs of application and uploaded pointers
+ * for the arrays in \p pointers.
+ */
+static void
+upload_arrays(struct glthread_state *glthread, const struct glthread_vao *vao,
+              const struct draw_uploads *uploads, const void **pointers)
+{
+   const uint8_t *copies[VERT_ATTRIB_MAX];
+
+   for (unsigned r = 0; r < uploads->num_ranges; r++) {
+      const struct upload_range *range = &uploads->ranges[r];
+
+      copies[r] = upload(glthread, (const void *) range->start,
+                         range->end - range->start);
+   }
+
+   GLbitfield mask = uploads->arrays;
+   while (mask) {
+      const unsigned i = u_bit_scan(&mask);
+      const unsigned r = uploads->array_range[i];
+
+      *pointers++ = vao->Attrib[i].Pointer;
+      *pointers++ = (const void *)
+         ((uintptr_t) copies[r] +
+          ((uintptr_t) vao->Attrib[i].Pointer - uploads->ranges[r].start));
+   }
+}
+
+
+/**
+ * Point the user arrays in \p mask at the other pointer of each pair from
+ * upload_arrays.  \p from selects whether the application's pointers (0) or
+ * the uploaded ones (1) are replaced.
+ *
+ * Arrays that don't have the expected pointer are left alone.  That only
+ * happens if the main thread got the state wrong, in which case drawing
+ * from the application's memory is the best we can do.
+ */
+static void
+replace_user_arrays(struct gl_context *ctx, GLbitfield mask,
+                    const void *const *pointers, unsigned from)
+{
+   struct gl_vertex_array_object *vao = ctx->Array.VAO;
+
+   while (mask) {
+      const gl_vert_attrib i = u_bit_scan(&mask);
+      const void *old_ptr = pointers[from];
+      const void *new_ptr = pointers[!from];
+      struct gl_array_attributes *array = &vao->VertexAttrib[i];
+      struct gl_vertex_buffer_binding *binding =
+         &vao->BufferBinding[array->BufferBindingIndex];
+
+      pointers += 2;
+
+      if (array->BufferBindingIndex != i ||
+          _mesa_is_bufferobj(binding->BufferObj) ||
+          array->RelativeOffset != 0 || array->Ptr != old_ptr)
+         continue;
+
+      array->Ptr = new_ptr;
+      binding->Offset = (GLintptr) new_ptr;
+      vao->NewArrays |= vao->Enabled & VERT_BIT(i);
+   }
+}
+
+
+struct marshal_cmd_DrawArrays
+{
+   struct marshal_cmd_base cmd_base;
+   GLenum mode;
+   GLint first;
+   GLsizei count;
+   GLsizei instance_count;
+   GLuint baseinstance;
+
+   /** User arrays that were copied to \c upload. */
+   GLbitfield user_arrays;
+   struct glthread_upload_buffer *upload;
+
+   /* Followed by the application's and the uploaded pointer for each bit
+    * in user_arrays.
+    */
+};
+
+
+struct marshal_cmd_DrawElements
+{
+   struct marshal_cmd_base cmd_base;
+   GLenum mode;
+   GLenum type;
+   GLsizei count;
+   GLsizei instance_count;
+   GLint basevertex;
+   GLuint baseinstance;
+   GLuint start;
+   GLuint end;
+   const GLvoid *indices;
+
+   /** User arrays that were copied to \c upload. */
+   GLbitfield user_arrays;
+   struct glthread_upload_buffer *upload;
+
+   /* Followed by the application's and the uploaded pointer for each bit
+    * in user_arrays.
+    */
+};
+
+
+/**
+ * Queue a glDrawArrays-like call, copying the user arrays it reads.
+ *
+ * \return false if the call has to be executed synchronously
+ */
+static bool
+marshal_draw_arrays(struct gl_context *ctx, uint16_t cmd_id, GLenum mode,
+                    GLint first, GLsizei count, GLsizei instance_count,
+                    GLuint baseinstance)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   const struct glthread_vao *vao = glthread->CurrentVAO;
+   GLbitfield user_arrays = vao->Enabled & vao->UserPointerMask;
+   struct glthread_upload_buffer *buf = NULL;
+   struct draw_uploads uploads;
+
+   if (user_arrays) {
+      /* Let the worker thread report the error. */
+      if (first < 0 || count < 0 || instance_count < 0)
+         return false;
+
+      if (count == 0 || instance_count == 0) {
+         user_arrays = 0;
+      } else {
+         if (!get_draw_uploads(vao, user_arrays, first, first + count - 1,
+                               instance_count, baseinstance, &uploads))
+            return false;
+
+         user_arrays = uploads.arrays;
+         if (user_arrays) {
+            buf = upload_begin(glthread, uploads.size);
+            if (!buf)
+               return false;
+         }
+      }
+   }
+
+   const unsigned num_pointers = 2 * util_bitcount(user_arrays);
+   struct marshal_cmd_DrawArrays *cmd =
+      _mesa_glthread_allocate_command(ctx, cmd_id,
+                                      sizeof(*cmd) +
+                                      num_pointers * sizeof(void *));
+   cmd->mode = mode;
+   cmd->first = first;
+   cmd->count = count;
+   cmd->instance_count = instance_count;
+   cmd->baseinstance = baseinstance;
+   cmd->user_arrays = user_arrays;
+   cmd->upload = buf;
+
+   if (user_arrays)
+      upload_arrays(glthread, vao, &uploads, (const void **) (cmd + 1));
+
+   _mesa_post_marshal_hook(ctx);
+   return true;
+}
+
+
+/**
+ * Queue a glDrawElements-like call, copying the user indices and the parts
+ * of the user arrays that it reads.
+ *
+ * \param index_bounds_valid  whether start and end come from the application
+ * \return false if the call has to be executed synchronously
+ */
+static bool
+marshal_draw_elements(struct gl_context *ctx, uint16_t cmd_id, GLenum mode,
+                      GLsizei count, GLenum type, const GLvoid *indices,
+                      GLsizei instance_count, GLint basevertex,
+                      GLuint baseinstance, bool index_bounds_valid,
+                      GLuint start, GLuint end)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   const struct glthread_vao *vao = glthread->CurrentVAO;
+   GLbitfield user_arrays = vao->Enabled & vao->UserPointerMask;
+   const bool user_indices = ctx->API != API_OPENGL_CORE &&
+                             !vao->CurrentElementBufferName;
+   const unsigned index_size = get_index_size(type);
+   struct glthread_upload_buffer *buf = NULL;
+   struct draw_uploads uploads;
+   uint64_t upload_size = 0;
+   bool copy_indices = false;
+
+   if (user_arrays || user_indices) {
+      /* Let the worker thread report the error. */
+      if (count < 0 || instance_count < 0 || !index_size ||
+          (index_bounds_valid && end < start))
+         return false;
+
+      copy_indices = user_indices && count > 0 && instance_count > 0 &&
+                     indices;
+   }
+
+   if (user_arrays && count > 0 && instance_count > 0) {
+      unsigned min_index = start, max_index = end;
+
+      if (!index_bounds_valid) {
+         /* The indices in a buffer object can't be read here. */
+         if (!user_indices)
+            return false;
+
+         get_index_bounds(glthread, indices, index_size, count,
+                          &min_index, &max_index);
+      }
+
+      if (min_index > max_index) {
+         /* Only restart indices, no vertex is read. */
+         user_arrays = 0;
+      } else {
+         const int64_t min_vertex = (int64_t) min_index + basevertex;
+         const int64_t max_vertex = (int64_t) max_index + basevertex;
+
+         if (min_vertex < 0 || max_vertex > UINT32_MAX ||
+             !get_draw_uploads(vao, user_arrays, min_vertex, max_vertex,
+                               instance_count, baseinstance, &uploads))
+            return false;
+
+         user_arrays = uploads.arrays;
+         upload_size = uploads.size;
+      }
+   } else {
+      user_arrays = 0;
+   }
+
+   if (copy_indices) {
+      upload_size += ALIGN((uint64_t) count * index_size,
+                           GLTHREAD_UPLOAD_ALIGNMENT);
+   }
+
+   if (upload_size) {
+      if (upload_size > GLTHREAD_MAX_UPLOAD_SIZE)
+         return false;
+
+      buf = upload_begin(glthread, upload_size);
+      if (!buf)
+         return false;
+   }
+
+   const unsigned num_pointers = 2 * util_bitcount(user_arrays);
+   struct marshal_cmd_DrawElements *cmd =
+      _mesa_glthread_allocate_command(ctx, cmd_id,
+                                      sizeof(*cmd) +
+                                      num_pointers * sizeof(void *));
+   cmd->mode = mode;
+   cmd->type = type;
+   cmd->count = count;
+   cmd->instance_count = instance_count;
+   cmd->basevertex = basevertex;
+   cmd->baseinstance = baseinstance;
+   cmd->start = start;
+   cmd->end = end;
+   cmd->user_arrays = user_arrays;
+   cmd->upload = buf;
+
+   if (copy_indices)
+      cmd->indices = upload(glthread, indices, count * index_size);
+   else
+      cmd->indices = indices;
+
+   if (user_arrays)
+      upload_arrays(glthread, vao, &uploads, (const void **) (cmd + 1));
+
+   _mesa_post_marshal_hook(ctx);
+   return true;
+}
+
+
+static void
+unmarshal_draw_begin(struct gl_context *ctx, GLbitfield user_arrays,
+                     const void *const *pointers)
+{
+   if (user_arrays)
+      replace_user_arrays(ctx, user_arrays, pointers, 0);
+}
+
+
+static void
+unmarshal_draw_end(struct gl_context *ctx, GLbitfield user_arrays,
+                   const void *const *pointers,
+                   struct glthread_upload_buffer *upload)
+{
+   if (user_arrays)
+      replace_user_arrays(ctx, user_arrays, pointers, 1);
+
+   _mesa_glthread_upload_buffer_unref(upload);
+}
+
+
+void
+_mesa_unmarshal_DrawArrays(struct gl_context *ctx,
+                           const struct marshal_cmd_DrawArrays *cmd)
+{
+   const void *const *pointers = (const void *const *) (cmd + 1);
+
+   unmarshal_draw_begin(ctx, cmd->user_arrays, pointers);
+   CALL_DrawArrays(ctx->CurrentServerDispatch,
+                   (cmd->mode, cmd->first, cmd->count));
+   unmarshal_draw_end(ctx, cmd->user_arrays, pointers, cmd->upload);
+}
+
+
+void GLAPIENTRY
+_mesa_marshal_DrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   debug_print_marshal("DrawArrays");
+
+   if (marshal_draw_arrays(ctx, DISPATCH_CMD_DrawArrays, mode, first, count,
+                           1, 0))
+      return;
+
+   _mesa_glthread_finish(ctx);
+   debug_print_sync_fallback(ctx, "DrawArrays");
+   CALL_DrawArrays(ctx->CurrentServerDispatch, (mode, first, count));
+}
+
+
+void
+_mesa_unmarshal_DrawArraysInstancedARB(struct gl_context *ctx,
+                                       const struct marshal_cmd_DrawArrays *cmd)
+{
+   const void *const *pointers = (const void *const *) (cmd + 1);
+
+   unmarshal_draw_begin(ctx, cmd->user_arrays, pointers);
+   CALL_DrawArraysInstancedARB(ctx->CurrentServerDispatch,
+                               (cmd->mode, cmd->first, cmd->count,
+                                cmd->instance_count));
+   unmarshal_draw_end(ctx, cmd->user_arrays, pointers, cmd->upload);
+}
+
+
+void GLAPIENTRY
+_mesa_marshal_DrawArraysInstancedARB(GLenum mode, GLint first, GLsizei count,
+                                     GLsizei primcount)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   debug_print_marshal("DrawArraysInstancedARB");
+
+   if (marshal_draw_arrays(ctx, DISPATCH_CMD_DrawArraysInstancedARB, mode,
+                           first, count, primcount, 0))
+      return;
+
+   _mesa_glthread_finish(ctx);
+   debug_print_sync_fallback(ctx, "DrawArraysInstancedARB");
+   CALL_DrawArraysInstancedARB(ctx->CurrentServerDispatch,
+                               (mode, first, count, primcount));
+}
+
+
+void
+_mesa_unmarshal_DrawArraysInstancedBaseInstance(struct gl_context *ctx,
+                                                const struct marshal_cmd_DrawArrays *cmd)
+{
+   const void *const *pointers = (const void *const *) (cmd + 1);
+
+   unmarshal_draw_begin(ctx, cmd->user_arrays, pointers);
+   CALL_DrawArraysInstancedBaseInstance(ctx->CurrentServerDispatch,
+                                        (cmd->mode, cmd->first, cmd->count,
+                                         cmd->instance_count,
+                                         cmd->baseinstance));
+   unmarshal_draw_end(ctx, cmd->user_arrays, pointers, cmd->upload);
+}
+
+
+void GLAPIENTRY
+_mesa_marshal_DrawArraysInstancedBaseInstance(GLenum mode, GLint first,
+                                              GLsizei count, GLsizei primcount,
+                                              GLuint baseinstance)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   debug_print_marshal("DrawArraysInstancedBaseInstance");
+
+   if (marshal_draw_arrays(ctx, DISPATCH_CMD_DrawArraysInstancedBaseInstance,
+                           mode, first, count, primcount, baseinstance))
+      return;
+
+   _mesa_glthread_finish(ctx);
+   debug_print_sync_fallback(ctx, "DrawArraysInstancedBaseInstance");
+   CALL_DrawArraysInstancedBaseInstance(ctx->CurrentServerDispatch,
+                                        (mode, first, count, primcount,
+                                         baseinstance));
+}
+
+
+void
+_mesa_unmarshal_DrawElements(struct gl_context *ctx,
+                             const struct marshal_cmd_DrawElements *cmd)
+{
+   const void *const *pointers = (const void *const *) (cmd + 1);
+
+   unmarshal_draw_begin(ctx, cmd->user_arrays, pointers);
+   CALL_DrawElements(ctx->CurrentServerDispatch,
+                     (cmd->mode, cmd->count, cmd->type, cmd->indices));
+   unmarshal_draw_end(ctx, cmd->user_arrays, pointers, cmd->upload);
+}
+
+
+void GLAPIENTRY
+_mesa_marshal_DrawElements(GLenum mode, GLsizei count, GLenum type,
+                           const GLvoid *indices)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   debug_print_marshal("DrawElements");
+
+   if (marshal_draw_elements(ctx, DISPATCH_CMD_DrawElements, mode, count,
+                             type, indices, 1, 0, 0, false, 0, 0))
+      return;
+
+   _mesa_glthread_finish(ctx);
+   debug_print_sync_fallback(ctx, "DrawElements");
+   CALL_DrawElements(ctx->CurrentServerDispatch,
+                     (mode, count, type, indices));
+}
+
+
+void
+_mesa_unmarshal_DrawRangeElements(struct gl_context *ctx,
+                                  const struct marshal_cmd_DrawElements *cmd)
+{
+   const void *const *pointers = (const void *const *) (cmd + 1);
+
+   unmarshal_draw_begin(ctx, cmd->user_arrays, pointers);
+   CALL_DrawRangeElements(ctx->CurrentServerDispatch,
+                          (cmd->mode, cmd->start, cmd->end, cmd->count,
+                           cmd->type, cmd->indices));
+   unmarshal_draw_end(ctx, cmd->user_arrays, pointers, cmd->upload);
+}
+
+
+void GLAPIENTRY
+_mesa_marshal_DrawRangeElements(GLenum mode, GLuint start, GLuint end,
+                                GLsizei count, GLenum type,
+                                const GLvoid *indices)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   debug_print_marshal("DrawRangeElements");
+
+   if (marshal_draw_elements(ctx, DISPATCH_CMD_DrawRangeElements, mode, count,
+                             type, indices, 1, 0, 0, true, start, end))
+      return;
+
+   _mesa_glthread_finish(ctx);
+   debug_print_sync_fallback(ctx, "DrawRangeElements");
+   CALL_DrawRangeElements(ctx->CurrentServerDispatch,
+                          (mode, start, end, count, type, indices));
+}
+
+
+void
+_mesa_unmarshal_DrawElementsBaseVertex(struct gl_context *ctx,
+                                       const struct marshal_cmd_DrawElements *cmd)
+{
+   const void *const *pointers = (const void *const *) (cmd + 1);
+
+   unmarshal_draw_begin(ctx, cmd->user_arrays, pointers);
+   CALL_DrawElementsBaseVertex(ctx->CurrentServerDispatch,
+                               (cmd->mode, cmd->count, cmd->type,
+                                cmd->indices, cmd->basevertex));
+   unmarshal_draw_end(ctx, cmd->user_arrays, pointers, cmd->upload);
+}
+
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type,
+                                     const GLvoid *indices, GLint basevertex)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   debug_print_marshal("DrawElementsBaseVertex");
+
+   if (marshal_draw_elements(ctx, DISPATCH_CMD_DrawElementsBaseVertex, mode,
+                             count, type, indices, 1, basevertex, 0, false,
+                             0, 0))
+      return;
+
+   _mesa_glthread_finish(ctx);
+   debug_print_sync_fallback(ctx, "DrawElementsBaseVertex");
+   CALL_DrawElementsBaseVertex(ctx->CurrentServerDispatch,
+                               (mode, count, type, indices, basevertex));
+}
+
+
+void
+_mesa_unmarshal_DrawRangeElementsBaseVertex(struct gl_context *ctx,
+                                            const struct marshal_cmd_DrawElements *cmd)
+{
+   const void *const *pointers = (const void *const *) (cmd + 1);
+
+   unmarshal_draw_begin(ctx, cmd->user_arrays, pointers);
+   CALL_DrawRangeElementsBaseVertex(ctx->CurrentServerDispatch,
+                                    (cmd->mode, cmd->start, cmd->end,
+                                     cmd->count, cmd->type, cmd->indices,
+                                     cmd->basevertex));
+   unmarshal_draw_end(ctx, cmd->user_arrays, pointers, cmd->upload);
+}
+
+
+void GLAPIENTRY
+_mesa_marshal_DrawRangeElementsBaseVertex(GLenum mode, GLuint start,
+                                          GLuint end, GLsizei count,
+                                          GLenum type, const GLvoid *indices,
+                                          GLint basevertex)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   debug_print_marshal("DrawRangeElementsBaseVertex");
+
+   if (marshal_draw_elements(ctx, DISPATCH_CMD_DrawRangeElementsBaseVertex,
+                             mode, count, type, indices, 1, basevertex, 0,
+                             true, start, end))
+      return;
+
+   _mesa_glthread_finish(ctx);
+   debug_print_sync_fallback(ctx, "DrawRangeElementsBaseVertex");
+   CALL_DrawRangeElementsBaseVertex(ctx->CurrentServerDispatch,
+                                    (mode, start, end, count, type, indices,
+                                     basevertex));
+}
+
+
+void
+_mesa_unmarshal_DrawElementsInstancedARB(struct gl_context *ctx,
+                                         const struct marshal_cmd_DrawElements *cmd)
+{
+   const void *const *pointers = (const void *const *) (cmd + 1);
+
+   unmarshal_draw_begin(ctx, cmd->user_arrays, pointers);
+   CALL_DrawElementsInstancedARB(ctx->CurrentServerDispatch,
+                                 (cmd->mode, cmd->count, cmd->type,
+                                  cmd->indices, cmd->instance_count));
+   unmarshal_draw_end(ctx, cmd->user_arrays, pointers, cmd->upload);
+}
+
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsInstancedARB(GLenum mode, GLsizei count,
+                                       GLenum type, const GLvoid *indices,
+                                       GLsizei primcount)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   debug_print_marshal("DrawElementsInstancedARB");
+
+   if (marshal_draw_elements(ctx, DISPATCH_CMD_DrawElementsInstancedARB, mode,
+                             count, type, indices, primcount, 0, 0, false,
+                             0, 0))
+      return;
+
+   _mesa_glthread_finish(ctx);
+   debug_print_sync_fallback(ctx, "DrawElementsInstancedARB");
+   CALL_DrawElementsInstancedARB(ctx->CurrentServerDispatch,
+                                 (mode, count, type, indices, primcount));
+}
+
+
+void
+_mesa_unmarshal_DrawElementsInstancedBaseVertex(struct gl_context *ctx,
+                                                const struct marshal_cmd_DrawElements *cmd)
+{
+   const void *const *pointers = (const void *const *) (cmd + 1);
+
+   unmarshal_draw_begin(ctx, cmd->user_arrays, pointers);
+   CALL_DrawElementsInstancedBaseVertex(ctx->CurrentServerDispatch,
+                                        (cmd->mode, cmd->count, cmd->type,
+                                         cmd->indices, cmd->instance_count,
+                                         cmd->basevertex));
+   unmarshal_draw_end(ctx, cmd->user_arrays, pointers, cmd->upload);
+}
+
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsInstancedBaseVertex(GLenum mode, GLsizei count,
+                                              GLenum type,
+                                              const GLvoid *indices,
+                                              GLsizei primcount,
+                                              GLint basevertex)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   debug_print_marshal("DrawElementsInstancedBaseVertex");
+
+   if (marshal_draw_elements(ctx, DISPATCH_CMD_DrawElementsInstancedBaseVertex,
+                             mode, count, type, indices, primcount, basevertex,
+                             0, false, 0, 0))
+      return;
+
+   _mesa_glthread_finish(ctx);
+   debug_print_sync_fallback(ctx, "DrawElementsInstancedBaseVertex");
+   CALL_DrawElementsInstancedBaseVertex(ctx->CurrentServerDispatch,
+                                        (mode, count, type, indices,
+                                         primcount, basevertex));
+}
+
+
+void
+_mesa_unmarshal_DrawElementsInstancedBaseInstance(struct gl_context *ctx,
+                                                  const struct marshal_cmd_DrawElements *cmd)
+{
+   const void *const *pointers = (const void *const *) (cmd + 1);
+
+   unmarshal_draw_begin(ctx, cmd->user_arrays, pointers);
+   CALL_DrawElementsInstancedBaseInstance(ctx->CurrentServerDispatch,
+                                          (cmd->mode, cmd->count, cmd->type,
+                                           cmd->indices, cmd->instance_count,
+                                           cmd->baseinstance));
+   unmarshal_draw_end(ctx, cmd->user_arrays, pointers, cmd->upload);
+}
+
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsInstancedBaseInstance(GLenum mode, GLsizei count,
+                                                GLenum type,
+                                                const GLvoid *indices,
+                                                GLsizei primcount,
+                                                GLuint baseinstance)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   debug_print_marshal("DrawElementsInstancedBaseInstance");
+
+   if (marshal_draw_elements(ctx,
+                             DISPATCH_CMD_DrawElementsInstancedBaseInstance,
+                             mode, count, type, indices, primcount, 0,
+                             baseinstance, false, 0, 0))
+      return;
+
+   _mesa_glthread_finish(ctx);
+   debug_print_sync_fallback(ctx, "DrawElementsInstancedBaseInstance");
+   CALL_DrawElementsInstancedBaseInstance(ctx->CurrentServerDispatch,
+                                          (mode, count, type, indices,
+                                           primcount, baseinstance));
+}
+
+
+void
+_mesa_unmarshal_DrawElementsInstancedBaseVertexBaseInstance(struct gl_context *ctx,
+                                                            const struct marshal_cmd_DrawElements *cmd)
+{
+   const void *const *pointers = (const void *const *) (cmd + 1);
+
+   unmarshal_draw_begin(ctx, cmd->user_arrays, pointers);
+   CALL_DrawElementsInstancedBaseVertexBaseInstance(ctx->CurrentServerDispatch,
+                                                    (cmd->mode, cmd->count,
+                                                     cmd->type, cmd->indices,
+                                                     cmd->instance_count,
+                                                     cmd->basevertex,
+                                                     cmd->baseinstance));
+   unmarshal_draw_end(ctx, cmd->user_arrays, pointers, cmd->upload);
+}
+
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsInstancedBaseVertexBaseInstance(GLenum mode,
+                                                          GLsizei count,
+                                                          GLenum type,
+                                                          const GLvoid *indices,
+                                                          GLsizei primcount,
+                                                          GLint basevertex,
+                                                          GLuint baseinstance)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   debug_print_marshal("DrawElementsInstancedBaseVertexBaseInstance");
+
+   if (marshal_draw_elements(ctx,
+                             DISPATCH_CMD_DrawElementsInstancedBaseVertexBaseInstance,
+                             mode, count, type, indices, primcount, basevertex,
+                             baseinstance, false, 0, 0))
+      return;
+
+   _mesa_glthread_finish(ctx);
+   debug_print_sync_fallback(ctx, "DrawElementsInstancedBaseVertexBaseInstance");
+   CALL_DrawElementsInstancedBaseVertexBaseInstance(ctx->CurrentServerDispatch,
+                                                    (mode, count, type, indices,
+                                                     primcount, basevertex,
+                                                     baseinstance));
+}
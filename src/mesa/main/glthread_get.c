@@ -0,0 +1,442 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** \file glthread_get.c
+ *
+ * State queries answered on the main thread.
+ *
+ * glGet* and glIsEnabled have to wait for the worker thread to execute all
+ * queued commands, which is expensive when applications or middleware query
+ * state every frame.  The main thread keeps a shadow copy of the state that
+ * is queried most often and updates it as commands are queued, so that
+ * those queries don't need to synchronize.
+ *
+ * State that is changed in a way the main thread can't cheaply follow is
+ * marked unknown.  The next query then synchronizes and reloads the whole
+ * shadow copy from the context, which is safe because the worker thread is
+ * idle at that point.
+ */
+
+#include "main/glthread.h"
+#include "main/context.h"
+#include "main/dispatch.h"
+#include "main/extensions.h"
+#include "main/imports.h"
+#include "main/marshal.h"
+#include "main/mtypes.h"
+#include "main/texstate.h"
+
+
+/** Bits of glthread_state::ShadowValid and ShadowEnabled. */
+enum glthread_shadow {
+   /* Capabilities that are valid for glEnable in all APIs. */
+   SHADOW_BLEND,
+   SHADOW_CULL_FACE,
+   SHADOW_DEPTH_TEST,
+   SHADOW_DITHER,
+   SHADOW_POLYGON_OFFSET_FILL,
+   SHADOW_SCISSOR_TEST,
+   SHADOW_STENCIL_TEST,
+
+   SHADOW_ACTIVE_TEXTURE,
+   SHADOW_MATRIX_MODE,
+   SHADOW_CURRENT_PROGRAM,
+   SHADOW_VIEWPORT,
+   SHADOW_COUNT,
+};
+
+/** A shadowed value, converted the same way as in get.c. */
+struct shadow_value {
+   bool is_float;
+   unsigned count;
+   GLint i[4];
+   GLfloat f[4];
+};
+
+
+static int
+shadow_enable_bit(GLenum cap)
+{
+   switch (cap) {
+   case GL_BLEND:
+      return SHADOW_BLEND;
+   case GL_CULL_FACE:
+      return SHADOW_CULL_FACE;
+   case GL_DEPTH_TEST:
+      return SHADOW_DEPTH_TEST;
+   case GL_DITHER:
+      return SHADOW_DITHER;
+   case GL_POLYGON_OFFSET_FILL:
+      return SHADOW_POLYGON_OFFSET_FILL;
+   case GL_SCISSOR_TEST:
+      return SHADOW_SCISSOR_TEST;
+   case GL_STENCIL_TEST:
+      return SHADOW_STENCIL_TEST;
+   default:
+      return -1;
+   }
+}
+
+
+static inline bool
+shadow_is_valid(const struct glthread_state *glthread, enum glthread_shadow bit)
+{
+   return glthread->ShadowValid & BITFIELD_BIT(bit);
+}
+
+
+/**
+ * Reload the shadow state from the context.  This must only be called while
+ * the worker thread is idle.
+ */
+void
+_mesa_glthread_refresh_shadow_state(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   GLbitfield enabled = 0;
+
+   if (ctx->Color.BlendEnabled & 1)
+      enabled |= BITFIELD_BIT(SHADOW_BLEND);
+   if (ctx->Polygon.CullFlag)
+      enabled |= BITFIELD_BIT(SHADOW_CULL_FACE);
+   if (ctx->Depth.Test)
+      enabled |= BITFIELD_BIT(SHADOW_DEPTH_TEST);
+   if (ctx->Color.DitherFlag)
+      enabled |= BITFIELD_BIT(SHADOW_DITHER);
+   if (ctx->Polygon.OffsetFill)
+      enabled |= BITFIELD_BIT(SHADOW_POLYGON_OFFSET_FILL);
+   if (ctx->Scissor.EnableFlags & 1)
+      enabled |= BITFIELD_BIT(SHADOW_SCISSOR_TEST);
+   if (ctx->Stencil.Enabled)
+      enabled |= BITFIELD_BIT(SHADOW_STENCIL_TEST);
+
+   glthread->ShadowEnabled = enabled;
+   glthread->ActiveTexture = ctx->Texture.CurrentUnit;
+   glthread->MatrixMode = ctx->Transform.MatrixMode;
+   glthread->CurrentProgram =
+      ctx->Shader.ActiveProgram ? ctx->Shader.ActiveProgram->Name : 0;
+   glthread->Viewport[0] = ctx->ViewportArray[0].X;
+   glthread->Viewport[1] = ctx->ViewportArray[0].Y;
+   glthread->Viewport[2] = ctx->ViewportArray[0].Width;
+   glthread->Viewport[3] = ctx->ViewportArray[0].Height;
+
+   glthread->ShadowValid = BITFIELD_MASK(SHADOW_COUNT);
+
+   /* The first MakeCurrent sets the viewport to the size of the drawable,
+    * overriding whatever was set before.
+    */
+   if (!ctx->ViewportInitialized)
+      glthread->ShadowValid &= ~BITFIELD_BIT(SHADOW_VIEWPORT);
+}
+
+
+void
+_mesa_glthread_set_enable(struct gl_context *ctx, GLenum cap, bool enable)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   int bit;
+
+   switch (cap) {
+   case GL_PRIMITIVE_RESTART:
+      glthread->PrimitiveRestart = enable;
+      break;
+   case GL_PRIMITIVE_RESTART_FIXED_INDEX:
+      glthread->PrimitiveRestartFixedIndex = enable;
+      break;
+   default:
+      bit = shadow_enable_bit(cap);
+      if (bit < 0)
+         break;
+
+      if (enable)
+         glthread->ShadowEnabled |= BITFIELD_BIT(bit);
+      else
+         glthread->ShadowEnabled &= ~BITFIELD_BIT(bit);
+      glthread->ShadowValid |= BITFIELD_BIT(bit);
+      break;
+   }
+}
+
+
+/**
+ * glEnablei and glDisablei.  glIsEnabled returns the state of index 0, but
+ * whether the index is valid isn't known here.
+ */
+void
+_mesa_glthread_Enablei(struct gl_context *ctx, GLenum cap)
+{
+   int bit = shadow_enable_bit(cap);
+
+   if (bit >= 0)
+      ctx->GLThread->ShadowValid &= ~BITFIELD_BIT(bit);
+}
+
+
+void
+_mesa_glthread_ActiveTexture(struct gl_context *ctx, GLenum texture)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   GLuint unit = texture - GL_TEXTURE0;
+
+   if (unit < _mesa_max_tex_unit(ctx)) {
+      glthread->ActiveTexture = unit;
+      glthread->ShadowValid |= BITFIELD_BIT(SHADOW_ACTIVE_TEXTURE);
+   }
+}
+
+
+void
+_mesa_glthread_MatrixMode(struct gl_context *ctx, GLenum mode)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (ctx->API != API_OPENGL_COMPAT && ctx->API != API_OPENGLES)
+      return;
+
+   switch (mode) {
+   case GL_MODELVIEW:
+   case GL_PROJECTION:
+   case GL_TEXTURE:
+      glthread->MatrixMode = mode;
+      glthread->ShadowValid |= BITFIELD_BIT(SHADOW_MATRIX_MODE);
+      break;
+   default:
+      glthread->ShadowValid &= ~BITFIELD_BIT(SHADOW_MATRIX_MODE);
+      break;
+   }
+}
+
+
+void
+_mesa_glthread_Viewport(struct gl_context *ctx, GLint x, GLint y,
+                        GLsizei width, GLsizei height)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   GLfloat *v = glthread->Viewport;
+
+   /* ViewportInitialized is only set by MakeCurrent on this thread. */
+   if (width < 0 || height < 0 || !ctx->ViewportInitialized)
+      return;
+
+   /* Clamp like clamp_viewport() does. */
+   v[0] = x;
+   v[1] = y;
+   v[2] = MIN2((GLfloat) width, (GLfloat) ctx->Const.MaxViewportWidth);
+   v[3] = MIN2((GLfloat) height, (GLfloat) ctx->Const.MaxViewportHeight);
+
+   if (_mesa_has_ARB_viewport_array(ctx) ||
+       _mesa_has_OES_viewport_array(ctx)) {
+      v[0] = CLAMP(v[0], ctx->Const.ViewportBounds.Min,
+                   ctx->Const.ViewportBounds.Max);
+      v[1] = CLAMP(v[1], ctx->Const.ViewportBounds.Min,
+                   ctx->Const.ViewportBounds.Max);
+   }
+
+   glthread->ShadowValid |= BITFIELD_BIT(SHADOW_VIEWPORT);
+}
+
+
+/** glViewportArrayv and glViewportIndexedf*. */
+void
+_mesa_glthread_ViewportArray(struct gl_context *ctx)
+{
+   ctx->GLThread->ShadowValid &= ~BITFIELD_BIT(SHADOW_VIEWPORT);
+}
+
+
+void
+_mesa_glthread_UseProgram(struct gl_context *ctx, GLuint program)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (ctx->API == API_OPENGLES)
+      return;
+
+   glthread->CurrentProgram = program;
+   glthread->ShadowValid |= BITFIELD_BIT(SHADOW_CURRENT_PROGRAM);
+}
+
+
+void
+_mesa_glthread_PopAttrib(struct gl_context *ctx)
+{
+   ctx->GLThread->ShadowValid = 0;
+}
+
+
+static bool
+get_shadow_value(struct gl_context *ctx, GLenum pname,
+                 struct shadow_value *value)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   int bit = shadow_enable_bit(pname);
+
+   value->is_float = false;
+   value->count = 1;
+
+   if (bit >= 0) {
+      if (!shadow_is_valid(glthread, bit))
+         return false;
+      value->i[0] = !!(glthread->ShadowEnabled & BITFIELD_BIT(bit));
+      return true;
+   }
+
+   switch (pname) {
+   case GL_ACTIVE_TEXTURE:
+      if (!shadow_is_valid(glthread, SHADOW_ACTIVE_TEXTURE))
+         return false;
+      value->i[0] = GL_TEXTURE0 + glthread->ActiveTexture;
+      return true;
+
+   case GL_CLIENT_ACTIVE_TEXTURE:
+      if (ctx->API == API_OPENGLES2)
+         return false;
+      value->i[0] = GL_TEXTURE0 + glthread->ClientActiveTexture;
+      return true;
+
+   case GL_MATRIX_MODE:
+      if (ctx->API == API_OPENGLES2 ||
+          !shadow_is_valid(glthread, SHADOW_MATRIX_MODE))
+         return false;
+      value->i[0] = glthread->MatrixMode;
+      return true;
+
+   case GL_CURRENT_PROGRAM:
+      if (ctx->API == API_OPENGLES ||
+          !shadow_is_valid(glthread, SHADOW_CURRENT_PROGRAM))
+         return false;
+      value->i[0] = glthread->CurrentProgram;
+      return true;
+
+   case GL_VIEWPORT:
+      if (!shadow_is_valid(glthread, SHADOW_VIEWPORT))
+         return false;
+      value->is_float = true;
+      value->count = 4;
+      memcpy(value->f, glthread->Viewport, sizeof(glthread->Viewport));
+      return true;
+
+   case GL_ARRAY_BUFFER_BINDING:
+      value->i[0] = glthread->CurrentArrayBufferName;
+      return true;
+
+   case GL_ELEMENT_ARRAY_BUFFER_BINDING:
+      value->i[0] = glthread->CurrentVAO->CurrentElementBufferName;
+      return true;
+
+   case GL_VERTEX_ARRAY_BINDING:
+      value->i[0] = glthread->CurrentVAO->Name;
+      return true;
+
+   default:
+      return false;
+   }
+}
+
+
+void GLAPIENTRY
+_mesa_marshal_GetBooleanv(GLenum pname, GLboolean *params)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   struct shadow_value value;
+
+   debug_print_marshal("GetBooleanv");
+
+   if (get_shadow_value(ctx, pname, &value)) {
+      for (unsigned i = 0; i < value.count; i++) {
+         if (value.is_float)
+            params[i] = value.f[i] ? GL_TRUE : GL_FALSE;
+         else
+            params[i] = value.i[i] ? GL_TRUE : GL_FALSE;
+      }
+      return;
+   }
+
+   _mesa_glthread_finish(ctx);
+   debug_print_sync(ctx, "GetBooleanv");
+   CALL_GetBooleanv(ctx->CurrentServerDispatch, (pname, params));
+   _mesa_glthread_refresh_shadow_state(ctx);
+}
+
+
+void GLAPIENTRY
+_mesa_marshal_GetFloatv(GLenum pname, GLfloat *params)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   struct shadow_value value;
+
+   debug_print_marshal("GetFloatv");
+
+   if (get_shadow_value(ctx, pname, &value)) {
+      for (unsigned i = 0; i < value.count; i++)
+         params[i] = value.is_float ? value.f[i] : (GLfloat) value.i[i];
+      return;
+   }
+
+   _mesa_glthread_finish(ctx);
+   debug_print_sync(ctx, "GetFloatv");
+   CALL_GetFloatv(ctx->CurrentServerDispatch, (pname, params));
+   _mesa_glthread_refresh_shadow_state(ctx);
+}
+
+
+void GLAPIENTRY
+_mesa_marshal_GetIntegerv(GLenum pname, GLint *params)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   struct shadow_value value;
+
+   debug_print_marshal("GetIntegerv");
+
+   if (get_shadow_value(ctx, pname, &value)) {
+      for (unsigned i = 0; i < value.count; i++)
+         params[i] = value.is_float ? IROUND(value.f[i]) : value.i[i];
+      return;
+   }
+
+   _mesa_glthread_finish(ctx);
+   debug_print_sync(ctx, "GetIntegerv");
+   CALL_GetIntegerv(ctx->CurrentServerDispatch, (pname, params));
+   _mesa_glthread_refresh_shadow_state(ctx);
+}
+
+
+GLboolean GLAPIENTRY
+_mesa_marshal_IsEnabled(GLenum cap)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   struct glthread_state *glthread = ctx->GLThread;
+   int bit = shadow_enable_bit(cap);
+   GLboolean result;
+
+   debug_print_marshal("IsEnabled");
+
+   if (bit >= 0 && shadow_is_valid(glthread, bit))
+      return !!(glthread->ShadowEnabled & BITFIELD_BIT(bit));
+
+   _mesa_glthread_finish(ctx);
+   debug_print_sync(ctx, "IsEnabled");
+   result = CALL_IsEnabled(ctx->CurrentServerDispatch, (cap));
+   _mesa_glthread_refresh_shadow_state(ctx);
+   return result;
+}
@@ -0,0 +1,455 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** \file glthread_varray.c
+ *
+ * Vertex array state tracking on the main thread.
+ *
+ * The main thread keeps a shadow copy of the vertex array state that
+ * decides whether a draw reads user memory: which arrays are enabled, which
+ * of them are user pointers and how far apart their elements are, and
+ * whether an index buffer is bound.  This lets draws copy the user data
+ * they need before returning to the application instead of synchronizing
+ * with the worker thread.
+ *
+ * Invalid calls are ignored here as far as cheaply possible, because the
+ * worker thread will report the error without changing any state.
+ */
+
+#include "main/glthread.h"
+#include "main/glformats.h"
+#include "main/hash.h"
+#include "main/mtypes.h"
+
+
+static struct glthread_vao *
+lookup_vao(struct gl_context *ctx, GLuint id)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   struct glthread_vao *vao;
+
+   if (id == 0)
+      return NULL;
+
+   if (glthread->LastLookedUpVAO &&
+       glthread->LastLookedUpVAO->Name == id)
+      return glthread->LastLookedUpVAO;
+
+   vao = _mesa_HashLookup(glthread->VAOs, id);
+   if (vao)
+      glthread->LastLookedUpVAO = vao;
+
+   return vao;
+}
+
+
+void
+_mesa_glthread_init_vaos(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   glthread->VAOs = _mesa_NewHashTable();
+   glthread->CurrentVAO = &glthread->DefaultVAO;
+}
+
+
+static void
+free_vao(GLuint key, void *data, void *userData)
+{
+   free(data);
+}
+
+
+void
+_mesa_glthread_destroy_vaos(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (glthread->VAOs) {
+      _mesa_HashDeleteAll(glthread->VAOs, free_vao, NULL);
+      _mesa_DeleteHashTable(glthread->VAOs);
+      glthread->VAOs = NULL;
+   }
+   glthread->CurrentVAO = &glthread->DefaultVAO;
+   glthread->LastLookedUpVAO = NULL;
+}
+
+
+/**
+ * Note that GL core makes it so that a buffer binding with an invalid handle
+ * in the "buffer" parameter will throw an error, and then a
+ * glVertexAttribPointer() that follows might not end up pointing at a VBO.
+ * However, core GL doesn't have user arrays, so we never look at the
+ * binding there.
+ *
+ * For compatibility GL, we do need to accurately know whether the draw call
+ * on the unmarshal side will dereference a user pointer or load data from a
+ * VBO per vertex.  That would make it seem like we need to track whether a
+ * "buffer" is valid, so that we can know when an error will be generated
+ * instead of updating the binding.  However, compat GL has the ridiculous
+ * feature that if you pass a bad name, it just gens a buffer object for you,
+ * so we escape without having to know if things are valid or not.
+ */
+void
+_mesa_glthread_BindBuffer(struct gl_context *ctx, GLenum target,
+                          GLuint buffer)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   switch (target) {
+   case GL_ARRAY_BUFFER:
+      glthread->CurrentArrayBufferName = buffer;
+      break;
+   case GL_ELEMENT_ARRAY_BUFFER:
+      /* The element array buffer binding is part of the VAO. */
+      glthread->CurrentVAO->CurrentElementBufferName = buffer;
+      break;
+   }
+}
+
+
+void
+_mesa_glthread_DeleteBuffers(struct gl_context *ctx, GLsizei n,
+                             const GLuint *buffers)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (n < 0 || !buffers)
+      return;
+
+   /* Deleting a buffer unbinds it from the context and the current VAO. */
+   for (GLsizei i = 0; i < n; i++) {
+      GLuint id = buffers[i];
+
+      if (!id)
+         continue;
+
+      if (id == glthread->CurrentArrayBufferName)
+         glthread->CurrentArrayBufferName = 0;
+      if (id == glthread->CurrentVAO->CurrentElementBufferName)
+         glthread->CurrentVAO->CurrentElementBufferName = 0;
+   }
+}
+
+
+void
+_mesa_glthread_BindVertexArray(struct gl_context *ctx, GLuint id)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (id == 0) {
+      glthread->CurrentVAO = &glthread->DefaultVAO;
+   } else {
+      struct glthread_vao *vao = lookup_vao(ctx, id);
+
+      if (vao)
+         glthread->CurrentVAO = vao;
+   }
+}
+
+
+/**
+ * Called after glGenVertexArrays or glCreateVertexArrays has returned the
+ * new names, which are synchronous.
+ */
+void
+_mesa_glthread_GenVertexArrays(struct gl_context *ctx, GLsizei n,
+                               GLuint *arrays)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (n < 0 || !arrays)
+      return;
+
+   for (GLsizei i = 0; i < n; i++) {
+      GLuint id = arrays[i];
+      struct glthread_vao *vao;
+
+      if (!id || _mesa_HashLookup(glthread->VAOs, id))
+         continue;
+
+      vao = calloc(1, sizeof(*vao));
+      if (!vao) {
+         /* Without the VAO we can't follow later binds, so stop threading. */
+         _mesa_glthread_restore_dispatch(ctx, "GenVertexArrays");
+         return;
+      }
+
+      vao->Name = id;
+      _mesa_HashInsert(glthread->VAOs, id, vao);
+   }
+}
+
+
+void
+_mesa_glthread_DeleteVertexArrays(struct gl_context *ctx, GLsizei n,
+                                  const GLuint *ids)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (n < 0 || !ids)
+      return;
+
+   for (GLsizei i = 0; i < n; i++) {
+      struct glthread_vao *vao = lookup_vao(ctx, ids[i]);
+
+      if (!vao)
+         continue;
+
+      /* Deleting the bound VAO binds the default one. */
+      if (glthread->CurrentVAO == vao)
+         glthread->CurrentVAO = &glthread->DefaultVAO;
+      if (glthread->LastLookedUpVAO == vao)
+         glthread->LastLookedUpVAO = NULL;
+
+      _mesa_HashRemove(glthread->VAOs, vao->Name);
+      free(vao);
+   }
+}
+
+
+void
+_mesa_glthread_VertexArrayElementBuffer(struct gl_context *ctx,
+                                        GLuint vaobj, GLuint buffer)
+{
+   struct glthread_vao *vao = lookup_vao(ctx, vaobj);
+
+   if (vao)
+      vao->CurrentElementBufferName = buffer;
+}
+
+
+static void
+set_enabled(struct glthread_vao *vao, GLuint attrib, bool enable)
+{
+   if (enable)
+      vao->Enabled |= VERT_BIT(attrib);
+   else
+      vao->Enabled &= ~VERT_BIT(attrib);
+}
+
+
+void
+_mesa_glthread_ClientState(struct gl_context *ctx, GLenum array,
+                           bool enable)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   struct glthread_vao *vao = glthread->CurrentVAO;
+
+   switch (array) {
+   case GL_VERTEX_ARRAY:
+      set_enabled(vao, VERT_ATTRIB_POS, enable);
+      break;
+   case GL_NORMAL_ARRAY:
+      set_enabled(vao, VERT_ATTRIB_NORMAL, enable);
+      break;
+   case GL_COLOR_ARRAY:
+      set_enabled(vao, VERT_ATTRIB_COLOR0, enable);
+      break;
+   case GL_INDEX_ARRAY:
+      set_enabled(vao, VERT_ATTRIB_COLOR_INDEX, enable);
+      break;
+   case GL_TEXTURE_COORD_ARRAY:
+      set_enabled(vao, VERT_ATTRIB_TEX(glthread->ClientActiveTexture),
+                  enable);
+      break;
+   case GL_EDGE_FLAG_ARRAY:
+      set_enabled(vao, VERT_ATTRIB_EDGEFLAG, enable);
+      break;
+   case GL_FOG_COORDINATE_ARRAY_EXT:
+      set_enabled(vao, VERT_ATTRIB_FOG, enable);
+      break;
+   case GL_SECONDARY_COLOR_ARRAY_EXT:
+      set_enabled(vao, VERT_ATTRIB_COLOR1, enable);
+      break;
+   case GL_POINT_SIZE_ARRAY_OES:
+      set_enabled(vao, VERT_ATTRIB_POINT_SIZE, enable);
+      break;
+   case GL_PRIMITIVE_RESTART_NV:
+      glthread->PrimitiveRestart = enable;
+      break;
+   }
+}
+
+
+void
+_mesa_glthread_ClientStatei(struct gl_context *ctx, GLenum array,
+                            GLuint index, bool enable)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (array != GL_TEXTURE_COORD_ARRAY ||
+       index >= ctx->Const.MaxTextureCoordUnits)
+      return;
+
+   set_enabled(glthread->CurrentVAO, VERT_ATTRIB_TEX(index), enable);
+}
+
+
+void
+_mesa_glthread_AttribArray(struct gl_context *ctx, GLuint index,
+                           bool enable)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (index >= ctx->Const.Program[MESA_SHADER_VERTEX].MaxAttribs)
+      return;
+
+   set_enabled(glthread->CurrentVAO, VERT_ATTRIB_GENERIC(index), enable);
+}
+
+
+void
+_mesa_glthread_VertexArrayAttrib(struct gl_context *ctx, GLuint vaobj,
+                                 GLuint index, bool enable)
+{
+   struct glthread_vao *vao = lookup_vao(ctx, vaobj);
+
+   if (!vao || index >= ctx->Const.Program[MESA_SHADER_VERTEX].MaxAttribs)
+      return;
+
+   set_enabled(vao, VERT_ATTRIB_GENERIC(index), enable);
+}
+
+
+void
+_mesa_glthread_AttribPointer(struct gl_context *ctx, GLuint attrib,
+                             GLint size, GLenum type, GLsizei stride,
+                             const void *pointer)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   struct glthread_vao *vao = glthread->CurrentVAO;
+   int element_size;
+
+   if (attrib >= VERT_ATTRIB_MAX || stride < 0)
+      return;
+
+   if (attrib >= VERT_ATTRIB_GENERIC0 &&
+       attrib - VERT_ATTRIB_GENERIC0 >=
+       ctx->Const.Program[MESA_SHADER_VERTEX].MaxAttribs)
+      return;
+
+   element_size = _mesa_bytes_per_vertex_attrib(size == GL_BGRA ? 4 : size,
+                                                type);
+   if (element_size <= 0)
+      return;
+
+   vao->Attrib[attrib].Pointer = pointer;
+   vao->Attrib[attrib].Stride = stride ? stride : element_size;
+   vao->Attrib[attrib].ElementSize = element_size;
+
+   /* Core profiles don't have user vertex arrays at all. */
+   if (glthread->CurrentArrayBufferName == 0 && ctx->API != API_OPENGL_CORE)
+      vao->UserPointerMask |= VERT_BIT(attrib);
+   else
+      vao->UserPointerMask &= ~VERT_BIT(attrib);
+}
+
+
+void
+_mesa_glthread_AttribDivisor(struct gl_context *ctx, GLuint index,
+                             GLuint divisor)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (index >= ctx->Const.Program[MESA_SHADER_VERTEX].MaxAttribs)
+      return;
+
+   glthread->CurrentVAO->Attrib[VERT_ATTRIB_GENERIC(index)].Divisor = divisor;
+}
+
+
+void
+_mesa_glthread_ClientActiveTexture(struct gl_context *ctx, GLenum texture)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   GLuint unit = texture - GL_TEXTURE0;
+
+   if (unit < ctx->Const.MaxTextureCoordUnits)
+      glthread->ClientActiveTexture = unit;
+}
+
+
+void
+_mesa_glthread_PrimitiveRestartIndex(struct gl_context *ctx, GLuint index)
+{
+   ctx->GLThread->RestartIndex = index;
+}
+
+
+void
+_mesa_glthread_PushClientAttrib(struct gl_context *ctx, GLbitfield mask)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   struct glthread_client_attrib *top;
+
+   /* Like _mesa_PushClientAttrib, only push if there is something to save. */
+   if (glthread->ClientAttribStackTop >= MAX_CLIENT_ATTRIB_STACK_DEPTH ||
+       !(mask & (GL_CLIENT_PIXEL_STORE_BIT | GL_CLIENT_VERTEX_ARRAY_BIT)))
+      return;
+
+   top = &glthread->ClientAttribStack[glthread->ClientAttribStackTop++];
+   top->Valid = mask & GL_CLIENT_VERTEX_ARRAY_BIT;
+
+   if (top->Valid) {
+      top->VAO = *glthread->CurrentVAO;
+      top->CurrentArrayBufferName = glthread->CurrentArrayBufferName;
+      top->ClientActiveTexture = glthread->ClientActiveTexture;
+      top->RestartIndex = glthread->RestartIndex;
+      top->PrimitiveRestart = glthread->PrimitiveRestart;
+      top->PrimitiveRestartFixedIndex = glthread->PrimitiveRestartFixedIndex;
+   }
+}
+
+
+void
+_mesa_glthread_PopClientAttrib(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   struct glthread_client_attrib *top;
+   struct glthread_vao *vao;
+
+   if (glthread->ClientAttribStackTop == 0)
+      return;
+
+   top = &glthread->ClientAttribStack[--glthread->ClientAttribStackTop];
+   if (!top->Valid)
+      return;
+
+   /* Popping a deleted VAO restores nothing, see restore_array_attrib. */
+   if (top->VAO.Name) {
+      vao = lookup_vao(ctx, top->VAO.Name);
+      if (!vao)
+         return;
+   } else {
+      vao = &glthread->DefaultVAO;
+   }
+
+   *vao = top->VAO;
+   glthread->CurrentVAO = vao;
+   glthread->CurrentArrayBufferName = top->CurrentArrayBufferName;
+   glthread->ClientActiveTexture = top->ClientActiveTexture;
+   glthread->RestartIndex = top->RestartIndex;
+   glthread->PrimitiveRestart = top->PrimitiveRestart;
+   glthread->PrimitiveRestartFixedIndex = top->PrimitiveRestartFixedIndex;
+}
@@ -33,6 +33,7 @@
 #include "main/glthread.h"
 #include "main/context.h"
 #include "main/macros.h"
+#include "util/u_atomic.h"
 
 struct marshal_cmd_base
 {
@@ -53,13 +54,13 @@ _mesa_glthread_allocate_command(struct gl_context *ctx,
                                 size_t size)
 {
    struct glthread_state *glthread = ctx->GLThread;
-   struct glthread_batch *next = &glthread->batches[glthread->next];
+   struct glthread_batch *next = glthread->batches[glthread->next];
    struct marshal_cmd_base *cmd_base;
    const size_t aligned_size = ALIGN(size, 8);
 
-   if (unlikely(next->used + size > MARSHAL_MAX_CMD_SIZE)) {
+   if (unlikely(next->used + size > glthread->batch_size)) {
       _mesa_glthread_flush_batch(ctx);
-      next = &glthread->batches[glthread->next];
+      next = glthread->batches[glthread->next];
    }
 
    cmd_base = (struct marshal_cmd_base *)&next->buffer[next->used];
@@ -70,28 +71,16 @@ _mesa_glthread_allocate_command(struct gl_context *ctx,
 }
 
 /**
- * Instead of conditionally handling marshaling previously-bound user vertex
- * array data in draw calls (deprecated and removed in GL core), we just
- * disable threading at the point where the user sets a user vertex array.
+ * Whether the current vertex array object has enabled user vertex arrays.
+ * Draws that read them without going through glthread_draw.c have to be
+ * executed synchronously.
  */
 static inline bool
-_mesa_glthread_is_non_vbo_vertex_attrib_pointer(const struct gl_context *ctx)
+_mesa_glthread_has_user_arrays(const struct gl_context *ctx)
 {
-   struct glthread_state *glthread = ctx->GLThread;
-
-   return ctx->API != API_OPENGL_CORE && !glthread->vertex_array_is_vbo;
-}
-
-/**
- * Instead of conditionally handling marshaling immediate index data in draw
- * calls (deprecated and removed in GL core), we just disable threading.
- */
-static inline bool
-_mesa_glthread_is_non_vbo_draw_elements(const struct gl_context *ctx)
-{
-   struct glthread_state *glthread = ctx->GLThread;
+   const struct glthread_vao *vao = ctx->GLThread->CurrentVAO;
 
-   return ctx->API != API_OPENGL_CORE && !glthread->element_array_is_vbo;
+   return vao->Enabled & vao->UserPointerMask;
 }
 
 #define DEBUG_MARSHAL_PRINT_CALLS 0
@@ -99,10 +88,14 @@ _mesa_glthread_is_non_vbo_draw_elements(const struct gl_context *ctx)
 /**
  * This is printed when we have fallen back to a sync. This can happen when
  * MARSHAL_MAX_CMD_SIZE is exceeded.
+ *
+ * Both this and debug_print_sync() also count the call in
+ * glthread_state::stats, which GALLIUM_HUD shows as API-thread-sync-calls.
  */
 static inline void
-debug_print_sync_fallback(const char *func)
+debug_print_sync_fallback(struct gl_context *ctx, const char *func)
 {
+   p_atomic_inc(&ctx->GLThread->stats.num_sync_calls);
 #if DEBUG_MARSHAL_PRINT_CALLS
    printf("fallback to sync: %s\n", func);
 #endif
@@ -110,8 +103,9 @@ debug_print_sync_fallback(const char *func)
 
 
 static inline void
-debug_print_sync(const char *func)
+debug_print_sync(struct gl_context *ctx, const char *func)
 {
+   p_atomic_inc(&ctx->GLThread->stats.num_sync_calls);
 #if DEBUG_MARSHAL_PRINT_CALLS
    printf("sync: %s\n", func);
 #endif
@@ -152,24 +146,16 @@ _mesa_post_marshal_hook(struct gl_context *ctx)
 
 
 /**
- * Checks whether we're on a compat context for code-generated
- * glBindVertexArray().
+ * Checks whether vertex attrib bindings (ARB_vertex_attrib_binding) can
+ * change which user vertex arrays a draw reads.
  *
- * In order to decide whether a draw call uses only VBOs for vertex and index
- * buffers, we track the current vertex and index buffer bindings by
- * glBindBuffer().  However, the index buffer binding is stored in the vertex
- * array as opposed to the context.  If we were to accurately track whether
- * the index buffer was a user pointer ot not, we'd have to track it per
- * vertex array, which would mean synchronizing with the client thread and
- * looking into the hash table to find the actual vertex array object.  That's
- * more tracking than we'd like to do in the main thread, if possible.
- *
- * Instead, just punt for now and disable threading on apps using vertex
- * arrays and compat contexts.  Apps using vertex arrays can probably use a
- * core context.
+ * The main thread only tracks user arrays set by the gl*Pointer functions,
+ * which bind each attrib to the vertex buffer binding of the same index.
+ * Rather than tracking the bindings as well, disable threading when they are
+ * changed in an API that has user arrays.
  */
 static inline bool
-_mesa_glthread_is_compat_bind_vertex_array(const struct gl_context *ctx)
+_mesa_glthread_is_compat_vertex_binding(const struct gl_context *ctx)
 {
    return ctx->API != API_OPENGL_CORE;
 }
@@ -183,10 +169,22 @@ struct marshal_cmd_BufferSubData;
 struct marshal_cmd_NamedBufferData;
 struct marshal_cmd_NamedBufferSubData;
 struct marshal_cmd_ClearBuffer;
+struct marshal_cmd_DrawArrays;
+struct marshal_cmd_DrawElements;
 #define marshal_cmd_ClearBufferfv   marshal_cmd_ClearBuffer
 #define marshal_cmd_ClearBufferiv   marshal_cmd_ClearBuffer
 #define marshal_cmd_ClearBufferuiv  marshal_cmd_ClearBuffer
 #define marshal_cmd_ClearBufferfi   marshal_cmd_ClearBuffer
+#define marshal_cmd_DrawArraysInstancedARB            marshal_cmd_DrawArrays
+#define marshal_cmd_DrawArraysInstancedBaseInstance   marshal_cmd_DrawArrays
+#define marshal_cmd_DrawRangeElements                 marshal_cmd_DrawElements
+#define marshal_cmd_DrawElementsBaseVertex            marshal_cmd_DrawElements
+#define marshal_cmd_DrawRangeElementsBaseVertex       marshal_cmd_DrawElements
+#define marshal_cmd_DrawElementsInstancedARB          marshal_cmd_DrawElements
+#define marshal_cmd_DrawElementsInstancedBaseVertex   marshal_cmd_DrawElements
+#define marshal_cmd_DrawElementsInstancedBaseInstance marshal_cmd_DrawElements
+#define marshal_cmd_DrawElementsInstancedBaseVertexBaseInstance \
+   marshal_cmd_DrawElements
 
 void
 _mesa_unmarshal_Enable(struct gl_context *ctx,
@@ -281,4 +279,119 @@ void GLAPIENTRY
 _mesa_marshal_ClearBufferfi(GLenum buffer, GLint drawbuffer,
                             const GLfloat depth, const GLint stencil);
 
+void
+_mesa_unmarshal_DrawArrays(struct gl_context *ctx,
+                           const struct marshal_cmd_DrawArrays *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawArrays(GLenum mode, GLint first, GLsizei count);
+
+void
+_mesa_unmarshal_DrawArraysInstancedARB(struct gl_context *ctx,
+                                       const struct marshal_cmd_DrawArrays *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawArraysInstancedARB(GLenum mode, GLint first, GLsizei count,
+                                     GLsizei primcount);
+
+void
+_mesa_unmarshal_DrawArraysInstancedBaseInstance(struct gl_context *ctx,
+                                                const struct marshal_cmd_DrawArrays *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawArraysInstancedBaseInstance(GLenum mode, GLint first,
+                                              GLsizei count, GLsizei primcount,
+                                              GLuint baseinstance);
+
+void
+_mesa_unmarshal_DrawElements(struct gl_context *ctx,
+                             const struct marshal_cmd_DrawElements *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawElements(GLenum mode, GLsizei count, GLenum type,
+                           const GLvoid *indices);
+
+void
+_mesa_unmarshal_DrawRangeElements(struct gl_context *ctx,
+                                  const struct marshal_cmd_DrawElements *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawRangeElements(GLenum mode, GLuint start, GLuint end,
+                                GLsizei count, GLenum type,
+                                const GLvoid *indices);
+
+void
+_mesa_unmarshal_DrawElementsBaseVertex(struct gl_context *ctx,
+                                       const struct marshal_cmd_DrawElements *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type,
+                                     const GLvoid *indices, GLint basevertex);
+
+void
+_mesa_unmarshal_DrawRangeElementsBaseVertex(struct gl_context *ctx,
+                                            const struct marshal_cmd_DrawElements *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawRangeElementsBaseVertex(GLenum mode, GLuint start,
+                                          GLuint end, GLsizei count,
+                                          GLenum type, const GLvoid *indices,
+                                          GLint basevertex);
+
+void
+_mesa_unmarshal_DrawElementsInstancedARB(struct gl_context *ctx,
+                                         const struct marshal_cmd_DrawElements *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsInstancedARB(GLenum mode, GLsizei count,
+                                       GLenum type, const GLvoid *indices,
+                                       GLsizei primcount);
+
+void
+_mesa_unmarshal_DrawElementsInstancedBaseVertex(struct gl_context *ctx,
+                                                const struct marshal_cmd_DrawElements *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsInstancedBaseVertex(GLenum mode, GLsizei count,
+                                              GLenum type,
+                                              const GLvoid *indices,
+                                              GLsizei primcount,
+                                              GLint basevertex);
+
+void
+_mesa_unmarshal_DrawElementsInstancedBaseInstance(struct gl_context *ctx,
+                                                  const struct marshal_cmd_DrawElements *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsInstancedBaseInstance(GLenum mode, GLsizei count,
+                                                GLenum type,
+                                                const GLvoid *indices,
+                                                GLsizei primcount,
+                                                GLuint baseinstance);
+
+void
+_mesa_unmarshal_DrawElementsInstancedBaseVertexBaseInstance(struct gl_context *ctx,
+                                                            const struct marshal_cmd_DrawElements *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsInstancedBaseVertexBaseInstance(GLenum mode,
+                                                          GLsizei count,
+                                                          GLenum type,
+                                                          const GLvoid *indices,
+                                                          GLsizei primcount,
+                                                          GLint basevertex,
+                                                          GLuint baseinstance);
+
+void GLAPIENTRY
+_mesa_marshal_GetBooleanv(GLenum pname, GLboolean *params);
+
+void GLAPIENTRY
+_mesa_marshal_GetFloatv(GLenum pname, GLfloat *params);
+
+void GLAPIENTRY
+_mesa_marshal_GetIntegerv(GLenum pname, GLint *params);
+
+GLboolean GLAPIENTRY
+_mesa_marshal_IsEnabled(GLenum cap);
+
 #endif /* MARSHAL_H */
@@ -41,6 +41,13 @@
 #include "util/half_float.h"
 #include "util/format_rgb9e5.h"
 #include "util/format_r11g11b10f.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_queue.h"
+#include "c11/threads.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 
 /**
@@ -163,6 +170,51 @@ bytes_per_pixel(GLenum datatype, GLuint comps)
 /*@}*/
 
 
+#if defined(__SSE2__)
+/**
+ * 2:1 horizontal box filter of two rows of 8-bit RGBA texels, four
+ * destination texels at a time, with the same rounding as do_row().
+ * \return the number of destination texels done
+ */
+static GLuint
+do_row_ubyte4_sse2(const GLubyte *rowA, const GLubyte *rowB,
+                   GLuint dstWidth, GLubyte *dst)
+{
+   const __m128i zero = _mm_setzero_si128();
+   GLuint i;
+
+   for (i = 0; i + 4 <= dstWidth; i += 4) {
+      const __m128i a0 = _mm_loadu_si128((const __m128i *)(rowA + i * 8));
+      const __m128i a1 = _mm_loadu_si128((const __m128i *)(rowA + i * 8 + 16));
+      const __m128i b0 = _mm_loadu_si128((const __m128i *)(rowB + i * 8));
+      const __m128i b1 = _mm_loadu_si128((const __m128i *)(rowB + i * 8 + 16));
+
+      /* Vertical sums of source texels 0-1, 2-3, 4-5 and 6-7 */
+      const __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero),
+                                       _mm_unpacklo_epi8(b0, zero));
+      const __m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero),
+                                       _mm_unpackhi_epi8(b0, zero));
+      const __m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero),
+                                       _mm_unpacklo_epi8(b1, zero));
+      const __m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero),
+                                       _mm_unpackhi_epi8(b1, zero));
+
+      /* Add the horizontally adjacent texels */
+      const __m128i d01 = _mm_add_epi16(_mm_unpacklo_epi64(s0, s1),
+                                        _mm_unpackhi_epi64(s0, s1));
+      const __m128i d23 = _mm_add_epi16(_mm_unpacklo_epi64(s2, s3),
+                                        _mm_unpackhi_epi64(s2, s3));
+
+      _mm_storeu_si128((__m128i *)(dst + i * 4),
+                       _mm_packus_epi16(_mm_srli_epi16(d01, 2),
+                                        _mm_srli_epi16(d23, 2)));
+   }
+
+   return i;
+}
+#endif
+
+
 /**
  * Average together two rows of a source image to produce a single new
  * row in the dest image.  It's legal for the two source rows to point
@@ -187,11 +239,15 @@ do_row(GLenum datatype, GLuint comps, GLint srcWidth,
    */
 
    if (datatype == GL_UNSIGNED_BYTE && comps == 4) {
-      GLuint i, j, k;
+      GLuint i = 0, j, k;
       const GLubyte(*rowA)[4] = (const GLubyte(*)[4]) srcRowA;
       const GLubyte(*rowB)[4] = (const GLubyte(*)[4]) srcRowB;
       GLubyte(*dst)[4] = (GLubyte(*)[4]) dstRow;
-      for (i = j = 0, k = k0; i < (GLuint) dstWidth;
+#if defined(__SSE2__)
+      if (colStride == 2)
+         i = do_row_ubyte4_sse2(srcRowA, srcRowB, dstWidth, dstRow);
+#endif
+      for (j = i * colStride, k = j + k0; i < (GLuint) dstWidth;
            i++, j += colStride, k += colStride) {
          dst[i][0] = (rowA[j][0] + rowA[k][0] + rowB[j][0] + rowB[k][0]) / 4;
          dst[i][1] = (rowA[j][1] + rowA[k][1] + rowB[j][1] + rowB[k][1]) / 4;
@@ -1467,6 +1523,113 @@ make_1d_mipmap(GLenum datatype, GLuint comps, GLint border,
 }
 
 
+/* Levels with fewer destination texels than this are filtered by the
+ * calling thread alone.
+ */
+#define MIPMAP_THREADED_MIN_TEXELS (256 * 256)
+#define MIPMAP_MAX_JOBS 8
+
+/* Worker threads shared by all contexts, started on first use. */
+static struct util_queue mipmap_queue;
+static bool mipmap_queue_ready;
+static once_flag mipmap_queue_once = ONCE_FLAG_INIT;
+
+static void
+init_mipmap_queue(void)
+{
+   util_cpu_detect();
+   if (util_cpu_caps.nr_cpus < 2)
+      return;
+
+   mipmap_queue_ready =
+      util_queue_init(&mipmap_queue, "mipmap", MIPMAP_MAX_JOBS,
+                      MIN2(util_cpu_caps.nr_cpus, MIPMAP_MAX_JOBS) - 1, 0);
+}
+
+/** A band of destination rows of a 2D image */
+struct mipmap_rows_job {
+   GLenum datatype;
+   GLuint comps;
+   GLint srcWidth;
+   const GLubyte *srcA, *srcB;
+   GLint srcStride;   /**< bytes from one pair of source rows to the next */
+   GLint dstWidth;
+   GLubyte *dst;
+   GLint dstRowStride;
+   GLint rows;
+   struct util_queue_fence fence;
+};
+
+static void
+mipmap_rows_execute(void *data, UNUSED int thread_index)
+{
+   struct mipmap_rows_job *job = data;
+   const GLubyte *srcA = job->srcA, *srcB = job->srcB;
+   GLubyte *dst = job->dst;
+   GLint row;
+
+   for (row = 0; row < job->rows; row++) {
+      do_row(job->datatype, job->comps, job->srcWidth, srcA, srcB,
+             job->dstWidth, dst);
+      srcA += job->srcStride;
+      srcB += job->srcStride;
+      dst += job->dstRowStride;
+   }
+}
+
+/**
+ * Filter the rows of a 2D image, split into bands over the mipmap threads
+ * when it's large enough.
+ */
+static void
+make_2d_mipmap_rows(GLenum datatype, GLuint comps,
+                    GLint srcWidth, const GLubyte *srcA, const GLubyte *srcB,
+                    GLint srcStride, GLint dstWidth, GLint dstHeight,
+                    GLubyte *dst, GLint dstRowStride)
+{
+   struct mipmap_rows_job jobs[MIPMAP_MAX_JOBS];
+   unsigned num_jobs = 1, rows_per_job, i;
+
+   if ((int64_t)dstWidth * dstHeight >= MIPMAP_THREADED_MIN_TEXELS) {
+      call_once(&mipmap_queue_once, init_mipmap_queue);
+      if (mipmap_queue_ready)
+         num_jobs = MIN2(mipmap_queue.num_threads + 1, (unsigned) dstHeight);
+   }
+
+   rows_per_job = DIV_ROUND_UP(dstHeight, num_jobs);
+   num_jobs = rows_per_job ? DIV_ROUND_UP(dstHeight, rows_per_job) : 1;
+
+   for (i = 0; i < num_jobs; i++) {
+      struct mipmap_rows_job *job = &jobs[i];
+      unsigned y = i * rows_per_job;
+
+      job->datatype = datatype;
+      job->comps = comps;
+      job->srcWidth = srcWidth;
+      job->srcA = srcA + y * srcStride;
+      job->srcB = srcB + y * srcStride;
+      job->srcStride = srcStride;
+      job->dstWidth = dstWidth;
+      job->dst = dst + y * dstRowStride;
+      job->dstRowStride = dstRowStride;
+      job->rows = MIN2(rows_per_job, dstHeight - y);
+      util_queue_fence_init(&job->fence);
+
+      /* The first band is done by the calling thread. */
+      if (i)
+         util_queue_add_job(&mipmap_queue, job, &job->fence,
+                            mipmap_rows_execute, NULL);
+   }
+
+   mipmap_rows_execute(&jobs[0], 0);
+
+   for (i = 0; i < num_jobs; i++) {
+      util_queue_fence_wait(&jobs[i].fence);
+      util_queue_fence_destroy(&jobs[i].fence);
+   }
+}
+
+
 static void
 make_2d_mipmap(GLenum datatype, GLuint comps, GLint border,
                GLint srcWidth, GLint srcHeight,
@@ -1497,13 +1660,9 @@ make_2d_mipmap(GLenum datatype, GLuint comps, GLint border,
 
    dst = dstPtr + border * ((dstWidth + 1) * bpt);
 
-   for (row = 0; row < dstHeightNB; row++) {
-      do_row(datatype, comps, srcWidthNB, srcA, srcB,
-             dstWidthNB, dst);
-      srcA += srcRowStep * srcRowStride;
-      srcB += srcRowStep * srcRowStride;
-      dst += dstRowStride;
-   }
+   make_2d_mipmap_rows(datatype, comps, srcWidthNB, srcA, srcB,
+                       srcRowStep * srcRowStride, dstWidthNB, dstHeightNB,
+                       dst, dstRowStride);
 
    /* This is ugly but probably won't be used much */
    if (border > 0) {
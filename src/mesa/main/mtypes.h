@@ -49,6 +49,7 @@
 #include "compiler/glsl/list.h"
 #include "util/simple_mtx.h"
 #include "util/u_dynarray.h"
+#include "util/u_queue.h"
 
 
 #ifdef __cplusplus
@@ -1563,6 +1564,18 @@ struct gl_vertex_array_object
    /** Mask of VERT_BIT_* values indicating changed/dirty arrays */
    GLbitfield NewArrays;
 
+   /**
+    * Incremented whenever the derived array state is recomputed, so that
+    * drivers can tell whether state they derived from the VAO is stale.
+    */
+   unsigned _Generation;
+
+   /**
+    * Driver state derived from the arrays, allocated with malloc by the
+    * driver and freed with the VAO.  Unused for SharedAndImmutable VAOs.
+    */
+   void *DriverCache;
+
    /** The index buffer (also known as the element array buffer in OpenGL). */
    struct gl_buffer_object *IndexBufferObj;
 };
@@ -2604,6 +2617,12 @@ struct gl_shader
 
    enum gl_compile_status CompileStatus;
 
+   /**
+    * Signalled once a compile queued on ctx->ShaderCompilerQueue has
+    * finished.  Everything below must not be touched until then.
+    */
+   struct util_queue_fence CompileFence;
+
 #ifdef DEBUG
    unsigned SourceChecksum;       /**< for debug/logging purposes */
 #endif
@@ -3307,6 +3326,13 @@ struct gl_shared_state
    /** Table of both gl_shader and gl_shader_program objects */
    struct _mesa_HashTable *ShaderObjects;
 
+   /**
+    * Compiled IR of recently seen GLSL shaders, used to avoid compiling a
+    * stage from source again when the program cache misses.  Created on
+    * first use; see shader_cache.cpp.
+    */
+   struct shader_stage_cache *ShaderStageCache;
+
    /* GL_EXT_framebuffer_object */
    struct _mesa_HashTable *RenderBuffers;
    struct _mesa_HashTable *FrameBuffers;
@@ -4855,6 +4881,12 @@ struct gl_context
 
    struct glthread_state *GLThread;
 
+   /**
+    * Queue used to run glCompileShader off the application thread once
+    * glMaxShaderCompilerThreadsKHR has requested worker threads.
+    */
+   struct util_queue ShaderCompilerQueue;
+
    struct gl_config Visual;
    struct gl_framebuffer *DrawBuffer;	/**< buffer for writing */
    struct gl_framebuffer *ReadBuffer;	/**< buffer for reading */
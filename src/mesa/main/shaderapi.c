@@ -37,6 +37,7 @@
 #include <c99_alloca.h>
 #include "main/glheader.h"
 #include "main/context.h"
+#include "main/debug_output.h"
 #include "main/enums.h"
 #include "main/glspirv.h"
 #include "main/hash.h"
@@ -61,6 +62,7 @@
 #include "util/mesa-sha1.h"
 #include "util/crc32.h"
 #include "util/os_file.h"
+#include "util/u_cpu_detect.h"
 
 /**
  * Return mask of GLSL_x flags by examining the MESA_GLSL env var.
@@ -1008,12 +1010,15 @@ static void
 get_shaderiv(struct gl_context *ctx, GLuint name, GLenum pname, GLint *params)
 {
    struct gl_shader *shader =
-      _mesa_lookup_shader_err(ctx, name, "glGetShaderiv");
+      _mesa_lookup_shader_no_wait_err(ctx, name, "glGetShaderiv");
 
    if (!shader) {
       return;
    }
 
+   if (pname != GL_COMPLETION_STATUS_ARB)
+      util_queue_fence_wait(&shader->CompileFence);
+
    switch (pname) {
    case GL_SHADER_TYPE:
       *params = shader->Type;
@@ -1022,8 +1027,7 @@ get_shaderiv(struct gl_context *ctx, GLuint name, GLenum pname, GLint *params)
       *params = shader->DeletePending;
       break;
    case GL_COMPLETION_STATUS_ARB:
-      /* _mesa_glsl_compile_shader is not offloaded to other threads. */
-      *params = GL_TRUE;
+      *params = util_queue_fence_is_signalled(&shader->CompileFence);
       return;
    case GL_COMPILE_STATUS:
       *params = shader->CompileStatus ? GL_TRUE : GL_FALSE;
@@ -1166,14 +1170,12 @@ ensure_builtin_types(struct gl_context *ctx)
 }
 
 /**
- * Compile a shader.
+ * Do the parts of a compile that have to happen on the calling thread.
+ * Returns false if the shader must not be compiled at all.
  */
-void
-_mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
+static bool
+begin_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
 {
-   if (!sh)
-      return;
-
    /* The GL_ARB_gl_spirv spec says:
     *
     *    "Add a new error for the CompileShader command:
@@ -1183,7 +1185,7 @@ _mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
     */
    if (sh->spirv_data) {
       _mesa_error(ctx, GL_INVALID_OPERATION, "glCompileShader(SPIR-V)");
-      return;
+      return false;
    }
 
    if (!sh->Source) {
@@ -1192,24 +1194,38 @@ _mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
        */
       sh->CompileStatus = COMPILE_FAILURE;
    } else {
-      if (ctx->_Shader->Flags & GLSL_DUMP) {
+      if (ctx->Shader.Flags & GLSL_DUMP) {
          _mesa_log("GLSL source for %s shader %d:\n",
                  _mesa_shader_stage_to_string(sh->Stage), sh->Name);
          _mesa_log("%s\n", sh->Source);
       }
 
       ensure_builtin_types(ctx);
+   }
+
+   return true;
+}
 
+/**
+ * Run the compiler proper.  This may be called from a thread of
+ * ctx->ShaderCompilerQueue, so only state that doesn't change while the
+ * context is alive may be used: ctx->Shader.Flags rather than the bound
+ * pipeline's, and no GL errors.
+ */
+static void
+compile_shader(struct gl_context *ctx, struct gl_shader *sh)
+{
+   if (sh->Source) {
       /* this call will set the shader->CompileStatus field to indicate if
        * compilation was successful.
        */
       _mesa_glsl_compile_shader(ctx, sh, false, false, false);
 
-      if (ctx->_Shader->Flags & GLSL_LOG) {
+      if (ctx->Shader.Flags & GLSL_LOG) {
          _mesa_write_shader_to_file(sh);
       }
 
-      if (ctx->_Shader->Flags & GLSL_DUMP) {
+      if (ctx->Shader.Flags & GLSL_DUMP) {
          if (sh->CompileStatus) {
             if (sh->ir) {
                _mesa_log("GLSL IR for shader %d:\n", sh->Name);
@@ -1230,20 +1246,111 @@ _mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
    }
 
    if (!sh->CompileStatus) {
-      if (ctx->_Shader->Flags & GLSL_DUMP_ON_ERROR) {
+      if (ctx->Shader.Flags & GLSL_DUMP_ON_ERROR) {
          _mesa_log("GLSL source for %s shader %d:\n",
                  _mesa_shader_stage_to_string(sh->Stage), sh->Name);
          _mesa_log("%s\n", sh->Source);
          _mesa_log("Info Log:\n%s\n", sh->InfoLog);
       }
 
-      if (ctx->_Shader->Flags & GLSL_REPORT_ERRORS) {
+      if (ctx->Shader.Flags & GLSL_REPORT_ERRORS) {
          _mesa_debug(ctx, "Error compiling shader %u:\n%s\n",
                      sh->Name, sh->InfoLog);
       }
    }
 }
 
+/**
+ * Compile a shader.
+ */
+void
+_mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
+{
+   if (!sh)
+      return;
+
+   if (begin_compile_shader(ctx, sh))
+      compile_shader(ctx, sh);
+}
+
+
+struct compile_shader_job {
+   struct gl_context *ctx;
+   struct gl_shader *sh;
+};
+
+static void
+compile_shader_job_execute(void *data, int thread_index)
+{
+   struct compile_shader_job *job = (struct compile_shader_job *) data;
+
+   compile_shader(job->ctx, job->sh);
+}
+
+static void
+compile_shader_job_cleanup(void *data, int thread_index)
+{
+   free(data);
+}
+
+/**
+ * Compile a shader for glCompileShader, on ctx->ShaderCompilerQueue if the
+ * application asked for compiler threads.
+ */
+static void
+compile_shader_maybe_async(struct gl_context *ctx, struct gl_shader *sh)
+{
+   if (!sh || !begin_compile_shader(ctx, sh))
+      return;
+
+   /* Messages logged by the compiler have to reach the callback before
+    * glCompileShader returns when debug output is synchronous.
+    */
+   if (sh->Source &&
+       ctx->Hint.MaxShaderCompilerThreads > 0 &&
+       util_queue_is_initialized(&ctx->ShaderCompilerQueue) &&
+       !_mesa_get_debug_state_int(ctx, GL_DEBUG_OUTPUT_SYNCHRONOUS)) {
+      struct compile_shader_job *job = malloc(sizeof(*job));
+      if (job) {
+         job->ctx = ctx;
+         job->sh = sh;
+         util_queue_add_job(&ctx->ShaderCompilerQueue, job, &sh->CompileFence,
+                            compile_shader_job_execute,
+                            compile_shader_job_cleanup);
+         return;
+      }
+   }
+
+   compile_shader(ctx, sh);
+}
+
+
+/**
+ * Start or resize ctx->ShaderCompilerQueue for glMaxShaderCompilerThreadsKHR.
+ * A count of zero makes glCompileShader synchronous again; the threads are
+ * kept around idle.
+ */
+void
+_mesa_set_max_shader_compiler_threads(struct gl_context *ctx, unsigned count)
+{
+   if (count == 0)
+      return;
+
+   if (!util_queue_is_initialized(&ctx->ShaderCompilerQueue)) {
+      util_cpu_detect();
+
+      /* Leave a core to the application thread. */
+      unsigned max_threads = MAX2(util_cpu_caps.nr_cpus - 1, 1);
+
+      if (!util_queue_init(&ctx->ShaderCompilerQueue, "glsl", 64,
+                           max_threads, UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+                           UTIL_QUEUE_INIT_SHARED_POOL))
+         return;
+   }
+
+   util_queue_adjust_num_threads(&ctx->ShaderCompilerQueue, count);
+}
+
 
 /**
  * Link a program's shaders.
@@ -1279,6 +1386,9 @@ link_program(struct gl_context *ctx, struct gl_shader_program *shProg,
 
    ensure_builtin_types(ctx);
 
+   for (unsigned i = 0; i < shProg->NumShaders; i++)
+      util_queue_fence_wait(&shProg->Shaders[i]->CompileFence);
+
    FLUSH_VERTICES(ctx, 0);
    _mesa_glsl_link_shader(ctx, shProg);
 
@@ -1574,8 +1684,8 @@ _mesa_CompileShader(GLuint shaderObj)
    GET_CURRENT_CONTEXT(ctx);
    if (MESA_VERBOSE & VERBOSE_API)
       _mesa_debug(ctx, "glCompileShader %u\n", shaderObj);
-   _mesa_compile_shader(ctx, _mesa_lookup_shader_err(ctx, shaderObj,
-                                                     "glCompileShader"));
+   compile_shader_maybe_async(ctx, _mesa_lookup_shader_err(ctx, shaderObj,
+                                                           "glCompileShader"));
 }
 
 
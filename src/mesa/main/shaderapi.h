@@ -67,6 +67,9 @@ _mesa_active_program(struct gl_context *ctx, struct gl_shader_program *shProg,
 extern void
 _mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh);
 
+extern void
+_mesa_set_max_shader_compiler_threads(struct gl_context *ctx, unsigned count);
+
 extern void
 _mesa_link_program(struct gl_context *ctx, struct gl_shader_program *sh_prog);
 
@@ -94,6 +94,7 @@ _mesa_init_shader(struct gl_shader *shader)
    shader->info.Geom.VerticesOut = -1;
    shader->info.Geom.InputType = GL_TRIANGLES;
    shader->info.Geom.OutputType = GL_TRIANGLE_STRIP;
+   util_queue_fence_init(&shader->CompileFence);
 }
 
 /**
@@ -122,6 +123,8 @@ _mesa_new_shader(GLuint name, gl_shader_stage stage)
 void
 _mesa_delete_shader(struct gl_context *ctx, struct gl_shader *sh)
 {
+   util_queue_fence_wait(&sh->CompileFence);
+   util_queue_fence_destroy(&sh->CompileFence);
    _mesa_shader_spirv_data_reference(&sh->spirv_data, NULL);
    free((void *)sh->Source);
    free((void *)sh->FallbackSource);
@@ -144,10 +147,11 @@ _mesa_delete_linked_shader(struct gl_context *ctx,
 
 
 /**
- * Lookup a GLSL shader object.
+ * Lookup a GLSL shader object without waiting for a background compile of
+ * it to finish.  Only the compile status fence may be inspected.
  */
 struct gl_shader *
-_mesa_lookup_shader(struct gl_context *ctx, GLuint name)
+_mesa_lookup_shader_no_wait(struct gl_context *ctx, GLuint name)
 {
    if (name) {
       struct gl_shader *sh = (struct gl_shader *)
@@ -165,11 +169,25 @@ _mesa_lookup_shader(struct gl_context *ctx, GLuint name)
 }
 
 
+/**
+ * Lookup a GLSL shader object.
+ */
+struct gl_shader *
+_mesa_lookup_shader(struct gl_context *ctx, GLuint name)
+{
+   struct gl_shader *sh = _mesa_lookup_shader_no_wait(ctx, name);
+   if (sh)
+      util_queue_fence_wait(&sh->CompileFence);
+   return sh;
+}
+
+
 /**
  * As above, but record an error if shader is not found.
  */
 struct gl_shader *
-_mesa_lookup_shader_err(struct gl_context *ctx, GLuint name, const char *caller)
+_mesa_lookup_shader_no_wait_err(struct gl_context *ctx, GLuint name,
+                                const char *caller)
 {
    if (!name) {
       _mesa_error(ctx, GL_INVALID_VALUE, "%s", caller);
@@ -191,6 +209,19 @@ _mesa_lookup_shader_err(struct gl_context *ctx, GLuint name, const char *caller)
 }
 
 
+/**
+ * As above, but also wait for any background compile of the shader.
+ */
+struct gl_shader *
+_mesa_lookup_shader_err(struct gl_context *ctx, GLuint name, const char *caller)
+{
+   struct gl_shader *sh = _mesa_lookup_shader_no_wait_err(ctx, name, caller);
+   if (sh)
+      util_queue_fence_wait(&sh->CompileFence);
+   return sh;
+}
+
+
 
 /**********************************************************************/
 /*** Shader Program object functions                                ***/
@@ -57,9 +57,16 @@ extern void
 _mesa_reference_shader(struct gl_context *ctx, struct gl_shader **ptr,
                        struct gl_shader *sh);
 
+extern struct gl_shader *
+_mesa_lookup_shader_no_wait(struct gl_context *ctx, GLuint name);
+
 extern struct gl_shader *
 _mesa_lookup_shader(struct gl_context *ctx, GLuint name);
 
+extern struct gl_shader *
+_mesa_lookup_shader_no_wait_err(struct gl_context *ctx, GLuint name,
+                                const char *caller);
+
 extern struct gl_shader *
 _mesa_lookup_shader_err(struct gl_context *ctx, GLuint name, const char *caller);
 
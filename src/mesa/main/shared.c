@@ -40,6 +40,7 @@
 #include "shaderobj.h"
 #include "syncobj.h"
 #include "texturebindless.h"
+#include "compiler/glsl/shader_cache.h"
 
 #include "util/hash_table.h"
 #include "util/set.h"
@@ -371,6 +372,8 @@ free_shared_state(struct gl_context *ctx, struct gl_shared_state *shared)
       _mesa_DeleteHashTable(shared->ShaderObjects);
    }
 
+   shader_cache_destroy_stage_cache(shared->ShaderStageCache);
+
    if (shared->Programs) {
       _mesa_HashDeleteAll(shared->Programs, delete_program_cb, ctx);
       _mesa_DeleteHashTable(shared->Programs);
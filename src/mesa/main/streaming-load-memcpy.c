@@ -28,16 +28,54 @@
 
 #include "main/macros.h"
 #include "main/streaming-load-memcpy.h"
+#include "util/u_cpu_detect.h"
 #include <smmintrin.h>
 
+/* The AVX2 loop is compiled for AVX2 with a function attribute, so the rest
+ * of the file keeps building for SSE 4.1.
+ */
+#if defined(__GNUC__)
+#include <immintrin.h>
+#define HAVE_STREAMING_LOAD_AVX2
+#endif
+
+#ifdef HAVE_STREAMING_LOAD_AVX2
+/* Copies whole cachelines with AVX2's 32-byte VMOVNTDQA.  <d> and <s> must
+ * be 32-byte aligned.  Returns the number of bytes copied.
+ */
+__attribute__((target("avx2"))) static size_t
+streaming_load_memcpy_avx2(char *restrict d, char *restrict s, size_t len)
+{
+   size_t copied = 0;
+
+   while (len - copied >= 64) {
+      __m256i *dst_cacheline = (__m256i *)(d + copied);
+      __m256i *src_cacheline = (__m256i *)(s + copied);
+
+      __m256i temp1 = _mm256_stream_load_si256(src_cacheline + 0);
+      __m256i temp2 = _mm256_stream_load_si256(src_cacheline + 1);
+
+      _mm256_store_si256(dst_cacheline + 0, temp1);
+      _mm256_store_si256(dst_cacheline + 1, temp2);
+
+      copied += 64;
+   }
+
+   _mm256_zeroupper();
+   return copied;
+}
+#endif
+
 /* Copies memory from src to dst, using SSE 4.1's MOVNTDQA to get streaming
- * read performance from uncached memory.
+ * read performance from uncached memory, or AVX2's wider form of it when
+ * the CPU has it.
  */
 void
 _mesa_streaming_load_memcpy(void *restrict dst, void *restrict src, size_t len)
 {
    char *restrict d = dst;
    char *restrict s = src;
+   uintptr_t alignment = 16;
 
    /* If dst and src are not co-aligned, fallback to memcpy(). */
    if (((uintptr_t)d & 15) != ((uintptr_t)s & 15)) {
@@ -45,23 +83,40 @@ _mesa_streaming_load_memcpy(void *restrict dst, void *restrict src, size_t len)
       return;
    }
 
+#ifdef HAVE_STREAMING_LOAD_AVX2
+   util_cpu_detect();
+   if (util_cpu_caps.has_avx2 && ((uintptr_t)d & 31) == ((uintptr_t)s & 31))
+      alignment = 32;
+#endif
+
    /* memcpy() the misaligned header. At the end of this if block, <d> and <s>
-    * are aligned to a 16-byte boundary or <len> == 0.
+    * are aligned to an <alignment> boundary or <len> == 0.
     */
-   if ((uintptr_t)d & 15) {
-      uintptr_t bytes_before_alignment_boundary = 16 - ((uintptr_t)d & 15);
-      assert(bytes_before_alignment_boundary < 16);
+   if ((uintptr_t)d & (alignment - 1)) {
+      uintptr_t bytes_before_alignment_boundary =
+         alignment - ((uintptr_t)d & (alignment - 1));
+      assert(bytes_before_alignment_boundary < alignment);
 
       memcpy(d, s, MIN2(bytes_before_alignment_boundary, len));
 
-      d = (char *)ALIGN((uintptr_t)d, 16);
-      s = (char *)ALIGN((uintptr_t)s, 16);
+      d = (char *)ALIGN((uintptr_t)d, alignment);
+      s = (char *)ALIGN((uintptr_t)s, alignment);
       len -= MIN2(bytes_before_alignment_boundary, len);
    }
 
    if (len >= 64)
       _mm_mfence();
 
+#ifdef HAVE_STREAMING_LOAD_AVX2
+   if (alignment == 32) {
+      size_t copied = streaming_load_memcpy_avx2(d, s, len);
+
+      d += copied;
+      s += copied;
+      len -= copied;
+   }
+#endif
+
    while (len >= 64) {
       __m128i *dst_cacheline = (__m128i *)d;
       __m128i *src_cacheline = (__m128i *)s;
@@ -33,7 +33,33 @@
 #ifndef STREAMING_LOAD_MEMCPY_H
 #define STREAMING_LOAD_MEMCPY_H
 
+#include <string.h>
+#include "util/u_cpu_detect.h"
+
 void
 _mesa_streaming_load_memcpy(void *restrict dst, void *restrict src, size_t len);
 
+/* Below this, the fence before the streaming loads costs more than they
+ * save.
+ */
+#define STREAMING_LOAD_MIN_SIZE 256
+
+/**
+ * Copies memory out of a mapping which may be write-combined or uncached,
+ * such as a buffer or a transfer mapped for reading.  Uses streaming loads
+ * when the CPU has them and the copy is big enough, memcpy() otherwise.
+ * util_cpu_detect() must have been called.
+ */
+static inline void
+_mesa_readback_memcpy(void *restrict dst, void *restrict src, size_t len)
+{
+#ifdef USE_SSE41
+   if (len >= STREAMING_LOAD_MIN_SIZE && util_cpu_caps.has_sse4_1) {
+      _mesa_streaming_load_memcpy(dst, src, len);
+      return;
+   }
+#endif
+   memcpy(dst, src, len);
+}
+
 #endif /* STREAMING_LOAD_MEMCPY_H */
@@ -1035,39 +1035,74 @@ _mesa_flush_vertices_for_uniforms(struct gl_context *ctx,
    ctx->NewDriverState |= new_driver_state;
 }
 
-static void
+/**
+ * Copy the new uniform values to \p storage.
+ *
+ * Applications often set uniforms to the values they already have, so the
+ * values are compared first.  Only if they differ is the context flushed
+ * (when \p flush is set) and the storage written.
+ *
+ * \return true if the storage was changed
+ */
+static bool
 copy_uniforms_to_storage(gl_constant_value *storage,
                          struct gl_uniform_storage *uni,
                          struct gl_context *ctx, GLsizei count,
                          const GLvoid *values, const int size_mul,
                          const unsigned offset, const unsigned components,
-                         enum glsl_base_type basicType)
+                         enum glsl_base_type basicType, bool flush)
 {
    if (!uni->type->is_boolean() && !uni->is_bindless) {
-      memcpy(storage, values,
-             sizeof(storage[0]) * components * count * size_mul);
+      const unsigned size = sizeof(storage[0]) * components * count * size_mul;
+
+      if (!memcmp(storage, values, size))
+         return false;
+
+      if (flush)
+         _mesa_flush_vertices_for_uniforms(ctx, uni);
+
+      memcpy(storage, values, size);
+      return true;
    } else if (uni->is_bindless) {
       const union gl_constant_value *src =
          (const union gl_constant_value *) values;
       GLuint64 *dst = (GLuint64 *)&storage->i;
       const unsigned elems = components * count;
+      bool changed = false;
 
       for (unsigned i = 0; i < elems; i++) {
-         dst[i] = src[i].i;
+         if (dst[i] != (GLuint64)src[i].i) {
+            if (flush && !changed)
+               _mesa_flush_vertices_for_uniforms(ctx, uni);
+            dst[i] = src[i].i;
+            changed = true;
+         }
       }
+      return changed;
    } else {
       const union gl_constant_value *src =
          (const union gl_constant_value *) values;
       union gl_constant_value *dst = storage;
       const unsigned elems = components * count;
+      bool changed = false;
 
       for (unsigned i = 0; i < elems; i++) {
+         int value;
+
          if (basicType == GLSL_TYPE_FLOAT) {
-            dst[i].i = src[i].f != 0.0f ? ctx->Const.UniformBooleanTrue : 0;
+            value = src[i].f != 0.0f ? ctx->Const.UniformBooleanTrue : 0;
          } else {
-            dst[i].i = src[i].i != 0    ? ctx->Const.UniformBooleanTrue : 0;
+            value = src[i].i != 0    ? ctx->Const.UniformBooleanTrue : 0;
+         }
+
+         if (dst[i].i != value) {
+            if (flush && !changed)
+               _mesa_flush_vertices_for_uniforms(ctx, uni);
+            dst[i].i = value;
+            changed = true;
          }
       }
+      return changed;
    }
 }
 
@@ -1128,9 +1163,7 @@ _mesa_uniform(GLint location, GLsizei count, const GLvoid *values,
    /* We check samplers for changes and flush if needed in the sampler
     * handling code further down, so just skip them here.
     */
-   if (!uni->type->is_sampler()) {
-       _mesa_flush_vertices_for_uniforms(ctx, uni);
-   }
+   bool flush = !uni->type->is_sampler();
 
    /* Store the data in the "actual type" backing storage for the uniform.
     */
@@ -1141,15 +1174,16 @@ _mesa_uniform(GLint location, GLsizei count, const GLvoid *values,
          storage = (gl_constant_value *)
             uni->driver_storage[s].data + (size_mul * offset * components);
 
-         copy_uniforms_to_storage(storage, uni, ctx, count, values, size_mul,
-                                  offset, components, basicType);
+         if (copy_uniforms_to_storage(storage, uni, ctx, count, values,
+                                      size_mul, offset, components,
+                                      basicType, flush))
+            flush = false;
       }
    } else {
       storage = &uni->storage[size_mul * components * offset];
-      copy_uniforms_to_storage(storage, uni, ctx, count, values, size_mul,
-                               offset, components, basicType);
-
-      _mesa_propagate_uniforms_to_driver_storage(uni, offset, count);
+      if (copy_uniforms_to_storage(storage, uni, ctx, count, values, size_mul,
+                                   offset, components, basicType, flush))
+         _mesa_propagate_uniforms_to_driver_storage(uni, offset, count);
    }
 
    /* If the uniform is a sampler, do the extra magic necessary to propagate
@@ -1241,52 +1275,95 @@ _mesa_uniform(GLint location, GLsizei count, const GLvoid *values,
 }
 
 
-static void
-copy_uniform_matrix_to_storage(gl_constant_value *storage,
+/**
+ * Transpose a matrix array from \p src to \p dst, or if \p write is false,
+ * only check whether that would change \p dst.
+ */
+template<typename T>
+static bool
+transpose_uniform_matrix(T *dst, const T *src, GLsizei count,
+                         const unsigned components, const unsigned vectors,
+                         unsigned cols, unsigned rows, bool write)
+{
+   const unsigned elements = components * vectors;
+
+   for (int i = 0; i < count; i++) {
+      for (unsigned r = 0; r < rows; r++) {
+         for (unsigned c = 0; c < cols; c++) {
+            T *d = &dst[(c * components) + r];
+            const T *s = &src[c + (r * vectors)];
+
+            if (write)
+               *d = *s;
+            else if (memcmp(d, s, sizeof(T)))
+               return true;
+         }
+      }
+
+      dst += elements;
+      src += elements;
+   }
+
+   return false;
+}
+
+
+/**
+ * Like copy_uniforms_to_storage, for matrices.
+ */
+static bool
+copy_uniform_matrix_to_storage(struct gl_context *ctx,
+                               gl_constant_value *storage,
+                               struct gl_uniform_storage *const uni,
                                GLsizei count, const void *values,
                                const unsigned size_mul, const unsigned offset,
                                const unsigned components,
                                const unsigned vectors, bool transpose,
                                unsigned cols, unsigned rows,
-                               enum glsl_base_type basicType)
+                               enum glsl_base_type basicType, bool flush)
 {
    const unsigned elements = components * vectors;
 
    if (!transpose) {
-      memcpy(storage, values,
-             sizeof(storage[0]) * elements * count * size_mul);
+      const unsigned size = sizeof(storage[0]) * elements * count * size_mul;
+
+      if (!memcmp(storage, values, size))
+         return false;
+
+      if (flush)
+         _mesa_flush_vertices_for_uniforms(ctx, uni);
+
+      memcpy(storage, values, size);
    } else if (basicType == GLSL_TYPE_FLOAT) {
-      /* Copy and transpose the matrix.
-       */
-      const float *src = (const float *)values;
       float *dst = &storage->f;
+      const float *src = (const float *)values;
 
-      for (int i = 0; i < count; i++) {
-         for (unsigned r = 0; r < rows; r++) {
-            for (unsigned c = 0; c < cols; c++) {
-               dst[(c * components) + r] = src[c + (r * vectors)];
-            }
-         }
+      if (!transpose_uniform_matrix(dst, src, count, components, vectors,
+                                    cols, rows, false))
+         return false;
 
-         dst += elements;
-         src += elements;
-      }
+      if (flush)
+         _mesa_flush_vertices_for_uniforms(ctx, uni);
+
+      transpose_uniform_matrix(dst, src, count, components, vectors,
+                               cols, rows, true);
    } else {
       assert(basicType == GLSL_TYPE_DOUBLE);
-      const double *src = (const double *)values;
       double *dst = (double *)&storage->f;
+      const double *src = (const double *)values;
 
-      for (int i = 0; i < count; i++) {
-         for (unsigned r = 0; r < rows; r++) {
-            for (unsigned c = 0; c < cols; c++) {
-               dst[(c * components) + r] = src[c + (r * vectors)];
-            }
-         }
+      if (!transpose_uniform_matrix(dst, src, count, components, vectors,
+                                    cols, rows, false))
+         return false;
 
-         dst += elements;
-         src += elements;
-      }
+      if (flush)
+         _mesa_flush_vertices_for_uniforms(ctx, uni);
+
+      transpose_uniform_matrix(dst, src, count, components, vectors,
+                               cols, rows, true);
    }
+
+   return true;
 }
 
 
@@ -1385,28 +1462,30 @@ _mesa_uniform_matrix(GLint location, GLsizei count,
       count = MIN2(count, (int) (uni->array_elements - offset));
    }
 
-   _mesa_flush_vertices_for_uniforms(ctx, uni);
-
    /* Store the data in the "actual type" backing storage for the uniform.
     */
    gl_constant_value *storage;
    const unsigned elements = components * vectors;
    if (ctx->Const.PackedDriverUniformStorage) {
+      bool flush = true;
+
       for (unsigned s = 0; s < uni->num_driver_storage; s++) {
          storage = (gl_constant_value *)
             uni->driver_storage[s].data + (size_mul * offset * elements);
 
-         copy_uniform_matrix_to_storage(storage, count, values, size_mul,
-                                        offset, components, vectors,
-                                        transpose, cols, rows, basicType);
+         if (copy_uniform_matrix_to_storage(ctx, storage, uni, count, values,
+                                            size_mul, offset, components,
+                                            vectors, transpose, cols, rows,
+                                            basicType, flush))
+            flush = false;
       }
    } else {
       storage =  &uni->storage[size_mul * elements * offset];
-      copy_uniform_matrix_to_storage(storage, count, values, size_mul, offset,
-                                     components, vectors, transpose, cols,
-                                     rows, basicType);
-
-      _mesa_propagate_uniforms_to_driver_storage(uni, offset, count);
+      if (copy_uniform_matrix_to_storage(ctx, storage, uni, count, values,
+                                         size_mul, offset, components,
+                                         vectors, transpose, cols, rows,
+                                         basicType, true))
+         _mesa_propagate_uniforms_to_driver_storage(uni, offset, count);
    }
 }
 
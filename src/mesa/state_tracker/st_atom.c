@@ -37,6 +37,8 @@
 #include "st_program.h"
 #include "st_manager.h"
 #include "st_util.h"
+#include "st_debug.h"
+#include "util/os_time.h"
 
 
 typedef void (*update_func_t)(struct st_context *st);
@@ -49,16 +51,64 @@ static const update_func_t update_functions[] =
 #undef ST_STATE
 };
 
+static const char *update_names[] =
+{
+#define ST_STATE(FLAG, st_update) #st_update,
+#include "st_atom_list.h"
+#undef ST_STATE
+};
+
+struct st_atom_stats
+{
+   unsigned calls[ARRAY_SIZE(update_functions)];
+   int64_t nanoseconds[ARRAY_SIZE(update_functions)];
+};
+
 
 void st_init_atoms( struct st_context *st )
 {
    STATIC_ASSERT(ARRAY_SIZE(update_functions) <= 64);
+
+   if (ST_DEBUG & DEBUG_ATOMS)
+      st->atom_stats = CALLOC_STRUCT(st_atom_stats);
 }
 
 
 void st_destroy_atoms( struct st_context *st )
 {
-   /* no-op */
+   struct st_atom_stats *stats = st->atom_stats;
+
+   if (!stats)
+      return;
+
+   debug_printf("Mesa: state atom timings:\n");
+   for (unsigned i = 0; i < ARRAY_SIZE(update_functions); i++) {
+      if (!stats->calls[i])
+         continue;
+
+      debug_printf("   %-32s %10u calls %12.3f ms %8.3f us/call\n",
+                   update_names[i], stats->calls[i],
+                   stats->nanoseconds[i] / 1000000.0,
+                   stats->nanoseconds[i] / 1000.0 / stats->calls[i]);
+   }
+
+   free(stats);
+   st->atom_stats = NULL;
+}
+
+
+/**
+ * Run the update function of one atom and account for the time spent.
+ */
+static void
+update_atom_timed(struct st_context *st, unsigned index)
+{
+   int64_t start = os_time_get_nano();
+
+   update_functions[index](st);
+
+   st->atom_stats->nanoseconds[index] += os_time_get_nano() - start;
+   st->atom_stats->calls[index]++;
 }
 
 
@@ -188,6 +238,16 @@ void st_validate_state( struct st_context *st, enum st_pipeline pipeline )
       if (st->ctx->API == API_OPENGL_COMPAT)
          check_attrib_edgeflag(st);
 
+      /* Draws between which only uniforms changed don't need the program
+       * and framebuffer checks, because nothing they look at has changed.
+       * (winsys framebuffer changes set gfx_shaders_may_be_dirty)
+       */
+      if (!st->gfx_shaders_may_be_dirty &&
+          !(st->dirty & ST_PIPELINE_RENDER_STATE_MASK & ~ST_NEW_CONSTANTS)) {
+         pipeline_mask = ST_PIPELINE_RENDER_STATE_MASK & ST_NEW_CONSTANTS;
+         break;
+      }
+
       if (st->gfx_shaders_may_be_dirty) {
          check_program_state(st);
          st->gfx_shaders_may_be_dirty = false;
@@ -253,6 +313,16 @@ void st_validate_state( struct st_context *st, enum st_pipeline pipeline )
    dirty_lo = dirty;
    dirty_hi = dirty >> 32;
 
+   if (unlikely(st->atom_stats)) {
+      while (dirty_lo)
+         update_atom_timed(st, u_bit_scan(&dirty_lo));
+      while (dirty_hi)
+         update_atom_timed(st, 32 + u_bit_scan(&dirty_hi));
+
+      st->dirty &= ~pipeline_mask;
+      return;
+   }
+
    /* Update states.
     *
     * Don't use u_bit_scan64, it may be slower on 32-bit.
@@ -383,6 +383,19 @@ set_vertex_attribs(struct st_context *st,
    cso_set_vertex_elements(cso, num_velements, velements);
 }
 
+/**
+ * Vertex elements of the arrays of a VAO, cached in
+ * gl_vertex_array_object::DriverCache.  The vertex buffers aren't cached,
+ * because the buffer storage can change without the VAO changing.
+ */
+struct st_vao_velements
+{
+   unsigned vao_generation;
+   unsigned vp_variant_serial;
+   GLbitfield enabled_arrays;
+   struct pipe_vertex_element velements[PIPE_MAX_ATTRIBS];
+};
+
 void
 st_setup_arrays(struct st_context *st,
                 const struct st_vertex_program *vp,
@@ -391,12 +404,27 @@ st_setup_arrays(struct st_context *st,
                 struct pipe_vertex_buffer *vbuffer, unsigned *num_vbuffers)
 {
    struct gl_context *ctx = st->ctx;
-   const struct gl_vertex_array_object *vao = ctx->Array._DrawVAO;
+   struct gl_vertex_array_object *vao = ctx->Array._DrawVAO;
    const GLbitfield inputs_read = vp_variant->vert_attrib_mask;
    const ubyte *input_to_index = vp->input_to_index;
+   const GLbitfield enabled_arrays = _mesa_draw_array_bits(ctx);
+   struct st_vao_velements *cache = NULL;
+   bool cached_velements = false;
+
+   /* Shared VAOs can be used by several contexts at once. */
+   if (!vao->SharedAndImmutable) {
+      cache = vao->DriverCache;
+      if (!cache)
+         cache = vao->DriverCache = calloc(1, sizeof(*cache));
+
+      cached_velements = cache &&
+                         cache->vp_variant_serial == vp_variant->serial &&
+                         cache->vao_generation == vao->_Generation &&
+                         cache->enabled_arrays == enabled_arrays;
+   }
 
    /* Process attribute array data. */
-   GLbitfield mask = inputs_read & _mesa_draw_array_bits(ctx);
+   GLbitfield mask = inputs_read & enabled_arrays;
    while (mask) {
       /* The attribute index to start pulling a binding */
       const gl_vert_attrib i = ffs(mask) - 1;
@@ -440,6 +468,10 @@ st_setup_arrays(struct st_context *st,
       mask &= ~boundmask;
       /* We can assume that we have array for the binding */
       assert(attrmask);
+
+      if (cached_velements)
+         continue;
+
       /* Walk attributes belonging to the binding */
       while (attrmask) {
          const gl_vert_attrib attr = u_bit_scan(&attrmask);
@@ -451,6 +483,22 @@ st_setup_arrays(struct st_context *st,
                                input_to_index[attr]);
       }
    }
+
+   if (!cache)
+      return;
+
+   /* The entries of attributes not coming from arrays are overwritten by
+    * the caller, so the whole array can be copied.
+    */
+   const unsigned size = vp_variant->num_inputs * sizeof(velements[0]);
+   if (cached_velements) {
+      memcpy(velements, cache->velements, size);
+   } else {
+      memcpy(cache->velements, velements, size);
+      cache->vao_generation = vao->_Generation;
+      cache->vp_variant_serial = vp_variant->serial;
+      cache->enabled_arrays = enabled_arrays;
+   }
 }
 
 void
@@ -38,6 +38,7 @@
 #include "main/mtypes.h"
 #include "main/arrayobj.h"
 #include "main/bufferobj.h"
+#include "main/streaming-load-memcpy.h"
 
 #include "st_context.h"
 #include "st_cb_bufferobjects.h"
@@ -168,8 +169,16 @@ st_bufferobj_get_subdata(struct gl_context *ctx,
       return;
    }
 
-   pipe_buffer_read(st_context(ctx)->pipe, st_obj->buffer,
-                    offset, size, data);
+   struct pipe_transfer *transfer;
+   void *map = pipe_buffer_map_range(st_context(ctx)->pipe, st_obj->buffer,
+                                     offset, size, PIPE_TRANSFER_READ,
+                                     &transfer);
+   if (!map)
+      return;
+
+   /* The buffer may be mapped write-combined. */
+   _mesa_readback_memcpy(data, map, size);
+   pipe_buffer_unmap(st_context(ctx)->pipe, transfer);
 }
 
 
@@ -30,6 +30,7 @@
 #include "main/pbo.h"
 #include "main/imports.h"
 #include "main/readpix.h"
+#include "main/streaming-load-memcpy.h"
 #include "main/enums.h"
 #include "main/framebuffer.h"
 #include "util/u_inlines.h"
@@ -254,6 +255,33 @@ fail:
    return success;
 }
 
+/**
+ * Choose the format of the shader image that writes the pixels into the
+ * pack buffer.  Unlike the staging texture of the blit path, it doesn't
+ * have to be renderable, and depth values are stored as color.
+ */
+static enum pipe_format
+choose_pbo_download_format(struct st_context *st, GLenum format, GLenum type,
+                           GLboolean swap_bytes)
+{
+   enum pipe_format dst_format;
+
+   dst_format = st_choose_matching_format(st, 0, format, type, swap_bytes);
+
+   switch (dst_format) {
+   case PIPE_FORMAT_Z16_UNORM:
+      return PIPE_FORMAT_R16_UNORM;
+   case PIPE_FORMAT_Z32_UNORM:
+      return PIPE_FORMAT_R32_UNORM;
+   case PIPE_FORMAT_Z32_FLOAT:
+      return PIPE_FORMAT_R32_FLOAT;
+   default:
+      if (util_format_is_depth_or_stencil(dst_format))
+         return PIPE_FORMAT_NONE;
+      return dst_format;
+   }
+}
+
 /**
  * Create a staging texture and blit the requested region to it.
  */
@@ -420,10 +448,6 @@ st_ReadPixels(struct gl_context *ctx, GLint x, GLint y,
    st_validate_state(st, ST_PIPELINE_UPDATE_FRAMEBUFFER);
    st_flush_bitmap_cache(st);
 
-   if (!st->prefer_blit_based_texture_transfer) {
-      goto fallback;
-   }
-
    /* This must be done after state validation. */
    src = strb->texture;
 
@@ -457,6 +481,26 @@ st_ReadPixels(struct gl_context *ctx, GLint x, GLint y,
       goto fallback;
    }
 
+   /* Reading into a pack buffer on the GPU doesn't stall the application,
+    * so try it even if the driver doesn't prefer blits.
+    */
+   if (st->pbo.download_enabled && _mesa_is_bufferobj(pack->BufferObj)) {
+      dst_format = choose_pbo_download_format(st, format, type,
+                                              pack->SwapBytes);
+
+      if (dst_format != PIPE_FORMAT_NONE &&
+          try_pbo_readpixels(st, strb,
+                             st_fb_orientation(ctx->ReadBuffer) == Y_0_TOP,
+                             x, y, width, height,
+                             src_format, dst_format,
+                             pack, pixels))
+         return;
+   }
+
+   if (!st->prefer_blit_based_texture_transfer) {
+      goto fallback;
+   }
+
    if (format == GL_DEPTH_COMPONENT || format == GL_DEPTH_STENCIL)
       bind = PIPE_BIND_DEPTH_STENCIL;
    else
@@ -470,15 +514,6 @@ st_ReadPixels(struct gl_context *ctx, GLint x, GLint y,
       goto fallback;
    }
 
-   if (st->pbo.download_enabled && _mesa_is_bufferobj(pack->BufferObj)) {
-      if (try_pbo_readpixels(st, strb,
-                             st_fb_orientation(ctx->ReadBuffer) == Y_0_TOP,
-                             x, y, width, height,
-                             src_format, dst_format,
-                             pack, pixels))
-         return;
-   }
-
    if (needs_integer_signed_unsigned_conversion(ctx, format, type)) {
       goto fallback;
    }
@@ -532,12 +567,12 @@ st_ReadPixels(struct gl_context *ctx, GLint x, GLint y,
                                          type, 0, 0);
 
       if (tex_xfer->stride == bytesPerRow && destStride == bytesPerRow) {
-         memcpy(dest, map, bytesPerRow * height);
+         _mesa_readback_memcpy(dest, map, bytesPerRow * height);
       } else {
          GLuint row;
 
          for (row = 0; row < (unsigned) height; row++) {
-            memcpy(dest, map, bytesPerRow);
+            _mesa_readback_memcpy(dest, map, bytesPerRow);
             map += tex_xfer->stride;
             dest += destStride;
          }
@@ -75,6 +75,7 @@
 #include "util/u_sampler.h"
 #include "util/u_math.h"
 #include "util/u_box.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_simple_shaders.h"
 #include "cso_cache/cso_context.h"
 #include "tgsi/tgsi_ureg.h"
@@ -327,6 +328,113 @@ st_MapTextureImage(struct gl_context *ctx,
 }
 
 
+/* Uploads smaller than this are converted by the calling thread alone. */
+#define ST_TEXSTORE_THREADED_MIN_SIZE (1024 * 1024)
+#define ST_TEXSTORE_MAX_JOBS 8
+
+static bool
+st_init_texstore_queue(struct st_context *st)
+{
+   if (util_cpu_caps.nr_cpus < 2)
+      return false;
+
+   return util_queue_is_initialized(&st->texstore_queue) ||
+          util_queue_init(&st->texstore_queue, "st_texstore",
+                          ST_TEXSTORE_MAX_JOBS,
+                          MIN2(util_cpu_caps.nr_cpus, ST_TEXSTORE_MAX_JOBS) - 1,
+                          0);
+}
+
+/** A band of block rows of a compressed fallback image */
+struct st_decompress_job {
+   mesa_format format;
+   bool bgra;
+   uint8_t *dst;
+   unsigned dst_stride;
+   const uint8_t *src;
+   unsigned src_stride;
+   unsigned width, height;
+   struct util_queue_fence fence;
+};
+
+static void
+st_decompress_execute(void *data, UNUSED int thread_index)
+{
+   struct st_decompress_job *job = data;
+
+   if (job->format == MESA_FORMAT_ETC1_RGB8) {
+      _mesa_etc1_unpack_rgba8888(job->dst, job->dst_stride,
+                                 job->src, job->src_stride,
+                                 job->width, job->height);
+   } else if (_mesa_is_format_etc2(job->format)) {
+      _mesa_unpack_etc2_format(job->dst, job->dst_stride,
+                               job->src, job->src_stride,
+                               job->width, job->height,
+                               job->format, job->bgra);
+   } else if (_mesa_is_format_astc_2d(job->format)) {
+      _mesa_unpack_astc_2d_ldr(job->dst, job->dst_stride,
+                               job->src, job->src_stride,
+                               job->width, job->height,
+                               job->format);
+   } else {
+      unreachable("unexpected format for a compressed format fallback");
+   }
+}
+
+/**
+ * Decompress an image of a compressed format the driver doesn't support.
+ * Blocks decode independently, so large images are split into bands of
+ * block rows over the texstore threads.
+ */
+static void
+st_decompress_fallback(struct st_context *st, mesa_format format, bool bgra,
+                       uint8_t *dst, unsigned dst_stride,
+                       const uint8_t *src, unsigned src_stride,
+                       unsigned width, unsigned height)
+{
+   struct st_decompress_job jobs[ST_TEXSTORE_MAX_JOBS];
+   unsigned num_jobs = 1, blk_w, blk_h, y_blocks, blocks_per_job, i;
+
+   _mesa_get_format_block_size(format, &blk_w, &blk_h);
+   y_blocks = DIV_ROUND_UP(height, blk_h);
+
+   /* The decoded image is 4 bytes per texel. */
+   if ((size_t)width * height * 4 >= ST_TEXSTORE_THREADED_MIN_SIZE &&
+       st_init_texstore_queue(st))
+      num_jobs = MIN2(st->texstore_queue.num_threads + 1, y_blocks);
+
+   blocks_per_job = DIV_ROUND_UP(y_blocks, num_jobs);
+   num_jobs = DIV_ROUND_UP(y_blocks, blocks_per_job);
+
+   for (i = 0; i < num_jobs; i++) {
+      struct st_decompress_job *job = &jobs[i];
+      unsigned y = i * blocks_per_job * blk_h;
+
+      job->format = format;
+      job->bgra = bgra;
+      job->dst = dst + y * dst_stride;
+      job->dst_stride = dst_stride;
+      job->src = src + i * blocks_per_job * src_stride;
+      job->src_stride = src_stride;
+      job->width = width;
+      job->height = MIN2(blocks_per_job * blk_h, height - y);
+      util_queue_fence_init(&job->fence);
+
+      /* The first band is decoded by the calling thread. */
+      if (i)
+         util_queue_add_job(&st->texstore_queue, job, &job->fence,
+                            st_decompress_execute, NULL);
+   }
+
+   st_decompress_execute(&jobs[0], 0);
+
+   for (i = 0; i < num_jobs; i++) {
+      util_queue_fence_wait(&jobs[i].fence);
+      util_queue_fence_destroy(&jobs[i].fence);
+   }
+}
+
+
 /** called via ctx->Driver.UnmapTextureImage() */
 static void
 st_UnmapTextureImage(struct gl_context *ctx,
@@ -346,29 +454,13 @@ st_UnmapTextureImage(struct gl_context *ctx,
       assert(z == transfer->box.z);
 
       if (transfer->usage & PIPE_TRANSFER_WRITE) {
-         if (texImage->TexFormat == MESA_FORMAT_ETC1_RGB8) {
-            _mesa_etc1_unpack_rgba8888(itransfer->map, transfer->stride,
-                                       itransfer->temp_data,
-                                       itransfer->temp_stride,
-                                       transfer->box.width,
-                                       transfer->box.height);
-         } else if (_mesa_is_format_etc2(texImage->TexFormat)) {
-            bool bgra = stImage->pt->format == PIPE_FORMAT_B8G8R8A8_SRGB;
-            _mesa_unpack_etc2_format(itransfer->map, transfer->stride,
-                                     itransfer->temp_data,
-                                     itransfer->temp_stride,
-                                     transfer->box.width, transfer->box.height,
-                                     texImage->TexFormat,
-                                     bgra);
-         } else if (_mesa_is_format_astc_2d(texImage->TexFormat)) {
-            _mesa_unpack_astc_2d_ldr(itransfer->map, transfer->stride,
-                                     itransfer->temp_data,
-                                     itransfer->temp_stride,
-                                     transfer->box.width, transfer->box.height,
-                                     texImage->TexFormat);
-         } else {
-            unreachable("unexpected format for a compressed format fallback");
-         }
+         bool bgra = _mesa_is_format_etc2(texImage->TexFormat) &&
+                     stImage->pt->format == PIPE_FORMAT_B8G8R8A8_SRGB;
+
+         st_decompress_fallback(st, texImage->TexFormat, bgra,
+                                itransfer->map, transfer->stride,
+                                itransfer->temp_data, itransfer->temp_stride,
+                                transfer->box.width, transfer->box.height);
       }
 
       itransfer->temp_data = NULL;
@@ -1306,6 +1398,79 @@ fail:
 }
 
 
+/**
+ * Copy pixels from client memory into a temporary buffer with tightly
+ * packed rows, so that the PBO upload shader can convert them on the GPU.
+ * The dimensions in \p addr are in gallium terms.
+ */
+static struct pipe_resource *
+upload_client_pixels(struct st_context *st, GLuint dims, GLenum gl_target,
+                     GLenum format, GLenum type, const void *pixels,
+                     const struct gl_pixelstore_attrib *unpack,
+                     struct st_pbo_addresses *addr)
+{
+   struct pipe_context *pipe = st->pipe;
+   const unsigned bytes_per_row = addr->width * addr->bytes_per_pixel;
+   struct pipe_resource *buffer;
+   struct pipe_transfer *transfer;
+   GLubyte *map;
+   unsigned z, y;
+
+   if (addr->width * addr->height * addr->depth >
+       st->ctx->Const.MaxTextureBufferSize)
+      return NULL;
+
+   util_throttle_memory_usage(pipe, &st->throttle,
+                              bytes_per_row * addr->height * addr->depth);
+
+   buffer = pipe_buffer_create(pipe->screen, PIPE_BIND_SAMPLER_VIEW,
+                               PIPE_USAGE_STREAM,
+                               bytes_per_row * addr->height * addr->depth);
+   if (!buffer)
+      return NULL;
+
+   map = pipe_buffer_map(pipe, buffer,
+                         PIPE_TRANSFER_WRITE |
+                         PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE,
+                         &transfer);
+   if (!map) {
+      pipe_resource_reference(&buffer, NULL);
+      return NULL;
+   }
+
+   for (z = 0; z < addr->depth; z++) {
+      for (y = 0; y < addr->height; y++) {
+         const void *src;
+
+         /* Convert gallium coordinates back to GL coordinates. */
+         if (gl_target == GL_TEXTURE_1D_ARRAY)
+            src = _mesa_image_address2d(unpack, pixels, addr->width,
+                                        addr->depth, format, type, z, 0);
+         else
+            src = _mesa_image_address(dims, unpack, pixels, addr->width,
+                                      addr->height, format, type, z, y, 0);
+
+         memcpy(map, src, bytes_per_row);
+         map += bytes_per_row;
+      }
+   }
+
+   pipe_buffer_unmap(pipe, transfer);
+
+   addr->pixels_per_row = addr->width;
+   addr->image_height = addr->height;
+
+   if (!st_pbo_addresses_setup(st, buffer, 0, addr))
+      pipe_resource_reference(&buffer, NULL);
+
+   return buffer;
+}
+
+
+/**
+ * Upload with the PBO upload shader, which converts the pixels on the GPU.
+ * Pixels in client memory are copied into a temporary buffer first.
+ */
 static bool
 try_pbo_upload(struct gl_context *ctx, GLuint dims,
                struct gl_texture_image *texImage,
@@ -1323,6 +1488,7 @@ try_pbo_upload(struct gl_context *ctx, GLuint dims,
    struct pipe_context *pipe = st->pipe;
    struct pipe_screen *screen = pipe->screen;
    struct pipe_surface *surface = NULL;
+   struct pipe_resource *upload = NULL;
    struct st_pbo_addresses addr;
    enum pipe_format src_format;
    const struct util_format_description *desc;
@@ -1390,9 +1556,16 @@ try_pbo_upload(struct gl_context *ctx, GLuint dims,
    addr.depth = depth;
    addr.bytes_per_pixel = desc->block.bits / 8;
 
-   if (!st_pbo_addresses_pixelstore(st, gl_target, dims == 3, unpack, pixels,
-                                    &addr))
-      return false;
+   if (_mesa_is_bufferobj(unpack->BufferObj)) {
+      if (!st_pbo_addresses_pixelstore(st, gl_target, dims == 3, unpack,
+                                       pixels, &addr))
+         return false;
+   } else {
+      upload = upload_client_pixels(st, dims, gl_target, format, type,
+                                    pixels, unpack, &addr);
+      if (!upload)
+         return false;
+   }
 
    /* Set up the surface */
    {
@@ -1410,18 +1583,158 @@ try_pbo_upload(struct gl_context *ctx, GLuint dims,
       templ.u.tex.last_layer = MIN2(zoffset + depth - 1, max_layer);
 
       surface = pipe->create_surface(pipe, texture, &templ);
-      if (!surface)
+      if (!surface) {
+         pipe_resource_reference(&upload, NULL);
          return false;
+      }
    }
 
    success = try_pbo_upload_common(ctx, surface, &addr, src_format);
 
    pipe_surface_reference(&surface, NULL);
+   pipe_resource_reference(&upload, NULL);
 
    return success;
 }
 
 
+struct st_texstore_job {
+   struct gl_context *ctx;
+   const struct gl_texture_image *texImage;
+   GLubyte *dst;
+   GLint dst_row_stride;
+   GLint width, height;
+   GLenum format, type;
+   const void *pixels;
+   struct gl_pixelstore_attrib unpack;
+   struct util_queue_fence fence;
+   GLboolean success;
+};
+
+static void
+st_texstore_execute(void *data, UNUSED int thread_index)
+{
+   struct st_texstore_job *job = data;
+
+   job->success = _mesa_texstore(job->ctx, 2, job->texImage->_BaseFormat,
+                                 job->texImage->TexFormat,
+                                 job->dst_row_stride, &job->dst,
+                                 job->width, job->height, 1,
+                                 job->format, job->type, job->pixels,
+                                 &job->unpack);
+}
+
+/**
+ * Software fallback for large 2D uploads: split the image into bands of
+ * rows and convert them with _mesa_texstore on several threads.
+ *
+ * \return false if the image isn't suitable and _mesa_store_texsubimage
+ *         should be used instead
+ */
+static bool
+st_texstore_threaded(struct gl_context *ctx,
+                     struct gl_texture_image *texImage,
+                     GLint xoffset, GLint yoffset,
+                     GLint width, GLint height, GLint depth,
+                     GLenum format, GLenum type, const void *pixels,
+                     const struct gl_pixelstore_attrib *unpack)
+{
+   struct st_context *st = st_context(ctx);
+   struct st_texstore_job jobs[ST_TEXSTORE_MAX_JOBS];
+   unsigned num_jobs, rows_per_job, i;
+   GLbitfield map_mode;
+   GLubyte *map;
+   GLint row_stride;
+   GLboolean success = GL_TRUE;
+
+   switch (texImage->TexObject->Target) {
+   case GL_TEXTURE_2D:
+   case GL_TEXTURE_RECTANGLE:
+   case GL_TEXTURE_CUBE_MAP:
+      break;
+   default:
+      return false;
+   }
+
+   /* Pixel transfer ops and compressed formats don't work on independent
+    * bands of rows.
+    */
+   if (depth != 1 || ctx->_ImageTransferState ||
+       _mesa_is_format_compressed(texImage->TexFormat))
+      return false;
+
+   if ((size_t)width * height * _mesa_get_format_bytes(texImage->TexFormat) <
+       ST_TEXSTORE_THREADED_MIN_SIZE)
+      return false;
+
+   if (!st_init_texstore_queue(st))
+      return false;
+
+   pixels = _mesa_validate_pbo_teximage(ctx, 2, width, height, 1,
+                                        format, type, pixels, unpack,
+                                        "glTexSubImage");
+   if (!pixels)
+      return true; /* GL error */
+
+   if ((format == GL_STENCIL_INDEX || format == GL_DEPTH_COMPONENT) &&
+       _mesa_get_format_base_format(texImage->TexFormat) == GL_DEPTH_STENCIL)
+      map_mode = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT;
+   else
+      map_mode = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+
+   st_MapTextureImage(ctx, texImage, 0, xoffset, yoffset, width, height,
+                      map_mode, &map, &row_stride);
+   if (!map) {
+      _mesa_unmap_teximage_pbo(ctx, unpack);
+      _mesa_error(ctx, GL_OUT_OF_MEMORY, "glTexSubImage");
+      return true;
+   }
+
+   num_jobs = MIN2(st->texstore_queue.num_threads + 1, (unsigned) height);
+   rows_per_job = DIV_ROUND_UP(height, num_jobs);
+   num_jobs = DIV_ROUND_UP(height, rows_per_job);
+
+   for (i = 0; i < num_jobs; i++) {
+      struct st_texstore_job *job = &jobs[i];
+      unsigned y = i * rows_per_job;
+
+      job->ctx = ctx;
+      job->texImage = texImage;
+      job->dst = map + y * row_stride;
+      job->dst_row_stride = row_stride;
+      job->width = width;
+      job->height = MIN2(rows_per_job, height - y);
+      job->format = format;
+      job->type = type;
+      job->pixels = pixels;
+      job->unpack = *unpack;
+      job->unpack.SkipRows += y;
+      util_queue_fence_init(&job->fence);
+
+      /* The first band is converted by the calling thread. */
+      if (i)
+         util_queue_add_job(&st->texstore_queue, job, &job->fence,
+                            st_texstore_execute, NULL);
+   }
+
+   st_texstore_execute(&jobs[0], 0);
+
+   for (i = 0; i < num_jobs; i++) {
+      util_queue_fence_wait(&jobs[i].fence);
+      util_queue_fence_destroy(&jobs[i].fence);
+      success &= jobs[i].success;
+   }
+
+   st_UnmapTextureImage(ctx, texImage, 0);
+   _mesa_unmap_teximage_pbo(ctx, unpack);
+
+   if (!success)
+      _mesa_error(ctx, GL_OUT_OF_MEMORY, "glTexSubImage");
+
+   return true;
+}
+
+
 static void
 st_TexSubImage(struct gl_context *ctx, GLuint dims,
                struct gl_texture_image *texImage,
@@ -1553,7 +1866,7 @@ st_TexSubImage(struct gl_context *ctx, GLuint dims,
    src_format = st_choose_matching_format(st, PIPE_BIND_SAMPLER_VIEW,
                                           format, type, unpack->SwapBytes);
    if (!src_format) {
-      goto fallback;
+      goto convert;
    }
 
    mesa_src_format = st_pipe_format_to_mesa_format(src_format);
@@ -1564,7 +1877,7 @@ st_TexSubImage(struct gl_context *ctx, GLuint dims,
    if (!_mesa_texstore_can_use_memcpy(ctx,
                              _mesa_get_format_base_format(mesa_src_format),
                              mesa_src_format, format, type, unpack)) {
-      goto fallback;
+      goto convert;
    }
 
    /* TexSubImage only sets a single cubemap face. */
@@ -1690,12 +2003,29 @@ st_TexSubImage(struct gl_context *ctx, GLuint dims,
    pipe_resource_reference(&src, NULL);
    return;
 
+convert:
+   /* The blit can't convert the client's format and type, but the PBO
+    * upload shader may.
+    */
+   if (pixels && !_mesa_is_bufferobj(unpack->BufferObj) &&
+       !ctx->_ImageTransferState &&
+       try_pbo_upload(ctx, dims, texImage, format, type, dst_format,
+                      xoffset, yoffset, zoffset,
+                      width, height, depth, pixels, unpack))
+      return;
+
 fallback:
    if (!throttled) {
       util_throttle_memory_usage(pipe, &st->throttle,
                                  width * height * depth *
                                  _mesa_get_format_bytes(texImage->TexFormat));
    }
+
+   if (st_texstore_threaded(ctx, texImage, xoffset, yoffset,
+                            width, height, depth, format, type, pixels,
+                            unpack))
+      return;
+
    _mesa_store_texsubimage(ctx, dims, texImage, xoffset, yoffset, zoffset,
                            width, height, depth, format, type, pixels,
                            unpack);
@@ -2607,6 +2937,7 @@ st_finalize_texture(struct gl_context *ctx,
    enum pipe_format firstImageFormat;
    unsigned ptWidth;
    uint16_t ptHeight, ptDepth, ptLayers, ptNumSamples;
+   bool blit_batch = false;
 
    if (tObj->Immutable)
       return GL_TRUE;
@@ -2782,12 +3113,19 @@ st_finalize_texture(struct gl_context *ctx,
                  stImage->base.Height == height &&
                  stImage->base.Depth == depth)) {
                /* src image fits expected dest mipmap level size */
+               if (!blit_batch && stImage->pt && pipe->begin_blit_batch) {
+                  pipe->begin_blit_batch(pipe);
+                  blit_batch = true;
+               }
                copy_image_data_to_texture(st, stObj, level, stImage);
             }
          }
       }
    }
 
+   if (blit_batch)
+      pipe->end_blit_batch(pipe);
+
    stObj->validated_first_level = stObj->base.BaseLevel;
    stObj->validated_last_level = stObj->lastLevel;
    stObj->needs_validation = false;
@@ -35,6 +35,7 @@
 #include "state_tracker/st_atom.h"
 #include "util/u_helpers.h"
 #include "util/u_inlines.h"
+#include "util/u_queue.h"
 #include "util/list.h"
 #include "vbo/vbo.h"
 #include "util/list.h"
@@ -208,6 +209,9 @@ struct st_context
 
    uint64_t dirty; /**< dirty states */
 
+   /** Per-atom call counts and CPU time, only with ST_DEBUG=atoms. */
+   struct st_atom_stats *atom_stats;
+
    /** This masks out unused shader resources. Only valid in draw calls. */
    uint64_t active_states;
 
@@ -335,6 +339,11 @@ struct st_context
     */
    struct util_throttle throttle;
 
+   /* Worker threads for converting large texture uploads on the CPU,
+    * created on first use.
+    */
+   struct util_queue texstore_queue;
+
    struct {
       struct st_zombie_sampler_view_node list;
       mtx_t mutex;
@@ -63,6 +63,7 @@
 #include "st_nir.h"
 #include "st_shader_cache.h"
 #include "cso_cache/cso_context.h"
+#include "util/u_atomic.h"
 
 
 
@@ -646,9 +647,12 @@ st_create_vp_variant(struct st_context *st,
    struct pipe_context *pipe = st->pipe;
    struct gl_program_parameter_list *params = stvp->Base.Parameters;
 
+   static unsigned serial;
+
    vpv->key = *key;
    vpv->tgsi.stream_output = stvp->tgsi.stream_output;
    vpv->num_inputs = stvp->num_inputs;
+   vpv->serial = p_atomic_inc_return(&serial);
 
    /* When generating a NIR program, we usually don't have TGSI tokens.
     * However, we do create them for ARB_vertex_program / fixed-function VS
@@ -224,6 +224,9 @@ struct st_vp_variant
 
    /** Bitfield of VERT_BIT_* bits of mesa vertex processing inputs */
    GLbitfield vert_attrib_mask;
+
+   /** Unique among all variants, for caches keyed on the variant */
+   unsigned serial;
 };
 
 
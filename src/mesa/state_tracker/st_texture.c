@@ -384,6 +384,9 @@ st_texture_image_copy(struct pipe_context *pipe,
       depth = src->array_size;
    }
 
+   if (pipe->begin_blit_batch)
+      pipe->begin_blit_batch(pipe);
+
    /* Loop over 3D image slices */
    /* could (and probably should) use "true" 3d box here -
       but drivers can't quite handle it yet */
@@ -402,6 +405,9 @@ st_texture_image_copy(struct pipe_context *pipe,
                                  srcLevel,
                                  &src_box);
    }
+
+   if (pipe->end_blit_batch)
+      pipe->end_blit_batch(pipe);
 }
 
 
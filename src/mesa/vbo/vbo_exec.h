@@ -49,7 +49,7 @@ USE OR OTHER DEALINGS IN THE SOFTWARE.
 /**
  * Size (in bytes) of the VBO to use for glBegin/glVertex/glEnd-style rendering.
  */
-#define VBO_VERT_BUFFER_SIZE (1024 * 64)
+#define VBO_VERT_BUFFER_SIZE (1024 * 1024)
 
 
 struct vbo_exec_eval1_map {
@@ -87,6 +87,10 @@ struct vbo_exec_context
       fi_type *buffer_map;
       fi_type *buffer_ptr;              /* cursor, points into buffer */
       GLuint   buffer_used;             /* in bytes */
+
+      /* The buffer object stays mapped between draws, see vbo_exec_vtx_map */
+      bool persistent;
+
       fi_type vertex[VBO_ATTRIB_MAX*4]; /* current vertex */
 
       GLuint vert_count;   /**< Number of vertices currently in buffer */
@@ -111,6 +115,14 @@ struct vbo_exec_context
    /* Which flags to set in vbo_exec_begin_vertices() */
    GLbitfield begin_vertices_flags;
 
+   /* Why stored vertices were drawn, printed with MESA_VERBOSE=draw */
+   struct {
+      unsigned buffer_full;
+      unsigned prim_limit;
+      unsigned vertex_upgrade;
+      unsigned flush_vertices;
+   } flush_stats;
+
 #ifndef NDEBUG
    GLint flush_call_depth;
 #endif
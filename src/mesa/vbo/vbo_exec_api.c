@@ -133,6 +133,8 @@ vbo_exec_vtx_wrap(struct vbo_exec_context *exec)
 {
    unsigned numComponents;
 
+   exec->flush_stats.buffer_full++;
+
    /* Run pipeline on current vertices, copy wrapped vertices
     * to exec->vtx.copied.
     */
@@ -281,6 +283,9 @@ vbo_exec_wrap_upgrade_vertex(struct vbo_exec_context *exec,
 
    assert(attr < VBO_ATTRIB_MAX);
 
+   if (lastcount)
+      exec->flush_stats.vertex_upgrade++;
+
    /* Run pipeline on current vertices, copy wrapped vertices
     * to exec->vtx.copied.
     */
@@ -471,6 +476,24 @@ is_vertex_position(const struct gl_context *ctx, GLuint index)
 }
 
 
+/**
+ * Copy the current vertex to the vertex buffer.  The blocks of four
+ * dwords let the compiler use vector loads and stores, which also fill
+ * write-combined mappings faster.
+ */
+static inline void
+vbo_exec_copy_vertex(fi_type *restrict dst, const fi_type *restrict src,
+                     unsigned size)
+{
+   unsigned i = 0;
+
+   for (; i + 4 <= size; i += 4)
+      memcpy(dst + i, src + i, 4 * sizeof(fi_type));
+   for (; i < size; i++)
+      dst[i] = src[i];
+}
+
+
 /**
  * This macro is used to implement all the glVertex, glColor, glTexCoord,
  * glVertexAttrib, etc functions.
@@ -505,8 +528,6 @@ do {                                                                    \
                                                                         \
    if ((A) == 0) {                                                      \
       /* This is a glVertex call */                                     \
-      GLuint i;                                                         \
-                                                                        \
       if (unlikely((ctx->Driver.NeedFlush & FLUSH_UPDATE_CURRENT) == 0)) { \
          vbo_exec_begin_vertices(ctx);                                  \
       }                                                                 \
@@ -516,9 +537,8 @@ do {                                                                    \
       }                                                                 \
       assert(exec->vtx.buffer_ptr);                                     \
                                                                         \
-      /* copy 32-bit words */                                           \
-      for (i = 0; i < exec->vtx.vertex_size; i++)                       \
-         exec->vtx.buffer_ptr[i] = exec->vtx.vertex[i];                 \
+      vbo_exec_copy_vertex(exec->vtx.buffer_ptr, exec->vtx.vertex,     \
+                           exec->vtx.vertex_size);                      \
                                                                         \
       exec->vtx.buffer_ptr += exec->vtx.vertex_size;                    \
                                                                         \
@@ -648,6 +668,9 @@ vbo_Materialfv(GLenum face, GLenum pname, const GLfloat *params)
 static void
 vbo_exec_FlushVertices_internal(struct vbo_exec_context *exec, GLboolean unmap)
 {
+   if (exec->vtx.vert_count)
+      exec->flush_stats.flush_vertices++;
+
    if (exec->vtx.vert_count || unmap) {
       vbo_exec_vtx_flush(exec, unmap);
    }
@@ -914,8 +937,10 @@ vbo_exec_End(void)
 
    ctx->Driver.CurrentExecPrimitive = PRIM_OUTSIDE_BEGIN_END;
 
-   if (exec->vtx.prim_count == VBO_MAX_PRIM)
+   if (exec->vtx.prim_count == VBO_MAX_PRIM) {
+      exec->flush_stats.prim_limit++;
       vbo_exec_vtx_flush(exec, GL_FALSE);
+   }
 
    if (MESA_DEBUG_FLAGS & DEBUG_ALWAYS_FLUSH) {
       _mesa_flush(ctx);
@@ -1214,6 +1239,15 @@ vbo_exec_vtx_destroy(struct vbo_exec_context *exec)
    /* using a real VBO for vertex data */
    struct gl_context *ctx = exec->ctx;
 
+   if (MESA_VERBOSE & VERBOSE_DRAW) {
+      _mesa_debug(ctx, "vbo: immediate mode flushes: %u buffer full, "
+                  "%u primitive limit, %u vertex upgrade, %u flush\n",
+                  exec->flush_stats.buffer_full,
+                  exec->flush_stats.prim_limit,
+                  exec->flush_stats.vertex_upgrade,
+                  exec->flush_stats.flush_vertices);
+   }
+
    /* True VBOs should already be unmapped
     */
    if (exec->vtx.buffer_map) {
@@ -178,8 +178,12 @@ vbo_exec_bind_arrays(struct gl_context *ctx)
 
    GLintptr buffer_offset;
    if (_mesa_is_bufferobj(exec->vtx.bufferobj)) {
-      assert(exec->vtx.bufferobj->Mappings[MAP_INTERNAL].Pointer);
-      buffer_offset = exec->vtx.bufferobj->Mappings[MAP_INTERNAL].Offset;
+      const struct gl_buffer_mapping *map =
+         &exec->vtx.bufferobj->Mappings[MAP_INTERNAL];
+
+      assert(map->Pointer);
+      buffer_offset = map->Offset +
+                      ((GLbyte *)exec->vtx.buffer_map - (GLbyte *)map->Pointer);
    } else {
       /* Ptr into ordinary app memory */
       buffer_offset = (GLbyte *)exec->vtx.buffer_map - (GLbyte *)NULL;
@@ -240,7 +244,7 @@ vbo_exec_vtx_unmap(struct vbo_exec_context *exec)
    if (_mesa_is_bufferobj(exec->vtx.bufferobj)) {
       struct gl_context *ctx = exec->ctx;
 
-      if (ctx->Driver.FlushMappedBufferRange) {
+      if (ctx->Driver.FlushMappedBufferRange && !exec->vtx.persistent) {
          GLintptr offset = exec->vtx.buffer_used -
                            exec->vtx.bufferobj->Mappings[MAP_INTERNAL].Offset;
          GLsizeiptr length = (exec->vtx.buffer_ptr - exec->vtx.buffer_map) *
@@ -258,7 +262,9 @@ vbo_exec_vtx_unmap(struct vbo_exec_context *exec)
       assert(exec->vtx.buffer_used <= VBO_VERT_BUFFER_SIZE);
       assert(exec->vtx.buffer_ptr != NULL);
 
-      ctx->Driver.UnmapBuffer(ctx, exec->vtx.bufferobj, MAP_INTERNAL);
+      /* A persistent mapping is kept until the buffer is full. */
+      if (!exec->vtx.persistent)
+         ctx->Driver.UnmapBuffer(ctx, exec->vtx.bufferobj, MAP_INTERNAL);
       exec->vtx.buffer_map = NULL;
       exec->vtx.buffer_ptr = NULL;
       exec->vtx.max_vert = 0;
@@ -266,6 +272,56 @@ vbo_exec_vtx_unmap(struct vbo_exec_context *exec)
 }
 
 
+/**
+ * Map the whole vertex buffer persistently and keep the mapping across
+ * draws.  New vertices are always appended behind the ones already drawn,
+ * so nothing the GPU may still read is overwritten.  Once the buffer is
+ * full, its storage is orphaned and mapped again.
+ */
+static void
+vbo_exec_vtx_map_persistent(struct vbo_exec_context *exec)
+{
+   struct gl_context *ctx = exec->ctx;
+   struct gl_buffer_object *obj = exec->vtx.bufferobj;
+   const GLbitfield access = GL_MAP_WRITE_BIT |
+                             GL_MAP_PERSISTENT_BIT |
+                             GL_MAP_COHERENT_BIT |
+                             GL_MAP_UNSYNCHRONIZED_BIT;
+
+   if (_mesa_bufferobj_mapped(obj, MAP_INTERNAL)) {
+      if (VBO_VERT_BUFFER_SIZE > exec->vtx.buffer_used + 1024) {
+         /* There's room behind the vertices drawn so far */
+         exec->vtx.buffer_map = (fi_type *)
+            ((GLubyte *)obj->Mappings[MAP_INTERNAL].Pointer +
+             exec->vtx.buffer_used - obj->Mappings[MAP_INTERNAL].Offset);
+         return;
+      }
+
+      ctx->Driver.UnmapBuffer(ctx, obj, MAP_INTERNAL);
+   }
+
+   exec->vtx.buffer_used = 0;
+
+   if (ctx->Driver.BufferData(ctx, GL_ARRAY_BUFFER_ARB,
+                              VBO_VERT_BUFFER_SIZE,
+                              NULL, GL_STREAM_DRAW_ARB,
+                              GL_MAP_WRITE_BIT |
+                              GL_MAP_PERSISTENT_BIT |
+                              GL_MAP_COHERENT_BIT |
+                              GL_DYNAMIC_STORAGE_BIT |
+                              GL_CLIENT_STORAGE_BIT,
+                              obj)) {
+      exec->vtx.buffer_map = (fi_type *)
+         ctx->Driver.MapBufferRange(ctx, 0, VBO_VERT_BUFFER_SIZE, access,
+                                    obj, MAP_INTERNAL);
+   }
+   else {
+      _mesa_error(ctx, GL_OUT_OF_MEMORY, "VBO allocation");
+      exec->vtx.buffer_map = NULL;
+   }
+}
+
+
 /**
  * Map the vertex buffer to begin storing glVertex, glColor, etc data.
  */
@@ -286,7 +342,23 @@ vbo_exec_vtx_map(struct vbo_exec_context *exec)
    assert(!exec->vtx.buffer_map);
    assert(!exec->vtx.buffer_ptr);
 
-   if (VBO_VERT_BUFFER_SIZE > exec->vtx.buffer_used + 1024) {
+   /* Extensions aren't known yet when the buffer object is created, so
+    * pick the mapping mode whenever the buffer isn't mapped.
+    */
+   if (!_mesa_bufferobj_mapped(exec->vtx.bufferobj, MAP_INTERNAL)) {
+      bool persistent = ctx->Extensions.ARB_buffer_storage;
+
+      if (persistent != exec->vtx.persistent) {
+         /* The current storage was allocated for the other mode */
+         exec->vtx.persistent = persistent;
+         exec->vtx.buffer_used = VBO_VERT_BUFFER_SIZE;
+      }
+   }
+
+   if (exec->vtx.persistent) {
+      vbo_exec_vtx_map_persistent(exec);
+   }
+   else if (VBO_VERT_BUFFER_SIZE > exec->vtx.buffer_used + 1024) {
       /* The VBO exists and there's room for more */
       if (exec->vtx.bufferobj->Size > 0) {
          exec->vtx.buffer_map = (fi_type *)
@@ -304,7 +376,7 @@ vbo_exec_vtx_map(struct vbo_exec_context *exec)
       }
    }
 
-   if (!exec->vtx.buffer_map) {
+   if (!exec->vtx.persistent && !exec->vtx.buffer_map) {
       /* Need to allocate a new VBO */
       exec->vtx.buffer_used = 0;
 
@@ -75,8 +75,25 @@ struct vbo_save_vertex_list {
    GLuint prim_count;
 
    struct vbo_save_primitive_store *prim_store;
+
+   /* The primitives above merged into indexed triangles, lines and points,
+    * with identical vertices sharing an index.  The indices live in
+    * ib.obj, which is shared with other lists.  This is only valid if
+    * indexed_prim_count != 0 and the state allows it at playback, see
+    * VBO_SAVE_INDEXED_*.
+    */
+   struct _mesa_prim *indexed_prims;
+   GLuint indexed_prim_count;
+   GLbitfield indexed_flags;
+   struct _mesa_index_buffer ib;
+   GLuint min_index, max_index;
 };
 
+/* Strips, fans, quads or polygons were split, see indexed_prims. */
+#define VBO_SAVE_INDEXED_NEED_FILL        0x1
+/* Line strips or loops were split into lines. */
+#define VBO_SAVE_INDEXED_NEED_NO_STIPPLE  0x2
+
 
 /**
  * Return the stride in bytes of the display list node.
@@ -135,6 +152,7 @@ _vbo_save_get_vertex_count(const struct vbo_save_vertex_list *node)
  * internally even though this probably isn't allowed for client VBOs?
  */
 #define VBO_SAVE_BUFFER_SIZE (256*1024) /* dwords */
+#define VBO_SAVE_INDEX_BUFFER_SIZE (1024*1024) /* bytes */
 #define VBO_SAVE_PRIM_SIZE   128
 #define VBO_SAVE_PRIM_MODE_MASK         0x3f
 
@@ -177,6 +195,12 @@ struct vbo_save_context {
    struct vbo_save_vertex_store *vertex_store;
    struct vbo_save_primitive_store *prim_store;
 
+   /* Indices of the indexed primitives of vertex lists, appended with
+    * BufferSubData.
+    */
+   struct gl_buffer_object *index_bufferobj;
+   GLuint index_used;   /**< in bytes */
+
    fi_type *buffer_map;            /**< Mapping of vertex_store's buffer */
    fi_type *buffer_ptr;		   /**< cursor, points into buffer_map */
    fi_type vertex[VBO_ATTRIB_MAX*4];	   /* current values */
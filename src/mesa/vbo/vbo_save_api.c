@@ -82,6 +82,8 @@ USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "main/state.h"
 #include "main/varray.h"
 #include "util/bitscan.h"
+#include "util/hash_table.h"
+#include "util/u_math.h"
 
 #include "vbo_noop.h"
 #include "vbo_private.h"
@@ -412,6 +414,313 @@ convert_line_loop_to_strip(struct vbo_save_context *save,
 }
 
 
+/**
+ * Maps vertices to the index of the first identical vertex of a vertex
+ * list, using open addressing.
+ */
+struct vertex_dedup
+{
+   const fi_type *vertices;
+   GLuint vertex_size;
+   GLuint mask;
+   GLuint *slots;    /* vertex index + 1, or 0 if empty */
+};
+
+static GLuint
+dedup_vertex(struct vertex_dedup *dedup, GLuint index)
+{
+   const GLuint size = dedup->vertex_size * sizeof(fi_type);
+   const fi_type *vertex = dedup->vertices + index * dedup->vertex_size;
+   GLuint slot = _mesa_hash_data(vertex, size) & dedup->mask;
+
+   while (dedup->slots[slot]) {
+      const GLuint other = dedup->slots[slot] - 1;
+
+      if (!memcmp(vertex, dedup->vertices + other * dedup->vertex_size, size))
+         return other;
+      slot = (slot + 1) & dedup->mask;
+   }
+
+   dedup->slots[slot] = index + 1;
+   return index;
+}
+
+
+/**
+ * Return the mode the primitive mode is drawn with as an indexed primitive,
+ * or -1 if it can't be converted.
+ */
+static int
+indexed_prim_mode(const struct _mesa_prim *prim)
+{
+   switch (prim->mode) {
+   case GL_POINTS:
+      return GL_POINTS;
+   case GL_LINE_LOOP:
+      /* Wrapped loops need their first vertex from the previous list. */
+      if (!prim->begin || !prim->end)
+         return -1;
+      /* fallthrough */
+   case GL_LINES:
+   case GL_LINE_STRIP:
+      return GL_LINES;
+   case GL_TRIANGLES:
+   case GL_TRIANGLE_STRIP:
+   case GL_TRIANGLE_FAN:
+   case GL_QUADS:
+   case GL_QUAD_STRIP:
+   case GL_POLYGON:
+      return GL_TRIANGLES;
+   default:
+      return -1;
+   }
+}
+
+
+/**
+ * Generate the indices of one primitive, converted to points, lines or
+ * triangles.  The last vertex of every line and triangle is the provoking
+ * vertex of the original primitive with GL_LAST_VERTEX_CONVENTION, and
+ * the winding is kept.
+ */
+static GLuint *
+emit_prim_indices(struct vertex_dedup *dedup, const struct _mesa_prim *prim,
+                  GLuint *out)
+{
+   const GLuint s = prim->start;
+   const GLuint n = prim->count;
+   GLuint i;
+
+#define EMIT(v) (*out++ = dedup_vertex(dedup, v))
+   switch (prim->mode) {
+   case GL_POINTS:
+      for (i = 0; i < n; i++)
+         EMIT(s + i);
+      break;
+   case GL_LINES:
+      for (i = 0; i + 1 < n; i += 2) {
+         EMIT(s + i); EMIT(s + i + 1);
+      }
+      break;
+   case GL_LINE_LOOP:
+   case GL_LINE_STRIP:
+      for (i = 0; i + 1 < n; i++) {
+         EMIT(s + i); EMIT(s + i + 1);
+      }
+      if (prim->mode == GL_LINE_LOOP && n >= 2) {
+         EMIT(s + n - 1); EMIT(s);
+      }
+      break;
+   case GL_TRIANGLES:
+      for (i = 0; i + 2 < n; i += 3) {
+         EMIT(s + i); EMIT(s + i + 1); EMIT(s + i + 2);
+      }
+      break;
+   case GL_TRIANGLE_STRIP:
+      for (i = 0; i + 2 < n; i++) {
+         if (i & 1) {
+            EMIT(s + i + 1); EMIT(s + i);
+         } else {
+            EMIT(s + i); EMIT(s + i + 1);
+         }
+         EMIT(s + i + 2);
+      }
+      break;
+   case GL_TRIANGLE_FAN:
+      for (i = 0; i + 2 < n; i++) {
+         EMIT(s); EMIT(s + i + 1); EMIT(s + i + 2);
+      }
+      break;
+   case GL_QUADS:
+      for (i = 0; i + 3 < n; i += 4) {
+         EMIT(s + i); EMIT(s + i + 1); EMIT(s + i + 3);
+         EMIT(s + i + 1); EMIT(s + i + 2); EMIT(s + i + 3);
+      }
+      break;
+   case GL_QUAD_STRIP:
+      for (i = 0; i + 3 < n; i += 2) {
+         EMIT(s + i); EMIT(s + i + 1); EMIT(s + i + 3);
+         EMIT(s + i + 2); EMIT(s + i); EMIT(s + i + 3);
+      }
+      break;
+   case GL_POLYGON:
+      /* The first vertex is the provoking vertex of polygons. */
+      for (i = 0; i + 2 < n; i++) {
+         EMIT(s + i + 1); EMIT(s + i + 2); EMIT(s);
+      }
+      break;
+   default:
+      unreachable("Unexpected primitive type");
+   }
+#undef EMIT
+
+   return out;
+}
+
+
+/**
+ * Merge the primitives of a vertex list into as few indexed draws as
+ * possible, so that playback doesn't have to draw them one by one.  Runs
+ * of primitives that map to the same indexed mode become one primitive.
+ *
+ * \param vertices  vertex 0 of the VAO of the list
+ */
+static void
+build_indexed_prims(struct gl_context *ctx,
+                    struct vbo_save_vertex_list *node,
+                    const fi_type *vertices)
+{
+   struct vbo_save_context *save = &vbo_context(ctx)->save;
+   GLbitfield flags = 0;
+   GLuint num_runs = 0, max_indices = 0;
+   bool split = false;
+   int last_mode = -1;
+
+   for (GLuint i = 0; i < node->prim_count; i++) {
+      const struct _mesa_prim *prim = &node->prims[i];
+      const int mode = indexed_prim_mode(prim);
+
+      if (mode < 0)
+         return;
+
+      if (mode != last_mode)
+         num_runs++;
+      last_mode = mode;
+      max_indices += 3 * prim->count;
+
+      switch (prim->mode) {
+      case GL_LINE_STRIP:
+      case GL_LINE_LOOP:
+         flags |= VBO_SAVE_INDEXED_NEED_NO_STIPPLE;
+         split = true;
+         break;
+      case GL_TRIANGLE_STRIP:
+      case GL_TRIANGLE_FAN:
+         split = true;
+         break;
+      case GL_QUADS:
+      case GL_QUAD_STRIP:
+      case GL_POLYGON:
+         flags |= VBO_SAVE_INDEXED_NEED_FILL;
+         split = true;
+         break;
+      }
+   }
+
+   /* Nothing to gain over drawing the primitives as they are. */
+   if (num_runs == node->prim_count && !split)
+      return;
+
+   /* Edge flags only apply to some primitive types. */
+   if (save->enabled & BITFIELD64_BIT(VBO_ATTRIB_EDGEFLAG))
+      flags |= VBO_SAVE_INDEXED_NEED_FILL;
+
+   const GLuint min_vertex = _vbo_save_get_min_index(node);
+   const GLuint num_vertices = _vbo_save_get_max_index(node) + 1 - min_vertex;
+   const GLuint num_slots = util_next_power_of_two(2 * num_vertices);
+   struct vertex_dedup dedup = {
+      .vertices = vertices,
+      .vertex_size = save->vertex_size,
+      .mask = num_slots - 1,
+      .slots = calloc(num_slots, sizeof(GLuint)),
+   };
+   GLuint *indices = malloc(max_indices * sizeof(GLuint));
+   struct _mesa_prim *prims = calloc(num_runs, sizeof(*prims));
+
+   if (!dedup.slots || !indices || !prims)
+      goto fail;
+
+   GLuint *out = indices;
+   struct _mesa_prim *run = NULL;
+   last_mode = -1;
+
+   for (GLuint i = 0; i < node->prim_count; i++) {
+      const int mode = indexed_prim_mode(&node->prims[i]);
+
+      if (mode != last_mode) {
+         run = run ? run + 1 : prims;
+         run->mode = mode;
+         run->indexed = 1;
+         run->begin = 1;
+         run->end = 1;
+         run->start = out - indices;
+         run->num_instances = 1;
+      }
+      last_mode = mode;
+
+      out = emit_prim_indices(&dedup, &node->prims[i], out);
+      run->count = out - indices - run->start;
+   }
+
+   const GLuint count = out - indices;
+   if (!count)
+      goto fail;
+
+   GLuint min_index = ~0u, max_index = 0;
+   for (GLuint i = 0; i < count; i++) {
+      min_index = MIN2(min_index, indices[i]);
+      max_index = MAX2(max_index, indices[i]);
+   }
+
+   /* Use 16-bit indices if possible. */
+   unsigned index_size = 4;
+   if (max_index <= 0xffff) {
+      GLushort *indices16 = (GLushort *)indices;
+
+      for (GLuint i = 0; i < count; i++)
+         indices16[i] = indices[i];
+      index_size = 2;
+   }
+
+   const GLuint size = ALIGN(count * index_size, 4);
+   if (size > VBO_SAVE_INDEX_BUFFER_SIZE)
+      goto fail;
+
+   if (!save->index_bufferobj ||
+       save->index_used + size > VBO_SAVE_INDEX_BUFFER_SIZE) {
+      _mesa_reference_buffer_object(ctx, &save->index_bufferobj, NULL);
+      save->index_used = 0;
+
+      /* See alloc_vertex_store() about the name. */
+      struct gl_buffer_object *obj =
+         ctx->Driver.NewBufferObject(ctx, VBO_BUF_ID);
+      if (!obj)
+         goto fail;
+
+      if (!ctx->Driver.BufferData(ctx, GL_ELEMENT_ARRAY_BUFFER_ARB,
+                                  VBO_SAVE_INDEX_BUFFER_SIZE, NULL,
+                                  GL_STATIC_DRAW_ARB, GL_DYNAMIC_STORAGE_BIT,
+                                  obj)) {
+         _mesa_reference_buffer_object(ctx, &obj, NULL);
+         goto fail;
+      }
+      save->index_bufferobj = obj;
+   }
+
+   ctx->Driver.BufferSubData(ctx, save->index_used, count * index_size,
+                             indices, save->index_bufferobj);
+
+   /* The starts are relative to ib.ptr. */
+   node->ib.count = count;
+   node->ib.index_size = index_size;
+   node->ib.ptr = (const void *)(uintptr_t)save->index_used;
+   _mesa_reference_buffer_object(ctx, &node->ib.obj, save->index_bufferobj);
+   save->index_used += size;
+
+   node->indexed_prims = prims;
+   node->indexed_prim_count = num_runs;
+   node->indexed_flags = flags;
+   node->min_index = min_index;
+   node->max_index = max_index;
+   prims = NULL;
+
+fail:
+   free(dedup.slots);
+   free(indices);
+   free(prims);
+}
+
+
 /* Compare the present vao if it has the same setup. */
 static bool
 compare_vao(gl_vertex_processing_mode mode,
@@ -585,6 +894,9 @@ compile_vertex_list(struct gl_context *ctx)
    node->prims = save->prims;
    node->prim_count = save->prim_count;
    node->prim_store = save->prim_store;
+   node->indexed_prims = NULL;
+   node->indexed_prim_count = 0;
+   node->ib.obj = NULL;
 
    /* Create a pair of VAOs for the possible VERTEX_PROCESSING_MODEs
     * Note that this may reuse the previous one of possible.
@@ -653,6 +965,11 @@ compile_vertex_list(struct gl_context *ctx)
       node->prims[i].start += start_offset;
    }
 
+   if (node->vertex_count) {
+      build_indexed_prims(ctx, node, save->vertex_store->buffer_map +
+                                     buffer_offset / sizeof(GLfloat));
+   }
+
    /* Deal with GL_COMPILE_AND_EXECUTE:
     */
    if (ctx->ExecuteFlag) {
@@ -1856,6 +2173,10 @@ vbo_destroy_vertex_list(struct gl_context *ctx, void *data)
    if (--node->prim_store->refcount == 0)
       free(node->prim_store);
 
+   free(node->indexed_prims);
+   node->indexed_prims = NULL;
+   _mesa_reference_buffer_object(ctx, &node->ib.obj, NULL);
+
    free(node->current_data);
    node->current_data = NULL;
 }
@@ -1885,6 +2206,15 @@ vbo_print_vertex_list(struct gl_context *ctx, void *data, FILE *f)
              (prim->begin) ? "BEGIN" : "(wrap)",
              (prim->end) ? "END" : "(wrap)");
    }
+
+   for (i = 0; i < node->indexed_prim_count; i++) {
+      struct _mesa_prim *prim = &node->indexed_prims[i];
+      fprintf(f, "   indexed prim %d: %s %d..%d\n",
+             i,
+             _mesa_lookup_prim_by_nr(prim->mode),
+             prim->start,
+             prim->start + prim->count);
+   }
 }
 
 
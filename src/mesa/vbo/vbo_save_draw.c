@@ -35,6 +35,7 @@
 #include "main/macros.h"
 #include "main/light.h"
 #include "main/state.h"
+#include "main/transformfeedback.h"
 #include "main/varray.h"
 #include "util/bitscan.h"
 
@@ -144,6 +145,41 @@ loopback_vertex_list(struct gl_context *ctx,
 }
 
 
+/**
+ * Whether the indexed primitives of the list draw the same as the original
+ * ones with the current state.
+ */
+static bool
+use_indexed_prims(const struct gl_context *ctx,
+                  const struct vbo_save_vertex_list *node)
+{
+   if (!node->indexed_prim_count)
+      return false;
+
+   /* The provoking vertex and the primitive counts may change. */
+   if (ctx->Light.ProvokingVertex != GL_LAST_VERTEX_CONVENTION_EXT ||
+       ctx->RenderMode != GL_RENDER ||
+       _mesa_is_xfb_active_and_unpaused(ctx))
+      return false;
+
+   /* The indices could be equal to the restart index. */
+   if (ctx->Array._PrimitiveRestart)
+      return false;
+
+   /* Split polygons would show their inner edges. */
+   if (node->indexed_flags & VBO_SAVE_INDEXED_NEED_FILL &&
+       (ctx->Polygon.FrontMode != GL_FILL || ctx->Polygon.BackMode != GL_FILL))
+      return false;
+
+   /* The stipple pattern would restart at every line. */
+   if (node->indexed_flags & VBO_SAVE_INDEXED_NEED_NO_STIPPLE &&
+       ctx->Line.StippleFlag)
+      return false;
+
+   return true;
+}
+
+
 /**
  * Execute the buffer and save copied verts.
  * This is called from the display list code when executing
@@ -209,7 +245,11 @@ vbo_save_playback_vertex_list(struct gl_context *ctx, void *data)
 
       assert(ctx->NewState == 0);
 
-      if (node->vertex_count > 0) {
+      if (node->vertex_count > 0 && use_indexed_prims(ctx, node)) {
+         ctx->Driver.Draw(ctx, node->indexed_prims, node->indexed_prim_count,
+                          &node->ib, GL_TRUE, node->min_index,
+                          node->max_index, NULL, 0, NULL);
+      } else if (node->vertex_count > 0) {
          GLuint min_index = _vbo_save_get_min_index(node);
          GLuint max_index = _vbo_save_get_max_index(node);
          ctx->Driver.Draw(ctx, node->prims, node->prim_count, NULL, GL_TRUE,
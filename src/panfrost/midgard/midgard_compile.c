@@ -2801,15 +2801,23 @@ midgard_compile_shader_nir(struct midgard_screen *screen, nir_shader *nir, midga
 
         if (midgard_debug & MIDGARD_DBG_SHADERDB) {
                 unsigned nr_bundles = 0, nr_ins = 0;
+                unsigned nr_alu_bundles = 0, nr_alu_ins = 0;
 
-                /* Count instructions and bundles */
+                /* Count instructions and bundles, and separately the ALU
+                 * ones to see how well we fill the ALU slots */
 
                 mir_foreach_block(ctx, block) {
                         nr_bundles += util_dynarray_num_elements(
                                               &block->bundles, midgard_bundle);
 
-                        mir_foreach_bundle_in_block(block, bun)
+                        mir_foreach_bundle_in_block(block, bun) {
                                 nr_ins += bun->instruction_count;
+
+                                if (IS_ALU(bun->tag)) {
+                                        nr_alu_bundles++;
+                                        nr_alu_ins += bun->instruction_count;
+                                }
+                        }
                 }
 
                 /* Calculate thread count. There are certain cutoffs by
@@ -2827,13 +2835,15 @@ midgard_compile_shader_nir(struct midgard_screen *screen, nir_shader *nir, midga
                 fprintf(stderr, "shader%d - %s shader: "
                         "%u inst, %u bundles, %u quadwords, "
                         "%u registers, %u threads, %u loops, "
-                        "%u:%u spills:fills\n",
+                        "%u:%u spills:fills, "
+                        "%u:%u alu inst:bundles\n",
                         SHADER_DB_COUNT++,
                         gl_shader_stage_name(ctx->stage),
                         nr_ins, nr_bundles, ctx->quadword_count,
                         nr_registers, nr_threads,
                         ctx->loop_count,
-                        ctx->spills, ctx->fills);
+                        ctx->spills, ctx->fills,
+                        nr_alu_ins, nr_alu_bundles);
         }
 
         ralloc_free(ctx);
@@ -652,6 +652,92 @@ schedule_block(compiler_context *ctx, midgard_block *block)
 
 /* The following passes reorder MIR instructions to enable better scheduling */
 
+/* Fixed registers carry implicit ordering (conditionals, writeout, etc), so
+ * instructions touching them are never moved around */
+
+static bool
+mir_touches_fixed(midgard_instruction *ins)
+{
+        if (ins->dest != ~0 && ins->dest >= SSA_FIXED_MINIMUM)
+                return true;
+
+        for (unsigned i = 0; i < ARRAY_SIZE(ins->src); ++i) {
+                if (ins->src[i] != ~0 && ins->src[i] >= SSA_FIXED_MINIMUM)
+                        return true;
+        }
+
+        return false;
+}
+
+/* Does moving `later` above `earlier` break a data dependency? */
+
+static bool
+mir_depends_on(midgard_instruction *later, midgard_instruction *earlier)
+{
+        for (unsigned i = 0; i < ARRAY_SIZE(later->src); ++i) {
+                if (earlier->dest != ~0 && later->src[i] == earlier->dest)
+                        return true;
+
+                if (later->dest != ~0 && earlier->src[i] == later->dest)
+                        return true;
+        }
+
+        return later->dest != ~0 && later->dest == earlier->dest;
+}
+
+/* Bundles are formed from consecutive ALU instructions, so an ALU op whose
+ * successor can't run in the same bundle (either a dependent ALU op or
+ * something else entirely) leaves the rest of the bundle empty. Look a
+ * little ahead for an independent ALU op and move it up to fill in. */
+
+static void
+midgard_pair_alu(compiler_context *ctx, midgard_block *block)
+{
+        mir_foreach_instr_in_block_safe(block, ins) {
+                if (ins->type != TAG_ALU_4) continue;
+                if (ins->compact_branch || mir_touches_fixed(ins)) continue;
+
+                midgard_instruction *next_op = mir_next_op(ins);
+
+                if (&next_op->link == &block->instructions)
+                        continue;
+
+                if (next_op->type == TAG_ALU_4 && can_run_concurrent_ssa(ins, next_op))
+                        continue;
+
+                /* Keep the distance short, to avoid stretching live ranges */
+                int search_distance = 8;
+
+                mir_foreach_instr_in_block_from(block, c, next_op) {
+                        if (!(search_distance--)) break;
+
+                        /* Everything we hop over has to stay put */
+                        if (c->compact_branch || mir_touches_fixed(c)) break;
+
+                        bool movable = c->type == TAG_ALU_4 && c != next_op &&
+                                !c->precede_break && !c->has_blend_constant &&
+                                can_run_concurrent_ssa(ins, c);
+
+                        if (movable) {
+                                mir_foreach_instr_in_block_from(block, s, next_op) {
+                                        if (s == c) break;
+
+                                        if (mir_depends_on(c, s)) {
+                                                movable = false;
+                                                break;
+                                        }
+                                }
+                        }
+
+                        if (!movable) continue;
+
+                        list_del(&c->link);
+                        list_add(&c->link, &ins->link);
+                        break;
+                }
+        }
+}
+
 static void
 midgard_pair_load_store(compiler_context *ctx, midgard_block *block)
 {
@@ -976,6 +1062,7 @@ schedule_program(compiler_context *ctx)
 
         mir_foreach_block(ctx, block) {
                 midgard_pair_load_store(ctx, block);
+                midgard_pair_alu(ctx, block);
         }
 
         /* Must be lowered right before RA */
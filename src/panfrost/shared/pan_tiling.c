@@ -192,6 +192,98 @@ panfrost_store_tiled_image_bpp4(void *dst, const void *src,
    }
 }
 
+/* Since the bits of x and y (when both are multiples of 4) only come in above
+ * the bottom nibble of the index, a 4x4 block of pixels is stored as 16
+ * consecutive pixels within its tile. Within the block, pixel i comes from
+ * the row and column given here. */
+
+static const uint8_t block_4x4[16][2] = {
+   { 0, 0 }, { 0, 1 }, { 1, 1 }, { 1, 0 },
+   { 0, 2 }, { 0, 3 }, { 1, 3 }, { 1, 2 },
+   { 2, 2 }, { 2, 3 }, { 3, 3 }, { 3, 2 },
+   { 2, 0 }, { 2, 1 }, { 3, 1 }, { 3, 0 },
+};
+
+struct pan_pixel_128 {
+   uint64_t lo, hi;
+};
+
+/* Routines to (un)tile a box aligned to 4x4 blocks a whole block at a time.
+ * With a fixed pixel size, the block copy unrolls into sequential accesses
+ * to the tiled image and row-wise accesses to the linear one, which the
+ * compiler can vectorize. */
+
+#define TILED_ACCESS_4X4(pixel_t, suffix)                                    \
+static void                                                                  \
+panfrost_access_tiled_image_4x4_##suffix(void *dst, void *src,               \
+                                         const struct pipe_box *box,         \
+                                         uint32_t dst_stride,                \
+                                         uint32_t src_stride,                \
+                                         bool is_store)                      \
+{                                                                            \
+   for (int y = box->y, src_y = 0; src_y < box->height; y += 4, src_y += 4) { \
+      uint8_t *tile_row = (uint8_t *) dst + ((y & ~0x0f) * dst_stride);      \
+      uint8_t *source_row = (uint8_t *) src + (src_y * src_stride);          \
+      unsigned expanded_y = bit_duplication[y & 0xF];                        \
+                                                                             \
+      for (int x = box->x, src_x = 0; src_x < box->width; x += 4, src_x += 4) { \
+         pixel_t *tiled = (pixel_t *) tile_row +                             \
+            ((x >> 4) * PIXELS_PER_TILE) + (expanded_y ^ space_4[x & 0xF]);  \
+                                                                             \
+         for (unsigned i = 0; i < 16; ++i) {                                 \
+            pixel_t *linear = (pixel_t *)                                    \
+               (source_row + (block_4x4[i][0] * src_stride)) +               \
+               src_x + block_4x4[i][1];                                      \
+                                                                             \
+            if (is_store)                                                    \
+               tiled[i] = *linear;                                           \
+            else                                                             \
+               *linear = tiled[i];                                           \
+         }                                                                   \
+      }                                                                      \
+   }                                                                         \
+}
+
+TILED_ACCESS_4X4(uint8_t, bpp1)
+TILED_ACCESS_4X4(uint16_t, bpp2)
+TILED_ACCESS_4X4(uint32_t, bpp4)
+TILED_ACCESS_4X4(uint64_t, bpp8)
+TILED_ACCESS_4X4(struct pan_pixel_128, bpp16)
+
+/* Returns false if there is no 4x4 path for this box and bpp */
+
+static bool
+panfrost_access_tiled_image_4x4(void *dst, void *src,
+                                const struct pipe_box *box,
+                                uint32_t dst_stride,
+                                uint32_t src_stride,
+                                uint32_t bpp,
+                                bool is_store)
+{
+   if ((box->x | box->y | box->width | box->height) & 0x3)
+      return false;
+
+   switch (bpp) {
+      case 1:
+         panfrost_access_tiled_image_4x4_bpp1(dst, src, box, dst_stride, src_stride, is_store);
+         return true;
+      case 2:
+         panfrost_access_tiled_image_4x4_bpp2(dst, src, box, dst_stride, src_stride, is_store);
+         return true;
+      case 4:
+         panfrost_access_tiled_image_4x4_bpp4(dst, src, box, dst_stride, src_stride, is_store);
+         return true;
+      case 8:
+         panfrost_access_tiled_image_4x4_bpp8(dst, src, box, dst_stride, src_stride, is_store);
+         return true;
+      case 16:
+         panfrost_access_tiled_image_4x4_bpp16(dst, src, box, dst_stride, src_stride, is_store);
+         return true;
+      default:
+         return false;
+   }
+}
+
 static void
 panfrost_access_tiled_image_generic(void *dst, void *src,
                                const struct pipe_box *box,
@@ -282,6 +374,9 @@ panfrost_store_tiled_image(void *dst, const void *src,
                            uint32_t src_stride,
                            uint32_t bpp)
 {
+   if (panfrost_access_tiled_image_4x4(dst, (void *) src, box, dst_stride, src_stride, bpp, TRUE))
+      return;
+
    /* The optimized path is for aligned writes specifically */
 
    if (box->x & 0xF || box->width & 0xF) {
@@ -308,5 +403,8 @@ panfrost_load_tiled_image(void *dst, const void *src,
                            uint32_t src_stride,
                            uint32_t bpp)
 {
+   if (panfrost_access_tiled_image_4x4((void *) src, dst, box, src_stride, dst_stride, bpp, FALSE))
+      return;
+
    panfrost_access_tiled_image_generic((void *) src, dst, box, src_stride, dst_stride, bpp, FALSE);
 }
@@ -40,6 +40,10 @@
 #include <inttypes.h>
 #include "zlib.h"
 
+#ifdef HAVE_ZSTD
+#include "zstd.h"
+#endif
+
 #include "util/crc32.h"
 #include "util/debug.h"
 #include "util/rand_xor.h"
@@ -73,7 +77,23 @@
  * - There is no strict requirement that cache versions be backwards
  *   compatible but effort should be taken to limit disruption where possible.
  */
-#define CACHE_VERSION 1
+#define CACHE_VERSION 2
+
+/* Compression used for an entry, recorded in its header so that entries
+ * written by builds with a different codec are still readable.
+ */
+enum cache_entry_codec {
+   CACHE_CODEC_ZLIB = 0,
+   CACHE_CODEC_ZSTD = 1,
+};
+
+#ifdef HAVE_ZSTD
+#define CACHE_DEFAULT_CODEC CACHE_CODEC_ZSTD
+#define CACHE_DEFAULT_COMPRESSION_LEVEL 1
+#else
+#define CACHE_DEFAULT_CODEC CACHE_CODEC_ZLIB
+#define CACHE_DEFAULT_COMPRESSION_LEVEL Z_BEST_COMPRESSION
+#endif
 
 struct disk_cache {
    /* The path to the cache directory. */
@@ -83,6 +103,11 @@ struct disk_cache {
    /* Thread queue for compressing and writing cache entries to disk */
    struct util_queue cache_queue;
 
+   /* Thread queue for disk_cache_get_batch(), started on first use. */
+   struct util_queue read_queue;
+   bool read_queue_init;
+   mtx_t read_queue_mutex;
+
    /* Seed for rand, which is used to pick a random directory */
    uint64_t seed_xorshift128plus[2];
 
@@ -99,12 +124,29 @@ struct disk_cache {
    /* Maximum size of all cached objects (in bytes). */
    uint64_t max_size;
 
+   /* Codec and level used to compress new entries. */
+   enum cache_entry_codec codec;
+   int compression_level;
+
    /* Driver cache keys. */
    uint8_t *driver_keys_blob;
    size_t driver_keys_blob_size;
 
    disk_cache_put_cb blob_put_cb;
    disk_cache_get_cb blob_get_cb;
+
+   /* Single-file database used instead of one file per entry, or NULL. */
+   struct cache_db *db;
+
+   /* The mmapped LRU index of the files in the cache directory, or NULL if
+    * it could not be set up.
+    */
+   uint8_t *lru_mmap;
+   size_t lru_mmap_size;
+   int lru_fd;
+
+   struct cache_lru_header *lru_header;
+   struct cache_lru_slot *lru_slots;
 };
 
 struct disk_cache_put_job {
@@ -183,6 +225,360 @@ concatenate_and_mkdir(void *ctx, const char *path, const char *name)
       return NULL;
 }
 
+/* Single-file cache database.
+ *
+ * With MESA_GLSL_CACHE_SINGLE_FILE set, entries are appended to one pack
+ * file instead of getting a file each, and are found through a fixed-size
+ * open-addressed hash table kept in a second, memory-mapped file.  A lookup
+ * then costs a probe of the mapped table and a single pread, rather than
+ * a path walk, open, fstat, read and close per entry.  Entries are stored
+ * uncompressed so the data read is the data returned.
+ *
+ * Each record in the pack is the entry data followed by a cache_db_record
+ * trailer, so a lookup reads both straight into the buffer it hands back.
+ * Writers append a complete record before pointing an index slot at it.
+ * Readers take no lock: the index can change under them, so whatever they
+ * read is checked against the trailer's key, size and CRC, and a mismatch
+ * is just a cache miss.
+ *
+ * There is no per-entry eviction.  Once the pack would grow past the
+ * maximum cache size, or a key's probe window is full, the index is
+ * cleared and the pack truncated.
+ */
+#define CACHE_DB_MAGIC 0x42445343 /* "CSDB" */
+#define CACHE_DB_VERSION 1
+
+/* Number of slots in the index, must be a power of two. */
+#define CACHE_DB_NUM_SLOTS (1 << 16)
+
+/* Number of consecutive slots a key may occupy. */
+#define CACHE_DB_MAX_PROBE 64
+
+struct cache_db_header {
+   uint32_t magic;
+   uint32_t version;
+   uint32_t num_slots;
+   uint32_t pad;
+
+   /* Bytes of the pack file taken up by complete records. */
+   uint64_t pack_size;
+};
+
+struct cache_db_slot {
+   /* An all-zero key marks an unused slot. */
+   uint8_t key[CACHE_KEY_SIZE];
+   uint32_t size;
+   uint64_t offset;
+};
+
+struct cache_db_record {
+   uint8_t key[CACHE_KEY_SIZE];
+   uint32_t size;
+   uint32_t crc32;
+};
+
+struct cache_db {
+   int pack_fd;
+   int index_fd;
+
+   /* Serializes writers within the process, flock() on index_fd serializes
+    * them against other processes.
+    */
+   mtx_t mutex;
+
+   uint8_t *index_mmap;
+   size_t index_mmap_size;
+
+   struct cache_db_header *header;
+   struct cache_db_slot *slots;
+
+   uint64_t max_size;
+};
+
+static ssize_t
+pread_all(int fd, void *buf, size_t count, off_t offset)
+{
+   char *in = buf;
+   ssize_t read_ret;
+   size_t done;
+
+   for (done = 0; done < count; done += read_ret) {
+      read_ret = pread(fd, in + done, count - done, offset + done);
+      if (read_ret == -1 || read_ret == 0)
+         return -1;
+   }
+   return done;
+}
+
+static ssize_t
+pwrite_all(int fd, const void *buf, size_t count, off_t offset)
+{
+   const char *out = buf;
+   ssize_t written;
+   size_t done;
+
+   for (done = 0; done < count; done += written) {
+      written = pwrite(fd, out + done, count - done, offset + done);
+      if (written == -1)
+         return -1;
+   }
+   return done;
+}
+
+static bool
+cache_db_lock(struct cache_db *db)
+{
+   mtx_lock(&db->mutex);
+
+   if (flock(db->index_fd, LOCK_EX) == -1) {
+      mtx_unlock(&db->mutex);
+      return false;
+   }
+
+   return true;
+}
+
+static void
+cache_db_unlock(struct cache_db *db)
+{
+   flock(db->index_fd, LOCK_UN);
+   mtx_unlock(&db->mutex);
+}
+
+static const uint8_t cache_db_empty_key[CACHE_KEY_SIZE];
+
+/* Look through the probe window of 'key' for the slot holding 'match',
+ * which is either 'key' itself or cache_db_empty_key to find a free slot.
+ */
+static struct cache_db_slot *
+cache_db_find_slot(struct cache_db *db, const uint8_t *key,
+                   const uint8_t *match)
+{
+   const uint32_t *key_chunk = (const uint32_t *) key;
+   unsigned start = CPU_TO_LE32(*key_chunk);
+
+   /* Removing an entry leaves a hole in the middle of other keys' probe
+    * sequences, so always look through the whole window.
+    */
+   for (unsigned i = 0; i < CACHE_DB_MAX_PROBE; i++) {
+      struct cache_db_slot *slot =
+         &db->slots[(start + i) & (CACHE_DB_NUM_SLOTS - 1)];
+
+      if (memcmp(slot->key, match, CACHE_KEY_SIZE) == 0)
+         return slot;
+   }
+
+   return NULL;
+}
+
+/* Must be called with the lock held. */
+static void
+cache_db_reset(struct cache_db *db)
+{
+   memset(db->slots, 0, CACHE_DB_NUM_SLOTS * sizeof(*db->slots));
+
+   db->header->version = CACHE_DB_VERSION;
+   db->header->num_slots = CACHE_DB_NUM_SLOTS;
+   db->header->pack_size = 0;
+   db->header->magic = CACHE_DB_MAGIC;
+
+   /* Nothing past pack_size is reachable any more, truncating just gives
+    * the space back.  Readers still holding old offsets get short reads.
+    */
+   if (ftruncate(db->pack_fd, 0) == -1)
+      return;
+}
+
+static void
+cache_db_close(struct cache_db *db)
+{
+   if (db->index_mmap)
+      munmap(db->index_mmap, db->index_mmap_size);
+   if (db->index_fd != -1)
+      close(db->index_fd);
+   if (db->pack_fd != -1)
+      close(db->pack_fd);
+
+   mtx_destroy(&db->mutex);
+   ralloc_free(db);
+}
+
+static struct cache_db *
+cache_db_open(void *mem_ctx, const char *path, uint64_t max_size)
+{
+   struct cache_db *db = rzalloc(mem_ctx, struct cache_db);
+   if (db == NULL)
+      return NULL;
+
+   db->pack_fd = -1;
+   db->index_fd = -1;
+   db->max_size = max_size;
+   mtx_init(&db->mutex, mtx_plain);
+
+   char *filename = ralloc_asprintf(db, "%s/pack", path);
+   if (filename == NULL)
+      goto fail;
+
+   db->pack_fd = open(filename, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+   if (db->pack_fd == -1)
+      goto fail;
+
+   filename = ralloc_asprintf(db, "%s/pack_index", path);
+   if (filename == NULL)
+      goto fail;
+
+   db->index_fd = open(filename, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+   if (db->index_fd == -1)
+      goto fail;
+
+   struct stat sb;
+   if (fstat(db->index_fd, &sb) == -1)
+      goto fail;
+
+   size_t size = sizeof(struct cache_db_header) +
+                 CACHE_DB_NUM_SLOTS * sizeof(struct cache_db_slot);
+   if (sb.st_size != size) {
+      if (ftruncate(db->index_fd, size) == -1)
+         goto fail;
+   }
+
+   db->index_mmap = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, db->index_fd, 0);
+   if (db->index_mmap == MAP_FAILED) {
+      db->index_mmap = NULL;
+      goto fail;
+   }
+   db->index_mmap_size = size;
+
+   db->header = (struct cache_db_header *) db->index_mmap;
+   db->slots = (struct cache_db_slot *) (db->header + 1);
+
+   /* A new index, or one in a layout we don't understand. */
+   if (db->header->magic != CACHE_DB_MAGIC ||
+       db->header->version != CACHE_DB_VERSION ||
+       db->header->num_slots != CACHE_DB_NUM_SLOTS) {
+      if (!cache_db_lock(db))
+         goto fail;
+
+      if (db->header->magic != CACHE_DB_MAGIC ||
+          db->header->version != CACHE_DB_VERSION ||
+          db->header->num_slots != CACHE_DB_NUM_SLOTS)
+         cache_db_reset(db);
+
+      cache_db_unlock(db);
+   }
+
+   return db;
+
+ fail:
+   cache_db_close(db);
+
+   return NULL;
+}
+
+static void
+cache_db_put(struct cache_db *db, const cache_key key,
+             const void *data, size_t size)
+{
+   struct cache_db_record record;
+   uint64_t record_size = size + sizeof(record);
+
+   if (size > UINT32_MAX)
+      return;
+
+   memcpy(record.key, key, CACHE_KEY_SIZE);
+   record.size = size;
+   record.crc32 = util_hash_crc32(data, size);
+
+   if (!cache_db_lock(db))
+      return;
+
+   /* Another process may have stored the entry since our lookup missed. */
+   if (cache_db_find_slot(db, key, key))
+      goto done;
+
+   if (db->header->pack_size + record_size > db->max_size)
+      cache_db_reset(db);
+
+   struct cache_db_slot *slot =
+      cache_db_find_slot(db, key, cache_db_empty_key);
+   if (slot == NULL) {
+      cache_db_reset(db);
+      slot = cache_db_find_slot(db, key, cache_db_empty_key);
+   }
+
+   /* Records past pack_size were never published, so overwriting them is
+    * fine; that's also where a writer that died mid-write left its record.
+    */
+   uint64_t offset = db->header->pack_size;
+   if (pwrite_all(db->pack_fd, data, size, offset) == -1 ||
+       pwrite_all(db->pack_fd, &record, sizeof(record), offset + size) == -1)
+      goto done;
+
+   db->header->pack_size = offset + record_size;
+
+   slot->offset = offset;
+   slot->size = size;
+   memcpy(slot->key, key, CACHE_KEY_SIZE);
+
+ done:
+   cache_db_unlock(db);
+}
+
+static void *
+cache_db_get(struct cache_db *db, const cache_key key, size_t *size)
+{
+   struct cache_db_slot *slot = cache_db_find_slot(db, key, key);
+   if (slot == NULL)
+      return NULL;
+
+   uint64_t offset = slot->offset;
+   uint32_t data_size = slot->size;
+   size_t read_size = data_size + sizeof(struct cache_db_record);
+
+   uint8_t *data = malloc(read_size);
+   if (data == NULL)
+      return NULL;
+
+   if (pread_all(db->pack_fd, data, read_size, offset) == -1)
+      goto fail;
+
+   struct cache_db_record record;
+   memcpy(&record, data + data_size, sizeof(record));
+
+   if (memcmp(record.key, key, CACHE_KEY_SIZE) != 0 ||
+       record.size != data_size ||
+       record.crc32 != util_hash_crc32(data, data_size))
+      goto fail;
+
+   if (size)
+      *size = data_size;
+
+   return data;
+
+ fail:
+   free(data);
+
+   return NULL;
+}
+
+static void
+cache_db_remove(struct cache_db *db, const cache_key key)
+{
+   if (!cache_db_lock(db))
+      return;
+
+   /* The record stays in the pack until the next reset. */
+   struct cache_db_slot *slot = cache_db_find_slot(db, key, key);
+   if (slot)
+      memset(slot->key, 0, CACHE_KEY_SIZE);
+
+   cache_db_unlock(db);
+}
+
+static bool
+cache_lru_open(struct disk_cache *cache, void *mem_ctx);
+
 #define DRV_KEY_CPY(_dst, _src, _src_size) \
 do {                                       \
    memcpy(_dst, _src, _src_size);          \
@@ -369,6 +765,20 @@ disk_cache_create(const char *gpu_name, const char *driver_id,
 
    cache->max_size = max_size;
 
+   cache->codec = CACHE_DEFAULT_CODEC;
+   cache->compression_level =
+      env_var_as_unsigned("MESA_GLSL_CACHE_COMPRESSION_LEVEL",
+                          CACHE_DEFAULT_COMPRESSION_LEVEL);
+
+   /* If the database can't be opened, carry on with one file per entry. */
+   if (env_var_as_boolean("MESA_GLSL_CACHE_SINGLE_FILE", false))
+      cache->db = cache_db_open(cache, cache->path, max_size);
+
+   /* Without the LRU index we fall back to evicting random files. */
+   cache->lru_fd = -1;
+   if (cache->db == NULL)
+      cache_lru_open(cache, local);
+
    /* 1 thread was chosen because we don't really care about getting things
     * to disk quickly just that it's not blocking other tasks.
     *
@@ -378,7 +788,10 @@ disk_cache_create(const char *gpu_name, const char *driver_id,
    util_queue_init(&cache->cache_queue, "disk$", 32, 1,
                    UTIL_QUEUE_INIT_RESIZE_IF_FULL |
                    UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY |
-                   UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY);
+                   UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY |
+                   UTIL_QUEUE_INIT_SHARED_POOL);
+
+   mtx_init(&cache->read_queue_mutex, mtx_plain);
 
    cache->path_init_failed = false;
 
@@ -437,12 +850,31 @@ disk_cache_destroy(struct disk_cache *cache)
 {
    if (cache && !cache->path_init_failed) {
       util_queue_destroy(&cache->cache_queue);
+
+      if (cache->read_queue_init)
+         util_queue_destroy(&cache->read_queue);
+      mtx_destroy(&cache->read_queue_mutex);
       munmap(cache->index_mmap, cache->index_mmap_size);
+
+      if (cache->db)
+         cache_db_close(cache->db);
+
+      if (cache->lru_mmap)
+         munmap(cache->lru_mmap, cache->lru_mmap_size);
+      if (cache->lru_fd != -1)
+         close(cache->lru_fd);
    }
 
    ralloc_free(cache);
 }
 
+void
+disk_cache_wait_for_idle(struct disk_cache *cache)
+{
+   if (cache && !cache->path_init_failed)
+      util_queue_finish(&cache->cache_queue);
+}
+
 /* Return a filename within the cache's directory corresponding to 'key'. The
  * returned filename is ralloced with 'cache' as the parent context.
  *
@@ -667,11 +1099,325 @@ evict_lru_item(struct disk_cache *cache)
       p_atomic_add(cache->size, - (uint64_t)size);
 }
 
+/* LRU index for the file-per-entry cache.
+ *
+ * evict_lru_item only finds the oldest file in a random subdirectory, and
+ * does it with a readdir and a stat per file.  Instead, every file we write
+ * is recorded in a fixed-size, open-addressed hash table in the mmapped
+ * "lru_index" file, together with its size on disk and a last access stamp
+ * taken from a counter in the index header.  A cache hit only has to bump
+ * the stamp of its slot.  Evicting builds a min-heap of the stamps and pops
+ * entries off it, coldest first, until the new entry fits below a low
+ * watermark, so a full cache doesn't have to evict on every put.
+ *
+ * Slot updates are made with the index flock()ed, except for the stamp
+ * bump on a hit, which is a single aligned store: losing a race there only
+ * makes the entry look slightly older than it is.
+ *
+ * Files that aren't in the index, for instance ones written before it
+ * existed or dropped when their probe window filled up, are left to the
+ * random eviction above.
+ */
+#define CACHE_LRU_MAGIC 0x4c524343 /* "CCRL" */
+#define CACHE_LRU_VERSION 1
+
+/* Number of slots in the index, must be a power of two. */
+#define CACHE_LRU_NUM_SLOTS (1 << 17)
+
+/* Number of consecutive slots a key may occupy. */
+#define CACHE_LRU_MAX_PROBE 32
+
+struct cache_lru_header {
+   uint32_t magic;
+   uint32_t version;
+   uint32_t num_slots;
+   uint32_t pad;
+
+   /* Source of last_access stamps, incremented on every access. */
+   uint64_t clock;
+};
+
+struct cache_lru_slot {
+   /* An all-zero key marks an unused slot. */
+   uint8_t key[CACHE_KEY_SIZE];
+
+   /* Size of the file on disk, as accounted in cache->size. */
+   uint32_t size;
+   uint64_t last_access;
+};
+
+struct cache_lru_heap_entry {
+   uint64_t last_access;
+   uint32_t slot;
+};
+
+static const uint8_t cache_lru_empty_key[CACHE_KEY_SIZE];
+
+static bool
+cache_lru_open(struct disk_cache *cache, void *mem_ctx)
+{
+   char *filename = ralloc_asprintf(mem_ctx, "%s/lru_index", cache->path);
+   if (filename == NULL)
+      return false;
+
+   cache->lru_fd = open(filename, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+   if (cache->lru_fd == -1)
+      return false;
+
+   struct stat sb;
+   if (fstat(cache->lru_fd, &sb) == -1)
+      goto fail;
+
+   size_t size = sizeof(struct cache_lru_header) +
+                 CACHE_LRU_NUM_SLOTS * sizeof(struct cache_lru_slot);
+   if (sb.st_size != size) {
+      if (ftruncate(cache->lru_fd, size) == -1)
+         goto fail;
+   }
+
+   uint8_t *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                       cache->lru_fd, 0);
+   if (map == MAP_FAILED)
+      goto fail;
+
+   struct cache_lru_header *header = (struct cache_lru_header *) map;
+
+   /* A new index, or one in a layout we don't understand.  Files tracked
+    * by an index we throw away here are still accounted in cache->size, the
+    * random eviction will find them eventually.
+    */
+   if (header->magic != CACHE_LRU_MAGIC ||
+       header->version != CACHE_LRU_VERSION ||
+       header->num_slots != CACHE_LRU_NUM_SLOTS) {
+      if (flock(cache->lru_fd, LOCK_EX) == -1) {
+         munmap(map, size);
+         goto fail;
+      }
+
+      if (header->magic != CACHE_LRU_MAGIC ||
+          header->version != CACHE_LRU_VERSION ||
+          header->num_slots != CACHE_LRU_NUM_SLOTS) {
+         memset(map, 0, size);
+         header->version = CACHE_LRU_VERSION;
+         header->num_slots = CACHE_LRU_NUM_SLOTS;
+         header->magic = CACHE_LRU_MAGIC;
+      }
+
+      flock(cache->lru_fd, LOCK_UN);
+   }
+
+   cache->lru_mmap = map;
+   cache->lru_mmap_size = size;
+   cache->lru_header = header;
+   cache->lru_slots = (struct cache_lru_slot *) (header + 1);
+
+   return true;
+
+ fail:
+   close(cache->lru_fd);
+   cache->lru_fd = -1;
+
+   return false;
+}
+
+/* Look through the probe window of 'key' for the slot holding 'match',
+ * which is either 'key' itself or cache_lru_empty_key to find a free slot.
+ */
+static struct cache_lru_slot *
+cache_lru_find_slot(struct disk_cache *cache, const uint8_t *key,
+                    const uint8_t *match)
+{
+   const uint32_t *key_chunk = (const uint32_t *) key;
+   unsigned start = CPU_TO_LE32(*key_chunk);
+
+   for (unsigned i = 0; i < CACHE_LRU_MAX_PROBE; i++) {
+      struct cache_lru_slot *slot =
+         &cache->lru_slots[(start + i) & (CACHE_LRU_NUM_SLOTS - 1)];
+
+      if (memcmp(slot->key, match, CACHE_KEY_SIZE) == 0)
+         return slot;
+   }
+
+   return NULL;
+}
+
+/* Mark the entry for 'key' as just used. */
+static void
+cache_lru_touch(struct disk_cache *cache, const cache_key key)
+{
+   if (cache->lru_slots == NULL)
+      return;
+
+   struct cache_lru_slot *slot = cache_lru_find_slot(cache, key, key);
+   if (slot)
+      slot->last_access = p_atomic_inc_return(&cache->lru_header->clock);
+}
+
+/* Delete the file tracked by 'slot' and free the slot.  Must be called with
+ * the index locked.
+ */
+static void
+cache_lru_evict_slot(struct disk_cache *cache, struct cache_lru_slot *slot)
+{
+   char *filename = get_cache_file(cache, slot->key);
+
+   /* If the file is already gone, whoever removed it did the accounting. */
+   if (filename && unlink(filename) == 0)
+      p_atomic_add(cache->size, - (uint64_t)slot->size);
+
+   free(filename);
+   memset(slot->key, 0, CACHE_KEY_SIZE);
+}
+
+/* Record a newly written cache file. */
+static void
+cache_lru_insert(struct disk_cache *cache, const cache_key key, uint64_t size)
+{
+   if (cache->lru_slots == NULL)
+      return;
+
+   if (flock(cache->lru_fd, LOCK_EX) == -1)
+      return;
+
+   struct cache_lru_slot *slot = cache_lru_find_slot(cache, key, key);
+   if (slot == NULL)
+      slot = cache_lru_find_slot(cache, key, cache_lru_empty_key);
+
+   /* With the window full, make room by evicting its coldest entry rather
+    * than leaving this file untracked.
+    */
+   if (slot == NULL) {
+      const uint32_t *key_chunk = (const uint32_t *) key;
+      unsigned start = CPU_TO_LE32(*key_chunk);
+
+      for (unsigned i = 0; i < CACHE_LRU_MAX_PROBE; i++) {
+         struct cache_lru_slot *s =
+            &cache->lru_slots[(start + i) & (CACHE_LRU_NUM_SLOTS - 1)];
+         if (slot == NULL || s->last_access < slot->last_access)
+            slot = s;
+      }
+
+      cache_lru_evict_slot(cache, slot);
+   }
+
+   slot->size = MIN2(size, UINT32_MAX);
+   slot->last_access = p_atomic_inc_return(&cache->lru_header->clock);
+   memcpy(slot->key, key, CACHE_KEY_SIZE);
+
+   flock(cache->lru_fd, LOCK_UN);
+}
+
+/* Forget 'key' without touching its file. */
+static void
+cache_lru_remove(struct disk_cache *cache, const cache_key key)
+{
+   if (cache->lru_slots == NULL)
+      return;
+
+   if (flock(cache->lru_fd, LOCK_EX) == -1)
+      return;
+
+   struct cache_lru_slot *slot = cache_lru_find_slot(cache, key, key);
+   if (slot)
+      memset(slot->key, 0, CACHE_KEY_SIZE);
+
+   flock(cache->lru_fd, LOCK_UN);
+}
+
+static void
+cache_lru_heap_sift_down(struct cache_lru_heap_entry *heap, unsigned count,
+                         unsigned i)
+{
+   while (true) {
+      unsigned smallest = i;
+      unsigned left = 2 * i + 1;
+      unsigned right = 2 * i + 2;
+
+      if (left < count &&
+          heap[left].last_access < heap[smallest].last_access)
+         smallest = left;
+      if (right < count &&
+          heap[right].last_access < heap[smallest].last_access)
+         smallest = right;
+
+      if (smallest == i)
+         return;
+
+      struct cache_lru_heap_entry tmp = heap[i];
+      heap[i] = heap[smallest];
+      heap[smallest] = tmp;
+      i = smallest;
+   }
+}
+
+/* Evict the least recently used files until 'needed' more bytes fit below
+ * the low watermark.  Returns false if the index ran out of entries before
+ * that, so the caller can fall back to evict_lru_item.
+ */
+static bool
+cache_lru_evict(struct disk_cache *cache, size_t needed)
+{
+   uint64_t target = cache->max_size - cache->max_size / 8;
+   bool fits = false;
+
+   if (cache->lru_slots == NULL)
+      return false;
+
+   struct cache_lru_heap_entry *heap =
+      malloc(CACHE_LRU_NUM_SLOTS * sizeof(*heap));
+   if (heap == NULL)
+      return false;
+
+   if (flock(cache->lru_fd, LOCK_EX) == -1) {
+      free(heap);
+      return false;
+   }
+
+   unsigned count = 0;
+   for (unsigned i = 0; i < CACHE_LRU_NUM_SLOTS; i++) {
+      const struct cache_lru_slot *slot = &cache->lru_slots[i];
+
+      if (memcmp(slot->key, cache_lru_empty_key, CACHE_KEY_SIZE) != 0) {
+         heap[count].last_access = slot->last_access;
+         heap[count].slot = i;
+         count++;
+      }
+   }
+
+   for (unsigned i = count / 2; i-- > 0; )
+      cache_lru_heap_sift_down(heap, count, i);
+
+   while (true) {
+      if (*cache->size + needed <= target) {
+         fits = true;
+         break;
+      }
+
+      if (count == 0)
+         break;
+
+      cache_lru_evict_slot(cache, &cache->lru_slots[heap[0].slot]);
+
+      heap[0] = heap[--count];
+      cache_lru_heap_sift_down(heap, count, 0);
+   }
+
+   flock(cache->lru_fd, LOCK_UN);
+   free(heap);
+
+   return fits;
+}
+
 void
 disk_cache_remove(struct disk_cache *cache, const cache_key key)
 {
    struct stat sb;
 
+   if (cache->db) {
+      cache_db_remove(cache->db, key);
+      return;
+   }
+
    char *filename = get_cache_file(cache, key);
    if (filename == NULL) {
       return;
@@ -682,6 +1428,8 @@ disk_cache_remove(struct disk_cache *cache, const cache_key key)
       return;
    }
 
+   cache_lru_remove(cache, key);
+
    unlink(filename);
    free(filename);
 
@@ -731,7 +1479,7 @@ write_all(int fd, const void *buf, size_t count)
  */
 static size_t
 deflate_and_write_to_disk(const void *in_data, size_t in_data_size, int dest,
-                          const char *filename)
+                          int level)
 {
    unsigned char *out;
 
@@ -743,7 +1491,7 @@ deflate_and_write_to_disk(const void *in_data, size_t in_data_size, int dest,
    strm.next_in = (uint8_t *) in_data;
    strm.avail_in = in_data_size;
 
-   int ret = deflateInit(&strm, Z_BEST_COMPRESSION);
+   int ret = deflateInit(&strm, MIN2(level, Z_BEST_COMPRESSION));
    if (ret != Z_OK)
        return 0;
 
@@ -795,6 +1543,51 @@ deflate_and_write_to_disk(const void *in_data, size_t in_data_size, int dest,
    return compressed_size;
 }
 
+#ifdef HAVE_ZSTD
+/**
+ * Compresses cache entry with zstd in one go and writes it to disk. Returns
+ * the size of the data written to disk.
+ */
+static size_t
+zstd_compress_and_write_to_disk(const void *in_data, size_t in_data_size,
+                                int dest, int level)
+{
+   size_t out_size = ZSTD_compressBound(in_data_size);
+   void *out = malloc(out_size);
+   if (out == NULL)
+      return 0;
+
+   size_t compressed_size = ZSTD_compress(out, out_size, in_data,
+                                          in_data_size, level);
+   if (ZSTD_isError(compressed_size) ||
+       write_all(dest, out, compressed_size) == -1) {
+      free(out);
+      return 0;
+   }
+
+   free(out);
+   return compressed_size;
+}
+#endif
+
+static size_t
+compress_and_write_to_disk(struct disk_cache *cache, const void *in_data,
+                           size_t in_data_size, int dest)
+{
+   switch (cache->codec) {
+#ifdef HAVE_ZSTD
+   case CACHE_CODEC_ZSTD:
+      return zstd_compress_and_write_to_disk(in_data, in_data_size, dest,
+                                             cache->compression_level);
+#endif
+   case CACHE_CODEC_ZLIB:
+      return deflate_and_write_to_disk(in_data, in_data_size, dest,
+                                       cache->compression_level);
+   default:
+      unreachable("unsupported cache codec");
+   }
+}
+
 static struct disk_cache_put_job *
 create_put_job(struct disk_cache *cache, const cache_key key,
                const void *data, size_t size,
@@ -854,6 +1647,7 @@ destroy_put_job(void *job, int thread_index)
 struct cache_entry_file_data {
    uint32_t crc32;
    uint32_t uncompressed_size;
+   uint32_t codec;
 };
 
 static void
@@ -866,15 +1660,23 @@ cache_put(void *job, int thread_index)
    char *filename = NULL, *filename_tmp = NULL;
    struct disk_cache_put_job *dc_job = (struct disk_cache_put_job *) job;
 
+   if (dc_job->cache->db) {
+      cache_db_put(dc_job->cache->db, dc_job->key, dc_job->data, dc_job->size);
+      return;
+   }
+
    filename = get_cache_file(dc_job->cache, dc_job->key);
    if (filename == NULL)
       goto done;
 
    /* If the cache is too large, evict something else first. */
-   while (*dc_job->cache->size + dc_job->size > dc_job->cache->max_size &&
-          i < 8) {
-      evict_lru_item(dc_job->cache);
-      i++;
+   if (*dc_job->cache->size + dc_job->size > dc_job->cache->max_size &&
+       !cache_lru_evict(dc_job->cache, dc_job->size)) {
+      while (*dc_job->cache->size + dc_job->size > dc_job->cache->max_size &&
+             i < 8) {
+         evict_lru_item(dc_job->cache);
+         i++;
+      }
    }
 
    /* Write to a temporary file to allow for an atomic rename to the
@@ -969,6 +1771,7 @@ cache_put(void *job, int thread_index)
    struct cache_entry_file_data cf_data;
    cf_data.crc32 = util_hash_crc32(dc_job->data, dc_job->size);
    cf_data.uncompressed_size = dc_job->size;
+   cf_data.codec = dc_job->cache->codec;
 
    size_t cf_data_size = sizeof(cf_data);
    ret = write_all(fd, &cf_data, cf_data_size);
@@ -981,8 +1784,8 @@ cache_put(void *job, int thread_index)
     * rename them atomically to the destination filename, and also
     * perform an atomic increment of the total cache size.
     */
-   size_t file_size = deflate_and_write_to_disk(dc_job->data, dc_job->size,
-                                                fd, filename_tmp);
+   size_t file_size = compress_and_write_to_disk(dc_job->cache, dc_job->data,
+                                                 dc_job->size, fd);
    if (file_size == 0) {
       unlink(filename_tmp);
       goto done;
@@ -1001,6 +1804,7 @@ cache_put(void *job, int thread_index)
    }
 
    p_atomic_add(dc_job->cache->size, sb.st_blocks * 512);
+   cache_lru_insert(dc_job->cache, dc_job->key, sb.st_blocks * 512);
 
  done:
    if (fd_final != -1)
@@ -1076,6 +1880,31 @@ inflate_cache_data(uint8_t *in_data, size_t in_data_size,
    return true;
 }
 
+/**
+ * Decompresses cache entry written with 'codec', returns true if
+ * successful.
+ */
+static bool
+decompress_cache_data(uint32_t codec, uint8_t *in_data, size_t in_data_size,
+                      uint8_t *out_data, size_t out_data_size)
+{
+   switch (codec) {
+   case CACHE_CODEC_ZLIB:
+      return inflate_cache_data(in_data, in_data_size,
+                                out_data, out_data_size);
+#ifdef HAVE_ZSTD
+   case CACHE_CODEC_ZSTD: {
+      size_t ret = ZSTD_decompress(out_data, out_data_size,
+                                   in_data, in_data_size);
+      return !ZSTD_isError(ret) && ret == out_data_size;
+   }
+#endif
+   default:
+      /* Written by a build with a codec we don't have. */
+      return false;
+   }
+}
+
 void *
 disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
 {
@@ -1111,6 +1940,9 @@ disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
       return blob;
    }
 
+   if (cache->db)
+      return cache_db_get(cache->db, key, size);
+
    filename = get_cache_file(cache, key);
    if (filename == NULL)
       goto fail;
@@ -1185,8 +2017,8 @@ disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
 
    /* Uncompress the cache data */
    uncompressed_data = malloc(cf_data.uncompressed_size);
-   if (!inflate_cache_data(data, cache_data_size, uncompressed_data,
-                           cf_data.uncompressed_size))
+   if (!decompress_cache_data(cf_data.codec, data, cache_data_size,
+                              uncompressed_data, cf_data.uncompressed_size))
       goto fail;
 
    /* Check the data for corruption */
@@ -1199,6 +2031,8 @@ disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
    free(file_header);
    close(fd);
 
+   cache_lru_touch(cache, key);
+
    if (size)
       *size = cf_data.uncompressed_size;
 
@@ -1219,6 +2053,130 @@ disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
    return NULL;
 }
 
+struct disk_cache_get_job {
+   struct util_queue_fence fence;
+
+   struct disk_cache *cache;
+
+   cache_key key;
+
+   /* Result of the lookup, taken by disk_cache_batch_get(). */
+   void *data;
+   size_t size;
+};
+
+struct disk_cache_batch {
+   unsigned num_jobs;
+   struct disk_cache_get_job jobs[];
+};
+
+static void
+cache_get(void *job, int thread_index)
+{
+   struct disk_cache_get_job *dc_job = (struct disk_cache_get_job *) job;
+
+   dc_job->data = disk_cache_get(dc_job->cache, dc_job->key, &dc_job->size);
+}
+
+/* Lookups are mostly waiting on the filesystem, so use a few more threads
+ * than the single one compressing and writing entries.
+ */
+static bool
+start_read_queue(struct disk_cache *cache)
+{
+   mtx_lock(&cache->read_queue_mutex);
+
+   if (!cache->read_queue_init) {
+      long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+      unsigned num_threads = CLAMP(num_cpus, 1, 8);
+
+      cache->read_queue_init =
+         util_queue_init(&cache->read_queue, "disk$r", 64, num_threads,
+                         UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+                         UTIL_QUEUE_INIT_SHARED_POOL);
+   }
+
+   mtx_unlock(&cache->read_queue_mutex);
+
+   return cache->read_queue_init;
+}
+
+struct disk_cache_batch *
+disk_cache_get_batch(struct disk_cache *cache, const cache_key *keys,
+                     unsigned num_keys)
+{
+   struct disk_cache_batch *batch =
+      malloc(sizeof(*batch) + num_keys * sizeof(batch->jobs[0]));
+   if (batch == NULL)
+      return NULL;
+
+   batch->num_jobs = num_keys;
+
+   /* The Android blob callbacks and a cache without a directory answer
+    * immediately, so there's nothing to gain from the threads.
+    */
+   bool async = !cache->blob_get_cb && !cache->path_init_failed &&
+                start_read_queue(cache);
+
+   for (unsigned i = 0; i < num_keys; i++) {
+      struct disk_cache_get_job *dc_job = &batch->jobs[i];
+
+      dc_job->cache = cache;
+      memcpy(dc_job->key, keys[i], sizeof(cache_key));
+      dc_job->data = NULL;
+      dc_job->size = 0;
+      util_queue_fence_init(&dc_job->fence);
+
+      if (async) {
+         util_queue_add_job(&cache->read_queue, dc_job, &dc_job->fence,
+                            cache_get, NULL);
+      } else {
+         cache_get(dc_job, 0);
+      }
+   }
+
+   return batch;
+}
+
+void *
+disk_cache_batch_get(struct disk_cache_batch *batch, unsigned index,
+                     size_t *size)
+{
+   if (size)
+      *size = 0;
+
+   if (batch == NULL)
+      return NULL;
+
+   assert(index < batch->num_jobs);
+   struct disk_cache_get_job *dc_job = &batch->jobs[index];
+
+   util_queue_fence_wait(&dc_job->fence);
+
+   void *data = dc_job->data;
+   dc_job->data = NULL;
+
+   if (data && size)
+      *size = dc_job->size;
+
+   return data;
+}
+
+void
+disk_cache_batch_destroy(struct disk_cache_batch *batch)
+{
+   if (batch == NULL)
+      return;
+
+   for (unsigned i = 0; i < batch->num_jobs; i++) {
+      util_queue_fence_wait(&batch->jobs[i].fence);
+      util_queue_fence_destroy(&batch->jobs[i].fence);
+      free(batch->jobs[i].data);
+   }
+
+   free(batch);
+}
+
 void
 disk_cache_put_key(struct disk_cache *cache, const cache_key key)
 {
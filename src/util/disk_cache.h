@@ -174,6 +174,13 @@ disk_cache_create(const char *gpu_name, const char *timestamp,
 void
 disk_cache_destroy(struct disk_cache *cache);
 
+/**
+ * Wait for the items queued by disk_cache_put() to be written, which
+ * disk_cache_destroy() doesn't do.
+ */
+void
+disk_cache_wait_for_idle(struct disk_cache *cache);
+
 /**
  * Remove the item in the cache under the name \key.
  */
@@ -210,6 +217,44 @@ disk_cache_put(struct disk_cache *cache, const cache_key key,
 void *
 disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size);
 
+/**
+ * Start looking up \num_keys items at once.
+ *
+ * The lookups run in parallel on worker threads owned by the cache, so
+ * a driver warming many pipelines or programs at load time doesn't have
+ * to serialize on the cache's I/O. The results are collected with
+ * disk_cache_batch_get(), in any order, while later lookups may still be
+ * in flight.
+ *
+ * The keys are copied, so \keys can be freed once this returns. Every
+ * batch must be passed to disk_cache_batch_destroy() before the cache is
+ * destroyed.
+ *
+ * \return The batch, or NULL on allocation failure, in which case
+ * disk_cache_batch_get() reports every item as missing.
+ */
+struct disk_cache_batch *
+disk_cache_get_batch(struct disk_cache *cache, const cache_key *keys,
+                     unsigned num_keys);
+
+/**
+ * Wait for the lookup of the \index'th key of \batch and take its result.
+ *
+ * \return What disk_cache_get() would have returned for that key. The
+ * caller owns the returned data and should free() it; asking for the same
+ * index again returns NULL.
+ */
+void *
+disk_cache_batch_get(struct disk_cache_batch *batch, unsigned index,
+                     size_t *size);
+
+/**
+ * Wait for all lookups in \batch and free it, along with any results that
+ * weren't taken with disk_cache_batch_get().
+ */
+void
+disk_cache_batch_destroy(struct disk_cache_batch *batch);
+
 /**
  * Store the name \key within the cache, (without any associated data).
  *
@@ -268,6 +313,12 @@ disk_cache_put(struct disk_cache *cache, const cache_key key,
    return;
 }
 
+static inline void
+disk_cache_wait_for_idle(struct disk_cache *cache)
+{
+   return;
+}
+
 static inline void
 disk_cache_remove(struct disk_cache *cache, const cache_key key)
 {
@@ -280,6 +331,28 @@ disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
    return NULL;
 }
 
+static inline struct disk_cache_batch *
+disk_cache_get_batch(struct disk_cache *cache, const cache_key *keys,
+                     unsigned num_keys)
+{
+   return NULL;
+}
+
+static inline void *
+disk_cache_batch_get(struct disk_cache_batch *batch, unsigned index,
+                     size_t *size)
+{
+   if (size)
+      *size = 0;
+   return NULL;
+}
+
+static inline void
+disk_cache_batch_destroy(struct disk_cache_batch *batch)
+{
+   return;
+}
+
 static inline void
 disk_cache_put_key(struct disk_cache *cache, const cache_key key)
 {
@@ -47,9 +47,19 @@
 #include "hash_table.h"
 #include "ralloc.h"
 #include "macros.h"
+#include "bitscan.h"
 #include "main/hash.h"
 #include "fast_urem_by_const.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define SWISS_USE_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define SWISS_USE_NEON
+#include <arm_neon.h>
+#endif
+
 static const uint32_t deleted_key_value;
 
 /**
@@ -141,6 +151,7 @@ _mesa_hash_table_init(struct hash_table *ht,
    ht->entries = 0;
    ht->deleted_entries = 0;
    ht->deleted_key = &deleted_key_value;
+   ht->ctrl = NULL;
 
    return ht->table != NULL;
 }
@@ -168,6 +179,319 @@ _mesa_hash_table_create(void *mem_ctx,
    return ht;
 }
 
+/**
+ * Swiss table style hash tables.
+ *
+ * Tables created with _mesa_hash_table_create_swiss() keep the same array of
+ * hash_entry, so iteration, removal by entry and direct access to entries
+ * work exactly as for the others.  Next to it they keep one control byte
+ * per entry: either SWISS_CTRL_EMPTY, SWISS_CTRL_DELETED, or 7 bits of the
+ * entry's hash.  Lookups compare SWISS_GROUP_WIDTH control bytes at a time
+ * and only touch the entries whose bits match, instead of loading one entry
+ * per probe.
+ *
+ * The size is a power of two.  Probing starts at the slot picked by the low
+ * bits of the (mixed) hash and steps over whole groups with a growing stride, which
+ * reaches every group.  A group holding an empty slot ends a search.  The
+ * first SWISS_GROUP_WIDTH control bytes are mirrored past the end of the
+ * array so that a group can be loaded from any slot without wrapping.
+ */
+#define SWISS_GROUP_WIDTH 16
+#define SWISS_MIN_SIZE 16
+
+#define SWISS_CTRL_EMPTY 0x80
+#define SWISS_CTRL_DELETED 0xfe
+
+/* Bitmask with a bit set for each matching slot of a group. */
+typedef uint64_t swiss_mask;
+
+#if defined(SWISS_USE_SSE2)
+
+#define SWISS_MASK_SHIFT 0
+
+static inline swiss_mask
+swiss_match(const uint8_t *group, uint8_t value)
+{
+   __m128i ctrl = _mm_loadu_si128((const __m128i *) group);
+   return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(value)));
+}
+
+/* Empty and deleted slots are the ones with the top bit set. */
+static inline swiss_mask
+swiss_match_free(const uint8_t *group)
+{
+   return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) group));
+}
+
+#elif defined(SWISS_USE_NEON)
+
+/* NEON has no movemask, narrowing the comparison result leaves a nibble per
+ * slot, of which we keep the top bit.
+ */
+#define SWISS_MASK_SHIFT 2
+
+static inline swiss_mask
+swiss_neon_mask(uint8x16_t cmp)
+{
+   uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(cmp), 4);
+   return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0) &
+          0x8888888888888888ull;
+}
+
+static inline swiss_mask
+swiss_match(const uint8_t *group, uint8_t value)
+{
+   return swiss_neon_mask(vceqq_u8(vld1q_u8(group), vdupq_n_u8(value)));
+}
+
+static inline swiss_mask
+swiss_match_free(const uint8_t *group)
+{
+   int8x16_t ctrl = vreinterpretq_s8_u8(vld1q_u8(group));
+   return swiss_neon_mask(vcltq_s8(ctrl, vdupq_n_s8(0)));
+}
+
+#else
+
+#define SWISS_MASK_SHIFT 0
+
+static inline swiss_mask
+swiss_match(const uint8_t *group, uint8_t value)
+{
+   swiss_mask mask = 0;
+   for (unsigned i = 0; i < SWISS_GROUP_WIDTH; i++)
+      mask |= (swiss_mask) (group[i] == value) << i;
+   return mask;
+}
+
+static inline swiss_mask
+swiss_match_free(const uint8_t *group)
+{
+   swiss_mask mask = 0;
+   for (unsigned i = 0; i < SWISS_GROUP_WIDTH; i++)
+      mask |= (swiss_mask) (group[i] >> 7) << i;
+   return mask;
+}
+
+#endif
+
+/* Slot within the group of the lowest set bit of a non-zero mask. */
+static inline unsigned
+swiss_mask_first(swiss_mask mask)
+{
+   return (ffsll(mask) - 1) >> SWISS_MASK_SHIFT;
+}
+
+/* Many of the hash functions used with these tables, _mesa_hash_pointer()
+ * in particular, leave the high bits nearly constant.  Both the slot and the
+ * tag are taken from a mixed hash instead (the murmur3 finalizer), while
+ * entries keep the original one.
+ */
+static inline uint32_t
+swiss_mix(uint32_t hash)
+{
+   hash ^= hash >> 16;
+   hash *= 0x85ebca6b;
+   hash ^= hash >> 13;
+   hash *= 0xc2b2ae35;
+   hash ^= hash >> 16;
+   return hash;
+}
+
+/* The low bits of the mixed hash pick the slot, the tag comes from the top. */
+static inline uint8_t
+swiss_tag(uint32_t mixed)
+{
+   return mixed >> 25;
+}
+
+static inline void
+swiss_set_ctrl(struct hash_table *ht, uint32_t index, uint8_t value)
+{
+   ht->ctrl[index] = value;
+   if (index < SWISS_GROUP_WIDTH)
+      ht->ctrl[ht->size + index] = value;
+}
+
+static bool
+swiss_alloc(struct hash_table *ht, void *mem_ctx, uint32_t size)
+{
+   struct hash_entry *table = rzalloc_array(mem_ctx, struct hash_entry, size);
+   if (table == NULL)
+      return false;
+
+   uint8_t *ctrl = ralloc_array(table, uint8_t, size + SWISS_GROUP_WIDTH);
+   if (ctrl == NULL) {
+      ralloc_free(table);
+      return false;
+   }
+
+   memset(ctrl, SWISS_CTRL_EMPTY, size + SWISS_GROUP_WIDTH);
+
+   ht->table = table;
+   ht->ctrl = ctrl;
+   ht->size = size;
+   ht->max_entries = size - size / 8;
+   ht->entries = 0;
+   ht->deleted_entries = 0;
+
+   return true;
+}
+
+/* Iterate over the groups in the probe sequence of 'mixed', setting 'pos' to
+ * the first slot of each.  Visiting each group at most once also bounds the
+ * loop if a failed resize let the table fill up.
+ */
+#define swiss_foreach_group(ht, mixed, pos)                                \
+   for (uint32_t pos = (mixed) & ((ht)->size - 1),                         \
+                 _stride = SWISS_GROUP_WIDTH, _n = 0;                      \
+        _n < (ht)->size / SWISS_GROUP_WIDTH;                               \
+        pos = (pos + _stride) & ((ht)->size - 1),                          \
+        _stride += SWISS_GROUP_WIDTH, _n++)
+
+static struct hash_entry *
+swiss_search(struct hash_table *ht, uint32_t hash, const void *key)
+{
+   uint32_t mask = ht->size - 1;
+   uint32_t mixed = swiss_mix(hash);
+   uint8_t tag = swiss_tag(mixed);
+
+   swiss_foreach_group(ht, mixed, pos) {
+      const uint8_t *group = ht->ctrl + pos;
+
+      for (swiss_mask m = swiss_match(group, tag); m; m &= m - 1) {
+         struct hash_entry *entry =
+            ht->table + ((pos + swiss_mask_first(m)) & mask);
+
+         if (entry->hash == hash && ht->key_equals_function(key, entry->key))
+            return entry;
+      }
+
+      if (swiss_match(group, SWISS_CTRL_EMPTY))
+         return NULL;
+   }
+
+   return NULL;
+}
+
+/* Returns the index of the first empty or deleted slot on the probe
+ * sequence of 'mixed', or ht->size if there is none.
+ */
+static uint32_t
+swiss_find_free(struct hash_table *ht, uint32_t mixed)
+{
+   swiss_foreach_group(ht, mixed, pos) {
+      swiss_mask m = swiss_match_free(ht->ctrl + pos);
+      if (m)
+         return (pos + swiss_mask_first(m)) & (ht->size - 1);
+   }
+
+   return ht->size;
+}
+
+static void
+swiss_rehash(struct hash_table *ht, uint32_t new_size)
+{
+   struct hash_table old_ht = *ht;
+
+   if (new_size < old_ht.size || new_size > (1u << 31))
+      return;
+
+   if (!swiss_alloc(ht, ralloc_parent(old_ht.table), new_size))
+      return;
+
+   hash_table_foreach(&old_ht, entry) {
+      uint32_t mixed = swiss_mix(entry->hash);
+      uint32_t index = swiss_find_free(ht, mixed);
+
+      swiss_set_ctrl(ht, index, swiss_tag(mixed));
+      ht->table[index] = *entry;
+   }
+
+   ht->entries = old_ht.entries;
+
+   ralloc_free(old_ht.table);
+}
+
+static struct hash_entry *
+swiss_insert(struct hash_table *ht, uint32_t hash, const void *key, void *data)
+{
+   if (ht->entries >= ht->max_entries) {
+      swiss_rehash(ht, ht->size * 2);
+   } else if (ht->deleted_entries + ht->entries >= ht->max_entries) {
+      swiss_rehash(ht, ht->size);
+   }
+
+   /* Replace the data of an existing entry, like hash_table_insert(). */
+   struct hash_entry *entry = swiss_search(ht, hash, key);
+   if (entry) {
+      entry->key = key;
+      entry->data = data;
+      return entry;
+   }
+
+   uint32_t mixed = swiss_mix(hash);
+   uint32_t index = swiss_find_free(ht, mixed);
+   if (index == ht->size)
+      return NULL;
+
+   if (ht->ctrl[index] == SWISS_CTRL_DELETED)
+      ht->deleted_entries--;
+   swiss_set_ctrl(ht, index, swiss_tag(mixed));
+
+   entry = ht->table + index;
+   entry->hash = hash;
+   entry->key = key;
+   entry->data = data;
+   ht->entries++;
+
+   return entry;
+}
+
+bool
+_mesa_hash_table_init_swiss(struct hash_table *ht,
+                            void *mem_ctx,
+                            uint32_t (*key_hash_function)(const void *key),
+                            bool (*key_equals_function)(const void *a,
+                                                        const void *b))
+{
+   ht->size_index = 0;
+   ht->rehash = 0;
+   ht->size_magic = 0;
+   ht->rehash_magic = 0;
+   ht->key_hash_function = key_hash_function;
+   ht->key_equals_function = key_equals_function;
+   ht->deleted_key = &deleted_key_value;
+
+   return swiss_alloc(ht, mem_ctx, SWISS_MIN_SIZE);
+}
+
+/**
+ * Creates a hash table that probes groups of control bytes with SIMD
+ * instructions.  It is used through the same functions as any other hash
+ * table, but lookups in large or busy tables touch much less memory.
+ */
+struct hash_table *
+_mesa_hash_table_create_swiss(void *mem_ctx,
+                              uint32_t (*key_hash_function)(const void *key),
+                              bool (*key_equals_function)(const void *a,
+                                                          const void *b))
+{
+   struct hash_table *ht;
+
+   ht = ralloc(mem_ctx, struct hash_table);
+   if (ht == NULL)
+      return NULL;
+
+   if (!_mesa_hash_table_init_swiss(ht, ht, key_hash_function,
+                                    key_equals_function)) {
+      ralloc_free(ht);
+      return NULL;
+   }
+
+   return ht;
+}
+
 struct hash_table *
 _mesa_hash_table_clone(struct hash_table *src, void *dst_mem_ctx)
 {
@@ -187,6 +511,17 @@ _mesa_hash_table_clone(struct hash_table *src, void *dst_mem_ctx)
 
    memcpy(ht->table, src->table, ht->size * sizeof(struct hash_entry));
 
+   if (src->ctrl) {
+      ht->ctrl = ralloc_array(ht->table, uint8_t,
+                              ht->size + SWISS_GROUP_WIDTH);
+      if (ht->ctrl == NULL) {
+         ralloc_free(ht);
+         return NULL;
+      }
+
+      memcpy(ht->ctrl, src->ctrl, ht->size + SWISS_GROUP_WIDTH);
+   }
+
    return ht;
 }
 
@@ -233,6 +568,9 @@ _mesa_hash_table_clear(struct hash_table *ht,
       entry->key = NULL;
    }
 
+   if (ht->ctrl)
+      memset(ht->ctrl, SWISS_CTRL_EMPTY, ht->size + SWISS_GROUP_WIDTH);
+
    ht->entries = 0;
    ht->deleted_entries = 0;
 }
@@ -258,6 +596,9 @@ hash_table_search(struct hash_table *ht, uint32_t hash, const void *key)
 {
    assert(!key_pointer_is_reserved(ht, key));
 
+   if (ht->ctrl)
+      return swiss_search(ht, hash, key);
+
    uint32_t size = ht->size;
    uint32_t start_hash_address = util_fast_urem32(hash, size, ht->size_magic);
    uint32_t double_hash = 1 + util_fast_urem32(hash, ht->rehash,
@@ -376,6 +717,9 @@ hash_table_insert(struct hash_table *ht, uint32_t hash,
 
    assert(!key_pointer_is_reserved(ht, key));
 
+   if (ht->ctrl)
+      return swiss_insert(ht, hash, key, data);
+
    if (ht->entries >= ht->max_entries) {
       _mesa_hash_table_rehash(ht, ht->size_index + 1);
    } else if (ht->deleted_entries + ht->entries >= ht->max_entries) {
@@ -472,6 +816,9 @@ _mesa_hash_table_remove(struct hash_table *ht,
    if (!entry)
       return;
 
+   if (ht->ctrl)
+      swiss_set_ctrl(ht, entry - ht->table, SWISS_CTRL_DELETED);
+
    entry->key = ht->deleted_key;
    ht->entries--;
    ht->deleted_entries++;
@@ -57,6 +57,11 @@ struct hash_table {
    uint32_t size_index;
    uint32_t entries;
    uint32_t deleted_entries;
+
+   /* One control byte per entry plus a mirrored copy of the first group, for
+    * tables from _mesa_hash_table_create_swiss().  NULL otherwise.
+    */
+   uint8_t *ctrl;
 };
 
 struct hash_table *
@@ -72,6 +77,19 @@ _mesa_hash_table_init(struct hash_table *ht,
                       bool (*key_equals_function)(const void *a,
                                                   const void *b));
 
+struct hash_table *
+_mesa_hash_table_create_swiss(void *mem_ctx,
+                              uint32_t (*key_hash_function)(const void *key),
+                              bool (*key_equals_function)(const void *a,
+                                                          const void *b));
+
+bool
+_mesa_hash_table_init_swiss(struct hash_table *ht,
+                            void *mem_ctx,
+                            uint32_t (*key_hash_function)(const void *key),
+                            bool (*key_equals_function)(const void *a,
+                                                        const void *b));
+
 struct hash_table *
 _mesa_hash_table_clone(struct hash_table *src, void *dst_mem_ctx);
 void _mesa_hash_table_destroy(struct hash_table *ht,
@@ -44,7 +44,14 @@ _CRTIMP int _vscprintf(const char *format, va_list argptr);
 #endif
 #endif
 
-#define CANARY 0x5A1106
+/* Every allocation is preceded by a 32-bit tag saying which kind of header
+ * sits in front of it.  Besides catching pointers that weren't ralloc'd, the
+ * tag is what lets an arena's children get away with a 16-byte header.
+ */
+#define RALLOC_TAG_NODE   0x5A1106
+#define RALLOC_TAG_ARENA  0x5A1107
+#define RALLOC_TAG_LIGHT  0x5A1108
+#define RALLOC_TAG_LIGHT_DTOR 0x5A1109
 
 /* Align the header's size so that ralloc() allocations will return with the
  * same alignment as a libc malloc would have (8 on 32-bit GLIBC, 16 on
@@ -61,11 +68,6 @@ struct
 #endif
    ralloc_header
 {
-#ifndef NDEBUG
-   /* A canary value used to determine whether a pointer is ralloc'd. */
-   unsigned canary;
-#endif
-
    struct ralloc_header *parent;
 
    /* The first child (head of a linked list) */
@@ -76,23 +78,116 @@ struct
    struct ralloc_header *next;
 
    void (*destructor)(void *);
+
+#if UINTPTR_MAX > 0xffffffff
+   uint32_t unused;
+#endif
+   /* RALLOC_TAG_NODE or RALLOC_TAG_ARENA, must be last. */
+   uint32_t tag;
 };
 
 typedef struct ralloc_header ralloc_header;
 
+/* Header of an allocation made out of an arena context.  These aren't linked
+ * into the ralloc tree at all: the memory belongs to one of the arena's
+ * blocks and goes away with it.
+ */
+struct ralloc_light_header
+{
+   /* The arena's header, or its ralloc_arena_dtor record if the tag is
+    * RALLOC_TAG_LIGHT_DTOR.
+    */
+   void *link;
+#if UINTPTR_MAX <= 0xffffffff
+   uint32_t unused;
+#endif
+   uint32_t size;
+   uint32_t tag;
+};
+
+typedef struct ralloc_light_header ralloc_light_header;
+
 static void unlink_block(ralloc_header *info);
 static void unsafe_free(ralloc_header *info);
+static void *arena_alloc(ralloc_header *info, size_t size);
+
+static inline uint32_t
+get_tag(const void *ptr)
+{
+   return ((const uint32_t *) ptr)[-1];
+}
+
+static inline bool
+is_light(uint32_t tag)
+{
+   return tag == RALLOC_TAG_LIGHT || tag == RALLOC_TAG_LIGHT_DTOR;
+}
 
 static ralloc_header *
 get_header(const void *ptr)
 {
    ralloc_header *info = (ralloc_header *) (((char *) ptr) -
 					    sizeof(ralloc_header));
-   assert(info->canary == CANARY);
+   assert(info->tag == RALLOC_TAG_NODE || info->tag == RALLOC_TAG_ARENA);
    return info;
 }
 
+static ralloc_light_header *
+get_light_header(const void *ptr)
+{
+   ralloc_light_header *light = (ralloc_light_header *) (((char *) ptr) -
+                                                        sizeof(ralloc_light_header));
+   assert(is_light(light->tag));
+   return light;
+}
+
 #define PTR_FROM_HEADER(info) (((char *) info) + sizeof(ralloc_header))
+#define PTR_FROM_LIGHT(light) (((char *) light) + sizeof(ralloc_light_header))
+
+/* Arena contexts hand out memory from blocks of ARENA_BLOCK_SIZE bytes, which
+ * are ordinary ralloc children of the arena node.  Anything that doesn't fit
+ * comfortably in a block becomes an ordinary child instead.
+ */
+#define ARENA_BLOCK_SIZE (8192 - sizeof(ralloc_header))
+#define ARENA_MAX_CHILD_SIZE 2048
+#define ARENA_ALIGNMENT sizeof(ralloc_light_header)
+
+struct ralloc_arena_dtor {
+   ralloc_header *arena;
+   void *ptr;
+   void (*destructor)(void *);
+   struct ralloc_arena_dtor *next;
+};
+
+/* The data of an arena node. */
+struct ralloc_arena {
+   char *next;   /* first free byte of the current block */
+   char *end;    /* end of the current block */
+   struct ralloc_arena_dtor *dtors;
+};
+
+static ralloc_header *
+light_arena(const ralloc_light_header *light)
+{
+   if (light->tag == RALLOC_TAG_LIGHT_DTOR)
+      return ((struct ralloc_arena_dtor *) light->link)->arena;
+   return (ralloc_header *) light->link;
+}
+
+/* Return the node that children allocated out of ctx are linked to: ctx's own
+ * header, or the arena for allocations made out of an arena.
+ */
+static ralloc_header *
+get_parent_header(const void *ctx)
+{
+   if (ctx == NULL)
+      return NULL;
+
+   if (is_light(get_tag(ctx)))
+      return light_arena(get_light_header(ctx));
+
+   return get_header(ctx);
+}
 
 static void
 add_child(ralloc_header *parent, ralloc_header *info)
@@ -113,12 +208,11 @@ ralloc_context(const void *ctx)
    return ralloc_size(ctx, 0);
 }
 
-void *
-ralloc_size(const void *ctx, size_t size)
+static ralloc_header *
+alloc_node(ralloc_header *parent, size_t size)
 {
    void *block = malloc(size + sizeof(ralloc_header));
    ralloc_header *info;
-   ralloc_header *parent;
 
    if (unlikely(block == NULL))
       return NULL;
@@ -133,16 +227,196 @@ ralloc_size(const void *ctx, size_t size)
    info->prev = NULL;
    info->next = NULL;
    info->destructor = NULL;
-
-   parent = ctx != NULL ? get_header(ctx) : NULL;
+   info->tag = RALLOC_TAG_NODE;
 
    add_child(parent, info);
 
-#ifndef NDEBUG
-   info->canary = CANARY;
-#endif
+   return info;
+}
 
-   return PTR_FROM_HEADER(info);
+void *
+ralloc_size(const void *ctx, size_t size)
+{
+   ralloc_header *parent = get_parent_header(ctx);
+   ralloc_header *info;
+
+   if (parent != NULL && parent->tag == RALLOC_TAG_ARENA)
+      return arena_alloc(parent, size);
+
+   info = alloc_node(parent, size);
+   return likely(info) ? PTR_FROM_HEADER(info) : NULL;
+}
+
+void *
+ralloc_arena_context(const void *ctx)
+{
+   ralloc_header *info;
+   struct ralloc_arena *arena;
+
+   STATIC_ASSERT(offsetof(ralloc_header, tag) ==
+                 sizeof(ralloc_header) - sizeof(uint32_t));
+   STATIC_ASSERT(offsetof(ralloc_light_header, tag) ==
+                 sizeof(ralloc_light_header) - sizeof(uint32_t));
+   STATIC_ASSERT(sizeof(ralloc_light_header) == 16);
+
+   /* An arena created out of another one is an ordinary child of it, so that
+    * it can still be freed on its own.
+    */
+   info = alloc_node(get_parent_header(ctx), sizeof(struct ralloc_arena));
+   if (unlikely(info == NULL))
+      return NULL;
+
+   info->tag = RALLOC_TAG_ARENA;
+   arena = (struct ralloc_arena *) PTR_FROM_HEADER(info);
+   arena->next = NULL;
+   arena->end = NULL;
+   arena->dtors = NULL;
+
+   return arena;
+}
+
+static void *
+arena_alloc(ralloc_header *info, size_t size)
+{
+   struct ralloc_arena *arena = (struct ralloc_arena *) PTR_FROM_HEADER(info);
+   size_t full_size;
+   ralloc_light_header *light;
+
+   if (unlikely(size > ARENA_MAX_CHILD_SIZE)) {
+      ralloc_header *child = alloc_node(info, size);
+      return likely(child) ? PTR_FROM_HEADER(child) : NULL;
+   }
+
+   full_size = ALIGN_POT(sizeof(ralloc_light_header) + size, ARENA_ALIGNMENT);
+
+   if (unlikely(full_size > (size_t) (arena->end - arena->next))) {
+      ralloc_header *block = alloc_node(info, ARENA_BLOCK_SIZE);
+      if (unlikely(block == NULL))
+         return NULL;
+
+      arena->next = PTR_FROM_HEADER(block);
+      arena->end = arena->next + ARENA_BLOCK_SIZE;
+   }
+
+   light = (ralloc_light_header *) arena->next;
+   arena->next += full_size;
+
+   light->link = info;
+   light->size = size;
+   light->tag = RALLOC_TAG_LIGHT;
+
+   return PTR_FROM_LIGHT(light);
+}
+
+static char *
+light_end(const ralloc_light_header *light)
+{
+   return (char *) light +
+          ALIGN_POT(sizeof(ralloc_light_header) + light->size, ARENA_ALIGNMENT);
+}
+
+static void *
+resize_light(void *ptr, size_t size)
+{
+   ralloc_light_header *light = get_light_header(ptr);
+   ralloc_header *info = light_arena(light);
+   struct ralloc_arena *arena = (struct ralloc_arena *) PTR_FROM_HEADER(info);
+   void *new_ptr;
+
+   if (size <= light->size)
+      return ptr;
+
+   /* The most recent allocation can simply grow into the rest of its block. */
+   if (light_end(light) == arena->next && size <= ARENA_MAX_CHILD_SIZE &&
+       ALIGN_POT(sizeof(ralloc_light_header) + size, ARENA_ALIGNMENT) <=
+       (size_t) (arena->end - (char *) light)) {
+      light->size = size;
+      arena->next = light_end(light);
+      return ptr;
+   }
+
+   new_ptr = arena_alloc(info, size);
+   if (unlikely(new_ptr == NULL))
+      return NULL;
+
+   memcpy(new_ptr, ptr, light->size);
+
+   if (light->tag == RALLOC_TAG_LIGHT_DTOR) {
+      struct ralloc_arena_dtor *dtor = light->link;
+
+      light->link = info;
+      light->tag = RALLOC_TAG_LIGHT;
+
+      if (is_light(get_tag(new_ptr))) {
+         ralloc_light_header *new_light = get_light_header(new_ptr);
+         new_light->link = dtor;
+         new_light->tag = RALLOC_TAG_LIGHT_DTOR;
+         dtor->ptr = new_ptr;
+      } else {
+         get_header(new_ptr)->destructor = dtor->destructor;
+         dtor->destructor = NULL;
+      }
+   }
+
+   return new_ptr;
+}
+
+static void
+free_light(void *ptr)
+{
+   ralloc_light_header *light = get_light_header(ptr);
+   ralloc_header *info = light_arena(light);
+   struct ralloc_arena *arena = (struct ralloc_arena *) PTR_FROM_HEADER(info);
+
+   if (light->tag == RALLOC_TAG_LIGHT_DTOR) {
+      struct ralloc_arena_dtor *dtor = light->link;
+      void (*destructor)(void *) = dtor->destructor;
+
+      light->link = info;
+      light->tag = RALLOC_TAG_LIGHT;
+      dtor->destructor = NULL;
+
+      if (destructor != NULL)
+         destructor(ptr);
+   }
+
+   /* Only the most recent allocation can be given back. */
+   if (light_end(light) == arena->next)
+      arena->next = (char *) light;
+}
+
+static void
+set_light_destructor(void *ptr, void (*destructor)(void *))
+{
+   ralloc_light_header *light = get_light_header(ptr);
+   ralloc_header *info;
+   struct ralloc_arena *arena;
+   struct ralloc_arena_dtor *dtor;
+
+   if (light->tag == RALLOC_TAG_LIGHT_DTOR) {
+      dtor = light->link;
+      dtor->destructor = destructor;
+      return;
+   }
+
+   if (destructor == NULL)
+      return;
+
+   info = light->link;
+   arena = (struct ralloc_arena *) PTR_FROM_HEADER(info);
+
+   dtor = arena_alloc(info, sizeof(*dtor));
+   if (unlikely(dtor == NULL))
+      return;
+
+   dtor->arena = info;
+   dtor->ptr = ptr;
+   dtor->destructor = destructor;
+   dtor->next = arena->dtors;
+   arena->dtors = dtor;
+
+   light->link = dtor;
+   light->tag = RALLOC_TAG_LIGHT_DTOR;
 }
 
 void *
@@ -162,7 +436,12 @@ resize(void *ptr, size_t size)
 {
    ralloc_header *child, *old, *info;
 
+   if (is_light(get_tag(ptr)))
+      return resize_light(ptr, size);
+
    old = get_header(ptr);
+   /* Allocations out of the arena point back at its header. */
+   assert(old->tag != RALLOC_TAG_ARENA);
    info = realloc(old, size + sizeof(ralloc_header));
 
    if (info == NULL)
@@ -193,7 +472,7 @@ reralloc_size(const void *ctx, void *ptr, size_t size)
    if (unlikely(ptr == NULL))
       return ralloc_size(ctx, size);
 
-   assert(ralloc_parent(ptr) == ctx);
+   assert(get_parent_header(ralloc_parent(ptr)) == get_parent_header(ctx));
    return resize(ptr, size);
 }
 
@@ -203,7 +482,7 @@ rerzalloc_size(const void *ctx, void *ptr, size_t old_size, size_t new_size)
    if (unlikely(ptr == NULL))
       return rzalloc_size(ctx, new_size);
 
-   assert(ralloc_parent(ptr) == ctx);
+   assert(get_parent_header(ralloc_parent(ptr)) == get_parent_header(ctx));
    ptr = resize(ptr, new_size);
 
    if (new_size > old_size)
@@ -257,6 +536,11 @@ ralloc_free(void *ptr)
    if (ptr == NULL)
       return;
 
+   if (is_light(get_tag(ptr))) {
+      free_light(ptr);
+      return;
+   }
+
    info = get_header(ptr);
    unlink_block(info);
    unsafe_free(info);
@@ -286,6 +570,20 @@ unsafe_free(ralloc_header *info)
 {
    /* Recursively free any children...don't waste time unlinking them. */
    ralloc_header *temp;
+
+   /* Arena allocations go away with the arena's blocks, so run their
+    * destructors while the blocks are still around.
+    */
+   if (info->tag == RALLOC_TAG_ARENA) {
+      struct ralloc_arena *arena = (struct ralloc_arena *) PTR_FROM_HEADER(info);
+      struct ralloc_arena_dtor *dtor;
+
+      for (dtor = arena->dtors; dtor != NULL; dtor = dtor->next) {
+         if (dtor->destructor != NULL)
+            dtor->destructor(dtor->ptr);
+      }
+   }
+
    while (info->child != NULL) {
       temp = info->child;
       info->child = temp->next;
@@ -307,8 +605,17 @@ ralloc_steal(const void *new_ctx, void *ptr)
    if (unlikely(ptr == NULL))
       return;
 
+   /* Arena allocations can't leave their arena; stealing one into a context
+    * that allocates out of the same arena changes nothing.
+    */
+   if (is_light(get_tag(ptr))) {
+      assert(get_parent_header(new_ctx) ==
+             light_arena(get_light_header(ptr)));
+      return;
+   }
+
    info = get_header(ptr);
-   parent = new_ctx ? get_header(new_ctx) : NULL;
+   parent = get_parent_header(new_ctx);
 
    unlink_block(info);
 
@@ -323,8 +630,18 @@ ralloc_adopt(const void *new_ctx, void *old_ctx)
    if (unlikely(old_ctx == NULL))
       return;
 
+   /* Whatever was allocated out of an arena allocation belongs to the arena. */
+   if (is_light(get_tag(old_ctx))) {
+      assert(get_parent_header(new_ctx) ==
+             light_arena(get_light_header(old_ctx)));
+      return;
+   }
+
    old_info = get_header(old_ctx);
-   new_info = get_header(new_ctx);
+   new_info = get_parent_header(new_ctx);
+
+   /* The arena's blocks can't be handed to anyone else. */
+   assert(old_info->tag != RALLOC_TAG_ARENA);
 
    /* If there are no children, bail. */
    if (unlikely(old_info->child == NULL))
@@ -352,6 +669,9 @@ ralloc_parent(const void *ptr)
    if (unlikely(ptr == NULL))
       return NULL;
 
+   if (is_light(get_tag(ptr)))
+      return PTR_FROM_HEADER(light_arena(get_light_header(ptr)));
+
    info = get_header(ptr);
    return info->parent ? PTR_FROM_HEADER(info->parent) : NULL;
 }
@@ -359,7 +679,14 @@ ralloc_parent(const void *ptr)
 void
 ralloc_set_destructor(const void *ptr, void(*destructor)(void *))
 {
-   ralloc_header *info = get_header(ptr);
+   ralloc_header *info;
+
+   if (is_light(get_tag(ptr))) {
+      set_light_destructor((void *) ptr, destructor);
+      return;
+   }
+
+   info = get_header(ptr);
    info->destructor = destructor;
 }
 
@@ -91,6 +91,28 @@ extern "C" {
  */
 void *ralloc_context(const void *ctx);
 
+/**
+ * Allocate a new arena context.
+ *
+ * An arena context behaves like one from \c ralloc_context, except that
+ * everything allocated out of it (or out of anything allocated out of it) is
+ * bump-allocated from large blocks with a 16-byte header, instead of being
+ * malloc'd and linked into the ralloc tree one by one.  This suits the many
+ * small, short-lived allocations made by compiler passes.
+ *
+ * The price is that arena allocations share the arena's lifetime:
+ * - \c ralloc_free on them only runs their destructor; the memory is
+ *   reclaimed when the arena is freed.
+ * - They can't be stolen out of the arena.  \c ralloc_steal into anything
+ *   allocated out of the same arena is a no-op, anything else is an error.
+ * - \c ralloc_parent returns the arena itself.
+ *
+ * The arena as a whole can be freed, or stolen into another context, like any
+ * other ralloc'd pointer.  Allocations too large to be worth bump-allocating
+ * become ordinary children of the arena and keep the usual semantics.
+ */
+void *ralloc_arena_context(const void *ctx);
+
 /**
  * Allocate memory chained off of the given context.
  *
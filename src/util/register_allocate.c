@@ -118,6 +118,13 @@ struct ra_class {
     * the worst choice register from C conflict with".
     */
    unsigned int *q;
+
+   /**
+    * Range of BITSET_WORDs of regs containing any registers of the class,
+    * [regs_start_word, regs_end_word).
+    */
+   unsigned int regs_start_word;
+   unsigned int regs_end_word;
 };
 
 struct ra_node {
@@ -126,7 +133,6 @@ struct ra_node {
     * List of which nodes this node interferes with.  This should be
     * symmetric with the other node.
     */
-   BITSET_WORD *adjacency;
    unsigned int *adjacency_list;
    unsigned int adjacency_list_size;
    unsigned int adjacency_count;
@@ -169,6 +175,13 @@ struct ra_graph {
    struct ra_node *nodes;
    unsigned int count; /**< count of nodes. */
 
+   /**
+    * Lower triangle of the interference matrix, indexed with
+    * ra_adjacency_index().  Being triangular, it only needs to grow at the
+    * end when nodes are added.
+    */
+   BITSET_WORD *adjacency;
+
    unsigned int alloc; /**< count of nodes allocated. */
 
    unsigned int (*select_reg_callback)(struct ra_graph *g, BITSET_WORD *regs,
@@ -411,17 +424,49 @@ ra_set_finalize(struct ra_regs *regs, unsigned int **q_values)
       }
    }
 
+   for (b = 0; b < regs->class_count; b++) {
+      struct ra_class *class = regs->classes[b];
+      unsigned int words = BITSET_WORDS(regs->count);
+
+      class->regs_start_word = 0;
+      while (class->regs_start_word < words &&
+             !class->regs[class->regs_start_word])
+         class->regs_start_word++;
+
+      class->regs_end_word = words;
+      while (class->regs_end_word > class->regs_start_word &&
+             !class->regs[class->regs_end_word - 1])
+         class->regs_end_word--;
+   }
+
    for (b = 0; b < regs->count; b++) {
       ralloc_free(regs->regs[b].conflict_list);
       regs->regs[b].conflict_list = NULL;
    }
 }
 
+static uint64_t
+ra_adjacency_index(unsigned int n1, unsigned int n2)
+{
+   if (n1 < n2) {
+      unsigned int tmp = n1;
+      n1 = n2;
+      n2 = tmp;
+   }
+
+   return (uint64_t)n1 * (n1 + 1) / 2 + n2;
+}
+
+/* Number of BITSET_WORDs of the interference matrix for count nodes. */
+static unsigned int
+ra_adjacency_words(unsigned int count)
+{
+   return BITSET_WORDS(ra_adjacency_index(count, 0));
+}
+
 static void
 ra_add_node_adjacency(struct ra_graph *g, unsigned int n1, unsigned int n2)
 {
-   BITSET_SET(g->nodes[n1].adjacency, n2);
-
    assert(n1 != n2);
 
    int n1_class = g->nodes[n1].class;
@@ -443,7 +488,7 @@ ra_add_node_adjacency(struct ra_graph *g, unsigned int n1, unsigned int n2)
 static void
 ra_node_remove_adjacency(struct ra_graph *g, unsigned int n1, unsigned int n2)
 {
-   BITSET_CLEAR(g->nodes[n1].adjacency, n2);
+   BITSET_CLEAR(g->adjacency, ra_adjacency_index(n1, n2));
 
    assert(n1 != n2);
 
@@ -479,19 +524,18 @@ ra_realloc_interference_graph(struct ra_graph *g, unsigned int alloc)
 
    g->nodes = reralloc(g, g->nodes, struct ra_node, alloc);
 
-   unsigned g_bitset_count = BITSET_WORDS(g->alloc);
    unsigned bitset_count = BITSET_WORDS(alloc);
-   /* For nodes already in the graph, we just have to grow the adjacency set */
-   for (unsigned i = 0; i < g->alloc; i++) {
-      assert(g->nodes[i].adjacency != NULL);
-      g->nodes[i].adjacency = rerzalloc(g, g->nodes[i].adjacency, BITSET_WORD,
-                                        g_bitset_count, bitset_count);
-   }
+
+   /* The rows for the new nodes all come after the existing ones, so the
+    * matrix just needs zeroing at the end.
+    */
+   g->adjacency = rerzalloc(g, g->adjacency, BITSET_WORD,
+                            ra_adjacency_words(g->alloc),
+                            ra_adjacency_words(alloc));
 
    /* For new nodes, we have to fully initialize them */
    for (unsigned i = g->alloc; i < alloc; i++) {
       memset(&g->nodes[i], 0, sizeof(g->nodes[i]));
-      g->nodes[i].adjacency = rzalloc_array(g, BITSET_WORD, bitset_count);
       g->nodes[i].adjacency_list_size = 4;
       g->nodes[i].adjacency_list =
          ralloc_array(g, unsigned int, g->nodes[i].adjacency_list_size);
@@ -537,7 +581,7 @@ ra_resize_interference_graph(struct ra_graph *g, unsigned int count)
 {
    g->count = count;
    if (count > g->alloc)
-      ra_realloc_interference_graph(g, g->alloc * 2);
+      ra_realloc_interference_graph(g, MAX2(g->alloc * 2, count));
 }
 
 void ra_set_select_reg_callback(struct ra_graph *g,
@@ -580,7 +624,9 @@ ra_add_node_interference(struct ra_graph *g,
                          unsigned int n1, unsigned int n2)
 {
    assert(n1 < g->count && n2 < g->count);
-   if (n1 != n2 && !BITSET_TEST(g->nodes[n1].adjacency, n2)) {
+   uint64_t index = ra_adjacency_index(n1, n2);
+   if (n1 != n2 && !BITSET_TEST(g->adjacency, index)) {
+      BITSET_SET(g->adjacency, index);
       ra_add_node_adjacency(g, n1, n2);
       ra_add_node_adjacency(g, n2, n1);
    }
@@ -592,8 +638,6 @@ ra_reset_node_interference(struct ra_graph *g, unsigned int n)
    for (unsigned int i = 0; i < g->nodes[n].adjacency_count; i++)
       ra_node_remove_adjacency(g, g->nodes[n].adjacency_list[i], n);
 
-   memset(g->nodes[n].adjacency, 0,
-          BITSET_WORDS(g->count) * sizeof(BITSET_WORD));
    g->nodes[n].adjacency_count = 0;
 }
 
@@ -759,23 +803,6 @@ ra_simplify(struct ra_graph *g)
    g->tmp.stack_optimistic_start = stack_optimistic_start;
 }
 
-static bool
-ra_any_neighbors_conflict(struct ra_graph *g, unsigned int n, unsigned int r)
-{
-   unsigned int i;
-
-   for (i = 0; i < g->nodes[n].adjacency_count; i++) {
-      unsigned int n2 = g->nodes[n].adjacency_list[i];
-
-      if (!BITSET_TEST(g->tmp.in_stack, n2) &&
-          BITSET_TEST(g->regs->regs[r].conflicts, g->nodes[n2].reg)) {
-         return true;
-      }
-   }
-
-   return false;
-}
-
 /* Computes a bitfield of what regs are available for a given register
  * selection.
  *
@@ -791,19 +818,19 @@ ra_compute_available_regs(struct ra_graph *g, unsigned int n, BITSET_WORD *regs)
    memcpy(regs, c->regs, BITSET_WORDS(g->regs->count) * sizeof(BITSET_WORD));
 
    /* Remove any regs that conflict with nodes that we're adjacent to and have
-    * already colored.
+    * already colored.  Words outside of the class are zero already.
     */
    for (int i = 0; i < g->nodes[n].adjacency_count; i++) {
       unsigned int n2 = g->nodes[n].adjacency_list[i];
       unsigned int r = g->nodes[n2].reg;
 
       if (!BITSET_TEST(g->tmp.in_stack, n2)) {
-         for (int j = 0; j < BITSET_WORDS(g->regs->count); j++)
+         for (int j = c->regs_start_word; j < c->regs_end_word; j++)
             regs[j] &= ~g->regs->regs[r].conflicts[j];
       }
    }
 
-   for (int i = 0; i < BITSET_WORDS(g->regs->count); i++) {
+   for (int i = c->regs_start_word; i < c->regs_end_word; i++) {
       if (regs[i])
          return true;
    }
@@ -811,6 +838,27 @@ ra_compute_available_regs(struct ra_graph *g, unsigned int n, BITSET_WORD *regs)
    return false;
 }
 
+/* Returns the first register set in regs at or after start, wrapping around
+ * at count.  There must be one.
+ */
+static unsigned int
+ra_find_reg(const BITSET_WORD *regs, unsigned int start, unsigned int count)
+{
+   unsigned int words = BITSET_WORDS(count);
+   unsigned int i = start / BITSET_WORDBITS;
+   BITSET_WORD word = regs[i] & ~(BITSET_BIT(start) - 1);
+
+   for (unsigned int k = 0; k <= words; k++) {
+      if (word)
+         return i * BITSET_WORDBITS + ffs(word) - 1;
+
+      i = (i + 1) % words;
+      word = regs[i];
+   }
+
+   unreachable("no register available");
+}
+
 /**
  * Pops nodes from the stack back into the graph, coloring them with
  * registers as they go.
@@ -821,45 +869,35 @@ ra_compute_available_regs(struct ra_graph *g, unsigned int n, BITSET_WORD *regs)
 static bool
 ra_select(struct ra_graph *g)
 {
-   int start_search_reg = 0;
-   BITSET_WORD *select_regs = NULL;
-
-   if (g->select_reg_callback)
-      select_regs = malloc(BITSET_WORDS(g->regs->count) * sizeof(BITSET_WORD));
+   unsigned int start_search_reg = 0;
+   BITSET_WORD *select_regs =
+      malloc(BITSET_WORDS(g->regs->count) * sizeof(BITSET_WORD));
 
    while (g->tmp.stack_count != 0) {
-      unsigned int ri;
-      unsigned int r = -1;
+      unsigned int r;
       int n = g->tmp.stack[g->tmp.stack_count - 1];
-      struct ra_class *c = g->regs->classes[g->nodes[n].class];
 
       /* set this to false even if we return here so that
        * ra_get_best_spill_node() considers this node later.
        */
       BITSET_CLEAR(g->tmp.in_stack, n);
 
-      if (g->select_reg_callback) {
-         if (!ra_compute_available_regs(g, n, select_regs)) {
-            free(select_regs);
-            return false;
-         }
+      /* Gathering the available registers in one walk over the neighbors is
+       * much cheaper than checking all of them for each candidate register.
+       */
+      if (!ra_compute_available_regs(g, n, select_regs)) {
+         free(select_regs);
+         return false;
+      }
 
+      if (g->select_reg_callback) {
          r = g->select_reg_callback(g, select_regs, g->select_reg_callback_data);
       } else {
          /* Find the lowest-numbered reg which is not used by a member
           * of the graph adjacent to us.
           */
-         for (ri = 0; ri < g->regs->count; ri++) {
-            r = (start_search_reg + ri) % g->regs->count;
-            if (!reg_belongs_to_class(r, c))
-               continue;
-
-            if (!ra_any_neighbors_conflict(g, n, r))
-               break;
-         }
-
-         if (ri >= g->regs->count)
-            return false;
+         r = ra_find_reg(select_regs, start_search_reg % g->regs->count,
+                         g->regs->count);
       }
 
       g->nodes[n].reg = r;
@@ -39,17 +39,18 @@
 #define CHECK_MAGIC(element, value)
 #endif
 
+/* Value of slab_page_header::migrated once the owning child pool has been
+ * destroyed.  Elements are aligned, so it can't be an element address.
+ */
+#define SLAB_PAGE_ORPHANED 1
+
 /* One array element within a big buffer. */
 struct slab_element_header {
    /* The next element in the free or migrated list. */
    struct slab_element_header *next;
 
-   /* This is either
-    * - a pointer to the child pool to which this element belongs, or
-    * - a pointer to the orphaned page of the element, with the least
-    *   significant bit set to 1.
-    */
-   intptr_t owner;
+   /* The page that contains this element. */
+   struct slab_page_header *page;
 
 #ifndef NDEBUG
    intptr_t magic;
@@ -58,13 +59,22 @@ struct slab_element_header {
 
 /* The page is an array of allocations in one block. */
 struct slab_page_header {
-   union {
-      /* Next page in the same child pool. */
-      struct slab_page_header *next;
+   /* Next page in the same child pool. */
+   struct slab_page_header *next;
+
+   /* The child pool to which the elements belong, 0 once it's destroyed. */
+   intptr_t owner;
+
+   /* Lock-free stack of elements of this page that were freed with a
+    * different pool as the argument to slab_free, or SLAB_PAGE_ORPHANED.
+    * Other threads only ever push, and the owner takes the whole stack at
+    * once, so there is no ABA problem.
+    */
+   intptr_t migrated;
+
+   /* Number of remaining, non-freed elements (for orphaned pages). */
+   unsigned num_remaining;
 
-      /* Number of remaining, non-freed elements (for orphaned pages). */
-      unsigned num_remaining;
-   } u;
    /* Memory after the last member is dedicated to the page itself.
     * The allocated size is always larger than this structure.
     */
@@ -86,12 +96,11 @@ slab_get_element(struct slab_parent_pool *parent,
 static void
 slab_free_orphaned(struct slab_element_header *elt)
 {
-   struct slab_page_header *page;
+   struct slab_page_header *page = elt->page;
 
-   assert(elt->owner & 1);
+   assert(p_atomic_read(&page->migrated) == SLAB_PAGE_ORPHANED);
 
-   page = (struct slab_page_header *)(elt->owner & ~(intptr_t)1);
-   if (!p_atomic_dec_return(&page->u.num_remaining))
+   if (!p_atomic_dec_return(&page->num_remaining))
       free(page);
 }
 
@@ -106,7 +115,6 @@ slab_create_parent(struct slab_parent_pool *parent,
                    unsigned item_size,
                    unsigned num_items)
 {
-   mtx_init(&parent->mutex, mtx_plain);
    parent->element_size = ALIGN_POT(sizeof(struct slab_element_header) + item_size,
                                     sizeof(intptr_t));
    parent->num_elements = num_items;
@@ -115,7 +123,6 @@ slab_create_parent(struct slab_parent_pool *parent,
 void
 slab_destroy_parent(struct slab_parent_pool *parent)
 {
-   mtx_destroy(&parent->mutex);
 }
 
 /**
@@ -127,7 +134,6 @@ void slab_create_child(struct slab_child_pool *pool,
    pool->parent = parent;
    pool->pages = NULL;
    pool->free = NULL;
-   pool->migrated = NULL;
 }
 
 /**
@@ -141,31 +147,38 @@ void slab_destroy_child(struct slab_child_pool *pool)
    if (!pool->parent)
       return; /* the slab probably wasn't even created */
 
-   mtx_lock(&pool->parent->mutex);
+   /* Only count the elements in our free list, nobody else can free them. */
+   for (struct slab_page_header *page = pool->pages; page; page = page->next) {
+      p_atomic_set(&page->owner, 0);
+      page->num_remaining = pool->parent->num_elements;
+   }
+
+   for (struct slab_element_header *elt = pool->free; elt; elt = elt->next)
+      elt->page->num_remaining--;
+
+   pool->free = NULL;
 
    while (pool->pages) {
       struct slab_page_header *page = pool->pages;
-      pool->pages = page->u.next;
-      p_atomic_set(&page->u.num_remaining, pool->parent->num_elements);
+      pool->pages = page->next;
 
-      for (unsigned i = 0; i < pool->parent->num_elements; ++i) {
-         struct slab_element_header *elt = slab_get_element(pool->parent, page, i);
-         p_atomic_set(&elt->owner, (intptr_t)page | 1);
+      if (page->num_remaining == 0) {
+         free(page);
+         continue;
       }
-   }
-
-   while (pool->migrated) {
-      struct slab_element_header *elt = pool->migrated;
-      pool->migrated = elt->next;
-      slab_free_orphaned(elt);
-   }
 
-   mtx_unlock(&pool->parent->mutex);
+      /* From now on, other threads free elements of this page as orphans.
+       * Those that were migrated before count as remaining, so free them the
+       * same way.
+       */
+      struct slab_element_header *elt = (struct slab_element_header *)
+         p_atomic_xchg(&page->migrated, SLAB_PAGE_ORPHANED);
 
-   while (pool->free) {
-      struct slab_element_header *elt = pool->free;
-      pool->free = elt->next;
-      slab_free_orphaned(elt);
+      while (elt) {
+         struct slab_element_header *next = elt->next;
+         slab_free_orphaned(elt);
+         elt = next;
+      }
    }
 
    /* Guard against use-after-free. */
@@ -183,15 +196,16 @@ slab_add_new_page(struct slab_child_pool *pool)
 
    for (unsigned i = 0; i < pool->parent->num_elements; ++i) {
       struct slab_element_header *elt = slab_get_element(pool->parent, page, i);
-      elt->owner = (intptr_t)pool;
-      assert(!(elt->owner & 1));
+      elt->page = page;
 
       elt->next = pool->free;
       pool->free = elt;
       SET_MAGIC(elt, SLAB_MAGIC_FREE);
    }
 
-   page->u.next = pool->pages;
+   page->owner = (intptr_t)pool;
+   page->migrated = 0;
+   page->next = pool->pages;
    pool->pages = page;
 
    return true;
@@ -211,10 +225,20 @@ slab_alloc(struct slab_child_pool *pool)
       /* First, collect elements that belong to us but were freed from a
        * different child pool.
        */
-      mtx_lock(&pool->parent->mutex);
-      pool->free = pool->migrated;
-      pool->migrated = NULL;
-      mtx_unlock(&pool->parent->mutex);
+      for (struct slab_page_header *page = pool->pages; page;
+           page = page->next) {
+         if (!p_atomic_read(&page->migrated))
+            continue;
+
+         struct slab_element_header *list = (struct slab_element_header *)
+            p_atomic_xchg(&page->migrated, 0);
+         struct slab_element_header *tail = list;
+
+         while (tail->next)
+            tail = tail->next;
+         tail->next = pool->free;
+         pool->free = list;
+      }
 
       /* Now allocate a new page. */
       if (!pool->free && !slab_add_new_page(pool))
@@ -242,12 +266,12 @@ slab_alloc(struct slab_child_pool *pool)
 void slab_free(struct slab_child_pool *pool, void *ptr)
 {
    struct slab_element_header *elt = ((struct slab_element_header*)ptr - 1);
-   intptr_t owner_int;
+   struct slab_page_header *page = elt->page;
 
    CHECK_MAGIC(elt, SLAB_MAGIC_ALLOCATED);
    SET_MAGIC(elt, SLAB_MAGIC_FREE);
 
-   if (p_atomic_read(&elt->owner) == (intptr_t)pool) {
+   if (p_atomic_read(&page->owner) == (intptr_t)pool) {
       /* This is the simple case: The caller guarantees that we can safely
        * access the free list.
        */
@@ -256,24 +280,22 @@ void slab_free(struct slab_child_pool *pool, void *ptr)
       return;
    }
 
-   /* The slow case: migration or an orphaned page. */
-   mtx_lock(&pool->parent->mutex);
-
-   /* Note: we _must_ re-read elt->owner here because the owning child pool
-    * may have been destroyed by another thread in the meantime.
+   /* The slow case: push the element to the page, unless the owning child
+    * pool has been destroyed by another thread in the meantime.  The page
+    * can't go away before this element is freed.
     */
-   owner_int = p_atomic_read(&elt->owner);
+   intptr_t head = p_atomic_read(&page->migrated);
 
-   if (!(owner_int & 1)) {
-      struct slab_child_pool *owner = (struct slab_child_pool *)owner_int;
-      elt->next = owner->migrated;
-      owner->migrated = elt;
-      mtx_unlock(&pool->parent->mutex);
-   } else {
-      mtx_unlock(&pool->parent->mutex);
+   while (head != SLAB_PAGE_ORPHANED) {
+      elt->next = (struct slab_element_header *)head;
 
-      slab_free_orphaned(elt);
+      intptr_t old = p_atomic_cmpxchg(&page->migrated, head, (intptr_t)elt);
+      if (old == head)
+         return;
+      head = old;
    }
+
+   slab_free_orphaned(elt);
 }
 
 /**
@@ -33,7 +33,8 @@
  * Allocations obtained from one child pool should usually be freed in the
  * same child pool. Freeing an allocation in a different child pool associated
  * to the same parent is allowed (and requires no locking by the caller), but
- * it is discouraged because it implies a performance penalty.
+ * it is slower, because the allocation is handed back to its pool with an
+ * atomic operation.
  *
  * For convenience and to ease the transition, there is also a set of wrapper
  * functions around a single parent-child pair.
@@ -48,7 +49,6 @@ struct slab_element_header;
 struct slab_page_header;
 
 struct slab_parent_pool {
-   mtx_t mutex;
    unsigned element_size;
    unsigned num_elements;
 };
@@ -60,13 +60,6 @@ struct slab_child_pool {
 
    /* Free elements. */
    struct slab_element_header *free;
-
-   /* Elements that are owned by this pool but were freed with a different
-    * pool as the argument to slab_free.
-    *
-    * This list is protected by the parent mutex.
-    */
-   struct slab_element_header *migrated;
 };
 
 void slab_create_parent(struct slab_parent_pool *parent,
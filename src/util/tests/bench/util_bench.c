@@ -0,0 +1,399 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Throughput and latency of the util data structures, allocators and
+ * queues.  Not run as a test, build it with
+ * "ninja src/util/tests/bench/util_bench".
+ *
+ * Results are printed as tab-separated "benchmark, parameter, value, unit"
+ * rows.  Pass the names of the benchmarks to run, or nothing for all of
+ * them.
+ */
+
+#define _XOPEN_SOURCE 700
+#include <fcntl.h>
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "c11/threads.h"
+#include "disk_cache.h"
+#include "hash_table.h"
+#include "macros.h"
+#include "os_time.h"
+#include "ralloc.h"
+#include "slab.h"
+#include "u_queue.h"
+
+static void
+report(const char *benchmark, const char *param, double value,
+       const char *unit)
+{
+   printf("%s\t%s\t%.1f\t%s\n", benchmark, param, value, unit);
+   fflush(stdout);
+}
+
+static uint32_t
+key_hash(const void *key)
+{
+   return _mesa_hash_pointer(key);
+}
+
+static bool
+key_equal(const void *a, const void *b)
+{
+   return a == b;
+}
+
+static void
+shuffle(void **array, unsigned count)
+{
+   for (unsigned i = count - 1; i > 0; i--) {
+      unsigned j = rand() % (i + 1);
+      void *tmp = array[i];
+      array[i] = array[j];
+      array[j] = tmp;
+   }
+}
+
+/* The default table resizes at a load factor of 70%, so doubling the key
+ * count lands each run at a different load factor.
+ */
+static void
+bench_hash_table(void)
+{
+   for (unsigned num_keys = 100; num_keys <= 1 << 20; num_keys *= 2) {
+      void **keys = malloc(num_keys * sizeof(*keys));
+      char *base = malloc(num_keys * 2);
+      unsigned found = 0;
+      char param[64];
+
+      for (unsigned i = 0; i < num_keys; i++)
+         keys[i] = base + 2 * i;
+      srand(1);
+      shuffle(keys, num_keys);
+
+      struct hash_table *ht = _mesa_hash_table_create(NULL, key_hash,
+                                                      key_equal);
+      int64_t start = os_time_get_nano();
+      for (unsigned i = 0; i < num_keys; i++)
+         _mesa_hash_table_insert(ht, keys[i], keys[i]);
+      int64_t inserted = os_time_get_nano();
+
+      snprintf(param, sizeof(param), "%u keys, load %.2f", num_keys,
+               (double)ht->entries / ht->size);
+
+      /* Even keys were inserted, odd ones are misses. */
+      for (unsigned i = 0; i < num_keys; i++)
+         found += _mesa_hash_table_search(ht, keys[i]) != NULL;
+      int64_t hits = os_time_get_nano();
+      for (unsigned i = 0; i < num_keys; i++)
+         found += _mesa_hash_table_search(ht, (char *)keys[i] + 1) != NULL;
+      int64_t misses = os_time_get_nano();
+      for (unsigned i = 0; i < num_keys; i++)
+         _mesa_hash_table_remove_key(ht, keys[i]);
+      int64_t removed = os_time_get_nano();
+
+      if (found != num_keys)
+         fprintf(stderr, "hash_table: found %u of %u keys\n", found, num_keys);
+
+      report("hash_insert", param, (double)(inserted - start) / num_keys, "ns");
+      report("hash_search_hit", param, (double)(hits - inserted) / num_keys,
+             "ns");
+      report("hash_search_miss", param, (double)(misses - hits) / num_keys,
+             "ns");
+      report("hash_remove", param, (double)(removed - misses) / num_keys,
+             "ns");
+
+      _mesa_hash_table_destroy(ht, NULL);
+      free(base);
+      free(keys);
+   }
+}
+
+#define SLAB_BATCH 256
+#define SLAB_ROUNDS 4096
+
+struct slab_thread {
+   struct slab_parent_pool *parent;
+   thrd_t thread;
+};
+
+static int
+slab_thread_func(void *data)
+{
+   struct slab_thread *t = data;
+   struct slab_child_pool pool;
+   void *items[SLAB_BATCH];
+
+   slab_create_child(&pool, t->parent);
+   for (unsigned r = 0; r < SLAB_ROUNDS; r++) {
+      for (unsigned i = 0; i < SLAB_BATCH; i++)
+         items[i] = slab_alloc(&pool);
+      for (unsigned i = 0; i < SLAB_BATCH; i++)
+         slab_free(&pool, items[i]);
+   }
+   slab_destroy_child(&pool);
+
+   return 0;
+}
+
+/* Each thread has its own child pool of a shared parent, the way contexts
+ * of a screen do.
+ */
+static void
+bench_slab(void)
+{
+   for (unsigned num_threads = 1; num_threads <= 8; num_threads *= 2) {
+      struct slab_parent_pool parent;
+      struct slab_thread threads[8];
+      char param[64];
+
+      slab_create_parent(&parent, 64, 64);
+
+      int64_t start = os_time_get_nano();
+      for (unsigned i = 0; i < num_threads; i++) {
+         threads[i].parent = &parent;
+         thrd_create(&threads[i].thread, slab_thread_func, &threads[i]);
+      }
+      for (unsigned i = 0; i < num_threads; i++)
+         thrd_join(threads[i].thread, NULL);
+      int64_t end = os_time_get_nano();
+
+      slab_destroy_parent(&parent);
+
+      /* wall time per alloc+free pair, over all threads */
+      snprintf(param, sizeof(param), "%u threads", num_threads);
+      report("slab_alloc_free", param,
+             (double)(end - start) /
+             ((uint64_t)SLAB_BATCH * SLAB_ROUNDS * num_threads), "ns");
+   }
+}
+
+#define QUEUE_JOBS 4096
+
+struct queue_job {
+   struct util_queue_fence fence;
+   int64_t added;
+   int64_t started;
+   unsigned work;
+};
+
+static void
+queue_job_execute(void *data, int thread_index)
+{
+   struct queue_job *job = data;
+   volatile unsigned x = 0;
+
+   job->started = os_time_get_nano();
+   for (unsigned i = 0; i < job->work; i++)
+      x += i;
+}
+
+static int
+compare_int64(const void *a, const void *b)
+{
+   int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+   return x < y ? -1 : x > y;
+}
+
+/* Time from util_queue_add_job() to the job starting, with jobs doing no
+ * work and with jobs doing enough to keep the threads busy.
+ */
+static void
+bench_util_queue(void)
+{
+   static struct queue_job jobs[QUEUE_JOBS];
+   static int64_t latency[QUEUE_JOBS];
+
+   for (unsigned num_threads = 1; num_threads <= 4; num_threads *= 2) {
+      for (unsigned work = 0; work <= 10000; work += 10000) {
+         struct util_queue queue;
+         char param[64];
+
+         util_queue_init(&queue, "bench", QUEUE_JOBS, num_threads, 0);
+
+         for (unsigned i = 0; i < QUEUE_JOBS; i++) {
+            jobs[i].work = work;
+            util_queue_fence_init(&jobs[i].fence);
+            jobs[i].added = os_time_get_nano();
+            util_queue_add_job(&queue, &jobs[i], &jobs[i].fence,
+                               queue_job_execute, NULL);
+         }
+         for (unsigned i = 0; i < QUEUE_JOBS; i++) {
+            util_queue_fence_wait(&jobs[i].fence);
+            util_queue_fence_destroy(&jobs[i].fence);
+            latency[i] = jobs[i].started - jobs[i].added;
+         }
+
+         util_queue_destroy(&queue);
+
+         qsort(latency, QUEUE_JOBS, sizeof(latency[0]), compare_int64);
+         snprintf(param, sizeof(param), "%u threads, %s", num_threads,
+                  work ? "loaded" : "idle jobs");
+         report("queue_latency_p50", param, latency[QUEUE_JOBS / 2] / 1e3,
+                "us");
+         report("queue_latency_p99", param,
+                latency[QUEUE_JOBS * 99 / 100] / 1e3, "us");
+      }
+   }
+}
+
+#define CACHE_ITEMS 512
+#define CACHE_ITEM_SIZE 4096
+
+static int
+evict_file(const char *path, const struct stat *sb, int type,
+           struct FTW *ftw)
+{
+   if (type == FTW_F) {
+      int fd = open(path, O_RDONLY);
+      if (fd >= 0) {
+         posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+         close(fd);
+      }
+   }
+   return 0;
+}
+
+static int
+remove_file(const char *path, const struct stat *sb, int type,
+            struct FTW *ftw)
+{
+   remove(path);
+   return 0;
+}
+
+static void
+bench_disk_cache(void)
+{
+#ifdef ENABLE_SHADER_CACHE
+   char dir[] = "/tmp/util_bench_XXXXXX";
+   static cache_key keys[CACHE_ITEMS];
+   char data[CACHE_ITEM_SIZE];
+
+   if (!mkdtemp(dir)) {
+      fprintf(stderr, "disk_cache: couldn't create a cache directory\n");
+      return;
+   }
+   setenv("MESA_GLSL_CACHE_DIR", dir, 1);
+   unsetenv("MESA_GLSL_CACHE_DISABLE");
+
+   struct disk_cache *cache = disk_cache_create("util_bench", "0", 0);
+   if (!cache) {
+      fprintf(stderr, "disk_cache: couldn't create the cache\n");
+      return;
+   }
+
+   for (unsigned i = 0; i < CACHE_ITEMS; i++) {
+      memset(data, i, sizeof(data));
+      disk_cache_compute_key(cache, &i, sizeof(i), keys[i]);
+   }
+
+   int64_t start = os_time_get_nano();
+   for (unsigned i = 0; i < CACHE_ITEMS; i++)
+      disk_cache_put(cache, keys[i], data, sizeof(data), NULL);
+   disk_cache_wait_for_idle(cache);
+   int64_t put = os_time_get_nano();
+
+   for (unsigned i = 0; i < CACHE_ITEMS; i++)
+      free(disk_cache_get(cache, keys[i], NULL));
+   int64_t warm = os_time_get_nano();
+
+   /* Drop the cache files from the page cache, which needs no privileges
+    * for files nobody has dirty pages of.
+    */
+   nftw(dir, evict_file, 16, FTW_PHYS);
+   int64_t evicted = os_time_get_nano();
+   for (unsigned i = 0; i < CACHE_ITEMS; i++)
+      free(disk_cache_get(cache, keys[i], NULL));
+   int64_t cold = os_time_get_nano();
+
+   disk_cache_destroy(cache);
+
+   report("disk_cache_put", "4 KiB", (double)(put - start) / CACHE_ITEMS / 1e3,
+          "us");
+   report("disk_cache_get_warm", "4 KiB",
+          (double)(warm - put) / CACHE_ITEMS / 1e3, "us");
+   report("disk_cache_get_cold", "4 KiB",
+          (double)(cold - evicted) / CACHE_ITEMS / 1e3, "us");
+
+   nftw(dir, remove_file, 16, FTW_DEPTH | FTW_PHYS);
+#endif
+}
+
+#define ALLOC_COUNT (1 << 20)
+
+static void
+bench_ralloc(void)
+{
+   int64_t start = os_time_get_nano();
+   void *ctx = ralloc_context(NULL);
+   for (unsigned i = 0; i < ALLOC_COUNT; i++)
+      ralloc_size(ctx, 16 + (i & 48));
+   ralloc_free(ctx);
+   int64_t rallocs = os_time_get_nano();
+
+   ctx = ralloc_context(NULL);
+   void *parent = linear_alloc_parent(ctx, 0);
+   for (unsigned i = 0; i < ALLOC_COUNT; i++)
+      linear_alloc_child(parent, 16 + (i & 48));
+   ralloc_free(ctx);
+   int64_t linear = os_time_get_nano();
+
+   /* per allocation, including freeing them all at the end */
+   report("ralloc", "16-64 bytes", (double)(rallocs - start) / ALLOC_COUNT,
+          "ns");
+   report("linear_alloc", "16-64 bytes",
+          (double)(linear - rallocs) / ALLOC_COUNT, "ns");
+}
+
+static const struct {
+   const char *name;
+   void (*func)(void);
+} benchmarks[] = {
+   { "hash_table", bench_hash_table },
+   { "slab", bench_slab },
+   { "util_queue", bench_util_queue },
+   { "disk_cache", bench_disk_cache },
+   { "ralloc", bench_ralloc },
+};
+
+int
+main(int argc, char **argv)
+{
+   printf("# benchmark\tparameter\tvalue\tunit\n");
+
+   for (unsigned i = 0; i < ARRAY_SIZE(benchmarks); i++) {
+      bool run = argc < 2;
+      for (int j = 1; j < argc; j++)
+         run |= strcmp(argv[j], benchmarks[i].name) == 0;
+
+      if (run)
+         benchmarks[i].func();
+   }
+
+   return 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Compares lookup and insertion times of the default hash table and the
+ * swiss table variant.  Not run as a test, build it with
+ * "ninja src/util/tests/hash_table/hash_table_benchmark".
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include "hash_table.h"
+#include "os_time.h"
+
+static uint32_t
+key_hash(const void *key)
+{
+   return _mesa_hash_pointer(key);
+}
+
+static bool
+key_equal(const void *a, const void *b)
+{
+   return a == b;
+}
+
+typedef struct hash_table *(*create_func)(void *mem_ctx,
+                                          uint32_t (*)(const void *),
+                                          bool (*)(const void *,
+                                                   const void *));
+
+static void
+run(const char *name, create_func create, void **keys, unsigned num_keys,
+    unsigned iterations)
+{
+   struct hash_table *ht = create(NULL, key_hash, key_equal);
+   unsigned found = 0;
+
+   int64_t start = os_time_get_nano();
+   for (unsigned i = 0; i < num_keys; i++)
+      _mesa_hash_table_insert(ht, keys[i], keys[i]);
+   int64_t inserted = os_time_get_nano();
+
+   /* Even keys were inserted, odd ones are misses. */
+   for (unsigned n = 0; n < iterations; n++) {
+      for (unsigned i = 0; i < num_keys; i++) {
+         found += _mesa_hash_table_search(ht, keys[i]) != NULL;
+         found += _mesa_hash_table_search(ht, keys[i] + 1) != NULL;
+      }
+   }
+   int64_t searched = os_time_get_nano();
+
+   printf("%-8s %8u keys: insert %6.1f ns, search hit+miss %6.1f ns (%u)\n",
+          name, num_keys, (double)(inserted - start) / num_keys,
+          (double)(searched - inserted) / ((uint64_t)num_keys * iterations),
+          found);
+
+   _mesa_hash_table_destroy(ht, NULL);
+}
+
+int
+main(int argc, char **argv)
+{
+   (void) argc;
+   (void) argv;
+
+   for (unsigned num_keys = 64; num_keys <= 1 << 20; num_keys *= 8) {
+      void **keys = malloc(num_keys * sizeof(*keys));
+      char *base = malloc(num_keys * 2);
+
+      for (unsigned i = 0; i < num_keys; i++)
+         keys[i] = base + 2 * i;
+
+      /* Shuffle so that lookups don't walk the table in order. */
+      srand(1);
+      for (unsigned i = num_keys - 1; i > 0; i--) {
+         unsigned j = rand() % (i + 1);
+         void *tmp = keys[i];
+         keys[i] = keys[j];
+         keys[j] = tmp;
+      }
+
+      unsigned iterations = (1 << 24) / num_keys;
+      run("default", _mesa_hash_table_create, keys, num_keys, iterations);
+      run("swiss", _mesa_hash_table_create_swiss, keys, num_keys, iterations);
+
+      free(base);
+      free(keys);
+   }
+
+   return 0;
+}
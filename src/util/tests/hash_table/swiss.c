@@ -0,0 +1,150 @@
+/*
+ * Copyright © 2019 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#undef NDEBUG
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "hash_table.h"
+
+#define NUM_KEYS 4096
+
+static uint32_t
+key_value(const void *key)
+{
+   return *(const uint32_t *) key;
+}
+
+static bool
+uint_key_equal(const void *a, const void *b)
+{
+   return key_value(a) == key_value(b);
+}
+
+static uint32_t
+uint_key_hash(const void *key)
+{
+   return _mesa_hash_data(key, sizeof(uint32_t));
+}
+
+/* A poor hash, so that most keys share groups and control byte tags. */
+static uint32_t
+bad_hash(const void *key)
+{
+   return key_value(key) & 0x3;
+}
+
+/* Checks that the tables hold exactly the same keys and data. */
+static void
+check_same(struct hash_table *ht, struct hash_table *ref)
+{
+   assert(ht->entries == ref->entries);
+
+   hash_table_foreach(ref, ref_entry) {
+      struct hash_entry *entry = _mesa_hash_table_search(ht, ref_entry->key);
+      assert(entry);
+      assert(entry->data == ref_entry->data);
+   }
+
+   unsigned count = 0;
+   hash_table_foreach(ht, entry) {
+      assert(_mesa_hash_table_search(ref, entry->key));
+      count++;
+   }
+   assert(count == ht->entries);
+}
+
+static void
+test_random_ops(uint32_t (*hash)(const void *key), unsigned num_ops)
+{
+   static uint32_t keys[NUM_KEYS];
+   struct hash_table *ht, *ref, *clone;
+
+   for (unsigned i = 0; i < NUM_KEYS; i++)
+      keys[i] = i;
+
+   ht = _mesa_hash_table_create_swiss(NULL, hash, uint_key_equal);
+   ref = _mesa_hash_table_create(NULL, hash, uint_key_equal);
+
+   srand(42);
+   for (unsigned i = 0; i < num_ops; i++) {
+      uint32_t *key = &keys[rand() % NUM_KEYS];
+      void *data = (void *)(uintptr_t)(i + 1);
+
+      /* Lean towards inserting so that the tables keep growing. */
+      if (rand() % 3) {
+         _mesa_hash_table_insert(ht, key, data);
+         _mesa_hash_table_insert(ref, key, data);
+      } else {
+         _mesa_hash_table_remove_key(ht, key);
+         _mesa_hash_table_remove_key(ref, key);
+      }
+
+      if (i % 1024 == 0)
+         check_same(ht, ref);
+   }
+   check_same(ht, ref);
+
+   clone = _mesa_hash_table_clone(ht, NULL);
+   check_same(clone, ref);
+
+   /* Removing everything while iterating must leave an empty table. */
+   hash_table_foreach(clone, entry)
+      _mesa_hash_table_remove(clone, entry);
+   assert(clone->entries == 0);
+   for (unsigned i = 0; i < NUM_KEYS; i++)
+      assert(!_mesa_hash_table_search(clone, &keys[i]));
+
+   /* The original must not have been affected. */
+   check_same(ht, ref);
+
+   _mesa_hash_table_clear(ht, NULL);
+   assert(ht->entries == 0);
+   for (unsigned i = 0; i < NUM_KEYS; i++)
+      assert(!_mesa_hash_table_search(ht, &keys[i]));
+
+   /* And the table is still usable after clearing. */
+   for (unsigned i = 0; i < NUM_KEYS; i++)
+      _mesa_hash_table_insert(ht, &keys[i], &keys[i]);
+   assert(ht->entries == NUM_KEYS);
+   for (unsigned i = 0; i < NUM_KEYS; i++)
+      assert(_mesa_hash_table_search(ht, &keys[i])->data == &keys[i]);
+
+   _mesa_hash_table_destroy(clone, NULL);
+   _mesa_hash_table_destroy(ht, NULL);
+   _mesa_hash_table_destroy(ref, NULL);
+}
+
+int
+main(int argc, char **argv)
+{
+   (void) argc;
+   (void) argv;
+
+   test_random_ops(uint_key_hash, 100000);
+   test_random_ops(bad_hash, 20000);
+
+   return 0;
+}
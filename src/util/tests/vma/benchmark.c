@@ -0,0 +1,102 @@
+/*
+ * Copyright © 2018 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Times util_vma_heap_alloc() and util_vma_heap_free() on a heap fragmented
+ * by a large working set of allocations.  Not run as a test, build it with
+ * "ninja src/util/tests/vma/vma_benchmark".
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "vma.h"
+#include "os_time.h"
+
+#define PAGE_SIZE 4096
+
+struct allocation {
+   uint64_t addr;
+   uint64_t size;
+};
+
+static uint32_t
+rand_next(uint32_t *state)
+{
+   /* xorshift32 */
+   *state ^= *state << 13;
+   *state ^= *state >> 17;
+   *state ^= *state << 5;
+   return *state;
+}
+
+static void
+allocate(struct util_vma_heap *heap, struct allocation *a, uint32_t *seed)
+{
+   uint32_t r = rand_next(seed);
+   uint64_t alignment = (r & 0x7) == 0 ? 64 * 1024 : PAGE_SIZE;
+
+   a->size = (1 + (r >> 8) % 64) * PAGE_SIZE;
+   a->addr = util_vma_heap_alloc(heap, a->size, alignment);
+   if (a->addr == 0) {
+      fprintf(stderr, "heap exhausted\n");
+      exit(1);
+   }
+}
+
+int
+main(int argc, char **argv)
+{
+   unsigned num_allocs = argc > 1 ? atoi(argv[1]) : 50000;
+   unsigned iterations = argc > 2 ? atoi(argv[2]) : 1000000;
+   struct allocation *allocs = calloc(num_allocs, sizeof(*allocs));
+   struct util_vma_heap heap;
+   uint32_t seed = 0x12345678;
+
+   util_vma_heap_init(&heap, PAGE_SIZE, 1ull << 40);
+
+   int64_t start = os_time_get_nano();
+   for (unsigned i = 0; i < num_allocs; i++)
+      allocate(&heap, &allocs[i], &seed);
+   int64_t fill_time = os_time_get_nano() - start;
+
+   /* Free and reallocate random allocations, which keeps the heap full of
+    * holes of all sizes.
+    */
+   start = os_time_get_nano();
+   for (unsigned i = 0; i < iterations; i++) {
+      struct allocation *a = &allocs[rand_next(&seed) % num_allocs];
+      util_vma_heap_free(&heap, a->addr, a->size);
+      allocate(&heap, a, &seed);
+   }
+   int64_t churn_time = os_time_get_nano() - start;
+
+   printf("%u allocations: %.1f ns per alloc, %.1f ns per free + alloc\n",
+          num_allocs, (double)fill_time / num_allocs,
+          (double)churn_time / iterations);
+
+   for (unsigned i = 0; i < num_allocs; i++)
+      util_vma_heap_free(&heap, allocs[i].addr, allocs[i].size);
+   util_vma_heap_finish(&heap);
+   free(allocs);
+
+   return 0;
+}
@@ -414,6 +414,37 @@ get_cpu_topology(void)
       if (cache_level == 3)
          util_cpu_caps.cores_per_L3 = cores_per_cache;
    }
+
+   if (has_cpuid()) {
+      uint32_t regs[4];
+
+      if (util_cpu_caps.has_intel) {
+         unsigned i;
+
+         /* Walk the deterministic cache parameters. */
+         cpuid(0x00000000, regs);
+         if (regs[0] >= 0x00000004) {
+            for (i = 0; i < 16; i++) {
+               cpuid_count(0x00000004, i, regs);
+               if ((regs[0] & 0x1f) == 0)
+                  break;
+               if (((regs[0] >> 5) & 0x7) == 3) {
+                  util_cpu_caps.L3_size = ((regs[1] >> 22) + 1) *
+                                          (((regs[1] >> 12) & 0x3ff) + 1) *
+                                          ((regs[1] & 0xfff) + 1) *
+                                          (regs[2] + 1);
+               }
+            }
+         }
+      } else {
+         cpuid(0x80000000, regs);
+         if (regs[0] >= 0x80000006) {
+            /* L3 size in 512KB units */
+            cpuid(0x80000006, regs);
+            util_cpu_caps.L3_size = (regs[3] >> 18) * 512 * 1024;
+         }
+      }
+   }
 #endif
 }
 
@@ -578,6 +609,7 @@ util_cpu_detect_once(void)
 
       debug_printf("util_cpu_caps.x86_cpu_type = %u\n", util_cpu_caps.x86_cpu_type);
       debug_printf("util_cpu_caps.cacheline = %u\n", util_cpu_caps.cacheline);
+      debug_printf("util_cpu_caps.L3_size = %u\n", util_cpu_caps.L3_size);
 
       debug_printf("util_cpu_caps.has_tsc = %u\n", util_cpu_caps.has_tsc);
       debug_printf("util_cpu_caps.has_mmx = %u\n", util_cpu_caps.has_mmx);
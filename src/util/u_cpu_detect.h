@@ -51,6 +51,7 @@ struct util_cpu_caps {
    int x86_cpu_type;
    unsigned cacheline;
    unsigned cores_per_L3;
+   unsigned L3_size;    /**< in bytes, 0 if unknown */
 
    unsigned has_intel:1;
    unsigned has_tsc:1;
@@ -26,9 +26,13 @@
 
 #include "u_queue.h"
 
+#include <inttypes.h>
+
 #include "c11/threads.h"
 
+#include "util/debug.h"
 #include "util/os_time.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_string.h"
 #include "util/u_thread.h"
 #include "u_process.h"
@@ -224,6 +228,270 @@ util_queue_fence_destroy(struct util_queue_fence *fence)
 }
 #endif
 
+/****************************************************************************
+ * Shared thread pool
+ *
+ * Queues created with UTIL_QUEUE_INIT_SHARED_POOL don't start threads of
+ * their own when MESA_THREAD_POOL is set.  Their jobs stay in the queue's
+ * ring buffer, and one set of worker threads for the whole process executes
+ * them, always taking the oldest job of the highest priority queue that can
+ * run one.  Queues of the same priority take turns.
+ *
+ * A queue never runs more than num_threads jobs at once, and each running
+ * job gets a thread_index below num_threads that no other running job of
+ * the queue has, so per-thread state indexed by thread_index still works.
+ */
+
+#define POOL_MAX_THREADS_PER_QUEUE 32
+
+static struct {
+   mtx_t init_lock; /* serializes starting and stopping the workers */
+   mtx_t lock;
+   cnd_t has_work_cond;
+   struct list_head queues; /* in scheduling order */
+   thrd_t *threads;
+   unsigned num_threads;
+   bool terminate;
+   bool pin_threads;
+   bool print_stats;
+} pool = {
+   .init_lock = _MTX_INITIALIZER_NP,
+   .lock = _MTX_INITIALIZER_NP,
+};
+
+static unsigned
+util_queue_priority(struct util_queue *queue)
+{
+   if (queue->flags & UTIL_QUEUE_INIT_HIGH_PRIORITY)
+      return 2;
+   if (queue->flags & UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY)
+      return 0;
+   return 1;
+}
+
+static mtx_t *
+util_queue_ring_lock(struct util_queue *queue)
+{
+   return queue->flags & UTIL_QUEUE_INIT_SHARED_POOL ? &pool.lock
+                                                      : &queue->lock;
+}
+
+/* Called with the pool lock held. */
+static struct util_queue *
+pool_pick_queue(void)
+{
+   struct util_queue *iter, *best = NULL;
+
+   LIST_FOR_EACH_ENTRY(iter, &pool.queues, pool_link) {
+      if (iter->num_queued == 0 || iter->num_running >= iter->num_threads)
+         continue;
+
+      if (!best || util_queue_priority(iter) > util_queue_priority(best))
+         best = iter;
+   }
+
+   /* Move it behind the queues of the same priority. */
+   if (best) {
+      LIST_DEL(&best->pool_link);
+      LIST_ADDTAIL(&best->pool_link, &pool.queues);
+   }
+
+   return best;
+}
+
+static int
+util_queue_pool_thread_func(void *input)
+{
+   unsigned worker_index = (uintptr_t)input;
+
+#ifdef HAVE_PTHREAD_SETAFFINITY
+   /* The workers serve every queue, so don't inherit the affinity of the
+    * thread that happened to start them.
+    */
+   cpu_set_t cpuset;
+   CPU_ZERO(&cpuset);
+   if (pool.pin_threads) {
+      CPU_SET(worker_index % util_cpu_caps.nr_cpus, &cpuset);
+   } else {
+      for (unsigned i = 0; i < CPU_SETSIZE; i++)
+         CPU_SET(i, &cpuset);
+   }
+   pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+#endif
+
+   char name[16];
+   snprintf(name, sizeof(name), "mesa:pool%u", worker_index);
+   u_thread_setname(name);
+
+   mtx_lock(&pool.lock);
+   while (1) {
+      struct util_queue *queue;
+
+      while (!pool.terminate && !(queue = pool_pick_queue()))
+         cnd_wait(&pool.has_work_cond, &pool.lock);
+
+      if (pool.terminate)
+         break;
+
+      struct util_queue_job job = queue->jobs[queue->read_idx];
+      memset(&queue->jobs[queue->read_idx], 0, sizeof(struct util_queue_job));
+      queue->read_idx = (queue->read_idx + 1) % queue->max_jobs;
+      queue->num_queued--;
+      cnd_signal(&queue->has_space_cond);
+
+      int thread_index = ffs(~queue->busy_thread_mask) - 1;
+      assert(thread_index < queue->num_threads);
+      queue->busy_thread_mask |= 1u << thread_index;
+      queue->num_running++;
+      mtx_unlock(&pool.lock);
+
+      int64_t start = 0;
+      if (job.job) {
+         start = os_time_get_nano();
+         job.execute(job.job, thread_index);
+         util_queue_fence_signal(job.fence);
+         if (job.cleanup)
+            job.cleanup(job.job, thread_index);
+      }
+
+      mtx_lock(&pool.lock);
+      if (job.job) {
+         int64_t wait_time = start - job.submit_time;
+
+         queue->stats.num_jobs++;
+         queue->stats.wait_time += wait_time;
+         queue->stats.max_wait_time = MAX2(queue->stats.max_wait_time,
+                                           wait_time);
+         queue->stats.run_time += os_time_get_nano() - start;
+      }
+
+      queue->busy_thread_mask &= ~(1u << thread_index);
+      if (--queue->num_running == 0)
+         cnd_broadcast(&queue->idle_cond);
+   }
+   mtx_unlock(&pool.lock);
+   return 0;
+}
+
+static bool
+util_queue_pool_add_queue(struct util_queue *queue)
+{
+   bool success = true;
+
+   mtx_lock(&pool.init_lock);
+   mtx_lock(&pool.lock);
+
+   if (!pool.threads) {
+      util_cpu_detect();
+
+      unsigned num_threads =
+         env_var_as_unsigned("MESA_THREAD_POOL_THREADS",
+                             util_cpu_caps.nr_cpus);
+
+      pool.pin_threads = env_var_as_boolean("MESA_THREAD_POOL_PIN", false);
+      pool.print_stats = env_var_as_boolean("MESA_THREAD_POOL_STATS", false);
+      pool.terminate = false;
+      LIST_INITHEAD(&pool.queues);
+      cnd_init(&pool.has_work_cond);
+
+      pool.threads = (thrd_t*) calloc(MAX2(num_threads, 1), sizeof(thrd_t));
+      pool.num_threads = 0;
+
+      for (unsigned i = 0; pool.threads && i < num_threads; i++) {
+         pool.threads[i] = u_thread_create(util_queue_pool_thread_func,
+                                           (void*)(uintptr_t)i);
+         if (!pool.threads[i])
+            break;
+         pool.num_threads++;
+      }
+
+      if (pool.num_threads == 0) {
+         free(pool.threads);
+         pool.threads = NULL;
+         cnd_destroy(&pool.has_work_cond);
+         success = false;
+      }
+   }
+
+   if (success)
+      LIST_ADDTAIL(&queue->pool_link, &pool.queues);
+
+   mtx_unlock(&pool.lock);
+   mtx_unlock(&pool.init_lock);
+   return success;
+}
+
+static void
+util_queue_pool_remove_queue(struct util_queue *queue)
+{
+   if (pool.print_stats) {
+      struct util_queue_stats *stats = &queue->stats;
+      unsigned num_jobs = MAX2(stats->num_jobs, 1);
+
+      fprintf(stderr, "%s: %"PRIu64" jobs, wait avg %.1f us max %.1f us, "
+              "run avg %.1f us\n", queue->name, stats->num_jobs,
+              stats->wait_time / 1000.0 / num_jobs,
+              stats->max_wait_time / 1000.0,
+              stats->run_time / 1000.0 / num_jobs);
+   }
+
+   mtx_lock(&pool.init_lock);
+   mtx_lock(&pool.lock);
+   LIST_DEL(&queue->pool_link);
+
+   /* Stop the workers with the last queue, so that they don't outlive the
+    * driver that started them.
+    */
+   if (!LIST_IS_EMPTY(&pool.queues)) {
+      mtx_unlock(&pool.lock);
+      mtx_unlock(&pool.init_lock);
+      return;
+   }
+
+   pool.terminate = true;
+   cnd_broadcast(&pool.has_work_cond);
+   mtx_unlock(&pool.lock);
+
+   for (unsigned i = 0; i < pool.num_threads; i++)
+      thrd_join(pool.threads[i], NULL);
+
+   free(pool.threads);
+   pool.threads = NULL;
+   pool.num_threads = 0;
+   cnd_destroy(&pool.has_work_cond);
+   mtx_unlock(&pool.init_lock);
+}
+
+/* Reduce the number of jobs the queue may run at the same time.  With 0,
+ * wait for the running jobs and signal the fences of the others.
+ */
+static void
+util_queue_pool_kill_threads(struct util_queue *queue,
+                             unsigned keep_num_threads)
+{
+   mtx_lock(&pool.lock);
+   queue->num_threads = keep_num_threads;
+
+   if (keep_num_threads == 0) {
+      while (queue->num_running)
+         cnd_wait(&queue->idle_cond, &pool.lock);
+
+      /* Count the jobs, read_idx == write_idx if the ring is full. */
+      for (unsigned n = 0; n < queue->num_queued; n++) {
+         unsigned i = (queue->read_idx + n) % queue->max_jobs;
+
+         if (queue->jobs[i].job) {
+            util_queue_fence_signal(queue->jobs[i].fence);
+            queue->jobs[i].job = NULL;
+         }
+      }
+      queue->read_idx = queue->write_idx;
+      queue->num_queued = 0;
+      cnd_broadcast(&queue->idle_cond);
+   }
+   mtx_unlock(&pool.lock);
+}
+
 /****************************************************************************
  * util_queue implementation
  */
@@ -286,18 +554,32 @@ util_queue_thread_func(void *input)
       mtx_unlock(&queue->lock);
 
       if (job.job) {
+         int64_t start = os_time_get_nano();
+
          job.execute(job.job, thread_index);
          util_queue_fence_signal(job.fence);
          if (job.cleanup)
             job.cleanup(job.job, thread_index);
+
+         int64_t wait_time = start - job.submit_time;
+
+         mtx_lock(&queue->lock);
+         queue->stats.num_jobs++;
+         queue->stats.wait_time += wait_time;
+         queue->stats.max_wait_time = MAX2(queue->stats.max_wait_time,
+                                           wait_time);
+         queue->stats.run_time += os_time_get_nano() - start;
+         mtx_unlock(&queue->lock);
       }
    }
 
    /* signal remaining jobs if all threads are being terminated */
    mtx_lock(&queue->lock);
    if (queue->num_threads == 0) {
-      for (unsigned i = queue->read_idx; i != queue->write_idx;
-           i = (i + 1) % queue->max_jobs) {
+      /* Count the jobs, read_idx == write_idx if the ring is full. */
+      for (unsigned n = 0; n < queue->num_queued; n++) {
+         unsigned i = (queue->read_idx + n) % queue->max_jobs;
+
          if (queue->jobs[i].job) {
             util_queue_fence_signal(queue->jobs[i].fence);
             queue->jobs[i].job = NULL;
@@ -361,6 +643,15 @@ util_queue_adjust_num_threads(struct util_queue *queue, unsigned num_threads)
       return;
    }
 
+   if (queue->flags & UTIL_QUEUE_INIT_SHARED_POOL) {
+      mtx_lock(&pool.lock);
+      queue->num_threads = num_threads;
+      cnd_broadcast(&pool.has_work_cond);
+      mtx_unlock(&pool.lock);
+      mtx_unlock(&queue->finish_lock);
+      return;
+   }
+
    /* Create threads.
     *
     * We need to update num_threads first, because threads terminate
@@ -411,6 +702,13 @@ util_queue_init(struct util_queue *queue,
       snprintf(queue->name, sizeof(queue->name), "%s", name);
    }
 
+   if ((flags & UTIL_QUEUE_INIT_SHARED_POOL) &&
+       env_var_as_boolean("MESA_THREAD_POOL", false)) {
+      num_threads = MIN2(num_threads, POOL_MAX_THREADS_PER_QUEUE);
+   } else {
+      flags &= ~UTIL_QUEUE_INIT_SHARED_POOL;
+   }
+
    queue->flags = flags;
    queue->max_threads = num_threads;
    queue->num_threads = num_threads;
@@ -428,6 +726,18 @@ util_queue_init(struct util_queue *queue,
    cnd_init(&queue->has_queued_cond);
    cnd_init(&queue->has_space_cond);
 
+   if (flags & UTIL_QUEUE_INIT_SHARED_POOL) {
+      cnd_init(&queue->idle_cond);
+      if (util_queue_pool_add_queue(queue)) {
+         add_to_atexit_list(queue);
+         return true;
+      }
+
+      /* Fall back to threads of our own. */
+      cnd_destroy(&queue->idle_cond);
+      queue->flags &= ~UTIL_QUEUE_INIT_SHARED_POOL;
+   }
+
    queue->threads = (thrd_t*) calloc(num_threads, sizeof(thrd_t));
    if (!queue->threads)
       goto fail;
@@ -478,6 +788,13 @@ util_queue_kill_threads(struct util_queue *queue, unsigned keep_num_threads,
       return;
    }
 
+   if (queue->flags & UTIL_QUEUE_INIT_SHARED_POOL) {
+      util_queue_pool_kill_threads(queue, keep_num_threads);
+      if (!finish_locked)
+         mtx_unlock(&queue->finish_lock);
+      return;
+   }
+
    mtx_lock(&queue->lock);
    unsigned old_num_threads = queue->num_threads;
    /* Setting num_threads is what causes the threads to terminate.
@@ -500,6 +817,11 @@ util_queue_destroy(struct util_queue *queue)
    util_queue_kill_threads(queue, 0, false);
    remove_from_atexit_list(queue);
 
+   if (queue->flags & UTIL_QUEUE_INIT_SHARED_POOL) {
+      util_queue_pool_remove_queue(queue);
+      cnd_destroy(&queue->idle_cond);
+   }
+
    cnd_destroy(&queue->has_space_cond);
    cnd_destroy(&queue->has_queued_cond);
    mtx_destroy(&queue->finish_lock);
@@ -516,10 +838,11 @@ util_queue_add_job(struct util_queue *queue,
                    util_queue_execute_func cleanup)
 {
    struct util_queue_job *ptr;
+   mtx_t *lock = util_queue_ring_lock(queue);
 
-   mtx_lock(&queue->lock);
+   mtx_lock(lock);
    if (queue->num_threads == 0) {
-      mtx_unlock(&queue->lock);
+      mtx_unlock(lock);
       /* well no good option here, but any leaks will be
        * short-lived as things are shutting down..
        */
@@ -560,7 +883,7 @@ util_queue_add_job(struct util_queue *queue,
       } else {
          /* Wait until there is a free slot. */
          while (queue->num_queued == queue->max_jobs)
-            cnd_wait(&queue->has_space_cond, &queue->lock);
+            cnd_wait(&queue->has_space_cond, lock);
       }
    }
 
@@ -570,11 +893,16 @@ util_queue_add_job(struct util_queue *queue,
    ptr->fence = fence;
    ptr->execute = execute;
    ptr->cleanup = cleanup;
+   ptr->submit_time = os_time_get_nano();
    queue->write_idx = (queue->write_idx + 1) % queue->max_jobs;
 
    queue->num_queued++;
-   cnd_signal(&queue->has_queued_cond);
-   mtx_unlock(&queue->lock);
+   if (queue->flags & UTIL_QUEUE_INIT_SHARED_POOL) {
+      cnd_signal(&pool.has_work_cond);
+   } else {
+      cnd_signal(&queue->has_queued_cond);
+   }
+   mtx_unlock(lock);
 }
 
 /**
@@ -595,7 +923,8 @@ util_queue_drop_job(struct util_queue *queue, struct util_queue_fence *fence)
    if (util_queue_fence_is_signalled(fence))
       return;
 
-   mtx_lock(&queue->lock);
+   mtx_t *lock = util_queue_ring_lock(queue);
+   mtx_lock(lock);
    for (unsigned i = queue->read_idx; i != queue->write_idx;
         i = (i + 1) % queue->max_jobs) {
       if (queue->jobs[i].fence == fence) {
@@ -608,7 +937,7 @@ util_queue_drop_job(struct util_queue *queue, struct util_queue_fence *fence)
          break;
       }
    }
-   mtx_unlock(&queue->lock);
+   mtx_unlock(lock);
 
    if (removed)
       util_queue_fence_signal(fence);
@@ -632,6 +961,19 @@ util_queue_finish(struct util_queue *queue)
    util_barrier barrier;
    struct util_queue_fence *fences;
 
+   /* The barrier below would need num_threads free workers.  Just wait until
+    * the queue is idle instead.
+    */
+   if (queue->flags & UTIL_QUEUE_INIT_SHARED_POOL) {
+      mtx_lock(&queue->finish_lock);
+      mtx_lock(&pool.lock);
+      while (queue->num_queued || queue->num_running)
+         cnd_wait(&queue->idle_cond, &pool.lock);
+      mtx_unlock(&pool.lock);
+      mtx_unlock(&queue->finish_lock);
+      return;
+   }
+
    /* If 2 threads were adding jobs for 2 different barries at the same time,
     * a deadlock would happen, because 1 barrier requires that all threads
     * wait for it exclusively.
@@ -660,8 +1002,20 @@ int64_t
 util_queue_get_thread_time_nano(struct util_queue *queue, unsigned thread_index)
 {
    /* Allow some flexibility by not raising an error. */
-   if (thread_index >= queue->num_threads)
+   if (thread_index >= queue->num_threads ||
+       (queue->flags & UTIL_QUEUE_INIT_SHARED_POOL))
       return 0;
 
    return u_thread_get_time_nano(queue->threads[thread_index]);
 }
+
+void
+util_queue_get_stats(struct util_queue *queue, struct util_queue_stats *stats)
+{
+   mtx_t *lock = util_queue_ring_lock(queue);
+
+   mtx_lock(lock);
+   *stats = queue->stats;
+   stats->num_queued = queue->num_queued;
+   mtx_unlock(lock);
+}
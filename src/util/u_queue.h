@@ -49,6 +49,15 @@ extern "C" {
 #define UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY      (1 << 0)
 #define UTIL_QUEUE_INIT_RESIZE_IF_FULL            (1 << 1)
 #define UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY  (1 << 2)
+/* Run the jobs on the process-wide thread pool if MESA_THREAD_POOL is set,
+ * instead of starting threads for this queue.  Only for queues whose users
+ * don't access the queue's threads directly.
+ */
+#define UTIL_QUEUE_INIT_SHARED_POOL               (1 << 3)
+/* Jobs from this queue are latency critical and on the shared pool they
+ * are executed before jobs from other queues.
+ */
+#define UTIL_QUEUE_INIT_HIGH_PRIORITY             (1 << 4)
 
 #if defined(__GNUC__) && defined(HAVE_LINUX_FUTEX_H)
 #define UTIL_QUEUE_FENCE_FUTEX
@@ -196,6 +205,16 @@ struct util_queue_job {
    struct util_queue_fence *fence;
    util_queue_execute_func execute;
    util_queue_execute_func cleanup;
+   int64_t submit_time; /* for stats */
+};
+
+/* Statistics of a queue, times are in nanoseconds. */
+struct util_queue_stats {
+   uint64_t num_jobs;
+   int64_t wait_time;     /* between util_queue_add_job and execution */
+   int64_t max_wait_time;
+   int64_t run_time;
+   unsigned num_queued;   /* jobs waiting when the stats were read */
 };
 
 /* Put this into your context. */
@@ -213,9 +232,18 @@ struct util_queue {
    int max_jobs;
    int write_idx, read_idx; /* ring buffer pointers */
    struct util_queue_job *jobs;
+   struct util_queue_stats stats; /* protected by the ring buffer lock */
 
    /* for cleanup at exit(), protected by exit_mutex */
    struct list_head head;
+
+   /* for queues on the shared pool, protected by the pool lock, which also
+    * protects the ring buffer instead of "lock"
+    */
+   struct list_head pool_link;
+   cnd_t idle_cond;
+   unsigned num_running;
+   uint32_t busy_thread_mask; /* thread indices used by running jobs */
 };
 
 bool util_queue_init(struct util_queue *queue,
@@ -243,14 +271,18 @@ void util_queue_finish(struct util_queue *queue);
 void
 util_queue_adjust_num_threads(struct util_queue *queue, unsigned num_threads);
 
+/* Always 0 for queues on the shared pool, which don't own their threads. */
 int64_t util_queue_get_thread_time_nano(struct util_queue *queue,
                                         unsigned thread_index);
 
+void util_queue_get_stats(struct util_queue *queue,
+                          struct util_queue_stats *stats);
+
 /* util_queue needs to be cleared to zeroes for this to work */
 static inline bool
 util_queue_is_initialized(struct util_queue *queue)
 {
-   return queue->threads != NULL;
+   return queue->jobs != NULL;
 }
 
 /* Convenient structure for monitoring the queue externally and passing
@@ -265,6 +297,7 @@ struct util_queue_monitoring
    unsigned num_offloaded_items;
    unsigned num_direct_items;
    unsigned num_syncs;
+   unsigned num_sync_calls;
 };
 
 #ifdef __cplusplus
@@ -26,23 +26,99 @@
 #include "util/u_math.h"
 #include "util/vma.h"
 
+/* Holes are kept in two trees: heap->holes ordered by address, which is used
+ * to find the neighbours of a freed range, and heap->holes_by_size ordered by
+ * size, which is used to find the smallest hole an allocation fits in.  Among
+ * holes of the same size, the highest one sorts first so that, like the list
+ * this replaced, we tend to allocate from the top of the heap.
+ */
 struct util_vma_hole {
-   struct list_head link;
+   struct rb_node addr_node;
+   struct rb_node size_node;
    uint64_t offset;
    uint64_t size;
 };
 
+#define util_vma_hole_from_addr_node(_node) \
+   rb_node_data(struct util_vma_hole, _node, addr_node)
+
+#define util_vma_hole_from_size_node(_node) \
+   rb_node_data(struct util_vma_hole, _node, size_node)
+
 #define util_vma_foreach_hole(_hole, _heap) \
-   list_for_each_entry(struct util_vma_hole, _hole, &(_heap)->holes, link)
+   rb_tree_foreach_rev(struct util_vma_hole, _hole, &(_heap)->holes, addr_node)
 
 #define util_vma_foreach_hole_safe(_hole, _heap) \
-   list_for_each_entry_safe(struct util_vma_hole, _hole, &(_heap)->holes, link)
+   rb_tree_foreach_rev_safe(struct util_vma_hole, _hole, &(_heap)->holes, \
+                            addr_node)
+
+static int
+util_vma_hole_addr_cmp(const struct rb_node *a, const struct rb_node *b)
+{
+   const struct util_vma_hole *ha = util_vma_hole_from_addr_node(a);
+   const struct util_vma_hole *hb = util_vma_hole_from_addr_node(b);
+
+   if (ha->offset != hb->offset)
+      return ha->offset < hb->offset ? -1 : 1;
+   return 0;
+}
+
+static int
+util_vma_hole_size_cmp(const struct rb_node *a, const struct rb_node *b)
+{
+   const struct util_vma_hole *ha = util_vma_hole_from_size_node(a);
+   const struct util_vma_hole *hb = util_vma_hole_from_size_node(b);
+
+   if (ha->size != hb->size)
+      return ha->size < hb->size ? -1 : 1;
+   if (ha->offset != hb->offset)
+      return ha->offset > hb->offset ? -1 : 1;
+   return 0;
+}
+
+static struct util_vma_hole *
+util_vma_hole_create(struct util_vma_heap *heap,
+                     uint64_t offset, uint64_t size)
+{
+   struct util_vma_hole *hole = calloc(1, sizeof(*hole));
+
+   hole->offset = offset;
+   hole->size = size;
+   rb_tree_insert(&heap->holes, &hole->addr_node, util_vma_hole_addr_cmp);
+   rb_tree_insert(&heap->holes_by_size, &hole->size_node,
+                  util_vma_hole_size_cmp);
+
+   return hole;
+}
+
+static void
+util_vma_hole_destroy(struct util_vma_heap *heap, struct util_vma_hole *hole)
+{
+   rb_tree_remove(&heap->holes, &hole->addr_node);
+   rb_tree_remove(&heap->holes_by_size, &hole->size_node);
+   free(hole);
+}
+
+/* Changing the bounds of a hole never changes its position relative to the
+ * other holes by address, since holes don't overlap, but it does by size.
+ */
+static void
+util_vma_hole_set(struct util_vma_heap *heap, struct util_vma_hole *hole,
+                  uint64_t offset, uint64_t size)
+{
+   rb_tree_remove(&heap->holes_by_size, &hole->size_node);
+   hole->offset = offset;
+   hole->size = size;
+   rb_tree_insert(&heap->holes_by_size, &hole->size_node,
+                  util_vma_hole_size_cmp);
+}
 
 void
 util_vma_heap_init(struct util_vma_heap *heap,
                    uint64_t start, uint64_t size)
 {
-   list_inithead(&heap->holes);
+   rb_tree_init(&heap->holes);
+   rb_tree_init(&heap->holes_by_size);
    util_vma_heap_free(heap, start, size);
 }
 
@@ -58,16 +134,18 @@ static void
 util_vma_heap_validate(struct util_vma_heap *heap)
 {
    uint64_t prev_offset = 0;
+   struct util_vma_hole *top = NULL;
    util_vma_foreach_hole(hole, heap) {
       assert(hole->offset > 0);
       assert(hole->size > 0);
 
-      if (&hole->link == heap->holes.next) {
+      if (top == NULL) {
          /* This must be the top-most hole.  Assert that, if it overflows, it
           * overflows to 0, i.e. 2^64.
           */
          assert(hole->size + hole->offset == 0 ||
                 hole->size + hole->offset > hole->offset);
+         top = hole;
       } else {
          /* This is not the top-most hole so it must not overflow and, in
           * fact, must be strictly lower than the top-most hole.  If
@@ -94,9 +172,21 @@ util_vma_heap_alloc(struct util_vma_heap *heap,
 
    util_vma_heap_validate(heap);
 
-   util_vma_foreach_hole_safe(hole, heap) {
-      if (size > hole->size)
-         continue;
+   /* Find the smallest hole that is large enough. */
+   struct rb_node *node = NULL;
+   for (struct rb_node *n = heap->holes_by_size.root; n != NULL;) {
+      if (util_vma_hole_from_size_node(n)->size >= size) {
+         node = n;
+         n = n->left;
+      } else {
+         n = n->right;
+      }
+   }
+
+   /* Alignment may rule it out, in which case we move on to larger ones. */
+   for (; node != NULL; node = rb_node_next(node)) {
+      struct util_vma_hole *hole = util_vma_hole_from_size_node(node);
+      assert(size <= hole->size);
 
       /* Compute the offset as the highest address where a chunk of the given
        * size can be without going over the top of the hole.
@@ -116,8 +206,7 @@ util_vma_heap_alloc(struct util_vma_heap *heap,
 
       if (offset == hole->offset && size == hole->size) {
          /* Just get rid of the hole. */
-         list_del(&hole->link);
-         free(hole);
+         util_vma_hole_destroy(heap, hole);
          util_vma_heap_validate(heap);
          return offset;
       }
@@ -126,35 +215,24 @@ util_vma_heap_alloc(struct util_vma_heap *heap,
       uint64_t waste = (hole->size - size) - (offset - hole->offset);
       if (waste == 0) {
          /* We allocated at the top.  Shrink the hole down. */
-         hole->size -= size;
+         util_vma_hole_set(heap, hole, hole->offset, hole->size - size);
          util_vma_heap_validate(heap);
          return offset;
       }
 
       if (offset == hole->offset) {
          /* We allocated at the bottom. Shrink the hole up. */
-         hole->offset += size;
-         hole->size -= size;
+         util_vma_hole_set(heap, hole, hole->offset + size, hole->size - size);
          util_vma_heap_validate(heap);
          return offset;
       }
 
       /* We allocated in the middle.  We need to split the old hole into two
-       * holes, one high and one low.
-       */
-      struct util_vma_hole *high_hole = calloc(1, sizeof(*hole));
-      high_hole->offset = offset + size;
-      high_hole->size = waste;
-
-      /* Adjust the hole to be the amount of space left at he bottom of the
-       * original hole.
-       */
-      hole->size = offset - hole->offset;
-
-      /* Place the new hole before the old hole so that the list is in order
-       * from high to low.
+       * holes, one high and one low.  The old hole keeps the amount of space
+       * left at the bottom.
        */
-      list_addtail(&high_hole->link, &hole->link);
+      util_vma_hole_set(heap, hole, hole->offset, offset - hole->offset);
+      util_vma_hole_create(heap, offset + size, waste);
 
       util_vma_heap_validate(heap);
 
@@ -186,12 +264,15 @@ util_vma_heap_free(struct util_vma_heap *heap,
 
    /* Find immediately higher and lower holes if they exist. */
    struct util_vma_hole *high_hole = NULL, *low_hole = NULL;
-   util_vma_foreach_hole(hole, heap) {
+   for (struct rb_node *n = heap->holes.root; n != NULL;) {
+      struct util_vma_hole *hole = util_vma_hole_from_addr_node(n);
       if (hole->offset <= offset) {
          low_hole = hole;
-         break;
+         n = n->right;
+      } else {
+         high_hole = hole;
+         n = n->left;
       }
-      high_hole = hole;
    }
 
    if (high_hole)
@@ -206,28 +287,20 @@ util_vma_heap_free(struct util_vma_heap *heap,
 
    if (low_adjacent && high_adjacent) {
       /* Merge the two holes */
-      low_hole->size += size + high_hole->size;
-      list_del(&high_hole->link);
-      free(high_hole);
+      uint64_t high_size = high_hole->size;
+      util_vma_hole_destroy(heap, high_hole);
+      util_vma_hole_set(heap, low_hole, low_hole->offset,
+                        low_hole->size + size + high_size);
    } else if (low_adjacent) {
       /* Merge into the low hole */
-      low_hole->size += size;
+      util_vma_hole_set(heap, low_hole, low_hole->offset,
+                        low_hole->size + size);
    } else if (high_adjacent) {
       /* Merge into the high hole */
-      high_hole->offset = offset;
-      high_hole->size += size;
+      util_vma_hole_set(heap, high_hole, offset, high_hole->size + size);
    } else {
       /* Neither hole is adjacent; make a new one */
-      struct util_vma_hole *hole = calloc(1, sizeof(*hole));
-
-      hole->offset = offset;
-      hole->size = size;
-
-      /* Add it after the high hole so we maintain high-to-low ordering */
-      if (high_hole)
-         list_add(&hole->link, &high_hole->link);
-      else
-         list_add(&hole->link, &heap->holes);
+      util_vma_hole_create(heap, offset, size);
    }
 
    util_vma_heap_validate(heap);
@@ -42,7 +42,10 @@
 #include <errno.h>
 #include <dirent.h>
 #include <fnmatch.h>
+#include <sys/stat.h>
 #include "xmlconfig.h"
+#include "disk_cache.h"
+#include "u_dynarray.h"
 #include "u_process.h"
 
 /* For systems like Hurd */
@@ -705,6 +708,8 @@ struct OptConfData {
     uint32_t inDevice;
     uint32_t inApp;
     uint32_t inOption;
+    /** name\0value\0 of each option applied, for the config cache */
+    struct util_dynarray *applied;
 };
 
 /** \brief Elements in configuration files. */
@@ -758,6 +763,20 @@ parseAppAttr(struct OptConfData *data, const XML_Char **attr)
         data->ignoringApp = data->inApp;
 }
 
+/** \brief Set an option from a configuration file, unless the environment
+ * overrides it.  Returns false if the value is invalid. */
+static bool
+applyOptConf(driOptionCache *cache, uint32_t opt, const char *value)
+{
+    if (getenv (cache->info[opt].name)) {
+        /* don't use XML_WARNING, we want the user to see this! */
+        fprintf (stderr, "ATTENTION: option value of option %s ignored.\n",
+                 cache->info[opt].name);
+        return true;
+    }
+    return parseValue (&cache->values[opt], cache->info[opt].type, value);
+}
+
 /** \brief Parse attributes of an option element. */
 static void
 parseOptConfAttr(struct OptConfData *data, const XML_Char **attr)
@@ -778,11 +797,16 @@ parseOptConfAttr(struct OptConfData *data, const XML_Char **attr)
             /* don't use XML_WARNING, drirc defines options for all drivers,
              * but not all drivers support them */
             return;
-        else if (getenv (cache->info[opt].name))
-          /* don't use XML_WARNING, we want the user to see this! */
-            fprintf (stderr, "ATTENTION: option value of option %s ignored.\n",
-                     cache->info[opt].name);
-        else if (!parseValue (&cache->values[opt], cache->info[opt].type, value))
+        if (data->applied) {
+            size_t name_len = strlen (name) + 1, value_len = strlen (value) + 1;
+            char *dst = util_dynarray_grow_bytes (data->applied, 1,
+                                                  name_len + value_len);
+            if (dst) {
+                memcpy (dst, name, name_len);
+                memcpy (dst + name_len, value, value_len);
+            }
+        }
+        if (!applyOptConf (cache, opt, value))
             XML_WARNING ("illegal option value: %s.", value);
     }
 }
@@ -962,9 +986,18 @@ scandir_filter(const struct dirent *ent)
     return 1;
 }
 
-/** \brief Parse configuration files in a directory */
+/** \brief Add a configuration file to the list of files to parse */
+static void
+addConfigFile(struct util_dynarray *files, const char *filename)
+{
+    char *name = strdup(filename);
+    if (name)
+        util_dynarray_append(files, char *, name);
+}
+
+/** \brief Add the configuration files in a directory, in parsing order */
 static void
-parseConfigDir(struct OptConfData *data, const char *dirname)
+addConfigDir(struct util_dynarray *files, const char *dirname)
 {
     int i, count;
     struct dirent **entries = NULL;
@@ -979,12 +1012,132 @@ parseConfigDir(struct OptConfData *data, const char *dirname)
         snprintf(filename, PATH_MAX, "%s/%s", dirname, entries[i]->d_name);
         free(entries[i]);
 
-        parseOneConfigFile(data, filename);
+        addConfigFile(files, filename);
     }
 
     free(entries);
 }
 
+/**
+ * \brief Cache of the options the configuration files set for a device and
+ * application
+ *
+ * Parsing all of drirc.d is a large part of the screen creation time of
+ * short-lived processes.  The options which applied are stored in the
+ * shader disk cache, keyed by everything which selects them and by the
+ * modification time and size of every configuration file, so that
+ * editing, adding or removing a file misses the cache.
+ */
+/* Header of the cache entries, which also keeps them from being empty. */
+#define CONFIG_CACHE_VERSION 1
+
+static struct disk_cache *
+createConfigCache(void)
+{
+#if defined(ENABLE_SHADER_CACHE) && defined(HAVE_DLFCN_H)
+    uint32_t mesa_timestamp;
+    char timestamp[9];
+
+    if (!disk_cache_get_function_timestamp(driParseConfigFiles,
+                                           &mesa_timestamp))
+        return NULL;
+
+    snprintf(timestamp, sizeof(timestamp), "%08x", mesa_timestamp);
+    return disk_cache_create("driconf", timestamp, 0);
+#else
+    return NULL;
+#endif
+}
+
+static void
+appendConfigKeyString(struct util_dynarray *key, const char *str)
+{
+    size_t len = str ? strlen(str) + 1 : 1;
+    char *dst = util_dynarray_grow_bytes(key, 1, len);
+    if (dst)
+        memcpy(dst, str ? str : "", len);
+}
+
+static void
+computeConfigCacheKey(struct disk_cache *disk_cache,
+                      const struct OptConfData *data,
+                      const struct util_dynarray *files, cache_key key)
+{
+    const driOptionCache *cache = data->cache;
+    struct util_dynarray blob;
+    unsigned i;
+
+    util_dynarray_init(&blob, NULL);
+
+    appendConfigKeyString(&blob, data->driverName);
+    appendConfigKeyString(&blob, data->kernelDriverName);
+    appendConfigKeyString(&blob, data->execName);
+    util_dynarray_append(&blob, int, data->screenNum);
+
+    /* Which options exist decides which ones get applied. */
+    for (i = 0; i < 1u << cache->tableSize; i++) {
+        if (!cache->info[i].name)
+            continue;
+        appendConfigKeyString(&blob, cache->info[i].name);
+        util_dynarray_append(&blob, driOptionType, cache->info[i].type);
+    }
+
+    util_dynarray_foreach(files, char *, filename) {
+        struct stat st;
+        int64_t file_info[3] = { -1, -1, -1 };
+
+        if (stat(*filename, &st) == 0) {
+            file_info[0] = st.st_mtime;
+            file_info[1] = st.st_size;
+            file_info[2] = st.st_ino;
+        }
+        appendConfigKeyString(&blob, *filename);
+        void *dst = util_dynarray_grow_bytes(&blob, 1, sizeof(file_info));
+        if (dst)
+            memcpy(dst, file_info, sizeof(file_info));
+    }
+
+    disk_cache_compute_key(disk_cache, blob.data, blob.size, key);
+    util_dynarray_fini(&blob);
+}
+
+/** \brief Apply the options recorded by parseOptConfAttr
+ *
+ * Returns false, before applying anything, for entries of another version. */
+static bool
+applyCachedOptConf(driOptionCache *cache, const char *applied, size_t size)
+{
+    const char *end = applied + size;
+
+    uint32_t version;
+
+    if (size < sizeof(version))
+        return false;
+    memcpy(&version, applied, sizeof(version));
+    if (version != CONFIG_CACHE_VERSION)
+        return false;
+    applied += sizeof(version);
+
+    while (applied < end) {
+        const char *name = applied;
+        const char *value = memchr(name, 0, end - name);
+        if (!value)
+            break;
+        value++;
+        const char *next = memchr(value, 0, end - value);
+        if (!next)
+            break;
+
+        uint32_t opt = findOption(cache, name);
+        if (cache->info[opt].name)
+            applyOptConf(cache, opt, value);
+
+        applied = next + 1;
+    }
+
+    return true;
+}
+
 #ifndef SYSCONFDIR
 #define SYSCONFDIR "/etc"
 #endif
@@ -1000,6 +1153,9 @@ driParseConfigFiles(driOptionCache *cache, const driOptionCache *info,
 {
     char *home;
     struct OptConfData userData;
+    struct util_dynarray files, applied;
+    struct disk_cache *disk_cache;
+    cache_key key;
 
     initOptionCache (cache, info);
 
@@ -1008,16 +1164,54 @@ driParseConfigFiles(driOptionCache *cache, const driOptionCache *info,
     userData.driverName = driverName;
     userData.kernelDriverName = kernelDriverName;
     userData.execName = util_get_process_name();
+    userData.applied = NULL;
 
-    parseConfigDir(&userData, DATADIR "/drirc.d");
-    parseOneConfigFile(&userData, SYSCONFDIR "/drirc");
+    util_dynarray_init(&files, NULL);
+    addConfigDir(&files, DATADIR "/drirc.d");
+    addConfigFile(&files, SYSCONFDIR "/drirc");
 
     if ((home = getenv ("HOME"))) {
         char filename[PATH_MAX];
 
         snprintf(filename, PATH_MAX, "%s/.drirc", home);
-        parseOneConfigFile(&userData, filename);
+        addConfigFile(&files, filename);
+    }
+
+    disk_cache = createConfigCache();
+    if (disk_cache) {
+        size_t size;
+        void *cached;
+
+        computeConfigCacheKey(disk_cache, &userData, &files, key);
+        cached = disk_cache_get(disk_cache, key, &size);
+        if (cached) {
+            bool hit = applyCachedOptConf(cache, cached, size);
+            free(cached);
+            if (hit) {
+                disk_cache_destroy(disk_cache);
+                goto done;
+            }
+        }
+
+        util_dynarray_init(&applied, NULL);
+        util_dynarray_append(&applied, uint32_t, CONFIG_CACHE_VERSION);
+        userData.applied = &applied;
     }
+
+    util_dynarray_foreach(&files, char *, filename)
+        parseOneConfigFile(&userData, *filename);
+
+    if (disk_cache) {
+        disk_cache_put(disk_cache, key, applied.data, applied.size, NULL);
+        disk_cache_wait_for_idle(disk_cache);
+        util_dynarray_fini(&applied);
+        disk_cache_destroy(disk_cache);
+    }
+
+done:
+    util_dynarray_foreach(&files, char *, filename)
+        free(*filename);
+    util_dynarray_fini(&files);
 }
 
 void
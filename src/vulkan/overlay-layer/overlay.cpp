@@ -38,6 +38,7 @@
 #include "util/ralloc.h"
 #include "util/os_time.h"
 #include "util/simple_mtx.h"
+#include "util/u_queue.h"
 
 #include "vk_enum_to_str.h"
 #include "vk_util.h"
@@ -51,6 +52,16 @@ struct instance_data {
    bool pipeline_statistics_enabled;
 
    bool first_line_printed;
+
+   /* Writes the output_file lines, so that presents don't wait on I/O. */
+   struct util_queue output_queue;
+   bool output_queue_ready;
+};
+
+struct output_line {
+   struct util_queue_fence fence;
+   FILE *file;
+   char *text;
 };
 
 struct frame_stat {
@@ -104,8 +115,6 @@ struct queue_data {
    uint32_t family_index;
    uint64_t timestamp_mask;
 
-   VkFence queries_fence;
-
    struct list_head running_command_buffer;
 };
 
@@ -318,6 +327,10 @@ static struct instance_data *new_instance_data(VkInstance instance)
 
 static void destroy_instance_data(struct instance_data *data)
 {
+   if (data->output_queue_ready) {
+      util_queue_finish(&data->output_queue);
+      util_queue_destroy(&data->output_queue);
+   }
    if (data->params.output_file)
       fclose(data->params.output_file);
    unmap_object(HKEY(data->instance));
@@ -371,15 +384,6 @@ static struct queue_data *new_queue_data(VkQueue queue,
    LIST_INITHEAD(&data->running_command_buffer);
    map_object(HKEY(data->queue), data);
 
-   /* Fence synchronizing access to queries on that queue. */
-   VkFenceCreateInfo fence_info = {};
-   fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-   fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-   VK_CHECK(device_data->vtable.CreateFence(device_data->device,
-                                            &fence_info,
-                                            NULL,
-                                            &data->queries_fence));
-
    if (data->flags & VK_QUEUE_GRAPHICS_BIT)
       device_data->graphic_queue = data;
 
@@ -388,8 +392,6 @@ static struct queue_data *new_queue_data(VkQueue queue,
 
 static void destroy_queue(struct queue_data *data)
 {
-   struct device_data *device_data = data->device;
-   device_data->vtable.DestroyFence(device_data->device, data->queries_fence, NULL);
    unmap_object(HKEY(data->queue));
    ralloc_free(data);
 }
@@ -550,6 +552,41 @@ static const char *param_unit(enum overlay_param_enabled param)
    }
 }
 
+static void write_output_line(void *job, int thread_index)
+{
+   struct output_line *line = (struct output_line *)job;
+
+   fputs(line->text, line->file);
+   fflush(line->file);
+}
+
+static void free_output_line(void *job, int thread_index)
+{
+   struct output_line *line = (struct output_line *)job;
+
+   util_queue_fence_destroy(&line->fence);
+   ralloc_free(line);
+}
+
+/* Hand a line to the output thread, or write it right away if we couldn't
+ * start one.
+ */
+static void queue_output_line(struct instance_data *instance_data,
+                              struct output_line *line)
+{
+   line->file = instance_data->params.output_file;
+   util_queue_fence_init(&line->fence);
+
+   if (!instance_data->output_queue_ready) {
+      write_output_line(line, 0);
+      free_output_line(line, 0);
+      return;
+   }
+
+   util_queue_add_job(&instance_data->output_queue, line, &line->fence,
+                      write_output_line, free_output_line);
+}
+
 static void snapshot_swapchain_frame(struct swapchain_data *data)
 {
    struct device_data *device_data = data->device;
@@ -573,6 +610,9 @@ static void snapshot_swapchain_frame(struct swapchain_data *data)
       if (elapsed >= instance_data->params.fps_sampling_period) {
          data->fps = 1000000.0f * data->n_frames_since_update / elapsed;
          if (instance_data->params.output_file) {
+            struct output_line *line = rzalloc(NULL, struct output_line);
+            line->text = ralloc_strdup(line, "");
+
             if (!instance_data->first_line_printed) {
                bool first_column = true;
 
@@ -580,32 +620,33 @@ static void snapshot_swapchain_frame(struct swapchain_data *data)
 
 #define OVERLAY_PARAM_BOOL(name) \
                if (instance_data->params.enabled[OVERLAY_PARAM_ENABLED_##name]) { \
-                  fprintf(instance_data->params.output_file, \
-                          "%s%s%s", first_column ? "" : ", ", #name, \
-                          param_unit(OVERLAY_PARAM_ENABLED_##name)); \
+                  ralloc_asprintf_append(&line->text, \
+                                         "%s%s%s", first_column ? "" : ", ", #name, \
+                                         param_unit(OVERLAY_PARAM_ENABLED_##name)); \
                   first_column = false; \
                }
 #define OVERLAY_PARAM_CUSTOM(name)
                OVERLAY_PARAMS
 #undef OVERLAY_PARAM_BOOL
 #undef OVERLAY_PARAM_CUSTOM
-               fprintf(instance_data->params.output_file, "\n");
+               ralloc_strcat(&line->text, "\n");
             }
 
             for (int s = 0; s < OVERLAY_PARAM_ENABLED_MAX; s++) {
                if (!instance_data->params.enabled[s])
                   continue;
                if (s == OVERLAY_PARAM_ENABLED_fps) {
-                  fprintf(instance_data->params.output_file,
-                          "%s%.2f", s == 0 ? "" : ", ", data->fps);
+                  ralloc_asprintf_append(&line->text,
+                                         "%s%.2f", s == 0 ? "" : ", ", data->fps);
                } else {
-                  fprintf(instance_data->params.output_file,
-                          "%s%" PRIu64, s == 0 ? "" : ", ",
-                          data->accumulated_stats.stats[s]);
+                  ralloc_asprintf_append(&line->text,
+                                         "%s%" PRIu64, s == 0 ? "" : ", ",
+                                         data->accumulated_stats.stats[s]);
                }
             }
-            fprintf(instance_data->params.output_file, "\n");
-            fflush(instance_data->params.output_file);
+            ralloc_strcat(&line->text, "\n");
+
+            queue_output_line(instance_data, line);
          }
 
          memset(&data->accumulated_stats, 0, sizeof(data->accumulated_stats));
@@ -1394,6 +1435,10 @@ static void setup_swapchain_data(struct swapchain_data *data,
    data->height = pCreateInfo->imageExtent.height;
    data->format = pCreateInfo->imageFormat;
 
+   /* Nothing gets drawn, so we only need the frame statistics. */
+   if (data->device->instance->params.no_display)
+      return;
+
    data->imgui_context = ImGui::CreateContext();
    ImGui::SetCurrentContext(data->imgui_context);
 
@@ -1535,7 +1580,8 @@ static void shutdown_swapchain_data(struct swapchain_data *data)
    device_data->vtable.DestroyBuffer(device_data->device, data->upload_font_buffer, NULL);
    device_data->vtable.FreeMemory(device_data->device, data->upload_font_buffer_mem, NULL);
 
-   ImGui::DestroyContext(data->imgui_context);
+   if (data->imgui_context)
+      ImGui::DestroyContext(data->imgui_context);
 }
 
 static struct overlay_draw *before_present(struct swapchain_data *swapchain_data,
@@ -1599,17 +1645,10 @@ static VkResult overlay_QueuePresentKHR(
    device_data->frame_stats.stats[OVERLAY_PARAM_ENABLED_frame]++;
 
    if (list_length(&queue_data->running_command_buffer) > 0) {
-      /* Before getting the query results, make sure the operations have
-       * completed.
+      /* All these command buffers were submitted, so
+       * VK_QUERY_RESULT_WAIT_BIT is enough to wait for their results,
+       * without putting a submission of our own on the app's queue.
        */
-      VK_CHECK(device_data->vtable.ResetFences(device_data->device,
-                                               1, &queue_data->queries_fence));
-      VK_CHECK(device_data->vtable.QueueSubmit(queue, 0, NULL, queue_data->queries_fence));
-      VK_CHECK(device_data->vtable.WaitForFences(device_data->device,
-                                                 1, &queue_data->queries_fence,
-                                                 VK_FALSE, UINT64_MAX));
-
-      /* Now get the results. */
       list_for_each_entry_safe(struct command_buffer_data, cmd_buffer_data,
                                &queue_data->running_command_buffer, link) {
          list_delinit(&cmd_buffer_data->link);
@@ -2244,6 +2283,13 @@ static VkResult overlay_CreateInstance(
 
    parse_overlay_env(&instance_data->params, getenv("VK_LAYER_MESA_OVERLAY_CONFIG"));
 
+   if (instance_data->params.output_file) {
+      instance_data->output_queue_ready =
+         util_queue_init(&instance_data->output_queue, "overlay_out", 32, 1,
+                         UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+                         UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY);
+   }
+
    for (int i = OVERLAY_PARAM_ENABLED_vertices;
         i <= OVERLAY_PARAM_ENABLED_compute_invocations; i++) {
       if (instance_data->params.enabled[i]) {
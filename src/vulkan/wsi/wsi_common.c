@@ -1018,6 +1018,8 @@ wsi_common_queue_present(const struct wsi_device *wsi,
 
    const VkPresentRegionsKHR *regions =
       vk_find_struct_const(pPresentInfo->pNext, PRESENT_REGIONS_KHR);
+   const VkPresentTimesInfoGOOGLE *times =
+      vk_find_struct_const(pPresentInfo->pNext, PRESENT_TIMES_INFO_GOOGLE);
 
    for (uint32_t i = 0; i < pPresentInfo->swapchainCount; i++) {
       WSI_FROM_HANDLE(wsi_swapchain, swapchain, pPresentInfo->pSwapchains[i]);
@@ -1091,7 +1093,11 @@ wsi_common_queue_present(const struct wsi_device *wsi,
       if (regions && regions->pRegions)
          region = &regions->pRegions[i];
 
-      result = swapchain->queue_present(swapchain, image_index, region);
+      const VkPresentTimeGOOGLE *time = NULL;
+      if (times && times->pTimes)
+         time = &times->pTimes[i];
+
+      result = swapchain->queue_present(swapchain, image_index, region, time);
       if (result != VK_SUCCESS)
          goto fail_present;
 
@@ -1107,6 +1113,36 @@ wsi_common_queue_present(const struct wsi_device *wsi,
    return final_result;
 }
 
+VkResult
+wsi_common_get_refresh_cycle_duration(VkSwapchainKHR _swapchain,
+                                      VkRefreshCycleDurationGOOGLE *pDisplayTimingProperties)
+{
+   WSI_FROM_HANDLE(wsi_swapchain, swapchain, _swapchain);
+
+   if (swapchain->get_refresh_cycle_duration)
+      return swapchain->get_refresh_cycle_duration(swapchain,
+                                                   pDisplayTimingProperties);
+
+   pDisplayTimingProperties->refreshDuration = 1000000000ull / 60;
+   return VK_SUCCESS;
+}
+
+VkResult
+wsi_common_get_past_presentation_timing(VkSwapchainKHR _swapchain,
+                                        uint32_t *pPresentationTimingCount,
+                                        VkPastPresentationTimingGOOGLE *pPresentationTimings)
+{
+   WSI_FROM_HANDLE(wsi_swapchain, swapchain, _swapchain);
+
+   if (swapchain->get_past_presentation_timing)
+      return swapchain->get_past_presentation_timing(swapchain,
+                                                     pPresentationTimingCount,
+                                                     pPresentationTimings);
+
+   *pPresentationTimingCount = 0;
+   return VK_SUCCESS;
+}
+
 uint64_t
 wsi_common_get_current_time(void)
 {
@@ -257,6 +257,15 @@ wsi_common_queue_present(const struct wsi_device *wsi,
                          int queue_family_index,
                          const VkPresentInfoKHR *pPresentInfo);
 
+VkResult
+wsi_common_get_refresh_cycle_duration(VkSwapchainKHR swapchain,
+                                      VkRefreshCycleDurationGOOGLE *pDisplayTimingProperties);
+
+VkResult
+wsi_common_get_past_presentation_timing(VkSwapchainKHR swapchain,
+                                        uint32_t *pPresentationTimingCount,
+                                        VkPastPresentationTimingGOOGLE *pPresentationTimings);
+
 uint64_t
 wsi_common_get_current_time(void);
 
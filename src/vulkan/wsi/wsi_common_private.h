@@ -66,7 +66,17 @@ struct wsi_swapchain {
                                   uint32_t *image_index);
    VkResult (*queue_present)(struct wsi_swapchain *swap_chain,
                              uint32_t image_index,
-                             const VkPresentRegionKHR *damage);
+                             const VkPresentRegionKHR *damage,
+                             const VkPresentTimeGOOGLE *time);
+
+   /* VK_GOOGLE_display_timing.  Optional, a swapchain without them reports
+    * a 60Hz display and no past presents.
+    */
+   VkResult (*get_refresh_cycle_duration)(struct wsi_swapchain *swap_chain,
+                                          VkRefreshCycleDurationGOOGLE *duration);
+   VkResult (*get_past_presentation_timing)(struct wsi_swapchain *swap_chain,
+                                            uint32_t *count,
+                                            VkPastPresentationTimingGOOGLE *timings);
 };
 
 bool
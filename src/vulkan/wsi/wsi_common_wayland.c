@@ -843,7 +843,8 @@ static const struct wl_callback_listener frame_listener = {
 static VkResult
 wsi_wl_swapchain_queue_present(struct wsi_swapchain *wsi_chain,
                                uint32_t image_index,
-                               const VkPresentRegionKHR *damage)
+                               const VkPresentRegionKHR *damage,
+                               const VkPresentTimeGOOGLE *time)
 {
    struct wsi_wl_swapchain *chain = (struct wsi_wl_swapchain *)wsi_chain;
 
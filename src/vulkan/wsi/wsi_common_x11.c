@@ -26,6 +26,7 @@
 #include <xcb/xcb.h>
 #include <xcb/dri3.h>
 #include <xcb/present.h>
+#include <xcb/xfixes.h>
 
 #include "util/macros.h"
 #include <stdlib.h>
@@ -54,6 +55,7 @@ struct wsi_x11_connection {
    bool has_dri3;
    bool has_dri3_modifiers;
    bool has_present;
+   bool has_xfixes;
    bool is_proprietary_x11;
 };
 
@@ -189,6 +191,18 @@ wsi_x11_connection_create(struct wsi_device *wsi_dev,
    }
 #endif
 
+   /* Present takes its update area as an XFixes region. */
+   wsi_conn->has_xfixes = false;
+   if (wsi_conn->has_present) {
+      xcb_xfixes_query_version_cookie_t ver_cookie;
+      xcb_xfixes_query_version_reply_t *ver_reply;
+
+      ver_cookie = xcb_xfixes_query_version(conn, 2, 0);
+      ver_reply = xcb_xfixes_query_version_reply(conn, ver_cookie, NULL);
+      wsi_conn->has_xfixes = ver_reply && ver_reply->major_version >= 2;
+      free(ver_reply);
+   }
+
    wsi_conn->has_dri3_modifiers = has_dri3_v1_2 && has_present_v1_2;
    wsi_conn->is_proprietary_x11 = false;
    if (amd_reply && amd_reply->present)
@@ -720,18 +734,40 @@ VkResult wsi_create_xlib_surface(const VkAllocationCallbacks *pAllocator,
    return VK_SUCCESS;
 }
 
+/* Presents with more damage rectangles than this update the whole window. */
+#define X11_MAX_DAMAGE_RECTS 64
+
 struct x11_image {
    struct wsi_image                          base;
    xcb_pixmap_t                              pixmap;
    bool                                      busy;
    struct xshmfence *                        shm_fence;
    uint32_t                                  sync_fence;
+   xcb_xfixes_region_t                       update_region;
+   /* update_region for a present with damage, XCB_NONE for everything */
+   xcb_xfixes_region_t                       update_area;
+   /* VK_GOOGLE_display_timing request of the queued present, if any */
+   bool                                      has_present_time;
+   VkPresentTimeGOOGLE                       present_time;
+};
+
+/* Number of presents whose VK_GOOGLE_display_timing results are kept
+ * around, both while waiting for their CompleteNotify and after it until
+ * the application collects them.
+ */
+#define X11_PRESENT_TIMINGS 16
+
+struct x11_present_timing {
+   /* serial of the PresentPixmap request, 0 when the slot is unused */
+   uint32_t                                  serial;
+   VkPastPresentationTimingGOOGLE            timing;
 };
 
 struct x11_swapchain {
    struct wsi_swapchain                        base;
 
    bool                                         has_dri3_modifiers;
+   bool                                         has_xfixes;
 
    xcb_connection_t *                           conn;
    xcb_window_t                                 window;
@@ -753,6 +789,18 @@ struct x11_swapchain {
    struct wsi_queue                             acquire_queue;
    pthread_t                                    queue_manager;
 
+   /* Present feedback, from CompleteNotify events which either the queue
+    * manager or the application thread may be handling.
+    */
+   pthread_mutex_t                              timing_mutex;
+   uint64_t                                     last_complete_ust;
+   uint64_t                                     last_complete_msc;
+   uint64_t                                     refresh_duration;
+   struct x11_present_timing                    pending_timings[X11_PRESENT_TIMINGS];
+   VkPastPresentationTimingGOOGLE               past_timings[X11_PRESENT_TIMINGS];
+   unsigned                                     past_timings_start;
+   unsigned                                     past_timings_count;
+
    struct x11_image                             images[0];
 };
 WSI_DEFINE_NONDISP_HANDLE_CASTS(x11_swapchain, VkSwapchainKHR)
@@ -805,6 +853,134 @@ x11_get_wsi_image(struct wsi_swapchain *wsi_chain, uint32_t image_index)
 /**
  * Process an X11 Present event. Does not update chain->status.
  */
+/**
+ * Note when a present reached the screen, for the refresh rate estimate
+ * and for VK_GOOGLE_display_timing if the present asked for it.
+ */
+static void
+x11_record_present_complete(struct x11_swapchain *chain,
+                            const xcb_present_complete_notify_event_t *complete)
+{
+   pthread_mutex_lock(&chain->timing_mutex);
+
+   if (complete->mode != XCB_PRESENT_COMPLETE_MODE_SKIP) {
+      /* Present reports UST in microseconds of CLOCK_MONOTONIC. */
+      if (chain->last_complete_ust && complete->msc > chain->last_complete_msc &&
+          complete->ust > chain->last_complete_ust) {
+         chain->refresh_duration =
+            (complete->ust - chain->last_complete_ust) * 1000 /
+            (complete->msc - chain->last_complete_msc);
+      }
+      chain->last_complete_ust = complete->ust;
+      chain->last_complete_msc = complete->msc;
+   }
+
+   struct x11_present_timing *pending =
+      &chain->pending_timings[complete->serial % X11_PRESENT_TIMINGS];
+   if (pending->serial != 0 && pending->serial == complete->serial) {
+      VkPastPresentationTimingGOOGLE *timing = &pending->timing;
+
+      timing->actualPresentTime = complete->ust * 1000;
+      timing->earliestPresentTime = timing->actualPresentTime;
+      timing->presentMargin = 0;
+      pending->serial = 0;
+
+      /* Drop the oldest result nobody asked for when we run out of room. */
+      if (chain->past_timings_count == X11_PRESENT_TIMINGS) {
+         chain->past_timings_start =
+            (chain->past_timings_start + 1) % X11_PRESENT_TIMINGS;
+         chain->past_timings_count--;
+      }
+      unsigned idx = (chain->past_timings_start + chain->past_timings_count) %
+                     X11_PRESENT_TIMINGS;
+      chain->past_timings[idx] = *timing;
+      chain->past_timings_count++;
+   }
+
+   pthread_mutex_unlock(&chain->timing_mutex);
+}
+
+/**
+ * Start tracking a present which has a VK_GOOGLE_display_timing request,
+ * and turn its desired present time into a target MSC.
+ */
+static uint64_t
+x11_queue_present_timing(struct x11_swapchain *chain, struct x11_image *image,
+                         uint64_t target_msc)
+{
+   pthread_mutex_lock(&chain->timing_mutex);
+
+   struct x11_present_timing *pending =
+      &chain->pending_timings[chain->send_sbc % X11_PRESENT_TIMINGS];
+   pending->serial = (uint32_t)chain->send_sbc;
+   pending->timing = (VkPastPresentationTimingGOOGLE) {
+      .presentID = image->present_time.presentID,
+      .desiredPresentTime = image->present_time.desiredPresentTime,
+   };
+
+   uint64_t desired = image->present_time.desiredPresentTime;
+   uint64_t last_time = chain->last_complete_ust * 1000;
+   if (desired > last_time && chain->last_complete_ust &&
+       chain->refresh_duration) {
+      uint64_t msc = chain->last_complete_msc +
+                     DIV_ROUND_UP(desired - last_time, chain->refresh_duration);
+      target_msc = MAX2(target_msc, msc);
+   }
+
+   pthread_mutex_unlock(&chain->timing_mutex);
+
+   return target_msc;
+}
+
+static VkResult
+x11_get_refresh_cycle_duration(struct wsi_swapchain *anv_chain,
+                               VkRefreshCycleDurationGOOGLE *duration)
+{
+   struct x11_swapchain *chain = (struct x11_swapchain *)anv_chain;
+
+   pthread_mutex_lock(&chain->timing_mutex);
+   /* Until two presents have completed, assume 60Hz. */
+   duration->refreshDuration = chain->refresh_duration ?
+                               chain->refresh_duration : 1000000000ull / 60;
+   pthread_mutex_unlock(&chain->timing_mutex);
+
+   return chain->status < 0 ? chain->status : VK_SUCCESS;
+}
+
+static VkResult
+x11_get_past_presentation_timing(struct wsi_swapchain *anv_chain,
+                                 uint32_t *count,
+                                 VkPastPresentationTimingGOOGLE *timings)
+{
+   struct x11_swapchain *chain = (struct x11_swapchain *)anv_chain;
+   VkResult result = VK_SUCCESS;
+
+   pthread_mutex_lock(&chain->timing_mutex);
+
+   if (!timings) {
+      *count = chain->past_timings_count;
+   } else {
+      if (*count < chain->past_timings_count)
+         result = VK_INCOMPLETE;
+      else
+         *count = chain->past_timings_count;
+
+      /* Results handed out are consumed. */
+      for (uint32_t i = 0; i < *count; i++) {
+         timings[i] = chain->past_timings[chain->past_timings_start];
+         chain->past_timings_start =
+            (chain->past_timings_start + 1) % X11_PRESENT_TIMINGS;
+      }
+      chain->past_timings_count -= *count;
+   }
+
+   pthread_mutex_unlock(&chain->timing_mutex);
+
+   if (chain->status < 0)
+      return chain->status;
+   return result;
+}
+
 static VkResult
 x11_handle_dri3_present_event(struct x11_swapchain *chain,
                               xcb_present_generic_event_t *event)
@@ -837,8 +1013,10 @@ x11_handle_dri3_present_event(struct x11_swapchain *chain,
 
    case XCB_PRESENT_EVENT_COMPLETE_NOTIFY: {
       xcb_present_complete_notify_event_t *complete = (void *) event;
-      if (complete->kind == XCB_PRESENT_COMPLETE_KIND_PIXMAP)
+      if (complete->kind == XCB_PRESENT_COMPLETE_KIND_PIXMAP) {
          chain->last_present_msc = complete->msc;
+         x11_record_present_complete(chain, complete);
+      }
 
       VkResult result = VK_SUCCESS;
 
@@ -1007,13 +1185,15 @@ x11_present_to_x11(struct x11_swapchain *chain, uint32_t image_index,
    xshmfence_reset(image->shm_fence);
 
    ++chain->send_sbc;
+   if (image->has_present_time)
+      target_msc = x11_queue_present_timing(chain, image, target_msc);
    xcb_void_cookie_t cookie =
       xcb_present_pixmap(chain->conn,
                          chain->window,
                          image->pixmap,
                          (uint32_t) chain->send_sbc,
                          0,                                    /* valid */
-                         0,                                    /* update */
+                         image->update_area,                   /* update */
                          0,                                    /* x_off */
                          0,                                    /* y_off */
                          XCB_NONE,                             /* target_crtc */
@@ -1052,7 +1232,8 @@ x11_acquire_next_image(struct wsi_swapchain *anv_chain,
 static VkResult
 x11_queue_present(struct wsi_swapchain *anv_chain,
                   uint32_t image_index,
-                  const VkPresentRegionKHR *damage)
+                  const VkPresentRegionKHR *damage,
+                  const VkPresentTimeGOOGLE *time)
 {
    struct x11_swapchain *chain = (struct x11_swapchain *)anv_chain;
 
@@ -1060,7 +1241,36 @@ x11_queue_present(struct wsi_swapchain *anv_chain,
    if (chain->status < 0)
       return chain->status;
 
-   chain->images[image_index].busy = true;
+   struct x11_image *image = &chain->images[image_index];
+
+   /* Only let the server copy the damaged part of the image.  The region
+    * is set on this thread ahead of the present, which the connection
+    * keeps in order even when the present is sent from the queue manager.
+    */
+   image->update_area = XCB_NONE;
+   if (damage && damage->pRectangles && damage->rectangleCount > 0 &&
+       damage->rectangleCount <= X11_MAX_DAMAGE_RECTS &&
+       image->update_region != XCB_NONE) {
+      xcb_rectangle_t rects[X11_MAX_DAMAGE_RECTS];
+
+      for (unsigned i = 0; i < damage->rectangleCount; i++) {
+         const VkRectLayerKHR *rect = &damage->pRectangles[i];
+
+         rects[i].x = rect->offset.x;
+         rects[i].y = rect->offset.y;
+         rects[i].width = rect->extent.width;
+         rects[i].height = rect->extent.height;
+      }
+      xcb_xfixes_set_region(chain->conn, image->update_region,
+                            damage->rectangleCount, rects);
+      image->update_area = image->update_region;
+   }
+
+   image->has_present_time = time != NULL;
+   if (time)
+      image->present_time = *time;
+
+   image->busy = true;
    if (chain->has_present_queue) {
       wsi_queue_push(&chain->present_queue, image_index);
       return chain->status;
@@ -1225,6 +1435,14 @@ x11_image_init(VkDevice device_h, struct x11_swapchain *chain,
                           false,
                           fence_fd);
 
+   image->update_region = XCB_NONE;
+   image->update_area = XCB_NONE;
+   image->has_present_time = false;
+   if (chain->has_xfixes) {
+      image->update_region = xcb_generate_id(chain->conn);
+      xcb_xfixes_create_region(chain->conn, image->update_region, 0, NULL);
+   }
+
    image->busy = false;
    xshmfence_trigger(image->shm_fence);
 
@@ -1253,6 +1471,11 @@ x11_image_finish(struct x11_swapchain *chain,
    xcb_discard_reply(chain->conn, cookie.sequence);
    xshmfence_unmap_shm(image->shm_fence);
 
+   if (image->update_region != XCB_NONE) {
+      cookie = xcb_xfixes_destroy_region(chain->conn, image->update_region);
+      xcb_discard_reply(chain->conn, cookie.sequence);
+   }
+
    cookie = xcb_free_pixmap(chain->conn, image->pixmap);
    xcb_discard_reply(chain->conn, cookie.sequence);
 
@@ -1363,6 +1586,7 @@ x11_swapchain_destroy(struct wsi_swapchain *anv_chain,
                                              XCB_PRESENT_EVENT_MASK_NO_EVENT);
    xcb_discard_reply(chain->conn, cookie.sequence);
 
+   pthread_mutex_destroy(&chain->timing_mutex);
    wsi_swapchain_finish(&chain->base);
 
    vk_free(pAllocator, chain);
@@ -1446,6 +1670,8 @@ x11_surface_create_swapchain(VkIcdSurfaceBase *icd_surface,
    chain->base.get_wsi_image = x11_get_wsi_image;
    chain->base.acquire_next_image = x11_acquire_next_image;
    chain->base.queue_present = x11_queue_present;
+   chain->base.get_refresh_cycle_duration = x11_get_refresh_cycle_duration;
+   chain->base.get_past_presentation_timing = x11_get_past_presentation_timing;
    chain->base.present_mode = present_mode;
    chain->base.image_count = num_images;
    chain->conn = conn;
@@ -1458,6 +1684,7 @@ x11_surface_create_swapchain(VkIcdSurfaceBase *icd_surface,
    chain->has_present_queue = false;
    chain->status = VK_SUCCESS;
    chain->has_dri3_modifiers = wsi_conn->has_dri3_modifiers;
+   chain->has_xfixes = wsi_conn->has_xfixes;
 
    /* If we are reallocating from an old swapchain, then we inherit its
     * last completion mode, to ensure we don't get into reallocation
@@ -1501,6 +1728,17 @@ x11_surface_create_swapchain(VkIcdSurfaceBase *icd_surface,
                           (uint32_t []) { 0 });
    xcb_discard_reply(chain->conn, cookie.sequence);
 
+   chain->last_complete_ust = 0;
+   chain->last_complete_msc = 0;
+   chain->refresh_duration = 0;
+   memset(chain->pending_timings, 0, sizeof(chain->pending_timings));
+   chain->past_timings_start = 0;
+   chain->past_timings_count = 0;
+   if (pthread_mutex_init(&chain->timing_mutex, NULL)) {
+      result = VK_ERROR_OUT_OF_HOST_MEMORY;
+      goto fail_register;
+   }
+
    uint64_t *modifiers[2] = {NULL, NULL};
    uint32_t num_modifiers[2] = {0, 0};
    uint32_t num_tranches = 0;
@@ -1580,6 +1818,8 @@ fail_init_images:
    for (int i = 0; i < ARRAY_SIZE(modifiers); i++)
       vk_free(pAllocator, modifiers[i]);
 
+   pthread_mutex_destroy(&chain->timing_mutex);
+
 fail_register:
    xcb_unregister_for_special_event(chain->conn, chain->special_event);
 